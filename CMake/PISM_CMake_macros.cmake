@@ -158,6 +158,9 @@ macro(pism_find_prerequisites)
   # MPI
   find_package (MPI REQUIRED COMPONENTS C)
 
+  # Threads (used by the asynchronous NetCDF-3 writer)
+  find_package (Threads REQUIRED)
+
   # Other required libraries
   find_package (UDUNITS2 REQUIRED)
   find_package (GSL REQUIRED)
@@ -178,6 +181,25 @@ macro(pism_find_prerequisites)
     find_package (ParallelIO REQUIRED)
   endif()
 
+  if (Pism_USE_ADIOS2)
+    find_package (ADIOS2 REQUIRED)
+  endif()
+
+  if (Pism_USE_FFTW_MPI)
+    get_filename_component(FFTW_LIB_DIR ${FFTW_LIBRARIES} PATH)
+    find_library (FFTW_MPI_LIBRARIES NAMES fftw3_mpi HINTS ${FFTW_LIB_DIR})
+    mark_as_advanced (FFTW_MPI_LIBRARIES)
+
+    if (NOT FFTW_MPI_LIBRARIES)
+      message(FATAL_ERROR
+        "Could not find FFTW's MPI library (libfftw3_mpi) next to ${FFTW_LIBRARIES}.")
+    endif()
+  endif()
+
+  if (Pism_USE_OPENMP)
+    find_package (OpenMP REQUIRED)
+  endif()
+
   if (Pism_USE_PARALLEL_NETCDF4)
     # Try to find netcdf_par.h. We assume that NetCDF was compiled with
     # parallel I/O if this header is present.
@@ -241,6 +263,7 @@ macro(pism_set_dependencies)
     ${GSL_LIBRARIES}
     ${NETCDF_LIBRARIES}
     ${MPI_C_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT}
     ${HDF5_LIBRARIES}
     ${HDF5_HL_LIBRARIES})
 
@@ -265,6 +288,24 @@ macro(pism_set_dependencies)
     list (APPEND Pism_EXTERNAL_LIBS ${PNETCDF_LIBRARIES})
   endif()
 
+  if (Pism_USE_ADIOS2)
+    get_target_property (ADIOS2_INCLUDES adios2::cxx11_mpi INTERFACE_INCLUDE_DIRECTORIES)
+    include_directories (${ADIOS2_INCLUDES})
+    list (APPEND Pism_EXTERNAL_LIBS adios2::cxx11_mpi)
+  endif()
+
+  if (Pism_USE_FFTW_MPI)
+    # libfftw3_mpi has to precede libfftw3
+    list (INSERT Pism_EXTERNAL_LIBS 0 ${FFTW_MPI_LIBRARIES})
+  endif()
+
+  if (Pism_USE_OPENMP)
+    # OpenMP_CXX_FLAGS are needed both to compile and to link
+    set (CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${OpenMP_C_FLAGS}")
+    set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+    list (APPEND Pism_EXTERNAL_LIBS ${OpenMP_CXX_LIBRARIES})
+  endif()
+
   # Hide distracting CMake variables
   mark_as_advanced(file_cmd MPI_LIBRARY MPI_EXTRA_LIBRARY
     HDF5_C_LIBRARY_dl HDF5_C_LIBRARY_hdf5 HDF5_C_LIBRARY_hdf5_hl HDF5_C_LIBRARY_m HDF5_C_LIBRARY_z
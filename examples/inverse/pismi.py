@@ -253,7 +253,14 @@ def createDesignVec(grid, design_var, name=None, **kwargs):
 
 
 # Main code starts here
-def run():
+def run(penalty_weight=None, suffix=""):
+    """Run an inversion.
+
+    :param penalty_weight: Tikhonov penalty weight overriding `inverse.tikhonov.penalty_weight`
+    :param suffix: suffix added to the output file name
+
+    Returns the name of the output file and the final misfit.
+    """
     context = PISM.Context()
     config = context.config
     com = context.com
@@ -272,6 +279,8 @@ def run():
     -inv_forward  model       forward model: only 'ssa' supported
     -inv_design   design_var  design variable name; one of 'tauc'/'hardav' for SSA inversions
     -inv_method   meth        algorithm for inversion [sd,nlcg,ign,tikhonov_lmvm]
+    -inv_multilevel factors   coarsening factors of grids used to compute the initial guess, e.g. 4,2
+    -inv_tikhonov_sweep etas  Tikhonov penalty weights to try concurrently, e.g. 0.1,1,10
 
     notes:
       * only one of -i/-a is allowed; both specify the input file
@@ -339,130 +348,180 @@ def run():
     if output_filename is None:
         output_filename = "pismi_" + os.path.basename(input_filename)
 
-    saving_inv_data = (inv_data_filename != output_filename)
+    if penalty_weight is not None:
+        if not inv_method.startswith("tikhonov"):
+            PISM.verbPrintf(1, com, "\nError: -inv_tikhonov_sweep requires a Tikhonov inversion method.\n")
+            sys.exit(1)
+        config.set_number("inverse.tikhonov.penalty_weight", penalty_weight)
 
-    forward_run = SSAForwardRun(input_filename, inv_data_filename, design_var)
-    forward_run.setup()
-    design_param = forward_run.designVariableParameterization()
-    solver = PISM.invert.ssa.createInvSSASolver(forward_run)
+    if len(suffix) > 0:
+        if append_mode:
+            PISM.verbPrintf(1, com, "\nError: -inv_tikhonov_sweep cannot be combined with -a.\n")
+            sys.exit(1)
+        root, extension = os.path.splitext(output_filename)
+        output_filename = root + suffix + extension
 
-    modeldata = forward_run.modeldata
-    vecs = modeldata.vecs
-    grid = modeldata.grid
+    saving_inv_data = (inv_data_filename != output_filename)
 
-    # Determine the prior guess for tauc/hardav. This can be one of
-    # a) tauc/hardav from the input file (default)
-    # b) tauc/hardav_prior from the inv_datafile if -inv_use_design_prior is set
-    design_prior = createDesignVec(grid, design_var, '%s_prior' % design_var)
-    long_name = design_prior.metadata().get_string("long_name")
-    units = design_prior.metadata().get_string("units")
-    design_prior.set_attrs("", "best prior estimate for %s (used for inversion)" % long_name,
-                           units, units, "", 0)
-    if PISM.util.fileHasVariable(inv_data_filename, "%s_prior" % design_var) and use_design_prior:
-        PISM.logging.logMessage("  Reading '%s_prior' from inverse data file %s.\n" % (design_var, inv_data_filename))
-        design_prior.regrid(inv_data_filename, critical=True)
-        vecs.add(design_prior, writing=saving_inv_data)
-    else:
-        if not PISM.util.fileHasVariable(input_filename, design_var):
-            PISM.verbPrintf(1, com, "Initial guess for design variable is not available as '%s' in %s.\nYou can provide an initial guess in the inverse data file.\n" % (
-                design_var, input_filename))
-            exit(1)
-        PISM.logging.logMessage("Reading '%s_prior' from '%s' in input file.\n" % (design_var, design_var))
-        design = createDesignVec(grid, design_var)
-        design.regrid(input_filename, True)
-        design_prior.copy_from(design)
-        vecs.add(design_prior, writing=True)
-
-    if using_zeta_fixed_mask:
-        if PISM.util.fileHasVariable(inv_data_filename, "zeta_fixed_mask"):
-            zeta_fixed_mask = PISM.model.createZetaFixedMaskVec(grid)
-            zeta_fixed_mask.regrid(inv_data_filename)
-            vecs.add(zeta_fixed_mask)
+    def setup_stage(stage):
+        "Set up the inversion on the grid used by a stage of a multilevel inversion."
+        forward_run = SSAForwardRun(input_filename, inv_data_filename, design_var,
+                                    coarsening_factor=stage.coarsening_factor)
+        forward_run.setup()
+        design_param = forward_run.designVariableParameterization()
+        solver = PISM.invert.ssa.createInvSSASolver(forward_run)
+
+        modeldata = forward_run.modeldata
+        vecs = modeldata.vecs
+        grid = modeldata.grid
+
+        # Determine the prior guess for tauc/hardav. This can be one of
+        # a) tauc/hardav from the input file (default)
+        # b) tauc/hardav_prior from the inv_datafile if -inv_use_design_prior is set
+        design_prior = createDesignVec(grid, design_var, '%s_prior' % design_var)
+        long_name = design_prior.metadata().get_string("long_name")
+        units = design_prior.metadata().get_string("units")
+        design_prior.set_attrs("", "best prior estimate for %s (used for inversion)" % long_name,
+                               units, units, "", 0)
+        if PISM.util.fileHasVariable(inv_data_filename, "%s_prior" % design_var) and use_design_prior:
+            PISM.logging.logMessage("  Reading '%s_prior' from inverse data file %s.\n" % (design_var, inv_data_filename))
+            design_prior.regrid(inv_data_filename, critical=True)
+            vecs.add(design_prior, writing=saving_inv_data)
         else:
-            if design_var == 'tauc':
-                logMessage(
-                    "  Computing 'zeta_fixed_mask' (i.e. locations where design variable '%s' has a fixed value).\n" % design_var)
+            if not PISM.util.fileHasVariable(input_filename, design_var):
+                PISM.verbPrintf(1, com, "Initial guess for design variable is not available as '%s' in %s.\nYou can provide an initial guess in the inverse data file.\n" % (
+                    design_var, input_filename))
+                exit(1)
+            PISM.logging.logMessage("Reading '%s_prior' from '%s' in input file.\n" % (design_var, design_var))
+            design = createDesignVec(grid, design_var)
+            design.regrid(input_filename, True)
+            design_prior.copy_from(design)
+            vecs.add(design_prior, writing=True)
+
+        if using_zeta_fixed_mask:
+            if PISM.util.fileHasVariable(inv_data_filename, "zeta_fixed_mask"):
                 zeta_fixed_mask = PISM.model.createZetaFixedMaskVec(grid)
-                zeta_fixed_mask.set(1)
-                mask = vecs.mask
-                with PISM.vec.Access(comm=zeta_fixed_mask, nocomm=mask):
-                    for (i, j) in grid.points():
-                        if mask.grounded_ice(i, j):
-                            zeta_fixed_mask[i, j] = 0
+                zeta_fixed_mask.regrid(inv_data_filename)
                 vecs.add(zeta_fixed_mask)
-
-                adjustTauc(vecs.mask, design_prior)
-            elif design_var == 'hardav':
-                PISM.logging.logPrattle(
-                    "Skipping 'zeta_fixed_mask' for design variable 'hardav'; no natural locations to fix its value.")
-                pass
             else:
-                raise NotImplementedError("Unable to build 'zeta_fixed_mask' for design variable %s.", design_var)
-
-    # Convert design_prior -> zeta_prior
-    zeta_prior = PISM.IceModelVec2S()
-    zeta_prior.create(grid, "zeta_prior", PISM.WITH_GHOSTS, WIDE_STENCIL)
-    design_param.convertFromDesignVariable(design_prior, zeta_prior)
-    vecs.add(zeta_prior, writing=True)
-
-    # Determine the initial guess for zeta.  If we are restarting, load it from
-    # the output file.  Otherwise, if 'zeta_inv' is in the inverse data file, use it.
-    # If none of the above, copy from 'zeta_prior'.
-    zeta = PISM.IceModelVec2S()
-    zeta.create(grid, "zeta_inv", PISM.WITH_GHOSTS, WIDE_STENCIL)
-    zeta.set_attrs("diagnostic", "zeta_inv", "1", "1", "zeta_inv", 0)
-    if do_restart:
-        # Just to be sure, verify that we have a 'zeta_inv' in the output file.
-        if not PISM.util.fileHasVariable(output_filename, 'zeta_inv'):
-            PISM.verbPrintf(
-                1, com, "Unable to restart computation: file %s is missing variable 'zeta_inv'", output_filename)
-            exit(1)
-        PISM.logging.logMessage("  Inversion starting from 'zeta_inv' found in %s\n" % output_filename)
-        zeta.regrid(output_filename, True)
-
-    elif PISM.util.fileHasVariable(inv_data_filename, 'zeta_inv'):
-        PISM.logging.logMessage("  Inversion starting from 'zeta_inv' found in %s\n" % inv_data_filename)
-        zeta.regrid(inv_data_filename, True)
-    else:
-        zeta.copy_from(zeta_prior)
+                if design_var == 'tauc':
+                    logMessage(
+                        "  Computing 'zeta_fixed_mask' (i.e. locations where design variable '%s' has a fixed value).\n" % design_var)
+                    zeta_fixed_mask = PISM.model.createZetaFixedMaskVec(grid)
+                    zeta_fixed_mask.set(1)
+                    mask = vecs.mask
+                    with PISM.vec.Access(comm=zeta_fixed_mask, nocomm=mask):
+                        for (i, j) in grid.points():
+                            if mask.grounded_ice(i, j):
+                                zeta_fixed_mask[i, j] = 0
+                    vecs.add(zeta_fixed_mask)
+
+                    adjustTauc(vecs.mask, design_prior)
+                elif design_var == 'hardav':
+                    PISM.logging.logPrattle(
+                        "Skipping 'zeta_fixed_mask' for design variable 'hardav'; no natural locations to fix its value.")
+                    pass
+                else:
+                    raise NotImplementedError("Unable to build 'zeta_fixed_mask' for design variable %s.", design_var)
+
+        # Convert design_prior -> zeta_prior
+        zeta_prior = PISM.IceModelVec2S()
+        zeta_prior.create(grid, "zeta_prior", PISM.WITH_GHOSTS, WIDE_STENCIL)
+        design_param.convertFromDesignVariable(design_prior, zeta_prior)
+        vecs.add(zeta_prior, writing=True)
+
+        # Determine the initial guess for zeta.  If we are restarting, load it from
+        # the output file.  Otherwise, if 'zeta_inv' is in the inverse data file, use it.
+        # If none of the above, copy from 'zeta_prior'.
+        zeta = PISM.IceModelVec2S()
+        zeta.create(grid, "zeta_inv", PISM.WITH_GHOSTS, WIDE_STENCIL)
+        zeta.set_attrs("diagnostic", "zeta_inv", "1", "1", "zeta_inv", 0)
+        if do_restart:
+            # Just to be sure, verify that we have a 'zeta_inv' in the output file.
+            if not PISM.util.fileHasVariable(output_filename, 'zeta_inv'):
+                PISM.verbPrintf(
+                    1, com, "Unable to restart computation: file %s is missing variable 'zeta_inv'", output_filename)
+                exit(1)
+            PISM.logging.logMessage("  Inversion starting from 'zeta_inv' found in %s\n" % output_filename)
+            zeta.regrid(output_filename, True)
+
+        elif PISM.util.fileHasVariable(inv_data_filename, 'zeta_inv'):
+            PISM.logging.logMessage("  Inversion starting from 'zeta_inv' found in %s\n" % inv_data_filename)
+            zeta.regrid(inv_data_filename, True)
+        else:
+            zeta.copy_from(zeta_prior)
 
-    vel_ssa_observed = None
-    vel_ssa_observed = PISM.model.create2dVelocityVec(grid, '_ssa_observed', stencil_width=2)
-    if PISM.util.fileHasVariable(inv_data_filename, "u_ssa_observed"):
-        vel_ssa_observed.regrid(inv_data_filename, True)
-        vecs.add(vel_ssa_observed, writing=saving_inv_data)
-    else:
-        if not PISM.util.fileHasVariable(inv_data_filename, "u_surface_observed"):
-            PISM.verbPrintf(
-                1, context.com, "Neither u/v_ssa_observed nor u/v_surface_observed is available in %s.\nAt least one must be specified.\n" % inv_data_filename)
-            exit(1)
-        vel_surface_observed = PISM.model.create2dVelocityVec(grid, '_surface_observed', stencil_width=2)
-        vel_surface_observed.regrid(inv_data_filename, True)
-        vecs.add(vel_surface_observed, writing=saving_inv_data)
-
-        sia_solver = PISM.SIAFD
-        if is_regional:
-            sia_solver = PISM.SIAFD_Regional
-        vel_sia_observed = PISM.sia.computeSIASurfaceVelocities(modeldata, sia_solver)
-
-        vel_sia_observed.metadata(0).set_name('u_sia_observed')
-        vel_sia_observed.metadata(0).set_string('long_name', "x-component of the 'observed' SIA velocities")
-
-        vel_sia_observed.metadata(1).set_name('v_sia_observed')
-        vel_sia_observed.metadata(1).set_string('long_name', "y-component of the 'observed' SIA velocities")
-
-        vel_ssa_observed.copy_from(vel_surface_observed)
-        vel_ssa_observed.add(-1, vel_sia_observed)
-        vecs.add(vel_ssa_observed, writing=True)
-
-    # If the inverse data file has a variable tauc/hardav_true, this is probably
-    # a synthetic inversion.  We'll load it now so that it will get written
-    # out, if needed, at the end of the computation in the output file.
-    if PISM.util.fileHasVariable(inv_data_filename, "%s_true" % design_var):
-        design_true = createDesignVec(grid, design_var, '%s_true' % design_var)
-        design_true.regrid(inv_data_filename, True)
-        design_true.read_attributes(inv_data_filename)
-        vecs.add(design_true, writing=saving_inv_data)
+        vel_ssa_observed = None
+        vel_ssa_observed = PISM.model.create2dVelocityVec(grid, '_ssa_observed', stencil_width=2)
+        if PISM.util.fileHasVariable(inv_data_filename, "u_ssa_observed"):
+            vel_ssa_observed.regrid(inv_data_filename, True)
+            vecs.add(vel_ssa_observed, writing=saving_inv_data)
+        else:
+            if not PISM.util.fileHasVariable(inv_data_filename, "u_surface_observed"):
+                PISM.verbPrintf(
+                    1, context.com, "Neither u/v_ssa_observed nor u/v_surface_observed is available in %s.\nAt least one must be specified.\n" % inv_data_filename)
+                exit(1)
+            vel_surface_observed = PISM.model.create2dVelocityVec(grid, '_surface_observed', stencil_width=2)
+            vel_surface_observed.regrid(inv_data_filename, True)
+            vecs.add(vel_surface_observed, writing=saving_inv_data)
+
+            sia_solver = PISM.SIAFD
+            if is_regional:
+                sia_solver = PISM.SIAFD_Regional
+            vel_sia_observed = PISM.sia.computeSIASurfaceVelocities(modeldata, sia_solver)
+
+            vel_sia_observed.metadata(0).set_name('u_sia_observed')
+            vel_sia_observed.metadata(0).set_string('long_name', "x-component of the 'observed' SIA velocities")
+
+            vel_sia_observed.metadata(1).set_name('v_sia_observed')
+            vel_sia_observed.metadata(1).set_string('long_name', "y-component of the 'observed' SIA velocities")
+
+            vel_ssa_observed.copy_from(vel_surface_observed)
+            vel_ssa_observed.add(-1, vel_sia_observed)
+            vecs.add(vel_ssa_observed, writing=True)
+
+        # If the inverse data file has a variable tauc/hardav_true, this is probably
+        # a synthetic inversion.  We'll load it now so that it will get written
+        # out, if needed, at the end of the computation in the output file.
+        if PISM.util.fileHasVariable(inv_data_filename, "%s_true" % design_var):
+            design_true = createDesignVec(grid, design_var, '%s_true' % design_var)
+            design_true.regrid(inv_data_filename, True)
+            design_true.read_attributes(inv_data_filename)
+            vecs.add(design_true, writing=saving_inv_data)
+
+        return (solver, zeta_prior, vel_ssa_observed, zeta)
+
+    stages = PISM.invert.multilevel.schedule(config)
+    if do_restart and len(stages) > 1:
+        logMessage("  Restarting: skipping coarse stages of the multilevel inversion.\n")
+        stages = stages[-1:]
+
+    # Solve on coarse grids (if requested) to get a better initial guess.
+    zeta_coarse = None
+    if len(stages) > 1:
+        multilevel = PISM.invert.multilevel.MultilevelInversion(stages[:-1])
+        multilevel.addIterationListener(PISM.invert.ssa.printIteration)
+        if inv_method.startswith('tikhonov'):
+            multilevel.addIterationListener(PISM.invert.ssa.printTikhonovProgress)
+
+        reason = multilevel.solve(setup_stage)
+        if reason.failed():
+            PISM.logging.logError("Coarse inverse solve FAILURE:\n%s\n" % reason.nested_description(1))
+            quit()
+
+        (zeta_coarse, _) = multilevel.solver.inverseSolution()
+
+    (solver, zeta_prior, vel_ssa_observed, zeta) = setup_stage(stages[-1])
+
+    if zeta_coarse is not None:
+        logMessage("  Inversion starting from the solution on a coarser grid\n")
+        PISM.invert.multilevel.prolongate(zeta_coarse, zeta)
+
+    forward_run = solver.ssarun
+    design_param = forward_run.designVariableParameterization()
+    modeldata = forward_run.modeldata
+    vecs = modeldata.vecs
+    grid = modeldata.grid
 
     # Establish a logger which will save logging messages to the output file.
     message_logger = PISM.logging.CaptureLogger(output_filename, 'pismi_log')
@@ -580,9 +639,42 @@ def run():
     # Save the misfit history
     misfit_logger.write(output_filename)
 
+    misfit = misfit_logger.misfit_history[-1] if len(misfit_logger.misfit_history) > 0 else None
+
+    return output_filename, misfit
+
+
+def run_sweep(weights):
+    """Run inversions using penalty weights `weights` concurrently and keep the best result
+    (see :mod:`PISM.invert.sweep`)."""
+    import shutil
+
+    sweep = PISM.invert.sweep.PenaltyWeightSweep(weights)
+
+    output_filename, misfit = run(sweep.penalty_weight, sweep.suffix)
+
+    config = PISM.Context().config
+    target_misfit = None
+    if config.get_string("inverse.state_func") == "meansquare":
+        target_misfit = config.get_number("inverse.target_misfit")
+
+    best = sweep.select(misfit if misfit is not None else float("inf"), target_misfit)
+
+    # copy the selected result to the output file name without the suffix
+    if sweep.group == best and PISM.Context().rank == 0:
+        root, extension = os.path.splitext(output_filename)
+        filename = root[:len(root) - len(sweep.suffix)] + extension
+        shutil.copyfile(output_filename, filename)
+        logMessage("  copied %s to %s\n" % (output_filename, filename))
+    sweep.world.Barrier()
+
 
 if __name__ == "__main__":
-    run()
+    weights = PISM.invert.sweep.penalty_weights()
+    if len(weights) > 1:
+        run_sweep(weights)
+    else:
+        run()
 
 # try to stop coverage and save a report:
 try:                            # pragma: no cover
@@ -20,3 +20,5 @@
 
 from PISM.invert import ssa
 from PISM.invert import listener
+from PISM.invert import multilevel
+from PISM.invert import sweep
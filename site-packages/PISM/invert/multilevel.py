@@ -0,0 +1,207 @@
+# Copyright (C) 2020 PISM Authors
+#
+# This file is part of PISM.
+#
+# PISM is free software; you can redistribute it and/or modify it under the
+# terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 3 of the License, or (at your option) any later
+# version.
+#
+# PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License
+# along with PISM; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""Multilevel (coarse-to-fine) SSA inversions.
+
+An inversion is solved on a sequence of grids, starting with the coarsest one. The
+parameterized design variable :math:`\\zeta` computed at each stage is interpolated onto
+the grid of the next stage (using regridding code used to read model inputs) and used as
+the initial guess there. Coarse stages are cheap and provide a much better initial guess
+than the prior, so the expensive full-resolution stage needs fewer iterations.
+
+Typical use::
+
+    def setup(stage):
+        forward_run = SSAForwardRunFromInputFile(input_file, inv_data_file, "tauc",
+                                                 coarsening_factor=stage.coarsening_factor)
+        forward_run.setup()
+        ...
+        return (solver, zeta_prior, u_obs, zeta)
+
+    ml = PISM.invert.multilevel.MultilevelInversion(schedule(config))
+    reason = ml.solve(setup)
+    (zeta, u) = ml.solver.inverseSolution()
+"""
+
+import contextlib
+
+import PISM
+from PISM.logging import logMessage
+
+
+class Stage(object):
+    """One stage of a multilevel inversion."""
+
+    def __init__(self, coarsening_factor, config=None):
+        """
+        :param coarsening_factor: ratio of the grid spacing used by this stage to the one
+                                  in the input file (1 corresponds to the full resolution)
+        :param config: dictionary of configuration parameters to set during this stage,
+                       e.g. ``{"inverse.tikhonov.rtol" : 0.1, "inverse.max_iterations" : 50}``
+        """
+        self.coarsening_factor = int(coarsening_factor)
+        if self.coarsening_factor < 1:
+            raise ValueError("invalid coarsening factor: %d" % self.coarsening_factor)
+
+        self.config = dict(config or {})
+
+    def __repr__(self):
+        return "Stage(%d, %s)" % (self.coarsening_factor, self.config)
+
+
+def schedule(config):
+    """Returns the list of stages of a multilevel inversion defined by configuration
+    parameters. The last stage always uses the full-resolution grid.
+
+    Coarse stages use ``inverse.multilevel.coarsening_factors`` (coarsest first) and
+    stopping tolerances ``inverse.tikhonov.rtol`` multiplied by the coarsening factor, so
+    that tolerances get tighter as the grid is refined.
+    """
+    factors = config.get_string("inverse.multilevel.coarsening_factors")
+    factors = [int(f) for f in factors.split(",") if len(f.strip()) > 0]
+
+    rtol = config.get_number("inverse.tikhonov.rtol")
+
+    stages = [Stage(f, {"inverse.tikhonov.rtol": rtol * f}) for f in factors if f > 1]
+
+    return stages + [Stage(1)]
+
+
+def coarsen(M, factor, registration):
+    """Number of grid points in a direction of a grid coarsened by `factor`, given the
+    number of points `M` in the original grid. Grid extents are not affected."""
+    if registration == PISM.CELL_CORNER:
+        # keep grid points at domain boundaries
+        return max((M - 1) // factor + 1, 3)
+    return max(M // factor, 3)
+
+
+@contextlib.contextmanager
+def config_overrides(config, parameters):
+    """Set configuration `parameters` (a dictionary) for the duration of a `with` block."""
+
+    def get_value(name):
+        if config.is_set(name):
+            t = config.type(name)
+            if t == "flag":
+                return config.get_flag(name)
+            if t in ["string", "keyword"]:
+                return config.get_string(name)
+            return config.get_number(name)
+        raise ValueError("unknown configuration parameter %s" % name)
+
+    def set_value(name, value):
+        if isinstance(value, bool):
+            config.set_flag(name, value)
+        elif isinstance(value, str):
+            config.set_string(name, value)
+        else:
+            config.set_number(name, value)
+
+    old = {name: get_value(name) for name in parameters}
+    try:
+        for name, value in parameters.items():
+            set_value(name, value)
+        yield
+    finally:
+        for name, value in old.items():
+            set_value(name, value)
+
+
+def prolongate(zeta_coarse, zeta_fine):
+    """Interpolate `zeta_coarse` onto the grid of `zeta_fine` (updating ghosts of
+    `zeta_fine` if present). Uses an in-memory file to avoid writing to disk."""
+
+    name = zeta_fine.get_name()
+    units = zeta_fine.metadata().get_string("units")
+
+    tmp = PISM.IceModelVec2S(zeta_coarse.grid(), name, PISM.WITHOUT_GHOSTS)
+    tmp.set_attrs("internal", "interpolation source", units, units, "", 0)
+    tmp.copy_from(zeta_coarse)
+
+    filename = "memory:multilevel_%s" % name
+
+    f = PISM.File(zeta_coarse.grid().com, filename, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_CLOBBER)
+    try:
+        tmp.define(f)
+        tmp.write(f)
+    finally:
+        f.close()
+
+    zeta_fine.regrid(filename, critical=True)
+
+
+class MultilevelInversion(object):
+    """Driver running a sequence of inversions from coarse to fine grids."""
+
+    def __init__(self, stages):
+        """:param stages: list of :class:`Stage` instances, coarsest first."""
+        self.stages = stages
+        self.listeners = []
+        self.stage_listeners = []
+        self.solver = None
+
+    def addIterationListener(self, listener):
+        """Add an iteration listener to solvers of all stages. See :ref:`Listeners`."""
+        self.listeners.append(listener)
+
+    def addStageListener(self, listener):
+        """Add a listener called as ``listener(driver, stage, solver)`` before each stage,
+        e.g. to attach stage-specific iteration listeners."""
+        self.stage_listeners.append(listener)
+
+    def solve(self, setup, zeta_initial=None):
+        """Run all stages.
+
+        :param setup: a callable taking a :class:`Stage` and returning a tuple
+                      ``(solver, zeta_prior, u_obs, zeta)`` on the grid of this stage, where
+                      `solver` is an :class:`PISM.invert.ssa.InvSSASolver` and `zeta` is
+                      the storage for the initial guess
+        :param zeta_initial: optional initial guess (on any grid) used by the first stage;
+                             by default the first stage uses the `zeta` returned by `setup`
+        :returns: the :cpp:class:`TerminationReason` of the last stage that was run
+        """
+        config = PISM.Context().config
+
+        zeta_previous = zeta_initial
+        reason = None
+        for k, stage in enumerate(self.stages):
+            with config_overrides(config, stage.config):
+                (solver, zeta_prior, u_obs, zeta) = setup(stage)
+                self.solver = solver
+
+                grid = solver.ssarun.grid
+                logMessage("Multilevel inversion: stage %d of %d, %d x %d grid\n" %
+                           (k + 1, len(self.stages), grid.Mx(), grid.My()))
+
+                if zeta_previous is not None:
+                    prolongate(zeta_previous, zeta)
+
+                for l in self.listeners:
+                    solver.addIterationListener(l)
+
+                for l in self.stage_listeners:
+                    l(self, stage, solver)
+
+                reason = solver.solveInverse(zeta_prior, u_obs, zeta)
+                if reason.failed():
+                    return reason
+
+            (zeta_previous, _) = solver.inverseSolution()
+
+        return reason
@@ -74,14 +74,17 @@ class SSAForwardRunFromInputFile(SSAForwardRun):
     """Subclass of :class:`SSAForwardRun` where the vector data
     for the run is provided in an input :file:`.nc` file."""
 
-    def __init__(self, input_filename, inv_data_filename, design_var):
+    def __init__(self, input_filename, inv_data_filename, design_var, coarsening_factor=1):
         """
         :param input_filename:    :file:`.nc` file containing generic PISM model data.
         :param inv_data_filename: :file:`.nc` file containing data specific to inversion (e.g. observed SSA velocities).
+        :param coarsening_factor: use a grid coarser than the one in `input_filename` by this factor
+                                  (see :mod:`PISM.invert.multilevel`).
         """
         SSAForwardRun.__init__(self, design_var)
         self.input_filename = input_filename
         self.inv_data_filename = inv_data_filename
+        self.coarsening_factor = coarsening_factor
 
     def _initGrid(self):
         """Initialize grid size and periodicity. Called from :meth:`PISM.ssa.SSARun.setup`."""
@@ -94,7 +97,16 @@ class SSAForwardRunFromInputFile(SSAForwardRun):
         ctx = PISM.Context().ctx
 
         pio = PISM.File(ctx.com(), self.input_filename, PISM.PISM_NETCDF3, PISM.PISM_READONLY)
-        self.grid = PISM.IceGrid.FromFile(ctx, pio, "enthalpy", registration)
+        if self.coarsening_factor > 1:
+            from PISM.invert.multilevel import coarsen
+
+            P = PISM.GridParameters(ctx, pio, "enthalpy", registration)
+            P.Mx = coarsen(P.Mx, self.coarsening_factor, registration)
+            P.My = coarsen(P.My, self.coarsening_factor, registration)
+            P.ownership_ranges_from_options(ctx.size())
+            self.grid = PISM.IceGrid(ctx, P)
+        else:
+            self.grid = PISM.IceGrid.FromFile(ctx, pio, "enthalpy", registration)
         pio.close()
 
     def _initPhysics(self):
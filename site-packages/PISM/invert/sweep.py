@@ -0,0 +1,111 @@
+# Copyright (C) 2020 PISM Authors
+#
+# This file is part of PISM.
+#
+# PISM is free software; you can redistribute it and/or modify it under the
+# terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 3 of the License, or (at your option) any later
+# version.
+#
+# PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License
+# along with PISM; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""Concurrent Tikhonov inversions using several penalty weights.
+
+Choosing the Tikhonov penalty weight :math:`\\eta` usually requires running an inversion
+several times. Here ``PETSc.COMM_WORLD`` is split into equal groups of consecutive ranks
+and each group solves the same inversion using its own :math:`\\eta`. Once all groups are
+done, one result is selected using the discrepancy principle: the smallest :math:`\\eta`
+(i.e. the strongest regularization) such that the final misfit does not exceed
+``inverse.target_misfit``. If no group reached the target the one with the smallest misfit
+is selected.
+
+Typical use (before the first call of :class:`PISM.Context`)::
+
+    weights = PISM.invert.sweep.penalty_weights()
+    if len(weights) > 1:
+        sweep = PISM.invert.sweep.PenaltyWeightSweep(weights)
+        misfit = run_inversion(sweep.penalty_weight, sweep.suffix)
+        best = sweep.select(misfit, target_misfit)
+
+Requires ``mpi4py``.
+"""
+
+import PISM
+from PISM.logging import logMessage
+
+
+def penalty_weights():
+    "Returns the list of penalty weights set using ``-inv_tikhonov_sweep``."
+    option = PISM.OptionString("-inv_tikhonov_sweep",
+                               "comma-separated list of Tikhonov penalty weights to try concurrently")
+    if not option.is_set():
+        return []
+
+    return [float(w) for w in option.value().split(",") if len(w.strip()) > 0]
+
+
+class PenaltyWeightSweep(object):
+    """Splits ``PETSc.COMM_WORLD`` and assigns a penalty weight to each group of ranks."""
+
+    def __init__(self, weights):
+        """:param weights: list of penalty weights, one per group of ranks
+
+        Sets the communicator used by :class:`PISM.Context`, so it has to be called before
+        the context is created.
+        """
+        if PISM.Context._instance is not None:
+            raise RuntimeError("the communicator has to be split before PISM.Context is created")
+
+        self.weights = list(weights)
+        self.world = PISM.PETSc.COMM_WORLD.tompi4py()
+
+        size = self.world.Get_size()
+        rank = self.world.Get_rank()
+        n_groups = len(self.weights)
+
+        if n_groups < 1 or size % n_groups != 0:
+            raise RuntimeError("the number of MPI processes (%d) has to be a multiple of"
+                               " the number of penalty weights (%d)" % (size, n_groups))
+
+        self.group_size = size // n_groups
+        self.group = rank // self.group_size
+        self.penalty_weight = self.weights[self.group]
+        # suffix added to output file names of this group
+        self.suffix = "_eta%d" % self.group
+
+        self.comm = self.world.Split(self.group, rank)
+        PISM.Context.com = PISM.PETSc.Comm(self.comm)
+
+    def select(self, misfit, target_misfit=None):
+        """Returns the index of the group whose result should be kept.
+
+        Collective on ``PETSc.COMM_WORLD``.
+
+        :param misfit: final misfit computed by this group
+        :param target_misfit: desired misfit (in the units of `misfit`) or None to pick
+                              the smallest misfit
+        """
+        misfits = self.world.allgather(misfit)[::self.group_size]
+
+        for k, (eta, m) in enumerate(zip(self.weights, misfits)):
+            logMessage("  penalty weight %g (group %d): final misfit %g\n" % (eta, k, m))
+
+        best = None
+        if target_misfit is not None:
+            feasible = [k for k, m in enumerate(misfits) if m <= target_misfit]
+            if len(feasible) > 0:
+                best = min(feasible, key=lambda k: self.weights[k])
+
+        if best is None:
+            best = min(range(len(misfits)), key=lambda k: misfits[k])
+
+        logMessage("  selected penalty weight %g (group %d)\n" % (self.weights[best], best))
+
+        return best
@@ -34,7 +34,8 @@ def prepare_output(filename, append_time=True):
                        filename,
                        PISM.string_to_backend(ctx.config.get_string("output.format")),
                        PISM.PISM_READWRITE_MOVE,
-                       ctx.ctx.pio_iosys_id())
+                       ctx.ctx.pio_iosys_id(),
+                       ctx.ctx.netcdf3_n_aggregators())
     PISM.define_time(output,
                      ctx.config.get_string("time.dimension_name"),
                      ctx.config.get_string("time.calendar"),
@@ -80,15 +80,19 @@ class Access(object):
         pass
 
     def __exit__(self, exc_type, exc_value, traceback):
+        # Vectors accessed here may have been modified: increment state counters so that
+        # derived fields (see DependencyTracker) are re-computed.
         if not self.nocomm is None:
             for v in self.nocomm:
                 v.end_access()
+                v.inc_state_counter()
             self.nocomm = None
 
         if not self.comm is None:
             for v in self.comm:
                 v.end_access()
                 v.update_ghosts()
+                v.inc_state_counter()
             self.comm = None
 
 
@@ -17,12 +17,17 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::upper_bound
+#include <cmath>                // std::floor, std::ceil
+
 #include "AgeModel.hh"
 
 #include "pism/age/AgeColumnSystem.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/io/File.hh"
+#include "pism/util/SinglePrecisionColumns.hh"
+#include "pism/util/pism_utilities.hh"
 
 namespace pism {
 
@@ -59,16 +64,23 @@ AgeModel::AgeModel(IceGrid::ConstPtr grid, stressbalance::StressBalance *stress_
   : Component(grid),
     // FIXME: should be able to use width=1...
     m_ice_age(m_grid, "age", WITH_GHOSTS, m_config->get_number("grid.max_stencil_width")),
-    m_work(m_grid, "work_vector", WITHOUT_GHOSTS),
-    m_stress_balance(stress_balance) {
+    m_stress_balance(stress_balance),
+    m_ghosts_updater(grid) {
+
+  m_semi_lagrangian = m_config->get_string("age.method") == "semi_lagrangian";
 
   m_ice_age.set_attrs("model_state", "age of ice",
                       "s", "years", "" /* no standard name*/, 0);
 
   m_ice_age.metadata().set_number("valid_min", 0.0);
 
-  m_work.set_attrs("internal", "new values of age during time step",
-                   "s", "s", "", 0);
+  if (m_config->get_flag("age.single_precision")) {
+    m_work_single.reset(new SinglePrecisionColumns(m_grid, m_grid->Mz()));
+  } else {
+    m_work.reset(new IceModelVec3(m_grid, "work_vector", WITHOUT_GHOSTS));
+    m_work->set_attrs("internal", "new values of age during time step",
+                      "s", "s", "", 0);
+  }
 }
 
 /*!
@@ -104,6 +116,8 @@ calculation.  Note that the columnSystemCtx methods coarse_to_fine() and
 fine_to_coarse() interpolate back and forth between this fine grid and
 the storage grid.  The storage grid may or may not be equally-spaced.  See
 AgeColumnSystem::solve() for the actual method.
+
+If `age.method` is "semi_lagrangian", see update_semi_lagrangian() instead.
  */
 void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
 
@@ -112,6 +126,15 @@ void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
 
   inputs.check();
 
+  if (m_semi_lagrangian) {
+    update_semi_lagrangian(dt, inputs);
+  } else {
+    update_upwind(dt, inputs);
+  }
+}
+
+void AgeModel::update_upwind(double dt, const AgeModelInputs &inputs) {
+
   const IceModelVec2S &ice_thickness = *inputs.ice_thickness;
 
   const IceModelVec3
@@ -119,64 +142,333 @@ void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
     &v3 = *inputs.v3,
     &w3 = *inputs.w3;
 
-  AgeColumnSystem system(m_grid->z(), "age",
-                         m_grid->dx(), m_grid->dy(), dt,
-                         m_ice_age, u3, v3, w3); // linear system to solve in each column
+  const bool restricted = m_config->get_flag("grid.restrict_3d_halo_exchange");
 
-  size_t Mz_fine = system.z().size();
-  std::vector<double> x(Mz_fine);   // space for solution
+  if (restricted) {
+    // upwinding uses a stencil of width 1 and does not look above the ice surface, but
+    // the ice extent may have changed since the last exchange
+    update_ghosts(ice_thickness);
+  }
 
-  IceModelVec::AccessList list{&ice_thickness, &u3, &v3, &w3, &m_ice_age, &m_work};
+  IceModelVec::AccessList list{&ice_thickness, &u3, &v3, &w3, &m_ice_age};
+  if (m_work) {
+    list.add(*m_work);
+  }
 
   unsigned int Mz = m_grid->Mz();
 
+  // the cost of a column depends on the ice thickness, so columns are handed out to
+  // threads in chunks
+  ColumnQueue columns(*m_grid);
+
   ParallelSection loop(m_grid->com);
-  try {
+#pragma omp parallel
+  {
+    // linear system to solve in each column (private to each thread)
+    AgeColumnSystem system(m_grid->z(), "age",
+                           m_grid->dx(), m_grid->dy(), dt,
+                           m_ice_age, u3, v3, w3);
+
+    size_t Mz_fine = system.z().size();
+    std::vector<double> x(Mz_fine);   // space for solution
+
+    // storage for new values in a column (used if m_work is not allocated)
+    std::vector<double> buffer(Mz);
+
+    try {
+      for (QueuePoints p(columns); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        system.init(i, j, ice_thickness(i, j));
+
+        double *column = m_work ? m_work->get_column(i, j) : buffer.data();
+
+        if (system.ks() == 0) {
+          // if no ice, set the entire column to zero age
+          for (unsigned int k = 0; k < Mz; ++k) {
+            column[k] = 0.0;
+          }
+        } else {
+          // general case: solve advection PDE
+
+          // solve the system for this column; call checks that params set
+          system.solve(x);
+
+          // put solution in the storage grid column
+          system.fine_to_coarse(x, column);
+
+          // Ensure that the age of the ice is non-negative.
+          //
+          // FIXME: this is a kludge. We need to ensure that our numerical method has the maximum
+          // principle instead. (We may still need this for correctness, though.)
+          for (unsigned int k = 0; k < Mz; ++k) {
+            if (column[k] < 0.0) {
+              column[k] = 0.0;
+            }
+          }
+        }
+
+        if (m_work_single) {
+          m_work_single->set_column(i, j, column);
+        }
+      }
+    } catch (...) {
+      loop.failed();
+    }
+  }
+  loop.check();
+
+  if (restricted) {
+    // ghosts are updated right before they are used (see update_ghosts())
+    if (m_work) {
+      IceModelVec::AccessList list2{m_work.get(), &m_ice_age};
+
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        m_ice_age.set_column(i, j, m_work->get_column(i, j));
+      }
+      m_ice_age.inc_state_counter();
+    } else {
+      m_work_single->copy_to(m_ice_age);
+    }
+  } else {
+    store_new_age();
+  }
+}
+
+/*!
+ * Update ghosts of age in the ice, using the current ice thickness.
+ *
+ * Does nothing unless `grid.restrict_3d_halo_exchange` is set and the upwinding scheme
+ * is used (see EnergyModel::update_ghosts()).
+ */
+void AgeModel::update_ghosts(const IceModelVec2S &ice_thickness) {
+  if (m_config->get_flag("grid.restrict_3d_halo_exchange") and not m_semi_lagrangian) {
+    m_ghosts_updater.update(ice_thickness, m_ice_age);
+  }
+}
+
+//! Copy new values of age from the work space to `m_ice_age` and update ghosts.
+void AgeModel::store_new_age() {
+  if (m_work) {
+    m_work->update_ghosts(m_ice_age);
+  } else {
+    m_work_single->copy_to(m_ice_age);
+    m_ice_age.update_ghosts();
+  }
+}
+
+//! Semi-Lagrangian age transport.
+/*!
+ * The age of the ice at a point is the age at the departure point of the characteristic
+ * arriving at it, plus the time step length. Departure points are traced back using the
+ * velocity at the arrival point; age is interpolated at departure points (bilinear in the
+ * horizontal, linear in the vertical). Characteristics that entered the ice through the
+ * surface (accumulation) or the base (freeze-on) during the step get the time elapsed
+ * since crossing the boundary.
+ *
+ * The scheme is stable for any time step length, but departure points have to be in the
+ * part of the grid available to this sub-domain (including ghosts). The step is split
+ * into sub-steps so that horizontal displacements do not exceed the ghost width of age.
+ * These sub-steps do not limit the time step taken by the rest of the model.
+ */
+void AgeModel::update_semi_lagrangian(double dt, const AgeModelInputs &inputs) {
+
+  const IceModelVec2S &ice_thickness = *inputs.ice_thickness;
+
+  const IceModelVec3
+    &u3 = *inputs.u3,
+    &v3 = *inputs.v3;
+
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy();
+
+  // maximum horizontal speed, in grid cells per second
+  double max_rate = 0.0;
+  {
+    IceModelVec::AccessList list{&ice_thickness, &u3, &v3};
+
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      system.init(i, j, ice_thickness(i, j));
+      const unsigned int ks = m_grid->kBelowHeight(ice_thickness(i, j));
+      const double
+        *u = u3.get_column(i, j),
+        *v = v3.get_column(i, j);
+
+      for (unsigned int k = 0; k <= ks; ++k) {
+        max_rate = std::max(max_rate, std::max(fabs(u[k]) / dx, fabs(v[k]) / dy));
+      }
+    }
+    max_rate = GlobalMax(m_grid->com, max_rate);
+  }
+
+  const int width = std::min(m_ice_age.stencil_width(), ice_thickness.stencil_width());
+
+  const int N = std::max(1, (int)std::ceil(dt * max_rate / width));
+
+  for (int n = 0; n < N; ++n) {
+    semi_lagrangian_step(dt / N, inputs);
+  }
+}
+
+//! Take one semi-Lagrangian step. Horizontal displacements have to be at most the ghost
+//! width of age and ice thickness.
+void AgeModel::semi_lagrangian_step(double dt, const AgeModelInputs &inputs) {
+
+  const IceModelVec2S &H = *inputs.ice_thickness;
+
+  const IceModelVec3
+    &u3 = *inputs.u3,
+    &v3 = *inputs.v3,
+    &w3 = *inputs.w3;
+
+  IceModelVec::AccessList list{&H, &u3, &v3, &w3, &m_ice_age};
+  if (m_work) {
+    list.add(*m_work);
+  }
+
+  const std::vector<double> &z = m_grid->z();
+  const unsigned int Mz = m_grid->Mz();
 
-      if (system.ks() == 0) {
-        // if no ice, set the entire column to zero age
-        m_work.set_column(i, j, 0.0);
-      } else {
-        // general case: solve advection PDE
+  const int
+    Mx    = m_grid->Mx(),
+    My    = m_grid->My(),
+    width = std::min(m_ice_age.stencil_width(), H.stencil_width());
 
-        // solve the system for this column; call checks that params set
-        system.solve(x);
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy();
 
-        // put solution in IceModelVec3
-        system.fine_to_coarse(x, i, j, m_work);
+  const bool
+    x_periodic = m_grid->periodicity() & X_PERIODIC,
+    y_periodic = m_grid->periodicity() & Y_PERIODIC;
+
+  ColumnQueue columns(*m_grid);
+
+  ParallelSection loop(m_grid->com);
+#pragma omp parallel
+  {
+    // storage for new values in a column (used if m_work is not allocated)
+    std::vector<double> buffer(Mz);
+
+    try {
+      for (QueuePoints p(columns); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        double *column = m_work ? m_work->get_column(i, j) : buffer.data();
+
+        const double
+          *u = u3.get_column(i, j),
+          *v = v3.get_column(i, j),
+          *w = w3.get_column(i, j);
 
-        // Ensure that the age of the ice is non-negative.
-        //
-        // FIXME: this is a kludge. We need to ensure that our numerical method has the maximum
-        // principle instead. (We may still need this for correctness, though.)
-        double *column = m_work.get_column(i, j);
         for (unsigned int k = 0; k < Mz; ++k) {
-          if (column[k] < 0.0) {
+          if (z[k] > H(i, j) or H(i, j) <= 0.0) {
             column[k] = 0.0;
+            continue;
+          }
+
+          // departure point in "grid index" coordinates
+          double
+            x_d = i - u[k] * dt / dx,
+            y_d = j - v[k] * dt / dy,
+            z_d = z[k] - w[k] * dt;
+
+          x_d = clip(x_d, i - width, i + width);
+          y_d = clip(y_d, j - width, j + width);
+          if (not x_periodic) {
+            x_d = clip(x_d, 0, Mx - 1);
           }
+          if (not y_periodic) {
+            y_d = clip(y_d, 0, My - 1);
+          }
+
+          // the cell containing the departure point; (i0 + 1, j0 + 1) may be a ghost
+          const int
+            i0 = std::min((int)std::floor(x_d), i + width - 1),
+            j0 = std::min((int)std::floor(y_d), j + width - 1);
+          const double
+            a = x_d - i0,
+            b = y_d - j0;
+
+          if (z_d < 0.0) {
+            // entered through the base (freeze-on)
+            column[k] = dt * z[k] / (z[k] - z_d);
+            continue;
+          }
+
+          const double H_d = ((1.0 - a) * (1.0 - b) * H(i0, j0) +
+                              a * (1.0 - b) * H(i0 + 1, j0) +
+                              (1.0 - a) * b * H(i0, j0 + 1) +
+                              a * b * H(i0 + 1, j0 + 1));
+
+          if (z_d > H_d) {
+            // entered through the surface: estimate the time since crossing assuming
+            // that the height above the surface changes linearly along the path
+            const double
+              f0 = H(i, j) - z[k],
+              f1 = z_d - H_d;
+            column[k] = dt * f0 / (f0 + f1);
+            continue;
+          }
+
+          // the vertical interval containing the departure point
+          int k0 = (std::upper_bound(z.begin(), z.end(), z_d) - z.begin()) - 1;
+          k0 = std::max(0, std::min(k0, (int)Mz - 2));
+          const double c = (z_d - z[k0]) / (z[k0 + 1] - z[k0]);
+
+          const double
+            *A00 = m_ice_age.get_column(i0, j0),
+            *A10 = m_ice_age.get_column(i0 + 1, j0),
+            *A01 = m_ice_age.get_column(i0, j0 + 1),
+            *A11 = m_ice_age.get_column(i0 + 1, j0 + 1);
+
+          const double
+            age00 = A00[k0] + c * (A00[k0 + 1] - A00[k0]),
+            age10 = A10[k0] + c * (A10[k0 + 1] - A10[k0]),
+            age01 = A01[k0] + c * (A01[k0 + 1] - A01[k0]),
+            age11 = A11[k0] + c * (A11[k0 + 1] - A11[k0]);
+
+          column[k] = ((1.0 - a) * (1.0 - b) * age00 +
+                       a * (1.0 - b) * age10 +
+                       (1.0 - a) * b * age01 +
+                       a * b * age11) + dt;
+        }
+
+        if (m_work_single) {
+          m_work_single->set_column(i, j, column);
         }
       }
+    } catch (...) {
+      loop.failed();
     }
-  } catch (...) {
-    loop.failed();
   }
   loop.check();
 
-  m_work.update_ghosts(m_ice_age);
+  store_new_age();
 }
 
 const IceModelVec3 & AgeModel::age() const {
   return m_ice_age;
 }
 
+//! Returns true if this model uses the semi-Lagrangian scheme (the time step is not
+//! limited by the CFL condition).
+bool AgeModel::semi_lagrangian() const {
+  return m_semi_lagrangian;
+}
+
 MaxTimestep AgeModel::max_timestep_impl(double t) const {
   // fix a compiler warning
   (void) t;
 
+  if (m_semi_lagrangian) {
+    return MaxTimestep("age model");
+  }
+
   if (m_stress_balance == NULL) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                   "AgeModel: no stress balance provided."
@@ -20,12 +20,16 @@
 #ifndef AGEMODEL_H
 #define AGEMODEL_H
 
+#include <memory>
+
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/Component.hh"
 #include "pism/stressbalance/StressBalance.hh"
 
 namespace pism {
 
+class SinglePrecisionColumns;
+
 class AgeModelInputs {
 public:
   AgeModelInputs();
@@ -47,17 +51,33 @@ public:
 
   void update(double t, double dt, const AgeModelInputs &inputs);
 
+  void update_ghosts(const IceModelVec2S &ice_thickness);
+
   void init(const InputOptions &opts);
 
   const IceModelVec3 & age() const;
+
+  bool semi_lagrangian() const;
 protected:
   MaxTimestep max_timestep_impl(double t) const;
   void define_model_state_impl(const File &output) const;
   void write_model_state_impl(const File &output) const;
 
+  void update_upwind(double dt, const AgeModelInputs &inputs);
+  void update_semi_lagrangian(double dt, const AgeModelInputs &inputs);
+  void semi_lagrangian_step(double dt, const AgeModelInputs &inputs);
+  void store_new_age();
+
   IceModelVec3 m_ice_age;
-  IceModelVec3 m_work;
+  // new values of age during a time step; only one of these is allocated (see
+  // age.single_precision)
+  std::shared_ptr<IceModelVec3> m_work;
+  std::shared_ptr<SinglePrecisionColumns> m_work_single;
   stressbalance::StressBalance *m_stress_balance;
+  //! true if age.method is "semi_lagrangian"
+  bool m_semi_lagrangian;
+  //! updates ghosts of m_ice_age if grid.restrict_3d_halo_exchange is set
+  IceGhostsUpdater m_ghosts_updater;
 };
 
 } // end of namespace pism
@@ -138,8 +138,7 @@ MohrCoulombYieldStress::~MohrCoulombYieldStress() {
 }
 
 void MohrCoulombYieldStress::restart_impl(const File &input_file, int record) {
-  m_basal_yield_stress.read(input_file, record);
-  m_till_phi.read(input_file, record);
+  read_fields(input_file, record, {&m_basal_yield_stress, &m_till_phi});
 }
 
 
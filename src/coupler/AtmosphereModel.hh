@@ -28,6 +28,7 @@ namespace pism {
 
 class Geometry;
 class IceModelVec2S;
+class AffineMap;
 
 //! @brief Atmosphere models and modifiers: provide precipitation and
 //! temperature to a surface::SurfaceModel below
@@ -63,6 +64,20 @@ public:
   //! grid. Times (in years) are specified in ts. NB! Has to be surrounded by
   //! begin_pointwise_access() and end_pointwise_access()
   void temp_time_series(int i, int j, std::vector<double> &result) const;
+
+  //! \brief Sets `result` to time-series of precipitation at `n_points` consecutive
+  //! points in the grid row `j`, starting at `i0`.
+  //!
+  //! See temp_time_series_batch() for more.
+  void precip_time_series_batch(int i0, int j, int n_points, double *result) const;
+
+  //! \brief Sets `result` to time-series of near-surface air temperature at `n_points`
+  //! consecutive points in the grid row `j`, starting at `i0`.
+  //!
+  //! The value at time `k` and the point `(i0 + p, j)` is stored in `result[k * n_points +
+  //! p]`, so `result` has to have room for `n_points * ts.size()` values. Has to be
+  //! surrounded by begin_pointwise_access() and end_pointwise_access().
+  void temp_time_series_batch(int i0, int j, int n_points, double *result) const;
 protected:
   virtual void init_impl(const Geometry &geometry) = 0;
   virtual void update_impl(const Geometry &geometry, double t, double dt) = 0;
@@ -79,12 +94,24 @@ protected:
   virtual void init_timeseries_impl(const std::vector<double> &ts) const;
   virtual void precip_time_series_impl(int i, int j, std::vector<double> &result) const;
   virtual void temp_time_series_impl(int i, int j, std::vector<double> &result) const;
+  virtual void precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+  virtual void temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
 
   virtual DiagnosticList diagnostics_impl() const;
   virtual TSDiagnosticList ts_diagnostics_impl() const;
+
+  virtual bool temperature_map_impl(AffineMap &result) const;
+  virtual bool precipitation_map_impl(AffineMap &result) const;
+
+  void fused_temperature(IceModelVec2S &result) const;
+  void fused_precipitation(IceModelVec2S &result) const;
 protected:
   mutable std::vector<double> m_ts_times;
 
+  //! storage for one time series used by the default implementation of
+  //! precip_time_series_batch_impl() and temp_time_series_batch_impl()
+  mutable std::vector<double> m_point_values;
+
   std::shared_ptr<AtmosphereModel> m_input_model;
 
   static IceModelVec2S::Ptr allocate_temperature(IceGrid::ConstPtr grid);
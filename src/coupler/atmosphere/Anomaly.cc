@@ -21,6 +21,7 @@
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/io/io_helpers.hh"
+#include "pism/util/IceModelVecExpressions.hh"
 #include "pism/coupler/util/options.hh"
 
 namespace pism {
@@ -98,17 +99,9 @@ void Anomaly::update_impl(const Geometry &geometry, double t, double dt) {
   m_precipitation_anomaly->average(t, dt);
   m_air_temp_anomaly->average(t, dt);
 
-  // precipitation
-  {
-    m_precipitation->copy_from(m_input_model->mean_precipitation());
-    m_precipitation->add(1.0, *m_precipitation_anomaly);
-  }
+  assign(*m_precipitation, m_input_model->mean_precipitation() + *m_precipitation_anomaly);
 
-  // temperature
-  {
-    m_temperature->copy_from(m_input_model->mean_annual_temp());
-    m_temperature->add(1.0, *m_air_temp_anomaly);
-  }
+  assign(*m_temperature, m_input_model->mean_annual_temp() + *m_air_temp_anomaly);
 }
 
 const IceModelVec2S& Anomaly::mean_precipitation_impl() const {
@@ -161,5 +154,31 @@ void Anomaly::precip_time_series_impl(int i, int j, std::vector<double> &result)
   }
 }
 
+void Anomaly::temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+  m_input_model->temp_time_series_batch(i0, j, n_points, result);
+
+  const size_t size = m_ts_times.size() * n_points;
+
+  m_temp_anomaly.resize(size);
+  m_air_temp_anomaly->interp(i0, j, n_points, m_temp_anomaly.data());
+
+  for (size_t k = 0; k < size; ++k) {
+    result[k] += m_temp_anomaly[k];
+  }
+}
+
+void Anomaly::precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+  m_input_model->precip_time_series_batch(i0, j, n_points, result);
+
+  const size_t size = m_ts_times.size() * n_points;
+
+  m_mass_flux_anomaly.resize(size);
+  m_precipitation_anomaly->interp(i0, j, n_points, m_mass_flux_anomaly.data());
+
+  for (size_t k = 0; k < size; ++k) {
+    result[k] += m_mass_flux_anomaly[k];
+  }
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -44,6 +44,8 @@ protected:
   void end_pointwise_access_impl() const;
   void temp_time_series_impl(int i, int j, std::vector<double> &values) const;
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+  void precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
 protected:
   mutable std::vector<double> m_mass_flux_anomaly, m_temp_anomaly;
 
@@ -23,6 +23,7 @@
 #include "pism/util/Time.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/MaxTimestep.hh"
+#include "pism/coupler/util/AffineMap.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -98,6 +99,72 @@ void AtmosphereModel::temp_time_series(int i, int j, std::vector<double> &result
   this->temp_time_series_impl(i, j, result);
 }
 
+void AtmosphereModel::precip_time_series_batch(int i0, int j, int n_points,
+                                               double *result) const {
+  this->precip_time_series_batch_impl(i0, j, n_points, result);
+}
+
+void AtmosphereModel::temp_time_series_batch(int i0, int j, int n_points,
+                                             double *result) const {
+  this->temp_time_series_batch_impl(i0, j, n_points, result);
+}
+
+//! Set `result` to the map applied to the temperature field by this modifier.
+/*!
+ * Returns `false` if this model computes the temperature field in some other way (this
+ * is the default).
+ */
+bool AtmosphereModel::temperature_map_impl(AffineMap &result) const {
+  (void) result;
+  return false;
+}
+
+//! Set `result` to the map applied to the precipitation field by this modifier.
+/*!
+ * Returns `false` if this model computes the precipitation field in some other way (this
+ * is the default).
+ */
+bool AtmosphereModel::precipitation_map_impl(AffineMap &result) const {
+  (void) result;
+  return false;
+}
+
+//! Compute the temperature field produced by this model and the chain of modifiers below
+//! it in one pass.
+/*!
+ * Walks down the modifier chain while modifiers describe their effect using an affine
+ * map, combines these maps and applies the result to the temperature field of the first
+ * model that does not.
+ */
+void AtmosphereModel::fused_temperature(IceModelVec2S &result) const {
+  AffineMap map, step;
+  const AtmosphereModel *model = this;
+
+  while (model->temperature_map_impl(step)) {
+    map = map.after(step);
+    model = model->m_input_model.get();
+  }
+
+  map.apply(model->mean_annual_temp(), result);
+}
+
+//! Compute the precipitation field produced by this model and the chain of modifiers
+//! below it in one pass.
+/*!
+ * @see fused_temperature()
+ */
+void AtmosphereModel::fused_precipitation(IceModelVec2S &result) const {
+  AffineMap map, step;
+  const AtmosphereModel *model = this;
+
+  while (model->precipitation_map_impl(step)) {
+    map = map.after(step);
+    model = model->m_input_model.get();
+  }
+
+  map.apply(model->mean_precipitation(), result);
+}
+
 namespace diagnostics {
 
 /*! @brief Instantaneous near-surface air temperature. */
@@ -296,6 +363,42 @@ void AtmosphereModel::precip_time_series_impl(int i, int j, std::vector<double>
   }
 }
 
+//! Default implementation: get time series one point at a time.
+/*!
+ * Models that compute time series of precipitation should override this to avoid the
+ * per-point overhead.
+ */
+void AtmosphereModel::precip_time_series_batch_impl(int i0, int j, int n_points,
+                                                    double *result) const {
+  const size_t N = m_ts_times.size();
+
+  for (int p = 0; p < n_points; ++p) {
+    this->precip_time_series(i0 + p, j, m_point_values);
+
+    for (size_t k = 0; k < N; ++k) {
+      result[k * n_points + p] = m_point_values[k];
+    }
+  }
+}
+
+//! Default implementation: get time series one point at a time.
+/*!
+ * Models that compute time series of temperature should override this to avoid the
+ * per-point overhead.
+ */
+void AtmosphereModel::temp_time_series_batch_impl(int i0, int j, int n_points,
+                                                  double *result) const {
+  const size_t N = m_ts_times.size();
+
+  for (int p = 0; p < n_points; ++p) {
+    this->temp_time_series(i0 + p, j, m_point_values);
+
+    for (size_t k = 0; k < N; ++k) {
+      result[k * n_points + p] = m_point_values[k];
+    }
+  }
+}
+
 void AtmosphereModel::init_timeseries_impl(const std::vector<double> &ts) const {
   if (m_input_model) {
     m_input_model->init_timeseries(ts);
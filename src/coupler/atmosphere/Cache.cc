@@ -0,0 +1,161 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#include <cmath>                // floor
+
+#include "Cache.hh"
+
+namespace pism {
+namespace atmosphere {
+
+Cache::Cache(IceGrid::ConstPtr g, std::shared_ptr<AtmosphereModel> in)
+  : CachingModifier<AtmosphereModel>(g, in, "atmosphere"),
+    m_cycle_start(0.0) {
+
+  m_precipitation = allocate_precipitation(g);
+  m_temperature   = allocate_temperature(g);
+
+  for (int k = 0; k < N_SAMPLES; ++k) {
+    m_precipitation_cycle.push_back(allocate_precipitation(g));
+    m_temperature_cycle.push_back(allocate_temperature(g));
+  }
+}
+
+Cache::~Cache() {
+  // empty
+}
+
+void Cache::copy_outputs() {
+  m_precipitation->copy_from(m_input_model->mean_precipitation());
+  m_temperature->copy_from(m_input_model->mean_annual_temp());
+
+  // sample the yearly cycle
+  auto time = m_grid->ctx()->time();
+
+  const double
+    t    = m_update_time,
+    year = time->increment_date(t, 1) - t;
+
+  std::vector<double> ts(N_SAMPLES);
+  for (int k = 0; k < N_SAMPLES; ++k) {
+    ts[k] = t + (k + 0.5) * year / N_SAMPLES;
+  }
+  m_cycle_start = time->year_fraction(t);
+
+  m_input_model->init_timeseries(ts);
+  m_input_model->begin_pointwise_access();
+
+  IceModelVec::AccessList list;
+  for (int k = 0; k < N_SAMPLES; ++k) {
+    list.add(*m_precipitation_cycle[k]);
+    list.add(*m_temperature_cycle[k]);
+  }
+
+  std::vector<double> P(N_SAMPLES), T(N_SAMPLES);
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_input_model->precip_time_series(i, j, P);
+      m_input_model->temp_time_series(i, j, T);
+
+      for (int k = 0; k < N_SAMPLES; ++k) {
+        (*m_precipitation_cycle[k])(i, j) = P[k];
+        (*m_temperature_cycle[k])(i, j)   = T[k];
+      }
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+
+  m_input_model->end_pointwise_access();
+}
+
+const IceModelVec2S& Cache::mean_precipitation_impl() const {
+  return *m_precipitation;
+}
+
+const IceModelVec2S& Cache::mean_annual_temp_impl() const {
+  return *m_temperature;
+}
+
+void Cache::begin_pointwise_access_impl() const {
+  for (int k = 0; k < N_SAMPLES; ++k) {
+    m_precipitation_cycle[k]->begin_access();
+    m_temperature_cycle[k]->begin_access();
+  }
+}
+
+void Cache::end_pointwise_access_impl() const {
+  for (int k = 0; k < N_SAMPLES; ++k) {
+    m_precipitation_cycle[k]->end_access();
+    m_temperature_cycle[k]->end_access();
+  }
+}
+
+void Cache::init_timeseries_impl(const std::vector<double> &ts) const {
+  auto time = m_grid->ctx()->time();
+
+  const size_t N = ts.size();
+  m_ts_index.resize(N);
+  m_ts_weight.resize(N);
+
+  for (size_t k = 0; k < N; ++k) {
+    // position of ts[k] relative to samples (sample n is at n + 0.5)
+    double x = time->year_fraction(ts[k]) - m_cycle_start;
+    x = (x - floor(x)) * N_SAMPLES - 0.5;
+    if (x < 0.0) {
+      x += N_SAMPLES;
+    }
+
+    const int n = static_cast<int>(floor(x));
+
+    m_ts_index[k]  = n % N_SAMPLES;
+    m_ts_weight[k] = x - n;
+  }
+
+  m_ts_times = ts;
+}
+
+//! Interpolate the yearly cycle stored in `samples` at the point (i, j).
+void Cache::interpolate(const std::vector<IceModelVec2S::Ptr> &samples, int i, int j,
+                        std::vector<double> &result) const {
+  for (size_t k = 0; k < m_ts_index.size(); ++k) {
+    const int
+      n0 = m_ts_index[k],
+      n1 = (n0 + 1) % N_SAMPLES;
+    const double w = m_ts_weight[k];
+
+    result[k] = (1.0 - w) * (*samples[n0])(i, j) + w * (*samples[n1])(i, j);
+  }
+}
+
+void Cache::precip_time_series_impl(int i, int j, std::vector<double> &result) const {
+  interpolate(m_precipitation_cycle, i, j, result);
+}
+
+void Cache::temp_time_series_impl(int i, int j, std::vector<double> &result) const {
+  interpolate(m_temperature_cycle, i, j, result);
+}
+
+} // end of namespace atmosphere
+} // end of namespace pism
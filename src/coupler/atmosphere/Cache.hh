@@ -0,0 +1,77 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#ifndef _PACACHE_H_
+#define _PACACHE_H_
+
+#include "pism/coupler/AtmosphereModel.hh"
+#include "pism/coupler/util/CachingModifier.hh"
+
+namespace pism {
+namespace atmosphere {
+
+//! Updates the atmosphere model below it every `atmosphere.cache.update_interval` years
+//! (see CachingModifier).
+/*!
+ * In addition to mean annual fields this modifier stores the yearly cycle of the model
+ * below it, sampled at `N_SAMPLES` equally-spaced times during the year following an
+ * update. Time series requested by a surface model are interpolated (linearly and
+ * periodically) from these samples using the fraction of the year corresponding to each
+ * time.
+ */
+class Cache : public CachingModifier<AtmosphereModel> {
+public:
+  Cache(IceGrid::ConstPtr g, std::shared_ptr<AtmosphereModel> in);
+  virtual ~Cache();
+
+protected:
+  void copy_outputs();
+
+  const IceModelVec2S& mean_precipitation_impl() const;
+  const IceModelVec2S& mean_annual_temp_impl() const;
+
+  void begin_pointwise_access_impl() const;
+  void end_pointwise_access_impl() const;
+
+  void init_timeseries_impl(const std::vector<double> &ts) const;
+  void precip_time_series_impl(int i, int j, std::vector<double> &result) const;
+  void temp_time_series_impl(int i, int j, std::vector<double> &result) const;
+private:
+  static const int N_SAMPLES = 12;
+
+  IceModelVec2S::Ptr m_precipitation;
+  IceModelVec2S::Ptr m_temperature;
+
+  //! samples of the yearly cycle
+  std::vector<IceModelVec2S::Ptr> m_precipitation_cycle, m_temperature_cycle;
+  //! year fraction of the time of the last update
+  double m_cycle_start;
+
+  //! interpolation indexes and weights corresponding to times in m_ts_times
+  mutable std::vector<int> m_ts_index;
+  mutable std::vector<double> m_ts_weight;
+
+  void interpolate(const std::vector<IceModelVec2S::Ptr> &samples, int i, int j,
+                   std::vector<double> &result) const;
+};
+
+} // end of namespace atmosphere
+} // end of namespace pism
+
+#endif /* _PACACHE_H_ */
@@ -20,6 +20,7 @@
 
 #include "pism/util/ConfigInterface.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/AffineMap.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -37,6 +38,9 @@ Delta_T::Delta_T(IceGrid::ConstPtr grid, std::shared_ptr<AtmosphereModel> in)
                                     "near-surface air temperature offsets"));
 
   m_temperature = allocate_temperature(grid);
+
+  m_fuse = m_config->get_flag("atmosphere.fuse_modifiers");
+  m_temperature_is_stale = false;
 }
 
 void Delta_T::init_impl(const Geometry &geometry) {
@@ -50,24 +54,41 @@ void Delta_T::init_impl(const Geometry &geometry) {
 void Delta_T::init_timeseries_impl(const std::vector<double> &ts) const {
   AtmosphereModel::init_timeseries_impl(ts);
 
-  m_offset_values.resize(ts.size());
-  for (unsigned int k = 0; k < ts.size(); ++k) {
-    m_offset_values[k] = m_forcing->value(ts[k]);
-  }
+  m_forcing->value(ts, m_offset_values);
 }
 
 void Delta_T::update_impl(const Geometry& geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
   m_forcing->update(t, dt);
 
-  m_temperature->copy_from(m_input_model->mean_annual_temp());
-  m_temperature->shift(m_forcing->value());
+  if (m_fuse) {
+    // the temperature field is computed when needed (see mean_annual_temp_impl())
+    m_temperature_is_stale = true;
+  } else {
+    m_temperature->copy_from(m_input_model->mean_annual_temp());
+    m_temperature->shift(m_forcing->value());
+  }
 }
 
 const IceModelVec2S& Delta_T::mean_annual_temp_impl() const {
+  if (m_temperature_is_stale) {
+    fused_temperature(*m_temperature);
+    m_temperature_is_stale = false;
+  }
   return *m_temperature;
 }
 
+bool Delta_T::temperature_map_impl(AffineMap &result) const {
+  result = AffineMap(1.0, m_forcing->value());
+  return m_fuse;
+}
+
+bool Delta_T::precipitation_map_impl(AffineMap &result) const {
+  // precipitation is not modified
+  result = AffineMap();
+  return m_fuse;
+}
+
 void Delta_T::temp_time_series_impl(int i, int j, std::vector<double> &result) const {
   m_input_model->temp_time_series(i, j, result);
 
@@ -76,5 +97,19 @@ void Delta_T::temp_time_series_impl(int i, int j, std::vector<double> &result) c
   }
 }
 
+void Delta_T::temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+  m_input_model->temp_time_series_batch(i0, j, n_points, result);
+
+  for (unsigned int k = 0; k < m_ts_times.size(); ++k) {
+    for (int p = 0; p < n_points; ++p) {
+      result[k * n_points + p] += m_offset_values[k];
+    }
+  }
+}
+
+void Delta_T::precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+  m_input_model->precip_time_series_batch(i0, j, n_points, result);
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -41,9 +41,19 @@ protected:
 
   void init_timeseries_impl(const std::vector<double> &ts) const;
   void temp_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+  void precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+
+  bool temperature_map_impl(AffineMap &result) const;
+  bool precipitation_map_impl(AffineMap &result) const;
 private:
   IceModelVec2S::Ptr m_temperature;
 
+  //! true if consecutive scalar modifiers are applied in one pass
+  bool m_fuse;
+  //! true if `m_temperature` has to be re-computed (used if `m_fuse` is set)
+  mutable bool m_temperature_is_stale;
+
   std::unique_ptr<ScalarForcing> m_forcing;
 
   mutable std::vector<double> m_offset_values;
@@ -221,5 +221,56 @@ void ElevationChange::precip_time_series_impl(int i, int j, std::vector<double>
   }
 }
 
+void ElevationChange::temp_time_series_batch_impl(int i0, int j, int n_points,
+                                                  double *result) const {
+  const size_t N = m_ts_times.size();
+
+  m_input_model->temp_time_series_batch(i0, j, n_points, result);
+
+  m_reference_surface_values.resize(N * n_points);
+  double *usurf = m_reference_surface_values.data();
+  m_reference_surface->interp(i0, j, n_points, usurf);
+
+  for (size_t m = 0; m < N; ++m) {
+    for (int p = 0; p < n_points; ++p) {
+      const size_t k = m * n_points + p;
+      result[k] -= m_temp_lapse_rate * (m_surface(i0 + p, j) - usurf[k]);
+    }
+  }
+}
+
+void ElevationChange::precip_time_series_batch_impl(int i0, int j, int n_points,
+                                                    double *result) const {
+  const size_t N = m_ts_times.size();
+
+  m_input_model->precip_time_series_batch(i0, j, n_points, result);
+
+  m_reference_surface_values.resize(N * n_points);
+  double *usurf = m_reference_surface_values.data();
+  m_reference_surface->interp(i0, j, n_points, usurf);
+
+  switch (m_precip_method) {
+  case SCALE:
+    {
+      for (size_t m = 0; m < N; ++m) {
+        for (int p = 0; p < n_points; ++p) {
+          const size_t k = m * n_points + p;
+          double dT = -m_temp_lapse_rate * (m_surface(i0 + p, j) - usurf[k]);
+          result[k] *= std::exp(m_precip_exp_factor * dT);
+        }
+      }
+    }
+    break;
+  case SHIFT:
+    for (size_t m = 0; m < N; ++m) {
+      for (int p = 0; p < n_points; ++p) {
+        const size_t k = m * n_points + p;
+        result[k] -= m_precip_lapse_rate * (m_surface(i0 + p, j) - usurf[k]);
+      }
+    }
+    break;
+  }
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -45,6 +45,8 @@ protected:
   void init_timeseries_impl(const std::vector<double> &ts) const;
   void precip_time_series_impl(int i, int j, std::vector<double> &result) const;
   void temp_time_series_impl(int i, int j, std::vector<double> &result) const;
+  void temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+  void precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
 
 protected:
   enum Method {SCALE, SHIFT};
@@ -59,6 +61,9 @@ protected:
   IceModelVec2S::Ptr m_precipitation;
   IceModelVec2S::Ptr m_temperature;
   IceModelVec2S m_surface;
+
+  //! reference surface elevation time series used by *_time_series_batch_impl()
+  mutable std::vector<double> m_reference_surface_values;
 };
 
 } // end of namespace atmosphere
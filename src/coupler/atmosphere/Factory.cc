@@ -34,6 +34,7 @@
 #include "Uniform.hh"
 #include "OrographicPrecipitation.hh"
 #include "IndexForcing.hh"
+#include "Cache.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -58,6 +59,7 @@ Factory::Factory(IceGrid::ConstPtr g)
   add_modifier<Delta_T>("delta_T");
   add_modifier<ElevationChange>("elevation_change");
   add_modifier<OrographicPrecipitation>("orographic_precipitation");
+  add_modifier<Cache>("cache");
 }
 
 Factory::~Factory() {
@@ -20,6 +20,7 @@
 
 #include "pism/util/ConfigInterface.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/AffineMap.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -34,6 +35,9 @@ Frac_P::Frac_P(IceGrid::ConstPtr grid, std::shared_ptr<AtmosphereModel> in)
                                     "precipitation multiplier, pure fraction"));
 
   m_precipitation = allocate_precipitation(grid);
+
+  m_fuse = m_config->get_flag("atmosphere.fuse_modifiers");
+  m_precipitation_is_stale = false;
 }
 
 Frac_P::~Frac_P() {
@@ -51,24 +55,41 @@ void Frac_P::init_impl(const Geometry &geometry) {
 void Frac_P::init_timeseries_impl(const std::vector<double> &ts) const {
   AtmosphereModel::init_timeseries_impl(ts);
 
-  m_offset_values.resize(ts.size());
-  for (unsigned int k = 0; k < ts.size(); ++k) {
-    m_offset_values[k] = m_forcing->value(ts[k]);
-  }
+  m_forcing->value(ts, m_offset_values);
 }
 
 void Frac_P::update_impl(const Geometry &geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
   m_forcing->update(t, dt);
 
-  m_precipitation->copy_from(m_input_model->mean_precipitation());
-  m_precipitation->scale(m_forcing->value());
+  if (m_fuse) {
+    // the precipitation field is computed when needed (see mean_precipitation_impl())
+    m_precipitation_is_stale = true;
+  } else {
+    m_precipitation->copy_from(m_input_model->mean_precipitation());
+    m_precipitation->scale(m_forcing->value());
+  }
 }
 
 const IceModelVec2S& Frac_P::mean_precipitation_impl() const {
+  if (m_precipitation_is_stale) {
+    fused_precipitation(*m_precipitation);
+    m_precipitation_is_stale = false;
+  }
   return *m_precipitation;
 }
 
+bool Frac_P::temperature_map_impl(AffineMap &result) const {
+  // temperature is not modified
+  result = AffineMap();
+  return m_fuse;
+}
+
+bool Frac_P::precipitation_map_impl(AffineMap &result) const {
+  result = AffineMap(m_forcing->value(), 0.0);
+  return m_fuse;
+}
+
 void Frac_P::precip_time_series_impl(int i, int j, std::vector<double> &result) const {
   m_input_model->precip_time_series(i, j, result);
 
@@ -77,5 +98,19 @@ void Frac_P::precip_time_series_impl(int i, int j, std::vector<double> &result)
   }
 }
 
+void Frac_P::temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+  m_input_model->temp_time_series_batch(i0, j, n_points, result);
+}
+
+void Frac_P::precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+  m_input_model->precip_time_series_batch(i0, j, n_points, result);
+
+  for (unsigned int k = 0; k < m_offset_values.size(); ++k) {
+    for (int p = 0; p < n_points; ++p) {
+      result[k * n_points + p] *= m_offset_values[k];
+    }
+  }
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -41,12 +41,22 @@ private:
   const IceModelVec2S& mean_precipitation_impl() const;
 
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+  void precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+
+  bool temperature_map_impl(AffineMap &result) const;
+  bool precipitation_map_impl(AffineMap &result) const;
 
   mutable std::vector<double> m_offset_values;
 
   std::unique_ptr<ScalarForcing> m_forcing;
 
   IceModelVec2S::Ptr m_precipitation;
+
+  //! true if consecutive scalar modifiers are applied in one pass
+  bool m_fuse;
+  //! true if `m_precipitation` has to be re-computed (used if `m_fuse` is set)
+  mutable bool m_precipitation_is_stale;
 };
 
 } // end of namespace atmosphere
@@ -126,6 +126,16 @@ void Given::precip_time_series_impl(int i, int j, std::vector<double> &result) c
   m_precipitation->interp(i, j, result);
 }
 
+void Given::temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+
+  m_air_temp->interp(i0, j, n_points, result);
+}
+
+void Given::precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const {
+
+  m_precipitation->interp(i0, j, n_points, result);
+}
+
 void Given::init_timeseries_impl(const std::vector<double> &ts) const {
 
   m_air_temp->init_interpolation(ts);
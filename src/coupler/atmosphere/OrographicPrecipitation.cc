@@ -16,6 +16,9 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>             // std::max
+#include <cmath>                 // std::abs
+
 #include "OrographicPrecipitation.hh"
 
 #include "OrographicPrecipitationSerial.hh"
@@ -24,17 +27,26 @@
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Time.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/pism_config.hh"
+
+#if (Pism_USE_FFTW_MPI==1)
+#include "OrographicPrecipitationParallel.hh"
+#endif
 
 namespace pism {
 namespace atmosphere {
 
 OrographicPrecipitation::OrographicPrecipitation(IceGrid::ConstPtr grid,
                                                  std::shared_ptr<AtmosphereModel> in)
-    : AtmosphereModel(grid, in) {
+    : AtmosphereModel(grid, in),
+      m_last_surface_elevation(grid, "last_surface_elevation", WITHOUT_GHOSTS) {
 
   m_precipitation = allocate_precipitation(grid);
 
-  m_work0 = m_precipitation->allocate_proc0_copy();
+  m_last_surface_elevation_set = false;
+  m_update_threshold = m_config->get_number("atmosphere.orographic_precipitation.update_threshold");
+  m_water_density    = m_config->get_number("constants.fresh_water.density");
 
   const int
     Mx = m_grid->Mx(),
@@ -43,18 +55,30 @@ OrographicPrecipitation::OrographicPrecipitation(IceGrid::ConstPtr grid,
     Nx = Z * (Mx - 1) + 1,
     Ny = Z * (My - 1) + 1;
 
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) {
-      m_serial_model.reset(new OrographicPrecipitationSerial(*m_config,
-                                                             Mx, My,
-                                                             m_grid->dx(), m_grid->dy(),
-                                                             Nx, Ny));
+  if (m_config->get_flag("atmosphere.orographic_precipitation.parallel_fft")) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model.reset(new OrographicPrecipitationParallel(*m_config, m_grid, Nx, Ny));
+#else
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "atmosphere.orographic_precipitation.parallel_fft requires PISM"
+                       " built with FFTW-MPI (Pism_USE_FFTW_MPI)");
+#endif
+  } else {
+    m_work0 = m_precipitation->allocate_proc0_copy();
+
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) {
+        m_serial_model.reset(new OrographicPrecipitationSerial(*m_config,
+                                                               Mx, My,
+                                                               m_grid->dx(), m_grid->dy(),
+                                                               Nx, Ny));
+      }
+    } catch (...) {
+      rank0.failed();
     }
-  } catch (...) {
-    rank0.failed();
+    rank0.check();
   }
-  rank0.check();
 }
 
 OrographicPrecipitation::~OrographicPrecipitation() {
@@ -80,29 +104,66 @@ void OrographicPrecipitation::init_impl(const Geometry &geometry) {
 }
 
 
+//! Compute the maximum absolute difference between `a` and `b`.
+static double max_difference(const IceModelVec2S &a, const IceModelVec2S &b) {
+  IceGrid::ConstPtr grid = a.grid();
+
+  IceModelVec::AccessList list{&a, &b};
+
+  double result = 0.0;
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result = std::max(result, std::abs(a(i, j) - b(i, j)));
+  }
+
+  return GlobalMax(grid->com, result);
+}
+
 void OrographicPrecipitation::update_impl(const Geometry &geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
 
-  geometry.ice_surface_elevation.put_on_proc0(*m_work0);
+  const IceModelVec2S &surface_elevation = geometry.ice_surface_elevation;
 
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) { // processor zero updates the precipitation
-      m_serial_model->update(*m_work0);
-
-      PetscErrorCode ierr = VecCopy(m_serial_model->precipitation(), *m_work0);
-      PISM_CHK(ierr, "VecCopy");
+  // re-use precipitation computed earlier if the surface elevation did not change much
+  if (m_update_threshold > 0.0) {
+    if (m_last_surface_elevation_set and
+        max_difference(surface_elevation, m_last_surface_elevation) < m_update_threshold) {
+      return;
     }
-  } catch (...) {
-    rank0.failed();
+
+    m_last_surface_elevation.copy_from(surface_elevation);
+    m_last_surface_elevation_set = true;
   }
-  rank0.check();
 
-  m_precipitation->get_from_proc0(*m_work0);
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->update(surface_elevation);
+
+    m_precipitation->copy_from(m_parallel_model->precipitation());
+  } else
+#endif
+  {
+    surface_elevation.put_on_proc0(*m_work0);
+
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) { // processor zero updates the precipitation
+        m_serial_model->update(*m_work0);
+
+        PetscErrorCode ierr = VecCopy(m_serial_model->precipitation(), *m_work0);
+        PISM_CHK(ierr, "VecCopy");
+      }
+    } catch (...) {
+      rank0.failed();
+    }
+    rank0.check();
+
+    m_precipitation->get_from_proc0(*m_work0);
+  }
 
   // convert from mm/s to kg / (m^2 s):
-  double water_density = m_config->get_number("constants.fresh_water.density");
-  m_precipitation->scale(1e-3 * water_density);
+  m_precipitation->scale(1e-3 * m_water_density);
 }
 
 void OrographicPrecipitation::precip_time_series_impl(int i, int j,
@@ -113,6 +174,20 @@ void OrographicPrecipitation::precip_time_series_impl(int i, int j,
   }
 }
 
+void OrographicPrecipitation::temp_time_series_batch_impl(int i0, int j, int n_points,
+                                                          double *result) const {
+  m_input_model->temp_time_series_batch(i0, j, n_points, result);
+}
+
+void OrographicPrecipitation::precip_time_series_batch_impl(int i0, int j, int n_points,
+                                                            double *result) const {
+  for (unsigned int k = 0; k < m_ts_times.size(); k++) {
+    for (int p = 0; p < n_points; ++p) {
+      result[k * n_points + p] = (*m_precipitation)(i0 + p, j);
+    }
+  }
+}
+
 void OrographicPrecipitation::begin_pointwise_access_impl() const {
   m_input_model->begin_pointwise_access();
   m_precipitation->begin_access();
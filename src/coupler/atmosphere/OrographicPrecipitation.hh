@@ -28,6 +28,7 @@ class Geometry;
 namespace atmosphere {
 
 class OrographicPrecipitationSerial;
+class OrographicPrecipitationParallel;
 
 class OrographicPrecipitation : public AtmosphereModel {
 public:
@@ -44,6 +45,8 @@ private:
   void end_pointwise_access_impl() const;
 
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void temp_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
+  void precip_time_series_batch_impl(int i0, int j, int n_points, double *result) const;
 
 protected:
   std::string m_reference;
@@ -56,6 +59,21 @@ protected:
 
   //! Serial orographic precipitation model.
   std::unique_ptr<OrographicPrecipitationSerial> m_serial_model;
+
+  //! Distributed orographic precipitation model (used if
+  //! `atmosphere.orographic_precipitation.parallel_fft` is set).
+  //! OrographicPrecipitationParallel is not available if PISM is built without FFTW-MPI.
+  std::shared_ptr<OrographicPrecipitationParallel> m_parallel_model;
+
+  //! Surface elevation used by the most recent evaluation of the model.
+  IceModelVec2S m_last_surface_elevation;
+  //! True if m_precipitation corresponds to m_last_surface_elevation.
+  bool m_last_surface_elevation_set;
+  //! Re-compute precipitation only if surface elevation changed by more than this
+  //! (meters).
+  double m_update_threshold;
+  //! fresh water density, used to convert precipitation to kg m-2 s-1
+  double m_water_density;
 };
 
 } // end of namespace atmosphere
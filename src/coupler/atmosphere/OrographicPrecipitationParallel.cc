@@ -0,0 +1,231 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "OrographicPrecipitationParallel.hh"
+
+#include <algorithm>            // std::max
+#include <fftw3-mpi.h>
+#include <gsl/gsl_math.h>       // M_PI
+
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/fftw_utilities.hh"
+#include "pism/util/SlabScatter.hh"
+
+namespace pism {
+namespace atmosphere {
+
+/*!
+ * @param[in] config configuration database
+ * @param[in] grid PISM's grid
+ * @param[in] Nx extended grid size in the X direction
+ * @param[in] Ny extended grid size in the Y direction
+ */
+OrographicPrecipitationParallel::OrographicPrecipitationParallel(const Config &config,
+                                                                 IceGrid::ConstPtr grid,
+                                                                 int Nx, int Ny)
+  : m_Nx(Nx), m_Ny(Ny),
+    m_precipitation(grid, "orographic_precipitation", WITHOUT_GHOSTS) {
+
+  m_background_precip_pre  = config.get_number("atmosphere.orographic_precipitation.background_precip_pre", "mm/s");
+  m_background_precip_post = config.get_number("atmosphere.orographic_precipitation.background_precip_post", "mm/s");
+  m_precip_scale_factor    = config.get_number("atmosphere.orographic_precipitation.scale_factor");
+  m_truncate               = config.get_flag("atmosphere.orographic_precipitation.truncate");
+
+  // setup fftw stuff (fftw_mpi_init() may be called more than once)
+  fftw_mpi_init();
+
+  ptrdiff_t local_n0 = 0, local_0_start = 0;
+  ptrdiff_t alloc_local = fftw_mpi_local_size_2d(m_Nx, m_Ny, grid->com,
+                                                 &local_n0, &local_0_start);
+  m_slab_start = local_0_start;
+  m_slab_size  = local_n0;
+
+  m_fftw_input  = fftw_alloc_complex(alloc_local);
+  m_fftw_output = fftw_alloc_complex(alloc_local);
+
+  {
+    unsigned int flags = fftw_planner_flags(config);
+    std::string wisdom_file = config.get_string("fftw.wisdom_file");
+
+    // rank 0 reads wisdom and shares it with other ranks
+    if (grid->rank() == 0) {
+      fftw_load_wisdom(wisdom_file);
+    }
+    fftw_mpi_broadcast_wisdom(grid->com);
+
+    m_dft_forward = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                         grid->com, FFTW_FORWARD, flags);
+    m_dft_inverse = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                         grid->com, FFTW_BACKWARD, flags);
+
+    fftw_mpi_gather_wisdom(grid->com);
+    if (grid->rank() == 0) {
+      fftw_save_wisdom(wisdom_file);
+    }
+  }
+
+  // moves data between PISM's domain decomposition and slabs
+  m_center.reset(new SlabScatter(m_precipitation, m_Ny, m_slab_start, m_slab_size,
+                                 (m_Nx - grid->Mx()) / 2, (m_Ny - grid->My()) / 2));
+
+  precompute_transfer_function(config, grid->dx(), grid->dy());
+}
+
+OrographicPrecipitationParallel::~OrographicPrecipitationParallel() {
+  fftw_destroy_plan(m_dft_forward);
+  fftw_destroy_plan(m_dft_inverse);
+  fftw_free(m_fftw_input);
+  fftw_free(m_fftw_output);
+}
+
+/*!
+ * Return precipitation (in mm/s, like OrographicPrecipitationSerial).
+ */
+const IceModelVec2S& OrographicPrecipitationParallel::precipitation() const {
+  return m_precipitation;
+}
+
+/*!
+ * Compute the factor multiplying the Fourier transform of surface elevation in rows of
+ * the extended grid owned by this rank.
+ *
+ * See OrographicPrecipitationSerial::update() for details.
+ */
+void OrographicPrecipitationParallel::precompute_transfer_function(const Config &config,
+                                                                   double dx, double dy) {
+  const double eps = 1.0e-18;
+
+  const double
+    tau_c          = config.get_number("atmosphere.orographic_precipitation.conversion_time"),
+    tau_f          = config.get_number("atmosphere.orographic_precipitation.fallout_time"),
+    Hw             = config.get_number("atmosphere.orographic_precipitation.water_vapor_scale_height"),
+    Nm             = config.get_number("atmosphere.orographic_precipitation.moist_stability_frequency"),
+    wind_speed     = config.get_number("atmosphere.orographic_precipitation.wind_speed"),
+    wind_direction = config.get_number("atmosphere.orographic_precipitation.wind_direction"),
+    gamma          = config.get_number("atmosphere.orographic_precipitation.lapse_rate"),
+    Theta_m        = config.get_number("atmosphere.orographic_precipitation.moist_adiabatic_lapse_rate"),
+    rho_Sref       = config.get_number("atmosphere.orographic_precipitation.reference_density"),
+    latitude       = config.get_number("atmosphere.orographic_precipitation.coriolis_latitude");
+
+  const double
+    f  = 2.0 * 7.2921e-5 * sin(latitude * M_PI / 180.0),
+    u  = -sin(wind_direction * 2.0 * M_PI / 360.0) * wind_speed,
+    v  = -cos(wind_direction * 2.0 * M_PI / 360.0) * wind_speed,
+    Cw = rho_Sref * Theta_m / gamma;
+
+  std::vector<double>
+    kx = fftfreq(m_Nx, dx / (2.0 * M_PI)),
+    ky = fftfreq(m_Ny, dy / (2.0 * M_PI));
+
+  std::complex<double> I(0.0, 1.0);
+
+  m_transfer_function.resize(m_slab_size * m_Ny);
+
+  for (int i = m_slab_start; i < m_slab_start + m_slab_size; i++) {
+    for (int j = 0; j < m_Ny; j++) {
+      double sigma = u * kx[i] + v * ky[j];
+
+      // See equation (6) in [@ref SmithBarstadBonneau2005]
+      std::complex<double> m;
+      {
+        double denominator = sigma * sigma - f * f;
+
+        // avoid dividing by zero:
+        if (fabs(denominator) < eps) {
+          denominator = denominator >= 0 ? eps : -eps;
+        }
+
+        double m_squared = (Nm * Nm - sigma * sigma) * (kx[i] * kx[i] + ky[j] * ky[j]) / denominator;
+
+        // Note: this is a *complex* square root.
+        m = std::sqrt(std::complex<double>(m_squared));
+
+        if (m_squared >= 0.0 and sigma != 0.0) {
+          m *= sigma > 0.0 ? 1.0 : -1.0;
+        }
+      }
+
+      // avoid dividing by zero:
+      double delta = 0.0;
+      if (std::abs(1.0 - I * m * Hw) < eps) {
+        delta = eps;
+      }
+
+      // See equation (49) in [@ref SmithBarstad2004] or equation (3) in [@ref
+      // SmithBarstadBonneau2005].
+      m_transfer_function[(i - m_slab_start) * m_Ny + j] =
+        Cw * I * sigma / ((1.0 - I * m * Hw + delta) *
+                          (1.0 + I * sigma * tau_c) *
+                          (1.0 + I * sigma * tau_f));
+    }
+  }
+}
+
+/*!
+ * Update precipitation.
+ *
+ * @param[in] surface_elevation surface elevation on PISM's grid
+ */
+void OrographicPrecipitationParallel::update(const IceModelVec2S &surface_elevation) {
+
+  // Compute fft2(surface_elevation)
+  {
+    clear_fftw_array(m_fftw_input, m_slab_size, m_Ny);
+    m_center->set_real_part(surface_elevation, 1.0, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  {
+    FFTWArray
+      fftw_output(m_fftw_output, m_slab_size, m_Ny),
+      fftw_input(m_fftw_input, m_slab_size, m_Ny);
+
+    for (int i = 0; i < m_slab_size; i++) {
+      for (int j = 0; j < m_Ny; j++) {
+        fftw_input(i, j) = fftw_output(i, j) * m_transfer_function[i * m_Ny + j];
+      }
+    }
+  }
+
+  fftw_execute(m_dft_inverse);
+
+  m_center->get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_precipitation);
+
+  IceGrid::ConstPtr grid = m_precipitation.grid();
+
+  IceModelVec::AccessList list(m_precipitation);
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double &P = m_precipitation(i, j);
+
+    P += m_background_precip_pre;
+    if (m_truncate) {
+      P = std::max(P, 0.0);
+    }
+    P *= m_precip_scale_factor;
+    P += m_background_precip_post;
+  }
+}
+
+} // end of namespace atmosphere
+} // end of namespace pism
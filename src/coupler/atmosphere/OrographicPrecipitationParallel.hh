@@ -0,0 +1,94 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef OROGRAPHICPRECIPITATIONPARALLEL_H
+#define OROGRAPHICPRECIPITATIONPARALLEL_H
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include <fftw3.h>
+
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+
+class Config;
+class SlabScatter;
+
+namespace atmosphere {
+
+//! Distributed version of OrographicPrecipitationSerial.
+/*!
+  Implements the same linear model of orographic precipitation, but uses FFTW's MPI
+  interface so that the data stays distributed: the extended grid is split into slabs
+  (contiguous ranges of grid rows in the X direction), one slab per rank.
+
+  OrographicPrecipitationSerial remains the reference implementation: both classes should
+  produce the same results up to rounding errors.
+*/
+class OrographicPrecipitationParallel {
+public:
+  OrographicPrecipitationParallel(const Config &config, IceGrid::ConstPtr grid,
+                                  int Nx, int Ny);
+  ~OrographicPrecipitationParallel();
+
+  const IceModelVec2S& precipitation() const;
+
+  void update(const IceModelVec2S &surface_elevation);
+
+private:
+  void precompute_transfer_function(const Config &config, double dx, double dy);
+
+  // extended grid size
+  int m_Nx;
+  int m_Ny;
+
+  // the range of rows (in the X direction) of the extended grid owned by this rank
+  int m_slab_start;
+  int m_slab_size;
+
+  //! truncate
+  bool m_truncate;
+  //! precipitation scale factor
+  double m_precip_scale_factor;
+  //! background precipitation
+  double m_background_precip_pre, m_background_precip_post;
+
+  //! Fourier transform of precipitation divided by the Fourier transform of surface
+  //! elevation, in rows owned by this rank
+  std::vector<std::complex<double> > m_transfer_function;
+
+  // orographic precipitation
+  IceModelVec2S m_precipitation;
+
+  //! PISM grid <-> extended grid with the physical grid in the center
+  std::unique_ptr<SlabScatter> m_center;
+
+  fftw_complex *m_fftw_input;
+  fftw_complex *m_fftw_output;
+
+  fftw_plan m_dft_forward;
+  fftw_plan m_dft_inverse;
+};
+
+} // end of namespace atmosphere
+} // end of namespace pism
+
+#endif /* OROGRAPHICPRECIPITATIONPARALLEL_H */
@@ -98,10 +98,17 @@ OrographicPrecipitationSerial::OrographicPrecipitationSerial(const Config &confi
     m_fftw_output = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
 
     // FFTW plans
+    unsigned int flags = fftw_planner_flags(config);
+    std::string wisdom_file = config.get_string("fftw.wisdom_file");
+
+    fftw_load_wisdom(wisdom_file);
+
     m_dft_forward = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
-                                     FFTW_FORWARD, FFTW_ESTIMATE);
+                                     FFTW_FORWARD, flags);
     m_dft_inverse = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
-                                     FFTW_BACKWARD, FFTW_ESTIMATE);
+                                     FFTW_BACKWARD, flags);
+
+    fftw_save_wisdom(wisdom_file);
 
     // Note: FFTW is weird. If a malloc() call fails it will just call
     // abort() on you without giving you a chance to recover or tell the
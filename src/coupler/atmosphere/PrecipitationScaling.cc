@@ -57,9 +57,9 @@ void PrecipitationScaling::init_impl(const Geometry &geometry) {
 void PrecipitationScaling::init_timeseries_impl(const std::vector<double> &ts) const {
   AtmosphereModel::init_timeseries_impl(ts);
 
-  m_scaling_values.resize(ts.size());
+  m_forcing->value(ts, m_scaling_values);
   for (unsigned int k = 0; k < ts.size(); ++k) {
-    m_scaling_values[k] = exp(m_exp_factor * m_forcing->value(ts[k]));
+    m_scaling_values[k] = exp(m_exp_factor * m_scaling_values[k]);
   }
 }
 
@@ -0,0 +1,44 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#include "Cache.hh"
+
+namespace pism {
+namespace frontalmelt {
+
+Cache::Cache(IceGrid::ConstPtr g, std::shared_ptr<FrontalMelt> in)
+  : CachingModifier<FrontalMelt, FrontalMeltInputs>(g, in, "frontal_melt") {
+
+  m_frontal_melt_rate = allocate_frontal_melt_rate(g);
+}
+
+Cache::~Cache() {
+  // empty
+}
+
+void Cache::copy_outputs() {
+  m_frontal_melt_rate->copy_from(m_input_model->frontal_melt_rate());
+}
+
+const IceModelVec2S& Cache::frontal_melt_rate_impl() const {
+  return *m_frontal_melt_rate;
+}
+
+} // end of namespace frontalmelt
+} // end of namespace pism
@@ -0,0 +1,56 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#ifndef _PFM_CACHE_H_
+#define _PFM_CACHE_H_
+
+#include "pism/coupler/FrontalMelt.hh"
+#include "pism/coupler/util/CachingModifier.hh"
+
+namespace pism {
+
+inline const Geometry& cached_geometry(const FrontalMeltInputs &inputs) {
+  return *inputs.geometry;
+}
+
+namespace frontalmelt {
+
+//! Updates the frontal melt model below it every `frontal_melt.cache.update_interval`
+//! years (see CachingModifier).
+/*!
+ * The retreat rate is re-computed every time step using the stored frontal melt rate and
+ * the current geometry.
+ */
+class Cache : public CachingModifier<FrontalMelt, FrontalMeltInputs> {
+public:
+  Cache(IceGrid::ConstPtr g, std::shared_ptr<FrontalMelt> in);
+  virtual ~Cache();
+
+protected:
+  void copy_outputs();
+
+  const IceModelVec2S& frontal_melt_rate_impl() const;
+private:
+  IceModelVec2S::Ptr m_frontal_melt_rate;
+};
+
+} // end of namespace frontalmelt
+} // end of namespace pism
+
+#endif /* _PFM_CACHE_H_ */
@@ -16,6 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cmath>                // NAN, std::abs
+
 #include "DischargeRouting.hh"
 
 #include "pism/util/IceGrid.hh"
@@ -27,10 +29,22 @@ namespace pism {
 namespace frontalmelt {
   
 DischargeRouting::DischargeRouting(IceGrid::ConstPtr grid)
-  : FrontalMelt(grid, nullptr) {
+  : FrontalMelt(grid, nullptr),
+    m_melt_rate(grid, "frontal_melt_rate_cache", WITHOUT_GHOSTS),
+    m_water_depth(grid, "frontal_melt_water_depth_cache", WITHOUT_GHOSTS),
+    m_discharge_flux(grid, "frontal_melt_discharge_flux_cache", WITHOUT_GHOSTS),
+    m_thermal_forcing(grid, "frontal_melt_thermal_forcing_cache", WITHOUT_GHOSTS) {
 
   m_frontal_melt_rate = allocate_frontal_melt_rate(grid, 1);
 
+  m_update_tolerance = m_config->get_number("frontal_melt.routing.update_tolerance");
+
+  // NaNs mark inputs that were not used yet (see changed() below)
+  m_water_depth.set(NAN);
+  m_discharge_flux.set(NAN);
+  m_thermal_forcing.set(NAN);
+  m_melt_rate.set(0.0);
+
   m_log->message(2,
                  "* Initializing the frontal melt model\n"
                  "  using the Rignot/Xu parameterization\n"
@@ -87,6 +101,14 @@ void DischargeRouting::initialize(const IceModelVec2S &theta) {
   m_theta_ocean->copy_from(theta);
 }
 
+/*!
+ * Returns true if `new_value` differs from `old_value` by more than `tolerance` times
+ * `old_value` (and if `old_value` is NaN).
+ */
+static bool changed(double old_value, double new_value, double tolerance) {
+  return not (std::abs(new_value - old_value) <= tolerance * std::abs(old_value));
+}
+
 void DischargeRouting::update_impl(const FrontalMeltInputs &inputs, double t, double dt) {
 
   m_theta_ocean->update(t, dt);
@@ -101,12 +123,19 @@ void DischargeRouting::update_impl(const FrontalMeltInputs &inputs, double t, do
 
   IceModelVec::AccessList list
     {&ice_thickness, &bed_elevation, &cell_type, &sea_level_elevation,
-     &water_flux, m_theta_ocean.get(), m_frontal_melt_rate.get()};
+     &water_flux, m_theta_ocean.get(), m_frontal_melt_rate.get(),
+     &m_melt_rate, &m_water_depth, &m_discharge_flux, &m_thermal_forcing};
 
   double
     seconds_per_day = 86400,
     grid_spacing    = 0.5 * (m_grid->dx() + m_grid->dy());
 
+  // Frontal melt rates change slowly compared to the time step length, so we re-compute
+  // them only at icy cells where inputs changed (by more than m_update_tolerance). Inputs
+  // at these cells are collected and processed in a batch.
+  std::vector<int> I, J;
+  std::vector<double> H, Q, TF_list;
+
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
@@ -118,6 +147,14 @@ void DischargeRouting::update_impl(const FrontalMeltInputs &inputs, double t, do
       double water_depth = std::max(sea_level_elevation(i, j) - bed_elevation(i, j), 0.0),
         submerged_front_area = water_depth * grid_spacing;
 
+      if (water_depth <= 0.0) {
+        // no frontal melt (see FrontalMeltPhysics::frontal_melt_from_undercutting())
+        m_melt_rate(i, j) = 0.0;
+        // make sure the melt rate is re-computed once water depth becomes positive
+        m_water_depth(i, j) = NAN;
+        continue;
+      }
+
       // Convert subglacial water flux (m^2/s) to an "effective subglacial freshwater
       // velocity" or flux per unit area of ice front in m/day (see Xu et al 2013, section
       // 2, paragraph 11).
@@ -129,14 +166,36 @@ void DischargeRouting::update_impl(const FrontalMeltInputs &inputs, double t, do
       double Q_sg = water_flux(i, j) * grid_spacing;
       double q_sg = Q_sg / submerged_front_area * seconds_per_day;
 
-      (*m_frontal_melt_rate)(i, j) = physics.frontal_melt_from_undercutting(water_depth, q_sg, TF);
-      // convert from m / day to m / s
-      (*m_frontal_melt_rate)(i, j) /= seconds_per_day;
-    } else {
-      (*m_frontal_melt_rate)(i, j) = 0.0;
+      if (changed(m_water_depth(i, j), water_depth, m_update_tolerance) or
+          changed(m_discharge_flux(i, j), q_sg, m_update_tolerance) or
+          changed(m_thermal_forcing(i, j), TF, m_update_tolerance)) {
+        I.push_back(i);
+        J.push_back(j);
+        H.push_back(water_depth);
+        Q.push_back(q_sg);
+        TF_list.push_back(TF);
+
+        m_water_depth(i, j)     = water_depth;
+        m_discharge_flux(i, j)  = q_sg;
+        m_thermal_forcing(i, j) = TF;
+      }
     }
   } // end of the loop over grid points
 
+  std::vector<double> melt_rate;
+  physics.frontal_melt_from_undercutting(H, Q, TF_list, melt_rate);
+
+  for (size_t k = 0; k < melt_rate.size(); ++k) {
+    // convert from m / day to m / s
+    m_melt_rate(I[k], J[k]) = melt_rate[k] / seconds_per_day;
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    (*m_frontal_melt_rate)(i, j) = cell_type.icy(i, j) ? m_melt_rate(i, j) : 0.0;
+  }
+
   // Set frontal melt rate *near* grounded termini to the average of grounded icy
   // neighbors: front retreat code uses values at these locations (the rest is for
   // visualization).
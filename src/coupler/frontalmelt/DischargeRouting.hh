@@ -47,6 +47,13 @@ private:
 
   // output
   IceModelVec2S::Ptr m_frontal_melt_rate;
+
+  //! frontal melt rates at icy cells computed during previous updates
+  IceModelVec2S m_melt_rate;
+  //! inputs used to compute m_melt_rate
+  IceModelVec2S m_water_depth, m_discharge_flux, m_thermal_forcing;
+  //! relative change of inputs that triggers re-computing the frontal melt rate
+  double m_update_tolerance;
 };
 
 } // end of namespace frontalmelt
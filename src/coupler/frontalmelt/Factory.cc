@@ -24,6 +24,7 @@
 #include "DischargeGiven.hh"
 #include "DischargeRouting.hh"
 #include "Given.hh"
+#include "Cache.hh"
 
 namespace pism {
 namespace frontalmelt {
@@ -35,6 +36,8 @@ Factory::Factory(IceGrid::ConstPtr g)
   add_model<DischargeGiven>("discharge_given");
   add_model<DischargeRouting>("routing");
   add_model<Given>("given");
+
+  add_modifier<Cache>("cache");
 }
 
 Factory::~Factory() {
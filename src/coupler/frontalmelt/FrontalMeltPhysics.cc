@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include <cmath> // pow
+#include <cassert>
 
 #include "FrontalMeltPhysics.hh"
 
@@ -56,6 +57,36 @@ double FrontalMeltPhysics::frontal_melt_from_undercutting(double h, double q_sg,
   return (m_A * h * pow(q_sg, m_alpha) + m_B) * pow(TF, m_beta);
 }
 
+/*!
+ * Evaluate frontal_melt_from_undercutting() at a number of points.
+ *
+ * The loop has no branches, so it can be vectorized. Results are the same as the ones
+ * computed one point at a time.
+ *
+ * @param[in] h water depth, meters
+ * @param[in] q_sg subglacial water flux, m / day
+ * @param[in] TF thermal forcing, Celsius
+ * @param[out] result frontal melt rate, m / day
+ */
+void FrontalMeltPhysics::frontal_melt_from_undercutting(const std::vector<double> &h,
+                                                        const std::vector<double> &q_sg,
+                                                        const std::vector<double> &TF,
+                                                        std::vector<double> &result) const {
+  const size_t N = h.size();
+
+  assert(q_sg.size() == N and TF.size() == N);
+
+  result.resize(N);
+
+  for (size_t k = 0; k < N; ++k) {
+    bool valid = not (h[k] <= 0.0 or q_sg[k] < 0.0 or TF[k] < 0.0);
+
+    double melt_rate = (m_A * h[k] * pow(q_sg[k], m_alpha) + m_B) * pow(TF[k], m_beta);
+
+    result[k] = valid ? melt_rate : 0.0;
+  }
+}
+
 /*!
  * Parameterization of the frontal melt rate.
  *
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <vector>
+
 namespace pism {
 
 class Config;
@@ -35,6 +37,11 @@ public:
                                         double discharge_flux,
                                         double potential_temperature) const;
 
+  void frontal_melt_from_undercutting(const std::vector<double> &water_depth,
+                                      const std::vector<double> &discharge_flux,
+                                      const std::vector<double> &thermal_forcing,
+                                      std::vector<double> &result) const;
+
 private:
   double m_A, m_B, m_alpha, m_beta;
 };
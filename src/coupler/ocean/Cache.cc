@@ -17,32 +17,13 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <algorithm>            // std::min
-#include <cassert>
-#include <cmath>
-
 #include "Cache.hh"
-#include "pism/util/Time.hh"
-#include "pism/util/IceGrid.hh"
-
-#include "pism/util/error_handling.hh"
-#include "pism/util/pism_utilities.hh"
-#include "pism/util/MaxTimestep.hh"
 
 namespace pism {
 namespace ocean {
 
 Cache::Cache(IceGrid::ConstPtr g, std::shared_ptr<OceanModel> in)
-  : OceanModel(g, in) {
-
-  m_next_update_time = m_grid->ctx()->time()->current();
-  m_update_interval_years = m_config->get_number("ocean.cache.update_interval");
-
-  if (m_update_interval_years < 1) {
-    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                  "ocean.cache.update_interval has to be strictly positive (got %d)",
-                                  m_update_interval_years);
-  }
+  : CachingModifier<OceanModel>(g, in, "ocean") {
 
   {
     m_shelf_base_temperature         = allocate_shelf_base_temperature(g);
@@ -55,63 +36,12 @@ Cache::~Cache() {
   // empty
 }
 
-void Cache::init_impl(const Geometry &geometry) {
-  m_input_model->init(geometry);
-
-  m_log->message(2,
-                 "* Initializing the 'caching' ocean model modifier...\n");
-
-  m_next_update_time = m_grid->ctx()->time()->current();
-}
-
-void Cache::update_impl(const Geometry &geometry, double t, double dt) {
-  // ignore dt and always use 1 year long time-steps when updating
-  // an input model
-  (void) dt;
-
-  if (t >= m_next_update_time or
-      fabs(t - m_next_update_time) < 1.0) {
-
-    double
-      one_year_from_now = m_grid->ctx()->time()->increment_date(t, 1.0),
-      update_dt         = one_year_from_now - t;
-
-    assert(update_dt > 0.0);
-
-    m_input_model->update(geometry, t, update_dt);
-
-    m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
-                                                               m_update_interval_years);
-
-    m_melange_back_pressure_fraction->copy_from(m_input_model->melange_back_pressure_fraction());
-
-    m_shelf_base_temperature->copy_from(m_input_model->shelf_base_temperature());
-
-    m_shelf_base_mass_flux->copy_from(m_input_model->shelf_base_mass_flux());
-  }
-}
-
-MaxTimestep Cache::max_timestep_impl(double t) const {
-  double dt = m_next_update_time - t;
-
-  // if we got very close to the next update time, set time step
-  // length to the interval between updates
-  if (dt < 1.0) {
-    double update_time_after_next = m_grid->ctx()->time()->increment_date(m_next_update_time,
-                                                                m_update_interval_years);
+void Cache::copy_outputs() {
+  m_melange_back_pressure_fraction->copy_from(m_input_model->melange_back_pressure_fraction());
 
-    dt = update_time_after_next - m_next_update_time;
-    assert(dt > 0.0);
-  }
-
-  MaxTimestep cache_dt(dt, "ocean cache");
+  m_shelf_base_temperature->copy_from(m_input_model->shelf_base_temperature());
 
-  MaxTimestep input_max_timestep = m_input_model->max_timestep(t);
-  if (input_max_timestep.finite()) {
-    return std::min(input_max_timestep, cache_dt);
-  } else {
-    return cache_dt;
-  }
+  m_shelf_base_mass_flux->copy_from(m_input_model->shelf_base_mass_flux());
 }
 
 const IceModelVec2S& Cache::shelf_base_temperature_impl() const {
@@ -21,28 +21,23 @@
 #define _POCACHE_H_
 
 #include "pism/coupler/OceanModel.hh"
+#include "pism/coupler/util/CachingModifier.hh"
 
 namespace pism {
 namespace ocean {
 
-class Cache : public OceanModel {
+class Cache : public CachingModifier<OceanModel> {
 public:
   Cache(IceGrid::ConstPtr g, std::shared_ptr<OceanModel> in);
   virtual ~Cache();
 
 protected:
-  MaxTimestep max_timestep_impl(double t) const;
-
-  void update_impl(const Geometry &geometry, double my_t, double my_dt);
-  void init_impl(const Geometry &geometry);
+  void copy_outputs();
 
   const IceModelVec2S& shelf_base_temperature_impl() const;
   const IceModelVec2S& shelf_base_mass_flux_impl() const;
   const IceModelVec2S& melange_back_pressure_fraction_impl() const;
 private:
-  double m_next_update_time;
-  unsigned int m_update_interval_years;
-
   // storage for melange_back_pressure_fraction is inherited from OceanModel
   IceModelVec2S::Ptr m_shelf_base_temperature;
   IceModelVec2S::Ptr m_shelf_base_mass_flux;
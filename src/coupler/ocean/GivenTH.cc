@@ -18,6 +18,8 @@
 
 #include <gsl/gsl_poly.h>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 #include "GivenTH.hh"
 #include "pism/util/IceGrid.hh"
@@ -138,25 +140,37 @@ void GivenTH::update_impl(const Geometry &geometry, double t, double dt) {
   IceModelVec::AccessList list{ &ice_thickness, m_theta_ocean.get(), m_salinity_ocean.get(),
       &temperature, &mass_flux};
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    double potential_temperature_celsius = (*m_theta_ocean)(i,j) - 273.15;
-
-    double
-      shelf_base_temp_celsius = 0.0,
-      shelf_base_massflux     = 0.0;
+  // Copy inputs into arrays so that we can process all grid points in a batch (see
+  // batch_update()).
+  const size_t N = m_grid->xm() * m_grid->ym();
+  std::vector<double>
+    salinity(N), potential_temperature_celsius(N), thickness(N),
+    shelf_base_temp_celsius(N), shelf_base_massflux(N);
+  {
+    size_t k = 0;
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      salinity[k]                      = (*m_salinity_ocean)(i, j);
+      potential_temperature_celsius[k] = (*m_theta_ocean)(i, j) - 273.15;
+      thickness[k]                     = ice_thickness(i, j);
+      ++k;
+    }
+  }
 
-    pointwise_update(c,
-                     (*m_salinity_ocean)(i,j),
-                     potential_temperature_celsius,
-                     ice_thickness(i,j),
-                     &shelf_base_temp_celsius,
-                     &shelf_base_massflux);
+  batch_update(c, salinity, potential_temperature_celsius, thickness,
+               shelf_base_temp_celsius, shelf_base_massflux);
 
-    // Convert from Celsius to Kelvin:
-    temperature(i,j) = shelf_base_temp_celsius + 273.15;
-    mass_flux(i,j)   = shelf_base_massflux;
+  {
+    size_t k = 0;
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      // Convert from Celsius to Kelvin:
+      temperature(i, j) = shelf_base_temp_celsius[k] + 273.15;
+      mass_flux(i, j)   = shelf_base_massflux[k];
+      ++k;
+    }
   }
 
   // convert mass flux from [m s-1] to [kg m-2 s-1]:
@@ -191,6 +205,107 @@ static double shelf_base_melt_rate(GivenTH::Constants c,
   return c.gamma_S * c.sea_water_density * (sea_water_salinity - basal_salinity) / (c.ice_density * basal_salinity);
 }
 
+//! Clip salinity to the range in which the freezing point parameterization is valid, if
+//! requested.
+static inline double clip_salinity(const GivenTH::Constants &c, double salinity) {
+  // This model works for sea water salinity in the range of [4, 40] psu.
+  const double
+    min_salinity = 4.0,
+    max_salinity = 40.0;
+
+  if (c.limit_salinity_range) {
+    return std::min(std::max(salinity, min_salinity), max_salinity);
+  }
+  return salinity;
+}
+
+/*!
+ * Coefficients of quadratic equations for the basal salinity in the melt, freeze-on and
+ * diffusion-only cases. See subshelf_salinity_melt(), subshelf_salinity_freeze_on() and
+ * subshelf_salinity_diffusion_only() for details.
+ */
+struct QuadraticCoefficients {
+  double A, B, C;
+};
+
+static inline QuadraticCoefficients melt_coefficients(const GivenTH::Constants &c,
+                                                      double S_W, double Theta_W,
+                                                      double thickness) {
+  const double
+    c_pI    = c.ice_specific_heat_capacity,
+    c_pW    = c.sea_water_specific_heat_capacity,
+    L       = c.water_latent_heat_fusion,
+    T_S     = c.shelf_top_surface_temperature;
+
+  const double A = c.a[0] * c.gamma_S * c_pI - c.b[0] * c.gamma_T * c_pW;
+  const double B = (c.gamma_S * (L - c_pI * (T_S + c.a[0] * S_W - c.a[2] * thickness - c.a[1])) +
+                    c.gamma_T * c_pW * (Theta_W - c.b[2] * thickness - c.b[1]));
+  const double C = -c.gamma_S * S_W * (L - c_pI * (T_S - c.a[2] * thickness - c.a[1]));
+
+  return {A, B, C};
+}
+
+static inline QuadraticCoefficients freeze_on_coefficients(const GivenTH::Constants &c,
+                                                           double S_W, double Theta_W,
+                                                           double h) {
+  const double
+    c_pW    = c.sea_water_specific_heat_capacity,
+    L       = c.water_latent_heat_fusion;
+
+  const double A = -c.b[0] * c.gamma_T * c_pW;
+  const double B = c.gamma_S * L + c.gamma_T * c_pW * (Theta_W - c.b[2] * h - c.b[1]);
+  const double C = -c.gamma_S * S_W * L;
+
+  return {A, B, C};
+}
+
+static inline QuadraticCoefficients diffusion_only_coefficients(const GivenTH::Constants &c,
+                                                                double S_W, double Theta_W,
+                                                                double h) {
+  const double
+    c_pI    = c.ice_specific_heat_capacity,
+    c_pW    = c.sea_water_specific_heat_capacity,
+    L       = c.water_latent_heat_fusion,
+    T_S     = c.shelf_top_surface_temperature,
+    rho_W   = c.sea_water_density,
+    rho_I   = c.ice_density,
+    kappa   = c.ice_thermal_diffusivity;
+
+  const double A = -(c.b[0] * c.gamma_T * h * rho_W * c_pW - c.a[0] * rho_I * c_pI * kappa) / (h * rho_W);
+  const double B = ((rho_I * c_pI * kappa * (T_S - c.a[2] * h - c.a[1])) / (h * rho_W) +
+                    c.gamma_S * L + c.gamma_T * c_pW * (Theta_W - c.b[2] * h - c.b[1]));
+  const double C = -c.gamma_S * S_W * L;
+
+  return {A, B, C};
+}
+
+//! Solve a quadratic equation using GSL and return the bigger root.
+static inline double bigger_root_gsl(const QuadraticCoefficients &q) {
+  double S1 = 0.0, S2 = 0.0;
+  const int n_roots = gsl_poly_solve_quadratic(q.A, q.B, q.C, &S1, &S2);
+
+  assert(n_roots > 0);
+  assert(S2 > 0.0);             // The bigger root should be positive.
+  (void) n_roots;
+
+  return S2;
+}
+
+//! Branch-free version of bigger_root_gsl().
+/*!
+ * Uses the same formulas as gsl_poly_solve_quadratic() in the case of a positive
+ * discriminant and a non-zero `B` (which is the case here) and produces the same result.
+ */
+static inline double bigger_root(const QuadraticCoefficients &q) {
+  const double
+    disc = q.B * q.B - 4.0 * q.A * q.C,
+    temp = -0.5 * (q.B + std::copysign(std::sqrt(disc), q.B)),
+    r1   = temp / q.A,
+    r2   = q.C / temp;
+
+  return std::max(r1, r2);
+}
+
 /** @brief Compute temperature and melt rate at the base of the shelf.
  * Based on [@ref HellmerOlbers1989] and [@ref HollandJenkins1999].
  *
@@ -349,17 +464,7 @@ void GivenTH::pointwise_update(const Constants &constants,
 
   // This model works for sea water salinity in the range of [4, 40]
   // psu. Ensure that input salinity is in this range.
-  const double
-    min_salinity = 4.0,
-    max_salinity = 40.0;
-
-  if (constants.limit_salinity_range == true) {
-    if (sea_water_salinity < min_salinity) {
-      sea_water_salinity = min_salinity;
-    } else if (sea_water_salinity > max_salinity) {
-      sea_water_salinity = max_salinity;
-    }
-  }
+  sea_water_salinity = clip_salinity(constants, sea_water_salinity);
 
   double basal_salinity = sea_water_salinity;
   subshelf_salinity(constants, sea_water_salinity, sea_water_potential_temperature,
@@ -367,13 +472,7 @@ void GivenTH::pointwise_update(const Constants &constants,
 
   // Clip basal salinity so that we can use the freezing point
   // temperature parameterization to recover shelf base temperature.
-  if (constants.limit_salinity_range == true) {
-    if (basal_salinity <= min_salinity) {
-      basal_salinity = min_salinity;
-    } else if (basal_salinity >= max_salinity) {
-      basal_salinity = max_salinity;
-    }
-  }
+  basal_salinity = clip_salinity(constants, basal_salinity);
 
   *shelf_base_temperature_out = melting_point_temperature(constants, basal_salinity, thickness);
 
@@ -385,6 +484,91 @@ void GivenTH::pointwise_update(const Constants &constants,
   }
 }
 
+//! Batched version of pointwise_update().
+/*!
+ * Produces the same results as calling pointwise_update() at each point, but
+ *
+ * - first computes the basal salinity assuming melt at all points,
+ * - then uses the freeze-on assumption at points where this is not consistent with the
+ *   resulting melt rate (see subshelf_salinity()),
+ * - and the diffusion-only case at remaining points.
+ *
+ * Each of these steps is a loop without branches (except for collecting indices of points
+ * that need the next step), so it can be vectorized. Usually most points are in the first
+ * group.
+ */
+void GivenTH::batch_update(const Constants &c,
+                           const std::vector<double> &sea_water_salinity,
+                           const std::vector<double> &sea_water_potential_temperature,
+                           const std::vector<double> &ice_thickness,
+                           std::vector<double> &shelf_base_temperature_out,
+                           std::vector<double> &shelf_base_melt_rate_out) {
+  const size_t N = sea_water_salinity.size();
+
+  if (sea_water_potential_temperature.size() != N or ice_thickness.size() != N) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "array sizes do not match");
+  }
+
+  shelf_base_temperature_out.resize(N);
+  shelf_base_melt_rate_out.resize(N);
+
+  const double
+    *Theta_W = sea_water_potential_temperature.data(),
+    *h       = ice_thickness.data();
+
+  std::vector<double> S_W(N), S_B(N);
+
+  // assume melt at all points
+  for (size_t k = 0; k < N; ++k) {
+    assert(h[k] >= 0.0);
+
+    S_W[k] = clip_salinity(c, sea_water_salinity[k]);
+    S_B[k] = bigger_root(melt_coefficients(c, S_W[k], Theta_W[k], h[k]));
+  }
+
+  // points where the melt assumption is not consistent with the melt rate
+  std::vector<size_t> freeze_on;
+  for (size_t k = 0; k < N; ++k) {
+    if (not (shelf_base_melt_rate(c, S_W[k], S_B[k]) > 0.0)) {
+      freeze_on.push_back(k);
+    }
+  }
+
+  // assume freeze-on at these points
+  std::vector<double> S_F(freeze_on.size());
+  for (size_t n = 0; n < freeze_on.size(); ++n) {
+    const size_t k = freeze_on[n];
+    S_F[n] = bigger_root(freeze_on_coefficients(c, S_W[k], Theta_W[k], h[k]));
+  }
+
+  std::vector<size_t> diffusion_only;
+  for (size_t n = 0; n < freeze_on.size(); ++n) {
+    const size_t k = freeze_on[n];
+    if (shelf_base_melt_rate(c, S_W[k], S_F[n]) < 0.0) {
+      S_B[k] = S_F[n];
+    } else {
+      diffusion_only.push_back(k);
+    }
+  }
+
+  // use the diffusion-only case at remaining points
+  for (size_t n = 0; n < diffusion_only.size(); ++n) {
+    const size_t k = diffusion_only[n];
+    S_B[k] = bigger_root(diffusion_only_coefficients(c, S_W[k], Theta_W[k], h[k]));
+  }
+
+  for (size_t k = 0; k < N; ++k) {
+    const double basal_salinity = clip_salinity(c, S_B[k]);
+
+    shelf_base_temperature_out[k] = melting_point_temperature(c, basal_salinity, h[k]);
+
+    // no melt if there is no ice
+    shelf_base_melt_rate_out[k] = (h[k] == 0.0 ?
+                                   0.0 :
+                                   shelf_base_melt_rate(c, S_W[k], basal_salinity));
+  }
+}
+
 
 /** @brief Compute the basal salinity and make sure that it is
  * consistent with the basal melt rate.
@@ -482,31 +666,14 @@ void GivenTH::subshelf_salinity_melt(const Constants &c,
                                                  double sea_water_potential_temperature,
                                                  double thickness,
                                                  double *shelf_base_salinity) {
-
-  const double
-    c_pI    = c.ice_specific_heat_capacity,
-    c_pW    = c.sea_water_specific_heat_capacity,
-    L       = c.water_latent_heat_fusion,
-    T_S     = c.shelf_top_surface_temperature,
-    S_W     = sea_water_salinity,
-    Theta_W = sea_water_potential_temperature;
-
   // We solve a quadratic equation for Sb, the salinity at the shelf
   // base.
   //
   // A*Sb^2 + B*Sb + C = 0
-  const double A = c.a[0] * c.gamma_S * c_pI - c.b[0] * c.gamma_T * c_pW;
-  const double B = (c.gamma_S * (L - c_pI * (T_S + c.a[0] * S_W - c.a[2] * thickness - c.a[1])) +
-                    c.gamma_T * c_pW * (Theta_W - c.b[2] * thickness - c.b[1]));
-  const double C = -c.gamma_S * S_W * (L - c_pI * (T_S - c.a[2] * thickness - c.a[1]));
+  auto coefficients = melt_coefficients(c, sea_water_salinity,
+                                        sea_water_potential_temperature, thickness);
 
-  double S1 = 0.0, S2 = 0.0;
-  const int n_roots = gsl_poly_solve_quadratic(A, B, C, &S1, &S2);
-
-  assert(n_roots > 0);
-  assert(S2 > 0.0);             // The bigger root should be positive.
-
-  *shelf_base_salinity = S2;
+  *shelf_base_salinity = bigger_root_gsl(coefficients);
 }
 
 /** Compute basal salinity in the basal freeze-on case.
@@ -539,29 +706,14 @@ void GivenTH::subshelf_salinity_freeze_on(const Constants &c,
                                                       double sea_water_potential_temperature,
                                                       double thickness,
                                                       double *shelf_base_salinity) {
-
-  const double
-    c_pW    = c.sea_water_specific_heat_capacity,
-    L       = c.water_latent_heat_fusion,
-    S_W     = sea_water_salinity,
-    Theta_W = sea_water_potential_temperature,
-    h       = thickness;
-
   // We solve a quadratic equation for Sb, the salinity at the shelf
   // base.
   //
   // A*Sb^2 + B*Sb + C = 0
-  const double A = -c.b[0] * c.gamma_T * c_pW;
-  const double B = c.gamma_S * L + c.gamma_T * c_pW * (Theta_W - c.b[2] * h - c.b[1]);
-  const double C = -c.gamma_S * S_W * L;
-
-  double S1 = 0.0, S2 = 0.0;
-  const int n_roots = gsl_poly_solve_quadratic(A, B, C, &S1, &S2);
-
-  assert(n_roots > 0);
-  assert(S2 > 0.0);             // The bigger root should be positive.
+  auto coefficients = freeze_on_coefficients(c, sea_water_salinity,
+                                             sea_water_potential_temperature, thickness);
 
-  *shelf_base_salinity = S2;
+  *shelf_base_salinity = bigger_root_gsl(coefficients);
 }
 
 /** @brief Compute basal salinity in the case of no basal melt and no
@@ -599,34 +751,14 @@ void GivenTH::subshelf_salinity_diffusion_only(const Constants &c,
                                                            double sea_water_potential_temperature,
                                                            double thickness,
                                                            double *shelf_base_salinity) {
-  const double
-    c_pI    = c.ice_specific_heat_capacity,
-    c_pW    = c.sea_water_specific_heat_capacity,
-    L       = c.water_latent_heat_fusion,
-    T_S     = c.shelf_top_surface_temperature,
-    S_W     = sea_water_salinity,
-    Theta_W = sea_water_potential_temperature,
-    h       = thickness,
-    rho_W   = c.sea_water_density,
-    rho_I   = c.ice_density,
-    kappa   = c.ice_thermal_diffusivity;
-
   // We solve a quadratic equation for Sb, the salinity at the shelf
   // base.
   //
   // A*Sb^2 + B*Sb + C = 0
-  const double A = -(c.b[0] * c.gamma_T * h * rho_W * c_pW - c.a[0] * rho_I * c_pI * kappa) / (h * rho_W);
-  const double B = ((rho_I * c_pI * kappa * (T_S - c.a[2] * h - c.a[1])) / (h * rho_W) +
-                    c.gamma_S * L + c.gamma_T * c_pW * (Theta_W - c.b[2] * h - c.b[1]));
-  const double C = -c.gamma_S * S_W * L;
-
-  double S1 = 0.0, S2 = 0.0;
-  const int n_roots = gsl_poly_solve_quadratic(A, B, C, &S1, &S2);
-
-  assert(n_roots > 0);
-  assert(S2 > 0.0);             // The bigger root should be positive.
+  auto coefficients = diffusion_only_coefficients(c, sea_water_salinity,
+                                                  sea_water_potential_temperature, thickness);
 
-  *shelf_base_salinity = S2;
+  *shelf_base_salinity = bigger_root_gsl(coefficients);
 }
 
 } // end of namespace ocean
@@ -19,6 +19,8 @@
 #ifndef _POGIVENTH_H_
 #define _POGIVENTH_H_
 
+#include <vector>
+
 #include "CompleteOceanModel.hh"
 #include "pism/util/iceModelVec2T.hh"
 
@@ -58,6 +60,20 @@ public:
     double ice_thermal_diffusivity;
     bool limit_salinity_range;
   };
+
+  static void pointwise_update(const Constants &constants,
+                               double sea_water_salinity,
+                               double sea_water_potential_temperature,
+                               double ice_thickness,
+                               double *shelf_base_temperature_out,
+                               double *shelf_base_melt_rate_out);
+
+  static void batch_update(const Constants &constants,
+                           const std::vector<double> &sea_water_salinity,
+                           const std::vector<double> &sea_water_potential_temperature,
+                           const std::vector<double> &ice_thickness,
+                           std::vector<double> &shelf_base_temperature,
+                           std::vector<double> &shelf_base_melt_rate);
 private:
   void update_impl(const Geometry &geometry, double t, double dt);
   void init_impl(const Geometry &geometry);
@@ -66,36 +82,29 @@ private:
   IceModelVec2T::Ptr m_theta_ocean;
   IceModelVec2T::Ptr m_salinity_ocean;
 
-  void pointwise_update(const Constants &constants,
-                        double sea_water_salinity,
-                        double sea_water_potential_temperature,
-                        double ice_thickness,
-                        double *shelf_base_temperature_out,
-                        double *shelf_base_melt_rate_out);
-
-  void subshelf_salinity(const Constants &constants,
-                         double sea_water_salinity,
-                         double sea_water_potential_temperature,
-                         double ice_thickness,
-                         double *shelf_base_salinity);
-
-  void subshelf_salinity_melt(const Constants &constants,
-                              double sea_water_salinity,
-                              double sea_water_potential_temperature,
-                              double ice_thickness,
-                              double *shelf_base_salinity);
-
-  void subshelf_salinity_freeze_on(const Constants &constants,
-                                   double sea_water_salinity,
-                                   double sea_water_potential_temperature,
-                                   double ice_thickness,
-                                   double *shelf_base_salinity);
-
-  void subshelf_salinity_diffusion_only(const Constants &constants,
-                                        double sea_water_salinity,
-                                        double sea_water_potential_temperature,
-                                        double ice_thickness,
-                                        double *shelf_base_salinity);
+  static void subshelf_salinity(const Constants &constants,
+                                double sea_water_salinity,
+                                double sea_water_potential_temperature,
+                                double ice_thickness,
+                                double *shelf_base_salinity);
+
+  static void subshelf_salinity_melt(const Constants &constants,
+                                     double sea_water_salinity,
+                                     double sea_water_potential_temperature,
+                                     double ice_thickness,
+                                     double *shelf_base_salinity);
+
+  static void subshelf_salinity_freeze_on(const Constants &constants,
+                                          double sea_water_salinity,
+                                          double sea_water_potential_temperature,
+                                          double ice_thickness,
+                                          double *shelf_base_salinity);
+
+  static void subshelf_salinity_diffusion_only(const Constants &constants,
+                                               double sea_water_salinity,
+                                               double sea_water_potential_temperature,
+                                               double ice_thickness,
+                                               double *shelf_base_salinity);
 };
 
 } // end of namespace ocean
@@ -37,6 +37,7 @@
 #include "pism/util/Mask.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/IceModelVecExpressions.hh"
 #include "pism/util/Time.hh"
 #include "pism/geometry/Geometry.hh"
 
@@ -290,8 +291,7 @@ void Pico::update_impl(const Geometry &geometry, double t, double dt) {
 
   extend_basal_melt_rates(cell_type,m_basal_melt_rate);
 
-  m_shelf_base_mass_flux->copy_from(m_basal_melt_rate);
-  m_shelf_base_mass_flux->scale(physics.ice_density());
+  assign(*m_shelf_base_mass_flux, m_basal_melt_rate * physics.ice_density());
 
   m_melange_back_pressure_fraction->set(m_config->get_number("ocean.melange_back_pressure_fraction"));
 }
@@ -315,14 +315,13 @@ void Pico::compute_ocean_input_per_basin(const PicoPhysics &physics, const IceMo
                                          const IceModelVec2S &salinity_ocean, const IceModelVec2S &theta_ocean,
                                          std::vector<double> &temperature, std::vector<double> &salinity) {
 
-  std::vector<int> count(m_n_basins, 0);
-
-  temperature.resize(m_n_basins);
-  salinity.resize(m_n_basins);
-  for (int basin_id = 0; basin_id < m_n_basins; basin_id++) {
-    temperature[basin_id] = 0.0;
-    salinity[basin_id]    = 0.0;
-  }
+  // local sums: counts, salinity and temperature for each basin (stored together so that
+  // we can compute global sums using one reduction)
+  std::vector<double> sums(3 * m_n_basins, 0.0);
+  double
+    *count     = &sums[0],
+    *S_sum     = &sums[m_n_basins],
+    *theta_sum = &sums[2 * m_n_basins];
 
   IceModelVec::AccessList list{ &theta_ocean, &salinity_ocean, &basin_mask, &continental_shelf_mask };
 
@@ -336,21 +335,25 @@ void Pico::compute_ocean_input_per_basin(const PicoPhysics &physics, const IceMo
       int basin_id = basin_mask.as_int(i, j);
 
       count[basin_id] += 1;
-      salinity[basin_id] += salinity_ocean(i, j);
-      temperature[basin_id] += theta_ocean(i, j);
+      S_sum[basin_id] += salinity_ocean(i, j);
+      theta_sum[basin_id] += theta_ocean(i, j);
     }
   }
 
+  {
+    std::vector<double> local(sums);
+    GlobalSum(m_grid->com, local.data(), sums.data(), sums.size());
+  }
+
+  temperature.resize(m_n_basins);
+  salinity.resize(m_n_basins);
+
   // Divide by number of grid cells if more than zero cells belong to the basin. if no
   // ocean_contshelf_mask values intersect with the basin, count is zero. In such case,
   // use dummy temperature and salinity. This could happen, for example, if the ice shelf
   // front advances beyond the continental shelf break.
   for (int basin_id = 0; basin_id < m_n_basins; basin_id++) {
 
-    count[basin_id]       = GlobalSum(m_grid->com, count[basin_id]);
-    salinity[basin_id]    = GlobalSum(m_grid->com, salinity[basin_id]);
-    temperature[basin_id] = GlobalSum(m_grid->com, temperature[basin_id]);
-
     // if basin is not dummy basin 0 or there are no ocean cells in this basin to take the mean over.
     if (basin_id > 0 && count[basin_id] == 0) {
       m_log->message(2, "PICO ocean WARNING: basin %d contains no cells with ocean data on continental shelf\n"
@@ -365,8 +368,8 @@ void Pico::compute_ocean_input_per_basin(const PicoPhysics &physics, const IceMo
 
     } else {
 
-      salinity[basin_id] /= count[basin_id];
-      temperature[basin_id] /= count[basin_id];
+      salinity[basin_id]    = S_sum[basin_id] / count[basin_id];
+      temperature[basin_id] = theta_sum[basin_id] / count[basin_id];
 
       m_log->message(5, "  %d: temp =%.3f, salinity=%.3f\n", basin_id, temperature[basin_id], salinity[basin_id]);
     }
@@ -388,8 +391,19 @@ void Pico::set_ocean_input_fields(const PicoPhysics &physics, const IceModelVec2
 
   IceModelVec::AccessList list{ &ice_thickness, &basin_mask, &Soc_box0, &Toc_box0, &mask, &shelf_mask };
 
-  std::vector<std::vector<int> > n_shelf_cells_per_basin(m_n_shelves, std::vector<int>(m_n_basins, 0));
-  std::vector<int> n_shelf_cells(m_n_shelves, 0);
+  // Counts are stored in one array so that we can compute global sums using one
+  // reduction: element s * (m_n_basins + 1) + b is the number of cells in the
+  // intersection of shelf s and basin b (b < m_n_basins), the last element for each shelf
+  // is the number of cells in this shelf.
+  const int stride = m_n_basins + 1;
+  std::vector<double> counts(m_n_shelves * stride, 0.0);
+
+  auto n_shelf_cells_per_basin = [&counts, stride](int s, int b) {
+    return counts[s * stride + b];
+  };
+  auto n_shelf_cells = [&counts, stride, this](int s) {
+    return counts[s * stride + m_n_basins];
+  };
 
   // 1) count the number of cells in each shelf
   // 2) count the number of cells in the intersection of each shelf with all the basins
@@ -398,16 +412,12 @@ void Pico::set_ocean_input_fields(const PicoPhysics &physics, const IceModelVec2
       const int i = p.i(), j = p.j();
       int s = shelf_mask.as_int(i, j);
       int b = basin_mask.as_int(i, j);
-      n_shelf_cells_per_basin[s][b]++;
-      n_shelf_cells[s]++;
+      counts[s * stride + b] += 1;
+      counts[s * stride + m_n_basins] += 1;
     }
 
-    for (int s = 0; s < m_n_shelves; s++) {
-      n_shelf_cells[s] = GlobalSum(m_grid->com, n_shelf_cells[s]);
-      for (int b = 0; b < m_n_basins; b++) {
-        n_shelf_cells_per_basin[s][b] = GlobalSum(m_grid->com, n_shelf_cells_per_basin[s][b]);
-      }
-    }
+    std::vector<double> local(counts);
+    GlobalSum(m_grid->com, local.data(), counts.data(), counts.size());
   }
 
   // now set potential temperature and salinity box 0:
@@ -427,8 +437,8 @@ void Pico::set_ocean_input_fields(const PicoPhysics &physics, const IceModelVec2
 
       // weighted input depending on the number of shelf cells in each basin
       for (int b = 1; b < m_n_basins; b++) { //Note: b=0 yields nan
-        Toc_box0(i, j) += basin_temperature[b] * n_shelf_cells_per_basin[s][b] / (double)n_shelf_cells[s];
-        Soc_box0(i, j) += basin_salinity[b] * n_shelf_cells_per_basin[s][b] / (double)n_shelf_cells[s];
+        Toc_box0(i, j) += basin_temperature[b] * n_shelf_cells_per_basin(s, b) / n_shelf_cells(s);
+        Soc_box0(i, j) += basin_salinity[b] * n_shelf_cells_per_basin(s, b) / n_shelf_cells(s);
       }
 
       double theta_pm = physics.theta_pm(Soc_box0(i, j), physics.pressure(ice_thickness(i, j)));
@@ -582,9 +592,7 @@ void Pico::process_other_boxes(const PicoPhysics &physics,
   std::vector<double> overturning(m_n_shelves, 0.0);
   std::vector<double> salinity(m_n_shelves, 0.0);
   std::vector<double> temperature(m_n_shelves, 0.0);
-
-  // get average overturning from box 1 that is used as input later
-  compute_box_average(1, m_overturning, shelf_mask, box_mask, overturning);
+  std::vector<std::vector<double> > averages;
 
   std::vector<bool> use_beckmann_goosse(m_n_shelves);
 
@@ -594,8 +602,15 @@ void Pico::process_other_boxes(const PicoPhysics &physics,
   // Iterate over all boxes i for i > 1
   for (int box = 2; box <= m_n_boxes; ++box) {
 
-    compute_box_average(box - 1, Toc, shelf_mask, box_mask, temperature);
-    compute_box_average(box - 1, Soc, shelf_mask, box_mask, salinity);
+    if (box == 2) {
+      // also get average overturning from box 1 that is used as input for all boxes
+      compute_box_average(1, {&Toc, &Soc, &m_overturning}, shelf_mask, box_mask, averages);
+      overturning = averages[2];
+    } else {
+      compute_box_average(box - 1, {&Toc, &Soc}, shelf_mask, box_mask, averages);
+    }
+    temperature = averages[0];
+    salinity    = averages[1];
 
     // find all the shelves where we should fall back to the Beckmann-Goosse
     // parameterization
@@ -722,46 +737,63 @@ DiagnosticList Pico::diagnostics_impl() const {
 }
 
 /*!
- * For each shelf, compute average of a given field over the box with id `box_id`.
+ * For each shelf, compute averages of given fields over the box with id `box_id`.
+ *
+ * `result[k][s]` is the average of `fields[k]` over the box `box_id` of the shelf `s`.
+ *
+ * Uses one reduction for all fields and shelves.
  *
  * This method is used to get inputs from a previous box for the next one.
  */
 void Pico::compute_box_average(int box_id,
-                               const IceModelVec2S &field,
+                               const std::vector<const IceModelVec2S*> &fields,
                                const IceModelVec2Int &shelf_mask,
                                const IceModelVec2Int &box_mask,
-                               std::vector<double> &result) {
+                               std::vector<std::vector<double> > &result) {
 
-  IceModelVec::AccessList list{ &field, &shelf_mask, &box_mask };
+  const int N = fields.size();
 
-  std::vector<int> n_cells_per_box(m_n_shelves, 0);
-
-  // fill results with zeros
-  result.resize(m_n_shelves);
-  for (int s = 0; s < m_n_shelves; ++s) {
-    result[s] = 0.0;
+  IceModelVec::AccessList list{ &shelf_mask, &box_mask };
+  for (const auto *f : fields) {
+    list.add(*f);
   }
 
-  // compute the sum of field in each shelf's box box_id
+  // element s is the number of cells in each shelf's box box_id, element (k + 1) *
+  // m_n_shelves + s is the sum of fields[k] over this box
+  std::vector<double> sums((N + 1) * m_n_shelves, 0.0);
+
+  // compute the sum of fields in each shelf's box box_id
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
     int shelf_id = shelf_mask.as_int(i, j);
 
     if (box_mask.as_int(i, j) == box_id) {
-      n_cells_per_box[shelf_id] += 1;
-      result[shelf_id] += field(i, j);
+      sums[shelf_id] += 1;
+      for (int k = 0; k < N; ++k) {
+        sums[(k + 1) * m_n_shelves + shelf_id] += (*fields[k])(i, j);
+      }
     }
   }
 
   // compute the global sum and average
-  for (int s = 0; s < m_n_shelves; ++s) {
-    auto n_cells = GlobalSum(m_grid->com, n_cells_per_box[s]);
+  {
+    std::vector<double> local(sums);
+    GlobalSum(m_grid->com, local.data(), sums.data(), sums.size());
+  }
+
+  result.resize(N);
+  for (int k = 0; k < N; ++k) {
+    result[k].resize(m_n_shelves);
 
-    result[s] = GlobalSum(m_grid->com, result[s]);
+    for (int s = 0; s < m_n_shelves; ++s) {
+      const double n_cells = sums[s];
 
-    if (n_cells > 0) {
-      result[s] /= (double)n_cells;
+      result[k][s] = sums[(k + 1) * m_n_shelves + s];
+
+      if (n_cells > 0) {
+        result[k][s] /= n_cells;
+      }
     }
   }
 }
@@ -784,20 +816,20 @@ void Pico::compute_box_area(int box_id,
 
   auto cell_area = m_grid->cell_area();
 
+  std::vector<double> area(m_n_shelves, 0.0);
+
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
     int shelf_id = shelf_mask.as_int(i, j);
 
     if (shelf_id > 0 and box_mask.as_int(i, j) == box_id) {
-      result[shelf_id] += cell_area;
+      area[shelf_id] += cell_area;
     }
   }
 
   // compute global sums
-  for (int s = 1; s < m_n_shelves; ++s) {
-    result[s] = GlobalSum(m_grid->com, result[s]);
-  }
+  GlobalSum(m_grid->com, area.data(), result.data(), m_n_shelves);
 }
 
 } // end of namespace ocean
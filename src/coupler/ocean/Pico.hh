@@ -118,10 +118,10 @@ private:
                        IceModelVec2S &Soc);
 
   void compute_box_average(int box_id,
-                           const IceModelVec2S &field,
+                           const std::vector<const IceModelVec2S*> &fields,
                            const IceModelVec2Int &shelf_mask,
                            const IceModelVec2Int &box_mask,
-                           std::vector<double> &result);
+                           std::vector<std::vector<double> > &result);
 
   void compute_box_area(int box_id,
                         const IceModelVec2Int &shelf_mask,
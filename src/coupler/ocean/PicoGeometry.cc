@@ -20,7 +20,7 @@
 #include <algorithm> // max_element
 
 #include "PicoGeometry.hh"
-#include "pism/util/connected_components.hh"
+#include "pism/util/label_components.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/util/pism_utilities.hh"
 
@@ -45,8 +45,6 @@ PicoGeometry::PicoGeometry(IceGrid::ConstPtr grid)
                                      {OCEAN, RISE, CONTINENTAL, FLOATING});
   m_ice_rises.metadata().set_string("flag_meanings",
                                      "ocean ice_rise continental_ice_sheet, floating_ice");
-
-  m_tmp_p0 = m_tmp.allocate_proc0_copy();
 }
 
 PicoGeometry::~PicoGeometry() {
@@ -115,7 +113,7 @@ void PicoGeometry::update(const IceModelVec2S &bed_elevation, const IceModelVec2
 enum RelabelingType {BY_AREA, AREA_THRESHOLD};
 
 /*!
- * Re-label components in a mask processed by label_connected_components.
+ * Re-label components in a mask processed by label_components.
  *
  * If type is `BY_AREA`, the biggest one gets the value of 2, all the other ones 1, the
  * background is set to zero.
@@ -207,23 +205,10 @@ static void relabel(RelabelingType type,
 }
 
 /*!
- * Run the serial connected-component labeling algorithm on m_tmp.
+ * Run the connected-component labeling algorithm on m_tmp.
  */
 void PicoGeometry::label_tmp() {
-  m_tmp.put_on_proc0(*m_tmp_p0);
-
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) {
-      petsc::VecArray mask_p0(*m_tmp_p0);
-      label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), false, 0.0);
-    }
-  } catch (...) {
-    rank0.failed();
-  }
-  rank0.check();
-
-  m_tmp.get_from_proc0(*m_tmp_p0);
+  label_components(m_tmp, false, 0.0);
 }
 
 static bool edge_p(int i, int j, int Mx, int My) {
@@ -264,22 +249,7 @@ void PicoGeometry::compute_lakes(const IceModelVec2CellType &cell_type, IceModel
   }
 
   // identify "floating" areas that are not connected to the open ocean as defined above
-  {
-    m_tmp.put_on_proc0(*m_tmp_p0);
-
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_tmp_p0);
-        label_connected_components(mask_p0.get(), My, Mx, true, 2.0);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
-
-    m_tmp.get_from_proc0(*m_tmp_p0);
-  }
+  label_components(m_tmp, true, 2.0);
 
   result.copy_from(m_tmp);
 }
@@ -360,22 +330,7 @@ void PicoGeometry::compute_continental_shelf_mask(const IceModelVec2S &bed_eleva
 
   // use "iceberg identification" to label parts *not* connected to the continental ice
   // sheet
-  {
-    m_tmp.put_on_proc0(*m_tmp_p0);
-
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_tmp_p0);
-        label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), true, 2.0);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
-
-    m_tmp.get_from_proc0(*m_tmp_p0);
-  }
+  label_components(m_tmp, true, 2.0);
 
   // At this point areas with bed > threshold are 1, everything else is zero.
   //
@@ -572,9 +527,16 @@ void PicoGeometry::compute_distances_cf(const IceModelVec2Int &ocean_mask,
  * generic ice shelf locations with zeros, set neighbors of the grounding line to 1, and
  * the rest of the grid with -1 or some other negative number.
  *
- * Note that this implementation updates ghosts *every* iteration. We could speed this
- * up by checking if a point at a boundary of the processor sub-domain was updated and
- * update ghosts in those cases only.
+ * The result is the distance (in cells, plus one) along paths that connect four-point
+ * neighbors within the domain. Locations that cannot be reached from the wave front keep
+ * the value of zero.
+ *
+ * Each rank computes distances in its sub-domain by alternating forward and backward
+ * sweeps until labels stop changing, using ghost values as additional sources. Then
+ * ghosts are updated and this is repeated until no label at the boundary of any
+ * sub-domain changes. The number of ghost updates and global reductions is one plus the
+ * number of times shortest paths cross sub-domain boundaries instead of the maximum
+ * distance in cells.
  */
 void eikonal_equation(IceModelVec2Int &mask) {
 
@@ -582,34 +544,75 @@ void eikonal_equation(IceModelVec2Int &mask) {
 
   IceGrid::ConstPtr grid = mask.grid();
 
-  double current_label = 1;
-  double continue_loop = 1;
-  while (continue_loop != 0) {
+  const int
+    xs = grid->xs(),
+    xe = grid->xs() + grid->xm(),
+    ys = grid->ys(),
+    ye = grid->ys() + grid->ym();
 
-    continue_loop = 0;
+  IceModelVec::AccessList list{&mask};
 
-    for (Points p(*grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  // Update the label at (i, j) using labels of its neighbors. Returns true if the label
+  // changed.
+  auto relax = [&mask](int i, int j) {
+    auto R = mask.int_star(i, j);
 
-      if (mask.as_int(i, j) == 0) {
+    if (R.ij < 0) {
+      // outside the domain
+      return false;
+    }
+
+    int label = R.ij;
+    for (int n : {R.n, R.e, R.s, R.w}) {
+      if (n > 0 and (label == 0 or n + 1 < label)) {
+        label = n + 1;
+      }
+    }
 
-        auto R = mask.int_star(i, j);
+    if (label != R.ij) {
+      mask(i, j) = label;
+      return true;
+    }
+    return false;
+  };
+
+  double boundary_changed = 1;
+  while (boundary_changed != 0) {
+
+    boundary_changed = 0;
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+
+      // forward sweep
+      for (int j = ys; j < ye; ++j) {
+        for (int i = xs; i < xe; ++i) {
+          if (relax(i, j)) {
+            changed = true;
+            if (i == xs or i == xe - 1 or j == ys or j == ye - 1) {
+              boundary_changed = 1;
+            }
+          }
+        }
+      }
 
-        if (R.ij == 0 and
-            (R.n == current_label or R.s == current_label or
-             R.e == current_label or R.w == current_label)) {
-          // i.e. this is an shelf cell with no distance assigned yet and with a neighbor
-          // that has a distance assigned
-          mask(i, j) = current_label + 1;
-          continue_loop = 1;
+      // backward sweep
+      for (int j = ye - 1; j >= ys; --j) {
+        for (int i = xe - 1; i >= xs; --i) {
+          if (relax(i, j)) {
+            changed = true;
+            if (i == xs or i == xe - 1 or j == ys or j == ye - 1) {
+              boundary_changed = 1;
+            }
+          }
         }
       }
-    } // loop over grid points
+    }
 
-    current_label++;
     mask.update_ghosts();
 
-    continue_loop = GlobalMax(grid->com, continue_loop);
+    boundary_changed = GlobalMax(grid->com, boundary_changed);
   }
 }
 
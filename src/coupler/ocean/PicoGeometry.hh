@@ -82,7 +82,6 @@ private:
 
   // temporary storage
   IceModelVec2Int m_tmp;
-  petsc::Vec::Ptr m_tmp_p0;
 };
 
 } // end of namespace ocean
@@ -69,9 +69,9 @@ void SeaLevel::update(const Geometry &geometry, double t, double dt) {
 void SeaLevel::update_impl(const Geometry &geometry, double t, double dt) {
   if (m_input_model) {
     m_input_model->update(geometry, t, dt);
-  } else {
-    m_sea_level.set(0.0);
   }
+  // otherwise sea level is constant (set in init_impl()); leaving it alone keeps its state
+  // counter unchanged
 }
 
 const IceModelVec2S& SeaLevel::elevation() const {
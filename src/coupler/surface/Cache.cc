@@ -17,30 +17,13 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <cassert>
-#include <algorithm>            // for std::min
-
 #include "Cache.hh"
-#include "pism/util/Time.hh"
-#include "pism/util/pism_options.hh"
-#include "pism/util/IceGrid.hh"
-#include "pism/util/error_handling.hh"
-#include "pism/util/pism_utilities.hh"
-#include "pism/util/MaxTimestep.hh"
 
 namespace pism {
 namespace surface {
 
 Cache::Cache(IceGrid::ConstPtr grid, std::shared_ptr<SurfaceModel> in)
-  : SurfaceModel(grid, in) {
-
-  m_next_update_time = m_grid->ctx()->time()->current();
-  m_update_interval_years = m_config->get_number("surface.cache.update_interval", "years");
-
-  if (m_update_interval_years <= 0) {
-    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                  "surface.cache.update_interval has to be strictly positive.");
-  }
+  : CachingModifier<SurfaceModel>(grid, in, "surface") {
 
   {
     m_mass_flux             = allocate_mass_flux(grid);
@@ -58,67 +41,15 @@ Cache::~Cache() {
   // empty
 }
 
-void Cache::init_impl(const Geometry &geometry) {
-  m_input_model->init(geometry);
-
-  m_log->message(2, "* Initializing the 'caching' surface model modifier...\n");
-
-  m_next_update_time = m_grid->ctx()->time()->current();
-}
-
-void Cache::update_impl(const Geometry &geometry, double t, double dt) {
-  // ignore dt and always use 1 year long time-steps when updating
-  // the input model
-  (void) dt;
-
-  if (t >= m_next_update_time or fabs(t - m_next_update_time) < 1.0) {
-
-    double
-      one_year_from_now = m_grid->ctx()->time()->increment_date(t, 1.0),
-      update_dt         = one_year_from_now - t;
-
-    assert(update_dt > 0.0);
-
-    m_input_model->update(geometry, t, update_dt);
-
-    m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
-                                                               m_update_interval_years);
-
-    // store outputs of the input model
-    m_mass_flux->copy_from(m_input_model->mass_flux());
-    m_temperature->copy_from(m_input_model->temperature());
-    m_liquid_water_fraction->copy_from(m_input_model->liquid_water_fraction());
-    m_layer_mass->copy_from(m_input_model->layer_mass());
-    m_layer_thickness->copy_from(m_input_model->layer_thickness());
-    m_accumulation->copy_from(m_input_model->accumulation());
-    m_melt->copy_from(m_input_model->melt());
-    m_runoff->copy_from(m_input_model->runoff());
-  }
-}
-
-MaxTimestep Cache::max_timestep_impl(double t) const {
-  double dt = m_next_update_time - t;
-
-  // if we got very close to the next update time, set time step
-  // length to the interval between updates
-  if (dt < 1.0) {
-    double update_time_after_next = m_grid->ctx()->time()->increment_date(m_next_update_time,
-                                                                          m_update_interval_years);
-
-    dt = update_time_after_next - m_next_update_time;
-    assert(dt > 0.0);
-  }
-
-  assert(m_input_model != NULL);
-
-  MaxTimestep cache_dt(dt, "surface cache");
-
-  MaxTimestep input_max_timestep = m_input_model->max_timestep(t);
-  if (input_max_timestep.finite()) {
-    return std::min(input_max_timestep, cache_dt);
-  } else {
-    return cache_dt;
-  }
+void Cache::copy_outputs() {
+  m_mass_flux->copy_from(m_input_model->mass_flux());
+  m_temperature->copy_from(m_input_model->temperature());
+  m_liquid_water_fraction->copy_from(m_input_model->liquid_water_fraction());
+  m_layer_mass->copy_from(m_input_model->layer_mass());
+  m_layer_thickness->copy_from(m_input_model->layer_thickness());
+  m_accumulation->copy_from(m_input_model->accumulation());
+  m_melt->copy_from(m_input_model->melt());
+  m_runoff->copy_from(m_input_model->runoff());
 }
 
 const IceModelVec2S &Cache::layer_thickness_impl() const {
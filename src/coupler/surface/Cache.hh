@@ -21,17 +21,17 @@
 #define _PSCACHE_H_
 
 #include "pism/coupler/SurfaceModel.hh"
+#include "pism/coupler/util/CachingModifier.hh"
 
 namespace pism {
 namespace surface {
 
-class Cache : public SurfaceModel {
+class Cache : public CachingModifier<SurfaceModel> {
 public:
   Cache(IceGrid::ConstPtr g, std::shared_ptr<SurfaceModel> in);
   virtual ~Cache();
 protected:
-  void init_impl(const Geometry &geometry);
-  void update_impl(const Geometry &geometry, double t, double dt);
+  void copy_outputs();
 
   const IceModelVec2S &layer_mass_impl() const;
   const IceModelVec2S &liquid_water_fraction_impl() const;
@@ -42,15 +42,10 @@ protected:
   virtual const IceModelVec2S& accumulation_impl() const;
   virtual const IceModelVec2S& melt_impl() const;
   virtual const IceModelVec2S& runoff_impl() const;
-
-  MaxTimestep max_timestep_impl(double t) const;
 protected:
   // storage for the rest of the fields is inherited from SurfaceModel
   IceModelVec2S::Ptr m_mass_flux;
   IceModelVec2S::Ptr m_temperature;
-
-  double m_next_update_time;
-  unsigned int m_update_interval_years;
 };
 
 } // end of namespace surface
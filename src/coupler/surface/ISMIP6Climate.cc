@@ -30,7 +30,13 @@ ISMIP6::ISMIP6(IceGrid::ConstPtr grid, std::shared_ptr<atmosphere::AtmosphereMod
   : SurfaceModel(grid),
     m_mass_flux_reference(m_grid, "climatic_mass_balance", WITHOUT_GHOSTS),
     m_temperature_reference(m_grid, "ice_surface_temp", WITHOUT_GHOSTS),
-    m_surface_reference(m_grid, "usurf", WITHOUT_GHOSTS)
+    m_surface_reference(m_grid, "usurf", WITHOUT_GHOSTS),
+    m_mass_flux_base(m_grid, "climatic_mass_balance_base", WITHOUT_GHOSTS),
+    m_temperature_base(m_grid, "ice_surface_temp_base", WITHOUT_GHOSTS),
+    m_mass_flux_anomaly_record(-1),
+    m_temperature_anomaly_record(-1),
+    m_mass_flux_gradient_record(-1),
+    m_temperature_gradient_record(-1)
 {
   (void) input;
 
@@ -164,6 +170,27 @@ void ISMIP6::init_impl(const Geometry &geometry) {
     m_temperature_anomaly->init(opt.filename, opt.period, opt.reference_time);
     m_temperature_gradient->init(opt.filename, opt.period, opt.reference_time);
   }
+
+  m_mass_flux_anomaly_record    = -1;
+  m_temperature_anomaly_record  = -1;
+  m_mass_flux_gradient_record   = -1;
+  m_temperature_gradient_record = -1;
+}
+
+//! Update the time-dependent input `field` unless it is given by the same record
+//! `record` as during the previous time step. Returns true if `field` was updated.
+static bool update_forcing(IceModelVec2T &field, double t, double dt, int &record) {
+  int current = field.constant_record(t, dt);
+
+  if (current >= 0 and current == record) {
+    return false;
+  }
+
+  field.update(t, dt);
+  field.average(t, dt);
+  record = current;
+
+  return true;
 }
 
 void ISMIP6::update_impl(const Geometry &geometry, double t, double dt) {
@@ -184,30 +211,45 @@ void ISMIP6::update_impl(const Geometry &geometry, double t, double dt) {
   IceModelVec2S &SMB = *m_mass_flux;
 
   // get time-dependent input fields at the current time
+  //
+  // Forcing records usually cover a month or a year, i.e. many time steps. Reference
+  // fields plus anomalies are re-computed only when anomalies change.
+  bool anomalies_changed = false;
   {
-    aT.update(t, dt);
-    aSMB.update(t, dt);
-    dTdz.update(t, dt);
-    dSMBdz.update(t, dt);
-
-    aT.average(t, dt);
-    aSMB.average(t, dt);
-    dTdz.average(t, dt);
-    dSMBdz.average(t, dt);
+    anomalies_changed |= update_forcing(aT, t, dt, m_temperature_anomaly_record);
+    anomalies_changed |= update_forcing(aSMB, t, dt, m_mass_flux_anomaly_record);
+
+    update_forcing(dTdz, t, dt, m_temperature_gradient_record);
+    update_forcing(dSMBdz, t, dt, m_mass_flux_gradient_record);
   }
 
   // From http://www.climate-cryosphere.org/wiki/index.php?title=ISMIP6-Projections-Greenland:
   // SMB(x,y,t) = SMB_ref(x,y) + aSMB(x,y,t) + dSMBdz(x,y,t) * [h(x,y,t) - h_ref(x,y)]
 
+  IceModelVec2S &SMB_base = m_mass_flux_base;
+  IceModelVec2S &T_base   = m_temperature_base;
+
+  if (anomalies_changed) {
+    IceModelVec::AccessList list{&SMB_base, &SMB_ref, &aSMB,
+                                 &T_base, &T_ref, &aT};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      SMB_base(i, j) = SMB_ref(i, j) + aSMB(i, j);
+      T_base(i, j)   = T_ref(i, j) + aT(i, j);
+    }
+  }
+
   IceModelVec::AccessList list{&h, &h_ref,
-                               &SMB, &SMB_ref, &aSMB, &dSMBdz,
-                               &T, &T_ref, &aT, &dTdz};
+                               &SMB, &SMB_base, &dSMBdz,
+                               &T, &T_base, &dTdz};
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    SMB(i, j) = SMB_ref(i, j) + aSMB(i, j) + dSMBdz(i, j) * (h(i, j) - h_ref(i, j));
-    T(i, j)   = T_ref(i, j) + aT(i, j) + dTdz(i, j) * (h(i, j) - h_ref(i, j));
+    SMB(i, j) = SMB_base(i, j) + dSMBdz(i, j) * (h(i, j) - h_ref(i, j));
+    T(i, j)   = T_base(i, j) + dTdz(i, j) * (h(i, j) - h_ref(i, j));
   }
 
   dummy_accumulation(SMB, *m_accumulation);
@@ -52,6 +52,17 @@ protected:
   IceModelVec2S m_temperature_reference;
   IceModelVec2S m_surface_reference;
 
+  // reference fields plus anomalies; re-computed only when anomaly records change
+  IceModelVec2S m_mass_flux_base;
+  IceModelVec2S m_temperature_base;
+
+  //! in-file indexes of the records used to compute time-dependent inputs at the last
+  //! update (-1 if not constant over the last time step, see IceModelVec2T::constant_record())
+  int m_mass_flux_anomaly_record;
+  int m_temperature_anomaly_record;
+  int m_mass_flux_gradient_record;
+  int m_temperature_gradient_record;
+
   // outputs; stored as shared_ptr to be able to use SurfaceModel::allocate_xxx()
   IceModelVec2S::Ptr m_mass_flux;
   IceModelVec2S::Ptr m_temperature;
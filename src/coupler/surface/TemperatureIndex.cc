@@ -295,156 +295,173 @@ void TemperatureIndex::update_impl(const Geometry &geometry, double t, double dt
 
   const double ice_density = m_config->get_number("constants.ice.density");
 
+  const int
+    xs = m_grid->xs(),
+    xm = m_grid->xm(),
+    ys = m_grid->ys(),
+    ym = m_grid->ym();
+
+  // temperature and precipitation time series at all points in a grid row (the value at
+  // time k and the point i is stored at k * xm + (i - xs))
+  std::vector<double> T_row(N * xm), P_row(N * xm);
+
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      // the temperature time series from the AtmosphereModel and its modifiers
-      m_atmosphere->temp_time_series(i, j, T);
+    for (int j = ys; j < ys + ym; ++j) {
+      // time series from the AtmosphereModel and its modifiers
+      m_atmosphere->temp_time_series_batch(xs, j, xm, T_row.data());
+      m_atmosphere->precip_time_series_batch(xs, j, xm, P_row.data());
 
-      if (mask.ice_free_ocean(i, j)) {
-        // ignore precipitation over ice-free ocean
+      for (int i = xs; i < xs + xm; ++i) {
         for (int k = 0; k < N; ++k) {
-          P[k] = 0.0;
+          T[k] = T_row[k * xm + (i - xs)];
         }
-      } else {
-        // elsewhere, get precipitation from the atmosphere model
-        m_atmosphere->precip_time_series(i, j, P);
-      }
 
-      // convert precipitation from "kg m-2 second-1" to "m second-1" (PDDMassBalance expects
-      // accumulation in m/second ice equivalent)
-      for (int k = 0; k < N; ++k) {
-        P[k] = P[k] / ice_density;
-        // kg / (m^2 * second) / (kg / m^3) = m / second
-      }
+        if (mask.ice_free_ocean(i, j)) {
+          // ignore precipitation over ice-free ocean
+          for (int k = 0; k < N; ++k) {
+            P[k] = 0.0;
+          }
+        } else {
+          // elsewhere, use precipitation from the atmosphere model
+          for (int k = 0; k < N; ++k) {
+            P[k] = P_row[k * xm + (i - xs)];
+          }
+        }
 
-      // interpolate temperature standard deviation time series
-      if (m_sd_file_set) {
-        m_air_temp_sd->interp(i, j, S);
-      } else {
-        double tmp = (*m_air_temp_sd)(i, j);
+        // convert precipitation from "kg m-2 second-1" to "m second-1" (PDDMassBalance expects
+        // accumulation in m/second ice equivalent)
         for (int k = 0; k < N; ++k) {
-          S[k] = tmp;
+          P[k] = P[k] / ice_density;
+          // kg / (m^2 * second) / (kg / m^3) = m / second
         }
-      }
 
-      if (fausto_greve) {
-        // we have been asked to set mass balance parameters according to
-        //   formula (6) in [\ref Faustoetal2009]; they overwrite ddf set above
-        ddf = fausto_greve->degree_day_factors(i, j, (*latitude)(i, j));
-      }
+        // interpolate temperature standard deviation time series
+        if (m_sd_file_set) {
+          m_air_temp_sd->interp(i, j, S);
+        } else {
+          double tmp = (*m_air_temp_sd)(i, j);
+          for (int k = 0; k < N; ++k) {
+            S[k] = tmp;
+          }
+        }
 
-      // apply standard deviation lapse rate on top of prescribed values
-      if (sigmalapserate != 0.0) {
-        double lat = (*latitude)(i, j);
-        for (int k = 0; k < N; ++k) {
-          S[k] += sigmalapserate * (lat - sigmabaselat);
+        if (fausto_greve) {
+          // we have been asked to set mass balance parameters according to
+          //   formula (6) in [\ref Faustoetal2009]; they overwrite ddf set above
+          ddf = fausto_greve->degree_day_factors(i, j, (*latitude)(i, j));
         }
-        (*m_air_temp_sd)(i, j) = S[0]; // ensure correct SD reporting
-      }
 
-      // apply standard deviation param over ice if in use
-      if (m_sd_use_param and mask.icy(i, j)) {
-        for (int k = 0; k < N; ++k) {
-          S[k] = m_sd_param_a * (T[k] - 273.15) + m_sd_param_b;
-          if (S[k] < 0.0) {
-            S[k] = 0.0 ;
+        // apply standard deviation lapse rate on top of prescribed values
+        if (sigmalapserate != 0.0) {
+          double lat = (*latitude)(i, j);
+          for (int k = 0; k < N; ++k) {
+            S[k] += sigmalapserate * (lat - sigmabaselat);
           }
+          (*m_air_temp_sd)(i, j) = S[0]; // ensure correct SD reporting
         }
-        (*m_air_temp_sd)(i, j) = S[0]; // ensure correct SD reporting
-      }
 
-      // Use temperature time series, the "positive" threshhold, and
-      // the standard deviation of the daily variability to get the
-      // number of positive degree days (PDDs)
-      if (mask.ice_free_ocean(i, j)) {
-        for (int k = 0; k < N; ++k) {
-          PDDs[k] = 0.0;
+        // apply standard deviation param over ice if in use
+        if (m_sd_use_param and mask.icy(i, j)) {
+          for (int k = 0; k < N; ++k) {
+            S[k] = m_sd_param_a * (T[k] - 273.15) + m_sd_param_b;
+            if (S[k] < 0.0) {
+              S[k] = 0.0 ;
+            }
+          }
+          (*m_air_temp_sd)(i, j) = S[0]; // ensure correct SD reporting
         }
-      } else {
-        m_mbscheme->get_PDDs(dtseries, S, T, // inputs
-                             PDDs);          // output
-      }
 
-      // Use temperature time series to remove rainfall from precipitation
-      m_mbscheme->get_snow_accumulation(T,  // air temperature (input)
-                                        P); // precipitation rate (input-output)
-
-      // Use degree-day factors, the number of PDDs, and the snow precipitation to get surface mass
-      // balance (and diagnostics: accumulation, melt, runoff)
-      {
-        double next_snow_depth_reset = m_next_balance_year_start;
-
-        // make copies of firn and snow depth values at this point to avoid accessing 2D
-        // fields in the inner loop
-        double
-          ice  = H(i, j),
-          firn = m_firn_depth(i, j),
-          snow = m_snow_depth(i, j);
-
-        // accumulation, melt, runoff over this time-step
-        double
-          A   = 0.0,
-          M   = 0.0,
-          R   = 0.0,
-          SMB = 0.0;
+        // Use temperature time series, the "positive" threshhold, and
+        // the standard deviation of the daily variability to get the
+        // number of positive degree days (PDDs)
+        if (mask.ice_free_ocean(i, j)) {
+          for (int k = 0; k < N; ++k) {
+            PDDs[k] = 0.0;
+          }
+        } else {
+          m_mbscheme->get_PDDs(i, j, t, dtseries, S, T, // inputs
+                               PDDs);                   // output
+        }
 
-        for (int k = 0; k < N; ++k) {
-          if (ts[k] >= next_snow_depth_reset) {
-            snow = 0.0;
-            while (next_snow_depth_reset <= ts[k]) {
-              next_snow_depth_reset = m_grid->ctx()->time()->increment_date(next_snow_depth_reset, 1);
+        // Use temperature time series to remove rainfall from precipitation
+        m_mbscheme->get_snow_accumulation(T,  // air temperature (input)
+                                          P); // precipitation rate (input-output)
+
+        // Use degree-day factors, the number of PDDs, and the snow precipitation to get surface mass
+        // balance (and diagnostics: accumulation, melt, runoff)
+        {
+          double next_snow_depth_reset = m_next_balance_year_start;
+
+          // make copies of firn and snow depth values at this point to avoid accessing 2D
+          // fields in the inner loop
+          double
+            ice  = H(i, j),
+            firn = m_firn_depth(i, j),
+            snow = m_snow_depth(i, j);
+
+          // accumulation, melt, runoff over this time-step
+          double
+            A   = 0.0,
+            M   = 0.0,
+            R   = 0.0,
+            SMB = 0.0;
+
+          for (int k = 0; k < N; ++k) {
+            if (ts[k] >= next_snow_depth_reset) {
+              snow = 0.0;
+              while (next_snow_depth_reset <= ts[k]) {
+                next_snow_depth_reset = m_grid->ctx()->time()->increment_date(next_snow_depth_reset, 1);
+              }
             }
-          }
 
-          const double accumulation = P[k] * dtseries;
+            const double accumulation = P[k] * dtseries;
 
-          LocalMassBalance::Changes changes;
-          changes = m_mbscheme->step(ddf, PDDs[k],
-                                     ice, firn, snow, accumulation);
+            LocalMassBalance::Changes changes;
+            changes = m_mbscheme->step(ddf, PDDs[k],
+                                       ice, firn, snow, accumulation);
 
-          // update ice thickness
-          ice += changes.smb;
-          assert(ice >= 0);
+            // update ice thickness
+            ice += changes.smb;
+            assert(ice >= 0);
 
-          // update firn depth
-          firn += changes.firn_depth;
-          assert(firn >= 0);
+            // update firn depth
+            firn += changes.firn_depth;
+            assert(firn >= 0);
 
-          // update snow depth
-          snow += changes.snow_depth;
-          assert(snow >= 0);
+            // update snow depth
+            snow += changes.snow_depth;
+            assert(snow >= 0);
 
-          // update total accumulation, melt, and runoff
-          {
-            A   += accumulation;
-            M   += changes.melt;
-            R   += changes.runoff;
-            SMB += changes.smb;
-          }
-        } // end of the time-stepping loop
+            // update total accumulation, melt, and runoff
+            {
+              A   += accumulation;
+              M   += changes.melt;
+              R   += changes.runoff;
+              SMB += changes.smb;
+            }
+          } // end of the time-stepping loop
 
-        // set firn and snow depths
-        m_firn_depth(i, j) = firn;
-        m_snow_depth(i, j) = snow;
+          // set firn and snow depths
+          m_firn_depth(i, j) = firn;
+          m_snow_depth(i, j) = snow;
 
-        // set total accumulation, melt, and runoff, and SMB at this point, converting
-        // from "meters, ice equivalent" to "kg / m^2"
-        {
-          (*m_accumulation)(i, j)          = A * ice_density;
-          (*m_melt)(i, j)                  = M * ice_density;
-          (*m_runoff)(i, j)                = R * ice_density;
-          // m_mass_flux (unlike m_accumulation, m_melt, and m_runoff), is a
-          // rate. m * (kg / m^3) / second = kg / m^2 / second
-          m_mass_flux(i, j) = SMB * ice_density / dt;
+          // set total accumulation, melt, and runoff, and SMB at this point, converting
+          // from "meters, ice equivalent" to "kg / m^2"
+          {
+            (*m_accumulation)(i, j)          = A * ice_density;
+            (*m_melt)(i, j)                  = M * ice_density;
+            (*m_runoff)(i, j)                = R * ice_density;
+            // m_mass_flux (unlike m_accumulation, m_melt, and m_runoff), is a
+            // rate. m * (kg / m^3) / second = kg / m^2 / second
+            m_mass_flux(i, j) = SMB * ice_density / dt;
+          }
         }
-      }
 
-      if (mask.ice_free_ocean(i, j)) {
-        m_firn_depth(i, j) = 0.0;  // no firn in the ocean
-        m_snow_depth(i, j) = 0.0;  // snow over the ocean does not stick
+        if (mask.ice_free_ocean(i, j)) {
+          m_firn_depth(i, j) = 0.0;  // no firn in the ocean
+          m_snow_depth(i, j) = 0.0;  // snow over the ocean does not stick
+        }
       }
     }
   } catch (...) {
@@ -689,11 +706,11 @@ private:
 };
 
 /*!
- * Integrate a field over the computational domain.
+ * Integrate a field over the sub-domain owned by this rank.
  *
  * If the input has units kg/m^2, the output will be in kg.
  */
-static double integrate(const IceModelVec2S &input) {
+static double integrate_local(const IceModelVec2S &input) {
   IceGrid::ConstPtr grid = input.grid();
 
   double cell_area = grid->cell_area();
@@ -708,7 +725,7 @@ static double integrate(const IceModelVec2S &input) {
     result += input(i, j) * cell_area;
   }
 
-  return GlobalSum(grid->com, result);
+  return result;
 }
 
 
@@ -723,8 +740,9 @@ public:
     m_ts.variable().set_string("long_name", "surface accumulation rate (PDD model)");
   }
 
-  double compute() {
-    return integrate(model->accumulation());
+  bool compute_local_sum(double &result) {
+    result = integrate_local(model->accumulation());
+    return true;
   }
 };
 
@@ -740,8 +758,9 @@ public:
     m_ts.variable().set_string("long_name", "surface melt rate (PDD model)");
   }
 
-  double compute() {
-    return integrate(model->melt());
+  bool compute_local_sum(double &result) {
+    result = integrate_local(model->melt());
+    return true;
   }
 };
 
@@ -757,8 +776,9 @@ public:
     m_ts.variable().set_string("long_name", "surface runoff rate (PDD model)");
   }
 
-  double compute() {
-    return integrate(model->runoff());
+  bool compute_local_sum(double &result) {
+    result = integrate_local(model->runoff());
+    return true;
   }
 };
 
@@ -18,8 +18,7 @@
 
 #include <cassert>
 #include <ctime>  // for time(), used to initialize random number gen
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
+#include <cstring>              // memcpy
 #include <gsl/gsl_math.h>       // M_PI
 #include <cmath>                // for erfc() in CalovGreveIntegrand()
 #include <algorithm>
@@ -63,6 +62,30 @@ PDDMassBalance::PDDMassBalance(Config::ConstPtr config, units::System::Ptr syste
   refreeze_ice_melt  = m_config->get_flag("surface.pdd.refreeze_ice_melt");
 
   m_method = "an expectation integral";
+
+  // The integrand f(sigma, T) is equal to sigma * g(T / sigma), where g(z) = f(1, z), so we
+  // tabulate g. The error of linear interpolation of g using the spacing dz does not
+  // exceed dz^2 / 8 * max(g''(z)) = dz^2 / (8 * sqrt(2 pi)).
+  //
+  // Outside of [-z_max, z_max] g(z) is equal to zero (z < 0) or z (z > 0) to within 1e-16.
+  m_table_z_max = 8.0;
+  m_table_dz    = 0.0;
+
+  double max_error = m_config->get_number("surface.pdd.tabulated_integrand_error");
+  if (max_error > 0.0) {
+    double dz = sqrt(8.0 * sqrt(2.0 * M_PI) * max_error);
+
+    unsigned int N = static_cast<unsigned int>(ceil(2.0 * m_table_z_max / dz)) + 1;
+    N = std::max(N, 2U);
+
+    m_table_dz = 2.0 * m_table_z_max / (N - 1);
+    m_table.resize(N);
+    for (unsigned int k = 0; k < N; ++k) {
+      m_table[k] = CalovGreveIntegrand(1.0, -m_table_z_max + k * m_table_dz);
+    }
+
+    m_method = "an expectation integral (tabulated)";
+  }
 }
 
 
@@ -104,29 +127,68 @@ double PDDMassBalance::CalovGreveIntegrand(double sigma, double TacC) {
   }
 }
 
+//! Approximate CalovGreveIntegrand() using linear interpolation from a table.
+/*!
+ * Uses `CalovGreveIntegrand(sigma, TacC) == sigma * CalovGreveIntegrand(1, TacC / sigma)`.
+ */
+double PDDMassBalance::CalovGreveIntegrandTabulated(double sigma, double TacC) const {
+
+  if (sigma == 0) {
+    return std::max(TacC, 0.0);
+  }
+
+  const double z = TacC / sigma;
+
+  if (z <= -m_table_z_max) {
+    return 0.0;
+  }
+
+  if (z >= m_table_z_max) {
+    return TacC;
+  }
+
+  const double x = (z + m_table_z_max) / m_table_dz;
+  // x >= 0, so truncation is the same as floor()
+  const size_t k = std::min(static_cast<size_t>(x), m_table.size() - 2);
+  const double alpha = x - k;
+
+  return sigma * (m_table[k] + alpha * (m_table[k + 1] - m_table[k]));
+}
+
 
 //! Compute the expected number of positive degree days from the input temperature time-series.
 /**
  * Use the rectangle method for simplicity.
  *
+ * @param i,j grid point (not used)
+ * @param t time of the first sample (not used)
  * @param S standard deviation for air temperature excursions
  * @param dt_series length of the step for the time-series
  * @param T air temperature (array of length N)
  * @param N length of the T array
  * @param[out] PDDs pointer to a pre-allocated array with N-1 elements
  */
-void PDDMassBalance::get_PDDs(double dt_series,
+void PDDMassBalance::get_PDDs(int i, int j, double t, double dt_series,
                               const std::vector<double> &S,
                               const std::vector<double> &T,
                               std::vector<double> &PDDs) {
+  (void) i;
+  (void) j;
+  (void) t;
   assert(S.size() == T.size() and T.size() == PDDs.size());
   assert(dt_series > 0.0);
 
   const double h_days = dt_series / m_seconds_per_day;
   const size_t N = S.size();
 
-  for (unsigned int k = 0; k < N; ++k) {
-    PDDs[k] = h_days * CalovGreveIntegrand(S[k], T[k] - pdd_threshold_temp);
+  if (m_table.empty()) {
+    for (unsigned int k = 0; k < N; ++k) {
+      PDDs[k] = h_days * CalovGreveIntegrand(S[k], T[k] - pdd_threshold_temp);
+    }
+  } else {
+    for (unsigned int k = 0; k < N; ++k) {
+      PDDs[k] = h_days * CalovGreveIntegrandTabulated(S[k], T[k] - pdd_threshold_temp);
+    }
   }
 }
 
@@ -293,15 +355,13 @@ PDDMassBalance::Changes PDDMassBalance::step(const DegreeDayFactors &ddf,
 
 
 /*!
-Initializes the random number generator (RNG).  The RNG is GSL's recommended default,
-which seems to be "mt19937" and is DIEHARD (whatever that means ...). Seed with
-wall clock time in seconds in non-repeatable case, and with 0 in repeatable case.
+Initializes the counter-based random number generator (RNG). Seed with wall clock time in
+seconds in non-repeatable case, and with 0 in repeatable case.
  */
 PDDrandMassBalance::PDDrandMassBalance(Config::ConstPtr config, units::System::Ptr system,
                                        Kind kind)
-  : PDDMassBalance(config, system) {
-  pddRandGen = gsl_rng_alloc(gsl_rng_default);  // so pddRandGen != NULL now
-  gsl_rng_set(pddRandGen, kind == REPEATABLE ? 0 : time(0));
+  : PDDMassBalance(config, system),
+    m_generator(kind == REPEATABLE ? 0 : time(0)) {
 
   m_method = (kind == NOT_REPEATABLE
               ? "simulation of a random process"
@@ -310,10 +370,7 @@ PDDrandMassBalance::PDDrandMassBalance(Config::ConstPtr config, units::System::P
 
 
 PDDrandMassBalance::~PDDrandMassBalance() {
-  if (pddRandGen != NULL) {
-    gsl_rng_free(pddRandGen);
-    pddRandGen = NULL;
-  }
+  // empty
 }
 
 
@@ -337,14 +394,19 @@ unsigned int PDDrandMassBalance::get_timeseries_length(double dt) {
  * \f[
  * \text{PDD} = \sum_{i=0}^{N-1} h_{\text{days}} \cdot \text{max}(T_i-T_{\text{threshold}}, 0).
  * \f]
+ *
+ * The random temperature excursion for the sample `k` depends on the seed, the grid point
+ * (`i`, `j`) and the time of the sample only.
  * 
+ * @param i,j grid point
+ * @param t time of the first sample, in seconds
  * @param S \f$\sigma\f$ (standard deviation for daily temperature excursions)
  * @param dt_series time-series step, in seconds
  * @param T air temperature
  * @param N number of points in the temperature time-series, each corresponds to a sub-interval
  * @param PDDs pointer to a pre-allocated array of length N
  */
-void PDDrandMassBalance::get_PDDs(double dt_series,
+void PDDrandMassBalance::get_PDDs(int i, int j, double t, double dt_series,
                                   const std::vector<double> &S,
                                   const std::vector<double> &T,
                                   std::vector<double> &PDDs) {
@@ -355,8 +417,18 @@ void PDDrandMassBalance::get_PDDs(double dt_series,
   const size_t N = S.size();
 
   for (unsigned int k = 0; k < N; ++k) {
+    // use the grid point and the time of the sample as the counter
+    const double t_k = t + k * dt_series;
+    uint64_t t_bits = 0;
+    memcpy(&t_bits, &t_k, sizeof(t_k));
+
+    const Philox::Counter counter = {static_cast<uint32_t>(i),
+                                     static_cast<uint32_t>(j),
+                                     static_cast<uint32_t>(t_bits),
+                                     static_cast<uint32_t>(t_bits >> 32)};
+
     // average temperature in k-th interval
-    double T_k = T[k] + gsl_ran_gaussian(pddRandGen, S[k]); // add random: N(0,sigma)
+    double T_k = T[k] + S[k] * m_generator.gaussian(counter); // add random: N(0,sigma)
 
     if (T_k > pdd_threshold_temp) {
       PDDs[k] = h_days * (T_k - pdd_threshold_temp);
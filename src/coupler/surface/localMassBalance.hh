@@ -20,9 +20,8 @@
 #define __localMassBalance_hh
 
 
-#include <gsl/gsl_rng.h>
-
 #include "pism/util/iceModelVec.hh"  // only needed for FaustoGrevePDDObject
+#include "pism/util/Philox.hh"
 
 namespace pism {
 namespace surface {
@@ -78,8 +77,9 @@ public:
 
   //! Count positive degree days (PDDs).  Returned value in units of K day.
   /*! Inputs T[0],...,T[N-1] are temperatures (K) at times t, t+dt_series, ..., t+(N-1)dt_series.
-    Inputs `t`, `dt_series` are in seconds.  */
-  virtual void get_PDDs(double dt_series,
+    Inputs `t`, `dt_series` are in seconds. `i`, `j` are (global) indices of the grid
+    point. */
+  virtual void get_PDDs(int i, int j, double t, double dt_series,
                         const std::vector<double> &S,
                         const std::vector<double> &T,
                         std::vector<double> &PDDs) = 0;
@@ -137,7 +137,7 @@ public:
   virtual ~PDDMassBalance() {}
 
   virtual unsigned int get_timeseries_length(double dt);
-  virtual void get_PDDs(double dt_series,
+  virtual void get_PDDs(int i, int j, double t, double dt_series,
                         const std::vector<double> &S,
                         const std::vector<double> &T,
                         std::vector<double> &PDDs);
@@ -154,6 +154,12 @@ public:
 
 protected:
   double CalovGreveIntegrand(double sigma, double TacC);
+  double CalovGreveIntegrandTabulated(double sigma, double TacC) const;
+
+  //! values of CalovGreveIntegrand(1, z) at equally-spaced z in [-m_table_z_max,
+  //! m_table_z_max]; empty if the integrand is evaluated exactly
+  std::vector<double> m_table;
+  double m_table_z_max, m_table_dz;
 
   bool precip_as_snow,          //!< interpret all the precipitation as snow (no rain)
     refreeze_ice_melt;          //!< refreeze melted ice
@@ -165,8 +171,9 @@ protected:
 
 //! An alternative PDD implementation which simulates a random process to get the number of PDDs.
 /*!
-  Uses a GSL random number generator.  Significantly slower because new random numbers are
-  generated for each grid point.
+  Uses a counter-based random number generator keyed on the grid point and the time of
+  each sample, so results do not depend on the number of processes.  Significantly
+  slower because new random numbers are generated for each grid point.
 
   The way the number of positive degree-days are used to produce a surface mass balance
   is identical to the base class PDDMassBalance.
@@ -187,12 +194,12 @@ public:
 
   virtual unsigned int get_timeseries_length(double dt);
 
-  virtual void get_PDDs(double dt_series,
+  virtual void get_PDDs(int i, int j, double t, double dt_series,
                         const std::vector<double> &S,
                         const std::vector<double> &T,
                         std::vector<double> &PDDs);
 protected:
-  gsl_rng *pddRandGen;
+  Philox m_generator;
 };
 
 
@@ -0,0 +1,40 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "pism/coupler/util/AffineMap.hh"
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+
+//! Set `output` to the result of applying this map to `input` (at owned grid points).
+void AffineMap::apply(const IceModelVec2S &input, IceModelVec2S &output) const {
+  IceGrid::ConstPtr grid = output.grid();
+
+  IceModelVec::AccessList list{&input, &output};
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    output(i, j) = m_scale * input(i, j) + m_offset;
+  }
+
+  output.inc_state_counter();
+}
+
+} // end of namespace pism
@@ -0,0 +1,56 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_AFFINEMAP_H
+#define PISM_AFFINEMAP_H
+
+namespace pism {
+
+class IceModelVec2S;
+
+//! The map `x -> scale * x + offset` applied to a field by a scalar climate modifier.
+/*!
+ * Chains of modifiers using scalar offsets and factors are combined into one map so that
+ * the field they modify is read once and the result is written once.
+ */
+class AffineMap {
+public:
+  AffineMap(double scale = 1.0, double offset = 0.0)
+    : m_scale(scale), m_offset(offset) {
+    // empty
+  }
+
+  //! The map `x -> this(inner(x))`.
+  AffineMap after(const AffineMap &inner) const {
+    return AffineMap(m_scale * inner.m_scale, m_scale * inner.m_offset + m_offset);
+  }
+
+  double operator()(double x) const {
+    return m_scale * x + m_offset;
+  }
+
+  void apply(const IceModelVec2S &input, IceModelVec2S &output) const;
+private:
+  double m_scale;
+  double m_offset;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_AFFINEMAP_H */
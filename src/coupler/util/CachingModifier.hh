@@ -0,0 +1,203 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _CACHINGMODIFIER_H_
+#define _CACHINGMODIFIER_H_
+
+#include <algorithm>            // std::min
+#include <cassert>
+#include <cmath>                // fabs
+
+#include "pism/geometry/Geometry.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/Time.hh"
+#include "pism/util/MaxTimestep.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+
+//! Geometry used by CachingModifier to decide if outputs have to be refreshed.
+/*!
+ * Overload this for the inputs of components that do not take a Geometry.
+ */
+inline const Geometry& cached_geometry(const Geometry &geometry) {
+  return geometry;
+}
+
+//! A modifier that updates the model below it only once in a while and re-uses its
+//! outputs in between.
+/*!
+ * `Model` is the base class of a component type (surface::SurfaceModel,
+ * atmosphere::AtmosphereModel, etc) and `Inputs` is the type of the first argument of its
+ * update_impl(). Subclasses allocate storage for outputs, implement copy_outputs() and
+ * return stored outputs from *_impl() methods.
+ *
+ * Outputs are refreshed
+ *
+ * - every `PREFIX.cache.update_interval` years (the time step is limited so that PISM
+ *   stops at refresh times) and
+ * - if `PREFIX.cache.elevation_change_threshold` is positive, when the ice surface
+ *   elevation changes by more than this amount anywhere since the last refresh.
+ *
+ * The model below is always updated using a one year long time step.
+ */
+template <class Model, class Inputs = Geometry>
+class CachingModifier : public Model {
+public:
+  CachingModifier(IceGrid::ConstPtr grid, std::shared_ptr<Model> input,
+                  const std::string &prefix)
+    : Model(grid, input),
+      m_prefix(prefix),
+      m_refreshed(false),
+      m_update_time(0.0) {
+
+    auto config = grid->ctx()->config();
+
+    m_next_update_time           = grid->ctx()->time()->current();
+    m_update_interval_years      = config->get_number(prefix + ".cache.update_interval", "years");
+    m_elevation_change_threshold = config->get_number(prefix + ".cache.elevation_change_threshold",
+                                                      "meters");
+
+    if (m_update_interval_years < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "%s.cache.update_interval has to be strictly positive (got %d)",
+                                    prefix.c_str(), m_update_interval_years);
+    }
+
+    if (m_elevation_change_threshold > 0.0) {
+      m_surface_elevation.create(grid, "cached_surface_elevation", WITHOUT_GHOSTS);
+    }
+  }
+
+  virtual ~CachingModifier() {
+    // empty
+  }
+
+protected:
+  //! Store outputs of the input model (updated at m_update_time).
+  virtual void copy_outputs() = 0;
+
+  void init_impl(const Geometry &geometry) {
+    this->m_input_model->init(geometry);
+
+    this->m_log->message(2, "* Initializing the 'caching' %s model modifier...\n",
+                         m_prefix.c_str());
+
+    m_next_update_time = this->m_grid->ctx()->time()->current();
+    m_refreshed        = false;
+  }
+
+  void update_impl(const Inputs &inputs, double t, double dt) {
+    // ignore dt and always use 1 year long time-steps when updating the input model
+    (void) dt;
+
+    auto time = this->m_grid->ctx()->time();
+
+    const Geometry &geometry = cached_geometry(inputs);
+
+    bool scheduled = (t >= m_next_update_time or fabs(t - m_next_update_time) < 1.0);
+
+    if (not (scheduled or not m_refreshed or elevation_changed(geometry))) {
+      return;
+    }
+
+    double
+      one_year_from_now = time->increment_date(t, 1.0),
+      update_dt         = one_year_from_now - t;
+
+    assert(update_dt > 0.0);
+
+    this->m_input_model->update(inputs, t, update_dt);
+
+    if (scheduled) {
+      m_next_update_time = time->increment_date(m_next_update_time, m_update_interval_years);
+    }
+
+    if (m_elevation_change_threshold > 0.0) {
+      m_surface_elevation.copy_from(geometry.ice_surface_elevation);
+    }
+    m_refreshed   = true;
+    m_update_time = t;
+
+    this->copy_outputs();
+  }
+
+  MaxTimestep max_timestep_impl(double t) const {
+    double dt = m_next_update_time - t;
+
+    // if we got very close to the next update time, set time step
+    // length to the interval between updates
+    if (dt < 1.0) {
+      double update_time_after_next =
+        this->m_grid->ctx()->time()->increment_date(m_next_update_time, m_update_interval_years);
+
+      dt = update_time_after_next - m_next_update_time;
+      assert(dt > 0.0);
+    }
+
+    MaxTimestep cache_dt(dt, m_prefix + " cache");
+
+    MaxTimestep input_max_timestep = this->m_input_model->max_timestep(t);
+    if (input_max_timestep.finite()) {
+      return std::min(input_max_timestep, cache_dt);
+    } else {
+      return cache_dt;
+    }
+  }
+
+  //! Returns true if the ice surface elevation changed by more than the threshold
+  //! anywhere since the last refresh.
+  bool elevation_changed(const Geometry &geometry) const {
+    if (m_elevation_change_threshold <= 0.0 or not m_refreshed) {
+      return false;
+    }
+
+    const IceModelVec2S &surface = geometry.ice_surface_elevation;
+
+    IceModelVec::AccessList list{&surface, &m_surface_elevation};
+
+    double change = 0.0;
+    for (Points p(*this->m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      change = std::max(change, fabs(surface(i, j) - m_surface_elevation(i, j)));
+    }
+
+    return GlobalMax(this->m_grid->com, change) > m_elevation_change_threshold;
+  }
+
+  //! configuration prefix ("surface", "ocean", etc)
+  std::string m_prefix;
+
+  double m_next_update_time;
+  int m_update_interval_years;
+
+  double m_elevation_change_threshold;
+  //! ice surface elevation at the time of the last refresh
+  IceModelVec2S m_surface_elevation;
+  //! true if outputs were computed at least once
+  bool m_refreshed;
+  //! time of the last update of the input model (one year long)
+  double m_update_time;
+};
+
+} // end of namespace pism
+
+#endif /* _CACHINGMODIFIER_H_ */
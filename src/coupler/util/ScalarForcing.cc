@@ -102,4 +102,17 @@ double ScalarForcing::value(double t) const {
   return (*m_data)(t);
 }
 
+//! Compute values at times `ts` (more efficient than calling value(t) for each `t`).
+void ScalarForcing::value(const std::vector<double> &ts, std::vector<double> &result) const {
+  const unsigned int N = ts.size();
+
+  std::vector<double> times(N);
+  for (unsigned int k = 0; k < N; ++k) {
+    times[k] = m_ctx->time()->mod(ts[k] - m_reference_time, m_period);
+  }
+
+  result.resize(N);
+  m_data->evaluate(times.data(), result.data(), N);
+}
+
 } // end of namespace pism
@@ -20,6 +20,7 @@
 #define _SCALARFORCING_H_
 
 #include <memory>               // std::unique_ptr
+#include <vector>
 
 #include "pism/util/Context.hh"
 
@@ -49,6 +50,7 @@ public:
 
   double value() const;
   double value(double t) const;
+  void value(const std::vector<double> &ts, std::vector<double> &result) const;
 protected:
   Context::ConstPtr m_ctx;
 
@@ -16,6 +16,10 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cmath>                // std::floor
+#include <vector>
+#include <algorithm>            // std::min
+
 #include "LingleClark.hh"
 
 #include "pism/util/io/File.hh"
@@ -29,6 +33,12 @@
 #include "pism/util/fftw_utilities.hh"
 #include "LingleClarkSerial.hh"
 
+#include "pism/pism_config.hh"
+
+#if (Pism_USE_FFTW_MPI==1)
+#include "LingleClarkParallel.hh"
+#endif
+
 namespace pism {
 namespace bed {
 
@@ -50,15 +60,11 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
                                   m_update_interval);
   }
 
-  // A work vector. This storage is used to put thickness change on rank 0 and to get the plate
-  // displacement change back.
   m_total_displacement.set_attrs("internal",
                                  "total (viscous and elastic) displacement "
                                  "in the Lingle-Clark bed deformation model",
                                  "meters", "meters", "", 0);
 
-  m_work0 = m_total_displacement.allocate_proc0_copy();
-
   m_relief.set_attrs("internal",
                      "bed relief relative to the modeled bed displacement",
                      "meters", "meters", "", 0);
@@ -69,14 +75,34 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
                                    "elastic part of the displacement in the "
                                    "Lingle-Clark bed deformation model; "
                                    "see :cite:`BLKfastearth`", "meters", "meters", "", 0);
-  m_elastic_displacement0 = m_elastic_displacement.allocate_proc0_copy();
 
   const int
     Mx = m_grid->Mx(),
     My = m_grid->My(),
-    Z  = m_config->get_number("bed_deformation.lc.grid_size_factor"),
-    Nx = Z*(Mx - 1) + 1,
-    Ny = Z*(My - 1) + 1;
+    Z  = m_config->get_number("bed_deformation.lc.grid_size_factor");
+
+  // The deformation model may use a coarser grid covering the same domain. Its spacing
+  // is approximately m_earth_grid_factor times the spacing of the ice grid.
+  m_earth_grid_factor = m_config->get_number("bed_deformation.lc.coarsening_factor");
+
+  if (m_earth_grid_factor < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid bed_deformation.lc.coarsening_factor = %d",
+                                  m_earth_grid_factor);
+  }
+
+  if (m_earth_grid_factor > 1 and m_config->get_flag("bed_deformation.lc.parallel_fft")) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "bed_deformation.lc.coarsening_factor > 1 is not supported"
+                       " with bed_deformation.lc.parallel_fft");
+  }
+
+  m_earth_Mx = (Mx - 1 + m_earth_grid_factor - 1) / m_earth_grid_factor + 1;
+  m_earth_My = (My - 1 + m_earth_grid_factor - 1) / m_earth_grid_factor + 1;
+
+  const int
+    Nx = Z*(m_earth_Mx - 1) + 1,
+    Ny = Z*(m_earth_My - 1) + 1;
 
   const double
     Lx = Z * (m_grid->x0() - m_grid->x(0)),
@@ -102,20 +128,51 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
   // do not point to auxiliary coordinates "lon" and "lat".
   m_viscous_displacement.metadata().set_string("coordinates", "");
 
-  m_viscous_displacement0 = m_viscous_displacement.allocate_proc0_copy();
+  if (m_config->get_flag("bed_deformation.lc.parallel_fft")) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model.reset(new LingleClarkParallel(m_log, *m_config, use_elastic_model,
+                                                   m_grid, m_extended_grid));
+#else
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "bed_deformation.lc.parallel_fft requires PISM built with FFTW-MPI"
+                       " (Pism_USE_FFTW_MPI)");
+#endif
+  } else {
+    // Work vectors. This storage is used to put thickness change on rank 0 and to get the
+    // plate displacement change back.
+    m_work0 = m_total_displacement.allocate_proc0_copy();
+    m_elastic_displacement0 = m_elastic_displacement.allocate_proc0_copy();
+    m_viscous_displacement0 = m_viscous_displacement.allocate_proc0_copy();
 
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) {
-      m_serial_model.reset(new LingleClarkSerial(m_log, *m_config, use_elastic_model,
-                                                 Mx, My,
-                                                 m_grid->dx(), m_grid->dy(),
-                                                 Nx, Ny));
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) {
+        if (m_earth_grid_factor > 1) {
+          PetscErrorCode ierr = 0;
+
+          ierr = VecCreateSeq(PETSC_COMM_SELF, m_earth_Mx * m_earth_My,
+                              m_earth_work0.rawptr());
+          PISM_CHK(ierr, "VecCreateSeq");
+
+          ierr = VecCreateSeq(PETSC_COMM_SELF, m_earth_Mx * m_earth_My,
+                              m_earth_load0.rawptr());
+          PISM_CHK(ierr, "VecCreateSeq");
+        }
+
+        const double
+          dx = m_earth_grid_factor > 1 ? m_extended_grid->dx() : m_grid->dx(),
+          dy = m_earth_grid_factor > 1 ? m_extended_grid->dy() : m_grid->dy();
+
+        m_serial_model.reset(new LingleClarkSerial(m_log, *m_config, use_elastic_model,
+                                                   m_earth_Mx, m_earth_My,
+                                                   dx, dy,
+                                                   Nx, Ny));
+      }
+    } catch (...) {
+      rank0.failed();
     }
-  } catch (...) {
-    rank0.failed();
+    rank0.check();
   }
-  rank0.check();
 }
 
 LingleClark::~LingleClark() {
@@ -142,10 +199,19 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
   compute_load(bed_elevation, ice_thickness, sea_level_elevation,
                m_load_thickness);
 
-  petsc::Vec::Ptr thickness0 = m_load_thickness.allocate_proc0_copy();
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->bootstrap(m_load_thickness, bed_uplift);
 
-  // initialize the plate displacement
+    m_viscous_displacement.copy_from(m_parallel_model->viscous_displacement());
+    m_elastic_displacement.copy_from(m_parallel_model->elastic_displacement());
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+  } else
+#endif
   {
+    petsc::Vec::Ptr thickness0 = m_load_thickness.allocate_proc0_copy();
+
+    // initialize the plate displacement
     bed_uplift.put_on_proc0(*m_work0);
     m_load_thickness.put_on_proc0(*thickness0);
 
@@ -154,33 +220,121 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
       if (m_grid->rank() == 0) {
         PetscErrorCode ierr = 0;
 
-        m_serial_model->bootstrap(*thickness0, *m_work0);
+        m_serial_model->bootstrap(to_earth_grid(*thickness0, m_earth_load0),
+                                  to_earth_grid(*m_work0, m_earth_work0));
 
-        ierr = VecCopy(m_serial_model->total_displacement(), *m_work0);
-        PISM_CHK(ierr, "VecCopy");
+        from_earth_grid(m_serial_model->total_displacement(), *m_work0);
 
         ierr = VecCopy(m_serial_model->viscous_displacement(), *m_viscous_displacement0);
         PISM_CHK(ierr, "VecCopy");
 
-        ierr = VecCopy(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
-        PISM_CHK(ierr, "VecCopy");
+        from_earth_grid(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
       }
     } catch (...) {
       rank0.failed();
     }
     rank0.check();
-  }
 
-  m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
+    m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
 
-  m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
+    m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
 
-  m_total_displacement.get_from_proc0(*m_work0);
+    m_total_displacement.get_from_proc0(*m_work0);
+  }
 
   // compute bed relief
   m_topg.add(-1.0, m_total_displacement, m_relief);
 }
 
+/*!
+ * Return `input` (rank 0 storage using the ice grid) on the grid used by the deformation
+ * model. Uses `work` as storage if the deformation model uses a coarser grid.
+ *
+ * Each point of the coarser grid gets the average of values at the nearest ice grid
+ * points, so the total load is approximately preserved.
+ *
+ * Should be called on rank 0 only.
+ */
+Vec LingleClark::to_earth_grid(Vec input, petsc::Vec &work) {
+  if (m_earth_grid_factor == 1) {
+    return input;
+  }
+
+  const int
+    Mx = m_grid->Mx(),
+    My = m_grid->My(),
+    mx = m_earth_Mx,
+    my = m_earth_My;
+
+  const double
+    rx = (mx - 1.0) / (Mx - 1.0),
+    ry = (my - 1.0) / (My - 1.0);
+
+  PetscErrorCode ierr = VecSet(work, 0.0); PISM_CHK(ierr, "VecSet");
+
+  std::vector<double> count(mx * my, 0.0);
+
+  petsc::VecArray2D in(input, Mx, My), out(work, mx, my);
+
+  for (int j = 0; j < My; ++j) {
+    const int J = static_cast<int>(std::floor(j * ry + 0.5));
+    for (int i = 0; i < Mx; ++i) {
+      const int I = static_cast<int>(std::floor(i * rx + 0.5));
+
+      out(I, J) += in(i, j);
+      count[J * mx + I] += 1.0;
+    }
+  }
+
+  for (int J = 0; J < my; ++J) {
+    for (int I = 0; I < mx; ++I) {
+      out(I, J) /= count[J * mx + I];
+    }
+  }
+
+  return work;
+}
+
+/*!
+ * Put `input` (rank 0 storage using the grid of the deformation model) on the ice grid,
+ * using bilinear interpolation if the deformation model uses a coarser grid.
+ *
+ * Should be called on rank 0 only.
+ */
+void LingleClark::from_earth_grid(Vec input, Vec output) const {
+  if (m_earth_grid_factor == 1) {
+    PetscErrorCode ierr = VecCopy(input, output); PISM_CHK(ierr, "VecCopy");
+    return;
+  }
+
+  const int
+    Mx = m_grid->Mx(),
+    My = m_grid->My(),
+    mx = m_earth_Mx,
+    my = m_earth_My;
+
+  const double
+    rx = (mx - 1.0) / (Mx - 1.0),
+    ry = (my - 1.0) / (My - 1.0);
+
+  petsc::VecArray2D in(input, mx, my), out(output, Mx, My);
+
+  for (int j = 0; j < My; ++j) {
+    const double y = j * ry;
+    const int    J = std::min(static_cast<int>(std::floor(y)), my - 2);
+    const double b = y - J;
+
+    for (int i = 0; i < Mx; ++i) {
+      const double x = i * rx;
+      const int    I = std::min(static_cast<int>(std::floor(x)), mx - 2);
+      const double a = x - I;
+
+      out(i, j) = ((1.0 - a) * (1.0 - b) * in(I, J) + a * (1.0 - b) * in(I + 1, J) +
+                   (1.0 - a) * b * in(I, J + 1) + a * b * in(I + 1, J + 1));
+    }
+  }
+}
+
 /*!
  * Return the load response matrix for the elastic response.
  *
@@ -193,6 +347,13 @@ IceModelVec2S::Ptr LingleClark::elastic_load_response_matrix() const {
     Nx = m_extended_grid->Mx(),
     Ny = m_extended_grid->My();
 
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->compute_load_response_matrix(*result);
+    return result;
+  }
+#endif
+
   auto lrm0 = result->allocate_proc0_copy();
 
   {
@@ -268,6 +429,13 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
 
   // Now that viscous displacement and elastic displacement are finally initialized,
   // put them on rank 0 and initialize the serial model itself.
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->init(m_viscous_displacement, m_elastic_displacement);
+
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+  } else
+#endif
   {
     m_viscous_displacement.put_on_proc0(*m_viscous_displacement0);
     m_elastic_displacement.put_on_proc0(*m_work0);
@@ -275,20 +443,17 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
     ParallelSection rank0(m_grid->com);
     try {
       if (m_grid->rank() == 0) {  // only processor zero does the work
-        PetscErrorCode ierr = 0;
-
-        m_serial_model->init(*m_viscous_displacement0, *m_work0);
+        m_serial_model->init(*m_viscous_displacement0, to_earth_grid(*m_work0, m_earth_work0));
 
-        ierr = VecCopy(m_serial_model->total_displacement(), *m_work0);
-        PISM_CHK(ierr, "VecCopy");
+        from_earth_grid(m_serial_model->total_displacement(), *m_work0);
       }
     } catch (...) {
       rank0.failed();
     }
     rank0.check();
-  }
 
-  m_total_displacement.get_from_proc0(*m_work0);
+    m_total_displacement.get_from_proc0(*m_work0);
+  }
 
   // compute bed relief
   m_topg.add(-1.0, m_total_displacement, m_relief);
@@ -343,34 +508,43 @@ void LingleClark::step(const IceModelVec2S &ice_thickness,
   compute_load(m_topg, ice_thickness, sea_level_elevation,
                m_load_thickness);
 
-  m_load_thickness.put_on_proc0(*m_work0);
+#if (Pism_USE_FFTW_MPI==1)
+  if (m_parallel_model) {
+    m_parallel_model->step(dt, m_load_thickness);
+
+    m_viscous_displacement.copy_from(m_parallel_model->viscous_displacement());
+    m_elastic_displacement.copy_from(m_parallel_model->elastic_displacement());
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+  } else
+#endif
+  {
+    m_load_thickness.put_on_proc0(*m_work0);
 
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) {  // only processor zero does the step
-      PetscErrorCode ierr = 0;
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) {  // only processor zero does the step
+        PetscErrorCode ierr = 0;
 
-      m_serial_model->step(dt, *m_work0);
+        m_serial_model->step(dt, to_earth_grid(*m_work0, m_earth_load0));
 
-      ierr = VecCopy(m_serial_model->total_displacement(), *m_work0);
-      PISM_CHK(ierr, "VecCopy");
+        from_earth_grid(m_serial_model->total_displacement(), *m_work0);
 
-      ierr = VecCopy(m_serial_model->viscous_displacement(), *m_viscous_displacement0);
-      PISM_CHK(ierr, "VecCopy");
+        ierr = VecCopy(m_serial_model->viscous_displacement(), *m_viscous_displacement0);
+        PISM_CHK(ierr, "VecCopy");
 
-      ierr = VecCopy(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
-      PISM_CHK(ierr, "VecCopy");
+        from_earth_grid(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
+      }
+    } catch (...) {
+      rank0.failed();
     }
-  } catch (...) {
-    rank0.failed();
-  }
-  rank0.check();
+    rank0.check();
 
-  m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
+    m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
 
-  m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
+    m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
 
-  m_total_displacement.get_from_proc0(*m_work0);
+    m_total_displacement.get_from_proc0(*m_work0);
+  }
 
   // Update bed elevation using bed displacement and relief.
   {
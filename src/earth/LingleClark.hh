@@ -28,8 +28,9 @@ namespace pism {
 namespace bed {
 
 class LingleClarkSerial;
+class LingleClarkParallel;
 
-//! A wrapper class around LingleClarkSerial.
+//! A wrapper class around LingleClarkSerial and LingleClarkParallel.
 class LingleClark : public BedDef {
 public:
   LingleClark(IceGrid::ConstPtr g);
@@ -65,6 +66,9 @@ protected:
                    const IceModelVec2S &sea_level_elevation,
                    double t, double dt);
 
+  Vec to_earth_grid(Vec input, petsc::Vec &work);
+  void from_earth_grid(Vec input, Vec output) const;
+
   //! Total (viscous and elastic) bed displacement.
   IceModelVec2S m_total_displacement;
 
@@ -81,6 +85,20 @@ protected:
   //! Serial viscoelastic bed deformation model.
   std::unique_ptr<LingleClarkSerial> m_serial_model;
 
+  //! Distributed viscoelastic bed deformation model (used if
+  //! bed_deformation.lc.parallel_fft is set). This is a shared_ptr because
+  //! LingleClarkParallel is not available if PISM is built without FFTW-MPI.
+  std::shared_ptr<LingleClarkParallel> m_parallel_model;
+
+  //! Coarsening factor of the grid used by the deformation model (1 if it uses the ice
+  //! grid)
+  int m_earth_grid_factor;
+  //! Size of the grid used by the deformation model
+  int m_earth_Mx, m_earth_My;
+  //! rank 0 storage on the grid used by the deformation model (allocated only if
+  //! m_earth_grid_factor > 1)
+  petsc::Vec m_earth_work0, m_earth_load0;
+
   //! extended grid for the viscous plate displacement
   IceGrid::Ptr m_extended_grid;
 
@@ -0,0 +1,531 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <cmath>                // sqrt, exp
+#include <algorithm>            // std::min, std::max
+#include <fftw3-mpi.h>
+#include <gsl/gsl_math.h>       // M_PI
+
+#include "matlablike.hh"
+#include "greens.hh"
+#include "LingleClarkParallel.hh"
+
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/fftw_utilities.hh"
+#include "pism/util/SlabScatter.hh"
+
+namespace pism {
+namespace bed {
+
+/*!
+ * @param[in] config configuration database
+ * @param[in] include_elastic include elastic deformation component
+ * @param[in] grid PISM's grid
+ * @param[in] extended_grid extended grid used by the viscous part of the model
+ */
+LingleClarkParallel::LingleClarkParallel(Logger::ConstPtr log,
+                                         const Config &config,
+                                         bool include_elastic,
+                                         IceGrid::ConstPtr grid,
+                                         IceGrid::ConstPtr extended_grid)
+  : m_Uv(extended_grid, "viscous_displacement", WITHOUT_GHOSTS),
+    m_Uv_central(grid, "viscous_displacement_central", WITHOUT_GHOSTS),
+    m_Ue(grid, "elastic_displacement", WITHOUT_GHOSTS),
+    m_U(grid, "total_displacement", WITHOUT_GHOSTS),
+    m_log(log) {
+
+  // set parameters
+  m_include_elastic = include_elastic;
+  m_exponential_integrator = config.get_string("bed_deformation.lc.time_stepping") == "exponential";
+
+  if (include_elastic) {
+    // check if the extended grid is large enough (see LingleClarkSerial)
+    if (config.get_number("bed_deformation.lc.grid_size_factor") < 2) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "bed_deformation.lc.elastic_model"
+                                    " requires bed_deformation.lc.grid_size_factor > 1");
+    }
+  }
+
+  // grid parameters
+  m_Mx = grid->Mx();
+  m_My = grid->My();
+  m_dx = grid->dx();
+  m_dy = grid->dy();
+  m_Nx = extended_grid->Mx();
+  m_Ny = extended_grid->My();
+
+  m_load_density   = config.get_number("constants.ice.density");
+  m_mantle_density = config.get_number("bed_deformation.mantle_density");
+  m_eta            = config.get_number("bed_deformation.mantle_viscosity");
+  m_D              = config.get_number("bed_deformation.lithosphere_flexural_rigidity");
+
+  m_standard_gravity = config.get_number("constants.standard_gravity");
+
+  // derive more parameters
+  m_Lx        = 0.5 * (m_Nx - 1.0) * m_dx;
+  m_Ly        = 0.5 * (m_Ny - 1.0) * m_dy;
+  m_i0_offset = (m_Nx - m_Mx) / 2;
+  m_j0_offset = (m_Ny - m_My) / 2;
+
+  // setup fftw stuff (fftw_mpi_init() may be called more than once)
+  fftw_mpi_init();
+
+  ptrdiff_t local_n0 = 0, local_0_start = 0;
+  ptrdiff_t alloc_local = fftw_mpi_local_size_2d(m_Nx, m_Ny, grid->com,
+                                                 &local_n0, &local_0_start);
+  m_slab_start = local_0_start;
+  m_slab_size  = local_n0;
+
+  m_fftw_input  = fftw_alloc_complex(alloc_local);
+  m_fftw_output = fftw_alloc_complex(alloc_local);
+  m_loadhat     = fftw_alloc_complex(alloc_local);
+  m_lrm_hat     = fftw_alloc_complex(alloc_local);
+
+  {
+    unsigned int flags = fftw_planner_flags(config);
+    std::string wisdom_file = config.get_string("fftw.wisdom_file");
+
+    // rank 0 reads wisdom and shares it with other ranks
+    if (grid->rank() == 0) {
+      fftw_load_wisdom(wisdom_file);
+    }
+    fftw_mpi_broadcast_wisdom(grid->com);
+
+    m_dft_forward = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                         grid->com, FFTW_FORWARD, flags);
+    m_dft_inverse = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                         grid->com, FFTW_BACKWARD, flags);
+
+    fftw_mpi_gather_wisdom(grid->com);
+    if (grid->rank() == 0) {
+      fftw_save_wisdom(wisdom_file);
+    }
+  }
+  // planning with FFTW_MEASURE overwrites arrays, so we clear input *after* planning
+  clear(m_fftw_input);
+
+  // scatters moving data between PISM's domain decomposition and slabs
+  m_center.reset(new SlabScatter(m_U, m_Ny, m_slab_start, m_slab_size,
+                                 m_i0_offset, m_j0_offset));
+  m_corner.reset(new SlabScatter(m_U, m_Ny, m_slab_start, m_slab_size, 0, 0));
+  m_elastic.reset(new SlabScatter(m_U, m_Ny, m_slab_start, m_slab_size,
+                                  m_Nx / 2, m_Ny / 2));
+  m_extended.reset(new SlabScatter(m_Uv, m_Ny, m_slab_start, m_slab_size, 0, 0));
+
+  precompute_coefficients();
+}
+
+LingleClarkParallel::~LingleClarkParallel() {
+  fftw_destroy_plan(m_dft_forward);
+  fftw_destroy_plan(m_dft_inverse);
+  fftw_free(m_fftw_input);
+  fftw_free(m_fftw_output);
+  fftw_free(m_loadhat);
+  fftw_free(m_lrm_hat);
+}
+
+//! Fill the part of `input` owned by this rank with zeros.
+void LingleClarkParallel::clear(fftw_complex *input) {
+  clear_fftw_array(input, m_slab_size, m_Ny);
+}
+
+//! Copy the part of `source` owned by this rank to `destination`.
+void LingleClarkParallel::copy(fftw_complex *source, fftw_complex *destination) {
+  copy_fftw_array(source, destination, m_slab_size, m_Ny);
+}
+
+/*!
+ * Return total displacement.
+ */
+const IceModelVec2S& LingleClarkParallel::total_displacement() const {
+  return m_U;
+}
+
+/*!
+ * Return viscous plate displacement.
+ */
+const IceModelVec2S& LingleClarkParallel::viscous_displacement() const {
+  return m_Uv;
+}
+
+/*!
+ * Return elastic plate displacement.
+ */
+const IceModelVec2S& LingleClarkParallel::elastic_displacement() const {
+  return m_Ue;
+}
+
+/*!
+ * Compute the load response matrix on the extended grid.
+ *
+ * This method is used for testing only.
+ */
+void LingleClarkParallel::compute_load_response_matrix(IceModelVec2S &output) {
+  std::vector<std::complex<double> > array(std::max(m_slab_size, 1) * m_Ny);
+
+  compute_load_response_matrix((fftw_complex*)array.data());
+
+  m_extended->get_real_part((fftw_complex*)array.data(), 1.0, output);
+}
+
+/*!
+ * Compute rows of the load response matrix owned by this rank.
+ *
+ * Uses the symmetry of the matrix (see LingleClarkSerial::compute_load_response_matrix()),
+ * but only within a row: values in the "right half" are computed by the rank owning the
+ * corresponding row.
+ */
+void LingleClarkParallel::compute_load_response_matrix(fftw_complex *output) {
+
+  FFTWArray LRM(output, m_slab_size, m_Ny);
+
+  greens_elastic G;
+  ge_data ge_data {m_dx, m_dy, 0, 0, &G};
+
+  int Nx2 = m_Nx / 2;
+  int Ny2 = m_Ny / 2;
+
+  for (int i = 0; i < m_slab_size; ++i) {
+    // index of this row in the extended grid, mirrored if it is in the right half
+    const int
+      i_global = m_slab_start + i,
+      i_mirror = i_global <= Nx2 ? i_global : 2 * Nx2 - i_global;
+
+    for (int j = 0; j <= Ny2; ++j) {
+      ge_data.p = Nx2 - i_mirror;
+      ge_data.q = Ny2 - j;
+
+      LRM(i, j) = dblquad_cubature(ge_integrand,
+                                   -m_dx / 2, m_dx / 2,
+                                   -m_dy / 2, m_dy / 2,
+                                   1.0e-8, &ge_data);
+    }
+
+    for (int j = Ny2 + 1; j < m_Ny; ++j) {
+      LRM(i, j) = LRM(i, 2 * Ny2 - j);
+    }
+  }
+}
+
+/**
+ * Pre-compute coefficients used by the model.
+ */
+void LingleClarkParallel::precompute_coefficients() {
+
+  // Coefficients for Fourier spectral method Laplacian
+  m_cx = fftfreq(m_Nx, m_Lx / (m_Nx * M_PI));
+  m_cy = fftfreq(m_Ny, m_Ly / (m_Ny * M_PI));
+
+  if (m_include_elastic) {
+    m_log->message(2, "     computing spherical elastic load response matrix ...");
+    {
+      compute_load_response_matrix(m_fftw_input);
+      // Compute fft2(LRM) and save it in m_lrm_hat
+      fftw_execute(m_dft_forward);
+      copy(m_fftw_output, m_lrm_hat);
+    }
+    m_log->message(2, " done\n");
+  }
+}
+
+/*!
+ * Solve the uplift problem. See LingleClarkSerial::uplift_problem().
+ *
+ * Sets m_Uv and m_Uv_central.
+ */
+void LingleClarkParallel::uplift_problem(const IceModelVec2S &load_thickness,
+                                         const IceModelVec2S &bed_uplift) {
+
+  // Compute fft2(-load_density * g * load_thickness)
+  {
+    clear(m_fftw_input);
+    m_center->set_real_part(load_thickness, - m_load_density * m_standard_gravity,
+                            m_fftw_input);
+    fftw_execute(m_dft_forward);
+    // Save fft2(-load_density * g * load_thickness) in loadhat.
+    copy(m_fftw_output, m_loadhat);
+  }
+
+  // fft2(uplift)
+  {
+    clear(m_fftw_input);
+    m_center->set_real_part(bed_uplift, 1.0, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  {
+    FFTWArray
+      u0_hat(m_fftw_input, m_slab_size, m_Ny),
+      load_hat(m_loadhat, m_slab_size, m_Ny),
+      uplift_hat(m_fftw_output, m_slab_size, m_Ny);
+
+    for (int i = 0; i < m_slab_size; i++) {
+      const double cx = m_cx[m_slab_start + i];
+      for (int j = 0; j < m_Ny; j++) {
+        const double
+          C = cx*cx + m_cy[j]*m_cy[j],
+          A = - 2.0 * m_eta * sqrt(C),
+          B = m_mantle_density * m_standard_gravity + m_D * C * C;
+
+        u0_hat(i, j) = (load_hat(i, j) + A * uplift_hat(i, j)) / B;
+      }
+    }
+  }
+
+  fftw_execute(m_dft_inverse);
+  m_extended->get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Uv);
+  m_center->get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Uv_central);
+
+  tweak(load_thickness, 0.0);
+}
+
+/*! Initialize using provided load thickness and the bed uplift rate.
+ *
+ * See LingleClarkSerial::bootstrap().
+ *
+ * @param[in] thickness load thickness, meters
+ * @param[in] uplift initial bed uplift on the PISM grid
+ *
+ * Sets m_Uv, m_Ue, m_U.
+ */
+void LingleClarkParallel::bootstrap(const IceModelVec2S &thickness,
+                                    const IceModelVec2S &uplift) {
+
+  // compute viscous displacement
+  uplift_problem(thickness, uplift);
+
+  if (m_include_elastic) {
+    compute_elastic_response(thickness, m_Ue);
+  } else {
+    m_Ue.set(0.0);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Initialize using provided plate displacement.
+ *
+ * @param[in] viscous_displacement initial viscous plate displacement (meters) on the extended grid
+ * @param[in] elastic_displacement initial viscous plate displacement (meters) on the regular grid
+ *
+ * Sets m_Uv, m_Ue, m_U.
+ */
+void LingleClarkParallel::init(const IceModelVec2S &viscous_displacement,
+                               const IceModelVec2S &elastic_displacement) {
+  m_Uv.copy_from(viscous_displacement);
+
+  // extract the central part of the viscous displacement
+  m_extended->set_real_part(m_Uv, 1.0, m_fftw_input);
+  m_center->get_real_part(m_fftw_input, 1.0, m_Uv_central);
+
+  if (m_include_elastic) {
+    m_Ue.copy_from(elastic_displacement);
+  } else {
+    m_Ue.set(0.0);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Perform a time step. See LingleClarkSerial::step().
+ *
+ * @param[in] dt time step length
+ * @param[in] H load thickness on the physical (Mx*My) grid
+ */
+void LingleClarkParallel::step(double dt, const IceModelVec2S &H) {
+
+  if (dt > 0.0) {
+    // Non-zero time step: include the viscous part of the model.
+
+    // Compute fft2(-load_density * g * dt * H) (the exponential integrator uses
+    // fft2(-load_density * g * H))
+    const double load_scale = m_exponential_integrator ? 1.0 : dt;
+    {
+      clear(m_fftw_input);
+      m_center->set_real_part(H, - m_load_density * m_standard_gravity * load_scale,
+                              m_fftw_input);
+      fftw_execute(m_dft_forward);
+
+      // Save fft2(-load_density * g * H * dt) in loadhat.
+      copy(m_fftw_output, m_loadhat);
+    }
+
+    // Compute fft2(u).
+    // no need to clear fftw_input: all values are overwritten
+    {
+      m_extended->set_real_part(m_Uv, 1.0, m_fftw_input);
+      fftw_execute(m_dft_forward);
+    }
+
+    // frhs = right.*fft2(uun) + fft2(dt*sszz);
+    // uun1 = real(ifft2(frhs./left));
+    {
+      FFTWArray input(m_fftw_input, m_slab_size, m_Ny),
+        u_hat(m_fftw_output, m_slab_size, m_Ny), load_hat(m_loadhat, m_slab_size, m_Ny);
+      for (int i = 0; i < m_slab_size; i++) {
+        const double cx = m_cx[m_slab_start + i];
+        for (int j = 0; j < m_Ny; j++) {
+          const double
+            C     = cx*cx + m_cy[j]*m_cy[j],
+            part1 = 2.0 * m_eta * sqrt(C),
+            R     = m_mantle_density * m_standard_gravity + m_D * C * C;
+
+          if (m_exponential_integrator) {
+            // Under a constant load each mode relaxes towards load / R with the time scale
+            // 2 eta |k| / R, so this is exact for any dt.
+            const double decay = part1 > 0.0 ? exp(- dt * R / part1) : 0.0;
+
+            input(i, j) = decay * u_hat(i, j) + (1.0 - decay) * load_hat(i, j) / R;
+          } else {
+            const double
+              part2 = (dt / 2.0) * R,
+              A     = part1 - part2,
+              B     = part1 + part2;
+
+            input(i, j) = (load_hat(i, j) + A * u_hat(i, j)) / B;
+          }
+        }
+      }
+    }
+
+    fftw_execute(m_dft_inverse);
+    m_extended->get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Uv);
+    m_center->get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Uv_central);
+
+    // Now tweak. (See the "correction" in section 5 of BuelerLingleBrown.)
+    //
+    // Here 1e16 approximates t = \infty.
+    tweak(H, 1e16);
+  } else {
+    // zero time step: viscous displacement is zero
+    m_Uv.set(0.0);
+    m_Uv_central.set(0.0);
+  }
+
+  // now compute elastic response if desired
+  if (m_include_elastic) {
+    compute_elastic_response(H, m_Ue);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Compute elastic response to the load H. See
+ * LingleClarkSerial::compute_elastic_response().
+ *
+ * @param[in] H load thickness (ice equivalent meters)
+ * @param[out] dE elastic plate displacement
+ */
+void LingleClarkParallel::compute_elastic_response(const IceModelVec2S &H,
+                                                   IceModelVec2S &dE) {
+
+  // Compute fft2(load_density * H)
+  {
+    clear(m_fftw_input);
+    m_corner->set_real_part(H, m_load_density, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  // fft2(m_response_matrix) * fft2(load_density*H)
+  {
+    FFTWArray
+      input(m_fftw_input, m_slab_size, m_Ny),
+      LRM_hat(m_lrm_hat, m_slab_size, m_Ny),
+      load_hat(m_fftw_output, m_slab_size, m_Ny);
+    for (int i = 0; i < m_slab_size; i++) {
+      for (int j = 0; j < m_Ny; j++) {
+        input(i, j) = LRM_hat(i, j) * load_hat(i, j);
+      }
+    }
+  }
+
+  // Compute the inverse transform and extract the elastic response.
+  fftw_execute(m_dft_inverse);
+  m_elastic->get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), dE);
+}
+
+/*! Compute total displacement by combining viscous and elastic contributions.
+ */
+void LingleClarkParallel::update_displacement() {
+  m_Uv_central.add(1.0, m_Ue, m_U);
+}
+
+/*!
+ * Modify the plate displacement to correct for the effect of imposing periodic boundary
+ * conditions at a finite distance. See LingleClarkSerial::tweak().
+ *
+ * @param[in] load_thickness thickness of the load (used to compute the corresponding disc volume)
+ * @param[in] time time, seconds (usually 0 or a large number approximating \infty)
+ */
+void LingleClarkParallel::tweak(const IceModelVec2S &load_thickness, double time) {
+
+  // find average value along "distant" boundary of [-Lx, Lx]X[-Ly, Ly]
+  double average = 0.0;
+  {
+    const IceGrid &grid = *m_Uv.grid();
+
+    IceModelVec::AccessList list(m_Uv);
+
+    for (Points p(grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      // note that u(0, 0) is counted twice (as in LingleClarkSerial::tweak())
+      if (j == 0) {
+        average += m_Uv(i, j);
+      }
+
+      if (i == 0) {
+        average += m_Uv(i, j);
+      }
+    }
+
+    average = GlobalSum(grid.com, average) / (double) (m_Nx + m_Ny);
+  }
+
+  double shift = 0.0;
+
+  if (time > 0.0) {
+    const double L_average = (m_Lx + m_Ly) / 2.0;
+    const double R         = L_average * (2.0 / 3.0);
+
+    // compute disc thickness by dividing its volume by the area
+    const double H = (load_thickness.sum() * m_dx * m_dy) / (M_PI * R * R);
+
+    shift = viscDisc(time,               // time in seconds
+                     H,                  // disc thickness
+                     R,                  // disc radius
+                     L_average,          // compute deflection at this radius
+                     m_mantle_density, m_load_density,    // mantle and load densities
+                     m_standard_gravity, //
+                     m_D,                // flexural rigidity
+                     m_eta);             // mantle viscosity
+  }
+
+  m_Uv.shift(shift - average);
+  m_Uv_central.shift(shift - average);
+}
+
+} // end of namespace bed
+} // end of namespace pism
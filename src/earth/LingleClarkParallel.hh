@@ -0,0 +1,163 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef LINGLECLARKPARALLEL_H
+#define LINGLECLARKPARALLEL_H
+
+#include <memory>
+#include <vector>
+
+#include <fftw3.h>
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/Logger.hh"
+
+namespace pism {
+
+class Config;
+class SlabScatter;
+
+namespace bed {
+
+//! Distributed version of LingleClarkSerial.
+/*!
+  Implements the same Fourier spectral method as LingleClarkSerial, but uses FFTW's MPI
+  interface so that the data stays distributed: the extended grid is split into slabs
+  (contiguous ranges of grid rows in the X direction), one slab per rank.
+
+  Data is moved between PISM's 2D domain decomposition and slabs using PETSc scatters.
+
+  LingleClarkSerial remains the reference implementation: both classes should produce
+  the same results up to rounding errors.
+*/
+class LingleClarkParallel {
+public:
+  LingleClarkParallel(Logger::ConstPtr log,
+                      const Config &config,
+                      bool include_elastic,
+                      IceGrid::ConstPtr grid,
+                      IceGrid::ConstPtr extended_grid);
+  ~LingleClarkParallel();
+
+  void init(const IceModelVec2S &viscous_displacement,
+            const IceModelVec2S &elastic_displacement);
+
+  void bootstrap(const IceModelVec2S &thickness, const IceModelVec2S &uplift);
+
+  void step(double dt_seconds, const IceModelVec2S &H);
+
+  const IceModelVec2S& total_displacement() const;
+
+  const IceModelVec2S& viscous_displacement() const;
+
+  const IceModelVec2S& elastic_displacement() const;
+
+  void compute_load_response_matrix(IceModelVec2S &output);
+private:
+  void compute_load_response_matrix(fftw_complex *output);
+
+  void compute_elastic_response(const IceModelVec2S &H, IceModelVec2S &dE);
+
+  void uplift_problem(const IceModelVec2S &load_thickness,
+                      const IceModelVec2S &bed_uplift);
+
+  void precompute_coefficients();
+
+  void update_displacement();
+
+  void tweak(const IceModelVec2S &load_thickness, double time);
+
+  void clear(fftw_complex *input);
+  void copy(fftw_complex *source, fftw_complex *destination);
+
+  bool m_include_elastic;
+  //! use the exponential integrator (instead of Crank-Nicolson) for the viscous part
+  bool m_exponential_integrator;
+  // grid size
+  int m_Mx;
+  int m_My;
+  // grid spacing
+  double m_dx;
+  double m_dy;
+  //! load density (for computing load from its thickness)
+  double m_load_density;
+  //! mantle density
+  double m_mantle_density;
+  //! mantle viscosity
+  double m_eta;
+  //! lithosphere flexural rigidity
+  double m_D;
+
+  // acceleration due to gravity
+  double m_standard_gravity;
+
+  // size of the extended grid
+  int m_Nx;
+  int m_Ny;
+
+  // indices into extended grid for the corner of the physical grid
+  int m_i0_offset;
+  int m_j0_offset;
+
+  // half-lengths of the extended (FFT, spectral) computational domain
+  double m_Lx;
+  double m_Ly;
+
+  // the range of rows (in the X direction) of the extended grid owned by this rank
+  int m_slab_start;
+  int m_slab_size;
+
+  // Coefficients of derivatives in Fourier space
+  std::vector<double> m_cx, m_cy;
+
+  // viscous displacement on the extended grid
+  IceModelVec2S m_Uv;
+
+  // central part of the viscous displacement (on the PISM grid)
+  IceModelVec2S m_Uv_central;
+
+  // elastic plate displacement
+  IceModelVec2S m_Ue;
+
+  // total (viscous and elastic) plate displacement
+  IceModelVec2S m_U;
+
+  //! PISM grid <-> extended grid with the physical grid in the center
+  std::unique_ptr<SlabScatter> m_center;
+  //! PISM grid <-> extended grid with the physical grid in the corner
+  std::unique_ptr<SlabScatter> m_corner;
+  //! PISM grid <-> part of the extended grid containing the elastic response
+  std::unique_ptr<SlabScatter> m_elastic;
+  //! extended grid <-> extended grid
+  std::unique_ptr<SlabScatter> m_extended;
+
+  fftw_complex *m_fftw_input;
+  fftw_complex *m_fftw_output;
+  fftw_complex *m_loadhat;
+  fftw_complex *m_lrm_hat;
+
+  fftw_plan m_dft_forward;
+  fftw_plan m_dft_inverse;
+
+  Logger::ConstPtr m_log;
+};
+
+} // end of namespace bed
+} // end of namespace pism
+
+#endif /* LINGLECLARKPARALLEL_H */
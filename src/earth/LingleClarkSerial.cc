@@ -17,7 +17,7 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cassert>
-#include <cmath>                // sqrt
+#include <cmath>                // sqrt, exp
 #include <fftw3.h>
 #include <gsl/gsl_math.h>       // M_PI
 
@@ -30,6 +30,8 @@
 #include "pism/util/error_handling.hh"
 #include "pism/util/petscwrappers/Vec.hh"
 #include "pism/util/fftw_utilities.hh"
+#include "pism/util/io/File.hh"
+#include "pism/util/io/io_helpers.hh"
 
 namespace pism {
 namespace bed {
@@ -54,6 +56,7 @@ LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
 
   // set parameters
   m_include_elastic = include_elastic;
+  m_exponential_integrator = config.get_string("bed_deformation.lc.time_stepping") == "exponential";
 
   if (include_elastic) {
     // check if the extended grid is large enough (it has to be at least twice the size of
@@ -82,6 +85,8 @@ LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
 
   m_standard_gravity = config.get_number("constants.standard_gravity");
 
+  m_lrm_file = config.get_string("bed_deformation.lc.load_response_matrix_file");
+
   // derive more parameters
   m_Lx        = 0.5 * (m_Nx - 1.0) * m_dx;
   m_Ly        = 0.5 * (m_Ny - 1.0) * m_dy;
@@ -109,11 +114,21 @@ LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
   m_loadhat     = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
   m_lrm_hat = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
 
+  {
+    unsigned int flags = fftw_planner_flags(config);
+    std::string wisdom_file = config.get_string("fftw.wisdom_file");
+
+    fftw_load_wisdom(wisdom_file);
+
+    m_dft_forward = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                     FFTW_FORWARD, flags);
+    m_dft_inverse = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                     FFTW_BACKWARD, flags);
+
+    fftw_save_wisdom(wisdom_file);
+  }
+  // planning with FFTW_MEASURE overwrites arrays, so we clear input *after* planning
   clear_fftw_array(m_fftw_input, m_Nx, m_Ny);
-  m_dft_forward = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
-                                   FFTW_FORWARD, FFTW_ESTIMATE);
-  m_dft_inverse = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
-                                   FFTW_BACKWARD, FFTW_ESTIMATE);
 
   // Note: FFTW is weird. If a malloc() call fails it will just call
   // abort() on you without giving you a chance to recover or tell the
@@ -212,6 +227,77 @@ void LingleClarkSerial::compute_load_response_matrix(fftw_complex *output) {
   }
 }
 
+/*!
+ * Read the load response matrix from `filename`.
+ *
+ * Returns false if the file does not exist or if the matrix stored in it was computed
+ * using a different grid.
+ */
+bool LingleClarkSerial::read_load_response_matrix(const std::string &filename,
+                                                  fftw_complex *output) {
+  if (filename.empty() or not file_exists(MPI_COMM_SELF, filename)) {
+    return false;
+  }
+
+  File file(MPI_COMM_SELF, filename, PISM_NETCDF3, PISM_READONLY);
+
+  if (not file.find_variable("lrm")) {
+    return false;
+  }
+
+  auto spacing = file.read_double_attribute("lrm", "grid_spacing");
+
+  if ((int)file.dimension_length("lrm_x") != m_Nx or
+      (int)file.dimension_length("lrm_y") != m_Ny or
+      spacing.size() != 2 or
+      std::abs(spacing[0] - m_dx) > 1e-12 * m_dx or
+      std::abs(spacing[1] - m_dy) > 1e-12 * m_dy) {
+    return false;
+  }
+
+  std::vector<double> buffer(m_Nx * m_Ny);
+  file.read_variable("lrm", {0, 0}, {(unsigned int)m_Nx, (unsigned int)m_Ny},
+                     buffer.data());
+
+  // the last dimension (Y) is contiguous, just like in FFTWArray
+  FFTWArray LRM(output, m_Nx, m_Ny);
+  for (int i = 0; i < m_Nx; ++i) {
+    for (int j = 0; j < m_Ny; ++j) {
+      LRM(i, j) = buffer[j + m_Ny * i];
+    }
+  }
+
+  return true;
+}
+
+/*!
+ * Save the load response matrix to `filename`.
+ */
+void LingleClarkSerial::write_load_response_matrix(const std::string &filename,
+                                                   fftw_complex *input) {
+  File file(MPI_COMM_SELF, filename, PISM_NETCDF3, PISM_READWRITE_CLOBBER);
+
+  file.define_dimension("lrm_x", m_Nx);
+  file.define_dimension("lrm_y", m_Ny);
+  file.define_variable("lrm", PISM_DOUBLE, {"lrm_x", "lrm_y"});
+  file.write_attribute("lrm", "long_name",
+                       "load response matrix of the elastic part of the Lingle-Clark model");
+  file.write_attribute("lrm", "grid_spacing", PISM_DOUBLE, {m_dx, m_dy});
+  file.enddef();
+
+  std::vector<double> buffer(m_Nx * m_Ny);
+
+  FFTWArray LRM(input, m_Nx, m_Ny);
+  for (int i = 0; i < m_Nx; ++i) {
+    for (int j = 0; j < m_Ny; ++j) {
+      buffer[j + m_Ny * i] = LRM(i, j).real();
+    }
+  }
+
+  file.write_variable("lrm", {0, 0}, {(unsigned int)m_Nx, (unsigned int)m_Ny},
+                      buffer.data());
+}
+
 /**
  * Pre-compute coefficients used by the model.
  */
@@ -224,9 +310,20 @@ void LingleClarkSerial::precompute_coefficients() {
 
   // compare geforconv.m
   if (m_include_elastic) {
-    m_log->message(2, "     computing spherical elastic load response matrix ...");
-    {
+    if (read_load_response_matrix(m_lrm_file, m_fftw_input)) {
+      m_log->message(2, "     read spherical elastic load response matrix from '%s' ...",
+                     m_lrm_file.c_str());
+    } else {
+      m_log->message(2, "     computing spherical elastic load response matrix ...");
+
       compute_load_response_matrix(m_fftw_input);
+
+      if (not m_lrm_file.empty()) {
+        write_load_response_matrix(m_lrm_file, m_fftw_input);
+      }
+    }
+
+    {
       // Compute fft2(LRM) and save it in m_lrm_hat
       fftw_execute(m_dft_forward);
       copy_fftw_array(m_fftw_output, m_lrm_hat, m_Nx, m_Ny);
@@ -364,6 +461,11 @@ void LingleClarkSerial::step(double dt, Vec H) {
   // where U=plate displacement; see equation (7) in
   // Bueler, Lingle, Brown (2007) "Fast computation of a viscoelastic
   // deformable Earth model for ice sheet simulations", Ann. Glaciol. 46, 97--105
+  //
+  // If bed_deformation.lc.time_stepping is "exponential", each Fourier mode is instead
+  // advanced using the exact solution of
+  //     2 eta |grad| dU/dt + rho_r g U + D grad^4 U = -rho g H_start,
+  // which is accurate for any dt.
 
   // Compute viscous displacement if dt > 0 and bypass this computation if dt == 0.
   //
@@ -371,11 +473,13 @@ void LingleClarkSerial::step(double dt, Vec H) {
   if (dt > 0.0) {
     // Non-zero time step: include the viscous part of the model.
 
-    // Compute fft2(-load_density * g * dt * H)
+    // Compute fft2(-load_density * g * dt * H) (the exponential integrator uses
+    // fft2(-load_density * g * H))
+    const double load_scale = m_exponential_integrator ? 1.0 : dt;
     {
       clear_fftw_array(m_fftw_input, m_Nx, m_Ny);
       set_real_part(H,
-                    - m_load_density * m_standard_gravity * dt,
+                    - m_load_density * m_standard_gravity * load_scale,
                     m_Mx, m_My, m_Nx, m_Ny, m_i0_offset, m_j0_offset,
                     m_fftw_input);
       fftw_execute(m_dft_forward);
@@ -401,11 +505,22 @@ void LingleClarkSerial::step(double dt, Vec H) {
           const double
             C     = m_cx[i]*m_cx[i] + m_cy[j]*m_cy[j],
             part1 = 2.0 * m_eta * sqrt(C),
-            part2 = (dt / 2.0) * (m_mantle_density * m_standard_gravity + m_D * C * C),
-            A = part1 - part2,
-            B = part1 + part2;
-
-          input(i, j) = (load_hat(i, j) + A * u_hat(i, j)) / B;
+            R     = m_mantle_density * m_standard_gravity + m_D * C * C;
+
+          if (m_exponential_integrator) {
+            // Under a constant load each mode relaxes towards load / R with the time scale
+            // 2 eta |k| / R, so this is exact for any dt.
+            const double decay = part1 > 0.0 ? exp(- dt * R / part1) : 0.0;
+
+            input(i, j) = decay * u_hat(i, j) + (1.0 - decay) * load_hat(i, j) / R;
+          } else {
+            const double
+              part2 = (dt / 2.0) * R,
+              A     = part1 - part2,
+              B     = part1 + part2;
+
+            input(i, j) = (load_hat(i, j) + A * u_hat(i, j)) / B;
+          }
         }
       }
     }
@@ -20,10 +20,10 @@
 #define LINGLECLARKSERIAL_H
 
 #include <vector>
+#include <string>
 
 #include <petscvec.h>
 #include <fftw3.h>
-#include <vector>
 
 #include "pism/util/petscwrappers/Vec.hh"
 #include "pism/util/Logger.hh"
@@ -85,9 +85,14 @@ private:
 
   void precompute_coefficients();
 
+  bool read_load_response_matrix(const std::string &filename, fftw_complex *output);
+  void write_load_response_matrix(const std::string &filename, fftw_complex *input);
+
   void update_displacement(Vec V, Vec dE, Vec dU);
 
   bool m_include_elastic;
+  //! use the exponential integrator (instead of Crank-Nicolson) for the viscous part
+  bool m_exponential_integrator;
   // grid size
   int m_Mx;
   int m_My;
@@ -106,6 +111,9 @@ private:
   // acceleration due to gravity
   double m_standard_gravity;
 
+  //! name of the file used to cache the load response matrix (empty if disabled)
+  std::string m_lrm_file;
+
   // size of the extended grid
   int m_Nx;
   int m_Ny;
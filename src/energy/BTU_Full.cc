@@ -171,23 +171,38 @@ void BTU_Full::update_impl(const IceModelVec2S &bedrock_top_temperature,
 
   IceModelVec::AccessList list{m_temp.get(), &m_bottom_surface_flux, &bedrock_top_temperature};
 
+  // Columns in a row of the grid are updated together, re-using the factorization of the
+  // system matrix (it does not depend on the column).
+  const int
+    xs = m_grid->xs(),
+    xm = m_grid->xm(),
+    ys = m_grid->ys(),
+    ym = m_grid->ym();
+
+  std::vector<double> Q_bottom(xm), T_top(xm);
+  std::vector<double*> T(xm);
+
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+    for (int j = ys; j < ys + ym; ++j) {
+      for (int c = 0; c < xm; ++c) {
+        const int i = xs + c;
 
-      double *T = m_temp->get_column(i, j);
+        Q_bottom[c] = m_bottom_surface_flux(i, j);
+        T_top[c]    = bedrock_top_temperature(i, j);
+        T[c]        = m_temp->get_column(i, j);
+      }
 
-      m_column->solve(dt, m_bottom_surface_flux(i, j), bedrock_top_temperature(i, j),
-                      T,  // input
-                      T); // output
+      m_column->solve(dt, xm, Q_bottom.data(), T_top.data(), T.data());
 
       // Check that T is positive:
-      for (unsigned int k = 0; k < m_Mbz; ++k) {
-        if (T[k] <= 0.0) {
-          throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                        "invalid bedrock temperature: %f Kelvin at %d,%d,%d",
-                                        T[k], i, j, k);
+      for (int c = 0; c < xm; ++c) {
+        for (unsigned int k = 0; k < m_Mbz; ++k) {
+          if (T[c][k] <= 0.0) {
+            throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                          "invalid bedrock temperature: %f Kelvin at %d,%d,%d",
+                                          T[c][k], xs + c, j, k);
+          }
         }
       }
     }
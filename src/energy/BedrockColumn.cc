@@ -22,13 +22,14 @@
 #include "BedrockColumn.hh"
 
 #include "pism/util/ConfigInterface.hh"
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 namespace energy {
 
 BedrockColumn::BedrockColumn(const std::string& prefix,
                              const Config& config, double dz, unsigned int M)
-  : m_dz(dz), m_M(M), m_system(M, prefix) {
+  : m_dz(dz), m_M(M), m_prefix(prefix), m_dt(-1.0), m_R(0.0) {
 
   assert(M > 1);
 
@@ -38,12 +39,70 @@ BedrockColumn::BedrockColumn(const std::string& prefix,
 
   m_k   = config.get_number("energy.bedrock_thermal.conductivity");
   m_D   = m_k / (rho * c);
+
+  m_L.resize(m_M);
+  m_b.resize(m_M);
+  m_w.resize(m_M);
 }
 
 BedrockColumn::~BedrockColumn() {
   // empty
 }
 
+/*!
+ * Compute and store the LU factorization of the system matrix corresponding to the time
+ * step `dt`. Does nothing if the matrix for this `dt` is already factored.
+ *
+ * This uses the same elimination as TridiagonalSystem::solve(), so results do not depend
+ * on whether the factorization is re-used or not.
+ */
+void BedrockColumn::factor(double dt) {
+  if (dt == m_dt) {
+    return;
+  }
+
+  const double R = m_D * dt / (m_dz * m_dz);
+  const unsigned int N = m_M - 1;
+
+  std::vector<double> D(m_M), U(m_M);
+
+  m_L[0] = 0.0;                 // not used
+  D[0]   = 1.0 + 2.0 * R;
+  U[0]   = -2.0 * R;
+
+  for (unsigned int k = 1; k < N; ++k) {
+    m_L[k] = -R;
+    D[k]   = 1.0 + 2.0 * R;
+    U[k]   = -R;
+  }
+
+  m_L[N] = 0.0;
+  D[N]   = 1.0;
+  U[N]   = 0.0;                 // not used
+
+  m_b[0] = D[0];
+  m_w[0] = 0.0;                 // not used
+  for (unsigned int k = 1; k < m_M; ++k) {
+    m_w[k] = U[k - 1] / m_b[k - 1];
+    m_b[k] = D[k] - m_L[k] * m_w[k];
+
+    if (m_b[k] == 0.0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "zero pivot at row %d (%s)", k + 1, m_prefix.c_str());
+    }
+  }
+
+  m_dt = dt;
+  m_R  = R;
+}
+
+//! Right-hand side of the first (bottom) equation.
+double BedrockColumn::rhs_bottom(double Q_bottom, double T_bottom) const {
+  const double G = -Q_bottom / m_k;
+
+  return T_bottom - 2.0 * G * m_dz * m_R;
+}
+
 /*!
  * Advance the heat equation in time.
  *
@@ -57,30 +116,63 @@ BedrockColumn::~BedrockColumn() {
  */
 void BedrockColumn::solve(double dt, double Q_bottom, double T_top,
                           const double *T_old, double *T_new) {
+  factor(dt);
 
-  double R = m_D * dt / (m_dz * m_dz);
-  double G = -Q_bottom / m_k;
+  const unsigned int N = m_M - 1;
+
+  // forward substitution
+  T_new[0] = rhs_bottom(Q_bottom, T_old[0]) / m_b[0];
+  for (unsigned int k = 1; k < N; ++k) {
+    T_new[k] = (T_old[k] - m_L[k] * T_new[k - 1]) / m_b[k];
+  }
+  T_new[N] = (T_top - m_L[N] * T_new[N - 1]) / m_b[N];
+
+  // back substitution
+  for (int k = N - 1; k >= 0; --k) {
+    T_new[k] -= m_w[k + 1] * T_new[k + 1];
+  }
+}
 
-  m_system.L(0)   = 0.0;                 // not used
-  m_system.D(0)   = 1.0 + 2.0 * R;
-  m_system.U(0)   = -2.0 * R;
-  m_system.RHS(0) = T_old[0] - 2.0 * G * m_dz * R;
+/*!
+ * Advance the heat equation in time in `n_columns` columns at once, re-using the
+ * factorization of the system matrix.
+ *
+ * @param[in] dt time step length
+ * @param[in] n_columns number of columns
+ * @param[in] Q_bottom heat flux into each column through the bottom surface
+ * @param[in] T_top temperature at the top surface of each column
+ * @param[in,out] T pointers to temperature in each column; overwritten with new values
+ *
+ * The loop over columns is the inner loop, so that the compiler can vectorize it.
+ */
+void BedrockColumn::solve(double dt, unsigned int n_columns,
+                          const double *Q_bottom, const double *T_top,
+                          double * const *T) {
+  factor(dt);
 
-  unsigned int N = m_M - 1;
+  const unsigned int N = m_M - 1;
 
+  // forward substitution
+  for (unsigned int c = 0; c < n_columns; ++c) {
+    T[c][0] = rhs_bottom(Q_bottom[c], T[c][0]) / m_b[0];
+  }
   for (unsigned int k = 1; k < N; ++k) {
-    m_system.L(k)   = -R;
-    m_system.D(k)   = 1.0 + 2.0 * R;
-    m_system.U(k)   = -R;
-    m_system.RHS(k) = T_old[k];
+    const double L = m_L[k], b = m_b[k];
+    for (unsigned int c = 0; c < n_columns; ++c) {
+      T[c][k] = (T[c][k] - L * T[c][k - 1]) / b;
+    }
+  }
+  for (unsigned int c = 0; c < n_columns; ++c) {
+    T[c][N] = (T_top[c] - m_L[N] * T[c][N - 1]) / m_b[N];
   }
 
-  m_system.L(N)   = 0.0;
-  m_system.D(N)   = 1.0;
-  m_system.U(N)   = 0.0;                 // not used
-  m_system.RHS(N) = T_top;
-
-  m_system.solve(m_M, T_new);
+  // back substitution
+  for (int k = N - 1; k >= 0; --k) {
+    const double w = m_w[k + 1];
+    for (unsigned int c = 0; c < n_columns; ++c) {
+      T[c][k] -= w * T[c][k + 1];
+    }
+  }
 }
 
 /*!
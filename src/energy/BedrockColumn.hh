@@ -19,7 +19,8 @@
 #ifndef BEDROCK_COLUMN_HH
 #define BEDROCK_COLUMN_HH
 
-#include "pism/util/ColumnSystem.hh"
+#include <string>
+#include <vector>
 
 namespace pism {
 
@@ -35,6 +36,10 @@ namespace energy {
  *
  * The implementation uses a second-order discretization in space and the backward-Euler
  * (first-order, fully implicit) time-discretization.
+ *
+ * Material properties and the grid do not change in time, so the system matrix depends on
+ * the time step length only. It is factored once per time step length and the
+ * factorization is re-used by all columns (see factor()).
  */
 class BedrockColumn {
 public:
@@ -49,7 +54,15 @@ public:
              const std::vector<double> &T_old,
              std::vector<double> &result);
 
+  void solve(double dt, unsigned int n_columns,
+             const double *Q_bottom, const double *T_top,
+             double * const *T);
+
 private:
+  void factor(double dt);
+
+  double rhs_bottom(double Q_bottom, double T_bottom) const;
+
   // temperature diffusivity coefficient
   double m_D;
   // thermal conductivity
@@ -59,7 +72,19 @@ private:
   // system size
   unsigned int m_M;
 
-  TridiagonalSystem m_system;
+  std::string m_prefix;
+
+  // time step length corresponding to the current factorization (negative if the system
+  // was not factored yet)
+  double m_dt;
+  // R = D * dt / dz^2 corresponding to m_dt
+  double m_R;
+  // lower-diagonal entries
+  std::vector<double> m_L;
+  // pivots (diagonal entries of the upper-triangular factor)
+  std::vector<double> m_b;
+  // super-diagonal entries of the upper-triangular factor (divided by pivots)
+  std::vector<double> m_w;
 };
 
 } // end of namespace energy
@@ -155,7 +155,7 @@ void CHSystem::update_impl(double t, double dt, const Inputs &inputs) {
   IceModelVec::AccessList list{&ice_surface_temp, &shelf_base_temp, &surface_liquid_fraction,
       &ice_thickness, &basal_frictional_heating, &basal_heat_flux,
       &cell_type, &u3, &v3, &w3, &volumetric_heat, &m_ice_enthalpy,
-      &m_work};
+      m_work.get()};
 
   double
     margin_threshold = m_config->get_number("energy.margin_ice_thickness_limit"),
@@ -176,7 +176,7 @@ void CHSystem::update_impl(double t, double dt, const Inputs &inputs) {
         // We use surface temperature to determine if we're in a melt season or not. It
         // probably makes sense to use the surface mass balance instead.
 
-        double *column = m_work.get_column(i, j);
+        double *column = m_work->get_column(i, j);
         for (unsigned int k = 0; k < Mz; ++k) {
           double
             depth = std::max(H - z[k], 0.0),
@@ -204,7 +204,7 @@ void CHSystem::update_impl(double t, double dt, const Inputs &inputs) {
 
       // deal completely with columns with no ice
       if (ice_free_column) {
-        m_work.set_column(i, j, Enth_ks);
+        m_work->set_column(i, j, Enth_ks);
         continue;
       } // end of if (ice_free_column)
 
@@ -230,7 +230,7 @@ void CHSystem::update_impl(double t, double dt, const Inputs &inputs) {
         system.solve(Enthnew);
       }
 
-      system.fine_to_coarse(Enthnew, i, j, m_work);
+      system.fine_to_coarse(Enthnew, i, j, *m_work);
     }
   } catch (...) {
     loop.failed();
@@ -246,6 +246,22 @@ void CHSystem::write_model_state_impl(const File &output) const {
   m_ice_enthalpy.write(output);
 }
 
+/*!
+ * Heat flux corresponding to the cryo-hydrologic warming at a point at the given depth
+ * below the ice surface.
+ *
+ * `C = k / R**2`, see below.
+ */
+double cryo_hydrologic_warming_flux(double C, double depth,
+                                    double E_ice, double E_ch,
+                                    const EnthalpyConverter &EC) {
+  if (depth > 0.0) {
+    double P = EC.pressure(depth);
+    return std::max(C * (EC.temperature(E_ch, P) - EC.temperature(E_ice, P)), 0.0);
+  }
+  return 0.0;
+}
+
 /*!
  * Compute the heat flux corresponding to the cryo-hydrologic warming.
  *
@@ -283,16 +299,8 @@ void cryo_hydrologic_warming_flux(double k,
       double *Q = result.get_column(i, j);
 
       for (unsigned int m = 0; m < Mz; ++m) {
-        double
-          depth = ice_thickness(i, j) - z[m];
-
-        if (depth > 0.0) {
-          double P = EC->pressure(depth);
-          Q[m] = std::max(C * (EC->temperature(E_ch[m], P) - EC->temperature(E_ice[m], P)),
-                          0.0);
-        } else {
-          Q[m] = 0.0;
-        }
+        Q[m] = cryo_hydrologic_warming_flux(C, ice_thickness(i, j) - z[m],
+                                            E_ice[m], E_ch[m], *EC);
       }
     }
   } catch (...) {
@@ -21,6 +21,7 @@
 #define CHSYSTEM_H
 
 #include "EnergyModel.hh"
+#include "pism/util/EnthalpyConverter.hh"
 
 namespace pism {
 namespace energy {
@@ -49,8 +50,16 @@ protected:
 
   void define_model_state_impl(const File &output) const;
   void write_model_state_impl(const File &output) const;
+
+  // EnthalpyModel::update_impl() can update this system in the same pass over columns
+  // (see EnthalpyModel::set_cryo_hydrologic_system())
+  friend class EnthalpyModel;
 };
 
+double cryo_hydrologic_warming_flux(double C, double depth,
+                                    double E_ice, double E_ch,
+                                    const EnthalpyConverter &EC);
+
 void cryo_hydrologic_warming_flux(double k,
                                   double R,
                                   const IceModelVec2S &ice_thickness,
@@ -128,7 +128,7 @@ void EnergyModelStats::sum(MPI_Comm com) {
 
 EnergyModel::EnergyModel(IceGrid::ConstPtr grid,
                          stressbalance::StressBalance *stress_balance)
-  : Component(grid), m_stress_balance(stress_balance) {
+  : Component(grid), m_ghosts_updater(grid), m_stress_balance(stress_balance) {
 
   const unsigned int WIDE_STENCIL = m_config->get_number("grid.max_stencil_width");
 
@@ -151,13 +151,7 @@ EnergyModel::EnergyModel(IceGrid::ConstPtr grid,
     m_basal_melt_rate.metadata().set_string("comment", "positive basal melt rate corresponds to ice loss");
   }
 
-  // a 3d work vector
-  {
-    m_work.create(m_grid, "work_vector", WITHOUT_GHOSTS);
-    m_work.set_attrs("internal",
-                     "usually new values of temperature or enthalpy during time step",
-                     "", "", "", 0);
-  }
+  m_pool = IceModelVecPool::shared(m_grid);
 }
 
 void EnergyModel::init_enthalpy(const File &input_file, bool do_regrid, int record) {
@@ -169,8 +163,10 @@ void EnergyModel::init_enthalpy(const File &input_file, bool do_regrid, int reco
       m_ice_enthalpy.read(input_file, record);
     }
   } else if (input_file.find_variable("temp")) {
+    IceModelVec3::Ptr temp_storage = m_pool->volume("temp");
+
     IceModelVec3
-      &temp    = m_work,
+      &temp    = *temp_storage,
       &liqfrac = m_ice_enthalpy;
 
     {
@@ -271,6 +267,19 @@ void EnergyModel::initialize(const IceModelVec2S &basal_melt_rate,
                         basal_heat_flux);
 }
 
+/*!
+ * Update ghosts of enthalpy in the ice, using the current ice thickness.
+ *
+ * Does nothing unless `grid.restrict_3d_halo_exchange` is set: otherwise update() updates
+ * all ghosts. Skips the exchange if neither enthalpy nor the ice thickness changed since
+ * the last one.
+ */
+void EnergyModel::update_ghosts(const IceModelVec2S &ice_thickness) {
+  if (m_config->get_flag("grid.restrict_3d_halo_exchange")) {
+    m_ghosts_updater.update(ice_thickness, m_ice_enthalpy);
+  }
+}
+
 void EnergyModel::update(double t, double dt, const Inputs &inputs) {
   // reset standard out flags at the beginning of every time step
   m_stdout_flags = "";
@@ -280,10 +289,34 @@ void EnergyModel::update(double t, double dt, const Inputs &inputs) {
 
   profiling.begin("ice_energy");
   {
+    const bool restricted = m_config->get_flag("grid.restrict_3d_halo_exchange");
+
+    if (restricted) {
+      // the ice extent may have changed since the last exchange
+      update_ghosts(*inputs.ice_thickness);
+    }
+
+    m_work = m_pool->volume("work_vector");
+
     // this call should fill m_work with new values of enthalpy
     this->update_impl(t, dt, inputs);
 
-    m_work.update_ghosts(m_ice_enthalpy);
+    if (restricted) {
+      // ghosts are updated right before they are used (see update_ghosts())
+      IceModelVec::AccessList list{m_work.get(), &m_ice_enthalpy};
+
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        m_ice_enthalpy.set_column(i, j, m_work->get_column(i, j));
+      }
+      m_ice_enthalpy.inc_state_counter();
+    } else {
+      m_work->update_ghosts(m_ice_enthalpy);
+    }
+
+    // return work space to the pool
+    m_work.reset();
   }
   profiling.end("ice_energy");
 
@@ -23,6 +23,7 @@
 #include "pism/util/Component.hh"
 
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/IceModelVecPool.hh"
 
 namespace pism {
 
@@ -97,6 +98,8 @@ public:
 
   void update(double t, double dt, const Inputs &inputs);
 
+  void update_ghosts(const IceModelVec2S &ice_thickness);
+
   const EnergyModelStats& stats() const;
 
   const IceModelVec3 & enthalpy() const;
@@ -137,8 +140,13 @@ protected:
   void regrid_enthalpy();
 protected:
   IceModelVec3 m_ice_enthalpy;
-  IceModelVec3 m_work;
+  //! new values of temperature or enthalpy during a time step (borrowed from m_pool for
+  //! the duration of update())
+  IceModelVec3::Ptr m_work;
+  IceModelVecPool::Ptr m_pool;
   IceModelVec2S m_basal_melt_rate;
+  //! updates ghosts of m_ice_enthalpy if grid.restrict_3d_halo_exchange is set
+  IceGhostsUpdater m_ghosts_updater;
 
   EnergyModelStats m_stats;
 
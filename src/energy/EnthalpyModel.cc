@@ -17,8 +17,12 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cassert>
+#include <memory>               // std::unique_ptr
+
 #include "EnthalpyModel.hh"
 
+#include "CHSystem.hh"
 #include "DrainageCalculator.hh"
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/energy/enthSystem.hh"
@@ -30,12 +34,35 @@
 namespace pism {
 namespace energy {
 
+EnthalpyModel::Parameters::Parameters(const Config &config) {
+  ice_density           = config.get_number("constants.ice.density");
+  cold_bulge_max        = config.get_number("energy.enthalpy.cold_bulge_max");
+  target_water_fraction = config.get_number("energy.drainage_target_water_fraction");
+  margin_threshold      = config.get_number("energy.margin_ice_thickness_limit");
+  tillwat_max           = config.get_number("hydrology.tillwat_max");
+  use_storage_grid      = config.get_flag("energy.enthalpy.use_storage_grid");
+}
+
 EnthalpyModel::EnthalpyModel(IceGrid::ConstPtr grid,
                              stressbalance::StressBalance *stress_balance)
-  : EnergyModel(grid, stress_balance) {
+  : EnergyModel(grid, stress_balance),
+    m_parameters(*m_config),
+    m_ch_system(NULL) {
   // empty
 }
 
+//! Update the enthalpy of the cryo-hydrologic system `ch_system` in the same pass over
+//! columns as the ice enthalpy.
+/*!
+ * Both systems read the same velocity columns and are coupled by the cryo-hydrologic
+ * warming flux (see cryo_hydrologic_warming_flux()), so they are assembled in the same
+ * column visit and solved together using TridiagonalSystemBatch. Once this is set,
+ * `ch_system` should not be updated separately.
+ */
+void EnthalpyModel::set_cryo_hydrologic_system(CHSystem *ch_system) {
+  m_ch_system = ch_system;
+}
+
 void EnthalpyModel::restart_impl(const File &input_file, int record) {
 
   m_log->message(2, "* Restarting the enthalpy-based energy balance model from %s...\n",
@@ -102,6 +129,9 @@ No communication of ghosts is done for any of these fields.
 
 We use an instance of enthSystemCtx.
 
+If set_cryo_hydrologic_system() was called, this method also updates the enthalpy of the
+cryo-hydrologic system (including its ghosts).
+
 Regarding drainage, see [\ref AschwandenBuelerKhroulevBlatter] and references therein.
  */
 
@@ -112,9 +142,9 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
   EnthalpyConverter::Ptr EC = m_grid->ctx()->enthalpy_converter();
 
   const double
-    ice_density           = m_config->get_number("constants.ice.density"), // kg m-3
-    bulgeEnthMax          = m_config->get_number("energy.enthalpy.cold_bulge_max"), // J kg-1
-    target_water_fraction = m_config->get_number("energy.drainage_target_water_fraction");
+    ice_density           = m_parameters.ice_density, // kg m-3
+    bulgeEnthMax          = m_parameters.cold_bulge_max, // J kg-1
+    target_water_fraction = m_parameters.target_water_fraction;
 
   energy::DrainageCalculator dc(*m_config);
 
@@ -138,257 +168,404 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
     &ice_surface_temp         = *inputs.surface_temp,
     &till_water_thickness     = *inputs.till_water_thickness;
 
-  energy::enthSystemCtx system(m_grid->z(), "energy.enthalpy", m_grid->dx(), m_grid->dy(), dt,
-                               *m_config, m_ice_enthalpy, u3, v3, w3, strain_heating3, EC);
-
-  const size_t Mz_fine = system.z().size();
-  const double dz = system.dz();
-  std::vector<double> Enthnew(Mz_fine); // new enthalpy in column
-
   IceModelVec::AccessList list{&ice_surface_temp, &shelf_base_temp, &surface_liquid_fraction,
       &ice_thickness, &basal_frictional_heating, &basal_heat_flux, &till_water_thickness,
       &cell_type, &u3, &v3, &w3, &strain_heating3, &m_basal_melt_rate, &m_ice_enthalpy,
-      &m_work};
+      m_work.get()};
+
+  // set in regional runs
+  const IceModelVec2Int *no_model_mask = inputs.no_model_mask;
+  if (no_model_mask) {
+    list.add(*no_model_mask);
+  }
 
-  double margin_threshold = m_config->get_number("energy.margin_ice_thickness_limit");
-  
-  double tillwatmax  = m_config->get_number("hydrology.tillwat_max"),
+  double margin_threshold = m_parameters.margin_threshold;
+
+  double tillwatmax  = m_parameters.tillwat_max,
          one_year = units::convert(m_sys, 1.0, "year", "seconds"),
          H_critical = tillwatmax * dt / one_year;
 
-  unsigned int liquifiedCount = 0;
+  unsigned int
+    reduced_accuracy_counter = 0,
+    bulge_counter            = 0;
+
+  // total thickness of liquified ice segments
+  double liquified_thickness = 0.0;
+
+  const bool use_storage_grid = m_parameters.use_storage_grid;
+
+  // the cryo-hydrologic system (if any) is updated in the same pass
+  IceModelVec3::Ptr ch_work;
+  const IceModelVec3 *ch_enthalpy = NULL;
+  IceModelVec3 *ch_enthalpy_new = NULL;
+  double
+    ch_C                       = 0.0,
+    ch_residual_water_fraction = 0.0,
+    T_pm                       = 0.0;
+  if (m_ch_system) {
+    ch_work         = m_pool->volume("ch_work_vector");
+    ch_enthalpy     = &m_ch_system->m_ice_enthalpy;
+    ch_enthalpy_new = ch_work.get();
+    list.add(*ch_enthalpy);
+    list.add(*ch_enthalpy_new);
+
+    const double
+      k = m_config->get_number("constants.ice.thermal_conductivity"),
+      R = m_config->get_number("energy.ch_warming.average_channel_spacing");
+
+    ch_C                       = k / (R * R);
+    ch_residual_water_fraction = m_config->get_number("energy.ch_warming.residual_water_fraction");
+    T_pm                       = m_config->get_number("constants.fresh_water.melting_point_temperature");
+  }
+  const std::vector<double> &z_storage = m_grid->z();
+
+  // the cost of a column varies a lot (ice-free, cold, temperate), so columns are handed
+  // out to threads in chunks
+  ColumnQueue columns(*m_grid);
 
   ParallelSection loop(m_grid->com);
-  try {
-    for (Points pt(*m_grid); pt; pt.next()) {
-      const int i = pt.i(), j = pt.j();
-
-      const double H = ice_thickness(i, j);
-
-      system.init(i, j,
-                  marginal(ice_thickness, i, j, margin_threshold),
-                  H);
-
-      // enthalpy and pressures at top of ice
-      const double
-        depth_ks = H - system.ks() * dz,
-        p_ks     = EC->pressure(depth_ks); // FIXME issue #15
-
-      const double Enth_ks = EC->enthalpy_permissive(ice_surface_temp(i, j),
-                                                     surface_liquid_fraction(i, j), p_ks);
-
-      const bool ice_free_column = (system.ks() == 0);
-
-      // deal completely with columns with no ice; enthalpy and basal_melt_rate need setting
-      if (ice_free_column) {
-        m_work.set_column(i, j, Enth_ks);
-        // The floating basal melt rate will be set later; cover this
-        // case and set to zero for now. Also, there is no basal melt
-        // rate on ice free land and ice free ocean
-        m_basal_melt_rate(i, j) = 0.0;
-        continue;
-      } // end of if (ice_free_column)
-
-      if (system.lambda() < 1.0) {
-        m_stats.reduced_accuracy_counter += 1; // count columns with lambda < 1
-      }
+#pragma omp parallel reduction(+: liquified_thickness, reduced_accuracy_counter, bulge_counter)
+  {
+    // column system and work space (private to each thread)
+    energy::enthSystemCtx system(m_grid->z(), "energy.enthalpy", m_grid->dx(), m_grid->dy(), dt,
+                                 *m_config, m_ice_enthalpy, u3, v3, w3, strain_heating3, EC,
+                                 use_storage_grid);
+
+    const size_t Mz_fine = system.z().size();
+    const std::vector<double> &z = system.z();
+    std::vector<double> Enthnew(Mz_fine); // new enthalpy in column
+
+    // the cryo-hydrologic system uses the same vertical grid, so both column systems have
+    // the same size and can be solved as a batch
+    std::unique_ptr<energy::enthSystemCtx> ch_system;
+    std::unique_ptr<TridiagonalSystemBatch> batch;
+    std::vector<double> CHnew, Q, batch_solution;
+    if (ch_enthalpy) {
+      ch_system.reset(new energy::enthSystemCtx(m_grid->z(), "energy.ch_warming",
+                                                m_grid->dx(), m_grid->dy(), dt,
+                                                *m_config, *ch_enthalpy, u3, v3, w3,
+                                                strain_heating3, EC, use_storage_grid));
+      batch.reset(new TridiagonalSystemBatch(Mz_fine, 2, "energy.ch_warming"));
+      CHnew.resize(Mz_fine);
+      Q.resize(Mz_fine);
+    }
 
-      const bool
-        is_floating        = cell_type.ocean(i, j),
-        base_is_warm       = system.Enth(0) >= system.Enth_s(0),
-        above_base_is_warm = system.Enth(1) >= system.Enth_s(1);
-
-      // set boundary conditions and update enthalpy
-      {
-        system.set_surface_dirichlet_bc(Enth_ks);
-
-        // determine lowest-level equation at bottom of ice; see
-        // decision chart in the source code browser and page
-        // documenting BOMBPROOF
-        if (is_floating) {
-          // floating base: Dirichlet application of known temperature from ocean
-          //   coupler; assumes base of ice shelf has zero liquid fraction
-          double Enth0 = EC->enthalpy_permissive(shelf_base_temp(i, j), 0.0, EC->pressure(H));
-
-          system.set_basal_dirichlet_bc(Enth0);
-        } else {
-          // grounded ice warm and wet
-          if (base_is_warm && (till_water_thickness(i, j) > 0.0)) {
-            if (above_base_is_warm) {
-              // temperate layer at base (Neumann) case:  q . n = 0  (K0 grad E . n = 0)
-              system.set_basal_heat_flux(0.0);
-            } else {
-              // only the base is warm: E = E_s(p) (Dirichlet)
-              // ( Assumes ice has zero liquid fraction. Is this a valid assumption here?
-              system.set_basal_dirichlet_bc(system.Enth_s(0));
-            }
-          } else {
-            // (Neumann) case:  q . n = q_lith . n + F_b
-            // a) cold and dry base, or
-            // b) base that is still warm from the last time step, but without basal water
-            system.set_basal_heat_flux(basal_heat_flux(i, j) + basal_frictional_heating(i, j));
+    try {
+      for (QueuePoints pt(columns); pt; pt.next()) {
+        const int i = pt.i(), j = pt.j();
+
+        // Enthalpy in the no-model strip of a regional model does not evolve (see
+        // EnthalpyModel_Regional), so we don't need to solve for it there.
+        if (no_model_mask and no_model_mask->as_int(i, j) == 1) {
+          m_work->set_column(i, j, m_ice_enthalpy.get_column(i, j));
+          if (ch_enthalpy) {
+            ch_enthalpy_new->set_column(i, j, ch_enthalpy->get_column(i, j));
           }
+          continue;
         }
 
-        // solve the system
-        system.solve(Enthnew);
+        const double H = ice_thickness(i, j);
 
-      }
+        // Columns thinner than one grid level contain no ice levels (ks == 0 in
+        // enthSystemCtx). Deal with them completely here, without setting up the column
+        // system: in many runs most columns are ice-free.
+        const bool ice_free_column = system.k_below_height(H) == 0;
 
-      // post-process (drainage and bulge-limiting)
-      double Hdrainedtotal = 0.0;
-      double Hfrozen = 0.0;
-      {
-        // drain ice segments by mechanism in [\ref AschwandenBuelerKhroulevBlatter],
-        //   using DrainageCalculator dc
-        for (unsigned int k=0; k < system.ks(); k++) {
-          if (Enthnew[k] > system.Enth_s(k)) { // avoid doing any more work if cold
+        if (ice_free_column) {
+          // enthalpy at the top of ice (ks == 0, so the depth is H)
+          const double Enth_ks = EC->enthalpy_permissive(ice_surface_temp(i, j),
+                                                         surface_liquid_fraction(i, j),
+                                                         EC->pressure(H)); // FIXME issue #15
 
-            const double
-              depth = H - k * dz,
-              p     = EC->pressure(depth), // FIXME issue #15
-              T_m   = EC->melting_temperature(p),
-              L     = EC->L(T_m);
-
-            if (Enthnew[k] >= system.Enth_s(k) + 0.5 * L) {
-              liquifiedCount++; // count these rare events...
-              Enthnew[k] = system.Enth_s(k) + 0.5 * L; //  but lose the energy
-            }
+          m_work->set_column(i, j, Enth_ks);
+          if (ch_enthalpy) {
+            ch_enthalpy_new->set_column(i, j, Enth_ks);
+          }
+          // The floating basal melt rate will be set later; cover this
+          // case and set to zero for now. Also, there is no basal melt
+          // rate on ice free land and ice free ocean
+          m_basal_melt_rate(i, j) = 0.0;
+          continue;
+        } // end of if (ice_free_column)
 
-            double omega = EC->water_fraction(Enthnew[k], p);
+        const bool is_marginal = marginal(ice_thickness, i, j, margin_threshold);
 
-            if (omega > target_water_fraction) {
-              double fractiondrained = dc.get_drainage_rate(omega) * dt; // pure number
+        system.init(i, j, is_marginal, H);
 
-              fractiondrained  = std::min(fractiondrained,
-                                          omega - target_water_fraction);
-              Hdrainedtotal   += fractiondrained * dz; // always a positive contribution
-              Enthnew[k]      -= fractiondrained * L;
-            }
+        assert(system.ks() > 0);
+
+        // We use surface temperature to determine if we're in a melt season or not. During
+        // the melt season the cryo-hydrologic system is not solved (see CHSystem).
+        const bool solve_ch = ch_enthalpy and ice_surface_temp(i, j) < T_pm;
+
+        if (ch_enthalpy and not solve_ch) {
+          double *column = ch_enthalpy_new->get_column(i, j);
+          for (unsigned int k = 0; k < z_storage.size(); ++k) {
+            const double
+              depth = std::max(H - z_storage[k], 0.0),
+              P     = EC->pressure(depth);
+            column[k] = EC->enthalpy(EC->melting_temperature(P),
+                                     ch_residual_water_fraction, P);
           }
         }
 
-        // apply bulge limiter
-        const double lowerEnthLimit = Enth_ks - bulgeEnthMax;
-        for (unsigned int k=0; k < system.ks(); k++) {
-          if (Enthnew[k] < lowerEnthLimit) {
-            // Count grid points which have very large cold limit advection bulge... enthalpy not
-            // too low.
-            m_stats.bulge_counter += 1;
-            Enthnew[k] = lowerEnthLimit;
+        if (solve_ch) {
+          // re-use velocity columns loaded by the ice system
+          ch_system->init(i, j, is_marginal, H, system);
+
+          // cryo-hydrologic warming: energy lost by the CH system is gained by the ice
+          for (unsigned int k = 0; k <= system.ks(); ++k) {
+            Q[k] = cryo_hydrologic_warming_flux(ch_C, H - z[k],
+                                                system.Enth(k), ch_system->Enth(k), *EC);
           }
+          system.add_volumetric_heating(Q, 1.0);
+          ch_system->add_volumetric_heating(Q, -1.0);
         }
 
-        // if there is subglacial water, don't allow ice base enthalpy to be below
-        // pressure-melting; that is, assume subglacial water is at the pressure-
-        // melting temperature and enforce continuity of temperature
+        // enthalpy and pressures at top of ice
+        const double
+          depth_ks = H - z[system.ks()],
+          p_ks     = EC->pressure(depth_ks); // FIXME issue #15
+
+        const double Enth_ks = EC->enthalpy_permissive(ice_surface_temp(i, j),
+                                                       surface_liquid_fraction(i, j), p_ks);
+
+        if (system.lambda() < 1.0) {
+          reduced_accuracy_counter += 1; // count columns with lambda < 1
+        }
+
+        const bool
+          is_floating        = cell_type.ocean(i, j),
+          base_is_warm       = system.Enth(0) >= system.Enth_s(0),
+          above_base_is_warm = system.Enth(1) >= system.Enth_s(1);
+
+        // set boundary conditions and update enthalpy
         {
-          if (Enthnew[0] < system.Enth_s(0) && till_water_thickness(i,j) > 0.0) {
-            const double E_difference = system.Enth_s(0) - Enthnew[0];
-
-            const double depth = H,
-              pressure         = EC->pressure(depth),
-              T_m              = EC->melting_temperature(pressure);
-
-            Enthnew[0] = system.Enth_s(0);
-            // This adjustment creates energy out of nothing. We will
-            // freeze some basal water, subtracting an equal amount of
-            // energy, to make up for it.
-            //
-            // Note that [E_difference] = J/kg, so
-            //
-            // U_difference = E_difference * ice_density * dx * dy * (0.5*dz)
-            //
-            // is the amount of energy created (we changed enthalpy of
-            // a block of ice with the volume equal to
-            // dx*dy*(0.5*dz); note that the control volume
-            // corresponding to the grid point at the base of the
-            // column has thickness 0.5*dz, not dz).
-            //
-            // Also, [L] = J/kg, so
-            //
-            // U_freeze_on = L * ice_density * dx * dy * Hfrozen,
-            //
-            // is the amount of energy created by freezing a water
-            // layer of thickness Hfrozen (using units of ice
-            // equivalent thickness).
-            //
-            // Setting U_difference = U_freeze_on and solving for
-            // Hfrozen, we find the thickness of the basal water layer
-            // we need to freeze co restore energy conservation.
-
-            Hfrozen = E_difference * (0.5*dz) / EC->L(T_m);
-            
-            if (Hfrozen > H_critical) {
-              m_log->message(3,"EnthalpyModel: Assert Hfrozen=%f m/yr to not exceed tillwatmax in %d,%d! \n",Hfrozen*one_year/dt,i,j);
-              Hfrozen = H_critical;
+          system.set_surface_dirichlet_bc(Enth_ks);
+
+          // determine lowest-level equation at bottom of ice; see
+          // decision chart in the source code browser and page
+          // documenting BOMBPROOF
+          if (is_floating) {
+            // floating base: Dirichlet application of known temperature from ocean
+            //   coupler; assumes base of ice shelf has zero liquid fraction
+            double Enth0 = EC->enthalpy_permissive(shelf_base_temp(i, j), 0.0, EC->pressure(H));
+
+            system.set_basal_dirichlet_bc(Enth0);
+          } else {
+            // grounded ice warm and wet
+            if (base_is_warm && (till_water_thickness(i, j) > 0.0)) {
+              if (above_base_is_warm) {
+                // temperate layer at base (Neumann) case:  q . n = 0  (K0 grad E . n = 0)
+                system.set_basal_heat_flux(0.0);
+              } else {
+                // only the base is warm: E = E_s(p) (Dirichlet)
+                // ( Assumes ice has zero liquid fraction. Is this a valid assumption here?
+                system.set_basal_dirichlet_bc(system.Enth_s(0));
+              }
+            } else {
+              // (Neumann) case:  q . n = q_lith . n + F_b
+              // a) cold and dry base, or
+              // b) base that is still warm from the last time step, but without basal water
+              system.set_basal_heat_flux(basal_heat_flux(i, j) + basal_frictional_heating(i, j));
             }
           }
-        }
 
-      } // end of post-processing
-
-      // compute basal melt rate
-      {
-        bool base_is_cold = (Enthnew[0] < system.Enth_s(0)) && (till_water_thickness(i,j) == 0.0);
-        // Determine melt rate, but only preliminarily because of
-        // drainage, from heat flux out of bedrock, heat flux into
-        // ice, and frictional heating
-        if (is_floating) {
-          // The floating basal melt rate will be set later; cover
-          // this case and set to zero for now. Note that
-          // Hdrainedtotal is discarded (the ocean model determines
-          // the basal melt).
-          m_basal_melt_rate(i, j) = 0.0;
-        } else {
-          if (base_is_cold) {
-            m_basal_melt_rate(i, j) = 0.0;  // zero melt rate if cold base
-          } else {
-            const double
-              p_0 = EC->pressure(H),
-              p_1 = EC->pressure(H - dz), // FIXME issue #15
-              Tpmp_0 = EC->melting_temperature(p_0);
+          if (solve_ch) {
+            ch_system->set_surface_dirichlet_bc(Enth_ks);
 
-            const bool k1_istemperate = EC->is_temperate(Enthnew[1], p_1); // level  z = + \Delta z
-            double hf_up = 0.0;
-            if (k1_istemperate) {
-              const double
-                Tpmp_1 = EC->melting_temperature(p_1);
+            if (is_floating) {
+              double Enth0 = EC->enthalpy_permissive(shelf_base_temp(i, j), 0.0, EC->pressure(H));
 
-              hf_up = -system.k_from_T(Tpmp_0) * (Tpmp_1 - Tpmp_0) / dz;
+              ch_system->set_basal_dirichlet_bc(Enth0);
             } else {
-              double T_0 = EC->temperature(Enthnew[0], p_0);
-              const double K_0 = system.k_from_T(T_0) / EC->c();
+              ch_system->set_basal_heat_flux(basal_heat_flux(i, j) + basal_frictional_heating(i, j));
+            }
+
+            // solve both systems
+            system.assemble(*batch, 0);
+            ch_system->assemble(*batch, 1);
+
+            try {
+              batch->solve(system.ks() + 1, 2, batch_solution);
+            } catch (RuntimeError &e) {
+              e.add_context("solving ice and cryo-hydrologic column systems at (%d,%d)", i, j);
+              throw;
+            }
+
+            system.get_solution(batch_solution, 2, 0, Enthnew);
+            ch_system->get_solution(batch_solution, 2, 1, CHnew);
+
+            ch_system->fine_to_coarse(CHnew, i, j, *ch_enthalpy_new);
+          } else {
+            // solve the system
+            system.solve(Enthnew);
+          }
+        }
+
+        // post-process (drainage and bulge-limiting)
+        double Hdrainedtotal = 0.0;
+        double Hfrozen = 0.0;
+        {
+          // drain ice segments by mechanism in [\ref AschwandenBuelerKhroulevBlatter],
+          //   using DrainageCalculator dc
+          for (unsigned int k=0; k < system.ks(); k++) {
+            if (Enthnew[k] > system.Enth_s(k)) { // avoid doing any more work if cold
 
-              hf_up = -K_0 * (Enthnew[1] - Enthnew[0]) / dz;
+              const double
+                depth = H - z[k],
+                p     = EC->pressure(depth), // FIXME issue #15
+                T_m   = EC->melting_temperature(p),
+                L     = EC->L(T_m);
+
+              if (Enthnew[k] >= system.Enth_s(k) + 0.5 * L) {
+                liquified_thickness += system.dz(k); // count these rare events...
+                Enthnew[k] = system.Enth_s(k) + 0.5 * L; //  but lose the energy
+              }
+
+              double omega = EC->water_fraction(Enthnew[k], p);
+
+              if (omega > target_water_fraction) {
+                double fractiondrained = dc.get_drainage_rate(omega) * dt; // pure number
+
+                fractiondrained  = std::min(fractiondrained,
+                                            omega - target_water_fraction);
+                Hdrainedtotal   += fractiondrained * system.dz(k); // always a positive contribution
+                Enthnew[k]      -= fractiondrained * L;
+              }
             }
+          }
 
-            // compute basal melt rate from flux balance:
-            //
-            // basal_melt_rate = - Mb / rho in [\ref AschwandenBuelerKhroulevBlatter];
-            //
-            // after we compute it we make sure there is no refreeze if
-            // there is no available basal water
-            m_basal_melt_rate(i, j) = (basal_frictional_heating(i, j) + basal_heat_flux(i, j) - hf_up) / (ice_density * EC->L(Tpmp_0));
+          // apply bulge limiter
+          const double lowerEnthLimit = Enth_ks - bulgeEnthMax;
+          for (unsigned int k=0; k < system.ks(); k++) {
+            if (Enthnew[k] < lowerEnthLimit) {
+              // Count grid points which have very large cold limit advection bulge... enthalpy not
+              // too low.
+              bulge_counter += 1;
+              Enthnew[k] = lowerEnthLimit;
+            }
+          }
 
-            if (till_water_thickness(i, j) <= 0 && m_basal_melt_rate(i, j) < 0) {
-              m_basal_melt_rate(i, j) = 0.0;
+          // if there is subglacial water, don't allow ice base enthalpy to be below
+          // pressure-melting; that is, assume subglacial water is at the pressure-
+          // melting temperature and enforce continuity of temperature
+          {
+            if (Enthnew[0] < system.Enth_s(0) && till_water_thickness(i,j) > 0.0) {
+              const double E_difference = system.Enth_s(0) - Enthnew[0];
+
+              const double depth = H,
+                pressure         = EC->pressure(depth),
+                T_m              = EC->melting_temperature(pressure);
+
+              Enthnew[0] = system.Enth_s(0);
+              // This adjustment creates energy out of nothing. We will
+              // freeze some basal water, subtracting an equal amount of
+              // energy, to make up for it.
+              //
+              // Note that [E_difference] = J/kg, so
+              //
+              // U_difference = E_difference * ice_density * dx * dy * (0.5*dz)
+              //
+              // is the amount of energy created (we changed enthalpy of
+              // a block of ice with the volume equal to
+              // dx*dy*(0.5*dz); note that the control volume
+              // corresponding to the grid point at the base of the
+              // column has thickness 0.5*dz, not dz).
+              //
+              // Also, [L] = J/kg, so
+              //
+              // U_freeze_on = L * ice_density * dx * dy * Hfrozen,
+              //
+              // is the amount of energy created by freezing a water
+              // layer of thickness Hfrozen (using units of ice
+              // equivalent thickness).
+              //
+              // Setting U_difference = U_freeze_on and solving for
+              // Hfrozen, we find the thickness of the basal water layer
+              // we need to freeze co restore energy conservation.
+
+              Hfrozen = E_difference * (0.5 * system.dz(0)) / EC->L(T_m);
+            
+              if (Hfrozen > H_critical) {
+#pragma omp critical (pism_log)
+                m_log->message(3,"EnthalpyModel: Assert Hfrozen=%f m/yr to not exceed tillwatmax in %d,%d! \n",Hfrozen*one_year/dt,i,j);
+                Hfrozen = H_critical;
+              }
             }
           }
 
-          // Add drained water from the column to basal melt rate.
-          m_basal_melt_rate(i, j) += (Hdrainedtotal - Hfrozen) / dt;
-        } // end of the grounded case
-      } // end of the basal melt rate computation
+        } // end of post-processing
+
+        // compute basal melt rate
+        {
+          bool base_is_cold = (Enthnew[0] < system.Enth_s(0)) && (till_water_thickness(i,j) == 0.0);
+          // Determine melt rate, but only preliminarily because of
+          // drainage, from heat flux out of bedrock, heat flux into
+          // ice, and frictional heating
+          if (is_floating) {
+            // The floating basal melt rate will be set later; cover
+            // this case and set to zero for now. Note that
+            // Hdrainedtotal is discarded (the ocean model determines
+            // the basal melt).
+            m_basal_melt_rate(i, j) = 0.0;
+          } else {
+            if (base_is_cold) {
+              m_basal_melt_rate(i, j) = 0.0;  // zero melt rate if cold base
+            } else {
+              const double
+                dz  = system.dz(0),
+                p_0 = EC->pressure(H),
+                p_1 = EC->pressure(H - dz), // FIXME issue #15
+                Tpmp_0 = EC->melting_temperature(p_0);
+
+              const bool k1_istemperate = EC->is_temperate(Enthnew[1], p_1); // level  z = + \Delta z
+              double hf_up = 0.0;
+              if (k1_istemperate) {
+                const double
+                  Tpmp_1 = EC->melting_temperature(p_1);
+
+                hf_up = -system.k_from_T(Tpmp_0) * (Tpmp_1 - Tpmp_0) / dz;
+              } else {
+                double T_0 = EC->temperature(Enthnew[0], p_0);
+                const double K_0 = system.k_from_T(T_0) / EC->c();
+
+                hf_up = -K_0 * (Enthnew[1] - Enthnew[0]) / dz;
+              }
+
+              // compute basal melt rate from flux balance:
+              //
+              // basal_melt_rate = - Mb / rho in [\ref AschwandenBuelerKhroulevBlatter];
+              //
+              // after we compute it we make sure there is no refreeze if
+              // there is no available basal water
+              m_basal_melt_rate(i, j) = (basal_frictional_heating(i, j) + basal_heat_flux(i, j) - hf_up) / (ice_density * EC->L(Tpmp_0));
+
+              if (till_water_thickness(i, j) <= 0 && m_basal_melt_rate(i, j) < 0) {
+                m_basal_melt_rate(i, j) = 0.0;
+              }
+            }
 
-      system.fine_to_coarse(Enthnew, i, j, m_work);
+            // Add drained water from the column to basal melt rate.
+            m_basal_melt_rate(i, j) += (Hdrainedtotal - Hfrozen) / dt;
+          } // end of the grounded case
+        } // end of the basal melt rate computation
+
+        system.fine_to_coarse(Enthnew, i, j, *m_work);
+      }
+    } catch (...) {
+      loop.failed();
     }
-  } catch (...) {
-    loop.failed();
   }
   loop.check();
 
-  m_stats.liquified_ice_volume = ((double) liquifiedCount) * dz * m_grid->cell_area();
+  m_stats.reduced_accuracy_counter += reduced_accuracy_counter;
+  m_stats.bulge_counter            += bulge_counter;
+  m_stats.liquified_ice_volume = liquified_thickness * m_grid->cell_area();
+
+  if (m_ch_system) {
+    ch_work->update_ghosts(m_ch_system->m_ice_enthalpy);
+  }
 }
 
 void EnthalpyModel::define_model_state_impl(const File &output) const {
@@ -25,11 +25,15 @@
 namespace pism {
 namespace energy {
 
+class CHSystem;
+
 /*! @brief The enthalpy-based energy balance model. */
 class EnthalpyModel : public EnergyModel {
 public:
   EnthalpyModel(IceGrid::ConstPtr grid, stressbalance::StressBalance *stress_balance);
 
+  void set_cryo_hydrologic_system(CHSystem *ch_system);
+
 protected:
   virtual void restart_impl(const File &input_file, int record);
 
@@ -50,6 +54,28 @@ protected:
 
   virtual void define_model_state_impl(const File &output) const;
   virtual void write_model_state_impl(const File &output) const;
+
+  //! Parameters used by update_impl(), read once so that they are not looked up at every
+  //! time step.
+  struct Parameters {
+    Parameters(const Config &config);
+
+    //! ice density, kg m-3
+    double ice_density;
+    //! maximum enthalpy decrease due to a "cold bulge", J kg-1
+    double cold_bulge_max;
+    double target_water_fraction;
+    //! ice thickness threshold used to identify the ice margin, m
+    double margin_threshold;
+    //! maximum till water thickness, m
+    double tillwat_max;
+    bool use_storage_grid;
+  };
+  const Parameters m_parameters;
+
+  //! cryo-hydrologic system updated in the same pass over columns (not owned; may be
+  //! NULL)
+  CHSystem *m_ch_system;
 };
 
 /*! @brief The "dummy" energy balance model. Reads in enthalpy from a file, but does not update it. */
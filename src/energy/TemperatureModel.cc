@@ -203,7 +203,7 @@ void TemperatureModel::update_impl(double t, double dt, const Inputs &inputs) {
 
   IceModelVec::AccessList list{&ice_surface_temp, &shelf_base_temp, &ice_thickness,
       &cell_type, &basal_heat_flux, &till_water_thickness, &basal_frictional_heating,
-      &u3, &v3, &w3, &strain_heating3, &m_basal_melt_rate, &m_ice_temperature, &m_work};
+      &u3, &v3, &w3, &strain_heating3, &m_basal_melt_rate, &m_ice_temperature, m_work.get()};
 
   energy::tempSystemCtx system(m_grid->z(), "temperature",
                                m_grid->dx(), m_grid->dy(), dt,
@@ -328,7 +328,7 @@ void TemperatureModel::update_impl(double t, double dt, const Inputs &inputs) {
       }
 
       // transfer column into m_work; communication later
-      system.fine_to_coarse(Tnew, i, j, m_work);
+      system.fine_to_coarse(Tnew, i, j, *m_work);
 
       // basal_melt_rate(i,j) is rate of mass loss at bottom of ice
       if (ocean(mask)) {
@@ -353,10 +353,10 @@ void TemperatureModel::update_impl(double t, double dt, const Inputs &inputs) {
   }
 
   // copy to m_ice_temperature, updating ghosts
-  m_work.update_ghosts(m_ice_temperature);
+  m_work->update_ghosts(m_ice_temperature);
 
   // Set ice enthalpy in place. EnergyModel::update will scatter ghosts
-  compute_enthalpy_cold(m_work, ice_thickness, m_work);
+  compute_enthalpy_cold(*m_work, ice_thickness, *m_work);
 }
 
 void TemperatureModel::define_model_state_impl(const File &output) const {
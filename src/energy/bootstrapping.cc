@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::min
 #include <cmath>
 
 #include "pism/energy/bootstrapping.hh"
@@ -27,36 +28,67 @@ namespace energy {
 double ice_temperature_guess(EnthalpyConverter::Ptr EC,
                              double H, double z, double T_surface,
                              double G, double ice_k) {
-
-  const double
-    depth = H - z,
-    d2    = depth * depth,
-    Tpmp  = EC->melting_temperature(EC->pressure(depth));
-
-  const double
-    beta = (4.0/21.0) * (G / (2.0 * ice_k * H * H * H)),
-    alpha = (G / (2.0 * H * ice_k)) - 2.0 * H * H * beta;
-
-  return std::min(Tpmp, T_surface + alpha * d2 + beta * d2 * d2);
+  double T = 0.0;
+  ice_temperature_guess(*EC, H, &z, 1, T_surface, G, ice_k, &T);
+  return T;
 }
 
 double ice_temperature_guess_smb(EnthalpyConverter::Ptr EC,
                                  double H, double z, double T_surface,
                                  double G, double ice_k, double K, double SMB) {
+  double T = 0.0;
+  ice_temperature_guess_smb(*EC, H, &z, 1, T_surface, G, ice_k, K, SMB, &T);
+  return T;
+}
+
+void ice_temperature_guess(const EnthalpyConverter &EC,
+                           double H, const double *z, unsigned int ks,
+                           double T_surface, double G, double ice_k,
+                           double *T) {
   const double
-    depth = H - z,
-    Tpmp  = EC->melting_temperature(EC->pressure(depth));
+    beta  = (4.0/21.0) * (G / (2.0 * ice_k * H * H * H)),
+    alpha = (G / (2.0 * H * ice_k)) - 2.0 * H * H * beta;
 
+  for (unsigned int k = 0; k < ks; ++k) {
+    const double
+      depth = H - z[k],
+      d2    = depth * depth,
+      Tpmp  = EC.melting_temperature(EC.pressure(depth));
+
+    T[k] = std::min(Tpmp, T_surface + alpha * d2 + beta * d2 * d2);
+  }
+}
+
+void ice_temperature_guess_smb(const EnthalpyConverter &EC,
+                               double H, const double *z, unsigned int ks,
+                               double T_surface, double G, double ice_k, double K, double SMB,
+                               double *T) {
   if (SMB <= 0.0) {
     // negative or zero surface mass balance: linear temperature profile
-    return std::min(Tpmp, G / ice_k * depth + T_surface);
+    const double gradient = G / ice_k;
+
+    for (unsigned int k = 0; k < ks; ++k) {
+      const double
+        depth = H - z[k],
+        Tpmp  = EC.melting_temperature(EC.pressure(depth));
+
+      T[k] = std::min(Tpmp, gradient * depth + T_surface);
+    }
   } else {
     // positive surface mass balance
     const double
-      C0     = (G * sqrt(M_PI * H * K)) / (ice_k * sqrt(2.0 * SMB)),
-      gamma0 = sqrt(SMB * H / (2.0 * K));
+      C0      = (G * sqrt(M_PI * H * K)) / (ice_k * sqrt(2.0 * SMB)),
+      gamma0  = sqrt(SMB * H / (2.0 * K)),
+      gamma_H = gamma0 / H,
+      T_top   = T_surface + C0 * erf(gamma0);
+
+    for (unsigned int k = 0; k < ks; ++k) {
+      const double
+        depth = H - z[k],
+        Tpmp  = EC.melting_temperature(EC.pressure(depth));
 
-    return std::min(Tpmp, T_surface + C0 * (erf(gamma0) - erf(gamma0 * z / H)));
+      T[k] = std::min(Tpmp, T_top - C0 * erf(gamma_H * z[k]));
+    }
   }
 }
 
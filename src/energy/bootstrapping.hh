@@ -62,6 +62,27 @@ double ice_temperature_guess_smb(EnthalpyConverter::Ptr EC,
                                  double H, double z, double T_surface,
                                  double G, double ice_k, double K, double SMB);
 
+/*!
+ * Column version of ice_temperature_guess(): computes temperatures `T[k]` at heights
+ * `z[k]`, `0 <= k < ks`.
+ *
+ * Quantities that do not depend on `z` are computed once per column and the loop over
+ * levels has no branches or function calls, so it can be vectorized by the compiler.
+ */
+void ice_temperature_guess(const EnthalpyConverter &EC,
+                           double H, const double *z, unsigned int ks,
+                           double T_surface, double G, double ice_k,
+                           double *T);
+
+/*!
+ * Column version of ice_temperature_guess_smb(): computes temperatures `T[k]` at heights
+ * `z[k]`, `0 <= k < ks`.
+ */
+void ice_temperature_guess_smb(const EnthalpyConverter &EC,
+                               double H, const double *z, unsigned int ks,
+                               double T_surface, double G, double ice_k, double K, double SMB,
+                               double *T);
+
 } // end of namespace energy
 } // end of namespace pism
 
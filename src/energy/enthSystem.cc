@@ -17,6 +17,8 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "enthSystem.hh"
+#include <algorithm>            // std::max, std::fill
+#include <cassert>
 #include <gsl/gsl_math.h>       // GSL_NAN, gsl_isnan()
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/iceModelVec.hh"
@@ -37,8 +39,9 @@ enthSystemCtx::enthSystemCtx(const std::vector<double>& storage_grid,
                              const IceModelVec3 &v3,
                              const IceModelVec3 &w3,
                              const IceModelVec3 &strain_heating3,
-                             EnthalpyConverter::Ptr EC)
-: columnSystemCtx(storage_grid, prefix, dx, dy, dt, u3, v3, w3),
+                             EnthalpyConverter::Ptr EC,
+                             bool use_storage_grid)
+: columnSystemCtx(storage_grid, prefix, dx, dy, dt, u3, v3, w3, use_storage_grid),
   m_Enth3(Enth3),
   m_strain_heating3(strain_heating3),
   m_EC(EC) {
@@ -132,6 +135,56 @@ void enthSystemCtx::init(int i, int j, bool marginal, double ice_thickness) {
   }
 
   coarse_to_fine(m_strain_heating3, m_i, m_j, &m_strain_heating[0]);
+
+  init_enthalpy();
+}
+
+//! Initialize the system at (i,j), using velocity columns of `velocity_source`.
+/*!
+ * `velocity_source` has to be initialized at the same column and has to use the same
+ * vertical grid. This avoids interpolating velocity columns again when two systems (e.g.
+ * ice and the cryo-hydrologic system) are solved in the same column.
+ *
+ * Volumetric heating is set to zero; use add_volumetric_heating() to set it.
+ */
+void enthSystemCtx::init(int i, int j, bool marginal, double ice_thickness,
+                         const enthSystemCtx &velocity_source) {
+  assert(velocity_source.m_i == i and velocity_source.m_j == j);
+  assert(velocity_source.m_z.size() == m_z.size());
+
+  m_ice_thickness = ice_thickness;
+
+  m_marginal = marginal;
+
+  init_column(i, j, m_ice_thickness);
+
+  if (m_ks == 0) {
+    return;
+  }
+
+  // vectors have the same size, so this does not allocate
+  m_u = velocity_source.m_u;
+  m_v = velocity_source.m_v;
+  m_w = velocity_source.m_w;
+
+  std::fill(m_strain_heating.begin(), m_strain_heating.end(), 0.0);
+
+  init_enthalpy();
+}
+
+//! Add `scale * Q` to the volumetric heating in the current column.
+/*!
+ * `Q` is defined on the vertical grid used by this system (see z()). Has to be called
+ * after init() and before setting boundary conditions.
+ */
+void enthSystemCtx::add_volumetric_heating(const std::vector<double> &Q, double scale) {
+  for (unsigned int k = 0; k <= m_ks; ++k) {
+    m_strain_heating[k] += scale * Q[k];
+  }
+}
+
+//! Load enthalpy columns and compute quantities that depend on enthalpy.
+void enthSystemCtx::init_enthalpy() {
   coarse_to_fine(m_Enth3, m_i, m_j, &m_Enth[0]);
 
   coarse_to_fine(m_Enth3, m_i, m_j+1, &m_E_n[0]);
@@ -154,7 +207,7 @@ void enthSystemCtx::compute_enthalpy_CTS() {
 
   for (unsigned int k = 0; k <= m_ks; k++) {
     const double
-      depth = m_ice_thickness - k * m_dz,
+      depth = m_ice_thickness - m_z[k],
       p = m_EC->pressure(depth); // FIXME issue #15
     m_Enth_s[k] = m_EC->enthalpy_cts(p);
   }
@@ -177,7 +230,10 @@ double enthSystemCtx::compute_lambda() {
     if (m_Enth[k] > m_Enth_s[k]) { // lambda = 0 if temperate ice present in column
       result = 0.0;
     } else {
-      const double denom = (fabs(m_w[k]) + epsilon) * m_ice_density * m_ice_c * m_dz;
+      // use the larger of the two spacings next to level k (they are equal on the fine grid)
+      const double
+        dz    = std::max(this->dz(k), k > 0 ? this->dz(k - 1) : 0.0),
+        denom = (fabs(m_w[k]) + epsilon) * m_ice_density * m_ice_c * dz;
       result = std::min(result, 2.0 * m_ice_k / denom);
     }
   }
@@ -224,10 +280,14 @@ void enthSystemCtx::set_surface_neumann_bc(double G) {
   const bool include_horizontal_advection = not (m_marginal and m_exclude_horizontal_advection);
   const bool include_strain_heating       = not (m_marginal and m_exclude_strain_heat);
 
+  // spacing below the surface; m_R is scaled to use it instead of the reference spacing
+  // (the scaling factor is 1 on the fine grid)
   const double
-    Rminus = 0.5 * (m_R[m_ks - 1] + m_R[m_ks]), // R_{ks-1/2}
-    Rplus  = m_R[m_ks],                         // R_{ks+1/2}
-    mu_w   = 0.5 * m_nu * m_w[m_ks];
+    dz     = this->dz(m_ks - 1),
+    scale  = PetscSqr(m_dz / dz),
+    Rminus = 0.5 * (m_R[m_ks - 1] + m_R[m_ks]) * scale, // R_{ks-1/2}
+    Rplus  = m_R[m_ks] * scale,                         // R_{ks+1/2}
+    mu_w   = 0.5 * (m_dt / dz) * m_w[m_ks];
 
   const double A_l = m_w[m_ks] < 0.0 ? 1.0 - m_lambda : m_lambda - 1.0;
   const double A_d = m_w[m_ks] < 0.0 ? m_lambda - 1.0 : 1.0 - m_lambda;
@@ -242,7 +302,7 @@ void enthSystemCtx::set_surface_neumann_bc(double G) {
   // m_Enth[m_ks] (below) is there due to the fully-implicit discretization in time, the second term is
   // the modification of the right-hand side implementing the Neumann B.C. (similar to
   // set_basal_heat_flux(); see that method for details)
-  m_B_ks = m_Enth[m_ks] + 2.0 * G * m_dz * (Rplus + mu_w * A_b);
+  m_B_ks = m_Enth[m_ks] + 2.0 * G * dz * (Rplus + mu_w * A_b);
 
   // treat horizontal velocity using first-order upwinding:
   double upwind_u = 0.0;
@@ -343,10 +403,14 @@ void enthSystemCtx::set_basal_neumann_bc(double G) {
   const bool include_horizontal_advection = not (m_marginal and m_exclude_horizontal_advection);
   const bool include_strain_heating       = not (m_marginal and m_exclude_strain_heat);
 
+  // spacing above the base; m_R is scaled to use it instead of the reference spacing
+  // (the scaling factor is 1 on the fine grid)
   const double
-    Rminus = m_R[0],                  // R_{-1/2}
-    Rplus  = 0.5 * (m_R[0] + m_R[1]), // R_{+1/2}
-    mu_w   = 0.5 * m_nu * m_w[0];
+    dz     = this->dz(0),
+    scale  = PetscSqr(m_dz / dz),
+    Rminus = m_R[0] * scale,                  // R_{-1/2}
+    Rplus  = 0.5 * (m_R[0] + m_R[1]) * scale, // R_{+1/2}
+    mu_w   = 0.5 * (m_dt / dz) * m_w[0];
 
   const double A_d = m_w[0] < 0.0 ? m_lambda - 1.0 : 1.0 - m_lambda;
   const double A_u = m_w[0] < 0.0 ? 1.0 - m_lambda : m_lambda - 1.0;
@@ -357,7 +421,7 @@ void enthSystemCtx::set_basal_neumann_bc(double G) {
   // upper-diagonal entry
   m_U0 = - Rminus - Rplus + 2.0 * mu_w * A_u;
   // right-hand side, excluding the strain heating term and the horizontal advection
-  m_B0 = m_Enth[0] + 2.0 * G * m_dz * (-Rminus + mu_w * A_b);
+  m_B0 = m_Enth[0] + 2.0 * G * dz * (-Rminus + mu_w * A_b);
 
   // treat horizontal velocity using first-order upwinding:
   double upwind_u = 0.0;
@@ -403,7 +467,7 @@ void enthSystemCtx::assemble_R() {
     for (unsigned int k = 1; k <= m_ks; k++) {
       if (m_Enth[k] < m_Enth_s[k]) {
         // cold case
-        const double depth = m_ice_thickness - k * m_dz;
+        const double depth = m_ice_thickness - m_z[k];
         double T = m_EC->temperature(m_Enth[k],
                                      m_EC->pressure(depth)); // FIXME: issue #15
 
@@ -478,7 +542,83 @@ void enthSystemCtx::assemble_R() {
  */
 void enthSystemCtx::solve(std::vector<double> &x) {
 
-  TridiagonalSystem &S = *m_solver;
+  assemble_system(*m_solver);
+
+  // Solve it; note drainage is not addressed yet and post-processing may occur
+  try {
+    m_solver->solve(m_ks + 1, x);
+  }
+  catch (RuntimeError &e) {
+    e.add_context("solving the tri-diagonal system (enthSystemCtx) at (%d,%d)\n"
+                  "saving system to m-file... ", m_i, m_j);
+    reportColumnZeroPivotErrorMFile(m_ks + 1);
+    throw;
+  }
+
+  // air above
+  for (unsigned int k = m_ks+1; k < x.size(); k++) {
+    x[k] = m_B_ks;
+  }
+
+  mark_solved();
+}
+
+//! Column `c` of a TridiagonalSystemBatch, with the interface of TridiagonalSystem used
+//! by enthSystemCtx::assemble_system().
+class BatchColumn {
+public:
+  BatchColumn(TridiagonalSystemBatch &batch, unsigned int c)
+    : m_batch(batch), m_c(c) {
+    // empty
+  }
+  double& L(size_t k) {
+    return m_batch.L(k, m_c);
+  }
+  double& D(size_t k) {
+    return m_batch.D(k, m_c);
+  }
+  double& U(size_t k) {
+    return m_batch.U(k, m_c);
+  }
+  double& RHS(size_t k) {
+    return m_batch.RHS(k, m_c);
+  }
+private:
+  TridiagonalSystemBatch &m_batch;
+  unsigned int m_c;
+};
+
+//! Assemble the system in the current column as the system `c` of `batch`.
+/*!
+ * Use this to solve several systems of the same size (e.g. ice and the cryo-hydrologic
+ * system in the same column) together, then call get_solution().
+ */
+void enthSystemCtx::assemble(TridiagonalSystemBatch &batch, unsigned int c) {
+  assert(c < batch.batch_size());
+
+  BatchColumn S(batch, c);
+  assemble_system(S);
+}
+
+//! Extract the solution of the system `c` from the solution of a batch (see assemble()).
+void enthSystemCtx::get_solution(const std::vector<double> &batch_solution,
+                                 unsigned int batch_size, unsigned int c,
+                                 std::vector<double> &x) {
+  for (unsigned int k = 0; k <= m_ks; k++) {
+    x[k] = batch_solution[k * batch_size + c];
+  }
+
+  // air above
+  for (unsigned int k = m_ks+1; k < x.size(); k++) {
+    x[k] = m_B_ks;
+  }
+
+  mark_solved();
+}
+
+//! Assemble the tridiagonal system in the current column.
+template<class System>
+void enthSystemCtx::assemble_system(System &S) {
 
 #if (Pism_DEBUG==1)
   checkReadyToSolve();
@@ -515,9 +655,33 @@ void enthSystemCtx::solve(std::vector<double> &x) {
       A_d = m_w[k] >= 0.0 ? 1.0 - m_lambda : m_lambda - 1.0,
       A_u = m_w[k] >= 0.0 ? 0.5 * m_lambda : 1.0 - 0.5 * m_lambda;
 
-    S.L(k) = - Rminus + nu_w * A_l;
-    S.D(k) = 1.0 + Rminus + Rplus + nu_w * A_d;
-    S.U(k) = - Rplus + nu_w * A_u;
+    if (not m_use_storage_grid) {
+      S.L(k) = - Rminus + nu_w * A_l;
+      S.D(k) = 1.0 + Rminus + Rplus + nu_w * A_d;
+      S.U(k) = - Rplus + nu_w * A_u;
+    } else {
+      // non-uniform spacing: scale R to use local spacings and replace centered and
+      // upwinded differences with their non-uniform counterparts
+      const double
+        dz_m    = m_z[k] - m_z[k - 1],
+        dz_p    = m_z[k + 1] - m_z[k],
+        h       = 0.5 * (dz_m + dz_p),
+        dt_w    = m_dt * m_w[k],
+        L       = m_lambda,
+        c       = L / (dz_m + dz_p), // centered difference weight
+        R_minus = Rminus * PetscSqr(m_dz) / (h * dz_m),
+        R_plus  = Rplus * PetscSqr(m_dz) / (h * dz_p);
+
+      if (m_w[k] >= 0.0) {
+        S.L(k) = - R_minus + dt_w * (- (1.0 - L) / dz_m - c);
+        S.D(k) = 1.0 + R_minus + R_plus + dt_w * (1.0 - L) / dz_m;
+        S.U(k) = - R_plus + dt_w * c;
+      } else {
+        S.L(k) = - R_minus - dt_w * c;
+        S.D(k) = 1.0 + R_minus + R_plus + dt_w * (L - 1.0) / dz_p;
+        S.U(k) = - R_plus + dt_w * ((1.0 - L) / dz_p + c);
+      }
+    }
 
     // horizontal velocity and strain heating
     double upwind_u = 0.0;
@@ -544,23 +708,9 @@ void enthSystemCtx::solve(std::vector<double> &x) {
     S.U(m_ks) = m_U_ks;
   }
   S.RHS(m_ks) = m_B_ks;
+}
 
-  // Solve it; note drainage is not addressed yet and post-processing may occur
-  try {
-    S.solve(m_ks + 1, x);
-  }
-  catch (RuntimeError &e) {
-    e.add_context("solving the tri-diagonal system (enthSystemCtx) at (%d,%d)\n"
-                  "saving system to m-file... ", m_i, m_j);
-    reportColumnZeroPivotErrorMFile(m_ks + 1);
-    throw;
-  }
-
-  // air above
-  for (unsigned int k = m_ks+1; k < x.size(); k++) {
-    x[k] = m_B_ks;
-  }
-
+void enthSystemCtx::mark_solved() {
 #if (Pism_DEBUG==1)
   // if success, mark column as done by making scheme params and b.c. coeffs invalid
   m_lambda = -1.0;
@@ -48,10 +48,15 @@ public:
                 const IceModelVec3 &v3,
                 const IceModelVec3 &w3,
                 const IceModelVec3 &strain_heating3,
-                EnthalpyConverter::Ptr EC);
+                EnthalpyConverter::Ptr EC,
+                bool use_storage_grid = false);
   ~enthSystemCtx();
 
   void init(int i, int j, bool ismarginal, double ice_thickness);
+  void init(int i, int j, bool ismarginal, double ice_thickness,
+            const enthSystemCtx &velocity_source);
+
+  void add_volumetric_heating(const std::vector<double> &Q, double scale);
 
   double k_from_T(double T) const;
 
@@ -67,6 +72,11 @@ public:
 
   void solve(std::vector<double> &result);
 
+  void assemble(TridiagonalSystemBatch &batch, unsigned int c);
+  void get_solution(const std::vector<double> &batch_solution,
+                    unsigned int batch_size, unsigned int c,
+                    std::vector<double> &result);
+
   double lambda() const {
     return m_lambda;
   }
@@ -91,7 +101,8 @@ protected:
   //! strain heating in the ice column
   std::vector<double> m_strain_heating;
 
-  //! values of @f$ k \Delta t / (\rho c \Delta x^2) @f$
+  //! values of @f$ k \Delta t / (\rho c \Delta z^2) @f$, where @f$ \Delta z @f$ is the
+  //! reference spacing columnSystemCtx::dz()
   std::vector<double> m_R;
 
   double m_ice_density, m_ice_c, m_ice_k, m_p_air,
@@ -110,11 +121,16 @@ protected:
   const IceModelVec3 &m_Enth3, &m_strain_heating3;
   EnthalpyConverter::Ptr m_EC;  // conductivity has known dependence on T, not enthalpy
 
+  void init_enthalpy();
   void compute_enthalpy_CTS();
   double compute_lambda();
 
   void assemble_R();
   void checkReadyToSolve();
+  void mark_solved();
+
+  template<class System>
+  void assemble_system(System &S);
 };
 
 } // end of namespace energy
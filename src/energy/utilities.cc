@@ -361,6 +361,8 @@ void bootstrap_ice_temperature(const IceModelVec2S &ice_thickness,
     T_melting   = config->get_number("constants.fresh_water.melting_point_temperature",
                                      "Kelvin");
 
+  const double *z = &grid->z()[0];
+
   IceModelVec::AccessList list{&ice_surface_temp, &surface_mass_balance,
       &ice_thickness, &basal_heat_flux, &result};
 
@@ -397,17 +399,11 @@ void bootstrap_ice_temperature(const IceModelVec2S &ice_thickness,
         // Convert SMB from "kg m-2 s-1" to "m second-1".
         const double SMB = surface_mass_balance(i, j) / ice_density;
 
-        for (unsigned int k = 0; k < ks; k++) {
-          const double z = grid->z(k);
-          T[k] = ice_temperature_guess_smb(EC, H, z, T_surface, G, ice_k, K, SMB);
-        }
+        ice_temperature_guess_smb(*EC, H, z, ks, T_surface, G, ice_k, K, SMB, T);
 
       } else { // method 2: a quartic guess; does not use SMB
 
-        for (unsigned int k = 0; k < ks; k++) {
-          const double z = grid->z(k);
-          T[k] = ice_temperature_guess(EC, H, z, T_surface, G, ice_k);
-        }
+        ice_temperature_guess(*EC, H, z, ks, T_surface, G, ice_k, T);
 
       }
 
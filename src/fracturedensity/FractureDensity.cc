@@ -22,6 +22,7 @@
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/Logger.hh"
 
 namespace pism {
 
@@ -43,7 +44,8 @@ FractureDensity::FractureDensity(IceGrid::ConstPtr grid,
                           0, // stencil width
                           3), // dof
     m_velocity(grid, "ghosted_velocity", WITH_GHOSTS, 1),
-    m_flow_law(flow_law) {
+    m_flow_law(flow_law),
+    m_ghost_exchange({&m_density, &m_age}) {
 
   m_density.set_attrs("model_state", "fracture density in ice shelf", "1", "1", "", 0);
   m_density.metadata().set_number("valid_max", 1.0);
@@ -85,6 +87,43 @@ FractureDensity::FractureDensity(IceGrid::ConstPtr grid,
   m_deviatoric_stresses.set_attrs("internal",
                                   "deviatoric shear stress",
                                   "Pa", "Pa", "", 2);
+
+  m_soft_residual = options::Real("-fracture_softening", "soft_residual", 1.0);
+  // assume linear response function: E_fr = (1-(1-soft_residual)*phi) -> 1-phi
+  //
+  // more: T. Albrecht, A. Levermann; Fracture-induced softening for
+  // large-scale ice dynamics; (2013), The Cryosphere Discussions 7;
+  // 4501-4544; DOI:10.5194/tcd-7-4501-2013
+
+  // get four options for calculation of fracture density.
+  // 1st: fracture growth constant gamma
+  // 2nd: fracture initiation stress threshold sigma_cr
+  // 3rd: healing rate constant gamma_h
+  // 4th: healing strain rate threshold
+  // more: T. Albrecht, A. Levermann; Fracture field for large-scale
+  // ice dynamics; (2012), Journal of Glaciology, Vol. 58, No. 207,
+  // 165-176, DOI: 10.3189/2012JoG11J191.
+  {
+    options::RealList fractures("-fracture_parameters",
+                                "gamma, initThreshold, gammaheal, healThreshold",
+                                {1.0, 7.0e4, 0.0, 2.0e-10});
+    if (fractures->size() != 4) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "option -fracture_parameters requires exactly 4 arguments");
+    }
+    m_gamma                = fractures[0];
+    m_initiation_threshold = fractures[1];
+    m_gamma_healing        = fractures[2];
+    m_healing_threshold    = fractures[3];
+  }
+
+  m_include_grounded_ice      = m_config->get_flag("fracture_density.include_grounded_ice");
+  m_phi0                      = m_config->get_number("fracture_density.phi0");
+  m_constant_healing          = m_config->get_flag("fracture_density.constant_healing");
+  m_fracture_weighted_healing = m_config->get_flag("fracture_density.fracture_weighted_healing");
+  m_max_shear_stress          = m_config->get_flag("fracture_density.max_shear_stress");
+  m_lefm                      = m_config->get_flag("fracture_density.lefm");
+  m_constant_fd               = m_config->get_flag("fracture_density.constant_fd");
+  m_fd2d_scheme               = m_config->get_flag("fracture_density.fd2d_scheme");
 }
 
 FractureDensity::~FractureDensity() {
@@ -95,8 +134,7 @@ void FractureDensity::restart(const File &input_file, int record) {
   m_log->message(2, "* Restarting the fracture density model from %s...\n",
                  input_file.filename().c_str());
 
-  m_density.read(input_file, record);
-  m_age.read(input_file, record);
+  read_fields(input_file, record, {&m_density, &m_age});
 
   regrid("Fracture density model", m_density, REGRID_WITHOUT_REGRID_VARS);
   regrid("Fracture density model", m_age, REGRID_WITHOUT_REGRID_VARS);
@@ -131,23 +169,105 @@ void FractureDensity::write_model_state_impl(const File &output) const {
   m_age.write(output);
 }
 
+//! Advection term `u D_x + v D_y` of the fracture density using the 2D upwinding scheme.
+static double upwind_2d(const IceModelVec2S &D, int i, int j, double u, double v,
+                        double dx, double dy, const Logger &log) {
+  if (u >= dx * v / dy and v >= 0.0) { //1
+    return u * (D(i, j) - D(i - 1, j)) / dx + v * (D(i - 1, j) - D(i - 1, j - 1)) / dy;
+  } else if (u <= dx * v / dy and u >= 0.0) { //2
+    return u * (D(i, j - 1) - D(i - 1, j - 1)) / dx + v * (D(i, j) - D(i, j - 1)) / dy;
+  } else if (u >= -dx * v / dy and u <= 0.0) { //3
+    return -u * (D(i, j - 1) - D(i + 1, j - 1)) / dx + v * (D(i, j) - D(i, j - 1)) / dy;
+  } else if (u <= -dx * v / dy and v >= 0.0) { //4
+    return -u * (D(i, j) - D(i + 1, j)) / dx + v * (D(i + 1, j) - D(i + 1, j - 1)) / dy;
+  } else if (u <= dx * v / dy and v <= 0.0) { //5
+    return -u * (D(i, j) - D(i + 1, j)) / dx - v * (D(i + 1, j) - D(i + 1, j + 1)) / dy;
+  } else if (u >= dx * v / dy and u <= 0.0) { //6
+    return -u * (D(i, j + 1) - D(i + 1, j + 1)) / dx - v * (D(i, j) - D(i, j + 1)) / dy;
+  } else if (u <= -dx * v / dy and u >= 0.0) { //7
+    return u * (D(i, j + 1) - D(i - 1, j + 1)) / dx - v * (D(i, j) - D(i, j + 1)) / dy;
+  } else if (u >= -dx * v / dy and v <= 0.0) { //8
+    return u * (D(i, j) - D(i - 1, j)) / dx - v * (D(i - 1, j) - D(i - 1, j + 1)) / dy;
+  }
+
+  log.message(3, "######### missing case of angle %f of %f and %f at %d, %d \n",
+              atan(v / u) / M_PI * 180., u * 3e7, v * 3e7, i, j);
+  return 0.0;
+}
+
+//! Stress used by the fracture initiation criterion (von Mises, maximum shear stress, or
+//! LEFM mixed-mode).
+double FractureDensity::fracture_stress(double txx, double tyy, double txy) const {
+  ///von mises criterion
+  double
+    T1     = 0.5 * (txx + tyy) + sqrt(0.25 * PetscSqr(txx - tyy) + PetscSqr(txy)), //Pa
+    T2     = 0.5 * (txx + tyy) - sqrt(0.25 * PetscSqr(txx - tyy) + PetscSqr(txy)), //Pa
+    sigmat = sqrt(PetscSqr(T1) + PetscSqr(T2) - T1 * T2);
+
+  ///max shear stress criterion (more stringent than von mises)
+  if (m_max_shear_stress) {
+    double maxshear = fabs(T1);
+    maxshear        = std::max(maxshear, fabs(T2));
+    maxshear        = std::max(maxshear, fabs(T1 - T2));
+
+    sigmat = maxshear;
+  }
+
+  ///lefm mixed-mode criterion
+  if (m_lefm) {
+    double sigmamu = 0.1; //friction coefficient between crack faces
+
+    double sigmac = 0.64 / M_PI; //initial crack depth 20cm
+
+    double sigmabetatest, sigmanor, sigmatau, Kone, Ktwo, KSI, KSImax = 0.0, sigmatetanull;
+
+    for (int l = 46; l <= 90; ++l) { //optimize for various precursor angles beta
+      sigmabetatest = l * M_PI / 180.0;
+
+      //rist_sammonds99
+      sigmanor = 0.5 * (T1 + T2) - (T1 - T2) * cos(2 * sigmabetatest);
+      sigmatau = 0.5 * (T1 - T2) * sin(2 * sigmabetatest);
+      //shayam_wu90
+      if (sigmamu * sigmanor < 0.0) { //compressive case
+        if (fabs(sigmatau) <= fabs(sigmamu * sigmanor)) {
+          sigmatau = 0.0;
+        } else {
+          if (sigmatau > 0) { //coulomb friction opposing sliding
+            sigmatau += (sigmamu * sigmanor);
+          } else {
+            sigmatau -= (sigmamu * sigmanor);
+          }
+        }
+      }
+
+      //stress intensity factors
+      Kone = sigmanor * sqrt(M_PI * sigmac); //normal
+      Ktwo = sigmatau * sqrt(M_PI * sigmac); //shear
+
+      if (Ktwo == 0.0) {
+        sigmatetanull = 0.0;
+      } else { //eq15 in hulbe_ledoux10 or eq15 shayam_wu90
+        sigmatetanull = -2.0 * atan((sqrt(PetscSqr(Kone) + 8.0 * PetscSqr(Ktwo)) - Kone) / (4.0 * Ktwo));
+      }
+
+      KSI = cos(0.5 * sigmatetanull) *
+            (Kone * cos(0.5 * sigmatetanull) * cos(0.5 * sigmatetanull) - 0.5 * 3.0 * Ktwo * sin(sigmatetanull));
+      // mode I stress intensity
+
+      KSImax = std::max(KSI, KSImax);
+    }
+    sigmat = KSImax;
+  }
+
+  return sigmat;
+}
+
+//! Update fracture density and age, computing strain rates and stresses from `velocity`.
 void FractureDensity::update(double dt,
                              const Geometry &geometry,
                              const IceModelVec2V &velocity,
                              const IceModelVec2S &hardness,
                              const IceModelVec2S &bc_mask) {
-  const double
-    dx = m_grid->dx(),
-    dy = m_grid->dy();
-  const int
-    Mx = m_grid->Mx(),
-    My = m_grid->My();
-
-  IceModelVec2S
-    &D     = m_density,
-    &D_new = m_density_new,
-    &A     = m_age,
-    &A_new = m_age_new;
 
   m_velocity.copy_from(velocity);
 
@@ -161,281 +281,174 @@ void FractureDensity::update(double dt,
                                      geometry.cell_type,
                                      m_deviatoric_stresses);
 
-  IceModelVec::AccessList list{&m_velocity, &m_strain_rates, &m_deviatoric_stresses,
-                               &D, &D_new, &geometry.cell_type, &bc_mask, &A, &A_new,
-                               &m_growth_rate, &m_healing_rate, &m_flow_enhancement,
-                               &m_toughness};
-
-  D_new.copy_from(D);
+  update(dt, geometry, m_velocity, m_strain_rates, m_deviatoric_stresses, bc_mask);
+}
 
-  //options
-  /////////////////////////////////////////////////////////
-  double soft_residual = options::Real("-fracture_softening", "soft_residual", 1.0);
-  // assume linear response function: E_fr = (1-(1-soft_residual)*phi) -> 1-phi
-  //
-  // more: T. Albrecht, A. Levermann; Fracture-induced softening for
-  // large-scale ice dynamics; (2013), The Cryosphere Discussions 7;
-  // 4501-4544; DOI:10.5194/tcd-7-4501-2013
+//! Update fracture density and age using pre-computed strain rates and stresses.
+/*!
+ * `strain_rates` and `deviatoric_stresses` have to correspond to `velocity` (see
+ * stressbalance::StressBalance::principal_strain_rates() and
+ * stressbalance::StressBalance::deviatoric_stresses()).
+ */
+void FractureDensity::update(double dt,
+                             const Geometry &geometry,
+                             const IceModelVec2V &velocity,
+                             const IceModelVec2 &strain_rates,
+                             const IceModelVec2 &deviatoric_stresses,
+                             const IceModelVec2S &bc_mask) {
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy();
+  const int
+    Mx = m_grid->Mx(),
+    My = m_grid->My();
 
-  // get four options for calculation of fracture density.
-  // 1st: fracture growth constant gamma
-  // 2nd: fracture initiation stress threshold sigma_cr
-  // 3rd: healing rate constant gamma_h
-  // 4th: healing strain rate threshold
-  // more: T. Albrecht, A. Levermann; Fracture field for large-scale
-  // ice dynamics; (2012), Journal of Glaciology, Vol. 58, No. 207,
-  // 165-176, DOI: 10.3189/2012JoG11J191.
+  IceModelVec2S
+    &D     = m_density,
+    &D_new = m_density_new,
+    &A     = m_age,
+    &A_new = m_age_new;
 
-  double gamma = 1.0, initThreshold = 7.0e4, gammaheal = 0.0, healThreshold = 2.0e-10;
-  {
-    options::RealList fractures("-fracture_parameters",
-                                "gamma, initThreshold, gammaheal, healThreshold",
-                                {gamma, initThreshold, gammaheal, healThreshold});
-    if (fractures->size() != 4) {
-      throw RuntimeError(PISM_ERROR_LOCATION, "option -fracture_parameters requires exactly 4 arguments");
-    }
-    gamma         = fractures[0];
-    initThreshold = fractures[1];
-    gammaheal     = fractures[2];
-    healThreshold = fractures[3];
+  if (&velocity != &m_velocity) {
+    m_velocity.copy_from(velocity);
   }
 
   m_log->message(3, "PISM-PIK INFO: fracture density is found with parameters:\n"
                     " gamma=%.2f, sigma_cr=%.2f, gammah=%.2f, healing_cr=%.1e and soft_res=%f \n",
-                 gamma, initThreshold, gammaheal, healThreshold, soft_residual);
-
-  bool do_fracground = m_config->get_flag("fracture_density.include_grounded_ice");
-
-  double fdBoundaryValue = m_config->get_number("fracture_density.phi0");
-
-  bool constant_healing = m_config->get_flag("fracture_density.constant_healing");
-
-  bool fracture_weighted_healing = m_config->get_flag("fracture_density.fracture_weighted_healing");
-
-  bool max_shear_stress = m_config->get_flag("fracture_density.max_shear_stress");
-
-  bool lefm = m_config->get_flag("fracture_density.lefm");
+                 m_gamma, m_initiation_threshold, m_gamma_healing, m_healing_threshold,
+                 m_soft_residual);
 
-  bool constant_fd = m_config->get_flag("fracture_density.constant_fd");
-
-  bool fd2d_scheme = m_config->get_flag("fracture_density.fd2d_scheme");
-
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    double tempFD = 0.0;
-
-    double u = m_velocity(i, j).u;
-    double v = m_velocity(i, j).v;
-
-    if (fd2d_scheme) {
-      if (u >= dx * v / dy and v >= 0.0) { //1
-        tempFD = u * (D(i, j) - D(i - 1, j)) / dx + v * (D(i - 1, j) - D(i - 1, j - 1)) / dy;
-      } else if (u <= dx * v / dy and u >= 0.0) { //2
-        tempFD = u * (D(i, j - 1) - D(i - 1, j - 1)) / dx + v * (D(i, j) - D(i, j - 1)) / dy;
-      } else if (u >= -dx * v / dy and u <= 0.0) { //3
-        tempFD = -u * (D(i, j - 1) - D(i + 1, j - 1)) / dx + v * (D(i, j) - D(i, j - 1)) / dy;
-      } else if (u <= -dx * v / dy and v >= 0.0) { //4
-        tempFD = -u * (D(i, j) - D(i + 1, j)) / dx + v * (D(i + 1, j) - D(i + 1, j - 1)) / dy;
-      } else if (u <= dx * v / dy and v <= 0.0) { //5
-        tempFD = -u * (D(i, j) - D(i + 1, j)) / dx - v * (D(i + 1, j) - D(i + 1, j + 1)) / dy;
-      } else if (u >= dx * v / dy and u <= 0.0) { //6
-        tempFD = -u * (D(i, j + 1) - D(i + 1, j + 1)) / dx - v * (D(i, j) - D(i, j + 1)) / dy;
-      } else if (u <= -dx * v / dy and u >= 0.0) { //7
-        tempFD = u * (D(i, j + 1) - D(i - 1, j + 1)) / dx - v * (D(i, j) - D(i, j + 1)) / dy;
-      } else if (u >= -dx * v / dy and v <= 0.0) { //8
-        tempFD = u * (D(i, j) - D(i - 1, j)) / dx - v * (D(i - 1, j) - D(i - 1, j + 1)) / dy;
-      } else {
-        m_log->message(3, "######### missing case of angle %f of %f and %f at %d, %d \n",
-                       atan(v / u) / M_PI * 180., u * 3e7, v * 3e7, i, j);
+  const double
+    gamma         = m_gamma,
+    initThreshold = m_initiation_threshold,
+    gammaheal     = m_gamma_healing,
+    healThreshold = m_healing_threshold;
+
+  // All fracture quantities are computed in one pass over the grid: advection of the
+  // fracture density and age shares velocity and upwinding decisions, and sources use
+  // strain rates and stresses at the same grid point.
+  {
+    IceModelVec::AccessList list{&m_velocity, &strain_rates, &deviatoric_stresses,
+                                 &D, &D_new, &geometry.cell_type, &bc_mask, &A, &A_new,
+                                 &m_growth_rate, &m_healing_rate, &m_flow_enhancement,
+                                 &m_toughness};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      // ice free regions and boundary of computational domain
+      if (geometry.cell_type.ice_free(i, j) or
+          i == 0 or j == 0 or i == Mx - 1 or j == My - 1) {
+        D_new(i, j)              = m_constant_fd ? D(i, j) : 0.0;
+        A_new(i, j)              = 0.0;
+        m_growth_rate(i, j)      = 0.0;
+        m_healing_rate(i, j)     = 0.0;
+        m_flow_enhancement(i, j) = 1.0;
+        m_toughness(i, j)        = 0.0;
+        continue;
       }
-    } else {
-      tempFD += u * (u < 0 ? D(i + 1, j) - D(i, j) : D(i, j) - D(i - 1, j)) / dx;
-      tempFD += v * (v < 0 ? D(i, j + 1) - D(i, j) : D(i, j) - D(i, j - 1)) / dy;
-    }
-
-    D_new(i, j) -= tempFD * dt;
-
-    //sources /////////////////////////////////////////////////////////////////
-    ///von mises criterion
-
-    double
-      txx    = m_deviatoric_stresses(i, j, 0),
-      tyy    = m_deviatoric_stresses(i, j, 1),
-      txy    = m_deviatoric_stresses(i, j, 2),
-      T1     = 0.5 * (txx + tyy) + sqrt(0.25 * PetscSqr(txx - tyy) + PetscSqr(txy)), //Pa
-      T2     = 0.5 * (txx + tyy) - sqrt(0.25 * PetscSqr(txx - tyy) + PetscSqr(txy)), //Pa
-      sigmat = sqrt(PetscSqr(T1) + PetscSqr(T2) - T1 * T2);
-
-
-    ///max shear stress criterion (more stringent than von mises)
-    if (max_shear_stress) {
-      double maxshear = fabs(T1);
-      maxshear        = std::max(maxshear, fabs(T2));
-      maxshear        = std::max(maxshear, fabs(T1 - T2));
-
-      sigmat = maxshear;
-    }
 
-    ///lefm mixed-mode criterion
-    if (lefm) {
-      double sigmamu = 0.1; //friction coefficient between crack faces
+      const double
+        u = m_velocity(i, j).u,
+        v = m_velocity(i, j).v;
 
-      double sigmac = 0.64 / M_PI; //initial crack depth 20cm
+      const auto
+        d = D.star(i, j),
+        a = A.star(i, j);
 
-      double sigmabetatest, sigmanor, sigmatau, Kone, Ktwo, KSI, KSImax = 0.0, sigmatetanull;
-
-      for (int l = 46; l <= 90; ++l) { //optimize for various precursor angles beta
-        sigmabetatest = l * M_PI / 180.0;
-
-        //rist_sammonds99
-        sigmanor = 0.5 * (T1 + T2) - (T1 - T2) * cos(2 * sigmabetatest);
-        sigmatau = 0.5 * (T1 - T2) * sin(2 * sigmabetatest);
-        //shayam_wu90
-        if (sigmamu * sigmanor < 0.0) { //compressive case
-          if (fabs(sigmatau) <= fabs(sigmamu * sigmanor)) {
-            sigmatau = 0.0;
-          } else {
-            if (sigmatau > 0) { //coulomb friction opposing sliding
-              sigmatau += (sigmamu * sigmanor);
-            } else {
-              sigmatau -= (sigmamu * sigmanor);
-            }
-          }
-        }
+      // advection (first-order upwinding; upwind directions are shared by the density and
+      // the age)
+      double adv_D = 0.0, adv_A = 0.0;
+      {
+        const bool
+          u_negative = u < 0.0,
+          v_negative = v < 0.0;
 
-        //stress intensity factors
-        Kone = sigmanor * sqrt(M_PI * sigmac); //normal
-        Ktwo = sigmatau * sqrt(M_PI * sigmac); //shear
+        adv_A += u * (u_negative ? a.e - a.ij : a.ij - a.w) / dx;
+        adv_A += v * (v_negative ? a.n - a.ij : a.ij - a.s) / dy;
 
-        if (Ktwo == 0.0) {
-          sigmatetanull = 0.0;
-        } else { //eq15 in hulbe_ledoux10 or eq15 shayam_wu90
-          sigmatetanull = -2.0 * atan((sqrt(PetscSqr(Kone) + 8.0 * PetscSqr(Ktwo)) - Kone) / (4.0 * Ktwo));
+        if (m_fd2d_scheme) {
+          adv_D = upwind_2d(D, i, j, u, v, dx, dy, *m_log);
+        } else {
+          adv_D += u * (u_negative ? d.e - d.ij : d.ij - d.w) / dx;
+          adv_D += v * (v_negative ? d.n - d.ij : d.ij - d.s) / dy;
         }
-
-        KSI = cos(0.5 * sigmatetanull) *
-              (Kone * cos(0.5 * sigmatetanull) * cos(0.5 * sigmatetanull) - 0.5 * 3.0 * Ktwo * sin(sigmatetanull));
-        // mode I stress intensity
-
-        KSImax = std::max(KSI, KSImax);
       }
-      sigmat = KSImax;
-    }
 
-    //////////////////////////////////////////////////////////////////////////////
+      double D_ij = d.ij - adv_D * dt;
 
-    //fracture density
-    double fdnew = gamma * (m_strain_rates(i, j, 0) - 0.0) * (1 - D_new(i, j));
-    if (sigmat > initThreshold) {
-      D_new(i, j) += fdnew * dt;
-    }
+      // sources
+      const double
+        sigmat = fracture_stress(deviatoric_stresses(i, j, 0),
+                                 deviatoric_stresses(i, j, 1),
+                                 deviatoric_stresses(i, j, 2)),
+        e1     = strain_rates(i, j, 0);
 
-    //healing
-    double fdheal = gammaheal * (m_strain_rates(i, j, 0) - healThreshold);
-    if (geometry.cell_type.icy(i, j)) {
-      if (constant_healing) {
-        fdheal = gammaheal * (-healThreshold);
-        if (fracture_weighted_healing) {
-          D_new(i, j) += fdheal * dt * (1 - D(i, j));
-        } else {
-          D_new(i, j) += fdheal * dt;
-        }
-      } else if (m_strain_rates(i, j, 0) < healThreshold) {
-        if (fracture_weighted_healing) {
-          D_new(i, j) += fdheal * dt * (1 - D(i, j));
-        } else {
-          D_new(i, j) += fdheal * dt;
-        }
+      //fracture density
+      const double fdnew = gamma * (e1 - 0.0) * (1 - D_ij);
+      const bool fracturing = sigmat > initThreshold;
+      if (fracturing) {
+        D_ij += fdnew * dt;
       }
-    }
 
-    // bounding
-    D_new(i, j) = pism::clip(D_new(i, j), 0.0, 1.0);
+      //healing
+      double healing_rate = 0.0;
+      if (m_constant_healing or e1 < healThreshold) {
+        const double fdheal = (m_constant_healing ?
+                               gammaheal * (-healThreshold) :
+                               gammaheal * (e1 - healThreshold));
 
-    if (geometry.cell_type.icy(i, j)) {
-      //fracture toughness
-      m_toughness(i, j) = sigmat;
+        healing_rate = m_fracture_weighted_healing ? fdheal * (1 - d.ij) : fdheal;
 
-      // fracture growth rate
-      if (sigmat > initThreshold) {
-        m_growth_rate(i, j) = fdnew;
-        //m_growth_rate(i,j)=gamma*(vPrinStrain1(i,j)-0.0)*(1-D_new(i,j));
-      } else {
-        m_growth_rate(i, j) = 0.0;
+        D_ij += healing_rate * dt;
       }
 
-      // fracture healing rate
-      if (geometry.cell_type.icy(i, j)) {
-        if (constant_healing or (m_strain_rates(i, j, 0) < healThreshold)) {
-          if (fracture_weighted_healing) {
-            m_healing_rate(i, j) = fdheal * (1 - D(i, j));
-          } else {
-            m_healing_rate(i, j) = fdheal;
-          }
-        } else {
-          m_healing_rate(i, j) = 0.0;
-        }
-      }
+      // bounding
+      D_ij = pism::clip(D_ij, 0.0, 1.0);
+
+      D_new(i, j)          = D_ij;
+      m_toughness(i, j)    = sigmat;
+      m_growth_rate(i, j)  = fracturing ? fdnew : 0.0;
+      m_healing_rate(i, j) = healing_rate;
 
       // fracture age since fracturing occurred
-      {
-        auto a = A.star(i, j);
-        A_new(i, j) -= dt * u * (u < 0 ? a.e - a.ij : a.ij - a.w) / dx;
-        A_new(i, j) -= dt * v * (v < 0 ? a.n - a.ij : a.ij - a.s) / dy;
-        A_new(i, j) += dt;
-        if (sigmat > initThreshold) {
-          A_new(i, j) = 0.0;
-        }
-      }
+      A_new(i, j) = fracturing ? 0.0 : a.ij - dt * adv_A + dt;
 
       // additional flow enhancement due to fracture softening
-      double phi_exp   = 3.0; //flow_law->exponent();
-      double softening = pow((1.0 - (1.0 - soft_residual) * D_new(i, j)), -phi_exp);
-      if (geometry.cell_type.icy(i, j)) {
+      {
+        double phi_exp   = 3.0; //flow_law->exponent();
+        double softening = pow((1.0 - (1.0 - m_soft_residual) * D_ij), -phi_exp);
         m_flow_enhancement(i, j) = 1.0 / pow(softening, 1 / 3.0);
-      } else {
-        m_flow_enhancement(i, j) = 1.0;
-      }
-    }
-
-    // boundary condition
-    if (geometry.cell_type.grounded(i, j) and not do_fracground) {
-
-      if (bc_mask(i, j) > 0.5) {
-        D_new(i, j) = fdBoundaryValue;
-
-        {
-          A_new(i, j)              = 0.0;
-          m_growth_rate(i, j)      = 0.0;
-          m_healing_rate(i, j)     = 0.0;
-          m_flow_enhancement(i, j) = 1.0;
-          m_toughness(i, j)        = 0.0;
-        }
       }
-    }
-
-    // ice free regions and boundary of computational domain
-    if (geometry.cell_type.ice_free(i, j) or i == 0 or j == 0 or i == Mx - 1 or j == My - 1) {
 
-      D_new(i, j) = 0.0;
-
-      {
+      // boundary condition
+      if (geometry.cell_type.grounded(i, j) and not m_include_grounded_ice and
+          bc_mask(i, j) > 0.5) {
+        D_new(i, j)              = m_phi0;
         A_new(i, j)              = 0.0;
         m_growth_rate(i, j)      = 0.0;
         m_healing_rate(i, j)     = 0.0;
         m_flow_enhancement(i, j) = 1.0;
         m_toughness(i, j)        = 0.0;
       }
+
+      if (m_constant_fd) { // no fd evolution
+        D_new(i, j) = D(i, j);
+      }
     }
 
-    if (constant_fd) { // no fd evolution
-      D_new(i, j) = D(i, j);
+    // D and A cannot be updated in place because the loop above reads their neighbors
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      D(i, j) = D_new(i, j);
+      A(i, j) = A_new(i, j);
     }
   }
 
-  A_new.update_ghosts(A);
-  D_new.update_ghosts(D);
+  m_ghost_exchange.update();
+  D.inc_state_counter();
+  A.inc_state_counter();
 }
 
 DiagnosticList FractureDensity::diagnostics_impl() const {
@@ -21,6 +21,7 @@
 
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Component.hh"
+#include "pism/util/GhostExchange.hh"
 #include "pism/rheology/FlowLaw.hh"
 
 namespace pism {
@@ -45,6 +46,13 @@ public:
               const IceModelVec2S &hardness,
               const IceModelVec2S &inflow_boundary_mask);
 
+  void update(double dt,
+              const Geometry &geometry,
+              const IceModelVec2V &velocity,
+              const IceModelVec2 &strain_rates,
+              const IceModelVec2 &deviatoric_stresses,
+              const IceModelVec2S &inflow_boundary_mask);
+
   const IceModelVec2S& density() const;
   const IceModelVec2S& growth_rate() const;
   const IceModelVec2S& healing_rate() const;
@@ -59,6 +67,8 @@ private:
 
   DiagnosticList diagnostics_impl() const;
 
+  double fracture_stress(double txx, double tyy, double txy) const;
+
   IceModelVec2S m_density;
   IceModelVec2S m_density_new;
   IceModelVec2S m_growth_rate;
@@ -78,6 +88,32 @@ private:
   IceModelVec2V m_velocity;
 
   std::shared_ptr<const rheology::FlowLaw> m_flow_law;
+
+  //! Updates ghosts of m_density and m_age using one exchange
+  GhostExchange m_ghost_exchange;
+
+  // parameters (see the constructor)
+
+  //! residual ice softness of fully fractured ice
+  double m_soft_residual;
+  //! fracture growth constant
+  double m_gamma;
+  //! fracture initiation stress threshold
+  double m_initiation_threshold;
+  //! healing rate constant
+  double m_gamma_healing;
+  //! healing strain rate threshold
+  double m_healing_threshold;
+  //! fracture density at the in-flow boundary
+  double m_phi0;
+
+  bool m_include_grounded_ice;
+  bool m_constant_healing;
+  bool m_fracture_weighted_healing;
+  bool m_max_shear_stress;
+  bool m_lefm;
+  bool m_constant_fd;
+  bool m_fd2d_scheme;
 };
 
 } // end of namespace pism
@@ -29,7 +29,8 @@ namespace pism {
 
 FrontRetreat::FrontRetreat(IceGrid::ConstPtr g)
   : Component(g),
-    m_tmp(m_grid, "temporary_storage", WITH_GHOSTS, 1) {
+    m_tmp(m_grid, "temporary_storage", WITH_GHOSTS, 1),
+    m_front(m_grid) {
 
   m_tmp.set_attrs("internal", "additional mass loss at points near the front",
                   "m", "m", "", 0);
@@ -93,8 +94,10 @@ MaxTimestep FrontRetreat::max_timestep(const IceModelVec2CellType &cell_type,
 
   IceModelVec::AccessList list{&cell_type, &bc_mask, &retreat_rate};
 
-  for (Points pt(*grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
+  m_front.update(cell_type);
+
+  for (const auto &pt : m_front.points()) {
+    const int i = pt.i, j = pt.j;
 
     if (cell_type.ice_free_ocean(i, j) and
         cell_type.next_to_ice(i, j) and
@@ -119,10 +122,7 @@ MaxTimestep FrontRetreat::max_timestep(const IceModelVec2CellType &cell_type,
     retreat_rate_mean = 0.0;
   }
 
-  double denom = retreat_rate_max / grid->dx();
-  const double epsilon = convert(sys, 0.001 / (grid->dx() + grid->dy()), "seconds", "years");
-
-  double dt = 1.0 / (denom + epsilon);
+  double dt = max_timestep_for_rate(retreat_rate_max);
 
   m_log->message(3,
                  "  frontal retreat: maximum rate = %.2f m/year gives dt=%.5f years\n"
@@ -135,6 +135,51 @@ MaxTimestep FrontRetreat::max_timestep(const IceModelVec2CellType &cell_type,
   return MaxTimestep(std::max(dt, dt_min), "front_retreat");
 }
 
+/*!
+ * Maximum time step length corresponding to the retreat rate `retreat_rate_max`.
+ */
+double FrontRetreat::max_timestep_for_rate(double retreat_rate_max) const {
+  double denom = retreat_rate_max / m_grid->dx();
+  const double epsilon = units::convert(m_sys, 0.001 / (m_grid->dx() + m_grid->dy()),
+                                        "seconds", "years");
+
+  return 1.0 / (denom + epsilon);
+}
+
+/*!
+ * Same as max_timestep(), but uses the retreat rate in the sub-domain owned by this rank
+ * and does not communicate.
+ *
+ * The time step restriction is a decreasing function of the maximum retreat rate, so the
+ * minimum of these values over all ranks is equal to the value returned by
+ * max_timestep().
+ */
+MaxTimestep FrontRetreat::max_timestep_local(const IceModelVec2CellType &cell_type,
+                                             const IceModelVec2Int &bc_mask,
+                                             const IceModelVec2S &retreat_rate) const {
+  // About 9 hours which corresponds to 10000 km year-1 on a 10 km grid
+  double dt_min = units::convert(m_sys, 0.001, "years", "seconds");
+
+  double retreat_rate_max = 0.0;
+
+  IceModelVec::AccessList list{&cell_type, &bc_mask, &retreat_rate};
+
+  m_front.update(cell_type);
+
+  for (const auto &pt : m_front.points()) {
+    const int i = pt.i, j = pt.j;
+
+    if (cell_type.ice_free_ocean(i, j) and
+        cell_type.next_to_ice(i, j) and
+        bc_mask(i, j) < 0.5) {
+      // NB: this condition has to match the one in update_geometry()
+      retreat_rate_max = std::max(retreat_rate(i, j), retreat_rate_max);
+    }
+  }
+
+  return MaxTimestep(std::max(max_timestep_for_rate(retreat_rate_max), dt_min), "front_retreat");
+}
+
 /*!
  * Update ice geometry by applying a horizontal retreat rate.
  *
@@ -169,6 +214,9 @@ void FrontRetreat::update_geometry(double dt,
 
   m_tmp.set(0.0);
 
+  // Both steps below modify ice geometry at points near the front only.
+  m_front.update(geometry.cell_type);
+
   IceModelVec::AccessList list{&ice_thickness, &bc_mask,
       &bed, &sea_level, &m_cell_type, &Href, &m_tmp, &retreat_rate,
       &surface_elevation};
@@ -177,14 +225,14 @@ void FrontRetreat::update_geometry(double dt,
   const Direction dirs[] = {North, East, South, West};
 
   // Step 1: Apply the computed horizontal retreat rate:
-  for (Points pt(*m_grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
+  for (const auto &pt : m_front.points()) {
+    const int i = pt.i, j = pt.j;
 
     // apply retreat rate at the margin (i.e. to partially-filled cells) only
     if (m_cell_type.ice_free_ocean(i, j) and
         m_cell_type.next_to_ice(i, j) and
         bc_mask(i, j) < 0.5) {
-      // NB: this condition has to match the one in max_timestep()
+      // NB: this condition has to match the one in max_timestep() and max_timestep_local()
 
       const double
         rate     = retreat_rate(i, j),
@@ -245,13 +293,13 @@ void FrontRetreat::update_geometry(double dt,
       }
 
     } // end of "if ice free ocean next to ice and not a BC location "
-  }   // end of loop over grid points
+  }   // end of loop over points near the front
 
   // Step 2: update ice thickness and Href in neighboring cells if we need to propagate mass losses.
   m_tmp.update_ghosts();
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  for (const auto &p : m_front.points()) {
+    const int i = p.i, j = p.j;
 
     // Note: this condition has to match the one in step 1 above.
     if (bc_mask.as_int(i, j) == 0 and
@@ -272,6 +320,9 @@ void FrontRetreat::update_geometry(double dt,
       }
     }
   }
+
+  ice_thickness.inc_state_counter();
+  Href.inc_state_counter();
 }
 
 } // end of namespace pism
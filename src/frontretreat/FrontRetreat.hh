@@ -24,6 +24,7 @@
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/util/MaxTimestep.hh"
+#include "pism/frontretreat/util/FrontBand.hh"
 
 namespace pism {
 
@@ -49,7 +50,12 @@ public:
   MaxTimestep max_timestep(const IceModelVec2CellType &cell_type,
                            const IceModelVec2Int &bc_mask,
                            const IceModelVec2S &retreat_rate) const;
+
+  MaxTimestep max_timestep_local(const IceModelVec2CellType &cell_type,
+                                 const IceModelVec2Int &bc_mask,
+                                 const IceModelVec2S &retreat_rate) const;
 private:
+  double max_timestep_for_rate(double retreat_rate_max) const;
 
   void compute_modified_mask(const IceModelVec2CellType &input,
                              IceModelVec2CellType &output) const;
@@ -62,6 +68,13 @@ private:
   // Temporary storage for distributing ice loss to "full" (as opposed to "partially
   // filled") cells near the front
   IceModelVec2S m_tmp;
+
+  // Grid points near the calving front (computed using the cell type mask *before*
+  // modifications made to prevent wrap-around; this band contains all the points
+  // where retreat rates are applied and mass losses are distributed to).
+  //
+  // Mutable because max_timestep() and max_timestep_local() update it.
+  mutable FrontBand m_front;
 };
 
 } // end of namespace pism
@@ -85,6 +85,9 @@ void PrescribedRetreat::update(double t,
       // M == 1.0: do nothing
     }
   }
+
+  ice_thickness.inc_state_counter();
+  ice_area_specific_volume.inc_state_counter();
 }
 
 MaxTimestep PrescribedRetreat::max_timestep_impl(double t) const {
@@ -96,7 +96,9 @@ void CalvingAtThickness::update(IceModelVec2CellType &pism_mask,
   }
 
   pism_mask.update_ghosts();
+  pism_mask.inc_state_counter();
   ice_thickness.update_ghosts();
+  ice_thickness.inc_state_counter();
 }
 
 const IceModelVec2S& CalvingAtThickness::threshold() const {
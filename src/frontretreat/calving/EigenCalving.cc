@@ -62,10 +62,9 @@ void EigenCalving::init() {
   See equation (26) in [\ref Winkelmannetal2011].
 */
 void EigenCalving::update(const IceModelVec2CellType &cell_type,
-                          const IceModelVec2V &ice_velocity) {
+                          const IceModelVec2 &strain_rates) {
 
-  // make a copy with a wider stencil
-  m_cell_type.copy_from(cell_type);
+  update_strain_rates(cell_type, strain_rates);
 
   // Distance (grid cells) from calving front where strain rate is evaluated
   int offset = m_stencil_width;
@@ -74,15 +73,14 @@ void EigenCalving::update(const IceModelVec2CellType &cell_type,
   // regime
   const double eigenCalvOffset = 0.0;
 
-  stressbalance::compute_2D_principal_strain_rates(ice_velocity, m_cell_type,
-                                                   m_strain_rates);
-  m_strain_rates.update_ghosts();
-
   IceModelVec::AccessList list{&m_cell_type, &m_calving_rate, &m_strain_rates};
 
+  // The calving rate is zero away from the calving front.
+  m_calving_rate.set(0.0);
+
   // Compute the horizontal calving rate
-  for (Points pt(*m_grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
+  for (const auto &pt : m_front.points()) {
+    const int i = pt.i, j = pt.j;
 
     // Find partially filled or empty grid boxes on the icefree ocean, which
     // have floating ice neighbors after the mass continuity step
@@ -130,10 +128,8 @@ void EigenCalving::update(const IceModelVec2CellType &cell_type,
         m_calving_rate(i, j) = 0.0;
       }
 
-    } else { // end of "if (ice_free_ocean and next_to_floating)"
-      m_calving_rate(i, j) = 0.0;
-    }
-  } // end of the loop over grid points
+    } // end of "if (ice_free_ocean and next_to_floating)"
+  } // end of the loop over points near the calving front
 }
 
 DiagnosticList EigenCalving::diagnostics_impl() const {
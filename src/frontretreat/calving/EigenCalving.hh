@@ -34,7 +34,7 @@ public:
 
   void init();
 
-  void update(const IceModelVec2CellType &cell_type, const IceModelVec2V &ice_velocity);
+  void update(const IceModelVec2CellType &cell_type, const IceModelVec2 &strain_rates);
 protected:
   DiagnosticList diagnostics_impl() const;
 
@@ -68,25 +68,29 @@ void FloatKill::update(IceModelVec2CellType &mask, IceModelVec2S &ice_thickness)
 
   const bool dont_calve_near_grounded_ice = not m_calve_near_grounding_line;
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  // Note: the loop below modifies the mask, but the list of floating points is not
+  // re-computed until inc_state_counter() is called.
+  const IndexList &floating_ice = mask.index_list(IceModelVec2CellType::FLOATING_ICE);
 
-    if (mask.floating_ice(i, j)) {
-      if (m_margin_only and not mask.next_to_ice_free_ocean(i, j)) {
-        continue;
-      }
+  for (PointsInList p(floating_ice); p; p.next()) {
+    const int i = p.i(), j = p.j();
 
-      if (dont_calve_near_grounded_ice and mask.next_to_grounded_ice(i, j)) {
-        continue;
-      }
+    if (m_margin_only and not mask.next_to_ice_free_ocean(i, j)) {
+      continue;
+    }
 
-      ice_thickness(i, j) = 0.0;
-      mask(i, j)          = MASK_ICE_FREE_OCEAN;
+    if (dont_calve_near_grounded_ice and mask.next_to_grounded_ice(i, j)) {
+      continue;
     }
+
+    ice_thickness(i, j) = 0.0;
+    mask(i, j)          = MASK_ICE_FREE_OCEAN;
   }
 
   mask.update_ghosts();
+  mask.inc_state_counter();
   ice_thickness.update_ghosts();
+  ice_thickness.inc_state_counter();
 }
 
 } // end of namespace calving
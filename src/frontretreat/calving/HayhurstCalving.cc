@@ -29,7 +29,8 @@ namespace calving {
 
 HayhurstCalving::HayhurstCalving(IceGrid::ConstPtr grid)
   : Component(grid),
-    m_calving_rate(grid, "hayhurst_calving_rate", WITH_GHOSTS)
+    m_calving_rate(grid, "hayhurst_calving_rate", WITH_GHOSTS),
+    m_front(grid)
 {
   m_calving_rate.set_attrs("diagnostic",
                            "horizontal calving rate due to Hayhurst calving",
@@ -50,6 +51,10 @@ void HayhurstCalving::init() {
   m_exponent_r = m_config->get_number("calving.hayhurst_calving.exponent_r");
   m_sigma_threshold = m_config->get_number("calving.hayhurst_calving.sigma_threshold", "Pa");
 
+  m_ice_density      = m_config->get_number("constants.ice.density");
+  m_water_density    = m_config->get_number("constants.sea_water.density");
+  m_standard_gravity = m_config->get_number("constants.standard_gravity");
+
   m_log->message(2,
                  "  B tilde parameter: %3.3f MPa-%3.3f yr-1.\n", m_B_tilde, m_exponent_r);
   m_log->message(2,
@@ -74,17 +79,25 @@ void HayhurstCalving::update(const IceModelVec2CellType &cell_type,
   using std::min;
 
   const double
-    ice_density   = m_config->get_number("constants.ice.density"),
-    water_density = m_config->get_number("constants.sea_water.density"),
-    gravity       = m_config->get_number("constants.standard_gravity"),
+    ice_density   = m_ice_density,
+    water_density = m_water_density,
+    gravity       = m_standard_gravity,
     // convert "Pa" to "MPa" and "m yr-1" to "m s-1"
     unit_scaling  = pow(1e-6, m_exponent_r) * convert(m_sys, 1.0, "m year-1", "m second-1");
 
   IceModelVec::AccessList list{&ice_thickness, &cell_type, &m_calving_rate, &sea_level,
                                &bed_elevation};
 
-  for (Points pt(*m_grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
+  Config::LookupGuard guard(*m_config, "HayhurstCalving::update()");
+
+  m_front.update(cell_type);
+
+  // The front retreat code uses the calving rate at icy cells at the margin and ice-free
+  // cells next to them, so here we compute it near the calving front only.
+  m_calving_rate.set(0.0);
+
+  for (const auto &pt : m_front.points()) {
+    const int i = pt.i, j = pt.j;
 
     double water_depth = sea_level(i, j) - bed_elevation(i, j);
 
@@ -118,21 +131,18 @@ void HayhurstCalving::update(const IceModelVec2CellType &cell_type,
       m_calving_rate(i, j) = (m_B_tilde * unit_scaling *
                               (1.0 - pow(omega, 2.8)) *
                               pow(sigma_0 - m_sigma_threshold, m_exponent_r) * H);
-    } else { // end of "if (ice_free_ocean and next_to_floating)"
-      m_calving_rate(i, j) = 0.0;
-    }
-  }   // end of loop over grid points
+    } // end of "if (icy and water_depth > 0)"
+  }   // end of loop over points near the calving front
 
   // Set calving rate *near* grounded termini to the average of grounded icy
-  // neighbors: front retreat code uses values at these locations (the rest is for
-  // visualization).
+  // neighbors: front retreat code uses values at these locations.
 
   m_calving_rate.update_ghosts();
 
   const Direction dirs[] = {North, East, South, West};
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  for (const auto &p : m_front.points()) {
+    const int i = p.i, j = p.j;
 
     if (cell_type.ice_free(i, j) and cell_type.next_to_ice(i, j) ) {
 
@@ -21,6 +21,7 @@
 #define HAYHURSTCALVING_H
 
 #include "pism/util/Component.hh"
+#include "pism/frontretreat/util/FrontBand.hh"
 
 namespace pism {
 
@@ -46,7 +47,11 @@ protected:
 protected:
   IceModelVec2S m_calving_rate;
 
+  // grid points near the calving front
+  FrontBand m_front;
+
   double m_B_tilde, m_exponent_r, m_sigma_threshold;
+  double m_ice_density, m_water_density, m_standard_gravity;
 
 };
 
@@ -28,7 +28,8 @@ StressCalving::StressCalving(IceGrid::ConstPtr grid,
     m_stencil_width(stencil_width),
     m_strain_rates(m_grid, "strain_rates", WITH_GHOSTS,
                    m_stencil_width,
-                   2 /* 2 components */) {
+                   2 /* 2 components */),
+    m_front(m_grid) {
 
   m_strain_rates.metadata(0).set_name("eigen1");
   m_strain_rates.set_attrs("internal",
@@ -51,6 +52,34 @@ const IceModelVec2S &StressCalving::calving_rate() const {
   return m_calving_rate;
 }
 
+//! Update `m_cell_type`, principal strain rates `m_strain_rates` and the front band.
+/*!
+ * Principal strain rates are computed (and shared with other models) by the stress
+ * balance model (see stressbalance::StressBalance::principal_strain_rates()). Here we
+ * make copies with wider stencils.
+ *
+ * Skips copying if `cell_type` and `strain_rates` did not change since the last call.
+ */
+void StressCalving::update_strain_rates(const IceModelVec2CellType &cell_type,
+                                        const IceModelVec2 &strain_rates) {
+  const DependencyTracker::Inputs fields{&cell_type, &strain_rates,
+      &m_cell_type, &m_strain_rates};
+
+  if (not m_strain_rates_inputs.changed(fields)) {
+    return;
+  }
+
+  // make copies with a wider stencil
+  m_cell_type.copy_from(cell_type);
+
+  strain_rates.update_ghosts(m_strain_rates);
+  m_strain_rates.inc_state_counter();
+
+  m_front.update(m_cell_type);
+
+  m_strain_rates_inputs.record(fields);
+}
+
 
 StressCalving::~StressCalving() {
   // empty
@@ -22,6 +22,8 @@
 
 #include "pism/util/Component.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/DependencyTracker.hh"
+#include "pism/frontretreat/util/FrontBand.hh"
 
 namespace pism {
 
@@ -36,6 +38,9 @@ public:
   const IceModelVec2S &calving_rate() const;
 
 protected:
+  void update_strain_rates(const IceModelVec2CellType &cell_type,
+                           const IceModelVec2 &strain_rates);
+
   const int m_stencil_width;
 
   IceModelVec2 m_strain_rates;
@@ -43,6 +48,12 @@ protected:
   IceModelVec2S m_calving_rate;
 
   IceModelVec2CellType m_cell_type;
+
+  // inputs and outputs of the last update_strain_rates() call
+  DependencyTracker m_strain_rates_inputs;
+
+  // grid points near the calving front (computed using m_cell_type)
+  FrontBand m_front;
 };
 
 
@@ -99,6 +99,7 @@ void vonMisesCalving::init() {
 void vonMisesCalving::update(const IceModelVec2CellType &cell_type,
                              const IceModelVec2S &ice_thickness,
                              const IceModelVec2V &ice_velocity,
+                             const IceModelVec2 &strain_rates,
                              const IceModelVec3 &ice_enthalpy) {
 
   using std::max;
@@ -106,12 +107,7 @@ void vonMisesCalving::update(const IceModelVec2CellType &cell_type,
   // Distance (grid cells) from calving front where strain rate is evaluated
   int offset = m_stencil_width;
 
-  // make a copy with a wider stencil
-  m_cell_type.copy_from(cell_type);
-
-  stressbalance::compute_2D_principal_strain_rates(ice_velocity, m_cell_type,
-                                                   m_strain_rates);
-  m_strain_rates.update_ghosts();
+  update_strain_rates(cell_type, strain_rates);
 
   IceModelVec::AccessList list{&ice_enthalpy, &ice_thickness, &m_cell_type, &ice_velocity,
                                &m_strain_rates, &m_calving_rate, &m_calving_threshold};
@@ -120,8 +116,11 @@ void vonMisesCalving::update(const IceModelVec2CellType &cell_type,
 
   double glen_exponent = m_flow_law->exponent();
 
-  for (Points pt(*m_grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
+  // The calving rate is zero away from the calving front.
+  m_calving_rate.set(0.0);
+
+  for (const auto &pt : m_front.points()) {
+    const int i = pt.i, j = pt.j;
 
     // Find partially filled or empty grid boxes on the icefree ocean, which
     // have floating ice neighbors after the mass continuity step
@@ -184,10 +183,8 @@ void vonMisesCalving::update(const IceModelVec2CellType &cell_type,
       // Calving law [\ref Morlighem2016] equation 4
       m_calving_rate(i, j) = velocity_magnitude * sigma_tilde / m_calving_threshold(i, j);
 
-    } else { // end of "if (ice_free_ocean and next_to_floating)"
-      m_calving_rate(i, j) = 0.0;
-    }
-  }   // end of loop over grid points
+    } // end of "if (ice_free_ocean and next_to_ice)"
+  }   // end of loop over points near the calving front
 }
 
 const IceModelVec2S& vonMisesCalving::threshold() const {
@@ -42,6 +42,7 @@ public:
   void update(const IceModelVec2CellType &cell_type,
               const IceModelVec2S &ice_thickness,
               const IceModelVec2V &ice_velocity,
+              const IceModelVec2 &strain_rates,
               const IceModelVec3 &ice_enthalpy);
   const IceModelVec2S& threshold() const;
 
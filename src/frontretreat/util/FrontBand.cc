@@ -0,0 +1,59 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "FrontBand.hh"
+#include "pism/util/IceModelVec2CellType.hh"
+
+namespace pism {
+
+FrontBand::FrontBand(IceGrid::ConstPtr grid)
+  : m_grid(grid) {
+  // empty
+}
+
+//! Re-compute the band if `cell_type` changed since the last call.
+/*!
+ * Requires ghosts of `cell_type` (stencil width of at least 1).
+ */
+void FrontBand::update(const IceModelVec2CellType &cell_type) {
+  if (not m_inputs.changed({&cell_type})) {
+    return;
+  }
+
+  m_points.clear();
+
+  IceModelVec::AccessList list{&cell_type};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if ((cell_type.ice_free(i, j) and cell_type.next_to_ice(i, j)) or
+        cell_type.ice_margin(i, j)) {
+      m_points.push_back({i, j});
+    }
+  }
+
+  m_inputs.record({&cell_type});
+}
+
+const std::vector<FrontBand::Point>& FrontBand::points() const {
+  return m_points;
+}
+
+} // end of namespace pism
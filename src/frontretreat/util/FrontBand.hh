@@ -0,0 +1,69 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_FRONTBAND_H
+#define PISM_FRONTBAND_H
+
+#include <vector>
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/DependencyTracker.hh"
+
+namespace pism {
+
+class IceModelVec2CellType;
+
+//! List of grid points (owned by this rank) on either side of the ice margin.
+/*!
+ * The band contains ice-free cells next to ice and icy cells next to ice-free cells
+ * (using 4-neighbors). Calving laws and the front retreat code only use values at these
+ * locations, so they can iterate over the band instead of the whole grid:
+ *
+ * \code
+ * m_front.update(cell_type);
+ *
+ * for (const auto &p : m_front.points()) {
+ *   const int i = p.i, j = p.j;
+ *   ...
+ * }
+ * \endcode
+ *
+ * The band is re-computed only if the cell type mask changed since the last call of
+ * update() (see DependencyTracker).
+ */
+class FrontBand {
+public:
+  struct Point {
+    int i, j;
+  };
+
+  FrontBand(IceGrid::ConstPtr grid);
+
+  void update(const IceModelVec2CellType &cell_type);
+
+  const std::vector<Point>& points() const;
+private:
+  IceGrid::ConstPtr m_grid;
+  std::vector<Point> m_points;
+  DependencyTracker m_inputs;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_FRONTBAND_H */
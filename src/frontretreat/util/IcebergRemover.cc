@@ -18,21 +18,29 @@
  */
 
 #include "IcebergRemover.hh"
-#include "pism/util/connected_components.hh"
+#include "pism/util/label_components.hh"
 #include "pism/util/Mask.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/pism_utilities.hh"
 
 namespace pism {
 namespace calving {
 
+static const int
+  mask_grounded_ice = 1,
+  mask_floating_ice = 2;
+
 IcebergRemover::IcebergRemover(IceGrid::ConstPtr g)
   : Component(g),
-    m_iceberg_mask(m_grid, "iceberg_mask", WITHOUT_GHOSTS){
-
-  m_mask_p0 = m_iceberg_mask.allocate_proc0_copy();
+    m_iceberg_mask(m_grid, "iceberg_mask", WITHOUT_GHOSTS),
+    m_ice_class(m_grid, "ice_class", WITH_GHOSTS),
+    m_ice_class_previous(m_grid, "ice_class_previous", WITH_GHOSTS),
+    m_have_previous(false),
+    m_skipped_updates(0) {
+  // empty
 }
 
 IcebergRemover::~IcebergRemover() {
@@ -42,83 +50,137 @@ IcebergRemover::~IcebergRemover() {
 void IcebergRemover::init() {
 }
 
-/**
- * Use PISM's ice cover mask to update ice thickness, removing "icebergs".
+/*!
+ * Classify grid cells: grounded ice (and icy Dirichlet B.C. locations, which we don't
+ * want removed), floating ice, or no ice. Updates ghosts of `result`.
+ */
+void IcebergRemover::compute_ice_class(const IceModelVec2Int &bc_mask,
+                                       const IceModelVec2CellType &mask,
+                                       IceModelVec2Int &result) const {
+  IceModelVec::AccessList list{&mask, &bc_mask, &result};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (mask.grounded_ice(i, j) or (bc_mask(i, j) > 0.5 and mask.icy(i, j))) {
+      result(i, j) = mask_grounded_ice;
+    } else if (mask.floating_ice(i, j)) {
+      result(i, j) = mask_floating_ice;
+    } else {
+      result(i, j) = 0.0;
+    }
+  }
+
+  result.update_ghosts();
+}
+
+/*!
+ * Returns false if changes of the ice cover since the last update (which removed all
+ * icebergs) cannot create new icebergs, i.e. if
  *
- * @param[in,out] pism_mask PISM's ice cover mask
- * @param[in,out] ice_thickness ice thickness
+ * - no icy cell became ice-free,
+ * - no grounded cell became floating, and
+ * - each new floating cell is next to a cell that was icy before and is icy now.
+ *
+ * Cells that became grounded cannot detach anything.
  */
-void IcebergRemover::update(const IceModelVec2Int &bc_mask,
-                            IceModelVec2CellType &mask,
-                            IceModelVec2S &ice_thickness) {
-  const int
-    mask_grounded_ice = 1,
-    mask_floating_ice = 2;
+bool IcebergRemover::may_have_icebergs() const {
+  IceModelVec::AccessList list{&m_ice_class, &m_ice_class_previous};
 
-  // prepare the mask that will be handed to the connected component
-  // labeling code:
-  {
-    m_iceberg_mask.set(0.0);
+  const IceModelVec2Int
+    &current  = m_ice_class,
+    &previous = m_ice_class_previous;
 
-    IceModelVec::AccessList list{&mask, &m_iceberg_mask, &bc_mask};
+  int unsafe = 0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
 
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+    const int
+      old_class = previous.as_int(i, j),
+      new_class = current.as_int(i, j);
 
-      if (mask.grounded_ice(i,j) == true) {
-        m_iceberg_mask(i,j) = mask_grounded_ice;
-      } else if (mask.floating_ice(i,j) == true) {
-        m_iceberg_mask(i,j) = mask_floating_ice;
-      }
+    if (old_class == new_class or new_class == mask_grounded_ice) {
+      continue;
     }
 
-    // Mark icy Dirichlet B.C. cells as "grounded" because we don't want them removed.
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+    if (new_class == 0 or old_class == mask_grounded_ice) {
+      // removed ice or a grounded cell became floating
+      unsafe = 1;
+      break;
+    }
 
-      if (bc_mask(i, j) > 0.5 and mask.icy(i, j)) {
-        m_iceberg_mask(i, j) = mask_grounded_ice;
-      }
+    // old_class == 0 and new_class == mask_floating_ice: check if this cell is attached to
+    // ice that was present during the last update
+    auto C = current.int_star(i, j);
+    auto P = previous.int_star(i, j);
+    const bool attached = ((C.e > 0 and P.e > 0) or (C.w > 0 and P.w > 0) or
+                           (C.n > 0 and P.n > 0) or (C.s > 0 and P.s > 0));
+    if (not attached) {
+      unsafe = 1;
+      break;
     }
   }
 
-  // identify icebergs using serial code on processor 0:
-  {
-    m_iceberg_mask.put_on_proc0(*m_mask_p0);
+  return GlobalMax(m_grid->com, unsafe) > 0;
+}
 
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_mask_p0);
-        label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), true, mask_grounded_ice);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
+/**
+ * Use PISM's ice cover mask to update ice thickness, removing "icebergs".
+ *
+ * @param[in,out] pism_mask PISM's ice cover mask
+ * @param[in,out] ice_thickness ice thickness
+ */
+void IcebergRemover::update(const IceModelVec2Int &bc_mask,
+                            IceModelVec2CellType &mask,
+                            IceModelVec2S &ice_thickness) {
+
+  compute_ice_class(bc_mask, mask, m_ice_class);
 
-    m_iceberg_mask.get_from_proc0(*m_mask_p0);
+  const int full_check_interval = m_config->get_number("geometry.remove_icebergs_full_check_interval");
+
+  bool relabel = true;
+  if (full_check_interval > 0 and m_have_previous and
+      m_skipped_updates + 1 < full_check_interval) {
+    relabel = may_have_icebergs();
   }
 
-  // correct ice thickness and the cell type mask using the resulting
-  // "iceberg" mask:
-  {
-    IceModelVec::AccessList list{&ice_thickness, &mask, &m_iceberg_mask, &bc_mask};
+  if (relabel) {
+    // identify icebergs:
+    m_iceberg_mask.copy_from(m_ice_class);
+    label_components(m_iceberg_mask, true, mask_grounded_ice);
+
+    // correct ice thickness and the cell type mask using the resulting
+    // "iceberg" mask:
+    {
+      IceModelVec::AccessList list{&ice_thickness, &mask, &m_iceberg_mask, &bc_mask, &m_ice_class};
 
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
 
-      if (m_iceberg_mask(i,j) > 0.5 && bc_mask(i,j) < 0.5) {
-        ice_thickness(i,j) = 0.0;
-        mask(i,j)     = MASK_ICE_FREE_OCEAN;
+        if (m_iceberg_mask(i,j) > 0.5 && bc_mask(i,j) < 0.5) {
+          ice_thickness(i,j) = 0.0;
+          mask(i,j)     = MASK_ICE_FREE_OCEAN;
+          m_ice_class(i, j) = 0.0;
+        }
       }
     }
+    m_skipped_updates = 0;
+  } else {
+    m_skipped_updates += 1;
+  }
+
+  if (full_check_interval > 0) {
+    m_ice_class_previous.copy_from(m_ice_class);
+    m_ice_class_previous.update_ghosts();
+    m_have_previous = true;
   }
 
   // update ghosts of the mask and the ice thickness (then surface
   // elevation can be updated redundantly)
   mask.update_ghosts();
+  mask.inc_state_counter();
   ice_thickness.update_ghosts();
+  ice_thickness.inc_state_counter();
 }
 
 } // end of namespace calving
@@ -45,6 +45,11 @@ namespace calving {
  *
  * This class uses a serial connected component labeling algorithm to
  * remove "icebergs".
+ *
+ * Labeling gathers the mask on rank 0, so it is expensive on large grids. If
+ * `geometry.remove_icebergs_full_check_interval` is positive, this class remembers the
+ * ice cover after the last labeling and skips labeling if all changes since then are
+ * known to keep all floating ice attached (see may_have_icebergs()).
  */
 class IcebergRemover : public Component
 {
@@ -57,8 +62,21 @@ public:
               IceModelVec2CellType &pism_mask,
               IceModelVec2S &ice_thickness);
 protected:
-  IceModelVec2S m_iceberg_mask;
-  petsc::Vec::Ptr m_mask_p0;
+  void compute_ice_class(const IceModelVec2Int &bc_mask,
+                         const IceModelVec2CellType &mask,
+                         IceModelVec2Int &result) const;
+  bool may_have_icebergs() const;
+
+  IceModelVec2Int m_iceberg_mask;
+
+  //! ice cover: grounded (or Dirichlet B.C.), floating, or ice-free
+  IceModelVec2Int m_ice_class;
+  //! ice cover after the last update (contains no icebergs)
+  IceModelVec2Int m_ice_class_previous;
+  //! true if m_ice_class_previous is valid
+  bool m_have_previous;
+  //! number of calls since the last connected component labeling
+  int m_skipped_updates;
 };
 
 } // end of namespace calving
@@ -132,6 +132,7 @@ void remove_narrow_tongues(const Geometry &geometry,
       ice_thickness(i, j) = 0.0;
     }
   }
+  ice_thickness.inc_state_counter();
 }
 
 } // end of namespace pism
@@ -41,6 +41,9 @@ Geometry::Geometry(IceGrid::ConstPtr grid)
     cell_grounded_fraction(grid, "cell_grounded_fraction", WITHOUT_GHOSTS),
     ice_surface_elevation(grid, "usurf", WITH_GHOSTS, m_stencil_width) {
 
+  m_ice_free_thickness_threshold = 0.0;
+  m_changed_cells = nullptr;
+
   latitude.set_attrs("mapping", "latitude", "degree_north", "degree_north", "latitude", 0);
   latitude.set_time_independent(true);
   latitude.metadata().set_string("grid_mapping", "");
@@ -118,43 +121,113 @@ void check_minimum_ice_thickness(const IceModelVec2S &ice_thickness) {
   loop.check();
 }
 
+DependencyTracker::Inputs Geometry::fields() const {
+  return {&sea_level_elevation, &bed_elevation,
+      &ice_thickness, &ice_area_specific_volume,
+      &cell_type, &cell_grounded_fraction, &ice_surface_elevation};
+}
+
+bool Geometry::consistent() const {
+  return not m_consistency.changed(fields());
+}
+
+void Geometry::set_changed_cells(const IceModelVec2Int &cells) {
+  m_changed_cells = &cells;
+
+  auto inputs = fields();
+  inputs.push_back(m_changed_cells);
+  m_changes.record(inputs);
+}
+
+void Geometry::remove_isolated_partially_filled_cells() {
+  const bool was_consistent = consistent();
+
+  IceModelVec::AccessList list{&ice_area_specific_volume, &cell_type};
+
+  for (Points p(*ice_thickness.grid()); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (ice_area_specific_volume(i, j) > 0.0 and not cell_type.next_to_ice(i, j)) {
+      ice_area_specific_volume(i, j) = 0.0;
+    }
+  }
+  ice_area_specific_volume.inc_state_counter();
+
+  // cell type, surface elevation and grounded cell fraction do not depend on area
+  // specific volume
+  if (was_consistent) {
+    m_consistency.record(fields());
+  }
+}
+
 void Geometry::ensure_consistency(double ice_free_thickness_threshold) {
   IceGrid::ConstPtr grid = ice_thickness.grid();
   Config::ConstPtr config = grid->ctx()->config();
 
-  check_minimum_ice_thickness(ice_thickness);
+  // Note: state counters are updated by collective operations, so all ranks make the
+  // same decision here.
+  const DependencyTracker::Inputs fields = this->fields();
+
+  if (ice_free_thickness_threshold == m_ice_free_thickness_threshold and
+      not m_consistency.changed(fields)) {
+    m_changed_cells = nullptr;
+    return;
+  }
+
+  // Use the set of changed cells if it covers all the changes since the last call, i.e. if
+  // nothing changed after set_changed_cells() and the threshold is the same.
+  const IceModelVec2Int *changed = nullptr;
+  if (m_changed_cells != nullptr and
+      ice_free_thickness_threshold == m_ice_free_thickness_threshold) {
+    auto inputs = fields;
+    inputs.push_back(m_changed_cells);
+
+    if (not m_changes.changed(inputs)) {
+      changed = m_changed_cells;
+    }
+  }
+  m_changed_cells = nullptr;
+
+  if (changed == nullptr) {
+    check_minimum_ice_thickness(ice_thickness);
+  }
 
   IceModelVec::AccessList list{&sea_level_elevation, &bed_elevation,
       &ice_thickness, &ice_area_specific_volume,
       &cell_type, &ice_surface_elevation};
 
-  // first ensure that ice_area_specific_volume is 0 if ice_thickness > 0.
+  if (changed != nullptr) {
+    list.add(*changed);
+  }
+
+  GeometryCalculator gc(*config);
+  gc.set_icefree_thickness(ice_free_thickness_threshold);
+
+  // Ensure that ice_area_specific_volume is 0 if ice_thickness > 0, then compute cell type
+  // and surface elevation. All these are point-wise operations, so only changed cells need
+  // to be updated.
   {
     ParallelSection loop(grid->com);
     try {
       for (Points p(*grid); p; p.next()) {
         const int i = p.i(), j = p.j();
 
+        if (changed != nullptr) {
+          if ((*changed)(i, j) == 0.0) {
+            continue;
+          }
+
+          if (ice_thickness(i, j) < 0.0) {
+            throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                          "H = %e (negative) at point i=%d, j=%d",
+                                          ice_thickness(i, j), i, j);
+          }
+        }
+
         if (ice_thickness(i, j) > 0.0 and ice_area_specific_volume(i, j) > 0.0) {
           ice_thickness(i, j) += ice_area_specific_volume(i, j);
           ice_area_specific_volume(i, j) = 0.0;
         }
-      }
-    } catch (...) {
-      loop.failed();
-    }
-    loop.check();
-  }
-
-  // compute cell type and surface elevation
-  {
-    GeometryCalculator gc(*config);
-    gc.set_icefree_thickness(ice_free_thickness_threshold);
-
-    ParallelSection loop(grid->com);
-    try {
-      for (Points p(*grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
 
         int mask = 0;
         gc.compute(sea_level_elevation(i, j), bed_elevation(i, j), ice_thickness(i, j),
@@ -168,20 +241,75 @@ void Geometry::ensure_consistency(double ice_free_thickness_threshold) {
   }
 
   ice_thickness.update_ghosts();
+  ice_thickness.inc_state_counter();
   ice_area_specific_volume.update_ghosts();
+  ice_area_specific_volume.inc_state_counter();
   cell_type.update_ghosts();
+  cell_type.inc_state_counter();
   ice_surface_elevation.update_ghosts();
+  ice_surface_elevation.inc_state_counter();
 
   const double
     ice_density = config->get_number("constants.ice.density"),
     ocean_density = config->get_number("constants.sea_water.density");
 
-  compute_grounded_cell_fraction(ice_density,
-                                 ocean_density,
-                                 sea_level_elevation,
-                                 ice_thickness,
-                                 bed_elevation,
-                                 cell_grounded_fraction);
+  if (changed != nullptr) {
+    compute_grounded_cell_fraction(ice_density,
+                                   ocean_density,
+                                   sea_level_elevation,
+                                   ice_thickness,
+                                   bed_elevation,
+                                   *changed,
+                                   cell_grounded_fraction);
+  } else {
+    compute_grounded_cell_fraction(ice_density,
+                                   ocean_density,
+                                   sea_level_elevation,
+                                   ice_thickness,
+                                   bed_elevation,
+                                   cell_grounded_fraction);
+  }
+  cell_grounded_fraction.inc_state_counter();
+
+#if (Pism_DEBUG==1)
+  // Check that the incremental update produced the same result as re-computing
+  // everything.
+  if (changed != nullptr) {
+    IceModelVec2Int mask(grid, "mask", WITHOUT_GHOSTS);
+    IceModelVec2S
+      surface(grid, "usurf", WITHOUT_GHOSTS),
+      fraction(grid, "cell_grounded_fraction", WITHOUT_GHOSTS);
+
+    gc.compute(sea_level_elevation, bed_elevation, ice_thickness, mask, surface);
+    compute_grounded_cell_fraction(ice_density, ocean_density,
+                                   sea_level_elevation, ice_thickness, bed_elevation,
+                                   fraction);
+
+    list.add({&mask, &surface, &fraction, &cell_grounded_fraction});
+
+    ParallelSection loop(grid->com);
+    try {
+      for (Points p(*grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        if (mask(i, j) != cell_type(i, j) or
+            surface(i, j) != ice_surface_elevation(i, j) or
+            fraction(i, j) != cell_grounded_fraction(i, j) or
+            (ice_thickness(i, j) > 0.0 and ice_area_specific_volume(i, j) > 0.0)) {
+          throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                        "incremental geometry update failed at i=%d, j=%d",
+                                        i, j);
+        }
+      }
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
+  }
+#endif
+
+  m_ice_free_thickness_threshold = ice_free_thickness_threshold;
+  m_consistency.record(fields);
 }
 
 /*! Compute the elevation of the bottom surface of the ice.
@@ -221,8 +349,8 @@ void ice_bottom_surface(const Geometry &geometry, IceModelVec2S &result) {
   result.update_ghosts();
 }
 
-//! Computes the ice volume, in m^3.
-double ice_volume(const Geometry &geometry, double thickness_threshold) {
+//! Computes the ice volume in the sub-domain owned by this rank, in m^3.
+double ice_volume_local(const Geometry &geometry, double thickness_threshold) {
   auto grid = geometry.ice_thickness.grid();
   auto config = grid->ctx()->config();
 
@@ -252,11 +380,13 @@ double ice_volume(const Geometry &geometry, double thickness_threshold) {
     }
   }
 
-  return GlobalSum(grid->com, volume);
+  return volume;
 }
 
-double ice_volume_not_displacing_seawater(const Geometry &geometry,
-                                          double thickness_threshold) {
+//! Computes the volume of ice not displacing sea water in the sub-domain owned by this rank,
+//! in m^3.
+double ice_volume_not_displacing_seawater_local(const Geometry &geometry,
+                                                double thickness_threshold) {
   auto grid = geometry.ice_thickness.grid();
   auto config = grid->ctx()->config();
 
@@ -289,11 +419,11 @@ double ice_volume_not_displacing_seawater(const Geometry &geometry,
     }
   } // end of the loop over grid points
 
-  return GlobalSum(grid->com, volume);
+  return volume;
 }
 
-//! Computes ice area, in m^2.
-double ice_area(const Geometry &geometry, double thickness_threshold) {
+//! Computes ice area in the sub-domain owned by this rank, in m^2.
+double ice_area_local(const Geometry &geometry, double thickness_threshold) {
   auto grid = geometry.ice_thickness.grid();
 
   double area = 0.0;
@@ -309,11 +439,11 @@ double ice_area(const Geometry &geometry, double thickness_threshold) {
     }
   }
 
-  return GlobalSum(grid->com, area);
+  return area;
 }
 
-//! Computes grounded ice area, in m^2.
-double ice_area_grounded(const Geometry &geometry, double thickness_threshold) {
+//! Computes grounded ice area in the sub-domain owned by this rank, in m^2.
+double ice_area_grounded_local(const Geometry &geometry, double thickness_threshold) {
   auto grid = geometry.ice_thickness.grid();
 
   double area = 0.0;
@@ -330,11 +460,11 @@ double ice_area_grounded(const Geometry &geometry, double thickness_threshold) {
     }
   }
 
-  return GlobalSum(grid->com, area);
+  return area;
 }
 
-//! Computes floating ice area, in m^2.
-double ice_area_floating(const Geometry &geometry, double thickness_threshold) {
+//! Computes floating ice area in the sub-domain owned by this rank, in m^2.
+double ice_area_floating_local(const Geometry &geometry, double thickness_threshold) {
   auto grid = geometry.ice_thickness.grid();
 
   double area = 0.0;
@@ -351,12 +481,13 @@ double ice_area_floating(const Geometry &geometry, double thickness_threshold) {
     }
   }
 
-  return GlobalSum(grid->com, area);
+  return area;
 }
 
 
-//! Computes the sea level rise that would result if all the ice were melted.
-double sea_level_rise_potential(const Geometry &geometry, double thickness_threshold) {
+//! Computes the contribution of the sub-domain owned by this rank to the sea level rise
+//! that would result if all the ice were melted.
+double sea_level_rise_potential_local(const Geometry &geometry, double thickness_threshold) {
   auto config = geometry.ice_thickness.grid()->ctx()->config();
 
   const double
@@ -365,14 +496,50 @@ double sea_level_rise_potential(const Geometry &geometry, double thickness_thres
     ocean_area    = config->get_number("constants.global_ocean_area");
 
   const double
-    volume                  = ice_volume_not_displacing_seawater(geometry,
-                                                                 thickness_threshold),
+    volume                  = ice_volume_not_displacing_seawater_local(geometry,
+                                                                       thickness_threshold),
     additional_water_volume = (ice_density / water_density) * volume,
     sea_level_change        = additional_water_volume / ocean_area;
 
   return sea_level_change;
 }
 
+//! Computes the ice volume, in m^3.
+double ice_volume(const Geometry &geometry, double thickness_threshold) {
+  return GlobalSum(geometry.ice_thickness.grid()->com,
+                   ice_volume_local(geometry, thickness_threshold));
+}
+
+//! Computes the volume of ice not displacing sea water, in m^3.
+double ice_volume_not_displacing_seawater(const Geometry &geometry,
+                                          double thickness_threshold) {
+  return GlobalSum(geometry.ice_thickness.grid()->com,
+                   ice_volume_not_displacing_seawater_local(geometry, thickness_threshold));
+}
+
+//! Computes ice area, in m^2.
+double ice_area(const Geometry &geometry, double thickness_threshold) {
+  return GlobalSum(geometry.ice_thickness.grid()->com,
+                   ice_area_local(geometry, thickness_threshold));
+}
+
+//! Computes grounded ice area, in m^2.
+double ice_area_grounded(const Geometry &geometry, double thickness_threshold) {
+  return GlobalSum(geometry.ice_thickness.grid()->com,
+                   ice_area_grounded_local(geometry, thickness_threshold));
+}
+
+//! Computes floating ice area, in m^2.
+double ice_area_floating(const Geometry &geometry, double thickness_threshold) {
+  return GlobalSum(geometry.ice_thickness.grid()->com,
+                   ice_area_floating_local(geometry, thickness_threshold));
+}
+
+//! Computes the sea level rise that would result if all the ice were melted.
+double sea_level_rise_potential(const Geometry &geometry, double thickness_threshold) {
+  return GlobalSum(geometry.ice_thickness.grid()->com,
+                   sea_level_rise_potential_local(geometry, thickness_threshold));
+}
 
 /*!
  * @brief Set no_model_mask variable to have value 1 in strip of width 'strip' m around
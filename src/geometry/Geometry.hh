@@ -23,21 +23,62 @@
 #include "pism/util/IceGrid.hh"
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/DependencyTracker.hh"
 
 namespace pism {
 
 class Geometry {
 private:
   const unsigned int m_stencil_width;
+
+  // inputs and outputs of the last ensure_consistency() call
+  DependencyTracker m_consistency;
+  double m_ice_free_thickness_threshold;
+
+  // cells that changed since the last ensure_consistency() call (see set_changed_cells())
+  const IceModelVec2Int *m_changed_cells;
+  // all fields (and m_changed_cells) at the time of the set_changed_cells() call
+  DependencyTracker m_changes;
+
+  DependencyTracker::Inputs fields() const;
 public:
   Geometry(IceGrid::ConstPtr grid);
 
   /*!
    * Ensures consistency of ice geometry by re-computing cell type, cell grounded fraction, and ice
    * surface elevation.
+   *
+   * Does nothing if none of the fields below changed since the last call using the same
+   * threshold (see DependencyTracker). Code modifying these fields using `operator()` has
+   * to call `inc_state_counter()`.
+   *
+   * Updates only cells near the ones marked using set_changed_cells() if possible.
    */
   void ensure_consistency(double ice_free_thickness_threshold);
 
+  /*!
+   * Returns true if no field changed since the last ensure_consistency() call.
+   */
+  bool consistent() const;
+
+  /*!
+   * Mark cells where ice thickness and area specific volume changed (`cells` has to be
+   * ghosted and contain 1 at changed cells and 0 elsewhere).
+   *
+   * The next ensure_consistency() call will use this to update only cells near the
+   * changed ones if the geometry was consistent before the change (see consistent()) and
+   * nothing changed since this call. The caller has to make sure that `cells` is not
+   * modified or de-allocated until then.
+   */
+  void set_changed_cells(const IceModelVec2Int &cells);
+
+  /*!
+   * Set area specific volume to zero in partially-filled cells that are not next to ice.
+   *
+   * This does not affect consistency of ice geometry (see consistent()).
+   */
+  void remove_isolated_partially_filled_cells();
+
   // This is grid information, which is not (strictly speaking) ice geometry, but it should be
   // available everywhere we use ice geometry.
   IceModelVec2S latitude;
@@ -69,6 +110,16 @@ double ice_volume_not_displacing_seawater(const Geometry &geometry,
                                           double thickness_threshold);
 double sea_level_rise_potential(const Geometry &geometry, double thickness_threshold);
 
+// Contributions of the sub-domain owned by this rank to the quantities above (these do
+// not communicate; see update_ts_diagnostics()).
+double ice_volume_local(const Geometry &geometry, double thickness_threshold);
+double ice_area_floating_local(const Geometry &geometry, double thickness_threshold);
+double ice_area_grounded_local(const Geometry &geometry, double thickness_threshold);
+double ice_area_local(const Geometry &geometry, double thickness_threshold);
+double ice_volume_not_displacing_seawater_local(const Geometry &geometry,
+                                                double thickness_threshold);
+double sea_level_rise_potential_local(const Geometry &geometry, double thickness_threshold);
+
 void set_no_model_strip(const IceGrid &grid, double width, IceModelVec2Int &result);
 
 } // end of namespace pism
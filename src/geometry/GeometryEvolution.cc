@@ -17,9 +17,15 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <cassert>
+#include <vector>
+#include <utility>              // std::pair
+#include <algorithm>            // std::sort, std::unique
+
 #include "GeometryEvolution.hh"
 
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/IceModelVecPool.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Mask.hh"
 
@@ -27,6 +33,8 @@
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/petscwrappers/KSP.hh"
+#include "pism/util/petscwrappers/Mat.hh"
 
 namespace pism {
 
@@ -36,6 +44,7 @@ using mask::ice_free;
 using mask::ice_free_land;
 using mask::ice_free_ocean;
 using mask::icy;
+using mask::ocean;
 
 struct GeometryEvolution::Impl {
   Impl(IceGrid::ConstPtr g);
@@ -52,6 +61,12 @@ struct GeometryEvolution::Impl {
   //! True if the part-grid scheme is enabled.
   bool use_part_grid;
 
+  //! True if the diffusive (SIA) flux is computed using an implicit step.
+  bool implicit_sia;
+
+  //! Ratio of the ice density to the sea water density.
+  double density_ratio;
+
   //! Flux divergence (used to track thickness changes due to flow).
   IceModelVec2S flux_divergence;
 
@@ -73,17 +88,56 @@ struct GeometryEvolution::Impl {
   //! Flux through cell interfaces. Ghosted.
   IceModelVec2Stag flux_staggered;
 
-  // Work space
-  IceModelVec2V        input_velocity;       // ghosted copy; not modified
-  IceModelVec2S        bed_elevation;        // ghosted copy; not modified
-  IceModelVec2S        sea_level;            // ghosted copy; not modified
-  IceModelVec2S        ice_thickness;        // ghosted; updated in place
-  IceModelVec2S        area_specific_volume; // ghosted; updated in place
-  IceModelVec2S        surface_elevation;    // ghosted; updated to maintain consistency
-  IceModelVec2CellType cell_type;            // ghosted; updated to maintain consistency
-  IceModelVec2S        residual;             // ghosted; temporary storage
-  IceModelVec2S        thickness;            // ghosted; temporary storage
-  IceModelVec2Int      velocity_bc_mask;
+  //! Cells where thickness_change or ice_area_specific_volume_change is not zero (1 if
+  //! changed, 0 otherwise). Ghosted.
+  IceModelVec2Int changed_cells;
+
+  //! Fields shared with other components (work space is borrowed from it for the
+  //! duration of a flow step).
+  IceModelVecPool::Ptr pool;
+
+  // Work space (borrowed from `pool` in flow_step())
+  IceModelVec2V::Ptr        input_velocity;       // ghosted copy; not modified
+  IceModelVec2S::Ptr        bed_elevation;        // ghosted copy; not modified
+  IceModelVec2S::Ptr        sea_level;            // ghosted copy; not modified
+  IceModelVec2S::Ptr        ice_thickness;        // ghosted; updated in place
+  IceModelVec2S::Ptr        area_specific_volume; // ghosted; updated in place
+  IceModelVec2S::Ptr        surface_elevation;    // ghosted; updated to maintain consistency
+  IceModelVec2CellType::Ptr cell_type;            // ghosted; updated to maintain consistency
+  IceModelVec2S::Ptr        residual;             // ghosted; temporary storage
+  IceModelVec2S::Ptr        thickness;            // ghosted; temporary storage
+  IceModelVec2Int::Ptr      velocity_bc_mask;
+  IceModelVec2Stag::Ptr     diffusivity;          // ghosted copy; not modified (implicit SIA)
+  IceModelVec2Stag::Ptr     diffusive_flux;       // diffusive flux computed by the implicit step
+
+  // Implicit diffusion (used if implicit_sia is set)
+  petsc::KSP           implicit_KSP;
+  petsc::Mat           implicit_A;
+  IceModelVec2S        implicit_rhs;         // right hand side
+  IceModelVec2S        implicit_solution;    // ice thickness at the end of the step
+
+  //! Return work space to the pool.
+  void release_work_space() {
+    input_velocity.reset();
+    bed_elevation.reset();
+    sea_level.reset();
+    ice_thickness.reset();
+    area_specific_volume.reset();
+    surface_elevation.reset();
+    cell_type.reset();
+    residual.reset();
+    thickness.reset();
+    velocity_bc_mask.reset();
+    diffusivity.reset();
+    diffusive_flux.reset();
+  }
+
+  //! Owned grid points with a positive residual (work list used by the residual
+  //! redistribution code).
+  std::vector<std::pair<int, int> > residual_points;
+  //! Owned grid points where ice thickness changed since the last update of the cell type
+  //! mask (work list used by the residual redistribution code).
+  std::vector<std::pair<int, int> > changed_points;
 };
 
 GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
@@ -96,16 +150,10 @@ GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
     thickness_change(grid, "thickness_change", WITHOUT_GHOSTS),
     ice_area_specific_volume_change(grid, "ice_area_specific_volume_change", WITHOUT_GHOSTS),
     flux_staggered(grid, "flux_staggered", WITH_GHOSTS),
-    input_velocity(grid, "input_velocity", WITH_GHOSTS),
-    bed_elevation(grid, "bed_elevation", WITH_GHOSTS),
-    sea_level(grid, "sea_level", WITH_GHOSTS),
-    ice_thickness(grid, "ice_thickness", WITH_GHOSTS),
-    area_specific_volume(grid, "area_specific_volume", WITH_GHOSTS),
-    surface_elevation(grid, "surface_elevation", WITH_GHOSTS),
-    cell_type(grid, "cell_type", WITH_GHOSTS),
-    residual(grid, "residual", WITH_GHOSTS),
-    thickness(grid, "thickness", WITH_GHOSTS),
-    velocity_bc_mask(grid, "velocity_bc_mask", WITH_GHOSTS) {
+    changed_cells(grid, "changed_cells", WITH_GHOSTS),
+    pool(IceModelVecPool::shared(grid)),
+    implicit_rhs(grid, "implicit_rhs", WITHOUT_GHOSTS),
+    implicit_solution(grid, "implicit_solution", WITHOUT_GHOSTS) {
 
   Config::ConstPtr config = grid->ctx()->config();
 
@@ -116,6 +164,39 @@ GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
     ice_density   = config->get_number("constants.ice.density");
     use_bmr       = config->get_flag("geometry.update.use_basal_melt_rate");
     use_part_grid = config->get_flag("geometry.part_grid.enabled");
+    implicit_sia  = config->get_flag("geometry.update.implicit_sia");
+    density_ratio = ice_density / config->get_number("constants.sea_water.density");
+  }
+
+  if (implicit_sia) {
+    PetscErrorCode ierr;
+
+    ierr = DMSetMatType(*implicit_solution.dm(), MATAIJ);
+    PISM_CHK(ierr, "DMSetMatType");
+
+    ierr = DMCreateMatrix(*implicit_solution.dm(), implicit_A.rawptr());
+    PISM_CHK(ierr, "DMCreateMatrix");
+
+    ierr = KSPCreate(grid->com, implicit_KSP.rawptr());
+    PISM_CHK(ierr, "KSPCreate");
+
+    ierr = KSPSetOptionsPrefix(implicit_KSP, "geometry_implicit_");
+    PISM_CHK(ierr, "KSPSetOptionsPrefix");
+
+    // Give the KSP access to the DMDA (used to build multigrid hierarchies), but use the
+    // matrix assembled in compute_implicit_diffusive_flux().
+    ierr = KSPSetDM(implicit_KSP, *implicit_solution.dm());
+    PISM_CHK(ierr, "KSPSetDM");
+
+    ierr = KSPSetDMActive(implicit_KSP, PETSC_FALSE);
+    PISM_CHK(ierr, "KSPSetDMActive");
+
+    // the ice thickness at the beginning of the step is a good initial guess
+    ierr = KSPSetInitialGuessNonzero(implicit_KSP, PETSC_TRUE);
+    PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
+
+    ierr = KSPSetFromOptions(implicit_KSP);
+    PISM_CHK(ierr, "KSPSetFromOptions");
   }
 
   // reported quantities
@@ -148,36 +229,9 @@ GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
 
   // internal storage
   {
-    input_velocity.set_attrs("internal", "ghosted copy of the input velocity",
-                             "meters / second", "meters / second", "", 0);
-
-    bed_elevation.set_attrs("internal", "ghosted copy of the bed elevation",
-                            "meters", "meters", "", 0);
-
-    sea_level.set_attrs("internal", "ghosted copy of the sea level elevation",
-                        "meters", "meters", "", 0);
-
-    ice_thickness.set_attrs("internal", "working (ghosted) copy of the ice thickness",
-                            "meters", "meters", "", 0);
-
-    area_specific_volume.set_attrs("internal", "working (ghosted) copy of the area specific volume",
-                                   "meters3 / meters2", "meters3 / meters2", "", 0);
-
-    surface_elevation.set_attrs("internal", "working (ghosted) copy of the surface elevation",
-                                "meters", "meters", "", 0);
-
-    cell_type.set_attrs("internal", "working (ghosted) copy of the cell type mask",
-                        "", "", "", 0);
-
-    residual.set_attrs("internal", "residual area specific volume",
-                       "meters3 / meters2", "meters3 / meters2", "", 0);
-
-    thickness.set_attrs("internal", "thickness (temporary storage)",
-                        "meters", "meters", "", 0);
-
-    velocity_bc_mask.set_attrs("internal", "ghosted copy of the velocity B.C. mask"
-                               " (1 at velocity B.C. location, 0 elsewhere)",
-                               "", "", "", 0);
+    changed_cells.set_attrs("internal", "cells where ice geometry changed due to flow"
+                            " (1 if changed, 0 otherwise)",
+                            "", "", "", 0);
   }
 }
 
@@ -235,6 +289,11 @@ const IceModelVec2S& GeometryEvolution::conservation_error() const {
  * @param[in] velocity_bc_mask advective velocity Dirichlet B.C. mask
  * @param[in] velocity_bc_values advective velocity Dirichlet B.C. values
  * @param[in] thickness_bc_mask ice thickness Dirichlet B.C. mask
+ * @param[in] diffusivity SIA diffusivity on the staggered grid (used only if
+ *                        `geometry.update.implicit_sia` is set)
+ *
+ * If `geometry.update.implicit_sia` is set the diffusive flux is re-computed using an
+ * implicit step (see compute_implicit_diffusive_flux()) and `diffusive_flux` is not used.
  *
  * Results are stored in internal fields accessible using getters.
  */
@@ -242,79 +301,144 @@ void GeometryEvolution::flow_step(const Geometry &geometry, double dt,
                                   const IceModelVec2V    &advective_velocity,
                                   const IceModelVec2Stag &diffusive_flux,
                                   const IceModelVec2Int  &velocity_bc_mask,
-                                  const IceModelVec2Int  &thickness_bc_mask) {
+                                  const IceModelVec2Int  &thickness_bc_mask,
+                                  const IceModelVec2Stag *diffusivity) {
+
+  // borrow work space (returned at the end of the step)
+  {
+    IceModelVecPool &pool = *m_impl->pool;
+
+    m_impl->input_velocity       = pool.vector("input_velocity", WITH_GHOSTS);
+    m_impl->bed_elevation        = pool.scalar("bed_elevation", WITH_GHOSTS);
+    m_impl->sea_level            = pool.scalar("sea_level", WITH_GHOSTS);
+    m_impl->ice_thickness        = pool.scalar("ice_thickness", WITH_GHOSTS);
+    m_impl->area_specific_volume = pool.scalar("area_specific_volume", WITH_GHOSTS);
+    m_impl->surface_elevation    = pool.scalar("surface_elevation", WITH_GHOSTS);
+    m_impl->cell_type            = pool.cell_type("cell_type", WITH_GHOSTS);
+    m_impl->residual             = pool.scalar("residual", WITH_GHOSTS);
+    m_impl->thickness            = pool.scalar("thickness", WITH_GHOSTS);
+    m_impl->velocity_bc_mask     = pool.integer("velocity_bc_mask", WITH_GHOSTS);
+
+    if (m_impl->implicit_sia) {
+      m_impl->diffusivity    = pool.staggered("diffusivity", WITH_GHOSTS);
+      m_impl->diffusive_flux = pool.staggered("diffusive_flux", WITHOUT_GHOSTS);
+    }
+  }
 
   m_impl->profile.begin("ge.update_ghosted_copies");
   {
     // make ghosted copies of input fields
-    m_impl->ice_thickness.copy_from(geometry.ice_thickness);
-    m_impl->area_specific_volume.copy_from(geometry.ice_area_specific_volume);
-    m_impl->sea_level.copy_from(geometry.sea_level_elevation);
-    m_impl->bed_elevation.copy_from(geometry.bed_elevation);
-    m_impl->input_velocity.copy_from(advective_velocity);
-    m_impl->velocity_bc_mask.copy_from(velocity_bc_mask);
+    m_impl->ice_thickness->copy_from(geometry.ice_thickness);
+    if (m_impl->use_part_grid) {
+      // the area specific volume is modified by flow only if part_grid is enabled
+      m_impl->area_specific_volume->copy_from(geometry.ice_area_specific_volume);
+    }
+    m_impl->sea_level->copy_from(geometry.sea_level_elevation);
+    m_impl->bed_elevation->copy_from(geometry.bed_elevation);
+    m_impl->input_velocity->copy_from(advective_velocity);
+    m_impl->velocity_bc_mask->copy_from(velocity_bc_mask);
 
     // Compute cell_type and surface_elevation. Ghosts of results are updated.
-    m_impl->gc.compute(m_impl->sea_level,          // in (uses ghosts)
-                       m_impl->bed_elevation,      // in (uses ghosts)
-                       m_impl->ice_thickness,      // in (uses ghosts)
-                       m_impl->cell_type,          // out (ghosts are updated)
-                       m_impl->surface_elevation); // out (ghosts are updated)
+    m_impl->gc.compute(*m_impl->sea_level,          // in (uses ghosts)
+                       *m_impl->bed_elevation,      // in (uses ghosts)
+                       *m_impl->ice_thickness,      // in (uses ghosts)
+                       *m_impl->cell_type,          // out (ghosts are updated)
+                       *m_impl->surface_elevation); // out (ghosts are updated)
   }
   m_impl->profile.end("ge.update_ghosted_copies");
 
+  const IceModelVec2Stag *Q_diffusive = &diffusive_flux;
+
+  if (m_impl->implicit_sia) {
+    if (diffusivity == nullptr) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "geometry.update.implicit_sia requires the SIA diffusivity");
+    }
+
+    m_impl->profile.begin("ge.implicit_sia");
+    {
+      // make a ghosted copy of the diffusivity (the input may not have up to date ghosts)
+      {
+        IceModelVec::AccessList list{diffusivity, m_impl->diffusivity.get()};
+
+        for (Points p(*m_grid); p; p.next()) {
+          const int i = p.i(), j = p.j();
+
+          (*m_impl->diffusivity)(i, j, 0) = (*diffusivity)(i, j, 0);
+          (*m_impl->diffusivity)(i, j, 1) = (*diffusivity)(i, j, 1);
+        }
+        m_impl->diffusivity->update_ghosts();
+      }
+
+      // Compute the divergence of the advective flux (treated explicitly).
+      m_impl->diffusive_flux->set(0.0);
+
+      compute_interface_fluxes(*m_impl->cell_type,        // in (uses ghosts)
+                               *m_impl->ice_thickness,    // in (uses ghosts)
+                               *m_impl->input_velocity,   // in (uses ghosts)
+                               *m_impl->velocity_bc_mask, // in (uses ghosts)
+                               *m_impl->diffusive_flux,   // in
+                               m_impl->flux_staggered);   // out
+
+      compute_flux_divergence(m_impl->flux_staggered,   // in (ghosts are updated)
+                              thickness_bc_mask,        // in
+                              m_impl->flux_divergence); // out
+
+      compute_implicit_diffusive_flux(dt,                       // in
+                                      *m_impl->cell_type,       // in (uses ghosts)
+                                      *m_impl->bed_elevation,   // in (uses ghosts)
+                                      *m_impl->sea_level,       // in (uses ghosts)
+                                      *m_impl->ice_thickness,   // in
+                                      m_impl->flux_divergence,  // in
+                                      *m_impl->diffusivity,     // in (uses ghosts)
+                                      thickness_bc_mask,        // in
+                                      *m_impl->diffusive_flux); // out
+    }
+    m_impl->profile.end("ge.implicit_sia");
+
+    Q_diffusive = m_impl->diffusive_flux.get();
+  }
+
   // Derived classes can include modifications for regional runs.
   m_impl->profile.begin("ge.interface_fluxes");
-  compute_interface_fluxes(m_impl->cell_type,          // in (uses ghosts)
-                           m_impl->ice_thickness,      // in (uses ghosts)
-                           m_impl->input_velocity,     // in (uses ghosts)
-                           m_impl->velocity_bc_mask,   // in (uses ghosts)
-                           diffusive_flux,             // in
-                           m_impl->flux_staggered);    // out
+  compute_interface_fluxes(*m_impl->cell_type,        // in (uses ghosts)
+                           *m_impl->ice_thickness,    // in (uses ghosts)
+                           *m_impl->input_velocity,   // in (uses ghosts)
+                           *m_impl->velocity_bc_mask, // in (uses ghosts)
+                           *Q_diffusive,              // in
+                           m_impl->flux_staggered);   // out
   m_impl->profile.end("ge.interface_fluxes");
 
-  m_impl->flux_staggered.update_ghosts();
-
   m_impl->profile.begin("ge.flux_divergence");
-  compute_flux_divergence(m_impl->flux_staggered,   // in (uses ghosts)
+  compute_flux_divergence(m_impl->flux_staggered,   // in (ghosts are updated)
                           thickness_bc_mask,        // in
                           m_impl->flux_divergence); // out
   m_impl->profile.end("ge.flux_divergence");
 
-  // This is where part_grid is implemented.
-  m_impl->profile.begin("ge.update_in_place");
-  update_in_place(dt,                            // in
-                  m_impl->bed_elevation,         // in
-                  m_impl->sea_level,             // in
-                  m_impl->flux_divergence,       // in
-                  m_impl->ice_thickness,         // in/out
-                  m_impl->area_specific_volume); // in/out
-  m_impl->profile.end("ge.update_in_place");
-
-  // Compute ice thickness and area specific volume changes.
-  m_impl->profile.begin("ge.compute_changes");
-  {
-    m_impl->ice_thickness.add(-1.0, geometry.ice_thickness,
-                              m_impl->thickness_change);
-    m_impl->area_specific_volume.add(-1.0, geometry.ice_area_specific_volume,
-                                     m_impl->ice_area_specific_volume_change);
+  // This is where part_grid is implemented. Without part_grid the thickness update is
+  // purely local and is done by compute_changes_due_to_flow() below.
+  if (m_impl->use_part_grid) {
+    m_impl->profile.begin("ge.update_in_place");
+    update_in_place(dt,                             // in
+                    *m_impl->bed_elevation,         // in
+                    *m_impl->sea_level,             // in
+                    m_impl->flux_divergence,        // in
+                    *m_impl->ice_thickness,         // in/out
+                    *m_impl->area_specific_volume); // in/out
+    m_impl->profile.end("ge.update_in_place");
   }
-  m_impl->profile.end("ge.compute_changes");
 
-  // Computes the numerical conservation error and corrects ice_thickness_change and
-  // ice_area_specific_volume_change. We can do this here because
+  // Compute ice thickness and area specific volume changes, the numerical conservation
+  // error (correcting changes to preserve non-negativity) and cells affected by flow (see
+  // apply_flux_divergence()) in one pass. We can do this here because
   // compute_surface_and_basal_mass_balance() preserves non-negativity.
   //
   // Note that here we use the "old" ice geometry.
-  //
-  // This computation is purely local.
-  m_impl->profile.begin("ge.ensure_nonnegativity");
-  ensure_nonnegativity(geometry.ice_thickness,                  // in
-                       geometry.ice_area_specific_volume,       // in
-                       m_impl->thickness_change,                // in/out
-                       m_impl->ice_area_specific_volume_change, // in/out
-                       m_impl->conservation_error);             // out
-  m_impl->profile.end("ge.ensure_nonnegativity");
+  m_impl->profile.begin("ge.compute_changes");
+  compute_changes_due_to_flow(dt,                                 // in
+                              geometry.ice_thickness,             // in
+                              geometry.ice_area_specific_volume); // in
+  m_impl->profile.end("ge.compute_changes");
 
   // Now the caller can compute
   //
@@ -322,6 +446,8 @@ void GeometryEvolution::flow_step(const Geometry &geometry, double dt,
   // Href_new = Href_old + ice_area_specific_volume_change.
 
   // calving is a separate issue
+
+  m_impl->release_work_space();
 }
 
 void GeometryEvolution::source_term_step(const Geometry &geometry, double dt,
@@ -346,8 +472,16 @@ void GeometryEvolution::source_term_step(const Geometry &geometry, double dt,
  * Apply changes due to flow to ice geometry and ice area specific volume.
  */
 void GeometryEvolution::apply_flux_divergence(Geometry &geometry) const {
+  // if the geometry is consistent, the next Geometry::ensure_consistency() call needs to
+  // update only cells affected by the flow
+  const bool consistent = geometry.consistent();
+
   geometry.ice_thickness.add(1.0, m_impl->thickness_change);
   geometry.ice_area_specific_volume.add(1.0, m_impl->ice_area_specific_volume_change);
+
+  if (consistent) {
+    geometry.set_changed_cells(m_impl->changed_cells);
+  }
 }
 
 /*!
@@ -386,6 +520,8 @@ void GeometryEvolution::apply_mass_fluxes(Geometry &geometry) const {
     loop.failed();
   }
   loop.check();
+
+  H.inc_state_counter();
 }
 
 
@@ -543,130 +679,396 @@ void GeometryEvolution::compute_interface_fluxes(const IceModelVec2CellType &cel
       &diffusive_flux, &output};
 
   ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int
-        i  = p.i(),
-        j  = p.j(),
-        M  = cell_type(i, j),
-        BC = velocity_bc_mask.as_int(i, j);
-
-      const double H = ice_thickness(i, j);
-      const Vector2 V  = velocity(i, j);
-
-      for (int n = 0; n < 2; ++n) {
+#pragma omp parallel
+  {
+    try {
+      for (ThreadPoints p(*m_grid); p; p.next()) {
         const int
-          oi  = 1 - n,               // offset in the i direction
-          oj  = n,                   // offset in the j direction
-          i_n = i + oi,              // i index of a neighbor
-          j_n = j + oj;              // j index of a neighbor
+          i  = p.i(),
+          j  = p.j(),
+          M  = cell_type(i, j),
+          BC = velocity_bc_mask.as_int(i, j);
+
+        const double H = ice_thickness(i, j);
+        const Vector2 V  = velocity(i, j);
 
-        const int M_n = cell_type(i_n, j_n);
+        for (int n = 0; n < 2; ++n) {
+          const int
+            oi  = 1 - n,               // offset in the i direction
+            oj  = n,                   // offset in the j direction
+            i_n = i + oi,              // i index of a neighbor
+            j_n = j + oj;              // j index of a neighbor
 
-        // advective velocity at the current interface
-        double v = 0.0;
-        {
-          const Vector2 V_n  = velocity(i_n, j_n);
+          const int M_n = cell_type(i_n, j_n);
 
-          // Regular case
+          // advective velocity at the current interface
+          double v = 0.0;
           {
-            if (icy(M) and icy(M_n)) {
-              // Case 1: both sides of the interface are icy
-              v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
+            const Vector2 V_n  = velocity(i_n, j_n);
 
-            } else if (icy(M) and ice_free(M_n)) {
-              // Case 2: icy cell next to an ice-free cell
-              v = (n == 0 ? V.u : V.v);
+            // Regular case
+            {
+              if (icy(M) and icy(M_n)) {
+                // Case 1: both sides of the interface are icy
+                v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
 
-            } else if (ice_free(M) and icy(M_n)) {
-              // Case 3: ice-free cell next to icy cell
-              v = (n == 0 ? V_n.u : V_n.v);
+              } else if (icy(M) and ice_free(M_n)) {
+                // Case 2: icy cell next to an ice-free cell
+                v = (n == 0 ? V.u : V.v);
 
-            } else if (ice_free(M) and ice_free(M_n)) {
-              // Case 4: both sides of the interface are ice-free
-              v = 0.0;
+              } else if (ice_free(M) and icy(M_n)) {
+                // Case 3: ice-free cell next to icy cell
+                v = (n == 0 ? V_n.u : V_n.v);
 
+              } else if (ice_free(M) and ice_free(M_n)) {
+                // Case 4: both sides of the interface are ice-free
+                v = 0.0;
+
+              }
             }
+
+            // The Dirichlet B.C. case:
+            {
+              const int BC_n = velocity_bc_mask.as_int(i_n, j_n);
+
+              if (BC == 1 and BC_n == 1) {
+                // Case 1: both sides of the interface are B.C. locations: average from
+                // the regular grid onto the staggered grid.
+                v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
+
+              } else if (BC == 1 and BC_n == 0) {
+                // Case 2: at a Dirichlet B.C. location next to a regular location
+                v = (n == 0 ? V.u : V.v);
+
+              } else if (BC == 0 and BC_n == 1) {
+
+                // Case 3: at a regular location next to a Dirichlet B.C. location
+                v = (n == 0 ? V_n.u : V_n.v);
+
+              } else {
+                // Case 4: elsewhere.
+                // No Dirichlet B.C. adjustment here.
+              }
+
+            } // end of the Dirichlet B.C. case
+
+            // finally, limit advective velocities
+            v = limit_advective_velocity(M, M_n, v);
           }
 
-          // The Dirichlet B.C. case:
-          {
-            const int BC_n = velocity_bc_mask.as_int(i_n, j_n);
+          // advective flux
+          const double
+            H_n         = ice_thickness(i_n, j_n),
+            Q_advective = v * (v > 0.0 ? H : H_n); // first order upwinding
+
+          // diffusive flux
+          const double
+            Q_diffusive = limit_diffusive_flux(M, M_n, diffusive_flux(i, j, n));
+
+          output(i, j, n) = Q_diffusive + Q_advective;
+        } // end of the loop over neighbors (n)
+      }
+    } catch (...) {
+      loop.failed();
+    }
+  }
+  loop.check();
+}
+
+/*!
+ * Compute coefficients of the surface elevation as a linear function of ice thickness,
+ * `h = slope * H + offset`, for a cell of type `cell_type`.
+ */
+static void surface_elevation_coefficients(int cell_type, double bed, double sea_level,
+                                           double density_ratio,
+                                           double &slope, double &offset) {
+  if (ocean(cell_type)) {
+    slope  = 1.0 - density_ratio;
+    offset = sea_level;
+  } else {
+    slope  = 1.0;
+    offset = bed;
+  }
+}
+
+/*!
+ * Compute the diffusive (SIA) flux using an implicit step.
+ *
+ * Solves
+ *
+ * @f[ H_{\text{new}} - \Delta t\, \nabla \cdot (D \nabla h_{\text{new}}) = H - \Delta t\, \nabla \cdot Q_{\text{advective}} @f]
+ *
+ * for @f$ H_{\text{new}} @f$, with the diffusivity @f$ D @f$ computed by the stress
+ * balance model at the beginning of the step (i.e. one Picard iteration). The surface
+ * elevation @f$ h_{\text{new}} @f$ is a linear function of @f$ H_{\text{new}} @f$ that
+ * depends on the cell type at the beginning of the step (see
+ * surface_elevation_coefficients()).
+ *
+ * The diffusive flux is then computed using the new surface elevation, so that the
+ * explicit update using this flux reproduces @f$ H_{\text{new}} @f$ and is stable
+ * regardless of the time step length.
+ *
+ * Interface diffusivities are limited using the same rules as diffusive fluxes (see
+ * limit_diffusive_flux()). There is no flux through domain boundaries.
+ *
+ * Use PETSc options with the prefix `geometry_implicit_` to choose the solver.
+ */
+void GeometryEvolution::compute_implicit_diffusive_flux(double dt,
+                                                        const IceModelVec2CellType &cell_type,
+                                                        const IceModelVec2S        &bed_elevation,
+                                                        const IceModelVec2S        &sea_level,
+                                                        const IceModelVec2S        &ice_thickness,
+                                                        const IceModelVec2S        &advective_flux_divergence,
+                                                        const IceModelVec2Stag     &diffusivity,
+                                                        const IceModelVec2Int      &thickness_bc_mask,
+                                                        IceModelVec2Stag           &output) {
+  PetscErrorCode ierr = 0;
 
-            if (BC == 1 and BC_n == 1) {
-              // Case 1: both sides of the interface are B.C. locations: average from
-              // the regular grid onto the staggered grid.
-              v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
+  const double
+    dx            = m_grid->dx(),
+    dy            = m_grid->dy(),
+    C_x           = dt / (dx * dx),
+    C_y           = dt / (dy * dy),
+    density_ratio = m_impl->density_ratio;
 
-            } else if (BC == 1 and BC_n == 0) {
-              // Case 2: at a Dirichlet B.C. location next to a regular location
-              v = (n == 0 ? V.u : V.v);
+  const int
+    nrow = 1,
+    ncol = 5,
+    Mx   = m_grid->Mx(),
+    My   = m_grid->My();
 
-            } else if (BC == 0 and BC_n == 1) {
+  Mat A = m_impl->implicit_A;
+  IceModelVec2S
+    &b = m_impl->implicit_rhs,
+    &x = m_impl->implicit_solution;
 
-              // Case 3: at a regular location next to a Dirichlet B.C. location
-              v = (n == 0 ? V_n.u : V_n.v);
+  ierr = MatZeroEntries(A); PISM_CHK(ierr, "MatZeroEntries");
 
-            } else {
-              // Case 4: elsewhere.
-              // No Dirichlet B.C. adjustment here.
-            }
+  {
+    IceModelVec::AccessList list{&cell_type, &bed_elevation, &sea_level, &ice_thickness,
+        &advective_flux_divergence, &diffusivity, &thickness_bc_mask, &b, &x};
+
+    ParallelSection loop(m_grid->com);
+    try {
+      MatStencil row, col[ncol];
+      row.c = 0;
+
+      for (int m = 0; m < ncol; m++) {
+        col[m].c = 0;
+      }
+
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        /* i indices */
+        const int I[] = {i, i - 1,  i,  i + 1, i};
+
+        /* j indices */
+        const int J[] = {j + 1, j,  j,  j, j - 1};
 
-          } // end of the Dirichlet B.C. case
+        row.i = i;
+        row.j = j;
 
-          // finally, limit advective velocities
-          v = limit_advective_velocity(M, M_n, v);
+        for (int m = 0; m < ncol; m++) {
+          col[m].i = I[m];
+          col[m].j = J[m];
         }
 
-        // advective flux
-        const double
-          H_n         = ice_thickness(i_n, j_n),
-          Q_advective = v * (v > 0.0 ? H : H_n); // first order upwinding
+        // the thickness at the beginning of the step is the initial guess
+        x(i, j) = ice_thickness(i, j);
+
+        if (thickness_bc_mask.as_int(i, j) == 1) {
+          // Dirichlet B.C. location: keep the current thickness
+          double D[ncol] = {0.0,
+                            0.0, 1.0, 0.0,
+                            0.0};
+
+          ierr = MatSetValuesStencil(A, nrow, &row, ncol, col, D, INSERT_VALUES);
+          PISM_CHK(ierr, "MatSetValuesStencil");
+
+          b(i, j) = ice_thickness(i, j);
+        } else {
+          auto M = cell_type.int_star(i, j);
+
+          // scaled interface diffusivities
+          double
+            K_n = C_y * limit_diffusive_flux(M.ij, M.n, diffusivity(i, j, 1)),
+            K_w = C_x * limit_diffusive_flux(M.w, M.ij, diffusivity(i - 1, j, 0)),
+            K_e = C_x * limit_diffusive_flux(M.ij, M.e, diffusivity(i, j, 0)),
+            K_s = C_y * limit_diffusive_flux(M.s, M.ij, diffusivity(i, j - 1, 1));
+
+          // no flux through domain boundaries
+          {
+            K_n = j == My - 1 ? 0.0 : K_n;
+            K_e = i == Mx - 1 ? 0.0 : K_e;
+            K_w = i == 0      ? 0.0 : K_w;
+            K_s = j == 0      ? 0.0 : K_s;
+          }
+
+          const double K[ncol] = {K_n,
+                                  K_w, 0.0, K_e,
+                                  K_s};
+
+          // h = slope * H + offset at this point and its neighbors
+          double slope[ncol], offset[ncol];
+          for (int m = 0; m < ncol; m++) {
+            surface_elevation_coefficients(cell_type.as_int(I[m], J[m]),
+                                           bed_elevation(I[m], J[m]),
+                                           sea_level(I[m], J[m]),
+                                           density_ratio,
+                                           slope[m], offset[m]);
+          }
+
+          double
+            L[ncol] = {0.0,
+                       0.0, 1.0, 0.0,
+                       0.0},
+            rhs     = ice_thickness(i, j) - dt * advective_flux_divergence(i, j);
+
+          for (int m = 0; m < ncol; m++) {
+            L[m] -= K[m] * slope[m];
+            L[2] += K[m] * slope[2];
+            rhs  += K[m] * (offset[m] - offset[2]);
+          }
 
-        // diffusive flux
-        const double
-          Q_diffusive = limit_diffusive_flux(M, M_n, diffusive_flux(i, j, n));
+          ierr = MatSetValuesStencil(A, nrow, &row, ncol, col, L, INSERT_VALUES);
+          PISM_CHK(ierr, "MatSetValuesStencil");
 
-        output(i, j, n) = Q_diffusive + Q_advective;
-      } // end of the loop over neighbors (n)
+          b(i, j) = rhs;
+        }
+      }
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
+  }
+
+  ierr = MatAssemblyBegin(A, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyBegin");
+  ierr = MatAssemblyEnd(A, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyEnd");
+
+  ierr = KSPSetOperators(m_impl->implicit_KSP, A, A);
+  PISM_CHK(ierr, "KSPSetOperators");
+
+  ierr = KSPSolve(m_impl->implicit_KSP, b.vec(), x.vec());
+  PISM_CHK(ierr, "KSPSolve");
+
+  KSPConvergedReason reason;
+  ierr = KSPGetConvergedReason(m_impl->implicit_KSP, &reason);
+  PISM_CHK(ierr, "KSPGetConvergedReason");
+
+  if (reason < 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "KSP iteration failed during the implicit SIA step: %s",
+                                  KSPConvergedReasons[reason]);
+  }
+
+  // Compute the diffusive flux using the new surface elevation.
+  IceModelVec2S &H_new = *m_impl->thickness;
+  H_new.copy_from(x);
+
+  IceModelVec::AccessList list{&cell_type, &bed_elevation, &sea_level, &diffusivity,
+      &H_new, &output};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const int M = cell_type.as_int(i, j);
+
+    double slope = 0.0, offset = 0.0;
+    surface_elevation_coefficients(M, bed_elevation(i, j), sea_level(i, j),
+                                   density_ratio, slope, offset);
+    const double h = slope * H_new(i, j) + offset;
+
+    for (int n = 0; n < 2; ++n) {
+      const int
+        oi  = 1 - n,               // offset in the i direction
+        oj  = n,                   // offset in the j direction
+        i_n = i + oi,              // i index of a neighbor
+        j_n = j + oj;              // j index of a neighbor
+
+      if ((n == 0 and i == Mx - 1) or (n == 1 and j == My - 1)) {
+        // no flux through domain boundaries
+        output(i, j, n) = 0.0;
+        continue;
+      }
+
+      const int M_n = cell_type.as_int(i_n, j_n);
+
+      double slope_n = 0.0, offset_n = 0.0;
+      surface_elevation_coefficients(M_n, bed_elevation(i_n, j_n), sea_level(i_n, j_n),
+                                     density_ratio, slope_n, offset_n);
+      const double
+        h_n     = slope_n * H_new(i_n, j_n) + offset_n,
+        spacing = n == 0 ? dx : dy,
+        D       = limit_diffusive_flux(M, M_n, diffusivity(i, j, n));
+
+      output(i, j, n) = - D * (h_n - h) / spacing;
     }
-  } catch (...) {
-    loop.failed();
   }
-  loop.check();
+}
+
+//! Compute flux divergence at points `(i_first, j)`, ..., `(i_last, j)`. See
+//! compute_flux_divergence().
+static void flux_divergence_row(int i_first, int i_last, int j, double dx, double dy,
+                                const FlatView<const double> &flux,
+                                const FlatView<const double> &thickness_bc_mask,
+                                const FlatView<double> &output) {
+  const int
+    n      = i_last - i_first + 1,
+    stride = flux.stride();
+
+  const double *Q    = flux.pointer(i_first, j);
+  const double *mask = thickness_bc_mask.pointer(i_first, j);
+  double *result     = output.pointer(i_first, j);
+
+  for (int m = 0; m < n; ++m) {
+    // interface fluxes of the cell m: east and west (component 0), north and south
+    // (component 1)
+    const double
+      *q         = Q + 2 * m,
+      divergence = (q[0] - q[-2]) / dx + (q[1] - q[1 - stride]) / dy;
+
+    result[m] = mask[m] > 0.5 ? 0.0 : divergence;
+  }
 }
 
 /*!
  * Compute flux divergence using cell interface fluxes on the staggered grid.
  *
  * The flux divergence at *ice thickness* Dirichlet B.C. locations is set to zero.
+ *
+ * Updates ghosts of `flux`. The divergence in the interior of the sub-domain is computed
+ * while ghosts are communicated.
  */
-void GeometryEvolution::compute_flux_divergence(const IceModelVec2Stag &flux,
+void GeometryEvolution::compute_flux_divergence(IceModelVec2Stag &flux,
                                                 const IceModelVec2Int &thickness_bc_mask,
                                                 IceModelVec2S &output) {
   const double
     dx = m_grid->dx(),
     dy = m_grid->dy();
 
-  IceModelVec::AccessList list{&flux, &thickness_bc_mask, &output};
+  flux.begin_update_ghosts();
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  IceModelVec::AccessList list{&flux, &thickness_bc_mask, &output};
 
-      if (thickness_bc_mask(i, j) > 0.5) {
-        output(i, j) = 0.0;
-      } else {
-        StarStencil<double> Q = flux.star(i, j);
+  const auto
+    Q    = static_cast<const IceModelVec2Stag&>(flux).flat_view(),
+    mask = thickness_bc_mask.flat_view();
+  const auto result = output.flat_view();
 
-        output(i, j) = (Q.e - Q.w) / dx + (Q.n - Q.s) / dy;
-      }
+  // points that do not need ghosts of flux
+#pragma omp parallel
+  {
+    for (ThreadInteriorPoints p(*m_grid, 1); p; p.next_row()) {
+      flux_divergence_row(p.i_first(), p.i_last(), p.j(), dx, dy, Q, mask, result);
     }
-  } catch (...) {
-    loop.failed();
   }
-  loop.check();
+
+  flux.end_update_ghosts();
+
+  for (BoundaryPoints p(*m_grid, 1); p; p.next()) {
+    flux_divergence_row(p.i(), p.i(), p.j(), dx, dy, Q, mask, result);
+  }
 }
 
 /*!
@@ -677,6 +1079,9 @@ void GeometryEvolution::compute_flux_divergence(const IceModelVec2Stag &flux,
  * ice thickness and area_specific_volume, use this old code, then compute differences to get changes.
  * Compute ice thickness changes due to the flow of the ice.
  *
+ * Uses the cell type mask and the surface elevation in `m_impl`: they have to correspond
+ * to `ice_thickness` (flow_step() computes them).
+ *
  * @param[in] dt time step, seconds
  * @param[in] bed_elevation bed elevation, meters
  * @param[in] sea_level sea level elevation
@@ -693,22 +1098,19 @@ void GeometryEvolution::update_in_place(double dt,
                                         IceModelVec2S &ice_thickness,
                                         IceModelVec2S &area_specific_volume) {
 
-  m_impl->gc.compute(sea_level, bed_topography, ice_thickness,
-                     m_impl->cell_type, m_impl->surface_elevation);
-
   IceModelVec::AccessList list{&ice_thickness, &flux_divergence};
 
   if (m_impl->use_part_grid) {
-    m_impl->residual.set(0.0);
+    m_impl->residual->set(0.0);
 
     // Store ice thickness. We need this copy to make sure that modifying ice_thickness in the loop
     // below does not affect the computation of the threshold thickness. (Note that
     // part_grid_threshold_thickness uses neighboring values of the mask, ice thickness, and surface
     // elevation.)
-    m_impl->thickness.copy_from(ice_thickness);
+    m_impl->thickness->copy_from(ice_thickness);
 
-    list.add({&area_specific_volume, &m_impl->residual, &m_impl->thickness,
-          &m_impl->surface_elevation, &bed_topography, &m_impl->cell_type});
+    list.add({&area_specific_volume, m_impl->residual.get(), m_impl->thickness.get(),
+          m_impl->surface_elevation.get(), &bed_topography, m_impl->cell_type.get()});
   }
 
 #if (Pism_DEBUG==1)
@@ -723,13 +1125,13 @@ void GeometryEvolution::update_in_place(double dt,
       double divQ = flux_divergence(i, j);
 
       if (m_impl->use_part_grid) {
-        if (m_impl->cell_type.ice_free_ocean(i, j) and m_impl->cell_type.next_to_ice(i, j)) {
+        if (m_impl->cell_type->ice_free_ocean(i, j) and m_impl->cell_type->next_to_ice(i, j)) {
           // Add the flow contribution to this partially filled cell.
           area_specific_volume(i, j) += -divQ * dt;
 
-          double threshold = part_grid_threshold_thickness(m_impl->cell_type.int_star(i, j),
-                                                           m_impl->thickness.star(i, j),
-                                                           m_impl->surface_elevation.star(i, j),
+          double threshold = part_grid_threshold_thickness(m_impl->cell_type->int_star(i, j),
+                                                           m_impl->thickness->star(i, j),
+                                                           m_impl->surface_elevation->star(i, j),
                                                            bed_topography(i, j));
 
           // if threshold is zero, turn all the area specific volume into ice thickness, with zero
@@ -740,7 +1142,7 @@ void GeometryEvolution::update_in_place(double dt,
 
           if (area_specific_volume(i, j) >= threshold) {
             ice_thickness(i, j)        += threshold;
-            m_impl->residual(i, j)      = area_specific_volume(i, j) - threshold;
+            (*m_impl->residual)(i, j)   = area_specific_volume(i, j) - threshold;
             area_specific_volume(i, j)  = 0.0;
           }
 
@@ -767,7 +1169,7 @@ void GeometryEvolution::update_in_place(double dt,
   ice_thickness.update_ghosts();
 
   // Compute the mask corresponding to the new thickness.
-  m_impl->gc.compute_mask(sea_level, bed_topography, ice_thickness, m_impl->cell_type);
+  m_impl->gc.compute_mask(sea_level, bed_topography, ice_thickness, *m_impl->cell_type);
 
   /*
     Redistribute residual ice mass from subgrid-scale parameterization.
@@ -775,38 +1177,51 @@ void GeometryEvolution::update_in_place(double dt,
     See [@ref Albrechtetal2011].
   */
   if (m_impl->use_part_grid) {
-    const int max_n_iterations = m_config->get_number("geometry.part_grid.max_iterations");
+    const int
+      max_n_iterations = m_config->get_number("geometry.part_grid.max_iterations"),
+      check_interval   = std::max(1, (int)m_config->get_number("geometry.part_grid.convergence_check_interval"));
 
     bool done = false;
     for (int i = 0; i < max_n_iterations and not done; ++i) {
       m_log->message(4, "redistribution iteration %d\n", i);
 
+      const bool check_convergence = ((i + 1) % check_interval == 0 or
+                                      i + 1 == max_n_iterations);
+
       // this call may set done to true
       residual_redistribution_iteration(bed_topography,
                                         sea_level,
-                                        m_impl->surface_elevation,
+                                        *m_impl->surface_elevation,
                                         ice_thickness,
-                                        m_impl->cell_type,
+                                        *m_impl->cell_type,
                                         area_specific_volume,
-                                        m_impl->residual,
+                                        *m_impl->residual,
+                                        i == 0,
+                                        check_convergence,
                                         done);
     }
 
     if (not done) {
       m_log->message(2,
                      "WARNING: not done redistributing mass after %d iterations, remaining residual: %f m^3.\n",
-                     max_n_iterations, m_impl->residual.sum() * m_grid->cell_area());
+                     max_n_iterations, m_impl->residual->sum() * m_grid->cell_area());
 
       // Add residual to ice thickness, preserving total ice mass. (This is not great, but
       // better than losing mass.)
-      ice_thickness.add(1.0, m_impl->residual);
-      m_impl->residual.set(0.0);
+      ice_thickness.add(1.0, *m_impl->residual);
+      m_impl->residual->set(0.0);
     }
   }
 }
 
 //! @brief Perform one iteration of the residual mass redistribution.
 /*!
+  The first iteration visits all grid points. Later iterations visit only points near the
+  ones where the residual is positive or ice thickness changed and update the cell type
+  mask and the surface elevation at points where ice thickness changed. This produces
+  the same result as re-computing them everywhere, since the mask and the surface
+  elevation at a grid point depend on ice thickness at the same point only.
+
   @param[in] bed_topography bed elevation
   @param[in] sea_level sea level elevation
   @param[in,out] ice_surface_elevation surface elevation; used as temp. storage
@@ -814,6 +1229,9 @@ void GeometryEvolution::update_in_place(double dt,
   @param[in,out] cell_type cell type mask; used as temp. storage
   @param[in,out] area_specific_volume area specific volume; updated
   @param[in,out] residual ice volume that still needs to be distributed; updated
+  @param[in] first_iteration true if this is the first iteration (initializes work lists)
+  @param[in] check_convergence true if this iteration should check the remaining residual
+                               (requires a global reduction)
   @param[in,out] done result flag: true if this iteration should be the last one
  */
 void GeometryEvolution::residual_redistribution_iteration(const IceModelVec2S  &bed_topography,
@@ -823,23 +1241,80 @@ void GeometryEvolution::residual_redistribution_iteration(const IceModelVec2S  &
                                                           IceModelVec2CellType &cell_type,
                                                           IceModelVec2S        &area_specific_volume,
                                                           IceModelVec2S        &residual,
+                                                          bool first_iteration,
+                                                          bool check_convergence,
                                                           bool &done) {
+  typedef std::pair<int, int> Point;
+
+  const GeometryCalculator &gc = m_impl->gc;
+
+  std::vector<Point>
+    &residual_points = m_impl->residual_points,
+    &changed_points  = m_impl->changed_points;
 
-  m_impl->gc.compute_mask(sea_level, bed_topography, ice_thickness, cell_type);
+  const int
+    xs = m_grid->xs(),
+    xm = m_grid->xm(),
+    ys = m_grid->ys(),
+    ym = m_grid->ym(),
+    width = cell_type.stencil_width();
+
+  assert(ice_thickness.stencil_width() >= (unsigned int)width);
+  assert(m_impl->thickness->stencil_width() >= (unsigned int)width);
+
+  auto owned = [=](int i, int j) {
+    return i >= xs and i < xs + xm and j >= ys and j < ys + ym;
+  };
 
   const Direction directions[4] = {North, East, South, West};
+  const int
+    di[4] = {0, 1, 0, -1},
+    dj[4] = {1, 0, -1, 0};
 
-  // First step: distribute residual mass
-  {
-    // will be destroyed at the end of the block
-    IceModelVec::AccessList list{&cell_type, &ice_thickness, &area_specific_volume, &residual};
+  IceModelVec::AccessList list{&bed_topography, &sea_level, &ice_surface_elevation,
+                               &ice_thickness, &cell_type, &area_specific_volume,
+                               &residual, m_impl->thickness.get()};
+
+  // Update the mask at points where ice thickness changed during the previous
+  // iteration. (The first iteration uses the mask computed by the caller.)
+  //
+  // Note: m_impl->thickness contains ice thickness used during the second step of the
+  // previous iteration, so ghost points where ice thickness changed can be found without
+  // communication.
+  if (not first_iteration) {
+    for (const auto &p : changed_points) {
+      const int i = p.first, j = p.second;
+      cell_type(i, j) = gc.mask(sea_level(i, j), bed_topography(i, j), ice_thickness(i, j));
+    }
 
+    for (GhostPoints p(*m_grid, width); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (ice_thickness(i, j) != (*m_impl->thickness)(i, j)) {
+        cell_type(i, j) = gc.mask(sea_level(i, j), bed_topography(i, j), ice_thickness(i, j));
+      }
+    }
+    cell_type.inc_state_counter();
+  } else {
+    changed_points.clear();
+
+    residual_points.clear();
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      if (residual(i, j) <= 0.0) {
-        continue;
+      if (residual(i, j) > 0.0) {
+        residual_points.push_back({i, j});
       }
+    }
+  }
+
+  // owned points that received redistributed mass
+  std::vector<Point> receivers;
+
+  // First step: distribute residual mass
+  {
+    for (const auto &p : residual_points) {
+      const int i = p.first, j = p.second;
 
       StarStencil<int> m = cell_type.int_star(i, j);
 
@@ -860,14 +1335,44 @@ void GeometryEvolution::residual_redistribution_iteration(const IceModelVec2S  &
         // front
         ice_thickness(i, j) += residual(i, j);
         residual(i, j) = 0.0;
+
+        changed_points.push_back(p);
       }
     }
 
     residual.update_ghosts();
 
+    // find owned neighbors of points with a positive residual, including ghost points
+    // updated by other ranks
+    {
+      auto add_neighbors = [&](int i, int j) {
+        for (int n = 0; n < 4; ++n) {
+          if (owned(i + di[n], j + dj[n])) {
+            receivers.push_back({i + di[n], j + dj[n]});
+          }
+        }
+      };
+
+      for (const auto &p : residual_points) {
+        if (residual(p.first, p.second) > 0.0) {
+          add_neighbors(p.first, p.second);
+        }
+      }
+
+      for (GhostPoints p(*m_grid, 1); p; p.next()) {
+        if (residual(p.i(), p.j()) > 0.0) {
+          add_neighbors(p.i(), p.j());
+        }
+      }
+
+      // each point has to be updated once
+      std::sort(receivers.begin(), receivers.end());
+      receivers.erase(std::unique(receivers.begin(), receivers.end()), receivers.end());
+    }
+
     // update area_specific_volume using adjusted residuals
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+    for (const auto &p : receivers) {
+      const int i = p.first, j = p.second;
 
       if (cell_type.ice_free_ocean(i, j)) {
         area_specific_volume(i, j) += (residual(i + 1, j) +
@@ -875,127 +1380,244 @@ void GeometryEvolution::residual_redistribution_iteration(const IceModelVec2S  &
                                        residual(i, j + 1) +
                                        residual(i, j - 1));
       }
-
     }
 
-    residual.set(0.0);
+    // reset the residual (it is zero everywhere else)
+    for (const auto &p : residual_points) {
+      residual(p.first, p.second) = 0.0;
+    }
+    for (GhostPoints p(*m_grid, 1); p; p.next()) {
+      residual(p.i(), p.j()) = 0.0;
+    }
+    residual.inc_state_counter();
   }
 
   ice_thickness.update_ghosts();
 
-  // Store ice thickness. We need this copy to make sure that modifying ice_thickness in the loop
-  // below does not affect the computation of the threshold thickness. (Note that
-  // part_grid_threshold_thickness uses neighboring values of the mask, ice thickness, and surface
-  // elevation.)
-  m_impl->thickness.copy_from(ice_thickness);
+  // Owned points at which the second step needs to be performed. Area specific volume,
+  // thickness, mask and surface elevation near other points did not change since the
+  // last iteration, so they would not gain ice. (Duplicates are harmless: a point that
+  // gained ice has zero area specific volume and is skipped.)
+  std::vector<Point> candidates;
+
+  if (first_iteration) {
+    // Store ice thickness. We need this copy to make sure that modifying ice_thickness in
+    // the loop below does not affect the computation of the threshold thickness. (Note
+    // that part_grid_threshold_thickness uses neighboring values of the mask, ice
+    // thickness, and surface elevation.)
+    m_impl->thickness->copy_from(ice_thickness);
+
+    // The loop above updated ice_thickness, so we need to re-calculate the mask and the
+    // surface elevation:
+    gc.compute(sea_level, bed_topography, ice_thickness, cell_type, ice_surface_elevation);
+  } else {
+    // Update the copy of ice thickness, the mask and the surface elevation at points
+    // where ice thickness changed (during the second step of the previous iteration or
+    // the first step of this one).
+    auto update = [&](int i, int j) {
+      const double
+        b  = bed_topography(i, j),
+        H  = ice_thickness(i, j),
+        sl = sea_level(i, j);
 
-  // The loop above updated ice_thickness, so we need to re-calculate the mask and the
-  // surface elevation:
-  m_impl->gc.compute(sea_level, bed_topography, ice_thickness, cell_type, ice_surface_elevation);
+      cell_type(i, j)             = gc.mask(sl, b, H);
+      ice_surface_elevation(i, j) = gc.surface(sl, b, H);
+      (*m_impl->thickness)(i, j)  = H;
 
-  double remaining_residual = 0.0;
+      if (owned(i, j)) {
+        candidates.push_back({i, j});
+      }
+      for (int n = 0; n < 4; ++n) {
+        if (owned(i + di[n], j + dj[n])) {
+          candidates.push_back({i + di[n], j + dj[n]});
+        }
+      }
+    };
 
-  // Second step: we need to redistribute residual ice volume if
-  // neighbors which gained redistributed ice also become full.
-  {
-    // will be destroyed at the end of the block
-    IceModelVec::AccessList list{&m_impl->thickness, &ice_thickness,
-        &ice_surface_elevation, &bed_topography, &cell_type};
+    for (const auto &p : changed_points) {
+      update(p.first, p.second);
+    }
 
-    for (Points p(*m_grid); p; p.next()) {
+    for (GhostPoints p(*m_grid, width); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      if (area_specific_volume(i, j) <= 0.0) {
-        continue;
+      if (ice_thickness(i, j) != (*m_impl->thickness)(i, j)) {
+        update(i, j);
       }
+    }
 
-      double threshold = part_grid_threshold_thickness(cell_type.int_star(i, j),
-                                                       m_impl->thickness.star(i, j),
-                                                       ice_surface_elevation.star(i, j),
-                                                       bed_topography(i, j));
+    candidates.insert(candidates.end(), receivers.begin(), receivers.end());
 
-      // if threshold is zero, turn all the area specific volume into ice thickness, with zero
-      // residual
-      if (threshold == 0.0) {
-        threshold = area_specific_volume(i, j);
-      }
+    cell_type.inc_state_counter();
+    ice_surface_elevation.inc_state_counter();
+    m_impl->thickness->inc_state_counter();
+  }
+
+  changed_points.clear();
+  residual_points.clear();
+
+  double remaining_residual = 0.0;
+
+  // Second step: we need to redistribute residual ice volume if
+  // neighbors which gained redistributed ice also become full.
+  auto second_step = [&](int i, int j) {
+    if (area_specific_volume(i, j) <= 0.0) {
+      return;
+    }
+
+    double threshold = part_grid_threshold_thickness(cell_type.int_star(i, j),
+                                                     m_impl->thickness->star(i, j),
+                                                     ice_surface_elevation.star(i, j),
+                                                     bed_topography(i, j));
+
+    // if threshold is zero, turn all the area specific volume into ice thickness, with zero
+    // residual
+    if (threshold == 0.0) {
+      threshold = area_specific_volume(i, j);
+    }
+
+    if (area_specific_volume(i, j) >= threshold) {
+      ice_thickness(i, j)        += threshold;
+      residual(i, j)              = area_specific_volume(i, j) - threshold;
+      area_specific_volume(i, j)  = 0.0;
 
-      if (area_specific_volume(i, j) >= threshold) {
-        ice_thickness(i, j)        += threshold;
-        residual(i, j)              = area_specific_volume(i, j) - threshold;
-        area_specific_volume(i, j)  = 0.0;
+      remaining_residual += residual(i, j);
 
-        remaining_residual += residual(i, j);
+      changed_points.push_back({i, j});
+      if (residual(i, j) > 0.0) {
+        residual_points.push_back({i, j});
       }
     }
+  };
+
+  if (first_iteration) {
+    for (Points p(*m_grid); p; p.next()) {
+      second_step(p.i(), p.j());
+    }
+  } else {
+    for (const auto &p : candidates) {
+      second_step(p.first, p.second);
+    }
   }
 
   // check if redistribution should be run once more
-  remaining_residual = GlobalSum(m_grid->com, remaining_residual);
+  if (check_convergence) {
+    remaining_residual = GlobalSum(m_grid->com, remaining_residual);
 
-  if (remaining_residual > 0.0) {
-    done = false;
+    if (remaining_residual > 0.0) {
+      done = false;
+    } else {
+      done = true;
+    }
   } else {
-    done = true;
+    done = false;
   }
 
   ice_thickness.update_ghosts();
 }
 
 /*!
- * Correct `thickness_change` and `area_specific_volume_change` so that applying them will not
- * result in negative `ice_thickness` and `area_specific_volume`.
+ * Compute changes in ice thickness and area specific volume due to flow, correcting them so
+ * that applying them will not result in negative ice thickness and area specific volume.
  *
- * Compute the `conservation_error`, i.e. the amount of ice that is added to preserve
- * non-negativity.
+ * Computes the conservation error, i.e. the amount of ice that is added to preserve
+ * non-negativity, and records cells affected by flow (see apply_flux_divergence()).
  *
- * @param[in] ice_thickness ice thickness (m)
- * @param[in] area_specific_volume area-specific volume (m3/m2)
- * @param[in,out] thickness_change "proposed" thickness change (m)
- * @param[in,out] area_specific_volume_change "proposed" area-specific volume change (m3/m2)
- * @param[out] conservation_error computed conservation error (m)
+ * If part_grid is enabled, new ice thickness and area specific volume are in
+ * `m_impl->ice_thickness` and `m_impl->area_specific_volume` (see update_in_place()).
+ * Otherwise the ice thickness change is computed here using the flux divergence and the
+ * area specific volume does not change.
  *
- * This computation is purely local.
+ * @param[in] dt time step, seconds
+ * @param[in] ice_thickness ice thickness at the beginning of the step (m)
+ * @param[in] area_specific_volume area-specific volume at the beginning of the step (m3/m2)
+ *
+ * All outputs are computed in one pass over the grid. This computation is purely local
+ * (except for the ghost update of the changed cells mask).
  */
-void GeometryEvolution::ensure_nonnegativity(const IceModelVec2S &ice_thickness,
-                                             const IceModelVec2S &area_specific_volume,
-                                             IceModelVec2S &thickness_change,
-                                             IceModelVec2S &area_specific_volume_change,
-                                             IceModelVec2S &conservation_error) {
+void GeometryEvolution::compute_changes_due_to_flow(double dt,
+                                                    const IceModelVec2S &ice_thickness,
+                                                    const IceModelVec2S &area_specific_volume) {
+
+  IceModelVec2S
+    &thickness_change            = m_impl->thickness_change,
+    &area_specific_volume_change = m_impl->ice_area_specific_volume_change,
+    &conservation_error          = m_impl->conservation_error;
+
+  const bool part_grid = m_impl->use_part_grid;
 
   IceModelVec::AccessList list{&ice_thickness, &area_specific_volume, &thickness_change,
-      &area_specific_volume_change, &conservation_error};
+      &area_specific_volume_change, &conservation_error, &m_impl->changed_cells};
+
+  if (part_grid) {
+    list.add({m_impl->ice_thickness.get(), m_impl->area_specific_volume.get()});
+  } else {
+    list.add(m_impl->flux_divergence);
+  }
+
+#if (Pism_DEBUG==1)
+  const double Lz = m_grid->Lz();
+#endif
 
   ParallelSection loop(m_grid->com);
   try {
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      conservation_error(i, j) = 0.0;
-
       const double
-        H  = ice_thickness(i, j),
-        dH = thickness_change(i, j);
+        H = ice_thickness(i, j),
+        V = area_specific_volume(i, j);
+
+      double H_new = 0.0, V_new = 0.0;
+      if (part_grid) {
+        H_new = (*m_impl->ice_thickness)(i, j);
+        V_new = (*m_impl->area_specific_volume)(i, j);
+      } else {
+        H_new = H + (- dt * m_impl->flux_divergence(i, j));
+        V_new = V;
+
+#if (Pism_DEBUG==1)
+        if (H_new > Lz) {
+          throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                        "ice thickness exceeds Lz at i=%d, j=%d (H=%f, Lz=%f)",
+                                        i, j, H_new, Lz);
+        }
+#endif
+      }
+
+      double
+        dH    = H_new - H,
+        dV    = V_new - V,
+        error = 0.0;
 
       // applying thickness_change will lead to negative thickness
       if (H + dH < 0.0) {
-        thickness_change(i, j)    = H;
-        conservation_error(i, j) += - (H + dH);
+        error += - (H + dH);
+        dH     = - H;
       }
 
-      const double
-        V  = area_specific_volume(i, j),
-        dV = area_specific_volume_change(i, j);
-
       if (V + dV < 0.0) {
-        area_specific_volume_change(i, j)  = V;
-        conservation_error(i, j)          += - (V + dV);
+        error += - (V + dV);
+        dV     = - V;
       }
+
+      thickness_change(i, j)            = dH;
+      area_specific_volume_change(i, j) = dV;
+      conservation_error(i, j)          = error;
+
+      m_impl->changed_cells(i, j) = (dH != 0.0 or dV != 0.0) ? 1.0 : 0.0;
     }
   } catch (...) {
     loop.failed();
   }
   loop.check();
+
+  thickness_change.inc_state_counter();
+  area_specific_volume_change.inc_state_counter();
+  conservation_error.inc_state_counter();
+
+  m_impl->changed_cells.update_ghosts();
+  m_impl->changed_cells.inc_state_counter();
 }
 
 /*!
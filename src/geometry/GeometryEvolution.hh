@@ -46,7 +46,8 @@ public:
                  const IceModelVec2V    &advective_velocity,
                  const IceModelVec2Stag &diffusive_flux,
                  const IceModelVec2Int  &velocity_bc_mask,
-                 const IceModelVec2Int  &thickness_bc_mask);
+                 const IceModelVec2Int  &thickness_bc_mask,
+                 const IceModelVec2Stag *diffusivity = nullptr);
 
   void source_term_step(const Geometry &geometry, double dt,
                         const IceModelVec2Int &thickness_bc_mask,
@@ -89,6 +90,8 @@ protected:
                                          IceModelVec2CellType& cell_type,
                                          IceModelVec2S& Href,
                                          IceModelVec2S& H_residual,
+                                         bool first_iteration,
+                                         bool check_convergence,
                                          bool &done);
 
   virtual void compute_interface_fluxes(const IceModelVec2CellType &cell_type,
@@ -98,15 +101,23 @@ protected:
                                         const IceModelVec2Stag     &diffusive_flux,
                                         IceModelVec2Stag           &output);
 
-  virtual void compute_flux_divergence(const IceModelVec2Stag &flux_staggered,
+  void compute_implicit_diffusive_flux(double dt,
+                                       const IceModelVec2CellType &cell_type,
+                                       const IceModelVec2S        &bed_elevation,
+                                       const IceModelVec2S        &sea_level,
+                                       const IceModelVec2S        &ice_thickness,
+                                       const IceModelVec2S        &advective_flux_divergence,
+                                       const IceModelVec2Stag     &diffusivity,
+                                       const IceModelVec2Int      &thickness_bc_mask,
+                                       IceModelVec2Stag           &output);
+
+  virtual void compute_flux_divergence(IceModelVec2Stag &flux_staggered,
                                        const IceModelVec2Int &thickness_bc_mask,
                                        IceModelVec2S &flux_fivergence);
 
-  virtual void ensure_nonnegativity(const IceModelVec2S &ice_thickness,
-                                    const IceModelVec2S &area_specific_volume,
-                                    IceModelVec2S &thickness_change,
-                                    IceModelVec2S &area_specific_volume_change,
-                                    IceModelVec2S &conservation_error);
+  void compute_changes_due_to_flow(double dt,
+                                   const IceModelVec2S &ice_thickness,
+                                   const IceModelVec2S &area_specific_volume);
 
   virtual void set_no_model_mask_impl(const IceModelVec2Int &mask);
 
@@ -19,6 +19,7 @@
 
 #include <cassert>
 #include <cmath>                // fabs
+#include <algorithm>            // std::min, std::max
 
 #include "grounded_cell_fraction.hh"
 
@@ -254,6 +255,91 @@ static Box F(const Box &SL, const Box &B, const Box &H, double alpha) {
           F(SL.ne, B.ne, H.ne, alpha)};
 }
 
+/*!
+ * Compute the grounded cell fraction at a point given values of the flotation criterion
+ * `f` in the box stencil around it.
+ *
+ * The control volume is split into 8 triangles and the flotation criterion is treated as a
+ * linear function on each triangle.
+ */
+static double grounded_cell_fraction(const Box &f) {
+  /*
+    NW----------------N----------------NE
+    |                 |                 |
+    |                 |                 |
+    |       nw--------n--------ne       |
+    |        |        |        |        |
+    |        |        |        |        |
+    W--------w--------o--------e--------E
+    |        |        |        |        |
+    |        |        |        |        |
+    |       sw--------s--------se       |
+    |                 |                 |
+    |                 |                 |
+    SW----------------S----------------SE
+  */
+
+  double
+    f_o  = f.ij,
+    f_sw = 0.25 * (f.sw + f.s + f.ij + f.w),
+    f_se = 0.25 * (f.s + f.se + f.e + f.ij),
+    f_ne = 0.25 * (f.ij + f.e + f.ne + f.n),
+    f_nw = 0.25 * (f.w + f.ij + f.n + f.nw);
+
+  double
+    f_s = 0.5 * (f.ij + f.s),
+    f_e = 0.5 * (f.ij + f.e),
+    f_n = 0.5 * (f.ij + f.n),
+    f_w = 0.5 * (f.ij + f.w);
+
+  double fraction = 0.125 * (grounded_area_fraction(f_o, f_ne, f_n) +
+                             grounded_area_fraction(f_o, f_n,  f_nw) +
+                             grounded_area_fraction(f_o, f_nw, f_w) +
+                             grounded_area_fraction(f_o, f_w,  f_sw) +
+                             grounded_area_fraction(f_o, f_sw, f_s) +
+                             grounded_area_fraction(f_o, f_s,  f_se) +
+                             grounded_area_fraction(f_o, f_se, f_e) +
+                             grounded_area_fraction(f_o, f_e,  f_ne));
+
+  return clip(fraction, 0.0, 1.0);
+}
+
+/*!
+ * Compute the grounded cell fraction at the point (i, j). `alpha` is the ice density
+ * divided by the ocean density.
+ *
+ * Values of the flotation criterion used by the triangles above are averages of values
+ * in the box stencil, so if all of them are positive (non-positive) the cell is fully
+ * grounded (floating) and grounded_cell_fraction(f) would return exactly 1 (0). This
+ * check does not branch at every value and is done first: only the (relatively few)
+ * cells near the grounding line take the expensive path. Note that a NaN fails both
+ * tests, so such cells take the expensive path as well.
+ */
+static double grounded_cell_fraction(int i, int j, double alpha,
+                                     const IceModelVec2S &sea_level,
+                                     const IceModelVec2S &ice_thickness,
+                                     const IceModelVec2S &bed_topography) {
+  auto S = sea_level.box(i, j);
+  auto H = ice_thickness.box(i, j);
+  auto B = bed_topography.box(i, j);
+
+  auto f = F(S, B, H, alpha);
+
+  double
+    f_min = std::min({f.ij, f.n, f.nw, f.w, f.sw, f.s, f.se, f.e, f.ne}),
+    f_max = std::max({f.ij, f.n, f.nw, f.w, f.sw, f.s, f.se, f.e, f.ne});
+
+  if (f_min > 0.0) {
+    return 1.0;
+  }
+
+  if (f_max <= 0.0) {
+    return 0.0;
+  }
+
+  return grounded_cell_fraction(f);
+}
+
 /*!
  * @param[in] ice_density ice density, kg/m3
  * @param[in] ocean_density ocean_density, kg/m3
@@ -278,52 +364,51 @@ void compute_grounded_cell_fraction(double ice_density,
     for (Points p(*grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      auto S = sea_level.box(i, j);
-      auto H = ice_thickness.box(i, j);
-      auto B = bed_topography.box(i, j);
-
-      auto f = F(S, B, H, alpha);
-
-      /*
-        NW----------------N----------------NE
-        |                 |                 |
-        |                 |                 |
-        |       nw--------n--------ne       |
-        |        |        |        |        |
-        |        |        |        |        |
-        W--------w--------o--------e--------E
-        |        |        |        |        |
-        |        |        |        |        |
-        |       sw--------s--------se       |
-        |                 |                 |
-        |                 |                 |
-        SW----------------S----------------SE
-      */
-
-      double
-        f_o  = f.ij,
-        f_sw = 0.25 * (f.sw + f.s + f.ij + f.w),
-        f_se = 0.25 * (f.s + f.se + f.e + f.ij),
-        f_ne = 0.25 * (f.ij + f.e + f.ne + f.n),
-        f_nw = 0.25 * (f.w + f.ij + f.n + f.nw);
-
-      double
-        f_s = 0.5 * (f.ij + f.s),
-        f_e = 0.5 * (f.ij + f.e),
-        f_n = 0.5 * (f.ij + f.n),
-        f_w = 0.5 * (f.ij + f.w);
-
-      double fraction = 0.125 * (grounded_area_fraction(f_o, f_ne, f_n) +
-                                 grounded_area_fraction(f_o, f_n,  f_nw) +
-                                 grounded_area_fraction(f_o, f_nw, f_w) +
-                                 grounded_area_fraction(f_o, f_w,  f_sw) +
-                                 grounded_area_fraction(f_o, f_sw, f_s) +
-                                 grounded_area_fraction(f_o, f_s,  f_se) +
-                                 grounded_area_fraction(f_o, f_se, f_e) +
-                                 grounded_area_fraction(f_o, f_e,  f_ne));
-
-      result(i, j) = clip(fraction, 0.0, 1.0);
+      result(i, j) = grounded_cell_fraction(i, j, alpha,
+                                            sea_level, ice_thickness, bed_topography);
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+}
+
+/*!
+ * @param[in] ice_density ice density, kg/m3
+ * @param[in] ocean_density ocean_density, kg/m3
+ * @param[in] sea_level sea level (flotation) elevation, m
+ * @param[in] ice_thickness ice thickness, m
+ * @param[in] bed_topography bed elevation, m
+ * @param[in] changed_cells cells where the geometry changed (non-zero), ghosted
+ * @param[in,out] result grounded cell fraction, between 0 (floating) and 1 (grounded);
+ *                       updated near changed cells only
+ */
+void compute_grounded_cell_fraction(double ice_density,
+                                    double ocean_density,
+                                    const IceModelVec2S &sea_level,
+                                    const IceModelVec2S &ice_thickness,
+                                    const IceModelVec2S &bed_topography,
+                                    const IceModelVec2Int &changed_cells,
+                                    IceModelVec2S &result) {
+  IceGrid::ConstPtr grid = result.grid();
+  double alpha = ice_density / ocean_density;
+
+  IceModelVec::AccessList list{&sea_level, &ice_thickness, &bed_topography,
+                               &changed_cells, &result};
+
+  ParallelSection loop(grid->com);
+  try {
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      // the grounded cell fraction uses values in the 3x3 box around (i, j)
+      auto C = changed_cells.int_box(i, j);
+      if (C.ij + C.n + C.e + C.s + C.w + C.ne + C.se + C.sw + C.nw == 0) {
+        continue;
+      }
 
+      result(i, j) = grounded_cell_fraction(i, j, alpha,
+                                            sea_level, ice_thickness, bed_topography);
     }
   } catch (...) {
     loop.failed();
@@ -23,6 +23,7 @@
 namespace pism {
 
 class IceModelVec2S;
+class IceModelVec2Int;
 
 double grounded_area_fraction(double a, double b, double c);
 
@@ -37,6 +38,18 @@ void compute_grounded_cell_fraction(double ice_density,
                                     const IceModelVec2S &bed_topography,
                                     IceModelVec2S &result);
 
+/*!
+ * Update grounded cell fractions at grid points next to (or at) cells marked in
+ * `changed_cells` (ghosted).
+ */
+void compute_grounded_cell_fraction(double ice_density,
+                                    double ocean_density,
+                                    const IceModelVec2S &sea_level,
+                                    const IceModelVec2S &ice_thickness,
+                                    const IceModelVec2S &bed_topography,
+                                    const IceModelVec2Int &changed_cells,
+                                    IceModelVec2S &result);
+
 } // end of namespace pism
 
 
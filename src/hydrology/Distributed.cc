@@ -46,6 +46,83 @@ Distributed::Distributed(IceGrid::ConstPtr g)
                    "new transportable subglacial water pressure during update",
                    "Pa", "Pa", "", 0);
   m_Pnew.metadata().set_number("valid_min", 0.0);
+
+  m_WP_inputs.dt            = 0.0;
+  m_WP_inputs.cell_type     = nullptr;
+  m_WP_inputs.sliding_speed = nullptr;
+  m_WP_inputs.no_model_mask = nullptr;
+
+  m_implicit_WP = m_config->get_string("hydrology.distributed.time_stepping") == "implicit";
+
+  if (m_implicit_WP) {
+    PetscErrorCode ierr;
+
+    // Use a copy of the DM shared with other components: SNES callbacks are attached to
+    // the DM.
+    ierr = DMClone(*m_grid->get_dm(2, 1), m_WP_da.rawptr());
+    PISM_CHK(ierr, "DMClone");
+
+    ierr = DMDASetFieldName(m_WP_da, 0, "P");
+    PISM_CHK(ierr, "DMDASetFieldName");
+
+    ierr = DMDASetFieldName(m_WP_da, 1, "W");
+    PISM_CHK(ierr, "DMDASetFieldName");
+
+    // field splits extract sub-matrices, which is not supported by BAIJ
+    ierr = DMSetMatType(m_WP_da, MATAIJ);
+    PISM_CHK(ierr, "DMSetMatType");
+
+    ierr = DMCreateGlobalVector(m_WP_da, m_WP.rawptr());
+    PISM_CHK(ierr, "DMCreateGlobalVector");
+
+    ierr = DMDASNESSetFunctionLocal(m_WP_da, INSERT_VALUES,
+                                    (DMDASNESFunction)WP_function_callback,
+                                    this);
+    PISM_CHK(ierr, "DMDASNESSetFunctionLocal");
+
+    ierr = DMDASNESSetJacobianLocal(m_WP_da,
+                                    (DMDASNESJacobian)WP_jacobian_callback,
+                                    this);
+    PISM_CHK(ierr, "DMDASNESSetJacobianLocal");
+
+    ierr = SNESCreate(m_grid->com, m_WP_snes.rawptr());
+    PISM_CHK(ierr, "SNESCreate");
+
+    ierr = SNESSetOptionsPrefix(m_WP_snes, "hydrology_");
+    PISM_CHK(ierr, "SNESSetOptionsPrefix");
+
+    ierr = SNESSetDM(m_WP_snes, m_WP_da);
+    PISM_CHK(ierr, "SNESSetDM");
+
+    // Default preconditioner: eliminate P using the (diagonal) pressure block. The Schur
+    // complement is then an advection-diffusion operator for W that includes the change
+    // in storage due to pressure changes; it is assembled exactly ("selfp") because the
+    // pressure block is diagonal.
+    {
+      KSP ksp;
+      ierr = SNESGetKSP(m_WP_snes, &ksp);
+      PISM_CHK(ierr, "SNESGetKSP");
+
+      PC pc;
+      ierr = KSPGetPC(ksp, &pc);
+      PISM_CHK(ierr, "KSPGetPC");
+
+      ierr = PCSetType(pc, PCFIELDSPLIT);
+      PISM_CHK(ierr, "PCSetType");
+
+      ierr = PCFieldSplitSetType(pc, PC_COMPOSITE_SCHUR);
+      PISM_CHK(ierr, "PCFieldSplitSetType");
+
+      ierr = PCFieldSplitSetSchurFactType(pc, PC_FIELDSPLIT_SCHUR_FACT_FULL);
+      PISM_CHK(ierr, "PCFieldSplitSetSchurFactType");
+
+      ierr = PCFieldSplitSetSchurPre(pc, PC_FIELDSPLIT_SCHUR_PRE_SELFP, NULL);
+      PISM_CHK(ierr, "PCFieldSplitSetSchurPre");
+    }
+
+    ierr = SNESSetFromOptions(m_WP_snes);
+    PISM_CHK(ierr, "SNESSetFromOptions");
+  }
 }
 
 Distributed::~Distributed() {
@@ -218,6 +295,457 @@ void Distributed::P_from_W_steady(const IceModelVec2S &W,
   } // end of the loop over grid points
 }
 
+//! Conductivity at faces of the cell (i,j), set to zero at faces where the water
+//! velocity is zero (see compute_velocity()).
+StarStencil<double> Distributed::active_conductivity(int i, int j,
+                                                     const IceModelVec2Int *no_model_mask) const {
+  auto k  = m_Kstag.star(i, j);
+  auto ws = m_Wstag.star(i, j);
+
+  StarStencil<double> result;
+  result.ij = 0.0;
+  result.e  = ws.e > 0.0 ? k.e : 0.0;
+  result.w  = ws.w > 0.0 ? k.w : 0.0;
+  result.n  = ws.n > 0.0 ? k.n : 0.0;
+  result.s  = ws.s > 0.0 ? k.s : 0.0;
+
+  if (no_model_mask) {
+    auto M = no_model_mask->int_star(i, j);
+
+    if (M.ij) {
+      result.e = 0.0;
+      result.w = 0.0;
+      result.n = 0.0;
+      result.s = 0.0;
+    }
+    if (M.e) {
+      result.e = 0.0;
+    }
+    if (M.w) {
+      result.w = 0.0;
+    }
+    if (M.n) {
+      result.n = 0.0;
+    }
+    if (M.s) {
+      result.s = 0.0;
+    }
+  }
+
+  return result;
+}
+
+//! Residual of the implicit (backward Euler) discretization of the coupled W, P system.
+/*!
+  The water thickness equation uses the same spatial discretization as update_W(), but
+  fluxes are computed using W and P at the end of the sub-step. The water velocity is
+  computed from P at the end of the sub-step; the conductivity and the staggered water
+  thickness in the diffusive term are lagged.
+
+  Subtracting the water thickness equation from the pressure equation used by update_P()
+  gives the pressure equation in local form:
+
+  \f[ \frac{\phi_0}{\rho_w g}(P - P^n) - (W - W^n) = \Delta t\, (\text{Close} - \text{Open}). \f]
+
+  Both equations are in meters of water. Pressure is set to zero on ice-free land and
+  to overburden in the ocean.
+*/
+void Distributed::WP_residual(const WPValues *const *x, WPValues **f) {
+  const double
+    n    = m_config->get_number("stress_balance.sia.Glen_exponent"),
+    A    = m_config->get_number("flow_law.isothermal_Glen.ice_softness"),
+    c1   = m_config->get_number("hydrology.cavitation_opening_coefficient"),
+    c2   = m_config->get_number("hydrology.creep_closure_coefficient"),
+    Wr   = m_config->get_number("hydrology.roughness_scale"),
+    phi0 = m_config->get_number("hydrology.regularizing_porosity");
+
+  const double
+    dt  = m_WP_inputs.dt,
+    C   = phi0 / m_rg,
+    wux = 1.0 / (m_dx * m_dx),
+    wuy = 1.0 / (m_dy * m_dy);
+
+  const IceModelVec2CellType &cell_type = *m_WP_inputs.cell_type;
+  const IceModelVec2S &sliding_speed = *m_WP_inputs.sliding_speed;
+  const IceModelVec2Int *no_model_mask = m_WP_inputs.no_model_mask;
+
+  IceModelVec::AccessList list{&m_W, &m_P, &m_Wtill, &m_Wtillnew, &m_Wstag, &m_Kstag,
+                               &m_surface_input_rate, &m_basal_melt_rate, &m_Pover,
+                               &m_bottom_surface, &cell_type, &sliding_speed};
+  if (no_model_mask) {
+    list.add(*no_model_mask);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    // water thickness equation
+    {
+      auto K  = active_conductivity(i, j, no_model_mask);
+      auto k  = m_Kstag.star(i, j);
+      auto ws = m_Wstag.star(i, j);
+      auto b  = m_bottom_surface.star(i, j);
+
+      const double
+        W  = x[j][i].W,
+        We = x[j][i + 1].W,
+        Ww = x[j][i - 1].W,
+        Wn = x[j + 1][i].W,
+        Ws = x[j - 1][i].W,
+        P  = x[j][i].P;
+
+      // water velocity at cell faces (see compute_velocity())
+      const double
+        Ve = - K.e * ((x[j][i + 1].P - P) + m_rg * (b.e - b.ij)) / m_dx,
+        Vw = - K.w * ((P - x[j][i - 1].P) + m_rg * (b.ij - b.w)) / m_dx,
+        Vn = - K.n * ((x[j + 1][i].P - P) + m_rg * (b.n - b.ij)) / m_dy,
+        Vs = - K.s * ((P - x[j - 1][i].P) + m_rg * (b.ij - b.s)) / m_dy;
+
+      // upwinded advective fluxes (see advective_fluxes())
+      const double
+        Qe = Ve * (Ve >= 0.0 ? W : We),
+        Qw = Vw * (Vw >= 0.0 ? Ww : W),
+        Qn = Vn * (Vn >= 0.0 ? W : Wn),
+        Qs = Vs * (Vs >= 0.0 ? Ws : W);
+
+      const double divadflux = (Qe - Qw) / m_dx + (Qn - Qs) / m_dy;
+
+      const double
+        De = m_rg * k.e * ws.e,
+        Dw = m_rg * k.w * ws.w,
+        Dn = m_rg * k.n * ws.n,
+        Ds = m_rg * k.s * ws.s;
+
+      const double diffW = (wux * (De * (We - W) - Dw * (W - Ww)) +
+                            wuy * (Dn * (Wn - W) - Ds * (W - Ws)));
+
+      const double
+        input_rate   = m_surface_input_rate(i, j) + m_basal_melt_rate(i, j),
+        Wtill_change = m_Wtillnew(i, j) - m_Wtill(i, j);
+
+      f[j][i].W = (W - (m_W(i, j) + (dt * input_rate - Wtill_change)) -
+                   dt * (diffW - divadflux));
+    }
+
+    // pressure equation
+    {
+      const double
+        W   = x[j][i].W,
+        P   = x[j][i].P,
+        P_o = m_Pover(i, j);
+
+      if (cell_type.ice_free_land(i, j)) {
+        f[j][i].P = C * P;
+      } else if (cell_type.ocean(i, j)) {
+        f[j][i].P = C * (P - P_o);
+      } else {
+        const double
+          Open  = c1 * sliding_speed(i, j) * std::max(0.0, Wr - W),
+          Close = c2 * A * pow(std::max(P_o - P, 0.0), n) * W;
+
+        f[j][i].P = C * (P - m_P(i, j)) - (W - m_W(i, j)) - dt * (Close - Open);
+      }
+    }
+  } // end of the loop over grid points
+}
+
+//! Jacobian of WP_residual() (conductivity and staggered water thickness are lagged).
+void Distributed::WP_jacobian(const WPValues *const *x, Mat J) {
+  PetscErrorCode ierr = 0;
+
+  const double
+    n    = m_config->get_number("stress_balance.sia.Glen_exponent"),
+    A    = m_config->get_number("flow_law.isothermal_Glen.ice_softness"),
+    c1   = m_config->get_number("hydrology.cavitation_opening_coefficient"),
+    c2   = m_config->get_number("hydrology.creep_closure_coefficient"),
+    Wr   = m_config->get_number("hydrology.roughness_scale"),
+    phi0 = m_config->get_number("hydrology.regularizing_porosity");
+
+  const double
+    dt  = m_WP_inputs.dt,
+    C   = phi0 / m_rg,
+    wux = dt / (m_dx * m_dx),
+    wuy = dt / (m_dy * m_dy),
+    cx  = dt / m_dx,
+    cy  = dt / m_dy;
+
+  const IceModelVec2CellType &cell_type = *m_WP_inputs.cell_type;
+  const IceModelVec2S &sliding_speed = *m_WP_inputs.sliding_speed;
+  const IceModelVec2Int *no_model_mask = m_WP_inputs.no_model_mask;
+
+  // field indexes (see WPValues)
+  const int
+    P_field = 0,
+    W_field = 1;
+
+  ierr = MatZeroEntries(J); PISM_CHK(ierr, "MatZeroEntries");
+
+  IceModelVec::AccessList list{&m_Wstag, &m_Kstag, &m_Pover, &m_bottom_surface,
+                               &cell_type, &sliding_speed};
+  if (no_model_mask) {
+    list.add(*no_model_mask);
+  }
+
+  ParallelSection loop(m_grid->com);
+  try {
+    const int ncol = 10;
+    MatStencil row, col[ncol];
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      /* i indices */
+      const int I[] = {i, i - 1,  i,  i + 1, i};
+
+      /* j indices */
+      const int J[] = {j + 1, j,  j,  j, j - 1};
+
+      for (int m = 0; m < 5; m++) {
+        col[m].i = I[m];
+        col[m].j = J[m];
+        col[m].c = W_field;
+
+        col[m + 5].i = I[m];
+        col[m + 5].j = J[m];
+        col[m + 5].c = P_field;
+      }
+
+      row.i = i;
+      row.j = j;
+
+      // water thickness equation
+      {
+        auto K  = active_conductivity(i, j, no_model_mask);
+        auto k  = m_Kstag.star(i, j);
+        auto ws = m_Wstag.star(i, j);
+        auto b  = m_bottom_surface.star(i, j);
+
+        const double
+          W  = x[j][i].W,
+          We = x[j][i + 1].W,
+          Ww = x[j][i - 1].W,
+          Wn = x[j + 1][i].W,
+          Ws = x[j - 1][i].W,
+          P  = x[j][i].P;
+
+        const double
+          Ve = - K.e * ((x[j][i + 1].P - P) + m_rg * (b.e - b.ij)) / m_dx,
+          Vw = - K.w * ((P - x[j][i - 1].P) + m_rg * (b.ij - b.w)) / m_dx,
+          Vn = - K.n * ((x[j + 1][i].P - P) + m_rg * (b.n - b.ij)) / m_dy,
+          Vs = - K.s * ((P - x[j - 1][i].P) + m_rg * (b.ij - b.s)) / m_dy;
+
+        // upwinded water thickness at faces
+        const double
+          We_up = Ve >= 0.0 ? W : We,
+          Ww_up = Vw >= 0.0 ? Ww : W,
+          Wn_up = Vn >= 0.0 ? W : Wn,
+          Ws_up = Vs >= 0.0 ? Ws : W;
+
+        const double
+          De = m_rg * k.e * ws.e,
+          Dw = m_rg * k.w * ws.w,
+          Dn = m_rg * k.n * ws.n,
+          Ds = m_rg * k.s * ws.s;
+
+        // derivatives with respect to W (same as in assemble_W_matrix())
+        const double
+          WN = - wuy * Dn + cy * std::min(Vn, 0.0),
+          WE = - wux * De + cx * std::min(Ve, 0.0),
+          WW = - wux * Dw - cx * std::max(Vw, 0.0),
+          WS = - wuy * Ds - cy * std::max(Vs, 0.0),
+          WC = (1.0 +
+                wux * (De + Dw) + cx * (std::max(Ve, 0.0) - std::min(Vw, 0.0)) +
+                wuy * (Dn + Ds) + cy * (std::max(Vn, 0.0) - std::min(Vs, 0.0)));
+
+        // derivatives with respect to P (the velocity depends on the pressure gradient)
+        const double
+          PN = - wuy * Wn_up * K.n,
+          PE = - wux * We_up * K.e,
+          PW = - wux * Ww_up * K.w,
+          PS = - wuy * Ws_up * K.s,
+          PC = - (PN + PE + PW + PS);
+
+        double L[ncol] = {WN, WW, WC, WE, WS,
+                          PN, PW, PC, PE, PS};
+
+        row.c = W_field;
+        ierr = MatSetValuesStencil(J, 1, &row, ncol, col, L, INSERT_VALUES);
+        PISM_CHK(ierr, "MatSetValuesStencil");
+      }
+
+      // pressure equation
+      {
+        const double
+          W   = x[j][i].W,
+          P   = x[j][i].P,
+          P_o = m_Pover(i, j);
+
+        // columns: W and P at (i,j)
+        MatStencil c[2] = {col[2], col[7]};
+        double L[2] = {0.0, C};
+
+        if (not (cell_type.ice_free_land(i, j) or cell_type.ocean(i, j))) {
+          const double
+            dP       = std::max(P_o - P, 0.0),
+            dOpen_dW = W < Wr ? - c1 * sliding_speed(i, j) : 0.0;
+
+          L[0] = -1.0 - dt * (c2 * A * pow(dP, n) - dOpen_dW);
+          L[1] = C + dt * c2 * A * n * pow(dP, n - 1.0) * W;
+        }
+
+        row.c = P_field;
+        ierr = MatSetValuesStencil(J, 1, &row, 2, c, L, INSERT_VALUES);
+        PISM_CHK(ierr, "MatSetValuesStencil");
+      }
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+
+  ierr = MatAssemblyBegin(J, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyBegin");
+  ierr = MatAssemblyEnd(J, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyEnd");
+}
+
+PetscErrorCode Distributed::WP_function_callback(DMDALocalInfo *info,
+                                                 const WPValues *const *x, WPValues **f,
+                                                 Distributed *solver) {
+  try {
+    (void) info;
+    solver->WP_residual(x, f);
+  } catch (...) {
+    MPI_Comm com = solver->m_grid->com;
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+PetscErrorCode Distributed::WP_jacobian_callback(DMDALocalInfo *info,
+                                                 const WPValues *const *x,
+                                                 Mat A, Mat J, Distributed *solver) {
+  try {
+    (void) info;
+    (void) A;
+    solver->WP_jacobian(x, J);
+  } catch (...) {
+    MPI_Comm com = solver->m_grid->com;
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+//! The implicit computation of W and P, called by update() if
+//! hydrology.distributed.time_stepping is "implicit".
+/*!
+  Solves the coupled system (see WP_residual()) using SNES (options prefix
+  "hydrology_"). This method does not need CFL and diffusivity restrictions, so sub-steps
+  are limited by `hydrology.maximum_time_step` only.
+
+  Bounds \f$0 \le P \le P_o\f$ are enforced after the solve by projection, the same way
+  update_P() enforces them. `W_new` is bounded by enforce_bounds() in update_impl().
+*/
+void Distributed::update_WP_implicit(double dt,
+                                     const IceModelVec2CellType &cell_type,
+                                     const IceModelVec2S &sliding_speed,
+                                     const IceModelVec2Int *no_model_mask,
+                                     IceModelVec2S &W_new,
+                                     IceModelVec2S &P_new) {
+  PetscErrorCode ierr = 0;
+
+  m_WP_inputs.dt            = dt;
+  m_WP_inputs.cell_type     = &cell_type;
+  m_WP_inputs.sliding_speed = &sliding_speed;
+  m_WP_inputs.no_model_mask = no_model_mask;
+
+  // use W and P from the previous sub-step as the initial guess
+  {
+    WPValues **x = nullptr;
+    ierr = DMDAVecGetArray(m_WP_da, m_WP, &x);
+    PISM_CHK(ierr, "DMDAVecGetArray");
+
+    IceModelVec::AccessList list{&m_W, &m_P};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      x[j][i].W = m_W(i, j);
+      x[j][i].P = m_P(i, j);
+    }
+
+    ierr = DMDAVecRestoreArray(m_WP_da, m_WP, &x);
+    PISM_CHK(ierr, "DMDAVecRestoreArray");
+  }
+
+  m_grid->ctx()->profiling().begin("distributed_snes");
+  {
+    ierr = SNESSolve(m_WP_snes, NULL, m_WP);
+    PISM_CHK(ierr, "SNESSolve");
+  }
+  m_grid->ctx()->profiling().end("distributed_snes");
+
+  SNESConvergedReason reason;
+  ierr = SNESGetConvergedReason(m_WP_snes, &reason);
+  PISM_CHK(ierr, "SNESGetConvergedReason");
+
+  if (reason < 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "SNES iteration failed while updating subglacial water\n"
+                                  "thickness and pressure: %s\n"
+                                  "Try reducing hydrology.maximum_time_step.",
+                                  SNESConvergedReasons[reason]);
+  }
+
+  PetscInt snes_iterations = 0, ksp_iterations = 0;
+  ierr = SNESGetIterationNumber(m_WP_snes, &snes_iterations);
+  PISM_CHK(ierr, "SNESGetIterationNumber");
+  ierr = SNESGetLinearSolveIterations(m_WP_snes, &ksp_iterations);
+  PISM_CHK(ierr, "SNESGetLinearSolveIterations");
+
+  m_log->message(3, "  implicit (W, P) update: %d SNES iterations, %d KSP iterations\n",
+                 (int)snes_iterations, (int)ksp_iterations);
+
+  {
+    const WPValues *const *x = nullptr;
+    ierr = DMDAVecGetArrayRead(m_WP_da, m_WP, &x);
+    PISM_CHK(ierr, "DMDAVecGetArrayRead");
+
+    IceModelVec::AccessList list{&cell_type, &m_Pover, &m_W, &m_Wtill, &m_Wtillnew,
+                                 &m_surface_input_rate, &m_basal_melt_rate,
+                                 &m_flow_change_incremental, &W_new, &P_new};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      W_new(i, j) = x[j][i].W;
+
+      // projection to enforce 0 <= P <= P_o (see update_P())
+      const double P_o = m_Pover(i, j);
+      if (cell_type.grounded_ice(i, j) and W_new(i, j) <= 0.0) {
+        P_new(i, j) = P_o;
+      } else {
+        P_new(i, j) = clip(x[j][i].P, 0.0, P_o);
+      }
+
+      // the change due to flow is the part of the change not explained by inputs and
+      // the change in till water
+      const double
+        input_rate   = m_surface_input_rate(i, j) + m_basal_melt_rate(i, j),
+        Wtill_change = m_Wtillnew(i, j) - m_Wtill(i, j);
+
+      m_flow_change_incremental(i, j) = W_new(i, j) - (m_W(i, j) + (dt * input_rate - Wtill_change));
+    }
+
+    ierr = DMDAVecRestoreArrayRead(m_WP_da, m_WP, &x);
+    PISM_CHK(ierr, "DMDAVecRestoreArrayRead");
+  }
+
+  m_flow_change.add(1.0, m_flow_change_incremental);
+  m_input_change.add(dt, m_surface_input_rate);
+  m_input_change.add(dt, m_basal_melt_rate);
+}
+
 double Distributed::max_timestep_P_diff(double phi0, double dt_diff_w) const {
   return 2.0 * phi0 * dt_diff_w;
 }
@@ -367,16 +895,17 @@ void Distributed::update_impl(double t, double dt, const Inputs& inputs) {
 
     // to get Q, W needs valid ghosts
     advective_fluxes(m_Vstag, m_W, m_Qstag);
+    m_Qstag.end_update_ghosts();
 
     m_Qstag_average.add(hdt, m_Qstag);
 
-    {
-      const double
-        dt_cfl    = max_timestep_W_cfl(),
-        dt_diff_w = max_timestep_W_diff(maxKW),
-        dt_diff_p = max_timestep_P_diff(phi0, dt_diff_w);
+    hdt = std::min(t_final - ht, dt_max);
+    if (not m_implicit_WP) {
+      double dt_cfl = 0.0, dt_diff_w = 0.0;
+      max_timestep_W(maxKW, dt_cfl, dt_diff_w);
+
+      const double dt_diff_p = max_timestep_P_diff(phi0, dt_diff_w);
 
-      hdt = std::min(t_final - ht, dt_max);
       hdt = std::min(hdt, dt_cfl);
       hdt = std::min(hdt, dt_diff_w);
       hdt = std::min(hdt, dt_diff_p);
@@ -400,26 +929,34 @@ void Distributed::update_impl(double t, double dt, const Inputs& inputs) {
                    m_conservation_error_change,
                    m_no_model_mask_change);
 
-    update_P(hdt,
-             inputs.geometry->cell_type,
-             *inputs.ice_sliding_speed,
-             m_surface_input_rate,
-             m_basal_melt_rate,
-             m_Pover,
-             m_Wtill, m_Wtillnew,
-             subglacial_water_pressure(),
-             m_W, m_Wstag,
-             m_Kstag, m_Qstag,
-             m_Pnew);
-
-    // update Wnew from W, Wtill, Wtillnew, Wstag, Q, input_rate
-    update_W(hdt,
-             m_surface_input_rate,
-             m_basal_melt_rate,
-             m_W, m_Wstag,
-             m_Wtill, m_Wtillnew,
-             m_Kstag, m_Qstag,
-             m_Wnew);
+    if (m_implicit_WP) {
+      update_WP_implicit(hdt,
+                         inputs.geometry->cell_type,
+                         *inputs.ice_sliding_speed,
+                         inputs.no_model_mask,
+                         m_Wnew, m_Pnew);
+    } else {
+      update_P(hdt,
+               inputs.geometry->cell_type,
+               *inputs.ice_sliding_speed,
+               m_surface_input_rate,
+               m_basal_melt_rate,
+               m_Pover,
+               m_Wtill, m_Wtillnew,
+               subglacial_water_pressure(),
+               m_W, m_Wstag,
+               m_Kstag, m_Qstag,
+               m_Pnew);
+
+      // update Wnew from W, Wtill, Wtillnew, Wstag, Q, input_rate
+      update_W(hdt,
+               m_surface_input_rate,
+               m_basal_melt_rate,
+               m_W, m_Wstag,
+               m_Wtill, m_Wtillnew,
+               m_Kstag, m_Qstag,
+               m_Wnew);
+    }
     // remove water in ice-free areas and account for changes
     enforce_bounds(inputs.geometry->cell_type,
                    inputs.no_model_mask,
@@ -20,6 +20,9 @@
 #define _DISTRIBUTED_H_
 
 #include "Routing.hh"
+#include "pism/util/petscwrappers/DM.hh"
+#include "pism/util/petscwrappers/SNES.hh"
+#include "pism/util/petscwrappers/Vec.hh"
 
 namespace pism {
 
@@ -89,11 +92,55 @@ protected:
                 const IceModelVec2Stag &K,
                 const IceModelVec2Stag &Q,
                 IceModelVec2S &P_new) const;
+
+  void update_WP_implicit(double dt,
+                          const IceModelVec2CellType &cell_type,
+                          const IceModelVec2S &sliding_speed,
+                          const IceModelVec2Int *no_model_mask,
+                          IceModelVec2S &W_new,
+                          IceModelVec2S &P_new);
 protected:
   IceModelVec2S m_P;
   IceModelVec2S m_Pnew;
 private:
   void initialization_message() const;
+
+  //! Unknowns of the implicit (W, P) solver at a grid point.
+  /*!
+   * Pressure comes first: the default "Schur" field split eliminates the first field,
+   * which is cheap because the pressure block is diagonal.
+   */
+  struct WPValues {
+    double P, W;
+  };
+
+  StarStencil<double> active_conductivity(int i, int j,
+                                          const IceModelVec2Int *no_model_mask) const;
+
+  void WP_residual(const WPValues *const *x, WPValues **f);
+  void WP_jacobian(const WPValues *const *x, Mat J);
+
+  static PetscErrorCode WP_function_callback(DMDALocalInfo *info,
+                                             const WPValues *const *x, WPValues **f,
+                                             Distributed *solver);
+  static PetscErrorCode WP_jacobian_callback(DMDALocalInfo *info,
+                                             const WPValues *const *x,
+                                             Mat A, Mat J, Distributed *solver);
+
+  // implicit time stepping (see hydrology.distributed.time_stepping)
+  bool m_implicit_WP;
+  petsc::DM m_WP_da;
+  petsc::SNES m_WP_snes;
+  petsc::Vec m_WP;
+
+  //! inputs of the implicit solver that are not stored in this class (set by
+  //! update_WP_implicit())
+  struct {
+    double dt;
+    const IceModelVec2CellType *cell_type;
+    const IceModelVec2S *sliding_speed;
+    const IceModelVec2Int *no_model_mask;
+  } m_WP_inputs;
 };
 
 } // end of namespace hydrology
@@ -21,7 +21,8 @@
 
 #include "pism/geometry/Geometry.hh"
 #include "pism/util/pism_utilities.hh"
-#include "pism/geometry/Geometry.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/Profiling.hh"
 
 namespace pism {
 namespace hydrology {
@@ -162,6 +163,32 @@ EmptyingProblem::EmptyingProblem(IceGrid::ConstPtr grid)
   m_dx  = m_grid->dx();
   m_dy  = m_grid->dy();
   m_tau = m_config->get_number("hydrology.steady.input_rate_scaling");
+
+  m_linear_system = m_config->get_string("hydrology.steady.method") == "linear_system";
+
+  if (m_linear_system) {
+    // allocate storage only if it is needed
+    m_x.create(grid, "time_integrated_water_thickness", WITHOUT_GHOSTS);
+    m_x.set_attrs("internal", "time-integrated water thickness in the emptying problem",
+                  "m s", "m s", "", 0);
+
+    PetscErrorCode ierr;
+
+    ierr = DMSetMatType(*m_x.dm(), MATAIJ);
+    PISM_CHK(ierr, "DMSetMatType");
+
+    ierr = DMCreateMatrix(*m_x.dm(), m_A.rawptr());
+    PISM_CHK(ierr, "DMCreateMatrix");
+
+    ierr = KSPCreate(m_grid->com, m_KSP.rawptr());
+    PISM_CHK(ierr, "KSPCreate");
+
+    ierr = KSPSetOptionsPrefix(m_KSP, "steady_");
+    PISM_CHK(ierr, "KSPSetOptionsPrefix");
+
+    ierr = KSPSetFromOptions(m_KSP);
+    PISM_CHK(ierr, "KSPSetFromOptions");
+  }
 }
 
 EmptyingProblem::~EmptyingProblem() {
@@ -243,13 +270,152 @@ void EmptyingProblem::update(const Geometry &geometry,
     return;
   }
 
-  double volume = 0.0;
-  int step_counter = 0;
+  double epsilon = 0.0;
 
-  IceModelVec::AccessList list{&m_Qsum, &m_W, &m_Vstag, &m_domain_mask, &m_tmp};
+  if (m_linear_system) {
+    // n_iterations * dt is the longest time the time-stepping method is allowed to run
+    epsilon = solve_linear_system(n_iterations * dt, volume_0);
+  } else {
+    double volume = 0.0;
+    int step_counter = 0;
 
-  for (step_counter = 0; step_counter < n_iterations; ++step_counter) {
-    volume = 0.0;
+    IceModelVec::AccessList list{&m_Qsum, &m_W, &m_Vstag, &m_domain_mask, &m_tmp};
+
+    for (step_counter = 0; step_counter < n_iterations; ++step_counter) {
+      volume = 0.0;
+
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        auto v = m_Vstag.star(i, j);
+        auto w = m_W.star(i, j);
+
+        double
+          q_n = v.n * (v.n >= 0.0 ? w.ij : w.n),
+          q_e = v.e * (v.e >= 0.0 ? w.ij : w.e),
+          q_s = v.s * (v.s >= 0.0 ? w.s  : w.ij),
+          q_w = v.w * (v.w >= 0.0 ? w.w  : w.ij),
+          divQ = (q_e - q_w) / m_dx + (q_n - q_s) / m_dy;
+
+        // update water thickness
+        if (m_domain_mask(i, j) > 0.5) {
+          m_tmp(i, j) = w.ij + dt * (- divQ);
+        } else {
+          m_tmp(i, j) = 0.0;
+        }
+
+        if (m_tmp(i, j) < -eps) {
+          throw RuntimeError::formatted(PISM_ERROR_LOCATION, "W(%d, %d) = %f < 0",
+                                        i, j, m_tmp(i, j));
+        }
+
+        // accumulate the water flux
+        m_Qsum(i, j, 0) += dt * q_e;
+        m_Qsum(i, j, 1) += dt * q_n;
+
+        // compute volume
+        volume += m_tmp(i, j);
+      }
+
+      m_W.copy_from(m_tmp);
+      volume = cell_area * GlobalSum(m_grid->com, volume);
+
+      if (volume / volume_0 <= volume_ratio) {
+        break;
+      }
+      m_log->message(3, "%04d V = %f\n", step_counter, volume / volume_0);
+    } // end of the loop
+
+    m_log->message(3, "Emptying problem: stopped after %d iterations. V = %f\n",
+                   step_counter, volume / volume_0);
+
+    epsilon = volume / volume_0;
+  }
+
+  m_Qsum.update_ghosts();
+  staggered_to_regular(geometry.cell_type, m_Qsum,
+                       true,    // include floating ice
+                       m_Q);
+  m_Q.scale(1.0 / (m_tau * (1.0 - epsilon)));
+
+  diagnostics::effective_water_velocity(geometry, m_Q, m_q_sg);
+}
+
+/*!
+ * Solve the emptying problem by solving a linear system for the time-integrated water
+ * thickness.
+ *
+ * Let \f$ S = \int_0^\infty W\, dt \f$. Integrating \f$ W_t + \nabla\cdot(V W) = 0 \f$
+ * in time gives the steady advection problem
+ *
+ * \f[ \nabla\cdot(V S) = W_0, \f]
+ *
+ * and the time-integrated flux is \f$ V S \f$. This replaces thousands of explicit steps
+ * (each with a global reduction) by one linear solve. We use the same first-order upwind
+ * discretization.
+ *
+ * Water trapped in sinks that were not filled (see compute_potential()) never leaves the
+ * domain, which makes this system singular. To regularize it we add the term
+ * \f$ S / T \f$, where \f$ T \f$ is the longest time the time-stepping method is allowed
+ * to run: water stuck in the domain for a time much longer than \f$ T \f$ is removed.
+ *
+ * Fills `m_Qsum` and sets `m_W` to the rate at which water is removed by the
+ * regularization.
+ *
+ * @param[in] T regularization time scale, seconds
+ * @param[in] volume_0 initial water volume
+ *
+ * @return fraction of the initial water volume that did not leave the domain
+ */
+double EmptyingProblem::solve_linear_system(double T, double volume_0) {
+  PetscErrorCode ierr = 0;
+
+  const double cell_area = m_grid->cell_area();
+
+  m_grid->ctx()->profiling().begin("steady_assembly");
+  {
+    assemble_matrix(T, m_Vstag, m_domain_mask, m_A);
+
+    IceModelVec::AccessList list{&m_W, &m_domain_mask, &m_tmp};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_tmp(i, j) = m_domain_mask(i, j) > 0.5 ? m_W(i, j) : 0.0;
+    }
+  }
+  m_grid->ctx()->profiling().end("steady_assembly");
+
+  m_grid->ctx()->profiling().begin("steady_ksp");
+  {
+    ierr = KSPSetOperators(m_KSP, m_A, m_A);
+    PISM_CHK(ierr, "KSPSetOperators");
+
+    ierr = KSPSolve(m_KSP, m_tmp.vec(), m_x.vec());
+    PISM_CHK(ierr, "KSPSolve");
+  }
+  m_grid->ctx()->profiling().end("steady_ksp");
+
+  KSPConvergedReason reason;
+  ierr = KSPGetConvergedReason(m_KSP, &reason);
+  PISM_CHK(ierr, "KSPGetConvergedReason");
+
+  if (reason < 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "KSP iteration failed while solving the emptying problem: %s",
+                                  KSPConvergedReasons[reason]);
+  }
+
+  PetscInt ksp_iterations = 0;
+  ierr = KSPGetIterationNumber(m_KSP, &ksp_iterations);
+  PISM_CHK(ierr, "KSPGetIterationNumber");
+
+  // updates ghosts of m_W
+  m_W.copy_from(m_x);
+
+  double remaining = 0.0;
+  {
+    IceModelVec::AccessList list{&m_Qsum, &m_W, &m_Vstag, &m_domain_mask};
 
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
@@ -257,54 +423,105 @@ void EmptyingProblem::update(const Geometry &geometry,
       auto v = m_Vstag.star(i, j);
       auto w = m_W.star(i, j);
 
-      double
-        q_n = v.n * (v.n >= 0.0 ? w.ij : w.n),
-        q_e = v.e * (v.e >= 0.0 ? w.ij : w.e),
-        q_s = v.s * (v.s >= 0.0 ? w.s  : w.ij),
-        q_w = v.w * (v.w >= 0.0 ? w.w  : w.ij),
-        divQ = (q_e - q_w) / m_dx + (q_n - q_s) / m_dy;
+      m_Qsum(i, j, 0) = v.e * (v.e >= 0.0 ? w.ij : w.e);
+      m_Qsum(i, j, 1) = v.n * (v.n >= 0.0 ? w.ij : w.n);
 
-      // update water thickness
       if (m_domain_mask(i, j) > 0.5) {
-        m_tmp(i, j) = w.ij + dt * (- divQ);
-      } else {
-        m_tmp(i, j) = 0.0;
+        remaining += w.ij / T;
       }
+    }
+  }
+  remaining = cell_area * GlobalSum(m_grid->com, remaining);
 
-      if (m_tmp(i, j) < -eps) {
-        throw RuntimeError::formatted(PISM_ERROR_LOCATION, "W(%d, %d) = %f < 0",
-                                      i, j, m_tmp(i, j));
-      }
+  m_W.scale(1.0 / T);
 
-      // accumulate the water flux
-      m_Qsum(i, j, 0) += dt * q_e;
-      m_Qsum(i, j, 1) += dt * q_n;
+  m_log->message(3, "Emptying problem: solved in %d KSP iterations. V = %f\n",
+                 (int)ksp_iterations, remaining / volume_0);
 
-      // compute volume
-      volume += m_tmp(i, j);
-    }
+  return remaining / volume_0;
+}
+
+/*!
+ * Assemble the matrix corresponding to the upwind discretization of
+ * \f$ S / T + \nabla\cdot(V S) \f$ (see solve_linear_system()).
+ *
+ * Outside the domain we use trivial equations (1 on the diagonal) and zero right hand
+ * side, so that \f$ S = 0 \f$ there, as in the time-stepping method.
+ */
+void EmptyingProblem::assemble_matrix(double T,
+                                      const IceModelVec2Stag &velocity,
+                                      const IceModelVec2Int &domain_mask,
+                                      Mat A) const {
+  PetscErrorCode ierr = 0;
 
-    m_W.copy_from(m_tmp);
-    volume = cell_area * GlobalSum(m_grid->com, volume);
+  const int
+    nrow = 1,
+    ncol = 5;
 
-    if (volume / volume_0 <= volume_ratio) {
-      break;
+  ierr = MatZeroEntries(A); PISM_CHK(ierr, "MatZeroEntries");
+
+  IceModelVec::AccessList list{&velocity, &domain_mask};
+
+  ParallelSection loop(m_grid->com);
+  try {
+    MatStencil row, col[ncol];
+    row.c = 0;
+
+    for (int m = 0; m < ncol; m++) {
+      col[m].c = 0;
     }
-    m_log->message(3, "%04d V = %f\n", step_counter, volume / volume_0);
-  } // end of the loop
 
-  m_log->message(3, "Emptying problem: stopped after %d iterations. V = %f\n",
-                 step_counter, volume / volume_0);
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
 
-  double epsilon = volume / volume_0;
+      /* i indices */
+      const int I[] = {i, i - 1,  i,  i + 1, i};
 
-  m_Qsum.update_ghosts();
-  staggered_to_regular(geometry.cell_type, m_Qsum,
-                       true,    // include floating ice
-                       m_Q);
-  m_Q.scale(1.0 / (m_tau * (1.0 - epsilon)));
+      /* j indices */
+      const int J[] = {j + 1, j,  j,  j, j - 1};
 
-  diagnostics::effective_water_velocity(geometry, m_Q, m_q_sg);
+      row.i = i;
+      row.j = j;
+
+      for (int m = 0; m < ncol; m++) {
+        col[m].i = I[m];
+        col[m].j = J[m];
+      }
+
+      if (domain_mask(i, j) > 0.5) {
+        auto v = velocity.star(i, j);
+
+        double
+          N = std::min(v.n, 0.0) / m_dy,
+          E = std::min(v.e, 0.0) / m_dx,
+          W = - std::max(v.w, 0.0) / m_dx,
+          S = - std::max(v.s, 0.0) / m_dy,
+          C = (1.0 / T +
+               (std::max(v.e, 0.0) - std::min(v.w, 0.0)) / m_dx +
+               (std::max(v.n, 0.0) - std::min(v.s, 0.0)) / m_dy);
+
+        double L[ncol] = {N,
+                          W, C, E,
+                          S};
+
+        ierr = MatSetValuesStencil(A, nrow, &row, ncol, col, L, INSERT_VALUES);
+        PISM_CHK(ierr, "MatSetValuesStencil");
+      } else {
+        double D[ncol] = {0.0,
+                          0.0, 1.0, 0.0,
+                          0.0};
+
+        ierr = MatSetValuesStencil(A, nrow, &row, ncol, col, D, INSERT_VALUES);
+        PISM_CHK(ierr, "MatSetValuesStencil");
+      }
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+
+  ierr = MatAssemblyBegin(A, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyBegin");
+  ierr = MatAssemblyEnd(A, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyEnd");
 }
 
 /*! Compute the unmodified hydraulic potential (with sinks).
@@ -71,6 +71,13 @@ protected:
                     const IceModelVec2Int *no_model_mask,
                     IceModelVec2Int &result) const;
 
+  double solve_linear_system(double T, double volume_0);
+
+  void assemble_matrix(double T,
+                       const IceModelVec2Stag &velocity,
+                       const IceModelVec2Int &domain_mask,
+                       Mat A) const;
+
   IceModelVec2S m_potential;
   IceModelVec2S m_tmp;
   IceModelVec2S m_bottom_surface;
@@ -84,6 +91,12 @@ protected:
   IceModelVec2S m_adjustment;
   IceModelVec2Int m_sinks;
 
+  // used if hydrology.steady.method is "linear_system"
+  bool m_linear_system;
+  petsc::KSP m_KSP;
+  petsc::Mat m_A;
+  IceModelVec2S m_x;
+
   double m_dx;
   double m_dy;
 
@@ -128,12 +128,10 @@ public:
   }
 
 protected:
-  void update_impl(double dt) {
+  const IceModelVec2S& model_input() {
     m_flux_magnitude.set_to_magnitude(model->flux());
 
-    m_accumulator.add(dt, m_flux_magnitude);
-
-    m_interval_length += dt;
+    return m_flux_magnitude;
   }
 
   IceModelVec2S m_flux_magnitude;
@@ -280,7 +278,8 @@ Hydrology::Hydrology(IceGrid::ConstPtr g)
   : Component(g),
     m_Q(m_grid, "water_flux", WITHOUT_GHOSTS),
     m_Wtill(m_grid, "tillwat", WITHOUT_GHOSTS),
-    m_W(m_grid, "bwat", WITH_GHOSTS, 1),
+    // the wider stencil is used by the fused sub-step kernel in Routing
+    m_W(m_grid, "bwat", WITH_GHOSTS, m_config->get_number("grid.max_stencil_width")),
     m_Pover(m_grid, "overburden_pressure", WITHOUT_GHOSTS),
     m_surface_input_rate(m_grid, "water_input_rate_from_surface", WITHOUT_GHOSTS),
     m_basal_melt_rate(m_grid, "water_input_rate_due_to_basal_melt", WITHOUT_GHOSTS),
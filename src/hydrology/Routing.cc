@@ -260,7 +260,7 @@ Routing::Routing(IceGrid::ConstPtr grid)
   : Hydrology(grid),
     m_Qstag(grid, "advection_flux", WITH_GHOSTS, 1),
     m_Qstag_average(grid, "cumulative_advection_flux", WITH_GHOSTS, 1),
-    m_Vstag(grid, "water_velocity", WITHOUT_GHOSTS),
+    m_Vstag(grid, "water_velocity", WITH_GHOSTS, 1),
     m_Wstag(grid, "W_staggered", WITH_GHOSTS, 1),
     m_Kstag(grid, "K_staggered", WITH_GHOSTS, 1),
     m_Wnew(grid, "W_new", WITHOUT_GHOSTS),
@@ -268,7 +268,10 @@ Routing::Routing(IceGrid::ConstPtr grid)
     m_R(grid, "potential_workspace", WITH_GHOSTS, 1), /* box stencil used */
     m_dx(grid->dx()),
     m_dy(grid->dy()),
-    m_bottom_surface(grid, "ice_bottom_surface_elevation", WITH_GHOSTS) {
+    m_bottom_surface(grid, "ice_bottom_surface_elevation", WITH_GHOSTS),
+    m_gradient_factor(grid, "gradient_factor", WITH_GHOSTS, 1),
+    m_potential_gradient(grid, "potential_gradient", WITH_GHOSTS, 1),
+    m_rhs(grid, "routing_rhs", WITHOUT_GHOSTS) {
 
   m_W.metadata().set_string("pism_intent", "model_state");
 
@@ -314,6 +317,46 @@ Routing::Routing(IceGrid::ConstPtr grid)
                        "m", "m", "", 0);
   m_Wtillnew.metadata().set_number("valid_min", 0.0);
 
+  m_gradient_factor.set_attrs("internal",
+                              "regularized |grad(P + rho_w g b)|^(beta - 2) on the staggered grid",
+                              "", "", "", 0);
+
+  m_potential_gradient.set_attrs("internal",
+                                 "minus the gradient of P + rho_w g b on the staggered grid",
+                                 "Pa m-1", "Pa m-1", "", 0);
+
+  m_fused = (m_config->get_flag("hydrology.routing.fused_substeps") and
+             m_W.stencil_width() >= 2);
+
+  m_rhs.set_attrs("internal",
+                  "right hand side of the linear system used by the implicit time stepping method",
+                  "m", "m", "", 0);
+
+  m_implicit = m_config->get_string("hydrology.routing.time_stepping") == "implicit";
+
+  if (m_implicit) {
+    PetscErrorCode ierr;
+
+    ierr = DMSetMatType(*m_W.dm(), MATAIJ);
+    PISM_CHK(ierr, "DMSetMatType");
+
+    ierr = DMCreateMatrix(*m_W.dm(), m_A.rawptr());
+    PISM_CHK(ierr, "DMCreateMatrix");
+
+    ierr = KSPCreate(m_grid->com, m_KSP.rawptr());
+    PISM_CHK(ierr, "KSPCreate");
+
+    ierr = KSPSetOptionsPrefix(m_KSP, "routing_");
+    PISM_CHK(ierr, "KSPSetOptionsPrefix");
+
+    // W from the previous sub-step is a good initial guess
+    ierr = KSPSetInitialGuessNonzero(m_KSP, PETSC_TRUE);
+    PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
+
+    ierr = KSPSetFromOptions(m_KSP);
+    PISM_CHK(ierr, "KSPSetFromOptions");
+  }
+
   {
     double alpha = m_config->get_number("hydrology.thickness_power_in_flux");
     if (alpha < 1.0) {
@@ -342,6 +385,10 @@ void Routing::initialization_message() const {
   } else {
     m_log->message(2, "  ... routing subglacial water under grounded ice only.\n");
   }
+
+  if (m_implicit) {
+    m_log->message(2, "  ... using implicit time stepping.\n");
+  }
 }
 
 void Routing::restart_impl(const File &input_file, int record) {
@@ -451,7 +498,8 @@ void Routing::water_thickness_staggered(const IceModelVec2S &W,
   internally; this is computed on a staggered grid by a Mahaffy-like ([@ref Mahaffy])
   scheme. This requires \f$R\f$ to be defined on a box stencil of width 1.
 
-  Also returns the maximum over all staggered points of \f$ K W \f$.
+  Also returns the maximum of \f$ K W \f$ over staggered points owned by this rank (see
+  max_timestep_W()).
 */
 void Routing::compute_conductivity(const IceModelVec2Stag &W,
                                    const IceModelVec2S &P,
@@ -525,8 +573,6 @@ void Routing::compute_conductivity(const IceModelVec2Stag &W,
     }
   }
 
-  KW_max = GlobalMax(m_grid->com, KW_max);
-
   result.update_ghosts();
 }
 
@@ -685,6 +731,8 @@ void Routing::compute_velocity(const IceModelVec2Stag &W,
 /*!
   The field W must have valid ghost values, but V does not need them.
 
+  Starts updating ghosts of `result`: call `result.end_update_ghosts()` before using them.
+
   FIXME:  This could be re-implemented using the Koren (1993) flux-limiter.
 */
 void Routing::advective_fluxes(const IceModelVec2Stag &V,
@@ -701,7 +749,170 @@ void Routing::advective_fluxes(const IceModelVec2Stag &V,
     result(i, j, 1) = V(i, j, 1) * (V(i, j, 1) >= 0.0 ? W(i, j) :  W(i, j + 1));
   }
 
-  result.update_ghosts();
+  result.begin_update_ghosts();
+}
+
+/*!
+ * Compute parts of the conductivity and the water velocity that do not depend on the
+ * water thickness. These are used by compute_staggered_fields().
+ *
+ * Fills `m_gradient_factor` with \f$ |\nabla R|^{\beta-2} \f$ (see
+ * compute_conductivity()) and `m_potential_gradient` with \f$ -\nabla R \f$ (see
+ * compute_velocity()), with \f$ R = P + \rho_w g b \f$. The latter is set to zero at faces
+ * adjacent to `no_model_mask` cells.
+ *
+ * Both are constant during a call of update_impl(), so this is called once per update
+ * instead of once per hydrology sub-step. Updates ghosts of both.
+ */
+void Routing::compute_potential_factors(const IceModelVec2S &P,
+                                        const IceModelVec2S &bed,
+                                        const IceModelVec2Int *no_model_mask) {
+  const double
+    beta    = m_config->get_number("hydrology.gradient_power_in_flux"),
+    betapow = (beta - 2.0) / 2.0;
+
+  IceModelVec2Stag
+    &B = m_gradient_factor,
+    &G = m_potential_gradient;
+
+  if (beta != 2.0) {
+    // R  <-- P + rhow g b
+    P.add(m_rg, bed, m_R);  // yes, it updates ghosts
+
+    IceModelVec::AccessList list{&m_R, &B};
+
+    // We regularize negative power |\grad psi|^{beta-2} by adding eps because large
+    // head gradient might be 10^7 Pa per 10^4 m or 10^3 Pa/m.
+    const double eps = beta < 2.0 ? 1.0 : 0.0;
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      double dRdx, dRdy, Pi;
+      dRdx = (m_R(i + 1, j) - m_R(i, j)) / m_dx;
+      dRdy = (m_R(i + 1, j + 1) + m_R(i, j + 1) - m_R(i + 1, j - 1) - m_R(i, j - 1)) / (4.0 * m_dy);
+      Pi = dRdx * dRdx + dRdy * dRdy;
+      B(i, j, 0) = pow(Pi + eps * eps, betapow);
+
+      dRdx = (m_R(i + 1, j + 1) + m_R(i + 1, j) - m_R(i - 1, j + 1) - m_R(i - 1, j)) / (4.0 * m_dx);
+      dRdy = (m_R(i, j + 1) - m_R(i, j)) / m_dy;
+      Pi = dRdx * dRdx + dRdy * dRdy;
+      B(i, j, 1) = pow(Pi + eps * eps, betapow);
+    }
+  } else {
+    B.set(1.0);
+  }
+
+  m_R.copy_from(P);  // yes, it updates ghosts
+
+  IceModelVec::AccessList list{&m_R, &bed, &G};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double
+      P_x = (m_R(i + 1, j) - m_R(i, j)) / m_dx,
+      b_x = (bed(i + 1, j) - bed(i, j)) / m_dx;
+    G(i, j, 0) = - (P_x + m_rg * b_x);
+
+    double
+      P_y = (m_R(i, j + 1) - m_R(i, j)) / m_dy,
+      b_y = (bed(i, j + 1) - bed(i, j)) / m_dy;
+    G(i, j, 1) = - (P_y + m_rg * b_y);
+  }
+
+  if (no_model_mask) {
+    list.add(*no_model_mask);
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      auto M = no_model_mask->int_star(i, j);
+
+      if (M.ij or M.e) {
+        G(i, j, 0) = 0.0;
+      }
+
+      if (M.ij or M.n) {
+        G(i, j, 1) = 0.0;
+      }
+    }
+  }
+
+  B.update_ghosts();
+  G.update_ghosts();
+}
+
+/*!
+ * Compute staggered grid values of the water thickness, conductivity, water velocity and
+ * advective flux in one sweep.
+ *
+ * This is equivalent to calling water_thickness_staggered(), compute_conductivity(),
+ * compute_velocity() and advective_fluxes(), but values at faces of the first row of
+ * ghost cells are computed redundantly instead of being communicated. This requires
+ * ghosts of width 2 of `W` and `mask` (and valid ghosts of `m_gradient_factor` and
+ * `m_potential_gradient`, see compute_potential_factors()), but the only halo exchange
+ * left in a hydrology sub-step is the one updating ghosts of `W` at the end of the step.
+ *
+ * Returns maxima of \f$ K W \f$, \f$ |u| \f$ and \f$ |v| \f$ over staggered points
+ * computed by this rank (see max_timestep_W()).
+ */
+void Routing::compute_staggered_fields(const IceModelVec2S &W,
+                                       const IceModelVec2CellType &mask,
+                                       double &KW_max,
+                                       double &u_max,
+                                       double &v_max) {
+  const double
+    k     = m_config->get_number("hydrology.hydraulic_conductivity"),
+    alpha = m_config->get_number("hydrology.thickness_power_in_flux");
+
+  const bool include_floating = m_config->get_flag("hydrology.routing.include_floating_ice");
+
+  assert(W.stencil_width() >= 2);
+  assert(mask.stencil_width() >= 2);
+
+  IceModelVec::AccessList list{&W, &mask, &m_gradient_factor, &m_potential_gradient,
+                               &m_Wstag, &m_Kstag, &m_Vstag, &m_Qstag};
+
+  KW_max = 0.0;
+  double V_max[2] = {0.0, 0.0};
+
+  for (PointsWithGhosts p(*m_grid, 1); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const bool wet = include_floating ? mask.icy(i, j) : mask.grounded_ice(i, j);
+
+    for (int o = 0; o < 2; ++o) {
+      // neighbor across the east (o == 0) or north (o == 1) face
+      const int
+        i1 = o == 0 ? i + 1 : i,
+        j1 = o == 0 ? j : j + 1;
+
+      const bool wet1 = include_floating ? mask.icy(i1, j1) : mask.grounded_ice(i1, j1);
+
+      double Ws = 0.0;
+      if (wet) {
+        Ws = wet1 ? 0.5 * (W(i, j) + W(i1, j1)) : W(i, j);
+      } else {
+        Ws = wet1 ? W(i1, j1) : 0.0;
+      }
+
+      const double
+        K = k * pow(Ws, alpha - 1.0) * m_gradient_factor(i, j, o),
+        V = Ws > 0.0 ? K * m_potential_gradient(i, j, o) : 0.0;
+
+      m_Wstag(i, j, o) = Ws;
+      m_Kstag(i, j, o) = K;
+      m_Vstag(i, j, o) = V;
+      m_Qstag(i, j, o) = V * (V >= 0.0 ? W(i, j) : W(i1, j1));
+
+      KW_max   = std::max(KW_max, K * Ws);
+      V_max[o] = std::max(V_max[o], fabs(V));
+    }
+  }
+
+  u_max = V_max[0];
+  v_max = V_max[1];
 }
 
 /*!
@@ -720,11 +931,53 @@ double Routing::max_timestep_W_cfl() const {
   // V could be zero if P is constant and bed is flat
   std::vector<double> tmp = m_Vstag.absmaxcomponents();
 
+  return max_timestep_W_cfl(tmp[0], tmp[1]);
+}
+
+double Routing::max_timestep_W_cfl(double u_max, double v_max) const {
   // add a safety margin
   double alpha = 0.95;
   double eps = 1e-6;
 
-  return alpha * 0.5 / (tmp[0]/m_dx + tmp[1]/m_dy + eps);
+  return alpha * 0.5 / (u_max/m_dx + v_max/m_dy + eps);
+}
+
+/*!
+ * Compute CFL and diffusivity time step restrictions for the water thickness using one
+ * reduction.
+ *
+ * @param[in] KW_max_local maximum of \f$ K W \f$ in the sub-domain owned by this rank
+ *                         (see compute_conductivity())
+ * @param[out] dt_cfl CFL time step restriction
+ * @param[out] dt_diff diffusivity time step restriction
+ */
+void Routing::max_timestep_W(double KW_max_local, double &dt_cfl, double &dt_diff) const {
+  double u_max = 0.0, v_max = 0.0;
+
+  IceModelVec::AccessList list(m_Vstag);
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    u_max = std::max(u_max, fabs(m_Vstag(i, j, 0)));
+    v_max = std::max(v_max, fabs(m_Vstag(i, j, 1)));
+  }
+
+  max_timestep_W(KW_max_local, u_max, v_max, dt_cfl, dt_diff);
+}
+
+/*!
+ * Same as above, but uses local maxima of velocity components computed elsewhere (see
+ * compute_staggered_fields()).
+ */
+void Routing::max_timestep_W(double KW_max_local, double u_max_local, double v_max_local,
+                             double &dt_cfl, double &dt_diff) const {
+  double local[3] = {KW_max_local, u_max_local, v_max_local};
+
+  double global[3];
+  GlobalMax(m_grid->com, local, global, 3);
+
+  dt_cfl  = max_timestep_W_cfl(global[1], global[2]);
+  dt_diff = max_timestep_W_diff(global[0]);
 }
 
 
@@ -788,26 +1041,55 @@ void Routing::W_change_due_to_flow(double dt,
 
   IceModelVec::AccessList list{&W, &Wstag, &K, &Q, &result};
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  const auto
+    W_view     = W.flat_view(),
+    Wstag_view = Wstag.flat_view(),
+    K_view     = K.flat_view(),
+    Q_view     = Q.flat_view();
+  const auto result_view = result.flat_view();
+
+  // distances between rows
+  const int
+    Q_stride     = Q_view.stride(),
+    K_stride     = K_view.stride(),
+    Wstag_stride = Wstag_view.stride(),
+    W_stride     = W_view.stride();
+
+  for (Points p(*m_grid); p; p.next_row()) {
+    const int
+      i0 = p.i_first(),
+      j  = p.j(),
+      n  = p.i_last() - i0 + 1;
 
-    auto q = Q.star(i, j);
-    const double divQ = (q.e - q.w) / m_dx + (q.n - q.s) / m_dy;
+    const double
+      *Q_row  = Q_view.pointer(i0, j),
+      *K_row  = K_view.pointer(i0, j),
+      *Ws_row = Wstag_view.pointer(i0, j),
+      *W_row  = W_view.pointer(i0, j);
+    double *result_row = result_view.pointer(i0, j);
+
+    for (int m = 0; m < n; ++m) {
+      // staggered values at the east and north faces of the cell m are at offsets 0
+      // and 1, at the west and south faces at -2 and 1 - stride
+      const double
+        *q  = Q_row + 2 * m,
+        *k  = K_row + 2 * m,
+        *Ws = Ws_row + 2 * m,
+        *x  = W_row + m;
 
-    auto k  = K.star(i, j);
-    auto ws = Wstag.star(i, j);
+      const double divQ = (q[0] - q[-2]) / m_dx + (q[1] - q[1 - Q_stride]) / m_dy;
 
-    const double
-      De = m_rg * k.e * ws.e,
-      Dw = m_rg * k.w * ws.w,
-      Dn = m_rg * k.n * ws.n,
-      Ds = m_rg * k.s * ws.s;
+      const double
+        De = m_rg * k[0] * Ws[0],
+        Dw = m_rg * k[-2] * Ws[-2],
+        Dn = m_rg * k[1] * Ws[1],
+        Ds = m_rg * k[1 - K_stride] * Ws[1 - Wstag_stride];
 
-    auto w = W.star(i, j);
-    const double diffW = (wux * (De * (w.e - w.ij) - Dw * (w.ij - w.w)) +
-                          wuy * (Dn * (w.n - w.ij) - Ds * (w.ij - w.s)));
+      const double diffW = (wux * (De * (x[1] - x[0]) - Dw * (x[0] - x[-1])) +
+                            wuy * (Dn * (x[W_stride] - x[0]) - Ds * (x[0] - x[-W_stride])));
 
-    result(i, j) = dt * (- divQ + diffW);
+      result_row[m] = dt * (- divQ + diffW);
+    }
   }
 }
 
@@ -843,14 +1125,194 @@ void Routing::update_W(double dt,
   m_input_change.add(dt, basal_melt_rate);
 }
 
+/*!
+ * Assemble the matrix of the implicit (backward Euler) discretization of the W equation.
+ *
+ * The conductivity `K`, the staggered water thickness `Wstag` and the water velocity `V`
+ * are lagged (taken from the beginning of the sub-step), so the system is linear in
+ * \f$ W^{n+1} \f$:
+ *
+ * \f[ W^{n+1} + \Delta t \left( \nabla\cdot (V W^{n+1}) - \nabla\cdot (D \nabla W^{n+1}) \right) = W^{n} + \Delta t\, r - \Delta W_{till}, \f]
+ *
+ * with \f$ D = \rho_w g K W_{stag} \f$ and first-order upwinding in the advective term.
+ * This is the same spatial discretization as in W_change_due_to_flow(). The matrix is an
+ * M-matrix, so the solution is non-negative if the right hand side is.
+ *
+ * `V` has to have valid ghosts.
+ */
+void Routing::assemble_W_matrix(double dt,
+                                const IceModelVec2Stag &Wstag,
+                                const IceModelVec2Stag &K,
+                                const IceModelVec2Stag &V,
+                                Mat A) {
+  PetscErrorCode ierr = 0;
+
+  const double
+    wux = dt / (m_dx * m_dx),
+    wuy = dt / (m_dy * m_dy),
+    cx  = dt / m_dx,
+    cy  = dt / m_dy;
+
+  const int
+    nrow = 1,
+    ncol = 5;
+
+  ierr = MatZeroEntries(A); PISM_CHK(ierr, "MatZeroEntries");
+
+  IceModelVec::AccessList list{&Wstag, &K, &V};
+
+  ParallelSection loop(m_grid->com);
+  try {
+    MatStencil row, col[ncol];
+    row.c = 0;
+
+    for (int m = 0; m < ncol; m++) {
+      col[m].c = 0;
+    }
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      /* i indices */
+      const int I[] = {i, i - 1,  i,  i + 1, i};
+
+      /* j indices */
+      const int J[] = {j + 1, j,  j,  j, j - 1};
+
+      row.i = i;
+      row.j = j;
+
+      for (int m = 0; m < ncol; m++) {
+        col[m].i = I[m];
+        col[m].j = J[m];
+      }
+
+      auto k  = K.star(i, j);
+      auto ws = Wstag.star(i, j);
+      auto v  = V.star(i, j);
+
+      const double
+        De = m_rg * k.e * ws.e,
+        Dw = m_rg * k.w * ws.w,
+        Dn = m_rg * k.n * ws.n,
+        Ds = m_rg * k.s * ws.s;
+
+      const double
+        N = - wuy * Dn + cy * std::min(v.n, 0.0),
+        E = - wux * De + cx * std::min(v.e, 0.0),
+        W = - wux * Dw - cx * std::max(v.w, 0.0),
+        S = - wuy * Ds - cy * std::max(v.s, 0.0),
+        C = (1.0 +
+             wux * (De + Dw) + cx * (std::max(v.e, 0.0) - std::min(v.w, 0.0)) +
+             wuy * (Dn + Ds) + cy * (std::max(v.n, 0.0) - std::min(v.s, 0.0)));
+
+      double L[ncol] = {N,
+                        W, C, E,
+                        S};
+
+      ierr = MatSetValuesStencil(A, nrow, &row, ncol, col, L, INSERT_VALUES);
+      PISM_CHK(ierr, "MatSetValuesStencil");
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+
+  ierr = MatAssemblyBegin(A, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyBegin");
+  ierr = MatAssemblyEnd(A, MAT_FINAL_ASSEMBLY); PISM_CHK(ierr, "MatAssemblyEnd");
+}
+
+//! The implicit computation of Wnew, called by update() if hydrology.routing.time_stepping is "implicit".
+/*!
+  Unlike update_W(), this method is stable for any time step length, so sub-steps are
+  limited by `hydrology.maximum_time_step` only. Fluxes are computed using conductivity
+  and velocity from the beginning of the sub-step (see assemble_W_matrix()).
+*/
+void Routing::update_W_implicit(double dt,
+                                const IceModelVec2S    &surface_input_rate,
+                                const IceModelVec2S    &basal_melt_rate,
+                                const IceModelVec2S    &W,
+                                const IceModelVec2Stag &Wstag,
+                                const IceModelVec2S    &Wtill,
+                                const IceModelVec2S    &Wtill_new,
+                                const IceModelVec2Stag &K,
+                                const IceModelVec2Stag &V,
+                                IceModelVec2S &W_new) {
+  PetscErrorCode ierr = 0;
+
+  m_grid->ctx()->profiling().begin("routing_assembly");
+  {
+    assemble_W_matrix(dt, Wstag, K, V, m_A);
+
+    IceModelVec::AccessList list{&W, &Wtill, &Wtill_new, &surface_input_rate,
+                                 &basal_melt_rate, &m_rhs};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      double input_rate = surface_input_rate(i, j) + basal_melt_rate(i, j);
+
+      double Wtill_change = Wtill_new(i, j) - Wtill(i, j);
+      m_rhs(i, j) = W(i, j) + (dt * input_rate - Wtill_change);
+    }
+  }
+  m_grid->ctx()->profiling().end("routing_assembly");
+
+  // use W from the previous sub-step as the initial guess
+  W_new.copy_from(W);
+
+  m_grid->ctx()->profiling().begin("routing_ksp");
+  {
+    ierr = KSPSetOperators(m_KSP, m_A, m_A);
+    PISM_CHK(ierr, "KSPSetOperators");
+
+    ierr = KSPSolve(m_KSP, m_rhs.vec(), W_new.vec());
+    PISM_CHK(ierr, "KSPSolve");
+  }
+  m_grid->ctx()->profiling().end("routing_ksp");
+
+  KSPConvergedReason reason;
+  ierr = KSPGetConvergedReason(m_KSP, &reason);
+  PISM_CHK(ierr, "KSPGetConvergedReason");
+
+  if (reason < 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "KSP iteration failed while updating the subglacial water thickness: %s",
+                                  KSPConvergedReasons[reason]);
+  }
+
+  PetscInt ksp_iterations = 0;
+  ierr = KSPGetIterationNumber(m_KSP, &ksp_iterations);
+  PISM_CHK(ierr, "KSPGetIterationNumber");
+
+  m_log->message(3, "  implicit W update: %d KSP iterations\n", (int)ksp_iterations);
+
+  // the change due to flow is the part of the change not explained by inputs and the
+  // change in till water
+  {
+    IceModelVec::AccessList list{&m_rhs, &W_new, &m_flow_change_incremental};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_flow_change_incremental(i, j) = W_new(i, j) - m_rhs(i, j);
+    }
+  }
+
+  m_flow_change.add(1.0, m_flow_change_incremental);
+  m_input_change.add(dt, surface_input_rate);
+  m_input_change.add(dt, basal_melt_rate);
+}
+
 //! Update the model state variables W and Wtill by applying the subglacial hydrology model equations.
 /*!
   Runs the hydrology model from time t to time t + dt.  Here [t, dt]
   is generally on the order of months to years.  This hydrology model will take its
   own shorter time steps, perhaps hours to weeks.
 
-  To update W = `bwat` we call update_W(), and to update Wtill = `tillwat` we
-  call update_Wtill().
+  To update W = `bwat` we call update_W() (or update_W_implicit(), see
+  `hydrology.routing.time_stepping`), and to update Wtill = `tillwat` we call
+  update_Wtill().
 */
 void Routing::update_impl(double t, double dt, const Inputs& inputs) {
 
@@ -869,6 +1331,14 @@ void Routing::update_impl(double t, double dt, const Inputs& inputs) {
   // make sure W has valid ghosts before starting hydrology steps
   m_W.update_ghosts();
 
+  const bool fused = m_fused and inputs.geometry->cell_type.stencil_width() >= 2;
+
+  if (fused) {
+    compute_potential_factors(subglacial_water_pressure(),
+                              m_bottom_surface,
+                              inputs.no_model_mask);
+  }
+
   unsigned int step_counter = 0;
   for (; ht < t_final; ht += hdt) {
     step_counter++;
@@ -880,44 +1350,62 @@ void Routing::update_impl(double t, double dt, const Inputs& inputs) {
     check_bounds(m_Wtill, m_config->get_number("hydrology.tillwat_max"));
 #endif
 
-    // updates ghosts of m_Wstag
-    water_thickness_staggered(m_W,
-                              inputs.geometry->cell_type,
-                              m_Wstag);
-
-    double maxKW = 0.0;
-    // updates ghosts of m_Kstag
-    m_grid->ctx()->profiling().begin("routing_conductivity");
-    compute_conductivity(m_Wstag,
-                         subglacial_water_pressure(),
-                         m_bottom_surface,
-                         m_Kstag, maxKW);
-    m_grid->ctx()->profiling().end("routing_conductivity");
-
-    // ghosts of m_Vstag are not updated
-    m_grid->ctx()->profiling().begin("routing_velocity");
-    compute_velocity(m_Wstag,
-                     subglacial_water_pressure(),
-                     m_bottom_surface,
-                     m_Kstag,
-                     inputs.no_model_mask,
-                     m_Vstag);
-    m_grid->ctx()->profiling().end("routing_velocity");
-
-    // to get Q, W needs valid ghosts (ghosts of m_Vstag are not used)
-    // updates ghosts of m_Qstag
-    m_grid->ctx()->profiling().begin("routing_flux");
-    advective_fluxes(m_Vstag, m_W, m_Qstag);
-    m_grid->ctx()->profiling().end("routing_flux");
+    double maxKW = 0.0, u_max = 0.0, v_max = 0.0;
+    if (fused) {
+      // computes m_Wstag, m_Kstag, m_Vstag and m_Qstag, including their ghosts
+      m_grid->ctx()->profiling().begin("routing_staggered");
+      compute_staggered_fields(m_W, inputs.geometry->cell_type,
+                               maxKW, u_max, v_max);
+      m_grid->ctx()->profiling().end("routing_staggered");
+    } else {
+      // updates ghosts of m_Wstag
+      water_thickness_staggered(m_W,
+                                inputs.geometry->cell_type,
+                                m_Wstag);
+
+      // updates ghosts of m_Kstag
+      m_grid->ctx()->profiling().begin("routing_conductivity");
+      compute_conductivity(m_Wstag,
+                           subglacial_water_pressure(),
+                           m_bottom_surface,
+                           m_Kstag, maxKW);
+      m_grid->ctx()->profiling().end("routing_conductivity");
+
+      // ghosts of m_Vstag are not updated
+      m_grid->ctx()->profiling().begin("routing_velocity");
+      compute_velocity(m_Wstag,
+                       subglacial_water_pressure(),
+                       m_bottom_surface,
+                       m_Kstag,
+                       inputs.no_model_mask,
+                       m_Vstag);
+      m_grid->ctx()->profiling().end("routing_velocity");
+
+      // to get Q, W needs valid ghosts (ghosts of m_Vstag are not used)
+      // starts updating ghosts of m_Qstag
+      m_grid->ctx()->profiling().begin("routing_flux");
+      advective_fluxes(m_Vstag, m_W, m_Qstag);
+      m_grid->ctx()->profiling().end("routing_flux");
+    }
 
-    m_Qstag_average.add(hdt, m_Qstag);
+    // length of the previous step (used to update m_Qstag_average below)
+    const double hdt_previous = hdt;
 
-    {
-      const double
-        dt_cfl    = max_timestep_W_cfl(),
-        dt_diff_w = max_timestep_W_diff(maxKW);
+    hdt = std::min(t_final - ht, dt_max);
+    if (m_implicit) {
+      // the implicit method does not need CFL and diffusivity restrictions, but it does
+      // need ghosts of the velocity
+      if (not fused) {
+        m_Vstag.update_ghosts();
+      }
+    } else {
+      double dt_cfl = 0.0, dt_diff_w = 0.0;
+      if (fused) {
+        max_timestep_W(maxKW, u_max, v_max, dt_cfl, dt_diff_w);
+      } else {
+        max_timestep_W(maxKW, dt_cfl, dt_diff_w);
+      }
 
-      hdt = std::min(t_final - ht, dt_max);
       hdt = std::min(hdt, dt_cfl);
       hdt = std::min(hdt, dt_diff_w);
     }
@@ -944,17 +1432,35 @@ void Routing::update_impl(double t, double dt, const Inputs& inputs) {
       m_grid->ctx()->profiling().end("routing_Wtill");
     }
 
+    if (not fused) {
+      // ghosts of m_Qstag are communicated while the time step length and Wtillnew are
+      // computed
+      m_Qstag.end_update_ghosts();
+    }
+
+    m_Qstag_average.add(hdt_previous, m_Qstag);
+
     // update Wnew from W, Wtill, Wtillnew, Wstag, Q, input_rate
     // uses ghosts of m_W, m_Wstag, m_Qstag, m_Kstag
     {
       m_grid->ctx()->profiling().begin("routing_W");
-      update_W(hdt,
-               m_surface_input_rate,
-               m_basal_melt_rate,
-               m_W, m_Wstag,
-               m_Wtill, m_Wtillnew,
-               m_Kstag, m_Qstag,
-               m_Wnew);
+      if (m_implicit) {
+        update_W_implicit(hdt,
+                          m_surface_input_rate,
+                          m_basal_melt_rate,
+                          m_W, m_Wstag,
+                          m_Wtill, m_Wtillnew,
+                          m_Kstag, m_Vstag,
+                          m_Wnew);
+      } else {
+        update_W(hdt,
+                 m_surface_input_rate,
+                 m_basal_melt_rate,
+                 m_W, m_Wstag,
+                 m_Wtill, m_Wtillnew,
+                 m_Kstag, m_Qstag,
+                 m_Wnew);
+      }
       // remove water in ice-free areas and account for changes
       enforce_bounds(inputs.geometry->cell_type,
                      inputs.no_model_mask,
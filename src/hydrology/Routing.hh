@@ -20,6 +20,8 @@
 #define _ROUTING_H_
 
 #include "Hydrology.hh"
+#include "pism/util/petscwrappers/KSP.hh"
+#include "pism/util/petscwrappers/Mat.hh"
 
 namespace pism {
 
@@ -107,6 +109,10 @@ protected:
 
   double max_timestep_W_diff(double KW_max) const;
   double max_timestep_W_cfl() const;
+  double max_timestep_W_cfl(double u_max, double v_max) const;
+  void max_timestep_W(double KW_max_local, double &dt_cfl, double &dt_diff) const;
+  void max_timestep_W(double KW_max_local, double u_max_local, double v_max_local,
+                      double &dt_cfl, double &dt_diff) const;
 protected:
 
   // edge-centered (staggered) advection flux
@@ -114,7 +120,7 @@ protected:
 
   IceModelVec2Stag m_Qstag_average;
 
-  // edge-centered (staggered) water velocity
+  // edge-centered (staggered) water velocity (ghosts are used by the implicit solver)
   IceModelVec2Stag m_Vstag;
 
   // edge-centered (staggered) W values (averaged from regular)
@@ -134,6 +140,17 @@ protected:
 
   IceModelVec2S m_bottom_surface;
 
+  // parts of K and V that do not depend on W (see compute_potential_factors())
+  IceModelVec2Stag m_gradient_factor;
+  IceModelVec2Stag m_potential_gradient;
+  bool m_fused;
+
+  // implicit time stepping (see hydrology.routing.time_stepping)
+  bool m_implicit;
+  petsc::KSP m_KSP;
+  petsc::Mat m_A;
+  IceModelVec2S m_rhs;
+
   void water_thickness_staggered(const IceModelVec2S &W,
                                  const IceModelVec2CellType &mask,
                                  IceModelVec2Stag &result);
@@ -155,6 +172,16 @@ protected:
                         const IceModelVec2S &W,
                         IceModelVec2Stag &result) const;
 
+  void compute_potential_factors(const IceModelVec2S &P,
+                                 const IceModelVec2S &bed,
+                                 const IceModelVec2Int *no_model_mask);
+
+  void compute_staggered_fields(const IceModelVec2S &W,
+                                const IceModelVec2CellType &mask,
+                                double &KW_max,
+                                double &u_max,
+                                double &v_max);
+
   void W_change_due_to_flow(double dt,
                             const IceModelVec2S    &W,
                             const IceModelVec2Stag &Wstag,
@@ -172,6 +199,23 @@ protected:
                 const IceModelVec2Stag &Q,
                 IceModelVec2S &W_new);
 
+  void update_W_implicit(double dt,
+                         const IceModelVec2S    &surface_input_rate,
+                         const IceModelVec2S    &basal_melt_rate,
+                         const IceModelVec2S    &W,
+                         const IceModelVec2Stag &Wstag,
+                         const IceModelVec2S    &Wtill,
+                         const IceModelVec2S    &Wtill_new,
+                         const IceModelVec2Stag &K,
+                         const IceModelVec2Stag &V,
+                         IceModelVec2S &W_new);
+
+  void assemble_W_matrix(double dt,
+                         const IceModelVec2Stag &Wstag,
+                         const IceModelVec2Stag &K,
+                         const IceModelVec2Stag &V,
+                         Mat A);
+
   void update_Wtill(double dt,
                     const IceModelVec2S &Wtill,
                     const IceModelVec2S &surface_input_rate,
@@ -0,0 +1,53 @@
+#include <pism/util/IceGrid.hh>
+#include <pism/util/error_handling.hh>
+#include <pism/icebin/CouplingArrays.hh>
+
+namespace pism {
+namespace icebin {
+
+CouplingArrays::CouplingArrays(const std::vector<pism::IceModelVec2S *> &fields)
+  : m_fields(fields) {
+
+  for (auto *field : m_fields) {
+    if (field->stencil_width() > 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "cannot exchange %s: it has ghosts",
+                                    field->get_name().c_str());
+    }
+  }
+
+  for (auto *field : m_fields) {
+    m_arrays.emplace_back(new petsc::VecArray(field->vec()));
+  }
+}
+
+CouplingArrays::~CouplingArrays() {
+  // the coupler may have modified these fields
+  for (auto *field : m_fields) {
+    field->inc_state_counter();
+  }
+}
+
+size_t CouplingArrays::size() const {
+  return m_fields.size();
+}
+
+size_t CouplingArrays::local_size() const {
+  if (m_fields.empty()) {
+    return 0;
+  }
+
+  IceGrid::ConstPtr grid = m_fields[0]->grid();
+  return static_cast<size_t>(grid->xm()) * grid->ym();
+}
+
+std::string const &CouplingArrays::name(size_t k) const {
+  return m_fields.at(k)->get_name();
+}
+
+double *CouplingArrays::data(size_t k) {
+  return m_arrays.at(k)->get();
+}
+
+} // end of namespace icebin
+} // end of namespace pism
@@ -0,0 +1,47 @@
+#pragma once
+
+// --------------------------------
+// PISM Includes... want to be included first
+#include <petsc.h>
+#include <pism/util/iceModelVec.hh>
+// --------------------------------
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pism/util/petscwrappers/Vec.hh>
+
+namespace pism {
+namespace icebin {
+
+/** Gives a coupler direct access to local parts of a set of 2D fields, without copying.
+
+Each array contains values at grid points owned by this rank (grid->xm() * grid->ym()
+values, the i index changes fastest), so it can be passed to the coupler as is. All
+fields have to be allocated without ghosts.
+
+Arrays are valid while this object exists. The destructor returns them to PETSc and
+marks all fields as modified.
+*/
+class CouplingArrays {
+public:
+  CouplingArrays(const std::vector<pism::IceModelVec2S *> &fields);
+  ~CouplingArrays();
+
+  /** Number of fields. */
+  size_t size() const;
+
+  /** Number of values in each array. */
+  size_t local_size() const;
+
+  std::string const &name(size_t k) const;
+  double *data(size_t k);
+
+private:
+  std::vector<pism::IceModelVec2S *> m_fields;
+  std::vector<std::unique_ptr<petsc::VecArray> > m_arrays;
+};
+
+} // end of namespace icebin
+} // end of namespace pism
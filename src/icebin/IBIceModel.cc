@@ -5,6 +5,7 @@
 #include <pism/util/io/File.hh>
 #include <pism/util/io/io_helpers.hh>
 #include "pism/energy/EnergyModel.hh"
+#include "pism/geometry/GeometryEvolution.hh"
 
 #include "pism/icebin/IBIceModel.hh"
 #include "pism/icebin/IBSurfaceModel.hh"
@@ -83,10 +84,10 @@ void IBIceModel::allocate_storage() {
 
   M1.create(m_grid, "M1", pism::WITHOUT_GHOSTS);
   M2.create(m_grid, "M2", pism::WITHOUT_GHOSTS);
-  M1.create(m_grid, "H1", pism::WITHOUT_GHOSTS);
-  M2.create(m_grid, "H2", pism::WITHOUT_GHOSTS);
-  M1.create(m_grid, "V1", pism::WITHOUT_GHOSTS);
-  M2.create(m_grid, "V2", pism::WITHOUT_GHOSTS);
+  H1.create(m_grid, "H1", pism::WITHOUT_GHOSTS);
+  H2.create(m_grid, "H2", pism::WITHOUT_GHOSTS);
+  V1.create(m_grid, "V1", pism::WITHOUT_GHOSTS);
+  V2.create(m_grid, "V2", pism::WITHOUT_GHOSTS);
 
   std::cout << "IBIceModel Conservation Formulas:" << std::endl;
   cur.print_formulas(std::cout);
@@ -137,104 +138,84 @@ void IBIceModel::energy_step() {
   printf("END IBIceModel::energy_step(time=%f)\n", t_TempAge);
 }
 
-void IBIceModel::massContExplicitStep(double dt,
-                                      const IceModelVec2Stag &diffusive_flux,
-                                      const IceModelVec2V &advective_velocity) {
-
-  printf("BEGIN IBIceModel::MassContExplicitStep()\n");
-
-  _ice_density              = m_config->get_number("constants.ice.density");
-  _meter_per_s_to_kg_per_m2 = dt * _ice_density;
-
-
-  // =========== The Mass Continuity Step Itself
-  // This will call through to accumulateFluxes_massContExplicitStep()
-  // in the inner loop
-  {
-    AccessList access{ &cur.pism_smb,           &cur.melt_grounded, &cur.melt_floating,
-                       &cur.internal_advection, &cur.href_to_h,     &cur.nonneg_rule };
-
-    // FIXME: this is obviously broken now that PISM uses GeometryEvolution instead.
-    (void) diffusive_flux;
-    (void) advective_velocity;
-    // super::massContExplicitStep(dt, diffusive_flux, advective_velocity);
+void IBIceModel::post_step_hook() {
+  if (m_config->get_flag("geometry.update.enabled")) {
+    accumulate_fluxes(m_dt);
   }
-
-  // =========== AFTER the Mass Continuity Step
-
-  // ----------- SMB: Pass inputs through to outputs.
-  // They are needed to participate in mass/energy budget
-  IBSurfaceModel *ib_surface = ib_surface_model();
-
-
-  {
-    AccessList access{ &ib_surface->icebin_massxfer, &ib_surface->icebin_enthxfer, &ib_surface->icebin_deltah,
-                       &cur.icebin_xfer, &cur.icebin_deltah };
-
-    for (int i = m_grid->xs(); i < m_grid->xs() + m_grid->xm(); ++i) {
-      for (int j = m_grid->ys(); j < m_grid->ys() + m_grid->ym(); ++j) {
-        cur.icebin_xfer.mass(i, j) += m_dt * ib_surface->icebin_massxfer(i, j);
-        cur.icebin_xfer.enth(i, j) += m_dt * ib_surface->icebin_enthxfer(i, j);
-        cur.icebin_deltah(i, j) += m_dt * ib_surface->icebin_deltah(i, j);
-      }
-    }
-  }
-
-  printf("END IBIceModel::MassContExplicitStep()\n");
 }
 
+/** Called after each mass continuity step. Records the same mass fluxes PISM used to
+update ice geometry (see GeometryEvolution), together with the enthalpy they carry, and
+accumulates inputs from IceBin.
 
-/** This is called IMMEDIATELY after ice is gained/lost in
-iMgeometry.cc (massContExplicitStep()).  Here we can record the same
-values that PISM saw when moving ice around. */
-void IBIceModel::accumulateFluxes_massContExplicitStep(int i, int j,
-                                                       double surface_mass_balance, // [m s-1] ice equivalent
-                                                       double meltrate_grounded,    // [m s-1] ice equivalent
-                                                       double meltrate_floating,    // [m s-1] ice equivalent
-                                                       double divQ_SIA,             // [m s-1] ice equivalent
-                                                       double divQ_SSA,             // [m s-1] ice equivalent
-                                                       double Href_to_H_flux,       // [m] ice equivalent
-                                                       double nonneg_rule_flux)     // [m] ice equivalent
-{
+All fluxes are handled in one pass over the grid. */
+void IBIceModel::accumulate_fluxes(double dt) {
   EnthalpyConverter::Ptr EC = ctx()->enthalpy_converter();
 
-  // -------------- Melting
-  double p_basal             = EC->pressure(m_geometry.ice_thickness(i, j));
-  double T                   = EC->melting_temperature(p_basal);
-  double specific_enth_basal = EC->enthalpy_permissive(T, 1.0, p_basal);
-  double mass;
-
-  // ------- Melting at base of ice sheet
-  mass = -meltrate_grounded * _meter_per_s_to_kg_per_m2;
-  cur.melt_grounded.mass(i, j) += mass;
-  cur.melt_grounded.enth(i, j) += mass * specific_enth_basal;
-
-  // ------- Melting under ice shelf
-  mass = -meltrate_floating * _meter_per_s_to_kg_per_m2;
-  cur.melt_floating.mass(i, j) += mass;
-  cur.melt_floating.enth(i, j) += mass * specific_enth_basal;
+  const double ice_density = m_config->get_number("constants.ice.density");
 
+  const IceModelVec2S
+    &smb             = m_geometry_evolution->top_surface_mass_balance(),    // [m]
+    &bmb             = m_geometry_evolution->bottom_surface_mass_balance(), // [m]
+    &flux_divergence = m_geometry_evolution->flux_divergence(),             // [m s-1]
+    &nonneg_rule     = m_geometry_evolution->conservation_error();          // [m]
 
-  // -------------- internal_advection
-  const int ks             = m_grid->kBelowHeight(m_geometry.ice_thickness(i, j));
-  // Approximate, we will use the enthalpy of the top layer...
-  double specific_enth_top = m_energy_model->enthalpy().get_column(i, j)[ks];
-
-  mass = -(divQ_SIA + divQ_SSA) * _meter_per_s_to_kg_per_m2;
-
-  cur.internal_advection.mass(i, j) += mass;
-  cur.internal_advection.enth(i, j) += mass * specific_enth_top;
-
+  const IceModelVec2S &H = m_geometry.ice_thickness;
+  const IceModelVec2CellType &cell_type = m_geometry.cell_type;
+  const IceModelVec3 &ice_enthalpy = m_energy_model->enthalpy();
 
-  // -------------- Get the easy veriables out of the way...
-  mass = surface_mass_balance * _meter_per_s_to_kg_per_m2;
-  cur.pism_smb.mass(i, j) += mass;
-  cur.pism_smb.enth(i, j) += mass * specific_enth_top;
-  cur.nonneg_rule(i, j) -= nonneg_rule_flux * _ice_density;
-  cur.href_to_h(i, j) += Href_to_H_flux * _ice_density;
+  IBSurfaceModel *ib_surface = ib_surface_model();
 
+  AccessList access{ &smb, &bmb, &flux_divergence, &nonneg_rule, &H, &cell_type,
+                     &ice_enthalpy,
+                     &ib_surface->icebin_massxfer, &ib_surface->icebin_enthxfer,
+                     &ib_surface->icebin_deltah,
+                     &cur.pism_smb, &cur.melt_grounded, &cur.melt_floating,
+                     &cur.internal_advection, &cur.nonneg_rule,
+                     &cur.icebin_xfer, &cur.icebin_deltah };
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    // -------------- Melting
+    const double
+      p_basal             = EC->pressure(H(i, j)),
+      T                   = EC->melting_temperature(p_basal),
+      specific_enth_basal = EC->enthalpy_permissive(T, 1.0, p_basal);
+
+    // Approximate: we use the enthalpy of the top layer
+    const int ks = m_grid->kBelowHeight(H(i, j));
+    const double specific_enth_top = ice_enthalpy.get_column(i, j)[ks];
+
+    // basal mass balance is negative where ice melts
+    const double melt = bmb(i, j) * ice_density; // [kg m-2]
+    MassEnthVec2S &melt_budget = cell_type.floating_ice(i, j) ? cur.melt_floating : cur.melt_grounded;
+    melt_budget.mass(i, j) += melt;
+    melt_budget.enth(i, j) += melt * specific_enth_basal;
+
+    // -------------- Internal advection
+    const double advected = -flux_divergence(i, j) * dt * ice_density;
+    cur.internal_advection.mass(i, j) += advected;
+    cur.internal_advection.enth(i, j) += advected * specific_enth_top;
+
+    // -------------- SMB as seen by PISM
+    const double smb_mass = smb(i, j) * ice_density;
+    cur.pism_smb.mass(i, j) += smb_mass;
+    cur.pism_smb.enth(i, j) += smb_mass * specific_enth_top;
+
+    // ice added to keep ice thickness non-negative
+    cur.nonneg_rule(i, j) += nonneg_rule(i, j) * ice_density;
+
+    // -------------- Inputs from IceBin: pass them through to outputs so that they
+    // participate in the mass/energy budget
+    cur.icebin_xfer.mass(i, j) += dt * ib_surface->icebin_massxfer(i, j);
+    cur.icebin_xfer.enth(i, j) += dt * ib_surface->icebin_enthxfer(i, j);
+    cur.icebin_deltah(i, j)    += dt * ib_surface->icebin_deltah(i, j);
+  }
+}
 
-  //  printf("END IBIceModel::accumulateFluxes_MassContExplicitStep()\n");
+std::vector<IceModelVec2S *> IBIceModel::coupling_outputs() {
+  return { &M1, &M2, &H1, &H2, &V1, &V2 };
 }
 
 
@@ -246,7 +227,8 @@ void IBIceModel::prepare_nc(std::string const &fname, std::unique_ptr<File> &nc)
                     fname,
                     string_to_backend(m_config->get_string("output.format")),
                     PISM_READWRITE_MOVE,
-                    m_grid->ctx()->pio_iosys_id()));
+                    m_grid->ctx()->pio_iosys_id(),
+                    m_grid->ctx()->netcdf3_n_aggregators()));
 
   io::define_time(*nc, m_grid->ctx()->config()->get_string("time.dimension_name"), m_grid->ctx()->time()->calendar(),
                   m_grid->ctx()->time()->CF_units_string(), m_grid->ctx()->unit_system());
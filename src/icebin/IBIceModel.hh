@@ -71,23 +71,11 @@ protected:
   // see iceModel.cc
   virtual void allocate_storage();
 
-public:
-  virtual void massContExplicitStep(double dt,
-                                    const IceModelVec2Stag &diffusive_flux,
-                                    const IceModelVec2V &advective_velocity);
-  virtual void accumulateFluxes_massContExplicitStep(int i, int j,
-                                                     double surface_mass_balance, // [m s-1] ice equivalent (from PISM)
-                                                     double meltrate_grounded,    // [m s-1] ice equivalent
-                                                     double meltrate_floating,    // [m s-1] ice equivalent
-                                                     double divQ_SIA,             // [m s-1] ice equivalent
-                                                     double divQ_SSA,             // [m s-1] ice equivalent
-                                                     double Href_to_H_flux,       // [m s-1] ice equivalent
-                                                     double nonneg_rule_flux);    // [m s-1] ice equivalent
-private:
-  // Temporary variables inside massContExplicitStep()
-  double _ice_density;              // From config
-  double _meter_per_s_to_kg_per_m2; // Conversion factor computed from _ice_density
+protected:
+  void post_step_hook();
 
+  /** Adds mass and enthalpy fluxes of the last mass continuity step to `cur`. */
+  void accumulate_fluxes(double dt);
 
 private:
   // Utility function
@@ -117,6 +105,10 @@ public:
 
   void compute_enth2(pism::IceModelVec2S &enth2, pism::IceModelVec2S &mass2);
 
+  /** Fields returned to the GCM (see prepare_outputs()). Use CouplingArrays to access
+    all of them at once. */
+  std::vector<pism::IceModelVec2S *> coupling_outputs();
+
   /** @return Our instance of IBSurfaceModel */
   pism::icebin::IBSurfaceModel *ib_surface_model() {
     return dynamic_cast<IBSurfaceModel *>(m_surface.get());
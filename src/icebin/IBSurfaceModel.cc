@@ -64,6 +64,10 @@ IBSurfaceModel::IBSurfaceModel(IceGrid::ConstPtr g)
   printf("END IBSurfaceModel::allocate_IBSurfaceModel()\n");
 }
 
+std::vector<IceModelVec2S*> IBSurfaceModel::coupling_inputs() {
+  return {&icebin_wflux, &icebin_deltah, &icebin_massxfer, &icebin_enthxfer};
+}
+
 void IBSurfaceModel::init_impl(const Geometry &geometry) {
   (void) geometry;
 
@@ -37,6 +37,9 @@ class IBSurfaceModel : public pism::surface::SurfaceModel {
 public:
   IBSurfaceModel(IceGrid::ConstPtr grid);
 
+  //! Fields set by IceBin. Use CouplingArrays to access all of them at once.
+  std::vector<IceModelVec2S*> coupling_inputs();
+
 protected:
   virtual void init_impl(const Geometry &geometry);
   virtual void update_impl(const Geometry &geometry, double t, double dt);
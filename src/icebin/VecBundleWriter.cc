@@ -16,37 +16,52 @@ VecBundleWriter::VecBundleWriter(pism::IceGrid::Ptr _grid, std::string const &_f
     : m_grid(_grid), fname(_fname), vecs(_vecs) {
 }
 
+bool VecBundleWriter::enabled() const {
+  return not fname.empty();
+}
+
 void VecBundleWriter::init() {
-  pism::File file(m_grid->com,
-                  fname,
-                  string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
-                  PISM_READWRITE_MOVE,
-                  m_grid->ctx()->pio_iosys_id());
+  if (not enabled()) {
+    return;
+  }
+
+  m_file.reset(new pism::File(m_grid->com,
+                              fname,
+                              string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
+                              PISM_READWRITE_MOVE,
+                              m_grid->ctx()->pio_iosys_id(),
+                              m_grid->ctx()->netcdf3_n_aggregators()));
 
-  io::define_time(file,
+  io::define_time(*m_file,
                   m_grid->ctx()->config()->get_string("time.dimension_name"),
                   m_grid->ctx()->time()->calendar(),
                   m_grid->ctx()->time()->CF_units_string(),
                   m_grid->ctx()->unit_system());
 
   for (pism::IceModelVec const *vec : vecs) {
-    vec->define(file, PISM_DOUBLE);
+    vec->define(*m_file, PISM_DOUBLE);
   }
 }
 
 /** Dump the value of the Vectors at curent PISM simulation time. */
 void VecBundleWriter::write(double time_s) {
-  pism::File file(m_grid->com,
-                  fname,
-                  string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
-                  PISM_READWRITE, // append to file
-                  m_grid->ctx()->pio_iosys_id());
+  if (not enabled()) {
+    return;
+  }
+
+  if (not m_file) {
+    init();
+  }
 
-  io::append_time(file, m_grid->ctx()->config()->get_string("time.dimension_name"), time_s);
+  io::append_time(*m_file, m_grid->ctx()->config()->get_string("time.dimension_name"), time_s);
 
   for (pism::IceModelVec const *vec : vecs) {
-    vec->write(file);
+    vec->write(*m_file);
   }
+
+  // make sure the time dimension is up to date; asynchronous backends keep writing
+  // large variables in the background
+  m_file->sync();
 }
 
 } // end of namespace icebin
@@ -7,22 +7,33 @@
 #include <pism/util/IceGrid.hh>
 // --------------------------------
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <pism/util/io/File.hh>
+
 namespace pism {
 namespace icebin {
 
 
-/** Sets up to easily write out a bundle of PISM variables to a file. */
+/** Sets up to easily write out a bundle of PISM variables to a file.
+
+Writing is optional: a writer with an empty file name does nothing. The file stays open
+between write() calls, so asynchronous backends (`-o_format netcdf3_async`) can write
+while the model keeps running. */
 class VecBundleWriter {
   pism::IceGrid::ConstPtr m_grid;
   std::string const fname;                     // Name of the file to write
   std::vector<pism::IceModelVec const *> vecs; // The vectors we will write
+  std::unique_ptr<pism::File> m_file;
 
 public:
   VecBundleWriter(pism::IceGrid::Ptr grid, std::string const &_fname, std::vector<pism::IceModelVec const *> &_vecs);
 
+  /** @return false if this writer is disabled (empty file name). */
+  bool enabled() const;
+
   void init();
 
   /** Dump the value of the Vectors at curent PISM simulation time. */
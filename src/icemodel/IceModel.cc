@@ -36,6 +36,7 @@
 #include "pism/energy/BedThermalUnit.hh"
 #include "pism/hydrology/Hydrology.hh"
 #include "pism/stressbalance/StressBalance.hh"
+#include "pism/stressbalance/sia/SIAFD.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Mask.hh"
 #include "pism/util/ConfigInterface.hh"
@@ -50,11 +51,15 @@
 #include "pism/util/pism_signal.h"
 #include "pism/util/Vars.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/TaskGraph.hh"
+#include "pism/util/MemoryUsage.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/age/AgeModel.hh"
 #include "pism/energy/EnergyModel.hh"
 #include "pism/util/io/File.hh"
 #include "pism/util/iceModelVec2T.hh"
+#include "pism/util/IceModelVecExpressions.hh"
+#include "pism/util/Decimation.hh"
 #include "pism/fracturedensity/FractureDensity.hh"
 #include "pism/coupler/util/options.hh" // ForcingOptions
 
@@ -91,6 +96,7 @@ IceModel::IceModel(IceGrid::Ptr g, Context::Ptr context)
   signal(SIGTERM, pism_signal_handler);
   signal(SIGUSR1, pism_signal_handler);
   signal(SIGUSR2, pism_signal_handler);
+  m_preempted = false;
 
   m_surface = nullptr;
   m_ocean   = nullptr;
@@ -290,8 +296,23 @@ void IceModel::allocate_storage() {
 */
 void IceModel::enforce_consistency_of_geometry(ConsistencyFlag flag) {
 
-  m_geometry.bed_elevation.copy_from(m_beddef->bed_elevation());
-  m_geometry.sea_level_elevation.copy_from(m_sea_level->elevation());
+  // copy bed elevation and sea level only if they changed: this allows
+  // Geometry::ensure_consistency() to skip re-computing cell type and surface elevation
+  {
+    const DependencyTracker::Inputs
+      bed{&m_beddef->bed_elevation(), &m_geometry.bed_elevation},
+      sea_level{&m_sea_level->elevation(), &m_geometry.sea_level_elevation};
+
+    if (m_bed_elevation_copy.changed(bed)) {
+      m_geometry.bed_elevation.copy_from(m_beddef->bed_elevation());
+      m_bed_elevation_copy.record(bed);
+    }
+
+    if (m_sea_level_copy.changed(sea_level)) {
+      m_geometry.sea_level_elevation.copy_from(m_sea_level->elevation());
+      m_sea_level_copy.record(sea_level);
+    }
+  }
 
   if (m_iceberg_remover and flag == REMOVE_ICEBERGS) {
     // The iceberg remover has to use the same mask as the stress balance code, hence the
@@ -311,17 +332,7 @@ void IceModel::enforce_consistency_of_geometry(ConsistencyFlag flag) {
 
   if (flag == REMOVE_ICEBERGS) {
     // clean up partially-filled cells that are not next to ice
-    IceModelVec::AccessList list{&m_geometry.ice_area_specific_volume,
-                                 &m_geometry.cell_type};
-
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      if (m_geometry.ice_area_specific_volume(i, j) > 0.0 and
-          not m_geometry.cell_type.next_to_ice(i, j)) {
-        m_geometry.ice_area_specific_volume(i, j) = 0.0;
-      }
-    }
+    m_geometry.remove_isolated_partially_filled_cells();
   }
 }
 
@@ -335,6 +346,12 @@ stressbalance::Inputs IceModel::stress_balance_inputs() {
   result.melange_back_pressure = &m_ocean->melange_back_pressure_fraction();
   result.geometry              = &m_geometry;
   result.new_bed_elevation     = m_new_bed_elevation;
+  // the stress balance uses ghosts of enthalpy and age
+  m_energy_model->update_ghosts(m_geometry.ice_thickness);
+  if (m_age_model) {
+    m_age_model->update_ghosts(m_geometry.ice_thickness);
+  }
+
   result.enthalpy              = &m_energy_model->enthalpy();
   result.age                   = m_age_model ? &m_age_model->age() : nullptr;
 
@@ -422,7 +439,7 @@ void IceModel::step(bool do_mass_continuity,
   try {
     profiling.begin("stress_balance");
     m_stress_balance->update(stress_balance_inputs(), updateAtDepth);
-    profiling.end("stress_balance");
+    profiling.end("stress_balance", m_grid->com);
   } catch (RuntimeError &e) {
     std::string output_file = m_config->get_string("output.file_name");
 
@@ -436,7 +453,8 @@ void IceModel::step(bool do_mass_continuity,
     File file(m_grid->com, o_file,
               string_to_backend(m_config->get_string("output.format")),
               PISM_READWRITE_MOVE,
-              m_ctx->pio_iosys_id());
+              m_ctx->pio_iosys_id(),
+              m_ctx->netcdf3_n_aggregators());
 
     update_run_stats();
     write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
@@ -457,184 +475,258 @@ void IceModel::step(bool do_mass_continuity,
   //! \li determine the time step according to a variety of stability criteria
   max_timestep(m_dt, m_skip_countdown);
 
-  //! \li update the yield stress for the plastic till model (if appropriate)
-  if (m_basal_yield_stress_model) {
-    profiling.begin("basal_yield_stress");
-    m_basal_yield_stress_model->update(yield_stress_inputs(), current_time, m_dt);
-    profiling.end("basal_yield_stress");
-    m_basal_yield_stress.copy_from(m_basal_yield_stress_model->basal_material_yield_stress());
-    m_stdout_flags += "y";
-  } else {
-    m_stdout_flags += "$";
-  }
-
   dt_TempAge += m_dt;
 
+  // FIXME: thickness B.C. mask should be separate
+  IceModelVec2Int &thickness_bc_mask = m_ssa_dirichlet_bc_mask;
+
+  // The rest of the step is a list of tasks with declared inputs and outputs. TaskGraph
+  // groups them into stages of tasks that do not depend on each other (printed with
+  // -verbose 4). All tasks are run sequentially, in the order they are added here: they
+  // use collective operations on the grid communicator, so stages only document data
+  // dependencies.
+  TaskGraph tasks;
+
+  //! \li update the yield stress for the plastic till model (if appropriate)
+  tasks.add("basal_yield_stress", {"geometry", "hydrology"}, {"yield_stress"},
+            [&]() {
+              if (m_basal_yield_stress_model) {
+                profiling.begin("basal_yield_stress");
+                m_basal_yield_stress_model->update(yield_stress_inputs(), current_time, m_dt);
+                profiling.end("basal_yield_stress", m_grid->com);
+                m_basal_yield_stress.copy_from(m_basal_yield_stress_model->basal_material_yield_stress());
+                m_stdout_flags += "y";
+              } else {
+                m_stdout_flags += "$";
+              }
+            });
+
   //! \li update the age of the ice (if appropriate)
-  if (m_age_model and updateAtDepth) {
-    AgeModelInputs inputs;
-    inputs.ice_thickness = &m_geometry.ice_thickness;
-    inputs.u3            = &m_stress_balance->velocity_u();
-    inputs.v3            = &m_stress_balance->velocity_v();
-    inputs.w3            = &m_stress_balance->velocity_w();
-
-    profiling.begin("age");
-    m_age_model->update(current_time, dt_TempAge, inputs);
-    profiling.end("age");
-    m_stdout_flags += "a";
-  } else {
-    m_stdout_flags += "$";
-  }
+  tasks.add("age", {"geometry", "velocity"}, {"age"},
+            [&]() {
+              if (m_age_model and updateAtDepth) {
+                AgeModelInputs inputs;
+                inputs.ice_thickness = &m_geometry.ice_thickness;
+                inputs.u3            = &m_stress_balance->velocity_u();
+                inputs.v3            = &m_stress_balance->velocity_v();
+                inputs.w3            = &m_stress_balance->velocity_w();
+
+                profiling.begin("age");
+                m_age_model->update(current_time, dt_TempAge, inputs);
+                profiling.end("age", m_grid->com);
+                m_stdout_flags += "a";
+              } else {
+                m_stdout_flags += "$";
+              }
+            });
 
   //! \li update the enthalpy (or temperature) field according to the conservation of
   //!  energy model based (especially) on the new velocity field; see
   //!  energy_step()
-  if (updateAtDepth) { // do the energy step
-    profiling.begin("energy");
-    energy_step();
-    profiling.end("energy");
-    m_stdout_flags += "E";
-  } else {
-    m_stdout_flags += "$";
-  }
+  tasks.add("energy", {"geometry", "velocity", "ocean", "surface", "hydrology"},
+            {"energy", "basal_melt_rate", "work2d[2]"},
+            [&]() {
+              if (updateAtDepth) {
+                profiling.begin("energy");
+                energy_step();
+                profiling.end("energy", m_grid->com);
+                m_stdout_flags += "E";
+              } else {
+                m_stdout_flags += "$";
+              }
+            });
 
   //! \li update the fracture density field; see update_fracture_density()
-  if (m_config->get_flag("fracture_density.enabled")) {
-    profiling.begin("fracture_density");
-    update_fracture_density();
-    profiling.end("fracture_density");
-  }
+  tasks.add("fracture_density", {"geometry", "velocity"},
+            {"fracture_density", "work2d[0]", "work2d[1]"},
+            [&]() {
+              if (m_config->get_flag("fracture_density.enabled")) {
+                profiling.begin("fracture_density");
+                update_fracture_density();
+                profiling.end("fracture_density", m_grid->com);
+              }
+            });
 
   //! \li update the thickness of the ice according to the mass conservation model and calving
   //! parameterizations
-
-  // FIXME: thickness B.C. mask should be separate
-  IceModelVec2Int &thickness_bc_mask = m_ssa_dirichlet_bc_mask;
-
-  if (do_mass_continuity) {
-    profiling.begin("mass_transport");
-    {
-      // Note that there are three adaptive time-stepping criteria. Two of them (using max.
-      // diffusion and 2D CFL) are limiting the mass-continuity time-step and the third (3D
-      // CFL) limits the energy and age time-steps.
-
-      // The mass-continuity time-step is usually smaller, and the skipping mechanism lets us
-      // do several mass-continuity steps for each energy step.
-
-      // When -no_mass is set, mass-continuity-related time-step restrictions are disabled,
-      // making "skipping" unnecessary.
-
-      // This is why the following two lines appear here and are executed only if
-      // do_mass_continuity is true.
-      if (do_skip and m_skip_countdown > 0) {
-        m_skip_countdown--;
-      }
-
-      m_geometry_evolution->flow_step(m_geometry,
-                                      m_dt,
-                                      m_stress_balance->advective_velocity(),
-                                      m_stress_balance->diffusive_flux(),
-                                      m_ssa_dirichlet_bc_mask,
-                                      thickness_bc_mask);
-
-      m_geometry_evolution->apply_flux_divergence(m_geometry);
-
-      enforce_consistency_of_geometry(DONT_REMOVE_ICEBERGS);
-    }
-    profiling.end("mass_transport");
-
-    // calving, frontal melt, and discharge accounting
-    profiling.begin("front_retreat");
-    front_retreat_step();
-    profiling.end("front_retreat");
-
-    m_stdout_flags += "h";
-  } else {
-    m_stdout_flags += "$";
-  }
-
-  profiling.begin("sea_level");
-  m_sea_level->update(m_geometry, current_time, m_dt);
-  profiling.end("sea_level");
-
-  profiling.begin("ocean");
-  m_ocean->update(m_geometry, current_time, m_dt);
-  profiling.end("ocean");
+  tasks.add("mass_transport", {"geometry", "velocity"}, {"geometry"},
+            [&]() {
+              if (not do_mass_continuity) {
+                return;
+              }
+
+              profiling.begin("mass_transport");
+              {
+                // Note that there are three adaptive time-stepping criteria. Two of them (using max.
+                // diffusion and 2D CFL) are limiting the mass-continuity time-step and the third (3D
+                // CFL) limits the energy and age time-steps.
+
+                // The mass-continuity time-step is usually smaller, and the skipping mechanism lets us
+                // do several mass-continuity steps for each energy step.
+
+                // When -no_mass is set, mass-continuity-related time-step restrictions are disabled,
+                // making "skipping" unnecessary.
+
+                // This is why the following two lines appear here and are executed only if
+                // do_mass_continuity is true.
+                if (do_skip and m_skip_countdown > 0) {
+                  m_skip_countdown--;
+                }
+
+                // the implicit SIA step uses the diffusivity instead of the diffusive flux
+                const IceModelVec2Stag *diffusivity = nullptr;
+                if (m_config->get_flag("geometry.update.implicit_sia")) {
+                  auto sia = dynamic_cast<const stressbalance::SIAFD*>(m_stress_balance->modifier());
+
+                  if (sia == nullptr) {
+                    throw RuntimeError(PISM_ERROR_LOCATION,
+                                       "geometry.update.implicit_sia requires the SIA stress balance model");
+                  }
+
+                  diffusivity = &sia->diffusivity();
+                }
+
+                m_geometry_evolution->flow_step(m_geometry,
+                                                m_dt,
+                                                m_stress_balance->advective_velocity(),
+                                                m_stress_balance->diffusive_flux(),
+                                                m_ssa_dirichlet_bc_mask,
+                                                thickness_bc_mask,
+                                                diffusivity);
+
+                m_geometry_evolution->apply_flux_divergence(m_geometry);
+
+                enforce_consistency_of_geometry(DONT_REMOVE_ICEBERGS);
+              }
+              profiling.end("mass_transport", m_grid->com);
+            });
+
+  // calving, frontal melt, and discharge accounting
+  tasks.add("front_retreat", {"geometry", "velocity", "ocean"},
+            {"geometry", "thickness_change", "work2d[0]", "work2d[1]", "work2d[2]"},
+            [&]() {
+              if (do_mass_continuity) {
+                profiling.begin("front_retreat");
+                front_retreat_step();
+                profiling.end("front_retreat", m_grid->com);
+
+                m_stdout_flags += "h";
+              } else {
+                m_stdout_flags += "$";
+              }
+            });
+
+  tasks.add("sea_level", {"geometry"}, {"sea_level"},
+            [&]() {
+              profiling.begin("sea_level");
+              m_sea_level->update(m_geometry, current_time, m_dt);
+              profiling.end("sea_level", m_grid->com);
+            });
+
+  tasks.add("ocean", {"geometry"}, {"ocean"},
+            [&]() {
+              profiling.begin("ocean");
+              m_ocean->update(m_geometry, current_time, m_dt);
+              profiling.end("ocean", m_grid->com);
+            });
 
   // The sea level elevation might have changed, so we need to update the mask, etc. Note
   // that THIS MAY PRODUCE ICEBERGS, but we assume that the surface model does not care.
-  enforce_consistency_of_geometry(DONT_REMOVE_ICEBERGS);
+  tasks.add("geometry_consistency", {"geometry", "sea_level", "bed_elevation"}, {"geometry"},
+            [&]() {
+              enforce_consistency_of_geometry(DONT_REMOVE_ICEBERGS);
+            });
 
   //! \li Update surface and ocean models.
-  profiling.begin("surface");
-  m_surface->update(m_geometry, current_time, m_dt);
-  profiling.end("surface");
-
-
-  if (do_mass_continuity) {
-    // compute and apply effective surface and basal mass balance
-
-    m_geometry_evolution->source_term_step(m_geometry, m_dt,
-                                           thickness_bc_mask,
-                                           m_surface->mass_flux(),
-                                           m_basal_melt_rate);
-    m_geometry_evolution->apply_mass_fluxes(m_geometry);
-
-    // add removed icebergs to discharge due to calving
-    {
-      IceModelVec2S
-        &old_H    = m_work2d[0],
-        &old_Href = m_work2d[1];
-
-      {
-        old_H.copy_from(m_geometry.ice_thickness);
-        old_Href.copy_from(m_geometry.ice_area_specific_volume);
-      }
-
-      // the last call has to remove icebergs
-      enforce_consistency_of_geometry(REMOVE_ICEBERGS);
-
-      bool add_values = true;
-      compute_geometry_change(m_geometry.ice_thickness,
-                              m_geometry.ice_area_specific_volume,
-                              old_H, old_Href,
-                              add_values,
-                              m_thickness_change.calving);
-    }
-  }
+  tasks.add("surface", {"geometry"}, {"surface"},
+            [&]() {
+              profiling.begin("surface");
+              m_surface->update(m_geometry, current_time, m_dt);
+              profiling.end("surface", m_grid->com);
+            });
+
+  // compute and apply effective surface and basal mass balance
+  tasks.add("mass_fluxes",
+            {"geometry", "surface", "sea_level", "bed_elevation", "basal_melt_rate"},
+            {"geometry", "thickness_change", "work2d[0]", "work2d[1]"},
+            [&]() {
+              if (not do_mass_continuity) {
+                return;
+              }
+
+              m_geometry_evolution->source_term_step(m_geometry, m_dt,
+                                                     thickness_bc_mask,
+                                                     m_surface->mass_flux(),
+                                                     m_basal_melt_rate);
+              m_geometry_evolution->apply_mass_fluxes(m_geometry);
+
+              // add removed icebergs to discharge due to calving
+              {
+                IceModelVec2S
+                  &old_H    = m_work2d[0],
+                  &old_Href = m_work2d[1];
+
+                {
+                  old_H.copy_from(m_geometry.ice_thickness);
+                  old_Href.copy_from(m_geometry.ice_area_specific_volume);
+                }
+
+                // the last call has to remove icebergs
+                enforce_consistency_of_geometry(REMOVE_ICEBERGS);
+
+                bool add_values = true;
+                compute_geometry_change(m_geometry.ice_thickness,
+                                        m_geometry.ice_area_specific_volume,
+                                        old_H, old_Href,
+                                        add_values,
+                                        m_thickness_change.calving);
+              }
+            });
 
   //! \li update the state variables in the subglacial hydrology model (typically
   //!  water thickness and sometimes pressure)
-  profiling.begin("basal_hydrology");
-  hydrology_step();
-  profiling.end("basal_hydrology");
+  tasks.add("basal_hydrology", {"geometry", "velocity", "surface", "basal_melt_rate"},
+            {"hydrology", "work2d[0]", "work2d[1]"},
+            [&]() {
+              profiling.begin("basal_hydrology");
+              hydrology_step();
+              profiling.end("basal_hydrology", m_grid->com);
+            });
 
   //! \li compute the bed deformation, which depends on current thickness, bed elevation,
   //! and sea level
-  if (m_beddef) {
-    int topg_state_counter = m_beddef->bed_elevation().state_counter();
-
-    profiling.begin("bed_deformation");
-    m_beddef->update(m_geometry.ice_thickness,
-                     m_geometry.sea_level_elevation,
-                     current_time, m_dt);
-    profiling.end("bed_deformation");
-
-    if (m_beddef->bed_elevation().state_counter() != topg_state_counter) {
-      m_new_bed_elevation = true;
-    } else {
-      m_new_bed_elevation = false;
-    }
-  } else {
-    m_new_bed_elevation = false;
+  tasks.add("bed_deformation", {"geometry"}, {"bed_elevation"},
+            [&]() {
+              if (m_beddef) {
+                int topg_state_counter = m_beddef->bed_elevation().state_counter();
+
+                profiling.begin("bed_deformation");
+                m_beddef->update(m_geometry.ice_thickness,
+                                 m_geometry.sea_level_elevation,
+                                 current_time, m_dt);
+                profiling.end("bed_deformation", m_grid->com);
+
+                m_new_bed_elevation = (m_beddef->bed_elevation().state_counter() != topg_state_counter);
+              } else {
+                m_new_bed_elevation = false;
+              }
+            });
+
+  tasks.add("bed_consistency", {"geometry", "bed_elevation", "sea_level"}, {"geometry"},
+            [&]() {
+              if (m_new_bed_elevation) {
+                enforce_consistency_of_geometry(DONT_REMOVE_ICEBERGS);
+                m_stdout_flags += "b";
+              } else {
+                m_stdout_flags += " ";
+              }
+            });
+
+  if (m_log->get_threshold() >= 4) {
+    m_log->message(4, "Time step stages:\n%s", tasks.description().c_str());
   }
 
-  if (m_new_bed_elevation) {
-    enforce_consistency_of_geometry(DONT_REMOVE_ICEBERGS);
-    m_stdout_flags += "b";
-  } else {
-    m_stdout_flags += " ";
-  }
+  tasks.run();
 
   //! \li call post_step_hook() to let derived classes do more
   post_step_hook();
@@ -664,7 +756,8 @@ void IceModel::step(bool do_mass_continuity,
               o_file,
               string_to_backend(m_config->get_string("output.format")),
               PISM_READWRITE_MOVE,
-              m_ctx->pio_iosys_id());
+              m_ctx->pio_iosys_id(),
+              m_ctx->netcdf3_n_aggregators());
 
     update_run_stats();
     write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
@@ -707,8 +800,7 @@ void IceModel::hydrology_step() {
   } else if (m_config->get_flag("hydrology.surface_input_from_runoff")) {
     // convert [kg m-2] to [kg m-2 s-1]
     IceModelVec2S &surface_input_rate = m_work2d[1];
-    surface_input_rate.copy_from(m_surface->runoff());
-    surface_input_rate.scale(1.0 / m_dt);
+    assign(surface_input_rate, m_surface->runoff() / m_dt);
     inputs.surface_input_rate = &surface_input_rate;
   }
 
@@ -757,6 +849,8 @@ void IceModel::run() {
   bool do_skip = m_config->get_flag("time_stepping.skip.enabled");
 
   int stepcount = m_config->get_flag("time_stepping.count_steps") ? 0 : -1;
+  const int max_steps = m_config->get_number("time_stepping.max_steps");
+  const double max_wall_clock_time = m_config->get_number("time_stepping.max_wall_clock_time");
 
   // de-allocate diagnostics that are not needed
   prune_diagnostics();
@@ -773,9 +867,7 @@ void IceModel::run() {
   // This is needed to compute rates of change of the ice mass, volume, etc.
   {
     const double time = m_time->current();
-    for (auto d : m_ts_diagnostics) {
-      d.second->update(time, time);
-    }
+    update_ts_diagnostics(m_grid->com, m_ts_diagnostics, time, time);
   }
 
   m_log->message(2, "running forward ...\n");
@@ -791,15 +883,39 @@ void IceModel::run() {
   // main loop for time evolution
   // IceModel::step calls Time::step(dt), ensuring that this while loop
   // will terminate
+  const bool preemption = m_config->get_flag("output.preemption.enabled");
+  if (preemption and not (m_config->get_number("output.preemption.time_budget") > 0.0)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "output.preemption.time_budget has to be positive (got %f)",
+                                  m_config->get_number("output.preemption.time_budget"));
+  }
+
   profiling.stage_begin("time-stepping loop");
+  const double loop_start = GlobalMax(m_grid->com, get_time());
+  int step_counter = 0;
+  init_telemetry();
   while (m_time->current() < m_time->end()) {
 
     m_stdout_flags.erase();  // clear it out
 
+    profiling.set_step(step_counter);
+    profiling.begin("time_step");
+
     step(do_mass_conserve, do_skip);
 
     update_diagnostics(m_dt);
 
+    // the only check of preemption signals in this step (it is a collective operation)
+    const bool preemption_signal = preemption and preemption_requested();
+
+    if (preemption_signal) {
+      // skip viewers, snapshots, extras and backups: the job is about to be killed
+      process_signals(preemption_signal);
+      profiling.end("time_step");
+      step_counter++;
+      break;
+    }
+
     // report a summary for major steps or the last one
     bool updateAtDepth = m_skip_countdown == 0;
     bool tempAgeStep   = updateAtDepth and (m_age_model or do_energy);
@@ -817,16 +933,43 @@ void IceModel::run() {
     write_backup();
     profiling.end("io");
 
+    profiling.end("time_step");
+    step_counter++;
+
+    write_telemetry(step_counter);
+
     if (stepcount >= 0) {
       stepcount++;
     }
-    if (process_signals() != 0) {
+    if (process_signals(preemption_signal) != 0) {
       break;
     }
+
+    if (max_steps > 0 and step_counter >= max_steps) {
+      m_log->message(2, "Stopping after %d time steps (time_stepping.max_steps).\n",
+                     step_counter);
+      break;
+    }
+
+    if (max_wall_clock_time > 0.0) {
+      // all ranks have to agree on when to stop
+      const double wall_clock_time = GlobalMax(m_grid->com, get_time()) - loop_start;
+      if (wall_clock_time >= max_wall_clock_time) {
+        m_log->message(2, "Stopping after %d time steps and %.1f seconds"
+                       " (time_stepping.max_wall_clock_time).\n",
+                       step_counter, wall_clock_time);
+        break;
+      }
+    }
   } // end of the time-stepping loop
 
   profiling.stage_end("time-stepping loop");
 
+  // used to compute throughput in benchmarks (see pismv -report_file)
+  m_run_stats.set_number("time_steps", step_counter);
+  m_run_stats.set_number("time_stepping_wall_clock_seconds",
+                         GlobalMax(m_grid->com, get_time()) - loop_start);
+
   if (stepcount >= 0) {
     m_log->message(1,
                "count_time_steps:  run() took %d steps\n"
@@ -853,21 +996,34 @@ void IceModel::init() {
   //! The IceModel initialization sequence is this:
 
   //! 1) Initialize model time:
+  profiling.begin("init.time");
   time_setup();
+  profiling.end("init.time");
 
   //! 2) Process the options:
+  profiling.begin("init.options");
   process_options();
+  profiling.end("init.options");
 
   //! 3) Memory allocation:
-  allocate_storage();
+  profiling.begin("init.allocate");
+  {
+    MemoryOwner owner(m_ctx->memory_usage(), "IceModel");
+    allocate_storage();
+  }
+  profiling.end("init.allocate");
 
   //! 4) Allocate PISM components modeling some physical processes.
+  profiling.begin("init.submodels");
   allocate_submodels();
+  profiling.end("init.submodels");
 
   //! 6) Initialize coupler models and fill the model state variables
   //! (from a PISM output file, from a bootstrapping file using some
   //! modeling choices or using formulas). Calls IceModel::regrid()
+  profiling.begin("init.model_state");
   model_state_setup();
+  profiling.end("init.model_state");
 
   //! 7) Report grid parameters:
   m_grid->report_parameters();
@@ -875,7 +1031,13 @@ void IceModel::init() {
   //! 8) Miscellaneous stuff: set up the bed deformation model, initialize the
   //! basal till model, initialize snapshots. This has to happen *after*
   //! regridding.
+  profiling.begin("init.misc");
   misc_setup();
+  profiling.end("init.misc");
+
+  if (m_config->get_flag("output.memory_usage")) {
+    m_ctx->memory_usage().report(m_grid->com, *m_log, "after initialization");
+  }
 
   profiling.end("initialization");
 }
@@ -1034,14 +1196,12 @@ void IceModel::prune_diagnostics() {
  * Call this after prune_diagnostics() to avoid unnecessary work.
  */
 void IceModel::update_diagnostics(double dt) {
-  for (auto d : m_diagnostics) {
-    d.second->update(dt);
-  }
+  pism::update_diagnostics(m_diagnostics, dt);
 
   const double time = m_time->current();
-  for (auto d : m_ts_diagnostics) {
-    d.second->update(time - dt, time);
-  }
+  update_ts_diagnostics(m_grid->com, m_ts_diagnostics, time - dt, time);
+
+  flush_full_timeseries();
 }
 
 /*!
@@ -48,6 +48,7 @@
 #include "pism/util/Time.hh"
 #include "pism/util/Diagnostic.hh"
 #include "pism/util/MaxTimestep.hh"
+#include "pism/util/DependencyTracker.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/geometry/GeometryEvolution.hh"
 #include "pism/stressbalance/StressBalance.hh"
@@ -101,6 +102,7 @@ class AgeModel;
 class IceModelVec2CellType;
 class IceModelVec2T;
 class Component;
+class Decimation;
 class FrontRetreat;
 class PrescribedRetreat;
 
@@ -126,6 +128,10 @@ public:
 
   virtual void save_results();
 
+  void save_state(const std::string &name);
+  void restore_state(const std::string &name);
+  void discard_state(const std::string &name);
+
   void list_diagnostics() const;
   void list_diagnostics_json() const;
   std::map<std::string, std::vector<VariableMetadata>> describe_diagnostics() const;
@@ -150,6 +156,8 @@ public:
   const Geometry& geometry() const;
   const GeometryEvolution& geometry_evolution() const;
 
+  void set_ice_thickness(const IceModelVec2S &thickness, const IceModelVec2Int &mask);
+
   double dt() const;
 
 protected:
@@ -206,7 +214,11 @@ protected:
                               OutputKind kind,
                               const std::set<std::string> &variables,
                               double time,
-                              IO_Type default_diagnostics_type = PISM_FLOAT);
+                              const Decimation *decimation = nullptr);
+  void define_variables(const File &file,
+                        OutputKind kind,
+                        const std::set<std::string> &variables,
+                        const Decimation *decimation = nullptr);
 
   virtual void define_model_state(const File &file);
   virtual void write_model_state(const File &file);
@@ -217,14 +229,18 @@ protected:
                               HistoryTreatment history_flag);
 
   virtual void write_mapping(const File &file);
+  void set_output_types(File &file) const;
+  void set_ice_columns(File &file) const;
   virtual void write_run_stats(const File &file);
 
 
   virtual void define_diagnostics(const File &file,
                                   const std::set<std::string> &variables,
-                                  IO_Type default_type);
+                                  IO_Type default_type,
+                                  const Decimation *decimation = nullptr);
   virtual void write_diagnostics(const File &file,
-                                 const std::set<std::string> &variables);
+                                 const std::set<std::string> &variables,
+                                 const Decimation *decimation = nullptr);
 
   //! Computational grid
   const IceGrid::Ptr m_grid;
@@ -280,6 +296,8 @@ protected:
   Geometry m_geometry;
   std::unique_ptr<GeometryEvolution> m_geometry_evolution;
   bool m_new_bed_elevation;
+  //! track bed elevation and sea level copied into m_geometry
+  DependencyTracker m_bed_elevation_copy, m_sea_level_copy;
 
   //! ghosted
   IceModelVec2S m_basal_yield_stress;
@@ -315,6 +333,8 @@ protected:
   virtual MaxTimestep max_timestep_diffusivity();
   virtual void max_timestep(double &dt_result, unsigned int &skip_counter);
   virtual unsigned int skip_counter(double input_dt, double input_dt_diffusivity);
+  virtual unsigned int adaptive_skip_counter(double dt, bool full_update, unsigned int counter);
+  MaxTimestep max_timestep_energy_age() const;
 
   // see energy.cc
   virtual void bedrock_thermal_model_step();
@@ -356,7 +376,7 @@ protected:
 
 
   // see iMutil.cc
-  virtual int process_signals();
+  virtual int process_signals(bool preemption_signal);
   virtual void prepend_history(const std::string &string);
   virtual void update_run_stats();
 
@@ -398,6 +418,7 @@ protected:
   bool m_save_snapshots, m_snapshots_file_is_ready, m_split_snapshots;
   std::vector<double> m_snapshot_times;
   std::set<std::string> m_snapshot_vars;
+  std::unique_ptr<File> m_snapshot_file;
   unsigned int m_current_snapshot;
   void init_snapshots();
   void write_snapshot();
@@ -405,15 +426,28 @@ protected:
 
   //! file to write scalar time-series to
   std::string m_ts_filename;
+  //! scalar time-series file (kept open during the run)
+  std::unique_ptr<File> m_ts_file;
   //! requested times for scalar time-series
   std::shared_ptr<std::vector<double>> m_ts_times;
   std::set<std::string> m_ts_vars;
   void init_timeseries();
   void flush_timeseries();
+  void flush_full_timeseries();
   MaxTimestep ts_max_timestep(double my_t);
 
   // spatially-varying time-series
   bool m_save_extra, m_extra_file_is_ready, m_split_extra;
+  //! true if time-independent diagnostics were written to the companion file (see
+  //! output.extra.split_time_independent)
+  bool m_extra_time_independent_written;
+  //! true if each diagnostic is written to a separate file (see
+  //! output.extra.file_per_variable)
+  bool m_extra_file_per_variable;
+  //! true if m_extra_template was created (see copy_extra_template())
+  bool m_extra_template_ready;
+  //! contents of the template of split extra files (rank 0 only)
+  std::string m_extra_template;
   std::string m_extra_filename;
   std::vector<double> m_extra_times;
   unsigned int m_next_extra;
@@ -421,16 +455,47 @@ protected:
   std::set<std::string> m_extra_vars;
   TimeBoundsMetadata m_extra_bounds;
   std::unique_ptr<File> m_extra_file;
+  //! coarse (or cropped) grid used to write diagnostics to the extra file
+  std::unique_ptr<Decimation> m_extra_decimation;
   void init_extras();
   void write_extras();
+  std::unique_ptr<File> open_extra_file(const std::string &filename, IO_Mode mode) const;
+  void define_extra_file(const File &file, const std::string &time_independent_filename);
+  void copy_extra_template(const std::string &filename,
+                           const std::set<std::string> &variables,
+                           const std::string &time_independent_filename);
+  void write_extras_per_variable(const std::string &prefix,
+                                 const std::set<std::string> &variables,
+                                 double time, const std::vector<double> &time_bounds);
   MaxTimestep extras_max_timestep(double my_t);
 
   // automatic backups
   std::string m_backup_filename;
+  //! file name used by incremental backups (see output.backup_incremental)
+  std::string m_backup_increment_filename;
+  //! checksums of variables in the first (base) backup; empty if it was not written yet
+  std::map<std::string, std::string> m_backup_checksums;
   double m_last_backup_time;
   std::set<std::string> m_backup_vars;
   void init_backups();
   void write_backup();
+  void report_load_balance();
+
+  // preemption checkpoints (see output.preemption.enabled)
+  //! true if the run was stopped after writing a preemption checkpoint
+  bool m_preempted;
+  bool preemption_requested() const;
+  void write_preemption_checkpoint();
+
+  // run telemetry (see output.telemetry.file)
+  struct TelemetryState {
+    double wall_clock_hours;
+    double model_time;
+    std::map<std::string, double> event_times;
+  };
+  TelemetryState m_telemetry;
+  void init_telemetry();
+  void write_telemetry(int step);
 
   // last time at which PISM hit a multiple of X years, see the configuration parameter
   // time_stepping.hit_multiples
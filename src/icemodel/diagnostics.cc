@@ -32,6 +32,7 @@
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/Diagnostic.hh"
 #include "pism/util/Vars.hh"
+#include "pism/util/Refinement.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/iceModelVec3Custom.hh"
 #include "pism/util/pism_utilities.hh"
@@ -80,7 +81,7 @@ IceMarginPressureDifference::IceMarginPressureDifference(IceModel *m)
 
 IceModelVec::Ptr IceMarginPressureDifference::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "ice_margin_pressure_difference", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("ice_margin_pressure_difference");
   result->metadata(0) = m_vars[0];
 
   IceModelVec2CellType mask(m_grid, "mask", WITH_GHOSTS);
@@ -172,6 +173,13 @@ public:
 
 protected:
   AreaType m_kind;
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     const IceModelVec2S &input = model->geometry_evolution().bottom_surface_mass_balance();
     const IceModelVec2CellType &cell_type = model->geometry().cell_type;
@@ -238,7 +246,7 @@ IceModelVec::Ptr HardnessAverage::compute_impl() const {
     }
   }
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "hardav", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("hardav");
   result->metadata() = m_vars[0];
 
   const IceModelVec2CellType &cell_type = model->geometry().cell_type;
@@ -289,7 +297,7 @@ Rank::Rank(const IceModel *m)
 
 IceModelVec::Ptr Rank::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "rank", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("rank");
   result->metadata() = m_vars[0];
 
   IceModelVec::AccessList list{result.get()};
@@ -301,6 +309,66 @@ IceModelVec::Ptr Rank::compute_impl() const {
   return result;
 }
 
+//! \brief Marks cells covered by patches of a block-structured refinement (see
+//! refinement_patches()).
+class RefinementPatches : public Diag<IceModel>
+{
+public:
+  RefinementPatches(const IceModel *m);
+protected:
+  virtual IceModelVec::Ptr compute_impl() const;
+};
+
+RefinementPatches::RefinementPatches(const IceModel *m)
+  : Diag<IceModel>(m) {
+  m_vars = {SpatialVariableMetadata(m_sys, "refinement_patches")};
+  set_attrs("cells flagged for refinement (2) and other cells covered by refinement patches (1)",
+            "", "1", "", 0);
+  m_vars[0].set_output_type(PISM_INT);
+}
+
+IceModelVec::Ptr RefinementPatches::compute_impl() const {
+  RefinementParameters parameters;
+  parameters.velocity_gradient_threshold =
+    m_config->get_number("grid.refinement.velocity_gradient_threshold", "s-1");
+  parameters.buffer_width   = m_config->get_number("grid.refinement.buffer_width");
+  parameters.efficiency     = m_config->get_number("grid.refinement.efficiency");
+  parameters.min_patch_size = m_config->get_number("grid.refinement.min_patch_size");
+
+  IceModelVec2Int::Ptr flags = m_pool->integer("refinement_flags", WITH_GHOSTS);
+
+  flag_cells_for_refinement(model->geometry().cell_type,
+                            model->stress_balance()->advective_velocity(),
+                            parameters, *flags);
+
+  auto patches = refinement_patches(*flags, parameters);
+
+  IceModelVec2S::Ptr result = m_pool->scalar("refinement_patches");
+  result->metadata() = m_vars[0];
+
+  IceModelVec::AccessList list{result.get(), flags.get()};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    (*result)(i, j) = flags->as_int(i, j) > 0 ? 2.0 : 0.0;
+  }
+
+  for (const auto &patch : patches) {
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (i >= patch.i_first and i <= patch.i_last and
+          j >= patch.j_first and j <= patch.j_last and
+          (*result)(i, j) == 0.0) {
+        (*result)(i, j) = 1.0;
+      }
+    }
+  }
+
+  return result;
+}
+
 //! \brief Computes CTS, CTS = E/E_s(p).
 class CTS : public Diag<IceModel>
 {
@@ -322,7 +390,7 @@ CTS::CTS(const IceModel *m)
 
 IceModelVec::Ptr CTS::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "cts", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("cts");
   result->metadata() = m_vars[0];
 
   energy::compute_cts(model->energy_balance_model()->enthalpy(),
@@ -352,7 +420,7 @@ Temperature::Temperature(const IceModel *m)
 
 IceModelVec::Ptr Temperature::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "temp", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("temp");
   result->metadata() = m_vars[0];
 
   const IceModelVec2S &thickness = model->geometry().ice_thickness;
@@ -411,7 +479,7 @@ IceModelVec::Ptr TemperaturePA::compute_impl() const {
   bool cold_mode = m_config->get_flag("energy.temperature_based");
   double melting_point_temp = m_config->get_number("constants.fresh_water.melting_point_temperature");
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "temp_pa", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("temp_pa");
   result->metadata() = m_vars[0];
 
   const IceModelVec2S &thickness = model->geometry().ice_thickness;
@@ -479,7 +547,7 @@ IceModelVec::Ptr TemperaturePABasal::compute_impl() const {
   bool cold_mode = m_config->get_flag("energy.temperature_based");
   double melting_point_temp = m_config->get_number("constants.fresh_water.melting_point_temperature");
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "temp_pa_base", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("temp_pa_base");
   result->metadata() = m_vars[0];
 
   const IceModelVec2S &thickness = model->geometry().ice_thickness;
@@ -541,7 +609,7 @@ IceEnthalpySurface::IceEnthalpySurface(const IceModel *m)
 
 IceModelVec::Ptr IceEnthalpySurface::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "enthalpysurf", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("enthalpysurf");
   result->metadata() = m_vars[0];
 
   // compute levels corresponding to 1 m below the ice surface:
@@ -592,7 +660,7 @@ IceEnthalpyBasal::IceEnthalpyBasal(const IceModel *m)
 
 IceModelVec::Ptr IceEnthalpyBasal::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "enthalpybase", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("enthalpybase");
   result->metadata() = m_vars[0];
 
   model->energy_balance_model()->enthalpy().getHorSlice(*result, 0.0);  // z=0 slice
@@ -643,7 +711,7 @@ TemperatureBasal::TemperatureBasal(const IceModel *m, AreaType area_type)
 
 IceModelVec::Ptr TemperatureBasal::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "basal_temperature", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("basal_temperature");
   result->metadata(0) = m_vars[0];
 
   const IceModelVec2S &thickness = model->geometry().ice_thickness;
@@ -708,15 +776,14 @@ IceModelVec::Ptr TemperatureSurface::compute_impl() const {
 
   const IceModelVec2S &thickness = model->geometry().ice_thickness;
 
-  IceModelVec::Ptr enth = IceEnthalpySurface(model).compute();
-  IceModelVec2S::Ptr result = IceModelVec2S::To2DScalar(enth);
+  // surface enthalpy (may be shared with other diagnostics, so it is not modified here)
+  IceModelVec2S::Ptr enthalpy = IceModelVec2S::To2DScalar(IceEnthalpySurface(model).compute());
 
-  EnthalpyConverter::Ptr EC = model->ctx()->enthalpy_converter();
+  IceModelVec2S::Ptr result = m_pool->scalar("ice_surface_temp");
 
-  // result contains surface enthalpy; note that it is allocated by
-  // IceEnthalpySurface::compute().
+  EnthalpyConverter::Ptr EC = model->ctx()->enthalpy_converter();
 
-  IceModelVec::AccessList list{result.get(), &thickness};
+  IceModelVec::AccessList list{result.get(), enthalpy.get(), &thickness};
 
   double depth = 1.0,
     pressure = EC->pressure(depth);
@@ -726,7 +793,7 @@ IceModelVec::Ptr TemperatureSurface::compute_impl() const {
       const int i = p.i(), j = p.j();
 
       if (thickness(i,j) > 1) {
-        (*result)(i,j) = EC->temperature((*result)(i,j), pressure);
+        (*result)(i,j) = EC->temperature((*enthalpy)(i,j), pressure);
       } else {
         (*result)(i,j) = m_fill_value;
       }
@@ -762,7 +829,7 @@ LiquidFraction::LiquidFraction(const IceModel *m)
 
 IceModelVec::Ptr LiquidFraction::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "liqfrac", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("liqfrac");
   result->metadata(0) = m_vars[0];
 
   bool cold_mode = m_config->get_flag("energy.temperature_based");
@@ -801,7 +868,7 @@ TemperateIceThickness::TemperateIceThickness(const IceModel *m)
 
 IceModelVec::Ptr TemperateIceThickness::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "tempicethk", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("tempicethk");
   result->metadata(0) = m_vars[0];
 
   const IceModelVec2CellType &cell_type = model->geometry().cell_type;
@@ -876,7 +943,7 @@ TemperateIceThicknessBasal::TemperateIceThicknessBasal(const IceModel *m)
  */
 IceModelVec::Ptr TemperateIceThicknessBasal::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "tempicethk_basal", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("tempicethk_basal");
   result->metadata(0) = m_vars[0];
 
   EnthalpyConverter::Ptr EC = model->ctx()->enthalpy_converter();
@@ -974,9 +1041,10 @@ public:
     m_ts.variable().set_string("long_name", "volume of the ice in glacierized areas");
     m_ts.variable().set_number("valid_min", 0.0);
   }
-  double compute() {
-    return ice_volume(model->geometry(),
-                      m_config->get_number("output.ice_free_thickness_standard"));
+  bool compute_local_sum(double &result) {
+    result = ice_volume_local(model->geometry(),
+                              m_config->get_number("output.ice_free_thickness_standard"));
+    return true;
   }
 };
 
@@ -992,8 +1060,9 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
-    return ice_volume(model->geometry(), 0.0);
+  bool compute_local_sum(double &result) {
+    result = ice_volume_local(model->geometry(), 0.0);
+    return true;
   }
 };
 
@@ -1009,9 +1078,10 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
-    return sea_level_rise_potential(model->geometry(),
-                                    m_config->get_number("output.ice_free_thickness_standard"));
+  bool compute_local_sum(double &result) {
+    const double thickness_threshold = m_config->get_number("output.ice_free_thickness_standard");
+    result = sea_level_rise_potential_local(model->geometry(), thickness_threshold);
+    return true;
   }
 };
 
@@ -1026,9 +1096,10 @@ public:
     m_ts.variable().set_string("long_name", "rate of change of the ice volume in glacierized areas");
   }
 
-  double compute() {
-    return ice_volume(model->geometry(),
-                      m_config->get_number("output.ice_free_thickness_standard"));
+  bool compute_local_sum(double &result) {
+    result = ice_volume_local(model->geometry(),
+                              m_config->get_number("output.ice_free_thickness_standard"));
+    return true;
   }
 };
 
@@ -1044,8 +1115,9 @@ public:
                                "rate of change of the ice volume, including seasonal cover");
   }
 
-  double compute() {
-    return ice_volume(model->geometry(), 0.0);
+  bool compute_local_sum(double &result) {
+    result = ice_volume_local(model->geometry(), 0.0);
+    return true;
   }
 };
 
@@ -1061,8 +1133,10 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
-    return ice_area(model->geometry(), m_config->get_number("output.ice_free_thickness_standard"));
+  bool compute_local_sum(double &result) {
+    result = ice_area_local(model->geometry(),
+                            m_config->get_number("output.ice_free_thickness_standard"));
+    return true;
   }
 };
 
@@ -1079,16 +1153,17 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
 
     const double
       thickness_standard = m_config->get_number("output.ice_free_thickness_standard"),
       ice_density        = m_config->get_number("constants.ice.density"),
-      ice_volume         = ice_volume_not_displacing_seawater(model->geometry(),
-                                                              thickness_standard),
+      ice_volume         = ice_volume_not_displacing_seawater_local(model->geometry(),
+                                                                    thickness_standard),
       ice_mass           = ice_volume * ice_density;
 
-    return ice_mass;
+    result = ice_mass;
+    return true;
   }
 };
 
@@ -1104,11 +1179,12 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
     double
       ice_density        = m_config->get_number("constants.ice.density"),
       thickness_standard = m_config->get_number("output.ice_free_thickness_standard");
-    return ice_volume(model->geometry(), thickness_standard) * ice_density;
+    result = ice_volume_local(model->geometry(), thickness_standard) * ice_density;
+    return true;
   }
 };
 
@@ -1129,9 +1205,10 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
-    return (ice_volume(model->geometry(), 0.0) *
-            m_config->get_number("constants.ice.density"));
+  bool compute_local_sum(double &result) {
+    result = (ice_volume_local(model->geometry(), 0.0) *
+                               m_config->get_number("constants.ice.density"));
+    return true;
   }
 };
 
@@ -1146,11 +1223,12 @@ public:
     m_ts.variable().set_string("long_name", "rate of change of the ice mass in glacierized areas");
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
     double
       ice_density         = m_config->get_number("constants.ice.density"),
       thickness_threshold = m_config->get_number("output.ice_free_thickness_standard");
-    return ice_volume(model->geometry(), thickness_threshold) * ice_density;
+    result = ice_volume_local(model->geometry(), thickness_threshold) * ice_density;
+    return true;
   }
 };
 
@@ -1170,7 +1248,7 @@ public:
                                " (i.e. prescribed ice thickness)");
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
 
     const double
       ice_density = m_config->get_number("constants.ice.density");
@@ -1191,7 +1269,8 @@ public:
     }
 
     // (kg/m^3) * m^3 = kg
-    return ice_density * GlobalSum(m_grid->com, volume_change);
+    result = ice_density * volume_change;
+    return true;
   }
 };
 
@@ -1207,9 +1286,10 @@ public:
                                "rate of change of the mass of ice, including seasonal cover");
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
     const double ice_density = m_config->get_number("constants.ice.density");
-    return ice_volume(model->geometry(), 0.0) * ice_density;
+    result = ice_volume_local(model->geometry(), 0.0) * ice_density;
+    return true;
   }
 };
 
@@ -1371,9 +1451,10 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
-    return ice_area_grounded(model->geometry(),
-                             m_config->get_number("output.ice_free_thickness_standard"));
+  bool compute_local_sum(double &result) {
+    result = ice_area_grounded_local(model->geometry(),
+                                     m_config->get_number("output.ice_free_thickness_standard"));
+    return true;
   }
 };
 
@@ -1394,9 +1475,10 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
-    return ice_area_floating(model->geometry(),
-                             m_config->get_number("output.ice_free_thickness_standard"));
+  bool compute_local_sum(double &result) {
+    result = ice_area_floating_local(model->geometry(),
+                                     m_config->get_number("output.ice_free_thickness_standard"));
+    return true;
   }
 };
 
@@ -1412,7 +1494,7 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
     const IceModelVec2CellType &cell_type = model->geometry().cell_type;
 
     const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
@@ -1434,7 +1516,8 @@ public:
       }
     }
 
-    return GlobalSum(m_grid->com, volume);
+    result = volume;
+    return true;
   }
 };
 
@@ -1450,7 +1533,7 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
     const IceModelVec2CellType &cell_type = model->geometry().cell_type;
 
     const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
@@ -1472,7 +1555,8 @@ public:
       }
     }
 
-    return GlobalSum(m_grid->com, volume);
+    result = volume;
+    return true;
   }
 };
 
@@ -1542,7 +1626,8 @@ public:
 };
 
 /*!
- * Return total mass change due to one of the terms in the mass continuity equation.
+ * Return the mass change in the sub-domain owned by this rank due to one of the terms in
+ * the mass continuity equation.
  *
  * Possible terms are
  *
@@ -1565,7 +1650,7 @@ public:
  * special case used when `term == FLOW`. (Note that surface and basal
  * mass balances do not affect the area specific volume field.)
  */
-double mass_change(const IceModel *model, TermType term, AreaType area) {
+double mass_change_local(const IceModel *model, TermType term, AreaType area) {
   const IceGrid &grid = *model->grid();
   const Config &config = *grid.ctx()->config();
 
@@ -1619,7 +1704,7 @@ double mass_change(const IceModel *model, TermType term, AreaType area) {
   }
 
   // (kg / m^3) * m^3 = kg
-  return ice_density * GlobalSum(grid.com, volume_change);
+  return ice_density * volume_change;
 }
 
 //! \brief Reports the total bottom surface ice flux.
@@ -1639,8 +1724,9 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
-    return mass_change(model, BMB, BOTH);
+  bool compute_local_sum(double &result) {
+    result = mass_change_local(model, BMB, BOTH);
+    return true;
   }
 };
 
@@ -1661,8 +1747,9 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
-    return mass_change(model, SMB, BOTH);
+  bool compute_local_sum(double &result) {
+    result = mass_change_local(model, SMB, BOTH);
+    return true;
   }
 };
 
@@ -1679,8 +1766,9 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
-    return mass_change(model, BMB, GROUNDED);
+  bool compute_local_sum(double &result) {
+    result = mass_change_local(model, BMB, GROUNDED);
+    return true;
   }
 };
 
@@ -1701,8 +1789,9 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
-    return mass_change(model, BMB, SHELF);
+  bool compute_local_sum(double &result) {
+    result = mass_change_local(model, BMB, SHELF);
+    return true;
   }
 };
 
@@ -1720,8 +1809,9 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
-    return mass_change(model, ERROR, BOTH);
+  bool compute_local_sum(double &result) {
+    result = mass_change_local(model, ERROR, BOTH);
+    return true;
   }
 };
 
@@ -1744,7 +1834,7 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
     const double ice_density = m_config->get_number("constants.ice.density");
 
     const IceModelVec2S &calving = model->calving();
@@ -1764,7 +1854,8 @@ public:
     }
 
     // (kg/m^3) * m^3 = kg
-    return ice_density * GlobalSum(m_grid->com, volume_change);
+    result = ice_density * volume_change;
+    return true;
   }
 };
 
@@ -1785,7 +1876,7 @@ public:
     m_ts.variable().set_string("comment", "positive means ice gain");
   }
 
-  double compute() {
+  bool compute_local_sum(double &result) {
     const double ice_density = m_config->get_number("constants.ice.density");
 
     const IceModelVec2S &calving = model->calving();
@@ -1803,7 +1894,8 @@ public:
     }
 
     // (kg/m^3) * m^3 = kg
-    return ice_density * GlobalSum(m_grid->com, volume_change);
+    result = ice_density * volume_change;
+    return true;
   }
 };
 
@@ -1867,7 +1959,7 @@ public:
 protected:
   IceModelVec::Ptr compute_impl() const {
 
-    IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "dHdt", WITHOUT_GHOSTS));
+    IceModelVec2S::Ptr result = m_pool->scalar("dHdt");
     result->metadata() = m_vars[0];
 
     if (m_interval_length > 0.0) {
@@ -1905,6 +1997,8 @@ protected:
   virtual IceModelVec::Ptr compute_impl() const;
 protected:
   std::string m_var_name, m_proj_string;
+  //! bounds computed by the first call of compute_impl() (they are time-independent)
+  mutable IceModelVec::Ptr m_bounds;
 };
 
 LatLonBounds::LatLonBounds(const IceModel *m,
@@ -1946,6 +2040,12 @@ LatLonBounds::LatLonBounds(const IceModel *m,
 }
 
 IceModelVec::Ptr LatLonBounds::compute_impl() const {
+  // Bounds depend on the grid and the projection only: compute them once to avoid
+  // re-running coordinate transformations every time they are written.
+  if (m_bounds) {
+    return m_bounds;
+  }
+
   std::map<std::string,std::string> attrs;
   std::vector<double> indices(4);
 
@@ -1964,6 +2064,8 @@ IceModelVec::Ptr LatLonBounds::compute_impl() const {
     compute_lon_bounds(m_proj_string, *result);
   }
 
+  m_bounds = result;
+
   return result;
 }
 
@@ -1985,7 +2087,7 @@ IceAreaFraction::IceAreaFraction(const IceModel *m)
 
 IceModelVec::Ptr IceAreaFraction::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, land_ice_area_fraction_name, WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar(land_ice_area_fraction_name);
   result->metadata(0) = m_vars[0];
 
   const IceModelVec2S
@@ -2063,7 +2165,7 @@ IceAreaFractionGrounded::IceAreaFractionGrounded(const IceModel *m)
 }
 
 IceModelVec::Ptr IceAreaFractionGrounded::compute_impl() const {
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, grounded_ice_sheet_area_fraction_name, WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar(grounded_ice_sheet_area_fraction_name);
   result->metadata() = m_vars[0];
 
   const double
@@ -2159,7 +2261,7 @@ HeightAboveFloatation::HeightAboveFloatation(const IceModel *m)
 
 IceModelVec::Ptr HeightAboveFloatation::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "height_above_flotation", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("height_above_flotation");
   result->metadata(0) = m_vars[0];
 
   const IceModelVec2CellType &cell_type = model->geometry().cell_type;
@@ -2223,7 +2325,7 @@ IceMass::IceMass(const IceModel *m)
 
 IceModelVec::Ptr IceMass::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "ice_mass", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("ice_mass");
   result->metadata(0) = m_vars[0];
 
   const IceModelVec2CellType &cell_type = model->geometry().cell_type;
@@ -2294,7 +2396,7 @@ BedTopographySeaLevelAdjusted::BedTopographySeaLevelAdjusted(const IceModel *m)
 
 IceModelVec::Ptr BedTopographySeaLevelAdjusted::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "topg_sl_adjusted", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("topg_sl_adjusted");
   result->metadata(0) = m_vars[0];
 
   auto
@@ -2336,7 +2438,7 @@ IceHardness::IceHardness(const IceModel *m)
 
 IceModelVec::Ptr IceHardness::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "hardness", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("hardness");
   result->metadata(0) = m_vars[0];
 
   EnthalpyConverter::Ptr EC = m_grid->ctx()->enthalpy_converter();
@@ -2403,7 +2505,7 @@ static inline double square(double x) {
 
 IceModelVec::Ptr IceViscosity::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "effective_viscosity", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("effective_viscosity");
   result->metadata(0) = m_vars[0];
 
   IceModelVec3 W(m_grid, "wvel", WITH_GHOSTS);
@@ -2581,7 +2683,7 @@ public:
 protected:
   IceModelVec::Ptr compute_impl() const {
 
-    IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "thk", WITHOUT_GHOSTS));
+    IceModelVec2S::Ptr result = m_pool->scalar("thk");
     result->metadata(0) = m_vars[0];
 
     result->copy_from(model->geometry().ice_thickness);
@@ -2608,7 +2710,7 @@ public:
 protected:
   IceModelVec::Ptr compute_impl() const {
 
-    IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "ice_base_elevation", WITHOUT_GHOSTS));
+    IceModelVec2S::Ptr result = m_pool->scalar("ice_base_elevation");
     result->metadata(0) = m_vars[0];
 
     ice_bottom_surface(model->geometry(), *result);
@@ -2635,7 +2737,7 @@ public:
 protected:
   IceModelVec::Ptr compute_impl() const {
 
-    IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "usurf", WITHOUT_GHOSTS));
+    IceModelVec2S::Ptr result = m_pool->scalar("usurf");
     result->metadata(0) = m_vars[0];
 
     result->copy_from(model->geometry().ice_surface_elevation);
@@ -2668,6 +2770,13 @@ public:
   }
 
 protected:
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     grounding_line_flux(model->geometry().cell_type,
                         model->geometry_evolution().flux_staggered(),
@@ -2766,6 +2875,7 @@ void IceModel::init_diagnostics() {
 
     // misc
     {"rank", f(new Rank(this))},
+    {"refinement_patches", f(new RefinementPatches(this))},
   };
 
 #if (Pism_USE_PROJ==1)
@@ -173,6 +173,13 @@ public:
   }
 
 protected:
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     const IceModelVec2S
       &dH = model->geometry_evolution().thickness_change_due_to_flow(),
@@ -237,6 +244,13 @@ public:
   }
 
 protected:
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     const IceModelVec2S
       &SMB = model->geometry_evolution().top_surface_mass_balance();
@@ -297,6 +311,13 @@ public:
   }
 
 protected:
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     const IceModelVec2S
       &BMB = model->geometry_evolution().bottom_surface_mass_balance();
@@ -357,6 +378,13 @@ public:
   }
 
 protected:
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     const IceModelVec2S
       &error = model->geometry_evolution().conservation_error();
@@ -421,6 +449,13 @@ public:
   }
 
 protected:
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     const IceModelVec2S &calving = model->calving();
     const IceModelVec2S &frontal_melt = model->frontal_melt();
@@ -486,6 +521,13 @@ public:
   }
 
 protected:
+  bool prepare_update_impl(double dt, AccumulatorUpdate &result) {
+    // this diagnostic is updated by update_impl() below
+    (void) dt;
+    (void) result;
+    return false;
+  }
+
   void update_impl(double dt) {
     const IceModelVec2S &calving = model->calving();
 
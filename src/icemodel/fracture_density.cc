@@ -19,6 +19,7 @@
 #include "IceModel.hh"
 
 #include "pism/energy/EnergyModel.hh"
+#include "pism/stressbalance/StressBalance.hh"
 #include "pism/stressbalance/ShallowStressBalance.hh"
 #include "pism/fracturedensity/FractureDensity.hh"
 
@@ -72,9 +73,14 @@ void IceModel::update_fracture_density() {
 
   // This model has the same time-step restriction as the mass transport code so we don't
   // check if this time step is short enough.
+  //
+  // Strain rates and stresses are computed by the stress balance model and shared with
+  // calving models.
   m_fracture->update(m_dt, m_geometry,
                      m_stress_balance->shallow()->velocity(),
-                     hardness, bc_mask);
+                     m_stress_balance->principal_strain_rates(m_geometry.cell_type),
+                     m_stress_balance->deviatoric_stresses(m_geometry.cell_type, hardness),
+                     bc_mask);
 }
 
 } // end of namespace pism
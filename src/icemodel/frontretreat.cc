@@ -33,6 +33,7 @@
 
 #include "pism/energy/EnergyModel.hh"
 #include "pism/coupler/FrontalMelt.hh"
+#include "pism/stressbalance/StressBalance.hh"
 #include "pism/stressbalance/ShallowStressBalance.hh"
 #include "pism/hydrology/Hydrology.hh"
 #include "pism/frontretreat/util/remove_narrow_tongues.hh"
@@ -51,7 +52,7 @@ void IceModel::front_retreat_step() {
   {
     if (m_eigen_calving) {
       m_eigen_calving->update(m_geometry.cell_type,
-                              m_stress_balance->shallow()->velocity());
+                              m_stress_balance->principal_strain_rates(m_geometry.cell_type));
     }
 
     if (m_hayhurst_calving) {
@@ -67,6 +68,7 @@ void IceModel::front_retreat_step() {
       m_vonmises_calving->update(m_geometry.cell_type,
                                  m_geometry.ice_thickness,
                                  m_stress_balance->shallow()->velocity(),
+                                 m_stress_balance->principal_strain_rates(m_geometry.cell_type),
                                  m_energy_model->enthalpy());
     }
 
@@ -58,8 +58,10 @@
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/io/io_helpers.hh"
+#include "pism/util/io/autotune.hh"
 #include "pism/util/projection.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/MemoryUsage.hh"
 #include "pism/age/AgeModel.hh"
 #include "pism/energy/EnthalpyModel.hh"
 #include "pism/energy/TemperatureModel.hh"
@@ -340,9 +342,8 @@ void IceModel::restart_2d(const File &input_file, unsigned int last_record) {
 
   m_log->message(2, "initializing 2D fields from NetCDF file '%s'...\n", filename.c_str());
 
-  for (auto variable : m_model_state) {
-    variable->read(input_file, last_record);
-  }
+  std::vector<IceModelVec*> fields(m_model_state.begin(), m_model_state.end());
+  read_fields(input_file, last_record, fields);
 }
 
 void IceModel::bootstrap_2d(const File &input_file) {
@@ -647,30 +648,59 @@ void IceModel::allocate_basal_yield_stress() {
   setting up the coupling or filling model-state variables.
  */
 void IceModel::allocate_submodels() {
+  const MemoryUsage &memory = m_ctx->memory_usage();
 
-  allocate_geometry_evolution();
+  {
+    MemoryOwner owner(memory, "geometry_evolution");
+    allocate_geometry_evolution();
+  }
 
-  allocate_iceberg_remover();
+  {
+    MemoryOwner owner(memory, "iceberg_remover");
+    allocate_iceberg_remover();
+  }
 
-  allocate_stressbalance();
+  {
+    MemoryOwner owner(memory, "stress_balance");
+    allocate_stressbalance();
+  }
 
   // this has to happen *after* allocate_stressbalance()
   {
-    allocate_age_model();
-    allocate_energy_model();
-    allocate_subglacial_hydrology();
+    {
+      MemoryOwner owner(memory, "age");
+      allocate_age_model();
+    }
+    {
+      MemoryOwner owner(memory, "energy");
+      allocate_energy_model();
+    }
+    {
+      MemoryOwner owner(memory, "hydrology");
+      allocate_subglacial_hydrology();
+    }
   }
 
   // this has to happen *after* allocate_subglacial_hydrology()
-  allocate_basal_yield_stress();
+  {
+    MemoryOwner owner(memory, "basal_yield_stress");
+    allocate_basal_yield_stress();
+  }
 
-  allocate_bedrock_thermal_unit();
+  {
+    MemoryOwner owner(memory, "bedrock_thermal_unit");
+    allocate_bedrock_thermal_unit();
+  }
 
-  allocate_bed_deformation();
+  {
+    MemoryOwner owner(memory, "bed_deformation");
+    allocate_bed_deformation();
+  }
 
   allocate_couplers();
 
   if (m_config->get_flag("fracture_density.enabled")) {
+    MemoryOwner owner(memory, "fracture_density");
     m_fracture.reset(new FractureDensity(m_grid, m_stress_balance->shallow()->flow_law()));
     m_submodels["fracture_density"] = m_fracture.get();
   }
@@ -684,6 +714,8 @@ void IceModel::allocate_couplers() {
 
     m_log->message(2, "# Allocating a surface process model or coupler...\n");
 
+    MemoryOwner owner(m_ctx->memory_usage(), "surface");
+
     surface::Factory ps(m_grid, atmosphere::Factory(m_grid).create());
 
     m_surface.reset(new surface::InitializationHelper(m_grid, ps.create()));
@@ -694,6 +726,8 @@ void IceModel::allocate_couplers() {
   if (not m_sea_level) {
     m_log->message(2, "# Allocating sea level forcing...\n");
 
+    MemoryOwner owner(m_ctx->memory_usage(), "sea_level");
+
     using namespace ocean::sea_level;
 
     m_sea_level.reset(new InitializationHelper(m_grid, Factory(m_grid).create()));
@@ -704,6 +738,8 @@ void IceModel::allocate_couplers() {
   if (not m_ocean) {
     m_log->message(2, "# Allocating an ocean model or coupler...\n");
 
+    MemoryOwner owner(m_ctx->memory_usage(), "ocean");
+
     using namespace ocean;
 
     m_ocean.reset(new InitializationHelper(m_grid, Factory(m_grid).create()));
@@ -743,6 +779,13 @@ void IceModel::misc_setup() {
     }
   }
 
+  if (m_config->get_string("output.format") == "auto") {
+    m_config->set_string("output.format",
+                         io::fastest_output_format(m_grid,
+                                                   m_config->get_string("output.file_name"),
+                                                   m_config->get_string("output.autotune_cache")));
+  }
+
   {
     // A single record of a time-dependent variable cannot exceed 2^32-4
     // bytes in size. See the NetCDF User's Guide
@@ -776,10 +819,25 @@ void IceModel::misc_setup() {
   }
 #endif
 
-  init_calving();
-  init_frontal_melt();
-  init_front_retreat();
-  init_diagnostics();
+  {
+    const MemoryUsage &memory = m_ctx->memory_usage();
+    {
+      MemoryOwner owner(memory, "calving");
+      init_calving();
+    }
+    {
+      MemoryOwner owner(memory, "frontal_melt");
+      init_frontal_melt();
+    }
+    {
+      MemoryOwner owner(memory, "front_retreat");
+      init_front_retreat();
+    }
+    {
+      MemoryOwner owner(memory, "diagnostics");
+      init_diagnostics();
+    }
+  }
   init_snapshots();
   init_backups();
   init_timeseries();
@@ -37,6 +37,7 @@
 #include "pism/util/Profiling.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/projection.hh"
+#include "pism/util/Decimation.hh"
 #include "pism/util/Component.hh"
 #include "pism/energy/utilities.hh"
 
@@ -113,6 +114,11 @@ void IceModel::save_results() {
     prepend_history(str);
   }
 
+  if (m_preempted) {
+    m_log->message(2, "Not writing the output file: the model state was saved to a preemption checkpoint.\n");
+    return;
+  }
+
   std::string filename = m_config->get_string("output.file_name");
 
   if (filename.empty()) {
@@ -134,12 +140,16 @@ void IceModel::save_results() {
               filename,
               string_to_backend(m_config->get_string("output.format")),
               PISM_READWRITE_MOVE,
-              m_ctx->pio_iosys_id());
+              m_ctx->pio_iosys_id(),
+              m_ctx->netcdf3_n_aggregators());
+    file.set_chunking(string_to_chunking(m_config->get_string("output.chunking")));
+    file.set_compression_level(m_config->get_number("output.compression_level"));
+    set_output_types(file);
+    set_ice_columns(file);
+    file.set_header_padding(m_config->get_number("output.header_padding") * 1024);
 
     write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
 
-    write_run_stats(file);
-
     save_variables(file, INCLUDE_MODEL_STATE, m_output_vars,
                    m_time->current());
   }
@@ -164,6 +174,60 @@ void IceModel::write_mapping(const File &file) {
   }
 }
 
+/*!
+ * Override output types of variables listed in output.variable_types, a comma-separated list
+ * of "name:type" pairs, e.g. "temp:double,thk:float".
+ */
+void IceModel::set_output_types(File &file) const {
+  for (auto entry : split(m_config->get_string("output.variable_types"), ',')) {
+    auto parts = split(entry, ':');
+
+    if (parts.size() != 2) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid entry '%s' in output.variable_types"
+                                    " (expected 'name:type')",
+                                    entry.c_str());
+    }
+
+    try {
+      file.set_output_type(parts[0], string_to_type(parts[1]));
+    } catch (RuntimeError &e) {
+      e.add_context("processing output.variable_types");
+      throw;
+    }
+  }
+}
+
+/*!
+ * Write 3D variables listed in output.gathered_3d_variables in ice-covered columns only,
+ * keeping levels at and below the ice surface.
+ */
+void IceModel::set_ice_columns(File &file) const {
+  auto variables = split(m_config->get_string("output.gathered_3d_variables"), ',');
+  if (variables.empty()) {
+    return;
+  }
+
+  const IceModelVec2S &ice_thickness = m_geometry.ice_thickness;
+
+  std::vector<int> n_levels(m_grid->xm() * m_grid->ym(), 0);
+
+  IceModelVec::AccessList list{&ice_thickness};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double H = ice_thickness(i, j);
+
+    if (H > 0.0) {
+      n_levels[(j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs())] =
+        m_grid->kBelowHeight(H) + 1;
+    }
+  }
+
+  file.set_ice_columns(variables, n_levels);
+}
+
 void IceModel::write_run_stats(const File &file) {
   update_run_stats();
   if (not file.find_variable(m_run_stats.get_name())) {
@@ -176,15 +240,43 @@ void IceModel::save_variables(const File &file,
                               OutputKind kind,
                               const std::set<std::string> &variables,
                               double time,
-                              IO_Type default_diagnostics_type) {
+                              const Decimation *decimation) {
+
+  define_variables(file, kind, variables, decimation);
+
+  // Done defining variables and attributes; append to the time dimension
+  io::append_time(file, *m_config, time);
+
+  if (kind == INCLUDE_MODEL_STATE) {
+    write_model_state(file);
+  }
+  write_diagnostics(file, variables, decimation);
+
+  // find out how much time passed since the beginning of the run and save it to the output file
+  {
+    unsigned int time_length = file.dimension_length(m_config->get_string("time.dimension_name"));
+    size_t start = time_length > 0 ? static_cast<size_t>(time_length - 1) : 0;
+    io::write_timeseries(file, m_timestamp, start,
+                         wall_clock_hours(m_grid->com, m_start_time));
+  }
+}
+
+//! Define variables written by save_variables() (a no-op for variables defined already).
+void IceModel::define_variables(const File &file,
+                                OutputKind kind,
+                                const std::set<std::string> &variables,
+                                const Decimation *decimation) {
+
+  IO_Type default_diagnostics_type = string_to_type(m_config->get_string("output.diagnostics_type"));
+
+  // Define everything before writing any data: with NetCDF-3 files, adding variables after
+  // data were written may force the library to move all data in the file.
 
   // define the time dimension if necessary (no-op if it is already defined)
   io::define_time(file, *m_grid->ctx());
   // define the "timestamp" (wall clock time since the beginning of the run)
   // Note: it is time-dependent, so we need to define time first.
   io::define_timeseries(m_timestamp, file, PISM_FLOAT);
-  // append to the time dimension
-  io::append_time(file, *m_config, time);
 
   // Write metadata *before* everything else:
   //
@@ -192,14 +284,18 @@ void IceModel::save_variables(const File &file,
   // about 2^16 attribute modifications per variable. :-(
   write_run_stats(file);
 
+  unsigned int n_variables = file.nvariables();
+
   if (kind == INCLUDE_MODEL_STATE) {
     define_model_state(file);
   }
-  define_diagnostics(file, variables, default_diagnostics_type);
+  define_diagnostics(file, variables, default_diagnostics_type, decimation);
 
   // Done defining variables
 
-  {
+  // Set the "coordinates" attribute if we just defined new variables. (When writing many
+  // records to the same file this saves a number of header updates per record.)
+  if (file.nvariables() != n_variables) {
     // Note: we don't use "variables" (an argument of this method) here because it
     // contains PISM's names of diagnostic quantities which (in some cases) map to more
     // than one NetCDF variable. Moreover, here we're concerned with file contents, not
@@ -234,39 +330,64 @@ void IceModel::save_variables(const File &file,
       }
     }
   }
-
-  if (kind == INCLUDE_MODEL_STATE) {
-    write_model_state(file);
-  }
-  write_diagnostics(file, variables);
-
-  // find out how much time passed since the beginning of the run and save it to the output file
-  {
-    unsigned int time_length = file.dimension_length(m_config->get_string("time.dimension_name"));
-    size_t start = time_length > 0 ? static_cast<size_t>(time_length - 1) : 0;
-    io::write_timeseries(file, m_timestamp, start,
-                         wall_clock_hours(m_grid->com, m_start_time));
-  }
 }
 
+//! Define diagnostics listed in `variables`, using the grid of `decimation` if it is not NULL.
 void IceModel::define_diagnostics(const File &file, const std::set<std::string> &variables,
-                                  IO_Type default_type) {
+                                  IO_Type default_type, const Decimation *decimation) {
   for (auto variable : variables) {
     auto diag = m_diagnostics.find(variable);
 
-    if (diag != m_diagnostics.end()) {
+    if (diag == m_diagnostics.end()) {
+      continue;
+    }
+
+    if (decimation != nullptr) {
+      for (unsigned int k = 0; k < diag->second->n_variables(); ++k) {
+        decimation->define(diag->second->metadata(k), file, default_type);
+      }
+    } else {
       diag->second->define(file, default_type);
     }
   }
 }
 
+//! Returns true if all variables of `diagnostic` are time-independent and were written to
+//! `file` already.
+static bool written_already(Diagnostic &diagnostic, const File &file) {
+  for (unsigned int k = 0; k < diagnostic.n_variables(); ++k) {
+    if (not io::time_independent_written(diagnostic.metadata(k), file)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 //! \brief Writes variables listed in vars to filename, using nctype to write
 //! fields stored in dedicated IceModelVecs.
-void IceModel::write_diagnostics(const File &file, const std::set<std::string> &variables) {
+/*!
+ * If `decimation` is not NULL, diagnostics are coarsened (or cropped) before writing.
+ */
+void IceModel::write_diagnostics(const File &file, const std::set<std::string> &variables,
+                                 const Decimation *decimation) {
+  // diagnostics computed using other diagnostics re-use their results
+  Diagnostic::OutputEvent event(m_grid);
+
   for (auto variable : variables) {
     auto diag = m_diagnostics.find(variable);
 
-    if (diag != m_diagnostics.end()) {
+    if (diag == m_diagnostics.end()) {
+      continue;
+    }
+
+    // time-independent diagnostics are written once per file: don't re-compute them
+    if (written_already(*diag->second, file)) {
+      continue;
+    }
+
+    if (decimation != nullptr) {
+      decimation->write(*diag->second->compute(), file);
+    } else {
       diag->second->compute()->write(file);
     }
   }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2019 PISM Authors
+/* Copyright (C) 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -21,6 +21,7 @@
 
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/partitioning.hh"
 
 namespace pism {
 
@@ -30,9 +31,12 @@ void IceModel::init_backups() {
   std::string backup_file = m_config->get_string("output.file_name");
   if (not backup_file.empty()) {
     m_backup_filename = filename_add_suffix(backup_file, "_backup", "");
+    m_backup_increment_filename = filename_add_suffix(backup_file, "_backup_increment", "");
   } else {
     m_backup_filename = "pism_backup.nc";
+    m_backup_increment_filename = "pism_backup_increment.nc";
   }
+  m_backup_checksums.clear();
 
   m_backup_vars = output_variables(m_config->get_string("output.backup_size"));
   m_last_backup_time = 0.0;
@@ -53,25 +57,61 @@ void IceModel::write_backup() {
 
   m_last_backup_time = wall_clock_hours;
 
+  // Incremental backups: the first backup contains everything; later ones are written to
+  // a different file and contain only the fields that changed since the first one.
+  const bool
+    incremental = m_config->get_flag("output.backup_incremental"),
+    increment   = incremental and not m_backup_checksums.empty();
+
+  const std::string &filename = increment ? m_backup_increment_filename : m_backup_filename;
+
   // create a history string:
 
   m_log->message(2,
                  "  [%s] Saving an automatic backup to '%s' (%1.3f hours after the beginning of the run)\n",
-                 timestamp(m_grid->com).c_str(), m_backup_filename.c_str(), wall_clock_hours);
+                 timestamp(m_grid->com).c_str(), filename.c_str(), wall_clock_hours);
+
+  std::string format = m_config->get_string("output.backup_format");
+  if (format == "default") {
+    format = m_config->get_string("output.format");
+  }
 
   double backup_start_time = get_time();
   profiling.begin("io.backup");
   {
     File file(m_grid->com,
-              m_backup_filename,
-              string_to_backend(m_config->get_string("output.format")),
+              filename,
+              string_to_backend(format),
               PISM_READWRITE_MOVE,
-              m_ctx->pio_iosys_id());
+              m_ctx->pio_iosys_id(),
+              m_ctx->netcdf3_n_aggregators());
+    file.set_chunking(string_to_chunking(m_config->get_string("output.chunking")));
+    file.set_compression_level(m_config->get_number("output.compression_level"));
+    set_output_types(file);
+    file.set_header_padding(m_config->get_number("output.header_padding") * 1024);
+
+    if (incremental) {
+      if (increment) {
+        file.set_checkpoint(m_backup_filename, m_backup_checksums);
+      } else {
+        file.set_checkpoint("", {});
+      }
+    }
 
     write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
     write_run_stats(file);
 
+    if (increment) {
+      // the list of fields stored in the base file is given by variable attributes
+      // "pism_checkpoint_base"
+      file.write_attribute("PISM_GLOBAL", "pism_checkpoint_base", m_backup_filename);
+    }
+
     save_variables(file, INCLUDE_MODEL_STATE, m_backup_vars, m_time->current());
+
+    if (incremental and not increment) {
+      m_backup_checksums = file.checksums();
+    }
   }
   profiling.end("io.backup");
   double backup_end_time = get_time();
@@ -85,6 +125,134 @@ void IceModel::write_backup() {
                  backup_end_time - backup_start_time,
                  (backup_end_time - backup_start_time) / 60.0);
 
+  if (m_config->get_string("grid.partitioning.method") == "ice_weighted") {
+    report_load_balance();
+  }
+}
+
+//! Write a preemption checkpoint (see output.preemption.enabled).
+/*!
+ * Called at the end of a time step after a job scheduler sent a signal announcing that the
+ * job is about to be killed. Writes the model state only (no diagnostics and no
+ * compression) using the fastest format available (output.preemption.format) and reports
+ * how long it took.
+ *
+ * Time series are flushed only if writing the checkpoint took less than
+ * output.preemption.time_budget seconds.
+ */
+void IceModel::write_preemption_checkpoint() {
+
+  const double time_budget = m_config->get_number("output.preemption.time_budget");
+
+  std::string filename = m_config->get_string("output.file_name");
+  if (not filename.empty()) {
+    filename = filename_add_suffix(filename, "_checkpoint", "");
+  } else {
+    filename = "pism_checkpoint.nc";
+  }
+
+  std::string format = m_config->get_string("output.preemption.format");
+  if (format == "default") {
+    format = m_config->get_string("output.format");
+  }
+
+  m_log->message(1,
+                 "\n[%s] caught a preemption signal: writing a checkpoint to '%s'"
+                 " (time budget: %.1f seconds)\n",
+                 timestamp(m_grid->com).c_str(), filename.c_str(), time_budget);
+
+  prepend_history(pism::printf("EARLY EXIT caused by a preemption signal. Completed timestep at time=%s.",
+                               m_time->date().c_str()));
+
+  const Profiling &profiling = m_ctx->profiling();
+
+  const double start = GlobalMax(m_grid->com, get_time());
+  profiling.begin("io.preemption");
+  {
+    File file(m_grid->com,
+              filename,
+              string_to_backend(format),
+              PISM_READWRITE_MOVE,
+              m_ctx->pio_iosys_id(),
+              m_ctx->netcdf3_n_aggregators());
+    set_output_types(file);
+
+    write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
+    write_run_stats(file);
+
+    save_variables(file, INCLUDE_MODEL_STATE, {}, m_time->current());
+  }
+  profiling.end("io.preemption");
+  const double latency = GlobalMax(m_grid->com, get_time()) - start;
+
+  m_preempted = true;
+
+  if (latency <= time_budget) {
+    // there is time left: make time series cover the whole run
+    flush_timeseries();
+
+    m_log->message(1,
+                   "[%s] Done writing the checkpoint in %.3f seconds (%.0f%% of the time budget).\n",
+                   timestamp(m_grid->com).c_str(), latency, 100.0 * latency / time_budget);
+  } else {
+    m_log->message(1,
+                   "PISM WARNING: writing the checkpoint took %.3f seconds,"
+                   " exceeding the time budget of %.1f seconds.\n"
+                   "              Time series were not flushed.\n",
+                   latency, time_budget);
+  }
+}
+
+static std::string ranges_to_string(const std::vector<unsigned int> &ranges) {
+  std::vector<std::string> result;
+  for (auto r : ranges) {
+    result.push_back(pism::printf("%d", r));
+  }
+  return join(result, ",");
+}
+
+//! Report the load imbalance corresponding to the current ice extent.
+/*!
+ * Re-computes ownership ranges using the current ice thickness and reports the load
+ * imbalance of the current and re-partitioned grids. If re-partitioning helps, prints
+ * -procs_x and -procs_y to use when re-starting from the backup file.
+ *
+ * Note that this does not change the grid used by the model: all components keep a
+ * pointer to the grid they were created with.
+ */
+void IceModel::report_load_balance() {
+  if (m_grid->size() == 1) {
+    return;
+  }
+
+  double icy_cell_cost = m_config->get_number("grid.partitioning.icy_cell_cost");
+
+  IceModelVec2S cost(m_grid, "column_cost", WITHOUT_GHOSTS);
+  column_cost(m_geometry.ice_thickness, icy_cell_cost, cost);
+
+  IceGrid::Ptr grid = weighted_grid(*m_grid, cost);
+
+  IceModelVec2S new_cost(grid, "column_cost", WITHOUT_GHOSTS);
+  migrate(cost, new_cost);
+
+  double
+    imbalance     = load_imbalance(cost),
+    new_imbalance = load_imbalance(new_cost);
+
+  m_log->message(2,
+                 "  Load imbalance (max/mean cost per process): %.3f (current), %.3f (re-partitioned)\n",
+                 imbalance, new_imbalance);
+
+  if (new_imbalance < imbalance) {
+    GridParameters P = grid_parameters(*grid);
+
+    m_log->message(2,
+                   "  To use the re-partitioned grid, re-start from '%s' using\n"
+                   "    -procs_x %s -procs_y %s\n",
+                   m_backup_filename.c_str(),
+                   ranges_to_string(P.procs_x).c_str(),
+                   ranges_to_string(P.procs_y).c_str());
+  }
 }
 
 } // end of namespace pism
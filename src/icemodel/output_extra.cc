@@ -22,11 +22,22 @@
 #include <netcdf_meta.h>
 #endif
 
+#include <cstdlib>              // strtol, strtod
+#include <fstream>
+#include <iterator>             // std::istreambuf_iterator
+#include <algorithm>            // std::min, std::max, std::copy
+#include <limits>
+
 #include "IceModel.hh"
 
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/MemoryUsage.hh"
+#include "pism/util/Decimation.hh"
+#include "pism/util/io/ADIOS2Stream.hh"
+#include "pism/util/io/io_helpers.hh"
+#include "pism/util/petscwrappers/Vec.hh"
 
 namespace pism {
 
@@ -41,6 +52,77 @@ MaxTimestep IceModel::extras_max_timestep(double my_t) {
   return reporting_max_timestep(m_extra_times, my_t, "reporting (-extra_times)");
 }
 
+/*!
+ * Set numbers of significant digits to keep using a comma-separated list of "name:N"
+ * pairs and (possibly) one number without a name (the default for all other variables).
+ */
+static void set_significant_digits(const std::string &list, File &file) {
+  for (const auto &entry : split(list, ',')) {
+    auto words = split(entry, ':');
+
+    std::string name, digits;
+    if (words.size() == 1) {
+      digits = words[0];
+    } else if (words.size() == 2) {
+      name   = words[0];
+      digits = words[1];
+    } else {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid entry '%s' in output.extra.significant_digits",
+                                    entry.c_str());
+    }
+
+    char *endptr = NULL;
+    long int N = strtol(digits.c_str(), &endptr, 10);
+    if (digits.empty() or *endptr != '\0' or N < 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid number of significant digits in '%s'"
+                                    " (output.extra.significant_digits)",
+                                    entry.c_str());
+    }
+
+    file.set_significant_digits(name, N);
+  }
+}
+
+//! Returns the file name `filename` without the ".nc" suffix.
+static std::string extra_prefix(const std::string &filename) {
+  if (ends_with(filename, ".nc")) {
+    return filename.substr(0, filename.size() - 3);
+  }
+  return filename;
+}
+
+//! Parse output.extra.region ("x_min,x_max,y_min,y_max"). An empty string selects the whole domain.
+static std::vector<double> parse_region(const std::string &region) {
+  const double inf = std::numeric_limits<double>::infinity();
+
+  if (region.empty()) {
+    return {-inf, inf, -inf, inf};
+  }
+
+  std::vector<double> result;
+  for (auto entry : split(region, ',')) {
+    char *endptr = NULL;
+    double value = strtod(entry.c_str(), &endptr);
+    if (entry.empty() or *endptr != '\0') {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid number '%s' in output.extra.region",
+                                    entry.c_str());
+    }
+    result.push_back(value);
+  }
+
+  if (result.size() != 4 or result[0] >= result[1] or result[2] >= result[3]) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "output.extra.region has to have the form"
+                                  " 'x_min,x_max,y_min,y_max' (got '%s')",
+                                  region.c_str());
+  }
+
+  return result;
+}
+
 static std::set<std::string> process_extra_shortcuts(const Config &config,
                                                      const std::set<std::string> &input) {
   std::set<std::string> result = input;
@@ -179,16 +261,20 @@ void IceModel::init_extras() {
     }
   }
 
-  m_save_extra          = true;
-  m_extra_file_is_ready = false;
-  m_split_extra         = false;
+  m_save_extra                     = true;
+  m_extra_file_is_ready            = false;
+  m_split_extra                    = false;
+  m_extra_time_independent_written = false;
+  m_extra_file_per_variable        = m_config->get_flag("output.extra.file_per_variable");
+  m_extra_template_ready           = false;
 
   if (split) {
     m_split_extra = true;
     m_log->message(2, "saving spatial time-series to '%s+year.nc'; ",
                m_extra_filename.c_str());
   } else {
-    if (not ends_with(m_extra_filename, ".nc")) {
+    if (not ends_with(m_extra_filename, ".nc") and
+        not io::ADIOS2Stream::is_stream(m_extra_filename)) {
       m_log->message(2,
                  "PISM WARNING: spatial time-series file name '%s' does not have the '.nc' suffix!\n",
                  m_extra_filename.c_str());
@@ -227,6 +313,314 @@ void IceModel::init_extras() {
     m_log->message(2,
                    "PISM WARNING: output.extra.vars was not set. Writing the model state...\n");
   } // end of the else clause after "if (extra_vars_set)"
+
+  int factor = m_config->get_number("output.extra.coarsening_factor");
+  std::string region = m_config->get_string("output.extra.region");
+
+  if (factor < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "output.extra.coarsening_factor has to be positive (got %d)",
+                                  factor);
+  }
+
+  if (factor > 1 or not region.empty()) {
+    if (m_extra_vars.empty()) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "please set output.extra.vars to coarsen or crop spatially-variable"
+                         " diagnostics (the model state cannot be saved on a different grid)");
+    }
+
+    std::vector<double> bounds = parse_region(region);
+    auto method = string_to_decimation_method(m_config->get_string("output.extra.coarsening_method"));
+
+    m_extra_decimation.reset(new Decimation(m_grid, factor, method,
+                                            bounds[0], bounds[1], bounds[2], bounds[3]));
+
+    IceGrid::ConstPtr grid = m_extra_decimation->grid();
+    m_log->message(2,
+                   "saving diagnostics on a %d x %d grid (dx = %.3f km, dy = %.3f km)\n",
+                   grid->Mx(), grid->My(), grid->dx() / 1000.0, grid->dy() / 1000.0);
+  }
+
+  if (m_extra_file_per_variable) {
+    if (m_extra_vars.empty()) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "please set output.extra.vars to write one file per variable"
+                         " (output.extra.file_per_variable)");
+    }
+
+    if (m_extra_decimation) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "output.extra.file_per_variable does not support coarsening or cropping"
+                         " (output.extra.coarsening_factor and output.extra.region)");
+    }
+
+    m_log->message(2, "writing each diagnostic to a separate file ('%s_NAME.nc')\n",
+                   extra_prefix(m_extra_filename).c_str());
+  }
+}
+
+//! Returns true if all variables of `diagnostic` are time-independent.
+static bool time_independent(Diagnostic &diagnostic) {
+  for (unsigned int k = 0; k < diagnostic.n_variables(); ++k) {
+    if (not diagnostic.metadata(k).get_time_independent()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! Write each diagnostic in `variables` to a separate file `prefix_NAME.nc`.
+/*!
+ * Files are assigned to `output.extra.file_per_variable_writers` writers spread evenly
+ * over the communicator, so that each writer leads a disjoint group of ranks. All ranks
+ * send their patches of a diagnostic to the writer owning its file. Writers assemble
+ * these patches and write their files concurrently, using files opened on
+ * `MPI_COMM_SELF`, instead of all ranks writing each file in turn.
+ */
+void IceModel::write_extras_per_variable(const std::string &prefix,
+                                         const std::set<std::string> &variables,
+                                         double time, const std::vector<double> &time_bounds) {
+  MPI_Comm com = m_grid->com;
+
+  int rank = 0, size = 1;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  std::vector<std::string> names;
+  for (const auto &v : variables) {
+    if (m_diagnostics.find(v) != m_diagnostics.end()) {
+      names.push_back(v);
+    }
+  }
+
+  int n_writers = m_config->get_number("output.extra.file_per_variable_writers");
+  if (n_writers <= 0) {
+    n_writers = names.size();
+  }
+  n_writers = std::max(1, std::min(n_writers, size));
+
+  // sub-domains of all ranks: xs, xm, ys, ym
+  std::vector<int> corners(4 * size);
+  {
+    int local[4] = {m_grid->xs(), m_grid->xm(), m_grid->ys(), m_grid->ym()};
+    MPI_Allgather(local, 4, MPI_INT, corners.data(), 4, MPI_INT, com);
+  }
+
+  // patches sent to writers and metadata of variables written by this rank
+  std::vector<std::vector<double> > patches(names.size());
+  std::vector<MPI_Request> requests(names.size());
+  std::vector<std::vector<SpatialVariableMetadata> > metadata(names.size());
+  std::vector<unsigned int> block_size(names.size());
+
+  {
+    // diagnostics computed using other diagnostics re-use their results
+    Diagnostic::OutputEvent event(m_grid);
+
+    for (unsigned int d = 0; d < names.size(); ++d) {
+      auto vec = m_diagnostics[names[d]]->compute();
+
+      const int writer = (d % n_writers) * size / n_writers;
+
+      // values per grid point (see IceModelVec::copy_to_vec())
+      block_size[d] = std::max((size_t)vec->ndof(), vec->levels().size());
+
+      {
+        petsc::TemporaryGlobalVec tmp(vec->dm());
+        vec->copy_to_vec(vec->dm(), tmp);
+
+        petsc::VecArray tmp_array(tmp);
+        const double *values = tmp_array.get();
+        patches[d].assign(values, values + m_grid->xm() * m_grid->ym() * block_size[d]);
+      }
+
+      if (rank == writer) {
+        for (unsigned int c = 0; c < vec->ndof(); ++c) {
+          metadata[d].push_back(vec->metadata(c));
+        }
+      }
+
+      MPI_Isend(patches[d].data(), patches[d].size(), MPI_DOUBLE, writer, d, com,
+                &requests[d]);
+    }
+  }
+
+  IO_Backend backend = string_to_backend(m_config->get_string("output.format"));
+  if (backend != PISM_NETCDF4_PARALLEL) {
+    // other backends are either parallel (and use the whole communicator) or rely on
+    // helper ranks
+    backend = PISM_NETCDF3;
+  }
+
+  IO_Type default_type = string_to_type(m_config->get_string("output.diagnostics_type"));
+  std::string time_name = m_config->get_string("time.dimension_name");
+
+  bool append = m_config->get_flag("output.extra.append");
+  IO_Mode mode = m_extra_file_is_ready or append ? PISM_READWRITE : PISM_READWRITE_MOVE;
+
+  const unsigned int Mx = m_grid->Mx(), My = m_grid->My();
+
+  for (unsigned int d = 0; d < names.size(); ++d) {
+    if (metadata[d].empty()) {
+      continue;                 // written by a different rank
+    }
+
+    const unsigned int block = block_size[d];
+
+    // assemble patches
+    std::vector<double> values(Mx * My * block), patch;
+    for (int r = 0; r < size; ++r) {
+      const int
+        xs = corners[4 * r + 0],
+        xm = corners[4 * r + 1],
+        ys = corners[4 * r + 2],
+        ym = corners[4 * r + 3];
+
+      patch.resize(xm * ym * block);
+      MPI_Recv(patch.data(), patch.size(), MPI_DOUBLE, r, d, com, MPI_STATUS_IGNORE);
+
+      for (int j = 0; j < ym; ++j) {
+        std::copy(patch.data() + j * xm * block, patch.data() + (j + 1) * xm * block,
+                  values.data() + ((ys + j) * Mx + xs) * block);
+      }
+    }
+
+    File file(MPI_COMM_SELF, prefix + "_" + names[d] + ".nc", backend, mode);
+    file.set_compression_level(m_config->get_number("output.compression_level"));
+    set_output_types(file);
+    set_significant_digits(m_config->get_string("output.extra.significant_digits"), file);
+
+    if (not file.find_variable(time_name)) {
+      // a new file
+      io::define_time(file, *m_ctx);
+      file.write_attribute(time_name, "bounds", "time_bounds");
+      io::define_time_bounds(m_extra_bounds, file);
+      write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
+    }
+
+    for (const auto &variable : metadata[d]) {
+      io::define_spatial_variable(variable, *m_grid, file, default_type);
+    }
+
+    io::append_time(file, *m_config, time);
+
+    // variables of a diagnostic with more than one variable are interlaced
+    const unsigned int
+      n_components = metadata[d].size(),
+      n_levels     = block / n_components;
+    std::vector<double> component(Mx * My * n_levels);
+    for (unsigned int c = 0; c < n_components; ++c) {
+      for (unsigned int p = 0; p < Mx * My; ++p) {
+        for (unsigned int k = 0; k < n_levels; ++k) {
+          component[p * n_levels + k] = values[p * block + c * n_levels + k];
+        }
+      }
+      io::write_spatial_variable_serial(metadata[d][c], *m_grid, file, component.data());
+    }
+
+    unsigned int time_length = file.dimension_length(time_name);
+    io::write_time_bounds(file, m_extra_bounds, time_length - 1, time_bounds);
+  }
+
+  MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+}
+
+//! Open the file `filename` used to write spatially-variable diagnostics.
+std::unique_ptr<File> IceModel::open_extra_file(const std::string &filename, IO_Mode mode) const {
+  std::unique_ptr<File> file(new File(m_grid->com,
+                                      filename,
+                                      string_to_backend(m_config->get_string("output.format")),
+                                      mode,
+                                      m_ctx->pio_iosys_id(),
+                                      m_ctx->netcdf3_n_aggregators()));
+  file->set_chunking(string_to_chunking(m_config->get_string("output.extra.chunking")));
+  file->set_compression_level(m_config->get_number("output.compression_level"));
+  set_output_types(*file);
+  file->set_header_padding(m_config->get_number("output.header_padding") * 1024);
+  set_significant_digits(m_config->get_string("output.extra.significant_digits"), *file);
+
+  return file;
+}
+
+//! Define the time dimension, time bounds and global attributes of a new extra file.
+void IceModel::define_extra_file(const File &file,
+                                 const std::string &time_independent_filename) {
+  std::string time_name = m_config->get_string("time.dimension_name");
+
+  io::define_time(file, *m_ctx);
+  file.write_attribute(time_name, "bounds", "time_bounds");
+
+  io::define_time_bounds(m_extra_bounds, file);
+
+  write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
+
+  if (not time_independent_filename.empty()) {
+    file.write_attribute("PISM_GLOBAL", "time_independent_variables_file",
+                         time_independent_filename);
+  }
+}
+
+//! Returns true if split extra files written using `backend` can be copied from a template.
+static bool template_supported(IO_Backend backend, const std::string &filename) {
+  // other backends write asynchronously or do not write files
+  bool file_based = (backend == PISM_NETCDF3 or
+                     backend == PISM_NETCDF4_PARALLEL or
+                     backend == PISM_PNETCDF or
+                     backend == PISM_NETCDF3_AGGREGATED);
+
+  return file_based and not io::ADIOS2Stream::is_stream(filename);
+}
+
+//! Create the split extra file `filename` by copying the template.
+/*!
+ * With output.extra.split every record goes to a new file, but all these files have the
+ * same structure. The template (a file containing all dimensions, variables and
+ * attributes, but no records) is created once, kept in memory on rank 0 and then copied
+ * to each new file, so that only data have to be written.
+ */
+void IceModel::copy_extra_template(const std::string &filename,
+                                   const std::set<std::string> &variables,
+                                   const std::string &time_independent_filename) {
+  int rank = 0;
+  MPI_Comm_rank(m_grid->com, &rank);
+
+  if (not m_extra_template_ready) {
+    std::string template_name = extra_prefix(m_extra_filename) + "_template.nc";
+
+    {
+      auto file = open_extra_file(template_name, PISM_READWRITE_MOVE);
+      define_extra_file(*file, time_independent_filename);
+      define_variables(*file,
+                       m_extra_vars.empty() ? INCLUDE_MODEL_STATE : JUST_DIAGNOSTICS,
+                       variables,
+                       m_extra_decimation.get());
+    }
+
+    if (rank == 0) {
+      std::ifstream input(template_name, std::ios::binary);
+      m_extra_template.assign(std::istreambuf_iterator<char>(input),
+                              std::istreambuf_iterator<char>());
+    }
+
+    io::remove_if_exists(m_grid->com, template_name);
+
+    m_extra_template_ready = true;
+  }
+
+  io::move_if_exists(m_grid->com, filename);
+
+  if (rank == 0) {
+    std::ofstream output(filename, std::ios::binary);
+    output.write(m_extra_template.data(), m_extra_template.size());
+
+    if (not output) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION, "failed to write '%s'",
+                                    filename.c_str());
+    }
+  }
+
+  // make sure the file is complete before other ranks open it
+  MPI_Barrier(m_grid->com);
 }
 
 //! Write spatially-variable diagnostic quantities.
@@ -306,43 +700,89 @@ void IceModel::write_extras() {
                  "saving spatial time-series to %s at %s\n",
                  filename, m_time->date().c_str());
 
+  // In the "split" mode time-independent diagnostics can be written once to a separate
+  // file shared by all the files containing time-dependent ones.
+  std::set<std::string> variables = m_extra_vars;
+  std::string time_independent_filename;
+  if (m_split_extra and m_config->get_flag("output.extra.split_time_independent")) {
+    std::set<std::string> time_independent_vars;
+    for (const auto &v : m_extra_vars) {
+      auto diag = m_diagnostics.find(v);
+      if (diag != m_diagnostics.end() and time_independent(*diag->second)) {
+        time_independent_vars.insert(v);
+      }
+    }
+
+    if (not time_independent_vars.empty()) {
+      for (const auto &v : time_independent_vars) {
+        variables.erase(v);
+      }
+
+      time_independent_filename = m_extra_filename + "_time_independent.nc";
+
+      if (not m_extra_time_independent_written) {
+        m_log->message(3, "saving time-independent diagnostics to %s\n",
+                       time_independent_filename.c_str());
+
+        File file(m_grid->com,
+                  time_independent_filename,
+                  string_to_backend(m_config->get_string("output.format")),
+                  PISM_READWRITE_MOVE,
+                  m_ctx->pio_iosys_id(),
+                  m_ctx->netcdf3_n_aggregators());
+        set_output_types(file);
+        write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
+
+        MemoryOwner owner(m_ctx->memory_usage(), "diagnostics");
+        save_variables(file, JUST_DIAGNOSTICS, time_independent_vars, current_time,
+                       m_extra_decimation.get());
+
+        m_extra_time_independent_written = true;
+      }
+    }
+  }
+
   // default behavior is to move the file aside if it exists already; option allows appending
   bool append = m_config->get_flag("output.extra.append");
   IO_Mode mode = m_extra_file_is_ready or append ? PISM_READWRITE : PISM_READWRITE_MOVE;
 
   const Profiling &profiling = m_ctx->profiling();
   profiling.begin("io.extra_file");
-  {
+  if (m_extra_file_per_variable) {
+    write_extras_per_variable(extra_prefix(filename), variables,
+                              0.5 * (m_last_extra + current_time),
+                              {m_last_extra, current_time});
+    m_extra_file_is_ready = not m_split_extra;
+  } else {
     if (not m_extra_file) {
-      m_extra_file.reset(new File(m_grid->com,
-                                  filename,
-                                  string_to_backend(m_config->get_string("output.format")),
-                                  mode,
-                                  m_ctx->pio_iosys_id()));
+      if (m_split_extra and m_config->get_flag("output.extra.split_template") and
+          template_supported(string_to_backend(m_config->get_string("output.format")),
+                             m_extra_filename)) {
+        copy_extra_template(filename, variables, time_independent_filename);
+        mode = PISM_READWRITE;
+        m_extra_file_is_ready = true;
+      }
+
+      m_extra_file = open_extra_file(filename, mode);
     }
 
     std::string time_name = m_config->get_string("time.dimension_name");
 
     if (not m_extra_file_is_ready) {
-      // Prepare the file:
-      io::define_time(*m_extra_file, *m_ctx);
-      m_extra_file->write_attribute(time_name, "bounds", "time_bounds");
-
-      io::define_time_bounds(m_extra_bounds, *m_extra_file);
-
-      write_metadata(*m_extra_file, WRITE_MAPPING, PREPEND_HISTORY);
+      define_extra_file(*m_extra_file, time_independent_filename);
 
       m_extra_file_is_ready = true;
     }
 
-    write_run_stats(*m_extra_file);
-
-    save_variables(*m_extra_file,
-                   m_extra_vars.empty() ? INCLUDE_MODEL_STATE : JUST_DIAGNOSTICS,
-                   m_extra_vars,
-                   0.5 * (m_last_extra + current_time), // use the mid-point of the
-                                                        // current reporting interval
-                   PISM_FLOAT);
+    {
+      MemoryOwner owner(m_ctx->memory_usage(), "diagnostics");
+      save_variables(*m_extra_file,
+                     m_extra_vars.empty() ? INCLUDE_MODEL_STATE : JUST_DIAGNOSTICS,
+                     variables,
+                     0.5 * (m_last_extra + current_time), // use the mid-point of the
+                                                          // current reporting interval
+                     m_extra_decimation.get());
+    }
 
     // Get the length of the time dimension *after* it is appended to.
     unsigned int time_length = m_extra_file->dimension_length(time_name);
@@ -350,11 +790,21 @@ void IceModel::write_extras() {
 
     io::write_time_bounds(*m_extra_file, m_extra_bounds,
                           time_start, {m_last_extra, current_time});
-    // make sure all changes are written
-    m_extra_file->sync();
+
+    // Make sure all changes are written. Note that the file is closed (and so synchronized)
+    // after each record if m_split_extra is set.
+    int sync_interval = m_config->get_number("output.extra.sync_interval");
+    if (not m_split_extra and sync_interval > 0 and time_length % sync_interval == 0) {
+      m_extra_file->sync();
+    }
   }
   profiling.end("io.extra_file");
 
+  if (m_config->get_flag("output.memory_usage")) {
+    m_ctx->memory_usage().report(m_grid->com, *m_log,
+                                 "at " + m_time->date());
+  }
+
   flush_timeseries();
 
   if (m_split_extra) {
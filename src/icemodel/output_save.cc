@@ -153,21 +153,36 @@ void IceModel::write_snapshot() {
   profiling.begin("io.snapshots");
   IO_Mode mode = m_snapshots_file_is_ready ? PISM_READWRITE : PISM_READWRITE_MOVE;
   {
-    File file(m_grid->com,
-              filename,
-              string_to_backend(m_config->get_string("output.format")),
-              mode,
-              m_ctx->pio_iosys_id());
+    if (m_split_snapshots) {
+      // close the file containing the previous snapshot
+      m_snapshot_file.reset(nullptr);
+    }
+
+    // Keep the file open between snapshots. This way asynchronous backends can finish
+    // writing while the model keeps running.
+    if (not m_snapshot_file) {
+      m_snapshot_file.reset(new File(m_grid->com,
+                                     filename,
+                                     string_to_backend(m_config->get_string("output.format")),
+                                     mode,
+                                     m_ctx->pio_iosys_id(),
+                                     m_ctx->netcdf3_n_aggregators()));
+      m_snapshot_file->set_chunking(string_to_chunking(m_config->get_string("output.chunking")));
+      m_snapshot_file->set_compression_level(m_config->get_number("output.compression_level"));
+      set_output_types(*m_snapshot_file);
+      m_snapshot_file->set_header_padding(m_config->get_number("output.header_padding") * 1024);
+    }
 
     if (not m_snapshots_file_is_ready) {
-      write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
+      write_metadata(*m_snapshot_file, WRITE_MAPPING, PREPEND_HISTORY);
 
       m_snapshots_file_is_ready = true;
     }
 
-    write_run_stats(file);
+    save_variables(*m_snapshot_file, INCLUDE_MODEL_STATE, m_snapshot_vars, m_time->current());
 
-    save_variables(file, INCLUDE_MODEL_STATE, m_snapshot_vars, m_time->current());
+    // make sure all changes are written
+    m_snapshot_file->sync();
   }
   profiling.end("io.snapshots");
 }
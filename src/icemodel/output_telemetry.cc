@@ -0,0 +1,126 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>               // fopen, rename
+#include <sys/resource.h>       // getrusage
+
+#include "IceModel.hh"
+
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/Profiling.hh"
+#include "pism/stressbalance/ssa/SSA.hh"
+
+namespace pism {
+
+//! Peak resident memory of this process, in MiB.
+static double peak_resident_memory() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0.0;
+  }
+  // ru_maxrss is in kilobytes on Linux
+  return usage.ru_maxrss / 1024.0;
+}
+
+//! Record the state used to compute throughput and event times in the first telemetry update.
+void IceModel::init_telemetry() {
+  m_telemetry.wall_clock_hours = pism::wall_clock_hours(m_grid->com, m_start_time);
+  m_telemetry.model_time       = m_time->current();
+  m_telemetry.event_times      = m_ctx->profiling().totals();
+}
+
+//! Re-write the telemetry file (see output.telemetry.file).
+/*!
+ * Called after each time step; does nothing unless `step` is a multiple of
+ * output.telemetry.interval. Collective.
+ *
+ * The file is written to a temporary file and renamed, so readers never see a partially
+ * written file. Times spent in profiling events are those on rank 0 during the steps
+ * since the previous update.
+ */
+void IceModel::write_telemetry(int step) {
+  const std::string filename = m_config->get_string("output.telemetry.file");
+  const int interval = m_config->get_number("output.telemetry.interval");
+
+  if (filename.empty() or interval <= 0 or step % interval != 0) {
+    return;
+  }
+
+  const double
+    wall_clock_hours = pism::wall_clock_hours(m_grid->com, m_start_time),
+    memory           = GlobalMax(m_grid->com, peak_resident_memory()),
+    model_years      = units::convert(m_sys, m_time->current() - m_time->start(),
+                                      "seconds", "years"),
+    recent_years     = units::convert(m_sys, m_time->current() - m_telemetry.model_time,
+                                      "seconds", "years"),
+    recent_hours     = wall_clock_hours - m_telemetry.wall_clock_hours;
+
+  auto event_times = m_ctx->profiling().totals();
+
+  if (m_grid->rank() == 0) {
+    const std::string tmp_filename = filename + ".tmp";
+
+    // Failures are reported but do not stop the run (and only rank 0 would know about
+    // them).
+    FILE *f = fopen(tmp_filename.c_str(), "w");
+    if (f == NULL) {
+      m_log->message(1, "PISM WARNING: failed to open '%s' for writing\n", tmp_filename.c_str());
+      return;
+    }
+
+    fprintf(f, "{\"step\": %d,\n", step);
+    fprintf(f, " \"date\": \"%s\",\n", m_time->date().c_str());
+    fprintf(f, " \"wall_clock_hours\": %.6f,\n", wall_clock_hours);
+    fprintf(f, " \"model_years_per_wall_clock_hour\": %.6g,\n",
+            wall_clock_hours > 0.0 ? model_years / wall_clock_hours : 0.0);
+    fprintf(f, " \"recent_model_years_per_wall_clock_hour\": %.6g,\n",
+            recent_hours > 0.0 ? recent_years / recent_hours : 0.0);
+    fprintf(f, " \"dt_years\": %.6g,\n", units::convert(m_sys, m_dt, "seconds", "years"));
+    fprintf(f, " \"dt_limited_by\": \"%s\",\n", m_adaptive_timestep_reason.c_str());
+    fprintf(f, " \"peak_resident_memory_mib\": %.1f,\n", memory);
+
+    auto ssa = dynamic_cast<const stressbalance::SSA*>(m_stress_balance->shallow());
+    if (ssa != nullptr) {
+      fprintf(f, " \"ssa_nonlinear_iterations\": %d,\n", ssa->nonlinear_iterations());
+      fprintf(f, " \"ssa_linear_iterations\": %d,\n", ssa->linear_iterations());
+    }
+
+    fprintf(f, " \"steps_in_event_times\": %d,\n", interval);
+    fprintf(f, " \"event_times\": {");
+    bool first = true;
+    for (const auto &e : event_times) {
+      const double time = e.second - m_telemetry.event_times[e.first];
+      fprintf(f, "%s\n  \"%s\": %.6f", first ? "" : ",", e.first.c_str(), time);
+      first = false;
+    }
+    fprintf(f, "\n }}\n");
+    fclose(f);
+
+    if (rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+      m_log->message(1, "PISM WARNING: failed to rename '%s' to '%s'\n",
+                     tmp_filename.c_str(), filename.c_str());
+    }
+  }
+
+  m_telemetry.wall_clock_hours = wall_clock_hours;
+  m_telemetry.model_time       = m_time->current();
+  m_telemetry.event_times      = event_times;
+}
+
+} // end of namespace pism
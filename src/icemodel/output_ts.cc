@@ -75,12 +75,19 @@ void IceModel::init_timeseries() {
     m_log->message(2, "variables requested: %s\n", set_join(m_ts_vars, ",").c_str());
   }
 
-  // prepare the output file
+  // prepare the output file; it is kept open to avoid re-opening it every time PISM writes
+  // buffered records
   {
     // default behavior is to move the file aside if it exists already; option allows appending
     bool append = m_config->get_flag("output.timeseries.append");
     IO_Mode mode = append ? PISM_READWRITE : PISM_READWRITE_MOVE;
-    File file(m_grid->com, m_ts_filename, PISM_NETCDF3, mode);      // Use NetCDF-3 to write time-series.
+    m_ts_file.reset(new File(m_grid->com, m_ts_filename,
+                             string_to_backend(m_config->get_string("output.timeseries.format")),
+                             mode));
+    File &file = *m_ts_file;
+    // leave room for variables defined when time-series are written for the first time
+    file.set_header_padding(m_config->get_number("output.header_padding") * 1024);
+
     // add the last saved time to the list of requested times so that the first time is interpreted
     // as the end of a reporting time step
     if (append and file.dimension_length("time") > 0) {
@@ -117,15 +124,30 @@ MaxTimestep IceModel::ts_max_timestep(double my_t) {
 
 //! Flush scalar time-series.
 void IceModel::flush_timeseries() {
+  if (m_ts_diagnostics.empty() or not m_ts_file) {
+    return;
+  }
+
   // flush all the time-series buffers:
   for (auto d : m_ts_diagnostics) {
-    d.second->flush();
+    d.second->flush(*m_ts_file);
   }
 
   // update run_stats in the time series output file
-  if (not m_ts_diagnostics.empty()) {
-    File file(m_grid->com, m_ts_filename, PISM_NETCDF3, PISM_READWRITE);
-    write_run_stats(file);
+  write_run_stats(*m_ts_file);
+
+  m_ts_file->sync();
+}
+
+//! Flush scalar time-series if one of the buffers is full (see output.timeseries.buffer_size).
+void IceModel::flush_full_timeseries() {
+  const size_t buffer_size = m_config->get_number("output.timeseries.buffer_size");
+
+  for (auto d : m_ts_diagnostics) {
+    if (d.second->buffer_length() >= buffer_size) {
+      flush_timeseries();
+      return;
+    }
   }
 }
 
@@ -38,8 +38,11 @@ namespace pism {
 /*! This applies to the horizontal part of the 3D advection problem solved by AgeModel and the
 horizontal part of the 3D convection-diffusion problems solved by EnthalpyModel and
 TemperatureModel.
+
+This requires a pass over 3D velocity fields, so IceModel::print_summary() calls it only
+if maximum velocities computed by the stress balance violate the CFL condition.
 */
-unsigned int count_CFL_violations(const IceModelVec3 &u3,
+static unsigned int count_CFL_violations(const IceModelVec3 &u3,
                                   const IceModelVec3 &v3,
                                   const IceModelVec2S &ice_thickness,
                                   double dt) {
@@ -88,33 +91,65 @@ unsigned int count_CFL_violations(const IceModelVec3 &u3,
 
 void IceModel::print_summary(bool tempAndAge) {
 
-  const IceModelVec3
-    &u3 = m_stress_balance->velocity_u(),
-    &v3 = m_stress_balance->velocity_v();
-
-  unsigned int n_CFL_violations = count_CFL_violations(u3, v3, m_geometry.ice_thickness,
-                                                       tempAndAge ? dt_TempAge : m_dt);
-
-  // report CFL violations
-  if (n_CFL_violations > 0.0) {
-    const double CFLviolpercent = 100.0 * n_CFL_violations / (m_grid->Mx() * m_grid->My() * m_grid->Mz());
-    // at default verbosity level, only report CFL viols if above:
-    const double CFLVIOL_REPORT_VERB2_PERCENT = 0.1;
-    if (CFLviolpercent > CFLVIOL_REPORT_VERB2_PERCENT ||
-        m_log->get_threshold() > 2) {
-      char tempstr[90] = "";
-      snprintf(tempstr,90,
-              "  [!CFL#=%d (=%5.2f%% of 3D grid)] ",
-              n_CFL_violations,CFLviolpercent);
-      m_stdout_flags = tempstr + m_stdout_flags;
+  const bool do_energy = m_config->get_flag("energy.enabled");
+
+  // print_summary_line() prints an 'S' line only if one of these is true; otherwise it
+  // just accumulates time step lengths, so we can skip computing quantities it reports
+  const bool print_line = (m_log->get_threshold() >= 2 and
+                           (tempAndAge or (not do_energy) or m_log->get_threshold() > 2));
+
+  if (not print_line) {
+    print_summary_line(false, tempAndAge, m_dt, 0.0, 0.0, 0.0, 0.0);
+    return;
+  }
+
+  // CFL violations are possible only in the 3D advection problems solved by the age and
+  // energy balance models
+  if (m_age_model or do_energy) {
+    const double dt = tempAndAge ? dt_TempAge : m_dt;
+
+    // The stress balance computes maximum horizontal velocity components (within the
+    // ice) anyway, so we need to count CFL violations only if these maxima violate the
+    // CFL condition.
+    const CFLData cfl = m_stress_balance->max_timestep_cfl_3d();
+
+    unsigned int n_CFL_violations = 0;
+    if (cfl.u_max * dt > m_grid->dx() or cfl.v_max * dt > m_grid->dy()) {
+      n_CFL_violations = count_CFL_violations(m_stress_balance->velocity_u(),
+                                              m_stress_balance->velocity_v(),
+                                              m_geometry.ice_thickness,
+                                              dt);
+    }
+
+    // report CFL violations
+    if (n_CFL_violations > 0.0) {
+      const double CFLviolpercent = 100.0 * n_CFL_violations / (m_grid->Mx() * m_grid->My() * m_grid->Mz());
+      // at default verbosity level, only report CFL viols if above:
+      const double CFLVIOL_REPORT_VERB2_PERCENT = 0.1;
+      if (CFLviolpercent > CFLVIOL_REPORT_VERB2_PERCENT ||
+          m_log->get_threshold() > 2) {
+        char tempstr[90] = "";
+        snprintf(tempstr,90,
+                 "  [!CFL#=%d (=%5.2f%% of 3D grid)] ",
+                 n_CFL_violations,CFLviolpercent);
+        m_stdout_flags = tempstr + m_stdout_flags;
+      }
     }
   }
 
   // get maximum diffusivity
   double max_diffusivity = m_stress_balance->max_diffusivity();
-  // get volumes in m^3 and areas in m^2
-  double volume = ice_volume(m_geometry, 0.0);
-  double area = ice_area(m_geometry, 0.0);
+  // get volumes in m^3 and areas in m^2 (using one reduction)
+  double volume = 0.0, area = 0.0;
+  {
+    double
+      local[2]  = {ice_volume_local(m_geometry, 0.0), ice_area_local(m_geometry, 0.0)},
+      global[2] = {0.0, 0.0};
+    GlobalSum(m_grid->com, local, global, 2);
+
+    volume = global[0];
+    area   = global[1];
+  }
 
   double meltfrac = 0.0;
   if (tempAndAge or m_log->get_threshold() >= 3) {
@@ -0,0 +1,130 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "IceModel.hh"
+
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Time.hh"
+#include "pism/util/Profiling.hh"
+#include "pism/util/io/File.hh"
+#include "pism/util/io/InMemoryFile.hh"
+#include "pism/fracturedensity/FractureDensity.hh"
+
+namespace pism {
+
+//! Name of the in-memory file used to store the model state `name`.
+static std::string state_filename(const std::string &name) {
+  return "memory:" + name;
+}
+
+//! Save the model state in memory, replacing the state saved earlier using the same `name`.
+/*!
+ * Saves the same variables as save_results() (the model state; no diagnostics) without
+ * writing to the file system. Use restore_state() to go back to this state, e.g. to run
+ * several ensemble members starting from the same spin-up.
+ */
+void IceModel::save_state(const std::string &name) {
+  const Profiling &profiling = m_ctx->profiling();
+
+  profiling.begin("io.model_state");
+  {
+    File file(m_grid->com, state_filename(name), PISM_IN_MEMORY, PISM_READWRITE_CLOBBER);
+
+    write_metadata(file, WRITE_MAPPING, OVERWRITE_HISTORY);
+
+    save_variables(file, INCLUDE_MODEL_STATE, {}, m_time->current());
+  }
+  profiling.end("io.model_state");
+}
+
+//! Restore the model state (and model time) saved using save_state().
+/*!
+ * Re-initializes the model state the same way as when re-starting from a file (`-i`),
+ * reading from memory instead. The grid and the domain decomposition have to be the same
+ * as when the state was saved.
+ *
+ * Components get the name of the input file from the configuration database, so this
+ * temporarily replaces `input.file`. Boundary conditions read from the input file (i.e.
+ * when `*.file` parameters of a model are not set) are not available; set corresponding
+ * `*.file` parameters to read them from other files.
+ *
+ * Output schedules (snapshots, spatial and scalar time series, backups) are not changed.
+ */
+void IceModel::restore_state(const std::string &name) {
+  const std::string filename = state_filename(name);
+
+  unsigned int record = 0;
+  double time = 0.0;
+  {
+    File file(m_grid->com, filename, PISM_IN_MEMORY, PISM_READONLY);
+
+    record = file.nrecords() - 1;
+    file.read_variable(m_config->get_string("time.dimension_name"), {record}, {1}, &time);
+  }
+
+  const std::string
+    input_file  = m_config->get_string("input.file"),
+    regrid_file = m_config->get_string("input.regrid.file"),
+    history     = m_output_global_attributes.get_string("history");
+  const bool bootstrap = m_config->get_flag("input.bootstrap");
+
+  auto reset_config = [&]() {
+    m_config->set_string("input.file", input_file);
+    m_config->set_string("input.regrid.file", regrid_file);
+    m_config->set_flag("input.bootstrap", bootstrap);
+  };
+
+  m_config->set_string("input.file", filename);
+  m_config->set_string("input.regrid.file", "");
+  m_config->set_flag("input.bootstrap", false);
+
+  try {
+    m_time->set(time);
+
+    model_state_setup();
+
+    // parts of the model state that are read by misc_setup()
+    File file(m_grid->com, filename, PISM_IN_MEMORY, PISM_READONLY);
+
+    if (m_fracture) {
+      m_fracture->restart(file, record);
+    }
+
+    for (auto d : m_diagnostics) {
+      d.second->reset();
+      d.second->init(file, record);
+    }
+  } catch (RuntimeError &e) {
+    reset_config();
+    e.add_context("restoring the model state '%s'", name.c_str());
+    throw;
+  }
+
+  reset_config();
+
+  // model_state_setup() prepends the history of the input file
+  m_output_global_attributes.set_string("history", history);
+}
+
+//! Free the memory used by the model state saved using save_state().
+void IceModel::discard_state(const std::string &name) {
+  io::InMemoryFile::remove(state_filename(name));
+}
+
+} // end of namespace pism
@@ -18,6 +18,7 @@
 
 #include <sstream>              // stringstream
 #include <algorithm>            // std::sort
+#include <limits>               // std::numeric_limits
 
 #include "IceModel.hh"
 #include "pism/util/IceGrid.hh"
@@ -26,7 +27,9 @@
 #include "pism/util/MaxTimestep.hh"
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/stressbalance/ShallowStressBalance.hh"
+#include "pism/age/AgeModel.hh"
 #include "pism/util/Component.hh" // ...->max_timestep()
+#include "pism/util/pism_utilities.hh" // GlobalMin
 
 #include "pism/frontretreat/calving/EigenCalving.hh"
 #include "pism/frontretreat/calving/HayhurstCalving.hh"
@@ -98,6 +101,58 @@ unsigned int IceModel::skip_counter(double input_dt, double input_dt_diffusivity
   return 0;
 }
 
+/*!
+ * Time step restriction of the energy balance and age models: the 3D CFL condition, if at
+ * least one of these models is used. (The semi-Lagrangian age model is not limited by
+ * the CFL condition.)
+ */
+MaxTimestep IceModel::max_timestep_energy_age() const {
+  bool age_cfl = m_age_model and not m_age_model->semi_lagrangian();
+
+  if (m_config->get_flag("energy.enabled") or age_cfl) {
+    return m_stress_balance->max_timestep_cfl_3d().dt_max;
+  }
+  return MaxTimestep();
+}
+
+/** @brief Compute the skip counter by comparing the time since the last energy and age
+ * step to the time step restriction of these models.
+ *
+ * Unlike skip_counter(), which chooses the number of mass continuity steps per energy
+ * step once (using the lengths of the current time step and the "long" time step), this
+ * is re-evaluated after every mass continuity step. This way the interval between energy
+ * and age steps follows changes in the mass continuity time step.
+ *
+ * @param[in] dt length of the current time step
+ * @param[in] full_update true if the current time step includes energy and age steps
+ * @param[in] counter current value of the skip counter
+ *
+ * @return new skip counter (the next step includes energy and age steps if it is 1)
+ */
+unsigned int IceModel::adaptive_skip_counter(double dt, bool full_update, unsigned int counter) {
+  const unsigned int skip_max = static_cast<int>(m_config->get_number("time_stepping.skip.max"));
+
+  if (full_update) {
+    counter = skip_max;
+  }
+
+  MaxTimestep dt_energy = max_timestep_energy_age();
+
+  if (counter > 1 and dt_energy.finite()) {
+    const double conservativeFactor = 0.95;
+
+    // Length of the interval covered by energy and age steps at the end of the *next*
+    // step, assuming that it has the same length as this one.
+    const double interval = (full_update ? 0.0 : dt_TempAge) + 2.0 * dt;
+
+    if (interval > conservativeFactor * dt_energy.value()) {
+      counter = 1;
+    }
+  }
+
+  return counter;
+}
+
 //! Use various stability criteria to determine the time step for an evolution run.
 /*!
 The main loop in run() approximates many physical processes.  Several of these approximations,
@@ -114,6 +169,10 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
 
   std::vector<MaxTimestep> restrictions;
 
+  // Restrictions computed using the sub-domain owned by this rank, without
+  // communication. They are combined using one reduction below.
+  std::vector<MaxTimestep> local_restrictions;
+
   // get time-stepping restrictions from sub-models
   for (auto m : m_submodels) {
     restrictions.push_back(m.second->max_timestep(current_time));
@@ -145,9 +204,9 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
 
     assert(m_front_retreat);
 
-    restrictions.push_back(m_front_retreat->max_timestep(m_geometry.cell_type,
-                                                         m_ssa_dirichlet_bc_mask,
-                                                         retreat_rate));
+    local_restrictions.push_back(m_front_retreat->max_timestep_local(m_geometry.cell_type,
+                                                                     m_ssa_dirichlet_bc_mask,
+                                                                     retreat_rate));
   }
 
   // Always consider the maximum allowed time-step length.
@@ -175,7 +234,25 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
     CFLData cfl = m_stress_balance->max_timestep_cfl_2d();
 
     restrictions.push_back(MaxTimestep(cfl.dt_max.value(), "2D CFL"));
-    restrictions.push_back(max_timestep_diffusivity());
+
+    // the implicit SIA step is stable regardless of the diffusivity
+    if (not m_config->get_flag("geometry.update.implicit_sia")) {
+      restrictions.push_back(max_timestep_diffusivity());
+    }
+  }
+
+  const bool adaptive_skip = (m_config->get_flag("time_stepping.skip.enabled") and
+                               m_config->get_flag("time_stepping.skip.adaptive"));
+
+  // with adaptive skipping the energy and age models use the time step covering all the
+  // mass continuity steps since the last energy step
+  if (adaptive_skip and skip_counter_result == 0 and dt_TempAge > 0.0) {
+    MaxTimestep dt_energy = max_timestep_energy_age();
+
+    if (dt_energy.finite() and dt_energy.value() > dt_TempAge) {
+      restrictions.push_back(MaxTimestep(dt_energy.value() - dt_TempAge,
+                                         "energy and age interval"));
+    }
   }
 
   // Hit multiples of X years, if requested.
@@ -203,6 +280,29 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
     }
   }
 
+  // compute global restrictions from local ones, keeping descriptions
+  if (not local_restrictions.empty()) {
+    const double infinity = std::numeric_limits<double>::max();
+    const int N = local_restrictions.size();
+
+    std::vector<double> local(N), global(N);
+    for (int k = 0; k < N; ++k) {
+      const MaxTimestep &dt = local_restrictions[k];
+      local[k] = dt.finite() ? dt.value() : infinity;
+    }
+
+    GlobalMin(m_grid->com, local.data(), global.data(), N);
+
+    for (int k = 0; k < N; ++k) {
+      const std::string &description = local_restrictions[k].description();
+      if (global[k] < infinity) {
+        restrictions.push_back(MaxTimestep(global[k], description));
+      } else {
+        restrictions.push_back(MaxTimestep(description));
+      }
+    }
+  }
+
   // sort time step restrictions to find the strictest one
   std::sort(restrictions.begin(), restrictions.end());
 
@@ -215,7 +315,11 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
                                 " (overrides " + dt_other.description() + ")");
 
   // the "skipping" mechanism
-  {
+  if (adaptive_skip) {
+    skip_counter_result = adaptive_skip_counter(dt_result,
+                                                skip_counter_result == 0,
+                                                skip_counter_result);
+  } else {
     if (dt_max.description() == "diffusivity" and skip_counter_result == 0) {
       skip_counter_result = skip_counter(dt_other.value(), dt_max.value());
     }
@@ -44,10 +44,23 @@ There is no indication of these actions in the history attribute of the output (
 NetCDF file because there is no effect on it, but there is an indication at `stdout`.
 
 Signal `SIGUSR2` makes PISM flush time-series, without saving model state.
+
+In the preemption mode (see `output.preemption.enabled`) signals `SIGTERM` and `SIGUSR1`
+make PISM write a checkpoint and stop (see write_preemption_checkpoint()). All processes
+have to agree on this, so the caller checks if any process caught one of these signals
+(see preemption_requested(), a collective operation done once per time step) and passes
+the result as `preemption_signal`. Until then these signals are ignored.
  */
-int IceModel::process_signals() {
+int IceModel::process_signals(bool preemption_signal) {
+
+  const bool preemption = m_config->get_flag("output.preemption.enabled");
+
+  if (preemption and preemption_signal) {
+    write_preemption_checkpoint();
+    return 1;
+  }
 
-  if (pism_signal == SIGTERM) {
+  if (pism_signal == SIGTERM and not preemption) {
     m_log->message(1,
        "\ncaught signal SIGTERM:  EXITING EARLY and saving with original filename.\n");
 
@@ -58,7 +71,7 @@ int IceModel::process_signals() {
     return 1;
   }
 
-  if (pism_signal == SIGUSR1) {
+  if (pism_signal == SIGUSR1 and not preemption) {
     char file_name[PETSC_MAX_PATH_LEN];
     snprintf(file_name, PETSC_MAX_PATH_LEN, "pism-%s.nc",
              m_time->date().c_str());
@@ -71,7 +84,8 @@ int IceModel::process_signals() {
               file_name,
               string_to_backend(m_config->get_string("output.format")),
               PISM_READWRITE_MOVE,
-              m_ctx->pio_iosys_id());
+              m_ctx->pio_iosys_id(),
+              m_ctx->netcdf3_n_aggregators());
     save_variables(file, INCLUDE_MODEL_STATE, m_output_vars, m_time->current());
 
     // flush all the time-series buffers:
@@ -91,6 +105,17 @@ int IceModel::process_signals() {
 }
 
 
+//! Returns true if a preemption signal (`SIGTERM` or `SIGUSR1`) was caught by any process.
+/*!
+ * This is a collective operation: all processes have to agree to write a checkpoint.
+ */
+bool IceModel::preemption_requested() const {
+  const double caught = (pism_signal == SIGTERM or pism_signal == SIGUSR1) ? 1.0 : 0.0;
+
+  return GlobalMax(m_grid->com, caught) > 0.0;
+}
+
+
 void IceModel::update_run_stats() {
 
   // timing stats
@@ -139,6 +164,28 @@ bool check_maximum_ice_thickness(const IceModelVec2S &ice_thickness) {
   }
 }
 
+//! Replace ice thickness where `mask` is set (used to couple nested models).
+void IceModel::set_ice_thickness(const IceModelVec2S &thickness, const IceModelVec2Int &mask) {
+  IceModelVec2S &H = m_geometry.ice_thickness;
+
+  {
+    IceModelVec::AccessList list{&H, &thickness, &mask};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (mask.as_int(i, j) == 1) {
+        H(i, j) = thickness(i, j);
+      }
+    }
+  }
+  H.update_ghosts();
+  // Geometry::ensure_consistency() skips the update unless the state counter changes
+  H.inc_state_counter();
+
+  enforce_consistency_of_geometry(DONT_REMOVE_ICEBERGS);
+}
+
 //! Return the grid used by this model.
 IceGrid::Ptr IceModel::grid() const {
   return m_grid;
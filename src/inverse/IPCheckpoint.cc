@@ -0,0 +1,189 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <algorithm>            // std::rotate
+
+#include "IPCheckpoint.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/io/File.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+namespace inverse {
+
+static double read_scalar(const File &file, const std::string &name) {
+  auto value = file.read_double_attribute("PISM_GLOBAL", name);
+  if (value.size() != 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "%s is not an inversion checkpoint (%s is missing)",
+                                  file.filename().c_str(), name.c_str());
+  }
+  return value[0];
+}
+
+IPCheckpoint::IPCheckpoint(IceGrid::ConstPtr grid, bool store_history)
+  : design(grid, "inv_checkpoint_zeta", WITHOUT_GHOSTS),
+    state(grid, "_inv_checkpoint", WITHOUT_GHOSTS),
+    iteration(0),
+    m_grid(grid),
+    m_history_size(0) {
+
+  auto config = grid->ctx()->config();
+
+  m_interval         = config->get_number("inverse.checkpoint.interval");
+  m_filename         = config->get_string("inverse.checkpoint.file");
+  m_restart_filename = config->get_string("inverse.checkpoint.restart_file");
+
+  design.set_attrs("internal", "design variable at the last completed iteration",
+                   "1", "1", "", 0);
+  design.set_time_independent(true);
+
+  state.set_attrs("internal", "x-component of the state corresponding to inv_checkpoint_zeta",
+                  "m s-1", "m s-1", "", 0);
+  state.set_attrs("internal", "y-component of the state corresponding to inv_checkpoint_zeta",
+                  "m s-1", "m s-1", "", 1);
+  state.set_time_independent(true);
+
+  // history is not needed if checkpointing is disabled and we are not restarting
+  if (not store_history or (m_interval <= 0 and m_restart_filename.empty())) {
+    return;
+  }
+
+  int history_length = config->get_number("inverse.checkpoint.history_length");
+  for (int k = 0; k < history_length; ++k) {
+    IceModelVec2S::Ptr d(new IceModelVec2S(grid, pism::printf("inv_checkpoint_zeta_%d", k),
+                                           WITHOUT_GHOSTS));
+    d->set_attrs("internal", "design variable at a previous iteration", "1", "1", "", 0);
+    d->set_time_independent(true);
+    m_history_design.push_back(d);
+
+    IceModelVec2S::Ptr g(new IceModelVec2S(grid, pism::printf("inv_checkpoint_gradient_%d", k),
+                                           WITHOUT_GHOSTS));
+    g->set_attrs("internal", "gradient of the objective at a previous iteration",
+                 "1", "1", "", 0);
+    g->set_time_independent(true);
+    m_history_gradient.push_back(g);
+  }
+}
+
+//! Returns true if a checkpoint should be written after the iteration `iteration`.
+bool IPCheckpoint::due(int iteration) const {
+  return m_interval > 0 and iteration > 0 and iteration % m_interval == 0;
+}
+
+//! Returns true if a solver should resume from a checkpoint.
+bool IPCheckpoint::restarting() const {
+  return not m_restart_filename.empty();
+}
+
+//! Add a (design, gradient) pair to the history, discarding the oldest pair if necessary.
+void IPCheckpoint::add_to_history(Vec design, Vec gradient) {
+  if (m_history_design.empty()) {
+    return;
+  }
+
+  if (m_history_size == m_history_design.size()) {
+    // re-use storage of the oldest pair
+    std::rotate(m_history_design.begin(), m_history_design.begin() + 1, m_history_design.end());
+    std::rotate(m_history_gradient.begin(), m_history_gradient.begin() + 1, m_history_gradient.end());
+    m_history_size -= 1;
+  }
+
+  m_history_design[m_history_size]->copy_from_vec(design);
+  m_history_gradient[m_history_size]->copy_from_vec(gradient);
+  m_history_size += 1;
+}
+
+unsigned int IPCheckpoint::history_size() const {
+  return m_history_size;
+}
+
+//! Design variable of the `k`-th stored pair (oldest first).
+IceModelVec2S& IPCheckpoint::history_design(unsigned int k) {
+  return *m_history_design.at(k);
+}
+
+//! Gradient of the `k`-th stored pair (oldest first).
+IceModelVec2S& IPCheckpoint::history_gradient(unsigned int k) {
+  return *m_history_gradient.at(k);
+}
+
+void IPCheckpoint::write() {
+  auto config = m_grid->ctx()->config();
+
+  m_grid->ctx()->log()->message(2, "Writing an inversion checkpoint (iteration %d) to %s...\n",
+                                iteration, m_filename.c_str());
+
+  File file(m_grid->com, m_filename,
+            string_to_backend(config->get_string("output.format")),
+            PISM_READWRITE_MOVE);
+
+  file.write_attribute("PISM_GLOBAL", "inverse_iteration", PISM_INT, {(double)iteration});
+  file.write_attribute("PISM_GLOBAL", "inverse_history_size", PISM_INT, {(double)m_history_size});
+  for (auto s : scalars) {
+    file.write_attribute("PISM_GLOBAL", "inverse_" + s.first, PISM_DOUBLE, {s.second});
+  }
+
+  design.write(file);
+  state.write(file);
+
+  for (unsigned int k = 0; k < m_history_size; ++k) {
+    // names of stored fields have to correspond to their position in the history
+    m_history_design[k]->metadata().set_name(pism::printf("inv_checkpoint_zeta_%d", k));
+    m_history_gradient[k]->metadata().set_name(pism::printf("inv_checkpoint_gradient_%d", k));
+
+    m_history_design[k]->write(file);
+    m_history_gradient[k]->write(file);
+  }
+}
+
+//! Read a checkpoint from `inverse.checkpoint.restart_file`.
+void IPCheckpoint::read() {
+  m_grid->ctx()->log()->message(2, "Resuming an inversion using the checkpoint in %s...\n",
+                                m_restart_filename.c_str());
+
+  File file(m_grid->com, m_restart_filename, PISM_GUESS, PISM_READONLY);
+
+  iteration = read_scalar(file, "inverse_iteration");
+
+  for (auto &s : scalars) {
+    s.second = read_scalar(file, "inverse_" + s.first);
+  }
+
+  design.read(file, 0);
+  state.read(file, 0);
+
+  unsigned int n = read_scalar(file, "inverse_history_size");
+  m_history_size = std::min(n, (unsigned int)m_history_design.size());
+
+  // if the history stored is longer than we need, skip oldest pairs
+  for (unsigned int k = 0; k < m_history_size; ++k) {
+    unsigned int j = k + (n - m_history_size);
+    m_history_design[k]->metadata().set_name(pism::printf("inv_checkpoint_zeta_%d", j));
+    m_history_gradient[k]->metadata().set_name(pism::printf("inv_checkpoint_gradient_%d", j));
+
+    m_history_design[k]->read(file, 0);
+    m_history_gradient[k]->read(file, 0);
+  }
+}
+
+} // end of namespace inverse
+} // end of namespace pism
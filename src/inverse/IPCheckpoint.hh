@@ -0,0 +1,86 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef IPCHECKPOINT_HH
+#define IPCHECKPOINT_HH
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <petscvec.h>
+
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+namespace inverse {
+
+//! State of an inversion saved to (and read from) checkpoint files.
+/*!
+ * A checkpoint contains
+ *
+ * - the design variable at the last completed iteration,
+ * - the corresponding state (used as the initial guess by the first forward solve after a
+ *   restart, which then converges immediately),
+ * - the iteration number and solver-specific scalars (e.g. the Tikhonov penalty),
+ * - most recent (design, gradient) pairs, used to rebuild the limited-memory quasi-Newton
+ *   approximation after a restart.
+ *
+ * Checkpoints are written every `inverse.checkpoint.interval` iterations to
+ * `inverse.checkpoint.file` (the previous checkpoint is kept as a backup). Solvers resume
+ * from `inverse.checkpoint.restart_file`, if set.
+ */
+class IPCheckpoint {
+public:
+  IPCheckpoint(IceGrid::ConstPtr grid, bool store_history = true);
+
+  bool due(int iteration) const;
+  void write();
+
+  bool restarting() const;
+  void read();
+
+  void add_to_history(Vec design, Vec gradient);
+  unsigned int history_size() const;
+  IceModelVec2S& history_design(unsigned int k);
+  IceModelVec2S& history_gradient(unsigned int k);
+
+  //! design variable (\f$\zeta\f$)
+  IceModelVec2S design;
+  //! state variable (velocity) corresponding to `design`
+  IceModelVec2V state;
+  //! number of completed iterations
+  int iteration;
+  //! solver-specific scalars
+  std::map<std::string, double> scalars;
+private:
+  IceGrid::ConstPtr m_grid;
+
+  int m_interval;
+  std::string m_filename;
+  std::string m_restart_filename;
+
+  //! stored pairs, oldest first
+  std::vector<IceModelVec2S::Ptr> m_history_design, m_history_gradient;
+  unsigned int m_history_size;
+};
+
+} // end of namespace inverse
+} // end of namespace pism
+
+#endif /* IPCHECKPOINT_HH */
@@ -19,9 +19,11 @@
 #ifndef IPTAOTIKHONOVPROBLEM_HH_4NMM724B
 #define IPTAOTIKHONOVPROBLEM_HH_4NMM724B
 
+#include <algorithm>            // std::max
 #include <memory>
 
 #include "TaoUtil.hh"
+#include "IPCheckpoint.hh"
 #include "functional/IPFunctional.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/IceGrid.hh"
@@ -225,13 +227,12 @@ public:
 
   //! Callback from TaoBasicSolver to form the starting iterate for the minimization.  See also
   //  setInitialGuess.
-  virtual TerminationReason::Ptr formInitialGuess(Vec *v) {
-    *v = m_dGlobal.vec();
-    return GenericTerminationReason::success();
-  }
+  virtual TerminationReason::Ptr formInitialGuess(Vec *v);
 
 protected:
 
+  void restart();
+
   IceGrid::ConstPtr m_grid;
   
   ForwardProblem &m_forward;
@@ -289,6 +290,12 @@ protected:
   */
   double m_tikhonov_rtol;
 
+  /// Checkpointing and restarting support.
+  IPCheckpoint m_checkpoint;
+  /// Number of iterations completed before a restart.
+  int m_iteration_offset;
+  /// The Tao connected to this problem.
+  Tao m_tao;
 };
 
 template<class ForwardProblem>
@@ -298,7 +305,8 @@ IPTaoTikhonovProblem<ForwardProblem>::IPTaoTikhonovProblem(ForwardProblem &forwa
                                                            IPFunctional<DesignVec> &designFunctional,
                                                            IPFunctional<StateVec> &stateFunctional)
   : m_forward(forward), m_d0(d0), m_u_obs(u_obs), m_eta(eta),
-    m_designFunctional(designFunctional), m_stateFunctional(stateFunctional) {
+    m_designFunctional(designFunctional), m_stateFunctional(stateFunctional),
+    m_checkpoint(d0.grid()), m_iteration_offset(0), m_tao(NULL) {
 
   m_grid = m_d0.grid();
 
@@ -342,6 +350,8 @@ void IPTaoTikhonovProblem<ForwardProblem>::connect(Tao tao) {
   typedef taoutil::TaoObjGradCallback<IPTaoTikhonovProblem<ForwardProblem>,
                              &IPTaoTikhonovProblem<ForwardProblem>::evaluateObjectiveAndGradient> ObjGradCallback; 
 
+  m_tao = tao;
+
   ObjGradCallback::connect(tao,*this);
 
   taoutil::TaoMonitorCallback< IPTaoTikhonovProblem<ForwardProblem> >::connect(tao,*this);
@@ -365,9 +375,14 @@ void IPTaoTikhonovProblem<ForwardProblem>::connect(Tao tao) {
 
 template<class ForwardProblem>
 void IPTaoTikhonovProblem<ForwardProblem>::monitorTao(Tao tao) {
+  PetscErrorCode ierr;
+
   PetscInt its;
   TaoGetSolutionStatus(tao, &its, NULL, NULL, NULL, NULL, NULL);
 
+  // TAO counts iterations since the beginning of the current solve
+  its += m_iteration_offset;
+
   int nListeners = m_listeners.size();
   for (int k=0; k<nListeners; k++) {
     m_listeners[k]->iteration(*this, m_eta,
@@ -376,6 +391,90 @@ void IPTaoTikhonovProblem<ForwardProblem>::monitorTao(Tao tao) {
                               m_forward.solution(), m_u_diff, m_grad_state,
                               m_grad);
   }
+
+  Vec x, g;
+  ierr = TaoGetSolutionVector(tao, &x);
+  PISM_CHK(ierr, "TaoGetSolutionVector");
+  ierr = TaoGetGradientVector(tao, &g);
+  PISM_CHK(ierr, "TaoGetGradientVector");
+
+  m_checkpoint.add_to_history(x, g);
+
+  if (m_checkpoint.due(its)) {
+    m_checkpoint.iteration = its;
+    m_checkpoint.design.copy_from_vec(x);
+    m_checkpoint.state.copy_from(*m_forward.solution());
+    m_checkpoint.write();
+  }
+}
+
+//! Callback from TaoBasicSolver to form the starting iterate for the minimization.  See also
+//  setInitialGuess.
+template<class ForwardProblem>
+TerminationReason::Ptr IPTaoTikhonovProblem<ForwardProblem>::formInitialGuess(Vec *v) {
+  if (m_checkpoint.restarting()) {
+    restart();
+  }
+
+  *v = m_dGlobal.vec();
+  return GenericTerminationReason::success();
+}
+
+//! Resume from a checkpoint.
+/*!
+ * Uses the design variable from the checkpoint as the initial guess and the state as the
+ * initial guess of the first forward solve (so that it converges immediately), reduces
+ * the maximum number of iterations by the number of iterations already completed and
+ * (with PETSc 3.11 or newer) primes the limited-memory quasi-Newton approximation used by
+ * TAO's LMVM and BLMVM methods with saved (design, gradient) pairs.
+ */
+template<class ForwardProblem>
+void IPTaoTikhonovProblem<ForwardProblem>::restart() {
+  PetscErrorCode ierr;
+
+  m_checkpoint.read();
+
+  m_dGlobal.copy_from(m_checkpoint.design);
+  m_forward.set_initial_guess(m_checkpoint.state);
+
+  m_iteration_offset = m_checkpoint.iteration;
+
+  PetscInt max_it = 0;
+  ierr = TaoGetMaximumIterations(m_tao, &max_it);
+  PISM_CHK(ierr, "TaoGetMaximumIterations");
+
+  ierr = TaoSetMaximumIterations(m_tao, std::max(max_it - m_iteration_offset, (PetscInt)0));
+  PISM_CHK(ierr, "TaoSetMaximumIterations");
+
+#if PETSC_VERSION_GE(3,11,0)
+  PetscBool lmvm = PETSC_FALSE;
+  ierr = PetscObjectTypeCompareAny((PetscObject)m_tao, &lmvm, TAOLMVM, TAOBLMVM, "");
+  PISM_CHK(ierr, "PetscObjectTypeCompareAny");
+
+  if (lmvm and m_checkpoint.history_size() > 0) {
+    // the LMVM matrix is allocated by TaoSetUp(), which needs the initial guess
+    ierr = TaoSetInitialVector(m_tao, m_dGlobal.vec());
+    PISM_CHK(ierr, "TaoSetInitialVector");
+
+    ierr = TaoSetUp(m_tao);
+    PISM_CHK(ierr, "TaoSetUp");
+
+    // keep the approximation we are about to build when TaoSolve() starts
+    ierr = TaoLMVMRecycle(m_tao, PETSC_TRUE);
+    PISM_CHK(ierr, "TaoLMVMRecycle");
+
+    Mat H;
+    ierr = TaoGetLMVMMatrix(m_tao, &H);
+    PISM_CHK(ierr, "TaoGetLMVMMatrix");
+
+    for (unsigned int k = 0; k < m_checkpoint.history_size(); ++k) {
+      ierr = MatLMVMUpdate(H,
+                           m_checkpoint.history_design(k).vec(),
+                           m_checkpoint.history_gradient(k).vec());
+      PISM_CHK(ierr, "MatLMVMUpdate");
+    }
+  }
+#endif
 }
 
 template<class ForwardProblem> void IPTaoTikhonovProblem<ForwardProblem>::convergenceTest(Tao tao) {
@@ -420,13 +519,14 @@ void IPTaoTikhonovProblem<ForwardProblem>::evaluateObjectiveAndGradient(Tao tao,
 
   m_d_diff->copy_from(*m_d);
   m_d_diff->add(-1, m_d0);
-  m_designFunctional.gradientAt(*m_d_diff, *m_grad_design);
+  double valDesign, valState;
+  m_designFunctional.valueAndGradientAt(*m_d_diff, &valDesign, *m_grad_design);
 
   m_u_diff->copy_from(*m_forward.solution());
   m_u_diff->add(-1, m_u_obs);
 
   // The following computes the reduced gradient.
-  m_stateFunctional.gradientAt(*m_u_diff, m_adjointRHS);
+  m_stateFunctional.valueAndGradientAt(*m_u_diff, &valState, m_adjointRHS);
   m_forward.apply_linearization_transpose(m_adjointRHS, *m_grad_state);
 
   m_grad->copy_from(*m_grad_design);
@@ -436,10 +536,6 @@ void IPTaoTikhonovProblem<ForwardProblem>::evaluateObjectiveAndGradient(Tao tao,
   ierr = VecCopy(m_grad->vec(), gradient);
   PISM_CHK(ierr, "VecCopy");
 
-  double valDesign, valState;
-  m_designFunctional.valueAt(*m_d_diff, &valDesign);
-  m_stateFunctional.valueAt(*m_u_diff, &valState);
-
   m_val_design = valDesign;
   m_val_state = valState;
 
@@ -140,6 +140,9 @@ void IP_SSAHardavForwardProblem::set_design(IceModelVec2S &new_zeta) {
     m_coefficients(i, j).hardness = m_hardav(i, j);
   }
 
+  // m_coefficients no longer correspond to inputs of cache_inputs()
+  m_hardness_inputs.reset();
+
   // Flag the state jacobian as needing rebuilding.
   m_rebuild_J_state = true;
 }
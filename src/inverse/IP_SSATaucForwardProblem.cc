@@ -16,6 +16,9 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::max
+#include <cmath>                // std::abs
+
 #include "IP_SSATaucForwardProblem.hh"
 #include "pism/basalstrength/basal_resistance.hh"
 #include "pism/util/IceGrid.hh"
@@ -38,7 +41,8 @@ IP_SSATaucForwardProblem::IP_SSATaucForwardProblem(IceGrid::ConstPtr g,
     m_element_index(*m_grid),
     m_element(*m_grid),
     m_quadrature(g->dx(), g->dy(), 1.0),
-    m_rebuild_J_state(true) {
+    m_rebuild_J_state(true),
+    m_pc_valid(false) {
 
   PetscErrorCode ierr;
   int stencil_width = 1;
@@ -57,6 +61,10 @@ IP_SSATaucForwardProblem::IP_SSATaucForwardProblem(IceGrid::ConstPtr g,
                         "yield stress for basal till (plastic or pseudo-plastic model)",
                         "Pa", "Pa", "", 0);
 
+  m_tauc_pc.create(m_grid, "tauc_pc", WITHOUT_GHOSTS);
+
+  m_pc_reuse_threshold = m_config->get_number("inverse.ssa.pc_reuse_threshold");
+
   ierr = DMSetMatType(*m_da, MATBAIJ);
   PISM_CHK(ierr, "DMSetMatType");
   ierr = DMCreateMatrix(*m_da, m_J_state.rawptr());
@@ -143,6 +151,9 @@ void IP_SSATaucForwardProblem::set_design(IceModelVec2S &new_zeta) {
     m_coefficients(i, j).tauc = tauc(i, j);
   }
 
+  // m_coefficients no longer correspond to inputs of cache_inputs()
+  m_tauc_inputs.reset();
+
   // Flag the state jacobian as needing rebuilding.
   m_rebuild_J_state = true;
 }
@@ -532,52 +543,105 @@ void IP_SSATaucForwardProblem::apply_jacobian_design_transpose(IceModelVec2V &u,
   }
 }
 
-/*!\brief Applies the linearization of the forward map (i.e. the reduced gradient \f$DF\f$ described in
-the class-level documentation.) */
-/*! As described previously,
-\f[
-Df = J_{\rm State}^{-1} J_{\rm Design}.
-\f]
-Applying the linearization then involves the solution of a linear equation.
-The matrices \f$J_{\rm State}\f$ and \f$J_{\rm Design}\f$ both depend on the value of the
-design variable \f$\zeta\f$ and the value of the corresponding state variable \f$u=F(\zeta)\f$.
-These are established by first calling linearize_at.
-  @param[in]   dzeta     Perturbation of the design variable
-  @param[out]  du        Computed corresponding perturbation of the state variable; ghosts (if present) are updated.
-*/
-void IP_SSATaucForwardProblem::apply_linearization(IceModelVec2S &dzeta, IceModelVec2V &du) {
-
+//! Assemble the state Jacobian (if the design changed) and give it to the KSP.
+/*!
+ * The KSP (including its preconditioner) is kept between calls, so both linearization
+ * solves following a linearize_at() use the same preconditioner.
+ *
+ * If `inverse.ssa.pc_reuse_threshold` is positive and the maximum relative change in
+ * \f$\tau_c\f$ since the preconditioner was built is below it (e.g. between TAO line
+ * search steps) the Jacobian is updated but the old preconditioner is kept.
+ */
+void IP_SSATaucForwardProblem::update_state_jacobian() {
   PetscErrorCode ierr;
 
-  if (m_rebuild_J_state) {
-    this->assemble_jacobian_state(m_velocity, m_J_state);
-    m_rebuild_J_state = false;
+  if (not m_rebuild_J_state) {
+    return;
   }
 
-  this->apply_jacobian_design(m_velocity, dzeta, m_du_global);
-  m_du_global.scale(-1);
+  this->assemble_jacobian_state(m_velocity, m_J_state);
+  m_rebuild_J_state = false;
+
+  bool reuse_pc = false;
+  if (m_pc_valid and m_pc_reuse_threshold > 0.0) {
+    IceModelVec::AccessList list{&m_tauc_copy, &m_tauc_pc};
+
+    double change = 0.0, scale = 0.0;
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      change = std::max(change, std::abs(m_tauc_copy(i, j) - m_tauc_pc(i, j)));
+      scale  = std::max(scale, std::abs(m_tauc_pc(i, j)));
+    }
+    change = GlobalMax(m_grid->com, change);
+    scale  = GlobalMax(m_grid->com, scale);
+
+    reuse_pc = change <= m_pc_reuse_threshold * scale;
+  }
+
+  ierr = KSPSetReusePreconditioner(m_ksp, reuse_pc ? PETSC_TRUE : PETSC_FALSE);
+  PISM_CHK(ierr, "KSPSetReusePreconditioner");
 
-  // call PETSc to solve linear system by iterative method.
   ierr = KSPSetOperators(m_ksp, m_J_state, m_J_state);
   PISM_CHK(ierr, "KSPSetOperators");
 
+  if (not reuse_pc) {
+    IceModelVec::AccessList list{&m_tauc_copy, &m_tauc_pc};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_tauc_pc(i, j) = m_tauc_copy(i, j);
+    }
+    m_pc_valid = true;
+  }
+}
+
+//! Solve the linear system with the state Jacobian, using m_du_global as the right hand
+//! side and storing the solution in it.
+void IP_SSATaucForwardProblem::solve_state_system(const char *caller) {
+  PetscErrorCode ierr;
+
+  // call PETSc to solve linear system by iterative method.
   ierr = KSPSolve(m_ksp, m_du_global.vec(), m_du_global.vec());
   PISM_CHK(ierr, "KSPSolve"); // SOLVE
 
   KSPConvergedReason  reason;
   ierr = KSPGetConvergedReason(m_ksp, &reason);
   PISM_CHK(ierr, "KSPGetConvergedReason");
+
   if (reason < 0) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                  "IP_SSATaucForwardProblem::apply_linearization solve"
-                                  " failed to converge (KSP reason %s)",
-                                  KSPConvergedReasons[reason]);
+                                  "%s solve failed to converge (KSP reason %s)",
+                                  caller, KSPConvergedReasons[reason]);
   } else {
     m_log->message(4,
-                   "IP_SSATaucForwardProblem::apply_linearization converged"
-                   " (KSP reason %s)\n",
-                   KSPConvergedReasons[reason]);
+                   "%s converged (KSP reason %s)\n",
+                   caller, KSPConvergedReasons[reason]);
   }
+}
+
+/*!\brief Applies the linearization of the forward map (i.e. the reduced gradient \f$DF\f$ described in
+the class-level documentation.) */
+/*! As described previously,
+\f[
+Df = J_{\rm State}^{-1} J_{\rm Design}.
+\f]
+Applying the linearization then involves the solution of a linear equation.
+The matrices \f$J_{\rm State}\f$ and \f$J_{\rm Design}\f$ both depend on the value of the
+design variable \f$\zeta\f$ and the value of the corresponding state variable \f$u=F(\zeta)\f$.
+These are established by first calling linearize_at.
+  @param[in]   dzeta     Perturbation of the design variable
+  @param[out]  du        Computed corresponding perturbation of the state variable; ghosts (if present) are updated.
+*/
+void IP_SSATaucForwardProblem::apply_linearization(IceModelVec2S &dzeta, IceModelVec2V &du) {
+
+  update_state_jacobian();
+
+  this->apply_jacobian_design(m_velocity, dzeta, m_du_global);
+  m_du_global.scale(-1);
+
+  solve_state_system("IP_SSATaucForwardProblem::apply_linearization");
 
   du.copy_from(m_du_global);
 }
@@ -602,12 +666,7 @@ These are established by first calling linearize_at.
 void IP_SSATaucForwardProblem::apply_linearization_transpose(IceModelVec2V &du,
                                                              IceModelVec2S &dzeta) {
 
-  PetscErrorCode ierr;
-
-  if (m_rebuild_J_state) {
-    this->assemble_jacobian_state(m_velocity, m_J_state);
-    m_rebuild_J_state = false;
-  }
+  update_state_jacobian();
 
   // Aliases to help with notation consistency below.
   const IceModelVec2Int *dirichletLocations = m_bc_mask;
@@ -624,28 +683,7 @@ void IP_SSATaucForwardProblem::apply_linearization_transpose(IceModelVec2V &du,
 
   m_du_global.end_access();
 
-  // call PETSc to solve linear system by iterative method.
-  ierr = KSPSetOperators(m_ksp, m_J_state, m_J_state);
-  PISM_CHK(ierr, "KSPSetOperators");
-
-  ierr = KSPSolve(m_ksp, m_du_global.vec(), m_du_global.vec());
-  PISM_CHK(ierr, "KSPSolve"); // SOLVE
-
-  KSPConvergedReason  reason;
-  ierr = KSPGetConvergedReason(m_ksp, &reason);
-  PISM_CHK(ierr, "KSPGetConvergedReason");
-
-  if (reason < 0) {
-    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                  "IP_SSATaucForwardProblem::apply_linearization solve"
-                                  " failed to converge (KSP reason %s)",
-                                  KSPConvergedReasons[reason]);
-  } else {
-    m_log->message(4,
-                   "IP_SSATaucForwardProblem::apply_linearization converged"
-                   " (KSP reason %s)\n",
-                   KSPConvergedReasons[reason]);
-  }
+  solve_state_system("IP_SSATaucForwardProblem::apply_linearization_transpose");
 
   this->apply_jacobian_design_transpose(m_velocity, m_du_global, dzeta);
   dzeta.scale(-1);
@@ -194,6 +194,9 @@ protected:
   fem::ElementMap      m_element;
   fem::Q1Quadrature4   m_quadrature;
 
+  void update_state_jacobian();
+  void solve_state_system(const char *caller);
+
   /// KSP used in \ref apply_linearization and \ref apply_linearization_transpose
   petsc::KSP  m_ksp;
   /// Mat used in \ref apply_linearization and \ref apply_linearization_transpose
@@ -203,6 +206,13 @@ protected:
 
   /// Flag indicating that the state jacobian matrix needs rebuilding.
   bool m_rebuild_J_state;
+
+  /// Values of tauc used to build the current preconditioner of m_ksp.
+  IceModelVec2S m_tauc_pc;
+  /// True if m_ksp has a preconditioner that may be re-used.
+  bool m_pc_valid;
+  /// Maximum relative change in tauc allowing re-use of the preconditioner.
+  double m_pc_reuse_threshold;
 };
 
 } // end of namespace inverse
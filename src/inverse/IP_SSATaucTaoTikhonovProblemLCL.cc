@@ -170,19 +170,16 @@ void IP_SSATaucTaoTikhonovProblemLCL::evaluateObjectiveAndGradient(Tao /*tao*/,
 
   m_d_diff->copy_from(*m_d);
   m_d_diff->add(-1,m_d0);
-  m_designFunctional.gradientAt(*m_d_diff, *m_grad_design);
+  m_designFunctional.valueAndGradientAt(*m_d_diff, &m_val_design, *m_grad_design);
   m_grad_design->scale(1/m_eta);
 
   m_u_diff->copy_from(*m_uGlobal);
   m_u_diff->add(-1, m_u_obs);
-  m_stateFunctional.gradientAt(*m_u_diff, *m_grad_state);
+  m_stateFunctional.valueAndGradientAt(*m_u_diff, &m_val_state, *m_grad_state);
   m_grad_state->scale(m_velocityScale);
 
   m_x->gather(m_grad_design->vec(), m_grad_state->vec(), gradient);
 
-  m_designFunctional.valueAt(*m_d_diff, &m_val_design);
-  m_stateFunctional.valueAt(*m_u_diff, &m_val_state);
-
   *value = m_val_design / m_eta + m_val_state;
 }
 
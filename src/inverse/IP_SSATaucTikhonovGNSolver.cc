@@ -59,7 +59,8 @@ IP_SSATaucTikhonovGNSolver::IP_SSATaucTikhonovGNSolver(IP_SSATaucForwardProblem
     m_eta(eta),
     m_designFunctional(designFunctional),
     m_stateFunctional(stateFunctional),
-    m_target_misfit(0.0)
+    m_target_misfit(0.0),
+    m_checkpoint(d0.grid(), false)
 {
   PetscErrorCode ierr;
   IceGrid::ConstPtr grid = m_d0.grid();
@@ -113,6 +114,10 @@ IP_SSATaucTikhonovGNSolver::IP_SSATaucTikhonovGNSolver(IP_SSATaucForwardProblem
   m_tikhonov_ptol = grid->ctx()->config()->get_number("inverse.tikhonov.ptol");
 
   m_log = d0.grid()->ctx()->log();
+
+  // the state of the adaptive choice of the Tikhonov penalty
+  m_checkpoint.scalars["log_alpha"]  = m_logalpha;
+  m_checkpoint.scalars["dlog_alpha"] = 0.0;
 }
 
 IP_SSATaucTikhonovGNSolver::~IP_SSATaucTikhonovGNSolver() {
@@ -267,21 +272,18 @@ TerminationReason::Ptr IP_SSATaucTikhonovGNSolver::evaluate_objective_and_gradie
   m_u_diff.copy_from(*m_ssaforward.solution());
   m_u_diff.add(-1,m_u_obs);
 
-  m_designFunctional.gradientAt(m_d_diff,m_grad_design);
+  double valDesign, valState;
+  m_designFunctional.valueAndGradientAt(m_d_diff,&valDesign,m_grad_design);
 
   // The following computes the reduced gradient.
   StateVec &adjointRHS = m_tmp_S1Global;
-  m_stateFunctional.gradientAt(m_u_diff,adjointRHS);  
+  m_stateFunctional.valueAndGradientAt(m_u_diff,&valState,adjointRHS);
   m_ssaforward.apply_linearization_transpose(adjointRHS,m_grad_state);
 
   m_gradient.copy_from(m_grad_design);
   m_gradient.scale(m_alpha);    
   m_gradient.add(1,m_grad_state);
 
-  double valDesign, valState;
-  m_designFunctional.valueAt(m_d_diff,&valDesign);
-  m_stateFunctional.valueAt(m_u_diff,&valState);
-
   m_val_design = valDesign;
   m_val_state = valState;
   
@@ -345,6 +347,21 @@ TerminationReason::Ptr IP_SSATaucTikhonovGNSolver::solve() {
 
   double dlogalpha = 0;
 
+  if (m_checkpoint.restarting()) {
+    m_checkpoint.read();
+
+    m_iter = m_checkpoint.iteration;
+    m_d->copy_from(m_checkpoint.design);
+    m_d->update_ghosts();
+
+    m_logalpha = m_checkpoint.scalars["log_alpha"];
+    m_alpha    = exp(m_logalpha);
+    dlogalpha  = m_checkpoint.scalars["dlog_alpha"];
+
+    // the first forward solve below converges immediately
+    m_ssaforward.set_initial_guess(m_checkpoint.state);
+  }
+
   TerminationReason::Ptr step_reason, reason;
 
   step_reason = this->evaluate_objective_and_gradient();
@@ -392,6 +409,15 @@ TerminationReason::Ptr IP_SSATaucTikhonovGNSolver::solve() {
     }
 
     m_iter++;
+
+    if (m_checkpoint.due(m_iter)) {
+      m_checkpoint.iteration = m_iter;
+      m_checkpoint.design.copy_from(*m_d);
+      m_checkpoint.state.copy_from(*m_ssaforward.solution());
+      m_checkpoint.scalars["log_alpha"]  = m_logalpha;
+      m_checkpoint.scalars["dlog_alpha"] = dlogalpha;
+      m_checkpoint.write();
+    }
   }
 
   return reason;
@@ -20,6 +20,7 @@
 #define IP_SSATAUCTIKHONOVGN_HH_SIU7F33G
 
 #include "IP_SSATaucForwardProblem.hh"
+#include "IPCheckpoint.hh"
 #include "pism/util/TerminationReason.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/iceModelVec.hh"
@@ -164,6 +165,8 @@ protected:
 
   MPI_Comm m_comm;
   Logger::ConstPtr m_log;
+
+  IPCheckpoint m_checkpoint;
 };
 
 } // end of namespace inverse
@@ -16,8 +16,12 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cmath>
+#include <algorithm>             // std::max
+
 #include "IPFunctional.hh"
 #include "pism/util/IceGrid.hh"
+#include "pism/util/pism_utilities.hh"
 #include "pism/util/error_handling.hh"
 
 namespace pism {
@@ -113,7 +117,78 @@ void gradientFD(IPFunctional<IceModelVec2V> &f, IceModelVec2V &x, IceModelVec2V
   loop.check();
 }
 
-// PetscErrorCode gradientFD(IPFunctional<IceModelVec2V> &f, IceModelVec2V &x, IceModelVec2V &gradient);
+//! Euclidean dot product of gradient components (values at owned grid points).
+static double dot(const IceModelVec2S &a, const IceModelVec2S &b) {
+  const IceGrid &grid = *a.grid();
+
+  IceModelVec::AccessList list{&a, &b};
+
+  double result = 0.0;
+  for (Points p(grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result += a(i, j) * b(i, j);
+  }
+
+  return GlobalSum(grid.com, result);
+}
+
+static double dot(const IceModelVec2V &a, const IceModelVec2V &b) {
+  const IceGrid &grid = *a.grid();
+
+  IceModelVec::AccessList list{&a, &b};
+
+  double result = 0.0;
+  for (Points p(grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result += a(i, j).u * b(i, j).u + a(i, j).v * b(i, j).v;
+  }
+
+  return GlobalSum(grid.com, result);
+}
+
+template<class V>
+static std::vector<double> taylor_test_impl(IPFunctional<V> &f, V &x, V &direction,
+                                            const std::vector<double> &steps) {
+  IceGrid::ConstPtr grid = x.grid();
+
+  IceModelVecKind ghosted = x.stencil_width() > 0 ? WITH_GHOSTS : WITHOUT_GHOSTS;
+
+  V gradient(grid, "taylor_test_gradient", WITHOUT_GHOSTS);
+  V x_h(grid, "taylor_test_x", ghosted, std::max(x.stencil_width(), 1u));
+
+  double F0 = 0.0;
+  f.valueAndGradientAt(x, &F0, gradient);
+
+  const double dF = dot(gradient, direction);
+
+  std::vector<double> result;
+  for (auto h : steps) {
+    x_h.copy_from(x);
+    x_h.add(h, direction);
+    if (ghosted) {
+      x_h.update_ghosts();
+    }
+
+    double Fh = 0.0;
+    f.valueAt(x_h, &Fh);
+
+    result.push_back(std::fabs(Fh - F0 - h * dF));
+  }
+
+  return result;
+}
+
+std::vector<double> taylor_test(IPFunctional<IceModelVec2S> &f, IceModelVec2S &x,
+                                IceModelVec2S &direction, const std::vector<double> &steps) {
+  return taylor_test_impl(f, x, direction, steps);
+}
+
+std::vector<double> taylor_test(IPFunctional<IceModelVec2V> &f, IceModelVec2V &x,
+                                IceModelVec2V &direction, const std::vector<double> &steps) {
+  return taylor_test_impl(f, x, direction, steps);
+}
 
 } // end of namespace inverse
 } // end of namespace pism
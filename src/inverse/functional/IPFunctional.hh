@@ -19,6 +19,8 @@
 #ifndef IPFUNCTIONAL_HH_1E2DIXE6
 #define IPFUNCTIONAL_HH_1E2DIXE6
 
+#include <vector>
+
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/FETools.hh"
 
@@ -66,6 +68,14 @@ public:
   */
   virtual void gradientAt(IMVecType &x, IMVecType &gradient) = 0;
 
+  //! Computes both the value and the gradient of the functional at the vector x.
+  /*! Equivalent to calling valueAt() and gradientAt(). Subclasses override this to
+    compute both in one sweep over the grid. */
+  virtual void valueAndGradientAt(IMVecType &x, double *OUTPUT, IMVecType &gradient) {
+    this->valueAt(x, OUTPUT);
+    this->gradientAt(x, gradient);
+  }
+
 protected:
   IceGrid::ConstPtr m_grid;
 
@@ -125,13 +135,34 @@ public:
 };
 
 //! Computes finite difference approximations of a IPFunctional<IceModelVec2S> gradient.
-/*! Useful for debugging a hand coded gradient. */
+/*! Useful for debugging a hand coded gradient on a small grid: this requires one
+  evaluation of the functional per degree of freedom. Use taylor_test() on larger grids. */
 void gradientFD(IPFunctional<IceModelVec2S> &f, IceModelVec2S &x, IceModelVec2S &gradient);
 
 //! Computes finite difference approximations of a IPFunctional<IceModelVec2V> gradient.
-/*! Useful for debugging a hand coded gradient. */
+/*! Useful for debugging a hand coded gradient on a small grid. */
 void gradientFD(IPFunctional<IceModelVec2V> &f, IceModelVec2V &x, IceModelVec2V &gradient);
 
+//! Checks the gradient of a IPFunctional<IceModelVec2S> using directional derivatives.
+/*! Computes remainders of the first order Taylor expansion
+  \f[
+  r(h) = |J(x + h d) - J(x) - h \nabla J(x)^T d|
+  \f]
+  along the `direction` \f$d\f$ for each step length \f$h\f$ in `steps`.
+
+  If the gradient is correct then \f$r(h) = O(h^2)\f$, i.e. halving \f$h\f$ reduces
+  the remainder by a factor of four; an error in the gradient makes it \f$O(h)\f$.
+  Unlike gradientFD() this costs one gradient and `steps.size() + 1` functional
+  evaluations, independently of the grid size. Use a random `direction` to test all
+  components of the gradient at once.
+*/
+std::vector<double> taylor_test(IPFunctional<IceModelVec2S> &f, IceModelVec2S &x,
+                                IceModelVec2S &direction, const std::vector<double> &steps);
+
+//! Checks the gradient of a IPFunctional<IceModelVec2V> using directional derivatives.
+std::vector<double> taylor_test(IPFunctional<IceModelVec2V> &f, IceModelVec2V &x,
+                                IceModelVec2V &direction, const std::vector<double> &steps);
+
 } // end of namespace inverse
 } // end of namespace pism
 
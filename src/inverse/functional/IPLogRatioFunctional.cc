@@ -126,5 +126,43 @@ void IPLogRatioFunctional::gradientAt(IceModelVec2V &x, IceModelVec2V &gradient)
   }
 }
 
+void IPLogRatioFunctional::valueAndGradientAt(IceModelVec2V &x, double *OUTPUT,
+                                              IceModelVec2V &gradient) {
+  double value = 0;
+
+  double w = 1.;
+
+  IceModelVec::AccessList list{&x, &gradient, &m_u_observed};
+
+  if (m_weights) {
+    list.add(*m_weights);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (m_weights) {
+      w = (*m_weights)(i, j);
+    }
+    Vector2 &x_ij = x(i, j);
+    Vector2 &u_obs_ij = m_u_observed(i, j);
+    Vector2 u_model_ij = x_ij+u_obs_ij;
+
+    double obsMagSq = u_obs_ij.u*u_obs_ij.u + u_obs_ij.v*u_obs_ij.v + m_eps*m_eps;
+    double modelMagSq = (u_model_ij.u*u_model_ij.u + u_model_ij.v*u_model_ij.v)+m_eps*m_eps;
+    double v = log(modelMagSq/obsMagSq);
+    double dJdw =  2*w*v/modelMagSq;
+
+    value += w*v*v;
+
+    gradient(i, j).u = dJdw*2*u_model_ij.u/m_normalization;
+    gradient(i, j).v = dJdw*2*u_model_ij.v/m_normalization;
+  }
+
+  value /= m_normalization;
+
+  GlobalSum(m_grid->com, &value, OUTPUT, 1);
+}
+
 } // end of namespace inverse
 } // end of namespace pism
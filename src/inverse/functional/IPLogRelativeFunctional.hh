@@ -44,6 +44,7 @@ public:
 
   virtual void valueAt(IceModelVec2V &x, double *OUTPUT);
   virtual void gradientAt(IceModelVec2V &x, IceModelVec2V &gradient);
+  virtual void valueAndGradientAt(IceModelVec2V &x, double *OUTPUT, IceModelVec2V &gradient);
 
 protected:
   IceModelVec2V &m_u_observed;
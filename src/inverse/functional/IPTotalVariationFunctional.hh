@@ -37,6 +37,7 @@ public:
 
   virtual void valueAt(IceModelVec2S &x, double *OUTPUT);
   virtual void gradientAt(IceModelVec2S &x, IceModelVec2S &gradient);
+  virtual void valueAndGradientAt(IceModelVec2S &x, double *OUTPUT, IceModelVec2S &gradient);
 
 protected:
 
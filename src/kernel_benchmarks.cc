@@ -0,0 +1,1181 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Times individual numerical kernels on a synthetic ice sheet and reports their\n"
+  "throughput in grid points per second. Use -Mx, -My, -Mz, -Lx, -Ly, -Lz to set\n"
+  "the grid size. Add \"_separate\" to the name of an inversion functional kernel\n"
+  "(functional_*) to compute its value and gradient in two separate sweeps. Kernels\n"
+  "with the \"_tiled\" suffix traverse the grid in -tile_width x -tile_height tiles.\n\n";
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "pism/energy/enthSystem.hh"
+#include "pism/fracturedensity/FractureDensity.hh"
+#include "pism/geometry/Geometry.hh"
+#include "pism/geometry/GeometryEvolution.hh"
+#include "pism/geometry/grounded_cell_fraction.hh"
+#include "pism/inverse/functional/IPTotalVariationFunctional.hh"
+#include "pism/inverse/functional/IP_H1NormFunctional.hh"
+#include "pism/inverse/functional/IPLogRatioFunctional.hh"
+#include "pism/rheology/FlowLaw.hh"
+#include "pism/rheology/FlowLawFactory.hh"
+#include "pism/stressbalance/StressBalance.hh"
+#include "pism/stressbalance/sia/SIAFD.hh"
+#include "pism/stressbalance/sia/BedSmoother.hh"
+#include "pism/stressbalance/ssa/SSAFD.hh"
+#include "pism/stressbalance/ssa/SSAFEM.hh"
+#include "pism/tracer/TracerColumnSystem.hh"
+#include "pism/util/ColumnInterpolation.hh"
+#include "pism/util/ColumnSystem.hh"
+#include "pism/util/connected_components.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/EnthalpyConverter.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/LevelMajorArray.hh"
+#include "pism/util/Mask.hh"
+#include "pism/util/Units.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+namespace pism {
+
+// The classes below expose protected methods implementing numerical kernels so that
+// they can be timed in isolation.
+
+class SIAFDBenchmark : public stressbalance::SIAFD {
+public:
+  SIAFDBenchmark(IceGrid::ConstPtr grid)
+    : SIAFD(grid) {
+    // empty
+  }
+
+  //! Compute inputs of compute_diffusivity() that do not change between calls.
+  void setup(const stressbalance::Inputs &inputs) {
+    m_bed_smoother->preprocess_bed(inputs.geometry->bed_elevation);
+    compute_surface_gradient(inputs, m_h_x, m_h_y);
+  }
+
+  void run(const stressbalance::Inputs &inputs) {
+    compute_diffusivity(true, *inputs.geometry, inputs.enthalpy, inputs.age,
+                        m_h_x, m_h_y, m_D);
+  }
+
+  //! Compute the diffusivity and the diffusive flux as in update() without the full
+  //! update of 3D velocities.
+  void run_flux(const stressbalance::Inputs &inputs) {
+    compute_diffusivity_and_flux(false, *inputs.geometry, inputs.enthalpy, inputs.age,
+                                 m_h_x, m_h_y, m_D, &m_diffusive_flux);
+  }
+
+  //! Make the next run() re-compute ice softness (as after an energy balance update).
+  void reset_softness() {
+    m_softness_enthalpy = nullptr;
+  }
+};
+
+class SSAFDBenchmark : public stressbalance::SSAFD {
+public:
+  SSAFDBenchmark(IceGrid::ConstPtr grid)
+    : SSAFD(grid) {
+    // empty
+  }
+
+  //! Compute the hardness and the effective viscosity used by assemble_matrix().
+  void setup(const stressbalance::Inputs &inputs, const IceModelVec2V &velocity) {
+    m_velocity.copy_from(velocity);
+    compute_hardav_staggered(inputs);
+    compute_nuH_staggered(*inputs.geometry,
+                          m_config->get_number("stress_balance.ssa.epsilon"),
+                          m_nuH);
+  }
+
+  void run(const stressbalance::Inputs &inputs) {
+    assemble_matrix(inputs, true, m_A);
+  }
+};
+
+class SSAFEMBenchmark : public stressbalance::SSAFEM {
+public:
+  SSAFEMBenchmark(IceGrid::ConstPtr grid)
+    : SSAFEM(grid) {
+    // empty
+  }
+
+  //! Compute coefficients at element nodes used by compute_local_function().
+  void setup(const stressbalance::Inputs &inputs, const IceModelVec2V &velocity) {
+    m_velocity.copy_from(velocity);
+    cache_inputs(inputs);
+  }
+
+  //! Compute the residual at `m_velocity`, storing it in `m_velocity_global`.
+  void run() {
+    IceModelVec::AccessList list{&m_velocity, &m_velocity_global};
+    compute_local_function(m_velocity.get_array(), m_velocity_global.get_array());
+  }
+};
+
+class GeometryEvolutionBenchmark : public GeometryEvolution {
+public:
+  GeometryEvolutionBenchmark(IceGrid::ConstPtr grid)
+    : GeometryEvolution(grid) {
+    // empty
+  }
+
+  void run(double dt, const IceModelVec2S &flux_divergence, Geometry &geometry) {
+    update_in_place(dt,
+                    geometry.bed_elevation, geometry.sea_level_elevation, flux_divergence,
+                    geometry.ice_thickness, geometry.ice_area_specific_volume);
+  }
+};
+
+//! A synthetic marine ice sheet: a dome on a bed sloping down below sea level.
+/*!
+ * The ice sheet has grounded, floating, and ice-free areas, so that kernels
+ * treating these differently exercise all branches.
+ */
+struct SyntheticIceSheet {
+  SyntheticIceSheet(IceGrid::ConstPtr grid, const EnthalpyConverter &EC)
+    : geometry(grid),
+      enthalpy(grid, "enthalpy", WITH_GHOSTS,
+               grid->ctx()->config()->get_number("grid.max_stencil_width")),
+      age(grid, "age", WITHOUT_GHOSTS),
+      u(grid, "uvel", WITH_GHOSTS),
+      v(grid, "vvel", WITH_GHOSTS),
+      w(grid, "wvel", WITHOUT_GHOSTS),
+      strain_heating(grid, "strain_heating", WITHOUT_GHOSTS),
+      tauc(grid, "tauc", WITH_GHOSTS,
+           grid->ctx()->config()->get_number("grid.max_stencil_width")),
+      flux_divergence(grid, "flux_divergence", WITHOUT_GHOSTS),
+      velocity(grid, "bar", WITH_GHOSTS,
+               grid->ctx()->config()->get_number("grid.max_stencil_width")) {
+
+    Config::ConstPtr config = grid->ctx()->config();
+    units::System::Ptr sys = grid->ctx()->unit_system();
+
+    const double
+      R          = 0.8 * std::min(grid->Lx(), grid->Ly()),
+      H_max      = 0.75 * grid->Lz(),
+      b_max      = 500.0,
+      b_min      = -1000.0,
+      T_surface  = 243.15,
+      one_year   = units::convert(sys, 1.0, "year", "seconds"),
+      ice_free_H = config->get_number("geometry.ice_free_thickness_standard");
+
+    const std::vector<double> &z = grid->z();
+    std::vector<double> E(z.size());
+
+    geometry.sea_level_elevation.set(0.0);
+    geometry.ice_area_specific_volume.set(0.0);
+    age.set(0.0);
+    w.set(0.0);
+    strain_heating.set(0.0);
+    tauc.set(1e5);
+
+    IceModelVec::AccessList list{&geometry.bed_elevation, &geometry.ice_thickness,
+        &enthalpy, &u, &v, &flux_divergence, &velocity};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      const double
+        x = grid->x(i),
+        y = grid->y(j),
+        r = std::sqrt(x * x + y * y) / R;
+
+      geometry.bed_elevation(i, j) = b_max + (b_min - b_max) * std::min(r, 1.0);
+      const double H = r < 1.0 ? H_max * std::sqrt(1.0 - r * r) : 0.0;
+      geometry.ice_thickness(i, j) = H;
+
+      // cold ice at the surface, temperate ice at the base
+      for (unsigned int k = 0; k < z.size(); ++k) {
+        const double
+          depth = std::max(H - z[k], 0.0),
+          pressure = EC.pressure(depth),
+          T_m = EC.melting_temperature(pressure),
+          lambda = H > 0.0 ? depth / H : 0.0;
+
+        E[k] = EC.enthalpy(T_surface + lambda * (T_m - T_surface), 0.0, pressure);
+      }
+      enthalpy.set_column(i, j, E.data());
+
+      // radial flow, faster near the margin
+      const double speed = 100.0 * r / one_year;
+      const double angle = std::atan2(y, x);
+      u.set_column(i, j, speed * std::cos(angle));
+      v.set_column(i, j, speed * std::sin(angle));
+      velocity(i, j) = Vector2(speed * std::cos(angle), speed * std::sin(angle));
+
+      flux_divergence(i, j) = (1.0 - 2.0 * r) / one_year;
+    }
+
+    geometry.bed_elevation.update_ghosts();
+    geometry.bed_elevation.inc_state_counter();
+    geometry.ice_thickness.update_ghosts();
+    geometry.ice_thickness.inc_state_counter();
+    enthalpy.update_ghosts();
+    u.update_ghosts();
+    v.update_ghosts();
+    velocity.update_ghosts();
+
+    geometry.ensure_consistency(ice_free_H);
+
+    inputs.geometry           = &geometry;
+    inputs.enthalpy           = &enthalpy;
+    inputs.age                = &age;
+    inputs.basal_yield_stress = &tauc;
+  }
+
+  Geometry geometry;
+  IceModelVec3 enthalpy, age, u, v, w, strain_heating;
+  IceModelVec2S tauc, flux_divergence;
+  IceModelVec2V velocity;
+  stressbalance::Inputs inputs;
+};
+
+//! Time `n_repeats` calls of `kernel`, calling `reset` (not timed) before each one.
+/*!
+ * Returns the elapsed time (maximum over all ranks).
+ */
+static double time_kernel(MPI_Comm com, int n_repeats,
+                          std::function<void()> reset,
+                          std::function<void()> kernel) {
+  double elapsed = 0.0;
+  for (int r = 0; r < n_repeats; ++r) {
+    reset();
+
+    MPI_Barrier(com);
+    double start = get_time();
+    kernel();
+    elapsed += get_time() - start;
+  }
+  return GlobalMax(com, elapsed);
+}
+
+static void no_reset() {
+  // empty
+}
+
+//! Number of map-plane grid points owned by this rank.
+static double local_size(const IceGrid &grid) {
+  return grid.xm() * grid.ym();
+}
+
+// Functions below time a kernel and return the number of points processed by this rank
+// in one call.
+
+static double bench_enthalpy(const SyntheticIceSheet &S, const Config &config,
+                             EnthalpyConverter::Ptr EC, double dt,
+                             int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  energy::enthSystemCtx system(grid->z(), "energy.enthalpy", grid->dx(), grid->dy(), dt,
+                               config, S.enthalpy, S.u, S.v, S.w, S.strain_heating, EC,
+                               config.get_flag("energy.enthalpy.use_storage_grid"));
+
+  std::vector<double> E_new(system.z().size());
+
+  const double
+    T_surface = 243.15,
+    E_surface = EC->enthalpy(T_surface, 0.0, 0.0),
+    G         = 0.042;          // W m-2
+
+  double n_points = 0.0;
+
+  IceModelVec::AccessList list{&S.geometry.ice_thickness,
+      &S.enthalpy, &S.u, &S.v, &S.w, &S.strain_heating};
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       n_points = 0.0;
+                       for (Points p(*grid); p; p.next()) {
+                         const int i = p.i(), j = p.j();
+
+                         system.init(i, j, false, S.geometry.ice_thickness(i, j));
+
+                         if (system.ks() == 0) {
+                           continue;
+                         }
+
+                         system.set_surface_dirichlet_bc(E_surface);
+                         system.set_basal_heat_flux(G);
+                         system.solve(E_new);
+
+                         n_points += system.ks() + 1;
+                       }
+                     });
+
+  return n_points;
+}
+
+static double bench_tridiagonal(const SyntheticIceSheet &S, int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const unsigned int Mz = grid->Mz();
+
+  TridiagonalSystem system(Mz, "benchmark");
+  std::vector<double> x(Mz);
+
+  IceModelVec::AccessList list{&S.enthalpy};
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       for (Points p(*grid); p; p.next()) {
+                         const double *E = S.enthalpy.get_column(p.i(), p.j());
+
+                         // a diagonally-dominant system similar to the ones used
+                         // in the energy balance code
+                         for (unsigned int k = 0; k < Mz; ++k) {
+                           system.L(k)   = -1.0;
+                           system.D(k)   = 3.0;
+                           system.U(k)   = -1.0;
+                           system.RHS(k) = E[k];
+                         }
+                         system.solve(Mz, x);
+                       }
+                     });
+
+  return local_size(*grid) * Mz;
+}
+
+//! Advect `n_tracers` tracers, either in one column sweep (`fused`) or one tracer at a
+//! time (re-reading velocity components for each tracer).
+static double bench_tracers(const SyntheticIceSheet &S, bool fused, unsigned int n_tracers,
+                            double dt, int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const unsigned int stencil_width = 1;
+
+  std::vector<std::shared_ptr<IceModelVec3> > storage;
+  std::vector<const IceModelVec3*> tracers;
+  for (unsigned int c = 0; c < n_tracers; ++c) {
+    std::shared_ptr<IceModelVec3> T(new IceModelVec3(grid, "tracer", WITH_GHOSTS,
+                                                     stencil_width));
+    T->set(c + 1.0);
+    storage.push_back(T);
+    tracers.push_back(T.get());
+  }
+
+  std::vector<std::shared_ptr<TracerColumnSystem> > systems;
+  if (fused) {
+    systems.emplace_back(new TracerColumnSystem(grid->z(), "tracers", grid->dx(), grid->dy(),
+                                                dt, tracers, S.u, S.v, S.w));
+  } else {
+    for (auto T : tracers) {
+      systems.emplace_back(new TracerColumnSystem(grid->z(), "tracer", grid->dx(), grid->dy(),
+                                                  dt, {T}, S.u, S.v, S.w));
+    }
+  }
+
+  std::vector<double>
+    sources(fused ? n_tracers : 1, 1.0),
+    boundary_values(fused ? n_tracers : 1, 0.0);
+  std::vector<std::vector<double> > x;
+
+  IceModelVec::AccessList list{&S.geometry.ice_thickness, &S.u, &S.v, &S.w};
+  for (auto T : tracers) {
+    list.add(*T);
+  }
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       for (Points p(*grid); p; p.next()) {
+                         const int i = p.i(), j = p.j();
+
+                         for (auto system : systems) {
+                           system->init(i, j, S.geometry.ice_thickness(i, j));
+
+                           if (system->ks() > 0) {
+                             system->solve(sources, boundary_values, x);
+                           }
+                         }
+                       }
+                     });
+
+  return local_size(*grid) * n_tracers;
+}
+
+static double bench_fracture_density(const SyntheticIceSheet &S,
+                                     std::shared_ptr<const rheology::FlowLaw> flow_law,
+                                     double dt, int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  FractureDensity model(grid, flow_law);
+  model.initialize();
+
+  IceModelVec2S hardness(grid, "hardness", WITHOUT_GHOSTS);
+  hardness.set(1e8);            // roughly the hardness of ice at -10 degrees C
+
+  IceModelVec2S bc_mask(grid, "bc_mask", WITHOUT_GHOSTS);
+  bc_mask.set(0.0);
+
+  IceModelVec2 strain_rates(grid, "strain_rates", WITHOUT_GHOSTS, 0, 2);
+  IceModelVec2 stresses(grid, "stresses", WITHOUT_GHOSTS, 0, 3);
+
+  stressbalance::compute_2D_principal_strain_rates(S.velocity, S.geometry.cell_type,
+                                                   strain_rates);
+  stressbalance::compute_2D_stresses(*flow_law, S.velocity, hardness, S.geometry.cell_type,
+                                     stresses);
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       model.update(dt, S.geometry, S.velocity, strain_rates, stresses,
+                                    bc_mask);
+                     });
+
+  return local_size(*grid);
+}
+
+//! If `cached` is true ice softness is computed once and re-used by all repetitions (as
+//! between energy balance updates).
+static double bench_sia(const SyntheticIceSheet &S, bool cached, bool flux, int n_repeats,
+                        double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  SIAFDBenchmark sia(grid);
+  sia.init();
+  sia.setup(S.inputs);
+
+  if (cached) {
+    sia.run(S.inputs);
+  }
+
+  time = time_kernel(grid->com, n_repeats,
+                     [&]() {
+                       if (not cached) {
+                         sia.reset_softness();
+                       }
+                     },
+                     [&]() {
+                       if (flux) {
+                         sia.run_flux(S.inputs);
+                       } else {
+                         sia.run(S.inputs);
+                       }
+                     });
+
+  return local_size(*grid);
+}
+
+static double bench_ssafd(const SyntheticIceSheet &S, int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  SSAFDBenchmark ssa(grid);
+  ssa.init();
+  ssa.setup(S.inputs, S.velocity);
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() { ssa.run(S.inputs); });
+
+  return local_size(*grid);
+}
+
+static double bench_ssafem(const SyntheticIceSheet &S, int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  SSAFEMBenchmark ssa(grid);
+  ssa.init();
+  ssa.setup(S.inputs, S.velocity);
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() { ssa.run(); });
+
+  return local_size(*grid);
+}
+
+static double bench_geometry(SyntheticIceSheet &S, double dt, int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  GeometryEvolutionBenchmark ge(grid);
+
+  // update_in_place() modifies the geometry: save it to restore before each call
+  IceModelVec2S
+    H(grid, "thk", WITHOUT_GHOSTS),
+    Href(grid, "ice_area_specific_volume", WITHOUT_GHOSTS);
+  H.copy_from(S.geometry.ice_thickness);
+  Href.copy_from(S.geometry.ice_area_specific_volume);
+
+  time = time_kernel(grid->com, n_repeats,
+                     [&]() {
+                       S.geometry.ice_thickness.copy_from(H);
+                       S.geometry.ice_area_specific_volume.copy_from(Href);
+                     },
+                     [&]() { ge.run(dt, S.flux_divergence, S.geometry); });
+
+  S.geometry.ice_thickness.copy_from(H);
+  S.geometry.ice_area_specific_volume.copy_from(Href);
+
+  return local_size(*grid);
+}
+
+static double bench_grounded_cell_fraction(const SyntheticIceSheet &S, const Config &config,
+                                           int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const double
+    ice_density   = config.get_number("constants.ice.density"),
+    ocean_density = config.get_number("constants.sea_water.density");
+
+  IceModelVec2S result(grid, "cell_grounded_fraction", WITHOUT_GHOSTS);
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       compute_grounded_cell_fraction(ice_density, ocean_density,
+                                                      S.geometry.sea_level_elevation,
+                                                      S.geometry.ice_thickness,
+                                                      S.geometry.bed_elevation,
+                                                      result);
+                     });
+
+  return local_size(*grid);
+}
+
+static double bench_connected_components(const SyntheticIceSheet &S, int n_repeats,
+                                         double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const int
+    xs = grid->xs(),
+    xm = grid->xm(),
+    ys = grid->ys(),
+    ym = grid->ym();
+
+  // the image of the icy part of the local sub-domain; label_connected_components()
+  // labels it in place
+  std::vector<double> mask(xm * ym), image(xm * ym);
+  {
+    IceModelVec::AccessList list{&S.geometry.cell_type};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      mask[(j - ys) * xm + (i - xs)] = S.geometry.cell_type.icy(i, j) ? 1.0 : 0.0;
+    }
+  }
+
+  time = time_kernel(grid->com, n_repeats,
+                     [&]() { image = mask; },
+                     [&]() { label_connected_components(image.data(), ym, xm, false, 0.0); });
+
+  return local_size(*grid);
+}
+
+static double bench_column_interpolation(const SyntheticIceSheet &S, const Config &config,
+                                         EnthalpyConverter::Ptr EC, double dt,
+                                         int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  // use the same fine grid as the enthalpy solver
+  std::vector<double> z_fine;
+  {
+    energy::enthSystemCtx system(grid->z(), "energy.enthalpy", grid->dx(), grid->dy(), dt,
+                                 config, S.enthalpy, S.u, S.v, S.w, S.strain_heating, EC);
+    z_fine = system.z();
+  }
+
+  ColumnInterpolation interp(grid->z(), z_fine);
+  std::vector<double> E_fine(z_fine.size());
+
+  const double dz = z_fine.size() > 1 ? z_fine[1] - z_fine[0] : grid->Lz();
+
+  IceModelVec::AccessList list{&S.geometry.ice_thickness, &S.enthalpy};
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       for (Points p(*grid); p; p.next()) {
+                         const int i = p.i(), j = p.j();
+
+                         const unsigned int ks = std::min(
+                           static_cast<unsigned int>(S.geometry.ice_thickness(i, j) / dz),
+                           static_cast<unsigned int>(z_fine.size() - 1));
+
+                         interp.coarse_to_fine(S.enthalpy.get_column(i, j), ks, E_fine.data());
+                       }
+                     });
+
+  return local_size(*grid) * z_fine.size();
+}
+
+static double bench_flow_law(const SyntheticIceSheet &S, const rheology::FlowLaw &law,
+                             int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const std::vector<double> &z = grid->z();
+  const unsigned int
+    Mz = z.size(),
+    N  = grid->xm() * grid->ym();
+
+  // copy enthalpy and pressure to contiguous storage (column c is at [c * Mz, (c + 1) * Mz))
+  std::vector<double> E(Mz * N), P(Mz * N), A(Mz * N);
+  {
+    const EnthalpyConverter &EC = *law.EC();
+
+    IceModelVec::AccessList list{&S.geometry.ice_thickness, &S.enthalpy};
+
+    unsigned int c = 0;
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      const double H = S.geometry.ice_thickness(i, j);
+      const double *column = S.enthalpy.get_column(i, j);
+
+      for (unsigned int k = 0; k < Mz; ++k) {
+        E[c * Mz + k] = column[k];
+        P[c * Mz + k] = EC.pressure(std::max(H - z[k], 0.0));
+      }
+      ++c;
+    }
+  }
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       for (unsigned int c = 0; c < N; ++c) {
+                         law.softness_n(&E[c * Mz], &P[c * Mz], Mz, &A[c * Mz]);
+                       }
+                     });
+
+  return static_cast<double>(N) * Mz;
+}
+
+// The three kernels below compare the column-major (IceModelVec3) and the level-major
+// (LevelMajorArray) layouts using the horizontal divergence of (u, v) at all levels,
+// which is a typical horizontal 3D kernel.
+
+static double bench_divergence_columns(const SyntheticIceSheet &S, int n_repeats,
+                                       double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const unsigned int Mz = grid->Mz();
+  const double
+    dx = grid->dx(),
+    dy = grid->dy();
+
+  std::vector<double> result(grid->xm() * grid->ym() * Mz);
+
+  IceModelVec::AccessList list{&S.u, &S.v};
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       unsigned int c = 0;
+                       for (Points p(*grid); p; p.next()) {
+                         const int i = p.i(), j = p.j();
+
+                         const double
+                           *u_e = S.u.get_column(i + 1, j),
+                           *u_w = S.u.get_column(i - 1, j),
+                           *v_n = S.v.get_column(i, j + 1),
+                           *v_s = S.v.get_column(i, j - 1);
+
+                         double *d = &result[c * Mz];
+                         for (unsigned int k = 0; k < Mz; ++k) {
+                           d[k] = (u_e[k] - u_w[k]) / (2.0 * dx) + (v_n[k] - v_s[k]) / (2.0 * dy);
+                         }
+                         ++c;
+                       }
+                     });
+
+  return local_size(*grid) * Mz;
+}
+
+static double bench_divergence_levels(const SyntheticIceSheet &S, int n_repeats,
+                                      double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const unsigned int Mz = grid->Mz();
+  const int
+    xs = grid->xs(),
+    xm = grid->xm(),
+    ys = grid->ys(),
+    ym = grid->ym();
+  const double
+    dx = grid->dx(),
+    dy = grid->dy();
+
+  LevelMajorArray u(grid, Mz, 1), v(grid, Mz, 1);
+  u.copy_from(S.u);
+  v.copy_from(S.v);
+
+  const int stride = u.stride();
+
+  std::vector<double> result(xm * ym * Mz);
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       for (unsigned int k = 0; k < Mz; ++k) {
+                         for (int j = ys; j < ys + ym; ++j) {
+                           const double
+                             *u_row = u.level(k, xs, j),
+                             *v_row = v.level(k, xs, j);
+
+                           double *d = &result[(k * ym + (j - ys)) * xm];
+                           for (int c = 0; c < xm; ++c) {
+                             d[c] = ((u_row[c + 1] - u_row[c - 1]) / (2.0 * dx) +
+                                     (v_row[c + stride] - v_row[c - stride]) / (2.0 * dy));
+                           }
+                         }
+                       }
+                     });
+
+  return local_size(*grid) * Mz;
+}
+
+static double bench_level_major_transpose(const SyntheticIceSheet &S, int n_repeats,
+                                          double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const unsigned int Mz = grid->Mz();
+
+  LevelMajorArray u(grid, Mz, 1), v(grid, Mz, 1);
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       u.copy_from(S.u);
+                       v.copy_from(S.v);
+                     });
+
+  return 2.0 * local_size(*grid) * Mz;
+}
+
+// The two kernels below compare reading the cell type mask stored as doubles
+// (IceModelVec2CellType) and its compact copy (CompactMask) in a loop counting ice margin
+// cells, which is a typical mask-heavy loop (cf. SSAFD::is_marginal()).
+
+template<class M>
+static int count_margin_cells(const IceGrid &grid, const M &cell_type) {
+  int result = 0;
+  for (Points p(grid); p; p.next()) {
+    auto C = cell_type.int_box(p.i(), p.j());
+
+    if (mask::icy(C.ij) and
+        (mask::ice_free_ocean(C.e) or mask::ice_free_ocean(C.w) or
+         mask::ice_free_ocean(C.n) or mask::ice_free_ocean(C.s) or
+         mask::ice_free_ocean(C.ne) or mask::ice_free_ocean(C.se) or
+         mask::ice_free_ocean(C.nw) or mask::ice_free_ocean(C.sw))) {
+      result += 1;
+    }
+  }
+  return result;
+}
+
+static double bench_cell_type(const SyntheticIceSheet &S, bool compact, int n_repeats,
+                              double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const IceModelVec2CellType &cell_type = S.geometry.cell_type;
+
+  IceModelVec::AccessList list{&cell_type};
+
+  // the compact copy is made once and then re-used by all kernels reading the mask
+  const auto &compact_cell_type = cell_type.compact();
+
+  int count = 0;
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       if (compact) {
+                         count += count_margin_cells(*grid, compact_cell_type);
+                       } else {
+                         count += count_margin_cells(*grid, cell_type);
+                       }
+                     });
+  (void) count;
+
+  return local_size(*grid);
+}
+
+//! Compute cell types and surface elevations one point at a time (`rows` is false) or
+//! using GeometryCalculator::compute_mask() and compute_surface(), which process whole
+//! rows.
+static double bench_geometry_calculator(const SyntheticIceSheet &S, const Config &config,
+                                        bool rows, int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const IceModelVec2S
+    &sea_level = S.geometry.sea_level_elevation,
+    &bed       = S.geometry.bed_elevation,
+    &thickness = S.geometry.ice_thickness;
+
+  IceModelVec2Int cell_type(grid, "cell_type", WITH_GHOSTS);
+  IceModelVec2S surface(grid, "surface", WITH_GHOSTS);
+
+  GeometryCalculator gc(config);
+
+  if (rows) {
+    time = time_kernel(grid->com, n_repeats, no_reset,
+                       [&]() {
+                         gc.compute_mask(sea_level, bed, thickness, cell_type);
+                         gc.compute_surface(sea_level, bed, thickness, surface);
+                       });
+  } else {
+    IceModelVec::AccessList list{&sea_level, &bed, &thickness, &cell_type, &surface};
+
+    time = time_kernel(grid->com, n_repeats, no_reset,
+                       [&]() {
+                         for (PointsWithGhosts p(*grid); p; p.next()) {
+                           const int i = p.i(), j = p.j();
+
+                           cell_type(i, j) = gc.mask(sea_level(i, j), bed(i, j), thickness(i, j));
+                           surface(i, j) = gc.surface(sea_level(i, j), bed(i, j), thickness(i, j));
+                         }
+                       });
+  }
+
+  // both versions have to produce identical results
+  {
+    IceModelVec::AccessList list{&sea_level, &bed, &thickness, &cell_type, &surface};
+
+    ParallelSection loop(grid->com);
+    try {
+      for (PointsWithGhosts p(*grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        if (cell_type(i, j) != gc.mask(sea_level(i, j), bed(i, j), thickness(i, j)) or
+            surface(i, j) != gc.surface(sea_level(i, j), bed(i, j), thickness(i, j))) {
+          throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                        "GeometryCalculator results differ at (%d, %d)", i, j);
+        }
+      }
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
+  }
+
+  return local_size(*grid);
+}
+
+// The two kernels below compare accessing fields using IceModelVec2Stag::star() and
+// IceModelVec2S::operator() (one row pointer per access) and using flat views (see
+// FlatView) in the flux divergence computation (cf.
+// GeometryEvolution::compute_flux_divergence()).
+
+static double bench_flux_divergence(const SyntheticIceSheet &S, bool flat, int n_repeats,
+                                    double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const double
+    dx = grid->dx(),
+    dy = grid->dy();
+
+  const IceModelVec2S &H = S.geometry.ice_thickness;
+
+  IceModelVec2Stag Q(grid, "flux", WITH_GHOSTS);
+  IceModelVec2S divQ(grid, "flux_divergence", WITHOUT_GHOSTS);
+
+  IceModelVec::AccessList list{&H, &Q, &divQ};
+
+  // a flux proportional to the thickness gradient (the actual value does not matter here)
+  for (PointsWithGhosts p(*grid, 1); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    Q(i, j, 0) = 1e-3 * (H(i + 1, j) - H(i, j));
+    Q(i, j, 1) = 1e-3 * (H(i, j + 1) - H(i, j));
+  }
+
+  const IceModelVec2Stag &flux = Q;
+  const auto Q_view = flux.flat_view();
+  const auto result = divQ.flat_view();
+
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       if (flat) {
+                         const int stride = Q_view.stride();
+                         for (Points p(*grid); p; p.next_row()) {
+                           const int
+                             i = p.i_first(),
+                             j = p.j(),
+                             n = p.i_last() - i + 1;
+
+                           const double *q_row = Q_view.pointer(i, j);
+                           double *d = result.pointer(i, j);
+                           for (int m = 0; m < n; ++m) {
+                             const double *q = q_row + 2 * m;
+                             d[m] = (q[0] - q[-2]) / dx + (q[1] - q[1 - stride]) / dy;
+                           }
+                         }
+                       } else {
+                         for (Points p(*grid); p; p.next()) {
+                           const int i = p.i(), j = p.j();
+
+                           auto q = flux.star(i, j);
+                           divQ(i, j) = (q.e - q.w) / dx + (q.n - q.s) / dy;
+                         }
+                       }
+                     });
+
+  return local_size(*grid);
+}
+
+// The kernel below chains the diffusive flux (SIAFD::compute_diffusive_flux()) and its
+// divergence (GeometryEvolution::compute_flux_divergence()), i.e. the SIA part of the
+// mass transport. If `tiled` is true both steps are applied to one tile at a time (see
+// Tiles), otherwise each step is a sweep over the whole sub-domain.
+
+static double bench_sia_flux_divergence(const SyntheticIceSheet &S, bool tiled,
+                                        int tile_width, int tile_height,
+                                        int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = S.geometry.ice_thickness.grid();
+
+  const double
+    dx = grid->dx(),
+    dy = grid->dy();
+
+  const IceModelVec2S
+    &H = S.geometry.ice_thickness,
+    &h = S.geometry.ice_surface_elevation;
+
+  IceModelVec2Stag
+    D(grid, "diffusivity", WITH_GHOSTS),
+    Q(grid, "flux", WITH_GHOSTS);
+  IceModelVec2S divQ(grid, "flux_divergence", WITHOUT_GHOSTS);
+
+  IceModelVec::AccessList list{&H, &h, &D, &Q, &divQ};
+
+  // a diffusivity proportional to H^2 (the actual value does not matter here)
+  for (PointsWithGhosts p(*grid, 1); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    D(i, j, 0) = 1e-6 * std::pow(0.5 * (H(i, j) + H(i + 1, j)), 2);
+    D(i, j, 1) = 1e-6 * std::pow(0.5 * (H(i, j) + H(i, j + 1)), 2);
+  }
+
+  auto flux = [&](int i, int j) {
+    Q(i, j, 0) = - D(i, j, 0) * (h(i + 1, j) - h(i, j)) / dx;
+    Q(i, j, 1) = - D(i, j, 1) * (h(i, j + 1) - h(i, j)) / dy;
+  };
+
+  auto divergence = [&](int i, int j) {
+    divQ(i, j) = (Q(i, j, 0) - Q(i - 1, j, 0)) / dx + (Q(i, j, 1) - Q(i, j - 1, 1)) / dy;
+  };
+
+  if (tiled) {
+    time = time_kernel(grid->com, n_repeats, no_reset,
+                       [&]() {
+                         for (Tiles t(*grid, 0, tile_width, tile_height); t; t.next()) {
+                           for (TilePoints p(t, 1); p; p.next()) {
+                             flux(p.i(), p.j());
+                           }
+                           for (TilePoints p(t); p; p.next()) {
+                             divergence(p.i(), p.j());
+                           }
+                         }
+                       });
+  } else {
+    time = time_kernel(grid->com, n_repeats, no_reset,
+                       [&]() {
+                         for (PointsWithGhosts p(*grid, 1); p; p.next()) {
+                           flux(p.i(), p.j());
+                         }
+                         for (Points p(*grid); p; p.next()) {
+                           divergence(p.i(), p.j());
+                         }
+                       });
+  }
+
+  return local_size(*grid);
+}
+
+//! Time computing the value and the gradient of an inversion functional `f` at `x`.
+/*!
+ * If `fused` is false the value and the gradient are computed separately (two sweeps
+ * over the grid), otherwise using IPFunctional::valueAndGradientAt().
+ */
+template<class V>
+static double time_functional(inverse::IPFunctional<V> &f, V &x, bool fused,
+                              int n_repeats, double &time) {
+  IceGrid::ConstPtr grid = x.grid();
+
+  V gradient(grid, "gradient", WITHOUT_GHOSTS);
+
+  double value = 0.0;
+  time = time_kernel(grid->com, n_repeats, no_reset,
+                     [&]() {
+                       if (fused) {
+                         f.valueAndGradientAt(x, &value, gradient);
+                       } else {
+                         f.valueAt(x, &value);
+                         f.gradientAt(x, gradient);
+                       }
+                     });
+
+  return local_size(*grid);
+}
+
+static double bench_functional_tv(SyntheticIceSheet &S, bool fused, int n_repeats,
+                                  double &time) {
+  IceGrid::ConstPtr grid = S.tauc.grid();
+
+  inverse::IPTotalVariationFunctional2S f(grid, 1.0, 1.2, 1e-4);
+
+  return time_functional(f, S.geometry.ice_thickness, fused, n_repeats, time);
+}
+
+static double bench_functional_h1(SyntheticIceSheet &S, bool fused, int n_repeats,
+                                  double &time) {
+  IceGrid::ConstPtr grid = S.tauc.grid();
+
+  inverse::IP_H1NormFunctional2S f(grid, 1.0, 1.0);
+
+  return time_functional(f, S.geometry.ice_thickness, fused, n_repeats, time);
+}
+
+static double bench_functional_log_ratio(SyntheticIceSheet &S, bool fused, int n_repeats,
+                                         double &time) {
+  IceGrid::ConstPtr grid = S.tauc.grid();
+
+  inverse::IPLogRatioFunctional f(grid, S.velocity, 1e-3);
+  f.normalize(1.0);
+
+  return time_functional(f, S.velocity, fused, n_repeats, time);
+}
+
+} // end of namespace pism
+
+using namespace pism;
+
+int main(int argc, char *argv[]) {
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "kernel_benchmarks");
+    Logger::Ptr log = ctx->log();
+    Config::Ptr config = ctx->config();
+
+    options::StringList kernels("-kernels", "Kernels to benchmark",
+                               "enthalpy,tridiagonal,sia,sia_cached,sia_flux,ssafd,ssafem,geometry,"
+                               "connected_components,column_interpolation,flow_law,"
+                               "divergence_columns,divergence_levels,level_major_transpose,"
+                               "functional_tv,functional_h1,functional_log_ratio,"
+                               "sia_flux_divergence,sia_flux_divergence_tiled,"
+                               "grounded_cell_fraction,cell_type_double,cell_type_compact,"
+                               "geometry_calculator_points,geometry_calculator_rows,"
+                               "flux_divergence_indexed,flux_divergence_flat,"
+                               "tracers_separate,tracers_fused,fracture_density");
+    options::Integer n_repeats("-n_repeats", "Number of times to repeat each kernel", 10);
+    options::Integer n_tracers("-n_tracers", "Number of tracers used by tracers_* kernels", 4);
+    options::Integer tile_width("-tile_width", "Width of tiles used by *_tiled kernels", 128);
+    options::Integer tile_height("-tile_height", "Height of tiles used by *_tiled kernels", 32);
+
+    if (n_repeats < 1) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "-n_repeats has to be positive");
+    }
+
+    if (n_tracers < 1) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "-n_tracers has to be positive");
+    }
+
+    GridParameters P(config);
+    P.horizontal_size_from_options();
+    P.horizontal_extent_from_options();
+    P.vertical_grid_from_options(config);
+    P.ownership_ranges_from_options(ctx->size());
+
+    IceGrid::Ptr grid(new IceGrid(ctx, P));
+    grid->report_parameters();
+
+    EnthalpyConverter::Ptr EC = ctx->enthalpy_converter();
+
+    const double dt = units::convert(ctx->unit_system(), 1.0, "year", "seconds");
+
+    SyntheticIceSheet S(grid, *EC);
+
+    rheology::FlowLawFactory factory("stress_balance.sia.", config, EC);
+    auto flow_law = factory.create();
+
+    log->message(2, "%d repetitions\n", n_repeats.value());
+    log->message(2, "%22s %14s %12s %16s\n",
+                 "kernel", "points", "time (s)", "points/s");
+
+    for (const auto &name : kernels.value()) {
+      double n_points = 0.0, time = 0.0;
+
+      if (name == "enthalpy") {
+        n_points = bench_enthalpy(S, *config, EC, dt, n_repeats, time);
+      } else if (name == "tridiagonal") {
+        n_points = bench_tridiagonal(S, n_repeats, time);
+      } else if (name == "sia" or name == "sia_cached" or name == "sia_flux") {
+        n_points = bench_sia(S, name == "sia_cached", name == "sia_flux", n_repeats, time);
+      } else if (name == "ssafd") {
+        n_points = bench_ssafd(S, n_repeats, time);
+      } else if (name == "ssafem") {
+        n_points = bench_ssafem(S, n_repeats, time);
+      } else if (name == "geometry") {
+        n_points = bench_geometry(S, dt, n_repeats, time);
+      } else if (name == "connected_components") {
+        n_points = bench_connected_components(S, n_repeats, time);
+      } else if (name == "column_interpolation") {
+        n_points = bench_column_interpolation(S, *config, EC, dt, n_repeats, time);
+      } else if (name == "flow_law") {
+        n_points = bench_flow_law(S, *flow_law, n_repeats, time);
+      } else if (name == "divergence_columns") {
+        n_points = bench_divergence_columns(S, n_repeats, time);
+      } else if (name == "divergence_levels") {
+        n_points = bench_divergence_levels(S, n_repeats, time);
+      } else if (name == "level_major_transpose") {
+        n_points = bench_level_major_transpose(S, n_repeats, time);
+      } else if (name == "functional_tv" or name == "functional_tv_separate") {
+        n_points = bench_functional_tv(S, name == "functional_tv", n_repeats, time);
+      } else if (name == "functional_h1" or name == "functional_h1_separate") {
+        n_points = bench_functional_h1(S, name == "functional_h1", n_repeats, time);
+      } else if (name == "functional_log_ratio" or name == "functional_log_ratio_separate") {
+        n_points = bench_functional_log_ratio(S, name == "functional_log_ratio",
+                                              n_repeats, time);
+      } else if (name == "sia_flux_divergence" or name == "sia_flux_divergence_tiled") {
+        n_points = bench_sia_flux_divergence(S, name == "sia_flux_divergence_tiled",
+                                             tile_width, tile_height, n_repeats, time);
+      } else if (name == "grounded_cell_fraction") {
+        n_points = bench_grounded_cell_fraction(S, *config, n_repeats, time);
+      } else if (name == "cell_type_double" or name == "cell_type_compact") {
+        n_points = bench_cell_type(S, name == "cell_type_compact", n_repeats, time);
+      } else if (name == "geometry_calculator_points" or name == "geometry_calculator_rows") {
+        n_points = bench_geometry_calculator(S, *config, name == "geometry_calculator_rows",
+                                             n_repeats, time);
+      } else if (name == "flux_divergence_indexed" or name == "flux_divergence_flat") {
+        n_points = bench_flux_divergence(S, name == "flux_divergence_flat", n_repeats, time);
+      } else if (name == "tracers_separate" or name == "tracers_fused") {
+        n_points = bench_tracers(S, name == "tracers_fused", n_tracers, dt, n_repeats, time);
+      } else if (name == "fracture_density") {
+        n_points = bench_fracture_density(S, flow_law, dt, n_repeats, time);
+      } else {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "unknown kernel: %s", name.c_str());
+      }
+
+      n_points = GlobalSum(com, n_points) * n_repeats;
+
+      log->message(2, "%22s %14.0f %12.6f %16.4e\n",
+                   name.c_str(), n_points, time, time > 0.0 ? n_points / time : 0.0);
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,493 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Recommends a domain decomposition (-Nx, -Ny, -procs_x, -procs_y) for a run using\n"
+  "-target_size processes. Uses the grid and the ice thickness in the input file (-i,\n"
+  "-bootstrap and grid options are processed the same way as in pismr) and, if\n"
+  "-profile_summary is set, the cost of a time step calibrated using summaries saved\n"
+  "by previous runs on the same grid using -profile_json.\n\n";
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>              // strtod
+#include <petscsys.h>           // PETSC_COMM_WORLD
+
+#include "pism/util/Config.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/partitioning.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+
+using namespace pism;
+
+//! Costs of all columns of a grid (the same on all ranks).
+struct CostMap {
+  unsigned int Mx, My;
+  //! `sum[j * (Mx + 1) + i]` is the total cost of columns in `[0, i) x [0, j)`
+  std::vector<double> sum;
+  //! total costs of grid columns (`x`) and rows (`y`)
+  std::vector<double> x, y;
+
+  //! Total cost of columns in `[i0, i1) x [j0, j1)`.
+  double patch(unsigned int i0, unsigned int i1, unsigned int j0, unsigned int j1) const {
+    const unsigned int M = Mx + 1;
+    return sum[j1 * M + i1] - sum[j0 * M + i1] - sum[j1 * M + i0] + sum[j0 * M + i0];
+  }
+
+  double total() const {
+    return sum.back();
+  }
+};
+
+//! Time step statistics of a previous run (see Profiling::save_summary()).
+struct RunSummary {
+  int ranks;
+  //! number of time steps
+  double steps;
+  //! average (over ranks) time spent computing and communicating, excluding I/O
+  double work, wait;
+  //! the ratio of the maximum to the average time spent computing
+  double imbalance;
+};
+
+//! Time per unit of column cost and per halo point, in seconds per time step.
+struct CostModel {
+  bool calibrated;
+  double column_time;
+  double halo_time;
+};
+
+//! A decomposition and its predicted performance.
+struct Candidate {
+  std::string method;
+  std::vector<unsigned int> procs_x, procs_y;
+  //! maximum and mean cost of a sub-domain
+  double max_load, mean_load;
+  //! maximum and mean number of ghost points of a sub-domain
+  double max_halo, mean_halo;
+  //! predicted wall clock time of a time step (in units of column cost if not calibrated)
+  double step_time;
+};
+
+//! Gather `cost` on rank 0, broadcast it and compute prefix sums.
+static CostMap cost_map(const IceModelVec2S &cost) {
+  IceGrid::ConstPtr grid = cost.grid();
+
+  CostMap result;
+  result.Mx = grid->Mx();
+  result.My = grid->My();
+
+  const unsigned int Mx = result.Mx, My = result.My;
+
+  std::vector<double> values(Mx * My, 0.0);
+  {
+    petsc::Vec::Ptr proc0 = cost.allocate_proc0_copy();
+    cost.put_on_proc0(*proc0);
+
+    if (grid->rank() == 0) {
+      petsc::VecArray array(*proc0);
+      std::copy(array.get(), array.get() + Mx * My, values.begin());
+    }
+    MPI_Bcast(values.data(), Mx * My, MPI_DOUBLE, 0, grid->com);
+  }
+
+  result.sum.resize((Mx + 1) * (My + 1), 0.0);
+  result.x.resize(Mx, 0.0);
+  result.y.resize(My, 0.0);
+
+  for (unsigned int j = 0; j < My; ++j) {
+    double row = 0.0;
+    for (unsigned int i = 0; i < Mx; ++i) {
+      const double c = values[j * Mx + i];
+
+      row += c;
+      result.sum[(j + 1) * (Mx + 1) + (i + 1)] = result.sum[j * (Mx + 1) + (i + 1)] + row;
+
+      result.x[i] += c;
+      result.y[j] += c;
+    }
+  }
+
+  return result;
+}
+
+//! Number of ghost points of a `xm x ym` sub-domain; `lower` and `upper` are true if the
+//! sub-domain has neighbors on corresponding sides.
+static double halo_size(unsigned int xm, unsigned int ym, unsigned int width,
+                        bool lower_x, bool upper_x, bool lower_y, bool upper_y) {
+  const double
+    gxm = xm + width * (lower_x + upper_x),
+    gym = ym + width * (lower_y + upper_y);
+
+  return gxm * gym - (double)xm * ym;
+}
+
+//! Compute loads, halo sizes and the predicted time step length of `c`.
+static void evaluate(const CostMap &cost, unsigned int width, Periodicity periodicity,
+                     const CostModel &model, Candidate &c) {
+  const unsigned int
+    Nx = c.procs_x.size(),
+    Ny = c.procs_y.size();
+
+  const bool
+    periodic_x = periodicity & X_PERIODIC,
+    periodic_y = periodicity & Y_PERIODIC;
+
+  c.max_load  = 0.0;
+  c.mean_load = cost.total() / (Nx * Ny);
+  c.max_halo  = 0.0;
+  c.mean_halo = 0.0;
+  c.step_time = 0.0;
+
+  unsigned int j0 = 0;
+  for (unsigned int n = 0; n < Ny; ++n) {
+    const unsigned int j1 = j0 + c.procs_y[n];
+
+    unsigned int i0 = 0;
+    for (unsigned int m = 0; m < Nx; ++m) {
+      const unsigned int i1 = i0 + c.procs_x[m];
+
+      const double
+        load = cost.patch(i0, i1, j0, j1),
+        halo = halo_size(c.procs_x[m], c.procs_y[n], width,
+                         periodic_x or m > 0, periodic_x or m < Nx - 1,
+                         periodic_y or n > 0, periodic_y or n < Ny - 1);
+
+      c.max_load   = std::max(c.max_load, load);
+      c.max_halo   = std::max(c.max_halo, halo);
+      c.mean_halo += halo / (Nx * Ny);
+
+      // all ranks wait for the slowest one at every halo exchange
+      c.step_time = std::max(c.step_time, model.column_time * load + model.halo_time * halo);
+
+      i0 = i1;
+    }
+    j0 = j1;
+  }
+}
+
+//! Enumerate decompositions of the grid into `size` sub-domains: for each factorization
+//! `Nx * Ny == size` use the even split (see ownership_ranges()) and the one balancing
+//! the cost of columns (see weighted_grid()).
+static std::vector<Candidate> candidates(const CostMap &cost, unsigned int size) {
+  std::vector<Candidate> result;
+
+  for (unsigned int Nx = 1; Nx <= size; ++Nx) {
+    if (size % Nx != 0) {
+      continue;
+    }
+    const unsigned int Ny = size / Nx;
+
+    // see compute_nprocs()
+    if (cost.Mx / Nx < 2 or cost.My / Ny < 2) {
+      continue;
+    }
+
+    Candidate even;
+    even.method  = "even";
+    even.procs_x = ownership_ranges(cost.Mx, Nx);
+    even.procs_y = ownership_ranges(cost.My, Ny);
+    result.push_back(even);
+
+    Candidate weighted;
+    weighted.method  = "weighted";
+    weighted.procs_x = weighted_ownership_ranges(cost.x, Nx);
+    weighted.procs_y = weighted_ownership_ranges(cost.y, Ny);
+
+    if (weighted.procs_x != even.procs_x or weighted.procs_y != even.procs_y) {
+      result.push_back(weighted);
+    }
+  }
+
+  if (result.empty()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "Can't split a %d x %d grid into %d parts.",
+                                  cost.Mx, cost.My, size);
+  }
+
+  return result;
+}
+
+//! Find the value of the key `key` in the JSON object starting at `start` in `text`.
+static double json_number(const std::string &text, size_t start, const std::string &key) {
+  const std::string quoted = "\"" + key + "\":";
+
+  const size_t end = text.find('}', start);
+  const size_t position = text.find(quoted, start);
+  if (position == std::string::npos or position > end) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "key '%s' not found", key.c_str());
+  }
+
+  return strtod(text.c_str() + position + quoted.size(), NULL);
+}
+
+//! Position of the object describing the event `path` in `text` (or `npos`).
+static size_t json_event(const std::string &text, const std::string &path) {
+  const size_t position = text.find("\"path\": \"" + path + "\"");
+  if (position == std::string::npos) {
+    return position;
+  }
+  return text.rfind('{', position);
+}
+
+//! Read time step statistics from a summary saved by Profiling::save_summary().
+/*!
+ * Time spent in the "io" child event of "time_step" is excluded: it does not depend on
+ * the domain decomposition (much).
+ *
+ * Reads on rank 0 and broadcasts results.
+ */
+static RunSummary read_summary(MPI_Comm com, const std::string &filename) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  // ranks, steps, work, wait, imbalance; a negative number of ranks signals a failure
+  double data[5] = {-1.0, 0.0, 0.0, 0.0, 0.0};
+  std::string message;
+
+  if (rank == 0) {
+    try {
+      std::ifstream f(filename);
+      if (not f.good()) {
+        throw RuntimeError(PISM_ERROR_LOCATION, "failed to open the file");
+      }
+      std::stringstream buffer;
+      buffer << f.rdbuf();
+      const std::string text = buffer.str();
+
+      const size_t step = json_event(text, "time_step");
+      if (step == std::string::npos) {
+        throw RuntimeError(PISM_ERROR_LOCATION, "event 'time_step' not found");
+      }
+
+      double
+        avg  = json_number(text, step, "avg"),
+        wait = json_number(text, step, "wait");
+
+      const size_t io = json_event(text, "time_step/io");
+      if (io != std::string::npos) {
+        const double io_wait = json_number(text, io, "wait");
+        avg  -= json_number(text, io, "avg");
+        wait -= io_wait;
+      }
+
+      data[0] = json_number(text, 0, "ranks");
+      data[1] = json_number(text, step, "calls");
+      data[2] = std::max(avg - wait, 0.0);
+      data[3] = std::max(wait, 0.0);
+      data[4] = json_number(text, step, "imbalance");
+    } catch (RuntimeError &e) {
+      data[0] = -1.0;
+      message = e.what();
+    }
+  }
+
+  MPI_Bcast(data, 5, MPI_DOUBLE, 0, com);
+
+  if (data[0] < 1.0 or data[1] < 1.0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to read time step statistics from '%s'%s%s",
+                                  filename.c_str(), message.empty() ? "" : ": ",
+                                  message.c_str());
+  }
+
+  RunSummary result;
+  result.ranks     = data[0];
+  result.steps     = data[1];
+  result.work      = data[2];
+  result.wait      = data[3];
+  result.imbalance = data[4];
+
+  return result;
+}
+
+/*!
+ * Assumes that previous runs used the same grid, a similar ice extent and the default
+ * decomposition (no -Nx, -Ny, -procs_x, -procs_y).
+ *
+ * The time per unit of column cost is the average (over ranks) compute time per step
+ * divided by the average cost of a sub-domain. The time per ghost point is the
+ * communication time per step not explained by the load imbalance (ranks waiting for the
+ * slowest one) divided by the mean number of ghost points of a sub-domain. Estimates from
+ * several runs are averaged.
+ */
+static CostModel calibrate(MPI_Comm com, const std::vector<std::string> &summaries,
+                           const CostMap &cost, unsigned int width, Periodicity periodicity,
+                           const Logger &log) {
+  CostModel result{false, 1.0, 0.0};
+
+  if (summaries.empty()) {
+    return result;
+  }
+
+  const CostModel uncalibrated = result;
+
+  result.calibrated  = true;
+  result.column_time = 0.0;
+  result.halo_time   = 0.0;
+
+  for (const auto &filename : summaries) {
+    RunSummary run = read_summary(com, filename);
+
+    unsigned int Nx = 0, Ny = 0;
+    compute_nprocs(cost.Mx, cost.My, run.ranks, Nx, Ny);
+
+    Candidate previous;
+    previous.procs_x = ownership_ranges(cost.Mx, Nx);
+    previous.procs_y = ownership_ranges(cost.My, Ny);
+    evaluate(cost, width, periodicity, uncalibrated, previous);
+
+    const double
+      work        = run.work / run.steps,
+      wait        = run.wait / run.steps,
+      halo_wait   = std::max(wait - (run.imbalance - 1.0) * work, 0.0),
+      column_time = work / previous.mean_load,
+      halo_time   = previous.mean_halo > 0.0 ? halo_wait / previous.mean_halo : 0.0;
+
+    log.message(2,
+                "  %s: %d ranks (%d x %d), %.0f steps, %.3e s per unit of cost,"
+                " %.3e s per ghost point\n",
+                filename.c_str(), run.ranks, Nx, Ny, run.steps, column_time, halo_time);
+
+    result.column_time += column_time / summaries.size();
+    result.halo_time   += halo_time / summaries.size();
+  }
+
+  return result;
+}
+
+//! Format ownership ranges as a comma-separated list.
+static std::string to_string(const std::vector<unsigned int> &ranges) {
+  std::vector<std::string> tmp;
+  for (auto r : ranges) {
+    tmp.push_back(pism::printf("%d", r));
+  }
+  return join(tmp, ",");
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "pism_decomp_advisor");
+    Logger::Ptr log = ctx->log();
+    Config::Ptr config = ctx->config();
+
+    options::Integer target_size("-target_size", "Number of processes of the planned run",
+                                 ctx->size());
+    options::StringList summaries("-profile_summary",
+                                  "Comma-separated list of summaries (-profile_json)"
+                                  " saved by previous runs", "");
+    options::Integer n_candidates("-n_candidates", "Number of decompositions to report", 10);
+
+    if (target_size < 1) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "-target_size has to be positive");
+    }
+
+    const std::string input_file = config->get_string("input.file");
+    if (input_file.empty()) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "please specify an input file using -i");
+    }
+
+    IceGrid::Ptr grid = IceGrid::FromOptions(ctx);
+
+    IceModelVec2S thickness(grid, "thk", WITHOUT_GHOSTS);
+    thickness.set_attrs("internal", "land ice thickness", "m", "m", "land_ice_thickness", 0);
+    thickness.metadata().set_number("valid_min", 0.0);
+    thickness.regrid(input_file, OPTIONAL, 0.0);
+
+    IceModelVec2S column_costs(grid, "column_cost", WITHOUT_GHOSTS);
+    column_cost(thickness, config->get_number("grid.partitioning.icy_cell_cost"),
+                column_costs);
+
+    const CostMap cost = cost_map(column_costs);
+
+    const unsigned int width = config->get_number("grid.max_stencil_width");
+
+    CostModel model = calibrate(com, summaries.is_set() ? summaries.value() :
+                                std::vector<std::string>{},
+                                cost, width, grid->periodicity(), *log);
+
+    auto C = candidates(cost, target_size);
+    for (auto &c : C) {
+      evaluate(cost, width, grid->periodicity(), model, c);
+    }
+
+    // sort by the predicted step time; prefer smaller halos if times are the same (this
+    // is always the case for the uncalibrated model if loads are the same)
+    std::stable_sort(C.begin(), C.end(),
+                     [](const Candidate &a, const Candidate &b) {
+                       if (a.step_time != b.step_time) {
+                         return a.step_time < b.step_time;
+                       }
+                       return a.max_halo < b.max_halo;
+                     });
+
+    log->message(2,
+                 "* Decompositions of the %d x %d grid into %d sub-domains"
+                 " (icy cell cost: %.2f, stencil width: %d):\n",
+                 cost.Mx, cost.My, target_size.value(),
+                 config->get_number("grid.partitioning.icy_cell_cost"), width);
+    log->message(2, "%6s %6s %10s %12s %10s %10s %10s %14s\n",
+                 "Nx", "Ny", "method", "max load", "imbalance", "max halo", "mean halo",
+                 model.calibrated ? "step time (s)" : "step time");
+
+    const size_t N = std::min(C.size(), (size_t)std::max(n_candidates.value(), 1));
+    for (size_t k = 0; k < N; ++k) {
+      const auto &c = C[k];
+      log->message(2, "%6d %6d %10s %12.0f %10.3f %10.0f %10.0f %14.4e\n",
+                   (int)c.procs_x.size(), (int)c.procs_y.size(), c.method.c_str(),
+                   c.max_load, c.max_load / c.mean_load, c.max_halo, c.mean_halo,
+                   c.step_time);
+    }
+
+    if (not model.calibrated) {
+      log->message(2,
+                   "  Step times are in units of column cost (set -profile_summary to"
+                   " calibrate).\n");
+    }
+
+    const auto &best = C.front();
+    log->message(2, "* Recommended options:\n  -Nx %d -Ny %d",
+                 (int)best.procs_x.size(), (int)best.procs_y.size());
+    if (best.method == "weighted") {
+      log->message(2, " -procs_x %s -procs_y %s",
+                   to_string(best.procs_x).c_str(), to_string(best.procs_y).c_str());
+    }
+    log->message(2, "\n");
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
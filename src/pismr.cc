@@ -20,6 +20,7 @@ static char help[] =
   "Ice sheet driver for PISM ice sheet simulations, initialized from data.\n"
   "The basic PISM executable for evolution runs.\n";
 
+#include <algorithm>            // std::min
 #include <memory>
 #include <petscsys.h>           // PETSC_COMM_WORLD
 
@@ -32,12 +33,225 @@ static char help[] =
 #include "pism/util/error_handling.hh"
 #include "pism/util/Context.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/Time.hh"
+#include "pism/util/EnthalpyConverter.hh"
+#include "pism/util/pism_utilities.hh"
 
 #include "pism/regional/IceGrid_Regional.hh"
 #include "pism/regional/IceRegionalModel.hh"
+#include "pism/regional/NestedCoupling.hh"
 
 using namespace pism;
 
+//! Append "_N" (N is the index of an ensemble member) or "_regionN" (N is the index of a
+//! nested regional model) to a file name, keeping the ".nc" or ".json" suffix.
+static std::string member_filename(const std::string &filename, int member,
+                                   const std::string &prefix = "member") {
+  if (filename.empty()) {
+    return filename;
+  }
+
+  std::string suffix = (prefix == "member" ?
+                        pism::printf("_%d", member) :
+                        pism::printf("_%s%d", prefix.c_str(), member));
+
+  for (std::string extension : {".nc", ".json"}) {
+    if (ends_with(filename, extension)) {
+      return filename.substr(0, filename.size() - extension.size()) + suffix + extension;
+    }
+  }
+  return filename + suffix;
+}
+
+//! Create the context of an ensemble member (or a nested regional model if `prefix` is
+//! "region").
+/*!
+ * Parameters are set the same way as in context_from_options(), then output file names
+ * get the suffix "_N" and parameters set in the variable `member_N` in `overrides_file`
+ * (if present) override the rest. This way members can write to files chosen in the
+ * overrides file.
+ */
+static Context::Ptr member_context(MPI_Comm com, int member,
+                                   const std::string &overrides_file,
+                                   const std::string &prefix = "member") {
+  units::System::Ptr sys(new units::System);
+
+  Logger::Ptr logger = logger_from_options(com);
+
+  Config::Ptr config = config_from_options(com, *logger, sys);
+
+  for (auto name : {"output.file_name", "output.extra.file", "output.snapshot.file",
+                    "output.timeseries.filename"}) {
+    config->set_string(name, member_filename(config->get_string(name), member, prefix));
+  }
+
+  if (not overrides_file.empty()) {
+    NetCDFConfig overrides(com, pism::printf("%s_%d", prefix.c_str(), member), sys);
+    overrides.read(com, overrides_file);
+    config->import_from(overrides);
+  }
+  print_config(*logger, 3, *config);
+
+  Time::Ptr time = time_from_options(com, config, sys);
+
+  EnthalpyConverter::Ptr EC(new EnthalpyConverter(*config));
+
+  return Context::Ptr(new Context(com, sys, config, EC, time, logger, "pismr"));
+}
+
+//! Initialize and run a model using the context `ctx`.
+static void run(Context::Ptr ctx, const ProfilingOptions &profiling) {
+  Logger::Ptr log = ctx->log();
+  Config::Ptr config = ctx->config();
+
+  start_profiling(*ctx, profiling);
+
+  const Profiling &P = ctx->profiling();
+
+  IceGrid::Ptr grid;
+  std::unique_ptr<IceModel> model;
+
+  P.stage_begin("startup");
+  P.begin("init.grid");
+  if (options::Bool("-regional", "enable regional (outlet glacier) mode")) {
+    grid = regional_grid_from_options(ctx);
+    P.end("init.grid");
+    model.reset(new IceRegionalModel(grid, ctx));
+  } else {
+    grid = IceGrid::FromOptions(ctx);
+    P.end("init.grid");
+    model.reset(new IceModel(grid, ctx));
+  }
+
+  model->init();
+  P.stage_end("startup");
+
+  const bool
+    list_ascii = options::Bool("-list_diagnostics",
+                               "List available diagnostic quantities and stop"),
+    list_json = options::Bool("-list_diagnostics_json",
+                              "List available diagnostic quantities (JSON format) and stop");
+
+  if (list_ascii) {
+    model->list_diagnostics();
+  } else if (list_json) {
+    model->list_diagnostics_json();
+  } else {
+    model->run();
+
+    log->message(2, "... done with run\n");
+
+    model->save_results();
+  }
+  print_unused_parameters(*log, 3, *config);
+
+  save_profiling_results(*ctx, profiling);
+}
+
+//! Run a coarse model and `n_regions` regional models nested in it.
+/*!
+ * Processes are split between models in contiguous blocks (the coarse model goes first).
+ * Regional models use parameters from variables `region_N` in `overrides_file` (usually
+ * to select input files containing their grids) and write to files with the suffix
+ * "_regionN". Models exchange boundary conditions and ice thickness every
+ * `regional.nested.coupling_interval` years (see NestedCoupling) and take their own time
+ * steps in between.
+ */
+static void run_nested(MPI_Comm com, int n_regions, const std::string &overrides_file,
+                       const ProfilingOptions &profiling) {
+  int size = 0, rank = 0;
+  MPI_Comm_size(com, &size);
+  MPI_Comm_rank(com, &rank);
+
+  if (n_regions + 1 > size) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot run a coarse model and %d regional models using %d processes",
+                                  n_regions, size);
+  }
+
+  const int
+    model_index = ((long int)rank * (n_regions + 1)) / size,
+    region      = model_index - 1;
+
+  MPI_Comm model_com = MPI_COMM_NULL;
+  MPI_Comm_split(com, model_index, rank, &model_com);
+
+  try {
+    Context::Ptr ctx = (region < 0 ?
+                        context_from_options(model_com, "pismr") :
+                        member_context(model_com, region, overrides_file, "region"));
+
+    ProfilingOptions model_profiling = profiling;
+    if (region >= 0) {
+      model_profiling.log     = member_filename(profiling.log, region, "region");
+      model_profiling.trace   = member_filename(profiling.trace, region, "region");
+      model_profiling.summary = member_filename(profiling.summary, region, "region");
+    }
+
+    start_profiling(*ctx, model_profiling);
+
+    IceGrid::Ptr grid;
+    std::unique_ptr<IceModel> model;
+    if (region < 0) {
+      grid = IceGrid::FromOptions(ctx);
+      model.reset(new IceModel(grid, ctx));
+    } else {
+      grid = regional_grid_from_options(ctx);
+      model.reset(new IceRegionalModel(grid, ctx));
+    }
+
+    model->init();
+
+    NestedCoupling coupling(com, n_regions, region, *model);
+
+    auto time = ctx->time();
+    const double
+      run_start = time->current(),
+      run_end   = time->end();
+
+    if (GlobalMin(com, run_start) != GlobalMax(com, run_start) or
+        GlobalMin(com, run_end) != GlobalMax(com, run_end)) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "nested models have to use the same start and end times");
+    }
+
+    const double interval = ctx->config()->get_number("regional.nested.coupling_interval",
+                                                      "seconds");
+    // all regions have to exchange data at the same times
+    if (GlobalMin(com, interval) != GlobalMax(com, interval)) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "nested models have to use the same regional.nested.coupling_interval");
+    }
+
+    if (not (interval > 0.0)) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "regional.nested.coupling_interval has to be positive (got %f)",
+                                    ctx->config()->get_number("regional.nested.coupling_interval"));
+    }
+
+    double t = run_start;
+    while (t < run_end) {
+      coupling.exchange();
+
+      t = std::min(t + interval, run_end);
+      model->run_to(t);
+    }
+
+    ctx->log()->message(2, "... done with run\n");
+
+    model->save_results();
+
+    print_unused_parameters(*ctx->log(), 3, *ctx->config());
+
+    save_profiling_results(*ctx, model_profiling);
+  } catch (...) {
+    MPI_Comm_free(&model_com);
+    throw;
+  }
+
+  MPI_Comm_free(&model_com);
+}
+
 int main(int argc, char *argv[]) {
 
   MPI_Comm com = MPI_COMM_WORLD;
@@ -46,7 +260,23 @@ int main(int argc, char *argv[]) {
   com = PETSC_COMM_WORLD;
 
   try {
+    options::Integer pio_servers("-pio_servers",
+                                 "number of processes reserved as ParallelIO I/O servers", 0);
+
+    int pio_iosysid = -1;
+    if (pio_servers > 0) {
+      com = pio_init_async(com, pio_servers, pio_iosysid);
+
+      if (com == MPI_COMM_NULL) {
+        // this process was an I/O server and the run is over
+        return 0;
+      }
+    }
+
     Context::Ptr ctx = context_from_options(com, "pismr");
+    if (pio_servers > 0) {
+      ctx->set_pio_iosys_id(pio_iosysid);
+    }
     Logger::Ptr log = ctx->log();
 
     std::string usage =
@@ -55,9 +285,15 @@ int main(int argc, char *argv[]) {
       "  -i          IN.nc is input file in NetCDF format: contains PISM-written model state\n"
       "  -bootstrap  enable heuristics to produce an initial state from an incomplete input\n"
       "  -regional   enable \"regional mode\"\n"
+      "  -ensemble_size N  run N ensemble members, splitting processes between them\n"
+      "  -ensemble_overrides FILE  read parameters of member K from the variable member_K\n"
+      "  -nested_regions N  run a coarse model and N regional models nested in it\n"
+      "  -nested_overrides FILE  read parameters of regional model K from the variable region_K\n"
+      "  -pio_servers N  reserve N processes as I/O servers for -o_format pio_*\n"
       "notes:\n"
       "  * option -i is required\n"
-      "  * if -bootstrap is used then also '-Mx A -My B -Mz C -Lz D' are required\n";
+      "  * if -bootstrap is used then also '-Mx A -My B -Mz C -Lz D' are required\n"
+      "  * output file names of ensemble members get the suffix _K (K = 0, ..., N - 1)\n";
     {
       std::vector<std::string> required(1, "-i");
 
@@ -68,49 +304,70 @@ int main(int argc, char *argv[]) {
       }
     }
 
-    options::String profiling_log = options::String("-profile",
-                                                    "Save detailed profiling data to a file.");
+    ProfilingOptions profiling;
 
-    Config::Ptr config = ctx->config();
+    options::Integer ensemble_size("-ensemble_size", "number of ensemble members", 1);
 
-    if (profiling_log.is_set()) {
-      ctx->profiling().start();
-    }
+    options::String ensemble_overrides("-ensemble_overrides",
+                                       "file containing parameters of ensemble members");
 
-    IceGrid::Ptr grid;
-    std::unique_ptr<IceModel> model;
+    options::Integer nested_regions("-nested_regions",
+                                    "number of regional models nested in the coarse model", 0);
 
-    if (options::Bool("-regional", "enable regional (outlet glacier) mode")) {
-      grid = regional_grid_from_options(ctx);
-      model.reset(new IceRegionalModel(grid, ctx));
-    } else {
-      grid = IceGrid::FromOptions(ctx);
-      model.reset(new IceModel(grid, ctx));
-    }
+    options::String nested_overrides("-nested_overrides",
+                                     "file containing parameters of nested regional models");
 
-    model->init();
+    if (nested_regions > 0) {
+      if (ensemble_size > 1) {
+        throw RuntimeError(PISM_ERROR_LOCATION,
+                           "-nested_regions and -ensemble_size cannot be used together");
+      }
 
-    const bool
-      list_ascii = options::Bool("-list_diagnostics",
-                                 "List available diagnostic quantities and stop"),
-      list_json = options::Bool("-list_diagnostics_json",
-                                "List available diagnostic quantities (JSON format) and stop");
+      log->message(2, "* Running a coarse model and %d nested regional models...\n",
+                   nested_regions.value());
 
-    if (list_ascii) {
-      model->list_diagnostics();
-    } else if (list_json) {
-      model->list_diagnostics_json();
+      run_nested(com, nested_regions,
+                 nested_overrides.is_set() ? nested_overrides.value() : "",
+                 profiling);
+    } else if (ensemble_size <= 1) {
+      run(ctx, profiling);
     } else {
-      model->run();
+      int size = 0, rank = 0;
+      MPI_Comm_size(com, &size);
+      MPI_Comm_rank(com, &rank);
 
-      log->message(2, "... done with run\n");
+      if (ensemble_size > size) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "cannot run %d ensemble members using %d processes",
+                                      ensemble_size.value(), size);
+      }
 
-      model->save_results();
-    }
-    print_unused_parameters(*log, 3, *config);
+      // processes are split between members in contiguous blocks
+      const int member = ((long int)rank * ensemble_size) / size;
+
+      MPI_Comm member_com = MPI_COMM_NULL;
+      MPI_Comm_split(com, member, rank, &member_com);
+
+      log->message(2, "* Running %d ensemble members using %d processes...\n",
+                   ensemble_size.value(), size);
+
+      try {
+        Context::Ptr member_ctx = member_context(member_com, member,
+                                                 ensemble_overrides.is_set() ?
+                                                 ensemble_overrides.value() : "");
+
+        ProfilingOptions member_profiling = profiling;
+        member_profiling.log     = member_filename(profiling.log, member);
+        member_profiling.trace   = member_filename(profiling.trace, member);
+        member_profiling.summary = member_filename(profiling.summary, member);
+
+        run(member_ctx, member_profiling);
+      } catch (...) {
+        MPI_Comm_free(&member_com);
+        throw;
+      }
 
-    if (profiling_log.is_set()) {
-      ctx->profiling().report(profiling_log);
+      MPI_Comm_free(&member_com);
     }
   }
   catch (...) {
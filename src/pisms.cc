@@ -126,6 +126,9 @@ int main(int argc, char *argv[]) {
 
     Config::Ptr config = ctx->config();
 
+    ProfilingOptions profiling;
+    start_profiling(*ctx, profiling);
+
     IceGrid::Ptr g = pisms_grid(ctx);
     IceEISModel m(g, ctx, experiment[0]);
 
@@ -139,6 +142,8 @@ int main(int argc, char *argv[]) {
     m.save_results();
 
     print_unused_parameters(*log, 3, *config);
+
+    save_profiling_results(*ctx, profiling);
   }
   catch (...) {
     handle_fatal_errors(com);
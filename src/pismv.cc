@@ -190,6 +190,9 @@ int main(int argc, char *argv[]) {
     std::string testname = options::Keyword("-test", "Specifies PISM verification test",
                                             "A,B,C,D,F,G,H,K,L,V", "A");
 
+    ProfilingOptions profiling;
+    start_profiling(*ctx, profiling);
+
     IceGrid::Ptr g = pismv_grid(ctx, testname[0]);
 
     IceCompModel m(g, ctx, testname[0]);
@@ -205,6 +208,8 @@ int main(int argc, char *argv[]) {
     m.save_results();
 
     print_unused_parameters(*log, 3, *config);
+
+    save_profiling_results(*ctx, profiling);
   }
   catch (...) {
     handle_fatal_errors(com);
@@ -1,5 +1,7 @@
 # code extending the IceModelVec class
 
+import contextlib
+
 
 def regrid(self, filename, critical=False, default_value=0.0):
     if critical == True:
@@ -19,3 +21,38 @@ def numpy(self):
         return numpy.array(tmp.get()).reshape(self.shape())
     else:
         return None
+
+
+@contextlib.contextmanager
+def local_array(self, writable=True):
+    """Zero-copy NumPy view of the data owned by this rank (including ghosts).
+
+    Use in a "with" statement: the array is valid inside the block only.
+
+        with field.local_array() as a:
+            a[...] = 0.0
+
+    Element (i, j) is at a[j - grid.ys() + w, i - grid.xs() + w], where w =
+    field.stencil_width(). 2D vector fields have a trailing dimension of length 2 (u, v),
+    3D fields a trailing dimension corresponding to vertical levels.
+
+    Ghosts are not updated after modifications; call update_ghosts() if necessary.
+    """
+    import ctypes
+    import numpy
+
+    self.begin_access()
+    try:
+        shape = tuple(self._local_array_shape())
+        size = int(numpy.prod(shape))
+        data = (ctypes.c_double * size).from_address(self._local_array_address())
+
+        array = numpy.frombuffer(data, dtype=numpy.float64).reshape(shape)
+        array.flags.writeable = writable
+
+        yield array
+    finally:
+        self.end_access()
+
+    if writable:
+        self.inc_state_counter()
@@ -67,6 +67,8 @@
 #include "util/Time_Calendar.hh"
 #include "util/Poisson.hh"
 #include "util/label_components.hh"
+#include "util/partitioning.hh"
+#include "util/Decimation.hh"
 %}
 
 // Tell SWIG that the following variables are truly constant
@@ -221,6 +223,7 @@
 %shared_ptr(pism::Config);
 %shared_ptr(pism::NetCDFConfig);
 %shared_ptr(pism::DefaultConfig);
+%ignore pism::Config::LookupGuard;
 %include "util/ConfigInterface.hh"
 %include "util/Config.hh"
 
@@ -262,6 +265,7 @@
 
 
 %shared_ptr(pism::Diagnostic)
+%ignore pism::Diagnostic::SharedResults;
 %include "util/Diagnostic.hh"
 %include "stressbalance/timestepping.hh"
 
@@ -338,6 +342,11 @@ pism_class(pism::RegionalYieldStress, "pism/regional/RegionalYieldStress.hh")
 %}
 %include "coupler/util/options.hh"
 
+%{
+#include "coupler/util/CachingModifier.hh"
+%}
+%include "coupler/util/CachingModifier.hh"
+
 %shared_ptr(pism::PCFactory< pism::surface::SurfaceModel >)
 %template(_SurfaceFactoryBase) pism::PCFactory<pism::surface::SurfaceModel>;
 
@@ -370,3 +379,7 @@ pism_class(pism::RegionalYieldStress, "pism/regional/RegionalYieldStress.hh")
 
 pism_class(pism::FractureDensity, "pism/fracturedensity/FractureDensity.hh")
 %include "util/label_components.hh"
+%include "util/partitioning.hh"
+%include "util/Decimation.hh"
+
+pism_class(pism::IceModel, "pism/icemodel/IceModel.hh")
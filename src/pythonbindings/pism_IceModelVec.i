@@ -24,6 +24,7 @@ using namespace pism;
 
 %ignore pism::IceModelVec2S::get_array;
 %ignore pism::IceModelVec2V::get_array;
+%ignore pism::IceModelVec2::flat_view;
 
 %rename(_regrid) pism::IceModelVec::regrid;
 %extend pism::IceModelVec
@@ -59,6 +60,22 @@ using namespace pism;
         (*($self))(i,j) = val;
     }
 
+    /* Address of the first element of the local (ghosted) array. Valid only between
+       begin_access() and end_access(). */
+    size_t _local_array_address()
+    {
+        const int w = $self->stencil_width();
+        auto grid = $self->grid();
+        return reinterpret_cast<size_t>(&(*($self))(grid->xs() - w, grid->ys() - w));
+    }
+
+    std::vector<int> _local_array_shape()
+    {
+        const int w = $self->stencil_width();
+        auto grid = $self->grid();
+        return {grid->ym() + 2 * w, grid->xm() + 2 * w};
+    }
+
     %pythoncode "IceModelVec2S.py"
 };
 
@@ -92,6 +109,20 @@ using namespace pism;
         (*($self))(i,j).v = v;
     }
 
+    size_t _local_array_address()
+    {
+        const int w = $self->stencil_width();
+        auto grid = $self->grid();
+        return reinterpret_cast<size_t>(&(*($self))(grid->xs() - w, grid->ys() - w).u);
+    }
+
+    std::vector<int> _local_array_shape()
+    {
+        const int w = $self->stencil_width();
+        auto grid = $self->grid();
+        return {grid->ym() + 2 * w, grid->xm() + 2 * w, 2};
+    }
+
     %pythoncode "IceModelVec2V.py"
 };
 
@@ -110,6 +141,20 @@ using namespace pism;
       (*($self))(i,j,k) = val;
   }
 
+  size_t _local_array_address()
+  {
+      const int w = $self->stencil_width();
+      auto grid = $self->grid();
+      return reinterpret_cast<size_t>($self->get_column(grid->xs() - w, grid->ys() - w));
+  }
+
+  std::vector<int> _local_array_shape()
+  {
+      const int w = $self->stencil_width();
+      auto grid = $self->grid();
+      return {grid->ym() + 2 * w, grid->xm() + 2 * w, (int)$self->levels().size()};
+  }
+
 
     %pythoncode {
     def __getitem__(self,*args):
@@ -124,6 +169,7 @@ using namespace pism;
 };
 
 %ignore pism::IceModelVec2T::interp(int, int, double*);
+%ignore pism::IceModelVec2T::interp(int, int, int, double*);
 %extend pism::IceModelVec2T
 {
 std::vector<double> interp(int i, int j) {
@@ -17,6 +17,8 @@
 %}
 
 %shared_ptr(pism::atmosphere::AtmosphereModel)
+%ignore pism::atmosphere::AtmosphereModel::temp_time_series_batch;
+%ignore pism::atmosphere::AtmosphereModel::precip_time_series_batch;
 %include "coupler/AtmosphereModel.hh"
 
 %shared_ptr(pism::atmosphere::Anomaly)
@@ -38,4 +38,5 @@ using pism::MaskValue;
 %include "regional/EnthalpyModel_Regional.hh"
 
 %ignore pism::energy::BedrockColumn::solve(double, double, double, const double *, double *);
+%ignore pism::energy::BedrockColumn::solve(double, unsigned int, const double *, const double *, double * const *);
 %include "energy/BedrockColumn.hh"
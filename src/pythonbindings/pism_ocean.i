@@ -28,6 +28,9 @@
 %rename(OceanConstant) pism::ocean::Constant;
 %include "coupler/ocean/Constant.hh"
 
+%shared_ptr(pism::CachingModifier<pism::ocean::OceanModel>)
+%template(_OceanCachingModifier) pism::CachingModifier<pism::ocean::OceanModel>;
+
 %shared_ptr(pism::ocean::Cache)
 %rename(OceanCache) pism::ocean::Cache;
 %include "coupler/ocean/Cache.hh"
@@ -62,6 +65,9 @@
 
 %shared_ptr(pism::ocean::GivenTH)
 %rename(OceanGivenTH) pism::ocean::GivenTH;
+%feature("flatnested") pism::ocean::GivenTH::Constants;
+%rename(OceanGivenTHConstants) pism::ocean::GivenTH::Constants;
+%apply double * OUTPUT {double *shelf_base_temperature_out, double *shelf_base_melt_rate_out};
 %include "coupler/ocean/GivenTH.hh"
 
 %shared_ptr(pism::ocean::Pico)
@@ -38,6 +38,9 @@
 %rename(SurfacePIK) pism::surface::PIK;
 %include "coupler/surface/ConstantPIK.hh"
 
+%shared_ptr(pism::CachingModifier<pism::surface::SurfaceModel>)
+%template(_SurfaceCachingModifier) pism::CachingModifier<pism::surface::SurfaceModel>;
+
 %shared_ptr(pism::surface::Cache)
 %rename(SurfaceCache) pism::surface::Cache;
 %include "coupler/surface/Cache.hh"
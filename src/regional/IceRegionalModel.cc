@@ -43,7 +43,10 @@ IceRegionalModel::IceRegionalModel(IceGrid::Ptr g, Context::Ptr c)
   : IceModel(g, c) {
   // empty
 
-  if (m_config->get_flag("energy.ch_warming.enabled")) {
+  // the warming flux is stored only if the enthalpy model does not update the
+  // cryo-hydrologic system (see allocate_energy_model())
+  if (m_config->get_flag("energy.ch_warming.enabled") and
+      not m_config->get_flag("energy.enabled")) {
     m_ch_warming_flux.reset(new IceModelVec3(m_grid, "ch_warming_flux", WITHOUT_GHOSTS));
   }
 }
@@ -172,12 +175,15 @@ void IceRegionalModel::allocate_energy_model() {
 
   m_log->message(2, "# Allocating an energy balance model...\n");
 
+  energy::EnthalpyModel *enthalpy_model = NULL;
+
   if (m_config->get_flag("energy.enabled")) {
     if (m_config->get_flag("energy.temperature_based")) {
       throw RuntimeError(PISM_ERROR_LOCATION,
                          "pismr -regional does not support the '-energy cold' mode.");
     } else {
-      m_energy_model = new energy::EnthalpyModel_Regional(m_grid, m_stress_balance.get());
+      enthalpy_model = new energy::EnthalpyModel_Regional(m_grid, m_stress_balance.get());
+      m_energy_model = enthalpy_model;
     }
   } else {
     m_energy_model = new energy::DummyEnergyModel(m_grid, m_stress_balance.get());
@@ -192,6 +198,11 @@ void IceRegionalModel::allocate_energy_model() {
 
     m_ch_system.reset(new energy::CHSystem(m_grid, m_stress_balance.get()));
     m_submodels["cryo-hydrologic warming"] = m_ch_system.get();
+
+    if (enthalpy_model) {
+      // update ice and cryo-hydrologic enthalpy in the same pass over columns
+      enthalpy_model->set_cryo_hydrologic_system(m_ch_system.get());
+    }
   }
 }
 
@@ -284,7 +295,9 @@ energy::Inputs IceRegionalModel::energy_model_inputs() {
 
 void IceRegionalModel::energy_step() {
 
-  if (m_ch_system) {
+  // If the energy balance model is enabled it updates the cryo-hydrologic system as well
+  // (see allocate_energy_model()).
+  if (m_ch_system and m_ch_warming_flux) {
     bedrock_thermal_model_step();
 
     energy::Inputs inputs = energy_model_inputs();
@@ -327,6 +340,38 @@ const energy::CHSystem* IceRegionalModel::cryo_hydrologic_system() const {
   return m_ch_system.get();
 }
 
+const IceModelVec2Int& IceRegionalModel::no_model_mask() const {
+  return m_no_model_mask;
+}
+
+//! Set boundary conditions in the `no_model_mask` area (used by nested runs).
+/*!
+ * Sets stored ice thickness and surface elevation, ice thickness in the `no_model_mask`
+ * area and (if `stress_balance.ssa.dirichlet_bc` is set) SSA Dirichlet boundary
+ * conditions there.
+ */
+void IceRegionalModel::set_boundary_conditions(const IceModelVec2S &ice_thickness,
+                                               const IceModelVec2S &surface_elevation,
+                                               const IceModelVec2V &velocity) {
+  m_thk_stored.copy_from(ice_thickness);
+  m_usurf_stored.copy_from(surface_elevation);
+
+  {
+    IceModelVec::AccessList list{&m_no_model_mask, &m_ssa_dirichlet_bc_values, &velocity};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (m_no_model_mask(i, j) > 0.5) {
+        m_ssa_dirichlet_bc_values(i, j) = velocity(i, j);
+      }
+    }
+  }
+  m_ssa_dirichlet_bc_values.update_ghosts();
+
+  set_ice_thickness(ice_thickness, m_no_model_mask);
+}
+
 /*! @brief Report temperature of the cryo-hydrologic system */
 class CHTemperature : public Diag<IceRegionalModel>
 {
@@ -38,6 +38,12 @@ public:
 
   const energy::CHSystem* cryo_hydrologic_system() const;
 
+  const IceModelVec2Int& no_model_mask() const;
+
+  void set_boundary_conditions(const IceModelVec2S &ice_thickness,
+                               const IceModelVec2S &surface_elevation,
+                               const IceModelVec2V &velocity);
+
 protected:
   virtual void bootstrap_2d(const File &input_file);
 
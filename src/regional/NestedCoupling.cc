@@ -0,0 +1,359 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::max, std::copy
+#include <cmath>                // std::floor, std::lround
+
+#include "NestedCoupling.hh"
+#include "IceRegionalModel.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/interpolation.hh"
+#include "pism/geometry/Geometry.hh"
+#include "pism/stressbalance/StressBalance.hh"
+
+namespace pism {
+
+// message tags
+static const int coordinates_tag = 1;
+static const int fields_tag      = 2;
+
+static void send_vector(MPI_Comm com, int destination, int tag,
+                        const std::vector<double> &data) {
+  int size = data.size();
+  MPI_Send(&size, 1, MPI_INT, destination, tag, com);
+  MPI_Send(data.data(), size, MPI_DOUBLE, destination, tag, com);
+}
+
+static std::vector<double> receive_vector(MPI_Comm com, int source, int tag) {
+  int size = 0;
+  MPI_Recv(&size, 1, MPI_INT, source, tag, com, MPI_STATUS_IGNORE);
+
+  std::vector<double> result(size);
+  MPI_Recv(result.data(), size, MPI_DOUBLE, source, tag, com, MPI_STATUS_IGNORE);
+
+  return result;
+}
+
+//! Gather `field` on rank 0 (in the natural ordering). Returns an empty vector on other
+//! ranks.
+static std::vector<double> gather(const IceModelVec &field, petsc::Vec &proc0) {
+  field.put_on_proc0(proc0);
+
+  std::vector<double> result;
+  if (field.grid()->rank() == 0) {
+    PetscInt size = 0;
+    PetscErrorCode ierr = VecGetLocalSize(proc0, &size);
+    PISM_CHK(ierr, "VecGetLocalSize");
+
+    petsc::VecArray array(proc0);
+    result.assign(array.get(), array.get() + size);
+  }
+  return result;
+}
+
+//! Distribute `values` (used on rank 0 only) stored in the natural ordering.
+static void scatter(const std::vector<double> &values, petsc::Vec &proc0, IceModelVec &field) {
+  if (field.grid()->rank() == 0) {
+    petsc::VecArray array(proc0);
+    std::copy(values.begin(), values.end(), array.get());
+  }
+  field.get_from_proc0(proc0);
+}
+
+NestedCoupling::NestedCoupling(MPI_Comm com, int n_regions, int region, IceModel &model)
+  : m_com(com),
+    m_n_regions(n_regions),
+    m_region(region),
+    m_model(model),
+    m_regional_model(nullptr) {
+
+  auto grid = m_model.grid();
+
+  if (m_region >= 0) {
+    m_regional_model = dynamic_cast<IceRegionalModel*>(&m_model);
+    if (m_regional_model == nullptr) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "nested models have to be regional models");
+    }
+  }
+
+  m_thickness.create(grid, "nested_thickness", WITHOUT_GHOSTS);
+  m_surface_elevation.create(grid, "nested_surface_elevation", WITHOUT_GHOSTS);
+  m_mask.create(grid, "nested_mask", WITHOUT_GHOSTS);
+  m_velocity.create(grid, "nested_velocity", WITHOUT_GHOSTS);
+
+  m_scalar0 = m_thickness.allocate_proc0_copy();
+  m_vector0 = m_velocity.allocate_proc0_copy();
+
+  // find roots of all models
+  {
+    int size = 0, rank = 0;
+    MPI_Comm_size(m_com, &size);
+    MPI_Comm_rank(m_com, &rank);
+
+    int model_index = grid->rank() == 0 ? m_region + 1 : -1;
+    std::vector<int> indexes(size);
+    MPI_Allgather(&model_index, 1, MPI_INT, indexes.data(), 1, MPI_INT, m_com);
+
+    m_roots.resize(m_n_regions + 1, -1);
+    for (int k = 0; k < size; ++k) {
+      if (indexes[k] >= 0 and indexes[k] <= m_n_regions) {
+        m_roots[indexes[k]] = k;
+      }
+    }
+
+    for (auto r : m_roots) {
+      if (r < 0) {
+        throw RuntimeError(PISM_ERROR_LOCATION,
+                           "each process has to belong to the coarse model or to a regional one");
+      }
+    }
+  }
+
+  // exchange grid information
+  std::vector<double> mask;
+  if (m_region >= 0) {
+    m_mask.copy_from(m_regional_model->no_model_mask());
+    mask = gather(m_mask, *m_scalar0);
+  }
+
+  if (grid->rank() == 0) {
+    if (m_region < 0) {
+      m_coarse_x = grid->x();
+      m_coarse_y = grid->y();
+
+      for (int r = 0; r < m_n_regions; ++r) {
+        send_vector(m_com, m_roots[r + 1], coordinates_tag, m_coarse_x);
+        send_vector(m_com, m_roots[r + 1], coordinates_tag, m_coarse_y);
+      }
+
+      for (int r = 0; r < m_n_regions; ++r) {
+        m_regional_x.push_back(receive_vector(m_com, m_roots[r + 1], coordinates_tag));
+        m_regional_y.push_back(receive_vector(m_com, m_roots[r + 1], coordinates_tag));
+        m_regional_mask.push_back(receive_vector(m_com, m_roots[r + 1], coordinates_tag));
+      }
+    } else {
+      m_coarse_x = receive_vector(m_com, m_roots[0], coordinates_tag);
+      m_coarse_y = receive_vector(m_com, m_roots[0], coordinates_tag);
+
+      send_vector(m_com, m_roots[0], coordinates_tag, grid->x());
+      send_vector(m_com, m_roots[0], coordinates_tag, grid->y());
+      send_vector(m_com, m_roots[0], coordinates_tag, mask);
+    }
+  }
+}
+
+NestedCoupling::~NestedCoupling() {
+  // empty
+}
+
+//! Exchange fields between the coarse model and regional models.
+/*!
+ * Collective on the communicator containing all models.
+ */
+void NestedCoupling::exchange() {
+  if (m_region < 0) {
+    send_coarse_fields();
+    receive_regional_fields();
+  } else {
+    receive_coarse_fields();
+    send_regional_fields();
+  }
+}
+
+void NestedCoupling::send_coarse_fields() {
+  const Geometry &geometry = m_model.geometry();
+
+  m_thickness.copy_from(geometry.ice_thickness);
+  m_surface_elevation.copy_from(geometry.ice_surface_elevation);
+  m_velocity.copy_from(m_model.stress_balance()->advective_velocity());
+
+  auto H = gather(m_thickness, *m_scalar0);
+  auto h = gather(m_surface_elevation, *m_scalar0);
+  auto V = gather(m_velocity, *m_vector0);
+
+  if (m_model.grid()->rank() == 0) {
+    // pack ice thickness, surface elevation and two velocity components at each point
+    const size_t N = H.size();
+    std::vector<double> data(4 * N);
+    for (size_t k = 0; k < N; ++k) {
+      data[4 * k + 0] = H[k];
+      data[4 * k + 1] = h[k];
+      data[4 * k + 2] = V[2 * k + 0];
+      data[4 * k + 3] = V[2 * k + 1];
+    }
+
+    for (int r = 0; r < m_n_regions; ++r) {
+      send_vector(m_com, m_roots[r + 1], fields_tag, data);
+    }
+  }
+}
+
+void NestedCoupling::receive_coarse_fields() {
+  const IceGrid &grid = *m_model.grid();
+
+  const size_t
+    Mx = grid.Mx(),
+    N  = Mx * grid.My();
+
+  std::vector<double> H, h, V;
+
+  if (grid.rank() == 0) {
+    auto data = receive_vector(m_com, m_roots[0], fields_tag);
+
+    const size_t coarse_Mx = m_coarse_x.size();
+
+    Interpolation
+      x_interp(LINEAR, m_coarse_x, grid.x()),
+      y_interp(LINEAR, m_coarse_y, grid.y());
+
+    H.resize(N);
+    h.resize(N);
+    V.resize(2 * N);
+
+    double values[4];
+    for (size_t j = 0; j < grid.My(); ++j) {
+      const int
+        B = y_interp.left(j),
+        T = y_interp.right(j);
+      const double beta = y_interp.alpha(j);
+
+      for (size_t i = 0; i < Mx; ++i) {
+        const int
+          L = x_interp.left(i),
+          R = x_interp.right(i);
+        const double alpha = x_interp.alpha(i);
+
+        for (int k = 0; k < 4; ++k) {
+          const double
+            f_LB = data[4 * (B * coarse_Mx + L) + k],
+            f_RB = data[4 * (B * coarse_Mx + R) + k],
+            f_LT = data[4 * (T * coarse_Mx + L) + k],
+            f_RT = data[4 * (T * coarse_Mx + R) + k];
+
+          values[k] = ((1.0 - beta) * (f_LB + alpha * (f_RB - f_LB)) +
+                       beta * (f_LT + alpha * (f_RT - f_LT)));
+        }
+
+        const size_t p = j * Mx + i;
+        H[p]         = values[0];
+        h[p]         = values[1];
+        V[2 * p + 0] = values[2];
+        V[2 * p + 1] = values[3];
+      }
+    }
+  }
+
+  scatter(H, *m_scalar0, m_thickness);
+  scatter(h, *m_scalar0, m_surface_elevation);
+  scatter(V, *m_vector0, m_velocity);
+
+  m_regional_model->set_boundary_conditions(m_thickness, m_surface_elevation, m_velocity);
+}
+
+void NestedCoupling::send_regional_fields() {
+  m_thickness.copy_from(m_model.geometry().ice_thickness);
+
+  auto H = gather(m_thickness, *m_scalar0);
+
+  if (m_model.grid()->rank() == 0) {
+    send_vector(m_com, m_roots[0], fields_tag, H);
+  }
+}
+
+void NestedCoupling::receive_regional_fields() {
+  const IceGrid &grid = *m_model.grid();
+
+  const int
+    Mx = grid.Mx(),
+    My = grid.My();
+
+  std::vector<double> H, mask;
+
+  if (grid.rank() == 0) {
+    H.resize(Mx * My, 0.0);
+    mask.resize(Mx * My, 0.0);
+
+    const double
+      dx = grid.dx(),
+      dy = grid.dy(),
+      x0 = m_coarse_x.front(),
+      y0 = m_coarse_y.front();
+
+    for (int r = 0; r < m_n_regions; ++r) {
+      auto H_regional = receive_vector(m_com, m_roots[r + 1], fields_tag);
+
+      const std::vector<double>
+        &x = m_regional_x[r],
+        &y = m_regional_y[r],
+        &no_model_mask = m_regional_mask[r];
+
+      const size_t
+        regional_Mx = x.size(),
+        regional_My = y.size();
+
+      // the number of regional grid points in a coarse grid cell
+      int min_count = 1;
+      if (regional_Mx > 1 and regional_My > 1) {
+        const double
+          regional_dx = x[1] - x[0],
+          regional_dy = y[1] - y[0];
+        min_count = std::max(1, (int)std::floor((dx * dy) / (regional_dx * regional_dy) + 1e-6));
+      }
+
+      std::vector<double> sum(Mx * My, 0.0);
+      std::vector<int> count(Mx * My, 0);
+
+      for (size_t j = 0; j < regional_My; ++j) {
+        for (size_t i = 0; i < regional_Mx; ++i) {
+          const size_t p = j * regional_Mx + i;
+
+          if (no_model_mask[p] > 0.5) {
+            continue;
+          }
+
+          const long int
+            I = std::lround((x[i] - x0) / dx),
+            J = std::lround((y[j] - y0) / dy);
+
+          if (I < 0 or I >= Mx or J < 0 or J >= My) {
+            continue;
+          }
+
+          sum[J * Mx + I]   += H_regional[p];
+          count[J * Mx + I] += 1;
+        }
+      }
+
+      for (int k = 0; k < Mx * My; ++k) {
+        if (count[k] >= min_count) {
+          H[k]    = sum[k] / count[k];
+          mask[k] = 1.0;
+        }
+      }
+    }
+  }
+
+  scatter(H, *m_scalar0, m_thickness);
+  scatter(mask, *m_scalar0, m_mask);
+
+  m_model.set_ice_thickness(m_thickness, m_mask);
+}
+
+} // end of namespace pism
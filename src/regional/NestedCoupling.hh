@@ -0,0 +1,98 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_NESTEDCOUPLING_H
+#define PISM_NESTEDCOUPLING_H
+
+#include <vector>
+#include <mpi.h>
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+
+namespace pism {
+
+class IceModel;
+class IceRegionalModel;
+
+//! In-memory two-way coupling of a coarse model and regional models nested in it.
+/*!
+ * The coarse model and each regional model run on disjoint groups of processes in the
+ * communicator `com`. Each of them creates a NestedCoupling instance and all processes
+ * call exchange() at the same model times (see `regional.nested.coupling_interval`).
+ * Between exchanges models take their own time steps.
+ *
+ * During an exchange
+ *
+ * - the coarse model sends its ice thickness, surface elevation and advective velocity to
+ *   regional models; these are interpolated (bi-linearly) onto regional grids and used as
+ *   boundary conditions in `no_model_mask` areas (see
+ *   IceRegionalModel::set_boundary_conditions()),
+ *
+ * - regional models send their ice thickness back; values at regional grid points
+ *   outside of `no_model_mask` areas are averaged over coarse grid cells and replace
+ *   coarse ice thickness in cells completely covered by these points.
+ *
+ * Fields are gathered on rank 0 of each model and exchanged between these ranks.
+ */
+class NestedCoupling {
+public:
+  NestedCoupling(MPI_Comm com, int n_regions, int region, IceModel &model);
+  ~NestedCoupling();
+
+  void exchange();
+private:
+  void send_coarse_fields();
+  void receive_coarse_fields();
+  void send_regional_fields();
+  void receive_regional_fields();
+
+  //! communicator containing all models
+  MPI_Comm m_com;
+  //! number of regional models
+  int m_n_regions;
+  //! index of the regional model using this instance or -1 for the coarse model
+  int m_region;
+
+  IceModel &m_model;
+  //! set if m_region >= 0
+  IceRegionalModel *m_regional_model;
+
+  //! ranks (in m_com) of rank 0 of the coarse model (first) and of regional models
+  std::vector<int> m_roots;
+
+  //! grid coordinates of the coarse model (on roots of all models)
+  std::vector<double> m_coarse_x, m_coarse_y;
+
+  //! grid coordinates and `no_model_mask` of regional models (on the root of the coarse
+  //! model)
+  std::vector<std::vector<double> > m_regional_x, m_regional_y, m_regional_mask;
+
+  //! storage for fields sent or received by this model
+  IceModelVec2S m_thickness, m_surface_elevation;
+  IceModelVec2Int m_mask;
+  IceModelVec2V m_velocity;
+
+  //! copies of fields on rank 0
+  petsc::Vec::Ptr m_scalar0, m_vector0;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_NESTEDCOUPLING_H */
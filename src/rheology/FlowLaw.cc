@@ -16,6 +16,9 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cmath>
+#include <algorithm>
+
 #include "FlowLaw.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/EnthalpyConverter.hh"
@@ -58,6 +61,70 @@ FlowLaw::FlowLaw(const std::string &prefix, const Config &config,
   m_schoofLen = config.get_number("flow_law.Schoof_regularizing_length", "m"); // convert to meters
   m_schoofVel = config.get_number("flow_law.Schoof_regularizing_velocity", "m second-1"); // convert to m second-1
   m_schoofReg = PetscSqr(m_schoofVel/m_schoofLen);
+
+  m_use_softness_table = config.get_flag("flow_law.Paterson_Budd.lookup_table.enabled");
+  if (m_use_softness_table) {
+    double
+      T_min   = config.get_number("flow_law.Paterson_Budd.lookup_table.T_min"),
+      spacing = config.get_number("flow_law.Paterson_Budd.lookup_table.spacing");
+
+    if (not (spacing > 0.0)) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "flow_law.Paterson_Budd.lookup_table.spacing = %f is invalid"
+                                    " (has to be positive)", spacing);
+    }
+
+    if (not (T_min < m_crit_temp and m_crit_temp < m_melting_point_temp)) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "flow_law.Paterson_Budd.lookup_table.T_min = %f is invalid"
+                                    " (has to be below T_critical = %f)", T_min, m_crit_temp);
+    }
+
+    init_softness_table(T_min, m_crit_temp, spacing, m_A_cold, m_Q_cold, m_table_cold);
+    init_softness_table(m_crit_temp, m_melting_point_temp, spacing, m_A_warm, m_Q_warm,
+                        m_table_warm);
+  }
+}
+
+//! Tabulate `A exp(-Q / (R T))` on `[T_min, T_max]` using (at most) the given spacing.
+/*!
+ * Both end points are grid points, so the cold and warm tables do not straddle the
+ * discontinuity at the critical temperature.
+ */
+void FlowLaw::init_softness_table(double T_min, double T_max, double spacing,
+                                  double A, double Q, SoftnessTable &table) const {
+  const unsigned int N = std::max(std::ceil((T_max - T_min) / spacing), 1.0);
+  const double dT = (T_max - T_min) / N;
+
+  table.T_min  = T_min;
+  table.T_max  = T_max;
+  table.dT_inv = 1.0 / dT;
+  table.values.resize(N + 1);
+  for (unsigned int k = 0; k <= N; ++k) {
+    table.values[k] = A * exp(-Q / (m_ideal_gas_constant * (T_min + k * dT)));
+  }
+}
+
+//! Interpolate tabulated softness. `T_pa` has to be in `[m_table_cold.T_min, m_table_warm.T_max]`.
+/*!
+ * In a table cell of width @f$ h @f$ the relative error of linear interpolation of @f$
+ * A(T) = A_0 \exp(-Q/(R T)) @f$ is bounded by
+ *
+ * @f[ \frac{h^2}{8} \max \left| \left(\frac{Q}{R T^2}\right)^2 - \frac{2 Q}{R T^3} \right|, @f]
+ *
+ * which is below @f$ 10^{-6} @f$ for @f$ h = 0.01 @f$ K and the default Paterson-Budd
+ * constants.
+ */
+inline double FlowLaw::softness_table(double T_pa) const {
+  const SoftnessTable &table = T_pa < m_crit_temp ? m_table_cold : m_table_warm;
+
+  const double s = (T_pa - table.T_min) * table.dT_inv;
+  const unsigned int
+    N = table.values.size() - 1,
+    k = std::min((unsigned int)s, N - 1);
+  const double lambda = s - k;
+
+  return table.values[k] + lambda * (table.values[k + 1] - table.values[k]);
 }
 
 FlowLaw::~FlowLaw() {
@@ -85,14 +152,72 @@ double FlowLaw::enhancement_factor_interglacial() const {
 }
 
 //! Return the softness parameter A(T) for a given temperature T.
-/*! This is not a natural part of all FlowLaw instances.   */
+/*! This is not a natural part of all FlowLaw instances.
+
+  Uses lookup tables if `flow_law.Paterson_Budd.lookup_table.enabled` is set and `T_pa` is
+  in the range covered by tables.
+*/
 double FlowLaw::softness_paterson_budd(double T_pa) const {
+  if (m_use_softness_table and
+      T_pa >= m_table_cold.T_min and T_pa <= m_table_warm.T_max) {
+    return softness_table(T_pa);
+  }
+
   const double A = T_pa < m_crit_temp ? m_A_cold : m_A_warm;
   const double Q = T_pa < m_crit_temp ? m_Q_cold : m_Q_warm;
 
   return A * exp(-Q / (m_ideal_gas_constant * T_pa));
 }
 
+//! Batch version of softness_paterson_budd().
+/*!
+ * The cold/warm switch is written using conditional expressions (not branches) so that
+ * this loop can be vectorized. `T_pa` and `result` may point to the same array.
+ */
+void FlowLaw::softness_paterson_budd_n(const double *T_pa, unsigned int n,
+                                       double *result) const {
+  if (m_use_softness_table) {
+    for (unsigned int k = 0; k < n; ++k) {
+      result[k] = softness_paterson_budd(T_pa[k]);
+    }
+    return;
+  }
+
+  const double
+    A_cold = m_A_cold,
+    A_warm = m_A_warm,
+    Q_cold = m_Q_cold,
+    Q_warm = m_Q_warm,
+    T_crit = m_crit_temp,
+    R      = m_ideal_gas_constant;
+
+  for (unsigned int k = 0; k < n; ++k) {
+    const double
+      T = T_pa[k],
+      A = T < T_crit ? A_cold : A_warm,
+      Q = T < T_crit ? Q_cold : Q_warm;
+
+    result[k] = A * exp(-Q / (R * T));
+  }
+}
+
+//! Replace softness values in `result` with corresponding hardness values.
+void FlowLaw::hardness_from_softness_n(unsigned int n, double *result) const {
+  const double power = m_hardness_power;
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = pow(result[k], power);
+  }
+}
+
+//! Replace softness values in `result` with strain rates corresponding to `stress`.
+void FlowLaw::flow_from_softness_n(const double *stress, unsigned int n,
+                                   double *result) const {
+  const double power = m_n - 1;
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] *= pow(stress[k], power);
+  }
+}
+
 //! The flow law itself.
 double FlowLaw::flow(double stress, double enthalpy,
                      double pressure, double gs) const {
@@ -123,6 +248,18 @@ double FlowLaw::softness(double E, double p) const {
   return this->softness_impl(E, p);
 }
 
+void FlowLaw::softness_n(const double *enthalpy, const double *pressure,
+                         unsigned int n, double *result) const {
+  this->softness_n_impl(enthalpy, pressure, n, result);
+}
+
+void FlowLaw::softness_n_impl(const double *enthalpy, const double *pressure,
+                              unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = this->softness(enthalpy[k], pressure[k]);
+  }
+}
+
 double FlowLaw::hardness(double E, double p) const {
   return this->hardness_impl(E, p);
 }
@@ -208,6 +345,8 @@ void averaged_hardness_vec(const FlowLaw &ice,
   loop.check();
 
   result.update_ghosts();
+  // StressBalance::deviatoric_stresses() caches results keyed on this counter
+  result.inc_state_counter();
 }
 
 //! Computes vertical average of `B(E, p)` ice hardness, namely @f$\bar B(E, p)@f$.
@@ -274,5 +413,32 @@ bool FlowLawUsesGrainSize(const FlowLaw &flow_law) {
   return false;
 }
 
+//! Returns true if `flow_law` satisfies `flow(s, E, p, gs) == softness(E, p) * s^(n-1)`.
+/*!
+ * Strain rates computed by such flow laws can be split into a part that depends on
+ * enthalpy and pressure only (softness) and a power of the stress.
+ */
+bool FlowLawIsPowerLaw(const FlowLaw &flow_law) {
+  if (FlowLawUsesGrainSize(flow_law)) {
+    return false;
+  }
+
+  static const double s[] = {1e4, 1e5, 1e6}, E = 400000, p = 1e6, gs = 1e-3;
+  const double n = flow_law.exponent();
+  try {
+    const double A = flow_law.softness(E, p);
+    for (int i = 0; i < 3; i++) {
+      const double F = flow_law.flow(s[i], E, p, gs);
+      if (std::fabs(F - A * pow(s[i], n - 1)) > 1e-12 * std::fabs(F)) {
+        return false;
+      }
+    }
+  } catch (std::exception &) {
+    // some flow laws (e.g. Goldsby-Kohlstedt) do not implement softness()
+    return false;
+  }
+  return true;
+}
+
 } // end of namespace rheology
 } // end of namespace pism
@@ -20,6 +20,7 @@
 #define __flowlaws_hh
 
 #include <string>
+#include <vector>
 
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/Vector2.hh"
@@ -72,6 +73,14 @@ namespace rheology {
   @note FlowLaw derived classes should implement hardness() in
   terms of softness(). That way in many cases we only need to
   re-implement softness... to turn one flow law into another.
+
+  @note Stress balance and energy balance code evaluates the flow law in whole columns
+  using flow_n(), hardness_n(), and softness_n(). Default implementations of these call
+  flow(), hardness(), and softness() (i.e. virtual methods) for each point. Derived
+  classes override them to avoid per-point virtual calls and to split computations
+  into a "scalar" part (enthalpy to temperature conversion) and loops without branches
+  or function calls that the compiler can vectorize (see softness_paterson_budd_n()).
+  Overrides have to produce the same results as the corresponding per-point methods.
 */
 class FlowLaw {
 public:
@@ -94,6 +103,8 @@ public:
                   unsigned int n, double *result) const;
 
   double softness(double E, double p) const;
+  void softness_n(const double *enthalpy, const double *pressure,
+                  unsigned int n, double *result) const;
 
   double flow(double stress, double E, double pressure, double grainsize) const;
   void flow_n(const double *stress, const double *E,
@@ -110,6 +121,8 @@ protected:
   virtual void hardness_n_impl(const double *enthalpy, const double *pressure,
                                unsigned int n, double *result) const;
   virtual double softness_impl(double E, double p) const = 0;
+  virtual void softness_n_impl(const double *enthalpy, const double *pressure,
+                               unsigned int n, double *result) const;
 
 protected:
   std::string m_name;
@@ -120,6 +133,9 @@ protected:
   EnthalpyConverter::Ptr m_EC;
 
   double softness_paterson_budd(double T_pa) const;
+  void softness_paterson_budd_n(const double *T_pa, unsigned int n, double *result) const;
+  void hardness_from_softness_n(unsigned int n, double *result) const;
+  void flow_from_softness_n(const double *stress, unsigned int n, double *result) const;
 
   //! regularizing length
   double m_schoofLen;
@@ -144,6 +160,19 @@ protected:
   //! critical temperature (cold -- warm transition)
   double m_crit_temp;
 
+  //! Tabulated Paterson-Budd softness on a uniform grid (see softness_paterson_budd()).
+  struct SoftnessTable {
+    double T_min, T_max, dT_inv;
+    std::vector<double> values;
+  };
+  //! true if softness_paterson_budd() uses lookup tables
+  bool m_use_softness_table;
+  //! lookup tables for the cold (`T_min <= T_pa < T_critical`) and warm cases
+  SoftnessTable m_table_cold, m_table_warm;
+  void init_softness_table(double T_min, double T_max, double spacing,
+                           double A, double Q, SoftnessTable &table) const;
+  double softness_table(double T_pa) const;
+
   //! acceleration due to gravity
   double m_standard_gravity;
   //! ideal gas constant
@@ -169,6 +198,7 @@ void averaged_hardness_vec(const FlowLaw &ice,
 
 // Helper functions:
 bool FlowLawUsesGrainSize(const FlowLaw &flow_law);
+bool FlowLawIsPowerLaw(const FlowLaw &flow_law);
 
 } // end of namespace rheology
 } // end of namespace pism
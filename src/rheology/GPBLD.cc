@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::min
+
 #include "GPBLD.hh"
 #include "pism/util/ConfigInterface.hh"
 
@@ -60,5 +62,59 @@ double GPBLD::softness_impl(double enthalpy, double pressure) const {
   }
 }
 
+//! Batch version of softness_impl().
+/*!
+  Computes the pressure-adjusted temperature and the water fraction factor for a block of
+  points first, then evaluates the Paterson-Budd relation for the whole block using
+  softness_paterson_budd_n().
+
+  In temperate ice the softness is computed as `softness_paterson_budd(m_T_0) * factor`
+  and in cold ice as `softness_paterson_budd(T_pa) * 1.0`, so results are the same as
+  the ones computed by softness_impl().
+*/
+void GPBLD::softness_n_impl(const double *enthalpy, const double *pressure,
+                            unsigned int n, double *result) const {
+  const unsigned int block_size = 64;
+  double factor[block_size];
+
+  for (unsigned int start = 0; start < n; start += block_size) {
+    const unsigned int N = std::min(block_size, n - start);
+    const double *E = enthalpy + start, *p = pressure + start;
+    double *T_pa = result + start;
+
+    for (unsigned int k = 0; k < N; ++k) {
+      if (E[k] < m_EC->enthalpy_cts(p[k])) {
+        T_pa[k]   = m_EC->pressure_adjusted_temperature(E[k], p[k]);
+        factor[k] = 1.0;
+      } else {
+        double omega = std::min(m_EC->water_fraction(E[k], p[k]),
+                                m_water_frac_observed_limit);
+        T_pa[k]   = m_T_0;
+        factor[k] = 1.0 + m_water_frac_coeff * omega;
+      }
+    }
+
+    // T_pa and the result share storage
+    softness_paterson_budd_n(T_pa, N, T_pa);
+
+    for (unsigned int k = 0; k < N; ++k) {
+      T_pa[k] *= factor[k];
+    }
+  }
+}
+
+void GPBLD::hardness_n_impl(const double *enthalpy, const double *pressure,
+                            unsigned int n, double *result) const {
+  GPBLD::softness_n_impl(enthalpy, pressure, n, result);
+  hardness_from_softness_n(n, result);
+}
+
+void GPBLD::flow_n_impl(const double *stress, const double *enthalpy,
+                        const double *pressure, const double * /* grainsize */,
+                        unsigned int n, double *result) const {
+  GPBLD::softness_n_impl(enthalpy, pressure, n, result);
+  flow_from_softness_n(stress, n, result);
+}
+
 } // end of namespace rheology
 } // end of namespace pism
@@ -98,6 +98,31 @@ double GoldsbyKohlstedt::hardness_impl(double enthalpy, double pressure) const {
   return pow(A, m_hardness_power);
 }
 
+//! Batch version of hardness_impl().
+void GoldsbyKohlstedt::hardness_n_impl(const double *enthalpy, const double *pressure,
+                                       unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_EC->pressure_adjusted_temperature(enthalpy[k], pressure[k]);
+  }
+  softness_paterson_budd_n(result, n, result);
+  hardness_from_softness_n(n, result);
+}
+
+/*!
+  Batch version of flow_impl().
+
+  The Goldsby-Kohlstedt flow law is too branchy to benefit from vectorization, but the
+  qualified call of flow_from_temp() avoids a virtual call per point.
+*/
+void GoldsbyKohlstedt::flow_n_impl(const double *stress, const double *E,
+                                   const double *pressure, const double *grainsize,
+                                   unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    double temp = m_EC->temperature(E[k], pressure[k]);
+    result[k] = GoldsbyKohlstedt::flow_from_temp(stress[k], temp, pressure[k], grainsize[k]);
+  }
+}
+
 double GoldsbyKohlstedt::softness_impl(double , double) const {
   throw std::runtime_error("double GoldsbyKohlstedt::softness is not implemented");
 
@@ -244,6 +269,16 @@ double GoldsbyKohlstedtStripped::flow_from_temp(double stress, double temp, doub
   return eps_disl + (eps_basal * eps_gbs) / (eps_basal + eps_gbs);
 }
 
+void GoldsbyKohlstedtStripped::flow_n_impl(const double *stress, const double *E,
+                                           const double *pressure, const double *grainsize,
+                                           unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    double temp = m_EC->temperature(E[k], pressure[k]);
+    result[k] = GoldsbyKohlstedtStripped::flow_from_temp(stress[k], temp,
+                                                         pressure[k], grainsize[k]);
+  }
+}
+
 
 } // end of namespace rheology
 } // end of namespace pism
@@ -57,6 +57,11 @@ protected:
   // NB! not virtual
   double softness_impl(double E, double p) const __attribute__((noreturn));
   double hardness_impl(double E, double p) const;
+  void hardness_n_impl(const double *enthalpy, const double *pressure,
+                       unsigned int n, double *result) const;
+  virtual void flow_n_impl(const double *stress, const double *E,
+                           const double *pressure, const double *grainsize,
+                           unsigned int n, double *result) const;
   virtual double flow_from_temp(double stress, double temp,
                                 double pressure, double gs) const;
   GKparts flowParts(double stress, double temp, double pressure) const;
@@ -86,6 +91,9 @@ public:
 protected:
   virtual double flow_from_temp(double stress, double temp,
                                 double pressure, double gs) const;
+  virtual void flow_n_impl(const double *stress, const double *E,
+                           const double *pressure, const double *grainsize,
+                           unsigned int n, double *result) const;
 
   double m_d_grain_size_stripped;
 };
@@ -48,5 +48,20 @@ double Hooke::softness_from_temp(double T_pa) const {
                          + 3.0 * m_C_Hooke * pow(m_Tr_Hooke - T_pa, -m_K_Hooke));
 }
 
+void Hooke::softness_from_temp_n(const double *T_pa, unsigned int n, double *result) const {
+  const double
+    A  = m_A_Hooke,
+    Q  = m_Q_Hooke,
+    C  = m_C_Hooke,
+    K  = m_K_Hooke,
+    Tr = m_Tr_Hooke,
+    R  = m_ideal_gas_constant;
+
+  for (unsigned int k = 0; k < n; ++k) {
+    const double T = T_pa[k];
+    result[k] = A * exp(-Q/(R * T) + 3.0 * C * pow(Tr - T, -K));
+  }
+}
+
 } // end of namespace rheology
 } // end of namespace pism
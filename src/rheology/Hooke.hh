@@ -32,6 +32,7 @@ public:
   virtual ~Hooke();
 protected:
   virtual double softness_from_temp(double T_pa) const;
+  virtual void softness_from_temp_n(const double *T_pa, unsigned int n, double *result) const;
 
   double m_A_Hooke, m_Q_Hooke, m_C_Hooke, m_K_Hooke, m_Tr_Hooke; // constants from Hooke (1981)
   // R_Hooke is the ideal_gas_constant.
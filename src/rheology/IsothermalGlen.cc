@@ -46,6 +46,26 @@ double IsothermalGlen::hardness_impl(double, double) const {
   return m_hardness_B;
 }
 
+void IsothermalGlen::flow_n_impl(const double *stress, const double *, const double *,
+                                 const double *, unsigned int n, double *result) const {
+  IsothermalGlen::softness_n_impl(nullptr, nullptr, n, result);
+  flow_from_softness_n(stress, n, result);
+}
+
+void IsothermalGlen::softness_n_impl(const double *, const double *,
+                                     unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_softness_A;
+  }
+}
+
+void IsothermalGlen::hardness_n_impl(const double *, const double *,
+                                     unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_hardness_B;
+  }
+}
+
 double IsothermalGlen::flow_from_temp(double stress, double, double, double) const {
   return m_softness_A * pow(stress,m_n-1);
 }
@@ -58,10 +58,52 @@ double PatersonBudd::flow_from_temp(double stress, double temp,
   return softness_from_temp(T_pa) * pow(stress, m_n-1);
 }
 
+/*! Batch version of flow_impl(): computes temperatures first, then calls flow_from_temp_n. */
+void PatersonBudd::flow_n_impl(const double *stress, const double *E,
+                               const double *pressure, const double *gs,
+                               unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_EC->temperature(E[k], pressure[k]);
+  }
+  this->flow_from_temp_n(stress, result, pressure, gs, n, result);
+}
+
+void PatersonBudd::flow_from_temp_n(const double *stress, const double *temp,
+                                    const double *pressure, const double * /*gs*/,
+                                    unsigned int n, double *result) const {
+  const double C = m_beta_CC_grad / (m_rho * m_standard_gravity);
+  for (unsigned int k = 0; k < n; ++k) {
+    // pressure-adjusted temperature
+    result[k] = temp[k] + C * pressure[k];
+  }
+  this->softness_from_temp_n(result, n, result);
+  flow_from_softness_n(stress, n, result);
+}
+
+/*! Batch version of softness_impl(). */
+void PatersonBudd::softness_n_impl(const double *enthalpy, const double *pressure,
+                                   unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_EC->pressure_adjusted_temperature(enthalpy[k], pressure[k]);
+  }
+  this->softness_from_temp_n(result, n, result);
+}
+
+void PatersonBudd::hardness_n_impl(const double *enthalpy, const double *pressure,
+                                   unsigned int n, double *result) const {
+  PatersonBudd::softness_n_impl(enthalpy, pressure, n, result);
+  hardness_from_softness_n(n, result);
+}
+
 double PatersonBudd::softness_from_temp(double T_pa) const {
   return softness_paterson_budd(T_pa);
 }
 
+void PatersonBudd::softness_from_temp_n(const double *T_pa, unsigned int n,
+                                        double *result) const {
+  softness_paterson_budd_n(T_pa, n, result);
+}
+
 double PatersonBudd::hardness_from_temp(double T_pa) const {
   return pow(softness_from_temp(T_pa), m_hardness_power);
 }
@@ -44,12 +44,27 @@ double PatersonBuddCold::softness_from_temp(double T_pa) const {
   return m_A_cold * exp(-m_Q_cold / (m_ideal_gas_constant * T_pa));
 }
 
+void PatersonBuddCold::softness_from_temp_n(const double *T_pa, unsigned int n,
+                                            double *result) const {
+  const double A = m_A_cold, Q = m_Q_cold, R = m_ideal_gas_constant;
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = A * exp(-Q / (R * T_pa[k]));
+  }
+}
+
 // ignores pressure and uses non-pressure-adjusted temperature
 double PatersonBuddCold::flow_from_temp(double stress, double temp,
                                         double , double) const {
   return softness_from_temp(temp) * pow(stress,m_n-1);
 }
 
+void PatersonBuddCold::flow_from_temp_n(const double *stress, const double *temp,
+                                        const double *, const double *,
+                                        unsigned int n, double *result) const {
+  PatersonBuddCold::softness_from_temp_n(temp, n, result);
+  flow_from_softness_n(stress, n, result);
+}
+
 
 // Rather than make this part of the base class, we just check at some reference values.
 bool FlowLawIsPatersonBuddCold(const FlowLaw &flow_law, const Config &config,
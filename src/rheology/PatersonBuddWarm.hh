@@ -38,9 +38,13 @@ protected:
   // takes care of hardness...
   double softness_from_temp(double T_pa) const;
 
+  void softness_from_temp_n(const double *T_pa, unsigned int n, double *result) const;
   // ignores pressure and uses non-pressure-adjusted temperature
   double flow_from_temp(double stress, double temp,
                         double , double) const;
+  void flow_from_temp_n(const double *stress, const double *temp,
+                        const double *, const double *,
+                        unsigned int n, double *result) const;
 };
 
 } // end of namespace rheology
@@ -0,0 +1,195 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Compares per-point (flow(), hardness()) and per-column (flow_n(), hardness_n())\n"
+  "evaluation of ice flow laws.\n\n";
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include "pism/rheology/FlowLawFactory.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/EnthalpyConverter.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+using namespace pism;
+
+//! Columns of ice containing both cold and temperate ice.
+struct Columns {
+  Columns(const EnthalpyConverter &EC, unsigned int size, unsigned int n_columns)
+    : Mz(size), N(n_columns),
+      stress(size * n_columns), E(size * n_columns), p(size * n_columns),
+      gs(size * n_columns, 1e-3) {
+
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    const double H = 3000.0, dz = H / std::max(size - 1, 1u);
+
+    // column c is stored at [c * Mz, (c + 1) * Mz)
+    for (unsigned int c = 0; c < N; ++c) {
+      const double alpha = 1e-3 * uniform(generator);
+      for (unsigned int k = 0; k < Mz; ++k) {
+        const unsigned int n = c * Mz + k;
+
+        p[n]      = EC.pressure(H - k * dz);
+        stress[n] = alpha * p[n];
+
+        const double T_m = EC.melting_temperature(p[n]);
+        if (uniform(generator) < 0.8) {
+          E[n] = EC.enthalpy(T_m - 40.0 * uniform(generator), 0.0, p[n]);
+        } else {
+          E[n] = EC.enthalpy(T_m, 0.01 * uniform(generator), p[n]);
+        }
+      }
+    }
+  }
+
+  unsigned int Mz, N;
+  std::vector<double> stress, E, p, gs;
+};
+
+static double max_relative_difference(const std::vector<double> &a,
+                                      const std::vector<double> &b) {
+  double result = 0.0;
+  for (unsigned int k = 0; k < a.size(); ++k) {
+    if (a[k] != b[k]) {
+      result = std::max(result, std::fabs(a[k] - b[k]) / std::max(std::fabs(a[k]),
+                                                                   std::fabs(b[k])));
+    }
+  }
+  return result;
+}
+
+//! Evaluate flow() and hardness() at each point. Returns elapsed times.
+static void per_point(const rheology::FlowLaw &law, const Columns &C, int n_repeats,
+                      std::vector<double> &flow, std::vector<double> &hardness,
+                      double &t_flow, double &t_hardness) {
+  const unsigned int size = C.Mz * C.N;
+  flow.resize(size);
+  hardness.resize(size);
+
+  double start = get_time();
+  for (int r = 0; r < n_repeats; ++r) {
+    for (unsigned int n = 0; n < size; ++n) {
+      flow[n] = law.flow(C.stress[n], C.E[n], C.p[n], C.gs[n]);
+    }
+  }
+  t_flow = get_time() - start;
+
+  start = get_time();
+  for (int r = 0; r < n_repeats; ++r) {
+    for (unsigned int n = 0; n < size; ++n) {
+      hardness[n] = law.hardness(C.E[n], C.p[n]);
+    }
+  }
+  t_hardness = get_time() - start;
+}
+
+//! Evaluate flow_n() and hardness_n() in each column. Returns elapsed times.
+static void per_column(const rheology::FlowLaw &law, const Columns &C, int n_repeats,
+                       std::vector<double> &flow, std::vector<double> &hardness,
+                       double &t_flow, double &t_hardness) {
+  flow.resize(C.Mz * C.N);
+  hardness.resize(C.Mz * C.N);
+
+  double start = get_time();
+  for (int r = 0; r < n_repeats; ++r) {
+    for (unsigned int c = 0; c < C.N; ++c) {
+      const unsigned int offset = c * C.Mz;
+      law.flow_n(&C.stress[offset], &C.E[offset], &C.p[offset], &C.gs[offset],
+                 C.Mz, &flow[offset]);
+    }
+  }
+  t_flow = get_time() - start;
+
+  start = get_time();
+  for (int r = 0; r < n_repeats; ++r) {
+    for (unsigned int c = 0; c < C.N; ++c) {
+      const unsigned int offset = c * C.Mz;
+      law.hardness_n(&C.E[offset], &C.p[offset], C.Mz, &hardness[offset]);
+    }
+  }
+  t_hardness = get_time() - start;
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "flow_law_benchmark");
+    Logger::Ptr log = ctx->log();
+
+    options::StringList flow_laws("-flow_laws", "Flow laws to compare",
+                                  "isothermal_glen,pb,gpbld,hooke,arr,arrwarm,gk");
+    options::Integer Mz("-Mz", "Number of points in a column", 101);
+    options::Integer n_columns("-n_columns", "Number of columns", 10000);
+    options::Integer n_repeats("-n_repeats", "Number of times to repeat each evaluation", 10);
+
+    if (Mz < 1 or n_columns < 1 or n_repeats < 1) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "-Mz, -n_columns, and -n_repeats have to be positive");
+    }
+
+    Columns C(*ctx->enthalpy_converter(), Mz, n_columns);
+
+    rheology::FlowLawFactory factory("stress_balance.sia.", ctx->config(),
+                                     ctx->enthalpy_converter());
+
+    log->message(2, "%d columns, Mz = %d, %d repetitions\n",
+                 n_columns.value(), Mz.value(), n_repeats.value());
+    log->message(2, "%16s %14s %14s %10s %12s %14s %14s %10s %12s\n",
+                 "flow law",
+                 "flow (s)", "flow_n (s)", "speedup", "rel. diff.",
+                 "hardness (s)", "hardness_n (s)", "speedup", "rel. diff.");
+
+    for (const auto &name : flow_laws.value()) {
+      factory.set_default(name);
+      auto law = factory.create();
+
+      std::vector<double> F_point, B_point, F_column, B_column;
+      double t_F_point, t_B_point, t_F_column, t_B_column;
+
+      per_point(*law, C, n_repeats, F_point, B_point, t_F_point, t_B_point);
+      per_column(*law, C, n_repeats, F_column, B_column, t_F_column, t_B_column);
+
+      log->message(2, "%16s %14.6f %14.6f %10.2f %12.2e %14.6f %14.6f %10.2f %12.2e\n",
+                   name.c_str(),
+                   t_F_point, t_F_column, t_F_point / t_F_column,
+                   max_relative_difference(F_point, F_column),
+                   t_B_point, t_B_column, t_B_point / t_B_column,
+                   max_relative_difference(B_point, B_column));
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
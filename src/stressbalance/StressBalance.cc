@@ -16,6 +16,9 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cassert>
+#include <algorithm>
+
 #include "StressBalance.hh"
 #include "ShallowStressBalance.hh"
 #include "SSB_Modifier.hh"
@@ -139,8 +142,18 @@ StressBalance::StressBalance(IceGrid::ConstPtr g,
                              ShallowStressBalance *sb,
                              SSB_Modifier *ssb_mod)
   : Component(g),
+    m_cfl_2d_is_local(false),
     m_w(m_grid, "wvel_rel", WITHOUT_GHOSTS),
     m_strain_heating(m_grid, "strain_heating", WITHOUT_GHOSTS),
+    m_column_top(m_grid, "column_top_index", WITH_GHOSTS),
+    m_strain_rates(m_grid, "strain_rates", WITHOUT_GHOSTS, 1, 2),
+    m_deviatoric_stresses(m_grid, "deviatoric_stresses", WITHOUT_GHOSTS, 1, 3),
+    m_3d_fields_are_stale(false),
+    m_cell_type(m_grid, "saved_cell_type", WITH_GHOSTS),
+    m_ice_thickness(m_grid, "saved_ice_thickness", WITHOUT_GHOSTS),
+    m_basal_melt_rate(m_grid, "saved_basal_melt_rate", WITHOUT_GHOSTS),
+    m_use_basal_melt_rate(false),
+    m_enthalpy(NULL),
     m_shallow_stress_balance(sb),
     m_modifier(ssb_mod) {
 
@@ -152,6 +165,31 @@ StressBalance::StressBalance(IceGrid::ConstPtr g,
   m_strain_heating.set_attrs("internal",
                              "rate of strain heating in ice (dissipation heating)",
                              "W m-3", "W m-3", "", 0);
+
+  m_strain_rates.metadata(0).set_name("eigen1");
+  m_strain_rates.set_attrs("internal",
+                           "major principal component of horizontal strain-rate",
+                           "second-1", "second-1", "", 0);
+
+  m_strain_rates.metadata(1).set_name("eigen2");
+  m_strain_rates.set_attrs("internal",
+                           "minor principal component of horizontal strain-rate",
+                           "second-1", "second-1", "", 1);
+
+  m_deviatoric_stresses.metadata(0).set_name("sigma_xx");
+  m_deviatoric_stresses.set_attrs("internal",
+                                  "deviatoric stress in x direction",
+                                  "Pa", "Pa", "", 0);
+
+  m_deviatoric_stresses.metadata(1).set_name("sigma_yy");
+  m_deviatoric_stresses.set_attrs("internal",
+                                  "deviatoric stress in y direction",
+                                  "Pa", "Pa", "", 1);
+
+  m_deviatoric_stresses.metadata(2).set_name("sigma_xy");
+  m_deviatoric_stresses.set_attrs("internal",
+                                  "deviatoric shear stress",
+                                  "Pa", "Pa", "", 2);
 }
 
 StressBalance::~StressBalance() {
@@ -181,28 +219,22 @@ void StressBalance::update(const Inputs &inputs, bool full_update) {
     profiling.end("stress_balance.modifier");
 
     if (full_update) {
-      const IceModelVec3 &u = m_modifier->velocity_u();
-      const IceModelVec3 &v = m_modifier->velocity_v();
-
-      profiling.begin("stress_balance.strain_heat");
-      this->compute_volumetric_strain_heating(inputs);
-      profiling.end("stress_balance.strain_heat");
-
-      profiling.begin("stress_balance.vertical_velocity");
-      this->compute_vertical_velocity(inputs.geometry->cell_type,
-                                      u, v, inputs.basal_melt_rate, m_w);
-      profiling.end("stress_balance.vertical_velocity");
-
-      m_cfl_3d = ::pism::max_timestep_cfl_3d(inputs.geometry->ice_thickness,
-                                             inputs.geometry->cell_type,
-                                             m_modifier->velocity_u(),
-                                             m_modifier->velocity_v(),
-                                             m_w);
+      compute_column_top(inputs.geometry->ice_thickness);
+
+      // The vertical velocity and the strain heating are computed when requested (by
+      // energy balance and age models or by diagnostics) and re-used until the next full
+      // update.
+      save_3d_inputs(inputs);
+
+      m_3d_fields_are_stale = true;
     }
 
-    m_cfl_2d = ::pism::max_timestep_cfl_2d(inputs.geometry->ice_thickness,
-                                           inputs.geometry->cell_type,
-                                           m_shallow_stress_balance->velocity());
+    // This is reduced when requested, together with the 3D CFL data if possible (see
+    // update_3d_fields()).
+    m_cfl_2d = ::pism::max_timestep_cfl_2d_local(inputs.geometry->ice_thickness,
+                                                 inputs.geometry->cell_type,
+                                                 m_shallow_stress_balance->velocity());
+    m_cfl_2d_is_local = true;
   }
   catch (RuntimeError &e) {
     e.add_context("updating the stress balance");
@@ -211,10 +243,17 @@ void StressBalance::update(const Inputs &inputs, bool full_update) {
 }
 
 CFLData StressBalance::max_timestep_cfl_2d() const {
+  if (m_cfl_2d_is_local) {
+    reduce_cfl_data(m_grid->com, {&m_cfl_2d});
+    m_cfl_2d_is_local = false;
+  }
+
   return m_cfl_2d;
 }
 
 CFLData StressBalance::max_timestep_cfl_3d() const {
+  update_3d_fields();
+
   return m_cfl_3d;
 }
 
@@ -239,6 +278,8 @@ const IceModelVec3& StressBalance::velocity_v() const {
 }
 
 const IceModelVec3& StressBalance::velocity_w() const {
+  update_3d_fields();
+
   return m_w;
 }
 
@@ -247,179 +288,168 @@ const IceModelVec2S& StressBalance::basal_frictional_heating() const {
 }
 
 const IceModelVec3& StressBalance::volumetric_strain_heating() const {
+  if (m_3d_fields_are_stale and m_enthalpy == NULL) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "cannot compute strain heating: enthalpy is not available");
+  }
+
+  update_3d_fields();
+
   return m_strain_heating;
 }
 
-//! Compute vertical velocity using incompressibility of the ice.
+//! Save inputs of 3D computations performed after a full update.
 /*!
-The vertical velocity \f$w(x,y,z,t)\f$ is the velocity *relative to the
-location of the base of the ice column*.  That is, the vertical velocity
-computed here is identified as \f$\tilde w(x,y,s,t)\f$ in the page
-[]@ref vertchange.
+ * The cell type, the ice thickness and the basal melt rate may change (e.g. during the
+ * mass transport step) before the vertical velocity or the strain heating is requested,
+ * so we keep copies to get the same results as computing these fields right away.
+ *
+ * Enthalpy is not copied: the energy balance model uses the strain heating and therefore
+ * requests it before updating enthalpy.
+ */
+void StressBalance::save_3d_inputs(const Inputs &inputs) {
+  const IceModelVec2S &ice_thickness = inputs.geometry->ice_thickness;
+  const IceModelVec2CellType &cell_type = inputs.geometry->cell_type;
 
-Thus \f$w<0\f$ here means that that
-that part of the ice is getting closer to the base of the ice, and so on.
-The slope of the bed (i.e. relative to the geoid) and/or the motion of the
-bed (i.e. from bed deformation) do not affect the vertical velocity.
+  m_use_basal_melt_rate = inputs.basal_melt_rate != NULL;
+  m_enthalpy            = inputs.enthalpy;
 
-In fact the following statement is exactly true if the basal melt rate is zero:
-the vertical velocity at a point in the ice is positive (negative) if and only
-if the average horizontal divergence of the horizontal velocity, in the portion
-of the ice column below that point, is negative (positive).
-In particular, because \f$z=0\f$ is the location of the base of the ice
-always, the only way to have \f$w(x,y,0,t) \ne 0\f$ is to have a basal melt
-rate.
+  IceModelVec::AccessList list{&ice_thickness, &cell_type, &m_ice_thickness, &m_cell_type};
 
-Incompressibility itself says
-   \f[ \nabla\cdot\mathbf{U} + \frac{\partial w}{\partial z} = 0. \f]
-This is immediately equivalent to the integral
-   \f[ w(x,y,z,t) = - \int_{b(x,y,t)}^{z} \nabla\cdot\mathbf{U}\,d\zeta
-                           + w_b(x,y,t). \f]
-Here the value \f$w_b(x,y,t)\f$ is either zero or the negative of the basal melt rate
-according to the value of the flag `geometry.update.use_basal_melt_rate`.
+  if (m_use_basal_melt_rate) {
+    list.add({inputs.basal_melt_rate, &m_basal_melt_rate});
+  }
 
-The vertical integral is computed by the trapezoid rule.
+  assert(cell_type.stencil_width() >= m_cell_type.stencil_width());
+
+  for (PointsWithGhosts p(*m_grid, m_cell_type.stencil_width()); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    m_cell_type(i, j) = cell_type(i, j);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    m_ice_thickness(i, j) = ice_thickness(i, j);
+
+    if (m_use_basal_melt_rate) {
+      m_basal_melt_rate(i, j) = (*inputs.basal_melt_rate)(i, j);
+    }
+  }
+
+  m_cell_type.inc_state_counter();
+  m_ice_thickness.inc_state_counter();
+  m_basal_melt_rate.inc_state_counter();
+}
+
+//! Compute the vertical velocity, the volumetric strain heating and the 3D CFL time step
+//! restriction, if necessary.
+/*!
+ * The strain heating is computed together with the vertical velocity (in the same sweep)
+ * if enthalpy is available.
+ *
+ * Models using the 3D CFL time step restriction request it before the mass continuity
+ * time step is chosen (using the 2D CFL restriction), so 2D and 3D CFL data are usually
+ * reduced together here.
  */
-void StressBalance::compute_vertical_velocity(const IceModelVec2CellType &mask,
-                                              const IceModelVec3 &u,
-                                              const IceModelVec3 &v,
-                                              const IceModelVec2S *basal_melt_rate,
-                                              IceModelVec3 &result) {
+void StressBalance::update_3d_fields() const {
+  if (not m_3d_fields_are_stale) {
+    return;
+  }
 
-  const bool use_upstream_fd = m_config->get_string("stress_balance.vertical_velocity_approximation") == "upstream";
+  const Profiling &profiling = m_grid->ctx()->profiling();
 
-  IceModelVec::AccessList list{&u, &v, &mask, &result};
+  const IceModelVec3
+    &u = m_modifier->velocity_u(),
+    &v = m_modifier->velocity_v();
 
-  if (basal_melt_rate) {
-    list.add(*basal_melt_rate);
+  profiling.begin("stress_balance.3d_fields");
+  this->compute_3d_fields(m_cell_type, m_ice_thickness, u, v,
+                          m_use_basal_melt_rate ? &m_basal_melt_rate : NULL,
+                          m_enthalpy,
+                          m_w,
+                          m_enthalpy != NULL ? &m_strain_heating : NULL,
+                          &m_cfl_3d);
+  profiling.end("stress_balance.3d_fields");
+
+  // use one reduction for 2D and 3D CFL data
+  if (m_cfl_2d_is_local) {
+    reduce_cfl_data(m_grid->com, {&m_cfl_2d, &m_cfl_3d});
+    m_cfl_2d_is_local = false;
+  } else {
+    reduce_cfl_data(m_grid->com, {&m_cfl_3d});
   }
 
-  const std::vector<double> &z = m_grid->z();
-  const unsigned int Mz = m_grid->Mz();
+  m_w.inc_state_counter();
+  if (m_enthalpy != NULL) {
+    m_strain_heating.inc_state_counter();
+  }
 
-  const double
-    dx = m_grid->dx(),
-    dy = m_grid->dy();
+  m_3d_fields_are_stale = false;
+}
 
-  std::vector<double> u_x_plus_v_y(Mz);
+//! Principal strain rates computed from the sliding velocity.
+/*!
+ * Calving and fracture density models use the same sliding velocity and cell type during
+ * a time step, so this field is computed once and re-used until one of its inputs
+ * changes.
+ *
+ * See compute_2D_principal_strain_rates().
+ */
+const IceModelVec2& StressBalance::principal_strain_rates(const IceModelVec2CellType &cell_type) const {
+  const IceModelVec2V &velocity = m_shallow_stress_balance->velocity();
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  const DependencyTracker::Inputs inputs{&velocity, &cell_type, &m_strain_rates};
 
-    double *w_ij = result.get_column(i,j);
-
-    const double
-      *u_w  = u.get_column(i-1,j),
-      *u_ij = u.get_column(i,j),
-      *u_e  = u.get_column(i+1,j);
-    const double
-      *v_s  = v.get_column(i,j-1),
-      *v_ij = v.get_column(i,j),
-      *v_n  = v.get_column(i,j+1);
-
-    double
-      west  = 1.0,
-      east  = 1.0,
-      south = 1.0,
-      north = 1.0;
-    double
-      D_x = 0,                  // 1/(dx), 1/(2dx), or 0
-      D_y = 0;                  // 1/(dy), 1/(2dy), or 0
-
-    // Switch between second-order centered differences in the interior and
-    // first-order one-sided differences at ice margins.
-
-    // x-derivative
-    {
-      // use basal velocity to determine FD direction ("upwind" when it's clear, centered when it's
-      // not)
-      if (use_upstream_fd) {
-        const double
-          uw = 0.5 * (u_w[0] + u_ij[0]),
-          ue = 0.5 * (u_ij[0] + u_e[0]);
-
-        if (uw > 0.0 and ue >= 0.0) {
-          west = 1.0;
-          east = 0.0;
-        } else if (uw <= 0.0 and ue < 0.0) {
-          west = 0.0;
-          east = 1.0;
-        } else {
-          west = 1.0;
-          east = 1.0;
-        }
-      }
+  if (m_strain_rates_inputs.changed(inputs)) {
+    compute_2D_principal_strain_rates(velocity, cell_type, m_strain_rates);
+    m_strain_rates.inc_state_counter();
 
-      if ((mask.icy(i,j) and mask.ice_free(i+1,j)) or (mask.ice_free(i,j) and mask.icy(i+1,j))) {
-        east = 0;
-      }
-      if ((mask.icy(i,j) and mask.ice_free(i-1,j)) or (mask.ice_free(i,j) and mask.icy(i-1,j))) {
-        west = 0;
-      }
+    m_strain_rates_inputs.record(inputs);
+  }
 
-      if (east + west > 0) {
-        D_x = 1.0 / (dx * (east + west));
-      } else {
-        D_x = 0.0;
-      }
-    }
+  return m_strain_rates;
+}
 
-    // y-derivative
-    {
-      // use basal velocity to determine FD direction ("upwind" when it's clear, centered when it's
-      // not)
-      if (use_upstream_fd) {
-        const double
-          vs = 0.5 * (v_s[0] + v_ij[0]),
-          vn = 0.5 * (v_ij[0] + v_n[0]);
-
-        if (vs > 0.0 and vn >= 0.0) {
-          south = 1.0;
-          north = 0.0;
-        } else if (vs <= 0.0 and vn < 0.0) {
-          south = 0.0;
-          north = 1.0;
-        } else {
-          south = 1.0;
-          north = 1.0;
-        }
-      }
+//! Deviatoric stresses computed from the sliding velocity.
+/*!
+ * Re-computed only if the sliding velocity, `cell_type` or `hardness` changed.
+ *
+ * See compute_2D_stresses().
+ */
+const IceModelVec2& StressBalance::deviatoric_stresses(const IceModelVec2CellType &cell_type,
+                                                       const IceModelVec2S &hardness) const {
+  const IceModelVec2V &velocity = m_shallow_stress_balance->velocity();
 
-      if ((mask.icy(i,j) and mask.ice_free(i,j+1)) or (mask.ice_free(i,j) and mask.icy(i,j+1))) {
-        north = 0;
-      }
-      if ((mask.icy(i,j) and mask.ice_free(i,j-1)) or (mask.ice_free(i,j) and mask.icy(i,j-1))) {
-        south = 0;
-      }
+  const DependencyTracker::Inputs inputs{&velocity, &cell_type, &hardness,
+      &m_deviatoric_stresses};
 
-      if (north + south > 0) {
-        D_y = 1.0 / (dy * (north + south));
-      } else {
-        D_y = 0.0;
-      }
-    }
+  if (m_deviatoric_stresses_inputs.changed(inputs)) {
+    compute_2D_stresses(*m_shallow_stress_balance->flow_law(),
+                        velocity, hardness, cell_type, m_deviatoric_stresses);
+    m_deviatoric_stresses.inc_state_counter();
 
-    // compute u_x + v_y using a vectorizable loop
-    for (unsigned int k = 0; k < Mz; ++k) {
-      double
-        u_x = D_x * (west  * (u_ij[k] - u_w[k]) + east  * (u_e[k] - u_ij[k])),
-        v_y = D_y * (south * (v_ij[k] - v_s[k]) + north * (v_n[k] - v_ij[k]));
-      u_x_plus_v_y[k] = u_x + v_y;
-    }
+    m_deviatoric_stresses_inputs.record(inputs);
+  }
 
-    // at the base: include the basal melt rate
-    if (basal_melt_rate != NULL) {
-      w_ij[0] = - (*basal_melt_rate)(i,j);
-    } else {
-      w_ij[0] = 0.0;
-    }
+  return m_deviatoric_stresses;
+}
+
+//! Compute the index of the highest vertical level below the ice surface in each column.
+/*!
+ * Computed once per full update so that 3D computations can skip the part of each column
+ * above the ice surface without calling IceGrid::kBelowHeight() repeatedly.
+ */
+void StressBalance::compute_column_top(const IceModelVec2S &ice_thickness) {
+  IceModelVec::AccessList list{&ice_thickness, &m_column_top};
 
-    // within the ice and above:
-    for (unsigned int k = 1; k < Mz; ++k) {
-      const double dz = z[k] - z[k-1];
+  assert(ice_thickness.stencil_width() >= m_column_top.stencil_width());
 
-      w_ij[k] = w_ij[k - 1] - (0.5 * dz) * (u_x_plus_v_y[k] + u_x_plus_v_y[k - 1]);
-    }
+  for (PointsWithGhosts p(*m_grid, m_column_top.stencil_width()); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    m_column_top(i, j) = m_grid->kBelowHeight(ice_thickness(i, j));
   }
 }
 
@@ -436,7 +466,7 @@ void StressBalance::compute_vertical_velocity(const IceModelVec2CellType &mask,
  *
  * (note the use of the summation convention). Here \f$D_{ij}\f$ is the
  * strain rate tensor. See
- * StressBalance::compute_volumetric_strain_heating() for details.
+ * StressBalance::compute_3d_fields() for details.
  *
  * @param u_x,u_y,u_z partial derivatives of \f$u\f$, the x-component of the ice velocity
  * @param v_x,v_y,v_z partial derivatives of \f$v\f$, the y-component of the ice velocity
@@ -447,77 +477,119 @@ static inline double D2(double u_x, double u_y, double u_z, double v_x, double v
   return 0.5 * (PetscSqr(u_x + v_y) + u_x*u_x + v_y*v_y + 0.5 * (PetscSqr(u_y + v_x) + u_z*u_z + v_z*v_z));
 }
 
-/**
-  \brief Computes the volumetric strain heating using horizontal
-  velocity.
+//! Compute the vertical velocity and (optionally) the volumetric strain heating.
+/*!
+Both fields use horizontal derivatives of the same columns of `u` and `v`, so they are
+computed in one sweep over the grid: each column is read once and processed while it is
+still in cache.
+
+The strain heating is computed if `strain_heating` is not NULL; this requires `enthalpy`.
+
+If `cfl` is not NULL this also computes maximum velocity components within the ice and
+the 3D CFL time step restriction (see max_timestep_cfl_3d()) for the sub-domain owned by
+this rank. Use reduce_cfl_data() to get global values.
+
+### Vertical velocity
+
+The vertical velocity \f$w(x,y,z,t)\f$ is the velocity *relative to the
+location of the base of the ice column*.  That is, the vertical velocity
+computed here is identified as \f$\tilde w(x,y,s,t)\f$ in the page
+[]@ref vertchange.
+
+Thus \f$w<0\f$ here means that that
+that part of the ice is getting closer to the base of the ice, and so on.
+The slope of the bed (i.e. relative to the geoid) and/or the motion of the
+bed (i.e. from bed deformation) do not affect the vertical velocity.
+
+In fact the following statement is exactly true if the basal melt rate is zero:
+the vertical velocity at a point in the ice is positive (negative) if and only
+if the average horizontal divergence of the horizontal velocity, in the portion
+of the ice column below that point, is negative (positive).
+In particular, because \f$z=0\f$ is the location of the base of the ice
+always, the only way to have \f$w(x,y,0,t) \ne 0\f$ is to have a basal melt
+rate.
+
+Incompressibility itself says
+   \f[ \nabla\cdot\mathbf{U} + \frac{\partial w}{\partial z} = 0. \f]
+This is immediately equivalent to the integral
+   \f[ w(x,y,z,t) = - \int_{b(x,y,t)}^{z} \nabla\cdot\mathbf{U}\,d\zeta
+                           + w_b(x,y,t). \f]
+Here the value \f$w_b(x,y,t)\f$ is either zero or the negative of the basal melt rate
+according to the value of the flag `geometry.update.use_basal_melt_rate`.
 
-  Following the notation used in [\ref BBssasliding], let \f$u\f$ be a
-  three-dimensional *vector* velocity field. Then the strain rate
-  tensor \f$D_{ij}\f$ is defined by
+The vertical integral is computed by the trapezoid rule.
+
+### Volumetric strain heating
 
-  \f[ D_{ij} = \frac 12 \left(\diff{u_{i}}{x_{j}} + \diff{u_{j}}{x_{i}} \right), \f]
+Following the notation used in [\ref BBssasliding], let \f$u\f$ be a
+three-dimensional *vector* velocity field. Then the strain rate
+tensor \f$D_{ij}\f$ is defined by
 
-  Where \f$i\f$ and \f$j\f$ range from \f$1\f$ to \f$3\f$.
+\f[ D_{ij} = \frac 12 \left(\diff{u_{i}}{x_{j}} + \diff{u_{j}}{x_{i}} \right), \f]
 
-  The flow law in the viscosity form states
+Where \f$i\f$ and \f$j\f$ range from \f$1\f$ to \f$3\f$.
 
-  \f[ \tau_{ij} = 2 \eta D_{ij}, \f]
+The flow law in the viscosity form states
 
-  and the nonlinear ice viscosity satisfies
+\f[ \tau_{ij} = 2 \eta D_{ij}, \f]
 
-  \f[ 2 \eta = B(T) D^{(1/n) - 1}. \f]
+and the nonlinear ice viscosity satisfies
 
-  Here \f$D^{2}\f$ is defined by \f$2D^{2} = D_{ij}D_{ij}\f$ (using the
-  summation convention) and \f$B(T) = A(T)^{-1/n}\f$ is the ice hardness.
+\f[ 2 \eta = B(T) D^{(1/n) - 1}. \f]
 
-  Now the volumetric strain heating is
+Here \f$D^{2}\f$ is defined by \f$2D^{2} = D_{ij}D_{ij}\f$ (using the
+summation convention) and \f$B(T) = A(T)^{-1/n}\f$ is the ice hardness.
 
-  \f[ \Sigma = \sum_{i,j=1}^{3}D_{ij}\tau_{ij} = 2 B(T) D^{(1/n) + 1}. \f]
+Now the volumetric strain heating is
 
-  We use an *approximation* of \f$D_{ij}\f$ common in shallow ice models:
+\f[ \Sigma = \sum_{i,j=1}^{3}D_{ij}\tau_{ij} = 2 B(T) D^{(1/n) + 1}. \f]
 
-  - we assume that horizontal derivatives of the vertical velocity are
-    much smaller than \f$z\f$ derivatives horizontal velocity
-    components \f$u\f$ and \f$v\f$. (We drop \f$w_x\f$ and \f$w_y\f$
-    terms in \f$D_{ij}\f$.)
+We use an *approximation* of \f$D_{ij}\f$ common in shallow ice models:
 
-  - we use the incompressibility of ice to approximate \f$w_z\f$:
+- we assume that horizontal derivatives of the vertical velocity are
+  much smaller than \f$z\f$ derivatives horizontal velocity
+  components \f$u\f$ and \f$v\f$. (We drop \f$w_x\f$ and \f$w_y\f$
+  terms in \f$D_{ij}\f$.)
 
-  \f[ w_z = - (u_x + v_y). \f]
+- we use the incompressibility of ice to approximate \f$w_z\f$:
 
-  Requires ghosts of `u` and `v` velocity components and uses the fact
-  that `u` and `v` above the ice are filled using constant
-  extrapolation.
+\f[ w_z = - (u_x + v_y). \f]
 
-  Resulting field does not have ghosts.
+Requires ghosts of `u` and `v` velocity components and uses the fact
+that `u` and `v` above the ice are filled using constant
+extrapolation.
 
-  Below is the *Maxima* code that produces the expression evaluated by D2().
+Resulting field does not have ghosts.
 
-       derivabbrev : true;
-       U : [u, v, w]; X : [x, y, z]; depends(U, X);
-       gradef(w, x, 0); gradef(w, y, 0);
-       gradef(w, z, -(diff(u, x) + diff(v, y)));
-       d[i,j] := 1/2 * (diff(U[i], X[j]) + diff(U[j], X[i]));
-       D : genmatrix(d, 3, 3), ratsimp, factor;
-       tex('D = D);
-       tex('D^2 = 1/2 * mat_trace(D . D));
+Below is the *Maxima* code that produces the expression evaluated by D2().
 
-  @return 0 on success
+     derivabbrev : true;
+     U : [u, v, w]; X : [x, y, z]; depends(U, X);
+     gradef(w, x, 0); gradef(w, y, 0);
+     gradef(w, z, -(diff(u, x) + diff(v, y)));
+     d[i,j] := 1/2 * (diff(U[i], X[j]) + diff(U[j], X[i]));
+     D : genmatrix(d, 3, 3), ratsimp, factor;
+     tex('D = D);
+     tex('D^2 = 1/2 * mat_trace(D . D));
  */
-void StressBalance::compute_volumetric_strain_heating(const Inputs &inputs) {
-  PetscErrorCode ierr;
+void StressBalance::compute_3d_fields(const IceModelVec2CellType &mask,
+                                      const IceModelVec2S &thickness,
+                                      const IceModelVec3 &u,
+                                      const IceModelVec3 &v,
+                                      const IceModelVec2S *basal_melt_rate,
+                                      const IceModelVec3 *enthalpy,
+                                      IceModelVec3 &w,
+                                      IceModelVec3 *strain_heating,
+                                      CFLData *cfl) const {
 
-  const rheology::FlowLaw &flow_law = *m_shallow_stress_balance->flow_law();
-  EnthalpyConverter::Ptr EC = m_shallow_stress_balance->enthalpy_converter();
+  const bool use_upstream_fd = m_config->get_string("stress_balance.vertical_velocity_approximation") == "upstream";
 
-  const IceModelVec3
-    &u = m_modifier->velocity_u(),
-    &v = m_modifier->velocity_v();
+  const bool compute_strain_heating = strain_heating != NULL;
 
-  const IceModelVec2S &thickness = inputs.geometry->ice_thickness;
-  const IceModelVec3  *enthalpy  = inputs.enthalpy;
+  assert(enthalpy != NULL or not compute_strain_heating);
 
-  const IceModelVec2CellType &mask = inputs.geometry->cell_type;
+  const rheology::FlowLaw &flow_law = *m_shallow_stress_balance->flow_law();
+  EnthalpyConverter::Ptr EC = m_shallow_stress_balance->enthalpy_converter();
 
   double
     enhancement_factor = flow_law.enhancement_factor(),
@@ -525,47 +597,68 @@ void StressBalance::compute_volumetric_strain_heating(const Inputs &inputs) {
     exponent = 0.5 * (1.0 / n + 1.0),
     e_to_a_power = pow(enhancement_factor,-1.0/n);
 
-  IceModelVec::AccessList list{&mask, enthalpy, &m_strain_heating, &thickness, &u, &v};
+  IceModelVec::AccessList list{&mask, &thickness, &u, &v, &w, &m_column_top};
+
+  if (basal_melt_rate) {
+    list.add(*basal_melt_rate);
+  }
+
+  if (compute_strain_heating) {
+    list.add({enthalpy, strain_heating});
+  }
 
   const std::vector<double> &z = m_grid->z();
   const unsigned int Mz = m_grid->Mz();
-  std::vector<double> depth(Mz), pressure(Mz), hardness(Mz);
+
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy();
+
+  // maximum velocity components and the CFL time step restriction
+  const bool compute_cfl = cfl != NULL;
+  double
+    u_max  = 0.0,
+    v_max  = 0.0,
+    w_max  = 0.0,
+    dt_max = m_config->get_number("time_stepping.maximum_time_step", "seconds");
 
   ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      double H = thickness(i, j);
-      int ks = m_grid->kBelowHeight(H);
-      const double
-        *u_ij, *u_w, *u_n, *u_e, *u_s,
-        *v_ij, *v_w, *v_n, *v_e, *v_s;
-      double *Sigma;
-      const double *E_ij;
-
-      double west = 1, east = 1, south = 1, north = 1,
-        D_x = 0,                // 1/(dx), 1/(2dx), or 0
-        D_y = 0;                // 1/(dy), 1/(2dy), or 0
-
-      // x-derivative
-      {
+#pragma omp parallel reduction(max: u_max, v_max, w_max) reduction(min: dt_max)
+  {
+    // work space (private to each thread)
+    std::vector<double> depth(Mz), pressure(Mz), hardness(Mz), u_x_plus_v_y(Mz);
+
+    try {
+      for (ThreadPoints p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        const double
+          *u_ij = u.get_column(i,     j),
+          *u_w  = u.get_column(i - 1, j),
+          *u_e  = u.get_column(i + 1, j),
+          *u_s  = u.get_column(i,     j - 1),
+          *u_n  = u.get_column(i,     j + 1);
+        const double
+          *v_ij = v.get_column(i,     j),
+          *v_w  = v.get_column(i - 1, j),
+          *v_e  = v.get_column(i + 1, j),
+          *v_s  = v.get_column(i,     j - 1),
+          *v_n  = v.get_column(i,     j + 1);
+
+        // Switch between second-order centered differences in the interior and
+        // first-order one-sided differences at ice margins.
+        double
+          west  = 1.0,
+          east  = 1.0,
+          south = 1.0,
+          north = 1.0;
+
         if ((mask.icy(i,j) and mask.ice_free(i+1,j)) or (mask.ice_free(i,j) and mask.icy(i+1,j))) {
           east = 0;
         }
         if ((mask.icy(i,j) and mask.ice_free(i-1,j)) or (mask.ice_free(i,j) and mask.icy(i-1,j))) {
           west = 0;
         }
-
-        if (east + west > 0) {
-          D_x = 1.0 / (m_grid->dx() * (east + west));
-        } else {
-          D_x = 0.0;
-        }
-      }
-
-      // y-derivative
-      {
         if ((mask.icy(i,j) and mask.ice_free(i,j+1)) or (mask.ice_free(i,j) and mask.icy(i,j+1))) {
           north = 0;
         }
@@ -573,72 +666,165 @@ void StressBalance::compute_volumetric_strain_heating(const Inputs &inputs) {
           south = 0;
         }
 
-        if (north + south > 0) {
-          D_y = 1.0 / (m_grid->dy() * (north + south));
-        } else {
-          D_y = 0.0;
+        const double
+          D_x = east + west > 0 ? 1.0 / (dx * (east + west)) : 0.0,     // 1/(dx), 1/(2dx), or 0
+          D_y = north + south > 0 ? 1.0 / (dy * (north + south)) : 0.0; // 1/(dy), 1/(2dy), or 0
+
+        const int ks = m_column_top.as_int(i, j);
+
+        if (compute_strain_heating) {
+          const double *E_ij = enthalpy->get_column(i, j);
+          double *Sigma = strain_heating->get_column(i, j);
+
+          const double H = thickness(i, j);
+
+          for (int k = 0; k <= ks; ++k) {
+            depth[k] = H - z[k];
+          }
+
+          // pressure added by the ice (i.e. pressure difference between the
+          // current level and the top of the column)
+          EC->pressure(depth, ks, pressure); // FIXME issue #15
+
+          flow_law.hardness_n(E_ij, &pressure[0], ks + 1, &hardness[0]);
+
+          for (int k = 0; k <= ks; ++k) {
+            double dz;
+
+            double u_z = 0.0, v_z = 0.0,
+              u_x = D_x * (west  * (u_ij[k] - u_w[k]) + east  * (u_e[k] - u_ij[k])),
+              u_y = D_y * (south * (u_ij[k] - u_s[k]) + north * (u_n[k] - u_ij[k])),
+              v_x = D_x * (west  * (v_ij[k] - v_w[k]) + east  * (v_e[k] - v_ij[k])),
+              v_y = D_y * (south * (v_ij[k] - v_s[k]) + north * (v_n[k] - v_ij[k]));
+
+            if (k > 0) {
+              dz = z[k+1] - z[k-1];
+              u_z = (u_ij[k+1] - u_ij[k-1]) / dz;
+              v_z = (v_ij[k+1] - v_ij[k-1]) / dz;
+            } else {
+              // use one-sided differences for u_z and v_z on the bottom level
+              dz = z[1] - z[0];
+              u_z = (u_ij[1] - u_ij[0]) / dz;
+              v_z = (v_ij[1] - v_ij[0]) / dz;
+            }
+
+            Sigma[k] = 2.0 * e_to_a_power * hardness[k] * pow(D2(u_x, u_y, u_z, v_x, v_y, v_z), exponent);
+          } // k-loop
+
+          int remaining_levels = Mz - (ks + 1);
+          if (remaining_levels > 0) {
+            PetscErrorCode ierr = PetscMemzero(&Sigma[ks+1],
+                                               remaining_levels*sizeof(double));
+            PISM_CHK(ierr, "PetscMemzero");
+          }
         }
-      }
-
-      u_ij = u.get_column(i,     j);
-      u_w  = u.get_column(i - 1, j);
-      u_e  = u.get_column(i + 1, j);
-      u_s  = u.get_column(i,     j - 1);
-      u_n  = u.get_column(i,     j + 1);
 
-      v_ij = v.get_column(i,     j);
-      v_w  = v.get_column(i - 1, j);
-      v_e  = v.get_column(i + 1, j);
-      v_s  = v.get_column(i,     j - 1);
-      v_n  = v.get_column(i,     j + 1);
-
-      E_ij = enthalpy->get_column(i, j);
-      Sigma = m_strain_heating.get_column(i, j);
-
-      for (int k = 0; k <= ks; ++k) {
-        depth[k] = H - z[k];
-      }
-
-      // pressure added by the ice (i.e. pressure difference between the
-      // current level and the top of the column)
-      EC->pressure(depth, ks, pressure); // FIXME issue #15
-
-      flow_law.hardness_n(E_ij, &pressure[0], ks + 1, &hardness[0]);
-
-      for (int k = 0; k <= ks; ++k) {
-        double dz;
-
-        double u_z = 0.0, v_z = 0.0,
-          u_x = D_x * (west  * (u_ij[k] - u_w[k]) + east  * (u_e[k] - u_ij[k])),
-          u_y = D_y * (south * (u_ij[k] - u_s[k]) + north * (u_n[k] - u_ij[k])),
-          v_x = D_x * (west  * (v_ij[k] - v_w[k]) + east  * (v_e[k] - v_ij[k])),
-          v_y = D_y * (south * (v_ij[k] - v_s[k]) + north * (v_n[k] - v_ij[k]));
-
-        if (k > 0) {
-          dz = z[k+1] - z[k-1];
-          u_z = (u_ij[k+1] - u_ij[k-1]) / dz;
-          v_z = (v_ij[k+1] - v_ij[k-1]) / dz;
-        } else {
-          // use one-sided differences for u_z and v_z on the bottom level
-          dz = z[1] - z[0];
-          u_z = (u_ij[1] - u_ij[0]) / dz;
-          v_z = (v_ij[1] - v_ij[0]) / dz;
+        // vertical velocity
+        {
+          double
+            w_west  = west,
+            w_east  = east,
+            w_south = south,
+            w_north = north,
+            w_D_x   = D_x,
+            w_D_y   = D_y;
+
+          // use basal velocity to determine FD direction ("upwind" when it's clear, centered
+          // when it's not)
+          if (use_upstream_fd) {
+            const double
+              uw = 0.5 * (u_w[0] + u_ij[0]),
+              ue = 0.5 * (u_ij[0] + u_e[0]),
+              vs = 0.5 * (v_s[0] + v_ij[0]),
+              vn = 0.5 * (v_ij[0] + v_n[0]);
+
+            if (uw > 0.0 and ue >= 0.0) {
+              w_east = 0.0;
+            } else if (uw <= 0.0 and ue < 0.0) {
+              w_west = 0.0;
+            }
+
+            if (vs > 0.0 and vn >= 0.0) {
+              w_north = 0.0;
+            } else if (vs <= 0.0 and vn < 0.0) {
+              w_south = 0.0;
+            }
+
+            w_D_x = w_east + w_west > 0 ? 1.0 / (dx * (w_east + w_west)) : 0.0;
+            w_D_y = w_north + w_south > 0 ? 1.0 / (dy * (w_north + w_south)) : 0.0;
+          }
+
+          double *w_ij = w.get_column(i, j);
+
+          // Values of w above the ice surface are not physically meaningful, so we compute w
+          // up to k_top and extend it as a constant above that level. k_top includes two
+          // levels above the surface in this column and its neighbors: they are used to
+          // interpolate w to the fine vertical grid in the energy and age models (see
+          // ColumnInterpolation).
+          unsigned int k_top = 0;
+          {
+            auto kn = m_column_top.int_star(i, j);
+            int kn_max = std::max(std::max(kn.ij, std::max(kn.e, kn.w)), std::max(kn.n, kn.s));
+            k_top = std::min((unsigned int)kn_max + 2, Mz - 1);
+          }
+
+          // compute u_x + v_y using a vectorizable loop
+          for (unsigned int k = 0; k <= k_top; ++k) {
+            double
+              u_x = w_D_x * (w_west  * (u_ij[k] - u_w[k]) + w_east  * (u_e[k] - u_ij[k])),
+              v_y = w_D_y * (w_south * (v_ij[k] - v_s[k]) + w_north * (v_n[k] - v_ij[k]));
+            u_x_plus_v_y[k] = u_x + v_y;
+          }
+
+          // at the base: include the basal melt rate
+          if (basal_melt_rate != NULL) {
+            w_ij[0] = - (*basal_melt_rate)(i,j);
+          } else {
+            w_ij[0] = 0.0;
+          }
+
+          // within the ice:
+          for (unsigned int k = 1; k <= k_top; ++k) {
+            const double dz = z[k] - z[k-1];
+
+            w_ij[k] = w_ij[k - 1] - (0.5 * dz) * (u_x_plus_v_y[k] + u_x_plus_v_y[k - 1]);
+          }
+
+          // above the ice:
+          for (unsigned int k = k_top + 1; k < Mz; ++k) {
+            w_ij[k] = w_ij[k_top];
+          }
+
+          // CFL (only velocities within the ice)
+          if (compute_cfl and mask.icy(i, j)) {
+            for (int k = 0; k <= ks; ++k) {
+              const double
+                u_abs = fabs(u_ij[k]),
+                v_abs = fabs(v_ij[k]);
+              u_max = std::max(u_max, u_abs);
+              v_max = std::max(v_max, v_abs);
+              w_max = std::max(w_max, fabs(w_ij[k]));
+
+              const double denom = u_abs / dx + v_abs / dy;
+              if (denom > 0.0) {
+                dt_max = std::min(dt_max, 1.0 / denom);
+              }
+            }
+          }
         }
-
-        Sigma[k] = 2.0 * e_to_a_power * hardness[k] * pow(D2(u_x, u_y, u_z, v_x, v_y, v_z), exponent);
-      } // k-loop
-
-      int remaining_levels = Mz - (ks + 1);
-      if (remaining_levels > 0) {
-        ierr = PetscMemzero(&Sigma[ks+1],
-                            remaining_levels*sizeof(double));
-        PISM_CHK(ierr, "PetscMemzero");
       }
+    } catch (...) {
+      loop.failed();
     }
-  } catch (...) {
-    loop.failed();
   }
   loop.check();
+
+  if (compute_cfl) {
+    cfl->u_max  = u_max;
+    cfl->v_max  = v_max;
+    cfl->w_max  = w_max;
+    cfl->dt_max = MaxTimestep(dt_max);
+  }
 }
 
 std::string StressBalance::stdout_report() const {
@@ -21,11 +21,12 @@
 
 #include "pism/util/Component.hh"     // derives from Component
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/DependencyTracker.hh"
 #include "pism/stressbalance/timestepping.hh"
 
 namespace pism {
 
-class IceModelVec2CellType;
 class Geometry;
 
 namespace rheology {
@@ -86,6 +87,11 @@ public:
 
   //! \brief Update all the fields if (full_update), only update diffusive flux
   //! and max. diffusivity otherwise.
+  /*!
+   * The vertical velocity, the volumetric strain heating and the 3D CFL time step
+   * restriction are computed on demand after a full update (see velocity_w(),
+   * volumetric_strain_heating() and max_timestep_cfl_3d()).
+   */
   void update(const Inputs &inputs, bool full_update);
 
   //! \brief Get the thickness-advective (SSA) 2D velocity.
@@ -112,6 +118,15 @@ public:
 
   const IceModelVec3& volumetric_strain_heating() const;
 
+  // for calving and fracture density models:
+
+  //! \brief Get principal strain rates corresponding to the sliding velocity.
+  const IceModelVec2& principal_strain_rates(const IceModelVec2CellType &cell_type) const;
+
+  //! \brief Get deviatoric stresses corresponding to the sliding velocity.
+  const IceModelVec2& deviatoric_stresses(const IceModelVec2CellType &cell_type,
+                                          const IceModelVec2S &hardness) const;
+
   //! \brief Produce a report string for the standard output.
   std::string stdout_report() const;
 
@@ -127,16 +142,46 @@ protected:
   virtual void define_model_state_impl(const File &output) const;
   virtual void write_model_state_impl(const File &output) const;
 
-  virtual void compute_vertical_velocity(const IceModelVec2CellType &mask,
-                                         const IceModelVec3 &u,
-                                         const IceModelVec3 &v,
-                                         const IceModelVec2S *bmr,
-                                         IceModelVec3 &result);
-  virtual void compute_volumetric_strain_heating(const Inputs &inputs);
-
-  CFLData m_cfl_2d, m_cfl_3d;
-
-  IceModelVec3 m_w, m_strain_heating;
+  virtual void compute_3d_fields(const IceModelVec2CellType &mask,
+                                 const IceModelVec2S &thickness,
+                                 const IceModelVec3 &u,
+                                 const IceModelVec3 &v,
+                                 const IceModelVec2S *basal_melt_rate,
+                                 const IceModelVec3 *enthalpy,
+                                 IceModelVec3 &w,
+                                 IceModelVec3 *strain_heating,
+                                 CFLData *cfl) const;
+
+  void compute_column_top(const IceModelVec2S &ice_thickness);
+
+  void save_3d_inputs(const Inputs &inputs);
+  void update_3d_fields() const;
+
+  mutable CFLData m_cfl_2d;
+  mutable CFLData m_cfl_3d;
+  //! true if m_cfl_2d contains values for the sub-domain owned by this rank
+  mutable bool m_cfl_2d_is_local;
+
+  mutable IceModelVec3 m_w, m_strain_heating;
+
+  //! true if m_w, m_strain_heating and m_cfl_3d have to be re-computed before use
+  mutable bool m_3d_fields_are_stale;
+
+  //! copies of inputs of 3D computations, saved during the last full update (the geometry
+  //! may change before 3D fields are requested)
+  IceModelVec2CellType m_cell_type;
+  IceModelVec2S m_ice_thickness, m_basal_melt_rate;
+  bool m_use_basal_melt_rate;
+  const IceModelVec3 *m_enthalpy;
+
+  //! index of the highest vertical level below the ice surface in each column (see
+  //! IceGrid::kBelowHeight()); updated once per full update and used in 3D computations
+  IceModelVec2Int m_column_top;
+
+  //! principal strain rates and deviatoric stresses (computed on demand, re-computed only
+  //! if the sliding velocity or other inputs changed)
+  mutable IceModelVec2 m_strain_rates, m_deviatoric_stresses;
+  mutable DependencyTracker m_strain_rates_inputs, m_deviatoric_stresses_inputs;
 
   ShallowStressBalance *m_shallow_stress_balance;
   SSB_Modifier *m_modifier;
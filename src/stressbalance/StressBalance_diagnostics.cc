@@ -96,14 +96,15 @@ IceModelVec::Ptr PSB_velbar::compute_impl() const {
   // get the thickness
   const IceModelVec2S* thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
 
-  // Compute the vertically-integrated horizontal ice flux:
-  IceModelVec2V::Ptr result = IceModelVec2V::ToVector(PSB_flux(model).compute());
+  // Compute the vertically-integrated horizontal ice flux (may be shared with other
+  // diagnostics, so it is not modified here):
+  IceModelVec2V::Ptr flux = IceModelVec2V::ToVector(PSB_flux(model).compute());
 
-  // Override metadata set by the flux computation
+  IceModelVec2V::Ptr result = m_pool->vector("bar");
   result->metadata(0) = m_vars[0];
   result->metadata(1) = m_vars[1];
 
-  IceModelVec::AccessList list{thickness, result.get()};
+  IceModelVec::AccessList list{thickness, flux.get(), result.get()};
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
@@ -112,7 +113,7 @@ IceModelVec::Ptr PSB_velbar::compute_impl() const {
     // Ice flux is masked already, but we need to check for division
     // by zero anyway.
     if (thk > 0.0) {
-      (*result)(i,j) /= thk;
+      (*result)(i,j) = (*flux)(i,j) / thk;
     } else {
       (*result)(i,j) = 0.0;
     }
@@ -136,7 +137,7 @@ PSB_velbar_mag::PSB_velbar_mag(const StressBalance *m)
 
 IceModelVec::Ptr PSB_velbar_mag::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "velbar_mag", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("velbar_mag");
   result->metadata(0) = m_vars[0];
 
   // compute vertically-averaged horizontal velocity:
@@ -172,7 +173,7 @@ PSB_flux::PSB_flux(const StressBalance *m)
 IceModelVec::Ptr PSB_flux::compute_impl() const {
   double H_threshold = m_config->get_number("geometry.ice_free_thickness_standard");
 
-  IceModelVec2V::Ptr result(new IceModelVec2V(m_grid, "flux", WITHOUT_GHOSTS));
+  IceModelVec2V::Ptr result = m_pool->vector("flux");
   result->metadata(0) = m_vars[0];
   result->metadata(1) = m_vars[1];
 
@@ -254,15 +255,18 @@ PSB_flux_mag::PSB_flux_mag(const StressBalance *m)
 IceModelVec::Ptr PSB_flux_mag::compute_impl() const {
   const IceModelVec2S *thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
 
-  // Compute the vertically-averaged horizontal ice velocity:
-  IceModelVec2S::Ptr result = IceModelVec2S::To2DScalar(PSB_velbar_mag(model).compute());
+  // Compute the vertically-averaged horizontal ice velocity (may be shared with other
+  // diagnostics, so it is not modified here):
+  IceModelVec2S::Ptr velbar_mag = IceModelVec2S::To2DScalar(PSB_velbar_mag(model).compute());
 
-  IceModelVec::AccessList list{thickness, result.get()};
+  IceModelVec2S::Ptr result = m_pool->scalar("flux_mag");
+
+  IceModelVec::AccessList list{thickness, velbar_mag.get(), result.get()};
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    (*result)(i,j) *= (*thickness)(i,j);
+    (*result)(i,j) = (*velbar_mag)(i,j) * (*thickness)(i,j);
   }
 
   result->mask_by(*thickness, to_internal(m_fill_value));
@@ -286,7 +290,7 @@ PSB_velbase_mag::PSB_velbase_mag(const StressBalance *m)
 }
 
 IceModelVec::Ptr PSB_velbase_mag::compute_impl() const {
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "velbase_mag", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("velbase_mag");
   result->metadata(0) = m_vars[0];
 
   result->set_to_magnitude(*IceModelVec2V::ToVector(PSB_velbase(model).compute()));
@@ -323,7 +327,7 @@ PSB_velsurf_mag::PSB_velsurf_mag(const StressBalance *m)
 IceModelVec::Ptr PSB_velsurf_mag::compute_impl() const {
   double fill_value = to_internal(m_fill_value);
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "velsurf_mag", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("velsurf_mag");
   result->metadata(0) = m_vars[0];
 
   result->set_to_magnitude(*IceModelVec2V::ToVector(PSB_velsurf(model).compute()));
@@ -372,7 +376,7 @@ PSB_velsurf::PSB_velsurf(const StressBalance *m)
 IceModelVec::Ptr PSB_velsurf::compute_impl() const {
   double fill_value = to_internal(m_fill_value);
 
-  IceModelVec2V::Ptr result(new IceModelVec2V(m_grid, "surf", WITHOUT_GHOSTS));
+  IceModelVec2V::Ptr result = m_pool->vector("surf");
   result->metadata(0) = m_vars[0];
   result->metadata(1) = m_vars[1];
 
@@ -421,7 +425,7 @@ PSB_wvel::PSB_wvel(const StressBalance *m)
 }
 
 IceModelVec::Ptr PSB_wvel::compute(bool zero_above_ice) const {
-  IceModelVec3::Ptr result3(new IceModelVec3(m_grid, "wvel", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result3 = m_pool->volume("wvel");
   result3->metadata() = m_vars[0];
 
   const IceModelVec2S *bed, *uplift;
@@ -523,7 +527,7 @@ PSB_wvelsurf::PSB_wvelsurf(const StressBalance *m)
 IceModelVec::Ptr PSB_wvelsurf::compute_impl() const {
   double fill_value = to_internal(m_fill_value);
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "wvelsurf", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("wvelsurf");
   result->metadata() = m_vars[0];
 
   // here "false" means "don't fill w3 above the ice surface with zeros"
@@ -569,7 +573,7 @@ PSB_wvelbase::PSB_wvelbase(const StressBalance *m)
 IceModelVec::Ptr PSB_wvelbase::compute_impl() const {
   double fill_value = to_internal(m_fill_value);
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "wvelbase", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("wvelbase");
   result->metadata() = m_vars[0];
 
   // here "false" means "don't fill w3 above the ice surface with zeros"
@@ -621,7 +625,7 @@ PSB_velbase::PSB_velbase(const StressBalance *m)
 IceModelVec::Ptr PSB_velbase::compute_impl() const {
   double fill_value = to_internal(m_fill_value);
 
-  IceModelVec2V::Ptr result(new IceModelVec2V(m_grid, "base", WITHOUT_GHOSTS));
+  IceModelVec2V::Ptr result = m_pool->vector("base");
   result->metadata(0) = m_vars[0];
   result->metadata(1) = m_vars[1];
 
@@ -666,7 +670,7 @@ PSB_bfrict::PSB_bfrict(const StressBalance *m)
 
 IceModelVec::Ptr PSB_bfrict::compute_impl() const {
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "bfrict", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("bfrict");
   result->metadata() = m_vars[0];
 
   result->copy_from(model->basal_frictional_heating());
@@ -724,7 +728,7 @@ static void zero_above_ice(const IceModelVec3 &F, const IceModelVec2S &H,
 
 IceModelVec::Ptr PSB_uvel::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "uvel", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("uvel");
   result->metadata() = m_vars[0];
 
   zero_above_ice(model->velocity_u(),
@@ -746,7 +750,7 @@ PSB_vvel::PSB_vvel(const StressBalance *m)
 
 IceModelVec::Ptr PSB_vvel::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "vvel", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("vvel");
   result->metadata() = m_vars[0];
 
   zero_above_ice(model->velocity_v(),
@@ -768,7 +772,7 @@ PSB_wvel_rel::PSB_wvel_rel(const StressBalance *m)
 
 IceModelVec::Ptr PSB_wvel_rel::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "wvel_rel", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("wvel_rel");
   result->metadata() = m_vars[0];
 
   zero_above_ice(model->velocity_w(),
@@ -790,7 +794,7 @@ PSB_strainheat::PSB_strainheat(const StressBalance *m)
 }
 
 IceModelVec::Ptr PSB_strainheat::compute_impl() const {
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "strainheat", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("strainheat");
   result->metadata() = m_vars[0];
 
   result->copy_from(model->volumetric_strain_heating());
@@ -879,7 +883,7 @@ PSB_pressure::PSB_pressure(const StressBalance *m)
 
 IceModelVec::Ptr PSB_pressure::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "pressure", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("pressure");
   result->metadata(0) = m_vars[0];
 
   const IceModelVec2S *thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
@@ -933,7 +937,7 @@ PSB_tauxz::PSB_tauxz(const StressBalance *m)
  */
 IceModelVec::Ptr PSB_tauxz::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "tauxz", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("tauxz");
   result->metadata() = m_vars[0];
 
   const IceModelVec2S *thickness, *surface;
@@ -993,7 +997,7 @@ PSB_tauyz::PSB_tauyz(const StressBalance *m)
  */
 IceModelVec::Ptr PSB_tauyz::compute_impl() const {
 
-  IceModelVec3::Ptr result(new IceModelVec3(m_grid, "tauyz", WITHOUT_GHOSTS));
+  IceModelVec3::Ptr result = m_pool->volume("tauyz");
   result->metadata(0) = m_vars[0];
 
   const IceModelVec2S *thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
@@ -1046,7 +1050,7 @@ IceModelVec::Ptr PSB_vonmises_stress::compute_impl() const {
 
   using std::max;
 
-  IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "vonmises_stress", WITHOUT_GHOSTS));
+  IceModelVec2S::Ptr result = m_pool->scalar("vonmises_stress");
   result->metadata(0) = m_vars[0];
 
   IceModelVec2S &vonmises_stress = *result;
@@ -23,6 +23,7 @@
 #include "pism/util/IceGrid.hh"
 #include "pism/util/petscwrappers/Vec.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/GhostExchange.hh"
 
 #include "pism/util/error_handling.hh"
 #include "pism/util/pism_utilities.hh"
@@ -60,13 +61,7 @@ BedSmoother::BedSmoother(IceGrid::ConstPtr g, int MAX_GHOSTS)
                    "polynomial coeff of H^-4, in bed roughness parameterization",
                    "m4", "m4", "", 0);
 
-    // allocate Vecs that live on processor 0:
-    m_topgp0 = m_topgsmooth.allocate_proc0_copy();
-    m_topgsmoothp0 = m_topgsmooth.allocate_proc0_copy();
-    m_maxtlp0 = m_maxtl.allocate_proc0_copy();
-    m_C2p0 = m_C2.allocate_proc0_copy();
-    m_C3p0 = m_C3.allocate_proc0_copy();
-    m_C4p0 = m_C4.allocate_proc0_copy();
+    // Vecs that live on processor 0 are allocated by preprocess_bed() if needed
   }
 
   m_Glen_exponent = m_config->get_number("stress_balance.sia.Glen_exponent"); // choice is SIA; see #285
@@ -139,6 +134,30 @@ void BedSmoother::preprocess_bed(const IceModelVec2S &topg,
   m_Nx = Nx;
   m_Ny = Ny;
 
+  // Use the distributed implementation if all sub-domains are at least as wide as the
+  // smoothing window: PETSc requires this to create a DM with this stencil width.
+  {
+    const int
+      width     = std::max(m_Nx, m_Ny),
+      min_width = static_cast<int>(GlobalMin(m_grid->com,
+                                             std::min(m_grid->xm(), m_grid->ym())));
+
+    if (min_width >= width) {
+      preprocess_bed_distributed(topg);
+      return;
+    }
+  }
+
+  if (not m_topgp0) {
+    // allocate Vecs that live on processor 0:
+    m_topgp0       = m_topgsmooth.allocate_proc0_copy();
+    m_topgsmoothp0 = m_topgsmooth.allocate_proc0_copy();
+    m_maxtlp0      = m_maxtl.allocate_proc0_copy();
+    m_C2p0         = m_C2.allocate_proc0_copy();
+    m_C3p0         = m_C3.allocate_proc0_copy();
+    m_C4p0         = m_C4.allocate_proc0_copy();
+  }
+
   topg.put_on_proc0(*m_topgp0);
   smooth_the_bed_on_proc0();
   // next call *does indeed* fill ghosts in topgsmooth
@@ -153,6 +172,106 @@ void BedSmoother::preprocess_bed(const IceModelVec2S &topg,
 }
 
 
+//! Computes the smoothed bed and coefficients without gathering the bed on processor 0.
+/*!
+ * Each rank gets bed elevation values in a halo as wide as the smoothing window and
+ * computes the smoothed bed and coefficients at grid points it owns. Arithmetic is the
+ * same as in smooth_the_bed_on_proc0() and compute_coefficients_on_proc0(), so results
+ * do not depend on the implementation used.
+ *
+ * Requires sub-domains that are at least max(Nx, Ny) grid points wide.
+ */
+void BedSmoother::preprocess_bed_distributed(const IceModelVec2S &topg) {
+  PetscErrorCode ierr;
+
+  const int
+    Mx    = (int)m_grid->Mx(),
+    My    = (int)m_grid->My(),
+    width = std::max(m_Nx, m_Ny);
+
+  // a copy of the bed elevation with ghosts as wide as the smoothing window
+  petsc::DM::Ptr da = m_grid->get_dm(1, width);
+
+  petsc::Vec topg_local;
+  {
+    petsc::TemporaryGlobalVec topg_global(da);
+    topg.copy_to_vec(da, topg_global);
+
+    ierr = DMCreateLocalVector(*da, topg_local.rawptr());
+    PISM_CHK(ierr, "DMCreateLocalVector");
+
+    ierr = DMGlobalToLocalBegin(*da, topg_global, INSERT_VALUES, topg_local);
+    PISM_CHK(ierr, "DMGlobalToLocalBegin");
+
+    ierr = DMGlobalToLocalEnd(*da, topg_global, INSERT_VALUES, topg_local);
+    PISM_CHK(ierr, "DMGlobalToLocalEnd");
+  }
+
+  petsc::DMDAVecArray topg_array(da, topg_local);
+  double **b0 = (double**)topg_array.get();
+
+  // scaling of the coeffs in Taylor series
+  const double
+    n  = m_Glen_exponent,
+    k  = (n + 2) / n,
+    s2 = k * (2 * n + 2) / (2 * n),
+    s3 = s2 * (3 * n + 2) / (3 * n),
+    s4 = s3 * (4 * n + 2) / (4 * n);
+
+  IceModelVec::AccessList list{&m_topgsmooth, &m_maxtl, &m_C2, &m_C3, &m_C4};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    // average only over those points which are in the grid; do not wrap periodically
+    double topgs = 0.0;
+    {
+      double sum = 0.0, count = 0.0;
+      for (int r = -m_Nx; r <= m_Nx; r++) {
+        for (int s = -m_Ny; s <= m_Ny; s++) {
+          if ((i+r >= 0) and (i+r < Mx) and (j+s >= 0) and (j+s < My)) {
+            sum   += b0[j+s][i+r];
+            count += 1.0;
+          }
+        }
+      }
+      // unprotected division by count but r=0,s=0 case guarantees count>=1
+      topgs = sum / count;
+    }
+    m_topgsmooth(i, j) = topgs;
+
+    double
+      maxtltemp = 0.0,
+      sum2      = 0.0,
+      sum3      = 0.0,
+      sum4      = 0.0,
+      count     = 0.0;
+
+    for (int r = -m_Nx; r <= m_Nx; r++) {
+      for (int s = -m_Ny; s <= m_Ny; s++) {
+        if ((i+r >= 0) and (i+r < Mx) and (j+s >= 0) and (j+s < My)) {
+          // tl is elevation of local topography at a pt in patch
+          const double tl  = b0[j+s][i+r] - topgs;
+          maxtltemp = std::max(maxtltemp, tl);
+          // accumulate 2nd, 3rd, and 4th powers with only 3 multiplications
+          const double tl2 = tl * tl;
+          sum2 += tl2;
+          sum3 += tl2 * tl;
+          sum4 += tl2 * tl2;
+          count += 1.0;
+        }
+      }
+    }
+    m_maxtl(i, j) = maxtltemp;
+
+    m_C2(i, j) = (sum2 / count) * s2;
+    m_C3(i, j) = (sum3 / count) * s3;
+    m_C4(i, j) = (sum4 / count) * s4;
+  }
+
+  GhostExchange({&m_topgsmooth, &m_maxtl, &m_C2, &m_C3, &m_C4}).update();
+}
+
 //! Computes the smoothed bed by a simple average over a rectangle of grid points.
 void BedSmoother::smooth_the_bed_on_proc0() {
 
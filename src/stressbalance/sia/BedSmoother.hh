@@ -106,6 +106,8 @@ protected:
 
   double m_Glen_exponent, m_smoothing_range;
 
+  //! copies on processor 0, allocated only if sub-domains are too small for
+  //! preprocess_bed_distributed() (see preprocess_bed())
   petsc::Vec::Ptr m_topgp0,         //!< original bed elevation on processor 0
     m_topgsmoothp0,   //!< smoothed bed elevation on processor 0
     m_maxtlp0,        //!< maximum elevation at (i,j) of local topography (nearby patch)
@@ -114,6 +116,8 @@ protected:
   virtual void preprocess_bed(const IceModelVec2S &topg,
                               unsigned int Nx_in, unsigned int Ny_in);
 
+  void preprocess_bed_distributed(const IceModelVec2S &topg);
+
   void smooth_the_bed_on_proc0();
   void compute_coefficients_on_proc0();
 };
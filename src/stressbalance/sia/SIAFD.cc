@@ -17,7 +17,9 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cstdlib>
+#include <cmath>                // NAN, std::fabs
 #include <cassert>
+#include <algorithm>
 
 #include "SIAFD.hh"
 #include "BedSmoother.hh"
@@ -31,14 +33,27 @@
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/iceModelVec3Custom.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/stressbalance/StressBalance.hh"
 
 #include "pism/util/Time.hh"
+#include "pism/util/GhostExchange.hh"
 
 namespace pism {
 namespace stressbalance {
 
+SIAFD::Parameters::Parameters(const Config &config) {
+  max_diffusivity         = config.get_number("stress_balance.sia.max_diffusivity");
+  grain_size              = config.get_number("constants.ice.grain_size", "m");
+  grain_size_age_coupling = config.get_flag("stress_balance.sia.grain_size_age_coupling");
+  e_age_coupling          = config.get_flag("stress_balance.sia.e_age_coupling");
+  limit_diffusivity       = config.get_flag("stress_balance.sia.limit_diffusivity");
+
+  flow_law_cache_thickness_tolerance =
+    config.get_number("stress_balance.flow_law_cache.thickness_tolerance");
+}
+
 SIAFD::SIAFD(IceGrid::ConstPtr g)
   : SSB_Modifier(g),
     m_stencil_width(m_config->get_number("grid.max_stencil_width")),
@@ -47,11 +62,41 @@ SIAFD::SIAFD(IceGrid::ConstPtr g)
     m_h_x(m_grid, "h_x", WITH_GHOSTS),
     m_h_y(m_grid, "h_y", WITH_GHOSTS),
     m_D(m_grid, "diffusivity", WITH_GHOSTS),
-    m_delta_0(m_grid, "delta_0", WITH_GHOSTS),
-    m_delta_1(m_grid, "delta_1", WITH_GHOSTS),
-    m_work_3d_0(m_grid, "work_3d_0", WITH_GHOSTS),
-    m_work_3d_1(m_grid, "work_3d_1", WITH_GHOSTS)
+    m_column_top(m_grid, "column_top_index", WITH_GHOSTS),
+    m_column_thickness(m_grid, "staggered_thickness", WITH_GHOSTS),
+    m_softness_thickness(m_grid, "softness_thickness", WITH_GHOSTS),
+    m_softness_enthalpy(nullptr),
+    m_softness_enthalpy_state(-1),
+    m_parameters(*m_config)
 {
+  {
+    int N = m_config->get_number("stress_balance.sia.sigma_levels");
+
+    if (N == 0) {
+      m_delta_0.reset(new IceModelVec3(m_grid, "delta_0", WITH_GHOSTS));
+      m_delta_1.reset(new IceModelVec3(m_grid, "delta_1", WITH_GHOSTS));
+      m_work_3d_0.reset(new IceModelVec3(m_grid, "work_3d_0", WITH_GHOSTS));
+      m_work_3d_1.reset(new IceModelVec3(m_grid, "work_3d_1", WITH_GHOSTS));
+    } else {
+      if (N < 2) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "stress_balance.sia.sigma_levels = %d is invalid"
+                                      " (has to be 0 or at least 2)", N);
+      }
+
+      // equally spaced levels in the scaled vertical coordinate sigma = z / H
+      m_sigma.resize(N);
+      for (int k = 0; k < N; ++k) {
+        m_sigma[k] = k / (N - 1.0);
+      }
+
+      m_delta_0.reset(new IceModelVec3Custom(m_grid, "delta_0", "sigma", m_sigma, WITH_GHOSTS));
+      m_delta_1.reset(new IceModelVec3Custom(m_grid, "delta_1", "sigma", m_sigma, WITH_GHOSTS));
+      m_work_3d_0.reset(new IceModelVec3Custom(m_grid, "work_3d_0", "sigma", m_sigma, WITH_GHOSTS));
+      m_work_3d_1.reset(new IceModelVec3Custom(m_grid, "work_3d_1", "sigma", m_sigma, WITH_GHOSTS));
+    }
+  }
+
   // bed smoother
   m_bed_smoother = new BedSmoother(m_grid, m_stencil_width);
 
@@ -62,6 +107,39 @@ SIAFD::SIAFD(IceGrid::ConstPtr g)
     m_flow_law = ice_factory.create();
   }
 
+  if (rheology::FlowLawIsPowerLaw(*m_flow_law)) {
+    if (m_sigma.empty()) {
+      m_softness_0.reset(new IceModelVec3(m_grid, "softness_0", WITH_GHOSTS));
+      m_softness_1.reset(new IceModelVec3(m_grid, "softness_1", WITH_GHOSTS));
+    } else {
+      m_softness_0.reset(new IceModelVec3Custom(m_grid, "softness_0", "sigma", m_sigma,
+                                                WITH_GHOSTS));
+      m_softness_1.reset(new IceModelVec3Custom(m_grid, "softness_1", "sigma", m_sigma,
+                                                WITH_GHOSTS));
+    }
+    m_softness_thickness.set(NAN);
+  }
+
+  {
+    const bool
+      use_age            = m_parameters.grain_size_age_coupling or m_parameters.e_age_coupling,
+      use_softness_cache = (bool)m_softness_0;
+
+    if (use_age) {
+      if (use_softness_cache) {
+        select_diffusivity_kernels<true, true>();
+      } else {
+        select_diffusivity_kernels<true, false>();
+      }
+    } else {
+      if (use_softness_cache) {
+        select_diffusivity_kernels<false, true>();
+      } else {
+        select_diffusivity_kernels<false, false>();
+      }
+    }
+  }
+
   const bool compute_grain_size_using_age = m_config->get_flag("stress_balance.sia.grain_size_age_coupling");
   const bool age_model_enabled = m_config->get_flag("age.enabled");
   const bool e_age_coupling = m_config->get_flag("stress_balance.sia.e_age_coupling");
@@ -138,12 +216,12 @@ void SIAFD::update(const IceModelVec2V &sliding_velocity,
   profiling.end("sia.gradient");
 
   profiling.begin("sia.flux");
-  compute_diffusivity(full_update,
-                      *inputs.geometry,
-                      inputs.enthalpy,
-                      inputs.age,
-                      m_h_x, m_h_y, m_D);
-  compute_diffusive_flux(m_h_x, m_h_y, m_D, m_diffusive_flux);
+  // compute the diffusivity and the flux in one pass over the staggered grid
+  compute_diffusivity_and_flux(full_update,
+                               *inputs.geometry,
+                               inputs.enthalpy,
+                               inputs.age,
+                               m_h_x, m_h_y, m_D, &m_diffusive_flux);
   profiling.end("sia.flux");
 
   if (full_update) {
@@ -495,8 +573,7 @@ void SIAFD::surface_gradient_haseloff(const IceModelVec2S &ice_surface_elevation
     } // end of "y-derivative, i-offset"
   }
 
-  h_x.update_ghosts();
-  h_y.update_ghosts();
+  GhostExchange({&h_x, &h_y}).update();
 }
 
 
@@ -547,6 +624,105 @@ void SIAFD::compute_diffusivity(bool full_update,
                                 const IceModelVec2Stag &h_x,
                                 const IceModelVec2Stag &h_y,
                                 IceModelVec2Stag &result) {
+  compute_diffusivity_and_flux(full_update, geometry, enthalpy, age, h_x, h_y,
+                               result, nullptr);
+}
+
+/*!
+ * Compute the average of `field` (defined on levels `z`) at regular grid points (i, j) and
+ * (i + oi, j + oj) at heights `z_column[0, ..., n-1]` (increasing) above the base of the
+ * ice. If `z_column` is NULL the average is computed at levels `z`.
+ *
+ * Uses linear interpolation in the vertical and the value at the top level above the top
+ * of the grid.
+ */
+static void staggered_average(const IceModelVec3 &field, const std::vector<double> &z,
+                              int i, int j, int oi, int oj,
+                              const double *z_column, unsigned int n, double *result) {
+  const double
+    *a = field.get_column(i, j),
+    *b = field.get_column(i + oi, j + oj);
+
+  if (z_column == NULL) {
+    for (unsigned int k = 0; k < n; ++k) {
+      result[k] = 0.5 * (a[k] + b[k]);
+    }
+    return;
+  }
+
+  const unsigned int Mz = z.size();
+
+  unsigned int m = 0;
+  for (unsigned int k = 0; k < n; ++k) {
+    while (m + 1 < Mz and z[m + 1] <= z_column[k]) {
+      ++m;
+    }
+
+    if (m + 1 == Mz) {
+      result[k] = 0.5 * (a[m] + b[m]);
+    } else {
+      const double w = (z_column[k] - z[m]) / (z[m + 1] - z[m]);
+      result[k] = 0.5 * ((a[m] + w * (a[m + 1] - a[m])) + (b[m] + w * (b[m + 1] - b[m])));
+    }
+  }
+}
+
+//! \brief Compute the SIA diffusivity and (optionally) the diffusive flux.
+/*!
+ * See compute_diffusivity() for details.
+ *
+ * If `flux` is not NULL, this method also computes the diffusive flux \f$ Q = -D \nabla h
+ * \f$ (see compute_diffusive_flux()) in the same loop over the staggered grid, avoiding
+ * an extra pass over `h_x`, `h_y` and the diffusivity.
+ *
+ * \param[out] diffusivity diffusivity of the SIA flow
+ * \param[out] flux diffusive flux (may be NULL)
+ */
+void SIAFD::compute_diffusivity_and_flux(bool full_update,
+                                         const Geometry &geometry,
+                                         const IceModelVec3 *enthalpy,
+                                         const IceModelVec3 *age,
+                                         const IceModelVec2Stag &h_x,
+                                         const IceModelVec2Stag &h_y,
+                                         IceModelVec2Stag &diffusivity,
+                                         IceModelVec2Stag *flux) {
+  DiffusivityKernel kernel = m_diffusivity_kernels[full_update][flux != nullptr];
+
+  (this->*kernel)(geometry, enthalpy, age, h_x, h_y, diffusivity, flux);
+}
+
+/*!
+ * Select instantiations of diffusivity_kernel() for the flags that do not change during a
+ * run.
+ */
+template<bool use_age, bool use_softness_cache>
+void SIAFD::select_diffusivity_kernels() {
+  m_diffusivity_kernels[0][0] = &SIAFD::diffusivity_kernel<use_age, use_softness_cache, false, false>;
+  m_diffusivity_kernels[0][1] = &SIAFD::diffusivity_kernel<use_age, use_softness_cache, false, true>;
+  m_diffusivity_kernels[1][0] = &SIAFD::diffusivity_kernel<use_age, use_softness_cache, true, false>;
+  m_diffusivity_kernels[1][1] = &SIAFD::diffusivity_kernel<use_age, use_softness_cache, true, true>;
+}
+
+/*!
+ * Implementation of compute_diffusivity_and_flux().
+ *
+ * Template parameters replace run-time flags tested at every grid point:
+ *
+ * - `use_age`: use the ice age (grain size-age or enhancement factor-age coupling),
+ * - `use_softness_cache`: use cached ice softness (m_softness_0 and m_softness_1),
+ * - `full_update`: store delta (used by compute_I()),
+ * - `compute_flux`: compute the diffusive flux.
+ */
+template<bool use_age, bool use_softness_cache, bool full_update, bool compute_flux>
+void SIAFD::diffusivity_kernel(const Geometry &geometry,
+                               const IceModelVec3 *enthalpy,
+                               const IceModelVec3 *age,
+                               const IceModelVec2Stag &h_x,
+                               const IceModelVec2Stag &h_y,
+                               IceModelVec2Stag &diffusivity,
+                               IceModelVec2Stag *flux) {
+  IceModelVec2Stag &result = diffusivity;
+
   IceModelVec2S
     &thk_smooth = m_work_2d_0,
     &theta      = m_work_2d_1;
@@ -556,7 +732,7 @@ void SIAFD::compute_diffusivity(bool full_update,
     &H = geometry.ice_thickness;
 
   const IceModelVec2CellType &mask = geometry.cell_type;
-  IceModelVec3* delta[] = {&m_delta_0, &m_delta_1};
+  IceModelVec3D* delta[] = {m_delta_0.get(), m_delta_1.get()};
 
   result.set(0.0);
 
@@ -564,15 +740,14 @@ void SIAFD::compute_diffusivity(bool full_update,
     current_time                    = m_grid->ctx()->time()->current(),
     enhancement_factor              = m_flow_law->enhancement_factor(),
     enhancement_factor_interglacial = m_flow_law->enhancement_factor_interglacial(),
-    D_limit                         = m_config->get_number("stress_balance.sia.max_diffusivity");
+    D_limit                         = m_parameters.max_diffusivity;
 
   const bool
-    compute_grain_size_using_age = m_config->get_flag("stress_balance.sia.grain_size_age_coupling"),
-    e_age_coupling               = m_config->get_flag("stress_balance.sia.e_age_coupling"),
-    limit_diffusivity            = m_config->get_flag("stress_balance.sia.limit_diffusivity"),
-    use_age                      = compute_grain_size_using_age or e_age_coupling;
+    compute_grain_size_using_age = m_parameters.grain_size_age_coupling,
+    e_age_coupling               = m_parameters.e_age_coupling;
 
-  rheology::grain_size_vostok gs_vostok;
+  // diffusivity cap: exceeding D_limit is an error unless limiting is enabled (see below)
+  const double D_cap = m_parameters.limit_diffusivity ? D_limit : INFINITY;
 
   // get "theta" from Schoof (2003) bed smoothness calculation and the
   // thickness relative to the smoothed bed; each IceModelVec2S involved must
@@ -590,8 +765,13 @@ void SIAFD::compute_diffusivity(bool full_update,
 
   if (full_update) {
     list.add({delta[0], delta[1]});
-    assert(m_delta_0.stencil_width()  >= 1);
-    assert(m_delta_1.stencil_width()  >= 1);
+    assert(m_delta_0->stencil_width()  >= 1);
+    assert(m_delta_1->stencil_width()  >= 1);
+  }
+
+  if (compute_flux) {
+    list.add(*flux);
+    assert(flux->stencil_width() >= 1);
   }
 
   assert(theta.stencil_width()      >= 2);
@@ -602,145 +782,199 @@ void SIAFD::compute_diffusivity(bool full_update,
   assert(enthalpy->stencil_width()  >= 2);
 
   const std::vector<double> &z = m_grid->z();
+  const bool use_sigma = not m_sigma.empty();
   const unsigned int
     Mx = m_grid->Mx(),
     My = m_grid->My(),
-    Mz = m_grid->Mz();
+    Mz = use_sigma ? m_sigma.size() : m_grid->Mz(); // number of levels of delta
 
-  std::vector<double> depth(Mz), stress(Mz), pressure(Mz), E(Mz), flow(Mz);
-  std::vector<double> delta_ij(Mz);
-  std::vector<double> A(Mz), ice_grain_size(Mz, m_config->get_number("constants.ice.grain_size", "m"));
-  std::vector<double> e_factor(Mz, enhancement_factor);
+  const double grain_size = m_parameters.grain_size;
+
+  // ice softness depends on enthalpy and pressure only, so it is re-used until enthalpy
+  // or the ice thickness changes
+  IceModelVec3D* softness[] = {m_softness_0.get(), m_softness_1.get()};
+  const double
+    n_glen              = m_flow_law->exponent(),
+    thickness_tolerance = m_parameters.flow_law_cache_thickness_tolerance;
+
+  if (use_softness_cache) {
+    if (m_softness_enthalpy != enthalpy or
+        m_softness_enthalpy_state != enthalpy->state_counter()) {
+      m_softness_thickness.set(NAN);
+      m_softness_enthalpy       = enthalpy;
+      m_softness_enthalpy_state = enthalpy->state_counter();
+    }
+    list.add({softness[0], softness[1], &m_softness_thickness});
+  }
+
+  Config::LookupGuard guard(*m_config, "SIAFD::compute_diffusivity()");
 
   double D_max = 0.0;
   int high_diffusivity_counter = 0;
   for (int o=0; o<2; o++) {
     ParallelSection loop(m_grid->com);
-    try {
-      for (PointsWithGhosts p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
-
-        // staggered point: o=0 is i+1/2, o=1 is j+1/2, (i, j) and (i+oi, j+oj)
-        //   are regular grid neighbors of a staggered point:
-        const int oi = 1 - o, oj = o;
+#pragma omp parallel reduction(max: D_max) reduction(+: high_diffusivity_counter)
+    {
+      // work space (private to each thread)
+      std::vector<double> depth(Mz), stress(Mz), pressure(Mz), E(Mz), flow(Mz);
+      std::vector<double> delta_ij(Mz), z_sigma(Mz);
+      std::vector<double> A(Mz), ice_grain_size(Mz, grain_size);
+      std::vector<double> e_factor(Mz, enhancement_factor);
 
-        const double
-          thk = 0.5 * (thk_smooth(i, j) + thk_smooth(i+oi, j+oj));
+      rheology::grain_size_vostok gs_vostok;
 
-        // zero thickness case:
-        if (thk == 0.0) {
-          result(i, j, o) = 0.0;
-          if (full_update) {
-            delta[o]->set_column(i, j, 0.0);
-          }
-          continue;
-        }
+      try {
+        for (ThreadPoints p(*m_grid, 1); p; p.next()) {
+          const int i = p.i(), j = p.j();
 
-        const int ks = m_grid->kBelowHeight(thk);
+          // staggered point: o=0 is i+1/2, o=1 is j+1/2, (i, j) and (i+oi, j+oj)
+          //   are regular grid neighbors of a staggered point:
+          const int oi = 1 - o, oj = o;
 
-        for (int k = 0; k <= ks; ++k) {
-          depth[k] = thk - z[k];
-        }
+          const double
+            thk = 0.5 * (thk_smooth(i, j) + thk_smooth(i+oi, j+oj));
 
-        // pressure added by the ice (i.e. pressure difference between the
-        // current level and the top of the column)
-        m_EC->pressure(depth, ks, pressure); // FIXME issue #15
+          // zero thickness case:
+          if (thk == 0.0) {
+            result(i, j, o) = 0.0;
+            if (compute_flux) {
+              (*flux)(i, j, o) = 0.0;
+            }
+            if (full_update) {
+              delta[o]->set_column(i, j, 0.0);
+            }
+            continue;
+          }
 
-        if (use_age) {
-          const double
-            *age_ij     = age->get_column(i, j),
-            *age_offset = age->get_column(i+oi, j+oj);
+          // levels used in this column: the vertical grid of the model or the
+          // terrain-following grid (which has a level at the ice surface)
+          int ks = 0;
+          const double *z_column = NULL;
+          if (use_sigma) {
+            ks = Mz - 1;
+            for (unsigned int k = 0; k < Mz; ++k) {
+              z_sigma[k] = m_sigma[k] * thk;
+            }
+            z_column = z_sigma.data();
+          } else {
+            ks = m_grid->kBelowHeight(thk);
+          }
+          const double *zk = use_sigma ? z_column : z.data();
 
           for (int k = 0; k <= ks; ++k) {
-            A[k] = 0.5 * (age_ij[k] + age_offset[k]);
+            depth[k] = thk - zk[k];
           }
 
-          if (compute_grain_size_using_age) {
-            for (int k = 0; k <= ks; ++k) {
-              // convert age from seconds to years:
-              ice_grain_size[k] = gs_vostok(A[k] * m_seconds_per_year);
+          // pressure added by the ice (i.e. pressure difference between the
+          // current level and the top of the column)
+          m_EC->pressure(depth, ks, pressure); // FIXME issue #15
+
+          if (use_age) {
+            staggered_average(*age, z, i, j, oi, oj, z_column, ks + 1, A.data());
+
+            if (compute_grain_size_using_age) {
+              for (int k = 0; k <= ks; ++k) {
+                // convert age from seconds to years:
+                ice_grain_size[k] = gs_vostok(A[k] * m_seconds_per_year);
+              }
             }
-          }
 
-          if (e_age_coupling) {
-            for (int k = 0; k <= ks; ++k) {
-              const double accumulation_time = current_time - A[k];
-              if (interglacial(accumulation_time)) {
-                e_factor[k] = enhancement_factor_interglacial;
-              } else {
-                e_factor[k] = enhancement_factor;
+            if (e_age_coupling) {
+              for (int k = 0; k <= ks; ++k) {
+                const double accumulation_time = current_time - A[k];
+                if (interglacial(accumulation_time)) {
+                  e_factor[k] = enhancement_factor_interglacial;
+                } else {
+                  e_factor[k] = enhancement_factor;
+                }
               }
             }
           }
-        }
 
-        {
-          const double
-            *E_ij     = enthalpy->get_column(i, j),
-            *E_offset = enthalpy->get_column(i+oi, j+oj);
+          const double alpha = sqrt(PetscSqr(h_x(i, j, o)) + PetscSqr(h_y(i, j, o)));
           for (int k = 0; k <= ks; ++k) {
-            E[k] = 0.5 * (E_ij[k] + E_offset[k]);
+            stress[k] = alpha * pressure[k];
           }
-        }
 
-        const double alpha = sqrt(PetscSqr(h_x(i, j, o)) + PetscSqr(h_y(i, j, o)));
-        for (int k = 0; k <= ks; ++k) {
-          stress[k] = alpha * pressure[k];
-        }
+          if (use_softness_cache) {
+            double *A = softness[o]->get_column(i, j);
+            const double thk_cached = m_softness_thickness(i, j, o);
+
+            // re-compute softness unless the thickness is close to the one used to
+            // compute it and the cached column covers all levels used here (note that
+            // the first condition is false if thk_cached is NAN)
+            if (not (std::fabs(thk - thk_cached) <= thickness_tolerance and
+                     (use_sigma or (int)m_grid->kBelowHeight(thk_cached) >= ks))) {
+              staggered_average(*enthalpy, z, i, j, oi, oj, z_column, ks + 1, E.data());
+              m_flow_law->softness_n(&E[0], &pressure[0], ks + 1, A);
+              m_softness_thickness(i, j, o) = thk;
+            }
 
-        m_flow_law->flow_n(&stress[0], &E[0], &pressure[0], &ice_grain_size[0], ks + 1,
-                           &flow[0]);
+            for (int k = 0; k <= ks; ++k) {
+              flow[k] = A[k] * pow(stress[k], n_glen - 1);
+            }
+          } else {
+            staggered_average(*enthalpy, z, i, j, oi, oj, z_column, ks + 1, E.data());
 
-        const double theta_local = 0.5 * (theta(i, j) + theta(i+oi, j+oj));
-        for (int k = 0; k <= ks; ++k) {
-          delta_ij[k] = e_factor[k] * theta_local * 2.0 * pressure[k] * flow[k];
-        }
+            m_flow_law->flow_n(&stress[0], &E[0], &pressure[0], &ice_grain_size[0], ks + 1,
+                               &flow[0]);
+          }
 
-        double D = 0.0;  // diffusivity for deformational SIA flow
-        {
-          for (int k = 1; k <= ks; ++k) {
-            // trapezoidal rule
-            const double dz = z[k] - z[k-1];
-            D += 0.5 * dz * ((depth[k] + dz) * delta_ij[k-1] + depth[k] * delta_ij[k]);
+          const double theta_local = 0.5 * (theta(i, j) + theta(i+oi, j+oj));
+          for (int k = 0; k <= ks; ++k) {
+            delta_ij[k] = e_factor[k] * theta_local * 2.0 * pressure[k] * flow[k];
           }
-          // finish off D with (1/2) dz (0 + (H-z[ks])*delta_ij[ks]), but dz=H-z[ks]:
-          const double dz = thk - z[ks];
-          D += 0.5 * dz * dz * delta_ij[ks];
-        }
 
-        // Override diffusivity at the edges of the domain. (At these
-        // locations PISM uses ghost cells *beyond* the boundary of
-        // the computational domain. This does not matter if the ice
-        // does not extend all the way to the domain boundary, as in
-        // whole-ice-sheet simulations. In a regional setup, though,
-        // this adjustment lets us avoid taking very small time-steps
-        // because of the possible thickness and bed elevation
-        // "discontinuities" at the boundary.)
-        if (i < 0 || i >= (int)Mx - 1 ||
-            j < 0 || j >= (int)My - 1) {
-          D = 0.0;
-        }
+          double D = 0.0;  // diffusivity for deformational SIA flow
+          {
+            for (int k = 1; k <= ks; ++k) {
+              // trapezoidal rule
+              const double dz = zk[k] - zk[k-1];
+              D += 0.5 * dz * ((depth[k] + dz) * delta_ij[k-1] + depth[k] * delta_ij[k]);
+            }
+            // finish off D with (1/2) dz (0 + (H-z[ks])*delta_ij[ks]), but dz=H-z[ks]
+            // (zero on the terrain-following grid):
+            const double dz = thk - zk[ks];
+            D += 0.5 * dz * dz * delta_ij[ks];
+          }
 
-        if (limit_diffusivity and D >= D_limit) {
-          D = D_limit;
-          high_diffusivity_counter += 1;
-        }
+          // Override diffusivity at the edges of the domain. (At these
+          // locations PISM uses ghost cells *beyond* the boundary of
+          // the computational domain. This does not matter if the ice
+          // does not extend all the way to the domain boundary, as in
+          // whole-ice-sheet simulations. In a regional setup, though,
+          // this adjustment lets us avoid taking very small time-steps
+          // because of the possible thickness and bed elevation
+          // "discontinuities" at the boundary.)
+          if (i < 0 || i >= (int)Mx - 1 ||
+              j < 0 || j >= (int)My - 1) {
+            D = 0.0;
+          }
 
-        D_max = std::max(D_max, D);
+          high_diffusivity_counter += (D >= D_cap);
+          D = std::min(D, D_cap);
 
-        result(i, j, o) = D;
+          D_max = std::max(D_max, D);
 
-        // if doing the full update, fill the delta column above the ice and
-        // store it:
-        if (full_update) {
-          for (unsigned int k = ks + 1; k < Mz; ++k) {
-            delta_ij[k] = 0.0;
+          result(i, j, o) = D;
+
+          if (compute_flux) {
+            const double slope = (o == 0) ? h_x(i, j, o) : h_y(i, j, o);
+            (*flux)(i, j, o) = - D * slope;
           }
-          delta[o]->set_column(i, j, &delta_ij[0]);
-        }
-      } // i, j-loop
-    } catch (...) {
-      loop.failed();
+
+          // if doing the full update, fill the delta column above the ice and
+          // store it:
+          if (full_update) {
+            for (unsigned int k = ks + 1; k < Mz; ++k) {
+              delta_ij[k] = 0.0;
+            }
+            delta[o]->set_column(i, j, &delta_ij[0]);
+          }
+        } // i, j-loop
+      } catch (...) {
+        loop.failed();
+      }
     }
     loop.check();
   } // o-loop
@@ -775,21 +1009,33 @@ void SIAFD::compute_diffusive_flux(const IceModelVec2Stag &h_x, const IceModelVe
 
   IceModelVec::AccessList list{&diffusivity, &h_x, &h_y, &result};
 
-  for (int o = 0; o < 2; o++) {
-    ParallelSection loop(m_grid->com);
-    try {
-      for (PointsWithGhosts p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
-
-        const double slope = (o == 0) ? h_x(i, j, o) : h_y(i, j, o);
+  const auto
+    D       = diffusivity.flat_view(),
+    slope_x = h_x.flat_view(),
+    slope_y = h_y.flat_view();
+  const auto Q = result.flat_view();
 
-        result(i, j, o) = - diffusivity(i, j, o) * slope;
+#pragma omp parallel
+  {
+    for (ThreadPoints p(*m_grid, 1); p; p.next_row()) {
+      const int
+        i = p.i_first(),
+        j = p.j(),
+        n = 2 * (p.i_last() - i + 1);
+
+      const double
+        *d  = D.pointer(i, j),
+        *sx = slope_x.pointer(i, j),
+        *sy = slope_y.pointer(i, j);
+      double *q = Q.pointer(i, j);
+
+      // components 0 and 1 of a point are next to each other
+      for (int m = 0; m < n; m += 2) {
+        q[m + 0] = - d[m + 0] * sx[m + 0];
+        q[m + 1] = - d[m + 1] * sy[m + 1];
       }
-    } catch (...) {
-      loop.failed();
     }
-    loop.check();
-  } // o-loop
+  }
 }
 
 //! \brief Compute I.
@@ -803,12 +1049,15 @@ void SIAFD::compute_diffusive_flux(const IceModelVec2Stag &h_x, const IceModelVe
  *
  * The result is stored in work_3d[0,1] and is used to compute the SIA component
  * of the 3D-distributed horizontal ice velocity.
+ *
+ * If stress_balance.sia.sigma_levels is positive, delta and I use the terrain-following
+ * grid `m_sigma` (scaled by the smoothed ice thickness in each column).
  */
 void SIAFD::compute_I(const Geometry &geometry) {
 
   IceModelVec2S &thk_smooth = m_work_2d_0;
-  IceModelVec3* I[] = {&m_work_3d_0, &m_work_3d_1};
-  IceModelVec3* delta[] = {&m_delta_0, &m_delta_1};
+  IceModelVec3D* I[] = {m_work_3d_0.get(), m_work_3d_1.get()};
+  IceModelVec3D* delta[] = {m_delta_0.get(), m_delta_1.get()};
 
   const IceModelVec2S
     &h = geometry.ice_surface_elevation,
@@ -818,7 +1067,8 @@ void SIAFD::compute_I(const Geometry &geometry) {
 
   m_bed_smoother->smoothed_thk(h, H, mask, thk_smooth);
 
-  IceModelVec::AccessList list{delta[0], delta[1], I[0], I[1], &thk_smooth};
+  IceModelVec::AccessList list{delta[0], delta[1], I[0], I[1], &thk_smooth, &m_column_top,
+                               &m_column_thickness};
 
   assert(I[0]->stencil_width()     >= 1);
   assert(I[1]->stencil_width()     >= 1);
@@ -826,49 +1076,83 @@ void SIAFD::compute_I(const Geometry &geometry) {
   assert(delta[1]->stencil_width() >= 1);
   assert(thk_smooth.stencil_width() >= 2);
 
-  const unsigned int Mz = m_grid->Mz();
+  const bool use_sigma = not m_sigma.empty();
 
+  // number of levels of I and delta
+  const unsigned int Mz = use_sigma ? m_sigma.size() : m_grid->Mz();
+
+  // spacing between levels (scaled by the ice thickness on the terrain-following grid)
   std::vector<double> dz(Mz);
   for (unsigned int k = 1; k < Mz; ++k) {
-    dz[k] = m_grid->z(k) - m_grid->z(k - 1);
+    dz[k] = use_sigma ? m_sigma[k] - m_sigma[k - 1] : m_grid->z(k) - m_grid->z(k - 1);
   }
 
   for (int o = 0; o < 2; ++o) {
     ParallelSection loop(m_grid->com);
-    try {
-      for (PointsWithGhosts p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
+#pragma omp parallel
+    {
+      try {
+        for (ThreadPoints p(*m_grid, 1); p; p.next()) {
+          const int i = p.i(), j = p.j();
 
-        const int oi = 1 - o, oj = o;
-        const double
-          thk = 0.5 * (thk_smooth(i, j) + thk_smooth(i + oi, j + oj));
+          const int oi = 1 - o, oj = o;
+          const double
+            thk = 0.5 * (thk_smooth(i, j) + thk_smooth(i + oi, j + oj));
 
-        const double *delta_ij = delta[o]->get_column(i, j);
-        double       *I_ij     = I[o]->get_column(i, j);
+          const double *delta_ij = delta[o]->get_column(i, j);
+          double       *I_ij     = I[o]->get_column(i, j);
 
-        const unsigned int ks = m_grid->kBelowHeight(thk);
+          const unsigned int ks = m_grid->kBelowHeight(thk);
+          m_column_top(i, j, o) = ks;
+          m_column_thickness(i, j, o) = thk;
 
-        // within the ice:
-        I_ij[0] = 0.0;
-        double I_current = 0.0;
-        for (unsigned int k = 1; k <= ks; ++k) {
-          // trapezoidal rule
-          I_current += 0.5 * dz[k] * (delta_ij[k - 1] + delta_ij[k]);
-          I_ij[k] = I_current;
-        }
+          // the top level within the ice and the scaling factor for dz
+          const unsigned int k_max = use_sigma ? Mz - 1 : ks;
+          const double scale = use_sigma ? thk : 1.0;
 
-        // above the ice:
-        for (unsigned int k = ks + 1; k < Mz; ++k) {
-          I_ij[k] = I_current;
+          // within the ice:
+          I_ij[0] = 0.0;
+          double I_current = 0.0;
+          for (unsigned int k = 1; k <= k_max; ++k) {
+            // trapezoidal rule
+            I_current += 0.5 * (dz[k] * scale) * (delta_ij[k - 1] + delta_ij[k]);
+            I_ij[k] = I_current;
+          }
+
+          // above the ice:
+          for (unsigned int k = k_max + 1; k < Mz; ++k) {
+            I_ij[k] = I_current;
+          }
         }
+      } catch (...) {
+        loop.failed();
       }
-    } catch (...) {
-      loop.failed();
     }
     loop.check();
   } // o-loop
 }
 
+/*!
+ * Interpolate `I` defined on the equally-spaced terrain-following grid with `N` levels
+ * in a column of thickness `H` to levels `z[0, ..., k_top]`. Uses the value at the ice
+ * surface above the ice.
+ */
+static void sigma_to_z(const double *I, unsigned int N, double H,
+                       const std::vector<double> &z, unsigned int k_top, double *result) {
+  for (unsigned int k = 0; k <= k_top; ++k) {
+    const double s = H > 0.0 ? z[k] / H : 1.0;
+
+    if (s >= 1.0) {
+      result[k] = I[N - 1];
+    } else {
+      const double x = s * (N - 1);
+      const unsigned int m = static_cast<unsigned int>(x);
+      const double w = x - m;
+      result[k] = I[m] + w * (I[m + 1] - I[m]);
+    }
+  }
+}
+
 //! \brief Compute horizontal components of the SIA velocity (in 3D).
 /*!
  * Recall that
@@ -895,56 +1179,100 @@ void SIAFD::compute_3d_horizontal_velocity(const Geometry &geometry,
 
   compute_I(geometry);
   // after the compute_I() call work_3d[0,1] contains I on the staggered grid
-  IceModelVec3* I[] = {&m_work_3d_0, &m_work_3d_1};
+  IceModelVec3D* I[] = {m_work_3d_0.get(), m_work_3d_1.get()};
 
-  IceModelVec::AccessList list{&u_out, &v_out, &h_x, &h_y, &sliding_velocity, I[0], I[1]};
+  IceModelVec::AccessList list{&u_out, &v_out, &h_x, &h_y, &sliding_velocity, I[0], I[1],
+                               &m_column_top, &m_column_thickness};
 
+  const std::vector<double> &z = m_grid->z();
   const unsigned int Mz = m_grid->Mz();
+  const unsigned int N = m_sigma.size();
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    const double
-      *I_e = I[0]->get_column(i, j),
-      *I_w = I[0]->get_column(i - 1, j),
-      *I_n = I[1]->get_column(i, j),
-      *I_s = I[1]->get_column(i, j - 1);
-
-    // Fetch values from 2D fields *outside* of the k-loop:
-    const double
-      h_x_w = h_x(i - 1, j, 0),
-      h_x_e = h_x(i, j, 0),
-      h_x_n = h_x(i, j, 1),
-      h_x_s = h_x(i, j - 1, 1);
-
-    const double
-      h_y_w = h_y(i - 1, j, 0),
-      h_y_e = h_y(i, j, 0),
-      h_y_n = h_y(i, j, 1),
-      h_y_s = h_y(i, j - 1, 1);
-
-    const double
-      sliding_velocity_u = sliding_velocity(i, j).u,
-      sliding_velocity_v = sliding_velocity(i, j).v;
-
-    double
-      *u_ij = u_out.get_column(i, j),
-      *v_ij = v_out.get_column(i, j);
-
-    // split into two loops to encourage auto-vectorization
-    for (unsigned int k = 0; k < Mz; ++k) {
-      u_ij[k] = sliding_velocity_u - 0.25 * (I_e[k] * h_x_e + I_w[k] * h_x_w +
-                                             I_n[k] * h_x_n + I_s[k] * h_x_s);
+  ParallelSection loop(m_grid->com);
+#pragma omp parallel
+  {
+    // I interpolated to the vertical grid of the model (used only if I is stored on the
+    // terrain-following grid)
+    std::vector<double> I_z_e, I_z_w, I_z_n, I_z_s;
+    if (N > 0) {
+      I_z_e.resize(Mz);
+      I_z_w.resize(Mz);
+      I_z_n.resize(Mz);
+      I_z_s.resize(Mz);
     }
-    for (unsigned int k = 0; k < Mz; ++k) {
-      v_ij[k] = sliding_velocity_v - 0.25 * (I_e[k] * h_y_e + I_w[k] * h_y_w +
-                                             I_n[k] * h_y_n + I_s[k] * h_y_s);
+
+    try {
+      for (ThreadPoints p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        // Fetch values from 2D fields *outside* of the k-loop:
+        const double
+          h_x_w = h_x(i - 1, j, 0),
+          h_x_e = h_x(i, j, 0),
+          h_x_n = h_x(i, j, 1),
+          h_x_s = h_x(i, j - 1, 1);
+
+        const double
+          h_y_w = h_y(i - 1, j, 0),
+          h_y_e = h_y(i, j, 0),
+          h_y_n = h_y(i, j, 1),
+          h_y_s = h_y(i, j - 1, 1);
+
+        const double
+          sliding_velocity_u = sliding_velocity(i, j).u,
+          sliding_velocity_v = sliding_velocity(i, j).v;
+
+        double
+          *u_ij = u_out.get_column(i, j),
+          *v_ij = v_out.get_column(i, j);
+
+        // I is constant above the ice surface at all four staggered grid points (see
+        // compute_I()), so the velocity is constant above k_top
+        const unsigned int k_top = std::max(std::max(m_column_top(i - 1, j, 0), m_column_top(i, j, 0)),
+                                            std::max(m_column_top(i, j, 1), m_column_top(i, j - 1, 1)));
+
+        const double
+          *I_e = I[0]->get_column(i, j),
+          *I_w = I[0]->get_column(i - 1, j),
+          *I_n = I[1]->get_column(i, j),
+          *I_s = I[1]->get_column(i, j - 1);
+
+        if (N > 0) {
+          sigma_to_z(I_e, N, m_column_thickness(i, j, 0), z, k_top, I_z_e.data());
+          sigma_to_z(I_w, N, m_column_thickness(i - 1, j, 0), z, k_top, I_z_w.data());
+          sigma_to_z(I_n, N, m_column_thickness(i, j, 1), z, k_top, I_z_n.data());
+          sigma_to_z(I_s, N, m_column_thickness(i, j - 1, 1), z, k_top, I_z_s.data());
+
+          I_e = I_z_e.data();
+          I_w = I_z_w.data();
+          I_n = I_z_n.data();
+          I_s = I_z_s.data();
+        }
+
+        // split into two loops to encourage auto-vectorization
+        for (unsigned int k = 0; k <= k_top; ++k) {
+          u_ij[k] = sliding_velocity_u - 0.25 * (I_e[k] * h_x_e + I_w[k] * h_x_w +
+                                                 I_n[k] * h_x_n + I_s[k] * h_x_s);
+        }
+        for (unsigned int k = 0; k <= k_top; ++k) {
+          v_ij[k] = sliding_velocity_v - 0.25 * (I_e[k] * h_y_e + I_w[k] * h_y_w +
+                                                 I_n[k] * h_y_n + I_s[k] * h_y_s);
+        }
+
+        // above the ice:
+        for (unsigned int k = k_top + 1; k < Mz; ++k) {
+          u_ij[k] = u_ij[k_top];
+          v_ij[k] = v_ij[k_top];
+        }
+      }
+    } catch (...) {
+      loop.failed();
     }
   }
+  loop.check();
 
   // Communicate to get ghosts:
-  u_out.update_ghosts();
-  v_out.update_ghosts();
+  GhostExchange({&u_out, &v_out}).update();
 }
 
 //! Determine if `accumulation_time` corresponds to an interglacial period.
@@ -89,6 +89,38 @@ protected:
                                    const IceModelVec2Stag &h_y,
                                    IceModelVec2Stag &result);
 
+  virtual void compute_diffusivity_and_flux(bool full_update,
+                                            const Geometry &geometry,
+                                            const IceModelVec3 *enthalpy,
+                                            const IceModelVec3 *age,
+                                            const IceModelVec2Stag &h_x,
+                                            const IceModelVec2Stag &h_y,
+                                            IceModelVec2Stag &diffusivity,
+                                            IceModelVec2Stag *flux);
+
+  template<bool use_age, bool use_softness_cache, bool full_update, bool compute_flux>
+  void diffusivity_kernel(const Geometry &geometry,
+                          const IceModelVec3 *enthalpy,
+                          const IceModelVec3 *age,
+                          const IceModelVec2Stag &h_x,
+                          const IceModelVec2Stag &h_y,
+                          IceModelVec2Stag &diffusivity,
+                          IceModelVec2Stag *flux);
+
+  template<bool use_age, bool use_softness_cache>
+  void select_diffusivity_kernels();
+
+  typedef void (SIAFD::*DiffusivityKernel)(const Geometry &geometry,
+                                           const IceModelVec3 *enthalpy,
+                                           const IceModelVec3 *age,
+                                           const IceModelVec2Stag &h_x,
+                                           const IceModelVec2Stag &h_y,
+                                           IceModelVec2Stag &diffusivity,
+                                           IceModelVec2Stag *flux);
+  //! instantiations of diffusivity_kernel() indexed by `full_update` and `flux != NULL`
+  //! (selected in the constructor; see select_diffusivity_kernels())
+  DiffusivityKernel m_diffusivity_kernels[2][2];
+
   virtual void compute_diffusive_flux(const IceModelVec2Stag &h_x, const IceModelVec2Stag &h_y,
                                       const IceModelVec2Stag &diffusivity,
                                       IceModelVec2Stag &result);
@@ -110,15 +142,51 @@ protected:
   IceModelVec2S m_work_2d_1;
   //! temporary storage for the surface gradient and the diffusivity
   IceModelVec2Stag m_h_x, m_h_y, m_D;
+  //! index of the highest vertical level below the surface of the smoothed ice thickness
+  //! on the staggered grid (computed by compute_I())
+  IceModelVec2Stag m_column_top;
+  //! smoothed ice thickness on the staggered grid (computed by compute_I())
+  IceModelVec2Stag m_column_thickness;
+  //! levels of the terrain-following grid used by delta and I (empty if these use the
+  //! vertical grid of the model; see stress_balance.sia.sigma_levels)
+  std::vector<double> m_sigma;
   //! temporary storage for delta on the staggered grid
-  IceModelVec3 m_delta_0;
-  IceModelVec3 m_delta_1;
-  //! temporary storage used to store I and strain_heating on the staggered grid
-  IceModelVec3 m_work_3d_0;
-  IceModelVec3 m_work_3d_1;
+  std::shared_ptr<IceModelVec3D> m_delta_0;
+  std::shared_ptr<IceModelVec3D> m_delta_1;
+  //! temporary storage used to store I on the staggered grid
+  std::shared_ptr<IceModelVec3D> m_work_3d_0;
+  std::shared_ptr<IceModelVec3D> m_work_3d_1;
+
+  //! ice softness on the staggered grid computed from enthalpy and re-used until
+  //! enthalpy or ice thickness change (see compute_diffusivity_and_flux()); allocated if
+  //! the flow law is a power law (see rheology::FlowLawIsPowerLaw())
+  std::shared_ptr<IceModelVec3D> m_softness_0;
+  std::shared_ptr<IceModelVec3D> m_softness_1;
+  //! smoothed ice thickness used to compute m_softness_0 and m_softness_1
+  IceModelVec2Stag m_softness_thickness;
+  //! enthalpy field (and its state counter) used to compute m_softness_0 and m_softness_1
+  const IceModelVec3 *m_softness_enthalpy;
+  int m_softness_enthalpy_state;
 
   BedSmoother *m_bed_smoother;
 
+  //! Parameters used by compute_diffusivity(), read once so that they are not looked up
+  //! at every time step.
+  struct Parameters {
+    Parameters(const Config &config);
+
+    //! maximum allowed diffusivity, m2/s
+    double max_diffusivity;
+    //! ice grain size, m
+    double grain_size;
+    bool grain_size_age_coupling;
+    bool e_age_coupling;
+    bool limit_diffusivity;
+    //! ice thickness change (m) that invalidates cached softness
+    double flow_law_cache_thickness_tolerance;
+  };
+  const Parameters m_parameters;
+
   // profiling
   int m_event_sia;
 
@@ -339,7 +339,7 @@ int main(int argc, char *argv[]) {
 
     // We use SIA_Nonsliding and not SIAFD here because we need the z-component
     // of the ice velocity, which is computed using incompressibility of ice in
-    // StressBalance::compute_vertical_velocity().
+    // StressBalance::compute_3d_fields().
     SIAFD *sia = new SIAFD(grid);
     ZeroSliding *no_sliding = new ZeroSliding(grid);
 
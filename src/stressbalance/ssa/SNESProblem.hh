@@ -24,12 +24,26 @@
 #include "pism/util/Vector2.hh" // to get Vector2
 #include "pism/util/petscwrappers/SNES.hh"
 #include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 
+//! How SNESProblem computes the Jacobian.
+enum JacobianType {
+  //! use compute_local_jacobian()
+  JACOBIAN_ANALYTIC,
+  //! finite differences using a coloring of the DMDA stencil (compute_local_jacobian() is
+  //! not needed)
+  JACOBIAN_FD_COLORING,
+  //! Jacobian-free Newton-Krylov (`-snes_mf_operator`): Jacobian-vector products use
+  //! finite differences, compute_local_jacobian() provides the (possibly approximate)
+  //! matrix used to build the preconditioner
+  JACOBIAN_MATRIX_FREE
+};
+
 template<int DOF, class U> class SNESProblem {
 public:
-  SNESProblem(IceGrid::ConstPtr g);
+  SNESProblem(IceGrid::ConstPtr g, JacobianType jacobian = JACOBIAN_ANALYTIC);
 
   virtual ~SNESProblem();
 
@@ -45,7 +59,7 @@ public:
 protected:
 
   virtual void compute_local_function(DMDALocalInfo *info, const U **xg, U **yg) = 0;
-  virtual void compute_local_jacobian(DMDALocalInfo *info, const U **x,  Mat B) = 0;
+  virtual void compute_local_jacobian(DMDALocalInfo *info, const U **x,  Mat B);
 
   IceGrid::ConstPtr m_grid;
 
@@ -102,7 +116,17 @@ PetscErrorCode SNESProblem<DOF,U>::jacobian_callback(DMDALocalInfo *info,
 }
 
 template<int DOF, class U>
-SNESProblem<DOF, U>::SNESProblem(IceGrid::ConstPtr g)
+void SNESProblem<DOF,U>::compute_local_jacobian(DMDALocalInfo *info, const U **x, Mat B) {
+  (void) info;
+  (void) x;
+  (void) B;
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "SNESProblem %s does not implement an analytic Jacobian;"
+                                " use JACOBIAN_FD_COLORING", name().c_str());
+}
+
+template<int DOF, class U>
+SNESProblem<DOF, U>::SNESProblem(IceGrid::ConstPtr g, JacobianType jacobian)
   : m_grid(g) {
 
   PetscErrorCode ierr;
@@ -125,9 +149,11 @@ SNESProblem<DOF, U>::SNESProblem(IceGrid::ConstPtr g)
                                   &m_callbackData);
   PISM_CHK(ierr, "DMDASNESSetFunctionLocal");
 
-  ierr = DMDASNESSetJacobianLocal(*m_DA, (DMDASNESJacobian)SNESProblem<DOF, U>::jacobian_callback,
-                                  &m_callbackData);
-  PISM_CHK(ierr, "DMDASNESSetJacobianLocal");
+  if (jacobian != JACOBIAN_FD_COLORING) {
+    ierr = DMDASNESSetJacobianLocal(*m_DA, (DMDASNESJacobian)SNESProblem<DOF, U>::jacobian_callback,
+                                    &m_callbackData);
+    PISM_CHK(ierr, "DMDASNESSetJacobianLocal");
+  }
 
   ierr = DMSetMatType(*m_DA, "baij");
   PISM_CHK(ierr, "DMSetMatType");
@@ -138,6 +164,21 @@ SNESProblem<DOF, U>::SNESProblem(IceGrid::ConstPtr g)
   ierr = SNESSetDM(m_snes, *m_DA);
   PISM_CHK(ierr, "SNESSetDM");
 
+  if (jacobian == JACOBIAN_FD_COLORING) {
+    // The coloring of the DMDA stencil and the MatFDColoring are created during the first
+    // Jacobian evaluation and stored with the Jacobian matrix owned by m_snes, so they are
+    // re-used by all later solves (i.e. time steps) using this object.
+    ierr = SNESSetJacobian(m_snes, NULL, NULL, SNESComputeJacobianDefaultColor, NULL);
+    PISM_CHK(ierr, "SNESSetJacobian");
+  }
+
+  if (jacobian == JACOBIAN_MATRIX_FREE) {
+    // same as -snes_mf_operator: the matrix computed by compute_local_jacobian() is used
+    // to build the preconditioner only
+    ierr = SNESSetUseMatrixFree(m_snes, PETSC_TRUE, PETSC_FALSE);
+    PISM_CHK(ierr, "SNESSetUseMatrixFree");
+  }
+
   ierr = SNESSetFromOptions(m_snes);
   PISM_CHK(ierr, "SNESSetFromOptions");
 }
@@ -149,7 +190,8 @@ SNESProblem<DOF,U>::~SNESProblem() {
 
 template<int DOF, class U>
 const std::string& SNESProblem<DOF,U>::name() {
-  return "UnnamedProblem";
+  static const std::string result = "UnnamedProblem";
+  return result;
 }
 
 template<int DOF, class U>
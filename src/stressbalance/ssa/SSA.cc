@@ -16,6 +16,9 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>              // std::max
+#include <cmath>                  // std::abs
+
 #include "SSA.hh"
 #include "pism/basalstrength/basal_resistance.hh"
 #include "pism/util/EnthalpyConverter.hh"
@@ -27,6 +30,8 @@
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/Time.hh"
+#include "pism/util/Context.hh"
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/geometry/Geometry.hh"
 
@@ -73,7 +78,8 @@ double SSAStrengthExtension::get_min_thickness() const {
 
 
 SSA::SSA(IceGrid::ConstPtr g)
-  : ShallowStressBalance(g)
+  : ShallowStressBalance(g), m_nonlinear_iterations(0), m_linear_iterations(0),
+    m_reuse_count(0), m_reuse_ready(false)
 {
   strength_extension = new SSAStrengthExtension(*m_config);
 
@@ -112,6 +118,46 @@ SSA::SSA(IceGrid::ConstPtr g)
 
   m_da = m_velocity_global.dm();
 
+  {
+    std::string extrapolation = m_config->get_string("stress_balance.ssa.initial_guess_extrapolation");
+    if (extrapolation == "none") {
+      m_extrapolation_order = 0;
+    } else if (extrapolation == "linear") {
+      m_extrapolation_order = 1;
+    } else if (extrapolation == "quadratic") {
+      m_extrapolation_order = 2;
+    } else {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid stress_balance.ssa.initial_guess_extrapolation: %s",
+                                    extrapolation.c_str());
+    }
+
+    if (m_extrapolation_order > 0) {
+      for (unsigned int k = 0; k < m_extrapolation_order + 1; ++k) {
+        m_velocity_history.emplace_back(new IceModelVec2V(m_grid, "velocity_history",
+                                                          WITH_GHOSTS, WIDE_STENCIL));
+      }
+      m_velocity_previous.create(m_grid, "velocity_previous", WITH_GHOSTS, WIDE_STENCIL);
+    }
+  }
+
+  {
+    int max_steps = m_config->get_number("stress_balance.ssa.reuse.max_steps");
+    if (max_steps < 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.reuse.max_steps = %d is invalid"
+                                    " (has to be non-negative)", max_steps);
+    }
+    m_reuse_max_steps = max_steps;
+    m_reuse_tolerance = m_config->get_number("stress_balance.ssa.reuse.tolerance");
+
+    if (m_reuse_max_steps > 0) {
+      m_reuse_thickness.create(m_grid, "reuse_thickness", WITHOUT_GHOSTS);
+      m_reuse_tauc.create(m_grid, "reuse_tauc", WITHOUT_GHOSTS);
+      m_reuse_mask.create(m_grid, "reuse_mask", WITHOUT_GHOSTS);
+    }
+  }
+
   {
     rheology::FlowLawFactory ice_factory("stress_balance.ssa.", m_config, m_EC);
     ice_factory.remove(ICE_GOLDSBY_KOHLSTEDT);
@@ -156,6 +202,14 @@ void SSA::init_impl() {
   } else {
     m_velocity.set(0.0); // default initial guess
   }
+
+  if (m_reuse_max_steps > 0) {
+    m_log->message(2,
+                   "  re-using the SSA velocity for up to %d time steps\n"
+                   "  (unless ice thickness or basal yield stress change by more than %.1f%%)...\n",
+                   m_reuse_max_steps, m_reuse_tolerance * 100.0);
+  }
+  m_reuse_ready = false;
 }
 
 //! \brief Update the SSA solution.
@@ -175,7 +229,23 @@ void SSA::update(const Inputs &inputs, bool full_update) {
   }
 
   if (full_update) {
-    solve(inputs);
+    if (velocity_is_reusable(inputs)) {
+      m_nonlinear_iterations = 0;
+      m_linear_iterations    = 0;
+    } else {
+      if (m_extrapolation_order > 0) {
+        extrapolate_initial_guess(inputs);
+      }
+
+      solve(inputs);
+
+      if (m_extrapolation_order > 0) {
+        update_velocity_history();
+      }
+
+      record_solve_inputs(inputs);
+    }
+
     compute_basal_frictional_heating(m_velocity,
                                      *inputs.basal_yield_stress,
                                      m_mask,
@@ -345,10 +415,197 @@ std::string SSA::stdout_report() const {
   return m_stdout_ssa;
 }
 
+int SSA::nonlinear_iterations() const {
+  return m_nonlinear_iterations;
+}
+
+int SSA::linear_iterations() const {
+  return m_linear_iterations;
+}
+
 
 //! \brief Set the initial guess of the SSA velocity.
 void SSA::set_initial_guess(const IceModelVec2V &guess) {
   m_velocity.copy_from(guess);
+  // SSAFEM uses m_velocity_global as the initial guess
+  m_velocity_global.copy_from(guess);
+}
+
+double SSA::residual_norm(const Inputs &inputs) {
+  (void) inputs;
+  return -1.0;
+}
+
+//! Returns true if the velocity computed by the latest solve can be used in this update.
+/*!
+ * The velocity is re-used for at most `stress_balance.ssa.reuse.max_steps` consecutive
+ * updates, as long as the cell type does not change and the maximum relative change in
+ * ice thickness and basal yield stress since the latest solve is below
+ * `stress_balance.ssa.reuse.tolerance`. These changes are the estimate of the error
+ * caused by re-using the velocity: the driving stress is proportional to the thickness
+ * and the sliding velocity of plastic till depends on the yield stress.
+ *
+ * Decisions and relative changes are reported at the verbosity level 3.
+ */
+bool SSA::velocity_is_reusable(const Inputs &inputs) {
+  if (m_reuse_max_steps == 0 or not m_reuse_ready) {
+    return false;
+  }
+
+  if (m_reuse_count >= m_reuse_max_steps) {
+    m_log->message(3, "  SSA: solving (re-used the velocity %d times)\n", m_reuse_count);
+    return false;
+  }
+
+  const IceModelVec2S
+    &H    = inputs.geometry->ice_thickness,
+    &tauc = *inputs.basal_yield_stress;
+
+  // relative changes are computed using thickness of at least this value to avoid
+  // over-reacting to changes in very thin ice
+  const double H_min = std::max(m_config->get_number("stress_balance.ice_free_thickness_standard"),
+                                1.0);
+
+  // maximum relative changes in thickness and yield stress and cell type changes
+  double local_changes[3] = {0.0, 0.0, 0.0}, changes[3];
+
+  IceModelVec::AccessList list{&H, &tauc, &m_mask, &m_reuse_thickness, &m_reuse_tauc,
+                               &m_reuse_mask};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (m_mask.as_int(i, j) != m_reuse_mask.as_int(i, j)) {
+      local_changes[2] = 1.0;
+    }
+
+    if (not m_mask.icy(i, j)) {
+      continue;
+    }
+
+    const double
+      H_old    = m_reuse_thickness(i, j),
+      tauc_old = m_reuse_tauc(i, j);
+
+    local_changes[0] = std::max(local_changes[0],
+                                std::abs(H(i, j) - H_old) / std::max(H_old, H_min));
+
+    const double tauc_max = std::max(tauc(i, j), tauc_old);
+    if (tauc_max > 0.0) {
+      local_changes[1] = std::max(local_changes[1],
+                                  std::abs(tauc(i, j) - tauc_old) / tauc_max);
+    }
+  }
+
+  GlobalMax(m_grid->com, local_changes, changes, 3);
+
+  const bool reuse = (changes[2] == 0.0 and
+                      changes[0] < m_reuse_tolerance and
+                      changes[1] < m_reuse_tolerance);
+
+  m_log->message(3,
+                 "  SSA: %s (relative change since the last solve: thickness %.2e, yield stress %.2e%s)\n",
+                 reuse ? "re-using the velocity" : "solving",
+                 changes[0], changes[1], changes[2] > 0.0 ? ", cell type changed" : "");
+
+  if (reuse) {
+    m_reuse_count += 1;
+    m_stdout_ssa = pism::printf("  SSA: re-used the velocity (%d of %d)\n",
+                                m_reuse_count, m_reuse_max_steps);
+  }
+
+  return reuse;
+}
+
+//! Save inputs used by velocity_is_reusable() after a solve.
+void SSA::record_solve_inputs(const Inputs &inputs) {
+  m_reuse_count = 0;
+
+  if (m_reuse_max_steps == 0) {
+    return;
+  }
+
+  m_reuse_thickness.copy_from(inputs.geometry->ice_thickness);
+  m_reuse_tauc.copy_from(*inputs.basal_yield_stress);
+  m_reuse_mask.copy_from(m_mask);
+  m_reuse_ready = true;
+}
+
+//! Save the latest solution to be used by extrapolate_initial_guess().
+void SSA::update_velocity_history() {
+  const double t = m_grid->ctx()->time()->current();
+
+  // m_velocity_history contains pre-allocated fields; the oldest one is re-used to store
+  // the latest solution
+  if (m_velocity_history_times.empty() or t > m_velocity_history_times.front()) {
+    m_velocity_history.push_front(m_velocity_history.back());
+    m_velocity_history.pop_back();
+
+    m_velocity_history_times.push_front(t);
+    if (m_velocity_history_times.size() > m_velocity_history.size()) {
+      m_velocity_history_times.pop_back();
+    }
+  } else {
+    // repeated solve at the same time: replace the latest solution
+    m_velocity_history_times.front() = t;
+  }
+
+  m_velocity_history.front()->copy_from(m_velocity);
+}
+
+//! Replace `m_velocity` with the extrapolation of the velocity from previous time steps.
+/*!
+ * Uses the polynomial of degree `m_extrapolation_order` (or lower if there are not
+ * enough previous solutions) interpolating the latest SSA solutions.
+ *
+ * The extrapolated guess is used only if the norm of the SSA residual it corresponds to
+ * is smaller than the one corresponding to the previous solution (see residual_norm()).
+ */
+void SSA::extrapolate_initial_guess(const Inputs &inputs) {
+  const double t = m_grid->ctx()->time()->current();
+
+  const unsigned int N = std::min((size_t)m_extrapolation_order + 1,
+                                  m_velocity_history_times.size());
+
+  if (N < 2 or t <= m_velocity_history_times.front()) {
+    return;
+  }
+
+  const double residual_previous = residual_norm(inputs);
+  if (residual_previous < 0.0) {
+    // the residual is not available, so we can't check if extrapolation helps
+    return;
+  }
+
+  m_velocity_previous.copy_from(m_velocity);
+
+  // Lagrange interpolation weights
+  const std::deque<double> &T = m_velocity_history_times;
+  m_velocity.set(0.0);
+  for (unsigned int k = 0; k < N; ++k) {
+    double w = 1.0;
+    for (unsigned int l = 0; l < N; ++l) {
+      if (l != k) {
+        w *= (t - T[l]) / (T[k] - T[l]);
+      }
+    }
+    m_velocity.add(w, *m_velocity_history[k]);
+  }
+  m_velocity.update_ghosts();
+
+  const double residual_extrapolated = residual_norm(inputs);
+
+  if (residual_extrapolated < residual_previous) {
+    m_log->message(3, "  SSA: using the extrapolated initial guess (residual %e instead of %e)\n",
+                   residual_extrapolated, residual_previous);
+  } else {
+    m_log->message(3, "  SSA: using the previous solution as the initial guess (residual %e, extrapolated %e)\n",
+                   residual_previous, residual_extrapolated);
+    m_velocity.copy_from(m_velocity_previous);
+  }
+
+  // SSAFEM uses m_velocity_global as the initial guess
+  m_velocity_global.copy_from(m_velocity);
 }
 
 const IceModelVec2V& SSA::driving_stress() const {
@@ -22,6 +22,8 @@
 #include "pism/stressbalance/ShallowStressBalance.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 
+#include <deque>
+
 namespace pism {
 
 class Geometry;
@@ -121,6 +123,11 @@ public:
   virtual std::string stdout_report() const;
 
   const IceModelVec2V& driving_stress() const;
+
+  //! Number of nonlinear iterations in the last solve.
+  int nonlinear_iterations() const;
+  //! Total number of linear (KSP) iterations in the last solve.
+  int linear_iterations() const;
 protected:
   virtual void define_model_state_impl(const File &output) const;
   virtual void write_model_state_impl(const File &output) const;
@@ -137,15 +144,51 @@ protected:
 
   virtual void solve(const Inputs &inputs) = 0;
 
+  //! Norm of the residual of the discretized SSA system at the current `m_velocity`.
+  /*!
+   * Used to decide if an extrapolated initial guess is better than the previous
+   * solution. Returns a negative number if the residual is not available.
+   */
+  virtual double residual_norm(const Inputs &inputs);
+
+  void extrapolate_initial_guess(const Inputs &inputs);
+  void update_velocity_history();
+
+  bool velocity_is_reusable(const Inputs &inputs);
+  void record_solve_inputs(const Inputs &inputs);
+
   IceModelVec2CellType m_mask;
   IceModelVec2V m_taud;
 
   std::string m_stdout_ssa;
 
+  //! iteration counts of the last solve (set by implementations of solve())
+  int m_nonlinear_iterations;
+  int m_linear_iterations;
+
   // objects used by the SSA solver (internally)
   petsc::DM::Ptr  m_da;               // dof=2 DA
   IceModelVec2V m_velocity_global; // global vector for solution
 
+  //! degree of the polynomial used to extrapolate the initial guess (0: disabled)
+  unsigned int m_extrapolation_order;
+  //! SSA solutions at previous time steps (most recent first) and corresponding times
+  std::deque<IceModelVec2V::Ptr> m_velocity_history;
+  std::deque<double> m_velocity_history_times;
+  IceModelVec2V m_velocity_previous;
+
+  //! maximum number of consecutive full updates re-using the velocity (0: always solve)
+  unsigned int m_reuse_max_steps;
+  //! relative change in ice thickness or basal yield stress that requires a new solve
+  double m_reuse_tolerance;
+  //! number of consecutive full updates that re-used the velocity
+  unsigned int m_reuse_count;
+  //! true if m_reuse_* fields contain inputs of the latest solve
+  bool m_reuse_ready;
+  //! ice thickness, basal yield stress and cell type at the time of the latest solve
+  IceModelVec2S m_reuse_thickness, m_reuse_tauc;
+  IceModelVec2Int m_reuse_mask;
+
   // profiling
   int m_event_ssa;
 };
@@ -16,8 +16,12 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cmath>                // NAN, std::fabs
 #include <cassert>
 #include <stdexcept>
+#include <algorithm>            // std::min, std::max, std::copy, std::fill
+#include <fstream>
+#include <sstream>
 
 #include "SSAFD.hh"
 #include "SSAFD_diagnostics.hh"
@@ -32,6 +36,11 @@
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/AndersonAcceleration.hh"
+#include "pism/util/SinglePrecisionILU.hh"
+#include "pism/util/Profiling.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/io/autotune.hh"
 
 namespace pism {
 namespace stressbalance {
@@ -52,6 +61,54 @@ SSA* SSAFDFactory(IceGrid::ConstPtr g) {
   return new SSAFD(g);
 }
 
+//! A linear solver configuration tried by SSAFD autotuning (see pc_setup()).
+struct SolverChoice {
+  const char *name;
+  //! ASM overlap (0: use block Jacobi, i.e. pc_setup_bjacobi())
+  int asm_overlap;
+  //! preconditioner of ASM sub-domains
+  const char *sub_pc_type;
+};
+
+static const SolverChoice solver_choices[] = {
+  {"bjacobi",  0, ""},
+  {"asm1_lu",  1, PCLU},
+  {"asm2_lu",  2, PCLU},
+  {"asm1_ilu", 1, PCILU},
+  {"asm2_ilu", 2, PCILU},
+};
+
+static const int n_solver_choices = sizeof(solver_choices) / sizeof(solver_choices[0]);
+
+/*!
+ * Returns the solver configuration stored in `cache_file` for `key` or an empty string.
+ *
+ * Each line of the cache file contains a key followed by a configuration name and the
+ * time to convergence. Later entries override earlier ones.
+ */
+static std::string cached_solver_choice(const std::string &cache_file, const std::string &key) {
+  std::ifstream input(cache_file);
+
+  std::string result, line;
+  while (std::getline(input, line)) {
+    if (line.compare(0, key.size() + 1, key + " ") != 0) {
+      continue;
+    }
+
+    std::istringstream entry(line.substr(key.size() + 1));
+    std::string choice;
+    entry >> choice;
+
+    for (int k = 0; k < n_solver_choices; ++k) {
+      if (choice == solver_choices[k].name) {
+        result = choice;
+      }
+    }
+  }
+
+  return result;
+}
+
 /*!
 Because the FD implementation of the SSA uses Picard iteration, a PETSc KSP
 and Mat are used directly.  In particular we set up \f$A\f$
@@ -76,6 +133,21 @@ SSAFD::SSAFD(IceGrid::ConstPtr g)
                        units, units,
                        "", 0);
 
+  m_hardav.create(m_grid, "hardav", WITHOUT_GHOSTS);
+  m_hardav.set_attrs("internal",
+                     "vertically-averaged ice hardness (without fracture-induced softening)",
+                     units, units, "", 0);
+
+  m_hardav_thickness.create(m_grid, "hardav_thickness", WITHOUT_GHOSTS);
+  m_hardav_thickness.set_attrs("internal",
+                               "ice thickness used to compute vertically-averaged hardness",
+                               "m", "m", "", 0);
+  m_hardav_thickness.set(NAN);
+  m_hardav_enthalpy       = nullptr;
+  m_hardav_enthalpy_state = -1;
+  m_hardav_thickness_tolerance =
+    m_config->get_number("stress_balance.flow_law_cache.thickness_tolerance");
+
   m_nuH.create(m_grid, "nuH", WITH_GHOSTS);
   m_nuH.set_attrs("internal",
                   "ice thickness times effective viscosity",
@@ -95,6 +167,93 @@ SSAFD::SSAFD(IceGrid::ConstPtr g)
 
   m_scaling = 1.0e9;  // comparable to typical beta for an ice stream;
 
+  if (m_config->get_flag("stress_balance.ssa.fd.anderson.enabled")) {
+    int depth = m_config->get_number("stress_balance.ssa.fd.anderson.depth");
+    if (depth < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.fd.anderson.depth = %d is invalid"
+                                    " (has to be positive)", depth);
+    }
+    m_anderson.reset(new AndersonAcceleration(m_grid->com, depth));
+  }
+
+  {
+    int max_age = m_config->get_number("stress_balance.ssa.fd.preconditioner_reuse.max_solves");
+    if (max_age < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.fd.preconditioner_reuse.max_solves = %d"
+                                    " is invalid (has to be positive)", max_age);
+    }
+    m_pc_max_age              = max_age;
+    m_pc_max_iteration_ratio  = m_config->get_number("stress_balance.ssa.fd.preconditioner_reuse.max_iteration_ratio");
+    m_pc_age                  = 0;
+    m_pc_reference_iterations = 0;
+  }
+
+  m_coo_assembly = m_config->get_flag("stress_balance.ssa.fd.coo_assembly");
+  m_coo_ready    = false;
+#if !PETSC_VERSION_GE(3,15,0)
+  if (m_coo_assembly) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "stress_balance.ssa.fd.coo_assembly requires PETSc 3.15 or newer");
+  }
+#endif
+
+  const std::string matrix_type = m_config->get_string("stress_balance.ssa.fd.matrix_type");
+  m_blocked = (matrix_type == "baij");
+  m_device  = not (matrix_type == "aij" or m_blocked);
+#if !PETSC_VERSION_GE(3,14,0)
+  if (m_device) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "stress_balance.ssa.fd.matrix_type = %s requires PETSc 3.14 or newer",
+                                  matrix_type.c_str());
+  }
+#endif
+
+  m_active_set = m_config->get_flag("stress_balance.ssa.fd.active_set");
+  if (m_active_set and not m_config->get_flag("stress_balance.calving_front_stress_bc")) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "stress_balance.ssa.fd.active_set requires stress_balance.calving_front_stress_bc");
+  }
+
+  if (m_config->get_flag("stress_balance.ssa.fd.single_precision_preconditioner")) {
+    if (m_device or m_blocked) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.fd.single_precision_preconditioner is not supported"
+                                    " with stress_balance.ssa.fd.matrix_type = %s",
+                                    matrix_type.c_str());
+    }
+    m_pc_single.reset(new SinglePrecisionILU());
+    m_solver_pc_single.reset(new SinglePrecisionILU());
+  }
+
+  if (m_blocked and m_active_set) {
+    // the restriction to active unknowns is not compatible with the block structure
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "stress_balance.ssa.fd.active_set is not supported"
+                       " with stress_balance.ssa.fd.matrix_type = baij");
+  }
+
+  m_use_subcommunicator = m_config->get_flag("stress_balance.ssa.fd.subcommunicator.enabled");
+  m_subcommunicator_threshold = m_config->get_number("stress_balance.ssa.fd.subcommunicator.threshold");
+  if (m_use_subcommunicator and not m_active_set) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "stress_balance.ssa.fd.subcommunicator.enabled requires stress_balance.ssa.fd.active_set");
+  }
+  if (m_use_subcommunicator and m_device) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "stress_balance.ssa.fd.subcommunicator.enabled is not supported"
+                                  " with stress_balance.ssa.fd.matrix_type = %s",
+                                  matrix_type.c_str());
+  }
+  m_solver_com_in_use = false;
+  m_solver_com        = MPI_COMM_NULL;
+  m_solver_root       = 0;
+
+  m_asm_overlap      = 1;
+  m_asm_sub_pc_type  = PCLU;
+  m_autotune_step    = n_solver_choices;
+
   // The nuH viewer:
   m_view_nuh = false;
   m_nuh_viewer_size = 300;
@@ -102,7 +261,9 @@ SSAFD::SSAFD(IceGrid::ConstPtr g)
   // PETSc objects and settings
   {
     PetscErrorCode ierr;
-    ierr = DMSetMatType(*m_da, MATAIJ);
+    // the DM is shared with other 2-component fields, so we set the matrix type right
+    // before creating m_A
+    ierr = DMSetMatType(*m_da, matrix_type.c_str());
     PISM_CHK(ierr, "DMSetMatType");
 
     ierr = DMCreateMatrix(*m_da, m_A.rawptr());
@@ -123,10 +284,96 @@ SSAFD::SSAFD(IceGrid::ConstPtr g)
     ierr = KSPConvergedDefaultSetUIRNorm(m_KSP);
     PISM_CHK(ierr, "KSPConvergedDefaultSetUIRNorm");
   }
+
+  update_solver_memory_use();
 }
 
 SSAFD::~SSAFD() {
-  // empty
+  // PETSc objects using m_solver_com have to be destroyed before it is freed (errors are
+  // ignored: destructors should not throw)
+  KSPDestroy(m_solver_KSP.rawptr());
+  MatDestroy(m_solver_A.rawptr());
+  MatDestroy(m_solver_A_local.rawptr());
+
+  if (m_solver_com != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_solver_com);
+  }
+}
+
+//! Record an estimate of the memory used by the system matrix and the Krylov solver.
+/*!
+ * PETSc does not report the size of the KSP workspace, so we assume that the solver
+ * uses the GMRES basis (restart + 1 vectors) plus a few work vectors and that the
+ * preconditioner is about as big as the matrix (half as big if it is stored in single
+ * precision).
+ */
+void SSAFD::update_solver_memory_use() {
+  PetscErrorCode ierr;
+
+  MatInfo info;
+  ierr = MatGetInfo(m_A, MAT_LOCAL, &info);
+  PISM_CHK(ierr, "MatGetInfo");
+
+  double matrix = info.nz_allocated * (sizeof(PetscScalar) + sizeof(PetscInt));
+
+  double preconditioner = matrix;
+  if (m_pc_single) {
+    preconditioner = info.nz_allocated * (sizeof(float) + sizeof(int));
+  }
+
+  PetscInt n = 0;
+  ierr = VecGetLocalSize(m_b.vec(), &n);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  PetscInt restart = 30;
+  PetscBool gmres = PETSC_FALSE;
+  ierr = PetscObjectTypeCompare((PetscObject)m_KSP.get(), KSPGMRES, &gmres);
+  PISM_CHK(ierr, "PetscObjectTypeCompare");
+  if (gmres) {
+    ierr = KSPGMRESGetRestart(m_KSP, &restart);
+    PISM_CHK(ierr, "KSPGMRESGetRestart");
+  }
+
+  double vectors = (restart + 4) * n * sizeof(PetscScalar);
+
+  m_solver_memory.set(m_grid->ctx()->memory_usage(), "solvers", matrix + preconditioner + vectors);
+}
+
+//! Returns true if the next KSP solve should re-use the current preconditioner.
+/*!
+ * The preconditioner is re-used for at most
+ * `stress_balance.ssa.fd.preconditioner_reuse.max_solves` solves (both within the Picard
+ * iteration and across time steps: the matrix changes slowly in both cases). It is
+ * re-built sooner if the number of KSP iterations grows by a factor exceeding
+ * `stress_balance.ssa.fd.preconditioner_reuse.max_iteration_ratio` compared to the first
+ * solve with this preconditioner.
+ */
+bool SSAFD::reuse_preconditioner() const {
+  return m_pc_age > 0 and m_pc_age < m_pc_max_age;
+}
+
+//! Update preconditioner reuse bookkeeping after a successful KSP solve.
+void SSAFD::update_preconditioner_age(bool reused, int ksp_iterations) {
+  if (not reused) {
+    m_pc_age = 1;
+    m_pc_reference_iterations = ksp_iterations;
+    return;
+  }
+
+  m_pc_age += 1;
+
+  if (ksp_iterations > m_pc_max_iteration_ratio * std::max(m_pc_reference_iterations, 1)) {
+    // convergence degraded: re-build the preconditioner before the next solve
+    m_pc_age = m_pc_max_age;
+  }
+}
+
+//! Reset preconditioner reuse bookkeeping if the preconditioner type changed.
+void SSAFD::set_preconditioner_type(const std::string &type) {
+  if (type != m_pc_type) {
+    m_pc_type = type;
+    m_pc_age  = 0;
+  }
 }
 
 //! @note Uses `PetscErrorCode` *intentionally*.
@@ -134,23 +381,50 @@ void SSAFD::pc_setup_bjacobi() {
   PetscErrorCode ierr;
   PC pc;
 
+  if (m_pc_max_age > 1 and m_pc_type.find("bjacobi:") == 0) {
+    // Already set up. Re-configuring would destroy the preconditioner if the user
+    // selected a PC type other than PCBJACOBI.
+    return;
+  }
+
   ierr = KSPSetType(m_KSP, KSPGMRES);
   PISM_CHK(ierr, "KSPSetType");
 
-  ierr = KSPSetOperators(m_KSP, m_A, m_A);
-  PISM_CHK(ierr, "KSPSetOperators");
+  {
+    Mat A = system_matrix();
+    ierr = KSPSetOperators(m_KSP, A, A);
+    PISM_CHK(ierr, "KSPSetOperators");
+  }
 
   // Get the PC from the KSP solver:
   ierr = KSPGetPC(m_KSP, &pc);
   PISM_CHK(ierr, "KSPGetPC");
 
   // Set the PC type:
-  ierr = PCSetType(pc, PCBJACOBI);
-  PISM_CHK(ierr, "PCSetType");
+  if (m_pc_single) {
+    m_pc_single->configure(pc);
+  } else {
+    ierr = PCSetType(pc, PCBJACOBI);
+    PISM_CHK(ierr, "PCSetType");
+  }
 
   // Process options:
   ierr = KSPSetFromOptions(m_KSP);
   PISM_CHK(ierr, "KSPSetFromOptions");
+
+  // The user may have selected a different PC type (e.g. -ssafd_pc_type gamg).
+  PCType pc_type;
+  ierr = PCGetType(pc, &pc_type);
+  PISM_CHK(ierr, "PCGetType");
+
+  // Re-use GAMG interpolation operators (the coarse grid hierarchy) when the
+  // preconditioner is re-built: the matrix changes slowly when the SSA is re-solved.
+  if (std::string(pc_type) == PCGAMG and m_pc_max_age > 1) {
+    ierr = PCGAMGSetReuseInterpolation(pc, PETSC_TRUE);
+    PISM_CHK(ierr, "PCGAMGSetReuseInterpolation");
+  }
+
+  set_preconditioner_type(std::string("bjacobi:") + pc_type);
 }
 
 //! @note Uses `PetscErrorCode` *intentionally*.
@@ -164,8 +438,11 @@ void SSAFD::pc_setup_asm() {
   ierr = KSPSetType(m_KSP, KSPGMRES);
   PISM_CHK(ierr, "KSPSetType");
 
-  ierr = KSPSetOperators(m_KSP, m_A, m_A);
-  PISM_CHK(ierr, "KSPSetOperators");
+  {
+    Mat A = system_matrix();
+    ierr = KSPSetOperators(m_KSP, A, A);
+    PISM_CHK(ierr, "KSPSetOperators");
+  }
 
   // Switch to using the "unpreconditioned" norm.
   ierr = KSPSetNormType(m_KSP, KSP_NORM_UNPRECONDITIONED);
@@ -183,6 +460,9 @@ void SSAFD::pc_setup_asm() {
   ierr = PCSetType(pc, PCASM);
   PISM_CHK(ierr, "PCSetType");
 
+  ierr = PCASMSetOverlap(pc, m_asm_overlap);
+  PISM_CHK(ierr, "PCASMSetOverlap");
+
   // Set the sub-KSP object to "preonly"
   KSP *sub_ksp;
   ierr = PCSetUp(pc);
@@ -194,17 +474,44 @@ void SSAFD::pc_setup_asm() {
   ierr = KSPSetType(*sub_ksp, KSPPREONLY);
   PISM_CHK(ierr, "KSPSetType");
 
-  // Set the PC of the sub-KSP to "LU".
+  // Set the PC of the sub-KSP to "LU" (or the type chosen by autotuning).
   ierr = KSPGetPC(*sub_ksp, &sub_pc);
   PISM_CHK(ierr, "KSPGetPC");
 
-  ierr = PCSetType(sub_pc, PCLU);
+  ierr = PCSetType(sub_pc, m_asm_sub_pc_type.c_str());
   PISM_CHK(ierr, "PCSetType");
 
   // Let the user override all this:
   // Process options:
   ierr = KSPSetFromOptions(m_KSP);
   PISM_CHK(ierr, "KSPSetFromOptions");
+
+  // PCSetUp() above built a new preconditioner
+  m_pc_type = pism::printf("asm:%d:%s", m_asm_overlap, m_asm_sub_pc_type.c_str());
+  m_pc_age  = 0;
+}
+
+//! Set up the preconditioner using the configuration `choice` (one of `solver_choices`).
+void SSAFD::pc_setup(const std::string &choice) {
+  for (int k = 0; k < n_solver_choices; ++k) {
+    const SolverChoice &c = solver_choices[k];
+
+    if (choice != c.name) {
+      continue;
+    }
+
+    if (c.asm_overlap > 0) {
+      m_asm_overlap     = c.asm_overlap;
+      m_asm_sub_pc_type = c.sub_pc_type;
+      pc_setup_asm();
+    } else {
+      pc_setup_bjacobi();
+    }
+    return;
+  }
+
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "invalid SSAFD solver configuration: %s", choice.c_str());
 }
 
 void SSAFD::init_impl() {
@@ -224,8 +531,46 @@ void SSAFD::init_impl() {
                "  using PISM-PIK calving-front stress boundary condition ...\n");
   }
 
+  if (m_anderson) {
+    m_log->message(2,
+                   "  using Anderson acceleration of Picard iterations (depth %d) ...\n",
+                   (int)m_config->get_number("stress_balance.ssa.fd.anderson.depth"));
+  }
+
+  if (m_config->get_flag("stress_balance.ssa.fd.eisenstat_walker.enabled")) {
+    m_log->message(2,
+                   "  using Eisenstat-Walker KSP tolerances in Picard iterations ...\n");
+  }
+
   m_default_pc_failure_count     = 0;
   m_default_pc_failure_max_count = 5;
+
+  if (m_config->get_flag("stress_balance.ssa.fd.autotune.enabled")) {
+    std::string cache_file = m_config->get_string("stress_balance.ssa.fd.autotune.cache_file");
+
+    m_autotune_key = pism::printf("%s %d %d %d",
+                                  io::cluster_name().c_str(), (int)m_grid->size(),
+                                  (int)m_grid->Mx(), (int)m_grid->My());
+
+    // all ranks have to use the same configuration
+    std::vector<char> choice(64, '\0');
+    if (not cache_file.empty() and m_grid->rank() == 0) {
+      std::string tmp = cached_solver_choice(cache_file, m_autotune_key);
+      std::copy(tmp.begin(), tmp.end(), choice.begin());
+    }
+    MPI_Bcast(choice.data(), choice.size(), MPI_CHAR, 0, m_grid->com);
+    m_solver_choice = choice.data();
+
+    if (not m_solver_choice.empty()) {
+      m_log->message(2, "  using the SSAFD solver configuration '%s' (found in '%s') ...\n",
+                     m_solver_choice.c_str(), cache_file.c_str());
+    } else {
+      m_log->message(2, "  choosing the fastest SSAFD solver configuration during the first %d solves ...\n",
+                     n_solver_choices + 1);
+      m_autotune_step = -1;
+      m_autotune_times.clear();
+    }
+  }
 }
 
 //! \brief Computes the right-hand side ("rhs") of the linear problem for the
@@ -292,6 +637,9 @@ void SSAFD::assemble_rhs(const Inputs &inputs) {
 
   m_b.set(0.0);
 
+  // compact copy of the cell type mask (to reduce memory traffic)
+  const auto &cell_type = m_mask.compact();
+
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
@@ -304,7 +652,7 @@ void SSAFD::assemble_rhs(const Inputs &inputs) {
     if (use_cfbc) {
       double H_ij = thickness(i,j);
 
-      auto M = m_mask.int_star(i, j);
+      auto M = cell_type.int_star(i, j);
 
       // Note: this sets velocities at both ice-free ocean and ice-free
       // bedrock to zero. This means that we need to set boundary conditions
@@ -512,8 +860,15 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
   // FIXME: bedrock_boundary is a misleading name
   const bool bedrock_boundary = m_config->get_flag("stress_balance.ssa.dirichlet_bc");
 
-  ierr = MatZeroEntries(A);
-  PISM_CHK(ierr, "MatZeroEntries");
+  const bool coo = use_coo(A);
+  if (coo) {
+    if (not m_coo_ready) {
+      coo_setup();
+    }
+  } else {
+    ierr = MatZeroEntries(A);
+    PISM_CHK(ierr, "MatZeroEntries");
+  }
 
   IceModelVec::AccessList list{&m_nuH, &tauc, &vel, &m_mask, &bed, &surface};
 
@@ -535,6 +890,9 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
   double lateral_drag_viscosity=m_config->get_number("stress_balance.ssa.fd.lateral_drag.viscosity");
   double HminFrozen=0.0;
 
+  // compact copy of the cell type mask (to reduce memory traffic)
+  const auto &cell_type = m_mask.compact();
+
   /* matrix assembly loop */
   ParallelSection loop(m_grid->com);
   try {
@@ -565,7 +923,7 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
         // be prescribed and is a temperature-independent free (user determined) parameter
 
         // direct neighbors
-        auto M = m_mask.int_star(i, j);
+        auto M = cell_type.int_star(i, j);
         auto H = thickness.star(i, j);
         auto b = bed.star(i, j);
         double h = surface(i, j);
@@ -612,10 +970,10 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
       int NNW = 1, NNE = 1, SSW = 1, SSE = 1;
       int WNW = 1, ENE = 1, WSW = 1, ESE = 1;
 
-      int M_ij = m_mask.as_int(i,j);
+      int M_ij = cell_type.as_int(i,j);
 
       if (use_cfbc) {
-        auto M = m_mask.int_box(i, j);
+        auto M = cell_type.int_box(i, j);
 
         // Note: this sets velocities at both ice-free ocean and ice-free
         // bedrock to zero. This means that we need to set boundary conditions
@@ -774,7 +1132,7 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
         // Set very high basal drag *in the direction along the boundary* at locations
         // bordering "fjord walls".
 
-        auto M = m_mask.int_star(i, j);
+        auto M = cell_type.int_star(i, j);
         auto b = bed.star(i, j);
         double h = surface(i, j);
 
@@ -812,8 +1170,37 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
         }
       }
 
+      if (coo) {
+        std::copy(eq1, eq1 + n_nonzeros, coo_row(i, j, 0));
+        std::copy(eq2, eq2 + n_nonzeros, coo_row(i, j, 1));
+        continue;
+      }
+
       row.i = i;
       row.j = j;
+
+      if (m_blocked) {
+        // one row of 2x2 blocks: the stencil has 9 points; entries of the block at the
+        // point s are (eq1[s], eq1[9 + s]; eq2[s], eq2[9 + s])
+        const int n_blocks = n_nonzeros / 2;
+        double values[2 * n_nonzeros];
+        for (int s = 0; s < n_blocks; ++s) {
+          col[s].i = I[s];
+          col[s].j = J[s];
+          col[s].c = 0;
+
+          values[2 * s + 0]              = eq1[s];
+          values[2 * s + 1]              = eq1[n_blocks + s];
+          values[n_nonzeros + 2 * s + 0] = eq2[s];
+          values[n_nonzeros + 2 * s + 1] = eq2[n_blocks + s];
+        }
+
+        row.c = 0;
+        ierr = MatSetValuesBlockedStencil(A, 1, &row, n_blocks, col, values, INSERT_VALUES);
+        PISM_CHK(ierr, "MatSetValuesBlockedStencil");
+        continue;
+      }
+
       for (int m = 0; m < n_nonzeros; m++) {
         col[m].i = I[m];
         col[m].j = J[m];
@@ -835,11 +1222,19 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
   }
   loop.check();
 
-  ierr = MatAssemblyBegin(A, MAT_FINAL_ASSEMBLY);
-  PISM_CHK(ierr, "MatAssemblyBegin");
+  if (coo) {
+#if PETSC_VERSION_GE(3,15,0)
+    // MatSetValuesCOO() assembles the matrix
+    ierr = MatSetValuesCOO(A, m_coo_values.data(), INSERT_VALUES);
+    PISM_CHK(ierr, "MatSetValuesCOO");
+#endif
+  } else {
+    ierr = MatAssemblyBegin(A, MAT_FINAL_ASSEMBLY);
+    PISM_CHK(ierr, "MatAssemblyBegin");
 
-  ierr = MatAssemblyEnd(A, MAT_FINAL_ASSEMBLY);
-  PISM_CHK(ierr, "MatAssemblyEnd");
+    ierr = MatAssemblyEnd(A, MAT_FINAL_ASSEMBLY);
+    PISM_CHK(ierr, "MatAssemblyEnd");
+  }
 #if (Pism_DEBUG==1)
   ierr = MatSetOption(A,MAT_NEW_NONZERO_LOCATION_ERR,PETSC_TRUE);
   PISM_CHK(ierr, "MatSetOption");
@@ -903,6 +1298,9 @@ but it may be worthwhile.  Note the user can already do `-pc_type asm
 FIXME: update this doxygen comment
 */
 void SSAFD::solve(const Inputs &inputs) {
+  const Profiling &profiling = m_grid->ctx()->profiling();
+
+  profiling.begin("ssa");
 
   // Store away old SSA velocity (it might be needed in case a solver
   // fails).
@@ -913,6 +1311,7 @@ void SSAFD::solve(const Inputs &inputs) {
   {
     assemble_rhs(inputs);
     compute_hardav_staggered(inputs);
+    update_active_set(inputs);
   }
 
   for (unsigned int k = 0; k < 3; ++k) {
@@ -953,12 +1352,645 @@ void SSAFD::solve(const Inputs &inputs) {
 
     m_velocity.update_ghosts();
   }
+
+  update_solver_memory_use();
+
+  profiling.end("ssa");
+}
+
+//! Copy values of `source` to `destination` (which may have a different type).
+static void copy_values(Vec source, Vec destination) {
+  PetscErrorCode ierr;
+
+  PetscInt n = 0;
+  ierr = VecGetLocalSize(source, &n);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  const PetscScalar *input = NULL;
+  ierr = VecGetArrayRead(source, &input);
+  PISM_CHK(ierr, "VecGetArrayRead");
+
+  PetscScalar *output = NULL;
+#if PETSC_VERSION_GE(3,12,0)
+  // does not copy old values from the device
+  ierr = VecGetArrayWrite(destination, &output);
+  PISM_CHK(ierr, "VecGetArrayWrite");
+#else
+  ierr = VecGetArray(destination, &output);
+  PISM_CHK(ierr, "VecGetArray");
+#endif
+
+  std::copy(input, input + n, output);
+
+#if PETSC_VERSION_GE(3,12,0)
+  ierr = VecRestoreArrayWrite(destination, &output);
+  PISM_CHK(ierr, "VecRestoreArrayWrite");
+#else
+  ierr = VecRestoreArray(destination, &output);
+  PISM_CHK(ierr, "VecRestoreArray");
+#endif
+
+  ierr = VecRestoreArrayRead(source, &input);
+  PISM_CHK(ierr, "VecRestoreArrayRead");
+}
+
+//! Compute the norm of the residual `A(u) u - b` of the SSAFD system at `m_velocity`.
+/*!
+ * Uses the regularization `stress_balance.ssa.epsilon` in the computation of `\nu H`.
+ * Modifies m_b, m_hardness, m_nuH, m_A, and m_velocity_global.
+ */
+double SSAFD::residual_norm(const Inputs &inputs) {
+  PetscErrorCode ierr;
+
+  assemble_rhs(inputs);
+  compute_hardav_staggered(inputs);
+
+  const double epsilon = m_config->get_number("stress_balance.ssa.epsilon");
+  if (m_config->get_flag("stress_balance.calving_front_stress_bc")) {
+    compute_nuH_staggered_cfbc(*inputs.geometry, epsilon, m_nuH);
+  } else {
+    compute_nuH_staggered(*inputs.geometry, epsilon, m_nuH);
+  }
+
+  assemble_matrix(inputs, true, m_A);
+
+  m_velocity_global.copy_from(m_velocity);
+
+  // vectors of the type matching m_A (see stress_balance.ssa.fd.matrix_type)
+  petsc::Vec u, residual;
+  ierr = MatCreateVecs(m_A, u.rawptr(), residual.rawptr());
+  PISM_CHK(ierr, "MatCreateVecs");
+
+  copy_values(m_velocity_global.vec(), u);
+  copy_values(m_b.vec(), residual);
+
+  // residual = A u - b
+  ierr = VecScale(residual, -1.0);
+  PISM_CHK(ierr, "VecScale");
+
+  ierr = MatMultAdd(m_A, u, residual, residual);
+  PISM_CHK(ierr, "MatMultAdd");
+
+  double result = 0.0;
+  ierr = VecNorm(residual, NORM_2, &result);
+  PISM_CHK(ierr, "VecNorm");
+
+  return result;
+}
+
+/*!
+ * Update the set of active (icy and Dirichlet B.C.) unknowns used if
+ * `stress_balance.ssa.fd.active_set` is set.
+ *
+ * With the calving front boundary condition rows of the system corresponding to
+ * ice-free cells reduce to `u = 0` and do not couple to other unknowns, so these
+ * unknowns can be removed from the system.
+ *
+ * The index set is re-built only if the ice extent changed.
+ */
+void SSAFD::update_active_set(const Inputs &inputs) {
+  if (not m_active_set) {
+    return;
+  }
+
+  PetscErrorCode ierr;
+
+  std::vector<int> active(m_grid->xm() * m_grid->ym());
+  {
+    IceModelVec::AccessList list{&m_mask};
+    if (inputs.bc_values and inputs.bc_mask) {
+      list.add(*inputs.bc_mask);
+    }
+
+    unsigned int n = 0;
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      bool dirichlet = (inputs.bc_values and inputs.bc_mask and
+                        inputs.bc_mask->as_int(i, j) == 1);
+
+      active[n] = dirichlet or icy(m_mask.as_int(i, j));
+      n += 1;
+    }
+  }
+
+  bool changed = GlobalMax(m_grid->com, active != m_active_cells ? 1.0 : 0.0) > 0.0;
+  if (not changed and m_active_is != NULL) {
+    return;
+  }
+
+  m_active_cells = active;
+
+  PetscInt low = 0, high = 0;
+  ierr = VecGetOwnershipRange(m_b.vec(), &low, &high);
+  PISM_CHK(ierr, "VecGetOwnershipRange");
+
+  // the order of Points matches the ordering of unknowns in a DMDA Vec
+  std::vector<PetscInt> indices;
+  for (unsigned int n = 0; n < active.size(); ++n) {
+    if (active[n]) {
+      indices.push_back(low + 2 * n + 0);
+      indices.push_back(low + 2 * n + 1);
+    }
+  }
+
+  unsigned int n_active = GlobalSum(m_grid->com, (unsigned int)indices.size());
+  if (n_active == 0) {
+    // no ice: solve the full system
+    for (unsigned int n = 0; n < active.size(); ++n) {
+      indices.push_back(low + 2 * n + 0);
+      indices.push_back(low + 2 * n + 1);
+    }
+  }
+
+  ierr = ISDestroy(m_active_is.rawptr());
+  PISM_CHK(ierr, "ISDestroy");
+
+  ierr = ISCreateGeneral(m_grid->com, indices.size(), indices.data(), PETSC_COPY_VALUES,
+                         m_active_is.rawptr());
+  PISM_CHK(ierr, "ISCreateGeneral");
+
+  // the size of the system changed: destroy the sub-matrix and all the objects
+  // (preconditioner, etc) that depend on it
+  ierr = MatDestroy(m_A_active.rawptr());
+  PISM_CHK(ierr, "MatDestroy");
+
+  ierr = VecDestroy(m_device_x.rawptr());
+  PISM_CHK(ierr, "VecDestroy");
+
+  ierr = VecDestroy(m_device_b.rawptr());
+  PISM_CHK(ierr, "VecDestroy");
+
+  ierr = KSPReset(m_KSP);
+  PISM_CHK(ierr, "KSPReset");
+
+  m_pc_type.clear();
+  m_pc_age = 0;
+
+  // with no ice all ranks own unknowns of the (full) system
+  update_subcommunicator(active, not indices.empty());
+
+  m_log->message(3, "  SSAFD: solving for %d of %d unknowns\n",
+                 (int)GlobalSum(m_grid->com, (unsigned int)indices.size()),
+                 (int)(2 * m_grid->Mx() * m_grid->My()));
+}
+
+//! Destroy the linear solver using m_solver_com and objects it depends on.
+void SSAFD::destroy_subcommunicator_solver() {
+  PetscErrorCode ierr;
+
+  ierr = KSPDestroy(m_solver_KSP.rawptr());
+  PISM_CHK(ierr, "KSPDestroy");
+
+  ierr = MatDestroy(m_solver_A.rawptr());
+  PISM_CHK(ierr, "MatDestroy");
+
+  ierr = MatDestroy(m_solver_A_local.rawptr());
+  PISM_CHK(ierr, "MatDestroy");
+
+  m_solver_pc_type.clear();
+}
+
+/*!
+ * Update the sub-communicator containing ranks that own active unknowns (used if
+ * `stress_balance.ssa.fd.subcommunicator.enabled` is set).
+ *
+ * Excluding ranks that own no active unknowns from linear solves reduces the cost of
+ * global reductions and halo exchanges.
+ *
+ * A rank that owns no active unknowns can stay in the sub-communicator (it owns no
+ * rows of the system in this case), so the sub-communicator is re-created only if
+ * an excluded rank gets active unknowns or if the fraction of cells that changed their
+ * status since the sub-communicator was created exceeds
+ * `stress_balance.ssa.fd.subcommunicator.threshold`.
+ *
+ * @param[in] active active cell flags (see update_active_set())
+ * @param[in] owns_unknowns true if this rank owns unknowns in `m_active_is`
+ */
+void SSAFD::update_subcommunicator(const std::vector<int> &active, bool owns_unknowns) {
+  // the system matrix changed size: the solver has to be re-created
+  destroy_subcommunicator_solver();
+
+  if (not m_use_subcommunicator) {
+    return;
+  }
+
+  const int member = owns_unknowns;
+
+  bool rebuild = m_solver_com_cells.empty();
+  if (not rebuild) {
+    const bool excluded = m_solver_com_in_use and m_solver_com == MPI_COMM_NULL;
+    const bool forced   = GlobalMax(m_grid->com, (excluded and member) ? 1.0 : 0.0) > 0.0;
+
+    unsigned int n_changed = 0;
+    for (unsigned int n = 0; n < active.size(); ++n) {
+      if (active[n] != m_solver_com_cells[n]) {
+        n_changed += 1;
+      }
+    }
+    n_changed = GlobalSum(m_grid->com, n_changed);
+
+    rebuild = forced or n_changed > m_subcommunicator_threshold * m_grid->Mx() * m_grid->My();
+  }
+
+  if (not rebuild) {
+    return;
+  }
+
+  if (m_solver_com != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_solver_com);
+    m_solver_com = MPI_COMM_NULL;
+  }
+  m_solver_com_cells = active;
+
+  const int
+    rank      = m_grid->rank(),
+    size      = m_grid->size(),
+    n_members = GlobalSum(m_grid->com, (unsigned int)member);
+
+  // If there is no ice update_active_set() uses the full system, so all ranks are needed.
+  if (n_members == 0 or n_members == size) {
+    m_solver_com_in_use = false;
+    m_log->message(3, "  SSAFD: solving using all %d MPI processes\n", size);
+    return;
+  }
+
+  int ierr = MPI_Comm_split(m_grid->com, member ? 0 : MPI_UNDEFINED, rank, &m_solver_com);
+  if (ierr != MPI_SUCCESS) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "MPI_Comm_split failed");
+  }
+
+  m_solver_com_in_use = true;
+  m_solver_root       = GlobalMin(m_grid->com, member ? rank : size);
+
+  m_log->message(3, "  SSAFD: solving using %d of %d MPI processes\n", n_members, size);
+}
+
+//! Configure m_solver_KSP to match m_KSP (as set up by pc_setup_bjacobi() or pc_setup_asm()).
+void SSAFD::configure_subcommunicator_solver() {
+  PetscErrorCode ierr;
+
+  if (m_solver_KSP == NULL) {
+    ierr = KSPCreate(m_solver_com, m_solver_KSP.rawptr());
+    PISM_CHK(ierr, "KSPCreate");
+
+    ierr = KSPSetOptionsPrefix(m_solver_KSP, "ssafd_");
+    PISM_CHK(ierr, "KSPSetOptionsPrefix");
+
+    ierr = KSPSetInitialGuessNonzero(m_solver_KSP, PETSC_TRUE);
+    PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
+
+    ierr = KSPConvergedDefaultSetUIRNorm(m_solver_KSP);
+    PISM_CHK(ierr, "KSPConvergedDefaultSetUIRNorm");
+  }
+
+  KSPType ksp_type;
+  ierr = KSPGetType(m_KSP, &ksp_type);
+  PISM_CHK(ierr, "KSPGetType");
+
+  ierr = KSPSetType(m_solver_KSP, ksp_type);
+  PISM_CHK(ierr, "KSPSetType");
+
+  KSPNormType norm_type;
+  ierr = KSPGetNormType(m_KSP, &norm_type);
+  PISM_CHK(ierr, "KSPGetNormType");
+
+  ierr = KSPSetNormType(m_solver_KSP, norm_type);
+  PISM_CHK(ierr, "KSPSetNormType");
+
+  PCSide pc_side;
+  ierr = KSPGetPCSide(m_KSP, &pc_side);
+  PISM_CHK(ierr, "KSPGetPCSide");
+
+  ierr = KSPSetPCSide(m_solver_KSP, pc_side);
+  PISM_CHK(ierr, "KSPSetPCSide");
+
+  ierr = KSPSetOperators(m_solver_KSP, m_solver_A, m_solver_A);
+  PISM_CHK(ierr, "KSPSetOperators");
+
+  PC pc, solver_pc;
+  ierr = KSPGetPC(m_KSP, &pc);
+  PISM_CHK(ierr, "KSPGetPC");
+
+  ierr = KSPGetPC(m_solver_KSP, &solver_pc);
+  PISM_CHK(ierr, "KSPGetPC");
+
+  PCType pc_type;
+  ierr = PCGetType(pc, &pc_type);
+  PISM_CHK(ierr, "PCGetType");
+
+  ierr = PCSetType(solver_pc, pc_type);
+  PISM_CHK(ierr, "PCSetType");
+
+  if (std::string(pc_type) == PCASM) {
+    // same as in pc_setup_asm()
+    ierr = PCASMSetOverlap(solver_pc, m_asm_overlap);
+    PISM_CHK(ierr, "PCASMSetOverlap");
+
+    KSP *sub_ksp;
+    ierr = PCSetUp(solver_pc);
+    PISM_CHK(ierr, "PCSetUp");
+
+    ierr = PCASMGetSubKSP(solver_pc, NULL, NULL, &sub_ksp);
+    PISM_CHK(ierr, "PCASMGetSubKSP");
+
+    ierr = KSPSetType(*sub_ksp, KSPPREONLY);
+    PISM_CHK(ierr, "KSPSetType");
+
+    PC sub_pc;
+    ierr = KSPGetPC(*sub_ksp, &sub_pc);
+    PISM_CHK(ierr, "KSPGetPC");
+
+    ierr = PCSetType(sub_pc, m_asm_sub_pc_type.c_str());
+    PISM_CHK(ierr, "PCSetType");
+  } else if (std::string(pc_type) == PCGAMG and m_pc_max_age > 1) {
+    ierr = PCGAMGSetReuseInterpolation(solver_pc, PETSC_TRUE);
+    PISM_CHK(ierr, "PCGAMGSetReuseInterpolation");
+  } else if (std::string(pc_type) == PCSHELL and m_solver_pc_single) {
+    // same as in pc_setup_bjacobi()
+    m_solver_pc_single->configure(solver_pc);
+  }
+
+  ierr = KSPSetFromOptions(m_solver_KSP);
+  PISM_CHK(ierr, "KSPSetFromOptions");
+
+  m_solver_pc_type = m_pc_type;
+}
+
+//! Return the matrix of the linear system: either `m_A` or its restriction to active unknowns.
+Mat SSAFD::system_matrix() {
+  if (not m_active_set) {
+    return m_A;
+  }
+
+  PetscErrorCode ierr;
+  MatReuse reuse = m_A_active == NULL ? MAT_INITIAL_MATRIX : MAT_REUSE_MATRIX;
+
+#if PETSC_VERSION_GE(3,8,0)
+  ierr = MatCreateSubMatrix(m_A, m_active_is, m_active_is, reuse, m_A_active.rawptr());
+  PISM_CHK(ierr, "MatCreateSubMatrix");
+#else
+  ierr = MatGetSubMatrix(m_A, m_active_is, m_active_is, reuse, m_A_active.rawptr());
+  PISM_CHK(ierr, "MatGetSubMatrix");
+#endif
+
+  return m_A_active;
+}
+
+//! Solve the linear system set up by assemble_matrix() and assemble_rhs().
+/*!
+ * Uses `m_velocity_global` as the initial guess and stores the solution in it.
+ *
+ * Uses the preconditioner re-use flag and tolerances of `m_KSP` even if the system is
+ * solved using `m_solver_KSP`.
+ *
+ * @param[out] reason KSP converged reason
+ * @param[out] iterations number of KSP iterations
+ */
+void SSAFD::ksp_solve(KSPConvergedReason &reason, PetscInt &iterations) {
+  PetscErrorCode ierr;
+
+  if (not m_active_set) {
+    krylov_solve(m_KSP, m_A, m_b.vec(), m_velocity_global.vec());
+  } else {
+    Vec b = NULL, x = NULL;
+
+    ierr = VecGetSubVector(m_b.vec(), m_active_is, &b);
+    PISM_CHK(ierr, "VecGetSubVector");
+
+    ierr = VecGetSubVector(m_velocity_global.vec(), m_active_is, &x);
+    PISM_CHK(ierr, "VecGetSubVector");
+
+    if (not m_solver_com_in_use) {
+      krylov_solve(m_KSP, m_A_active, b, x);
+    } else {
+      // values are computed using m_solver_com and then broadcast to all ranks
+      int result[2] = {0, 0};
+
+      // Excluded ranks wait in MPI_Bcast() below, so errors on m_solver_com are caught
+      // and re-thrown on all ranks after it.
+      std::string failure;
+
+      if (m_solver_com != MPI_COMM_NULL) {
+        PetscScalar *b_array = NULL, *x_array = NULL;
+        try {
+          PetscInt n = 0, N = 0;
+          ierr = VecGetLocalSize(x, &n);
+          PISM_CHK(ierr, "VecGetLocalSize");
+
+          ierr = VecGetSize(x, &N);
+          PISM_CHK(ierr, "VecGetSize");
+
+          // Local rows of m_A_active use global column indices. Excluded ranks own no
+          // rows, so these indices are valid in m_solver_com as well.
+          ierr = MatMPIAIJGetLocalMat(m_A_active,
+                                      m_solver_A_local == NULL ? MAT_INITIAL_MATRIX : MAT_REUSE_MATRIX,
+                                      m_solver_A_local.rawptr());
+          PISM_CHK(ierr, "MatMPIAIJGetLocalMat");
+
+          ierr = MatCreateMPIMatConcatenateSeqMat(m_solver_com, m_solver_A_local, n,
+                                                  m_solver_A == NULL ? MAT_INITIAL_MATRIX : MAT_REUSE_MATRIX,
+                                                  m_solver_A.rawptr());
+          PISM_CHK(ierr, "MatCreateMPIMatConcatenateSeqMat");
+
+          if (m_solver_pc_type != m_pc_type) {
+            configure_subcommunicator_solver();
+          } else {
+            ierr = KSPSetOperators(m_solver_KSP, m_solver_A, m_solver_A);
+            PISM_CHK(ierr, "KSPSetOperators");
+          }
+
+          {
+            PetscReal rtol, abstol, dtol;
+            PetscInt maxits;
+            ierr = KSPGetTolerances(m_KSP, &rtol, &abstol, &dtol, &maxits);
+            PISM_CHK(ierr, "KSPGetTolerances");
+
+            ierr = KSPSetTolerances(m_solver_KSP, rtol, abstol, dtol, maxits);
+            PISM_CHK(ierr, "KSPSetTolerances");
+
+            PetscBool reuse_pc;
+            ierr = KSPGetReusePreconditioner(m_KSP, &reuse_pc);
+            PISM_CHK(ierr, "KSPGetReusePreconditioner");
+
+            ierr = KSPSetReusePreconditioner(m_solver_KSP, reuse_pc);
+            PISM_CHK(ierr, "KSPSetReusePreconditioner");
+          }
+
+          ierr = VecGetArray(b, &b_array);
+          PISM_CHK(ierr, "VecGetArray");
+
+          ierr = VecGetArray(x, &x_array);
+          PISM_CHK(ierr, "VecGetArray");
+
+          {
+            petsc::Vec solver_b, solver_x;
+            ierr = VecCreateMPIWithArray(m_solver_com, 1, n, N, b_array, solver_b.rawptr());
+            PISM_CHK(ierr, "VecCreateMPIWithArray");
+
+            ierr = VecCreateMPIWithArray(m_solver_com, 1, n, N, x_array, solver_x.rawptr());
+            PISM_CHK(ierr, "VecCreateMPIWithArray");
+
+            ierr = KSPSolve(m_solver_KSP, solver_b, solver_x);
+            PISM_CHK(ierr, "KSPSolve");
+          }
+
+          ierr = VecRestoreArray(x, &x_array);
+          PISM_CHK(ierr, "VecRestoreArray");
+          x_array = NULL;
+
+          ierr = VecRestoreArray(b, &b_array);
+          PISM_CHK(ierr, "VecRestoreArray");
+          b_array = NULL;
+
+          KSPConvergedReason solver_reason;
+          ierr = KSPGetConvergedReason(m_solver_KSP, &solver_reason);
+          PISM_CHK(ierr, "KSPGetConvergedReason");
+
+          PetscInt solver_iterations;
+          ierr = KSPGetIterationNumber(m_solver_KSP, &solver_iterations);
+          PISM_CHK(ierr, "KSPGetIterationNumber");
+
+          result[0] = solver_reason;
+          result[1] = solver_iterations;
+        } catch (RuntimeError &e) {
+          failure = e.what();
+
+          if (x_array != NULL) {
+            VecRestoreArray(x, &x_array);
+          }
+          if (b_array != NULL) {
+            VecRestoreArray(b, &b_array);
+          }
+        }
+      }
+
+      ierr = MPI_Bcast(result, 2, MPI_INT, m_solver_root, m_grid->com);
+      if (ierr != MPI_SUCCESS) {
+        throw RuntimeError(PISM_ERROR_LOCATION, "MPI_Bcast failed");
+      }
+
+      if (GlobalMax(m_grid->com, failure.empty() ? 0.0 : 1.0) > 0.0) {
+        ierr = VecRestoreSubVector(m_velocity_global.vec(), m_active_is, &x);
+        PISM_CHK(ierr, "VecRestoreSubVector");
+
+        ierr = VecRestoreSubVector(m_b.vec(), m_active_is, &b);
+        PISM_CHK(ierr, "VecRestoreSubVector");
+
+        if (failure.empty()) {
+          failure = "failed on another MPI process";
+        }
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "SSAFD: linear solve on the sub-communicator: %s",
+                                      failure.c_str());
+      }
+
+      reason     = (KSPConvergedReason)result[0];
+      iterations = result[1];
+    }
+
+    ierr = VecRestoreSubVector(m_velocity_global.vec(), m_active_is, &x);
+    PISM_CHK(ierr, "VecRestoreSubVector");
+
+    ierr = VecRestoreSubVector(m_b.vec(), m_active_is, &b);
+    PISM_CHK(ierr, "VecRestoreSubVector");
+
+    // inactive unknowns are ice-free: set their velocity to zero (this is the solution of
+    // the corresponding rows of the full system)
+    IceModelVec::AccessList list{&m_velocity_global};
+    unsigned int n = 0;
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (not m_active_cells[n]) {
+        m_velocity_global(i, j) = 0.0;
+      }
+      n += 1;
+    }
+
+    if (m_solver_com_in_use) {
+      return;
+    }
+  }
+
+  ierr = KSPGetConvergedReason(m_KSP, &reason);
+  PISM_CHK(ierr, "KSPGetConvergedReason");
+
+  ierr = KSPGetIterationNumber(m_KSP, &iterations);
+  PISM_CHK(ierr, "KSPGetIterationNumber");
+}
+
+//! Solve the system `A x = b` using `ksp`, which has `A` as its operator.
+/*!
+ * If the matrix has a device type, `b` and `x` are copied to vectors of the matching type
+ * before the solve and the solution is copied back after it. This way all Krylov iterations
+ * run on the device and the data is moved between the host and the device once per
+ * Picard iteration.
+ */
+void SSAFD::krylov_solve(KSP ksp, Mat A, Vec b, Vec x) {
+  PetscErrorCode ierr;
+
+  const Profiling &profiling = m_grid->ctx()->profiling();
+
+  if (not m_device) {
+    profiling.begin("ksp");
+    ierr = KSPSolve(ksp, b, x);
+    PISM_CHK(ierr, "KSPSolve");
+    profiling.end("ksp");
+    return;
+  }
+
+  // these vectors are destroyed when the active set (i.e. the size of A) changes
+  if (m_device_x == NULL) {
+    ierr = MatCreateVecs(A, m_device_x.rawptr(), m_device_b.rawptr());
+    PISM_CHK(ierr, "MatCreateVecs");
+  }
+
+  copy_values(b, m_device_b);
+  copy_values(x, m_device_x);
+
+  profiling.begin("ksp");
+  ierr = KSPSolve(ksp, m_device_b, m_device_x);
+  PISM_CHK(ierr, "KSPSolve");
+  profiling.end("ksp");
+
+  copy_values(m_device_x, x);
 }
 
 void SSAFD::picard_iteration(const Inputs &inputs,
                              double nuH_regularization,
                              double nuH_iter_failure_underrelax) {
 
+  if (m_autotune_step >= 0 and m_autotune_step < n_solver_choices) {
+    autotune_picard_iteration(inputs, nuH_regularization, nuH_iter_failure_underrelax);
+    return;
+  }
+
+  if (not m_solver_choice.empty()) {
+    try {
+      pc_setup(m_solver_choice);
+      picard_manager(inputs, nuH_regularization,
+                     nuH_iter_failure_underrelax);
+    } catch (KSPFailure &f) {
+      m_log->message(1,
+                     "  re-trying using the default Additive Schwarz preconditioner...\n");
+
+      pc_setup("asm1_lu");
+
+      m_velocity.copy_from(m_velocity_old);
+
+      picard_manager(inputs, nuH_regularization,
+                     nuH_iter_failure_underrelax);
+    }
+    return;
+  }
+
+  if (m_autotune_step < 0) {
+    // the warm-up solve (using the default strategy below) is not timed: it starts from a
+    // poor initial guess
+    m_autotune_step = 0;
+  }
+
   if (m_default_pc_failure_count < m_default_pc_failure_max_count) {
     // Give BJACOBI another shot if we haven't tried it enough yet
 
@@ -991,7 +2023,171 @@ void SSAFD::picard_iteration(const Inputs &inputs,
   }
 }
 
+//! Solve using the next configuration tried by autotuning and record the time to
+//! convergence.
+/*!
+ * A configuration fails if the KSP solver fails (the solve is then completed using the
+ * default ASM setup) or if Picard iterations do not converge.
+ */
+void SSAFD::autotune_picard_iteration(const Inputs &inputs,
+                                      double nuH_regularization,
+                                      double nuH_iter_failure_underrelax) {
+  const std::string choice = solver_choices[m_autotune_step].name;
+
+  double time = -1.0;
+  try {
+    const double start = GlobalMax(m_grid->com, get_time());
+
+    pc_setup(choice);
+    picard_manager(inputs, nuH_regularization, nuH_iter_failure_underrelax);
+
+    time = GlobalMax(m_grid->com, get_time()) - start;
+  } catch (KSPFailure &f) {
+    m_log->message(2, "  SSAFD solver configuration '%s' failed\n", choice.c_str());
+
+    pc_setup("asm1_lu");
+
+    m_velocity.copy_from(m_velocity_old);
+
+    picard_manager(inputs, nuH_regularization, nuH_iter_failure_underrelax);
+  } catch (PicardFailure &f) {
+    m_autotune_times.push_back(-1.0);
+    m_autotune_step += 1;
+    finish_autotuning();
+    throw;
+  }
+
+  if (time >= 0.0) {
+    m_log->message(3, "  SSAFD solver configuration '%s': %.3f seconds\n",
+                   choice.c_str(), time);
+  }
+
+  m_autotune_times.push_back(time);
+  m_autotune_step += 1;
+  finish_autotuning();
+}
+
+//! Choose the fastest configuration once all of them were tried and save it to the cache
+//! file.
+void SSAFD::finish_autotuning() {
+  if (m_autotune_step < n_solver_choices) {
+    return;
+  }
+
+  int best = -1;
+  for (int k = 0; k < n_solver_choices; ++k) {
+    double time = m_autotune_times[k];
+    if (time >= 0.0 and (best < 0 or time < m_autotune_times[best])) {
+      best = k;
+    }
+  }
+
+  if (best < 0) {
+    m_log->message(2, "  SSAFD autotuning: all configurations failed; using the default strategy\n");
+    return;
+  }
+
+  m_solver_choice = solver_choices[best].name;
+
+  m_log->message(2, "  SSAFD autotuning: using '%s' (%.3f seconds)\n",
+                 m_solver_choice.c_str(), m_autotune_times[best]);
+
+  std::string cache_file = m_config->get_string("stress_balance.ssa.fd.autotune.cache_file");
+  if (not cache_file.empty() and m_grid->rank() == 0) {
+    std::ofstream output(cache_file, std::ios::app);
+    output << m_autotune_key << " " << m_solver_choice << " " << m_autotune_times[best] << "\n";
+  }
+}
+
+//! Copy values of a staggered field owned by this rank into a std::vector.
+static void get_values(const IceModelVec2Stag &input, std::vector<double> &result) {
+  const IceGrid &grid = *input.grid();
+
+  result.resize(2 * grid.xm() * grid.ym());
+
+  IceModelVec::AccessList list(input);
+
+  unsigned int n = 0;
+  for (Points p(grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result[n + 0] = input(i, j, 0);
+    result[n + 1] = input(i, j, 1);
+    n += 2;
+  }
+}
+
+//! Sets KSP tolerances, restoring original values when it goes out of scope.
+class KSPTolerances {
+public:
+  KSPTolerances(KSP ksp)
+    : m_ksp(ksp) {
+    PetscErrorCode ierr = KSPGetTolerances(m_ksp, &m_rtol, &m_abstol, &m_dtol, &m_maxits);
+    PISM_CHK(ierr, "KSPGetTolerances");
+  }
+
+  ~KSPTolerances() {
+    // errors are ignored: destructors should not throw
+    KSPSetTolerances(m_ksp, m_rtol, m_abstol, m_dtol, m_maxits);
+  }
+
+  //! original relative tolerance
+  double rtol() const {
+    return m_rtol;
+  }
+
+  void set_rtol(double rtol) {
+    PetscErrorCode ierr = KSPSetTolerances(m_ksp, rtol, m_abstol, m_dtol, m_maxits);
+    PISM_CHK(ierr, "KSPSetTolerances");
+  }
+private:
+  KSP m_ksp;
+  PetscReal m_rtol, m_abstol, m_dtol;
+  PetscInt m_maxits;
+};
+
+/*!
+ * Replace `m_nuH` (the Picard update of the previous iterate `m_nuH_x`; a copy of it is
+ * in `m_nuH_g`) with the Anderson-accelerated iterate.
+ *
+ * Values of the accelerated iterate that are not positive are replaced by corresponding
+ * Picard values.
+ */
+void SSAFD::accelerate_nuH() {
+  std::vector<double> result = m_nuH_g;
+
+  m_anderson->update(m_nuH_x, result);
+
+  IceModelVec::AccessList list(m_nuH);
+
+  unsigned int n = 0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (int o = 0; o < 2; ++o) {
+      m_nuH(i, j, o) = result[n] > 0.0 ? result[n] : m_nuH_g[n];
+      n += 1;
+    }
+  }
+
+  m_nuH.update_ghosts();
+}
+
 //! \brief Manages the Picard iteration loop.
+/*!
+ * Optional modifications of the Picard iteration:
+ *
+ * - If `stress_balance.ssa.fd.anderson.enabled` is set, iterates of `nuH` are combined
+ *   using Anderson acceleration (see AndersonAcceleration).
+ *
+ * - If `stress_balance.ssa.fd.eisenstat_walker.enabled` is set, the relative tolerance of
+ *   each KSP solve is chosen using the "choice 2" formula from [Eisenstat and Walker,
+ *   1996], with the relative change in `nuH` as the measure of the nonlinear residual:
+ *   there is no need to solve linear systems accurately while `nuH` is changing a lot.
+ *   The tolerance is bounded above by `stress_balance.ssa.fd.eisenstat_walker.max_rtol`
+ *   and the latest relative change in `nuH` and below by the KSP tolerance set using
+ *   command-line options (`-ssafd_ksp_rtol`).
+ */
 void SSAFD::picard_manager(const Inputs &inputs,
                            double nuH_regularization,
                            double nuH_iter_failure_underrelax) {
@@ -1022,6 +2218,22 @@ void SSAFD::picard_manager(const Inputs &inputs,
   }
   update_nuH_viewers();
 
+  if (m_anderson) {
+    m_anderson->reset();
+  }
+
+  const bool eisenstat_walker = m_config->get_flag("stress_balance.ssa.fd.eisenstat_walker.enabled");
+  KSPTolerances ksp_tolerances(m_KSP);
+  // Eisenstat-Walker parameters ("choice 2")
+  const double
+    EW_gamma = 0.9,
+    EW_alpha = 2.0,
+    EW_max_rtol = m_config->get_number("stress_balance.ssa.fd.eisenstat_walker.max_rtol"),
+    EW_min_rtol = ksp_tolerances.rtol();
+  double
+    ksp_rtol = std::max(EW_min_rtol, EW_max_rtol),
+    nuH_relative_change_old = 0.0;
+
   // outer loop
   for (unsigned int k = 0; k < max_iterations; ++k) {
 
@@ -1042,15 +2254,33 @@ void SSAFD::picard_manager(const Inputs &inputs,
     }
 
     // Call PETSc to solve linear system by iterative method; "inner iteration":
-    ierr = KSPSetOperators(m_KSP, m_A, m_A);
+    Mat A = system_matrix();
+    ierr = KSPSetOperators(m_KSP, A, A);
     PISM_CHK(ierr, "KSPSetOperator");
 
-    ierr = KSPSolve(m_KSP, m_b.vec(), m_velocity_global.vec());
-    PISM_CHK(ierr, "KSPSolve");
+    if (eisenstat_walker) {
+      ksp_tolerances.set_rtol(ksp_rtol);
+    }
 
-    // Check if diverged; report to standard out about iteration
-    ierr = KSPGetConvergedReason(m_KSP, &reason);
-    PISM_CHK(ierr, "KSPGetConvergedReason");
+    bool reuse_pc = reuse_preconditioner();
+    while (true) {
+      ierr = KSPSetReusePreconditioner(m_KSP, reuse_pc ? PETSC_TRUE : PETSC_FALSE);
+      PISM_CHK(ierr, "KSPSetReusePreconditioner");
+
+      ksp_solve(reason, ksp_iterations);
+
+      // Check if diverged; report to standard out about iteration
+
+      if (reason < 0 and reuse_pc) {
+        // try again with a new preconditioner
+        m_log->message(2,
+                       "  KSPSolve() with a re-used preconditioner failed; re-building it...\n");
+        reuse_pc = false;
+        m_velocity_global.copy_from(m_velocity);
+        continue;
+      }
+      break;
+    }
 
     if (reason < 0) {
       // KSP diverged
@@ -1060,17 +2290,18 @@ void SSAFD::picard_manager(const Inputs &inputs,
 
       write_system_petsc("kspdivergederror");
 
+      m_pc_age = 0;
+
       // Tell the caller that we failed. (The caller might try again,
       // though.)
       throw KSPFailure(KSPConvergedReasons[reason]);
     }
 
     // report on KSP success; the "inner" iteration is done
-    ierr = KSPGetIterationNumber(m_KSP, &ksp_iterations);
-    PISM_CHK(ierr, "KSPGetIterationNumber");
-
     ksp_iterations_total += ksp_iterations;
 
+    update_preconditioner_age(reuse_pc, ksp_iterations);
+
     if (very_verbose) {
       snprintf(tempstr, 100, "S:%d,%d: ", (int)ksp_iterations, reason);
       m_stdout_ssa += tempstr;
@@ -1117,6 +2348,13 @@ void SSAFD::picard_manager(const Inputs &inputs,
       m_nuH.scale(nuH_iter_failure_underrelax);
       m_nuH.add(1.0 - nuH_iter_failure_underrelax, m_nuH_old);
     }
+
+    if (m_anderson) {
+      // save iterates before compute_nuH_norm() modifies m_nuH_old
+      get_values(m_nuH_old, m_nuH_x);
+      get_values(m_nuH, m_nuH_g);
+    }
+
     compute_nuH_norm(nuH_norm, nuH_norm_change);
 
     update_nuH_viewers();
@@ -1140,6 +2378,34 @@ void SSAFD::picard_manager(const Inputs &inputs,
       goto done;
     }
 
+    if (eisenstat_walker) {
+      const double nuH_relative_change = nuH_norm > 0.0 ? nuH_norm_change / nuH_norm : 0.0;
+
+      if (nuH_norm > 0.0 and std::isfinite(nuH_relative_change)) {
+        double rtol = EW_max_rtol;
+        if (nuH_relative_change_old > 0.0) {
+          rtol = EW_gamma * pow(nuH_relative_change / nuH_relative_change_old, EW_alpha);
+
+          // safeguard against decreasing the tolerance too quickly
+          const double safeguard = EW_gamma * pow(ksp_rtol, EW_alpha);
+          if (safeguard > 0.1) {
+            rtol = std::max(rtol, safeguard);
+          }
+        }
+
+        ksp_rtol = std::max(EW_min_rtol, std::min(rtol, std::min(EW_max_rtol, nuH_relative_change)));
+        nuH_relative_change_old = nuH_relative_change;
+      } else {
+        // the relative change is undefined: use the fixed tolerance of the linear solver
+        ksp_rtol = EW_min_rtol;
+        nuH_relative_change_old = 0.0;
+      }
+    }
+
+    if (m_anderson) {
+      accelerate_nuH();
+    }
+
   } // outer loop (k)
 
   // If we're here, it means that we exceeded max_iterations and still
@@ -1151,6 +2417,9 @@ void SSAFD::picard_manager(const Inputs &inputs,
 
  done:
 
+  m_nonlinear_iterations = outer_iterations;
+  m_linear_iterations    = ksp_iterations_total;
+
   if (very_verbose) {
     snprintf(tempstr, 100, "... =%5d outer iterations, ~%3.1f KSP iterations each\n",
              (int)outer_iterations, ((double) ksp_iterations_total) / outer_iterations);
@@ -1240,19 +2509,36 @@ void SSAFD::compute_nuH_norm(double &norm, double &norm_change) {
 }
 
 //! \brief Computes vertically-averaged ice hardness on the staggered grid.
+/*!
+ * Averaged hardness is a column integral of the 3D enthalpy field, so it is re-used
+ * (from m_hardav) until the enthalpy changes (the energy balance model updates it less
+ * often than the stress balance is solved when `-skip` is used) or the ice thickness at
+ * a staggered grid point changes by more than
+ * `stress_balance.flow_law_cache.thickness_tolerance`.
+ */
 void SSAFD::compute_hardav_staggered(const Inputs &inputs) {
   const IceModelVec2S
     &thickness = inputs.geometry->ice_thickness;
 
   const IceModelVec3 &enthalpy = *inputs.enthalpy;
 
+  if (m_hardav_enthalpy != &enthalpy or
+      m_hardav_enthalpy_state != enthalpy.state_counter()) {
+    // enthalpy changed: re-compute hardness everywhere
+    m_hardav_thickness.set(NAN);
+    m_hardav_enthalpy       = &enthalpy;
+    m_hardav_enthalpy_state = enthalpy.state_counter();
+  }
+
+  const double tolerance = m_hardav_thickness_tolerance;
+
   const double
     *E_ij     = NULL,
     *E_offset = NULL;
 
   std::vector<double> E(m_grid->Mz());
 
-  IceModelVec::AccessList list{&thickness, &enthalpy, &m_hardness, &m_mask};
+  IceModelVec::AccessList list{&thickness, &enthalpy, &m_hardav, &m_hardav_thickness, &m_mask};
 
   ParallelSection loop(m_grid->com);
   try {
@@ -1272,8 +2558,15 @@ void SSAFD::compute_hardav_staggered(const Inputs &inputs) {
           H = thickness(i+oi,j+oj);
         }
 
+        // note that this is false if m_hardav_thickness(i, j, o) is NAN
+        if (std::fabs(H - m_hardav_thickness(i, j, o)) <= tolerance and
+            (H == 0.0) == (m_hardav_thickness(i, j, o) == 0.0)) {
+          continue;
+        }
+        m_hardav_thickness(i, j, o) = H;
+
         if (H == 0) {
-          m_hardness(i,j,o) = -1e6; // an obviously impossible value
+          m_hardav(i,j,o) = -1e6; // an obviously impossible value
           continue;
         }
 
@@ -1283,9 +2576,9 @@ void SSAFD::compute_hardav_staggered(const Inputs &inputs) {
           E[k] = 0.5 * (E_ij[k] + E_offset[k]);
         }
 
-        m_hardness(i,j,o) = rheology::averaged_hardness(*m_flow_law,
-                                                        H, m_grid->kBelowHeight(H),
-                                                        &(m_grid->z()[0]), &E[0]);
+        m_hardav(i,j,o) = rheology::averaged_hardness(*m_flow_law,
+                                                      H, m_grid->kBelowHeight(H),
+                                                      &(m_grid->z()[0]), &E[0]);
       } // o
     } // loop over points
   } catch (...) {
@@ -1293,6 +2586,8 @@ void SSAFD::compute_hardav_staggered(const Inputs &inputs) {
   }
   loop.check();
 
+  m_hardness.copy_from(m_hardav);
+
   fracture_induced_softening(inputs.fracture_density);
 }
 
@@ -1673,10 +2968,92 @@ void SSAFD::set_diagonal_matrix_entry(Mat A, int i, int j, int component,
   col.j = j;
   col.c = component;
 
+  if (use_coo(A)) {
+    // the diagonal entry is at position 4 in the first and 13 in the second equation
+    double *values = coo_row(i, j, component);
+    std::fill(values, values + 18, 0.0);
+    values[component == 0 ? 4 : 13] = value;
+    return;
+  }
+
   PetscErrorCode ierr = MatSetValuesStencil(A, 1, &row, 1, &col, &value, INSERT_VALUES);
   PISM_CHK(ierr, "MatSetValuesStencil");
 }
 
+//! Returns true if `A` should be assembled using MatSetValuesCOO().
+bool SSAFD::use_coo(Mat A) const {
+  return m_coo_assembly and A == m_A;
+}
+
+//! Values of the equation `component` at `(i, j)` in m_coo_values (18 entries).
+double* SSAFD::coo_row(int i, int j, int component) {
+  const int n = (j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs());
+  return &m_coo_values[(2 * n + component) * 18];
+}
+
+//! Set the sparsity pattern of `m_A` using MatSetPreallocationCOO().
+/*!
+ * Every equation uses the same 18 entries (see assemble_matrix()), including trivial
+ * equations at ice-free locations and locations of Dirichlet boundary conditions, so
+ * the sparsity pattern does not depend on the cell type mask and is set once.
+ *
+ * Each call of assemble_matrix() fills m_coo_values and passes it to MatSetValuesCOO(),
+ * avoiding the cost of MatSetValuesStencil() (index translation and searching for the
+ * location of each entry).
+ */
+void SSAFD::coo_setup() {
+  PetscErrorCode ierr;
+
+  const int n_nonzeros = 18;
+
+  PetscInt gxs, gys, gxm, gym;
+  ierr = DMDAGetGhostCorners(*m_da, &gxs, &gys, NULL, &gxm, &gym, NULL);
+  PISM_CHK(ierr, "DMDAGetGhostCorners");
+
+  const int N = m_grid->xm() * m_grid->ym();
+  std::vector<PetscInt> rows(2 * N * n_nonzeros), cols(2 * N * n_nonzeros);
+  m_coo_values.resize(2 * N * n_nonzeros);
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (int c = 0; c < 2; ++c) {
+      // same offset as in coo_row()
+      const int offset = coo_row(i, j, c) - m_coo_values.data();
+
+      // same order as in assemble_matrix(): u first, then v; in each component the
+      // rows of the 3x3 stencil from north to south
+      for (int m = 0; m < n_nonzeros; ++m) {
+        const int
+          C = m / 9,
+          I = i - 1 + m % 3,
+          J = j + 1 - (m % 9) / 3;
+
+        // indexes in a local (ghosted) Vec
+        rows[offset + m] = ((j - gys) * gxm + (i - gxs)) * 2 + c;
+        cols[offset + m] = ((J - gys) * gxm + (I - gxs)) * 2 + C;
+      }
+    }
+  }
+
+  ISLocalToGlobalMapping ltog;
+  ierr = DMGetLocalToGlobalMapping(*m_da, &ltog);
+  PISM_CHK(ierr, "DMGetLocalToGlobalMapping");
+
+  ierr = ISLocalToGlobalMappingApply(ltog, rows.size(), rows.data(), rows.data());
+  PISM_CHK(ierr, "ISLocalToGlobalMappingApply");
+
+  ierr = ISLocalToGlobalMappingApply(ltog, cols.size(), cols.data(), cols.data());
+  PISM_CHK(ierr, "ISLocalToGlobalMappingApply");
+
+#if PETSC_VERSION_GE(3,15,0)
+  ierr = MatSetPreallocationCOO(m_A, rows.size(), rows.data(), cols.data());
+  PISM_CHK(ierr, "MatSetPreallocationCOO");
+#endif
+
+  m_coo_ready = true;
+}
+
 //! \brief Checks if a cell is near or at the ice front.
 /*!
  * You need to create IceModelVec::AccessList object and add mask to it.
@@ -1693,7 +3070,7 @@ void SSAFD::set_diagonal_matrix_entry(Mat A, int i, int j, int component,
  */
 bool SSAFD::is_marginal(int i, int j, bool ssa_dirichlet_bc) {
 
-  auto M = m_mask.int_box(i, j);
+  auto M = m_mask.compact().int_box(i, j);
 
   if (ssa_dirichlet_bc) {
     return icy(M.ij) &&
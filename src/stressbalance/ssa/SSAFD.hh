@@ -19,14 +19,22 @@
 #ifndef _SSAFD_H_
 #define _SSAFD_H_
 
+#include <memory>
+
 #include "SSA.hh"
 
 #include "pism/util/error_handling.hh"
 #include "pism/util/petscwrappers/Viewer.hh"
 #include "pism/util/petscwrappers/KSP.hh"
 #include "pism/util/petscwrappers/Mat.hh"
+#include "pism/util/petscwrappers/IS.hh"
+#include "pism/util/petscwrappers/Vec.hh"
 
 namespace pism {
+
+class AndersonAcceleration;
+class SinglePrecisionILU;
+
 namespace stressbalance {
 
 //! PISM's SSA solver: the finite difference implementation.
@@ -45,9 +53,25 @@ protected:
   virtual void pc_setup_bjacobi();
 
   virtual void pc_setup_asm();
+
+  void pc_setup(const std::string &choice);
+  void autotune_picard_iteration(const Inputs &inputs,
+                                 double nuH_regularization,
+                                 double nuH_iter_failure_underrelax);
+  void finish_autotuning();
   
   virtual void solve(const Inputs &inputs);
 
+  virtual double residual_norm(const Inputs &inputs);
+
+  void update_active_set(const Inputs &inputs);
+  void update_subcommunicator(const std::vector<int> &active, bool owns_unknowns);
+  void destroy_subcommunicator_solver();
+  void configure_subcommunicator_solver();
+  Mat system_matrix();
+  void ksp_solve(KSPConvergedReason &reason, PetscInt &iterations);
+  void krylov_solve(KSP ksp, Mat A, Vec b, Vec x);
+
   virtual void picard_iteration(const Inputs &inputs,
                                 double nuH_regularization,
                                 double nuH_iter_failure_underrelax);
@@ -71,6 +95,13 @@ protected:
   virtual void compute_nuH_norm(double &norm,
                                 double &norm_change);
 
+  void accelerate_nuH();
+
+  bool reuse_preconditioner() const;
+  void update_preconditioner_age(bool reused, int ksp_iterations);
+  void set_preconditioner_type(const std::string &type);
+  void update_solver_memory_use();
+
   virtual void assemble_matrix(const Inputs &inputs,
                                bool include_basal_shear, Mat A);
 
@@ -83,22 +114,115 @@ protected:
   void set_diagonal_matrix_entry(Mat A, int i, int j, int component,
                                          double value);
 
+  void coo_setup();
+  bool use_coo(Mat A) const;
+  double* coo_row(int i, int j, int component);
+
   virtual bool is_marginal(int i, int j, bool ssa_dirichlet_bc);
 
   virtual void fracture_induced_softening(const IceModelVec2S *fracture_density);
 
   // objects used internally
   IceModelVec2Stag m_hardness, m_nuH, m_nuH_old;
+
+  //! vertically-averaged hardness (without fracture-induced softening) and the ice
+  //! thickness used to compute it (see compute_hardav_staggered())
+  IceModelVec2Stag m_hardav, m_hardav_thickness;
+  //! enthalpy field (and its state counter) used to compute m_hardav
+  const IceModelVec3 *m_hardav_enthalpy;
+  int m_hardav_enthalpy_state;
+  //! ice thickness change that invalidates m_hardav
+  double m_hardav_thickness_tolerance;
+
   IceModelVec2 m_work;
   petsc::KSP m_KSP;
   petsc::Mat m_A;
   IceModelVec2V m_b;            // right hand side
+  //! memory used by m_A and m_KSP (estimate)
+  MemoryRecord m_solver_memory;
   double m_scaling;
 
   IceModelVec2V m_velocity_old;
 
+  //! true if m_A is assembled using MatSetValuesCOO()
+  bool m_coo_assembly;
+  //! true if the sparsity pattern of m_A was set using MatSetPreallocationCOO()
+  bool m_coo_ready;
+  //! values of m_A (in the order set by coo_setup())
+  std::vector<double> m_coo_values;
+
+  //! true if m_A has a device (GPU) matrix type
+  bool m_device;
+  //! true if m_A uses block (BAIJ) storage with 2x2 blocks
+  bool m_blocked;
+  //! device copies of the right hand side and the solution (created using MatCreateVecs())
+  petsc::Vec m_device_b, m_device_x;
+
+  //! Anderson acceleration of the Picard iteration (null if disabled)
+  std::unique_ptr<AndersonAcceleration> m_anderson;
+  //! storage for nuH before and after the latest Picard update (used by m_anderson)
+  std::vector<double> m_nuH_x, m_nuH_g;
+
+  //! maximum number of KSP solves using the same preconditioner (1: no reuse)
+  unsigned int m_pc_max_age;
+  //! KSP iteration count increase (relative to the first solve) that triggers a
+  //! preconditioner update
+  double m_pc_max_iteration_ratio;
+  //! number of KSP solves since the latest preconditioner update (0: not set up yet)
+  unsigned int m_pc_age;
+  //! number of KSP iterations in the first solve with the current preconditioner
+  int m_pc_reference_iterations;
+  //! current preconditioner type (as set by pc_setup_bjacobi() or pc_setup_asm())
+  std::string m_pc_type;
+  //! single precision block Jacobi preconditioners used instead of PCBJACOBI by m_KSP and
+  //! m_solver_KSP (null unless stress_balance.ssa.fd.single_precision_preconditioner is set)
+  std::unique_ptr<SinglePrecisionILU> m_pc_single, m_solver_pc_single;
+
+  //! true if the linear system is solved for active (icy and Dirichlet B.C.) unknowns only
+  bool m_active_set;
+  //! active cell flags (in the order of Points) used to build m_active_is
+  std::vector<int> m_active_cells;
+  //! global indices of active unknowns
+  petsc::IS m_active_is;
+  //! restriction of m_A to active unknowns
+  petsc::Mat m_A_active;
+
+  //! true if linear systems are solved using ranks that own active unknowns only
+  bool m_use_subcommunicator;
+  //! fraction of cells that have to change from active to inactive (or back) to trigger
+  //! re-building the sub-communicator
+  double m_subcommunicator_threshold;
+  //! true if m_solver_com is in use (i.e. some ranks are excluded)
+  bool m_solver_com_in_use;
+  //! communicator used to solve linear systems (MPI_COMM_NULL on excluded ranks)
+  MPI_Comm m_solver_com;
+  //! rank (in m_grid->com) of the first rank in m_solver_com
+  int m_solver_root;
+  //! active cell flags used to create m_solver_com
+  std::vector<int> m_solver_com_cells;
+  //! linear solver on m_solver_com and the corresponding system matrix
+  petsc::KSP m_solver_KSP;
+  petsc::Mat m_solver_A, m_solver_A_local;
+  //! preconditioner type (see m_pc_type) used to configure m_solver_KSP
+  std::string m_solver_pc_type;
+
   unsigned int m_default_pc_failure_count,
     m_default_pc_failure_max_count;
+
+  //! overlap and the sub-domain preconditioner type used by pc_setup_asm()
+  int m_asm_overlap;
+  std::string m_asm_sub_pc_type;
+
+  //! solver configuration chosen by autotuning (see pc_setup(); empty: default strategy)
+  std::string m_solver_choice;
+  //! autotuning step: -1 during the first (warm-up) solve, then the index of the
+  //! configuration to try next (autotuning is done when it reaches the number of
+  //! configurations)
+  int m_autotune_step;
+  //! time to convergence for each configuration tried (negative if it failed)
+  std::vector<double> m_autotune_times;
+  //! key identifying this setup in the autotuning cache file
+  std::string m_autotune_key;
   
   bool m_view_nuh;
   petsc::Viewer::Ptr m_nuh_viewer;
@@ -76,7 +76,16 @@ SSAFEM::SSAFEM(IceGrid::ConstPtr g)
                                   &m_callback_data);
   PISM_CHK(ierr, "DMDASNESSetJacobianLocal");
 
-  ierr = DMSetMatType(*m_da, "baij");
+  const int mg_levels = m_config->get_number("stress_balance.ssa.fem.multigrid_levels");
+  if (mg_levels < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "stress_balance.ssa.fem.multigrid_levels = %d is invalid"
+                                  " (has to be positive)", mg_levels);
+  }
+
+  // Galerkin coarse grid operators (see below) are computed using MatPtAP(), which does
+  // not support the BAIJ format.
+  ierr = DMSetMatType(*m_da, mg_levels > 1 ? MATAIJ : "baij");
   PISM_CHK(ierr, "DMSetMatType");
 
   ierr = DMSetApplicationContext(*m_da, &m_callback_data);
@@ -85,6 +94,57 @@ SSAFEM::SSAFEM(IceGrid::ConstPtr g)
   ierr = SNESSetDM(m_snes, *m_da);
   PISM_CHK(ierr, "SNESSetDM");
 
+  if (m_config->get_flag("stress_balance.ssa.fem.matrix_free")) {
+    // Approximate Jacobian-vector products using finite differences of the residual
+    // (compute_local_function()). The assembled Jacobian is used to build the
+    // preconditioner only, so it does not have to be updated every Newton iteration.
+    ierr = SNESSetUseMatrixFree(m_snes, PETSC_TRUE, PETSC_FALSE);
+    PISM_CHK(ierr, "SNESSetUseMatrixFree");
+
+    int lag = m_config->get_number("stress_balance.ssa.fem.jacobian_lag");
+    if (lag < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.fem.jacobian_lag = %d is invalid"
+                                    " (has to be positive)", lag);
+    }
+
+    ierr = SNESSetLagJacobian(m_snes, lag);
+    PISM_CHK(ierr, "SNESSetLagJacobian");
+  }
+
+  if (mg_levels > 1) {
+    // Geometric multigrid using the hierarchy of DMDAs obtained by coarsening m_da
+    // (i.e. grids with spacing 2 dx, 4 dx, ...) and Galerkin coarse grid operators.
+    const int ratio = 1 << (mg_levels - 1);
+    if (m_grid->Mx() % ratio != 0 or m_grid->My() % ratio != 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.fem.multigrid_levels = %d requires"
+                                    " Mx and My divisible by %d (got Mx = %d, My = %d)",
+                                    mg_levels, ratio, m_grid->Mx(), m_grid->My());
+    }
+
+    KSP ksp;
+    ierr = SNESGetKSP(m_snes, &ksp);
+    PISM_CHK(ierr, "SNESGetKSP");
+
+    PC pc;
+    ierr = KSPGetPC(ksp, &pc);
+    PISM_CHK(ierr, "KSPGetPC");
+
+    ierr = PCSetType(pc, PCMG);
+    PISM_CHK(ierr, "PCSetType");
+
+    ierr = PCMGSetLevels(pc, mg_levels, NULL);
+    PISM_CHK(ierr, "PCMGSetLevels");
+
+#if PETSC_VERSION_GE(3,8,0)
+    ierr = PCMGSetGalerkin(pc, PC_MG_GALERKIN_BOTH);
+#else
+    ierr = PCMGSetGalerkin(pc, PETSC_TRUE);
+#endif
+    PISM_CHK(ierr, "PCMGSetGalerkin");
+  }
+
   // Default of maximum 200 iterations; possibly overridden by command line options
   int snes_max_it = 200;
   ierr = SNESSetTolerances(m_snes, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT,
@@ -96,6 +156,8 @@ SSAFEM::SSAFEM(IceGrid::ConstPtr g)
 
   // Allocate m_coefficients, which contains coefficient data at the nodes of all the elements.
   m_coefficients.create(m_grid, "ssa_coefficients", WITH_GHOSTS, 1);
+  // cache_inputs() does not set the driving stress unless it is prescribed explicitly
+  m_coefficients.set(0.0);
 
   m_node_type.create(m_grid, "node_type", WITH_GHOSTS, 1);
   m_node_type.set_attrs("internal", // intent
@@ -167,6 +229,18 @@ void SSAFEM::init_impl() {
 void SSAFEM::solve(const Inputs &inputs) {
 
   TerminationReason::Ptr reason = solve_with_reason(inputs);
+
+  {
+    PetscInt nonlinear = 0, linear = 0;
+    PetscErrorCode ierr = SNESGetIterationNumber(m_snes, &nonlinear);
+    PISM_CHK(ierr, "SNESGetIterationNumber");
+    ierr = SNESGetLinearSolveIterations(m_snes, &linear);
+    PISM_CHK(ierr, "SNESGetLinearSolveIterations");
+
+    m_nonlinear_iterations = nonlinear;
+    m_linear_iterations    = linear;
+  }
+
   if (reason->failed()) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION, "SSAFEM solve failed to converge (SNES reason %s)",
                                   reason->description().c_str());
@@ -183,6 +257,33 @@ TerminationReason::Ptr SSAFEM::solve_with_reason(const Inputs &inputs) {
   return solve_nocache();
 }
 
+//! Compute the norm of the SNES residual at `m_velocity`.
+/*!
+ * Updates cached coefficients (see cache_inputs()) and modifies m_velocity_global.
+ */
+double SSAFEM::residual_norm(const Inputs &inputs) {
+  PetscErrorCode ierr;
+
+  cache_inputs(inputs);
+
+  m_epsilon_ssa = m_config->get_number("stress_balance.ssa.epsilon");
+
+  m_velocity_global.copy_from(m_velocity);
+
+  petsc::Vec residual;
+  ierr = VecDuplicate(m_velocity_global.vec(), residual.rawptr());
+  PISM_CHK(ierr, "VecDuplicate");
+
+  ierr = SNESComputeFunction(m_snes, m_velocity_global.vec(), residual);
+  PISM_CHK(ierr, "SNESComputeFunction");
+
+  double result = 0.0;
+  ierr = VecNorm(residual, NORM_2, &result);
+  PISM_CHK(ierr, "VecNorm");
+
+  return result;
+}
+
 //! Solve the SSA without first recomputing the values of coefficients at quad
 //! points.  See the disccusion of SSAFEM::solve for more discussion.
 TerminationReason::Ptr SSAFEM::solve_nocache() {
@@ -258,6 +359,10 @@ TerminationReason::Ptr SSAFEM::solve_nocache() {
 
    In addition to coefficients at element nodes we store "node types" used to identify interior
    elements, exterior elements, and boundary faces.
+
+   Each group of coefficients (as well as node types and the boundary integral) is
+   re-computed only if state counters of its inputs changed since the last call (see
+   DependencyTracker).
 */
 void SSAFEM::cache_inputs(const Inputs &inputs) {
 
@@ -268,68 +373,103 @@ void SSAFEM::cache_inputs(const Inputs &inputs) {
 
   const std::vector<double> &z = m_grid->z();
 
-  IceModelVec::AccessList list{&m_coefficients,
-      inputs.enthalpy,
-      &inputs.geometry->ice_thickness,
-      &inputs.geometry->bed_elevation,
-      &inputs.geometry->sea_level_elevation,
-      inputs.basal_yield_stress};
+  const IceModelVec2S
+    &H         = inputs.geometry->ice_thickness,
+    &bed       = inputs.geometry->bed_elevation,
+    &sea_level = inputs.geometry->sea_level_elevation;
 
   bool use_explicit_driving_stress = (m_driving_stress_x != NULL) && (m_driving_stress_y != NULL);
-  if (use_explicit_driving_stress) {
-    list.add({m_driving_stress_x, m_driving_stress_y});
-  }
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  // Determine which groups of coefficients have to be re-computed. Note that the hardness
+  // depends on the ice thickness, so they are updated together.
+  const DependencyTracker::Inputs
+    hardness_inputs{&H, inputs.enthalpy},
+    geometry_inputs{&bed, &sea_level},
+    tauc_inputs{inputs.basal_yield_stress},
+    driving_stress_inputs = (use_explicit_driving_stress ?
+                             DependencyTracker::Inputs{m_driving_stress_x, m_driving_stress_y} :
+                             DependencyTracker::Inputs{});
+
+  const bool
+    update_hardness       = m_hardness_inputs.changed(hardness_inputs),
+    update_geometry       = m_geometry_inputs.changed(geometry_inputs),
+    update_tauc           = m_tauc_inputs.changed(tauc_inputs),
+    update_driving_stress = (use_explicit_driving_stress and
+                             m_driving_stress_inputs.changed(driving_stress_inputs));
+
+  if (update_hardness or update_geometry or update_tauc or update_driving_stress) {
+    IceModelVec::AccessList list{&m_coefficients, inputs.enthalpy, &H, &bed, &sea_level,
+                                 inputs.basal_yield_stress};
+
+    if (use_explicit_driving_stress) {
+      list.add({m_driving_stress_x, m_driving_stress_y});
+    }
 
-      double thickness = inputs.geometry->ice_thickness(i, j);
+    ParallelSection loop(m_grid->com);
+    try {
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
 
-      Vector2 tau_d;
-      if (use_explicit_driving_stress) {
-        tau_d.u = (*m_driving_stress_x)(i, j);
-        tau_d.v = (*m_driving_stress_y)(i, j);
-      } else {
-	// tau_d above is set to zero by the Vector2
-	// constructor, but is not used
-      }
+        Coefficients &c = m_coefficients(i, j);
+
+        if (update_hardness) {
+          double thickness = H(i, j);
 
-      const double *enthalpy = inputs.enthalpy->get_column(i, j);
-      double hardness = rheology::averaged_hardness(*m_flow_law, thickness,
+          const double *enthalpy = inputs.enthalpy->get_column(i, j);
+          c.thickness = thickness;
+          c.hardness  = rheology::averaged_hardness(*m_flow_law, thickness,
                                                     m_grid->kBelowHeight(thickness),
                                                     &z[0], enthalpy);
+        }
 
-      Coefficients c;
-      c.thickness      = thickness;
-      c.bed            = inputs.geometry->bed_elevation(i, j);
-      c.sea_level      = inputs.geometry->sea_level_elevation(i, j);
-      c.tauc           = (*inputs.basal_yield_stress)(i, j);
-      c.hardness       = hardness;
-      c.driving_stress = tau_d;
+        if (update_geometry) {
+          c.bed       = bed(i, j);
+          c.sea_level = sea_level(i, j);
+        }
 
-      m_coefficients(i, j) = c;
-    } // loop over owned grid points
-  } catch (...) {
-    loop.failed();
-  }
-  loop.check();
+        if (update_tauc) {
+          c.tauc = (*inputs.basal_yield_stress)(i, j);
+        }
 
-  m_coefficients.update_ghosts();
+        if (update_driving_stress) {
+          c.driving_stress = Vector2((*m_driving_stress_x)(i, j),
+                                     (*m_driving_stress_y)(i, j));
+        }
+        // Note: if the driving stress is not prescribed explicitly c.driving_stress is
+        // set to zero by the Vector2 constructor and is not used.
+      } // loop over owned grid points
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
 
-  const bool use_cfbc = m_config->get_flag("stress_balance.calving_front_stress_bc");
-  if (use_cfbc) {
-    // Note: the call below uses ghosts of inputs.geometry->ice_thickness.
-    compute_node_types(inputs.geometry->ice_thickness,
-                       m_config->get_number("stress_balance.ice_free_thickness_standard"),
-                       m_node_type);
-  } else {
-    m_node_type.set(NODE_INTERIOR);
+    m_coefficients.update_ghosts();
+
+    m_hardness_inputs.record(hardness_inputs);
+    m_geometry_inputs.record(geometry_inputs);
+    m_tauc_inputs.record(tauc_inputs);
+    m_driving_stress_inputs.record(driving_stress_inputs);
   }
 
-  cache_residual_cfbc(inputs);
+  if (m_node_type_inputs.changed({&H})) {
+    const bool use_cfbc = m_config->get_flag("stress_balance.calving_front_stress_bc");
+    if (use_cfbc) {
+      // Note: the call below uses ghosts of inputs.geometry->ice_thickness.
+      compute_node_types(H,
+                         m_config->get_number("stress_balance.ice_free_thickness_standard"),
+                         m_node_type);
+    } else {
+      m_node_type.set(NODE_INTERIOR);
+    }
+    m_node_type_inputs.record({&H});
+  }
 
+  // The boundary integral uses node types and ice geometry at boundary nodes.
+  const DependencyTracker::Inputs cfbc_inputs{&m_node_type, &H, &bed, &sea_level};
+  if (m_cfbc_inputs.changed(cfbc_inputs)) {
+    cache_residual_cfbc(inputs);
+    m_cfbc_inputs.record(cfbc_inputs);
+  }
 }
 
 //! Compute quadrature point values of various coefficients given a quadrature `Q` and nodal values.
@@ -684,6 +824,286 @@ void SSAFEM::cache_residual_cfbc(const Inputs &inputs) {
 
 
 //! Implements the callback for computing the residual.
+//! Number of elements processed together by SSAFEM::compute_local_function() and
+//! SSAFEM::compute_local_jacobian().
+static const int element_block_size = 8;
+
+//! Nodal and quadrature point values for a block of elements.
+/*!
+ * Values are stored as "structure of arrays": `H[k][e]` is the ice thickness at the node
+ * `k` of the element `e` in the block and `H_q[q][e]` is its value at the quadrature
+ * point `q`. The number of nodes `Nk`, the number of quadrature points `Nq` and the block
+ * size `B` are compile-time constants, so that loops over elements in a block vectorize.
+ *
+ * Use add() to add an element, then evaluate() to compute quadrature point values. Values
+ * of nuH and beta (and their derivatives) are set by the caller because they are computed
+ * by virtual methods of flow and sliding laws.
+ */
+template<int Nk, int Nq, int B>
+struct ElementBlock {
+  ElementBlock(const fem::Quadrature &Q)
+    : size(0) {
+    if ((int)Q.n() != Nq) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "expected a quadrature with %d points, got %d",
+                                    Nq, (int)Q.n());
+    }
+
+    const fem::Germs *test = Q.test_function_values();
+    const double *W = Q.weights();
+    for (int q = 0; q < Nq; ++q) {
+      for (int k = 0; k < Nk; ++k) {
+        psi[q][k]   = test[q][k].val;
+        psi_x[q][k] = test[q][k].dx;
+        psi_y[q][k] = test[q][k].dy;
+      }
+      weight[q] = W[q];
+    }
+  }
+
+  //! Add the element (`i`, `j`) with nodal values of coefficients `x` and velocity `velocity`.
+  template<class Coefficients>
+  void add(int i_element, int j_element, const Coefficients *x, const Vector2 *velocity) {
+    const int e = size;
+
+    i[e] = i_element;
+    j[e] = j_element;
+
+    for (int k = 0; k < Nk; ++k) {
+      H[k][e]         = x[k].thickness;
+      bed[k][e]       = x[k].bed;
+      sea_level[k][e] = x[k].sea_level;
+      tauc[k][e]      = x[k].tauc;
+      hardness[k][e]  = x[k].hardness;
+      tau_dx[k][e]    = x[k].driving_stress.u;
+      tau_dy[k][e]    = x[k].driving_stress.v;
+      u[k][e]         = velocity[k].u;
+      v[k][e]         = velocity[k].v;
+    }
+
+    size += 1;
+  }
+
+  //! Compute coefficients, the driving stress, and the velocity at quadrature points.
+  /*!
+   * See SSAFEM::quad_point_values(), SSAFEM::explicit_driving_stress() and
+   * SSAFEM::driving_stress() for element-by-element versions.
+   */
+  void evaluate(const GeometryCalculator &gc, double alpha, double rho_g,
+                bool use_explicit_driving_stress) {
+    const int n = size;
+
+    for (int q = 0; q < Nq; ++q) {
+      double sl[B], b[B], b_x[B], b_y[B], H_x[B], H_y[B];
+
+      for (int e = 0; e < n; ++e) {
+        H_q[q][e]        = 0.0;
+        tauc_q[q][e]     = 0.0;
+        hardness_q[q][e] = 0.0;
+        u_q[q][e]        = 0.0;
+        v_q[q][e]        = 0.0;
+        u_x[q][e]        = 0.0;
+        u_y[q][e]        = 0.0;
+        v_x[q][e]        = 0.0;
+        v_y[q][e]        = 0.0;
+        sl[e]            = 0.0;
+        b[e]             = 0.0;
+        b_x[e]           = 0.0;
+        b_y[e]           = 0.0;
+        H_x[e]           = 0.0;
+        H_y[e]           = 0.0;
+      }
+
+      for (int k = 0; k < Nk; ++k) {
+        const double
+          val = psi[q][k],
+          dx  = psi_x[q][k],
+          dy  = psi_y[q][k];
+
+        for (int e = 0; e < n; ++e) {
+          H_q[q][e]        += val * H[k][e];
+          H_x[e]           += dx * H[k][e];
+          H_y[e]           += dy * H[k][e];
+          b[e]             += val * bed[k][e];
+          b_x[e]           += dx * bed[k][e];
+          b_y[e]           += dy * bed[k][e];
+          sl[e]            += val * sea_level[k][e];
+          tauc_q[q][e]     += val * tauc[k][e];
+          hardness_q[q][e] += val * hardness[k][e];
+
+          u_q[q][e] += val * u[k][e];
+          v_q[q][e] += val * v[k][e];
+          u_x[q][e] += dx * u[k][e];
+          v_x[q][e] += dx * v[k][e];
+          u_y[q][e] += dy * u[k][e];
+          v_y[q][e] += dy * v[k][e];
+        }
+      }
+
+      for (int e = 0; e < n; ++e) {
+        mask_q[q][e] = gc.mask(sl[e], b[e], H_q[q][e]);
+      }
+
+      if (use_explicit_driving_stress) {
+        for (int e = 0; e < n; ++e) {
+          tau_d_u[q][e] = 0.0;
+          tau_d_v[q][e] = 0.0;
+        }
+        for (int k = 0; k < Nk; ++k) {
+          const double val = psi[q][k];
+          for (int e = 0; e < n; ++e) {
+            tau_d_u[q][e] += val * tau_dx[k][e];
+            tau_d_v[q][e] += val * tau_dy[k][e];
+          }
+        }
+      } else {
+        for (int e = 0; e < n; ++e) {
+          const bool grounded = mask::grounded(mask_q[q][e]);
+
+          const double
+            pressure = rho_g * H_q[q][e],
+            h_x      = grounded ? b_x[e] + H_x[e] : alpha * H_x[e],
+            h_y      = grounded ? b_y[e] + H_y[e] : alpha * H_y[e];
+
+          tau_d_u[q][e] = - pressure * h_x;
+          tau_d_v[q][e] = - pressure * h_y;
+        }
+      }
+    }
+  }
+
+  //! Compute element residuals (see SSAFEM::compute_local_function()).
+  void residual(double R_u[Nk][B], double R_v[Nk][B]) const {
+    const int n = size;
+
+    for (int k = 0; k < Nk; ++k) {
+      for (int e = 0; e < n; ++e) {
+        R_u[k][e] = 0.0;
+        R_v[k][e] = 0.0;
+      }
+    }
+
+    for (int q = 0; q < Nq; ++q) {
+      const double jw = weight[q];
+
+      for (int k = 0; k < Nk; ++k) {
+        const double
+          val = psi[q][k],
+          dx  = psi_x[q][k],
+          dy  = psi_y[q][k];
+
+        for (int e = 0; e < n; ++e) {
+          const double
+            u_y_plus_v_x = u_y[q][e] + v_x[q][e],
+            tau_b_u      = u_q[q][e] * (- beta[q][e]),
+            tau_b_v      = v_q[q][e] * (- beta[q][e]);
+
+          R_u[k][e] += jw * (eta[q][e] * (dx * (4.0 * u_x[q][e] + 2.0 * v_y[q][e]) + dy * u_y_plus_v_x)
+                             - val * (tau_b_u + tau_d_u[q][e]));
+          R_v[k][e] += jw * (eta[q][e] * (dx * u_y_plus_v_x + dy * (2.0 * u_x[q][e] + 4.0 * v_y[q][e]))
+                             - val * (tau_b_v + tau_d_v[q][e]));
+        }
+      }
+    }
+  }
+
+  //! Compute element Jacobians (see SSAFEM::compute_local_jacobian()).
+  void jacobian(double K[2 * Nk][2 * Nk][B]) const {
+    const int n = size;
+
+    for (int r = 0; r < 2 * Nk; ++r) {
+      for (int c = 0; c < 2 * Nk; ++c) {
+        for (int e = 0; e < n; ++e) {
+          K[r][c][e] = 0.0;
+        }
+      }
+    }
+
+    for (int q = 0; q < Nq; ++q) {
+      const double jw = weight[q];
+
+      for (int l = 0; l < Nk; ++l) { // trial functions
+        const double
+          phi     = psi[q][l],
+          phi_x   = psi_x[q][l],
+          phi_y   = psi_y[q][l];
+
+        // Derivatives of \eta = \nu*H and the basal shear stress term (\tau_b) with respect
+        // to u_l and v_l:
+        double eta_u[B], eta_v[B], taub_xu[B], taub_xv[B], taub_yu[B], taub_yv[B];
+        for (int e = 0; e < n; ++e) {
+          const double
+            U            = u_q[q][e],
+            V            = v_q[q][e],
+            u_y_plus_v_x = u_y[q][e] + v_x[q][e],
+            gamma_u      = (2.0 * u_x[q][e] + v_y[q][e]) * phi_x + 0.5 * u_y_plus_v_x * phi_y,
+            gamma_v      = 0.5 * u_y_plus_v_x * phi_x + (u_x[q][e] + 2.0 * v_y[q][e]) * phi_y;
+
+          eta_u[e] = deta[q][e] * gamma_u;
+          eta_v[e] = deta[q][e] * gamma_v;
+
+          taub_xu[e] = -dbeta[q][e] * U * U * phi - beta[q][e] * phi;
+          taub_xv[e] = -dbeta[q][e] * U * V * phi;
+          taub_yu[e] = -dbeta[q][e] * V * U * phi;
+          taub_yv[e] = -dbeta[q][e] * V * V * phi - beta[q][e] * phi;
+        }
+
+        for (int k = 0; k < Nk; ++k) { // test functions
+          const double
+            val = psi[q][k],
+            dx  = psi_x[q][k],
+            dy  = psi_y[q][k];
+
+          for (int e = 0; e < n; ++e) {
+            const double
+              u_y_plus_v_x = u_y[q][e] + v_x[q][e],
+              A            = dx * (4 * u_x[q][e] + 2 * v_y[q][e]) + dy * u_y_plus_v_x,
+              C            = dx * u_y_plus_v_x + dy * (2 * u_x[q][e] + 4 * v_y[q][e]),
+              eta_e        = eta[q][e];
+
+            // u-u coupling
+            K[k*2 + 0][l*2 + 0][e] += jw * (eta_u[e] * A + eta_e * (4 * dx * phi_x + dy * phi_y) - val * taub_xu[e]);
+            // u-v coupling
+            K[k*2 + 0][l*2 + 1][e] += jw * (eta_v[e] * A + eta_e * (2 * dx * phi_y + dy * phi_x) - val * taub_xv[e]);
+            // v-u coupling
+            K[k*2 + 1][l*2 + 0][e] += jw * (eta_u[e] * C + eta_e * (dx * phi_y + 2 * dy * phi_x) - val * taub_yu[e]);
+            // v-v coupling
+            K[k*2 + 1][l*2 + 1][e] += jw * (eta_v[e] * C + eta_e * (dx * phi_x + 4 * dy * phi_y) - val * taub_yv[e]);
+          }
+        }
+      }
+    }
+  }
+
+  //! number of elements in the block
+  int size;
+  //! element indices
+  int i[B], j[B];
+
+  //! values of test functions and their derivatives at quadrature points
+  double psi[Nq][Nk], psi_x[Nq][Nk], psi_y[Nq][Nk];
+  //! quadrature weights
+  double weight[Nq];
+
+  //! nodal values of coefficients
+  double H[Nk][B], bed[Nk][B], sea_level[Nk][B], tauc[Nk][B], hardness[Nk][B];
+  //! nodal values of the prescribed driving stress
+  double tau_dx[Nk][B], tau_dy[Nk][B];
+  //! nodal values of the velocity
+  double u[Nk][B], v[Nk][B];
+
+  //! coefficients at quadrature points
+  double H_q[Nq][B], tauc_q[Nq][B], hardness_q[Nq][B];
+  int mask_q[Nq][B];
+  //! driving stress at quadrature points
+  double tau_d_u[Nq][B], tau_d_v[Nq][B];
+  //! velocity and its derivatives at quadrature points
+  double u_q[Nq][B], v_q[Nq][B], u_x[Nq][B], u_y[Nq][B], v_x[Nq][B], v_y[Nq][B];
+  //! nuH, the basal drag coefficient, and their derivatives with respect to the second
+  //! invariant of the strain rate
+  double eta[Nq][B], deta[Nq][B], beta[Nq][B], dbeta[Nq][B];
+};
+
 /*!
  * Compute the residual \f[r_{ij}= G(x, \psi_{ij}) \f] where \f$G\f$
  * is the weak form of the SSA, \f$x\f$ is the current approximate
@@ -699,7 +1119,7 @@ void SSAFEM::compute_local_function(Vector2 const *const *const velocity_global,
   const bool use_cfbc = m_config->get_flag("stress_balance.calving_front_stress_bc");
 
   const unsigned int Nk = fem::q1::n_chi;
-  const unsigned int Nq_max = fem::MAX_QUADRATURE_SIZE;
+  const unsigned int Nq = fem::Q1Quadrature4::size;
 
   IceModelVec::AccessList list{&m_node_type, &m_coefficients, &m_boundary_integral};
 
@@ -715,8 +1135,47 @@ void SSAFEM::compute_local_function(Vector2 const *const *const velocity_global,
   // Start access to Dirichlet data if present.
   fem::DirichletData_Vector dirichlet_data(m_bc_mask, m_bc_values, m_dirichletScale);
 
-  // Storage for the current solution and its derivatives at quadrature points.
-  Vector2 U[Nq_max], U_x[Nq_max], U_y[Nq_max];
+  ElementBlock<Nk, Nq, element_block_size> block(m_quadrature);
+
+  // Element residuals
+  double R_u[Nk][element_block_size], R_v[Nk][element_block_size];
+
+  // Compute residuals of elements in the block and add them to the global residual.
+  auto process_block = [&]() {
+    block.evaluate(m_gc, m_alpha, m_rho_g, use_explicit_driving_stress);
+
+    for (unsigned int q = 0; q < Nq; q++) {
+      for (int e = 0; e < block.size; ++e) {
+        PointwiseNuHAndBeta(block.H_q[q][e], block.hardness_q[q][e], block.mask_q[q][e],
+                            block.tauc_q[q][e],
+                            Vector2(block.u_q[q][e], block.v_q[q][e]),
+                            Vector2(block.u_x[q][e], block.v_x[q][e]),
+                            Vector2(block.u_y[q][e], block.v_y[q][e]), // inputs
+                            &block.eta[q][e], NULL, &block.beta[q][e], NULL); // outputs
+      }
+    }
+
+    block.residual(R_u, R_v);
+
+    for (int e = 0; e < block.size; ++e) {
+      m_element.reset(block.i[e], block.j[e]);
+
+      if (dirichlet_data) {
+        // mark Dirichlet nodes in m_element so that they are not touched by
+        // add_contribution() below
+        dirichlet_data.constrain(m_element);
+      }
+
+      Vector2 residual[Nk];
+      for (unsigned int k = 0; k < Nk; k++) {
+        residual[k] = Vector2(R_u[k][e], R_v[k][e]);
+      }
+
+      m_element.add_contribution(residual, residual_global);
+    }
+
+    block.size = 0;
+  };
 
   // Iterate over the elements.
   const int
@@ -747,96 +1206,31 @@ void SSAFEM::compute_local_function(Vector2 const *const *const velocity_global,
 
         // Note: without CFBC all elements are "interior".
 
-        fem::Quadrature &Q = m_quadrature;
-
-        // Number of quadrature points.
-        const unsigned int Nq = Q.n();
-
-        // An Nq by Nk array of test function values.
-        const fem::Germs *test = Q.test_function_values();
+        Coefficients coeffs[Nk];
+        m_element.nodal_values(m_coefficients, coeffs);
 
-        // Jacobian times weights for quadrature.
-        const double* W = Q.weights();
+        // Obtain the value of the solution at the nodes adjacent to the element.
+        Vector2 velocity_nodal[Nk];
+        m_element.nodal_values(velocity_global, velocity_nodal);
 
-        // Storage for the solution and residuals at element nodes.
-        Vector2 residual[Nk];
-
-        int    mask[Nq_max];
-        double thickness[Nq_max];
-        double tauc[Nq_max];
-        double hardness[Nq_max];
-        Vector2 tau_d[Nq_max];
-
-        {
-          Coefficients coeffs[Nk];
-          m_element.nodal_values(m_coefficients, coeffs);
-
-          quad_point_values(Q, coeffs, mask, thickness, tauc, hardness);
-
-          if (use_explicit_driving_stress) {
-            explicit_driving_stress(Q, coeffs, tau_d);
-          } else {
-            driving_stress(Q, coeffs, tau_d);
-          }
+        // These values now need to be adjusted if some nodes in the element have Dirichlet data.
+        if (dirichlet_data) {
+          // Set elements of velocity_nodal that correspond to Dirichlet nodes to prescribed
+          // values.
+          dirichlet_data.enforce(m_element, velocity_nodal);
         }
 
-        {
-          // Obtain the value of the solution at the nodes adjacent to the element.
-          Vector2 velocity_nodal[Nk];
-          m_element.nodal_values(velocity_global, velocity_nodal);
-
-          // These values now need to be adjusted if some nodes in the element have Dirichlet data.
-          if (dirichlet_data) {
-            // Set elements of velocity_nodal that correspond to Dirichlet nodes to prescribed
-            // values.
-            dirichlet_data.enforce(m_element, velocity_nodal);
-            // mark Dirichlet nodes in m_element so that they are not touched by
-            // add_contribution() below
-            dirichlet_data.constrain(m_element);
-          }
-
-          // Compute the solution values and its gradient at the quadrature points.
-          quadrature_point_values(Q, velocity_nodal, // input
-                                  U, U_x, U_y);   // outputs
-        }
+        block.add(i, j, coeffs, velocity_nodal);
 
-        // Zero out the element-local residual in preparation for updating it.
-        for (unsigned int k = 0; k < Nk; k++) {
-          residual[k].u = 0;
-          residual[k].v = 0;
+        if (block.size == element_block_size) {
+          process_block();
         }
-
-        // loop over quadrature points:
-        for (unsigned int q = 0; q < Nq; q++) {
-
-          double eta = 0.0, beta = 0.0;
-          PointwiseNuHAndBeta(thickness[q], hardness[q], mask[q], tauc[q],
-                              U[q], U_x[q], U_y[q], // inputs
-                              &eta, NULL, &beta, NULL);              // outputs
-
-          // The next few lines compute the actual residual for the element.
-          const Vector2 tau_b = U[q] * (- beta); // basal shear stress
-
-          const double
-            jw           = W[q],
-            u_x          = U_x[q].u,
-            v_y          = U_y[q].v,
-            u_y_plus_v_x = U_y[q].u + U_x[q].v;
-
-          // Loop over test functions.
-          for (unsigned int k = 0; k < Nk; k++) {
-            const fem::Germ &psi = test[q][k];
-
-            residual[k].u += jw * (eta * (psi.dx * (4.0 * u_x + 2.0 * v_y) + psi.dy * u_y_plus_v_x)
-                                   - psi.val * (tau_b.u + tau_d[q].u));
-            residual[k].v += jw * (eta * (psi.dx * u_y_plus_v_x + psi.dy * (2.0 * u_x + 4.0 * v_y))
-                                   - psi.val * (tau_b.v + tau_d[q].v));
-          } // k (test functions)
-        }   // q (quadrature points)
-
-        m_element.add_contribution(residual, residual_global);
       } // i-loop
     } // j-loop
+
+    if (block.size > 0) {
+      process_block();
+    }
   } catch (...) {
     loop.failed();
   }
@@ -905,8 +1299,8 @@ void SSAFEM::monitor_function(Vector2 const *const *const velocity_global,
 */
 void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global, Mat Jac) {
 
-  const unsigned int Nk     = fem::q1::n_chi;
-  const unsigned int Nq_max = fem::MAX_QUADRATURE_SIZE;
+  const unsigned int Nk = fem::q1::n_chi;
+  const unsigned int Nq = fem::Q1Quadrature4::size;
 
   const bool use_cfbc = m_config->get_flag("stress_balance.calving_front_stress_bc");
 
@@ -919,8 +1313,55 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
   // Start access to Dirichlet data if present.
   fem::DirichletData_Vector dirichlet_data(m_bc_mask, m_bc_values, m_dirichletScale);
 
-  // Storage for the current solution at quadrature points.
-  Vector2 U[Nq_max], U_x[Nq_max], U_y[Nq_max];
+  ElementBlock<Nk, Nq, element_block_size> block(m_quadrature);
+
+  // Element-local Jacobian matrices (there are Nk vector valued degrees of freedom per
+  // element, for a total of (2*Nk)*(2*Nk) = 64 entries in the local Jacobian).
+  double K[2*Nk][2*Nk][element_block_size];
+
+  // Compute Jacobians of elements in the block and add them to the global Jacobian.
+  auto process_block = [&]() {
+    block.evaluate(m_gc, m_alpha, m_rho_g, false);
+
+    for (unsigned int q = 0; q < Nq; q++) {
+      for (int e = 0; e < block.size; ++e) {
+        PointwiseNuHAndBeta(block.H_q[q][e], block.hardness_q[q][e], block.mask_q[q][e],
+                            block.tauc_q[q][e],
+                            Vector2(block.u_q[q][e], block.v_q[q][e]),
+                            Vector2(block.u_x[q][e], block.v_x[q][e]),
+                            Vector2(block.u_y[q][e], block.v_y[q][e]),
+                            &block.eta[q][e], &block.deta[q][e],
+                            &block.beta[q][e], &block.dbeta[q][e]);
+
+        if (block.eta[q][e] == 0) {
+          ierr = PetscPrintf(PETSC_COMM_SELF, "eta=0 i %d j %d q %d\n",
+                             block.i[e], block.j[e], q);
+          PISM_CHK(ierr, "PetscPrintf");
+        }
+      }
+    }
+
+    block.jacobian(K);
+
+    for (int e = 0; e < block.size; ++e) {
+      m_element.reset(block.i[e], block.j[e]);
+
+      if (dirichlet_data) {
+        dirichlet_data.constrain(m_element);
+      }
+
+      double K_e[2*Nk][2*Nk];
+      for (unsigned int r = 0; r < 2*Nk; r++) {
+        for (unsigned int c = 0; c < 2*Nk; c++) {
+          K_e[r][c] = K[r][c][e];
+        }
+      }
+
+      m_element.add_contribution(&K_e[0][0], Jac);
+    }
+
+    block.size = 0;
+  };
 
   // Loop through all the elements.
   int
@@ -949,127 +1390,36 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
           continue;
         }
 
-        fem::Quadrature &Q = m_quadrature;
-
-        // Number of quadrature points.
-        const unsigned int Nq = Q.n();
+        Coefficients coeffs[Nk];
+        m_element.nodal_values(m_coefficients, coeffs);
 
-        // Jacobian times weights for quadrature.
-        const double* W = Q.weights();
+        // Values of the solution at the nodes of the current element.
+        Vector2 velocity_nodal[Nk];
+        // Obtain the value of the solution at the adjacent nodes to the element.
+        m_element.nodal_values(velocity_global, velocity_nodal);
 
-        // Values of the finite element test functions at the quadrature points.
-        // This is an Nq by Nk array of function germs
-        const fem::Germs *test = Q.test_function_values();
-
-        int    mask[Nq_max];
-        double thickness[Nq_max];
-        double tauc[Nq_max];
-        double hardness[Nq_max];
-
-        {
-          Coefficients coeffs[Nk];
-          m_element.nodal_values(m_coefficients, coeffs);
-
-          quad_point_values(Q, coeffs,
-                            mask, thickness, tauc, hardness);
-        }
-
-        {
-          // Values of the solution at the nodes of the current element.
-          Vector2 velocity_nodal[Nk];
-          // Obtain the value of the solution at the adjacent nodes to the element.
-          m_element.nodal_values(velocity_global, velocity_nodal);
-
-          // These values now need to be adjusted if some nodes in the element have
-          // Dirichlet data.
-          if (dirichlet_data) {
-            dirichlet_data.enforce(m_element, velocity_nodal);
-            dirichlet_data.constrain(m_element);
-          }
-          // Compute the values of the solution at the quadrature points.
-          quadrature_point_values(Q, velocity_nodal, U, U_x, U_y);
+        // These values now need to be adjusted if some nodes in the element have
+        // Dirichlet data.
+        if (dirichlet_data) {
+          dirichlet_data.enforce(m_element, velocity_nodal);
         }
 
-        // Element-local Jacobian matrix (there are Nk vector valued degrees
-        // of freedom per element, for a total of (2*Nk)*(2*Nk) = 16
-        // entries in the local Jacobian.
-        double K[2*Nk][2*Nk];
-        // Build the element-local Jacobian.
-        ierr = PetscMemzero(K, sizeof(K));
-        PISM_CHK(ierr, "PetscMemzero");
+        block.add(i, j, coeffs, velocity_nodal);
 
-        for (unsigned int q = 0; q < Nq; q++) {
-          const double
-            jw           = W[q],
-            u            = U[q].u,
-            v            = U[q].v,
-            u_x          = U_x[q].u,
-            v_y          = U_y[q].v,
-            u_y_plus_v_x = U_y[q].u + U_x[q].v;
-
-          double eta = 0.0, deta = 0.0, beta = 0.0, dbeta = 0.0;
-          PointwiseNuHAndBeta(thickness[q], hardness[q], mask[q], tauc[q],
-                              U[q], U_x[q], U_y[q],
-                              &eta, &deta, &beta, &dbeta);
-
-          for (unsigned int l = 0; l < Nk; l++) { // Trial functions
-
-            // Current trial function and its derivatives:
-            const fem::Germ &phi = test[q][l];
-
-            // Derivatives of \gamma with respect to u_l and v_l:
-            const double
-              gamma_u = (2.0 * u_x + v_y) * phi.dx + 0.5 * u_y_plus_v_x * phi.dy,
-              gamma_v = 0.5 * u_y_plus_v_x * phi.dx + (u_x + 2.0 * v_y) * phi.dy;
-
-            // Derivatives of \eta = \nu*H with respect to u_l and v_l:
-            const double
-              eta_u = deta * gamma_u,
-              eta_v = deta * gamma_v;
+        if (block.size == element_block_size) {
+          process_block();
+        }
+      } // i
+    } // j
 
-            // Derivatives of the basal shear stress term (\tau_b):
-            const double
-              taub_xu = -dbeta * u * u * phi.val - beta * phi.val,  // x-component, derivative with respect to u_l
-              taub_xv = -dbeta * u * v * phi.val,                   // x-component, derivative with respect to u_l
-              taub_yu = -dbeta * v * u * phi.val,                   // y-component, derivative with respect to v_l
-              taub_yv = -dbeta * v * v * phi.val - beta * phi.val;  // y-component, derivative with respect to v_l
-
-            for (unsigned int k = 0; k < Nk; k++) {   // Test functions
-
-              // Current test function and its derivatives:
-
-              const fem::Germ &psi = test[q][k];
-
-              if (eta == 0) {
-                ierr = PetscPrintf(PETSC_COMM_SELF, "eta=0 i %d j %d q %d k %d\n", i, j, q, k);
-                PISM_CHK(ierr, "PetscPrintf");
-              }
-
-              // u-u coupling
-              K[k*2 + 0][l*2 + 0] += jw * (eta_u * (psi.dx * (4 * u_x + 2 * v_y) + psi.dy * u_y_plus_v_x)
-                                           + eta * (4 * psi.dx * phi.dx + psi.dy * phi.dy) - psi.val * taub_xu);
-              // u-v coupling
-              K[k*2 + 0][l*2 + 1] += jw * (eta_v * (psi.dx * (4 * u_x + 2 * v_y) + psi.dy * u_y_plus_v_x)
-                                           + eta * (2 * psi.dx * phi.dy + psi.dy * phi.dx) - psi.val * taub_xv);
-              // v-u coupling
-              K[k*2 + 1][l*2 + 0] += jw * (eta_u * (psi.dx * u_y_plus_v_x + psi.dy * (2 * u_x + 4 * v_y))
-                                           + eta * (psi.dx * phi.dy + 2 * psi.dy * phi.dx) - psi.val * taub_yu);
-              // v-v coupling
-              K[k*2 + 1][l*2 + 1] += jw * (eta_v * (psi.dx * u_y_plus_v_x + psi.dy * (2 * u_x + 4 * v_y))
-                                           + eta * (psi.dx * phi.dx + 4 * psi.dy * phi.dy) - psi.val * taub_yv);
-
-            } // l
-          } // k
-        } // q
-        m_element.add_contribution(&K[0][0], Jac);
-      } // j
-    } // i
+    if (block.size > 0) {
+      process_block();
+    }
   } catch (...) {
     loop.failed();
   }
   loop.check();
 
-
   // Until now, the rows and columns correspoinding to Dirichlet data
   // have not been set. We now put an identity block in for these
   // unknowns. Note that because we have takes steps to not touching
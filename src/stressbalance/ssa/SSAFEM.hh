@@ -24,6 +24,7 @@
 #include "pism/util/petscwrappers/SNES.hh"
 #include "pism/util/TerminationReason.hh"
 #include "pism/util/Mask.hh"
+#include "pism/util/DependencyTracker.hh"
 
 namespace pism {
 
@@ -75,6 +76,12 @@ protected:
 
   IceModelVec2Fat<Coefficients> m_coefficients;
 
+  //! Inputs used to compute groups of m_coefficients, m_node_type, and
+  //! m_boundary_integral (see cache_inputs()). Code modifying m_coefficients directly
+  //! has to reset() corresponding trackers.
+  DependencyTracker m_hardness_inputs, m_geometry_inputs, m_tauc_inputs,
+    m_driving_stress_inputs, m_node_type_inputs, m_cfbc_inputs;
+
   void quad_point_values(const fem::Quadrature &Q,
                          const Coefficients *x,
                          int *mask,
@@ -107,6 +114,8 @@ protected:
 
   virtual void solve(const Inputs &inputs);
 
+  virtual double residual_norm(const Inputs &inputs);
+
   TerminationReason::Ptr solve_with_reason(const Inputs &inputs);
 
   TerminationReason::Ptr solve_nocache();
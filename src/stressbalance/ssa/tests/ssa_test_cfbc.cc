@@ -138,12 +138,15 @@ void SSATestCaseCFBC::initializeSSACoefficients() {
 
   // communicate what we have set
   m_geometry.ice_surface_elevation.update_ghosts();
+  m_geometry.ice_surface_elevation.inc_state_counter();
 
   m_geometry.ice_thickness.update_ghosts();
+  m_geometry.ice_thickness.inc_state_counter();
 
   m_bc_mask.update_ghosts();
 
   m_geometry.cell_type.update_ghosts();
+  m_geometry.cell_type.inc_state_counter();
 
   m_bc_values.update_ghosts();
 }
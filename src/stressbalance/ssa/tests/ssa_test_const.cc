@@ -130,7 +130,9 @@ void SSATestCaseConst::initializeSSACoefficients() {
   m_bc_values.update_ghosts();
   m_bc_mask.update_ghosts();
   m_geometry.bed_elevation.update_ghosts();
+  m_geometry.bed_elevation.inc_state_counter();
   m_geometry.ice_surface_elevation.update_ghosts();
+  m_geometry.ice_surface_elevation.inc_state_counter();
 }
 
 
@@ -43,6 +43,18 @@ CFLData max_timestep_cfl_3d(const IceModelVec2S &ice_thickness,
                             const IceModelVec3 &u3,
                             const IceModelVec3 &v3,
                             const IceModelVec3 &w3) {
+  CFLData result = max_timestep_cfl_3d_local(ice_thickness, cell_type, u3, v3, w3);
+
+  reduce_cfl_data(ice_thickness.grid()->com, {&result});
+
+  return result;
+}
+
+CFLData max_timestep_cfl_3d_local(const IceModelVec2S &ice_thickness,
+                                  const IceModelVec2CellType &cell_type,
+                                  const IceModelVec3 &u3,
+                                  const IceModelVec3 &v3,
+                                  const IceModelVec3 &w3) {
 
   IceGrid::ConstPtr grid = ice_thickness.grid();
   Config::ConstPtr config = grid->ctx()->config();
@@ -59,31 +71,31 @@ CFLData max_timestep_cfl_3d(const IceModelVec2S &ice_thickness,
   double u_max = 0.0, v_max = 0.0, w_max = 0.0;
   ParallelSection loop(grid->com);
   try {
-    for (Points p(*grid); p; p.next()) {
+    const IndexList &icy = cell_type.index_list(IceModelVec2CellType::ICY);
+
+    for (PointsInList p(icy); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      if (cell_type.icy(i, j)) {
-        const int ks = grid->kBelowHeight(ice_thickness(i, j));
+      const int ks = grid->kBelowHeight(ice_thickness(i, j));
+      const double
+        *u = u3.get_column(i, j),
+        *v = v3.get_column(i, j),
+        *w = w3.get_column(i, j);
+
+      for (int k = 0; k <= ks; ++k) {
         const double
-          *u = u3.get_column(i, j),
-          *v = v3.get_column(i, j),
-          *w = w3.get_column(i, j);
-
-        for (int k = 0; k <= ks; ++k) {
-          const double
-            u_abs = fabs(u[k]),
-            v_abs = fabs(v[k]);
-          u_max = std::max(u_max, u_abs);
-          v_max = std::max(v_max, v_abs);
-          const double denom = fabs(u_abs * one_over_dx) + fabs(v_abs * one_over_dy);
-          if (denom > 0.0) {
-            dt_max = std::min(dt_max, 1.0 / denom);
-          }
+          u_abs = fabs(u[k]),
+          v_abs = fabs(v[k]);
+        u_max = std::max(u_max, u_abs);
+        v_max = std::max(v_max, v_abs);
+        const double denom = fabs(u_abs * one_over_dx) + fabs(v_abs * one_over_dy);
+        if (denom > 0.0) {
+          dt_max = std::min(dt_max, 1.0 / denom);
         }
+      }
 
-        for (int k = 0; k <= ks; ++k) {
-          w_max = std::max(w_max, fabs(w[k]));
-        }
+      for (int k = 0; k <= ks; ++k) {
+        w_max = std::max(w_max, fabs(w[k]));
       }
     }
   } catch (...) {
@@ -93,10 +105,10 @@ CFLData max_timestep_cfl_3d(const IceModelVec2S &ice_thickness,
 
   CFLData result;
 
-  result.u_max = GlobalMax(grid->com, u_max);
-  result.v_max = GlobalMax(grid->com, v_max);
-  result.w_max = GlobalMax(grid->com, w_max);
-  result.dt_max = MaxTimestep(GlobalMin(grid->com, dt_max));
+  result.u_max = u_max;
+  result.v_max = v_max;
+  result.w_max = w_max;
+  result.dt_max = MaxTimestep(dt_max);
 
   return result;
 }
@@ -114,6 +126,16 @@ CFLData max_timestep_cfl_3d(const IceModelVec2S &ice_thickness,
 CFLData max_timestep_cfl_2d(const IceModelVec2S &ice_thickness,
                             const IceModelVec2CellType &cell_type,
                             const IceModelVec2V &velocity) {
+  CFLData result = max_timestep_cfl_2d_local(ice_thickness, cell_type, velocity);
+
+  reduce_cfl_data(ice_thickness.grid()->com, {&result});
+
+  return result;
+}
+
+CFLData max_timestep_cfl_2d_local(const IceModelVec2S &ice_thickness,
+                                  const IceModelVec2CellType &cell_type,
+                                  const IceModelVec2V &velocity) {
 
   IceGrid::ConstPtr grid = ice_thickness.grid();
   Config::ConstPtr config = grid->ctx()->config();
@@ -127,32 +149,58 @@ CFLData max_timestep_cfl_2d(const IceModelVec2S &ice_thickness,
   IceModelVec::AccessList list{&velocity, &cell_type};
 
   double u_max = 0.0, v_max = 0.0;
-  for (Points p(*grid); p; p.next()) {
+  const IndexList &icy = cell_type.index_list(IceModelVec2CellType::ICY);
+
+  for (PointsInList p(icy); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    if (cell_type.icy(i, j)) {
-      const double
-        u_abs = fabs(velocity(i, j).u),
-        v_abs = fabs(velocity(i, j).v);
+    const double
+      u_abs = fabs(velocity(i, j).u),
+      v_abs = fabs(velocity(i, j).v);
 
-      u_max = std::max(u_max, u_abs);
-      v_max = std::max(v_max, v_abs);
+    u_max = std::max(u_max, u_abs);
+    v_max = std::max(v_max, v_abs);
 
-      const double denom = u_abs / dx + v_abs / dy;
-      if (denom > 0.0) {
-        dt_max = std::min(dt_max, 1.0 / denom);
-      }
+    const double denom = u_abs / dx + v_abs / dy;
+    if (denom > 0.0) {
+      dt_max = std::min(dt_max, 1.0 / denom);
     }
   }
 
   CFLData result;
 
-  result.u_max = GlobalMax(grid->com, u_max);
-  result.v_max = GlobalMax(grid->com, v_max);
+  result.u_max = u_max;
+  result.v_max = v_max;
   result.w_max = 0.0;
-  result.dt_max = MaxTimestep(GlobalMin(grid->com, dt_max));
+  result.dt_max = MaxTimestep(dt_max);
 
   return result;
 }
 
+//! Replace local CFL data computed on each rank with global values.
+/*!
+ * Uses one reduction for all elements of `data`.
+ */
+void reduce_cfl_data(MPI_Comm com, const std::vector<CFLData*> &data) {
+  const int N = 4;
+  std::vector<double> local(N * data.size()), global(N * data.size());
+
+  for (unsigned int k = 0; k < data.size(); ++k) {
+    local[N * k + 0] = data[k]->u_max;
+    local[N * k + 1] = data[k]->v_max;
+    local[N * k + 2] = data[k]->w_max;
+    // max(-dt) == -min(dt)
+    local[N * k + 3] = -data[k]->dt_max.value();
+  }
+
+  GlobalMax(com, local.data(), global.data(), global.size());
+
+  for (unsigned int k = 0; k < data.size(); ++k) {
+    data[k]->u_max  = global[N * k + 0];
+    data[k]->v_max  = global[N * k + 1];
+    data[k]->w_max  = global[N * k + 2];
+    data[k]->dt_max = MaxTimestep(-global[N * k + 3]);
+  }
+}
+
 } // end of namespace pism
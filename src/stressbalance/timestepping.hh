@@ -20,6 +20,9 @@
 #ifndef TIMESTEPPING_H
 #define TIMESTEPPING_H
 
+#include <vector>
+#include <mpi.h>
+
 #include "pism/util/MaxTimestep.hh"
 
 namespace pism {
@@ -58,6 +61,23 @@ CFLData max_timestep_cfl_2d(const IceModelVec2S &ice_thickness,
                             const IceModelVec2CellType &cell_type,
                             const IceModelVec2V &velocity);
 
+/*!
+ * Versions of max_timestep_cfl_3d() and max_timestep_cfl_2d() that do not communicate:
+ * they return values for the sub-domain owned by this rank. Use reduce_cfl_data() to
+ * combine them.
+ */
+CFLData max_timestep_cfl_3d_local(const IceModelVec2S &ice_thickness,
+                                  const IceModelVec2CellType &cell_type,
+                                  const IceModelVec3 &u3,
+                                  const IceModelVec3 &v3,
+                                  const IceModelVec3 &w3);
+
+CFLData max_timestep_cfl_2d_local(const IceModelVec2S &ice_thickness,
+                                  const IceModelVec2CellType &cell_type,
+                                  const IceModelVec2V &velocity);
+
+void reduce_cfl_data(MPI_Comm com, const std::vector<CFLData*> &data);
+
 } // end of namespace pism
 
 
@@ -0,0 +1,216 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TracerColumnSystem.hh"
+
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+TracerColumnSystem::TracerColumnSystem(const std::vector<double>& storage_grid,
+                                       const std::string &my_prefix,
+                                       double dx, double dy, double dt,
+                                       const std::vector<const IceModelVec3*> &tracers,
+                                       const IceModelVec3 &u3,
+                                       const IceModelVec3 &v3,
+                                       const IceModelVec3 &w3)
+  : columnSystemCtx(storage_grid, my_prefix, dx, dy, dt, u3, v3, w3),
+    m_tracers(tracers) {
+
+  if (m_tracers.empty()) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "TracerColumnSystem needs at least one tracer");
+  }
+
+  size_t
+    Mz = m_z.size(),
+    N  = Mz * m_tracers.size();
+
+  m_T.resize(N);
+  m_T_n.resize(N);
+  m_T_e.resize(N);
+  m_T_s.resize(N);
+  m_T_w.resize(N);
+  m_rhs.resize(N);
+  m_x.resize(N);
+  m_column.resize(Mz);
+
+  m_nu = m_dt / m_dz; // derived constant
+}
+
+unsigned int TracerColumnSystem::n_tracers() const {
+  return m_tracers.size();
+}
+
+//! Store values of the tracer `c` (in levels `0, ..., ks`) in `output` (`N` tracers in
+//! total).
+static void load_tracer(const std::vector<double> &column, unsigned int c, unsigned int N,
+                        unsigned int ks, std::vector<double> &output) {
+  for (unsigned int k = 0; k <= ks; ++k) {
+    output[k * N + c] = column[k];
+  }
+}
+
+void TracerColumnSystem::init(int i, int j, double thickness) {
+  init_column(i, j, thickness);
+
+  if (m_ks == 0) {
+    return;
+  }
+
+  coarse_to_fine(m_u3, i, j, &m_u[0]);
+  coarse_to_fine(m_v3, i, j, &m_v[0]);
+  coarse_to_fine(m_w3, i, j, &m_w[0]);
+
+  const unsigned int N = m_tracers.size();
+
+  for (unsigned int c = 0; c < N; ++c) {
+    const IceModelVec3 &T = *m_tracers[c];
+
+    coarse_to_fine(T, m_i, m_j, &m_column[0]);
+    load_tracer(m_column, c, N, m_ks, m_T);
+
+    coarse_to_fine(T, m_i, m_j+1, &m_column[0]);
+    load_tracer(m_column, c, N, m_ks, m_T_n);
+
+    coarse_to_fine(T, m_i+1, m_j, &m_column[0]);
+    load_tracer(m_column, c, N, m_ks, m_T_e);
+
+    coarse_to_fine(T, m_i, m_j-1, &m_column[0]);
+    load_tracer(m_column, c, N, m_ks, m_T_s);
+
+    coarse_to_fine(T, m_i-1, m_j, &m_column[0]);
+    load_tracer(m_column, c, N, m_ks, m_T_w);
+  }
+}
+
+//! First-order upwind scheme with implicit in the vertical: one column solve for all tracers.
+/*!
+  The PDE being solved for each tracer \f$T_c\f$ is
+  \f[ \frac{\partial T_c}{\partial t} + \frac{\partial}{\partial x}\left(u T_c\right) + \frac{\partial}{\partial y}\left(v T_c\right) + \frac{\partial}{\partial z}\left(w T_c\right) = s_c, \f]
+  where \f$s_c\f$ is `sources[c]` (constant in space).
+
+  The tracer `c` is set to `boundary_values[c]` at the ice surface and at the base if the
+  ice velocity in the bottom cell is upward (compare AgeColumnSystem::solve(), which is
+  the special case of one tracer with \f$s = 1\f$ and the boundary value of zero).
+
+  On return `x[c]` contains the column of the tracer `c` on the fine grid.
+ */
+void TracerColumnSystem::solve(const std::vector<double> &sources,
+                               const std::vector<double> &boundary_values,
+                               std::vector<std::vector<double> > &x) {
+
+  const unsigned int N = m_tracers.size();
+
+  if (sources.size() != N or boundary_values.size() != N) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "expected %d sources and boundary values, got %d and %d",
+                                  N, (int)sources.size(), (int)boundary_values.size());
+  }
+
+  TridiagonalSystem &S = *m_solver;
+
+  // set up system: 0 <= k < m_ks
+  for (unsigned int k = 0; k < m_ks; k++) {
+    const double
+      *T   = &m_T[k * N],
+      *T_n = &m_T_n[k * N],
+      *T_e = &m_T_e[k * N],
+      *T_s = &m_T_s[k * N],
+      *T_w = &m_T_w[k * N];
+    double *rhs = &m_rhs[k * N];
+
+    // do lowest-order upwinding, explicitly for horizontal; upwind directions depend on
+    // the velocity only and are the same for all tracers
+    const double
+      u = m_u[k],
+      v = m_v[k];
+    for (unsigned int c = 0; c < N; ++c) {
+      double adv = (u < 0 ?
+                    u * (T_e[c] - T[c]) / m_dx :
+                    u * (T[c] - T_w[c]) / m_dx);
+      adv += (v < 0 ?
+              v * (T_n[c] - T[c]) / m_dy :
+              v * (T[c] - T_s[c]) / m_dy);
+
+      rhs[c] = T[c] + m_dt * (sources[c] - adv);
+    }
+
+    // do lowest-order upwinding, *implicitly* for vertical
+    double AA = m_nu * m_w[k];
+    if (k > 0) {
+      if (AA >= 0) { // upward velocity
+        S.L(k) = - AA;
+        S.D(k) = 1.0 + AA;
+        S.U(k) = 0.0;
+      } else { // downward velocity; note  -AA >= 0
+        S.L(k) = 0.0;
+        S.D(k) = 1.0 - AA;
+        S.U(k) = + AA;
+      }
+    } else { // k == 0 case
+      // note L[0] is not used
+      if (AA > 0) { // if strictly upward velocity apply boundary condition
+        S.D(0) = 1.0;
+        S.U(0) = 0.0;
+        for (unsigned int c = 0; c < N; ++c) {
+          rhs[c] = boundary_values[c];
+        }
+      } else { // downward velocity; note  -AA >= 0
+        S.D(0) = 1.0 - AA;
+        S.U(0) = + AA;
+        // keep rhs as is
+      }
+    }
+  }  // done "set up system: 0 <= k < m_ks"
+
+  // surface b.c. at m_ks
+  if (m_ks > 0) {
+    S.L(m_ks) = 0;
+    S.D(m_ks) = 1.0;   // ignore U[m_ks]
+    for (unsigned int c = 0; c < N; ++c) {
+      m_rhs[m_ks * N + c] = boundary_values[c];
+    }
+  }
+
+  // solve it
+  try {
+    S.solve(m_ks + 1, N, m_rhs.data(), m_x.data());
+  }
+  catch (RuntimeError &e) {
+    e.add_context("solving the tri-diagonal system (TracerColumnSystem) at (%d, %d)",
+                  m_i, m_j);
+    throw;
+  }
+
+  // copy solutions; tracer values above the surface are set to boundary values
+  const size_t Mz = m_z.size();
+  x.resize(N);
+  for (unsigned int c = 0; c < N; ++c) {
+    x[c].resize(Mz);
+
+    for (unsigned int k = 0; k <= m_ks; k++) {
+      x[c][k] = m_x[k * N + c];
+    }
+    for (unsigned int k = m_ks + 1; k < Mz; k++) {
+      x[c][k] = boundary_values[c];
+    }
+  }
+}
+
+} // end of namespace pism
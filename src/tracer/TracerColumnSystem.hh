@@ -0,0 +1,62 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TRACERCOLUMNSYSTEM_H
+#define TRACERCOLUMNSYSTEM_H
+
+#include "pism/util/ColumnSystem.hh"
+
+namespace pism {
+
+//! Tridiagonal linear systems for vertical columns of several passive tracers.
+/*!
+  Uses the method of AgeColumnSystem (first-order upwinding, implicit in the vertical) to
+  advect `N` tracers at once. Velocity components are interpolated to the fine grid once
+  per column and all tracers share the matrix of the system, so each column requires one
+  factorization and `N` back-substitutions.
+ */
+class TracerColumnSystem : public columnSystemCtx {
+public:
+  TracerColumnSystem(const std::vector<double>& storage_grid,
+                     const std::string &my_prefix,
+                     double dx, double dy, double dt,
+                     const std::vector<const IceModelVec3*> &tracers,
+                     const IceModelVec3 &u3,
+                     const IceModelVec3 &v3,
+                     const IceModelVec3 &w3);
+
+  unsigned int n_tracers() const;
+
+  void init(int i, int j, double thickness);
+
+  void solve(const std::vector<double> &sources,
+             const std::vector<double> &boundary_values,
+             std::vector<std::vector<double> > &x);
+protected:
+  std::vector<const IceModelVec3*> m_tracers;
+  double m_nu;
+  //! tracer values at the current column and its neighbors; tracer `c` in row `k` is
+  //! stored at `k * n_tracers() + c`
+  std::vector<double> m_T, m_T_n, m_T_e, m_T_s, m_T_w;
+  std::vector<double> m_column, m_rhs, m_x;
+};
+
+} // end of namespace pism
+
+#endif /* TRACERCOLUMNSYSTEM_H */
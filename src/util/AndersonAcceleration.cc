@@ -0,0 +1,170 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cmath>
+#include <algorithm>            // std::max, std::swap
+
+#include "AndersonAcceleration.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+
+AndersonAcceleration::AndersonAcceleration(MPI_Comm com, unsigned int depth)
+  : m_com(com), m_depth(depth) {
+  // empty
+}
+
+//! Forget the history (call this when starting a new fixed-point iteration).
+void AndersonAcceleration::reset() {
+  m_f_old.clear();
+  m_g_old.clear();
+  m_dF.clear();
+  m_dG.clear();
+}
+
+unsigned int AndersonAcceleration::history_size() const {
+  return m_dF.size();
+}
+
+/*!
+ * Given the current iterate `x` and `g` = G(`x`), compute the next iterate. The result
+ * is stored in `g`.
+ *
+ * If the least squares problem is (numerically) singular the history is discarded and
+ * `g` is not modified, i.e. this step is a plain fixed-point step.
+ */
+void AndersonAcceleration::update(const std::vector<double> &x, std::vector<double> &g) {
+  if (m_depth == 0) {
+    return;
+  }
+
+  const size_t N = x.size();
+
+  std::vector<double> f(N);
+  for (size_t k = 0; k < N; ++k) {
+    f[k] = g[k] - x[k];
+  }
+
+  if (not m_f_old.empty()) {
+    std::vector<double> df(N), dg(N);
+    for (size_t k = 0; k < N; ++k) {
+      df[k] = f[k] - m_f_old[k];
+      dg[k] = g[k] - m_g_old[k];
+    }
+    m_dF.push_back(df);
+    m_dG.push_back(dg);
+
+    if (m_dF.size() > m_depth) {
+      m_dF.pop_front();
+      m_dG.pop_front();
+    }
+  }
+
+  m_f_old = f;
+  m_g_old = g;
+
+  const unsigned int n = m_dF.size();
+  if (n == 0) {
+    return;
+  }
+
+  // Assemble normal equations A gamma = b, where A = dF^T dF and b = dF^T f. The last
+  // row of `local` contains b.
+  std::vector<double> local(n * (n + 1), 0.0), A(n * (n + 1));
+  for (unsigned int i = 0; i < n; ++i) {
+    for (unsigned int j = 0; j <= i; ++j) {
+      double sum = 0.0;
+      for (size_t k = 0; k < N; ++k) {
+        sum += m_dF[i][k] * m_dF[j][k];
+      }
+      local[i * n + j] = sum;
+    }
+
+    double sum = 0.0;
+    for (size_t k = 0; k < N; ++k) {
+      sum += m_dF[i][k] * f[k];
+    }
+    local[n * n + i] = sum;
+  }
+  GlobalSum(m_com, local.data(), A.data(), local.size());
+
+  std::vector<double> b(A.begin() + n * n, A.end());
+  for (unsigned int i = 0; i < n; ++i) {
+    for (unsigned int j = 0; j < i; ++j) {
+      A[j * n + i] = A[i * n + j];
+    }
+    // mild regularization
+    A[i * n + i] *= 1.0 + 1e-12;
+  }
+
+  // Solve using Gaussian elimination with partial pivoting.
+  double max_diagonal = 0.0;
+  for (unsigned int i = 0; i < n; ++i) {
+    max_diagonal = std::max(max_diagonal, A[i * n + i]);
+  }
+
+  for (unsigned int c = 0; c < n; ++c) {
+    unsigned int pivot = c;
+    for (unsigned int r = c + 1; r < n; ++r) {
+      if (std::fabs(A[r * n + c]) > std::fabs(A[pivot * n + c])) {
+        pivot = r;
+      }
+    }
+
+    if (not (std::fabs(A[pivot * n + c]) > 1e-14 * max_diagonal)) {
+      // singular: fall back to the fixed-point step
+      reset();
+      return;
+    }
+
+    if (pivot != c) {
+      for (unsigned int j = 0; j < n; ++j) {
+        std::swap(A[c * n + j], A[pivot * n + j]);
+      }
+      std::swap(b[c], b[pivot]);
+    }
+
+    for (unsigned int r = c + 1; r < n; ++r) {
+      const double factor = A[r * n + c] / A[c * n + c];
+      for (unsigned int j = c; j < n; ++j) {
+        A[r * n + j] -= factor * A[c * n + j];
+      }
+      b[r] -= factor * b[c];
+    }
+  }
+
+  std::vector<double> gamma(n);
+  for (int i = n - 1; i >= 0; --i) {
+    double sum = b[i];
+    for (unsigned int j = i + 1; j < n; ++j) {
+      sum -= A[i * n + j] * gamma[j];
+    }
+    gamma[i] = sum / A[i * n + i];
+  }
+
+  for (unsigned int j = 0; j < n; ++j) {
+    const std::vector<double> &dg = m_dG[j];
+    for (size_t k = 0; k < N; ++k) {
+      g[k] -= gamma[j] * dg[k];
+    }
+  }
+}
+
+} // end of namespace pism
@@ -0,0 +1,64 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ANDERSONACCELERATION_H
+#define ANDERSONACCELERATION_H
+
+#include <vector>
+#include <deque>
+#include <mpi.h>
+
+namespace pism {
+
+//! Anderson acceleration (Anderson mixing) of a fixed-point iteration `x <- G(x)`.
+/*!
+ * Uses the "type II" formulation from [Walker and Ni, 2011, doi:10.1137/10078356X]:
+ * given `x_k` and `g_k = G(x_k)`, the next iterate is
+ *
+ * @f[ x_{k+1} = g_k - \sum_{j} \gamma_j \Delta g_j, @f]
+ *
+ * where @f$ \gamma @f$ minimizes @f$ \| f_k - \sum_j \gamma_j \Delta f_j \|_2 @f$,
+ * @f$ f_k = g_k - x_k @f$ is the residual, and @f$ \Delta f_j @f$, @f$ \Delta g_j @f$
+ * are differences of consecutive residuals and values of @f$ G @f$ (at most `depth` of them).
+ *
+ * Vectors contain the part of a distributed field owned by this rank; the least squares
+ * problem is solved using normal equations assembled using one reduction per iteration.
+ */
+class AndersonAcceleration {
+public:
+  AndersonAcceleration(MPI_Comm com, unsigned int depth);
+
+  void reset();
+
+  void update(const std::vector<double> &x, std::vector<double> &g);
+
+  unsigned int history_size() const;
+private:
+  MPI_Comm m_com;
+  unsigned int m_depth;
+
+  //! residual and the value of G from the previous iteration
+  std::vector<double> m_f_old, m_g_old;
+  //! differences of consecutive residuals and values of G
+  std::deque<std::vector<double> > m_dF, m_dG;
+};
+
+} // end of namespace pism
+
+#endif /* ANDERSONACCELERATION_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 PISM Authors
+// Copyright (C) 2004-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -17,6 +17,7 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cassert>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -236,27 +237,201 @@ void TridiagonalSystem::solve(unsigned int system_size, double *result) {
   }
 }
 
+//! Solve the system with `n_rhs` right-hand sides.
+/*!
+  Uses the matrix set using L(), D(), and U() (entries set using RHS() are ignored).
+
+  The right-hand side `c` in row `k` is `rhs[k * n_rhs + c]`; the solution is stored in
+  `result` using the same layout. The matrix is factored once and the loop over
+  right-hand sides is the innermost loop.
+ */
+void TridiagonalSystem::solve(unsigned int system_size, unsigned int n_rhs,
+                              const double *rhs, double *result) {
+  assert(system_size >= 1);
+  assert(system_size <= m_max_system_size);
+
+  if (m_D[0] == 0.0) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "zero pivot at row 1");
+  }
+
+  const size_t N = n_rhs;
+
+  double b = m_D[0];
+
+  for (unsigned int c = 0; c < n_rhs; ++c) {
+    result[c] = rhs[c] / b;
+  }
+
+  for (unsigned int k = 1; k < system_size; ++k) {
+    m_work[k] = m_U[k - 1] / b;
+
+    b = m_D[k] - m_L[k] * m_work[k];
+
+    if (b == 0.0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION, "zero pivot at row %d", k + 1);
+    }
+
+    const double L = m_L[k], *f = &rhs[k * N], *x_prev = &result[(k - 1) * N];
+    double *x = &result[k * N];
+    for (unsigned int c = 0; c < n_rhs; ++c) {
+      x[c] = (f[c] - L * x_prev[c]) / b;
+    }
+  }
+
+  for (int k = system_size - 2; k >= 0; --k) {
+    const double w = m_work[k + 1], *x_next = &result[(k + 1) * N];
+    double *x = &result[k * N];
+    for (unsigned int c = 0; c < n_rhs; ++c) {
+      x[c] -= w * x_next[c];
+    }
+  }
+}
+
 std::string TridiagonalSystem::prefix() const {
   return m_prefix;
 }
 
+//! Allocate storage for `batch_size` tridiagonal systems of maximum size `max_size`.
+TridiagonalSystemBatch::TridiagonalSystemBatch(unsigned int max_size,
+                                               unsigned int batch_size,
+                                               const std::string &prefix)
+  : m_max_system_size(max_size), m_batch_size(batch_size), m_prefix(prefix) {
+  assert(m_max_system_size >= 1 && m_max_system_size < 1e6);
+  assert(m_batch_size >= 1);
+
+  const size_t N = m_max_system_size * m_batch_size;
+
+  m_L.resize(N);
+  m_D.resize(N);
+  m_U.resize(N);
+  m_rhs.resize(N);
+  m_work.resize(N);
+  m_b.resize(m_batch_size);
+}
+
+unsigned int TridiagonalSystemBatch::batch_size() const {
+  return m_batch_size;
+}
+
+std::string TridiagonalSystemBatch::prefix() const {
+  return m_prefix;
+}
+
+void TridiagonalSystemBatch::solve(unsigned int system_size, unsigned int n_systems,
+                                   std::vector<double> &result) {
+  result.resize(m_max_system_size * m_batch_size);
+
+  solve(system_size, n_systems, result.data());
+}
+
+//! Solve the first `n_systems` systems in the batch.
+/*!
+  This is the algorithm used by TridiagonalSystem::solve(), with the loop over systems
+  moved inside the loop over rows.
+
+  The solution of the system `c` in row `k` is stored in `result[k * batch_size + c]`.
+ */
+void TridiagonalSystemBatch::solve(unsigned int system_size, unsigned int n_systems,
+                                   double *result) {
+  assert(system_size >= 1);
+  assert(system_size <= m_max_system_size);
+  assert(n_systems <= m_batch_size);
+
+  const size_t N = m_batch_size;
+
+  // Loops below use pointers to rows to make them easier to vectorize.
+  double *b = m_b.data();
+
+  for (unsigned int c = 0; c < n_systems; ++c) {
+    if (m_D[c] == 0.0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "zero pivot at row 1 (system %d)", c);
+    }
+  }
+
+  {
+    const double *D = &m_D[0], *rhs = &m_rhs[0];
+    double *x = result;
+    for (unsigned int c = 0; c < n_systems; ++c) {
+      b[c] = D[c];
+      x[c] = rhs[c] / b[c];
+    }
+  }
+
+  for (unsigned int k = 1; k < system_size; ++k) {
+    const double
+      *L      = &m_L[k * N],
+      *D      = &m_D[k * N],
+      *U      = &m_U[(k - 1) * N],
+      *rhs    = &m_rhs[k * N],
+      *x_prev = &result[(k - 1) * N];
+    double
+      *w = &m_work[k * N],
+      *x = &result[k * N];
+
+    for (unsigned int c = 0; c < n_systems; ++c) {
+      w[c] = U[c] / b[c];
+      b[c] = D[c] - L[c] * w[c];
+    }
+
+    // checking pivots in a separate loop keeps the loop above free of branches
+    for (unsigned int c = 0; c < n_systems; ++c) {
+      if (b[c] == 0.0) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "zero pivot at row %d (system %d)", k + 1, c);
+      }
+    }
+
+    for (unsigned int c = 0; c < n_systems; ++c) {
+      x[c] = (rhs[c] - L[c] * x_prev[c]) / b[c];
+    }
+  }
+
+  for (int k = system_size - 2; k >= 0; --k) {
+    const double
+      *w      = &m_work[(k + 1) * N],
+      *x_next = &result[(k + 1) * N];
+    double *x = &result[k * N];
+
+    for (unsigned int c = 0; c < n_systems; ++c) {
+      x[c] -= w[c] * x_next[c];
+    }
+  }
+}
+
 //! A column system is a kind of a tridiagonal system.
+/*!
+ * By default the system uses an equally-spaced "fine" grid and interpolates from and to
+ * the storage grid. If `use_storage_grid` is set, the system uses the storage grid
+ * itself; in this case the vertical spacing may vary from level to level (see
+ * dz(unsigned int)) and no interpolation is done.
+ */
 columnSystemCtx::columnSystemCtx(const std::vector<double>& storage_grid,
                                  const std::string &prefix,
                                  double dx, double dy, double dt,
                                  const IceModelVec3 &u3,
                                  const IceModelVec3 &v3,
-                                 const IceModelVec3 &w3)
-  : m_dx(dx), m_dy(dy), m_dt(dt), m_u3(u3), m_v3(v3), m_w3(w3) {
+                                 const IceModelVec3 &w3,
+                                 bool use_storage_grid)
+  : m_interp(NULL), m_dx(dx), m_dy(dy), m_dt(dt), m_use_storage_grid(use_storage_grid),
+    m_u3(u3), m_v3(v3), m_w3(w3) {
   assert(dx > 0.0);
   assert(dy > 0.0);
   assert(dt > 0.0);
 
   init_fine_grid(storage_grid);
 
+  if (m_use_storage_grid) {
+    // m_dz (the minimum spacing computed by init_fine_grid()) is kept as the reference
+    // spacing
+    m_z = storage_grid;
+  }
+
   m_solver = new TridiagonalSystem(m_z.size(), prefix);
 
-  m_interp = new ColumnInterpolation(storage_grid, m_z);
+  if (not m_use_storage_grid) {
+    m_interp = new ColumnInterpolation(storage_grid, m_z);
+  }
 
   m_u.resize(m_z.size());
   m_v.resize(m_z.size());
@@ -276,20 +451,61 @@ double columnSystemCtx::dz() const {
   return m_dz;
 }
 
+//! Vertical spacing between levels `k` and `k + 1` (between the last two levels if `k` is
+//! the top level).
+double columnSystemCtx::dz(unsigned int k) const {
+  if (not m_use_storage_grid) {
+    return m_dz;
+  }
+
+  const unsigned int N = m_z.size();
+  k = std::min(k, N - 2);
+
+  return m_z[k + 1] - m_z[k];
+}
+
+//! Index of the highest level of the grid used by this system that is at or below
+//! `height` above the base of the ice.
+unsigned int columnSystemCtx::k_below_height(double height) const {
+  unsigned int result = 0;
+
+  if (m_use_storage_grid) {
+    auto top = std::upper_bound(m_z.begin(), m_z.end(), height);
+    result = top == m_z.begin() ? 0 : (top - m_z.begin()) - 1;
+  } else {
+    result = static_cast<unsigned int>(floor(height / m_dz));
+  }
+
+  // Force the result to be in the allowed range.
+  return std::min(result, (unsigned int)m_z.size() - 1);
+}
+
 const std::vector<double>& columnSystemCtx::z() const {
   return m_z;
 }
 
 void columnSystemCtx::fine_to_coarse(const std::vector<double> &fine, int i, int j,
                                      IceModelVec3& coarse) const {
-  double *array = coarse.get_column(i, j);
-  m_interp->fine_to_coarse(&fine[0], array);
+  fine_to_coarse(fine, coarse.get_column(i, j));
+}
+
+//! Interpolate from the fine grid to a column on the storage grid.
+void columnSystemCtx::fine_to_coarse(const std::vector<double> &fine, double *coarse) const {
+  if (m_use_storage_grid) {
+    std::copy(fine.begin(), fine.end(), coarse);
+  } else {
+    m_interp->fine_to_coarse(&fine[0], coarse);
+  }
 }
 
 void columnSystemCtx::coarse_to_fine(const IceModelVec3 &coarse, int i, int j,
                                      double* fine) const {
   const double *array = coarse.get_column(i, j);
-  m_interp->coarse_to_fine(array, m_ks, fine);
+  if (m_use_storage_grid) {
+    std::copy(array, array + m_z.size(), fine);
+  } else {
+    m_interp->coarse_to_fine(array, m_ks, fine);
+  }
 }
 
 void columnSystemCtx::init_fine_grid(const std::vector<double>& storage_grid) {
@@ -317,12 +533,7 @@ void columnSystemCtx::init_column(int i, int j,
                                   double ice_thickness) {
   m_i  = i;
   m_j  = j;
-  m_ks = static_cast<unsigned int>(floor(ice_thickness / m_dz));
-
-  // Force m_ks to be in the allowed range.
-  if (m_ks >= m_z.size()) {
-    m_ks = m_z.size() - 1;
-  }
+  m_ks = k_below_height(ice_thickness);
 
   m_solver->reset();
 
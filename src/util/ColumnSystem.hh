@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2019 PISM Authors
+// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -91,6 +91,7 @@ public:
   // copying
   void solve(unsigned int system_size, std::vector<double> &result);
   void solve(unsigned int system_size, double *result);
+  void solve(unsigned int system_size, unsigned int n_rhs, const double *rhs, double *result);
 
   void save_system_with_solution(const std::string &filename,
                                  unsigned int system_size,
@@ -131,6 +132,49 @@ private:
   std::string m_prefix;
 };
 
+//! A batch of tridiagonal systems of the same size, solved together.
+/*!
+  Uses the same notation and algorithm as TridiagonalSystem, but stores `batch_size`
+  systems in the "structure of arrays" layout: entries in row `k` of all systems are
+  stored next to each other (`L(k, c)` is at `k * batch_size + c`). This way the loop
+  over systems is the innermost loop in solve() and can be vectorized by the compiler.
+
+  Solutions are stored using the same layout.
+*/
+class TridiagonalSystemBatch {
+public:
+  TridiagonalSystemBatch(unsigned int max_size, unsigned int batch_size,
+                         const std::string &prefix);
+
+  unsigned int batch_size() const;
+
+  void solve(unsigned int system_size, unsigned int n_systems, double *result);
+  void solve(unsigned int system_size, unsigned int n_systems, std::vector<double> &result);
+
+  std::string prefix() const;
+
+  double& L(size_t k, size_t c) {
+    return m_L[k * m_batch_size + c];
+  }
+  double& D(size_t k, size_t c) {
+    return m_D[k * m_batch_size + c];
+  }
+  double& U(size_t k, size_t c) {
+    return m_U[k * m_batch_size + c];
+  }
+  double& RHS(size_t k, size_t c) {
+    return m_rhs[k * m_batch_size + c];
+  }
+private:
+  unsigned int m_max_system_size;
+  unsigned int m_batch_size;
+  std::vector<double> m_L, m_D, m_U, m_rhs, m_work;
+  // diagonal entries of the factored matrix (one row)
+  std::vector<double> m_b;
+
+  std::string m_prefix;
+};
+
 class IceModelVec3;
 class ColumnInterpolation;
 
@@ -142,17 +186,21 @@ class columnSystemCtx {
 public:
   columnSystemCtx(const std::vector<double>& storage_grid, const std::string &prefix,
                   double dx, double dy, double dt,
-                  const IceModelVec3 &u3, const IceModelVec3 &v3, const IceModelVec3 &w3);
+                  const IceModelVec3 &u3, const IceModelVec3 &v3, const IceModelVec3 &w3,
+                  bool use_storage_grid = false);
   ~columnSystemCtx();
 
   void save_to_file(const std::vector<double> &x);
   void save_to_file(const std::string &filename, const std::vector<double> &x);
 
   unsigned int ks() const;
+  unsigned int k_below_height(double height) const;
   double dz() const;
+  double dz(unsigned int k) const;
   const std::vector<double>& z() const;
   void fine_to_coarse(const std::vector<double> &fine, int i, int j,
                       IceModelVec3& coarse) const;
+  void fine_to_coarse(const std::vector<double> &fine, double *coarse) const;
 protected:
   TridiagonalSystem *m_solver;
 
@@ -165,13 +213,16 @@ protected:
 
   double m_dx, m_dy, m_dz, m_dt;
 
+  //! true if this system uses the storage grid instead of the equally-spaced fine grid
+  bool m_use_storage_grid;
+
   //! u-component of the ice velocity
   std::vector<double> m_u;
   //! v-component of the ice velocity
   std::vector<double> m_v;
   //! w-component of the ice velocity
   std::vector<double> m_w;
-  //! levels of the fine vertical grid
+  //! levels of the fine vertical grid (or the storage grid, see m_use_storage_grid)
   std::vector<double> m_z;
 
   //! pointers to 3D velocity components
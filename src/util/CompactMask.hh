@@ -0,0 +1,146 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_COMPACTMASK_H
+#define PISM_COMPACTMASK_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>            // std::min
+#include <cstdint>              // int8_t, int16_t, int32_t
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+//! A compact copy of an integer mask.
+/*!
+ * IceModelVec2Int stores masks as `double`, so reading a mask costs 8 bytes of memory
+ * traffic and a conversion to `int` per grid point. This class stores a copy of a mask
+ * (at owned grid points and `stencil_width` ghosts around them) using the integer type
+ * `T` (e.g. `int8_t` for cell types) and provides the same read access methods
+ * (as_int(), int_star(), int_box()), so loops reading a mask many times can use it
+ * instead.
+ *
+ * Values are copied from an IceModelVec2Int (including ghosts, if present) and can be
+ * copied back to one; ghost updates and I/O use the IceModelVec2Int.
+ */
+template<typename T>
+class CompactMask {
+public:
+  CompactMask(IceGrid::ConstPtr grid, unsigned int stencil_width)
+    : m_grid(grid), m_stencil_width(stencil_width) {
+    m_x0 = grid->xs() - (int)stencil_width;
+    m_y0 = grid->ys() - (int)stencil_width;
+    m_nx = grid->xm() + 2 * stencil_width;
+    m_ny = grid->ym() + 2 * stencil_width;
+
+    m_data.resize(m_nx * m_ny, 0);
+  }
+
+  unsigned int stencil_width() const {
+    return m_stencil_width;
+  }
+
+  //! Copy `input` (at owned grid points and ghosts, if present) to this mask.
+  /*!
+   * If `input` has fewer ghosts than this mask, values at the remaining ghost points are
+   * not changed.
+   */
+  void copy_from(const IceModelVec2Int &input) {
+    const int width = std::min(input.stencil_width(), m_stencil_width);
+
+    IceModelVec::AccessList list{&input};
+
+    for (PointsWithGhosts p(*m_grid, width); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      int value = input.as_int(i, j);
+
+      if (value < std::numeric_limits<T>::min() or
+          value > std::numeric_limits<T>::max()) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "value %d of %s at (%d, %d) does not fit in a compact mask",
+                                      value, input.get_name().c_str(), i, j);
+      }
+
+      m_data[offset(i, j)] = static_cast<T>(value);
+    }
+  }
+
+  //! Copy values at owned grid points to `output`.
+  void copy_to(IceModelVec2Int &output) const {
+    IceModelVec::AccessList list{&output};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      output(i, j) = m_data[offset(i, j)];
+    }
+
+    output.inc_state_counter();
+  }
+
+  T& operator()(int i, int j) {
+    return m_data[offset(i, j)];
+  }
+
+  int as_int(int i, int j) const {
+    return m_data[offset(i, j)];
+  }
+
+  StarStencil<int> int_star(int i, int j) const {
+    StarStencil<int> result;
+
+    result.ij = as_int(i, j);
+    result.e  = as_int(i + 1, j);
+    result.w  = as_int(i - 1, j);
+    result.n  = as_int(i, j + 1);
+    result.s  = as_int(i, j - 1);
+
+    return result;
+  }
+
+  BoxStencil<int> int_box(int i, int j) const {
+    const int
+      E = i + 1,
+      W = i - 1,
+      N = j + 1,
+      S = j - 1;
+
+    return {as_int(i, j), as_int(i, N), as_int(W, N), as_int(W, j), as_int(W, S),
+            as_int(i, S), as_int(E, S), as_int(E, j), as_int(E, N)};
+  }
+private:
+  size_t offset(int i, int j) const {
+    return (j - m_y0) * m_nx + (i - m_x0);
+  }
+
+  IceGrid::ConstPtr m_grid;
+  unsigned int m_stencil_width;
+  //! the lower left corner and the size of the stored patch (including ghosts)
+  int m_x0, m_y0;
+  size_t m_nx, m_ny;
+  std::vector<T> m_data;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_COMPACTMASK_H */
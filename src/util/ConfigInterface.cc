@@ -19,6 +19,7 @@
 
 #include <mpi.h>
 #include <cmath>
+#include <cstdint>
 
 #include "pism/util/io/File.hh"
 #include "ConfigInterface.hh"
@@ -50,8 +51,41 @@ struct Config::Impl {
   //! @brief Set of parameters used in a run. Used to warn about parameters that were set but were
   //! not used.
   std::set<std::string> parameters_used;
+
+  //! Record the use of a parameter. (Parameters may be read by several threads at once.)
+  void used(const std::string &name) {
+#pragma omp critical (pism_config_parameters_used)
+    parameters_used.insert(name);
+  }
+
+  //! Name of the code that must not look up parameters (see Config::LookupGuard).
+  std::string lookups_forbidden_in;
+
+  //! Stop if a parameter is looked up where this is not allowed.
+  void check_lookup(const std::string &name) const {
+#if (Pism_DEBUG==1)
+    if (not lookups_forbidden_in.empty()) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "parameter %s is looked up in %s;"
+                                    " read it during initialization instead",
+                                    name.c_str(), lookups_forbidden_in.c_str());
+    }
+#else
+    (void) name;
+#endif
+  }
 };
 
+Config::LookupGuard::LookupGuard(const Config &config, const std::string &location)
+  : m_config(config),
+    m_previous_location(config.m_impl->lookups_forbidden_in) {
+  m_config.m_impl->lookups_forbidden_in = location;
+}
+
+Config::LookupGuard::~LookupGuard() {
+  m_config.m_impl->lookups_forbidden_in = m_previous_location;
+}
+
 Config::Config(units::System::Ptr system)
   : m_impl(new Impl(system)) {
   // empty
@@ -61,10 +95,119 @@ Config::~Config() {
   delete m_impl;
 }
 
+//! Broadcast `data` from rank 0 to all ranks in `com`.
+template<typename T>
+static void broadcast(MPI_Comm com, MPI_Datatype type, std::vector<T> &data) {
+  uint64_t size = data.size();
+  MPI_Bcast(&size, 1, MPI_UINT64_T, 0, com);
+
+  data.resize(size);
+  if (size > 0) {
+    MPI_Bcast(data.data(), size, type, 0, com);
+  }
+}
+
+//! Broadcast all parameters of `config` from rank 0 to all ranks in `com`.
+/*!
+ * Strings (including flags) are packed into one buffer as "name\0value\0" pairs, numbers
+ * are sent as a list of names, a list of counts and one array of values.
+ */
+static void broadcast_parameters(MPI_Comm com, Config &config) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  std::vector<char> strings, names;
+  std::vector<int> counts;
+  std::vector<double> values;
+
+  auto pack = [](std::vector<char> &buffer, const std::string &text) {
+    buffer.insert(buffer.end(), text.begin(), text.end());
+    buffer.push_back('\0');
+  };
+
+  if (rank == 0) {
+    auto all_strings = config.all_strings();
+    for (const auto &s : all_strings) {
+      pack(strings, s.first);
+      pack(strings, s.second);
+    }
+
+    for (const auto &f : config.all_flags()) {
+      if (all_strings.find(f.first) != all_strings.end()) {
+        // a string that looks like a flag (already packed)
+        continue;
+      }
+      pack(strings, f.first);
+      pack(strings, f.second ? "true" : "false");
+    }
+
+    for (const auto &d : config.all_doubles()) {
+      pack(names, d.first);
+      counts.push_back(d.second.size());
+      values.insert(values.end(), d.second.begin(), d.second.end());
+    }
+  }
+
+  broadcast(com, MPI_CHAR, strings);
+  broadcast(com, MPI_CHAR, names);
+  broadcast(com, MPI_INT, counts);
+  broadcast(com, MPI_DOUBLE, values);
+
+  if (rank == 0) {
+    return;
+  }
+
+  size_t k = 0;
+  while (k < strings.size()) {
+    std::string name(&strings[k]);
+    k += name.size() + 1;
+    std::string value(&strings[k]);
+    k += value.size() + 1;
+
+    config.set_string(name, value);
+  }
+
+  size_t n = 0, offset = 0;
+  for (int count : counts) {
+    std::string name(&names[n]);
+    n += name.size() + 1;
+
+    config.set_numbers(name, std::vector<double>(values.begin() + offset,
+                                                 values.begin() + offset + count));
+    offset += count;
+  }
+}
+
 void Config::read(MPI_Comm com, const std::string &filename) {
+  int size = 1;
+  MPI_Comm_size(com, &size);
+
+  if (size == 1) {
+    File file(com, filename, PISM_NETCDF3, PISM_READONLY); // OK to use netcdf3
+    this->read(file);
+    return;
+  }
+
+  // A configuration file has thousands of attributes. Reading it collectively broadcasts
+  // them one at a time, which is slow on many ranks. Instead, read the file on rank 0
+  // and broadcast all parameters at once.
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  ParallelSection rank0(com);
+  try {
+    if (rank == 0) {
+      File file(MPI_COMM_SELF, filename, PISM_NETCDF3, PISM_READONLY); // OK to use netcdf3
+      this->read(file);
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+
+  broadcast_parameters(com, *this);
 
-  File file(com, filename, PISM_NETCDF3, PISM_READONLY); // OK to use netcdf3
-  this->read(file);
+  m_impl->filename = filename;
 }
 
 void Config::read(const File &file) {
@@ -142,8 +285,9 @@ Config::Doubles Config::all_doubles() const {
 }
 
 double Config::get_number(const std::string &name, UseFlag flag) const {
+  m_impl->check_lookup(name);
   if (flag == REMEMBER_THIS_USE) {
-    m_impl->parameters_used.insert(name);
+    m_impl->used(name);
   }
   return this->get_number_impl(name);
 }
@@ -164,8 +308,9 @@ double Config::get_number(const std::string &name,
 }
 
 std::vector<double> Config::get_numbers(const std::string &name, UseFlag flag) const {
+  m_impl->check_lookup(name);
   if (flag == REMEMBER_THIS_USE) {
-    m_impl->parameters_used.insert(name);
+    m_impl->used(name);
   }
   return this->get_numbers_impl(name);
 }
@@ -229,8 +374,9 @@ Config::Strings Config::all_strings() const {
 }
 
 std::string Config::get_string(const std::string &name, UseFlag flag) const {
+  m_impl->check_lookup(name);
   if (flag == REMEMBER_THIS_USE) {
-    m_impl->parameters_used.insert(name);
+    m_impl->used(name);
   }
   return this->get_string_impl(name);
 }
@@ -258,8 +404,9 @@ Config::Flags Config::all_flags() const {
 }
 
 bool Config::get_flag(const std::string& name, UseFlag flag) const {
+  m_impl->check_lookup(name);
   if (flag == REMEMBER_THIS_USE) {
-    m_impl->parameters_used.insert(name);
+    m_impl->used(name);
   }
   return this->get_flag_impl(name);
 }
@@ -120,6 +120,23 @@ public:
   std::string type(const std::string &parameter) const;
   std::string option(const std::string &parameter) const;
   std::string choices(const std::string &parameter) const;
+
+  //! Forbid parameter lookups while an instance of this class is in scope.
+  /*!
+   * Looking up a parameter by name is a `std::map` search (sometimes followed by a unit
+   * conversion), so code running at every grid point or every time step should read
+   * parameters it needs during initialization instead. Create a LookupGuard before such a
+   * loop to make sure this is the case: in debug builds any `get_...()` call while the
+   * guard is in scope throws RuntimeError. In optimized builds this class does nothing.
+   */
+  class LookupGuard {
+  public:
+    LookupGuard(const Config &config, const std::string &location);
+    ~LookupGuard();
+  private:
+    const Config &m_config;
+    std::string m_previous_location;
+  };
   // Implementations
 protected:
   virtual void read_impl(const File &nc) = 0;
@@ -17,14 +17,20 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <vector>
+#include <map>
+#include <numeric>              // std::iota
+
 #include "Context.hh"
 #include "Profiling.hh"
+#include "MemoryUsage.hh"
 #include "Units.hh"
 #include "Config.hh"
 #include "Time.hh"
 #include "Logger.hh"
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/error_handling.hh"
+#include "pism/util/io/InputStaging.hh"
 #include "pism/pism_config.hh"
 
 #if (Pism_USE_PIO==1)
@@ -55,8 +61,13 @@ public:
   TimePtr time;
   std::string prefix;
   Profiling profiling;
+  MemoryUsage memory_usage;
   LoggerPtr logger;
   int pio_iosys_id;
+  //! communicators returned by node_aware_com(), indexed by the size of the process grid
+  std::map<std::pair<size_t, size_t>, MPI_Comm> node_aware_coms;
+  //! local copies of input files (see input.staging.directory)
+  std::unique_ptr<io::InputStaging> input_staging;
 };
 
 Context::Context(MPI_Comm c, UnitsSystemPtr sys,
@@ -64,11 +75,22 @@ Context::Context(MPI_Comm c, UnitsSystemPtr sys,
                  LoggerPtr L,
                  const std::string &p)
   : m_impl(new Impl(c, sys, config, EC, t, L, p)) {
-  // empty
+
+  std::string staging_directory = config->get_string("input.staging.directory");
+  if (not staging_directory.empty()) {
+    double max_size = config->get_number("input.staging.max_size") * 1024.0 * 1024.0;
+    m_impl->input_staging.reset(new io::InputStaging(staging_directory, max_size));
+  }
 }
 
 Context::~Context() {
 
+  for (auto &c : m_impl->node_aware_coms) {
+    if (c.second != m_impl->com) {
+      MPI_Comm_free(&c.second);
+    }
+  }
+
 #if (Pism_USE_PIO==1)
   if (m_impl->pio_iosys_id != -1 and
       PIOc_free_iosystem(m_impl->pio_iosys_id) != PIO_NOERR) {
@@ -127,6 +149,10 @@ const Profiling& Context::profiling() const {
   return m_impl->profiling;
 }
 
+const MemoryUsage& Context::memory_usage() const {
+  return m_impl->memory_usage;
+}
+
 Context::ConstLoggerPtr Context::log() const {
   return m_impl->logger;
 }
@@ -168,6 +194,244 @@ int Context::pio_iosys_id() const {
   return m_impl->pio_iosys_id;
 }
 
+/*!
+ * Number of aggregators used by the `netcdf3_aggregated` I/O backend (pass it to File).
+ *
+ * Zero means "pick one automatically".
+ */
+int Context::netcdf3_n_aggregators() const {
+  return config()->get_number("output.netcdf3_aggregated.n_aggregators");
+}
+
+/*!
+ * Use an I/O system created elsewhere (see pio_init_async()). This context frees it when
+ * it is destroyed.
+ */
+void Context::set_pio_iosys_id(int iosysid) {
+  if (m_impl->pio_iosys_id != -1) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "ParallelIO I/O system is already initialized");
+  }
+  m_impl->pio_iosys_id = iosysid;
+}
+
+/*!
+ * Number of ghost values (one layer, box stencil, periodic boundaries) that patches of the
+ * process grid with ownership ranges `procs_x` and `procs_y` receive from other nodes.
+ *
+ * `node[p]` is the index of the node owning the patch `p`.
+ */
+static double inter_node_halo(const std::vector<unsigned int> &procs_x,
+                              const std::vector<unsigned int> &procs_y,
+                              const std::vector<int> &node) {
+  const int
+    Nx = procs_x.size(),
+    Ny = procs_y.size();
+
+  double result = 0.0;
+  for (int j = 0; j < Ny; ++j) {
+    for (int i = 0; i < Nx; ++i) {
+      const int p = j * Nx + i;
+
+      for (int dj = -1; dj <= 1; ++dj) {
+        for (int di = -1; di <= 1; ++di) {
+          if (di == 0 and dj == 0) {
+            continue;
+          }
+
+          const int q = ((j + dj + Ny) % Ny) * Nx + (i + di + Nx) % Nx;
+
+          if (node[q] != node[p]) {
+            result += (di == 0 ? procs_x[i] : 1.0) * (dj == 0 ? procs_y[j] : 1.0);
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+/*!
+ * Creates a communicator containing processes in `com` ordered so that each compute node
+ * owns a rectangular block of adjacent patches of the process grid with ownership ranges
+ * `procs_x` and `procs_y`. (PETSc's DMDA assigns the patch `(i, j)` to the rank `j * Nx + i`,
+ * so with the default ordering a node owns one or several rows of patches.)
+ *
+ * Returns `com` if nodes run different numbers of processes or their patches cannot be
+ * tiled using equal blocks.
+ */
+static MPI_Comm node_block_com(MPI_Comm com,
+                               const std::vector<unsigned int> &procs_x,
+                               const std::vector<unsigned int> &procs_y,
+                               const Logger &log) {
+  int rank = 0, size = 0;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  const int
+    Nx = procs_x.size(),
+    Ny = procs_y.size();
+
+  if (Nx * Ny != size) {
+    return com;
+  }
+
+  // processes sharing memory, i.e. running on the same node
+  int node_rank = 0, node_size = 0, leader = rank;
+  {
+    MPI_Comm node_com = MPI_COMM_NULL;
+    MPI_Comm_split_type(com, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_com);
+    MPI_Comm_rank(node_com, &node_rank);
+    MPI_Comm_size(node_com, &node_size);
+    MPI_Bcast(&leader, 1, MPI_INT, 0, node_com);
+    MPI_Comm_free(&node_com);
+  }
+
+  // the index of a node is the number of nodes with leaders (the lowest ranks) below ours
+  std::vector<int> leaders(size), node_sizes(size);
+  MPI_Allgather(&leader, 1, MPI_INT, leaders.data(), 1, MPI_INT, com);
+  MPI_Allgather(&node_size, 1, MPI_INT, node_sizes.data(), 1, MPI_INT, com);
+
+  int node = 0;
+  for (int r = 0; r < leader; ++r) {
+    node += leaders[r] == r ? 1 : 0;
+  }
+
+  for (int r = 0; r < size; ++r) {
+    if (node_sizes[r] != node_size) {
+      log.message(2, "* Nodes run different numbers of processes: using the default process placement\n");
+      return com;
+    }
+  }
+
+  // choose the block of bw by bh patches with the shortest perimeter
+  int bw = 0, bh = 0;
+  for (int w = 1; w <= node_size; ++w) {
+    const int h = node_size / w;
+    if (w * h == node_size and Nx % w == 0 and Ny % h == 0 and
+        (bw == 0 or w + h < bw + bh)) {
+      bw = w;
+      bh = h;
+    }
+  }
+
+  if (bw == 0) {
+    log.message(2, "* Cannot tile a %d x %d process grid using blocks of %d processes:"
+                " using the default process placement\n", Nx, Ny, node_size);
+    return com;
+  }
+
+  // the patch owned by this process: blocks are numbered row by row, as are patches
+  // within a block
+  const int
+    blocks_x = Nx / bw,
+    i        = (node % blocks_x) * bw + node_rank % bw,
+    j        = (node / blocks_x) * bh + node_rank / bw,
+    patch    = j * Nx + i;
+
+  std::vector<int> patches(size), node_before(size), node_after(size);
+  MPI_Allgather(&patch, 1, MPI_INT, patches.data(), 1, MPI_INT, com);
+  MPI_Allgather(&node, 1, MPI_INT, node_before.data(), 1, MPI_INT, com);
+  for (int r = 0; r < size; ++r) {
+    node_after[patches[r]] = node_before[r];
+  }
+
+  log.message(2,
+              "* Node-aware process placement: %d x %d patches per node\n"
+              "  inter-node halo: %.0f grid points (default placement), %.0f (node-aware)\n",
+              bw, bh,
+              inter_node_halo(procs_x, procs_y, node_before),
+              inter_node_halo(procs_x, procs_y, node_after));
+
+  MPI_Comm result = MPI_COMM_NULL;
+  MPI_Comm_split(com, 0, patch, &result);
+
+  return result;
+}
+
+/*!
+ * Returns a communicator containing processes in com() ordered so that patches owned by
+ * processes on the same compute node are adjacent (see grid.partitioning.node_aware).
+ *
+ * Communicators are created once for each size of the process grid and kept, so all grids
+ * with the same process grid use the same communicator.
+ */
+MPI_Comm Context::node_aware_com(const std::vector<unsigned int> &procs_x,
+                                 const std::vector<unsigned int> &procs_y) const {
+  auto key = std::make_pair(procs_x.size(), procs_y.size());
+
+  auto it = m_impl->node_aware_coms.find(key);
+  if (it != m_impl->node_aware_coms.end()) {
+    return it->second;
+  }
+
+  MPI_Comm result = node_block_com(m_impl->com, procs_x, procs_y, *m_impl->logger);
+  m_impl->node_aware_coms[key] = result;
+
+  return result;
+}
+
+/*!
+ * Reserve the last `n_servers` processes in `com` as ParallelIO I/O servers ("async"
+ * mode).
+ *
+ * Compute processes send data to I/O servers and continue, so writing output (using
+ * `pio_*` backends) overlaps with computation.
+ *
+ * On compute processes this returns the communicator containing compute processes and
+ * sets `iosysid` (pass it to Context::set_pio_iosys_id()). On I/O servers this call
+ * returns `MPI_COMM_NULL` once compute processes free the I/O system, i.e. at the end of
+ * the run.
+ */
+MPI_Comm pio_init_async(MPI_Comm com, int n_servers, int &iosysid) {
+#if (Pism_USE_PIO==1)
+  int size = 0;
+  MPI_Comm_size(com, &size);
+
+  if (n_servers < 1 or n_servers >= size) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "number of ParallelIO I/O servers (%d) has to be positive"
+                                  " and less than the communicator size (%d)",
+                                  n_servers, size);
+  }
+
+  int n_compute = size - n_servers;
+
+  std::vector<int> compute_ranks(n_compute), server_ranks(n_servers);
+  std::iota(compute_ranks.begin(), compute_ranks.end(), 0);
+  std::iota(server_ranks.begin(), server_ranks.end(), n_compute);
+
+  int *proc_list[] = {compute_ranks.data()};
+
+  int ierr = PIOc_set_iosystem_error_handling(PIO_DEFAULT, PIO_BCAST_ERROR, NULL);
+  if (ierr != 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "Failed to initialize ParallelIO");
+  }
+
+  MPI_Comm
+    io_comm      = MPI_COMM_NULL,
+    compute_comm = MPI_COMM_NULL;
+
+  // On I/O servers this runs the message handling loop and returns when compute processes
+  // call PIOc_free_iosystem().
+  ierr = PIOc_init_async(com, n_servers, server_ranks.data(),
+                         1, &n_compute, proc_list,
+                         &io_comm, &compute_comm,
+                         PIO_REARR_BOX, &iosysid);
+  if (ierr != 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "Failed to initialize ParallelIO I/O servers");
+  }
+
+  return compute_comm;
+#else
+  (void) com;
+  (void) n_servers;
+  (void) iosysid;
+  throw RuntimeError(PISM_ERROR_LOCATION,
+                     "ParallelIO I/O servers require PISM built with ParallelIO");
+#endif
+}
+
 Context::Ptr context_from_options(MPI_Comm com, const std::string &prefix) {
   // unit system
   units::System::Ptr sys(new units::System);
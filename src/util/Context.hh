@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <mpi.h>
 
@@ -35,6 +36,7 @@ class Config;
 class EnthalpyConverter;
 class Time;
 class Profiling;
+class MemoryUsage;
 class Logger;
 
 class Context {
@@ -66,6 +68,7 @@ public:
   ConstTimePtr time() const;
   const std::string& prefix() const;
   const Profiling& profiling() const;
+  const MemoryUsage& memory_usage() const;
 
   ConstLoggerPtr log() const;
   LoggerPtr log();
@@ -74,6 +77,12 @@ public:
   TimePtr time();
 
   int pio_iosys_id() const;
+  void set_pio_iosys_id(int iosysid);
+
+  int netcdf3_n_aggregators() const;
+
+  MPI_Comm node_aware_com(const std::vector<unsigned int> &procs_x,
+                          const std::vector<unsigned int> &procs_y) const;
 private:
   class Impl;
   Impl *m_impl;
@@ -85,6 +94,8 @@ private:
 //! Create a default context using options.
 Context::Ptr context_from_options(MPI_Comm com, const std::string &prefix);
 
+MPI_Comm pio_init_async(MPI_Comm com, int n_servers, int &iosysid);
+
 } // end of namespace pism
 
 #endif /* _CONTEXT_H_ */
@@ -0,0 +1,296 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+
+#include "pism/util/Decimation.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/io/File.hh"
+#include "pism/util/io/io_helpers.hh"
+#include "pism/util/VariableMetadata.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/IS.hh"
+
+namespace pism {
+
+Decimation::Method string_to_decimation_method(const std::string &method) {
+  if (method == "average") {
+    return Decimation::AVERAGE;
+  } else if (method == "subsample") {
+    return Decimation::SUBSAMPLE;
+  } else {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid decimation method: %s", method.c_str());
+  }
+}
+
+//! Number of degrees of freedom (per map-plane grid point) of `vec`.
+static unsigned int ndof(const IceModelVec &vec) {
+  return std::max((size_t)vec.ndof(), vec.levels().size());
+}
+
+/*!
+ * Create a grid covering points of `grid` with coordinates in [x_min, x_max] and [y_min,
+ * y_max], coarsened by `factor` in both directions. Partial blocks at the right and top
+ * edges of the region are dropped.
+ */
+Decimation::Decimation(IceGrid::ConstPtr grid, unsigned int factor, Method method,
+                       double x_min, double x_max, double y_min, double y_max)
+  : m_source(grid), m_factor(factor), m_method(method), m_i0(0), m_j0(0) {
+
+  if (factor < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid coarsening factor: %d", (int)factor);
+  }
+
+  const std::vector<double> &x = grid->x(), &y = grid->y();
+
+  int
+    i0 = std::lower_bound(x.begin(), x.end(), x_min) - x.begin(),
+    i1 = std::upper_bound(x.begin(), x.end(), x_max) - x.begin(),
+    j0 = std::lower_bound(y.begin(), y.end(), y_min) - y.begin(),
+    j1 = std::upper_bound(y.begin(), y.end(), y_max) - y.begin();
+
+  int
+    Mx = std::max(i1 - i0, 0) / (int)factor,
+    My = std::max(j1 - j0, 0) / (int)factor;
+
+  if (Mx < 3 or My < 3) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "the coarse grid (%d x %d points) is too small:"
+                                  " a region of at least %d x %d points is required",
+                                  Mx, My, 3 * factor, 3 * factor);
+  }
+
+  m_i0 = i0;
+  m_j0 = j0;
+
+  // coordinates of a coarse grid point are the coordinates of the center of a block
+  // (AVERAGE) or of the point used to represent it (SUBSAMPLE)
+  const double
+    dx     = grid->dx(),
+    dy     = grid->dy(),
+    offset = method == AVERAGE ? 0.5 * (factor - 1) : (double)(factor / 2);
+
+  Context::ConstPtr ctx = grid->ctx();
+
+  GridParameters params(ctx->config());
+  params.Lx           = 0.5 * (Mx - 1) * factor * dx;
+  params.Ly           = 0.5 * (My - 1) * factor * dy;
+  params.x0           = x[i0] + offset * dx + params.Lx;
+  params.y0           = y[j0] + offset * dy + params.Ly;
+  params.Mx           = Mx;
+  params.My           = My;
+  params.registration = CELL_CORNER;
+  params.periodicity  = NOT_PERIODIC;
+  params.z            = grid->z();
+  params.ownership_ranges_from_options(ctx->size());
+
+  m_grid = IceGrid::Ptr(new IceGrid(ctx, params));
+  m_grid->set_mapping_info(grid->get_mapping_info());
+}
+
+IceGrid::ConstPtr Decimation::grid() const {
+  return m_grid;
+}
+
+void Decimation::define(const SpatialVariableMetadata &variable, const File &file,
+                        IO_Type default_type) const {
+  io::define_spatial_variable(variable, *m_grid, file, default_type);
+}
+
+/*!
+ * Create a scatter moving values needed to compute coarse grid values owned by this rank
+ * from the natural ordering of the source grid to a "block" vector.
+ *
+ * The block vector contains `S * dof` values per (owned) point of the coarse grid, where
+ * `S` is `factor * factor` (AVERAGE) or 1 (SUBSAMPLE).
+ */
+const petsc::VecScatter& Decimation::scatter(unsigned int dof) const {
+  if (m_scatters.find(dof) != m_scatters.end()) {
+    return m_scatters[dof];
+  }
+
+  PetscErrorCode ierr = 0;
+
+  const int
+    f       = m_factor,
+    F       = m_method == AVERAGE ? f : 1,
+    offset  = m_method == AVERAGE ? 0 : f / 2,
+    Mx      = m_source->Mx(),
+    n       = m_grid->xm() * m_grid->ym() * F * F * dof;
+
+  petsc::Vec natural, blocks;
+
+  ierr = DMDACreateNaturalVector(*m_source->get_dm(dof, 0), natural.rawptr());
+  PISM_CHK(ierr, "DMDACreateNaturalVector");
+
+  ierr = VecCreateMPI(m_grid->com, n, PETSC_DETERMINE, blocks.rawptr());
+  PISM_CHK(ierr, "VecCreateMPI");
+
+  PetscInt lo = 0, hi = 0;
+  ierr = VecGetOwnershipRange(blocks, &lo, &hi);
+  PISM_CHK(ierr, "VecGetOwnershipRange");
+
+  std::vector<PetscInt> from;
+  from.reserve(n);
+  for (int J = m_grid->ys(); J < m_grid->ys() + m_grid->ym(); ++J) {
+    for (int I = m_grid->xs(); I < m_grid->xs() + m_grid->xm(); ++I) {
+      for (int b = 0; b < F; ++b) {
+        for (int a = 0; a < F; ++a) {
+          const int
+            i = m_i0 + I * f + offset + a,
+            j = m_j0 + J * f + offset + b;
+
+          for (unsigned int l = 0; l < dof; ++l) {
+            from.push_back(((PetscInt)j * Mx + i) * dof + l);
+          }
+        }
+      }
+    }
+  }
+
+  petsc::IS is_from, is_to;
+  ierr = ISCreateGeneral(m_grid->com, n, from.data(), PETSC_COPY_VALUES, is_from.rawptr());
+  PISM_CHK(ierr, "ISCreateGeneral");
+
+  ierr = ISCreateStride(m_grid->com, hi - lo, lo, 1, is_to.rawptr());
+  PISM_CHK(ierr, "ISCreateStride");
+
+  petsc::VecScatter &result = m_scatters[dof];
+  ierr = VecScatterCreate(natural, is_from, blocks, is_to, result.rawptr());
+  PISM_CHK(ierr, "VecScatterCreate");
+
+  return result;
+}
+
+/*!
+ * Average over a block of `N` values `block[s * dof]` (`s = 0, ..., N - 1`), skipping
+ * `fill_value` if `use_fill_value` is set. Returns `fill_value` if all values are missing.
+ */
+static double block_average(const double *block, int N, unsigned int dof,
+                            bool use_fill_value, double fill_value) {
+  double sum = 0.0;
+  int count = 0;
+  for (int s = 0; s < N; ++s) {
+    double v = block[s * dof];
+    if (use_fill_value and v == fill_value) {
+      continue;
+    }
+    sum += v;
+    count += 1;
+  }
+
+  return count > 0 ? sum / count : fill_value;
+}
+
+//! Coarsen `input` and write it to `file`, which has to contain definitions of its variables.
+void Decimation::write(const IceModelVec &input, const File &file) const {
+  PetscErrorCode ierr = 0;
+
+  const unsigned int dof = ndof(input);
+
+  petsc::DM::Ptr da = m_source->get_dm(dof, 0);
+
+  petsc::TemporaryGlobalVec global(da);
+  input.copy_to_vec(da, global);
+
+  petsc::Vec natural, blocks;
+
+  ierr = DMDACreateNaturalVector(*da, natural.rawptr());
+  PISM_CHK(ierr, "DMDACreateNaturalVector");
+
+  ierr = DMDAGlobalToNaturalBegin(*da, global, INSERT_VALUES, natural);
+  PISM_CHK(ierr, "DMDAGlobalToNaturalBegin");
+
+  ierr = DMDAGlobalToNaturalEnd(*da, global, INSERT_VALUES, natural);
+  PISM_CHK(ierr, "DMDAGlobalToNaturalEnd");
+
+  const int
+    f        = m_factor,
+    S        = m_method == AVERAGE ? f * f : 1,
+    n_points = m_grid->xm() * m_grid->ym();
+
+  ierr = VecCreateMPI(m_grid->com, n_points * S * dof, PETSC_DETERMINE, blocks.rawptr());
+  PISM_CHK(ierr, "VecCreateMPI");
+
+  const petsc::VecScatter &s = scatter(dof);
+
+  ierr = VecScatterBegin(s, natural, blocks, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(s, natural, blocks, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterEnd");
+
+  petsc::VecArray blocks_array(blocks);
+  const double *block_data = blocks_array.get();
+
+  // Vector fields have one level and ndof() components. Scalar (2D and 3D) fields have one
+  // component and levels().size() levels.
+  const unsigned int
+    n_components = input.ndof(),
+    n_levels     = n_components > 1 ? 1 : dof;
+
+  std::vector<double> result(n_points * n_levels);
+
+  for (unsigned int c = 0; c < n_components; ++c) {
+    const SpatialVariableMetadata &variable = input.metadata(c);
+
+    IO_Type type = variable.get_output_type();
+    bool integer = (type == PISM_BYTE or type == PISM_SHORT or type == PISM_INT);
+
+    // the point nearest to the center of a block
+    const int center = m_method == AVERAGE ? (f / 2) * f + f / 2 : 0;
+
+    // fill values are stored in glaciological units
+    bool use_fill_value = variable.has_attribute("_FillValue");
+    double fill_value = 0.0;
+    if (use_fill_value) {
+      std::string
+        units               = variable.get_string("units"),
+        glaciological_units = variable.get_string("glaciological_units");
+
+      fill_value = variable.get_number("_FillValue");
+      if (not glaciological_units.empty() and units != glaciological_units) {
+        fill_value = units::convert(variable.unit_system(), fill_value,
+                                    glaciological_units, units);
+      }
+    }
+
+    for (int p = 0; p < n_points; ++p) {
+      for (unsigned int l = 0; l < n_levels; ++l) {
+        const double *block = block_data + p * S * dof + (n_components > 1 ? c : l);
+
+        if (m_method == SUBSAMPLE or integer) {
+          result[p * n_levels + l] = block[center * dof];
+        } else {
+          result[p * n_levels + l] = block_average(block, S, dof,
+                                                   use_fill_value, fill_value);
+        }
+      }
+    }
+
+    io::write_spatial_variable(variable, *m_grid, file, result.data());
+  }
+}
+
+} // end of namespace pism
@@ -0,0 +1,80 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_DECIMATION_H
+#define PISM_DECIMATION_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/io/IO_Flags.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
+
+namespace pism {
+
+class File;
+class IceModelVec;
+class SpatialVariableMetadata;
+
+//! Writes fields defined on a grid to a file using a coarser and (possibly) cropped grid.
+/*!
+ * The coarse grid consists of `factor` by `factor` blocks of points of the original grid
+ * covering a rectangular region. Each value written to a file is either the average over
+ * a block (skipping fill values) or the value at the point nearest to the center of a
+ * block. Integer-valued fields (masks) are always subsampled.
+ *
+ * Values are moved between ranks using a VecScatter, so nothing is gathered on one rank.
+ */
+class Decimation {
+public:
+  enum Method {AVERAGE, SUBSAMPLE};
+
+  Decimation(IceGrid::ConstPtr grid, unsigned int factor, Method method,
+             double x_min, double x_max, double y_min, double y_max);
+
+  //! The grid used to write fields.
+  IceGrid::ConstPtr grid() const;
+
+  void define(const SpatialVariableMetadata &variable, const File &file,
+              IO_Type default_type) const;
+
+  void write(const IceModelVec &input, const File &file) const;
+private:
+  const petsc::VecScatter& scatter(unsigned int dof) const;
+
+  IceGrid::ConstPtr m_source;
+  IceGrid::Ptr m_grid;
+
+  unsigned int m_factor;
+  Method m_method;
+
+  //! indexes (in the source grid) of the lower left corner of the cropped region
+  int m_i0, m_j0;
+
+  //! scatters for each number of degrees of freedom per grid point
+  mutable std::map<unsigned int, petsc::VecScatter> m_scatters;
+};
+
+Decimation::Method string_to_decimation_method(const std::string &method);
+
+} // end of namespace pism
+
+#endif /* PISM_DECIMATION_H */
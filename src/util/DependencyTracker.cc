@@ -0,0 +1,59 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "DependencyTracker.hh"
+#include "iceModelVec.hh"
+
+namespace pism {
+
+DependencyTracker::DependencyTracker() {
+  // empty
+}
+
+//! Returns `true` if `inputs` differ from the ones recorded by record() or if one of
+//! them was modified since then.
+bool DependencyTracker::changed(const Inputs &inputs) const {
+  if (inputs.size() != m_inputs.size()) {
+    return true;
+  }
+
+  for (unsigned int k = 0; k < inputs.size(); ++k) {
+    if (inputs[k] != m_inputs[k].first or
+        inputs[k]->state_counter() != m_inputs[k].second) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//! Record current state counters of `inputs`.
+void DependencyTracker::record(const Inputs &inputs) {
+  m_inputs.clear();
+  for (const auto *input : inputs) {
+    m_inputs.push_back({input, input->state_counter()});
+  }
+}
+
+//! Forget recorded inputs, so that the next call to changed() returns `true`.
+void DependencyTracker::reset() {
+  m_inputs.clear();
+}
+
+} // end of namespace pism
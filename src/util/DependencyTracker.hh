@@ -0,0 +1,61 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_DEPENDENCYTRACKER_H
+#define PISM_DEPENDENCYTRACKER_H
+
+#include <vector>
+#include <utility>              // std::pair
+
+namespace pism {
+
+class IceModelVec;
+
+//! Tracks inputs of a derived field to avoid re-computing it if inputs did not change.
+/*!
+ * Records state counters (see IceModelVec::state_counter()) of the inputs used to compute
+ * a derived field:
+ *
+ * \code
+ * if (m_inputs.changed({&velocity, &cell_type})) {
+ *   compute_strain_rates(velocity, cell_type, m_strain_rates);
+ *   m_inputs.record({&velocity, &cell_type});
+ * }
+ * \endcode
+ *
+ * This relies on state counters of all inputs: code modifying an input using
+ * `operator()` has to call IceModelVec::inc_state_counter() when done.
+ */
+class DependencyTracker {
+public:
+  typedef std::vector<const IceModelVec*> Inputs;
+
+  DependencyTracker();
+
+  bool changed(const Inputs &inputs) const;
+  void record(const Inputs &inputs);
+  void reset();
+private:
+  // pairs (input, its state counter)
+  std::vector<std::pair<const IceModelVec*, int> > m_inputs;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_DEPENDENCYTRACKER_H */
@@ -17,6 +17,9 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <set>
+#include <algorithm>            // std::max
+
 #include "Diagnostic.hh"
 #include "pism/util/Time.hh"
 #include "error_handling.hh"
@@ -34,11 +37,69 @@ Diagnostic::Ptr Diagnostic::wrap(const IceModelVec2V &input) {
   return Ptr(new DiagWithDedicatedStorage<IceModelVec2V>(input));
 }
 
+struct Diagnostic::SharedResults {
+  SharedResults()
+    : n_events(0), depth(0) {
+    // empty
+  }
+
+  //! Get results shared by all diagnostics on `grid`.
+  static std::shared_ptr<SharedResults> get(IceGrid::ConstPtr grid) {
+    static std::map<const IceGrid*, std::weak_ptr<SharedResults> > all;
+
+    auto result = all[grid.get()].lock();
+    if (not result) {
+      result = std::make_shared<SharedResults>();
+      all[grid.get()] = result;
+    }
+    return result;
+  }
+
+  IceModelVec::Ptr find(const std::string &name) const {
+    auto i = intermediate.find(name);
+    if (i != intermediate.end()) {
+      return i->second;
+    }
+
+    auto t = top_level.find(name);
+    if (t != top_level.end()) {
+      return t->second.lock();
+    }
+
+    return nullptr;
+  }
+
+  //! number of active output events
+  int n_events;
+  //! depth of nested Diagnostic::compute() calls
+  int depth;
+  //! results computed for other diagnostics
+  std::map<std::string, IceModelVec::Ptr> intermediate;
+  //! results of top-level compute() calls (re-used while they exist)
+  std::map<std::string, std::weak_ptr<IceModelVec> > top_level;
+};
+
+Diagnostic::OutputEvent::OutputEvent(IceGrid::ConstPtr grid)
+  : m_results(SharedResults::get(grid)) {
+  m_results->n_events += 1;
+}
+
+Diagnostic::OutputEvent::~OutputEvent() {
+  m_results->n_events -= 1;
+
+  if (m_results->n_events == 0) {
+    m_results->intermediate.clear();
+    m_results->top_level.clear();
+  }
+}
+
 Diagnostic::Diagnostic(IceGrid::ConstPtr g)
   : m_grid(g),
     m_sys(g->ctx()->unit_system()),
     m_config(g->ctx()->config()),
-    m_fill_value(m_config->get_number("output.fill_value")) {
+    m_fill_value(m_config->get_number("output.fill_value")),
+    m_pool(IceModelVecPool::shared(g)),
+    m_shared_results(SharedResults::get(g)) {
   // empty
 }
 
@@ -55,6 +116,79 @@ void Diagnostic::update_impl(double dt) {
   // empty
 }
 
+/*!
+ * If this diagnostic accumulates a 2D field at every time step, put the accumulator, the
+ * field to add and the scaling factor in `result` and return `true`. The caller is then
+ * responsible for updating the accumulator (see update_diagnostics()).
+ *
+ * Returns `false` (and does nothing) otherwise: such diagnostics are updated using
+ * update().
+ */
+bool Diagnostic::prepare_update(double dt, AccumulatorUpdate &result) {
+  return this->prepare_update_impl(dt, result);
+}
+
+bool Diagnostic::prepare_update_impl(double dt, AccumulatorUpdate &result) {
+  (void) dt;
+  (void) result;
+  return false;
+}
+
+//! Update diagnostics for a time step of length `dt`.
+/*!
+ * Accumulators of time-averaged diagnostics (see DiagAverageRate) are updated in one
+ * loop over the grid instead of one loop per diagnostic. The rest are updated one at a
+ * time.
+ *
+ * Each diagnostic is updated once even if it appears in `diagnostics` under several
+ * names.
+ */
+void update_diagnostics(const DiagnosticList &diagnostics, double dt) {
+  std::set<Diagnostic*> seen;
+
+  std::vector<Diagnostic::AccumulatorUpdate> updates;
+
+  for (const auto &d : diagnostics) {
+    Diagnostic *diagnostic = d.second.get();
+
+    if (seen.find(diagnostic) != seen.end()) {
+      continue;
+    }
+    seen.insert(diagnostic);
+
+    Diagnostic::AccumulatorUpdate update;
+    if (diagnostic->prepare_update(dt, update)) {
+      updates.push_back(update);
+    } else {
+      diagnostic->update(dt);
+    }
+  }
+
+  if (updates.empty()) {
+    return;
+  }
+
+  IceModelVec::AccessList list;
+  for (const auto &u : updates) {
+    list.add(*u.accumulator);
+    list.add(*u.input);
+  }
+
+  const size_t N = updates.size();
+  for (Points p(*updates[0].accumulator->grid()); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (size_t k = 0; k < N; ++k) {
+      const auto &u = updates[k];
+      (*u.accumulator)(i, j) += u.factor * (*u.input)(i, j);
+    }
+  }
+
+  for (const auto &u : updates) {
+    u.accumulator->inc_state_counter();
+  }
+}
+
 void Diagnostic::reset() {
   this->reset_impl();
 }
@@ -170,10 +304,40 @@ IceModelVec::Ptr Diagnostic::compute() const {
   }
   std::string all_names = join(names, ",");
 
+  SharedResults &shared = *m_shared_results;
+  const bool share = shared.n_events > 0;
+
+  if (share) {
+    auto result = shared.find(all_names);
+    if (result) {
+      m_grid->ctx()->log()->message(3, "-  Re-using %s.\n", all_names.c_str());
+      return result;
+    }
+  }
+
   m_grid->ctx()->log()->message(3, "-  Computing %s...\n", all_names.c_str());
-  IceModelVec::Ptr result = this->compute_impl();
+  IceModelVec::Ptr result;
+  {
+    shared.depth += 1;
+    try {
+      result = this->compute_impl();
+    } catch (...) {
+      shared.depth -= 1;
+      throw;
+    }
+    shared.depth -= 1;
+  }
   m_grid->ctx()->log()->message(3, "-  Done computing %s.\n", all_names.c_str());
 
+  if (share) {
+    if (shared.depth > 0) {
+      // computed for another diagnostic: keep until the end of the output event
+      shared.intermediate[all_names] = result;
+    } else {
+      shared.top_level[all_names] = result;
+    }
+  }
+
   return result;
 }
 
@@ -311,35 +475,110 @@ void TSRateDiagnostic::evaluate(double t0, double t1, double change) {
 }
 
 void TSDiagnostic::update(double t0, double t1) {
-  this->update_impl(t0, t1);
+  this->update_impl(t0, t1, this->compute());
+}
+
+/*!
+ * Update using `value` computed by the caller (see update_ts_diagnostics()).
+ */
+void TSDiagnostic::update(double t0, double t1, double value) {
+  this->update_impl(t0, t1, value);
+}
+
+/*!
+ * Compute the contribution of this rank if this diagnostic is a sum over grid points.
+ *
+ * Returns `false` if it is not.
+ */
+bool TSDiagnostic::local_sum(double &result) {
+  return this->compute_local_sum(result);
 }
 
-void TSSnapshotDiagnostic::update_impl(double t0, double t1) {
+double TSDiagnostic::compute() {
+  double result = 0.0;
+  if (not this->compute_local_sum(result)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "time-series diagnostic %s does not implement compute()",
+                                  m_ts.variable().get_name().c_str());
+  }
+  return GlobalSum(m_grid->com, result);
+}
+
+bool TSDiagnostic::compute_local_sum(double &result) {
+  (void) result;
+  return false;
+}
+
+void TSSnapshotDiagnostic::update_impl(double t0, double t1, double value) {
   if (fabs(t1 - t0) < 1e-2) {
     return;
   }
   assert(t1 > t0);
-  evaluate(t0, t1, this->compute());
+  evaluate(t0, t1, value);
 }
 
-void TSRateDiagnostic::update_impl(double t0, double t1) {
-  const double v = this->compute();
-
+void TSRateDiagnostic::update_impl(double t0, double t1, double value) {
   if (m_v_previous_set) {
     assert(t1 > t0);
-    evaluate(t0, t1, v - m_v_previous);
+    evaluate(t0, t1, value - m_v_previous);
   }
 
-  m_v_previous = v;
+  m_v_previous = value;
   m_v_previous_set = true;
 }
 
-void TSFluxDiagnostic::update_impl(double t0, double t1) {
+void TSFluxDiagnostic::update_impl(double t0, double t1, double value) {
   if (fabs(t1 - t0) < 1e-2) {
     return;
   }
   assert(t1 > t0);
-  evaluate(t0, t1, this->compute());
+  evaluate(t0, t1, value);
+}
+
+//! Update time-series diagnostics for the time step from `t0` to `t1`.
+/*!
+ * Diagnostics that are sums over grid points (see TSDiagnostic::compute_local_sum())
+ * contribute their local sums to one buffer reduced using a single `MPI_Allreduce`, so
+ * the cost of communication does not grow with the number of diagnostics. The rest are
+ * updated one at a time.
+ *
+ * Each diagnostic is updated once even if it appears in `diagnostics` under several
+ * names.
+ */
+void update_ts_diagnostics(MPI_Comm com, const TSDiagnosticList &diagnostics,
+                           double t0, double t1) {
+  std::set<TSDiagnostic*> seen;
+
+  std::vector<TSDiagnostic*> sums;
+  std::vector<double> local;
+
+  for (const auto &d : diagnostics) {
+    TSDiagnostic *diagnostic = d.second.get();
+
+    if (seen.find(diagnostic) != seen.end()) {
+      continue;
+    }
+    seen.insert(diagnostic);
+
+    double value = 0.0;
+    if (diagnostic->local_sum(value)) {
+      sums.push_back(diagnostic);
+      local.push_back(value);
+    } else {
+      diagnostic->update(t0, t1);
+    }
+  }
+
+  if (sums.empty()) {
+    return;
+  }
+
+  std::vector<double> global(local.size());
+  GlobalSum(com, local.data(), global.data(), local.size());
+
+  for (unsigned int k = 0; k < sums.size(); ++k) {
+    sums[k]->update(t0, t1, global[k]);
+  }
 }
 
 void TSDiagnostic::define(const File &file) const {
@@ -353,10 +592,42 @@ void TSDiagnostic::flush() {
     return;
   }
 
-  std::string dimension_name = m_ts.dimension().get_name();
-
   File file(m_grid->com, m_output_filename, PISM_NETCDF3, PISM_READWRITE); // OK to use netcdf3
 
+  flush(file);
+}
+
+//! Write buffered records to `file` (open for writing) and empty the buffer.
+void TSDiagnostic::flush(const File &file) {
+
+  if (m_ts.times().empty()) {
+    return;
+  }
+
+  std::string
+    dimension_name = m_ts.dimension().get_name(),
+    variable_name  = m_ts.variable().get_name(),
+    bounds_name    = m_ts.bounds().get_name();
+
+  if (not file.find_variable(variable_name)) {
+    const bool
+      new_time   = not file.find_variable(dimension_name),
+      new_bounds = not file.find_variable(bounds_name);
+
+    define(file);
+
+    // Use chunks of buffer_size records so that each flush appends about one chunk. (This
+    // has no effect on NetCDF-3 files.)
+    const size_t chunk = std::max(m_buffer_size, (size_t)1);
+    if (new_time) {
+      file.define_chunking(dimension_name, {chunk});
+    }
+    if (new_bounds) {
+      file.define_chunking(bounds_name, {chunk, 2});
+    }
+    file.define_chunking(variable_name, {chunk});
+  }
+
   unsigned int len = file.dimension_length(dimension_name);
 
   if (len > 0) {
@@ -388,6 +659,10 @@ void TSDiagnostic::init(const File &output_file,
   m_start = output_file.dimension_length(m_ts.dimension().get_name());
 }
 
+size_t TSDiagnostic::buffer_length() const {
+  return m_ts.times().size();
+}
+
 const VariableMetadata &TSDiagnostic::metadata() const {
   return m_ts.variable();
 }
@@ -28,6 +28,7 @@
 #include "IceGrid.hh"
 #include "ConfigInterface.hh"
 #include "iceModelVec.hh"
+#include "pism/util/IceModelVecPool.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/io/File.hh"
 #include "pism/util/io/io_helpers.hh"
@@ -81,6 +82,38 @@ public:
   void init(const File &input, unsigned int time);
   void define_state(const File &output) const;
   void write_state(const File &output) const;
+
+  struct SharedResults;
+
+  //! Share results of diagnostic computations while an instance of this class is in scope.
+  /*!
+   * Some diagnostics are computed using others (`velbar_mag` uses `velbar`, which uses
+   * `flux`, etc). Within an output event the result of a diagnostic computed *for
+   * another diagnostic* is kept and re-used by all diagnostics on the same grid, so each
+   * of these intermediate results is computed once. Results of top-level compute() calls
+   * are re-used only while the caller holds on to them, so that writing many diagnostics
+   * does not keep all of them in memory.
+   *
+   * Results returned by compute() during an output event may be shared and must not be
+   * modified.
+   */
+  class OutputEvent {
+  public:
+    OutputEvent(IceGrid::ConstPtr grid);
+    ~OutputEvent();
+  private:
+    std::shared_ptr<SharedResults> m_results;
+  };
+
+  //! Contribution of a time step to the accumulator of a time-averaged diagnostic:
+  //! `accumulator += factor * input`.
+  struct AccumulatorUpdate {
+    IceModelVec2S *accumulator;
+    const IceModelVec2S *input;
+    double factor;
+  };
+
+  bool prepare_update(double dt, AccumulatorUpdate &result);
 protected:
   virtual void define_impl(const File &file, IO_Type default_type) const;
   virtual void init_impl(const File &input, unsigned int time);
@@ -94,6 +127,7 @@ protected:
                  unsigned int N = 0);
 
   virtual void update_impl(double dt);
+  virtual bool prepare_update_impl(double dt, AccumulatorUpdate &result);
   virtual void reset_impl();
 
   virtual IceModelVec::Ptr compute_impl() const = 0;
@@ -111,10 +145,16 @@ protected:
   std::vector<SpatialVariableMetadata> m_vars;
   //! fill value (used often enough to justify storing it)
   double m_fill_value;
+  //! re-usable fields for results of compute_impl() (shared by all diagnostics on this grid)
+  IceModelVecPool::Ptr m_pool;
+  //! results shared by diagnostics on this grid during an output event
+  std::shared_ptr<SharedResults> m_shared_results;
 };
 
 typedef std::map<std::string, Diagnostic::Ptr> DiagnosticList;
 
+void update_diagnostics(const DiagnosticList &diagnostics, double dt);
+
 /*!
  * Helper template wrapping quantities with dedicated storage in diagnostic classes.
  *
@@ -219,15 +259,24 @@ protected:
     io::write_timeseries(output, m_time_since_reset, t_start, m_interval_length, PISM_DOUBLE);
   }
 
-  virtual void update_impl(double dt) {
+  virtual bool prepare_update_impl(double dt, Diagnostic::AccumulatorUpdate &result) {
     // Here the "factor" is used to convert units (from m to kg m-2, for example) and (possibly)
     // integrate over the time integral using the rectangle method.
 
-    double factor = m_factor * (m_input_kind == TOTAL_CHANGE ? 1.0 : dt);
-
-    m_accumulator.add(factor, this->model_input());
+    result.accumulator = &m_accumulator;
+    result.input       = &this->model_input();
+    result.factor      = m_factor * (m_input_kind == TOTAL_CHANGE ? 1.0 : dt);
 
     m_interval_length += dt;
+
+    return true;
+  }
+
+  virtual void update_impl(double dt) {
+    Diagnostic::AccumulatorUpdate update;
+    if (this->prepare_update_impl(dt, update)) {
+      update.accumulator->add(update.factor, *update.input);
+    }
   }
 
   virtual void reset_impl() {
@@ -236,8 +285,7 @@ protected:
   }
 
   virtual IceModelVec::Ptr compute_impl() const {
-    IceModelVec2S::Ptr result(new IceModelVec2S(Diagnostic::m_grid,
-                                                "diagnostic", WITHOUT_GHOSTS));
+    IceModelVec2S::Ptr result = Diagnostic::m_pool->scalar("diagnostic");
     result->metadata(0) = Diagnostic::m_vars.at(0);
 
     if (m_interval_length > 0.0) {
@@ -274,8 +322,15 @@ public:
   virtual ~TSDiagnostic();
 
   void update(double t0, double t1);
+  void update(double t0, double t1, double value);
+
+  bool local_sum(double &result);
 
   void flush();
+  void flush(const File &file);
+
+  //! Number of records waiting to be written.
+  size_t buffer_length() const;
 
   void init(const File &output_file,
             std::shared_ptr<std::vector<double>> requested_times);
@@ -285,14 +340,27 @@ public:
   void define(const File &file) const;
 
 protected:
-  virtual void update_impl(double t0, double t1) = 0;
+  virtual void update_impl(double t0, double t1, double value) = 0;
 
   /*!
    * Compute the diagnostic. Regular (snapshot) quantity should be computed here; for rates of
    * change, compute() should return the total change during the time step from t0 to t1. The rate
    * itself is computed in evaluate_rate().
+   *
+   * The default implementation sums values computed by compute_local_sum().
    */
-  virtual double compute() = 0;
+  virtual double compute();
+
+  /*!
+   * Diagnostics that are sums over grid points should override this method (instead of
+   * compute()): compute the contribution of the sub-domain owned by this rank, store it
+   * in `result`, and return `true`.
+   *
+   * This allows update_ts_diagnostics() to combine all these sums into one reduction.
+   * Diagnostics that cannot be computed this way (maxima, values that are not sums)
+   * return `false` (the default) and implement compute() instead.
+   */
+  virtual bool compute_local_sum(double &result);
 
   /*!
    * Set internal (MKS) and "glaciological" units.
@@ -327,6 +395,9 @@ protected:
 
 typedef std::map<std::string, TSDiagnostic::Ptr> TSDiagnosticList;
 
+void update_ts_diagnostics(MPI_Comm com, const TSDiagnosticList &diagnostics,
+                           double t0, double t1);
+
 //! Scalar diagnostic reporting a snapshot of a quantity modeled by PISM.
 /*!
  * The method compute() should return the instantaneous "snapshot" value.
@@ -335,7 +406,7 @@ class TSSnapshotDiagnostic : public TSDiagnostic {
 public:
   TSSnapshotDiagnostic(IceGrid::ConstPtr g, const std::string &name);
 private:
-  void update_impl(double t0, double t1);
+  void update_impl(double t0, double t1, double value);
   void evaluate(double t0, double t1, double v);
 };
 
@@ -353,7 +424,7 @@ protected:
   double m_accumulator;
   void evaluate(double t0, double t1, double change);
 private:
-  void update_impl(double t0, double t1);
+  void update_impl(double t0, double t1, double value);
 
   //! last two values, used to compute the change during a time step
   double m_v_previous;
@@ -378,7 +449,7 @@ class TSFluxDiagnostic : public TSRateDiagnostic {
 public:
   TSFluxDiagnostic(IceGrid::ConstPtr g, const std::string &name);
 private:
-  void update_impl(double t0, double t1);
+  void update_impl(double t0, double t1, double value);
 };
 
 template <class D, class M>
@@ -352,7 +352,7 @@ static Germ apply_jacobian_inverse(const double J_inv[2][2], const Germ &f) {
 
 //! Two-by-two Gaussian quadrature on a rectangle.
 Q1Quadrature4::Q1Quadrature4(double dx, double dy, double L)
-  : UniformQxQuadrature(m_size, dx, dy, L) {
+  : UniformQxQuadrature(size, dx, dy, L) {
 
   // coordinates and weights of the 2-point 1D Gaussian quadrature
   const double
@@ -360,8 +360,8 @@ Q1Quadrature4::Q1Quadrature4(double dx, double dy, double L)
     points2[2]  = {-A, A},
     weights2[2] = {1.0, 1.0};
 
-  QuadPoint points[m_size];
-  double W[m_size];
+  QuadPoint points[size];
+  double W[size];
 
   tensor_product_quadrature(2, points2, weights2, points, W);
 
@@ -515,8 +515,8 @@ protected:
 class Q1Quadrature4 : public UniformQxQuadrature {
 public:
   Q1Quadrature4(double dx, double dy, double L=1.0);
-private:
-  static const unsigned int m_size = 4;
+  //! Number of quadrature points.
+  static const unsigned int size = 4;
 };
 
 //! The 9-point 2D Gaussian quadrature on the square [-1,1]*[-1,1].
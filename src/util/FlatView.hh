@@ -0,0 +1,100 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_FLATVIEW_H
+#define PISM_FLATVIEW_H
+
+#include <cstddef>              // ptrdiff_t
+
+namespace pism {
+
+//! A view of the local (ghosted) array of a 2D field as one flat array.
+/*!
+ * IceModelVec2S::operator()(i, j) loads a row pointer before loading a value, which
+ * prevents compilers from vectorizing loops over `i` and from recognizing that
+ * neighboring values are stored next to each other. This class stores the address of the
+ * lower left corner of the local patch (including ghosts) and its size, so that
+ *
+ *     view(i, j, k) == field(i, j, k)
+ *
+ * and, with `const double *p = view.pointer(i, j)`,
+ *
+ * - `p[k]` is the `k`-th component at `(i, j)`,
+ * - `p[k - view.dof()]` and `p[k + view.dof()]` are components at `(i - 1, j)` and `(i + 1, j)`,
+ * - `p[k - view.stride()]` and `p[k + view.stride()]` are components at `(i, j - 1)` and `(i, j + 1)`.
+ *
+ * Views are obtained using IceModelVec2::flat_view() and are valid while the field is
+ * accessed (see IceModelVec::AccessList).
+ *
+ * Use PointsWithGhosts::next_row() to traverse the grid one row at a time:
+ *
+ *     for (Points p(grid); p; p.next_row()) {
+ *       const int j = p.j(), n = p.i_last() - p.i_first() + 1;
+ *       const double *x = X.pointer(p.i_first(), j);
+ *       double *y = Y.pointer(p.i_first(), j);
+ *       for (int m = 0; m < n; ++m) { y[m] = x[m - 1] + x[m + 1]; }
+ *     }
+ */
+template<typename T>
+class FlatView {
+public:
+  FlatView(T *data, int x0, int y0, int nx, int dof)
+    : m_data(data), m_x0(x0), m_y0(y0), m_nx(nx), m_dof(dof) {
+    // empty
+  }
+
+  //! Conversion from a view of non-const values to a read-only view.
+  template<typename U>
+  FlatView(const FlatView<U> &other)
+    : m_data(other.m_data), m_x0(other.m_x0), m_y0(other.m_y0), m_nx(other.m_nx),
+      m_dof(other.m_dof) {
+    // empty
+  }
+
+  //! Number of values stored at each grid point.
+  int dof() const {
+    return m_dof;
+  }
+
+  //! Distance between values at `(i, j)` and `(i, j + 1)`.
+  int stride() const {
+    return m_nx * m_dof;
+  }
+
+  //! Address of the first component at `(i, j)`.
+  T* pointer(int i, int j) const {
+    return m_data + ((ptrdiff_t)(j - m_y0) * m_nx + (i - m_x0)) * m_dof;
+  }
+
+  T& operator()(int i, int j, int k = 0) const {
+    return pointer(i, j)[k];
+  }
+private:
+  template<typename U>
+  friend class FlatView;
+
+  T *m_data;
+  //! the lower left corner and the width of the local patch (including ghosts)
+  int m_x0, m_y0, m_nx;
+  int m_dof;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_FLATVIEW_H */
@@ -0,0 +1,172 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::copy
+
+#include "GhostExchange.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+//! Number of degrees of freedom per grid point of the DM used by `field`.
+static int dm_dof(const IceModelVec &field) {
+  PetscInt dof = 0;
+  PetscErrorCode ierr = DMDAGetInfo(*field.dm(),
+                                    NULL,       // dimensions
+                                    NULL, NULL, NULL, // global sizes
+                                    NULL, NULL, NULL, // numbers of processes
+                                    &dof,
+                                    NULL,       // stencil width
+                                    NULL, NULL, NULL, // boundary types
+                                    NULL);      // stencil type
+  PISM_CHK(ierr, "DMDAGetInfo");
+
+  return dof;
+}
+
+GhostExchange::GhostExchange(const std::vector<IceModelVec*> &fields)
+  : m_fields(fields), m_dof(0), m_packed(NULL) {
+
+  if (m_fields.empty()) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "GhostExchange: the list of fields is empty");
+  }
+
+  const IceModelVec &first = *m_fields[0];
+  const unsigned int stencil_width = first.stencil_width();
+
+  for (const auto *f : m_fields) {
+    if (f->stencil_width() == 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "GhostExchange: field '%s' does not have ghosts",
+                                    f->get_name().c_str());
+    }
+
+    if (f->stencil_width() != stencil_width or f->grid() != first.grid()) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "GhostExchange: fields '%s' and '%s' use different"
+                                    " grids or stencil widths",
+                                    first.get_name().c_str(), f->get_name().c_str());
+    }
+
+    m_dofs.push_back(dm_dof(*f));
+    m_dof += m_dofs.back();
+  }
+
+  m_da = first.grid()->get_dm(m_dof, stencil_width);
+}
+
+GhostExchange::~GhostExchange() {
+  if (m_packed != NULL) {
+    // end() was not called (e.g. because of an exception): return the vector to the DM
+    // ignoring errors
+    DMRestoreLocalVector(*m_da, &m_packed);
+  }
+}
+
+//! Update ghosts of all fields.
+void GhostExchange::update() {
+  begin();
+  end();
+}
+
+//! Start updating ghosts of all fields. Has to be followed by end().
+void GhostExchange::begin() {
+  PetscErrorCode ierr;
+
+  if (m_packed != NULL) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "GhostExchange::begin() was called twice");
+  }
+
+  ierr = DMGetLocalVector(*m_da, &m_packed);
+  PISM_CHK(ierr, "DMGetLocalVector");
+
+  copy(true);
+
+  ierr = DMLocalToLocalBegin(*m_da, m_packed, INSERT_VALUES, m_packed);
+  PISM_CHK(ierr, "DMLocalToLocalBegin");
+}
+
+//! Finish updating ghosts started by begin().
+void GhostExchange::end() {
+  PetscErrorCode ierr;
+
+  if (m_packed == NULL) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "GhostExchange::end() was called before begin()");
+  }
+
+  ierr = DMLocalToLocalEnd(*m_da, m_packed, INSERT_VALUES, m_packed);
+  PISM_CHK(ierr, "DMLocalToLocalEnd");
+
+  copy(false);
+
+  ierr = DMRestoreLocalVector(*m_da, &m_packed);
+  PISM_CHK(ierr, "DMRestoreLocalVector");
+
+  m_packed = NULL;
+}
+
+//! Copy values of all fields to m_packed (if `pack` is true) or back.
+void GhostExchange::copy(bool pack) {
+  PetscErrorCode ierr;
+
+  const unsigned int N = m_fields.size();
+
+  PetscInt size = 0;
+  ierr = VecGetLocalSize(m_packed, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  // number of grid points in the local (ghosted) sub-domain
+  const PetscInt n_points = size / m_dof;
+
+  std::vector<PetscScalar*> arrays(N, NULL);
+  for (unsigned int k = 0; k < N; ++k) {
+    ierr = VecGetArray(m_fields[k]->vec(), &arrays[k]);
+    PISM_CHK(ierr, "VecGetArray");
+  }
+
+  PetscScalar *buffer = NULL;
+  ierr = VecGetArray(m_packed, &buffer);
+  PISM_CHK(ierr, "VecGetArray");
+
+  for (PetscInt n = 0; n < n_points; ++n) {
+    PetscScalar *p = buffer + n * m_dof;
+    for (unsigned int k = 0; k < N; ++k) {
+      const int dof = m_dofs[k];
+      PetscScalar *field = arrays[k] + n * dof;
+      if (pack) {
+        std::copy(field, field + dof, p);
+      } else {
+        std::copy(p, p + dof, field);
+      }
+      p += dof;
+    }
+  }
+
+  ierr = VecRestoreArray(m_packed, &buffer);
+  PISM_CHK(ierr, "VecRestoreArray");
+
+  for (unsigned int k = 0; k < N; ++k) {
+    ierr = VecRestoreArray(m_fields[k]->vec(), &arrays[k]);
+    PISM_CHK(ierr, "VecRestoreArray");
+  }
+}
+
+} // end of namespace pism
@@ -0,0 +1,70 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GHOSTEXCHANGE_H
+#define GHOSTEXCHANGE_H
+
+#include <vector>
+
+#include "pism/util/petscwrappers/DM.hh"
+
+namespace pism {
+
+class IceModelVec;
+
+//! Updates ghosts of several fields using one exchange.
+/*!
+ * Values of all fields are packed into one local vector (using a DM with the number of
+ * degrees of freedom equal to the sum of the numbers of degrees of freedom of all the
+ * fields), ghosts of this vector are updated, and updated values are copied back.
+ *
+ * This way ghosts of all the fields are exchanged using one message per neighboring
+ * rank instead of one message per field and neighbor.
+ *
+ * All fields have to have ghosts and use the same stencil width. Fields are not owned by
+ * this class; they have to exist as long as it is used.
+ *
+ * Use begin() and end() instead of update() to overlap communication with computations
+ * that do not modify these fields (see IceModelVec::begin_update_ghosts()).
+ */
+class GhostExchange {
+public:
+  GhostExchange(const std::vector<IceModelVec*> &fields);
+  ~GhostExchange();
+
+  void update();
+  void begin();
+  void end();
+private:
+  std::vector<IceModelVec*> m_fields;
+  //! numbers of degrees of freedom of fields in m_fields
+  std::vector<int> m_dofs;
+  //! DM used to update ghosts of all fields at once
+  petsc::DM::Ptr m_da;
+  //! total number of degrees of freedom
+  int m_dof;
+  //! packed values of all fields (between begin() and end())
+  Vec m_packed;
+
+  void copy(bool pack);
+};
+
+} // end of namespace pism
+
+#endif /* GHOSTEXCHANGE_H */
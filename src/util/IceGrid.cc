@@ -18,6 +18,7 @@
 
 #include <cassert>
 
+#include <list>
 #include <map>
 #include <numeric>
 #include <petscsys.h>
@@ -31,9 +32,11 @@
 #include "pism_options.hh"
 #include "error_handling.hh"
 #include "pism/util/io/File.hh"
+#include "pism/util/io/LocalInterpCtx.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/projection.hh"
+#include "pism/util/partitioning.hh"
 #include "pism/pism_config.hh"
 
 #if (Pism_USE_PIO==1)
@@ -42,8 +45,20 @@
 #include <pio.h>
 #endif
 
+#if (Pism_USE_OPENMP==1)
+#include <omp.h>
+#endif
+
 namespace pism {
 
+//! An interpolation context and the parameters used to create it.
+struct InterpolationContextCacheEntry {
+  unsigned int t_len;
+  std::vector<double> x, y, z, z_output;
+  InterpolationType type;
+  std::shared_ptr<LocalInterpCtx> context;
+};
+
 //! Internal structures of IceGrid.
 struct IceGrid::Impl {
   Impl(Context::ConstPtr ctx);
@@ -56,6 +71,9 @@ struct IceGrid::Impl {
 
   Context::ConstPtr ctx;
 
+  //! communicator used by this grid (see grid.partitioning.node_aware)
+  MPI_Comm com;
+
   MappingInfo mapping_info;
 
   // int to match types used by MPI
@@ -100,7 +118,11 @@ struct IceGrid::Impl {
   //! half width of the ice model grid in y-direction (m)
   double Ly;
 
-  std::map<int,petsc::DM::WeakPtr> dms;
+  //! DMs used by this grid. DMs are created on first use and shared by all fields with the
+  //! same number of degrees of freedom and stencil width. They are kept until the grid is
+  //! destroyed: re-creating them (when short-lived fields release them) is expensive on
+  //! many ranks.
+  std::map<int,petsc::DM::Ptr> dms;
 
   // This DM is used for I/O operations and is not owned by any
   // IceModelVec (so far, anyway). We keep a pointer to it here to
@@ -117,10 +139,13 @@ struct IceGrid::Impl {
 
   //! ParallelIO I/O decompositions.
   std::map<int, int> io_decompositions;
+
+  //! Interpolation contexts used to regrid fields from files (most recently used first).
+  std::list<InterpolationContextCacheEntry> interpolation_contexts;
 };
 
 IceGrid::Impl::Impl(Context::ConstPtr context)
-  : ctx(context), mapping_info("mapping", ctx->unit_system()) {
+  : ctx(context), com(context->com()), mapping_info("mapping", ctx->unit_system()) {
   // empty
 }
 
@@ -234,9 +259,17 @@ IceGrid::Ptr IceGrid::Shallow(Context::ConstPtr ctx,
   }
 }
 
+//! Communicator used by a grid with parameters `p`.
+static MPI_Comm grid_com(const Context &ctx, const GridParameters &p) {
+  if (ctx.config()->get_flag("grid.partitioning.node_aware")) {
+    return ctx.node_aware_com(p.procs_x, p.procs_y);
+  }
+  return ctx.com();
+}
+
 //! @brief Create a PISM distributed computational grid.
 IceGrid::IceGrid(Context::ConstPtr context, const GridParameters &p)
-  : com(context->com()), m_impl(new Impl(context)) {
+  : com(grid_com(*context, p)), m_impl(new Impl(context)) {
 
   try {
     m_impl->bsearch_accel = gsl_interp_accel_alloc();
@@ -244,6 +277,7 @@ IceGrid::IceGrid(Context::ConstPtr context, const GridParameters &p)
       throw RuntimeError(PISM_ERROR_LOCATION, "Failed to allocate a GSL interpolation accelerator");
     }
 
+    m_impl->com = com;
     MPI_Comm_rank(com, &m_impl->rank);
     MPI_Comm_size(com, &m_impl->size);
 
@@ -436,11 +470,18 @@ unsigned int IceGrid::kBelowHeight(double height) const {
                                   " grid Lz = %5.4f\n", height, Lz());
   }
 
+#if (Pism_USE_OPENMP==1)
+  if (omp_in_parallel()) {
+    // the accelerator is shared and cannot be used by several threads at the same time
+    return gsl_interp_bsearch(&m_impl->z[0], height, 0, m_impl->z.size() - 1);
+  }
+#endif
+
   return gsl_interp_accel_find(m_impl->bsearch_accel, &m_impl->z[0], m_impl->z.size(), height);
 }
 
 //! \brief Computes the number of processors in the X- and Y-directions.
-static void compute_nprocs(unsigned int Mx, unsigned int My, unsigned int size,
+void compute_nprocs(unsigned int Mx, unsigned int My, unsigned int size,
                            unsigned int &Nx, unsigned int &Ny) {
 
   if (My <= 0) {
@@ -483,8 +524,8 @@ static void compute_nprocs(unsigned int Mx, unsigned int My, unsigned int size,
 
 //! \brief Computes processor ownership ranges corresponding to equal area
 //! distribution among processors.
-static std::vector<unsigned int> ownership_ranges(unsigned int Mx,
-                                              unsigned int Nx) {
+std::vector<unsigned int> ownership_ranges(unsigned int Mx,
+                                          unsigned int Nx) {
 
   std::vector<unsigned int> result(Nx);
 
@@ -834,11 +875,51 @@ petsc::DM::Ptr IceGrid::get_dm(int da_dof, int stencil_width) const {
 
   int j = dm_hash(da_dof, stencil_width);
 
-  if (m_impl->dms[j].expired()) {
+  if (not m_impl->dms[j]) {
     result = m_impl->create_dm(da_dof, stencil_width);
     m_impl->dms[j] = result;
   } else {
-    result = m_impl->dms[j].lock();
+    result = m_impl->dms[j];
+  }
+
+  return result;
+}
+
+//! Maximum number of interpolation contexts kept by an IceGrid.
+static const size_t max_interpolation_contexts = 16;
+
+//! Get an interpolation context for regridding from a grid described by `input`.
+/*!
+ * Interpolation contexts (indexes and weights used to interpolate onto the local part of
+ * this grid) are cached, so regridding many variables from the same file computes them
+ * once.
+ *
+ * The returned context (including its buffer) is shared by all callers using the same
+ * arguments.
+ *
+ * Collective: all ranks have to make the same sequence of calls.
+ */
+std::shared_ptr<LocalInterpCtx> IceGrid::get_interpolation_context(const grid_info &input,
+                                                                   const std::vector<double> &z_output,
+                                                                   InterpolationType type) const {
+  auto &cache = m_impl->interpolation_contexts;
+
+  for (auto it = cache.begin(); it != cache.end(); ++it) {
+    if (it->type == type and it->t_len == input.t_len and
+        it->x == input.x and it->y == input.y and it->z == input.z and
+        it->z_output == z_output) {
+      // move to the front
+      cache.splice(cache.begin(), cache, it);
+      return cache.front().context;
+    }
+  }
+
+  std::shared_ptr<LocalInterpCtx> result(new LocalInterpCtx(input, *this, z_output, type));
+
+  cache.push_front({input.t_len, input.x, input.y, input.z, z_output, type, result});
+
+  if (cache.size() > max_interpolation_contexts) {
+    cache.pop_back();
   }
 
   return result;
@@ -867,7 +948,7 @@ petsc::DM::Ptr IceGrid::Impl::create_dm(int da_dof, int stencil_width) const {
                       da_dof, stencil_width);
 
   DM result;
-  PetscErrorCode ierr = DMDACreate2d(ctx->com(),
+  PetscErrorCode ierr = DMDACreate2d(com,
                                      DM_BOUNDARY_PERIODIC, DM_BOUNDARY_PERIODIC,
                                      DMDA_STENCIL_BOX,
                                      Mx, My,
@@ -1333,10 +1414,8 @@ void GridParameters::validate() const {
   }
 }
 
-//! Create a grid using command-line options and (possibly) an input file.
-/** Processes options -i, -bootstrap, -Mx, -My, -Mz, -Lx, -Ly, -Lz, -x_range, -y_range.
- */
-IceGrid::Ptr IceGrid::FromOptions(Context::ConstPtr ctx) {
+//! Create a grid using command-line options and an input file (uses even partitioning).
+static IceGrid::Ptr grid_from_options(Context::ConstPtr ctx) {
   auto config = ctx->config();
 
   auto input_file = config->get_string("input.file");
@@ -1423,6 +1502,32 @@ IceGrid::Ptr IceGrid::FromOptions(Context::ConstPtr ctx) {
   }
 }
 
+//! Create a grid using command-line options and (possibly) an input file.
+/** Processes options -i, -bootstrap, -Mx, -My, -Mz, -Lx, -Ly, -Lz, -x_range, -y_range.
+ *
+ * If `grid.partitioning.method` is "ice_weighted", uses ice thickness in the input file to
+ * re-compute ownership ranges (unless they are set using -procs_x and -procs_y).
+ */
+IceGrid::Ptr IceGrid::FromOptions(Context::ConstPtr ctx) {
+  IceGrid::Ptr result = grid_from_options(ctx);
+
+  auto config = ctx->config();
+
+  if (config->get_string("grid.partitioning.method") == "ice_weighted") {
+    options::IntegerList procs_x("-procs_x", "Processor ownership ranges (x direction)", {});
+    options::IntegerList procs_y("-procs_y", "Processor ownership ranges (y direction)", {});
+
+    if (procs_x.is_set() or procs_y.is_set()) {
+      ctx->log()->message(2, "* -procs_x or -procs_y is set; using ownership ranges as given.\n");
+      return result;
+    }
+
+    return ice_weighted_grid(result, config->get_string("input.file"));
+  }
+
+  return result;
+}
+
 const MappingInfo& IceGrid::get_mapping_info() const {
   return m_impl->mapping_info;
 }
@@ -1483,4 +1588,140 @@ int IceGrid::pio_io_decomposition(int dof, int output_datatype) const {
   return result;
 }
 
+//! Restrict the range of rows to the block assigned to the current thread of the enclosing
+//! OpenMP parallel region.
+void PointsWithGhosts::split_rows_between_threads() {
+#if (Pism_USE_OPENMP==1)
+  const int
+    n_threads = omp_get_num_threads(),
+    thread    = omp_get_thread_num(),
+    n_rows    = std::max(m_j_last - m_j_first + 1, 0),
+    // the first n_rows % n_threads threads get one extra row
+    size      = n_rows / n_threads + (thread < n_rows % n_threads ? 1 : 0),
+    start     = m_j_first + thread * (n_rows / n_threads) + std::min(thread, n_rows % n_threads);
+
+  m_j_first = start;
+  m_j_last  = start + size - 1;
+
+  m_i    = m_i_first;
+  m_j    = m_j_first;
+  m_done = m_done or size == 0;
+#endif
+}
+
+ThreadPoints::ThreadPoints(const IceGrid &g, unsigned int stencil_width)
+  : PointsWithGhosts(g, stencil_width) {
+  split_rows_between_threads();
+}
+
+ThreadInteriorPoints::ThreadInteriorPoints(const IceGrid &g, unsigned int stencil_width)
+  : InteriorPoints(g, stencil_width) {
+  split_rows_between_threads();
+}
+
+ColumnQueue::ColumnQueue(const IceGrid &g, int min_chunk_size)
+  : m_next(0),
+    m_n_columns(g.xm() * g.ym()),
+    m_min_chunk_size(std::max(min_chunk_size, 1)),
+    m_xs(g.xs()), m_ys(g.ys()), m_xm(g.xm()) {
+  // empty
+}
+
+//! Claim the next chunk of columns (linear indexes `first` to `last`, inclusive). Returns
+//! false if there are no columns left.
+bool ColumnQueue::claim(int &first, int &last) {
+#if (Pism_USE_OPENMP==1)
+  const int n_threads = omp_get_num_threads();
+#else
+  const int n_threads = 1;
+#endif
+
+  // The number of remaining columns read here may be out of date by the time we claim
+  // them. This is harmless: it only affects the chunk size.
+  const int
+    remaining  = m_n_columns - m_next.load(),
+    chunk_size = std::max(remaining / (2 * n_threads), m_min_chunk_size);
+
+  first = m_next.fetch_add(chunk_size);
+  if (first >= m_n_columns) {
+    return false;
+  }
+  last = std::min(first + chunk_size, m_n_columns) - 1;
+
+  return true;
+}
+
+QueuePoints::QueuePoints(ColumnQueue &queue)
+  : PointsWithGhosts(0, -1, 0, -1), m_queue(queue), m_k(0), m_k_last(-1) {
+  claim();
+}
+
+void QueuePoints::claim() {
+  m_done = not m_queue.claim(m_k, m_k_last);
+  if (not m_done) {
+    set_indexes();
+  }
+}
+
+Tiles::Tiles(const IceGrid &g, unsigned int stencil_width, int tile_width, int tile_height)
+  : m_width(tile_width), m_height(tile_height) {
+
+  if (tile_width < 1 or tile_height < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid tile size: %d x %d",
+                                  tile_width, tile_height);
+  }
+
+  const int width = stencil_width;
+
+  m_i_start = g.xs() - width;
+  m_i_end   = g.xs() + g.xm() + width;
+  m_j_start = g.ys() - width;
+  m_j_end   = g.ys() + g.ym() + width;
+
+  m_i    = m_i_start;
+  m_j    = m_j_start;
+  m_done = (m_i_start >= m_i_end) or (m_j_start >= m_j_end);
+}
+
+InteriorPoints::InteriorPoints(const IceGrid &g, unsigned int stencil_width)
+  : PointsWithGhosts(g, 0) {
+  const int width = stencil_width;
+
+  m_i_first += width;
+  m_i_last  -= width;
+  m_j_first += width;
+  m_j_last  -= width;
+
+  m_i    = m_i_first;
+  m_j    = m_j_first;
+  // the interior is empty if the sub-domain is too small
+  m_done = (m_i_first > m_i_last) or (m_j_first > m_j_last);
+}
+
+BoundaryPoints::BoundaryPoints(const IceGrid &g, unsigned int stencil_width)
+  : PointsWithGhosts(g, 0) {
+  const int width = stencil_width;
+
+  m_interior_i_first = m_i_first + width;
+  m_interior_i_last  = m_i_last - width;
+  m_interior_j_first = m_j_first + width;
+  m_interior_j_last  = m_j_last - width;
+
+  // with a zero width all points are interior points
+  m_done = (width == 0);
+}
+
+GhostPoints::GhostPoints(const IceGrid &g, unsigned int stencil_width)
+  : PointsWithGhosts(g, stencil_width) {
+  const int width = stencil_width;
+
+  m_owned_i_first = m_i_first + width;
+  m_owned_i_last  = m_i_last - width;
+  m_owned_j_first = m_j_first + width;
+  m_owned_j_last  = m_j_last - width;
+
+  // with a zero width there are no ghost points
+  m_done = (width == 0);
+}
+
 } // end of namespace pism
@@ -19,6 +19,8 @@
 #ifndef __grid_hh
 #define __grid_hh
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <vector>
 #include <string>
@@ -27,6 +29,7 @@
 #include "pism/util/Context.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/petscwrappers/DM.hh"
+#include "pism/util/interpolation.hh"
 
 namespace pism {
 
@@ -38,6 +41,7 @@ class Vars;
 class Logger;
 
 class MappingInfo;
+class LocalInterpCtx;
 
 typedef enum {UNKNOWN = 0, EQUAL, QUADRATIC} SpacingType;
 typedef enum {NOT_PERIODIC = 0, X_PERIODIC = 1, Y_PERIODIC = 2, XY_PERIODIC = 3} Periodicity;
@@ -238,6 +242,10 @@ public:
 
   petsc::DM::Ptr get_dm(int dm_dof, int stencil_width) const;
 
+  std::shared_ptr<LocalInterpCtx> get_interpolation_context(const grid_info &input,
+                                                            const std::vector<double> &z_output,
+                                                            InterpolationType type) const;
+
   void report_parameters() const;
 
   void compute_point_neighbors(double X, double Y,
@@ -316,6 +324,13 @@ private:
 
 double radius(const IceGrid &grid, int i, int j);
 
+//! Compute the default number of processes in the X and Y directions.
+void compute_nprocs(unsigned int Mx, unsigned int My, unsigned int size,
+                    unsigned int &Nx, unsigned int &Ny);
+
+//! Ownership ranges splitting `Mx` grid points into `Nx` parts of (almost) equal size.
+std::vector<unsigned int> ownership_ranges(unsigned int Mx, unsigned int Nx);
+
 //! @brief Check if a point `(i,j)` is in the strip of `stripwidth`
 //! meters around the edge of the computational domain.
 inline bool in_null_strip(const IceGrid& grid, int i, int j, double strip_width) {
@@ -373,10 +388,39 @@ public:
     }
   }
 
+  //! Skip the rest of the current row.
+  /*!
+   * Use with i_first() and i_last() to process one row at a time (see FlatView). Not
+   * supported by iterators that skip points within a row (BoundaryPoints, GhostPoints).
+   */
+  void next_row() {
+    assert(not m_done);
+    m_i = m_i_last;
+    PointsWithGhosts::next();
+  }
+
+  //! The first `i` index visited in a row.
+  int i_first() const {
+    return m_i_first;
+  }
+  //! The last `i` index visited in a row.
+  int i_last() const {
+    return m_i_last;
+  }
+
   operator bool() const {
     return not m_done;
   }
-private:
+protected:
+  PointsWithGhosts(int i_first, int i_last, int j_first, int j_last)
+    : m_i(i_first), m_j(j_first),
+      m_i_first(i_first), m_i_last(i_last), m_j_first(j_first), m_j_last(j_last),
+      m_done(i_first > i_last or j_first > j_last) {
+    // empty
+  }
+
+  void split_rows_between_threads();
+
   int m_i, m_j;
   int m_i_first, m_i_last, m_j_first, m_j_last;
   bool m_done;
@@ -393,6 +437,254 @@ public:
   Points(const IceGrid &g) : PointsWithGhosts(g, 0) {}
 };
 
+/** Iterator class for traversing the interior of the sub-domain owned by this rank.
+ *
+ * Visits owned points at least `stencil_width` points away from the boundary of the
+ * sub-domain, i.e. points at which a computation using a stencil of this width does not
+ * need ghost values. Use with BoundaryPoints to overlap the communication needed to update
+ * ghosts with computations:
+ *
+ * ```
+ * field.begin_update_ghosts();
+ * for (InteriorPoints p(grid, 1); p; p.next()) { ... }
+ * field.end_update_ghosts();
+ * for (BoundaryPoints p(grid, 1); p; p.next()) { ... }
+ * ```
+ */
+class InteriorPoints : public PointsWithGhosts {
+public:
+  InteriorPoints(const IceGrid &g, unsigned int stencil_width);
+};
+
+/** Iterator class for traversing the band of points of width `stencil_width` along the
+ * boundary of the sub-domain owned by this rank.
+ *
+ * Visits owned points that are not visited by InteriorPoints with the same stencil width.
+ */
+class BoundaryPoints : public PointsWithGhosts {
+public:
+  BoundaryPoints(const IceGrid &g, unsigned int stencil_width);
+
+  void next() {
+    PointsWithGhosts::next();
+    if (not m_done and interior()) {
+      // skip the rest of interior points in this row
+      m_i = m_interior_i_last;
+      PointsWithGhosts::next();
+    }
+  }
+private:
+  bool interior() const {
+    return (m_i >= m_interior_i_first and m_i <= m_interior_i_last and
+            m_j >= m_interior_j_first and m_j <= m_interior_j_last);
+  }
+  int m_interior_i_first, m_interior_i_last, m_interior_j_first, m_interior_j_last;
+};
+
+/** Iterator class for traversing ghost points of the sub-domain owned by this rank.
+ *
+ * Visits points in the band of width `stencil_width` around the sub-domain, i.e. points
+ * visited by PointsWithGhosts with the same stencil width that are not owned by this rank.
+ */
+class GhostPoints : public PointsWithGhosts {
+public:
+  GhostPoints(const IceGrid &g, unsigned int stencil_width);
+
+  void next() {
+    PointsWithGhosts::next();
+    if (not m_done and owned()) {
+      // skip the rest of owned points in this row
+      m_i = m_owned_i_last;
+      PointsWithGhosts::next();
+    }
+  }
+private:
+  bool owned() const {
+    return (m_i >= m_owned_i_first and m_i <= m_owned_i_last and
+            m_j >= m_owned_j_first and m_j <= m_owned_j_last);
+  }
+  int m_owned_i_first, m_owned_i_last, m_owned_j_first, m_owned_j_last;
+};
+
+/** Iterator class for traversing the part of the grid assigned to the current thread.
+ *
+ * Splits rows of the sub-domain (extended by `stencil_width` ghost points) into contiguous
+ * blocks, one per thread of the enclosing OpenMP parallel region. Outside of a parallel
+ * region (and if PISM is built without OpenMP) it traverses the whole sub-domain.
+ *
+ * Usage:
+ *
+ * ```
+ * IceModelVec::AccessList list{...}; // has to be created outside of the parallel region
+ *
+ * ParallelSection loop(grid.com);
+ * #pragma omp parallel
+ * {
+ *   try {
+ *     for (ThreadPoints p(grid); p; p.next()) { ... }
+ *   } catch (...) {
+ *     loop.failed();
+ *   }
+ * }
+ * loop.check();
+ * ```
+ */
+class ThreadPoints : public PointsWithGhosts {
+public:
+  ThreadPoints(const IceGrid &g, unsigned int stencil_width = 0);
+};
+
+/** Iterator class for traversing the part of the interior of the sub-domain (see
+ * InteriorPoints) assigned to the current thread (see ThreadPoints).
+ */
+class ThreadInteriorPoints : public InteriorPoints {
+public:
+  ThreadInteriorPoints(const IceGrid &g, unsigned int stencil_width);
+};
+
+/** Columns of the sub-domain owned by this rank, handed out in chunks to threads of an
+ * OpenMP parallel region (see QueuePoints).
+ *
+ * ThreadPoints gives each thread the same number of rows. This balances the load poorly
+ * if the cost of a column varies a lot (temperate or thick columns are much more
+ * expensive than thin or ice-free ones). Here a thread that is done with its chunk
+ * claims the next one, so threads that got cheap columns take over the rest of the
+ * work. Chunks get smaller as the queue empties (each is a fraction of the remaining
+ * columns, but not smaller than `min_chunk_size`), so that expensive columns near the
+ * end are spread between threads.
+ *
+ * Has to be created outside of the parallel region.
+ */
+class ColumnQueue {
+public:
+  ColumnQueue(const IceGrid &g, int min_chunk_size = 8);
+
+  bool claim(int &first, int &last);
+private:
+  friend class QueuePoints;
+
+  std::atomic<int> m_next;
+  int m_n_columns, m_min_chunk_size;
+  int m_xs, m_ys, m_xm;
+};
+
+/** Iterator class for traversing columns claimed by the current thread from a
+ * ColumnQueue.
+ *
+ * Usage:
+ *
+ * ```
+ * ColumnQueue columns(grid);
+ * ParallelSection loop(grid.com);
+ * #pragma omp parallel
+ * {
+ *   try {
+ *     for (QueuePoints p(columns); p; p.next()) { ... }
+ *   } catch (...) {
+ *     loop.failed();
+ *   }
+ * }
+ * loop.check();
+ * ```
+ *
+ * Does not support next_row().
+ */
+class QueuePoints : public PointsWithGhosts {
+public:
+  QueuePoints(ColumnQueue &queue);
+
+  void next() {
+    assert(not m_done);
+    m_k += 1;
+    if (m_k > m_k_last) {
+      claim();
+    } else {
+      set_indexes();
+    }
+  }
+private:
+  void claim();
+
+  void set_indexes() {
+    m_i = m_queue.m_xs + m_k % m_queue.m_xm;
+    m_j = m_queue.m_ys + m_k / m_queue.m_xm;
+  }
+
+  ColumnQueue &m_queue;
+  //! linear index of the current column and the last column in the current chunk
+  int m_k, m_k_last;
+};
+
+/** Iterator class for traversing the sub-domain (extended by `stencil_width` ghost points)
+ * in rectangular tiles.
+ *
+ * Kernels applied one after another to the whole sub-domain of a large grid have to
+ * re-load their inputs from memory. Applying them tile by tile keeps the data in cache:
+ *
+ * ```
+ * for (Tiles t(grid); t; t.next()) {
+ *   for (TilePoints p(t, 1); p; p.next()) { ... compute A ... }
+ *   for (TilePoints p(t); p; p.next()) { ... compute B using A at (i, j) and neighbors ... }
+ * }
+ * ```
+ *
+ * If a kernel uses results of the previous one at neighboring points, the previous kernel
+ * has to be applied to the tile extended by a "halo" of the corresponding width (as
+ * above). Values in halos are computed more than once, so this works for kernels that
+ * only write to points they visit.
+ */
+class Tiles {
+public:
+  Tiles(const IceGrid &g, unsigned int stencil_width = 0,
+        int tile_width = 128, int tile_height = 32);
+
+  int i_first() const {
+    return m_i;
+  }
+  int i_last() const {
+    return std::min(m_i + m_width, m_i_end) - 1;
+  }
+  int j_first() const {
+    return m_j;
+  }
+  int j_last() const {
+    return std::min(m_j + m_height, m_j_end) - 1;
+  }
+
+  void next() {
+    assert(not m_done);
+    m_i += m_width;
+    if (m_i >= m_i_end) {
+      m_i = m_i_start;
+      m_j += m_height;
+    }
+    m_done = m_j >= m_j_end;
+  }
+
+  operator bool() const {
+    return not m_done;
+  }
+private:
+  int m_width, m_height;
+  //! the region covered by tiles: [m_i_start, m_i_end) x [m_j_start, m_j_end)
+  int m_i_start, m_i_end, m_j_start, m_j_end;
+  //! the lower left corner of the current tile
+  int m_i, m_j;
+  bool m_done;
+};
+
+/** Iterator class for traversing the current tile of Tiles, extended by `halo` points in
+ * all directions.
+ */
+class TilePoints : public PointsWithGhosts {
+public:
+  TilePoints(const Tiles &tile, unsigned int halo = 0)
+    : PointsWithGhosts(tile.i_first() - (int)halo, tile.i_last() + (int)halo,
+                       tile.j_first() - (int)halo, tile.j_last() + (int)halo) {
+    // empty
+  }
+};
+
 } // end of namespace pism
 
 #endif  /* __grid_hh */
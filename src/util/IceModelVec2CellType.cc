@@ -0,0 +1,124 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+//! List of indexes of owned grid points of a given type.
+/*!
+ * Lists are re-computed when the state counter of this field changes, so code modifying
+ * cell type values using `operator()` has to call inc_state_counter().
+ *
+ * Points in each list are in the order used by Points, so replacing
+ *
+ * @code
+ * for (Points p(grid); p; p.next()) {
+ *   if (cell_type.icy(p.i(), p.j())) { ... }
+ * }
+ * @endcode
+ *
+ * with
+ *
+ * @code
+ * for (PointsInList p(cell_type.index_list(IceModelVec2CellType::ICY)); p; p.next()) { ... }
+ * @endcode
+ *
+ * does not change results even if the loop body depends on the traversal order.
+ *
+ * The ICE_MARGIN list (icy points with at least one ice-free neighbor) requires ghosts.
+ */
+const IndexList& IceModelVec2CellType::index_list(IndexListType type) const {
+  if (type == ICE_MARGIN and not m_has_ghosts) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "%s: the ice margin index list requires ghosts",
+                                  get_name().c_str());
+  }
+
+  if (m_index_lists_state != state_counter()) {
+    update_index_lists();
+  }
+
+  return m_index_lists[type];
+}
+
+void IceModelVec2CellType::update_index_lists() const {
+  m_index_lists.resize(N_INDEX_LISTS);
+  for (auto &list : m_index_lists) {
+    list.clear();
+  }
+
+  AccessList list{this};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (icy(i, j)) {
+      m_index_lists[ICY].push_back(i, j);
+
+      if (grounded_ice(i, j)) {
+        m_index_lists[GROUNDED_ICE].push_back(i, j);
+      } else {
+        m_index_lists[FLOATING_ICE].push_back(i, j);
+      }
+
+      if (m_has_ghosts and ice_margin(i, j)) {
+        m_index_lists[ICE_MARGIN].push_back(i, j);
+      }
+    } else {
+      m_index_lists[ICE_FREE].push_back(i, j);
+    }
+  }
+
+  m_index_lists_state = state_counter();
+}
+
+/*!
+ * Returns a compact copy of cell type values at owned grid points and ghosts.
+ *
+ * The copy is updated when the state counter changes, so code modifying cell type
+ * values (including ghosts) has to call inc_state_counter().
+ *
+ * Mask-heavy loops can read cell types from this copy to reduce memory traffic:
+ *
+ * @code
+ * const auto &mask = cell_type.compact();
+ *
+ * for (Points p(grid); p; p.next()) {
+ *   auto M = mask.int_star(p.i(), p.j());
+ *   ...
+ * }
+ * @endcode
+ */
+const IceModelVec2CellType::Compact& IceModelVec2CellType::compact() const {
+  if (m_compact == nullptr or m_compact->stencil_width() != stencil_width()) {
+    m_compact.reset(new Compact(m_grid, stencil_width()));
+    m_compact_state = -1;
+  }
+
+  if (m_compact_state != state_counter()) {
+    m_compact->copy_from(*this);
+    m_compact_state = state_counter();
+  }
+
+  return *m_compact;
+}
+
+} // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2019 PISM Authors
+/* Copyright (C) 2016, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,11 +20,65 @@
 #ifndef ICEMODELVEC2CELLTYPE_H
 #define ICEMODELVEC2CELLTYPE_H
 
+#include <vector>
+
 #include "iceModelVec.hh"
 #include "Mask.hh"
+#include "CompactMask.hh"
 
 namespace pism {
 
+//! List of map-plane grid point indexes, stored as a "structure of arrays".
+struct IndexList {
+  std::vector<int> i, j;
+
+  size_t size() const {
+    return i.size();
+  }
+
+  void clear() {
+    i.clear();
+    j.clear();
+  }
+
+  void push_back(int i_, int j_) {
+    i.push_back(i_);
+    j.push_back(j_);
+  }
+};
+
+/** Iterator class for traversing grid points in an IndexList.
+ *
+ * Usage:
+ *
+ * `for (PointsInList p(cell_type.index_list(IceModelVec2CellType::ICY)); p; p.next()) { ... }`
+ */
+class PointsInList {
+public:
+  PointsInList(const IndexList &list)
+    : m_list(list), m_n(0) {
+    // empty
+  }
+
+  int i() const {
+    return m_list.i[m_n];
+  }
+  int j() const {
+    return m_list.j[m_n];
+  }
+
+  void next() {
+    m_n += 1;
+  }
+
+  operator bool() const {
+    return m_n < m_list.size();
+  }
+private:
+  const IndexList &m_list;
+  size_t m_n;
+};
+
 //! "Cell type" mask. Adds convenience methods to IceModelVec2Int.
 class IceModelVec2CellType : public IceModelVec2Int {
 public:
@@ -32,16 +86,27 @@ public:
   typedef std::shared_ptr<IceModelVec2CellType> Ptr;
   typedef std::shared_ptr<const IceModelVec2CellType> ConstPtr;
   IceModelVec2CellType()
-    : IceModelVec2Int() {
+    : IceModelVec2Int(), m_index_lists_state(-1), m_compact_state(-1) {
     // empty
   }
 
   IceModelVec2CellType(IceGrid::ConstPtr grid, const std::string &name,
                        IceModelVecKind ghostedp, int width = 1)
-    : IceModelVec2Int(grid, name, ghostedp, width) {
+    : IceModelVec2Int(grid, name, ghostedp, width), m_index_lists_state(-1),
+      m_compact_state(-1) {
     // empty
   }
-  
+
+  //! Categories of grid points stored in index lists.
+  enum IndexListType {ICY = 0, GROUNDED_ICE, FLOATING_ICE, ICE_MARGIN, ICE_FREE, N_INDEX_LISTS};
+
+  const IndexList& index_list(IndexListType type) const;
+
+  //! Compact storage of cell type values (see CompactMask).
+  typedef CompactMask<int8_t> Compact;
+
+  const Compact& compact() const;
+
   inline bool ocean(int i, int j) const {
     return mask::ocean(as_int(i, j));
   }
@@ -104,6 +169,18 @@ public:
     return (ice_free_ocean(i + 1, j) or ice_free_ocean(i - 1, j) or
             ice_free_ocean(i, j + 1) or ice_free_ocean(i, j - 1));
   }
+private:
+  void update_index_lists() const;
+
+  // cached lists of indexes of points owned by this rank, one per IndexListType
+  mutable std::vector<IndexList> m_index_lists;
+  // state counter corresponding to m_index_lists
+  mutable int m_index_lists_state;
+
+  // cached compact copy (including ghosts)
+  mutable std::unique_ptr<Compact> m_compact;
+  // state counter corresponding to m_compact
+  mutable int m_compact_state;
 };
 
 } // end of namespace pism
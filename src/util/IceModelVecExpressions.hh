@@ -0,0 +1,393 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ICEMODELVECEXPRESSIONS_H
+#define PISM_ICEMODELVECEXPRESSIONS_H
+
+#include <algorithm>            // std::min
+#include <type_traits>
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+
+/*!
+ * Point-wise arithmetic expressions involving IceModelVec2S, IceModelVec3D and numbers,
+ * evaluated in one pass over the grid and without temporary fields:
+ *
+ *     assign(result, a * x + b * y - z);
+ *
+ * is equivalent to
+ *
+ *     result.copy_from(x);
+ *     result.scale(a);
+ *     result.add(b, y);
+ *     result.add(-1.0, z);
+ *
+ * but reads each input once and writes `result` once. Fields used in an expression are
+ * added to an AccessList by assign(), so the caller does not need to create one.
+ *
+ * In a 3D expression 2D fields and numbers are the same at all levels of a column.
+ *
+ * Operators below build expression objects storing references to fields involved, so an
+ * expression should be evaluated in the statement that creates it.
+ */
+
+namespace pism {
+namespace expressions {
+
+//! Common base class of all expressions (used to identify them).
+struct ExpressionBase {
+};
+
+//! Base class of expressions (using the "curiously recurring template pattern").
+template<class E>
+struct Expression : public ExpressionBase {
+  const E& self() const {
+    return static_cast<const E&>(*this);
+  }
+};
+
+//! A 2D field.
+class Field2 : public Expression<Field2> {
+public:
+  Field2(const IceModelVec2S &field)
+    : m_field(field) {
+    // empty
+  }
+
+  double operator()(int i, int j) const {
+    return m_field(i, j);
+  }
+
+  double operator()(int i, int j, int /* k */) const {
+    return m_field(i, j);
+  }
+
+  void add_to(IceModelVec::AccessList &list) const {
+    list.add(m_field);
+  }
+
+  unsigned int stencil_width(unsigned int width) const {
+    return std::min(width, m_field.stencil_width());
+  }
+
+  void check_levels(unsigned int /* n_levels */) const {
+    // a 2D field is the same at all levels
+  }
+private:
+  const IceModelVec2S &m_field;
+};
+
+//! A 3D field.
+class Field3 : public Expression<Field3> {
+public:
+  Field3(const IceModelVec3D &field)
+    : m_field(field) {
+    // empty
+  }
+
+  double operator()(int i, int j, int k) const {
+    return m_field(i, j, k);
+  }
+
+  void add_to(IceModelVec::AccessList &list) const {
+    list.add(m_field);
+  }
+
+  unsigned int stencil_width(unsigned int width) const {
+    return std::min(width, m_field.stencil_width());
+  }
+
+  void check_levels(unsigned int n_levels) const {
+    if (m_field.levels().size() != n_levels) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "%s has %d levels, expected %d",
+                                    m_field.get_name().c_str(),
+                                    (int)m_field.levels().size(), (int)n_levels);
+    }
+  }
+private:
+  const IceModelVec3D &m_field;
+};
+
+//! A number.
+class Constant : public Expression<Constant> {
+public:
+  Constant(double value)
+    : m_value(value) {
+    // empty
+  }
+
+  double operator()(int /* i */, int /* j */) const {
+    return m_value;
+  }
+
+  double operator()(int /* i */, int /* j */, int /* k */) const {
+    return m_value;
+  }
+
+  void add_to(IceModelVec::AccessList &/* list */) const {
+    // empty
+  }
+
+  unsigned int stencil_width(unsigned int width) const {
+    return width;
+  }
+
+  void check_levels(unsigned int /* n_levels */) const {
+    // empty
+  }
+private:
+  double m_value;
+};
+
+struct Plus {
+  static double apply(double a, double b) {
+    return a + b;
+  }
+};
+
+struct Minus {
+  static double apply(double a, double b) {
+    return a - b;
+  }
+};
+
+struct Times {
+  static double apply(double a, double b) {
+    return a * b;
+  }
+};
+
+struct Divide {
+  static double apply(double a, double b) {
+    return a / b;
+  }
+};
+
+//! A binary operation. Operands are stored by value (fields are stored by reference).
+template<class Op, class L, class R>
+class Binary : public Expression<Binary<Op, L, R> > {
+public:
+  Binary(const L &left, const R &right)
+    : m_left(left), m_right(right) {
+    // empty
+  }
+
+  double operator()(int i, int j) const {
+    return Op::apply(m_left(i, j), m_right(i, j));
+  }
+
+  double operator()(int i, int j, int k) const {
+    return Op::apply(m_left(i, j, k), m_right(i, j, k));
+  }
+
+  void add_to(IceModelVec::AccessList &list) const {
+    m_left.add_to(list);
+    m_right.add_to(list);
+  }
+
+  unsigned int stencil_width(unsigned int width) const {
+    return m_right.stencil_width(m_left.stencil_width(width));
+  }
+
+  void check_levels(unsigned int n_levels) const {
+    m_left.check_levels(n_levels);
+    m_right.check_levels(n_levels);
+  }
+private:
+  L m_left;
+  R m_right;
+};
+
+//! Negation.
+template<class E>
+class Negate : public Expression<Negate<E> > {
+public:
+  Negate(const E &expression)
+    : m_expression(expression) {
+    // empty
+  }
+
+  double operator()(int i, int j) const {
+    return -m_expression(i, j);
+  }
+
+  double operator()(int i, int j, int k) const {
+    return -m_expression(i, j, k);
+  }
+
+  void add_to(IceModelVec::AccessList &list) const {
+    m_expression.add_to(list);
+  }
+
+  unsigned int stencil_width(unsigned int width) const {
+    return m_expression.stencil_width(width);
+  }
+
+  void check_levels(unsigned int n_levels) const {
+    m_expression.check_levels(n_levels);
+  }
+private:
+  E m_expression;
+};
+
+inline Field2 as_expression(const IceModelVec2S &field) {
+  return Field2(field);
+}
+
+inline Field3 as_expression(const IceModelVec3D &field) {
+  return Field3(field);
+}
+
+inline Constant as_expression(double value) {
+  return Constant(value);
+}
+
+template<class E>
+const E& as_expression(const Expression<E> &expression) {
+  return expression.self();
+}
+
+//! Type of the expression corresponding to an operand of type `T`.
+template<class T>
+using expression_type =
+  typename std::decay<decltype(as_expression(std::declval<const T&>()))>::type;
+
+//! True if `T` is a field or an expression (but not a number).
+template<class T>
+struct is_term : std::integral_constant<bool,
+                                        std::is_base_of<IceModelVec2S, T>::value or
+                                        std::is_base_of<IceModelVec3D, T>::value or
+                                        std::is_base_of<ExpressionBase, T>::value> {
+};
+
+//! Operators below accept a term and either a term or a number.
+template<class L, class R>
+using enable_binary =
+  typename std::enable_if<(is_term<L>::value and is_term<R>::value) or
+                          (is_term<L>::value and std::is_arithmetic<R>::value) or
+                          (std::is_arithmetic<L>::value and is_term<R>::value)>::type;
+
+template<class Op, class L, class R>
+using binary_type = Binary<Op, expression_type<L>, expression_type<R> >;
+
+} // end of namespace expressions
+
+template<class L, class R, class = expressions::enable_binary<L, R> >
+expressions::binary_type<expressions::Plus, L, R> operator+(const L &left, const R &right) {
+  using namespace expressions;
+  return {as_expression(left), as_expression(right)};
+}
+
+template<class L, class R, class = expressions::enable_binary<L, R> >
+expressions::binary_type<expressions::Minus, L, R> operator-(const L &left, const R &right) {
+  using namespace expressions;
+  return {as_expression(left), as_expression(right)};
+}
+
+template<class L, class R, class = expressions::enable_binary<L, R> >
+expressions::binary_type<expressions::Times, L, R> operator*(const L &left, const R &right) {
+  using namespace expressions;
+  return {as_expression(left), as_expression(right)};
+}
+
+template<class L, class R, class = expressions::enable_binary<L, R> >
+expressions::binary_type<expressions::Divide, L, R> operator/(const L &left, const R &right) {
+  using namespace expressions;
+  return {as_expression(left), as_expression(right)};
+}
+
+template<class E, class = typename std::enable_if<expressions::is_term<E>::value>::type>
+expressions::Negate<expressions::expression_type<E> > operator-(const E &expression) {
+  using namespace expressions;
+  return expressions::Negate<expression_type<E> >(as_expression(expression));
+}
+
+//! Evaluate `expression` at all grid points and store the result in `result`.
+/*!
+ * Ghosts of `result` are computed locally if all fields in `expression` have wide enough
+ * stencils and updated using communication otherwise (like IceModelVec::add()).
+ *
+ * `result` may appear in `expression`.
+ */
+template<class T>
+void assign(IceModelVec2S &result, const T &expression) {
+  auto e = expressions::as_expression(expression);
+
+  IceModelVec::AccessList list{&result};
+  e.add_to(list);
+
+  unsigned int width = e.stencil_width(result.stencil_width());
+  bool scatter = false;
+  if (width < result.stencil_width()) {
+    width   = 0;
+    scatter = true;
+  }
+
+  for (PointsWithGhosts p(*result.grid(), width); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result(i, j) = e(i, j);
+  }
+
+  if (scatter) {
+    result.update_ghosts();
+  }
+
+  result.inc_state_counter();
+}
+
+//! Evaluate a 3D `expression` at all grid points and store the result in `result`.
+template<class T>
+void assign(IceModelVec3D &result, const T &expression) {
+  auto e = expressions::as_expression(expression);
+
+  const unsigned int n_levels = result.levels().size();
+  e.check_levels(n_levels);
+
+  IceModelVec::AccessList list{&result};
+  e.add_to(list);
+
+  unsigned int width = e.stencil_width(result.stencil_width());
+  bool scatter = false;
+  if (width < result.stencil_width()) {
+    width   = 0;
+    scatter = true;
+  }
+
+  for (PointsWithGhosts p(*result.grid(), width); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double *column = result.get_column(i, j);
+    for (unsigned int k = 0; k < n_levels; ++k) {
+      column[k] = e(i, j, k);
+    }
+  }
+
+  if (scatter) {
+    result.update_ghosts();
+  }
+
+  result.inc_state_counter();
+}
+
+} // end of namespace pism
+
+#endif /* PISM_ICEMODELVECEXPRESSIONS_H */
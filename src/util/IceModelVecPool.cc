@@ -0,0 +1,152 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <map>
+#include <tuple>
+#include <typeindex>
+#include <vector>
+
+#include "pism/util/IceModelVecPool.hh"
+
+namespace pism {
+
+struct IceModelVecPool::Impl {
+  Impl(IceGrid::ConstPtr g)
+    : grid(g) {
+    // empty
+  }
+
+  ~Impl() {
+    for (auto &fields : idle) {
+      for (auto *field : fields.second) {
+        delete field;
+      }
+    }
+  }
+
+  //! field type, "with ghosts" flag and the stencil width
+  typedef std::tuple<std::type_index, bool, unsigned int> Key;
+
+  IceGrid::ConstPtr grid;
+
+  //! fields that are not in use
+  std::map<Key, std::vector<IceModelVec*> > idle;
+};
+
+IceModelVecPool::IceModelVecPool(IceGrid::ConstPtr grid)
+  : m_impl(new Impl(grid)) {
+  // empty
+}
+
+IceModelVecPool::~IceModelVecPool() {
+  // empty
+}
+
+//! Get the pool shared by all users of `grid`.
+/*!
+ * The pool is destroyed when all the pointers to it are gone.
+ */
+IceModelVecPool::Ptr IceModelVecPool::shared(IceGrid::ConstPtr grid) {
+  static std::map<const IceGrid*, std::weak_ptr<IceModelVecPool> > pools;
+
+  auto result = pools[grid.get()].lock();
+  if (not result) {
+    result = std::make_shared<IceModelVecPool>(grid);
+    pools[grid.get()] = result;
+  }
+  return result;
+}
+
+template<class T>
+typename T::Ptr IceModelVecPool::get(const std::string &name, IceModelVecKind ghosted,
+                                     unsigned int stencil_width) {
+  const Impl::Key key{std::type_index(typeid(T)), ghosted == WITH_GHOSTS, stencil_width};
+
+  T *result = nullptr;
+
+  auto &fields = m_impl->idle[key];
+  if (fields.empty()) {
+    result = new T(m_impl->grid, name, ghosted, stencil_width);
+  } else {
+    result = static_cast<T*>(fields.back());
+    fields.pop_back();
+
+    result->set_name(name);
+    result->set(0.0);
+  }
+
+  // Return the field to the pool instead of deleting it. The deleter holds a weak
+  // pointer to the storage so that fields outliving the pool are simply deleted.
+  std::weak_ptr<Impl> storage = m_impl;
+  return typename T::Ptr(result,
+                         [storage, key](T *field) {
+                           auto impl = storage.lock();
+                           if (impl) {
+                             impl->idle[key].push_back(field);
+                           } else {
+                             delete field;
+                           }
+                         });
+}
+
+//! Get a 2D scalar field.
+IceModelVec2S::Ptr IceModelVecPool::scalar(const std::string &name, IceModelVecKind ghosted,
+                                           unsigned int stencil_width) {
+  return get<IceModelVec2S>(name, ghosted, stencil_width);
+}
+
+//! Get a 2D vector field.
+IceModelVec2V::Ptr IceModelVecPool::vector(const std::string &name, IceModelVecKind ghosted,
+                                           unsigned int stencil_width) {
+  return get<IceModelVec2V>(name, ghosted, stencil_width);
+}
+
+//! Get a 3D field using vertical levels of the grid.
+IceModelVec2Int::Ptr IceModelVecPool::integer(const std::string &name, IceModelVecKind ghosted,
+                                              unsigned int stencil_width) {
+  return get<IceModelVec2Int>(name, ghosted, stencil_width);
+}
+
+IceModelVec2CellType::Ptr IceModelVecPool::cell_type(const std::string &name,
+                                                     IceModelVecKind ghosted,
+                                                     unsigned int stencil_width) {
+  return get<IceModelVec2CellType>(name, ghosted, stencil_width);
+}
+
+IceModelVec2Stag::Ptr IceModelVecPool::staggered(const std::string &name,
+                                                 IceModelVecKind ghosted,
+                                                 unsigned int stencil_width) {
+  return get<IceModelVec2Stag>(name, ghosted, stencil_width);
+}
+
+IceModelVec3::Ptr IceModelVecPool::volume(const std::string &name, IceModelVecKind ghosted,
+                                          unsigned int stencil_width) {
+  return get<IceModelVec3>(name, ghosted, stencil_width);
+}
+
+//! Number of fields that are not in use.
+unsigned int IceModelVecPool::n_idle() const {
+  unsigned int result = 0;
+  for (const auto &fields : m_impl->idle) {
+    result += fields.second.size();
+  }
+  return result;
+}
+
+} // end of namespace pism
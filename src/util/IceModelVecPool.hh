@@ -0,0 +1,95 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ICEMODELVECPOOL_H
+#define PISM_ICEMODELVECPOOL_H
+
+#include <memory>
+#include <string>
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/IceModelVec2CellType.hh"
+
+namespace pism {
+
+//! A pool of re-usable fields.
+/*!
+ * Allocating a field creates a PETSc Vec and destroying it frees its memory. Code that
+ * needs a new field every time it is called (e.g. Diagnostic::compute_impl()) can get
+ * one from this pool instead: when the last copy of the returned pointer goes out of
+ * scope the field is returned to the pool and the next request for a field of the same
+ * type and stencil width gets it back (if the pool still exists).
+ *
+ * Fields returned by this class are filled with zeros, just like new ones. The name of a
+ * re-used field is reset, but other metadata are left as is: callers are expected to set
+ * them (as all diagnostics do).
+ *
+ * Components use the pool shared by all users of a grid (see shared()) to borrow work
+ * space needed only while they are updated and release it when done. This way the peak
+ * memory use is set by the component needing the most work space at a time instead of
+ * the sum over all components.
+ *
+ * 3D fields use vertical levels of the grid.
+ */
+class IceModelVecPool {
+public:
+  typedef std::shared_ptr<IceModelVecPool> Ptr;
+
+  IceModelVecPool(IceGrid::ConstPtr grid);
+  ~IceModelVecPool();
+
+  static Ptr shared(IceGrid::ConstPtr grid);
+
+  IceModelVec2S::Ptr scalar(const std::string &name,
+                            IceModelVecKind ghosted = WITHOUT_GHOSTS,
+                            unsigned int stencil_width = 1);
+
+  IceModelVec2V::Ptr vector(const std::string &name,
+                            IceModelVecKind ghosted = WITHOUT_GHOSTS,
+                            unsigned int stencil_width = 1);
+
+  IceModelVec2Int::Ptr integer(const std::string &name,
+                               IceModelVecKind ghosted = WITHOUT_GHOSTS,
+                               unsigned int stencil_width = 1);
+
+  IceModelVec2CellType::Ptr cell_type(const std::string &name,
+                                      IceModelVecKind ghosted = WITHOUT_GHOSTS,
+                                      unsigned int stencil_width = 1);
+
+  IceModelVec2Stag::Ptr staggered(const std::string &name,
+                                  IceModelVecKind ghosted = WITHOUT_GHOSTS,
+                                  unsigned int stencil_width = 1);
+
+  IceModelVec3::Ptr volume(const std::string &name,
+                           IceModelVecKind ghosted = WITHOUT_GHOSTS,
+                           unsigned int stencil_width = 1);
+
+  unsigned int n_idle() const;
+private:
+  struct Impl;
+  std::shared_ptr<Impl> m_impl;
+
+  template<class T>
+  typename T::Ptr get(const std::string &name, IceModelVecKind ghosted,
+                      unsigned int stencil_width);
+};
+
+} // end of namespace pism
+
+#endif /* PISM_ICEMODELVECPOOL_H */
@@ -0,0 +1,111 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+
+#include "pism/util/LevelMajorArray.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+LevelMajorArray::LevelMajorArray(IceGrid::ConstPtr grid, unsigned int n_levels,
+                                 unsigned int stencil_width)
+  : m_grid(grid), m_n_levels(n_levels), m_stencil_width(stencil_width) {
+
+  if (n_levels < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid number of levels: %d", n_levels);
+  }
+
+  m_x0 = grid->xs() - (int)stencil_width;
+  m_y0 = grid->ys() - (int)stencil_width;
+  m_nx = grid->xm() + 2 * stencil_width;
+  m_ny = grid->ym() + 2 * stencil_width;
+
+  m_data.resize(m_nx * m_ny * m_n_levels, 0.0);
+}
+
+unsigned int LevelMajorArray::n_levels() const {
+  return m_n_levels;
+}
+
+//! Distance between neighboring rows of a level.
+int LevelMajorArray::stride() const {
+  return m_nx;
+}
+
+//! Copy `input` (at owned grid points and ghosts, if present) to this array.
+/*!
+ * If `input` has fewer ghosts than this array, values at the remaining ghost points are
+ * not changed.
+ */
+void LevelMajorArray::copy_from(const IceModelVec3D &input) {
+  if (input.levels().size() != m_n_levels) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot copy %s (%d levels) to an array with %d levels",
+                                  input.get_name().c_str(), (int)input.levels().size(),
+                                  m_n_levels);
+  }
+
+  const int width = std::min(input.stencil_width(), m_stencil_width);
+
+  IceModelVec::AccessList list{&input};
+
+  for (PointsWithGhosts p(*m_grid, width); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double *column = input.get_column(i, j);
+    double *result = &m_data[offset(0, i, j)];
+
+    const size_t level_size = m_nx * m_ny;
+    for (unsigned int k = 0; k < m_n_levels; ++k) {
+      result[k * level_size] = column[k];
+    }
+  }
+}
+
+//! Copy values at owned grid points to `output`.
+void LevelMajorArray::copy_to(IceModelVec3D &output) const {
+  if (output.levels().size() != m_n_levels) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot copy an array with %d levels to %s (%d levels)",
+                                  m_n_levels, output.get_name().c_str(),
+                                  (int)output.levels().size());
+  }
+
+  IceModelVec::AccessList list{&output};
+
+  const size_t level_size = m_nx * m_ny;
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double *column = output.get_column(i, j);
+    const double *input = &m_data[offset(0, i, j)];
+
+    for (unsigned int k = 0; k < m_n_levels; ++k) {
+      column[k] = input[k * level_size];
+    }
+  }
+
+  output.inc_state_counter();
+}
+
+} // end of namespace pism
@@ -0,0 +1,85 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_LEVELMAJORARRAY_H
+#define PISM_LEVELMAJORARRAY_H
+
+#include <vector>
+
+#include "pism/util/IceGrid.hh"
+
+namespace pism {
+
+class IceModelVec3D;
+
+//! A copy of a 3D field stored level by level.
+/*!
+ * IceModelVec3 stores each column contiguously, which is what column solvers need.
+ * Kernels computing horizontal derivatives at every level access neighboring columns
+ * instead, i.e. memory locations `Mz` values apart. This class stores a copy of a 3D
+ * field (at owned grid points and `stencil_width` ghosts around them) so that each
+ * horizontal slice ("level") is contiguous and these kernels can stream through it.
+ *
+ * The transposition costs roughly as much as one pass over the field, so this pays off
+ * only if a field is used by several horizontal kernels (see `kernel_benchmarks`).
+ */
+class LevelMajorArray {
+public:
+  LevelMajorArray(IceGrid::ConstPtr grid, unsigned int n_levels, unsigned int stencil_width);
+
+  void copy_from(const IceModelVec3D &input);
+  void copy_to(IceModelVec3D &output) const;
+
+  unsigned int n_levels() const;
+  int stride() const;
+
+  //! Pointer to the value at (i, j) in the level `k`. Neighbors in the same level are at
+  //! offsets -1, +1 (west, east) and -stride(), +stride() (south, north).
+  double* level(unsigned int k, int i, int j) {
+    return &m_data[offset(k, i, j)];
+  }
+
+  const double* level(unsigned int k, int i, int j) const {
+    return &m_data[offset(k, i, j)];
+  }
+
+  double& operator()(int i, int j, unsigned int k) {
+    return m_data[offset(k, i, j)];
+  }
+
+  const double& operator()(int i, int j, unsigned int k) const {
+    return m_data[offset(k, i, j)];
+  }
+private:
+  size_t offset(unsigned int k, int i, int j) const {
+    return (k * m_ny + (j - m_y0)) * m_nx + (i - m_x0);
+  }
+
+  IceGrid::ConstPtr m_grid;
+  unsigned int m_n_levels;
+  unsigned int m_stencil_width;
+  //! the lower left corner and the size of the stored patch (including ghosts)
+  int m_x0, m_y0;
+  size_t m_nx, m_ny;
+  std::vector<double> m_data;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_LEVELMAJORARRAY_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2014, 2015, 2016, 2017, 2018 Constantine Khroulev and David Maxwell
+// Copyright (C) 2011, 2014, 2015, 2016, 2017, 2018, 2020 Constantine Khroulev and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -32,6 +32,47 @@ void GeometryCalculator::compute(const IceModelVec2S& sea_level,
   compute_surface(sea_level, bed, thickness, out_surface);
 }
 
+//! Compute cell types and surface elevations at `n` consecutive grid points.
+/*!
+ * Produces the same results as the point-wise compute(), but without branches in the
+ * loops over points, so that compilers can vectorize them. Cell types are stored as
+ * doubles (as in IceModelVec2Int). Either output can be NULL.
+ */
+void GeometryCalculator::compute(const double *sea_level, const double *bed,
+                                 const double *thickness, unsigned int n,
+                                 double *out_mask, double *out_surface) const {
+  const bool wet = not m_is_dry_simulation;
+
+  if (out_mask != NULL) {
+    for (unsigned int k = 0; k < n; ++k) {
+      const double
+        hgrounded = bed[k] + thickness[k],
+        hfloating = sea_level[k] + m_alpha * thickness[k];
+
+      const int
+        floating = (hfloating > hgrounded) & wet,
+        ice_free = thickness[k] <= m_icefree_thickness;
+
+      // MASK_GROUNDED (2) or MASK_FLOATING (3) if icy, MASK_ICE_FREE_BEDROCK (0) or
+      // MASK_ICE_FREE_OCEAN (4) if ice-free
+      out_mask[k] = ((1 - ice_free) * (MASK_GROUNDED + floating) +
+                     ice_free * (MASK_ICE_FREE_OCEAN * floating));
+    }
+  }
+
+  if (out_surface != NULL) {
+    for (unsigned int k = 0; k < n; ++k) {
+      const double
+        hgrounded = bed[k] + thickness[k],
+        hfloating = sea_level[k] + m_alpha * thickness[k];
+
+      const bool floating = (hfloating > hgrounded) & wet;
+
+      out_surface[k] = floating ? hfloating : hgrounded;
+    }
+  }
+}
+
 void GeometryCalculator::compute_mask(const IceModelVec2S &sea_level,
                                       const IceModelVec2S &bed,
                                       const IceModelVec2S &thickness,
@@ -45,11 +86,20 @@ void GeometryCalculator::compute_mask(const IceModelVec2S &sea_level,
   assert(bed.stencil_width()       >= stencil);
   assert(thickness.stencil_width() >= stencil);
 
-  for (PointsWithGhosts p(grid, stencil); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  // process rows of the sub-domain (including ghosts) owned by this rank
+  const int
+    w  = stencil,
+    i0 = grid.xs() - w,
+    j0 = grid.ys() - w,
+    j1 = grid.ys() + grid.ym() + w;
+  const unsigned int n = grid.xm() + 2 * w;
 
-    result(i,j) = this->mask(sea_level(i, j), bed(i, j), thickness(i, j));
+  for (int j = j0; j < j1; ++j) {
+    this->compute(&sea_level(i0, j), &bed(i0, j), &thickness(i0, j), n,
+                  &result(i0, j), NULL);
   }
+
+  result.inc_state_counter();
 }
 
 void GeometryCalculator::compute_surface(const IceModelVec2S &sea_level,
@@ -65,10 +115,16 @@ void GeometryCalculator::compute_surface(const IceModelVec2S &sea_level,
   assert(bed.stencil_width()       >= stencil);
   assert(thickness.stencil_width() >= stencil);
 
-  for (PointsWithGhosts p(grid, stencil); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  const int
+    w  = stencil,
+    i0 = grid.xs() - w,
+    j0 = grid.ys() - w,
+    j1 = grid.ys() + grid.ym() + w;
+  const unsigned int n = grid.xm() + 2 * w;
 
-    result(i,j) = this->surface(sea_level(i, j), bed(i, j), thickness(i, j));
+  for (int j = j0; j < j1; ++j) {
+    this->compute(&sea_level(i0, j), &bed(i0, j), &thickness(i0, j), n,
+                  NULL, &result(i0, j));
   }
 }
 
@@ -93,6 +93,9 @@ public:
   void compute_surface(const IceModelVec2S& sea_level, const IceModelVec2S& bed,
                        const IceModelVec2S& thickness, IceModelVec2S& result) const;
 
+  void compute(const double *sea_level, const double *bed, const double *thickness,
+               unsigned int n, double *out_mask, double *out_surface) const;
+
   inline void compute(double sea_level, double bed, double thickness,
                       int *out_mask, double *out_surface) const {
     const double hgrounded = bed + thickness; // FIXME issue #15
@@ -0,0 +1,142 @@
+/* Copyright (C) 2026 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::max
+
+#include "MemoryUsage.hh"
+#include "Logger.hh"
+#include "pism_utilities.hh"
+
+namespace pism {
+
+MemoryUsage::MemoryUsage() {
+  m_total = {0.0, 0.0};
+}
+
+//! Returns the current owner (owners set using nested MemoryOwner instances are
+//! separated by "/").
+std::string MemoryUsage::owner() const {
+  if (m_owners.empty()) {
+    return "other";
+  }
+  return join(m_owners, "/");
+}
+
+//! Add `bytes` (may be negative) to the memory used by `owner` for storage of type `kind`.
+void MemoryUsage::add(const std::string &owner, const std::string &kind, double bytes) const {
+  Usage &u = m_usage[{owner, kind}];
+
+  u.current += bytes;
+  u.peak = std::max(u.peak, u.current);
+
+  m_total.current += bytes;
+  m_total.peak = std::max(m_total.peak, m_total.current);
+}
+
+//! Print current and peak memory use (max per rank and total across ranks).
+/*!
+ * Collective.
+ */
+void MemoryUsage::report(MPI_Comm com, const Logger &log, const std::string &when) const {
+  std::vector<std::pair<std::string, std::string>> keys;
+  {
+    std::set<std::string> local;
+    for (const auto &u : m_usage) {
+      local.insert(u.first.first + "\t" + u.first.second);
+    }
+
+    for (const auto &k : GlobalUnion(com, local)) {
+      auto parts = split(k, '\t');
+      keys.push_back({parts[0], parts[1]});
+    }
+  }
+
+  const size_t N = keys.size() + 1;
+
+  // the last element contains the total
+  std::vector<double> current(N, 0.0), peak(N, 0.0);
+  for (size_t k = 0; k < keys.size(); ++k) {
+    auto u = m_usage.find(keys[k]);
+    if (u != m_usage.end()) {
+      current[k] = u->second.current;
+      peak[k]    = u->second.peak;
+    }
+  }
+  current[N - 1] = m_total.current;
+  peak[N - 1]    = m_total.peak;
+
+  std::vector<double> current_max(N), current_sum(N), peak_max(N);
+  GlobalMax(com, current.data(), current_max.data(), N);
+  GlobalSum(com, current.data(), current_sum.data(), N);
+  GlobalMax(com, peak.data(), peak_max.data(), N);
+
+  const double MiB = 1024.0 * 1024.0;
+
+  log.message(2, "\nMemory use (MiB) %s:\n", when.c_str());
+  log.message(2, "%-40s %-16s %12s %12s %12s\n",
+              "owner", "kind", "max/rank", "total", "peak/rank");
+
+  for (size_t k = 0; k < N; ++k) {
+    std::string
+      owner = k < keys.size() ? keys[k].first : "total",
+      kind  = k < keys.size() ? keys[k].second : "";
+
+    log.message(2, "%-40s %-16s %12.1f %12.1f %12.1f\n",
+                owner.c_str(), kind.c_str(),
+                current_max[k] / MiB, current_sum[k] / MiB, peak_max[k] / MiB);
+  }
+}
+
+MemoryOwner::MemoryOwner(const MemoryUsage &usage, const std::string &name)
+  : m_usage(usage) {
+  m_usage.m_owners.push_back(name);
+}
+
+MemoryOwner::~MemoryOwner() {
+  m_usage.m_owners.pop_back();
+}
+
+MemoryRecord::MemoryRecord()
+  : m_usage(nullptr), m_bytes(0.0) {
+  // empty
+}
+
+MemoryRecord::~MemoryRecord() {
+  if (m_usage != nullptr) {
+    m_usage->add(m_owner, m_kind, -m_bytes);
+  }
+}
+
+//! Set the amount of memory used by an object.
+/*!
+ * The owner is set during the first call, so this can be used to update the amount of
+ * memory used by an object allocated earlier.
+ */
+void MemoryRecord::set(const MemoryUsage &usage, const std::string &kind, double bytes) {
+  if (m_usage == nullptr) {
+    m_usage = &usage;
+    m_owner = usage.owner();
+    m_kind  = kind;
+  }
+
+  m_usage->add(m_owner, m_kind, bytes - m_bytes);
+  m_bytes = bytes;
+}
+
+} // end of namespace pism
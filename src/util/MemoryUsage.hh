@@ -0,0 +1,90 @@
+/* Copyright (C) 2026 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+namespace pism {
+
+class Logger;
+
+//! Keeps track of memory used by fields, rank 0 copies, solvers, and forcing buffers.
+/*!
+ * Memory is attributed to the "owner" set using MemoryOwner at the time of the
+ * allocation (for example, the component that was being allocated) and to a "kind" of
+ * storage. Use MemoryRecord to record an allocation.
+ */
+class MemoryUsage {
+public:
+  MemoryUsage();
+
+  std::string owner() const;
+
+  void add(const std::string &owner, const std::string &kind, double bytes) const;
+
+  void report(MPI_Comm com, const Logger &log, const std::string &when) const;
+private:
+  friend class MemoryOwner;
+
+  struct Usage {
+    double current;
+    double peak;
+  };
+
+  mutable std::vector<std::string> m_owners;
+  //! usage by (owner, kind)
+  mutable std::map<std::pair<std::string, std::string>, Usage> m_usage;
+  mutable Usage m_total;
+};
+
+//! Sets the owner of memory allocated while an instance of this class exists.
+class MemoryOwner {
+public:
+  MemoryOwner(const MemoryUsage &usage, const std::string &name);
+  ~MemoryOwner();
+private:
+  const MemoryUsage &m_usage;
+};
+
+//! Memory used by an object. Released in the destructor.
+class MemoryRecord {
+public:
+  MemoryRecord();
+  ~MemoryRecord();
+
+  void set(const MemoryUsage &usage, const std::string &kind, double bytes);
+private:
+  const MemoryUsage *m_usage;
+  std::string m_owner;
+  std::string m_kind;
+  double m_bytes;
+
+  // disable copying
+  MemoryRecord(const MemoryRecord &);
+  MemoryRecord& operator=(const MemoryRecord &);
+};
+
+} // end of namespace pism
+
+#endif /* MEMORYUSAGE_H */
@@ -0,0 +1,84 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>
+
+#include "pism/util/Philox.hh"
+
+namespace pism {
+
+Philox::Philox(uint64_t seed) {
+  m_key[0] = static_cast<uint32_t>(seed);
+  m_key[1] = static_cast<uint32_t>(seed >> 32);
+}
+
+//! Four uniformly distributed 32-bit integers corresponding to `counter`.
+Philox::Counter Philox::operator()(const Counter &counter) const {
+  const uint32_t
+    M0 = 0xD2511F53,
+    M1 = 0xCD9E8D57,
+    W0 = 0x9E3779B9,
+    W1 = 0xBB67AE85;
+
+  Counter c = counter;
+  uint32_t k0 = m_key[0], k1 = m_key[1];
+
+  for (int round = 0; round < 10; ++round) {
+    const uint64_t
+      p0 = static_cast<uint64_t>(M0) * c[0],
+      p1 = static_cast<uint64_t>(M1) * c[2];
+
+    const uint32_t
+      hi0 = static_cast<uint32_t>(p0 >> 32),
+      lo0 = static_cast<uint32_t>(p0),
+      hi1 = static_cast<uint32_t>(p1 >> 32),
+      lo1 = static_cast<uint32_t>(p1);
+
+    c = {hi1 ^ c[1] ^ k0, lo1, hi0 ^ c[3] ^ k1, lo0};
+
+    k0 += W0;
+    k1 += W1;
+  }
+
+  return c;
+}
+
+//! A sample from the standard normal distribution corresponding to `counter`.
+/*!
+ * Uses the Box-Muller transform of two uniformly distributed numbers with 53 random bits
+ * each.
+ */
+double Philox::gaussian(const Counter &counter) const {
+  Counter r = (*this)(counter);
+
+  const double scale = 1.0 / 9007199254740992.0; // 2^-53
+
+  const uint64_t
+    a = ((static_cast<uint64_t>(r[0]) << 32) | r[1]) >> 11,
+    b = ((static_cast<uint64_t>(r[2]) << 32) | r[3]) >> 11;
+
+  // u1 is in (0, 1), so the logarithm is finite
+  const double
+    u1 = (a + 0.5) * scale,
+    u2 = b * scale;
+
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+} // end of namespace pism
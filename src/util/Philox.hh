@@ -0,0 +1,53 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_PHILOX_H
+#define PISM_PHILOX_H
+
+#include <array>
+#include <cstdint>
+
+namespace pism {
+
+//! Counter-based pseudo-random number generator Philox4x32-10.
+/*!
+ * See J. K. Salmon, M. A. Moraes, R. O. Dror, and D. E. Shaw, "Parallel random numbers:
+ * as easy as 1, 2, 3", SC'11.
+ *
+ * A counter-based generator has no state: the output is a (bijective, for a given key)
+ * function of a 128-bit counter. Using a counter computed from the grid point and the
+ * time makes random numbers independent of the parallel domain decomposition and the
+ * order in which grid points are visited.
+ */
+class Philox {
+public:
+  typedef std::array<uint32_t, 4> Counter;
+
+  Philox(uint64_t seed);
+
+  Counter operator()(const Counter &counter) const;
+
+  double gaussian(const Counter &counter) const;
+private:
+  uint32_t m_key[2];
+};
+
+} // end of namespace pism
+
+#endif /* PISM_PHILOX_H */
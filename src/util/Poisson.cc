@@ -27,7 +27,9 @@ Poisson::Poisson(IceGrid::ConstPtr grid)
     m_log(grid->ctx()->log()),
     m_b(grid, "poisson_rhs", WITHOUT_GHOSTS),
     m_x(grid, "poisson_x", WITHOUT_GHOSTS),
-    m_mask(grid, "poisson_mask", WITH_GHOSTS){
+    m_mask(grid, "poisson_mask", WITH_GHOSTS),
+    m_mask_source(nullptr),
+    m_mask_state(-1) {
 
   m_da = m_x.dm();
 
@@ -46,6 +48,14 @@ Poisson::Poisson(IceGrid::ConstPtr grid)
     ierr = KSPSetOptionsPrefix(m_KSP, "poisson_");
     PISM_CHK(ierr, "KSPSetOptionsPrefix");
 
+    // Give the KSP access to the DMDA (used to build multigrid hierarchies), but use the
+    // matrix assembled here.
+    ierr = KSPSetDM(m_KSP, *m_da);
+    PISM_CHK(ierr, "KSPSetDM");
+
+    ierr = KSPSetDMActive(m_KSP, PETSC_FALSE);
+    PISM_CHK(ierr, "KSPSetDMActive");
+
     // Process options:
     ierr = KSPSetFromOptions(m_KSP);
     PISM_CHK(ierr, "KSPSetFromOptions");
@@ -58,14 +68,18 @@ Poisson::Poisson(IceGrid::ConstPtr grid)
  * with the constant right hand side `rhs`.
  *
  * Set the mask to 2 to use zero Neumann BC.
+ *
+ * The matrix is assembled only if `mask` differs from the one used by the previous call
+ * (a different object or a different state counter). If `reuse_matrix` is true the matrix
+ * is re-used regardless and the previous solution is used as the initial guess.
  */
 int Poisson::solve(const IceModelVec2Int& mask, const IceModelVec2S& bc, double rhs,
                    bool reuse_matrix) {
 
   PetscErrorCode ierr;
 
-  // make a ghosted copy of the mask
-  m_mask.copy_from(mask);
+  const bool mask_changed = (&mask != m_mask_source or
+                             mask.state_counter() != m_mask_state);
 
   if (reuse_matrix) {
     // Use non-zero initial guess. I assume that re-using the matrix means that the BC and
@@ -76,13 +90,24 @@ int Poisson::solve(const IceModelVec2Int& mask, const IceModelVec2S& bc, double
   } else {
     ierr = KSPSetInitialGuessNonzero(m_KSP, PETSC_FALSE);
     PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
+  }
 
-    assemble_matrix(m_mask, m_A);
+  if (mask_changed) {
+    // make a ghosted copy of the mask
+    m_mask.copy_from(mask);
+
+    if (not reuse_matrix) {
+      assemble_matrix(m_mask, m_A);
+
+      m_mask_source = &mask;
+      m_mask_state  = mask.state_counter();
+    }
   }
 
   assemble_rhs(rhs, m_mask, bc, m_b);
 
-  // Call PETSc to solve linear system by iterative method.
+  // Call PETSc to solve linear system by iterative method. Note that the preconditioner
+  // is re-built only if the matrix changed since the last call.
   ierr = KSPSetOperators(m_KSP, m_A, m_A);
   PISM_CHK(ierr, "KSPSetOperator");
 
@@ -211,10 +236,10 @@ void Poisson::assemble_matrix(const IceModelVec2Int &mask, Mat A) {
 
         // Use zero Neumann BC at edges of the computational domain
         {
-          N = j == My - 1 ? 0.0 : 1.0;
-          E = i == Mx - 1 ? 0.0 : 1.0;
-          W = i == 0      ? 0.0 : 1.0;
-          S = j == 0      ? 0.0 : 1.0;
+          N = j == My - 1 ? 0.0 : N;
+          E = i == Mx - 1 ? 0.0 : E;
+          W = i == 0      ? 0.0 : W;
+          S = j == 0      ? 0.0 : S;
         }
 
         // discretization of the Laplacian
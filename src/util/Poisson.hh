@@ -25,6 +25,17 @@
 
 namespace pism {
 
+/*!
+ * Solver for the Poisson equation on a domain defined by a mask.
+ *
+ * The matrix and the preconditioner are re-used as long as the mask passed to solve() is
+ * the same object and was not modified (according to its state counter), so repeated
+ * solves on the same domain only assemble the right hand side.
+ *
+ * Use PETSc options with the prefix `poisson_` to choose the solver. The KSP has access to
+ * the grid's DMDA, so `-poisson_pc_type mg -poisson_pc_mg_levels N -poisson_pc_mg_galerkin
+ * both` uses geometric multigrid; the hierarchy is built once and re-used by later solves.
+ */
 class Poisson {
 public:
   Poisson(IceGrid::ConstPtr grid);
@@ -48,6 +59,10 @@ private:
   IceModelVec2S m_b;
   IceModelVec2S m_x;
   IceModelVec2Int m_mask;
+
+  //! the mask used to assemble m_A and its state counter at that time
+  const IceModelVec2Int *m_mask_source;
+  int m_mask_state;
 };
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016 PISM Authors
+/* Copyright (C) 2015, 2016, 2026 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -18,26 +18,428 @@
  */
 
 #include <petscviewer.h>
+#include <algorithm>            // std::sort, std::min, std::max
+#include <cstdio>
+#include <limits>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>              // memset
+#include <cstdint>              // uint64_t
+#endif
 
 #include "Profiling.hh"
 #include "error_handling.hh"
+#include "Logger.hh"
+#include "pism_utilities.hh"
 
 namespace pism {
 
+//! The instance that records wait times (the one that was started last).
+static const Profiling *active_instance = NULL;
+
 // PETSc profiling events
 
-Profiling::Profiling() {
+Profiling::Profiling()
+  : m_enabled(false), m_tracing(false), m_step(-1), m_start_time(0.0) {
   PetscErrorCode ierr = PetscClassIdRegister("PISM", &m_classid);
   PISM_CHK(ierr, "PetscClassIdRegister");
 }
 
-//! Enable PETSc logging.
-void Profiling::start() const {
+Profiling::~Profiling() {
+  if (active_instance == this) {
+    active_instance = NULL;
+  }
+
+#if defined(__linux__)
+  for (int fd : m_counter_fds) {
+    close(fd);
+  }
+#endif
+}
+
+//! Returns true if some Profiling instance records wait times.
+bool Profiling::enabled() {
+  return active_instance != NULL;
+}
+
+//! Add `seconds` to the wait time of all events in progress.
+void Profiling::record_wait(double seconds) {
+  if (active_instance == NULL) {
+    return;
+  }
+
+  for (auto &s : active_instance->m_scopes) {
+    s.wait += seconds;
+  }
+}
+
+WaitTimer::WaitTimer()
+  : m_start(Profiling::enabled() ? MPI_Wtime() : 0.0) {
+  // empty
+}
+
+WaitTimer::~WaitTimer() {
+  if (Profiling::enabled()) {
+    Profiling::record_wait(MPI_Wtime() - m_start);
+  }
+}
+
+//! Enable PETSc logging and PISM's timers.
+/*!
+ * If `trace` is true, keep every event instance so that it can be saved using trace().
+ *
+ * If `counters` is true, record hardware performance counters (see start_counters()).
+ */
+void Profiling::start(bool trace, bool counters) const {
 #if PETSC_VERSION_LE(3,6,3)
   PetscErrorCode ierr = PetscLogBegin(); PISM_CHK(ierr, "PetscLogBegin");
 #else
   PetscErrorCode ierr = PetscLogAllBegin(); PISM_CHK(ierr, "PetscLogAllBegin");
 #endif
+
+  m_enabled    = true;
+  m_tracing    = trace;
+  m_start_time = MPI_Wtime();
+
+  if (counters) {
+    start_counters();
+  }
+
+  active_instance = this;
+}
+
+//! Names of hardware counters recorded by start_counters(), in this order.
+static const char *counter_names[] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+static const int n_counters = 4;
+
+//! Open hardware performance counters (Linux perf_event) of the calling thread.
+/*!
+ * Counters are opened as one group so that they are scheduled together. If the kernel
+ * does not allow this process to use them (see `/proc/sys/kernel/perf_event_paranoid`),
+ * counters are not recorded.
+ *
+ * Only the calling thread is counted: work done by other OpenMP threads is not included.
+ */
+void Profiling::start_counters() const {
+#if defined(__linux__)
+  const uint64_t events[] = {PERF_COUNT_HW_CPU_CYCLES,
+                             PERF_COUNT_HW_INSTRUCTIONS,
+                             PERF_COUNT_HW_CACHE_MISSES,
+                             PERF_COUNT_HW_BRANCH_MISSES};
+
+  for (int k = 0; k < n_counters; ++k) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = events[k];
+    attr.disabled       = (k == 0);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP;
+
+    int group = m_counter_fds.empty() ? -1 : m_counter_fds[0];
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+    if (fd < 0) {
+      for (int f : m_counter_fds) {
+        close(f);
+      }
+      m_counter_fds.clear();
+      return;
+    }
+    m_counter_fds.push_back(fd);
+  }
+
+  ioctl(m_counter_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(m_counter_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+//! Current values of hardware counters (empty if they are not recorded).
+std::vector<double> Profiling::read_counters() const {
+  std::vector<double> result;
+#if defined(__linux__)
+  if (m_counter_fds.empty()) {
+    return result;
+  }
+
+  // the number of counters followed by their values
+  uint64_t buffer[1 + n_counters];
+  if (read(m_counter_fds[0], buffer, sizeof(buffer)) == (ssize_t)sizeof(buffer)) {
+    result.assign(buffer + 1, buffer + 1 + n_counters);
+  } else {
+    result.assign(n_counters, 0.0);
+  }
+#endif
+  return result;
+}
+
+//! Set the time step number used to tag event instances saved by trace().
+void Profiling::set_step(int step) const {
+  m_step = step;
+}
+
+//! Time spent in each event on this rank so far (empty unless start() was called).
+std::map<std::string, double> Profiling::totals() const {
+  std::map<std::string, double> result;
+  for (const auto &t : m_timers) {
+    result[t.first] = t.second.total;
+  }
+  return result;
+}
+
+//! Split an event path into its components (used to sort events so that children
+//! follow their parents).
+static std::vector<std::string> path_components(const std::string &path) {
+  return split(path, '/');
+}
+
+//! Compute min, avg, and max (across ranks in `com`) of the time spent in each event.
+/*!
+ * Collective. Events that were not used on some ranks are included: min and avg are
+ * computed using ranks that used them.
+ *
+ * "wait" is the average time spent in MPI communication (including waiting for other
+ * ranks), "imbalance" is the ratio of the maximum to the average time spent computing.
+ */
+std::vector<Profiling::Statistics> Profiling::statistics(MPI_Comm com) const {
+  // names of events used on all ranks
+  std::vector<std::string> paths;
+  {
+    std::set<std::string> local;
+    for (const auto &t : m_timers) {
+      local.insert(t.first);
+    }
+
+    auto names = GlobalUnion(com, local);
+    paths = std::vector<std::string>(names.begin(), names.end());
+  }
+
+  std::sort(paths.begin(), paths.end(),
+            [](const std::string &a, const std::string &b) {
+              return path_components(a) < path_components(b);
+            });
+
+  const size_t N = paths.size();
+  if (N == 0) {
+    return {};
+  }
+
+  // local totals; events that were not used contribute to max and the number of ranks
+  // only
+  std::vector<double> min(N), max(N), sum(N), used(N), calls(N), wait(N), work(N);
+  for (size_t k = 0; k < N; ++k) {
+    auto t = m_timers.find(paths[k]);
+    if (t != m_timers.end()) {
+      min[k]   = t->second.total;
+      max[k]   = t->second.total;
+      sum[k]   = t->second.total;
+      used[k]  = 1.0;
+      calls[k] = t->second.calls;
+      wait[k]  = t->second.wait;
+      work[k]  = t->second.total - t->second.wait;
+    } else {
+      min[k]   = std::numeric_limits<double>::max();
+      max[k]   = 0.0;
+      sum[k]   = 0.0;
+      used[k]  = 0.0;
+      calls[k] = 0.0;
+      wait[k]  = 0.0;
+      work[k]  = 0.0;
+    }
+  }
+
+  std::vector<double> min_all(N), max_all(N), sum_all(N), used_all(N), calls_all(N),
+    wait_all(N), work_max(N), work_all(N);
+
+  GlobalMin(com, min.data(), min_all.data(), N);
+  GlobalMax(com, max.data(), max_all.data(), N);
+  GlobalSum(com, sum.data(), sum_all.data(), N);
+  GlobalSum(com, used.data(), used_all.data(), N);
+  GlobalMax(com, calls.data(), calls_all.data(), N);
+  GlobalSum(com, wait.data(), wait_all.data(), N);
+  GlobalMax(com, work.data(), work_max.data(), N);
+  GlobalSum(com, work.data(), work_all.data(), N);
+
+  std::vector<Statistics> result(N);
+  for (size_t k = 0; k < N; ++k) {
+    double avg_work = work_all[k] / used_all[k];
+
+    result[k].path      = paths[k];
+    result[k].calls     = calls_all[k];
+    result[k].min       = min_all[k];
+    result[k].avg       = sum_all[k] / used_all[k];
+    result[k].max       = max_all[k];
+    result[k].wait      = wait_all[k] / used_all[k];
+    result[k].imbalance = avg_work > 0.0 ? work_max[k] / avg_work : 1.0;
+  }
+
+  // hardware counters (ranks that could not open them contribute zeros)
+  if (GlobalMax(com, (double)m_counter_fds.size()) > 0.0) {
+    std::vector<double> counters(N * n_counters, 0.0), counters_all(N * n_counters);
+    for (size_t k = 0; k < N; ++k) {
+      auto t = m_timers.find(paths[k]);
+      if (t != m_timers.end() and not t->second.counters.empty()) {
+        std::copy(t->second.counters.begin(), t->second.counters.end(),
+                  counters.data() + k * n_counters);
+      }
+    }
+
+    GlobalSum(com, counters.data(), counters_all.data(), N * n_counters);
+
+    for (size_t k = 0; k < N; ++k) {
+      result[k].counters.assign(counters_all.data() + k * n_counters,
+                                counters_all.data() + (k + 1) * n_counters);
+    }
+  }
+
+  return result;
+}
+
+//! Print min, avg, and max (across ranks in `com`) of the time spent in each event.
+/*!
+ * Collective. See statistics().
+ */
+void Profiling::summary(MPI_Comm com, const Logger &log) const {
+  int size = 0;
+  MPI_Comm_size(com, &size);
+
+  auto stats = statistics(com);
+  if (stats.empty()) {
+    return;
+  }
+
+  log.message(1, "\nTime spent in PISM events (seconds, %d ranks):\n", size);
+  log.message(1, "%-50s %8s %12s %12s %12s %12s %10s\n",
+              "event", "calls", "min", "avg", "max", "wait", "imbalance");
+
+  for (const auto &s : stats) {
+    auto components = path_components(s.path);
+
+    std::string name = std::string(2 * (components.size() - 1), ' ') + components.back();
+
+    log.message(1, "%-50s %8d %12.4f %12.4f %12.4f %12.4f %10.2f\n",
+                name.c_str(), s.calls, s.min, s.avg, s.max, s.wait, s.imbalance);
+  }
+
+  if (stats[0].counters.empty()) {
+    return;
+  }
+
+  // Memory traffic is estimated as 64 bytes per last level cache miss. Instructions per
+  // byte of this traffic approximate the arithmetic intensity (the x coordinate of the
+  // roofline model); the bandwidth (sum over ranks) is the y coordinate of memory-bound
+  // kernels.
+  log.message(1, "\nHardware counters (sums over ranks, main thread only;"
+              " 64 bytes of memory traffic per cache miss):\n");
+  log.message(1, "%-50s %8s %12s %12s %12s %12s\n",
+              "event", "IPC", "LLC misses", "GB/s", "instr/byte", "br.miss/ki");
+
+  for (const auto &s : stats) {
+    auto components = path_components(s.path);
+
+    std::string name = std::string(2 * (components.size() - 1), ' ') + components.back();
+
+    const double
+      cycles        = s.counters[0],
+      instructions  = s.counters[1],
+      misses        = s.counters[2],
+      branch_misses = s.counters[3],
+      bytes         = 64.0 * misses;
+
+    log.message(1, "%-50s %8.2f %12.4g %12.3f %12.2f %12.3f\n",
+                name.c_str(),
+                cycles > 0.0 ? instructions / cycles : 0.0,
+                misses,
+                s.max > 0.0 ? bytes / s.max * 1e-9 : 0.0,
+                bytes > 0.0 ? instructions / bytes : 0.0,
+                instructions > 0.0 ? 1000.0 * branch_misses / instructions : 0.0);
+  }
+}
+
+//! Save statistics computed by statistics() to a JSON file (on rank 0 of `com`).
+/*!
+ * Collective. The file contains an object with the number of ranks and the list of
+ * events; each event is an object with keys "path", "calls", "min", "avg", "max",
+ * "wait", and "imbalance" (plus "cycles", "instructions", "llc_misses" and
+ * "branch_misses" if hardware counters were recorded).
+ */
+void Profiling::save_summary(MPI_Comm com, const std::string &filename) const {
+  int rank = 0, size = 0;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  auto stats = statistics(com);
+
+  if (rank != 0) {
+    return;
+  }
+
+  FILE *f = fopen(filename.c_str(), "w");
+  if (f == NULL) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to open '%s' for writing", filename.c_str());
+  }
+
+  fprintf(f, "{\"ranks\": %d,\n \"events\": [", size);
+  for (size_t k = 0; k < stats.size(); ++k) {
+    const auto &s = stats[k];
+    fprintf(f, "%s\n  {\"path\": \"%s\", \"calls\": %d, \"min\": %.6f, \"avg\": %.6f,"
+            " \"max\": %.6f, \"wait\": %.6f, \"imbalance\": %.4f",
+            k > 0 ? "," : "", s.path.c_str(), s.calls, s.min, s.avg, s.max, s.wait,
+            s.imbalance);
+    for (size_t c = 0; c < s.counters.size(); ++c) {
+      fprintf(f, ", \"%s\": %.0f", counter_names[c], s.counters[c]);
+    }
+    fprintf(f, "}");
+  }
+  fprintf(f, "\n ]}\n");
+  fclose(f);
+}
+
+//! Save event instances recorded on this rank in the Chrome trace (Perfetto) JSON format.
+/*!
+ * Use `chrome://tracing` or https://ui.perfetto.dev to view.
+ *
+ * Not collective: each rank writes its own file. If `filename` ends with ".json", the
+ * rank is added before the extension ("trace.json" becomes "trace-0.json"), otherwise
+ * "-RANK.json" is appended.
+ */
+void Profiling::trace(const std::string &filename, int rank) const {
+  std::string name = filename;
+  if (ends_with(name, ".json")) {
+    name.resize(name.size() - 5);
+  }
+  name += pism::printf("-%d.json", rank);
+
+  FILE *f = fopen(name.c_str(), "w");
+  if (f == NULL) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to open '%s' for writing", name.c_str());
+  }
+
+  fprintf(f, "{\"traceEvents\": [\n");
+  fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 0,"
+          " \"args\": {\"name\": \"rank %d\"}}", rank, rank);
+
+  for (const auto &s : m_samples) {
+    auto components = path_components(s.path);
+
+    // times are in microseconds
+    fprintf(f, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\","
+            " \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": 0,"
+            " \"args\": {\"step\": %d, \"path\": \"%s\"}}",
+            components.back().c_str(), components.front().c_str(),
+            (s.start - m_start_time) * 1e6, s.duration * 1e6, rank,
+            s.step, s.path.c_str());
+  }
+
+  fprintf(f, "\n]}\n");
+  fclose(f);
 }
 
 //! Save detailed profiling data to a Python script.
@@ -85,6 +487,11 @@ void Profiling::begin(const char * name) const {
   }
   ierr = PetscLogEventBegin(event, 0, 0, 0, 0);
   PISM_CHK(ierr, "PetscLogEventBegin");
+
+  if (m_enabled) {
+    std::string path = m_scopes.empty() ? name : m_scopes.back().path + "/" + name;
+    m_scopes.push_back({name, path, MPI_Wtime(), 0.0, read_counters()});
+  }
 }
 
 void Profiling::end(const char * name) const {
@@ -97,6 +504,63 @@ void Profiling::end(const char * name) const {
   }
   PetscErrorCode ierr = PetscLogEventEnd(event, 0, 0, 0, 0);
   PISM_CHK(ierr, "PetscLogEventEnd");
+
+  if (not m_enabled) {
+    return;
+  }
+
+  // Close scopes that were left open (by an exception, for example) until we find this
+  // one. Stop if it is not in the stack at all.
+  bool found = false;
+  for (const auto &s : m_scopes) {
+    found = found or s.name == name;
+  }
+
+  while (found and not m_scopes.empty()) {
+    Scope s = m_scopes.back();
+    m_scopes.pop_back();
+
+    double now = MPI_Wtime(), duration = now - s.start;
+
+    std::vector<double> counters = read_counters();
+    for (size_t k = 0; k < counters.size(); ++k) {
+      counters[k] -= s.counters[k];
+    }
+
+    auto t = m_timers.find(s.path);
+    if (t == m_timers.end()) {
+      m_timers[s.path] = {1, duration, s.wait, counters};
+    } else {
+      t->second.calls += 1;
+      t->second.total += duration;
+      t->second.wait  += s.wait;
+      for (size_t k = 0; k < counters.size(); ++k) {
+        t->second.counters[k] += counters[k];
+      }
+    }
+
+    if (m_tracing) {
+      m_samples.push_back({s.path, m_step, s.start, duration});
+    }
+
+    if (s.name == name) {
+      break;
+    }
+  }
+}
+
+//! End an event after waiting for all ranks in `com` to reach this point.
+/*!
+ * Collective. Use this at the end of events that all ranks go through to attribute the
+ * time ranks spend waiting for each other (due to load imbalance) to this event instead
+ * of the next event that communicates.
+ */
+void Profiling::end(const char *name, MPI_Comm com) const {
+  if (m_enabled) {
+    WaitTimer timer;
+    MPI_Barrier(com);
+  }
+  end(name);
 }
 
 void Profiling::stage_begin(const char * name) const {
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015 PISM Authors
+/* Copyright (C) 2015, 2026 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -22,23 +22,113 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <petsclog.h>
 
 namespace pism {
 
+class Logger;
+
+//! Profiling events and stages.
+/*!
+ * Events are registered with PETSc (see report()). In addition, once start() is called,
+ * this class keeps its own timers: an event started while another one is in progress is
+ * a child of that event, so "ksp" started within "ssa" within "stress_balance" is
+ * recorded as "stress_balance/ssa/ksp".
+ *
+ * Time spent in MPI communication (see WaitTimer) is recorded as the "wait" time of all
+ * events in progress.
+ *
+ * Call summary() to print min/avg/max (across ranks) of the time spent in each event,
+ * save_summary() to save the same in the JSON format, and trace() to save all event
+ * instances (tagged with time step numbers set using set_step()) in the Chrome trace
+ * (Perfetto) format.
+ *
+ * If start() is called with `counters == true`, hardware performance counters (CPU
+ * cycles, instructions, last level cache misses and branch misses) of the calling thread
+ * are recorded for each event using Linux perf_event (see summary()). Nothing is
+ * recorded otherwise.
+ */
 class Profiling {
 public:
   Profiling();
-  void start() const;
+  ~Profiling();
+  void start(bool trace = false, bool counters = false) const;
   void report(const std::string &filename) const;
+  void summary(MPI_Comm com, const Logger &log) const;
+  void save_summary(MPI_Comm com, const std::string &filename) const;
+  void trace(const std::string &filename, int rank) const;
   void begin(const char *name) const;
   void end(const char *name) const;
+  void end(const char *name, MPI_Comm com) const;
   void stage_begin(const char *name) const;
   void stage_end(const char *name) const;
+  void set_step(int step) const;
+  std::map<std::string, double> totals() const;
+
+  static bool enabled();
+  static void record_wait(double seconds);
 private:
+  struct Statistics {
+    std::string path;
+    int calls;
+    double min;
+    double avg;
+    double max;
+    double wait;
+    double imbalance;
+    //! hardware counters (sums over ranks; empty if not recorded)
+    std::vector<double> counters;
+  };
+  std::vector<Statistics> statistics(MPI_Comm com) const;
+
+  struct Timer {
+    int calls;
+    double total;
+    double wait;
+    std::vector<double> counters;
+  };
+  struct Scope {
+    std::string name;
+    std::string path;
+    double start;
+    double wait;
+    //! values of hardware counters at the beginning of the event
+    std::vector<double> counters;
+  };
+  struct Sample {
+    std::string path;
+    int step;
+    double start;
+    double duration;
+  };
+
   PetscClassId m_classid;
   mutable std::map<std::string, PetscLogEvent> m_events;
   mutable std::map<std::string, PetscLogStage> m_stages;
+
+  mutable bool m_enabled;
+  mutable bool m_tracing;
+  mutable int m_step;
+  mutable double m_start_time;
+  mutable std::vector<Scope> m_scopes;
+  mutable std::map<std::string, Timer> m_timers;
+  mutable std::vector<Sample> m_samples;
+
+  //! file descriptors of hardware counters (empty if counters are not recorded)
+  mutable std::vector<int> m_counter_fds;
+  void start_counters() const;
+  std::vector<double> read_counters() const;
+};
+
+//! Records the time between its construction and destruction as time spent waiting in
+//! MPI communication (if profiling is enabled).
+class WaitTimer {
+public:
+  WaitTimer();
+  ~WaitTimer();
+private:
+  double m_start;
 };
 
 } // end of namespace pism
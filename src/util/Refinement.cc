@@ -0,0 +1,299 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>                // std::sqrt, std::fabs
+#include <algorithm>            // std::min, std::max
+#include <cstdlib>              // std::abs
+
+#include "pism/util/Refinement.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+
+//! Flag cells that should be covered by refinement patches.
+/*!
+ * Flags
+ *
+ * - cells on either side of the grounding line (grounded ice next to floating ice and
+ *   vice versa),
+ * - calving fronts (icy cells next to ice-free ocean),
+ * - icy cells where the norm of the velocity gradient exceeds
+ *   `parameters.velocity_gradient_threshold`,
+ *
+ * then adds a buffer `parameters.buffer_width` cells wide around flagged cells.
+ *
+ * `cell_type` and `velocity` have to have ghosts (up to date). `result` has to have
+ * ghosts if the buffer width is positive.
+ */
+void flag_cells_for_refinement(const IceModelVec2CellType &cell_type,
+                               const IceModelVec2V &velocity,
+                               const RefinementParameters &parameters,
+                               IceModelVec2Int &result) {
+  IceGrid::ConstPtr grid = result.grid();
+
+  const double
+    dx        = grid->dx(),
+    dy        = grid->dy(),
+    threshold = parameters.velocity_gradient_threshold;
+
+  {
+    IceModelVec::AccessList list{&cell_type, &velocity, &result};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      bool grounding_line = ((cell_type.grounded_ice(i, j) and cell_type.next_to_floating_ice(i, j)) or
+                             (cell_type.floating_ice(i, j) and cell_type.next_to_grounded_ice(i, j)));
+
+      bool calving_front = cell_type.icy(i, j) and cell_type.next_to_ice_free_ocean(i, j);
+
+      bool shear = false;
+      if (threshold > 0.0 and cell_type.icy(i, j)) {
+        const double
+          u_x = (velocity(i + 1, j).u - velocity(i - 1, j).u) / (2.0 * dx),
+          u_y = (velocity(i, j + 1).u - velocity(i, j - 1).u) / (2.0 * dy),
+          v_x = (velocity(i + 1, j).v - velocity(i - 1, j).v) / (2.0 * dx),
+          v_y = (velocity(i, j + 1).v - velocity(i, j - 1).v) / (2.0 * dy);
+
+        shear = std::sqrt(u_x * u_x + u_y * u_y + v_x * v_x + v_y * v_y) > threshold;
+      }
+
+      result(i, j) = (grounding_line or calving_front or shear) ? 1.0 : 0.0;
+    }
+  }
+
+  if (parameters.buffer_width > 0 and result.stencil_width() < 1) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "refinement flags need ghosts to add a buffer around flagged cells");
+  }
+
+  // add the buffer, one cell at a time
+  std::vector<char> flagged(grid->xm() * grid->ym());
+  for (int n = 0; n < parameters.buffer_width; ++n) {
+    result.update_ghosts();
+
+    IceModelVec::AccessList list{&result};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      bool any = false;
+      for (int dj = -1; dj <= 1; ++dj) {
+        for (int di = -1; di <= 1; ++di) {
+          any = any or result.as_int(i + di, j + dj) > 0;
+        }
+      }
+      flagged[(j - grid->ys()) * grid->xm() + (i - grid->xs())] = any;
+    }
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      result(i, j) = flagged[(j - grid->ys()) * grid->xm() + (i - grid->xs())] ? 1.0 : 0.0;
+    }
+  }
+}
+
+//! Compute signatures of `patch`: numbers of flagged cells in each column (`columns`) and
+//! in each row (`rows`).
+static void signatures(const IceModelVec2Int &flags, const RefinementPatch &patch,
+                       std::vector<double> &columns, std::vector<double> &rows) {
+  const IceGrid &grid = *flags.grid();
+
+  const int
+    Nx = patch.i_last - patch.i_first + 1,
+    Ny = patch.j_last - patch.j_first + 1;
+
+  std::vector<double> local(Nx + Ny, 0.0), global(Nx + Ny, 0.0);
+
+  const int
+    i_first = std::max(grid.xs(), patch.i_first),
+    i_last  = std::min(grid.xs() + grid.xm() - 1, patch.i_last),
+    j_first = std::max(grid.ys(), patch.j_first),
+    j_last  = std::min(grid.ys() + grid.ym() - 1, patch.j_last);
+
+  IceModelVec::AccessList list{&flags};
+
+  for (int j = j_first; j <= j_last; ++j) {
+    for (int i = i_first; i <= i_last; ++i) {
+      if (flags.as_int(i, j) > 0) {
+        local[i - patch.i_first] += 1.0;
+        local[Nx + j - patch.j_first] += 1.0;
+      }
+    }
+  }
+
+  GlobalSum(grid.com, local.data(), global.data(), Nx + Ny);
+
+  columns.assign(global.begin(), global.begin() + Nx);
+  rows.assign(global.begin() + Nx, global.end());
+}
+
+//! Find the best place to split a patch with the signature `signature` into two parts at
+//! least `min_size` cells wide.
+/*!
+ * Returns the index (relative to the start of the patch) of the first cell of the second
+ * part or -1 if the patch cannot be split.
+ *
+ * Prefers a hole (a row or a column without flagged cells) closest to the middle, then the
+ * strongest inflection point of the signature, then the middle (see Berger and Rigoutsos,
+ * An algorithm for point clustering and grid generation, 1991).
+ */
+static int find_split(const std::vector<double> &signature, int min_size) {
+  const int N = signature.size();
+
+  if (N < 2 * min_size) {
+    return -1;
+  }
+
+  // splits between k - 1 and k for k in [min_size, N - min_size]
+  int hole = -1;
+  for (int k = min_size; k <= N - min_size; ++k) {
+    if (signature[k - 1] == 0.0 or signature[k] == 0.0) {
+      if (hole < 0 or std::abs(k - N / 2) < std::abs(hole - N / 2)) {
+        hole = k;
+      }
+    }
+  }
+  if (hole >= 0) {
+    return hole;
+  }
+
+  int inflection = -1;
+  double strength = 0.0;
+  for (int k = std::max(min_size, 2); k <= std::min(N - min_size, N - 2); ++k) {
+    const double
+      left  = signature[k - 2] - 2.0 * signature[k - 1] + signature[k],
+      right = signature[k - 1] - 2.0 * signature[k] + signature[k + 1];
+
+    if (left * right < 0.0 and std::fabs(left - right) > strength) {
+      inflection = k;
+      strength   = std::fabs(left - right);
+    }
+  }
+  if (inflection >= 0) {
+    return inflection;
+  }
+
+  return N / 2;
+}
+
+static void cluster(const IceModelVec2Int &flags, RefinementPatch patch,
+                    const RefinementParameters &parameters,
+                    std::vector<RefinementPatch> &result) {
+  std::vector<double> columns, rows;
+  signatures(flags, patch, columns, rows);
+
+  // shrink the patch to the bounding box of flagged cells (signatures of trimmed rows and
+  // columns are zero, so remaining signatures do not change)
+  int
+    i_first = 0,
+    i_last  = columns.size() - 1,
+    j_first = 0,
+    j_last  = rows.size() - 1;
+
+  while (i_first <= i_last and columns[i_first] == 0.0) {
+    i_first++;
+  }
+  if (i_first > i_last) {
+    return;                     // no flagged cells
+  }
+  while (columns[i_last] == 0.0) {
+    i_last--;
+  }
+  while (rows[j_first] == 0.0) {
+    j_first++;
+  }
+  while (rows[j_last] == 0.0) {
+    j_last--;
+  }
+
+  columns = std::vector<double>(columns.begin() + i_first, columns.begin() + i_last + 1);
+  rows    = std::vector<double>(rows.begin() + j_first, rows.begin() + j_last + 1);
+
+  patch.i_last   = patch.i_first + i_last;
+  patch.i_first += i_first;
+  patch.j_last   = patch.j_first + j_last;
+  patch.j_first += j_first;
+
+  double n_flagged = 0.0;
+  for (auto n : columns) {
+    n_flagged += n;
+  }
+
+  const double area = columns.size() * rows.size();
+  if (n_flagged >= parameters.efficiency * area) {
+    result.push_back(patch);
+    return;
+  }
+
+  // split the longer side first
+  const int
+    x_split = find_split(columns, parameters.min_patch_size),
+    y_split = find_split(rows, parameters.min_patch_size);
+
+  bool split_x = x_split >= 0 and (columns.size() >= rows.size() or y_split < 0);
+
+  if (split_x) {
+    RefinementPatch left = patch, right = patch;
+    left.i_last   = patch.i_first + x_split - 1;
+    right.i_first = patch.i_first + x_split;
+
+    cluster(flags, left, parameters, result);
+    cluster(flags, right, parameters, result);
+  } else if (y_split >= 0) {
+    RefinementPatch bottom = patch, top = patch;
+    bottom.j_last = patch.j_first + y_split - 1;
+    top.j_first   = patch.j_first + y_split;
+
+    cluster(flags, bottom, parameters, result);
+    cluster(flags, top, parameters, result);
+  } else {
+    // too small to split
+    result.push_back(patch);
+  }
+}
+
+//! Cover cells marked in `flags` with rectangular patches.
+/*!
+ * Uses the Berger-Rigoutsos algorithm: a patch is split until at least the fraction
+ * `parameters.efficiency` of its cells are flagged or its parts would be narrower than
+ * `parameters.min_patch_size`.
+ *
+ * Signatures of patches are computed using global sums, so all ranks get the same list of
+ * patches. This is a collective operation.
+ */
+std::vector<RefinementPatch> refinement_patches(const IceModelVec2Int &flags,
+                                                const RefinementParameters &parameters) {
+  const IceGrid &grid = *flags.grid();
+
+  std::vector<RefinementPatch> result;
+
+  RefinementPatch domain = {0, (int)grid.Mx() - 1, 0, (int)grid.My() - 1};
+
+  cluster(flags, domain, parameters, result);
+
+  return result;
+}
+
+} // end of namespace pism
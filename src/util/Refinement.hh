@@ -0,0 +1,61 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_REFINEMENT_H
+#define PISM_REFINEMENT_H
+
+#include <vector>
+
+namespace pism {
+
+class IceModelVec2Int;
+class IceModelVec2CellType;
+class IceModelVec2V;
+
+//! A rectangular block of grid points `[i_first, i_last] x [j_first, j_last]` (global
+//! indexes).
+struct RefinementPatch {
+  int i_first, i_last;
+  int j_first, j_last;
+};
+
+//! Parameters of refinement criteria and of clustering of flagged cells.
+struct RefinementParameters {
+  //! flag cells where the norm of the velocity gradient exceeds this (1/s); ignored if
+  //! not positive
+  double velocity_gradient_threshold;
+  //! width (in grid cells) of the buffer added around flagged cells
+  int buffer_width;
+  //! minimum fraction of flagged cells in a patch
+  double efficiency;
+  //! minimum width and height of a patch (in grid cells)
+  int min_patch_size;
+};
+
+void flag_cells_for_refinement(const IceModelVec2CellType &cell_type,
+                               const IceModelVec2V &velocity,
+                               const RefinementParameters &parameters,
+                               IceModelVec2Int &result);
+
+std::vector<RefinementPatch> refinement_patches(const IceModelVec2Int &flags,
+                                                const RefinementParameters &parameters);
+
+} // end of namespace pism
+
+#endif /* PISM_REFINEMENT_H */
@@ -0,0 +1,256 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <map>
+#include <algorithm>            // std::max, std::copy
+#include <petscdmda.h>
+
+#include "pism/util/SharedMemoryHaloExchange.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+struct SharedMemoryHaloExchange::Impl {
+  petsc::DM::Ptr dm;
+
+  MPI_Comm com;
+  //! communicator of ranks sharing a node with this one
+  MPI_Comm node_com;
+  MPI_Win window;
+
+  //! segment of the shared window owned by this rank: 9 slots (one per direction)
+  double *segment;
+  //! size of a slot, in doubles
+  int slot_size;
+
+  //! ranks of neighbors (in `com`) in the order (dx, dy) = (-1, -1), (0, -1), (1, -1),
+  //! (-1, 0), ... (1, 1) (see DMDAGetNeighbors())
+  int neighbors[9];
+  //! segments of neighbors on this node (NULL for neighbors on other nodes)
+  double *neighbor_segment[9];
+
+  //! number of degrees of freedom and the stencil width
+  int dof, width;
+  //! owned and ghosted sub-domains
+  int xs, ys, xm, ym, gxs, gys, gxm;
+
+  //! receive buffers (used for neighbors on other nodes)
+  std::vector<double> buffers[9];
+
+  //! Index range `[begin, end)` of owned (`ghost == false`) or ghost points adjacent to
+  //! the side `direction` (-1, 0, 1) of a sub-domain starting at `start` and containing
+  //! `size` points.
+  void range(int start, int size, int direction, bool ghost, int &begin, int &end) const {
+    if (direction == 0) {
+      begin = start;
+      end   = start + size;
+    } else if (direction < 0) {
+      begin = ghost ? start - width : start;
+      end   = begin + width;
+    } else {
+      begin = ghost ? start + size : start + size - width;
+      end   = begin + width;
+    }
+  }
+
+  //! Copy values between the local array `array` and the buffer `buffer` (`pack` is true
+  //! to copy from `array` to `buffer`). Returns the number of values copied.
+  int copy(int direction, bool ghost, bool pack, double *array, double *buffer) const {
+    int i_begin, i_end, j_begin, j_end;
+    range(xs, xm, direction % 3 - 1, ghost, i_begin, i_end);
+    range(ys, ym, direction / 3 - 1, ghost, j_begin, j_end);
+
+    const int row_length = (i_end - i_begin) * dof;
+
+    int n = 0;
+    for (int j = j_begin; j < j_end; ++j) {
+      double *row = array + ((j - gys) * gxm + (i_begin - gxs)) * dof;
+      if (pack) {
+        std::copy(row, row + row_length, buffer + n);
+      } else {
+        std::copy(buffer + n, buffer + n + row_length, row);
+      }
+      n += row_length;
+    }
+    return n;
+  }
+};
+
+SharedMemoryHaloExchange::SharedMemoryHaloExchange(petsc::DM::Ptr dm)
+  : m_impl(new Impl) {
+  PetscErrorCode ierr;
+
+  m_impl->dm = dm;
+
+  ierr = PetscObjectGetComm((PetscObject)(DM)*dm, &m_impl->com);
+  PISM_CHK(ierr, "PetscObjectGetComm");
+
+  PetscInt dof = 0, width = 0;
+  ierr = DMDAGetInfo(*dm, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &dof, &width,
+                     NULL, NULL, NULL, NULL);
+  PISM_CHK(ierr, "DMDAGetInfo");
+  m_impl->dof   = dof;
+  m_impl->width = width;
+
+  PetscInt xs, ys, xm, ym, gxs, gys, gxm, gym;
+  ierr = DMDAGetCorners(*dm, &xs, &ys, NULL, &xm, &ym, NULL);
+  PISM_CHK(ierr, "DMDAGetCorners");
+
+  ierr = DMDAGetGhostCorners(*dm, &gxs, &gys, NULL, &gxm, &gym, NULL);
+  PISM_CHK(ierr, "DMDAGetGhostCorners");
+
+  m_impl->xs  = xs;
+  m_impl->ys  = ys;
+  m_impl->xm  = xm;
+  m_impl->ym  = ym;
+  m_impl->gxs = gxs;
+  m_impl->gys = gys;
+  m_impl->gxm = gxm;
+
+  const PetscMPIInt *neighbors = NULL;
+  ierr = DMDAGetNeighbors(*dm, &neighbors);
+  PISM_CHK(ierr, "DMDAGetNeighbors");
+
+  int rank = 0;
+  MPI_Comm_rank(m_impl->com, &rank);
+  MPI_Comm_split_type(m_impl->com, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                      &m_impl->node_com);
+
+  // all slots have the same size so that ranks can find data in segments of neighbors
+  {
+    int slot_size = std::max(xm, ym) * width * dof;
+    MPI_Allreduce(&slot_size, &m_impl->slot_size, 1, MPI_INT, MPI_MAX, m_impl->com);
+  }
+
+  MPI_Win_allocate_shared(9 * m_impl->slot_size * sizeof(double), sizeof(double),
+                          MPI_INFO_NULL, m_impl->node_com, &m_impl->segment, &m_impl->window);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, m_impl->window);
+
+  MPI_Group group, node_group;
+  MPI_Comm_group(m_impl->com, &group);
+  MPI_Comm_group(m_impl->node_com, &node_group);
+
+  for (int n = 0; n < 9; ++n) {
+    m_impl->neighbors[n]        = neighbors[n];
+    m_impl->neighbor_segment[n] = NULL;
+
+    if (n == 4 or neighbors[n] < 0) {
+      continue;
+    }
+
+    int node_rank = MPI_UNDEFINED;
+    MPI_Group_translate_ranks(group, 1, &neighbors[n], node_group, &node_rank);
+
+    if (node_rank != MPI_UNDEFINED) {
+      MPI_Aint size = 0;
+      int disp_unit = 0;
+      MPI_Win_shared_query(m_impl->window, node_rank, &size, &disp_unit,
+                           &m_impl->neighbor_segment[n]);
+    } else {
+      int i_begin, i_end, j_begin, j_end;
+      m_impl->range(xs, xm, n % 3 - 1, true, i_begin, i_end);
+      m_impl->range(ys, ym, n / 3 - 1, true, j_begin, j_end);
+      m_impl->buffers[n].resize((i_end - i_begin) * (j_end - j_begin) * dof);
+    }
+  }
+
+  MPI_Group_free(&node_group);
+  MPI_Group_free(&group);
+}
+
+SharedMemoryHaloExchange::~SharedMemoryHaloExchange() {
+  MPI_Win_unlock_all(m_impl->window);
+  MPI_Win_free(&m_impl->window);
+  MPI_Comm_free(&m_impl->node_com);
+  delete m_impl;
+}
+
+//! Returns the instance used by all vectors using the DM `dm`.
+SharedMemoryHaloExchange::Ptr SharedMemoryHaloExchange::shared(petsc::DM::Ptr dm) {
+  static std::map<DM, std::weak_ptr<SharedMemoryHaloExchange> > instances;
+
+  auto result = instances[*dm].lock();
+  if (not result) {
+    result = std::make_shared<SharedMemoryHaloExchange>(dm);
+    instances[*dm] = result;
+  }
+  return result;
+}
+
+//! Update ghosts of the local vector `local` (created using the DM of this instance).
+void SharedMemoryHaloExchange::update(Vec local) {
+  PetscErrorCode ierr;
+
+  double *array = NULL;
+  ierr = VecGetArray(local, &array);
+  PISM_CHK(ierr, "VecGetArray");
+
+  Impl &m = *m_impl;
+
+  // pack values needed by neighbors
+  std::vector<MPI_Request> requests;
+  for (int n = 0; n < 9; ++n) {
+    if (n == 4 or m.neighbors[n] < 0) {
+      continue;
+    }
+
+    double *slot = m.segment + n * m.slot_size;
+    int size = m.copy(n, false, true, array, slot);
+
+    if (m.neighbor_segment[n] == NULL) {
+      // the neighbor is on a different node: send a message (the neighbor in the
+      // direction `n` expects data from the direction `8 - n`)
+      MPI_Request request;
+      MPI_Isend(slot, size, MPI_DOUBLE, m.neighbors[n], n, m.com, &request);
+      requests.push_back(request);
+
+      MPI_Irecv(m.buffers[n].data(), m.buffers[n].size(), MPI_DOUBLE, m.neighbors[n], 8 - n,
+                m.com, &request);
+      requests.push_back(request);
+    }
+  }
+
+  // make packed values visible to ranks on this node
+  MPI_Win_sync(m.window);
+  MPI_Barrier(m.node_com);
+  MPI_Win_sync(m.window);
+
+  // copy ghosts directly from segments of neighbors on this node
+  for (int n = 0; n < 9; ++n) {
+    if (m.neighbor_segment[n] != NULL) {
+      m.copy(n, true, false, array, m.neighbor_segment[n] + (8 - n) * m.slot_size);
+    }
+  }
+
+  MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+  for (int n = 0; n < 9; ++n) {
+    if (not m.buffers[n].empty()) {
+      m.copy(n, true, false, array, m.buffers[n].data());
+    }
+  }
+
+  // neighbors on this node are done reading this segment
+  MPI_Barrier(m.node_com);
+
+  ierr = VecRestoreArray(local, &array);
+  PISM_CHK(ierr, "VecRestoreArray");
+}
+
+} // end of namespace pism
@@ -0,0 +1,66 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_SHAREDMEMORYHALOEXCHANGE_H
+#define PISM_SHAREDMEMORYHALOEXCHANGE_H
+
+#include <memory>
+#include <vector>
+#include <mpi.h>
+#include <petscvec.h>
+
+#include "pism/util/petscwrappers/DM.hh"
+
+namespace pism {
+
+//! Node-aware update of ghosts of local (ghosted) vectors using a DMDA.
+/*!
+ * Each rank packs values adjacent to its neighbors into its segment of an MPI shared
+ * memory window (`MPI_Win_allocate_shared`) allocated on the communicator of ranks
+ * sharing a node. Neighbors on the same node copy ghost values straight from this
+ * segment after a barrier on the node communicator; only values sent to neighbors on
+ * other nodes go through MPI messages.
+ *
+ * The window is shared by all vectors using the same DM (see shared()), so an update
+ * is completed before the next one starts (update() is not split into begin and end).
+ *
+ * Requires MPI 3.
+ */
+class SharedMemoryHaloExchange {
+public:
+  typedef std::shared_ptr<SharedMemoryHaloExchange> Ptr;
+
+  SharedMemoryHaloExchange(petsc::DM::Ptr dm);
+  ~SharedMemoryHaloExchange();
+
+  static Ptr shared(petsc::DM::Ptr dm);
+
+  void update(Vec local);
+private:
+  struct Impl;
+  Impl *m_impl;
+
+  // disable copy constructor and the assignment operator:
+  SharedMemoryHaloExchange(const SharedMemoryHaloExchange &other);
+  SharedMemoryHaloExchange& operator=(const SharedMemoryHaloExchange&);
+};
+
+} // end of namespace pism
+
+#endif /* PISM_SHAREDMEMORYHALOEXCHANGE_H */
@@ -0,0 +1,100 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cassert>
+
+#include "pism/util/SinglePrecisionColumns.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+SinglePrecisionColumns::SinglePrecisionColumns(IceGrid::ConstPtr grid, unsigned int n_levels)
+  : m_grid(grid), m_n_levels(n_levels) {
+
+  if (n_levels < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid number of levels: %d", n_levels);
+  }
+
+  m_data.resize(static_cast<size_t>(grid->xm()) * grid->ym() * n_levels, 0.0f);
+}
+
+unsigned int SinglePrecisionColumns::n_levels() const {
+  return m_n_levels;
+}
+
+//! Offset of the column at (i, j) in `m_data`.
+size_t SinglePrecisionColumns::offset(int i, int j) const {
+  assert(i >= m_grid->xs() and i < m_grid->xs() + m_grid->xm());
+  assert(j >= m_grid->ys() and j < m_grid->ys() + m_grid->ym());
+
+  const size_t
+    xm = m_grid->xm(),
+    i0 = i - m_grid->xs(),
+    j0 = j - m_grid->ys();
+
+  return (j0 * xm + i0) * m_n_levels;
+}
+
+//! Get the column at (i, j), converting to double precision.
+void SinglePrecisionColumns::get_column(int i, int j, double *result) const {
+  const float *column = &m_data[offset(i, j)];
+  for (unsigned int k = 0; k < m_n_levels; ++k) {
+    result[k] = column[k];
+  }
+}
+
+//! Set the column at (i, j), rounding to single precision.
+void SinglePrecisionColumns::set_column(int i, int j, const double *input) {
+  float *column = &m_data[offset(i, j)];
+  for (unsigned int k = 0; k < m_n_levels; ++k) {
+    column[k] = static_cast<float>(input[k]);
+  }
+}
+
+//! Set all values in the column at (i, j) to `value`.
+void SinglePrecisionColumns::set_column(int i, int j, double value) {
+  float *column = &m_data[offset(i, j)];
+  for (unsigned int k = 0; k < m_n_levels; ++k) {
+    column[k] = static_cast<float>(value);
+  }
+}
+
+//! Copy all columns to `output` (values at ghost points of `output` are not changed).
+void SinglePrecisionColumns::copy_to(IceModelVec3 &output) const {
+  if (output.levels().size() != m_n_levels) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot copy %d levels to %s (%d levels)",
+                                  m_n_levels, output.get_name().c_str(),
+                                  (int)output.levels().size());
+  }
+
+  IceModelVec::AccessList list{&output};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    get_column(i, j, output.get_column(i, j));
+  }
+
+  output.inc_state_counter();
+}
+
+} // end of namespace pism
@@ -0,0 +1,61 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_SINGLEPRECISIONCOLUMNS_H
+#define PISM_SINGLEPRECISIONCOLUMNS_H
+
+#include <vector>
+
+#include "pism/util/IceGrid.hh"
+
+namespace pism {
+
+class IceModelVec3;
+
+//! Columns of values at grid points owned by this rank, stored in single precision.
+/*!
+ * This is a work array for 3D fields that do not need ghosts, I/O or PETSc: values are
+ * stored as `float` (halving the memory footprint and the memory bandwidth needed to
+ * access them compared to IceModelVec3) and converted to and from `double` when a column
+ * is accessed, so all computations are done in double precision.
+ *
+ * Columns are stored contiguously and in the same order as in IceModelVec3.
+ */
+class SinglePrecisionColumns {
+public:
+  SinglePrecisionColumns(IceGrid::ConstPtr grid, unsigned int n_levels);
+
+  unsigned int n_levels() const;
+
+  void get_column(int i, int j, double *result) const;
+  void set_column(int i, int j, const double *input);
+  void set_column(int i, int j, double value);
+
+  void copy_to(IceModelVec3 &output) const;
+private:
+  size_t offset(int i, int j) const;
+
+  IceGrid::ConstPtr m_grid;
+  unsigned int m_n_levels;
+  std::vector<float> m_data;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_SINGLEPRECISIONCOLUMNS_H */
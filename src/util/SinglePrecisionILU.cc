@@ -0,0 +1,225 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <petscmat.h>
+
+#include "SinglePrecisionILU.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+SinglePrecisionILU::SinglePrecisionILU() {
+  // empty
+}
+
+//! Make `pc` use this preconditioner.
+void SinglePrecisionILU::configure(PC pc) {
+  PetscErrorCode ierr;
+
+  ierr = PCSetType(pc, PCSHELL);
+  PISM_CHK(ierr, "PCSetType");
+
+  ierr = PCShellSetContext(pc, this);
+  PISM_CHK(ierr, "PCShellSetContext");
+
+  ierr = PCShellSetSetUp(pc, set_up_callback);
+  PISM_CHK(ierr, "PCShellSetSetUp");
+
+  ierr = PCShellSetApply(pc, apply_callback);
+  PISM_CHK(ierr, "PCShellSetApply");
+
+  ierr = PCShellSetName(pc, "block Jacobi, single precision ILU(0)");
+  PISM_CHK(ierr, "PCShellSetName");
+}
+
+//! Compute ILU(0) factors of the diagonal block of `A` owned by this rank.
+void SinglePrecisionILU::set_up(Mat A) {
+  PetscErrorCode ierr;
+
+  Mat A_local = NULL;
+  ierr = MatGetDiagonalBlock(A, &A_local);
+  PISM_CHK(ierr, "MatGetDiagonalBlock");
+
+  // copy the diagonal block, converting values to single precision
+  {
+    PetscInt n = 0;
+    const PetscInt *ia = NULL, *ja = NULL;
+    PetscBool done = PETSC_FALSE;
+    ierr = MatGetRowIJ(A_local, 0, PETSC_FALSE, PETSC_FALSE, &n, &ia, &ja, &done);
+    PISM_CHK(ierr, "MatGetRowIJ");
+
+    if (not done) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "single precision ILU requires an AIJ matrix");
+    }
+
+    const PetscScalar *a = NULL;
+    ierr = MatSeqAIJGetArrayRead(A_local, &a);
+    PISM_CHK(ierr, "MatSeqAIJGetArrayRead");
+
+    m_row.assign(ia, ia + n + 1);
+    m_column.assign(ja, ja + ia[n]);
+    m_values.assign(a, a + ia[n]);
+
+    ierr = MatSeqAIJRestoreArrayRead(A_local, &a);
+    PISM_CHK(ierr, "MatSeqAIJRestoreArrayRead");
+
+    ierr = MatRestoreRowIJ(A_local, 0, PETSC_FALSE, PETSC_FALSE, &n, &ia, &ja, &done);
+    PISM_CHK(ierr, "MatRestoreRowIJ");
+  }
+
+  const int n = m_row.size() - 1;
+
+  m_diagonal.resize(n);
+  for (int i = 0; i < n; ++i) {
+    m_diagonal[i] = -1;
+    for (int p = m_row[i]; p < m_row[i + 1]; ++p) {
+      if (m_column[p] == i) {
+        m_diagonal[i] = p;
+        break;
+      }
+    }
+    if (m_diagonal[i] < 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "single precision ILU: missing diagonal entry in row %d", i);
+    }
+  }
+
+  // ILU(0) factorization ("IKJ" variant): the sparsity pattern of L + U is the pattern of
+  // the matrix. Column indexes in each row are sorted.
+  std::vector<int> position(n, -1);
+  for (int i = 0; i < n; ++i) {
+    for (int p = m_row[i]; p < m_row[i + 1]; ++p) {
+      position[m_column[p]] = p;
+    }
+
+    for (int p = m_row[i]; p < m_diagonal[i]; ++p) {
+      const int k = m_column[p];
+
+      m_values[p] /= m_values[m_diagonal[k]];
+      const float L_ik = m_values[p];
+
+      for (int q = m_diagonal[k] + 1; q < m_row[k + 1]; ++q) {
+        const int r = position[m_column[q]];
+        if (r >= 0) {
+          m_values[r] -= L_ik * m_values[q];
+        }
+      }
+    }
+
+    if (m_values[m_diagonal[i]] == 0.0f) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "single precision ILU: zero pivot in row %d", i);
+    }
+
+    for (int p = m_row[i]; p < m_row[i + 1]; ++p) {
+      position[m_column[p]] = -1;
+    }
+  }
+
+  m_work.resize(n);
+}
+
+//! Compute `y = U^{-1} L^{-1} x`.
+/*!
+ * Factors and intermediate values are stored in single precision; sums are accumulated in
+ * double precision.
+ */
+void SinglePrecisionILU::apply(Vec x, Vec y) const {
+  PetscErrorCode ierr;
+
+  const PetscScalar *X = NULL;
+  ierr = VecGetArrayRead(x, &X);
+  PISM_CHK(ierr, "VecGetArrayRead");
+
+  PetscScalar *Y = NULL;
+  ierr = VecGetArray(y, &Y);
+  PISM_CHK(ierr, "VecGetArray");
+
+  const int n = m_work.size();
+  float *w = m_work.data();
+
+  // forward substitution (L has the unit diagonal)
+  for (int i = 0; i < n; ++i) {
+    double s = X[i];
+    for (int p = m_row[i]; p < m_diagonal[i]; ++p) {
+      s -= m_values[p] * w[m_column[p]];
+    }
+    w[i] = s;
+  }
+
+  // back substitution
+  for (int i = n - 1; i >= 0; --i) {
+    double s = w[i];
+    for (int p = m_diagonal[i] + 1; p < m_row[i + 1]; ++p) {
+      s -= m_values[p] * w[m_column[p]];
+    }
+    s /= m_values[m_diagonal[i]];
+
+    w[i] = s;
+    Y[i] = s;
+  }
+
+  ierr = VecRestoreArray(y, &Y);
+  PISM_CHK(ierr, "VecRestoreArray");
+
+  ierr = VecRestoreArrayRead(x, &X);
+  PISM_CHK(ierr, "VecRestoreArrayRead");
+}
+
+//! Memory used by factors, in bytes.
+double SinglePrecisionILU::memory() const {
+  return (m_values.size() * sizeof(float) + m_work.size() * sizeof(float) +
+          (m_row.size() + m_column.size() + m_diagonal.size()) * sizeof(int));
+}
+
+PetscErrorCode SinglePrecisionILU::set_up_callback(PC pc) {
+  try {
+    void *ctx = NULL;
+    PetscErrorCode ierr = PCShellGetContext(pc, &ctx); CHKERRQ(ierr);
+
+    Mat A = NULL, P = NULL;
+    ierr = PCGetOperators(pc, &A, &P); CHKERRQ(ierr);
+
+    reinterpret_cast<SinglePrecisionILU*>(ctx)->set_up(P);
+  } catch (...) {
+    MPI_Comm com = MPI_COMM_SELF;
+    PetscErrorCode ierr = PetscObjectGetComm((PetscObject)pc, &com); CHKERRQ(ierr);
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+PetscErrorCode SinglePrecisionILU::apply_callback(PC pc, Vec x, Vec y) {
+  try {
+    void *ctx = NULL;
+    PetscErrorCode ierr = PCShellGetContext(pc, &ctx); CHKERRQ(ierr);
+
+    reinterpret_cast<SinglePrecisionILU*>(ctx)->apply(x, y);
+  } catch (...) {
+    MPI_Comm com = MPI_COMM_SELF;
+    PetscErrorCode ierr = PetscObjectGetComm((PetscObject)pc, &com); CHKERRQ(ierr);
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+} // end of namespace pism
@@ -0,0 +1,65 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_SINGLEPRECISIONILU_H
+#define PISM_SINGLEPRECISIONILU_H
+
+#include <vector>
+#include <petscpc.h>
+
+namespace pism {
+
+//! Block Jacobi preconditioner (one block per rank) using ILU(0) factors stored in single
+//! precision.
+/*!
+ * This is the same preconditioner as PETSc's default `-pc_type bjacobi -sub_pc_type
+ * ilu`, except that the factors of the diagonal block are computed from a single
+ * precision copy of the matrix and stored in single precision. Applying the
+ * preconditioner is limited by memory bandwidth, so this halves the cost of reading the
+ * factors (and the memory they use). The Krylov method using this preconditioner works
+ * in double precision, so the accuracy of the solution is not affected.
+ *
+ * Use configure() to make a PETSc PC use an instance of this class (PCSHELL). The
+ * instance has to outlive the PC.
+ */
+class SinglePrecisionILU {
+public:
+  SinglePrecisionILU();
+
+  void configure(PC pc);
+
+  void set_up(Mat A);
+
+  void apply(Vec x, Vec y) const;
+
+  double memory() const;
+private:
+  static PetscErrorCode set_up_callback(PC pc);
+  static PetscErrorCode apply_callback(PC pc, Vec x, Vec y);
+
+  //! factors L (without the unit diagonal) and U in compressed sparse row format
+  std::vector<int> m_row, m_column, m_diagonal;
+  std::vector<float> m_values;
+  //! work space used by apply()
+  mutable std::vector<float> m_work;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_SINGLEPRECISIONILU_H */
@@ -0,0 +1,129 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::min, std::max
+#include <petscao.h>
+
+#include "pism/util/SlabScatter.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/IS.hh"
+
+namespace pism {
+
+SlabScatter::SlabScatter(const IceModelVec2S &field, int Ny, int slab_start, int slab_size,
+                         int i0, int j0)
+  : m_da(field.dm()), m_Ny(Ny), m_i0(i0), m_j0(j0), m_slab_start(slab_start) {
+
+  const IceGrid &grid = *field.grid();
+
+  const int Mx = grid.Mx();
+  m_My = grid.My();
+
+  m_i_start = std::max(0, slab_start - i0);
+  m_i_end   = std::min(Mx, slab_start + slab_size - i0);
+  m_i_end   = std::max(m_i_start, m_i_end);
+
+  const int N = (m_i_end - m_i_start) * m_My;
+
+  // indices of the values this rank needs, using the natural ordering...
+  std::vector<PetscInt> indices(N);
+  for (int i = m_i_start; i < m_i_end; ++i) {
+    for (int j = 0; j < m_My; ++j) {
+      indices[(i - m_i_start) * m_My + j] = i + Mx * j;
+    }
+  }
+
+  PetscErrorCode ierr = 0;
+
+  // ... converted to PETSc's ordering
+  AO ao = NULL;
+  ierr = DMDAGetAO(*m_da, &ao);
+  PISM_CHK(ierr, "DMDAGetAO");
+
+  ierr = AOApplicationToPetsc(ao, N, indices.data());
+  PISM_CHK(ierr, "AOApplicationToPetsc");
+
+  ierr = DMCreateGlobalVector(*m_da, m_global.rawptr());
+  PISM_CHK(ierr, "DMCreateGlobalVector");
+
+  ierr = VecCreateSeq(PETSC_COMM_SELF, N, m_local.rawptr());
+  PISM_CHK(ierr, "VecCreateSeq");
+
+  petsc::IS is;
+  ierr = ISCreateGeneral(PETSC_COMM_SELF, N, indices.data(), PETSC_COPY_VALUES,
+                         is.rawptr());
+  PISM_CHK(ierr, "ISCreateGeneral");
+
+  ierr = VecScatterCreate(m_global, is, m_local, NULL, m_scatter.rawptr());
+  PISM_CHK(ierr, "VecScatterCreate");
+}
+
+void SlabScatter::set_real_part(const IceModelVec2S &input, double normalization,
+                                fftw_complex *output) {
+  PetscErrorCode ierr = 0;
+
+  input.copy_to_vec(m_da, m_global);
+
+  ierr = VecScatterBegin(m_scatter, m_global, m_local, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(m_scatter, m_global, m_local, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterEnd");
+
+  petsc::VecArray in(m_local);
+  const double *x = in.get();
+
+  for (int i = m_i_start; i < m_i_end; ++i) {
+    for (int j = 0; j < m_My; ++j) {
+      const int k = (m_i0 + i - m_slab_start) * m_Ny + (m_j0 + j);
+
+      output[k][0] = normalization * x[(i - m_i_start) * m_My + j];
+      output[k][1] = 0.0;
+    }
+  }
+}
+
+void SlabScatter::get_real_part(const fftw_complex *input, double normalization,
+                                IceModelVec2S &output) {
+  PetscErrorCode ierr = 0;
+
+  {
+    petsc::VecArray out(m_local);
+    double *x = out.get();
+
+    for (int i = m_i_start; i < m_i_end; ++i) {
+      for (int j = 0; j < m_My; ++j) {
+        const int k = (m_i0 + i - m_slab_start) * m_Ny + (m_j0 + j);
+
+        x[(i - m_i_start) * m_My + j] = normalization * input[k][0];
+      }
+    }
+  }
+
+  ierr = VecScatterBegin(m_scatter, m_local, m_global, INSERT_VALUES, SCATTER_REVERSE);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(m_scatter, m_local, m_global, INSERT_VALUES, SCATTER_REVERSE);
+  PISM_CHK(ierr, "VecScatterEnd");
+
+  output.copy_from_vec(m_global);
+}
+
+} // end of namespace pism
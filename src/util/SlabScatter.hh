@@ -0,0 +1,70 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_SLABSCATTER_H
+#define PISM_SLABSCATTER_H
+
+#include <fftw3.h>
+
+#include "pism/util/petscwrappers/DM.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
+
+namespace pism {
+
+class IceModelVec2S;
+
+//! Moves data between a distributed 2D field and a slab-decomposed FFTW array.
+/*!
+ * The field (size Mx*My) is embedded in the extended grid (size Nx*Ny) at offsets
+ * (i0, j0). Each rank owns the rows [slab_start, slab_start + slab_size) of the extended
+ * grid (all values in the Y direction) and receives the part of the field that falls
+ * into these rows.
+ */
+class SlabScatter {
+public:
+  SlabScatter(const IceModelVec2S &field, int Ny, int slab_start, int slab_size,
+              int i0, int j0);
+
+  //! Set the real part of `output` to `normalization * input`. Sets the imaginary part to
+  //! zero. Does not touch values outside of the area covered by the field.
+  void set_real_part(const IceModelVec2S &input, double normalization,
+                     fftw_complex *output);
+
+  //! Get the real part of `input`, multiply it by `normalization` and put it in `output`.
+  void get_real_part(const fftw_complex *input, double normalization,
+                     IceModelVec2S &output);
+private:
+  petsc::DM::Ptr m_da;
+  //! work space using PETSc's ordering
+  petsc::Vec m_global;
+  //! part of the field owned by this rank in the slab decomposition
+  petsc::Vec m_local;
+  petsc::VecScatter m_scatter;
+
+  int m_My, m_Ny;
+  int m_i0, m_j0;
+  int m_slab_start;
+  //! range of field rows in this rank's slab
+  int m_i_start, m_i_end;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_SLABSCATTER_H */
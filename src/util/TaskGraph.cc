@@ -0,0 +1,93 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::max
+
+#include "TaskGraph.hh"
+#include "pism_utilities.hh"    // join, printf
+
+namespace pism {
+
+//! Returns true if sets `a` and `b` have a common element.
+static bool intersect(const std::set<std::string> &a, const std::set<std::string> &b) {
+  for (const auto &x : a) {
+    if (b.find(x) != b.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//! Add a task reading `inputs` and modifying `outputs`.
+void TaskGraph::add(const std::string &name,
+                    const std::set<std::string> &inputs,
+                    const std::set<std::string> &outputs,
+                    const Task &task) {
+  int stage = 0;
+  for (const auto &n : m_nodes) {
+    if (intersect(inputs, n.outputs) or   // read after write
+        intersect(outputs, n.inputs) or   // write after read
+        intersect(outputs, n.outputs)) {  // write after write
+      stage = std::max(stage, n.stage + 1);
+    }
+  }
+
+  m_nodes.push_back({name, inputs, outputs, task, stage});
+}
+
+int TaskGraph::n_stages() const {
+  int result = 0;
+  for (const auto &n : m_nodes) {
+    result = std::max(result, n.stage + 1);
+  }
+  return result;
+}
+
+//! Names of tasks in each stage. Tasks in the same stage are independent.
+std::vector<std::vector<std::string> > TaskGraph::stages() const {
+  std::vector<std::vector<std::string> > result(n_stages());
+  for (const auto &n : m_nodes) {
+    result[n.stage].push_back(n.name);
+  }
+  return result;
+}
+
+//! Human-readable list of stages, one per line.
+std::string TaskGraph::description() const {
+  std::string result;
+  int k = 0;
+  for (const auto &s : stages()) {
+    result += pism::printf("  stage %d: %s\n", k, join(s, ", ").c_str());
+    ++k;
+  }
+  return result;
+}
+
+//! Run all tasks sequentially, in the order they were added.
+/*!
+ * Tasks use collective operations, so all ranks have to run them in the same order.
+ * Stages only document data dependencies.
+ */
+void TaskGraph::run() const {
+  for (const auto &n : m_nodes) {
+    n.task();
+  }
+}
+
+} // end of namespace pism
@@ -0,0 +1,72 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_TASKGRAPH_H
+#define PISM_TASKGRAPH_H
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace pism {
+
+//! A list of tasks with declared inputs and outputs, grouped into stages of independent
+//! tasks.
+/*!
+ * Tasks are added in the order in which they would be run sequentially. Each task
+ * declares the names of the fields it reads and modifies. A task depends on an earlier
+ * task if it reads a field the earlier one modifies, modifies a field the earlier one
+ * reads, or if both modify the same field.
+ *
+ * A task is placed in the stage immediately after the latest stage containing a task it
+ * depends on, so tasks in the same stage do not depend on each other *provided that all
+ * inputs and outputs are declared*. run() runs tasks sequentially, in the order they
+ * were added, so the results do not depend on the correctness of declared dependencies.
+ */
+class TaskGraph {
+public:
+  typedef std::function<void()> Task;
+
+  void add(const std::string &name,
+           const std::set<std::string> &inputs,
+           const std::set<std::string> &outputs,
+           const Task &task);
+
+  std::vector<std::vector<std::string> > stages() const;
+
+  std::string description() const;
+
+  void run() const;
+private:
+  struct Node {
+    std::string name;
+    std::set<std::string> inputs, outputs;
+    Task task;
+    int stage;
+  };
+
+  int n_stages() const;
+
+  std::vector<Node> m_nodes;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_TASKGRAPH_H */
@@ -19,6 +19,8 @@
 #include <cassert>
 #include <sstream>
 #include <cstdlib>
+#include <cmath>
+#include <algorithm>
 #include <petscsys.h>
 
 #include "error_handling.hh"
@@ -60,7 +62,8 @@ Time_Calendar::Time_Calendar(MPI_Comm c, Config::ConstPtr conf,
                              const std::string &calendar_string,
                              units::System::Ptr units_system)
   : Time(conf, calendar_string, units_system),
-    m_com(c) {
+    m_com(c),
+    m_table_first_year(0) {
 
   std::string ref_date = m_config->get_string("time.reference_date");
 
@@ -156,6 +159,7 @@ void Time_Calendar::init_from_input_file(const File &nc,
       std::string date_string = reference_date_from_file(nc, time_name);
       m_time_units = units::Unit(m_unit_system, "seconds " + date_string);
     }
+    invalidate_table();
 
     // Read time information from the file. (PISM output files don't have time bounds, so we don't
     // bother checking for them.)
@@ -225,6 +229,7 @@ void Time_Calendar::init_from_file(const std::string &filename, const Logger &lo
       std::string date_string = reference_date_from_file(file, time_name);
       m_time_units = units::Unit(m_unit_system, "seconds " + date_string);
     }
+    invalidate_table();
 
     // Read time information from the file.
     std::vector<double> time;
@@ -262,7 +267,117 @@ double Time_Calendar::mod(double time, unsigned int) const {
   return time;
 }
 
+//! Maximum number of years in the table of month start times.
+static const int max_table_years = 1000;
+
+//! Calendar conversions may round times within this many seconds of the start of a month
+//! or a day either way, so table lookups are not used for these times.
+static const double table_tolerance = 1.0;
+
+void Time_Calendar::invalidate_table() {
+  m_month_start.clear();
+  m_table_first_year = 0;
+}
+
+//! Fill the table of month start times, if it does not contain `T`.
+/*!
+ * The table covers up to `max_table_years` years, starting with the year before the one
+ * containing `T` and ending with the year after the end of the run. It is (re-)built only
+ * for times within the run, so that occasional queries outside of it do not replace it.
+ */
+void Time_Calendar::update_table(double T) const {
+  if (not m_month_start.empty() and
+      T >= m_month_start.front() and T < m_month_start.back()) {
+    return;
+  }
+
+  if (T < m_run_start or T > m_run_end) {
+    return;
+  }
+
+  auto year = [this](double t) {
+    int Y, M, D, h, m;
+    double s;
+    utCalendar2_cal(t, m_time_units.get(), &Y, &M, &D, &h, &m, &s,
+                    m_calendar_string.c_str());
+    return Y;
+  };
+
+  const int
+    first_year = year(T) - 1,
+    n_years    = std::max(std::min(year(m_run_end) + 2 - first_year, max_table_years), 3);
+
+  std::vector<double> month_start(12 * n_years + 1);
+  for (int n = 0; n < n_years; ++n) {
+    for (int month = 1; month <= 12; ++month) {
+      utInvCalendar2_cal(first_year + n, month, 1, 0, 0, 0.0, m_time_units.get(),
+                         &month_start[12 * n + month - 1],
+                         m_calendar_string.c_str());
+    }
+  }
+  utInvCalendar2_cal(first_year + n_years, 1, 1, 0, 0, 0.0, m_time_units.get(),
+                     &month_start.back(), m_calendar_string.c_str());
+
+  m_month_start.swap(month_start);
+  m_table_first_year = first_year;
+}
+
+//! Index (in `m_month_start`) of the month containing `T` or -1 if the table cannot be
+//! used. If `day` is not NULL, also set `*day` to the day of the month.
+int Time_Calendar::month_index(double T, int *day) const {
+  update_table(T);
+
+  if (m_month_start.empty() or
+      T < m_month_start.front() or T >= m_month_start.back()) {
+    return -1;
+  }
+
+  const std::vector<double> &start = m_month_start;
+  const int N = start.size() - 1;
+
+  // months have roughly the same length, so this guess is off by at most a couple of
+  // months
+  int k = (T - start[0]) / (start[N] - start[0]) * N;
+  k = std::max(std::min(k, N - 1), 0);
+  while (T < start[k]) {
+    k -= 1;
+  }
+  while (T >= start[k + 1]) {
+    k += 1;
+  }
+
+  if ((T != start[k] and T - start[k] < table_tolerance) or
+      start[k + 1] - T < table_tolerance) {
+    return -1;
+  }
+
+  if (day != nullptr) {
+    const double
+      one_day   = 86400.0,
+      n_days    = std::floor((T - start[k]) / one_day),
+      remainder = (T - start[k]) - n_days * one_day;
+
+    if (remainder != 0.0 and
+        (remainder < table_tolerance or one_day - remainder < table_tolerance)) {
+      return -1;
+    }
+
+    *day = static_cast<int>(n_days) + 1;
+  }
+
+  return k;
+}
+
 double Time_Calendar::year_fraction(double T) const {
+  const int k = month_index(T);
+  if (k >= 0) {
+    const double
+      year_start      = m_month_start[k - k % 12],
+      next_year_start = m_month_start[k - k % 12 + 12];
+
+    return (T - year_start) / (next_year_start - year_start);
+  }
+
   int year, month, day, hour, minute;
   double second, year_start, next_year_start;
 
@@ -292,9 +407,15 @@ std::string Time_Calendar::date(double T) const {
   int year, month, day, hour, minute;
   double second;
 
-  utCalendar2_cal(T, m_time_units.get(),
-                  &year, &month, &day, &hour, &minute, &second,
-                  m_calendar_string.c_str());
+  const int k = month_index(T, &day);
+  if (k >= 0) {
+    year  = m_table_first_year + k / 12;
+    month = k % 12 + 1;
+  } else {
+    utCalendar2_cal(T, m_time_units.get(),
+                    &year, &month, &day, &hour, &minute, &second,
+                    m_calendar_string.c_str());
+  }
 
   snprintf(tmp, 256, "%04d-%02d-%02d", year, month, day);
 
@@ -314,6 +435,11 @@ std::string Time_Calendar::end_date() const {
 }
 
 double Time_Calendar::calendar_year_start(double T) const {
+  const int k = month_index(T);
+  if (k >= 0) {
+    return m_month_start[k - k % 12];
+  }
+
   int year, month, day, hour, minute;
   double second, result;
 
@@ -334,6 +460,17 @@ double Time_Calendar::calendar_year_start(double T) const {
 
 
 double Time_Calendar::increment_date(double T, int years) const {
+  // the start of a year: look up the start of the year `years` years later
+  {
+    const int k = month_index(T);
+    if (k >= 0 and k % 12 == 0 and T == m_month_start[k]) {
+      const int n = k + 12 * years;
+      if (n >= 0 and n < (int)m_month_start.size()) {
+        return m_month_start[n];
+      }
+    }
+  }
+
   int year, month, day, hour, minute;
   double second, result;
 
@@ -19,6 +19,8 @@
 #ifndef _PISMGREGORIANTIME_H_
 #define _PISMGREGORIANTIME_H_
 
+#include <vector>
+
 #include "Time.hh"
 #include "Units.hh"
 
@@ -92,6 +94,16 @@ protected:
   void compute_times_yearly(std::vector<double> &result) const;
 private:
   MPI_Comm m_com;
+
+  int month_index(double T, int *day = nullptr) const;
+  void update_table(double T) const;
+  void invalidate_table();
+
+  //! Start times of months (12 per year) from January of `m_table_first_year` to January
+  //! of the year after the last one in the table. Used to avoid calendar conversions.
+  mutable std::vector<double> m_month_start;
+  //! the year corresponding to `m_month_start[0]`
+  mutable int m_table_first_year;
   // Hide copy constructor / assignment operator.
   Time_Calendar(Time_Calendar const &);
   Time_Calendar & operator=(Time_Calendar const &);
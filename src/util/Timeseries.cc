@@ -54,6 +54,7 @@ void Timeseries::private_constructor(MPI_Comm c, const std::string &dimension_na
   m_dimension.set_string("bounds", dimension_name + "_bounds");
 
   m_use_bounds = true;
+  m_cursor = 0;
 }
 
 //! Ensure that time bounds have the same units as the dimension.
@@ -185,6 +186,7 @@ void Timeseries::reset() {
   m_time.clear();
   m_values.clear();
   m_time_bounds.clear();
+  m_cursor = 0;
 }
 
 /** Scale all values stored in this instance by `scaling_factor`.
@@ -199,6 +201,29 @@ void Timeseries::scale(double scaling_factor) {
   }
 }
 
+/*!
+ * Find `k` such that `m_time[k] <= t < m_time[k + 1]` (or `k = m_time.size() - 1` if
+ * `t >= m_time.back()`). Returns 0 if `t < m_time[0]`.
+ *
+ * Callers usually request values at (slowly) increasing times, so this checks the
+ * interval found during the previous call and the one after it before falling back to
+ * the binary search.
+ */
+size_t Timeseries::segment(double t) const {
+  const size_t N = m_time.size();
+
+  for (size_t k = m_cursor; k < N and k <= m_cursor + 1; ++k) {
+    if (m_time[k] <= t and (k + 1 == N or t < m_time[k + 1])) {
+      m_cursor = k;
+      return k;
+    }
+  }
+
+  m_cursor = gsl_interp_bsearch(m_time.data(), t, 0, N);
+
+  return m_cursor;
+}
+
 //! Get a value of timeseries at time `t`.
 /*! Returns the first value or the last value if t is out of range on the left
   and right, respectively.
@@ -217,7 +242,7 @@ double Timeseries::operator()(double t) const {
     } else if (t >= m_time.back()) {
       k = m_time.size() - 1;
     } else {
-      k = gsl_interp_bsearch(m_time.data(), t, 0, m_time.size()) + 1;
+      k = segment(t) + 1;
     }
 
     return m_values[k];
@@ -229,7 +254,7 @@ double Timeseries::operator()(double t) const {
       return m_values[0];
     }
 
-    size_t k = gsl_interp_bsearch(m_time.data(), t, 0, m_time.size());
+    size_t k = segment(t);
 
     // extrapolation on the right
     if (k + 1 >= m_time.size()) {
@@ -242,6 +267,16 @@ double Timeseries::operator()(double t) const {
   }
 }
 
+//! Get values of timeseries at times `t[0], ..., t[N - 1]`.
+/*!
+ * This is more efficient than N calls of operator() if times are (mostly) increasing.
+ */
+void Timeseries::evaluate(const double *t, double *result, unsigned int N) const {
+  for (unsigned int k = 0; k < N; ++k) {
+    result[k] = (*this)(t[k]);
+  }
+}
+
 //! Get a value of timeseries by index.
 /*!
   Stops if the index is out of range.
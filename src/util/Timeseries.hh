@@ -80,6 +80,7 @@ public:
   void read(const File &nc, const Time &time_manager, const Logger &log);
   void write(const File &nc) const;
   double operator()(double time) const;
+  void evaluate(const double *t, double *result, unsigned int N) const;
   double operator[](unsigned int j) const;
   double average(double t, double dt, unsigned int N) const;
   void append(double value, double a, double b);
@@ -118,6 +119,10 @@ private:
   std::vector<double> m_values;
   std::vector<double> m_time_bounds;
 
+  //! index of the interval containing the time used in the last operator() call
+  mutable size_t m_cursor;
+  size_t segment(double t) const;
+
   void set_bounds_units();
   void private_constructor(MPI_Comm com, const std::string &dimension_name);
   void report_range(const Logger &log);
@@ -185,17 +185,22 @@ ParallelSection::~ParallelSection() {
 //! @brief Indicates a failure of a parallel section.
 /*!
  * This should be called from a `catch (...) { ... }` block **only**.
+ *
+ * May be called by several OpenMP threads at the same time.
  */
 void ParallelSection::failed() {
-  int rank = 0;
-  MPI_Comm_rank(m_com, &rank);
+#pragma omp critical (pism_parallel_section)
+  {
+    int rank = 0;
+    MPI_Comm_rank(m_com, &rank);
 
-  PetscFPrintf(MPI_COMM_SELF, stderr,
-               "PISM ERROR: Rank %d failed with the following message.\n", rank);
+    PetscFPrintf(MPI_COMM_SELF, stderr,
+                 "PISM ERROR: Rank %d failed with the following message.\n", rank);
 
-  handle_fatal_errors(MPI_COMM_SELF);
+    handle_fatal_errors(MPI_COMM_SELF);
 
-  m_failed = true;
+    m_failed = true;
+  }
 }
 
 void ParallelSection::reset() {
@@ -22,6 +22,8 @@
 #include "fftw_utilities.hh"
 
 #include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 
@@ -65,6 +67,50 @@ std::vector<double> fftfreq(int M, double d) {
   return result;
 }
 
+/*!
+ * Plans created using FFTW_MEASURE and FFTW_PATIENT are faster, but take longer to create
+ * (and overwrite input and output arrays while planning). Use `fftw.wisdom_file` to
+ * re-use them.
+ */
+unsigned int fftw_planner_flags(const Config &config) {
+  std::string effort = config.get_string("fftw.planning_effort");
+
+  if (effort == "estimate") {
+    return FFTW_ESTIMATE;
+  }
+
+  if (effort == "measure") {
+    return FFTW_MEASURE;
+  }
+
+  if (effort == "patient") {
+    return FFTW_PATIENT;
+  }
+
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "invalid fftw.planning_effort: '%s'", effort.c_str());
+}
+
+void fftw_load_wisdom(const std::string &filename) {
+  if (filename.empty()) {
+    return;
+  }
+
+  // Ignore errors: the file does not exist before the first run.
+  fftw_import_wisdom_from_filename(filename.c_str());
+}
+
+void fftw_save_wisdom(const std::string &filename) {
+  if (filename.empty()) {
+    return;
+  }
+
+  if (fftw_export_wisdom_to_filename(filename.c_str()) == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to save FFTW wisdom to '%s'", filename.c_str());
+  }
+}
+
 //! \brief Fill `input` with zeros.
 void clear_fftw_array(fftw_complex *input, int Nx, int Ny) {
   FFTWArray fftw_in(input, Nx, Ny);
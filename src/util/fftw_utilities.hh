@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <complex>
+#include <string>
 
 #include <fftw3.h>
 
@@ -28,6 +29,8 @@
 
 namespace pism {
 
+class Config;
+
 /*!
  * Template class for accessing the central part of an extended grid, i.e. PISM's grid
  * surrounded by "padding" necessary to reduce artifacts coming from interpreting model
@@ -55,6 +58,16 @@ private:
 
 std::vector<double> fftfreq(int M, double normalization);
 
+//! Return FFTW planner flags corresponding to `fftw.planning_effort`.
+unsigned int fftw_planner_flags(const Config &config);
+
+//! Import FFTW wisdom from `filename`. Does nothing if `filename` is empty or the file
+//! cannot be read.
+void fftw_load_wisdom(const std::string &filename);
+
+//! Export accumulated FFTW wisdom to `filename`. Does nothing if `filename` is empty.
+void fftw_save_wisdom(const std::string &filename);
+
 //! Fill `input` with zeros.
 void clear_fftw_array(fftw_complex *input, int Nx, int Ny);
 
@@ -33,6 +33,7 @@
 #include "pism/util/petscwrappers/VecScatter.hh"
 #include "pism/util/Mask.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/SharedMemoryHaloExchange.hh"
 
 namespace pism {
 
@@ -104,6 +105,15 @@ IceModelVec::~IceModelVec() {
   assert(m_access_counter == 0);
 }
 
+//! Record the amount of memory used by the internal storage (call after allocating it).
+void IceModelVec::record_memory_use() {
+  PetscInt n = 0;
+  PetscErrorCode ierr = VecGetLocalSize(m_v, &n);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  m_memory.set(m_grid->ctx()->memory_usage(), "fields", n * sizeof(PetscScalar));
+}
+
 //! Returns true if create() was called and false otherwise.
 bool IceModelVec::was_created() const {
   return (m_v != NULL);
@@ -522,6 +532,10 @@ void IceModelVec::write_impl(const File &file) const {
                        " IceModelVecs with dof == 1");
   }
 
+  if (io::time_independent_written(metadata(0), file)) {
+    return;
+  }
+
   if (m_has_ghosts) {
     petsc::TemporaryGlobalVec tmp(m_da);
 
@@ -543,7 +557,8 @@ void IceModelVec::dump(const char filename[]) const {
   File file(m_grid->com, filename,
             string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
             PISM_READWRITE_CLOBBER,
-            m_grid->ctx()->pio_iosys_id());
+            m_grid->ctx()->pio_iosys_id(),
+            m_grid->ctx()->netcdf3_n_aggregators());
 
   if (not m_metadata[0].get_time_independent()) {
     io::define_time(file, *m_grid->ctx());
@@ -628,20 +643,54 @@ void  IceModelVec::end_access() const {
 
 //! Updates ghost points.
 void  IceModelVec::update_ghosts() {
-  PetscErrorCode ierr;
+  begin_update_ghosts();
+  end_update_ghosts();
+}
+
+//! Start updating ghosts. Has to be followed by end_update_ghosts().
+/*!
+ * Ghost values are not valid and the field must not be modified until
+ * end_update_ghosts() is called. Values at owned grid points can be read in between, so
+ * computations at points that do not need ghosts (see InteriorPoints) can overlap
+ * communication.
+ */
+void IceModelVec::begin_update_ghosts() {
   if (not m_has_ghosts) {
     return;
   }
 
   assert(m_v != NULL);
 
-  ierr = DMLocalToLocalBegin(*m_da, m_v, INSERT_VALUES, m_v);
+  if (m_halo_exchange) {
+    // the node-aware exchange is completed here (it is not split into two stages)
+    m_halo_exchange->update(m_v);
+    return;
+  }
+
+  PetscErrorCode ierr = DMLocalToLocalBegin(*m_da, m_v, INSERT_VALUES, m_v);
   PISM_CHK(ierr, "DMLocalToLocalBegin");
-  
-  ierr = DMLocalToLocalEnd(*m_da, m_v, INSERT_VALUES, m_v);
+}
+
+//! Finish updating ghosts started by begin_update_ghosts().
+void IceModelVec::end_update_ghosts() {
+  if (not m_has_ghosts or m_halo_exchange) {
+    return;
+  }
+
+  assert(m_v != NULL);
+
+  WaitTimer timer;
+  PetscErrorCode ierr = DMLocalToLocalEnd(*m_da, m_v, INSERT_VALUES, m_v);
   PISM_CHK(ierr, "DMLocalToLocalEnd");
 }
 
+//! Set up the node-aware ghost exchange if requested (see grid.node_aware_halo_exchange).
+void IceModelVec::setup_halo_exchange() {
+  if (m_has_ghosts and m_grid->ctx()->config()->get_flag("grid.node_aware_halo_exchange")) {
+    m_halo_exchange = SharedMemoryHaloExchange::shared(m_da);
+  }
+}
+
 void IceModelVec::global_to_local(petsc::DM::Ptr dm, Vec source, Vec destination) const {
   PetscErrorCode ierr;
 
@@ -663,19 +712,15 @@ void  IceModelVec::update_ghosts(IceModelVec &destination) const {
   assert(destination.m_has_ghosts);
 
   if (m_has_ghosts and destination.m_has_ghosts) {
+    WaitTimer timer;
+
     ierr = DMLocalToLocalBegin(*m_da, m_v, INSERT_VALUES, destination.vec());
     PISM_CHK(ierr, "DMLocalToLocalBegin");
 
     ierr = DMLocalToLocalEnd(*m_da, m_v, INSERT_VALUES, destination.vec());
     PISM_CHK(ierr, "DMLocalToLocalEnd");
-
-    return;
-  }
-
-  if (not m_has_ghosts and destination.m_has_ghosts) {
+  } else if (not m_has_ghosts and destination.m_has_ghosts) {
     global_to_local(destination.dm(), m_v, destination.vec());
-
-    return;
   }
 
   destination.inc_state_counter();          // mark as modified
@@ -822,7 +867,8 @@ void IceModelVec::write(const std::string &filename) const {
             filename,
             string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
             PISM_READWRITE,
-            m_grid->ctx()->pio_iosys_id());
+            m_grid->ctx()->pio_iosys_id(),
+            m_grid->ctx()->netcdf3_n_aggregators());
 
   this->write(file);
 }
@@ -1149,7 +1195,21 @@ petsc::Vec::Ptr IceModelVec::allocate_proc0_copy() const {
     ierr = VecDuplicate(v_proc0, &result);
     PISM_CHK(ierr, "VecDuplicate");
   }
-  return petsc::Vec::Ptr(new petsc::Vec(result));
+
+  // the copy is attributed to the current owner and released when it is de-allocated
+  std::shared_ptr<MemoryRecord> memory(new MemoryRecord());
+  {
+    PetscInt n = 0;
+    ierr = VecGetLocalSize(result, &n);
+    PISM_CHK(ierr, "VecGetLocalSize");
+
+    memory->set(m_grid->ctx()->memory_usage(), "proc0 copies", n * sizeof(PetscScalar));
+  }
+
+  return petsc::Vec::Ptr(new petsc::Vec(result),
+                         [memory](petsc::Vec *v) {
+                           delete v;
+                         });
 }
 
 void IceModelVec::put_on_proc0(Vec parallel, Vec onp0) const {
@@ -1320,6 +1380,66 @@ bool set_contains(const std::set<std::string> &S, const IceModelVec &field) {
   return member(field.get_name(), S);
 }
 
+//! Read `fields` from `file` (record `time`).
+/*!
+ * This is equivalent to calling IceModelVec::read() for each field, but reads of all
+ * fields are started before any of them is completed. This allows I/O backends supporting
+ * non-blocking reads to combine them into one collective operation.
+ *
+ * Values are read into temporary storage and copied into `fields` once all reads are
+ * done.
+ */
+void read_fields(const File &file, unsigned int time, const std::vector<IceModelVec*> &fields) {
+  if (fields.empty()) {
+    return;
+  }
+
+  IceGrid::ConstPtr grid = fields[0]->grid();
+  const size_t n_points = grid->xm() * grid->ym();
+
+  std::vector<const SpatialVariableMetadata*> variables;
+  std::vector<double*> outputs;
+  // one buffer per component of each field
+  std::vector<std::vector<double> > buffers;
+
+  for (auto field : fields) {
+    grid->ctx()->log()->message(3, "  Reading %s...\n", field->get_name().c_str());
+
+    const size_t n_levels = std::max(field->levels().size(), (size_t)1);
+    for (unsigned int c = 0; c < field->ndof(); ++c) {
+      buffers.emplace_back(n_points * n_levels);
+      variables.push_back(&field->metadata(c));
+    }
+  }
+
+  for (auto &b : buffers) {
+    outputs.push_back(b.data());
+  }
+
+  io::read_spatial_variables(variables, *grid, file, time, outputs);
+
+  size_t b = 0;
+  for (auto field : fields) {
+    const unsigned int dof = field->ndof();
+
+    petsc::TemporaryGlobalVec tmp(field->dm());
+    {
+      petsc::VecArray tmp_array(tmp);
+      double *result = tmp_array.get();
+
+      for (unsigned int c = 0; c < dof; ++c, ++b) {
+        const std::vector<double> &values = buffers[b];
+        // components are interleaved
+        for (size_t k = 0; k < values.size(); ++k) {
+          result[k * dof + c] = values[k];
+        }
+      }
+    }
+
+    field->copy_from_vec(tmp);
+  }
+}
+
 void staggered_to_regular(const IceModelVec2CellType &cell_type,
                           const IceModelVec2Stag &input,
                           bool include_floating_ice,
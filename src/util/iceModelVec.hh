@@ -36,9 +36,13 @@
 #include "pism/util/io/IO_Flags.hh"
 #include "pism/pism_config.hh"  // Pism_DEBUG
 #include "pism/util/interpolation.hh" // InterpolationType
+#include "pism/util/MemoryUsage.hh"
+#include "pism/util/FlatView.hh"
 
 namespace pism {
 
+class SharedMemoryHaloExchange;
+
 class IceGrid;
 class File;
 
@@ -64,6 +68,12 @@ public:
 };
 
 //! Makes sure that we call begin_access() and end_access() for all accessed IceModelVecs.
+/*!
+ * AccessList is not thread-safe: create it *before* entering an OpenMP parallel region.
+ * Within the region several threads may access elements of listed fields (using
+ * `operator()`, `get_column()`, `set_column()`) as long as they write to different grid
+ * points (see ThreadPoints).
+ */
 class AccessList {
 public:
   AccessList();
@@ -270,6 +280,8 @@ public:
   virtual void  end_access() const;
   virtual void  update_ghosts();
   virtual void  update_ghosts(IceModelVec &destination) const;
+  void begin_update_ghosts();
+  void end_update_ghosts();
 
   petsc::Vec::Ptr allocate_proc0_copy() const;
   void put_on_proc0(Vec onp0) const;
@@ -312,6 +324,10 @@ protected:
   bool m_has_ghosts;            //!< m_has_ghosts == true means "has ghosts"
   petsc::DM::Ptr m_da;          //!< distributed mesh manager (DM)
 
+  //! node-aware ghost exchange (NULL unless grid.node_aware_halo_exchange is set)
+  std::shared_ptr<SharedMemoryHaloExchange> m_halo_exchange;
+  void setup_halo_exchange();
+
   bool m_begin_end_access_use_dof;
 
   //! It is a map, because a temporary IceModelVec can be used to view
@@ -325,6 +341,10 @@ protected:
 
   InterpolationType m_interpolation_type;
 
+  //! memory used by m_v
+  MemoryRecord m_memory;
+  void record_memory_use();
+
   virtual void checkCompatibility(const char *function, const IceModelVec &other) const;
 
   //! \brief Check the array indices and warn if they are out of range.
@@ -358,6 +378,8 @@ protected:
 
 bool set_contains(const std::set<std::string> &S, const IceModelVec &field);
 
+void read_fields(const File &file, unsigned int time, const std::vector<IceModelVec*> &fields);
+
 class IceModelVec2S;
 
 /** Class for a 2d DA-based Vec.
@@ -385,6 +407,9 @@ public:
   virtual void set_component(unsigned int n, const IceModelVec2S &source);
   inline double& operator() (int i, int j, int k);
   inline const double& operator() (int i, int j, int k) const;
+  // flat access (for loops over rows):
+  FlatView<double> flat_view();
+  FlatView<const double> flat_view() const;
   void create(IceGrid::ConstPtr grid, const std::string &short_name,
               IceModelVecKind ghostedp, unsigned int stencil_width, int dof);
 protected:
@@ -615,6 +640,27 @@ public:
   void  getSurfaceValues(IceModelVec2S &gsurf, const IceModelVec2S &myH) const;
 
   void sumColumns(IceModelVec2S &output, double A, double B) const;
+
+  void update_ghosts_in_ice(const IceModelVec2S &ice_thickness);
+  void update_ghosts_in_ice(const IceModelVec2S &ice_thickness,
+                            IceModelVec3 &destination) const;
+};
+
+//! Updates ghosts of a 3D field in the ice right before they are used.
+/*!
+ * Calls IceModelVec3::update_ghosts_in_ice() using the *current* ice thickness, skipping
+ * the exchange if neither the field nor the ice thickness changed since the last one.
+ */
+class IceGhostsUpdater {
+public:
+  IceGhostsUpdater(IceGrid::ConstPtr grid);
+
+  void update(const IceModelVec2S &ice_thickness, IceModelVec3 &field);
+private:
+  //! ice thickness used by the last exchange
+  IceModelVec2S m_ice_thickness;
+  //! state counter of the field after the last exchange
+  int m_state;
 };
 
 /** 
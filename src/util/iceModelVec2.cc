@@ -440,6 +440,43 @@ void IceModelVec2::set_component(unsigned int n, const IceModelVec2S &source) {
   IceModelVec2::set_dof(source.dm(), source.m_v, n);
 }
 
+//! Returns a flat view of the local array (see FlatView).
+/*!
+ * The view covers owned grid points and all ghosts stored locally (which may be more
+ * than stencil_width()). It is valid until the end of access (see
+ * IceModelVec::AccessList).
+ */
+FlatView<double> IceModelVec2::flat_view() {
+  if (m_array == NULL) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "%s: a flat view requires access (call begin_access() first)",
+                                  m_name.c_str());
+  }
+
+  PetscErrorCode ierr;
+  PetscInt x0, y0, nx, ny;
+  if (m_has_ghosts) {
+    ierr = DMDAGetGhostCorners(*m_da, &x0, &y0, NULL, &nx, &ny, NULL);
+    PISM_CHK(ierr, "DMDAGetGhostCorners");
+  } else {
+    ierr = DMDAGetCorners(*m_da, &x0, &y0, NULL, &nx, &ny, NULL);
+    PISM_CHK(ierr, "DMDAGetCorners");
+  }
+
+  // DMDAVecGetArray() (used if m_begin_end_access_use_dof is false) stores all components
+  // at a point next to each other in a row, i.e. a[j][i * dof + k]
+  double *data = m_begin_end_access_use_dof ?
+    &static_cast<double***>(m_array)[y0][x0][0] :
+    &static_cast<double**>(m_array)[y0][x0 * m_dof];
+
+  return FlatView<double>(data, x0, y0, nx, m_dof);
+}
+
+FlatView<const double> IceModelVec2::flat_view() const {
+  // the non-const version does not modify values
+  return const_cast<IceModelVec2*>(this)->flat_view();
+}
+
 void IceModelVec2::create(IceGrid::ConstPtr grid, const std::string & name,
                            IceModelVecKind ghostedp,
                            unsigned int stencil_width, int dof) {
@@ -469,6 +506,9 @@ void IceModelVec2::create(IceGrid::ConstPtr grid, const std::string & name,
   m_has_ghosts = (ghostedp == WITH_GHOSTS);
   m_name       = name;
 
+  record_memory_use();
+  setup_halo_exchange();
+
   if (m_dof == 1) {
     m_metadata.push_back(SpatialVariableMetadata(m_grid->ctx()->unit_system(),
                                                  name));
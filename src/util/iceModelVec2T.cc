@@ -18,9 +18,12 @@
 
 #include <petsc.h>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 #include "iceModelVec2T.hh"
 #include "pism/util/io/File.hh"
+#include "pism/util/io/NodeSharedBuffer.hh"
 #include "pism_utilities.hh"
 #include "Time.hh"
 #include "IceGrid.hh"
@@ -33,6 +36,28 @@
 
 namespace pism {
 
+static IceModelVec2T::Compression compression_type(const std::string &name) {
+  if (name == "float32") {
+    return IceModelVec2T::FLOAT32;
+  }
+  if (name == "int16") {
+    return IceModelVec2T::INT16;
+  }
+  return IceModelVec2T::NONE;
+}
+
+//! Number of bytes used to store a buffered value.
+static size_t value_size(IceModelVec2T::Compression compression) {
+  switch (compression) {
+  case IceModelVec2T::FLOAT32:
+    return sizeof(float);
+  case IceModelVec2T::INT16:
+    return sizeof(int16_t);
+  case IceModelVec2T::NONE:
+  default:
+    return sizeof(double);
+  }
+}
 
 /*!
  * Allocate an instance that will be used to load and use a forcing field from a file.
@@ -40,7 +65,8 @@ namespace pism {
  * Checks the number of records in a file and allocates storage accordingly.
  *
  * If `periodic` is true, allocate enough storage to hold all the records, otherwise
- * allocate storage for at most `max_buffer_size` records.
+ * allocate storage for at most `max_buffer_size` records (or the number of compressed
+ * records using the same amount of memory, see `input.forcing.buffer_compression`).
  *
  * @param[in] grid computational grid
  * @param[in] file input file
@@ -63,7 +89,12 @@ IceModelVec2T::Ptr IceModelVec2T::ForcingField(IceGrid::ConstPtr grid,
                                     grid->ctx()->unit_system());
 
   if (not periodic) {
-    n_records = std::min(n_records, max_buffer_size);
+    // compressed buffers hold more records using the same amount of memory
+    auto config      = grid->ctx()->config();
+    auto compression = compression_type(config->get_string("input.forcing.buffer_compression"));
+    int compression_ratio = sizeof(double) / value_size(compression);
+
+    n_records = std::min(n_records, max_buffer_size * compression_ratio);
   }
   // In the periodic case we try to keep all the records in RAM.
 
@@ -96,7 +127,8 @@ IceModelVec2T::IceModelVec2T(IceGrid::ConstPtr grid, const std::string &short_na
                              unsigned int n_evaluations_per_year,
                              InterpolationType interpolation_type)
   : IceModelVec2S(grid, short_name, WITHOUT_GHOSTS, 1),
-    m_array3(nullptr),
+    m_records(nullptr),
+    m_integrals(nullptr),
     m_n_records(n_records),
     m_N(0),
     m_n_evaluations_per_year(n_evaluations_per_year),
@@ -107,6 +139,25 @@ IceModelVec2T::IceModelVec2T(IceGrid::ConstPtr grid, const std::string &short_na
 {
   m_report_range = false;
 
+  m_read_ahead = m_grid->ctx()->config()->get_flag("input.forcing.read_ahead");
+  m_exact_averages = m_grid->ctx()->config()->get_flag("input.forcing.exact_averages");
+  m_layout = (m_grid->ctx()->config()->get_flag("input.forcing.record_major") ?
+              RECORD_MAJOR : POINT_MAJOR);
+  set_strides();
+
+  if (m_grid->ctx()->config()->get_flag("input.forcing.node_shared_cache")) {
+    m_node_buffer.reset(new io::NodeSharedBuffer(m_grid->com));
+  }
+
+  m_compression =
+    compression_type(m_grid->ctx()->config()->get_string("input.forcing.buffer_compression"));
+
+  if (m_compression != NONE and m_exact_averages) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "input.forcing.exact_averages cannot be used with compressed"
+                       " forcing buffers (input.forcing.buffer_compression)");
+  }
+
   if (not (m_interp_type == PIECEWISE_CONSTANT or
            m_interp_type == LINEAR or
            m_interp_type == LINEAR_PERIODIC)) {
@@ -122,12 +173,41 @@ IceModelVec2T::IceModelVec2T(IceGrid::ConstPtr grid, const std::string &short_na
   }
   // LCOV_EXCL_STOP
 
-  // initialize the m_da3 member:
-  m_da3 = m_grid->get_dm(n_records, this->m_da_stencil_width);
+  if (m_compression == NONE) {
+    // initialize the m_da3 member:
+    m_da3 = m_grid->get_dm(n_records, this->m_da_stencil_width);
+
+    // allocate the 3D Vec:
+    PetscErrorCode ierr = DMCreateGlobalVector(*m_da3, m_v3.rawptr());
+    PISM_CHK(ierr, "DMCreateGlobalVector");
+
+    if (m_exact_averages) {
+      ierr = DMCreateGlobalVector(*m_da3, m_v3_integral.rawptr());
+      PISM_CHK(ierr, "DMCreateGlobalVector");
+    }
 
-  // allocate the 3D Vec:
-  PetscErrorCode ierr = DMCreateGlobalVector(*m_da3, m_v3.rawptr());
-  PISM_CHK(ierr, "DMCreateGlobalVector");
+    PetscInt n = 0;
+    ierr = VecGetLocalSize(m_v3, &n);
+    PISM_CHK(ierr, "VecGetLocalSize");
+
+    int copies = m_exact_averages ? 2 : 1;
+
+    m_buffer_memory.set(m_grid->ctx()->memory_usage(), "forcing buffers",
+                        copies * n * sizeof(PetscScalar));
+  } else {
+    const size_t size = (size_t)m_grid->xm() * m_grid->ym() * n_records;
+
+    if (m_compression == FLOAT32) {
+      m_records_float.resize(size);
+    } else {
+      m_records_int16.resize(size);
+      m_record_offset.resize(n_records, 0.0);
+      m_record_scale.resize(n_records, 1.0);
+    }
+
+    m_buffer_memory.set(m_grid->ctx()->memory_usage(), "forcing buffers",
+                        size * value_size(m_compression));
+  }
 }
 
 IceModelVec2T::~IceModelVec2T() {
@@ -138,15 +218,76 @@ unsigned int IceModelVec2T::n_records() {
   return m_n_records;
 }
 
-double*** IceModelVec2T::get_array3() {
+IceModelVec2T::RecordLayout IceModelVec2T::layout() const {
+  return m_layout;
+}
+
+void IceModelVec2T::set_strides() {
+  if (m_layout == POINT_MAJOR) {
+    m_point_stride  = m_n_records;
+    m_record_stride = 1;
+  } else {
+    m_point_stride  = 1;
+    m_record_stride = m_grid->xm() * m_grid->ym();
+  }
+}
+
+//! Transpose `data`, an `n_points` by `n_records` matrix (`to_point_major` is true) or
+//! vice versa.
+template <typename T>
+static void transpose(T *data, size_t n_points, unsigned int n_records, bool to_point_major) {
+  std::vector<T> tmp(data, data + n_points * n_records);
+
+  for (size_t p = 0; p < n_points; ++p) {
+    for (unsigned int k = 0; k < n_records; ++k) {
+      if (to_point_major) {
+        data[p * n_records + k] = tmp[k * n_points + p];
+      } else {
+        data[k * n_points + p] = tmp[p * n_records + k];
+      }
+    }
+  }
+}
+
+//! Change the storage order of buffered records (and their prefix integrals).
+void IceModelVec2T::set_layout(RecordLayout layout) {
+  if (layout == m_layout) {
+    return;
+  }
+
+  const size_t n_points = m_grid->xm() * m_grid->ym();
+  const bool point_major = layout == POINT_MAJOR;
+
   begin_access();
-  return reinterpret_cast<double***>(m_array3);
+  switch (m_compression) {
+  case FLOAT32:
+    transpose(m_records_float.data(), n_points, m_n_records, point_major);
+    break;
+  case INT16:
+    transpose(m_records_int16.data(), n_points, m_n_records, point_major);
+    break;
+  case NONE:
+  default:
+    transpose(m_records, n_points, m_n_records, point_major);
+    if (m_exact_averages) {
+      transpose(m_integrals, n_points, m_n_records, point_major);
+    }
+  }
+  end_access();
+
+  m_layout = layout;
+  set_strides();
 }
 
 void IceModelVec2T::begin_access() const {
-  if (m_access_counter == 0) {
-    PetscErrorCode ierr = DMDAVecGetArrayDOF(*m_da3, m_v3, &m_array3);
-    PISM_CHK(ierr, "DMDAVecGetArrayDOF");
+  if (m_access_counter == 0 and m_compression == NONE) {
+    PetscErrorCode ierr = VecGetArray(m_v3, &m_records);
+    PISM_CHK(ierr, "VecGetArray");
+
+    if (m_exact_averages) {
+      ierr = VecGetArray(m_v3_integral, &m_integrals);
+      PISM_CHK(ierr, "VecGetArray");
+    }
   }
 
   // this call will increment the m_access_counter
@@ -158,10 +299,16 @@ void IceModelVec2T::end_access() const {
   // this call will decrement the m_access_counter
   IceModelVec2S::end_access();
 
-  if (m_access_counter == 0) {
-    PetscErrorCode ierr = DMDAVecRestoreArrayDOF(*m_da3, m_v3, &m_array3);
-    PISM_CHK(ierr, "DMDAVecRestoreArrayDOF");
-    m_array3 = NULL;
+  if (m_access_counter == 0 and m_compression == NONE) {
+    PetscErrorCode ierr = VecRestoreArray(m_v3, &m_records);
+    PISM_CHK(ierr, "VecRestoreArray");
+    m_records = nullptr;
+
+    if (m_exact_averages) {
+      ierr = VecRestoreArray(m_v3_integral, &m_integrals);
+      PISM_CHK(ierr, "VecRestoreArray");
+      m_integrals = nullptr;
+    }
   }
 }
 
@@ -281,6 +428,8 @@ void IceModelVec2T::init_constant(double value) {
 
   // set fake time bounds:
   m_time_bounds = {-1.0, 1.0};
+
+  update_integrals();
 }
 
 //! Read some data to make sure that the interval (t, t + dt) is covered.
@@ -311,6 +460,13 @@ void IceModelVec2T::update(double t, double dt) {
 
     // just return if we have all the data we need:
     if (t >= t0 and t + dt <= t1) {
+      if (m_read_ahead) {
+        // Discard records we no longer need and use freed space to read the next ones. This
+        // spreads the cost of reading forcing data over many time steps instead of
+        // re-filling the whole buffer when it is exhausted.
+        Interpolation I(m_interp_type, m_time, {t, t + dt});
+        update(I.left(0));
+      }
       return;
     }
   }
@@ -368,6 +524,7 @@ void IceModelVec2T::update(unsigned int start) {
   }
 
   if (missing <= 0) {
+    update_integrals();
     return;
   }
 
@@ -395,19 +552,70 @@ void IceModelVec2T::update(unsigned int start) {
   const bool allow_extrapolation = m_grid->ctx()->config()->get_flag("grid.allow_extrapolation");
 
   for (unsigned int j = 0; j < missing; ++j) {
-    {
-      petsc::VecArray tmp_array(m_v);
-      io::regrid_spatial_variable(m_metadata[0], *m_grid, file, start + j, CRITICAL,
-                                  m_report_range, allow_extrapolation,
-                                  0.0, m_interpolation_type, tmp_array.get());
-    }
-
     m_grid->ctx()->log()->message(5, " %s: reading entry #%02d, year %s...\n",
                                   m_name.c_str(),
                                   start + j,
                                   t->date(m_time[start + j]).c_str());
+  }
+
+  // Read all missing records at once: this uses one (x, y, time) hyperslab read and one
+  // interpolation context instead of one of each per record.
+  const size_t n_points = m_grid->xm() * m_grid->ym();
 
-    set_record(kept + j);
+  begin_access();
+  try {
+    if (m_layout == RECORD_MAJOR and m_compression == NONE) {
+      // records are contiguous: read directly into the buffer
+      io::regrid_spatial_variable_records(m_metadata[0], *m_grid, file, start, missing,
+                                          CRITICAL, m_report_range, allow_extrapolation,
+                                          0.0, m_interpolation_type, m_node_buffer.get(),
+                                          &m_records[index(0, kept)]);
+    } else {
+      std::vector<double> tmp(missing * n_points);
+
+      io::regrid_spatial_variable_records(m_metadata[0], *m_grid, file, start, missing,
+                                          CRITICAL, m_report_range, allow_extrapolation,
+                                          0.0, m_interpolation_type, m_node_buffer.get(),
+                                          tmp.data());
+
+      if (m_compression == NONE) {
+        for (size_t p = 0; p < n_points; ++p) {
+          for (unsigned int k = 0; k < missing; ++k) {
+            m_records[index(p, kept + k)] = tmp[k * n_points + p];
+          }
+        }
+      } else {
+        for (unsigned int k = 0; k < missing; ++k) {
+          store_record(kept + k, &tmp[k * n_points]);
+        }
+      }
+    }
+  } catch (...) {
+    end_access();
+    throw;
+  }
+  end_access();
+
+  update_integrals();
+}
+
+//! Move `N` records stored in `data` by `number` positions towards the "beginning".
+template <typename T>
+static void shift_records(T *data, IceModelVec2T::RecordLayout layout, size_t n_points,
+                          size_t point_stride, size_t record_stride,
+                          unsigned int N, int number) {
+  if (layout == IceModelVec2T::POINT_MAJOR) {
+    for (size_t p = 0; p < n_points; ++p) {
+      T *f = &data[p * point_stride];
+      for (unsigned int k = 0; k < N; ++k) {
+        f[k] = f[k + number];
+      }
+    }
+  } else {
+    for (unsigned int k = 0; k < N; ++k) {
+      std::copy(&data[(k + number) * record_stride], &data[(k + number) * record_stride] + n_points,
+                &data[k * record_stride]);
+    }
   }
 }
 
@@ -420,27 +628,131 @@ void IceModelVec2T::discard(int number) {
 
   m_N -= number;
 
-  double ***a3 = get_array3();
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  const size_t n_points = m_grid->xm() * m_grid->ym();
 
-    for (unsigned int k = 0; k < m_N; ++k) {
-      a3[j][i][k] = a3[j][i][k + number];
-    }
+  begin_access();
+  switch (m_compression) {
+  case FLOAT32:
+    shift_records(m_records_float.data(), m_layout, n_points,
+                  m_point_stride, m_record_stride, m_N, number);
+    break;
+  case INT16:
+    shift_records(m_records_int16.data(), m_layout, n_points,
+                  m_point_stride, m_record_stride, m_N, number);
+    shift_records(m_record_offset.data(), RECORD_MAJOR, 1, 1, 1, m_N, number);
+    shift_records(m_record_scale.data(), RECORD_MAJOR, 1, 1, 1, m_N, number);
+    break;
+  case NONE:
+  default:
+    shift_records(m_records, m_layout, n_points,
+                  m_point_stride, m_record_stride, m_N, number);
   }
   end_access();
 }
 
+//! Store `values` (one per owned grid point) as the record `k`, compressing them if
+//! necessary.
+/*!
+ * Records stored as 16-bit integers use the offset and the scale mapping the range of
+ * `values` to [-32767, 32767]. Such records cannot contain NaNs or infinities (there is
+ * no integer to map them to).
+ */
+void IceModelVec2T::store_record(unsigned int k, const double *values) {
+  const size_t n_points = m_grid->xm() * m_grid->ym();
+
+  switch (m_compression) {
+  case FLOAT32:
+    for (size_t p = 0; p < n_points; ++p) {
+      m_records_float[index(p, k)] = values[p];
+    }
+    break;
+  case INT16:
+    {
+      const double n_max = 32767.0;
+
+      int non_finite = 0;
+      for (size_t p = 0; p < n_points; ++p) {
+        non_finite += std::isfinite(values[p]) ? 0 : 1;
+      }
+
+      if (GlobalMax(m_grid->com, non_finite) > 0) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "record %d of %s contains NaNs or infinities;"
+                                      " they cannot be stored as 16-bit integers"
+                                      " (set input.forcing.buffer_compression to"
+                                      " \"float32\" or \"none\")",
+                                      k, get_name().c_str());
+      }
+
+      double
+        min = n_points > 0 ? values[0] : 0.0,
+        max = min;
+      for (size_t p = 0; p < n_points; ++p) {
+        min = std::min(min, values[p]);
+        max = std::max(max, values[p]);
+      }
+
+      const double
+        offset = 0.5 * (min + max),
+        scale  = max > min ? (max - min) / (2.0 * n_max) : 1.0;
+
+      m_record_offset[k] = offset;
+      m_record_scale[k]  = scale;
+
+      for (size_t p = 0; p < n_points; ++p) {
+        m_records_int16[index(p, k)] = std::lround((values[p] - offset) / scale);
+      }
+    }
+    break;
+  case NONE:
+  default:
+    for (size_t p = 0; p < n_points; ++p) {
+      m_records[index(p, k)] = values[p];
+    }
+  }
+}
+
+//! Returns values of the record `k` at all owned grid points, decompressing them into
+//! `buffer` if necessary.
+const double* IceModelVec2T::record(unsigned int k, std::vector<double> &buffer) const {
+  if (m_compression == NONE and m_layout == RECORD_MAJOR) {
+    return &m_records[index(0, k)];
+  }
+
+  const size_t n_points = m_grid->xm() * m_grid->ym();
+
+  buffer.resize(n_points);
+  for (size_t p = 0; p < n_points; ++p) {
+    buffer[p] = value(p, k);
+  }
+  return buffer.data();
+}
+
+//! Returns the time series of buffered values at the grid point number `p`,
+//! decompressing them into `buffer` if necessary.
+const double* IceModelVec2T::time_series(size_t p, std::vector<double> &buffer) const {
+  if (m_compression == NONE and m_layout == POINT_MAJOR) {
+    return &m_records[index(p, 0)];
+  }
+
+  buffer.resize(m_N);
+  for (unsigned int k = 0; k < m_N; ++k) {
+    buffer[k] = value(p, k);
+  }
+  return buffer.data();
+}
+
 //! Sets the record number n to the contents of the (internal) Vec v.
 void IceModelVec2T::set_record(int n) {
 
+  std::vector<double> values(m_grid->xm() * m_grid->ym());
+
   double  **a2 = get_array();
-  double ***a3 = get_array3();
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
-    a3[j][i][n] = a2[j][i];
+    values[point(i, j)] = a2[j][i];
   }
-  end_access();
+  store_record(n, values.data());
   end_access();
 }
 
@@ -448,13 +760,11 @@ void IceModelVec2T::set_record(int n) {
 void IceModelVec2T::get_record(int n) {
 
   double  **a2 = get_array();
-  double ***a3 = get_array3();
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
-    a2[j][i] = a3[j][i][n];
+    a2[j][i] = value(point(i, j), n);
   }
   end_access();
-  end_access();
 }
 
 //! @brief Given the time t determines the maximum possible time-step this IceModelVec2T
@@ -480,6 +790,30 @@ MaxTimestep IceModelVec2T::max_timestep(double t) const {
   }
 }
 
+//! Returns the in-file index of the record equal to the forcing at all times in `[t, t + dt]`
+//! or -1 if the forcing may change during this interval.
+/*!
+ * Callers can use this to skip update() and average() (and computations using their
+ * results) if the interval `[t, t + dt]` is covered by the same record as the previous one.
+ */
+int IceModelVec2T::constant_record(double t, double dt) const {
+  if (m_time.size() == 1) {
+    return 0;
+  }
+
+  if (m_interp_type != PIECEWISE_CONSTANT or m_period != 0) {
+    return -1;
+  }
+
+  size_t k = gsl_interp_bsearch(m_time.data(), t, 0, m_time.size());
+
+  if (t >= m_time_bounds[2 * k] and t + dt <= m_time_bounds[2 * k + 1]) {
+    return k;
+  }
+
+  return -1;
+}
+
 /*
  * \brief Use piecewise-constant interpolation to initialize
  * IceModelVec2T with the value at time `t`.
@@ -491,7 +825,7 @@ MaxTimestep IceModelVec2T::max_timestep(double t) const {
  */
 void IceModelVec2T::interp(double t) {
 
-  init_interpolation({t});
+  init_interpolation_impl({t});
 
   get_record(m_interp->left(0));
 }
@@ -514,6 +848,12 @@ void IceModelVec2T::average(double t, double dt) {
     return;
   }
 
+  if (m_exact_averages and dt > 0.0 and
+      not (m_period != 0 and m_interp_type == LINEAR)) {
+    average_exact(t, dt);
+    return;
+  }
+
   // Determine the number of small time-steps to use for averaging:
   int M = (int) ceil(m_n_evaluations_per_year * (dt_years));
   if (M < 1) {
@@ -526,12 +866,44 @@ void IceModelVec2T::average(double t, double dt) {
     ts[k] = t + k * ts_dt;
   }
 
-  init_interpolation(ts);
+  init_interpolation_impl(ts);
 
   double **a2 = get_array();         // calls begin_access()
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-    a2[j][i] = average(i, j);
+  if (m_layout == POINT_MAJOR or m_N == 1) {
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+      a2[j][i] = average(i, j);
+    }
+  } else {
+    // Evaluate forcing at all grid points one time at a time. Values of a record are
+    // contiguous, so these loops are vectorizable. This uses the same arithmetic as
+    // average(i, j).
+    const std::vector<int>
+      &L = m_interp->left(),
+      &R = m_interp->right();
+    const std::vector<double> &alpha = m_interp->alpha();
+
+    const size_t n_points = m_grid->xm() * m_grid->ym();
+    std::vector<double> sum(n_points, 0.0);
+
+    // used if records are compressed
+    std::vector<double> left, right;
+
+    for (int k = 0; k < M; ++k) {
+      const double
+        *f_L = record(L[k], left),
+        *f_R = record(R[k], right),
+        a    = alpha[k];
+
+      for (size_t p = 0; p < n_points; ++p) {
+        sum[p] += f_L[p] + a * (f_R[p] - f_L[p]);
+      }
+    }
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+      a2[j][i] = sum[point(i, j)] / (double)M;
+    }
   }
   end_access();
 }
@@ -544,6 +916,13 @@ void IceModelVec2T::average(double t, double dt) {
  *
  */
 void IceModelVec2T::init_interpolation(const std::vector<double> &ts) {
+  // the caller is going to use time series at grid points (see interp(i, j, ...))
+  set_layout(POINT_MAJOR);
+
+  init_interpolation_impl(ts);
+}
+
+void IceModelVec2T::init_interpolation_impl(const std::vector<double> &ts) {
 
   assert(m_first >= 0);
 
@@ -573,11 +952,291 @@ void IceModelVec2T::init_interpolation(const std::vector<double> &ts) {
  *
  */
 void IceModelVec2T::interp(int i, int j, std::vector<double> &result) {
-  double ***a3 = (double***) m_array3;
+  assert(m_layout == POINT_MAJOR);
 
   result.resize(m_interp->alpha().size());
 
-  m_interp->interpolate(a3[j][i], result.data());
+  std::vector<double> buffer;
+  m_interp->interpolate(time_series(point(i, j), buffer), result.data());
+}
+
+/**
+ * \brief Compute values of the time-series at `n_points` consecutive points in the grid
+ * row `j`, starting at `i0`.
+ *
+ * The value at time `k` and the point `(i0 + p, j)` is stored in `result[k * n_points + p]`.
+ *
+ * @param i0,j first map-plane grid point
+ * @param n_points number of points
+ * @param result pointer to an allocated array of `n_points * weights.size()` `double`
+ */
+void IceModelVec2T::interp(int i0, int j, int n_points, double *result) {
+  assert(m_layout == POINT_MAJOR);
+
+  const std::vector<int>
+    &L = m_interp->left(),
+    &R = m_interp->right();
+  const std::vector<double> &alpha = m_interp->alpha();
+  const size_t N = alpha.size();
+
+  std::vector<double> buffer;
+  for (int p = 0; p < n_points; ++p) {
+    const double *f = time_series(point(i0 + p, j), buffer);
+
+    for (size_t k = 0; k < N; ++k) {
+      result[k * n_points + p] = f[L[k]] + alpha[k] * (f[R[k]] - f[L[k]]);
+    }
+  }
+}
+
+/*!
+ * Re-compute prefix integrals of buffered records.
+ *
+ * The integral number `k` is the integral of forcing from the time of the first buffered
+ * record to the time of the record `k`, using the interpolation type of this field.
+ */
+void IceModelVec2T::update_integrals() {
+  if (not m_exact_averages or m_N == 0) {
+    return;
+  }
+
+  const double *T = &m_time[m_first];
+  const bool piecewise_constant = m_interp_type == PIECEWISE_CONSTANT;
+
+  const size_t
+    n_points = m_grid->xm() * m_grid->ym(),
+    rs       = m_record_stride;
+
+  begin_access();
+  if (m_layout == POINT_MAJOR) {
+    for (size_t p = 0; p < n_points; ++p) {
+      const double *f = &m_records[index(p, 0)];
+      double *integral = &m_integrals[index(p, 0)];
+
+      integral[0] = 0.0;
+      for (unsigned int k = 1; k < m_N; ++k) {
+        const double h = T[k] - T[k - 1];
+        if (piecewise_constant) {
+          integral[k] = integral[k - 1] + f[k - 1] * h;
+        } else {
+          integral[k] = integral[k - 1] + 0.5 * (f[k - 1] + f[k]) * h;
+        }
+      }
+    }
+  } else {
+    // same computation, one record at a time
+    std::fill(m_integrals, m_integrals + n_points, 0.0);
+    for (unsigned int k = 1; k < m_N; ++k) {
+      const double
+        h       = T[k] - T[k - 1],
+        *f_prev = &m_records[(k - 1) * rs],
+        *f      = &m_records[k * rs],
+        *F_prev = &m_integrals[(k - 1) * rs];
+      double *F = &m_integrals[k * rs];
+
+      if (piecewise_constant) {
+        for (size_t p = 0; p < n_points; ++p) {
+          F[p] = F_prev[p] + f_prev[p] * h;
+        }
+      } else {
+        for (size_t p = 0; p < n_points; ++p) {
+          F[p] = F_prev[p] + 0.5 * (f_prev[p] + f[p]) * h;
+        }
+      }
+    }
+  }
+  end_access();
+}
+
+//! Coefficients of a linear combination of buffered values and their prefix integrals.
+struct IntegralTerms {
+  std::vector<int> value_index, integral_index;
+  std::vector<double> value_weight, integral_weight;
+
+  void value(int k, double weight) {
+    value_index.push_back(k);
+    value_weight.push_back(weight);
+  }
+
+  void integral(int k, double weight) {
+    integral_index.push_back(k);
+    integral_weight.push_back(weight);
+  }
+};
+
+//! Add `scale` times the integral of the linear interpolant from `T[k]` to `T[k] + s`.
+static void linear_segment(const double *T, unsigned int k, double s, double scale,
+                           IntegralTerms &result) {
+  const double h = T[k + 1] - T[k];
+
+  result.value(k, scale * (s - s * s / (2.0 * h)));
+  result.value(k + 1, scale * s * s / (2.0 * h));
+}
+
+/*!
+ * Add `scale` times the integral of (non-periodic) forcing from `T[0]` to `t`.
+ *
+ * Uses constant extrapolation outside of `[T[0], T[N - 1]]`.
+ */
+static void antiderivative(InterpolationType type, const double *T, unsigned int N,
+                           double t, double scale, IntegralTerms &result) {
+  if (t < T[0] or N == 1) {
+    result.value(0, scale * (t - T[0]));
+    return;
+  }
+
+  unsigned int k = gsl_interp_bsearch(T, t, 0, N);
+
+  result.integral(k, scale);
+
+  if (type == PIECEWISE_CONSTANT or k == N - 1) {
+    result.value(k, scale * (t - T[k]));
+  } else {
+    linear_segment(T, k, t - T[k], scale, result);
+  }
+}
+
+/*!
+ * Add `scale` times the integral of periodic forcing over `n` periods plus the integral
+ * over the part `tau` of a period.
+ *
+ * Integrals over a part of a period start at 0 for piecewise-constant forcing and at
+ * `T[N - 1] - period` (the left end of the interval connecting the last and the first
+ * record) for linear interpolation.
+ */
+static void periodic_antiderivative(InterpolationType type, const double *T, unsigned int N,
+                                    double tau, double n, double period, double scale,
+                                    IntegralTerms &result) {
+  if (type == PIECEWISE_CONSTANT) {
+    // the integral over one period
+    result.value(0, scale * n * T[0]);
+    result.integral(N - 1, scale * n);
+    result.value(N - 1, scale * n * (period - T[N - 1]));
+
+    if (tau < T[0]) {
+      result.value(0, scale * tau);
+    } else {
+      unsigned int k = gsl_interp_bsearch(T, tau, 0, N);
+
+      result.value(0, scale * T[0]);
+      result.integral(k, scale);
+      result.value(k, scale * (tau - T[k]));
+    }
+    return;
+  }
+
+  // linear interpolation; the interval from the last record to the first one has the
+  // length D
+  const double D = period - T[N - 1] + T[0];
+
+  if (tau >= T[N - 1]) {
+    tau -= period;
+    n += 1.0;
+  }
+
+  // the integral over one period
+  result.value(N - 1, scale * n * 0.5 * D);
+  result.value(0, scale * n * 0.5 * D);
+  result.integral(N - 1, scale * n);
+
+  if (tau < T[0]) {
+    const double s = tau - (T[N - 1] - period);
+
+    result.value(N - 1, scale * (s - s * s / (2.0 * D)));
+    result.value(0, scale * s * s / (2.0 * D));
+  } else {
+    unsigned int k = gsl_interp_bsearch(T, tau, 0, N);
+
+    result.value(N - 1, scale * 0.5 * D);
+    result.value(0, scale * 0.5 * D);
+    result.integral(k, scale);
+    linear_segment(T, k, tau - T[k], scale, result);
+  }
+}
+
+/*!
+ * Compute the exact average over `[t, t + dt]` using prefix integrals.
+ *
+ * The average is computed as the difference of two values of the antiderivative of
+ * forcing divided by `dt`. Each value is a combination of a few buffered values and
+ * prefix integrals, so the cost per grid point does not depend on `dt`.
+ */
+void IceModelVec2T::average_exact(double t, double dt) {
+  assert(m_first >= 0);
+
+  const double *T = &m_time[m_first];
+
+  IntegralTerms terms;
+  if (m_period != 0) {
+    auto time = m_grid->ctx()->time();
+
+    double period = time->years_to_seconds(m_period);
+
+    std::vector<double> times = {t + dt, t}, scales = {1.0 / dt, -1.0 / dt};
+    for (unsigned int k = 0; k < 2; ++k) {
+      double
+        x   = times[k] - m_reference_time,
+        tau = time->mod(x, m_period),
+        n   = std::round((x - tau) / period);
+
+      periodic_antiderivative(m_interp_type, T, m_N, tau, n, period, scales[k], terms);
+    }
+  } else {
+    antiderivative(m_interp_type, T, m_N, t + dt, 1.0 / dt, terms);
+    antiderivative(m_interp_type, T, m_N, t, -1.0 / dt, terms);
+  }
+
+  const unsigned int
+    n_values    = terms.value_index.size(),
+    n_integrals = terms.integral_index.size();
+
+  double **a2 = get_array();         // calls begin_access()
+
+  if (m_layout == POINT_MAJOR) {
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      const double
+        *f        = &m_records[index(point(i, j), 0)],
+        *integral = &m_integrals[index(point(i, j), 0)];
+
+      double result = 0.0;
+      for (unsigned int k = 0; k < n_values; ++k) {
+        result += terms.value_weight[k] * f[terms.value_index[k]];
+      }
+      for (unsigned int k = 0; k < n_integrals; ++k) {
+        result += terms.integral_weight[k] * integral[terms.integral_index[k]];
+      }
+      a2[j][i] = result;
+    }
+  } else {
+    // add terms one at a time (in the same order as above)
+    const size_t n_points = m_grid->xm() * m_grid->ym();
+    std::vector<double> result(n_points, 0.0);
+
+    for (unsigned int k = 0; k < n_values; ++k) {
+      const double
+        w  = terms.value_weight[k],
+        *f = &m_records[index(0, terms.value_index[k])];
+      for (size_t p = 0; p < n_points; ++p) {
+        result[p] += w * f[p];
+      }
+    }
+    for (unsigned int k = 0; k < n_integrals; ++k) {
+      const double
+        w  = terms.integral_weight[k],
+        *F = &m_integrals[index(0, terms.integral_index[k])];
+      for (size_t p = 0; p < n_points; ++p) {
+        result[p] += w * F[p];
+      }
+    }
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+      a2[j][i] = result[point(i, j)];
+    }
+  }
+  end_access();
 }
 
 //! \brief Finds the average value at i,j over the interval (t, t +
@@ -590,8 +1249,7 @@ double IceModelVec2T::average(int i, int j) {
   double result = 0.0;
 
   if (m_N == 1) {
-    double ***a3 = (double***) m_array3;
-    result = a3[j][i][0];
+    result = value(point(i, j), 0);
   } else {
     std::vector<double> values(M);
 
@@ -19,11 +19,19 @@
 #ifndef __IceModelVec2T_hh
 #define __IceModelVec2T_hh
 
+#include <memory>
+#include <vector>
+#include <cstdint>              // int16_t
+
 #include "iceModelVec.hh"
 #include "MaxTimestep.hh"
 
 namespace pism {
 
+namespace io {
+class NodeSharedBuffer;
+}
+
 //! A class for storing and accessing 2D time-series (for climate forcing)
 /*! This class was created to read time-dependent and spatially-varying climate
   forcing data, in particular snow temperatures and precipitation.
@@ -39,11 +47,53 @@ namespace pism {
 
   Both versions of interp() use piecewise-constant interpolation and
   extrapolate (by a constant) outside the available range.
+
+  If `input.forcing.exact_averages` is set, this class also stores integrals of the
+  forcing from the time of the first buffered record to the time of each buffered record
+  ("prefix integrals"). Then average() computes exact averages of the interpolated
+  forcing using a few values per grid point, independently of the length of the
+  averaging interval.
+
+  If `input.forcing.node_shared_cache` is set, each record is read once per compute node
+  and shared by all ranks on the node (see io::NodeSharedBuffer).
+
+  Buffered records can be stored in two ways (see RecordLayout). Time series at grid
+  points (interp(i, j, ...)) need POINT_MAJOR storage, while 2D fields at a given time
+  (interp(t) and average()) are computed faster using RECORD_MAJOR storage. If
+  `input.forcing.record_major` is set, records are stored RECORD_MAJOR until a call to
+  init_interpolation() (which precedes calls to interp(i, j, ...)) switches this field to
+  POINT_MAJOR storage. The choice of storage does not affect results.
+
+  If `input.forcing.buffer_compression` is "float32" or "int16", buffered records are
+  stored as single precision numbers or as 16-bit integers with an offset and a scale
+  per record (see Compression) and decompressed when used. This reduces the memory used
+  by forcing buffers by a factor of 2 or 4 (ForcingField() allocates correspondingly
+  more records for non-periodic fields), at the cost of the precision of forcing.
+  Compressed buffers cannot be combined with `input.forcing.exact_averages`.
 */
 class IceModelVec2T : public IceModelVec2S {
 public:
   typedef std::shared_ptr<IceModelVec2T> Ptr;
 
+  //! Storage order of buffered records.
+  enum RecordLayout {
+    //! all records at a grid point are stored together (time series are contiguous)
+    POINT_MAJOR,
+    //! all grid points of a record are stored together (records are contiguous)
+    RECORD_MAJOR
+  };
+
+  //! Storage type of buffered records.
+  enum Compression {
+    //! double precision
+    NONE,
+    //! single precision
+    FLOAT32,
+    //! 16-bit integers `n` (value = offset + scale * n, with offset and scale computed
+    //! for each record using its local range)
+    INT16
+  };
+
   static Ptr ForcingField(IceGrid::ConstPtr grid,
                           const File &file,
                           const std::string &short_name,
@@ -65,24 +115,50 @@ public:
 
   void update(double t, double dt);
   MaxTimestep max_timestep(double t) const;
+  int constant_record(double t, double dt) const;
 
   void interp(double t);
 
   void interp(int i, int j, std::vector<double> &results);
 
+  void interp(int i0, int j, int n_points, double *results);
+
   void average(double t, double dt);
 
   void begin_access() const;
   void end_access() const;
   void init_interpolation(const std::vector<double> &ts);
 
+  RecordLayout layout() const;
+  void set_layout(RecordLayout layout);
+
 private:
   std::vector<double> m_time,             //!< all the times available in filename
     m_time_bounds;                //!< time bounds
   std::string m_filename;         //!< file to read (regrid) from
   petsc::DM::Ptr m_da3;
   petsc::Vec m_v3;                       //!< a 3D Vec used to store records
-  mutable void ***m_array3;
+  mutable double *m_records;
+
+  //! true if average() should use prefix integrals (see update_integrals())
+  bool m_exact_averages;
+  //! prefix integrals of buffered records (allocated if m_exact_averages is set)
+  petsc::Vec m_v3_integral;
+  mutable double *m_integrals;
+
+  //! storage order of m_v3 and m_v3_integral
+  RecordLayout m_layout;
+  //! distance between values of a record at neighboring grid points
+  size_t m_point_stride;
+  //! distance between values of neighboring records at a grid point
+  size_t m_record_stride;
+
+  //! memory used by m_v3 and m_v3_integral
+  MemoryRecord m_buffer_memory;
+
+  //! buffer used to read each record once per node (if `input.forcing.node_shared_cache`
+  //! is set)
+  std::unique_ptr<io::NodeSharedBuffer> m_node_buffer;
 
   //! maximum number of records to store in memory
   unsigned int m_n_records;
@@ -102,10 +178,53 @@ private:
   unsigned int m_period;        // in years
   double m_reference_time;      // in seconds
 
-  double*** get_array3();
+  //! true if forcing data should be read a few records at a time (see update())
+  bool m_read_ahead;
+
+  //! storage type of buffered records (m_v3 is not allocated if records are compressed)
+  Compression m_compression;
+  //! buffered records (if m_compression == FLOAT32)
+  std::vector<float> m_records_float;
+  //! buffered records (if m_compression == INT16)
+  std::vector<int16_t> m_records_int16;
+  //! offsets and scales of buffered records (if m_compression == INT16)
+  std::vector<double> m_record_offset, m_record_scale;
+
+  //! Index of the grid point (i, j) in the list of owned grid points.
+  size_t point(int i, int j) const {
+    return (j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs());
+  }
+
+  //! Index of the value of the record `k` at the grid point number `p` (see point()).
+  size_t index(size_t p, unsigned int k) const {
+    return p * m_point_stride + k * m_record_stride;
+  }
+
+  //! Value of the record `k` at the grid point number `p`.
+  double value(size_t p, unsigned int k) const {
+    const size_t n = index(p, k);
+    switch (m_compression) {
+    case FLOAT32:
+      return m_records_float[n];
+    case INT16:
+      return m_record_offset[k] + m_record_scale[k] * m_records_int16[n];
+    case NONE:
+    default:
+      return m_records[n];
+    }
+  }
+
+  void store_record(unsigned int k, const double *values);
+  const double* record(unsigned int k, std::vector<double> &buffer) const;
+  const double* time_series(size_t p, std::vector<double> &buffer) const;
+
+  void set_strides();
+  void init_interpolation_impl(const std::vector<double> &ts);
   void update(unsigned int start);
   void discard(int N);
   double average(int i, int j);
+  void average_exact(double t, double dt);
+  void update_integrals();
   void set_record(int n);
   void get_record(int n);
 };
@@ -22,6 +22,8 @@
 
 #include <memory>
 using std::dynamic_pointer_cast;
+#include <vector>
+#include <algorithm>            // std::min, std::max
 
 #include <petscdmda.h>
 
@@ -30,6 +32,7 @@ using std::dynamic_pointer_cast;
 #include "ConfigInterface.hh"
 
 #include "error_handling.hh"
+#include "pism_utilities.hh"
 
 namespace pism {
 
@@ -94,6 +97,9 @@ void IceModelVec3D::allocate(IceGrid::ConstPtr grid, const std::string &name,
     PISM_CHK(ierr, "DMCreateGlobalVector");
   }
 
+  record_memory_use();
+  setup_halo_exchange();
+
   m_name = name;
 
   m_metadata.push_back(SpatialVariableMetadata(m_grid->ctx()->unit_system(),
@@ -310,4 +316,181 @@ void IceModelVec3::sumColumns(IceModelVec2S &output, double A, double B) const {
   }
 }
 
+//! Range of grid indexes `[begin, end)` of owned (`ghost == false`) or ghost points
+//! adjacent to the side `direction` (-1, 0, 1) of a sub-domain starting at `start` and
+//! containing `size` points.
+static void halo_range(int start, int size, int width, int direction, bool ghost,
+                       int &begin, int &end) {
+  if (direction == 0) {
+    begin = start;
+    end   = start + size;
+  } else if (direction < 0) {
+    begin = ghost ? start - width : start;
+    end   = begin + width;
+  } else {
+    begin = ghost ? start + size : start + size - width;
+    end   = begin + width;
+  }
+}
+
+//! Update ghosts, exchanging only levels in (and just above) the ice.
+/*!
+ * The number of levels sent for a column is set by the thickest ice in the 3x3
+ * neighborhood of this column (plus one level above the surface), so computations that
+ * use a stencil of width 1 and do not look above the ice surface (e.g. upwinding in the
+ * energy balance and age models) get all the values they need. Remaining levels in ghost
+ * columns are *not* updated.
+ *
+ * `ice_thickness` has to have up to date ghosts (stencil width of at least 1).
+ *
+ * Columns are packed into one message per neighboring sub-domain. The number of levels
+ * in a column is included in the message, so senders and receivers do not have to agree
+ * on it in advance.
+ */
+void IceModelVec3::update_ghosts_in_ice(const IceModelVec2S &ice_thickness) {
+  if (not m_has_ghosts) {
+    return;
+  }
+
+  PetscErrorCode ierr;
+
+  // ranks of neighboring sub-domains (and this one) in the order (dx, dy) = (-1, -1),
+  // (0, -1), (1, -1), (-1, 0), ... (1, 1)
+  const PetscMPIInt *neighbors = NULL;
+  ierr = DMDAGetNeighbors(*m_da, &neighbors);
+  PISM_CHK(ierr, "DMDAGetNeighbors");
+
+  const int
+    width = m_da_stencil_width,
+    Mz    = m_grid->Mz(),
+    xs    = m_grid->xs(),
+    xm    = m_grid->xm(),
+    ys    = m_grid->ys(),
+    ym    = m_grid->ym();
+  const double Lz = m_grid->Lz();
+
+  MPI_Comm com = m_grid->com;
+
+  AccessList list{this, &ice_thickness};
+
+  // pack and send
+  std::vector<std::vector<double> > send_buffer(9);
+  std::vector<MPI_Request> requests;
+  for (int n = 0; n < 9; ++n) {
+    if (n == 4 or neighbors[n] < 0) {
+      continue;
+    }
+    int i_begin, i_end, j_begin, j_end;
+    halo_range(xs, xm, width, n % 3 - 1, false, i_begin, i_end);
+    halo_range(ys, ym, width, n / 3 - 1, false, j_begin, j_end);
+
+    std::vector<double> &buffer = send_buffer[n];
+    for (int j = j_begin; j < j_end; ++j) {
+      for (int i = i_begin; i < i_end; ++i) {
+        double H = 0.0;
+        for (int jj = j - 1; jj <= j + 1; ++jj) {
+          for (int ii = i - 1; ii <= i + 1; ++ii) {
+            H = std::max(H, ice_thickness(ii, jj));
+          }
+        }
+        const int N = std::min((int)m_grid->kBelowHeight(std::min(H, Lz)) + 2, Mz);
+
+        const double *column = get_column(i, j);
+        buffer.push_back(N);
+        buffer.insert(buffer.end(), column, column + N);
+      }
+    }
+
+    MPI_Request request;
+    MPI_Isend(buffer.data(), buffer.size(), MPI_DOUBLE, neighbors[n], n, com, &request);
+    requests.push_back(request);
+  }
+
+  // receive and unpack
+  std::vector<double> buffer;
+  for (int n = 0; n < 9; ++n) {
+    if (n == 4 or neighbors[n] < 0) {
+      continue;
+    }
+    // the neighbor in the direction n sent this message in the opposite direction
+    const int tag = 8 - n;
+
+    MPI_Status status;
+    MPI_Probe(neighbors[n], tag, com, &status);
+    int size = 0;
+    MPI_Get_count(&status, MPI_DOUBLE, &size);
+
+    buffer.resize(size);
+    MPI_Recv(buffer.data(), size, MPI_DOUBLE, neighbors[n], tag, com, MPI_STATUS_IGNORE);
+
+    int i_begin, i_end, j_begin, j_end;
+    halo_range(xs, xm, width, n % 3 - 1, true, i_begin, i_end);
+    halo_range(ys, ym, width, n / 3 - 1, true, j_begin, j_end);
+
+    const double *data = buffer.data();
+    for (int j = j_begin; j < j_end; ++j) {
+      for (int i = i_begin; i < i_end; ++i) {
+        const int N = *data;
+        std::copy(data + 1, data + 1 + N, get_column(i, j));
+        data += N + 1;
+      }
+    }
+  }
+
+  MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+  inc_state_counter();
+}
+
+//! Copy values at owned points to `destination` and update its ghosts in the ice (see
+//! update_ghosts_in_ice()).
+void IceModelVec3::update_ghosts_in_ice(const IceModelVec2S &ice_thickness,
+                                        IceModelVec3 &destination) const {
+  {
+    AccessList list{this, &destination};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      destination.set_column(i, j, get_column(i, j));
+    }
+  }
+
+  destination.update_ghosts_in_ice(ice_thickness);
+}
+
+IceGhostsUpdater::IceGhostsUpdater(IceGrid::ConstPtr grid)
+  : m_ice_thickness(grid, "ice_thickness_at_last_exchange", WITHOUT_GHOSTS),
+    m_state(-1) {
+  m_ice_thickness.set(0.0);
+}
+
+/*!
+ * The exchange has to use the ice thickness at the time the ghosts are *used*: the ice
+ * extent may change between the time a field is computed and the time it is used.
+ */
+void IceGhostsUpdater::update(const IceModelVec2S &ice_thickness, IceModelVec3 &field) {
+  int changed = field.state_counter() != m_state;
+
+  {
+    AccessList list{&ice_thickness, &m_ice_thickness};
+
+    for (Points p(*ice_thickness.grid()); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (ice_thickness(i, j) != m_ice_thickness(i, j)) {
+        changed = 1;
+        m_ice_thickness(i, j) = ice_thickness(i, j);
+      }
+    }
+  }
+
+  if (GlobalMax(ice_thickness.grid()->com, changed) == 0) {
+    return;
+  }
+
+  field.update_ghosts_in_ice(ice_thickness);
+  m_state = field.state_counter();
+}
+
 } // end of namespace pism
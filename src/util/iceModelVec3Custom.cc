@@ -54,6 +54,8 @@ IceModelVec3Custom::IceModelVec3Custom(IceGrid::ConstPtr grid,
   PetscErrorCode ierr = DMCreateGlobalVector(*m_da, m_v.rawptr());
   PISM_CHK(ierr, "DMCreateGlobalVector");
 
+  record_memory_use();
+
   m_metadata.push_back(SpatialVariableMetadata(m_grid->ctx()->unit_system(),
                                                m_name, m_zlevels));
   m_metadata[0].get_z().set_name(z_name);
@@ -63,6 +65,28 @@ IceModelVec3Custom::IceModelVec3Custom(IceGrid::ConstPtr grid,
   }
 }
 
+/**
+ * Allocate storage (possibly with ghosts) for a work array using "vertical" levels
+ * `z_levels`.
+ *
+ * @param grid grid to use
+ * @param name name of the NetCDF variable
+ * @param z_name name of the NetCDF dimension and variable corresponding to the third dimension
+ * @param z_levels "vertical" levels (values of z)
+ * @param ghostedp whether to allocate ghosts
+ * @param stencil_width stencil width (ignored if `ghostedp` is WITHOUT_GHOSTS)
+ */
+IceModelVec3Custom::IceModelVec3Custom(IceGrid::ConstPtr grid,
+                                       const std::string &name,
+                                       const std::string &z_name,
+                                       const std::vector<double> &z_levels,
+                                       IceModelVecKind ghostedp,
+                                       unsigned int stencil_width) {
+  allocate(grid, name, ghostedp, z_levels, stencil_width);
+
+  m_metadata[0].get_z().set_name(z_name);
+}
+
 IceModelVec3Custom::~IceModelVec3Custom() {
   // empty
 }
@@ -43,6 +43,12 @@ public:
                      const std::string &z_name,
                      const std::vector<double> &my_zlevels,
                      const std::map<std::string, std::string> &z_attrs);
+  IceModelVec3Custom(IceGrid::ConstPtr mygrid,
+                     const std::string &short_name,
+                     const std::string &z_name,
+                     const std::vector<double> &my_zlevels,
+                     IceModelVecKind ghostedp,
+                     unsigned int stencil_width = 1);
   virtual ~IceModelVec3Custom();
 
   typedef std::shared_ptr<IceModelVec3Custom> Ptr;
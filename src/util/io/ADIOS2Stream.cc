@@ -0,0 +1,480 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "ADIOS2Stream.hh"
+
+#include <algorithm>
+#include <memory>
+
+#include <adios2.h>
+
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+struct StreamAttribute {
+  std::string name;
+  IO_Type type;
+  std::vector<double> numbers;
+  std::string text;
+};
+
+struct StreamVariable {
+  std::string name;
+  IO_Type type;
+  std::vector<std::string> dimensions;
+  std::vector<StreamAttribute> attributes;
+};
+
+static StreamAttribute* find_attribute(std::vector<StreamAttribute> &attributes,
+                                       const std::string &name) {
+  for (auto &a : attributes) {
+    if (a.name == name) {
+      return &a;
+    }
+  }
+  return nullptr;
+}
+
+struct ADIOS2Stream::Impl {
+  Impl()
+    : in_step(false), record(-1), distributed(false) {
+    // empty
+  }
+
+  std::unique_ptr<adios2::ADIOS> adios;
+  adios2::IO io;
+  adios2::Engine engine;
+
+  //! names and lengths of dimensions
+  std::vector<std::pair<std::string, unsigned int> > dimensions;
+  //! name of the unlimited dimension (empty if there is none)
+  std::string unlimited;
+  //! variables, in the order they were defined
+  std::vector<StreamVariable> variables;
+  //! global attributes
+  std::vector<StreamAttribute> attributes;
+
+  //! true if an ADIOS2 step is open
+  bool in_step;
+  //! the record published in the current (or the last) step
+  int record;
+  //! true while writing a distributed array (see write_darray_impl())
+  bool distributed;
+
+  StreamVariable& variable(const std::string &name) {
+    for (auto &v : variables) {
+      if (v.name == name) {
+        return v;
+      }
+    }
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' not found",
+                                  name.c_str());
+  }
+
+  unsigned int* find_dimension(const std::string &name) {
+    for (auto &d : dimensions) {
+      if (d.first == name) {
+        return &d.second;
+      }
+    }
+    return nullptr;
+  }
+
+  std::vector<StreamAttribute>& attributes_of(const std::string &variable_name) {
+    if (variable_name == "PISM_GLOBAL") {
+      return attributes;
+    }
+    return variable(variable_name).attributes;
+  }
+
+  void begin_step(int new_record);
+  void end_step();
+  void publish(const StreamAttribute &attribute, const std::string &variable_name);
+  void set_attribute(const std::string &variable_name, const StreamAttribute &attribute);
+};
+
+//! Make sure a step is open, ending the current one if `new_record` is past the current
+//! record. Use `new_record == -1` for variables that do not depend on time.
+void ADIOS2Stream::Impl::begin_step(int new_record) {
+  if (in_step and record >= 0 and new_record > record) {
+    end_step();
+  }
+
+  if (not in_step) {
+    engine.BeginStep();
+    in_step = true;
+  }
+
+  record = std::max(record, new_record);
+}
+
+void ADIOS2Stream::Impl::end_step() {
+  if (in_step) {
+    engine.EndStep();
+    in_step = false;
+  }
+}
+
+//! Define (or re-define) an ADIOS2 attribute. It is sent to consumers with the next step.
+void ADIOS2Stream::Impl::publish(const StreamAttribute &attribute,
+                                 const std::string &variable_name) {
+  const std::string var = variable_name == "PISM_GLOBAL" ? "" : variable_name;
+  const bool allow_modification = true;
+
+  if (attribute.type == PISM_CHAR) {
+    io.DefineAttribute<std::string>(attribute.name, attribute.text, var, "/",
+                                    allow_modification);
+  } else if (attribute.numbers.size() == 1) {
+    io.DefineAttribute<double>(attribute.name, attribute.numbers[0], var, "/",
+                               allow_modification);
+  } else if (not attribute.numbers.empty()) {
+    io.DefineAttribute<double>(attribute.name, attribute.numbers.data(),
+                               attribute.numbers.size(), var, "/", allow_modification);
+  }
+}
+
+/*!
+ * Attributes of a variable are published when the variable is written for the first time
+ * (ADIOS2 variables are defined at that point); global attributes right away.
+ */
+void ADIOS2Stream::Impl::set_attribute(const std::string &variable_name,
+                                       const StreamAttribute &attribute) {
+  auto &list = attributes_of(variable_name);
+
+  StreamAttribute *a = find_attribute(list, attribute.name);
+  if (a == nullptr) {
+    list.push_back(attribute);
+  } else {
+    *a = attribute;
+  }
+
+  if (variable_name == "PISM_GLOBAL" or io.InquireVariable<double>(variable_name)) {
+    publish(attribute, variable_name);
+  }
+}
+
+ADIOS2Stream::ADIOS2Stream(MPI_Comm c)
+  : NCFile(c), m_impl(new Impl) {
+  // empty
+}
+
+ADIOS2Stream::~ADIOS2Stream() {
+  delete m_impl;
+}
+
+void ADIOS2Stream::open_impl(const std::string &filename, IO_Mode mode) {
+  (void) mode;
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot open '%s': ADIOS2 streams are write-only"
+                                " and cannot be re-opened", filename.c_str());
+}
+
+void ADIOS2Stream::create_impl(const std::string &filename) {
+  const std::string name = filename.substr(4); // strip "sst:"
+
+  m_impl->adios.reset(new adios2::ADIOS(m_com));
+  m_impl->io = m_impl->adios->DeclareIO(name);
+  m_impl->io.SetEngine("SST");
+  // Do not wait for a consumer to connect and do not block when consumers fall behind:
+  // discard queued steps instead.
+  m_impl->io.SetParameters({{"RendezvousReaderCount", "0"},
+                            {"QueueLimit", "4"},
+                            {"QueueFullPolicy", "Discard"}});
+  m_impl->engine = m_impl->io.Open(name, adios2::Mode::Write);
+}
+
+void ADIOS2Stream::sync_impl() const {
+  // publish the current record
+  m_impl->end_step();
+}
+
+void ADIOS2Stream::close_impl() {
+  m_impl->end_step();
+  m_impl->engine.Close();
+  m_impl->adios.reset();
+}
+
+void ADIOS2Stream::enddef_impl() const {
+  // empty
+}
+
+void ADIOS2Stream::redef_impl() const {
+  // empty
+}
+
+void ADIOS2Stream::def_dim_impl(const std::string &name, size_t length) const {
+  if (m_impl->find_dimension(name) != nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "dimension '%s' already exists",
+                                  name.c_str());
+  }
+
+  if (length == PISM_UNLIMITED) {
+    m_impl->unlimited = name;
+  }
+  m_impl->dimensions.push_back({name, (unsigned int)length});
+}
+
+void ADIOS2Stream::inq_dimid_impl(const std::string &dimension_name, bool &exists) const {
+  exists = m_impl->find_dimension(dimension_name) != nullptr;
+}
+
+void ADIOS2Stream::inq_dimlen_impl(const std::string &dimension_name,
+                                   unsigned int &result) const {
+  unsigned int *length = m_impl->find_dimension(dimension_name);
+  if (length == nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "dimension '%s' not found",
+                                  dimension_name.c_str());
+  }
+  result = *length;
+}
+
+void ADIOS2Stream::inq_unlimdim_impl(std::string &result) const {
+  result = m_impl->unlimited;
+}
+
+void ADIOS2Stream::def_var_impl(const std::string &name, IO_Type nctype,
+                                const std::vector<std::string> &dims) const {
+  bool exists = false;
+  inq_varid_impl(name, exists);
+  if (exists) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' already exists",
+                                  name.c_str());
+  }
+
+  for (const auto &d : dims) {
+    if (m_impl->find_dimension(d) == nullptr) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "cannot define '%s': dimension '%s' not found",
+                                    name.c_str(), d.c_str());
+    }
+  }
+
+  StreamVariable var;
+  var.name       = name;
+  var.type       = nctype;
+  var.dimensions = dims;
+
+  m_impl->variables.push_back(var);
+}
+
+void ADIOS2Stream::get_vara_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        double *ip) const {
+  (void) start;
+  (void) count;
+  (void) ip;
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot read '%s': ADIOS2 streams are write-only",
+                                variable_name.c_str());
+}
+
+void ADIOS2Stream::get_varm_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        const std::vector<unsigned int> &imap,
+                                        double *ip) const {
+  (void) imap;
+  get_vara_double_impl(variable_name, start, count, ip);
+}
+
+/*!
+ * Publishes the hyperslab (`start`, `count`) of `variable_name`.
+ *
+ * The unlimited dimension is not a dimension of ADIOS2 variables: each record is a
+ * separate step. Distributed arrays are written by all ranks; other variables are written
+ * by rank 0 only, since all ranks pass the same values.
+ */
+void ADIOS2Stream::put_vara_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        const double *op) const {
+  const StreamVariable &var = m_impl->variable(variable_name);
+  const size_t ndims = var.dimensions.size();
+
+  if (start.size() < ndims or count.size() < ndims) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "writing '%s': start and count have to have %d elements",
+                                  variable_name.c_str(), (int)ndims);
+  }
+
+  const bool time_dependent = (ndims > 0 and not m_impl->unlimited.empty() and
+                               var.dimensions[0] == m_impl->unlimited);
+
+  if (time_dependent and count[0] != 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "writing '%s': ADIOS2 streams support writing one record"
+                                  " at a time", variable_name.c_str());
+  }
+
+  const int record = time_dependent ? (int)start[0] : -1;
+
+  m_impl->begin_step(record);
+
+  if (time_dependent) {
+    unsigned int &length = *m_impl->find_dimension(m_impl->unlimited);
+    length = std::max(length, start[0] + 1);
+  }
+
+  adios2::Dims shape, adios_start, adios_count;
+  for (size_t d = time_dependent ? 1 : 0; d < ndims; ++d) {
+    shape.push_back(*m_impl->find_dimension(var.dimensions[d]));
+    adios_start.push_back(start[d]);
+    adios_count.push_back(count[d]);
+  }
+
+  adios2::Variable<double> v = m_impl->io.InquireVariable<double>(variable_name);
+  if (not v) {
+    if (shape.empty()) {
+      v = m_impl->io.DefineVariable<double>(variable_name);
+    } else {
+      v = m_impl->io.DefineVariable<double>(variable_name, shape, adios_start, adios_count);
+    }
+    for (const auto &a : var.attributes) {
+      m_impl->publish(a, variable_name);
+    }
+  }
+
+  int rank = 0;
+  MPI_Comm_rank(m_com, &rank);
+
+  if (m_impl->distributed or rank == 0) {
+    if (not shape.empty()) {
+      v.SetSelection({adios_start, adios_count});
+    }
+    m_impl->engine.Put(v, op, adios2::Mode::Sync);
+  }
+}
+
+void ADIOS2Stream::write_darray_impl(const std::string &variable_name,
+                                     const IceGrid &grid,
+                                     unsigned int z_count,
+                                     unsigned int record,
+                                     const double *input) {
+  m_impl->distributed = true;
+  try {
+    NCFile::write_darray_impl(variable_name, grid, z_count, record, input);
+  } catch (...) {
+    m_impl->distributed = false;
+    throw;
+  }
+  m_impl->distributed = false;
+}
+
+void ADIOS2Stream::inq_nvars_impl(int &result) const {
+  result = m_impl->variables.size();
+}
+
+void ADIOS2Stream::inq_vardimid_impl(const std::string &variable_name,
+                                     std::vector<std::string> &result) const {
+  result = m_impl->variable(variable_name).dimensions;
+}
+
+void ADIOS2Stream::inq_varnatts_impl(const std::string &variable_name, int &result) const {
+  result = m_impl->attributes_of(variable_name).size();
+}
+
+void ADIOS2Stream::inq_varid_impl(const std::string &variable_name, bool &exists) const {
+  exists = false;
+  for (const auto &v : m_impl->variables) {
+    if (v.name == variable_name) {
+      exists = true;
+      break;
+    }
+  }
+}
+
+void ADIOS2Stream::inq_varname_impl(unsigned int j, std::string &result) const {
+  if (j >= m_impl->variables.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid variable index: %d", (int)j);
+  }
+  result = m_impl->variables[j].name;
+}
+
+void ADIOS2Stream::get_att_double_impl(const std::string &variable_name,
+                                       const std::string &att_name,
+                                       std::vector<double> &result) const {
+  StreamAttribute *a = find_attribute(m_impl->attributes_of(variable_name), att_name);
+  result = a != nullptr ? a->numbers : std::vector<double>();
+}
+
+void ADIOS2Stream::get_att_text_impl(const std::string &variable_name,
+                                     const std::string &att_name,
+                                     std::string &result) const {
+  StreamAttribute *a = find_attribute(m_impl->attributes_of(variable_name), att_name);
+  result = a != nullptr ? a->text : std::string();
+}
+
+void ADIOS2Stream::put_att_double_impl(const std::string &variable_name,
+                                       const std::string &att_name,
+                                       IO_Type xtype, const std::vector<double> &data) const {
+  StreamAttribute a;
+  a.name    = att_name;
+  a.type    = xtype;
+  a.numbers = data;
+
+  m_impl->set_attribute(variable_name, a);
+}
+
+void ADIOS2Stream::put_att_text_impl(const std::string &variable_name,
+                                     const std::string &att_name,
+                                     const std::string &value) const {
+  StreamAttribute a;
+  a.name = att_name;
+  a.type = PISM_CHAR;
+  a.text = value;
+
+  m_impl->set_attribute(variable_name, a);
+}
+
+void ADIOS2Stream::inq_attname_impl(const std::string &variable_name, unsigned int n,
+                                    std::string &result) const {
+  auto &attributes = m_impl->attributes_of(variable_name);
+  if (n >= attributes.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid attribute index: %d", (int)n);
+  }
+  result = attributes[n].name;
+}
+
+void ADIOS2Stream::inq_atttype_impl(const std::string &variable_name,
+                                    const std::string &att_name,
+                                    IO_Type &result) const {
+  StreamAttribute *a = find_attribute(m_impl->attributes_of(variable_name), att_name);
+  result = a != nullptr ? a->type : PISM_NAT;
+}
+
+void ADIOS2Stream::set_fill_impl(int fillmode, int &old_modep) const {
+  (void) fillmode;
+  old_modep = PISM_NOFILL;
+}
+
+void ADIOS2Stream::del_att_impl(const std::string &variable_name,
+                                const std::string &att_name) const {
+  // ADIOS2 attributes cannot be removed: consumers that saw this attribute keep it
+  auto &attributes = m_impl->attributes_of(variable_name);
+  attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                  [&att_name](const StreamAttribute &a) {
+                                    return a.name == att_name;
+                                  }),
+                   attributes.end());
+}
+
+} // end of namespace io
+} // end of namespace pism
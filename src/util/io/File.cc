@@ -19,6 +19,8 @@
 #include <cassert>
 #include <cstdio>
 #include <memory>
+#include <map>
+#include <set>
 using std::shared_ptr;
 
 #include <petscvec.h>
@@ -30,6 +32,12 @@ using std::shared_ptr;
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/Time.hh"
 #include "NC3File.hh"
+#include "NC3Aggregated.hh"
+#include "NC3Async.hh"
+#include "NC3Checkpoint.hh"
+#include "InMemoryFile.hh"
+#include "InputStaging.hh"
+#include "ADIOS2Stream.hh"
 
 #include "pism/pism_config.hh"
 
@@ -53,6 +61,21 @@ namespace pism {
 struct File::Impl {
   MPI_Comm com;
   IO_Backend backend;
+  IO_Chunking chunking;
+  //! numbers of significant digits to keep, per variable ("" is the default)
+  std::map<std::string, int> significant_digits;
+  //! output types overriding defaults, per variable
+  std::map<std::string, IO_Type> output_types;
+  //! 3D variables written using "compression by gathering" (see set_ice_columns())
+  std::set<std::string> gathered_variables;
+  //! numbers of levels to write in local columns (0 if a column is not written)
+  std::vector<int> ice_column_levels;
+  //! true if this file is a checkpoint (see set_checkpoint())
+  bool checkpoint;
+  //! name of the base checkpoint (empty if this file is a base checkpoint)
+  std::string checkpoint_base;
+  //! checksums of variables in the base checkpoint and in this file
+  std::map<std::string, std::string> base_checksums, checksums;
   io::NCFile::Ptr nc;
 };
 
@@ -60,6 +83,15 @@ IO_Backend string_to_backend(const std::string &backend) {
   if (backend == "netcdf3") {
     return PISM_NETCDF3;
   }
+  if (backend == "netcdf3_aggregated") {
+    return PISM_NETCDF3_AGGREGATED;
+  }
+  if (backend == "netcdf3_async") {
+    return PISM_NETCDF3_ASYNC;
+  }
+  if (backend == "checkpoint") {
+    return PISM_CHECKPOINT;
+  }
   if (backend == "netcdf4_parallel") {
     return PISM_NETCDF4_PARALLEL;
   }
@@ -82,10 +114,53 @@ IO_Backend string_to_backend(const std::string &backend) {
                                 "unknown or unsupported I/O backend: %s", backend.c_str());
 }
 
+IO_Chunking string_to_chunking(const std::string &policy) {
+  if (policy == "default") {
+    return PISM_CHUNKING_DEFAULT;
+  }
+  if (policy == "decomposition") {
+    return PISM_CHUNKING_DECOMPOSITION;
+  }
+  if (policy == "tiles") {
+    return PISM_CHUNKING_TILES;
+  }
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "unknown chunking policy: %s", policy.c_str());
+}
+
+IO_Type string_to_type(const std::string &type) {
+  if (type == "byte") {
+    return PISM_BYTE;
+  }
+  if (type == "short") {
+    return PISM_SHORT;
+  }
+  if (type == "int") {
+    return PISM_INT;
+  }
+  if (type == "float") {
+    return PISM_FLOAT;
+  }
+  if (type == "double") {
+    return PISM_DOUBLE;
+  }
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "unknown output type: %s", type.c_str());
+}
+
+//! Returns true if files read using `backend` can be read from local copies (see
+//! io::InputStaging).
+static bool staging_supported(IO_Backend backend) {
+  // in-memory files and streams are not files; checkpoints refer to separate data files
+  return not (backend == PISM_IN_MEMORY or
+              backend == PISM_ADIOS2_SST or
+              backend == PISM_CHECKPOINT);
+}
+
 // Chooses the best available I/O backend for reading from 'filename'.
 static IO_Backend choose_backend(MPI_Comm com, const std::string &filename) {
 
-  std::string format;
+  std::string format, checkpoint_data;
   {
     // This is the rank-0-only purely-serial mode of accessing NetCDF files, but it
     // supports all the kinds of NetCDF, so this is fine.
@@ -93,9 +168,15 @@ static IO_Backend choose_backend(MPI_Comm com, const std::string &filename) {
 
     file.open(filename, PISM_READONLY);
     format = file.get_format();
+    file.get_att_text("PISM_GLOBAL", "checkpoint_data", checkpoint_data);
     file.close();
   }
 
+  // spatial fields of checkpoint files are stored in a separate data file
+  if (not checkpoint_data.empty()) {
+    return PISM_CHECKPOINT;
+  }
+
   if (format == "netcdf4") {
 #if (Pism_USE_PARALLEL_NETCDF4==1)
     return PISM_NETCDF4_PARALLEL;
@@ -106,22 +187,50 @@ static IO_Backend choose_backend(MPI_Comm com, const std::string &filename) {
 #endif
   }
 
-  // this choice is appropriate for both NetCDF-3 and NetCDF-4
-  return PISM_NETCDF3;
+  // This choice is appropriate for both NetCDF-3 and NetCDF-4. Use two-level aggregation
+  // (faster than reading one patch at a time on rank 0) if there is more than one rank.
+  int size = 1;
+  MPI_Comm_size(com, &size);
+
+  return size > 1 ? PISM_NETCDF3_AGGREGATED : PISM_NETCDF3;
 }
 
-static io::NCFile::Ptr create_backend(MPI_Comm com, IO_Backend backend, int iosysid) {
+static io::NCFile::Ptr create_backend(MPI_Comm com, IO_Backend backend, int iosysid,
+                                      int n_aggregators) {
   int size = 1;
   MPI_Comm_size(com, &size);
 
   if (backend == PISM_NETCDF3) {
     return io::NCFile::Ptr(new io::NC3File(com));
   }
+  if (backend == PISM_NETCDF3_AGGREGATED) {
+    return io::NCFile::Ptr(new io::NC3Aggregated(com, n_aggregators));
+  }
+  if (backend == PISM_NETCDF3_ASYNC) {
+    return io::NCFile::Ptr(new io::NC3Async(com));
+  }
+  if (backend == PISM_CHECKPOINT) {
+    return io::NCFile::Ptr(new io::NC3Checkpoint(com));
+  }
+
+  if (backend == PISM_IN_MEMORY) {
+    return io::NCFile::Ptr(new io::InMemoryFile(com));
+  }
 #if (Pism_USE_PARALLEL_NETCDF4==1)
   if (backend == PISM_NETCDF4_PARALLEL) {
     return io::NCFile::Ptr(new io::NC4_Par(com));
   }
 #endif
+#if (Pism_USE_ADIOS2==1)
+  if (backend == PISM_ADIOS2_SST) {
+    return io::NCFile::Ptr(new io::ADIOS2Stream(com));
+  }
+#else
+  if (backend == PISM_ADIOS2_SST) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "ADIOS2 streams are not supported: PISM was built without ADIOS2");
+  }
+#endif
 #if (Pism_USE_PNETCDF==1)
   if (backend == PISM_PNETCDF) {
     return io::NCFile::Ptr(new io::PNCFile(com));
@@ -145,8 +254,13 @@ static io::NCFile::Ptr create_backend(MPI_Comm com, IO_Backend backend, int iosy
                                 "unknown or unsupported I/O backend: %d", backend);
 }
 
+/*!
+ * @param[in] iosysid ParallelIO I/O system id (see Context::pio_iosys_id())
+ * @param[in] n_aggregators number of aggregators used by the `netcdf3_aggregated`
+ *                          backend (see Context::netcdf3_n_aggregators())
+ */
 File::File(MPI_Comm com, const std::string &filename, IO_Backend backend, IO_Mode mode,
-           int iosysid)
+           int iosysid, int n_aggregators)
   : m_impl(new Impl) {
 
   if (filename.empty()) {
@@ -154,14 +268,23 @@ File::File(MPI_Comm com, const std::string &filename, IO_Backend backend, IO_Mod
                                   "cannot open file: provided file name is empty");
   }
 
-  if (backend == PISM_GUESS) {
+  if (io::InMemoryFile::is_in_memory(filename)) {
+    // in-memory files can be accessed using this backend only (code reading input files
+    // often requests PISM_NETCDF3 explicitly)
+    m_impl->backend = PISM_IN_MEMORY;
+  } else if (io::ADIOS2Stream::is_stream(filename)) {
+    m_impl->backend = PISM_ADIOS2_SST;
+  } else if (backend == PISM_GUESS) {
     m_impl->backend = choose_backend(com, filename);
   } else {
     m_impl->backend = backend;
   }
 
-  m_impl->com = com;
-  m_impl->nc  = create_backend(m_impl->com, m_impl->backend, iosysid);
+  m_impl->com      = com;
+  m_impl->chunking = PISM_CHUNKING_DEFAULT;
+  m_impl->checkpoint = false;
+  m_impl->nc       = create_backend(m_impl->com, m_impl->backend, iosysid,
+                                    n_aggregators);
 
   this->open(filename, mode);
 }
@@ -187,18 +310,177 @@ IO_Backend File::backend() const {
   return m_impl->backend;
 }
 
+//! Chunking policy used by io::define_spatial_variable().
+IO_Chunking File::chunking() const {
+  return m_impl->chunking;
+}
+
+//! Set the chunking policy. Only affects variables defined after this call.
+void File::set_chunking(IO_Chunking policy) {
+  m_impl->chunking = policy;
+}
+
+//! Set the compression level (0 to 9). Only affects NetCDF-4 files.
+void File::set_compression_level(int level) {
+  try {
+    m_impl->nc->set_compression_level(level);
+  } catch (RuntimeError &e) {
+    e.add_context("setting the compression level of '%s'", filename().c_str());
+    throw;
+  }
+}
+
+/*!
+ * Set the amount of free space (in bytes) reserved after the header of a NetCDF-3 file.
+ *
+ * This space is used by variables and attributes added after data were written, so
+ * that the NetCDF library does not have to move all the data to grow the header.
+ */
+void File::set_header_padding(size_t bytes) {
+  m_impl->nc->set_header_padding(bytes);
+}
+
+//! Number of significant (decimal) digits to keep when writing a variable; 0 means "all".
+int File::significant_digits(const std::string &variable_name) const {
+  const auto &digits = m_impl->significant_digits;
+
+  auto j = digits.find(variable_name);
+  if (j != digits.end()) {
+    return j->second;
+  }
+
+  j = digits.find("");
+  if (j != digits.end()) {
+    return j->second;
+  }
+
+  return 0;
+}
+
+/*!
+ * Set the number of significant digits to keep when writing `variable_name`. Use the
+ * empty name to set the default for all variables.
+ *
+ * Bits that are not needed to represent `digits` decimal digits are set to zero in
+ * io::write_spatial_variable(), which makes compressed files smaller.
+ */
+void File::set_significant_digits(const std::string &variable_name, int digits) {
+  m_impl->significant_digits[variable_name] = digits;
+}
+
+//! Type used to write `variable_name` if it was overridden using set_output_type(); PISM_NAT otherwise.
+IO_Type File::output_type(const std::string &variable_name) const {
+  auto j = m_impl->output_types.find(variable_name);
+  if (j != m_impl->output_types.end()) {
+    return j->second;
+  }
+  return PISM_NAT;
+}
+
+/*!
+ * Override the type used to write `variable_name`. This takes precedence over the output
+ * type set in variable metadata and the default type used by io::define_spatial_variable().
+ * Only affects variables defined after this call.
+ */
+void File::set_output_type(const std::string &variable_name, IO_Type type) {
+  m_impl->output_types[variable_name] = type;
+}
+
+/*!
+ * Write 3D variables `variables` using "compression by gathering" (see the CF
+ * conventions, section 8.2): only columns with `n_levels[k] > 0` are stored.
+ *
+ * `n_levels` contains numbers of vertical levels to keep in each column of the
+ * sub-domain owned by this rank (in the order used by IceModelVec, i.e. with the `x`
+ * index changing fastest). Values above these levels are replaced with the fill value.
+ *
+ * Only affects variables defined after this call. See io::define_spatial_variable() and
+ * io::write_spatial_variable().
+ */
+void File::set_ice_columns(const std::vector<std::string> &variables,
+                           const std::vector<int> &n_levels) {
+  m_impl->gathered_variables = std::set<std::string>(variables.begin(), variables.end());
+  m_impl->ice_column_levels  = n_levels;
+}
+
+//! True if `variable_name` should be written using "compression by gathering".
+bool File::gathered(const std::string &variable_name) const {
+  return m_impl->gathered_variables.find(variable_name) != m_impl->gathered_variables.end();
+}
+
+//! Numbers of levels to write in local columns (see set_ice_columns()).
+const std::vector<int>& File::ice_column_levels() const {
+  return m_impl->ice_column_levels;
+}
+
+/*!
+ * Mark this file as a checkpoint: io::write_spatial_variable() computes checksums of
+ * variables written to it (see checksums()).
+ *
+ * If `base_filename` is not empty, this file is an increment: variables with checksums
+ * equal to ones in `base_checksums` (checksums of an earlier checkpoint written to
+ * `base_filename`) are not written. Instead these variables get the attribute
+ * `pism_checkpoint_base` and are read from the base file when re-starting.
+ */
+void File::set_checkpoint(const std::string &base_filename,
+                          const std::map<std::string, std::string> &base_checksums) {
+  m_impl->checkpoint      = true;
+  m_impl->checkpoint_base = base_filename;
+  m_impl->base_checksums  = base_checksums;
+}
+
+bool File::checkpoint() const {
+  return m_impl->checkpoint;
+}
+
+//! Name of the base checkpoint (empty if this file is not an increment).
+std::string File::checkpoint_base() const {
+  return m_impl->checkpoint_base;
+}
+
+//! Checksum of `variable_name` in the base checkpoint (empty if not available).
+std::string File::base_checksum(const std::string &variable_name) const {
+  auto j = m_impl->base_checksums.find(variable_name);
+  if (j != m_impl->base_checksums.end()) {
+    return j->second;
+  }
+  return "";
+}
+
+void File::record_checksum(const std::string &variable_name,
+                           const std::string &checksum) const {
+  m_impl->checksums[variable_name] = checksum;
+}
+
+//! Checksums of variables written to this checkpoint.
+const std::map<std::string, std::string>& File::checksums() const {
+  return m_impl->checksums;
+}
+
 void File::open(const std::string &filename, IO_Mode mode) {
   try {
 
     // opening for reading
     if (mode == PISM_READONLY) {
 
-      m_impl->nc->open(filename, mode);
+      io::InputStaging *staging = io::InputStaging::active();
+
+      if (staging != nullptr and staging_supported(m_impl->backend)) {
+        m_impl->nc->open(staging->local_copy(m_impl->com, filename), mode);
+      } else {
+        m_impl->nc->open(filename, mode);
+      }
 
     } else if (mode == PISM_READWRITE_CLOBBER or mode == PISM_READWRITE_MOVE) {
 
-      if (mode == PISM_READWRITE_MOVE) {
+      if (m_impl->backend == PISM_IN_MEMORY or m_impl->backend == PISM_ADIOS2_SST) {
+        // creating an in-memory file replaces the old one; streams are not files
+      } else if (mode == PISM_READWRITE_MOVE) {
         io::move_if_exists(m_impl->com, filename);
+
+        if (m_impl->backend == PISM_CHECKPOINT) {
+          io::NC3Checkpoint::move_data_file(m_impl->com, filename);
+        }
       } else {
         io::remove_if_exists(m_impl->com, filename);
       }
@@ -512,6 +794,18 @@ void File::define_dimension(const std::string &name, size_t length) const {
   }
 }
 
+//! Set chunk sizes of a variable. Has no effect unless the file uses NetCDF-4.
+void File::define_chunking(const std::string &name,
+                           const std::vector<size_t> &chunk_sizes) const {
+  try {
+    std::vector<size_t> tmp = chunk_sizes;
+    m_impl->nc->def_var_chunking(name, tmp);
+  } catch (RuntimeError &e) {
+    e.add_context("setting chunk sizes of '%s' in '%s'", name.c_str(), filename().c_str());
+    throw;
+  }
+}
+
 //! \brief Define a variable.
 void File::define_variable(const std::string &name, IO_Type nctype, const std::vector<std::string> &dims) const {
   try {
@@ -699,6 +993,35 @@ void File::read_variable(const std::string &variable_name,
   }
 }
 
+/*!
+ * Start reading a part of a variable into `ip`. The data is available after wait_all()
+ * returns, so `ip` has to stay valid until then.
+ *
+ * Backends supporting non-blocking reads (PnetCDF) combine pending reads into one
+ * collective operation.
+ */
+void File::read_variable_nonblocking(const std::string &variable_name,
+                                     const std::vector<unsigned int> &start,
+                                     const std::vector<unsigned int> &count,
+                                     double *ip) const {
+  try {
+    m_impl->nc->iget_vara_double(variable_name, start, count, ip);
+  } catch (RuntimeError &e) {
+    e.add_context("reading variable '%s' from '%s'", variable_name.c_str(), filename().c_str());
+    throw;
+  }
+}
+
+//! Complete all pending non-blocking reads and writes.
+void File::wait_all() const {
+  try {
+    m_impl->nc->wait_all();
+  } catch (RuntimeError &e) {
+    e.add_context("completing pending I/O requests (file '%s')", filename().c_str());
+    throw;
+  }
+}
+
 
 void File::write_variable(const std::string &variable_name,
                           const std::vector<unsigned int> &start,
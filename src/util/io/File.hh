@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <string>
+#include <map>
 #include <mpi.h>
 
 #include "pism/util/Units.hh"
@@ -37,6 +38,10 @@ class IceGrid;
  */
 IO_Backend string_to_backend(const std::string &backend);
 
+IO_Chunking string_to_chunking(const std::string &policy);
+
+IO_Type string_to_type(const std::string &type);
+
 struct VariableLookupData {
   bool exists;
   bool found_using_standard_name;
@@ -51,11 +56,37 @@ class File
 {
 public:
   File(MPI_Comm com, const std::string &filename, IO_Backend backend, IO_Mode mode,
-       int iosysid = -1);
+       int iosysid = -1, int n_aggregators = 0);
   ~File();
 
   IO_Backend backend() const;
 
+  IO_Chunking chunking() const;
+  void set_chunking(IO_Chunking policy);
+
+  void set_compression_level(int level);
+
+  void set_header_padding(size_t bytes);
+
+  int significant_digits(const std::string &variable_name) const;
+  void set_significant_digits(const std::string &variable_name, int digits);
+
+  IO_Type output_type(const std::string &variable_name) const;
+  void set_output_type(const std::string &variable_name, IO_Type type);
+
+  void set_ice_columns(const std::vector<std::string> &variables,
+                       const std::vector<int> &n_levels);
+  bool gathered(const std::string &variable_name) const;
+  const std::vector<int>& ice_column_levels() const;
+
+  void set_checkpoint(const std::string &base_filename,
+                      const std::map<std::string, std::string> &base_checksums);
+  bool checkpoint() const;
+  std::string checkpoint_base() const;
+  std::string base_checksum(const std::string &variable_name) const;
+  void record_checksum(const std::string &variable_name, const std::string &checksum) const;
+  const std::map<std::string, std::string>& checksums() const;
+
   MPI_Comm com() const;
 
   void close();
@@ -96,6 +127,8 @@ public:
 
   std::string variable_name(unsigned int id) const;
 
+  void define_chunking(const std::string &name, const std::vector<size_t> &chunk_sizes) const;
+
   void define_variable(const std::string &name, IO_Type nctype,
                        const std::vector<std::string> &dims) const;
 
@@ -108,6 +141,13 @@ public:
                        const std::vector<unsigned int> &count,
                        double *ip) const;
 
+  void read_variable_nonblocking(const std::string &variable_name,
+                                 const std::vector<unsigned int> &start,
+                                 const std::vector<unsigned int> &count,
+                                 double *ip) const;
+
+  void wait_all() const;
+
   void read_variable_transposed(const std::string &variable_name,
                                 const std::vector<unsigned int> &start,
                                 const std::vector<unsigned int> &count,
@@ -39,7 +39,16 @@ enum IO_Type {
 };
 
 enum IO_Backend {PISM_GUESS, PISM_NETCDF3, PISM_NETCDF4_PARALLEL, PISM_PNETCDF,
-                 PISM_PIO_PNETCDF, PISM_PIO_NETCDF, PISM_PIO_NETCDF4C, PISM_PIO_NETCDF4P};
+                 PISM_PIO_PNETCDF, PISM_PIO_NETCDF, PISM_PIO_NETCDF4C, PISM_PIO_NETCDF4P,
+                 PISM_NETCDF3_AGGREGATED, PISM_NETCDF3_ASYNC, PISM_CHECKPOINT,
+                 PISM_IN_MEMORY, PISM_ADIOS2_SST};
+
+//! Chunking policies for spatial variables in NetCDF-4 files.
+enum IO_Chunking {
+  PISM_CHUNKING_DEFAULT,        //!< use defaults chosen by the NetCDF library
+  PISM_CHUNKING_DECOMPOSITION,  //!< one chunk per (largest) patch, all vertical levels
+  PISM_CHUNKING_TILES           //!< one chunk per time record and vertical level
+};
 
 // This is a subset of NetCDF file modes. Use values that don't match
 // NetCDF flags so that we can detect errors caused by passing these
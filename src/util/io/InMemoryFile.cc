@@ -0,0 +1,489 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "InMemoryFile.hh"
+
+#include <algorithm>
+
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+struct MemoryAttribute {
+  std::string name;
+  IO_Type type;
+  std::vector<double> numbers;
+  std::string text;
+};
+
+//! A hyperslab written by this rank.
+struct MemoryBlock {
+  std::vector<unsigned int> start;
+  std::vector<unsigned int> count;
+  std::vector<double> data;
+};
+
+struct MemoryVariable {
+  std::string name;
+  IO_Type type;
+  std::vector<std::string> dimensions;
+  std::vector<MemoryAttribute> attributes;
+  std::vector<MemoryBlock> blocks;
+};
+
+struct MemoryDataset {
+  //! names and lengths of dimensions
+  std::vector<std::pair<std::string, unsigned int> > dimensions;
+  //! name of the unlimited dimension (empty if there is none)
+  std::string unlimited;
+  //! variables, in the order they were defined
+  std::vector<MemoryVariable> variables;
+  //! global attributes
+  std::vector<MemoryAttribute> attributes;
+
+  MemoryVariable* find_variable(const std::string &name) {
+    for (auto &v : variables) {
+      if (v.name == name) {
+        return &v;
+      }
+    }
+    return nullptr;
+  }
+
+  unsigned int* find_dimension(const std::string &name) {
+    for (auto &d : dimensions) {
+      if (d.first == name) {
+        return &d.second;
+      }
+    }
+    return nullptr;
+  }
+};
+
+//! In-memory files of this process.
+static std::map<std::string, std::shared_ptr<MemoryDataset> > &registry() {
+  static std::map<std::string, std::shared_ptr<MemoryDataset> > datasets;
+  return datasets;
+}
+
+static MemoryAttribute* find_attribute(std::vector<MemoryAttribute> &attributes,
+                                       const std::string &name) {
+  for (auto &a : attributes) {
+    if (a.name == name) {
+      return &a;
+    }
+  }
+  return nullptr;
+}
+
+/*!
+ * Copy values of `block` that are in the hyperslab (`start`, `count`) to `output`, using
+ * the mapping `imap` from hyperslab indexes to positions in `output`. Marks positions that
+ * were set in `covered`.
+ */
+static void copy_block(const MemoryBlock &block,
+                       const std::vector<unsigned int> &start,
+                       const std::vector<unsigned int> &count,
+                       const std::vector<unsigned int> &imap,
+                       double *output,
+                       std::vector<char> &covered) {
+  const size_t ndims = start.size();
+
+  if (ndims == 0) {
+    output[0] = block.data[0];
+    covered[0] = 1;
+    return;
+  }
+
+  // the intersection of the block and the hyperslab
+  std::vector<unsigned int> lo(ndims), hi(ndims), stride(ndims);
+  for (size_t d = 0; d < ndims; ++d) {
+    lo[d] = std::max(start[d], block.start[d]);
+    hi[d] = std::min(start[d] + count[d], block.start[d] + block.count[d]);
+    if (lo[d] >= hi[d]) {
+      return;
+    }
+  }
+
+  // strides of the block (row-major)
+  stride[ndims - 1] = 1;
+  for (size_t d = ndims - 1; d > 0; --d) {
+    stride[d - 1] = stride[d] * block.count[d];
+  }
+
+  std::vector<unsigned int> index = lo;
+  while (true) {
+    size_t in = 0, out = 0;
+    for (size_t d = 0; d < ndims; ++d) {
+      in  += (index[d] - block.start[d]) * stride[d];
+      out += (index[d] - start[d]) * imap[d];
+    }
+    output[out] = block.data[in];
+    covered[out] = 1;
+
+    // advance the multi-index, last dimension first
+    size_t d = ndims;
+    while (d > 0) {
+      --d;
+      index[d] += 1;
+      if (index[d] < hi[d]) {
+        break;
+      }
+      index[d] = lo[d];
+      if (d == 0) {
+        return;
+      }
+    }
+  }
+}
+
+struct InMemoryFile::Impl {
+  std::shared_ptr<MemoryDataset> data;
+
+  MemoryVariable& variable(const std::string &name) const {
+    MemoryVariable *result = data->find_variable(name);
+    if (result == nullptr) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' not found",
+                                    name.c_str());
+    }
+    return *result;
+  }
+
+  std::vector<MemoryAttribute>& attributes(const std::string &variable_name) const {
+    if (variable_name == "PISM_GLOBAL") {
+      return data->attributes;
+    }
+    return variable(variable_name).attributes;
+  }
+
+  void get_var(const std::string &variable_name,
+               const std::vector<unsigned int> &start,
+               const std::vector<unsigned int> &count,
+               const std::vector<unsigned int> &imap,
+               double *ip) const;
+};
+
+void InMemoryFile::Impl::get_var(const std::string &variable_name,
+                                 const std::vector<unsigned int> &start,
+                                 const std::vector<unsigned int> &count,
+                                 const std::vector<unsigned int> &imap,
+                                 double *ip) const {
+  const MemoryVariable &var = variable(variable_name);
+
+  size_t N = 1;
+  for (auto c : count) {
+    N *= c;
+  }
+
+  if (N == 0) {
+    return;
+  }
+
+  std::vector<char> covered(N, 0);
+
+  // later blocks replace earlier ones
+  for (const auto &block : var.blocks) {
+    copy_block(block, start, count, imap, ip, covered);
+  }
+
+  if (std::find(covered.begin(), covered.end(), 0) != covered.end()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "values of '%s' requested by this rank are not available"
+                                  " (in-memory files can be read using the same domain"
+                                  " decomposition only)",
+                                  variable_name.c_str());
+  }
+}
+
+InMemoryFile::InMemoryFile(MPI_Comm c)
+  : NCFile(c), m_impl(new Impl) {
+  // empty
+}
+
+InMemoryFile::~InMemoryFile() {
+  delete m_impl;
+}
+
+//! Returns true if `filename` is the name of an in-memory file.
+bool InMemoryFile::is_in_memory(const std::string &filename) {
+  return filename.compare(0, 7, "memory:") == 0;
+}
+
+//! Remove an in-memory file, freeing its memory. Does nothing if it does not exist.
+void InMemoryFile::remove(const std::string &filename) {
+  std::lock_guard<std::recursive_mutex> lock(netcdf_mutex());
+  registry().erase(filename);
+}
+
+void InMemoryFile::open_impl(const std::string &filename, IO_Mode mode) {
+  (void) mode;
+
+  auto j = registry().find(filename);
+  if (j == registry().end()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "in-memory file '%s' does not exist", filename.c_str());
+  }
+  m_impl->data = j->second;
+}
+
+void InMemoryFile::create_impl(const std::string &filename) {
+  m_impl->data = std::make_shared<MemoryDataset>();
+  registry()[filename] = m_impl->data;
+}
+
+void InMemoryFile::sync_impl() const {
+  // empty
+}
+
+void InMemoryFile::close_impl() {
+  m_impl->data.reset();
+}
+
+void InMemoryFile::enddef_impl() const {
+  // empty
+}
+
+void InMemoryFile::redef_impl() const {
+  // empty
+}
+
+void InMemoryFile::def_dim_impl(const std::string &name, size_t length) const {
+  if (m_impl->data->find_dimension(name) != nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "dimension '%s' already exists",
+                                  name.c_str());
+  }
+
+  if (length == PISM_UNLIMITED) {
+    m_impl->data->unlimited = name;
+  }
+  m_impl->data->dimensions.push_back({name, (unsigned int)length});
+}
+
+void InMemoryFile::inq_dimid_impl(const std::string &dimension_name, bool &exists) const {
+  exists = m_impl->data->find_dimension(dimension_name) != nullptr;
+}
+
+void InMemoryFile::inq_dimlen_impl(const std::string &dimension_name,
+                                   unsigned int &result) const {
+  unsigned int *length = m_impl->data->find_dimension(dimension_name);
+  if (length == nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "dimension '%s' not found",
+                                  dimension_name.c_str());
+  }
+  result = *length;
+}
+
+void InMemoryFile::inq_unlimdim_impl(std::string &result) const {
+  result = m_impl->data->unlimited;
+}
+
+void InMemoryFile::def_var_impl(const std::string &name, IO_Type nctype,
+                                const std::vector<std::string> &dims) const {
+  if (m_impl->data->find_variable(name) != nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' already exists",
+                                  name.c_str());
+  }
+
+  for (const auto &d : dims) {
+    if (m_impl->data->find_dimension(d) == nullptr) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "cannot define '%s': dimension '%s' not found",
+                                    name.c_str(), d.c_str());
+    }
+  }
+
+  MemoryVariable var;
+  var.name       = name;
+  var.type       = nctype;
+  var.dimensions = dims;
+
+  m_impl->data->variables.push_back(var);
+}
+
+void InMemoryFile::get_vara_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        double *ip) const {
+  // row-major order
+  std::vector<unsigned int> imap(start.size());
+  if (not imap.empty()) {
+    imap.back() = 1;
+    for (size_t d = imap.size() - 1; d > 0; --d) {
+      imap[d - 1] = imap[d] * count[d];
+    }
+  }
+
+  m_impl->get_var(variable_name, start, count, imap, ip);
+}
+
+void InMemoryFile::get_varm_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        const std::vector<unsigned int> &imap,
+                                        double *ip) const {
+  m_impl->get_var(variable_name, start, count, imap, ip);
+}
+
+void InMemoryFile::put_vara_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        const double *op) const {
+  MemoryVariable &var = m_impl->variable(variable_name);
+
+  if (start.size() != var.dimensions.size() or count.size() != var.dimensions.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "writing '%s': start and count have to have %d elements",
+                                  variable_name.c_str(), (int)var.dimensions.size());
+  }
+
+  size_t N = 1;
+  for (auto c : count) {
+    N *= c;
+  }
+
+  MemoryBlock block;
+  block.start = start;
+  block.count = count;
+  block.data.assign(op, op + N);
+
+  // replace a block written earlier, if possible
+  bool replaced = false;
+  for (auto &b : var.blocks) {
+    if (b.start == start and b.count == count) {
+      b.data.swap(block.data);
+      replaced = true;
+      break;
+    }
+  }
+  if (not replaced) {
+    var.blocks.push_back(block);
+  }
+
+  // update the length of the unlimited dimension
+  const std::string &unlimited = m_impl->data->unlimited;
+  if (not unlimited.empty() and not var.dimensions.empty() and
+      var.dimensions[0] == unlimited) {
+    unsigned int &length = *m_impl->data->find_dimension(unlimited);
+    length = std::max(length, start[0] + count[0]);
+  }
+}
+
+void InMemoryFile::inq_nvars_impl(int &result) const {
+  result = m_impl->data->variables.size();
+}
+
+void InMemoryFile::inq_vardimid_impl(const std::string &variable_name,
+                                     std::vector<std::string> &result) const {
+  result = m_impl->variable(variable_name).dimensions;
+}
+
+void InMemoryFile::inq_varnatts_impl(const std::string &variable_name, int &result) const {
+  result = m_impl->attributes(variable_name).size();
+}
+
+void InMemoryFile::inq_varid_impl(const std::string &variable_name, bool &exists) const {
+  exists = m_impl->data->find_variable(variable_name) != nullptr;
+}
+
+void InMemoryFile::inq_varname_impl(unsigned int j, std::string &result) const {
+  if (j >= m_impl->data->variables.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid variable index: %d", (int)j);
+  }
+  result = m_impl->data->variables[j].name;
+}
+
+void InMemoryFile::get_att_double_impl(const std::string &variable_name,
+                                       const std::string &att_name,
+                                       std::vector<double> &result) const {
+  MemoryAttribute *a = find_attribute(m_impl->attributes(variable_name), att_name);
+  result = a != nullptr ? a->numbers : std::vector<double>();
+}
+
+void InMemoryFile::get_att_text_impl(const std::string &variable_name,
+                                     const std::string &att_name,
+                                     std::string &result) const {
+  MemoryAttribute *a = find_attribute(m_impl->attributes(variable_name), att_name);
+  result = a != nullptr ? a->text : std::string();
+}
+
+void InMemoryFile::put_att_double_impl(const std::string &variable_name,
+                                       const std::string &att_name,
+                                       IO_Type xtype, const std::vector<double> &data) const {
+  auto &attributes = m_impl->attributes(variable_name);
+
+  MemoryAttribute *a = find_attribute(attributes, att_name);
+  if (a == nullptr) {
+    attributes.push_back(MemoryAttribute());
+    a = &attributes.back();
+    a->name = att_name;
+  }
+  a->type    = xtype;
+  a->numbers = data;
+  a->text.clear();
+}
+
+void InMemoryFile::put_att_text_impl(const std::string &variable_name,
+                                     const std::string &att_name,
+                                     const std::string &value) const {
+  auto &attributes = m_impl->attributes(variable_name);
+
+  MemoryAttribute *a = find_attribute(attributes, att_name);
+  if (a == nullptr) {
+    attributes.push_back(MemoryAttribute());
+    a = &attributes.back();
+    a->name = att_name;
+  }
+  a->type = PISM_CHAR;
+  a->numbers.clear();
+  a->text = value;
+}
+
+void InMemoryFile::inq_attname_impl(const std::string &variable_name, unsigned int n,
+                                    std::string &result) const {
+  auto &attributes = m_impl->attributes(variable_name);
+  if (n >= attributes.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid attribute index: %d", (int)n);
+  }
+  result = attributes[n].name;
+}
+
+void InMemoryFile::inq_atttype_impl(const std::string &variable_name,
+                                    const std::string &att_name,
+                                    IO_Type &result) const {
+  MemoryAttribute *a = find_attribute(m_impl->attributes(variable_name), att_name);
+  result = a != nullptr ? a->type : PISM_NAT;
+}
+
+void InMemoryFile::set_fill_impl(int fillmode, int &old_modep) const {
+  (void) fillmode;
+  old_modep = PISM_NOFILL;
+}
+
+void InMemoryFile::del_att_impl(const std::string &variable_name,
+                                const std::string &att_name) const {
+  auto &attributes = m_impl->attributes(variable_name);
+  attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+                                  [&att_name](const MemoryAttribute &a) {
+                                    return a.name == att_name;
+                                  }),
+                   attributes.end());
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,116 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _PISMINMEMORYFILE_H_
+#define _PISMINMEMORYFILE_H_
+
+#include "NCFile.hh"
+
+namespace pism {
+namespace io {
+
+//! A "file" stored in the memory of the current process.
+/*!
+ * Names of in-memory files start with "memory:" (see is_in_memory()). Their contents
+ * (dimensions, variables, attributes and data) live in a per-process registry until they
+ * are replaced or removed, so a file written by one File instance can be read by another.
+ *
+ * Each rank stores the blocks of data *it* wrote. Reads are served from these blocks, so
+ * distributed arrays can be read back only using the same grid and domain decomposition.
+ * Values are stored as doubles regardless of the type of a variable.
+ *
+ * This is used to save and restore the model state without file I/O: see
+ * IceModel::save_state() and IceModel::restore_state().
+ */
+class InMemoryFile : public NCFile
+{
+public:
+  InMemoryFile(MPI_Comm com);
+  virtual ~InMemoryFile();
+
+  static bool is_in_memory(const std::string &filename);
+  static void remove(const std::string &filename);
+protected:
+  // open/create/close
+  void open_impl(const std::string &filename, IO_Mode mode);
+  void create_impl(const std::string &filename);
+  void sync_impl() const;
+  void close_impl();
+
+  // redef/enddef
+  void enddef_impl() const;
+  void redef_impl() const;
+
+  // dim
+  void def_dim_impl(const std::string &name, size_t length) const;
+  void inq_dimid_impl(const std::string &dimension_name, bool &exists) const;
+  void inq_dimlen_impl(const std::string &dimension_name, unsigned int &result) const;
+  void inq_unlimdim_impl(std::string &result) const;
+
+  // var
+  void def_var_impl(const std::string &name, IO_Type nctype,
+                    const std::vector<std::string> &dims) const;
+
+  void get_vara_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            double *ip) const;
+
+  void put_vara_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            const double *op) const;
+
+  void get_varm_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            const std::vector<unsigned int> &imap,
+                            double *ip) const;
+
+  void inq_nvars_impl(int &result) const;
+  void inq_vardimid_impl(const std::string &variable_name, std::vector<std::string> &result) const;
+  void inq_varnatts_impl(const std::string &variable_name, int &result) const;
+  void inq_varid_impl(const std::string &variable_name, bool &exists) const;
+  void inq_varname_impl(unsigned int j, std::string &result) const;
+
+  // att
+  void get_att_double_impl(const std::string &variable_name, const std::string &att_name,
+                           std::vector<double> &result) const;
+  void get_att_text_impl(const std::string &variable_name, const std::string &att_name,
+                         std::string &result) const;
+  void put_att_double_impl(const std::string &variable_name, const std::string &att_name,
+                           IO_Type xtype, const std::vector<double> &data) const;
+  void put_att_text_impl(const std::string &variable_name, const std::string &att_name,
+                         const std::string &value) const;
+  void inq_attname_impl(const std::string &variable_name, unsigned int n,
+                        std::string &result) const;
+  void inq_atttype_impl(const std::string &variable_name, const std::string &att_name,
+                        IO_Type &result) const;
+
+  // misc
+  void set_fill_impl(int fillmode, int &old_modep) const;
+  void del_att_impl(const std::string &variable_name, const std::string &att_name) const;
+private:
+  struct Impl;
+  Impl *m_impl;
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* _PISMINMEMORYFILE_H_ */
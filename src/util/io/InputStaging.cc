@@ -0,0 +1,134 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <cstdio>               // std::remove
+#include <fstream>
+#include <functional>           // std::hash
+#include <sys/stat.h>           // stat, mkdir
+
+#include "InputStaging.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+namespace io {
+
+InputStaging *InputStaging::m_active = nullptr;
+
+InputStaging::InputStaging(const std::string &directory, double max_size)
+  : m_directory(directory), m_max_size(max_size), m_size(0.0) {
+  m_active = this;
+}
+
+InputStaging::~InputStaging() {
+  for (const auto &c : m_copies) {
+    std::remove(c.first.c_str());
+  }
+
+  if (m_active == this) {
+    m_active = nullptr;
+  }
+}
+
+//! Returns the instance used by File (NULL if input files are not staged).
+InputStaging* InputStaging::active() {
+  return m_active;
+}
+
+//! Returns the name of the file to read instead of `filename`: either the name of a local
+//! copy or `filename` itself. Collective on `com`.
+std::string InputStaging::local_copy(MPI_Comm com, const std::string &filename) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  MPI_Comm node_com;
+  MPI_Comm_split_type(com, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_com);
+
+  int node_rank = 0;
+  MPI_Comm_rank(node_com, &node_rank);
+  MPI_Comm_free(&node_com);
+
+  // the hash of the full name avoids collisions of files with the same base name
+  std::string
+    base_name  = filename.substr(filename.rfind('/') + 1),
+    local_name = pism::printf("%s/%016zx_%s", m_directory.c_str(),
+                              std::hash<std::string>()(filename), base_name.c_str());
+
+  int staged = 1;
+  if (node_rank == 0) {
+    staged = stage(filename, local_name) ? 1 : 0;
+  }
+
+  // This also makes sure that copies are complete before any rank opens them.
+  int all_staged = 0;
+  MPI_Allreduce(&staged, &all_staged, 1, MPI_INT, MPI_MIN, com);
+
+  return all_staged == 1 ? local_name : filename;
+}
+
+//! Copy `filename` to `local_name` unless an up to date copy exists already. Returns true
+//! on success.
+bool InputStaging::stage(const std::string &filename, const std::string &local_name) {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0) {
+    // let the code opening this file report the error
+    return false;
+  }
+
+  auto copy = m_copies.find(local_name);
+  if (copy != m_copies.end()) {
+    if (copy->second.size == info.st_size and
+        copy->second.modification_time == info.st_mtime) {
+      return true;
+    }
+
+    // the file changed since it was copied
+    std::remove(local_name.c_str());
+    m_size -= copy->second.size;
+    m_copies.erase(copy);
+  }
+
+  if (m_size + info.st_size > m_max_size) {
+    return false;
+  }
+
+  // ignore errors here: failing to create the directory means failing to write the copy
+  mkdir(m_directory.c_str(), 0755);
+
+  {
+    std::ifstream input(filename, std::ios::binary);
+    std::ofstream output(local_name, std::ios::binary);
+
+    if (input.is_open()) {
+      output << input.rdbuf();
+    }
+
+    if (not input.is_open() or not output) {
+      output.close();
+      std::remove(local_name.c_str());
+      return false;
+    }
+  }
+
+  m_copies[local_name] = {(double)info.st_size, (long int)info.st_mtime};
+  m_size += info.st_size;
+
+  return true;
+}
+
+} // end of namespace io
+} // end of namespace pism
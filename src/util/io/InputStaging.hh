@@ -0,0 +1,82 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _PISMINPUTSTAGING_H_
+#define _PISMINPUTSTAGING_H_
+
+#include <map>
+#include <string>
+#include <mpi.h>
+
+namespace pism {
+namespace io {
+
+//! Copies of input files on node-local storage.
+/*!
+ * When an instance exists (see active()), File opens local copies of files opened for
+ * reading: the lowest rank on each node copies a file to `directory` the first time it is
+ * opened (and again if it was modified since), then all ranks read from the copy. This
+ * replaces metadata operations on a shared file system with local ones, which matters
+ * for forcing files re-opened every time a buffer is refilled.
+ *
+ * Files that do not fit within the size limit (per node) are read from their original
+ * location. A file is read from local copies only if all nodes have one, so that all
+ * ranks use the same file name (required by parallel I/O libraries).
+ *
+ * Copies are removed when the instance is destroyed. `directory` should be specific to
+ * a run (e.g. a job-specific temporary directory): runs sharing it would remove each
+ * other's copies.
+ */
+class InputStaging {
+public:
+  /*!
+   * @param[in] directory node-local directory to copy files to (created if necessary)
+   * @param[in] max_size maximum total size of copies on a node, in bytes
+   */
+  InputStaging(const std::string &directory, double max_size);
+  ~InputStaging();
+
+  std::string local_copy(MPI_Comm com, const std::string &filename);
+
+  static InputStaging* active();
+private:
+  bool stage(const std::string &filename, const std::string &local_name);
+
+  std::string m_directory;
+  double m_max_size;
+  //! total size of copies on this node (node leaders only)
+  double m_size;
+
+  struct Copy {
+    double size;
+    long int modification_time;
+  };
+  //! copies made by this rank, indexed by names of copies
+  std::map<std::string, Copy> m_copies;
+
+  static InputStaging *m_active;
+
+  // disable copying
+  InputStaging(const InputStaging &);
+  InputStaging& operator=(const InputStaging &);
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* _PISMINPUTSTAGING_H_ */
@@ -0,0 +1,633 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "NC3Aggregated.hh"
+
+// The following is a stupid kludge necessary to make NetCDF 4.x work in
+// serial mode in an MPI program:
+#ifndef MPI_INCLUDED
+#define MPI_INCLUDED 1
+#endif
+#include <netcdf.h>
+#include <cstdio>               // stderr, fprintf
+#include <cstring>              // memcpy
+#include <cmath>                // sqrt, round
+#include <algorithm>            // min, max
+
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+static void check(const ErrorLocation &where, int return_code) {
+  if (return_code != NC_NOERR) {
+    throw RuntimeError(where, nc_strerror(return_code));
+  }
+}
+
+//! call MPI_Abort() if a NetCDF call failed
+static void check_and_abort(MPI_Comm com, const ErrorLocation &where, int return_code) {
+  if (return_code != NC_NOERR) {
+    fprintf(stderr, "%s:%d: %s\n", where.filename, where.line_number, nc_strerror(return_code));
+    MPI_Abort(com, -1);
+  }
+}
+
+NC3Aggregated::NC3Aggregated(MPI_Comm com, int n_aggregators)
+  : NC3File(com), m_group_comm(MPI_COMM_NULL), m_aggregator_comm(MPI_COMM_NULL) {
+
+  int rank = 0, size = 1;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  if (n_aggregators <= 0) {
+    n_aggregators = static_cast<int>(std::round(std::sqrt(size)));
+  }
+  n_aggregators = std::max(1, std::min(n_aggregators, size));
+
+  // consecutive ranks own neighboring patches, so we group them together
+  int group_size = (size + n_aggregators - 1) / n_aggregators;
+
+  MPI_Comm_split(com, rank / group_size, rank, &m_group_comm);
+
+  int group_rank = 0;
+  MPI_Comm_rank(m_group_comm, &group_rank);
+
+  // Aggregators are ordered by their rank in com, so rank 0 in com is rank 0 in
+  // m_aggregator_comm.
+  MPI_Comm_split(com, group_rank == 0 ? 0 : MPI_UNDEFINED, rank, &m_aggregator_comm);
+}
+
+NC3Aggregated::~NC3Aggregated() {
+  if (m_aggregator_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_aggregator_comm);
+  }
+  if (m_group_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_group_comm);
+  }
+}
+
+//! Number of elements in a hyperslab.
+static unsigned int hyperslab_size(int ndims, const unsigned int *count) {
+  unsigned int result = 1;
+  for (int k = 0; k < ndims; ++k) {
+    result *= count[k];
+  }
+  return result;
+}
+
+/*!
+ * Copy a patch (start, count) into a block (block_start, block_count) containing it.
+ *
+ * The last dimension is contiguous in both, so we copy one "row" at a time.
+ */
+static void copy_patch(int ndims,
+                       const unsigned int *start, const unsigned int *count,
+                       const double *patch,
+                       const unsigned int *block_start, const unsigned int *block_count,
+                       double *block) {
+  const unsigned int
+    n_rows     = hyperslab_size(ndims - 1, count),
+    row_length = count[ndims - 1];
+
+  std::vector<unsigned int> index(ndims, 0);
+
+  for (unsigned int row = 0; row < n_rows; ++row) {
+    // compute the offset of this row in the block
+    size_t offset = 0;
+    for (int k = 0; k < ndims; ++k) {
+      offset = offset * block_count[k] + (start[k] + index[k] - block_start[k]);
+    }
+
+    memcpy(&block[offset], &patch[row * row_length], row_length * sizeof(double));
+
+    // increment the multi-index, skipping the last (contiguous) dimension
+    for (int k = ndims - 2; k >= 0; --k) {
+      index[k] += 1;
+      if (index[k] < count[k]) {
+        break;
+      }
+      index[k] = 0;
+    }
+  }
+}
+
+/*!
+ * Merge patches gathered by an aggregator into blocks that can be written using one call
+ * each.
+ *
+ * Produces a header containing the number of blocks, the total number of values, and
+ * start and count for each block, followed by block data.
+ *
+ * If patches tile their bounding box they are copied into one block. Otherwise they are
+ * passed through unchanged.
+ */
+static void merge_patches(int ndims,
+                          const std::vector<unsigned int> &patches,
+                          const std::vector<int> &sizes,
+                          const std::vector<double> &data,
+                          std::vector<unsigned int> &header,
+                          std::vector<double> &blocks) {
+  const int n_patches = sizes.size();
+
+  std::vector<unsigned int> box_start(ndims, 0), box_end(ndims, 0);
+  unsigned int total_size = 0;
+  bool empty = true;
+  for (int p = 0; p < n_patches; ++p) {
+    if (sizes[p] == 0) {
+      continue;
+    }
+    const unsigned int
+      *start = &patches[2 * ndims * p],
+      *count = start + ndims;
+
+    for (int k = 0; k < ndims; ++k) {
+      if (empty) {
+        box_start[k] = start[k];
+        box_end[k]   = start[k] + count[k];
+      } else {
+        box_start[k] = std::min(box_start[k], start[k]);
+        box_end[k]   = std::max(box_end[k], start[k] + count[k]);
+      }
+    }
+    empty = false;
+    total_size += sizes[p];
+  }
+
+  std::vector<unsigned int> box_count(ndims);
+  for (int k = 0; k < ndims; ++k) {
+    box_count[k] = box_end[k] - box_start[k];
+  }
+
+  header.clear();
+
+  // Patches owned by different ranks do not overlap, so they tile the bounding box if
+  // their sizes add up to its size.
+  if (ndims > 0 and not empty and hyperslab_size(ndims, box_count.data()) == total_size) {
+    header.push_back(1);
+    header.push_back(total_size);
+    header.insert(header.end(), box_start.begin(), box_start.end());
+    header.insert(header.end(), box_count.begin(), box_count.end());
+
+    blocks.resize(total_size);
+    size_t offset = 0;
+    for (int p = 0; p < n_patches; ++p) {
+      if (sizes[p] == 0) {
+        continue;
+      }
+      const unsigned int
+        *start = &patches[2 * ndims * p],
+        *count = start + ndims;
+
+      copy_patch(ndims, start, count, &data[offset],
+                 box_start.data(), box_count.data(), blocks.data());
+      offset += sizes[p];
+    }
+  } else {
+    header.push_back(n_patches);
+    header.push_back(data.size());
+    header.insert(header.end(), patches.begin(), patches.end());
+
+    blocks = data;
+  }
+}
+
+//! Write blocks described by a header produced by merge_patches().
+static void write_blocks(MPI_Comm com, int file_id, int varid, int ndims,
+                         const std::vector<unsigned int> &header,
+                         const std::vector<double> &blocks) {
+  const unsigned int n_blocks = header[0];
+
+  std::vector<size_t> nc_start(ndims), nc_count(ndims);
+
+  size_t offset = 0;
+  for (unsigned int b = 0; b < n_blocks; ++b) {
+    const unsigned int
+      *start = &header[2 + 2 * ndims * b],
+      *count = start + ndims,
+      size   = hyperslab_size(ndims, count);
+
+    if (size == 0) {
+      continue;
+    }
+
+    for (int k = 0; k < ndims; ++k) {
+      nc_start[k] = start[k];
+      nc_count[k] = count[k];
+    }
+
+    int stat = nc_put_vara_double(file_id, varid, nc_start.data(), nc_count.data(),
+                                  &blocks[offset]);
+    check_and_abort(com, PISM_ERROR_LOCATION, stat);
+
+    offset += size;
+  }
+}
+
+/*!
+ * Copy a patch (start, count) out of a block (block_start, block_count) containing it.
+ *
+ * This is the inverse of copy_patch().
+ */
+static void extract_patch(int ndims,
+                          const unsigned int *block_start, const unsigned int *block_count,
+                          const double *block,
+                          const unsigned int *start, const unsigned int *count,
+                          double *patch) {
+  const unsigned int
+    n_rows     = hyperslab_size(ndims - 1, count),
+    row_length = count[ndims - 1];
+
+  std::vector<unsigned int> index(ndims, 0);
+
+  for (unsigned int row = 0; row < n_rows; ++row) {
+    size_t offset = 0;
+    for (int k = 0; k < ndims; ++k) {
+      offset = offset * block_count[k] + (start[k] + index[k] - block_start[k]);
+    }
+
+    memcpy(&patch[row * row_length], &block[offset], row_length * sizeof(double));
+
+    for (int k = ndims - 2; k >= 0; --k) {
+      index[k] += 1;
+      if (index[k] < count[k]) {
+        break;
+      }
+      index[k] = 0;
+    }
+  }
+}
+
+/*!
+ * Plan reading patches requested by ranks in a group.
+ *
+ * Produces a header in the format used by merge_patches(). If the bounding box of all
+ * patches is not much bigger than the patches themselves it is read as one block (this
+ * reads a few values nobody needs if patches do not tile it). Otherwise patches are read
+ * one at a time.
+ */
+static void plan_reading(int ndims,
+                         const std::vector<unsigned int> &patches,
+                         const std::vector<int> &sizes,
+                         std::vector<unsigned int> &header) {
+  const int n_patches = sizes.size();
+
+  std::vector<unsigned int> box_start(ndims, 0), box_end(ndims, 0);
+  unsigned int total_size = 0;
+  bool empty = true;
+  for (int p = 0; p < n_patches; ++p) {
+    if (sizes[p] == 0) {
+      continue;
+    }
+    const unsigned int
+      *start = &patches[2 * ndims * p],
+      *count = start + ndims;
+
+    for (int k = 0; k < ndims; ++k) {
+      if (empty) {
+        box_start[k] = start[k];
+        box_end[k]   = start[k] + count[k];
+      } else {
+        box_start[k] = std::min(box_start[k], start[k]);
+        box_end[k]   = std::max(box_end[k], start[k] + count[k]);
+      }
+    }
+    empty = false;
+    total_size += sizes[p];
+  }
+
+  std::vector<unsigned int> box_count(ndims);
+  for (int k = 0; k < ndims; ++k) {
+    box_count[k] = box_end[k] - box_start[k];
+  }
+
+  header.clear();
+
+  const unsigned int box_size = hyperslab_size(ndims, box_count.data());
+
+  if (ndims > 0 and not empty and box_size <= 2 * total_size) {
+    header.push_back(1);
+    header.push_back(box_size);
+    header.insert(header.end(), box_start.begin(), box_start.end());
+    header.insert(header.end(), box_count.begin(), box_count.end());
+  } else {
+    header.push_back(n_patches);
+    header.push_back(total_size);
+    header.insert(header.end(), patches.begin(), patches.end());
+  }
+}
+
+//! Read blocks described by a header produced by plan_reading().
+/*!
+ * Returns the NetCDF status of the first failed read (remaining blocks are not read).
+ * `blocks` has the size given in the header in any case, so that the caller can complete
+ * communication with other ranks before reporting the error.
+ */
+static int read_blocks(int file_id, int varid, int ndims,
+                       const std::vector<unsigned int> &header,
+                       std::vector<double> &blocks) {
+  const unsigned int n_blocks = header[0];
+
+  blocks.resize(header[1]);
+
+  std::vector<size_t> nc_start(ndims), nc_count(ndims);
+
+  size_t offset = 0;
+  for (unsigned int b = 0; b < n_blocks; ++b) {
+    const unsigned int
+      *start = &header[2 + 2 * ndims * b],
+      *count = start + ndims,
+      size   = hyperslab_size(ndims, count);
+
+    if (size == 0) {
+      continue;
+    }
+
+    for (int k = 0; k < ndims; ++k) {
+      nc_start[k] = start[k];
+      nc_count[k] = count[k];
+    }
+
+    int stat = nc_get_vara_double(file_id, varid, nc_start.data(), nc_count.data(),
+                                  &blocks[offset]);
+    if (stat != NC_NOERR) {
+      return stat;
+    }
+
+    offset += size;
+  }
+
+  return NC_NOERR;
+}
+
+/*!
+ * Read a hyperslab using a two-level scatter (the reverse of put_vara_double_impl()).
+ *
+ * Aggregators collect extents of patches needed by their groups and send them to rank 0,
+ * which reads one large block per group and sends it back (sending one block while
+ * reading the next one). Aggregators then distribute patches using MPI_Scatterv().
+ *
+ * If a read fails rank 0 completes this exchange anyway and then broadcasts the error
+ * status, so that all ranks throw.
+ */
+void NC3Aggregated::get_vara_double_impl(const std::string &variable_name,
+                                         const std::vector<unsigned int> &start,
+                                         const std::vector<unsigned int> &count,
+                                         double *ip) const {
+  const int
+    header_tag = 3,
+    data_tag   = 4,
+    ndims      = static_cast<int>(start.size());
+
+  int group_rank = 0, group_size = 1;
+  MPI_Comm_rank(m_group_comm, &group_rank);
+  MPI_Comm_size(m_group_comm, &group_size);
+
+  // Step 1: gather patch extents within each group.
+  std::vector<unsigned int> patch(start);
+  patch.insert(patch.end(), count.begin(), count.end());
+
+  int local_size = hyperslab_size(ndims, count.data());
+
+  std::vector<unsigned int> patches;
+  std::vector<int> sizes, offsets;
+  std::vector<double> group_data;
+  if (group_rank == 0) {
+    patches.resize(2 * ndims * group_size);
+    sizes.resize(group_size);
+    offsets.resize(group_size);
+  }
+
+  MPI_Gather(patch.data(), 2 * ndims, MPI_UNSIGNED,
+             patches.data(), 2 * ndims, MPI_UNSIGNED, 0, m_group_comm);
+  MPI_Gather(&local_size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, m_group_comm);
+
+  // NetCDF status on rank 0
+  int stat = NC_NOERR;
+
+  if (group_rank == 0) {
+    // Step 2: get blocks from rank 0.
+    std::vector<unsigned int> header;
+    std::vector<double> blocks;
+    plan_reading(ndims, patches, sizes, header);
+
+    int aggregator_rank = 0, n_aggregators = 1;
+    MPI_Comm_rank(m_aggregator_comm, &aggregator_rank);
+    MPI_Comm_size(m_aggregator_comm, &n_aggregators);
+
+    if (aggregator_rank != 0) {
+      MPI_Send(header.data(), header.size(), MPI_UNSIGNED, 0, header_tag, m_aggregator_comm);
+
+      blocks.resize(header[1]);
+      MPI_Recv(blocks.data(), blocks.size(), MPI_DOUBLE, 0, data_tag, m_aggregator_comm,
+               MPI_STATUS_IGNORE);
+    } else {
+      int varid = -1;
+      stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
+
+      if (stat == NC_NOERR) {
+        stat = read_blocks(m_file_id, varid, ndims, header, blocks);
+      } else {
+        blocks.resize(header[1]);
+      }
+
+      // Two buffers: rank 0 sends data to aggregator a - 1 while reading data for
+      // aggregator a.
+      std::vector<double> buffers[2];
+      MPI_Request requests[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+      std::vector<unsigned int> other_header;
+
+      for (int a = 1; a < n_aggregators; ++a) {
+        const int k = a % 2;
+
+        MPI_Status status;
+        int header_size = 0;
+        MPI_Probe(a, header_tag, m_aggregator_comm, &status);
+        MPI_Get_count(&status, MPI_UNSIGNED, &header_size);
+
+        other_header.resize(header_size);
+        MPI_Recv(other_header.data(), header_size, MPI_UNSIGNED, a, header_tag,
+                 m_aggregator_comm, MPI_STATUS_IGNORE);
+
+        // make sure the buffer is not in use
+        MPI_Wait(&requests[k], MPI_STATUS_IGNORE);
+
+        if (stat == NC_NOERR) {
+          stat = read_blocks(m_file_id, varid, ndims, other_header, buffers[k]);
+        } else {
+          // keep sending data (ignored after the error is reported below)
+          buffers[k].resize(other_header[1]);
+        }
+
+        MPI_Isend(buffers[k].data(), buffers[k].size(), MPI_DOUBLE, a, data_tag,
+                  m_aggregator_comm, &requests[k]);
+      }
+
+      MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+    }
+
+    // Step 3: extract patches, ordered by rank in the group.
+    int total = 0;
+    for (int r = 0; r < group_size; ++r) {
+      offsets[r] = total;
+      total += sizes[r];
+    }
+
+    if (header[0] == 1 and ndims > 0) {
+      // one block containing all patches
+      const unsigned int
+        *block_start = &header[2],
+        *block_count = block_start + ndims;
+
+      group_data.resize(total);
+      for (int r = 0; r < group_size; ++r) {
+        if (sizes[r] == 0) {
+          continue;
+        }
+        const unsigned int
+          *patch_start = &patches[2 * ndims * r],
+          *patch_count = patch_start + ndims;
+
+        extract_patch(ndims, block_start, block_count, blocks.data(),
+                      patch_start, patch_count, &group_data[offsets[r]]);
+      }
+    } else {
+      // patches were read one at a time
+      group_data = blocks;
+    }
+  }
+
+  // Step 4: distribute patches within each group.
+  MPI_Scatterv(group_data.data(), sizes.data(), offsets.data(), MPI_DOUBLE,
+               ip, local_size, MPI_DOUBLE, 0, m_group_comm);
+
+  MPI_Bcast(&stat, 1, MPI_INT, 0, m_com);
+  check(PISM_ERROR_LOCATION, stat);
+}
+
+void NC3Aggregated::put_vara_double_impl(const std::string &variable_name,
+                                         const std::vector<unsigned int> &start,
+                                         const std::vector<unsigned int> &count,
+                                         const double *op) const {
+  const int
+    header_tag = 1,
+    data_tag   = 2,
+    ndims      = static_cast<int>(start.size());
+
+  int group_rank = 0, group_size = 1;
+  MPI_Comm_rank(m_group_comm, &group_rank);
+  MPI_Comm_size(m_group_comm, &group_size);
+
+  // Step 1: gather patch extents and data within each group.
+  std::vector<unsigned int> patch(start);
+  patch.insert(patch.end(), count.begin(), count.end());
+
+  int local_size = hyperslab_size(ndims, count.data());
+
+  std::vector<unsigned int> patches;
+  std::vector<int> sizes, offsets;
+  std::vector<double> group_data;
+  if (group_rank == 0) {
+    patches.resize(2 * ndims * group_size);
+    sizes.resize(group_size);
+    offsets.resize(group_size);
+  }
+
+  MPI_Gather(patch.data(), 2 * ndims, MPI_UNSIGNED,
+             patches.data(), 2 * ndims, MPI_UNSIGNED, 0, m_group_comm);
+  MPI_Gather(&local_size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, m_group_comm);
+
+  if (group_rank == 0) {
+    int total = 0;
+    for (int r = 0; r < group_size; ++r) {
+      offsets[r] = total;
+      total += sizes[r];
+    }
+    group_data.resize(total);
+  }
+
+  MPI_Gatherv(const_cast<double*>(op), local_size, MPI_DOUBLE,
+              group_data.data(), sizes.data(), offsets.data(), MPI_DOUBLE,
+              0, m_group_comm);
+
+  if (group_rank != 0) {
+    // this rank is done
+    return;
+  }
+
+  // Step 2: merge patches into blocks.
+  std::vector<unsigned int> header;
+  std::vector<double> blocks;
+  merge_patches(ndims, patches, sizes, group_data, header, blocks);
+
+  int aggregator_rank = 0, n_aggregators = 1;
+  MPI_Comm_rank(m_aggregator_comm, &aggregator_rank);
+  MPI_Comm_size(m_aggregator_comm, &n_aggregators);
+
+  // Step 3: send blocks to rank 0 and write them.
+  if (aggregator_rank != 0) {
+    MPI_Send(header.data(), header.size(), MPI_UNSIGNED, 0, header_tag, m_aggregator_comm);
+    MPI_Send(blocks.data(), blocks.size(), MPI_DOUBLE, 0, data_tag, m_aggregator_comm);
+    return;
+  }
+
+  int varid = -1;
+  int stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
+  check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
+
+  // Two buffers: rank 0 receives data from aggregator a + 1 while writing data from
+  // aggregator a.
+  std::vector<unsigned int> headers[2];
+  std::vector<double> buffers[2];
+  MPI_Request requests[2];
+
+  auto post_receive = [&](int a) {
+    const int k = a % 2;
+    MPI_Status status;
+    int header_size = 0;
+    MPI_Probe(a, header_tag, m_aggregator_comm, &status);
+    MPI_Get_count(&status, MPI_UNSIGNED, &header_size);
+
+    headers[k].resize(header_size);
+    MPI_Recv(headers[k].data(), header_size, MPI_UNSIGNED, a, header_tag,
+             m_aggregator_comm, MPI_STATUS_IGNORE);
+
+    buffers[k].resize(headers[k][1]);
+    MPI_Irecv(buffers[k].data(), buffers[k].size(), MPI_DOUBLE, a, data_tag,
+              m_aggregator_comm, &requests[k]);
+  };
+
+  if (n_aggregators > 1) {
+    post_receive(1);
+  }
+
+  write_blocks(m_com, m_file_id, varid, ndims, header, blocks);
+
+  for (int a = 1; a < n_aggregators; ++a) {
+    if (a + 1 < n_aggregators) {
+      post_receive(a + 1);
+    }
+
+    MPI_Wait(&requests[a % 2], MPI_STATUS_IGNORE);
+
+    write_blocks(m_com, m_file_id, varid, ndims, headers[a % 2], buffers[a % 2]);
+  }
+}
+
+} // end of namespace io
+} // end of namespace pism
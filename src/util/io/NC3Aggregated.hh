@@ -0,0 +1,74 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _PISMNC3AGGREGATED_H_
+#define _PISMNC3AGGREGATED_H_
+
+#include "NC3File.hh"
+
+namespace pism {
+namespace io {
+
+//! NetCDF-3 I/O using a two-level gather when writing and a two-level scatter when reading.
+/*!
+ * Ranks are split into groups of consecutive ranks. Each group has an "aggregator" (the
+ * lowest rank in the group) that collects patches from the rest of the group using one
+ * collective call. Patches that tile a rectangular block are merged so that they can be
+ * written using one `nc_put_vara_double()` call.
+ *
+ * Aggregators send blocks to rank 0 (which owns the file); rank 0 receives the next
+ * aggregator's data while writing the current one.
+ *
+ * Reading works the other way around: rank 0 reads one block per group and sends it to
+ * the aggregator, which distributes patches within its group.
+ *
+ * Everything except reading and writing is inherited from NC3File (reading using a
+ * transposed map, i.e. get_varm_double(), is not aggregated).
+ */
+class NC3Aggregated : public NC3File
+{
+public:
+  /*!
+   * @param[in] com communicator
+   * @param[in] n_aggregators number of aggregators; use 0 to pick one automatically
+   *                          (the square root of the communicator size)
+   */
+  NC3Aggregated(MPI_Comm com, int n_aggregators = 0);
+  virtual ~NC3Aggregated();
+
+protected:
+  void get_vara_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            double *ip) const;
+
+  void put_vara_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            const double *op) const;
+private:
+  //! communicator containing ranks in the same aggregation group
+  MPI_Comm m_group_comm;
+  //! communicator containing aggregators only (MPI_COMM_NULL on other ranks)
+  MPI_Comm m_aggregator_comm;
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* _PISMNC3AGGREGATED_H_ */
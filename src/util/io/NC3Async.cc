@@ -0,0 +1,449 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "NC3Async.hh"
+
+// The following is a stupid kludge necessary to make NetCDF 4.x work in
+// serial mode in an MPI program:
+#ifndef MPI_INCLUDED
+#define MPI_INCLUDED 1
+#endif
+#include <netcdf.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+static void check(const ErrorLocation &where, int return_code) {
+  if (return_code != NC_NOERR) {
+    throw RuntimeError(where, nc_strerror(return_code));
+  }
+}
+
+//! Data gathered on rank 0 and waiting to be written.
+struct WriteRequest {
+  int file_id;
+  int varid;
+  int ndims;
+  //! start and count for each patch
+  std::vector<unsigned int> patches;
+  //! number of values in each patch
+  std::vector<int> sizes;
+  //! patch data, one patch after another
+  std::vector<double> data;
+
+  size_t size_in_bytes() const {
+    return data.size() * sizeof(double);
+  }
+};
+
+struct NC3Async::Impl {
+  Impl(size_t buffer_size);
+
+  void run();
+  void write(const WriteRequest &request);
+  bool pop(WriteRequest &result);
+  void drain();
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<WriteRequest> queue;
+  size_t queued_bytes;
+  size_t buffer_size;
+  bool stop;
+  //! status of the first failed write
+  int status;
+
+  std::thread writer;
+};
+
+NC3Async::Impl::Impl(size_t size)
+  : queued_bytes(0), buffer_size(size), stop(false), status(NC_NOERR) {
+  // empty
+}
+
+//! Write one request. The caller has to hold `netcdf_mutex()`.
+void NC3Async::Impl::write(const WriteRequest &request) {
+  const int ndims = request.ndims;
+  std::vector<size_t> nc_start(ndims), nc_count(ndims);
+
+  size_t offset = 0;
+  for (unsigned int p = 0; p < request.sizes.size(); ++p) {
+    const unsigned int
+      *start = &request.patches[2 * ndims * p],
+      *count = start + ndims;
+
+    if (request.sizes[p] > 0) {
+      for (int k = 0; k < ndims; ++k) {
+        nc_start[k] = start[k];
+        nc_count[k] = count[k];
+      }
+
+      int stat = nc_put_vara_double(request.file_id, request.varid,
+                                    nc_start.data(), nc_count.data(),
+                                    &request.data[offset]);
+      if (stat != NC_NOERR and status == NC_NOERR) {
+        status = stat;
+      }
+    }
+
+    offset += request.sizes[p];
+  }
+}
+
+//! Remove the oldest request from the queue. Returns false if the queue is empty.
+bool NC3Async::Impl::pop(WriteRequest &result) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (queue.empty()) {
+    return false;
+  }
+
+  result = std::move(queue.front());
+  queue.pop_front();
+  queued_bytes -= result.size_in_bytes();
+
+  return true;
+}
+
+//! Write all staged data (on the calling thread).
+void NC3Async::Impl::drain() {
+  std::lock_guard<std::recursive_mutex> netcdf_lock(netcdf_mutex());
+
+  WriteRequest request;
+  while (pop(request)) {
+    write(request);
+  }
+}
+
+//! The body of the background thread.
+void NC3Async::Impl::run() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this]() { return stop or not queue.empty(); });
+
+      if (stop and queue.empty()) {
+        return;
+      }
+    }
+
+    // Lock the NetCDF mutex *before* taking a request from the queue: this way the main
+    // thread holding this mutex knows that no request is being written in the background.
+    std::lock_guard<std::recursive_mutex> netcdf_lock(netcdf_mutex());
+
+    WriteRequest request;
+    if (pop(request)) {
+      write(request);
+    }
+  }
+}
+
+NC3Async::NC3Async(MPI_Comm com, size_t buffer_size)
+  : NC3File(com), m_impl(new Impl(buffer_size)) {
+
+  // put_vara_double_impl() locks netcdf_mutex() only when it uses NetCDF
+  m_unlocked_writes = true;
+
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  if (rank == 0) {
+    m_impl->writer = std::thread(&NC3Async::Impl::run, m_impl);
+  }
+}
+
+NC3Async::~NC3Async() {
+  if (m_impl->writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_impl->mutex);
+      m_impl->stop = true;
+    }
+    m_impl->cv.notify_one();
+    m_impl->writer.join();
+  }
+  delete m_impl;
+}
+
+void NC3Async::close_impl() {
+  m_impl->drain();
+
+  int stat = m_impl->status;
+  m_impl->status = NC_NOERR;
+
+  MPI_Bcast(&stat, 1, MPI_INT, 0, m_com);
+
+  NC3File::close_impl();
+
+  check(PISM_ERROR_LOCATION, stat);
+}
+
+//! Write all staged data before synchronizing the file.
+void NC3Async::sync_impl() const {
+  m_impl->drain();
+  NC3File::sync_impl();
+}
+
+void NC3Async::get_vara_double_impl(const std::string &variable_name,
+                                    const std::vector<unsigned int> &start,
+                                    const std::vector<unsigned int> &count,
+                                    double *ip) const {
+  m_impl->drain();
+  NC3File::get_vara_double_impl(variable_name, start, count, ip);
+}
+
+void NC3Async::get_varm_double_impl(const std::string &variable_name,
+                                    const std::vector<unsigned int> &start,
+                                    const std::vector<unsigned int> &count,
+                                    const std::vector<unsigned int> &imap,
+                                    double *ip) const {
+  m_impl->drain();
+  NC3File::get_varm_double_impl(variable_name, start, count, imap, ip);
+}
+
+void NC3Async::put_vara_double_impl(const std::string &variable_name,
+                                    const std::vector<unsigned int> &start,
+                                    const std::vector<unsigned int> &count,
+                                    const double *op) const {
+  // writes smaller than this are not staged
+  const size_t min_staged_size = 64 * 1024;
+
+  int rank = 0, size = 1;
+  MPI_Comm_rank(m_com, &rank);
+  MPI_Comm_size(m_com, &size);
+
+  const int ndims = static_cast<int>(start.size());
+
+  std::vector<unsigned int> patch(start);
+  patch.insert(patch.end(), count.begin(), count.end());
+
+  int local_size = 1;
+  for (auto c : count) {
+    local_size *= c;
+  }
+
+  WriteRequest request;
+  std::vector<int> offsets;
+  if (rank == 0) {
+    request.ndims = ndims;
+    request.patches.resize(2 * ndims * size);
+    request.sizes.resize(size);
+    offsets.resize(size);
+  }
+
+  MPI_Gather(patch.data(), 2 * ndims, MPI_UNSIGNED,
+             request.patches.data(), 2 * ndims, MPI_UNSIGNED, 0, m_com);
+  MPI_Gather(&local_size, 1, MPI_INT, request.sizes.data(), 1, MPI_INT, 0, m_com);
+
+  if (rank == 0) {
+    int total = 0;
+    for (int r = 0; r < size; ++r) {
+      offsets[r] = total;
+      total += request.sizes[r];
+    }
+    request.data.resize(total);
+  }
+
+  MPI_Gatherv(const_cast<double*>(op), local_size, MPI_DOUBLE,
+              request.data.data(), request.sizes.data(), offsets.data(), MPI_DOUBLE,
+              0, m_com);
+
+  if (rank != 0) {
+    return;
+  }
+
+  // Only rank 0 gets here. The gather above did not lock netcdf_mutex(), so it did not
+  // wait for the background thread writing previous requests.
+  {
+    std::lock_guard<std::recursive_mutex> netcdf_lock(netcdf_mutex());
+
+    request.file_id = m_file_id;
+    int stat = nc_inq_varid(m_file_id, variable_name.c_str(), &request.varid);
+    if (stat != NC_NOERR) {
+      // report this error when closing the file (other ranks returned already)
+      m_impl->status = stat;
+      return;
+    }
+
+    if (request.size_in_bytes() < min_staged_size) {
+      m_impl->write(request);
+      return;
+    }
+  }
+
+  bool full = false;
+  {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->queued_bytes += request.size_in_bytes();
+    m_impl->queue.push_back(std::move(request));
+    full = m_impl->queued_bytes > m_impl->buffer_size;
+  }
+  m_impl->cv.notify_one();
+
+  if (not full) {
+    return;
+  }
+
+  // Back-pressure: if too much data is staged, write the oldest requests now. Holding
+  // netcdf_mutex() while taking a request from the queue ensures that the background
+  // thread is not writing at the same time.
+  std::lock_guard<std::recursive_mutex> netcdf_lock(netcdf_mutex());
+  WriteRequest oldest;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(m_impl->mutex);
+      if (m_impl->queued_bytes <= m_impl->buffer_size) {
+        break;
+      }
+    }
+    if (not m_impl->pop(oldest)) {
+      break;
+    }
+    m_impl->write(oldest);
+  }
+}
+
+// Methods below write all staged data first: a staged write must not run while the file
+// is in define mode (e.g. after redef() called to add an attribute).
+
+void NC3Async::enddef_impl() const {
+  m_impl->drain();
+  NC3File::enddef_impl();
+}
+
+void NC3Async::redef_impl() const {
+  m_impl->drain();
+  NC3File::redef_impl();
+}
+
+void NC3Async::def_dim_impl(const std::string &name, size_t length) const {
+  m_impl->drain();
+  NC3File::def_dim_impl(name, length);
+}
+
+void NC3Async::inq_dimid_impl(const std::string &dimension_name, bool &exists) const {
+  m_impl->drain();
+  NC3File::inq_dimid_impl(dimension_name, exists);
+}
+
+void NC3Async::inq_dimlen_impl(const std::string &dimension_name,
+                               unsigned int &result) const {
+  m_impl->drain();
+  NC3File::inq_dimlen_impl(dimension_name, result);
+}
+
+void NC3Async::inq_unlimdim_impl(std::string &result) const {
+  m_impl->drain();
+  NC3File::inq_unlimdim_impl(result);
+}
+
+void NC3Async::def_var_impl(const std::string &name,
+                            IO_Type nctype,
+                            const std::vector<std::string> &dims) const {
+  m_impl->drain();
+  NC3File::def_var_impl(name, nctype, dims);
+}
+
+void NC3Async::inq_nvars_impl(int &result) const {
+  m_impl->drain();
+  NC3File::inq_nvars_impl(result);
+}
+
+void NC3Async::inq_vardimid_impl(const std::string &variable_name,
+                                 std::vector<std::string> &result) const {
+  m_impl->drain();
+  NC3File::inq_vardimid_impl(variable_name, result);
+}
+
+void NC3Async::inq_varnatts_impl(const std::string &variable_name, int &result) const {
+  m_impl->drain();
+  NC3File::inq_varnatts_impl(variable_name, result);
+}
+
+void NC3Async::inq_varid_impl(const std::string &variable_name, bool &exists) const {
+  m_impl->drain();
+  NC3File::inq_varid_impl(variable_name, exists);
+}
+
+void NC3Async::inq_varname_impl(unsigned int j, std::string &result) const {
+  m_impl->drain();
+  NC3File::inq_varname_impl(j, result);
+}
+
+void NC3Async::get_att_double_impl(const std::string &variable_name,
+                                   const std::string &att_name,
+                                   std::vector<double> &result) const {
+  m_impl->drain();
+  NC3File::get_att_double_impl(variable_name, att_name, result);
+}
+
+void NC3Async::get_att_text_impl(const std::string &variable_name,
+                                 const std::string &att_name,
+                                 std::string &result) const {
+  m_impl->drain();
+  NC3File::get_att_text_impl(variable_name, att_name, result);
+}
+
+void NC3Async::put_att_double_impl(const std::string &variable_name,
+                                   const std::string &att_name,
+                                   IO_Type xtype,
+                                   const std::vector<double> &data) const {
+  m_impl->drain();
+  NC3File::put_att_double_impl(variable_name, att_name, xtype, data);
+}
+
+void NC3Async::put_att_text_impl(const std::string &variable_name,
+                                 const std::string &att_name,
+                                 const std::string &value) const {
+  m_impl->drain();
+  NC3File::put_att_text_impl(variable_name, att_name, value);
+}
+
+void NC3Async::inq_attname_impl(const std::string &variable_name,
+                                unsigned int n,
+                                std::string &result) const {
+  m_impl->drain();
+  NC3File::inq_attname_impl(variable_name, n, result);
+}
+
+void NC3Async::inq_atttype_impl(const std::string &variable_name,
+                                const std::string &att_name,
+                                IO_Type &result) const {
+  m_impl->drain();
+  NC3File::inq_atttype_impl(variable_name, att_name, result);
+}
+
+void NC3Async::set_fill_impl(int fillmode, int &old_modep) const {
+  m_impl->drain();
+  NC3File::set_fill_impl(fillmode, old_modep);
+}
+
+void NC3Async::del_att_impl(const std::string &variable_name,
+                            const std::string &att_name) const {
+  m_impl->drain();
+  NC3File::del_att_impl(variable_name, att_name);
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,106 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _PISMNC3ASYNC_H_
+#define _PISMNC3ASYNC_H_
+
+#include "NC3File.hh"
+
+namespace pism {
+namespace io {
+
+//! NetCDF-3 I/O writing large variables in a background thread.
+/*!
+ * When writing a variable all ranks send their patches to rank 0 (one collective call)
+ * and return. Rank 0 copies gathered data into a staging buffer that is written by a
+ * background thread while the model continues.
+ *
+ * - Only rank 0 uses the NetCDF library, so the background thread does not make any MPI
+ *   calls.
+ * - Calls to the NetCDF library are serialized using netcdf_mutex(). Gathering and staging
+ *   use a separate lock guarding the queue only, so they do not wait for the background
+ *   thread to finish writing.
+ * - The amount of staged data is bounded: if the buffer is full, the main thread writes
+ *   the oldest staged request itself ("back-pressure").
+ * - Small writes (e.g. time and time bounds) are not staged so that the length of the
+ *   time dimension is always up to date.
+ * - Staged data is written before any other operation on the file (reading, defining
+ *   dimensions, variables and attributes, switching to define mode, synchronizing and
+ *   closing).
+ */
+class NC3Async : public NC3File
+{
+public:
+  /*!
+   * @param[in] com communicator
+   * @param[in] buffer_size maximum amount of staged data, in bytes
+   */
+  NC3Async(MPI_Comm com, size_t buffer_size = 256 * 1024 * 1024);
+  virtual ~NC3Async();
+
+protected:
+  void sync_impl() const;
+  void close_impl();
+
+  void get_vara_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            double *ip) const;
+
+  void get_varm_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            const std::vector<unsigned int> &imap,
+                            double *ip) const;
+
+  void put_vara_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            const double *op) const;
+
+  // Everything else waits for staged data to be written: a staged write must not run
+  // while the file is in define mode, and queries should see all data written so far.
+  void enddef_impl() const;
+  void redef_impl() const;
+  void def_dim_impl(const std::string &name, size_t length) const;
+  void inq_dimid_impl(const std::string &dimension_name, bool &exists) const;
+  void inq_dimlen_impl(const std::string &dimension_name, unsigned int &result) const;
+  void inq_unlimdim_impl(std::string &result) const;
+  void def_var_impl(const std::string &name, IO_Type nctype, const std::vector<std::string> &dims) const;
+  void inq_nvars_impl(int &result) const;
+  void inq_vardimid_impl(const std::string &variable_name, std::vector<std::string> &result) const;
+  void inq_varnatts_impl(const std::string &variable_name, int &result) const;
+  void inq_varid_impl(const std::string &variable_name, bool &exists) const;
+  void inq_varname_impl(unsigned int j, std::string &result) const;
+  void get_att_double_impl(const std::string &variable_name, const std::string &att_name, std::vector<double> &result) const;
+  void get_att_text_impl(const std::string &variable_name, const std::string &att_name, std::string &result) const;
+  void put_att_double_impl(const std::string &variable_name, const std::string &att_name, IO_Type xtype, const std::vector<double> &data) const;
+  void put_att_text_impl(const std::string &variable_name, const std::string &att_name, const std::string &value) const;
+  void inq_attname_impl(const std::string &variable_name, unsigned int n, std::string &result) const;
+  void inq_atttype_impl(const std::string &variable_name, const std::string &att_name, IO_Type &result) const;
+  void set_fill_impl(int fillmode, int &old_modep) const;
+  void del_att_impl(const std::string &variable_name, const std::string &att_name) const;
+private:
+  struct Impl;
+  Impl *m_impl;
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* _PISMNC3ASYNC_H_ */
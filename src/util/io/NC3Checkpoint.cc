@@ -0,0 +1,545 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "NC3Checkpoint.hh"
+
+#include <cstdint>
+#include <cstdio>               // fopen, rename
+#include <cstring>              // memcmp, memcpy
+#include <map>
+#include <sstream>
+#include <algorithm>
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+static void check(const ErrorLocation &where, int stat, const std::string &filename) {
+  if (stat != MPI_SUCCESS) {
+    char message[MPI_MAX_ERROR_STRING];
+    int length = 0;
+    MPI_Error_string(stat, message, &length);
+    throw RuntimeError::formatted(where, "MPI-IO error (file '%s'): %s",
+                                  filename.c_str(), message);
+  }
+}
+
+//! Marks the end of a data file (not NULL-terminated).
+static const char checkpoint_magic[8] = {'P', 'I', 'S', 'M', 'C', 'K', 'P', 'T'};
+
+//! Size of the trailer: the magic string, the offset and the length of the index.
+static const int trailer_size = 8 + 2 * sizeof(uint64_t);
+
+//! One record of one variable in a data file.
+struct CheckpointBlock {
+  unsigned int record;
+  unsigned int z_count;
+  //! offset of the block, in doubles
+  uint64_t offset;
+  //! patches (xs, xm, ys, ym) of all ranks, in the order they are stored
+  std::vector<unsigned int> patches;
+};
+
+struct NC3Checkpoint::Impl {
+  Impl()
+    : file(MPI_FILE_NULL), writing(false), size(0) {
+    // empty
+  }
+
+  std::string index_to_string() const;
+  void index_from_string(const std::string &text);
+  const CheckpointBlock* find(const std::string &variable_name, unsigned int record) const;
+
+  MPI_File file;
+  //! name of the data file
+  std::string filename;
+  bool writing;
+  //! number of doubles written so far
+  uint64_t size;
+  //! blocks of each variable
+  std::map<std::string, std::vector<CheckpointBlock> > index;
+};
+
+//! Convert the index to text: one line per block.
+std::string NC3Checkpoint::Impl::index_to_string() const {
+  std::ostringstream result;
+
+  for (const auto &v : index) {
+    for (const auto &b : v.second) {
+      result << v.first << " " << b.record << " " << b.z_count << " " << b.offset << " "
+             << b.patches.size() / 4;
+      for (auto p : b.patches) {
+        result << " " << p;
+      }
+      result << "\n";
+    }
+  }
+
+  return result.str();
+}
+
+void NC3Checkpoint::Impl::index_from_string(const std::string &text) {
+  index.clear();
+
+  std::istringstream input(text);
+  std::string line;
+  while (std::getline(input, line)) {
+    std::istringstream fields(line);
+
+    std::string name;
+    CheckpointBlock b;
+    size_t n_patches = 0;
+    fields >> name >> b.record >> b.z_count >> b.offset >> n_patches;
+
+    b.patches.resize(4 * n_patches);
+    for (auto &p : b.patches) {
+      fields >> p;
+    }
+
+    if (fields.fail()) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid index entry in '%s': '%s'",
+                                    filename.c_str(), line.c_str());
+    }
+
+    index[name].push_back(b);
+  }
+}
+
+//! Find the block containing `record` of `variable_name`. Returns NULL if not found.
+const CheckpointBlock* NC3Checkpoint::Impl::find(const std::string &variable_name,
+                                                 unsigned int record) const {
+  auto v = index.find(variable_name);
+  if (v == index.end()) {
+    return nullptr;
+  }
+
+  // if a record was written more than once, use the last copy
+  const auto &blocks = v->second;
+  for (auto b = blocks.rbegin(); b != blocks.rend(); ++b) {
+    if (b->record == record) {
+      return &(*b);
+    }
+  }
+  return nullptr;
+}
+
+NC3Checkpoint::NC3Checkpoint(MPI_Comm com)
+  : NC3File(com), m_impl(new Impl()) {
+  // empty
+}
+
+NC3Checkpoint::~NC3Checkpoint() {
+  if (m_impl->file != MPI_FILE_NULL) {
+    MPI_File_close(&m_impl->file);
+  }
+  delete m_impl;
+}
+
+//! Name of the data file corresponding to the NetCDF file `filename`.
+std::string NC3Checkpoint::data_filename(const std::string &filename) {
+  return filename + ".data";
+}
+
+//! Name of the file `filename` without the directory part.
+static std::string file_part(const std::string &filename) {
+  size_t slash = filename.find_last_of('/');
+  return slash == std::string::npos ? filename : filename.substr(slash + 1);
+}
+
+//! Directory part of `filename` (including the trailing slash, empty if none).
+static std::string directory_part(const std::string &filename) {
+  size_t slash = filename.find_last_of('/');
+  return slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+}
+
+/*!
+ * Rename the data file of `filename` so that it matches `filename` moved by
+ * io::move_if_exists() (only rank 0 does the job) and update the `checkpoint_data`
+ * attribute of the moved NetCDF file.
+ */
+void NC3Checkpoint::move_data_file(MPI_Comm com, const std::string &filename) {
+  int stat = 0, moved = 0, rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  std::string
+    data_file   = data_filename(filename),
+    backup_file = data_filename(filename + "~");
+
+  if (rank == 0) {
+    if (FILE *f = fopen(data_file.c_str(), "r")) {
+      fclose(f);
+      stat = rename(data_file.c_str(), backup_file.c_str());
+      moved = 1;
+    }
+  }
+
+  MPI_Bcast(&stat, 1, MPI_INT, 0, com);
+  MPI_Bcast(&moved, 1, MPI_INT, 0, com);
+
+  if (stat != 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "can't move '%s' to '%s'",
+                                  data_file.c_str(), backup_file.c_str());
+  }
+
+  if (moved == 0) {
+    return;
+  }
+
+  // the moved NetCDF file has to refer to the moved data file
+  NC3File backup(com);
+  backup.open(filename + "~", PISM_READWRITE);
+
+  std::string name;
+  backup.get_att_text("PISM_GLOBAL", "checkpoint_data", name);
+  if (not name.empty()) {
+    backup.redef();
+    backup.put_att_text("PISM_GLOBAL", "checkpoint_data", file_part(backup_file));
+  }
+  backup.close();
+}
+
+void NC3Checkpoint::open_impl(const std::string &filename, IO_Mode mode) {
+  if (mode != PISM_READONLY) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot open '%s' for writing: appending to checkpoint"
+                                  " files is not supported", filename.c_str());
+  }
+
+  NC3File::open_impl(filename, mode);
+
+  // the name of the data file is relative to the directory containing the NetCDF file
+  std::string name;
+  NC3File::get_att_text_impl("PISM_GLOBAL", "checkpoint_data", name);
+  if (name.empty()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "'%s' is not a PISM checkpoint file"
+                                  " (the attribute 'checkpoint_data' is missing)",
+                                  filename.c_str());
+  }
+
+  m_impl->filename = name[0] == '/' ? name : directory_part(filename) + name;
+  m_impl->writing  = false;
+
+  int rank = 0;
+  MPI_Comm_rank(m_com, &rank);
+
+  int exists = 0;
+  if (rank == 0) {
+    if (FILE *f = fopen(m_impl->filename.c_str(), "r")) {
+      fclose(f);
+      exists = 1;
+    }
+  }
+  MPI_Bcast(&exists, 1, MPI_INT, 0, m_com);
+
+  if (exists == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "the data file '%s' of the checkpoint '%s' is missing",
+                                  m_impl->filename.c_str(), filename.c_str());
+  }
+
+  int stat = MPI_File_open(m_com, m_impl->filename.c_str(), MPI_MODE_RDONLY,
+                           MPI_INFO_NULL, &m_impl->file);
+  check(PISM_ERROR_LOCATION, stat, m_impl->filename);
+
+  // read the index on rank 0
+  int success = 1;
+  uint64_t length = 0;
+  std::string text;
+  if (rank == 0) {
+    MPI_Offset size = 0;
+    MPI_File_get_size(m_impl->file, &size);
+
+    char trailer[trailer_size];
+    MPI_Status status;
+    if (size < trailer_size or
+        MPI_File_read_at(m_impl->file, size - trailer_size, trailer, trailer_size,
+                         MPI_CHAR, &status) != MPI_SUCCESS or
+        memcmp(trailer, checkpoint_magic, 8) != 0) {
+      success = 0;
+    } else {
+      uint64_t offset = 0;
+      memcpy(&offset, trailer + 8, sizeof(uint64_t));
+      memcpy(&length, trailer + 8 + sizeof(uint64_t), sizeof(uint64_t));
+
+      text.resize(length);
+      if (length > 0 and
+          MPI_File_read_at(m_impl->file, offset, &text[0], length,
+                           MPI_CHAR, &status) != MPI_SUCCESS) {
+        success = 0;
+      }
+    }
+  }
+
+  MPI_Bcast(&success, 1, MPI_INT, 0, m_com);
+  if (success == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "'%s' is not a valid PISM checkpoint data file",
+                                  m_impl->filename.c_str());
+  }
+
+  MPI_Bcast(&length, 1, MPI_UINT64_T, 0, m_com);
+  text.resize(length);
+  if (length > 0) {
+    MPI_Bcast(&text[0], length, MPI_CHAR, 0, m_com);
+  }
+
+  m_impl->index_from_string(text);
+}
+
+void NC3Checkpoint::create_impl(const std::string &filename) {
+  NC3File::create_impl(filename);
+
+  m_impl->filename = data_filename(filename);
+  m_impl->writing  = true;
+  m_impl->size     = 0;
+  m_impl->index.clear();
+
+  // mark the NetCDF file; the data file is in the same directory
+  NC3File::put_att_text_impl("PISM_GLOBAL", "checkpoint_data", file_part(m_impl->filename));
+
+  int stat = MPI_File_open(m_com, m_impl->filename.c_str(),
+                           MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                           MPI_INFO_NULL, &m_impl->file);
+  check(PISM_ERROR_LOCATION, stat, m_impl->filename);
+
+  stat = MPI_File_set_size(m_impl->file, 0);
+  check(PISM_ERROR_LOCATION, stat, m_impl->filename);
+}
+
+void NC3Checkpoint::sync_impl() const {
+  if (m_impl->writing and m_impl->file != MPI_FILE_NULL) {
+    int stat = MPI_File_sync(m_impl->file);
+    check(PISM_ERROR_LOCATION, stat, m_impl->filename);
+  }
+
+  NC3File::sync_impl();
+}
+
+void NC3Checkpoint::close_impl() {
+  int stat = MPI_SUCCESS;
+
+  if (m_impl->writing) {
+    // rank 0 appends the index and the trailer
+    int rank = 0;
+    MPI_Comm_rank(m_com, &rank);
+
+    if (rank == 0) {
+      std::string text = m_impl->index_to_string();
+
+      uint64_t
+        offset = m_impl->size * sizeof(double),
+        length = text.size();
+
+      char trailer[trailer_size];
+      memcpy(trailer, checkpoint_magic, 8);
+      memcpy(trailer + 8, &offset, sizeof(uint64_t));
+      memcpy(trailer + 8 + sizeof(uint64_t), &length, sizeof(uint64_t));
+
+      MPI_Status status;
+      if (length > 0) {
+        stat = MPI_File_write_at(m_impl->file, offset, &text[0], length, MPI_CHAR, &status);
+      }
+      if (stat == MPI_SUCCESS) {
+        stat = MPI_File_write_at(m_impl->file, offset + length, trailer, trailer_size,
+                                 MPI_CHAR, &status);
+      }
+    }
+
+    MPI_Bcast(&stat, 1, MPI_INT, 0, m_com);
+  }
+
+  if (m_impl->file != MPI_FILE_NULL) {
+    MPI_File_close(&m_impl->file);
+  }
+  m_impl->index.clear();
+  m_impl->writing = false;
+
+  NC3File::close_impl();
+
+  check(PISM_ERROR_LOCATION, stat, m_impl->filename);
+}
+
+/*!
+ * Read a part of a variable stored in the data file, assembling it from intersecting
+ * patches. Variables that are not in the data file are read from the NetCDF file.
+ *
+ * Each rank reads what it needs independently.
+ */
+void NC3Checkpoint::get_vara_double_impl(const std::string &variable_name,
+                                         const std::vector<unsigned int> &start,
+                                         const std::vector<unsigned int> &count,
+                                         double *ip) const {
+  auto v = m_impl->index.find(variable_name);
+  if (v == m_impl->index.end()) {
+    NC3File::get_vara_double_impl(variable_name, start, count, ip);
+    return;
+  }
+
+  const unsigned int
+    z_count        = v->second.front().z_count,
+    ndims          = start.size();
+  const bool time_dependent = ((z_count  > 1 and ndims == 4) or
+                               (z_count == 1 and ndims == 3));
+  const unsigned int
+    T  = time_dependent ? 1 : 0,
+    t  = time_dependent ? start[0] : 0,
+    y0 = start[T],     ny = count[T],
+    x0 = start[T + 1], nx = count[T + 1],
+    z0 = ndims > T + 2 ? start[T + 2] : 0,
+    nz = ndims > T + 2 ? count[T + 2] : 1;
+
+  const CheckpointBlock *block = m_impl->find(variable_name, t);
+  if (block == nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "record %d of '%s' is not in '%s'",
+                                  (int)t, variable_name.c_str(), m_impl->filename.c_str());
+  }
+
+  if (z0 + nz > z_count) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "'%s' in '%s' has %d levels (requested %d..%d)",
+                                  variable_name.c_str(), m_impl->filename.c_str(),
+                                  (int)z_count, (int)z0, (int)(z0 + nz - 1));
+  }
+
+  std::vector<double> buffer;
+  uint64_t patch_offset = block->offset;
+  for (size_t p = 0; p < block->patches.size() / 4; ++p) {
+    const unsigned int
+      xs = block->patches[4 * p + 0],
+      xm = block->patches[4 * p + 1],
+      ys = block->patches[4 * p + 2],
+      ym = block->patches[4 * p + 3];
+
+    const unsigned int
+      i0 = std::max(x0, xs),
+      i1 = std::min(x0 + nx, xs + xm),
+      j0 = std::max(y0, ys),
+      j1 = std::min(y0 + ny, ys + ym);
+
+    if (i0 < i1 and j0 < j1) {
+      const unsigned int width = i1 - i0, row_size = width * z_count;
+
+      buffer.resize((j1 - j0) * row_size);
+
+      MPI_Status status;
+      int stat = MPI_SUCCESS;
+      if (width == xm) {
+        // rows of the intersection are contiguous in the file
+        MPI_Offset offset = (patch_offset + (uint64_t)(j0 - ys) * xm * z_count) * sizeof(double);
+        stat = MPI_File_read_at(m_impl->file, offset, buffer.data(), buffer.size(),
+                                MPI_DOUBLE, &status);
+      } else {
+        for (unsigned int j = j0; j < j1 and stat == MPI_SUCCESS; ++j) {
+          MPI_Offset offset = (patch_offset +
+                               ((uint64_t)(j - ys) * xm + (i0 - xs)) * z_count) * sizeof(double);
+          stat = MPI_File_read_at(m_impl->file, offset, &buffer[(j - j0) * row_size], row_size,
+                                  MPI_DOUBLE, &status);
+        }
+      }
+      check(PISM_ERROR_LOCATION, stat, m_impl->filename);
+
+      for (unsigned int j = j0; j < j1; ++j) {
+        for (unsigned int i = i0; i < i1; ++i) {
+          const double *column = &buffer[(j - j0) * row_size + (i - i0) * z_count + z0];
+          double *result = &ip[((j - y0) * nx + (i - x0)) * nz];
+          for (unsigned int k = 0; k < nz; ++k) {
+            result[k] = column[k];
+          }
+        }
+      }
+    }
+
+    patch_offset += (uint64_t)xm * ym * z_count;
+  }
+}
+
+void NC3Checkpoint::get_varm_double_impl(const std::string &variable_name,
+                                         const std::vector<unsigned int> &start,
+                                         const std::vector<unsigned int> &count,
+                                         const std::vector<unsigned int> &imap,
+                                         double *ip) const {
+  if (m_impl->index.find(variable_name) != m_impl->index.end()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "transposed reading of '%s' from a checkpoint is not supported",
+                                  variable_name.c_str());
+  }
+  NC3File::get_varm_double_impl(variable_name, start, count, imap, ip);
+}
+
+/*!
+ * Write the patch of this rank to the data file. All ranks write using one collective
+ * MPI-IO call.
+ */
+void NC3Checkpoint::write_darray_impl(const std::string &variable_name,
+                                      const IceGrid &grid,
+                                      unsigned int z_count,
+                                      unsigned int record,
+                                      const double *input) {
+  std::vector<std::string> dims;
+  this->inq_vardimid(variable_name, dims);
+
+  unsigned int ndims = dims.size();
+
+  bool time_dependent = ((z_count  > 1 and ndims == 4) or
+                         (z_count == 1 and ndims == 3));
+
+  int rank = 0, size = 1;
+  MPI_Comm_rank(m_com, &rank);
+  MPI_Comm_size(m_com, &size);
+
+  unsigned int patch[4] = {(unsigned int)grid.xs(), (unsigned int)grid.xm(),
+                           (unsigned int)grid.ys(), (unsigned int)grid.ym()};
+
+  std::vector<unsigned int> patches(4 * size);
+  MPI_Allgather(patch, 4, MPI_UNSIGNED, patches.data(), 4, MPI_UNSIGNED, m_com);
+
+  uint64_t local_offset = 0, total = 0;
+  for (int r = 0; r < size; ++r) {
+    uint64_t n = (uint64_t)patches[4 * r + 1] * patches[4 * r + 3] * z_count;
+    if (r < rank) {
+      local_offset += n;
+    }
+    total += n;
+  }
+
+  const int local_size = grid.xm() * grid.ym() * z_count;
+
+  MPI_Offset offset = (m_impl->size + local_offset) * sizeof(double);
+  MPI_Status status;
+  int stat = MPI_File_write_at_all(m_impl->file, offset, const_cast<double*>(input),
+                                   local_size, MPI_DOUBLE, &status);
+  check(PISM_ERROR_LOCATION, stat, m_impl->filename);
+
+  CheckpointBlock block;
+  block.record  = time_dependent ? record : 0;
+  block.z_count = z_count;
+  block.offset  = m_impl->size;
+  block.patches = patches;
+  m_impl->index[variable_name].push_back(block);
+
+  m_impl->size += total;
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,87 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _PISMNC3CHECKPOINT_H_
+#define _PISMNC3CHECKPOINT_H_
+
+#include "NC3File.hh"
+
+namespace pism {
+namespace io {
+
+//! NetCDF-3 I/O writing spatial fields to a separate binary file, one block per rank.
+/*!
+ * Metadata, coordinate variables and time series are written to a NetCDF-3 file as
+ * usual. Distributed arrays (2D and 3D fields) are written to the "data file"
+ * (see data_filename()) using one collective MPI-IO call per field: each rank writes its
+ * patch as it is stored in memory, so there is no gathering on rank 0 and no
+ * transposition.
+ *
+ * The data file ends with an index listing the variable, record and patches of each
+ * block. Reading uses this index and works with any domain decomposition; a rank reading
+ * its own patch (re-starting using the same number of processes) makes one read per field.
+ *
+ * Files written using this backend are marked using the global attribute
+ * `checkpoint_data`, so that they are opened using this backend when read. It contains
+ * the name of the data file relative to the directory containing the NetCDF file.
+ *
+ * Spatial variables in the NetCDF file contain no data, so tools other than PISM cannot
+ * read them.
+ */
+class NC3Checkpoint : public NC3File
+{
+public:
+  NC3Checkpoint(MPI_Comm com);
+  virtual ~NC3Checkpoint();
+
+  static std::string data_filename(const std::string &filename);
+  static void move_data_file(MPI_Comm com, const std::string &filename);
+protected:
+  void open_impl(const std::string &filename, IO_Mode mode);
+
+  void create_impl(const std::string &filename);
+
+  void sync_impl() const;
+
+  void close_impl();
+
+  void get_vara_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            double *ip) const;
+
+  void get_varm_double_impl(const std::string &variable_name,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
+                            const std::vector<unsigned int> &imap,
+                            double *ip) const;
+
+  void write_darray_impl(const std::string &variable_name,
+                         const IceGrid &grid,
+                         unsigned int z_count,
+                         unsigned int record,
+                         const double *input);
+private:
+  struct Impl;
+  Impl *m_impl;
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* _PISMNC3CHECKPOINT_H_ */
@@ -133,10 +133,8 @@ void NC3File::sync_impl() const {
 void NC3File::enddef_impl() const {
   int stat = NC_NOERR;
 
-  int header_size = 200 * 1024;
-
   if (m_rank == 0) {
-    stat = nc__enddef(m_file_id, header_size, 4, 0, 4);
+    stat = nc__enddef(m_file_id, m_header_padding, 4, 0, 4);
   }
 
   MPI_Barrier(m_com);
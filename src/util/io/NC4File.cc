@@ -145,6 +145,15 @@ void NC4File::def_var_impl(const std::string &name,
   }
 }
 
+void NC4File::set_compression_level_impl(int level) {
+  if (level < 0 or level > 9) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid compression level %d (valid values: 0 to 9)",
+                                  level);
+  }
+  m_compression_level = level;
+}
+
 void NC4File::def_var_chunking_impl(const std::string &name,
                                    std::vector<size_t> &dimensions) const {
   int stat = 0, varid = 0;
@@ -25,6 +25,7 @@
 // have a parallel NetCDF library.
 extern "C" {
 #include <netcdf.h>
+#include <netcdf_meta.h>
 #include <netcdf_par.h>
 }
 
@@ -61,10 +62,27 @@ void NC4_Par::create_impl(const std::string &fname) {
   check(PISM_ERROR_LOCATION, stat);
 }
 
+/*!
+ * Parallel writes to compressed variables require NetCDF >= 4.7.4 built with HDF5 >=
+ * 1.10.3 (this is what NC_HAS_PAR_FILTERS indicates).
+ */
+void NC4_Par::set_compression_level_impl(int level) {
+#if defined(NC_HAS_PAR_FILTERS) && (NC_HAS_PAR_FILTERS == 1)
+  NC4File::set_compression_level_impl(level);
+#else
+  if (level > 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "parallel compression (level %d) requires NetCDF >= 4.7.4"
+                                  " with support for parallel filters",
+                                  level);
+  }
+#endif
+}
+
 void NC4_Par::set_access_mode(int varid, bool transposed) const {
   int stat;
 
-  if (transposed) {
+  if (transposed and m_compression_level == 0) {
     // Use independent parallel access mode because it works. It would be
     // better to use collective mode, but I/O performance is ruined by
     // the transpose anyway.
@@ -74,7 +92,7 @@ void NC4_Par::set_access_mode(int varid, bool transposed) const {
     stat = nc_var_par_access(m_file_id, varid, NC_INDEPENDENT); check(PISM_ERROR_LOCATION, stat);
   } else {
     // Use collective parallel access mode because it is faster (and because it
-    // works in this case).
+    // works in this case). Writes to compressed variables have to be collective.
     stat = nc_var_par_access(m_file_id, varid, NC_COLLECTIVE); check(PISM_ERROR_LOCATION, stat);
   }
 }
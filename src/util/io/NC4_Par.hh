@@ -36,6 +36,8 @@ protected:
 
   virtual void create_impl(const std::string &filename);
 
+  virtual void set_compression_level_impl(int level);
+
   virtual void set_access_mode(int varid, bool mapped) const;
 };
 
@@ -19,6 +19,8 @@
 #include "NCFile.hh"
 
 #include <cstdio>               // fprintf, stderr, rename, remove
+#include <mutex>
+#include <algorithm>            // std::max
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/IceGrid.hh"
@@ -33,8 +35,17 @@
 namespace pism {
 namespace io {
 
+typedef std::lock_guard<std::recursive_mutex> Lock;
+typedef std::unique_lock<std::recursive_mutex> WriteLock;
+
+std::recursive_mutex &netcdf_mutex() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+
 NCFile::NCFile(MPI_Comm c)
-  : m_com(c), m_file_id(-1), m_define_mode(false) {
+  : m_com(c), m_file_id(-1), m_header_padding(200 * 1024), m_unlocked_writes(false),
+    m_define_mode(false) {
 }
 
 NCFile::~NCFile() {
@@ -52,14 +63,27 @@ void NCFile::def_var_chunking_impl(const std::string &name,
   // the default implementation does nothing
 }
 
+void NCFile::set_compression_level_impl(int level) {
+  (void) level;
+  // the default implementation does nothing
+}
+
+
+void NCFile::clear_cache() const {
+  m_cache = MetadataCache();
+}
 
 void NCFile::open(const std::string &filename, IO_Mode mode) {
+  Lock lock(netcdf_mutex());
+  clear_cache();
   this->open_impl(filename, mode);
   m_filename = filename;
   m_define_mode = false;
 }
 
 void NCFile::create(const std::string &filename) {
+  Lock lock(netcdf_mutex());
+  clear_cache();
   this->create_impl(filename);
   m_filename = filename;
   m_define_mode = true;
@@ -67,10 +91,13 @@ void NCFile::create(const std::string &filename) {
 
 void NCFile::sync() const {
   enddef();
+  Lock lock(netcdf_mutex());
   this->sync_impl();
 }
 
 void NCFile::close() {
+  Lock lock(netcdf_mutex());
+  clear_cache();
   this->close_impl();
   m_filename.clear();
   m_file_id = -1;
@@ -78,6 +105,7 @@ void NCFile::close() {
 
 void NCFile::enddef() const {
   if (m_define_mode) {
+    Lock lock(netcdf_mutex());
     this->enddef_impl();
     m_define_mode = false;
   }
@@ -85,6 +113,7 @@ void NCFile::enddef() const {
 
 void NCFile::redef() const {
   if (not m_define_mode) {
+    Lock lock(netcdf_mutex());
     this->redef_impl();
     m_define_mode = true;
   }
@@ -92,32 +121,87 @@ void NCFile::redef() const {
 
 void NCFile::def_dim(const std::string &name, size_t length) const {
   redef();
+  Lock lock(netcdf_mutex());
   this->def_dim_impl(name, length);
+
+  m_cache.dimensions.insert(name);
+  if (length == PISM_UNLIMITED) {
+    // the unlimited dimension changed
+    m_cache.unlimited_dimension_known = false;
+  } else {
+    m_cache.dimension_lengths[name] = length;
+  }
 }
 
 void NCFile::inq_dimid(const std::string &dimension_name, bool &exists) const {
+  if (m_cache.dimensions.find(dimension_name) != m_cache.dimensions.end()) {
+    exists = true;
+    return;
+  }
+
+  Lock lock(netcdf_mutex());
   this->inq_dimid_impl(dimension_name,exists);
+
+  if (exists) {
+    m_cache.dimensions.insert(dimension_name);
+  }
 }
 
 void NCFile::inq_dimlen(const std::string &dimension_name, unsigned int &result) const {
+  auto it = m_cache.dimension_lengths.find(dimension_name);
+  if (it != m_cache.dimension_lengths.end()) {
+    result = it->second;
+    return;
+  }
+
+  Lock lock(netcdf_mutex());
   this->inq_dimlen_impl(dimension_name,result);
+
+  m_cache.dimension_lengths[dimension_name] = result;
 }
 
 void NCFile::inq_unlimdim(std::string &result) const {
+  if (m_cache.unlimited_dimension_known) {
+    result = m_cache.unlimited_dimension;
+    return;
+  }
+
+  Lock lock(netcdf_mutex());
   this->inq_unlimdim_impl(result);
+
+  m_cache.unlimited_dimension       = result;
+  m_cache.unlimited_dimension_known = true;
 }
 
 void NCFile::def_var(const std::string &name, IO_Type nctype,
                     const std::vector<std::string> &dims) const {
   redef();
+  Lock lock(netcdf_mutex());
   this->def_var_impl(name, nctype, dims);
 }
 
 void NCFile::def_var_chunking(const std::string &name,
                               std::vector<size_t> &dimensions) const {
+  Lock lock(netcdf_mutex());
   this->def_var_chunking_impl(name, dimensions);
 }
 
+//! Set the compression level used by variables defined after this call.
+void NCFile::set_compression_level(int level) {
+  this->set_compression_level_impl(level);
+}
+
+/*!
+ * Set the amount of free space to reserve after the header when leaving define mode.
+ *
+ * A NetCDF-3 file with enough free space after the header can get new variables and
+ * attributes without moving all the data that follows the header. Ignored by NetCDF-4 and
+ * ParallelIO backends.
+ */
+void NCFile::set_header_padding(size_t bytes) {
+  m_header_padding = bytes;
+}
+
 
 void NCFile::get_vara_double(const std::string &variable_name,
                             const std::vector<unsigned int> &start,
@@ -131,9 +215,50 @@ void NCFile::get_vara_double(const std::string &variable_name,
 #endif
 
   enddef();
+  Lock lock(netcdf_mutex());
+  this->get_vara_double_impl(variable_name, start, count, ip);
+}
+
+/*!
+ * Start reading a part of a variable into `ip`.
+ *
+ * The data is available after a call to wait_all(). Backends that do not support
+ * non-blocking reads read it right away.
+ */
+void NCFile::iget_vara_double(const std::string &variable_name,
+                              const std::vector<unsigned int> &start,
+                              const std::vector<unsigned int> &count,
+                              double *ip) const {
+#if (Pism_DEBUG==1)
+  if (start.size() != count.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "start and count arrays have to have the same size");
+  }
+#endif
+
+  enddef();
+  Lock lock(netcdf_mutex());
+  this->iget_vara_double_impl(variable_name, start, count, ip);
+}
+
+//! Complete all pending non-blocking operations.
+void NCFile::wait_all() const {
+  Lock lock(netcdf_mutex());
+  this->wait_all_impl();
+}
+
+void NCFile::iget_vara_double_impl(const std::string &variable_name,
+                                   const std::vector<unsigned int> &start,
+                                   const std::vector<unsigned int> &count,
+                                   double *ip) const {
+  // the default implementation uses a blocking read
   this->get_vara_double_impl(variable_name, start, count, ip);
 }
 
+void NCFile::wait_all_impl() const {
+  // the default implementation does nothing
+}
+
 void NCFile::put_vara_double(const std::string &variable_name,
                             const std::vector<unsigned int> &start,
                             const std::vector<unsigned int> &count,
@@ -146,7 +271,46 @@ void NCFile::put_vara_double(const std::string &variable_name,
 #endif
 
   enddef();
+  WriteLock lock(netcdf_mutex(), std::defer_lock);
+  if (not m_unlocked_writes) {
+    lock.lock();
+  }
   this->put_vara_double_impl(variable_name, start, count, op);
+
+  update_unlimited_dimension_length(variable_name, start, count);
+}
+
+/*!
+ * Writing to a variable that depends on the unlimited dimension may make this dimension
+ * longer. Update the cached length accordingly.
+ */
+void NCFile::update_unlimited_dimension_length(const std::string &variable_name,
+                                               const std::vector<unsigned int> &start,
+                                               const std::vector<unsigned int> &count) const {
+  if (not m_cache.unlimited_dimension_known or
+      m_cache.unlimited_dimension.empty()) {
+    return;
+  }
+
+  const std::string &dim = m_cache.unlimited_dimension;
+
+  auto length = m_cache.dimension_lengths.find(dim);
+  if (length == m_cache.dimension_lengths.end()) {
+    // length is not cached: nothing to do
+    return;
+  }
+
+  auto dims = m_cache.variable_dimensions.find(variable_name);
+  if (dims == m_cache.variable_dimensions.end()) {
+    // we don't know if this variable depends on the unlimited dimension
+    m_cache.dimension_lengths.erase(length);
+    return;
+  }
+
+  if (not dims->second.empty() and dims->second[0] == dim and
+      not start.empty() and not count.empty()) {
+    length->second = std::max(length->second, start[0] + count[0]);
+  }
 }
 
 
@@ -156,6 +320,10 @@ void NCFile::write_darray(const std::string &variable_name,
                           unsigned int record,
                           const double *input) {
   enddef();
+  WriteLock lock(netcdf_mutex(), std::defer_lock);
+  if (not m_unlocked_writes) {
+    lock.lock();
+  }
   this->write_darray_impl(variable_name, grid, z_count, record, input);
 }
 
@@ -214,38 +382,63 @@ void NCFile::get_varm_double(const std::string &variable_name,
 #endif
 
   enddef();
+  Lock lock(netcdf_mutex());
   this->get_varm_double_impl(variable_name, start, count, imap, ip);
 }
 
 void NCFile::inq_nvars(int &result) const {
+  Lock lock(netcdf_mutex());
   this->inq_nvars_impl(result);
 }
 
 void NCFile::inq_vardimid(const std::string &variable_name, std::vector<std::string> &result) const {
+  auto it = m_cache.variable_dimensions.find(variable_name);
+  if (it != m_cache.variable_dimensions.end()) {
+    result = it->second;
+    return;
+  }
+
+  Lock lock(netcdf_mutex());
   this->inq_vardimid_impl(variable_name, result);
+
+  m_cache.variable_dimensions[variable_name] = result;
 }
 
 void NCFile::inq_varnatts(const std::string &variable_name, int &result) const {
+  Lock lock(netcdf_mutex());
   this->inq_varnatts_impl(variable_name, result);
 }
 
 void NCFile::inq_varid(const std::string &variable_name, bool &result) const {
+  if (m_cache.variables.find(variable_name) != m_cache.variables.end()) {
+    result = true;
+    return;
+  }
+
+  Lock lock(netcdf_mutex());
   this->inq_varid_impl(variable_name, result);
+
+  if (result) {
+    m_cache.variables.insert(variable_name);
+  }
 }
 
 void NCFile::inq_varname(unsigned int j, std::string &result) const {
+  Lock lock(netcdf_mutex());
   this->inq_varname_impl(j, result);
 }
 
 void NCFile::get_att_double(const std::string &variable_name,
                             const std::string &att_name,
                             std::vector<double> &result) const {
+  Lock lock(netcdf_mutex());
   this->get_att_double_impl(variable_name, att_name, result);
 }
 
 void NCFile::get_att_text(const std::string &variable_name,
                           const std::string &att_name,
                           std::string &result) const {
+  Lock lock(netcdf_mutex());
   this->get_att_text_impl(variable_name, att_name, result);
 }
 
@@ -253,33 +446,39 @@ void NCFile::put_att_double(const std::string &variable_name,
                             const std::string &att_name,
                             IO_Type xtype,
                             const std::vector<double> &data) const {
+  Lock lock(netcdf_mutex());
   this->put_att_double_impl(variable_name, att_name, xtype, data);
 }
 
 void NCFile::put_att_text(const std::string &variable_name,
                           const std::string &att_name,
                           const std::string &value) const {
+  Lock lock(netcdf_mutex());
   this->put_att_text_impl(variable_name, att_name, value);
 }
 
 void NCFile::inq_attname(const std::string &variable_name,
                          unsigned int n,
                          std::string &result) const {
+  Lock lock(netcdf_mutex());
   this->inq_attname_impl(variable_name, n, result);
 }
 
 void NCFile::inq_atttype(const std::string &variable_name,
                          const std::string &att_name,
                          IO_Type &result) const {
+  Lock lock(netcdf_mutex());
   this->inq_atttype_impl(variable_name, att_name, result);
 }
 
 void NCFile::set_fill(int fillmode, int &old_modep) const {
   redef();
+  Lock lock(netcdf_mutex());
   this->set_fill_impl(fillmode, old_modep);
 }
 
 void NCFile::del_att(const std::string &variable_name, const std::string &att_name) const {
+  Lock lock(netcdf_mutex());
   this->del_att_impl(variable_name, att_name);
 }
 
@@ -19,7 +19,10 @@
 #ifndef _PISMNCWRAPPER_H_
 #define _PISMNCWRAPPER_H_
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -34,6 +37,15 @@ class IceGrid;
 //! Input and output code (NetCDF wrappers, etc)
 namespace io {
 
+/*!
+ * The mutex used to serialize calls to I/O libraries made by different threads.
+ *
+ * All NCFile methods lock it (except for writes in backends that set `m_unlocked_writes`),
+ * so code that uses NetCDF in a thread other than the main one (see NC3Async) has to lock it
+ * as well.
+ */
+std::recursive_mutex &netcdf_mutex();
+
 //! \brief The PISM wrapper for a subset of the NetCDF C API.
 /*!
  * The goal of this class is to hide the fact that we need to communicate data
@@ -52,6 +64,10 @@ namespace io {
  *   (Only calls used in PISM.) This is intentional.
  * - Methods of this class should do what corresponding NetCDF C API calls do,
  *   no more and no less.
+ * - Metadata that cannot change while a file is open (existence of dimensions and
+ *   variables, dimensions of a variable, lengths of fixed dimensions) is cached to avoid
+ *   communication. The length of the unlimited dimension is cached too, assuming that
+ *   this NCFile instance is the only one writing to the file.
  */
 class NCFile
 {
@@ -90,11 +106,22 @@ public:
 
   void def_var_chunking(const std::string &name, std::vector<size_t> &dimensions) const;
 
+  void set_compression_level(int level);
+
+  void set_header_padding(size_t bytes);
+
   void get_vara_double(const std::string &variable_name,
                        const std::vector<unsigned int> &start,
                        const std::vector<unsigned int> &count,
                        double *ip) const;
 
+  void iget_vara_double(const std::string &variable_name,
+                        const std::vector<unsigned int> &start,
+                        const std::vector<unsigned int> &count,
+                        double *ip) const;
+
+  void wait_all() const;
+
   void put_vara_double(const std::string &variable_name,
                        const std::vector<unsigned int> &start,
                        const std::vector<unsigned int> &count,
@@ -176,11 +203,20 @@ protected:
   virtual void def_var_chunking_impl(const std::string &name,
                                     std::vector<size_t> &dimensions) const;
 
+  virtual void set_compression_level_impl(int level);
+
   virtual void get_vara_double_impl(const std::string &variable_name,
                                    const std::vector<unsigned int> &start,
                                    const std::vector<unsigned int> &count,
                                    double *ip) const = 0;
 
+  virtual void iget_vara_double_impl(const std::string &variable_name,
+                                     const std::vector<unsigned int> &start,
+                                     const std::vector<unsigned int> &count,
+                                     double *ip) const;
+
+  virtual void wait_all_impl() const;
+
   virtual void put_vara_double_impl(const std::string &variable_name,
                                    const std::vector<unsigned int> &start,
                                    const std::vector<unsigned int> &count,
@@ -231,8 +267,36 @@ protected:                      // data members
   MPI_Comm m_com;
   int m_file_id;
   std::string m_filename;
+  //! free space (in bytes) to reserve after the header of a NetCDF-3 file
+  size_t m_header_padding;
+  //! true if put_vara_double_impl() locks netcdf_mutex() itself (see NC3Async)
+  bool m_unlocked_writes;
 private:
   mutable bool m_define_mode;
+
+  struct MetadataCache {
+    MetadataCache()
+      : unlimited_dimension_known(false) {
+      // empty
+    }
+    //! names of variables known to exist
+    std::set<std::string> variables;
+    //! names of dimensions known to exist
+    std::set<std::string> dimensions;
+    //! dimensions of variables
+    std::map<std::string, std::vector<std::string> > variable_dimensions;
+    //! lengths of dimensions
+    std::map<std::string, unsigned int> dimension_lengths;
+    //! name of the unlimited dimension (empty if there is none)
+    std::string unlimited_dimension;
+    bool unlimited_dimension_known;
+  };
+  mutable MetadataCache m_cache;
+
+  void clear_cache() const;
+  void update_unlimited_dimension_length(const std::string &variable_name,
+                                         const std::vector<unsigned int> &start,
+                                         const std::vector<unsigned int> &count) const;
 };
 
 } // end of namespace io
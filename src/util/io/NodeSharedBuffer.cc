@@ -0,0 +1,129 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "NodeSharedBuffer.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+NodeSharedBuffer::NodeSharedBuffer(MPI_Comm com)
+  : m_node_comm(MPI_COMM_NULL), m_leader_comm(MPI_COMM_NULL),
+    m_window(MPI_WIN_NULL), m_size(0), m_data(nullptr) {
+
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  int ierr = MPI_Comm_split_type(com, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                                 &m_node_comm);
+  if (ierr != MPI_SUCCESS) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "MPI_Comm_split_type failed");
+  }
+
+  int node_rank = 0;
+  MPI_Comm_rank(m_node_comm, &node_rank);
+
+  ierr = MPI_Comm_split(com, node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &m_leader_comm);
+  if (ierr != MPI_SUCCESS) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "MPI_Comm_split failed");
+  }
+}
+
+NodeSharedBuffer::~NodeSharedBuffer() {
+  free_window();
+
+  if (m_leader_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_leader_comm);
+  }
+  if (m_node_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_node_comm);
+  }
+}
+
+MPI_Comm NodeSharedBuffer::leaders() const {
+  return m_leader_comm;
+}
+
+MPI_Comm NodeSharedBuffer::node() const {
+  return m_node_comm;
+}
+
+void NodeSharedBuffer::free_window() {
+  if (m_window != MPI_WIN_NULL) {
+    MPI_Win_unlock_all(m_window);
+    MPI_Win_free(&m_window);
+  }
+  m_size = 0;
+  m_data = nullptr;
+}
+
+/*!
+ * Make sure that the buffer can hold at least `size` doubles and return the pointer to
+ * its beginning.
+ *
+ * Memory is allocated by the node leader. Collective on the node communicator; all ranks
+ * have to use the same `size`.
+ */
+double* NodeSharedBuffer::allocate(size_t size) {
+  if (size <= m_size) {
+    return m_data;
+  }
+
+  free_window();
+
+  int node_rank = 0;
+  MPI_Comm_rank(m_node_comm, &node_rank);
+
+  MPI_Aint local_size = node_rank == 0 ? size * sizeof(double) : 0;
+
+  void *local_data = nullptr;
+  int ierr = MPI_Win_allocate_shared(local_size, sizeof(double), MPI_INFO_NULL,
+                                     m_node_comm, &local_data, &m_window);
+  if (ierr != MPI_SUCCESS) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to allocate a shared buffer of %d doubles",
+                                  (int)size);
+  }
+
+  // get the address of the leader's part of the window
+  MPI_Aint leader_size = 0;
+  int displacement_unit = 0;
+  MPI_Win_shared_query(m_window, 0, &leader_size, &displacement_unit, &m_data);
+
+  // start a passive target epoch; synchronization is done in sync()
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, m_window);
+
+  m_size = size;
+
+  return m_data;
+}
+
+/*!
+ * Synchronize ranks on this node: after this call all ranks see changes made to the
+ * buffer by the leader before the call.
+ *
+ * Collective on the node communicator.
+ */
+void NodeSharedBuffer::sync() const {
+  MPI_Win_sync(m_window);
+  MPI_Barrier(m_node_comm);
+  MPI_Win_sync(m_window);
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,71 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _PISMNODESHAREDBUFFER_H_
+#define _PISMNODESHAREDBUFFER_H_
+
+#include <cstddef>
+#include <mpi.h>
+
+namespace pism {
+namespace io {
+
+//! A buffer shared by all ranks on a compute node.
+/*!
+ * Ranks of a communicator are split into groups of ranks sharing memory (one group per
+ * node). The lowest rank in a group is the "leader". Leaders fill the buffer (an MPI
+ * shared-memory window), then all ranks on the node read from it.
+ *
+ * This is used to read a record of a forcing field once per node instead of once per
+ * rank: see regrid_spatial_variable().
+ */
+class NodeSharedBuffer {
+public:
+  NodeSharedBuffer(MPI_Comm com);
+  ~NodeSharedBuffer();
+
+  //! Communicator containing node leaders (MPI_COMM_NULL on other ranks).
+  MPI_Comm leaders() const;
+
+  //! Communicator containing ranks on this node.
+  MPI_Comm node() const;
+
+  double* allocate(size_t size);
+
+  void sync() const;
+private:
+  void free_window();
+
+  MPI_Comm m_node_comm;
+  MPI_Comm m_leader_comm;
+
+  MPI_Win m_window;
+  //! size of the buffer (number of doubles)
+  size_t m_size;
+  //! start of the buffer (in the address space of this rank)
+  double *m_data;
+
+  // disable copying
+  NodeSharedBuffer(const NodeSharedBuffer &);
+  NodeSharedBuffer& operator=(const NodeSharedBuffer &);
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* _PISMNODESHAREDBUFFER_H_ */
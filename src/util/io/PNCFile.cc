@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -67,12 +67,15 @@ void PNCFile::create_impl(const std::string &fname) {
 }
 
 void PNCFile::sync_impl() const {
+  wait_all_impl();
 
   int stat = ncmpi_sync(m_file_id); check(PISM_ERROR_LOCATION, stat);
 }
 
 
 void PNCFile::close_impl() {
+  wait_all_impl();
+
   int stat = ncmpi_close(m_file_id); check(PISM_ERROR_LOCATION, stat);
 
   m_file_id = -1;
@@ -81,11 +84,13 @@ void PNCFile::close_impl() {
 
 void PNCFile::enddef_impl() const {
 
-  int stat = ncmpi_enddef(m_file_id); check(PISM_ERROR_LOCATION, stat);
+  int stat = ncmpi__enddef(m_file_id, m_header_padding, 4, 0, 4);
+  check(PISM_ERROR_LOCATION, stat);
 }
 
 
 void PNCFile::redef_impl() const {
+  wait_all_impl();
 
   int stat = ncmpi_redef(m_file_id); check(PISM_ERROR_LOCATION, stat);
 }
@@ -115,6 +120,9 @@ void PNCFile::inq_dimlen_impl(const std::string &dimension_name, unsigned int &r
   int stat, dimid = -1;
   MPI_Offset len;
 
+  // the length of the unlimited dimension is updated when pending writes are completed
+  wait_all_impl();
+
   stat = ncmpi_inq_dimid(m_file_id, dimension_name.c_str(), &dimid); check(PISM_ERROR_LOCATION, stat);
 
   stat = ncmpi_inq_dimlen(m_file_id, dimid, &len); check(PISM_ERROR_LOCATION, stat);
@@ -181,9 +189,83 @@ void PNCFile::put_vara_double_impl(const std::string &variable_name,
     nc_stride[j] = 1;
   }
 
-  stat = ncmpi_put_vara_double_all(m_file_id, varid,
-                                   &nc_start[0], &nc_count[0],
-                                   op); check(PISM_ERROR_LOCATION, stat);
+  // Post a non-blocking write and return. Pending writes are completed by wait_all(),
+  // which allows PnetCDF to combine writes of all variables in a record into one
+  // collective request.
+  //
+  // The caller may free `op` after this call, so we keep a copy.
+  size_t length = 1;
+  for (auto c : count) {
+    length *= c;
+  }
+  m_buffers.emplace_back(op, op + length);
+
+  int request = NC_REQ_NULL;
+  stat = ncmpi_iput_vara_double(m_file_id, varid,
+                                &nc_start[0], &nc_count[0],
+                                m_buffers.back().data(), &request);
+  check(PISM_ERROR_LOCATION, stat);
+
+  m_requests.push_back(request);
+
+  // Limit the amount of memory used by pending writes. Note that all ranks post the same
+  // number of requests, so they all reach this limit at the same time.
+  if (m_requests.size() >= max_pending_requests) {
+    wait_all_impl();
+  }
+}
+
+void PNCFile::iget_vara_double_impl(const std::string &variable_name,
+                                    const std::vector<unsigned int> &start,
+                                    const std::vector<unsigned int> &count,
+                                    double *ip) const {
+  int stat, varid, ndims = static_cast<int>(start.size());
+
+  std::vector<MPI_Offset> nc_start(ndims), nc_count(ndims);
+
+  stat = ncmpi_inq_varid(m_file_id, variable_name.c_str(), &varid);
+  check(PISM_ERROR_LOCATION, stat);
+
+  for (int j = 0; j < ndims; ++j) {
+    nc_start[j] = start[j];
+    nc_count[j] = count[j];
+  }
+
+  // Post a non-blocking read. The caller keeps `ip` until wait_all() returns.
+  int request = NC_REQ_NULL;
+  stat = ncmpi_iget_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0], ip, &request);
+  check(PISM_ERROR_LOCATION, stat);
+
+  m_requests.push_back(request);
+
+  if (m_requests.size() >= max_pending_requests) {
+    wait_all_impl();
+  }
+}
+
+/*!
+ * Complete all pending non-blocking reads and writes. Collective.
+ */
+void PNCFile::wait_all_impl() const {
+  if (m_file_id < 0) {
+    return;
+  }
+
+  int n_requests = m_requests.size();
+  std::vector<int> statuses(n_requests, NC_NOERR);
+
+  int stat = ncmpi_wait_all(m_file_id, n_requests,
+                            n_requests > 0 ? &m_requests[0] : NULL,
+                            n_requests > 0 ? &statuses[0] : NULL);
+
+  m_requests.clear();
+  m_buffers.clear();
+
+  check(PISM_ERROR_LOCATION, stat);
+
+  for (auto s : statuses) {
+    check(PISM_ERROR_LOCATION, s);
+  }
 }
 
 
@@ -394,6 +476,9 @@ void PNCFile::get_var_double(const std::string &variable_name,
                             const std::vector<unsigned int> &count,
                             const std::vector<unsigned int> &imap_input, double *ip,
                             bool transposed) const {
+  // make sure that we read data written by this process
+  wait_all_impl();
+
   std::vector<unsigned int> imap = imap_input;
   int stat, varid, ndims = static_cast<int>(start.size());
 
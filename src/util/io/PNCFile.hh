@@ -19,6 +19,9 @@
 #ifndef _PISMPNCFILE_H_
 #define _PISMPNCFILE_H_
 
+#include <list>
+#include <vector>
+
 #include "NCFile.hh"
 
 namespace pism {
@@ -67,6 +70,13 @@ protected:
                       const std::vector<unsigned int> &count,
                       double *ip) const;
 
+  void iget_vara_double_impl(const std::string &variable_name,
+                             const std::vector<unsigned int> &start,
+                             const std::vector<unsigned int> &count,
+                             double *ip) const;
+
+  void wait_all_impl() const;
+
   void put_vara_double_impl(const std::string &variable_name,
                       const std::vector<unsigned int> &start,
                       const std::vector<unsigned int> &count,
@@ -125,6 +135,13 @@ private:
 
   int get_varid(const std::string &variable_name) const;
 
+  //! maximum number of pending non-blocking requests
+  static const size_t max_pending_requests = 1024;
+  //! pending non-blocking read and write requests
+  mutable std::vector<int> m_requests;
+  //! copies of data written by pending requests
+  mutable std::list<std::vector<double> > m_buffers;
+
   MPI_Info m_mpi_info;            // MPI hints
 };
 
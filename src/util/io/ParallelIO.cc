@@ -259,23 +259,32 @@ void ParallelIO::write_darray_impl(const std::string &variable_name,
 
   size_t length = grid.xm() * grid.ym() * z_count;
 
+  stat = PIOc_setframe(m_file_id, varid, (int)record);
+  check(PISM_ERROR_LOCATION, stat);
+
+  // PIOc_write_darray() copies data to a buffer and returns: data are written when the
+  // buffer is full or the file is synchronized or closed. With I/O servers (see
+  // pio_init_async()) compute processes do not wait for the write.
   switch (type) {
   case PIO_DOUBLE:
     // no conversion necessary
-    stat = PIOc_put_vard_double(m_file_id, varid, decompid, (PIO_Offset)record, input);
+    stat = PIOc_write_darray(m_file_id, varid, decompid, (PIO_Offset)length,
+                             const_cast<double*>(input), NULL);
     check(PISM_ERROR_LOCATION, stat);
     break;
   case PIO_FLOAT:
     {
       auto buffer = convert_data<float>(input, length);
-      stat = PIOc_put_vard_float(m_file_id, varid, decompid, (PIO_Offset)record, buffer.data());
+      stat = PIOc_write_darray(m_file_id, varid, decompid, (PIO_Offset)length,
+                               buffer.data(), NULL);
       check(PISM_ERROR_LOCATION, stat);
       break;
     }
   case PIO_INT:
     {
       auto buffer = convert_data<int>(input, length);
-      stat = PIOc_put_vard_int(m_file_id, varid, decompid, (PIO_Offset)record, buffer.data());
+      stat = PIOc_write_darray(m_file_id, varid, decompid, (PIO_Offset)length,
+                               buffer.data(), NULL);
       check(PISM_ERROR_LOCATION, stat);
       break;
     }
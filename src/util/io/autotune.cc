@@ -0,0 +1,205 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cctype>               // isdigit
+#include <cstdio>               // std::remove
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "autotune.hh"
+
+#include "File.hh"
+#include "io_helpers.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/Time.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+namespace io {
+
+//! I/O formats tried by fastest_output_format().
+/*!
+ * The first one is always available and is used if all formats are equally fast.
+ */
+static const std::vector<std::string> formats = {"netcdf3",
+                                                 "netcdf3_aggregated",
+                                                 "netcdf3_async",
+                                                 "netcdf4_parallel",
+                                                 "pnetcdf",
+                                                 "pio_pnetcdf",
+                                                 "pio_netcdf4p",
+                                                 "pio_netcdf4c",
+                                                 "pio_netcdf"};
+
+/*!
+ * Returns the name of the cluster: the host name of this process without digits (e.g.
+ * "nid" for "nid00123").
+ */
+std::string cluster_name() {
+  char name[MPI_MAX_PROCESSOR_NAME];
+  int length = 0;
+  MPI_Get_processor_name(name, &length);
+
+  std::string result;
+  for (int k = 0; k < length; ++k) {
+    if (not isdigit(name[k])) {
+      result += name[k];
+    }
+  }
+
+  return result.empty() ? "unknown" : result;
+}
+
+/*!
+ * Returns the index (in `formats`) of the format stored in `cache_file` for `key` or -1
+ * if there is no such entry.
+ *
+ * Each line of the cache file contains a key followed by a format name and the time it
+ * took to write the test record. Later entries override earlier ones.
+ */
+static int cached_format(const std::string &cache_file, const std::string &key) {
+  std::ifstream input(cache_file);
+
+  int result = -1;
+  std::string line;
+  while (std::getline(input, line)) {
+    if (line.compare(0, key.size() + 1, key + " ") != 0) {
+      continue;
+    }
+
+    std::istringstream entry(line.substr(key.size() + 1));
+    std::string format;
+    entry >> format;
+
+    for (unsigned int k = 0; k < formats.size(); ++k) {
+      if (formats[k] == format) {
+        result = k;
+      }
+    }
+  }
+
+  return result;
+}
+
+//! Returns the time needed to write `field` to `filename` using `format`.
+static double write_time(const IceModelVec3 &field,
+                         const std::string &format,
+                         const std::string &filename) {
+  IceGrid::ConstPtr grid = field.grid();
+  Context::ConstPtr ctx = grid->ctx();
+
+  // initialize ParallelIO only if it is needed
+  int iosysid = format.find("pio_") == 0 ? ctx->pio_iosys_id() : -1;
+
+  const double start = GlobalMax(grid->com, get_time());
+  {
+    File file(grid->com, filename, string_to_backend(format), PISM_READWRITE_CLOBBER, iosysid,
+              ctx->netcdf3_n_aggregators());
+
+    define_time(file, *ctx);
+    append_time(file, *ctx->config(), ctx->time()->current());
+
+    field.define(file, PISM_DOUBLE);
+    field.write(file);
+  }
+  return GlobalMax(grid->com, get_time()) - start;
+}
+
+//! Find the fastest I/O format for this file system, number of processes and grid.
+/*!
+ * Writes one record of a 3D field (the size of an ice enthalpy record) with each
+ * available format to a file next to `output_file` and returns the name of the fastest
+ * one.
+ *
+ * Results are cached in `cache_file` (unless it is empty) using the cluster name, the
+ * number of processes and the grid size as the key, so later runs skip the benchmark.
+ */
+std::string fastest_output_format(IceGrid::ConstPtr grid,
+                                  const std::string &output_file,
+                                  const std::string &cache_file) {
+  const Logger &log = *grid->ctx()->log();
+
+  const std::string key = pism::printf("%s %d %d %d %d",
+                                       cluster_name().c_str(), (int)grid->size(),
+                                       (int)grid->Mx(), (int)grid->My(), (int)grid->Mz());
+
+  int result = -1;
+  if (not cache_file.empty() and grid->rank() == 0) {
+    result = cached_format(cache_file, key);
+  }
+  MPI_Bcast(&result, 1, MPI_INT, 0, grid->com);
+
+  if (result >= 0) {
+    log.message(2, "* Using the I/O format '%s' (found in '%s')\n",
+                formats[result].c_str(), cache_file.c_str());
+    return formats[result];
+  }
+
+  log.message(2, "* Choosing the fastest I/O format...\n");
+
+  IceModelVec3 field(grid, "io_benchmark", WITHOUT_GHOSTS);
+  field.set_attrs("internal", "field used to choose the fastest I/O format", "1", "1", "", 0);
+  field.set(1.0);
+
+  const std::string filename = filename_add_suffix(output_file.empty() ? "pism.nc" : output_file,
+                                                   "_io_benchmark", "");
+
+  double min_time = 0.0;
+  for (unsigned int k = 0; k < formats.size(); ++k) {
+    try {
+      double time = write_time(field, formats[k], filename);
+
+      log.message(2, "  %20s: %.3f seconds\n", formats[k].c_str(), time);
+
+      if (result < 0 or time < min_time) {
+        result   = k;
+        min_time = time;
+      }
+    } catch (RuntimeError &e) {
+      // this format is not supported by this PISM build
+      log.message(3, "  %20s: not available (%s)\n", formats[k].c_str(), e.what());
+    }
+
+    if (grid->rank() == 0) {
+      std::remove(filename.c_str());
+    }
+    MPI_Barrier(grid->com);
+  }
+
+  if (result < 0) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "failed to write a test file using any I/O format");
+  }
+
+  log.message(2, "  using '%s'\n", formats[result].c_str());
+
+  if (not cache_file.empty() and grid->rank() == 0) {
+    std::ofstream output(cache_file, std::ios::app);
+    output << key << " " << formats[result] << " " << min_time << "\n";
+  }
+
+  return formats[result];
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,39 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_AUTOTUNE_H
+#define PISM_AUTOTUNE_H
+
+#include <string>
+
+#include "pism/util/IceGrid.hh"
+
+namespace pism {
+namespace io {
+
+std::string cluster_name();
+
+std::string fastest_output_format(IceGrid::ConstPtr grid,
+                                  const std::string &output_file,
+                                  const std::string &cache_file);
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* PISM_AUTOTUNE_H */
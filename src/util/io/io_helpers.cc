@@ -17,11 +17,16 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::find, std::min
 #include <memory>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 
 #include "io_helpers.hh"
 #include "File.hh"
+#include "NodeSharedBuffer.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/VariableMetadata.hh"
 #include "pism/util/error_handling.hh"
@@ -45,7 +50,7 @@ namespace io {
  * Note that its inputs are (essentially)
  * - the definition of the input grid
  * - the definition of the output grid
- * - input array (lic->buffer)
+ * - input array (`input_array`, using the layout of `lic->buffer`)
  * - output array (double *output_array)
  *
  * The `output_array` is expected to be big enough to contain
@@ -55,87 +60,91 @@ namespace io {
  * fairly easily...
  */
 static void regrid(const IceGrid& grid, const std::vector<double> &zlevels_out,
-                   LocalInterpCtx *lic, double *output_array) {
+                   const LocalInterpCtx *lic, const double *input_array,
+                   double *output_array) {
   // We'll work with the raw storage here so that the array we are filling is
   // indexed the same way as the buffer we are pulling from (input_array)
 
   const int X = 1, Z = 3; // indices, just for clarity
 
-  unsigned int nlevels = zlevels_out.size();
-  double *input_array = &(lic->buffer[0]);
+  const unsigned int nlevels = zlevels_out.size();
 
   // array sizes for mapping from logical to "flat" indices
-  int
+  const int
     x_count = lic->count[X],
     z_count = lic->count[Z];
 
-  for (Points p(grid); p; p.next()) {
-    const int i_global = p.i(), j_global = p.j();
+  // Vertical interpolation indices and weights are the same in all columns.
+  std::vector<int> Z_m(nlevels, 0), Z_p(nlevels, 0);
+  std::vector<double> alpha_z(nlevels, 0.0);
+  for (unsigned int k = 0; nlevels > 1 and k < nlevels; ++k) {
+    Z_m[k]     = lic->z->left(k);
+    Z_p[k]     = lic->z->right(k);
+    alpha_z[k] = lic->z->alpha(k);
+  }
+
+  const int
+    xm = grid.xm(),
+    ym = grid.ym();
 
-    const int i = i_global - grid.xs(), j = j_global - grid.ys();
+  // Columns of input_array and output_array are contiguous (z is the fastest-varying
+  // index), so we interpolate one column at a time: horizontal indices and weights are
+  // computed once per column and the loop over k uses pointers to the four neighboring
+  // input columns.
+  for (int j = 0; j < ym; ++j) {
+    // interpolation coefficient in the y direction
+    const double y_alpha = lic->y->alpha(j);
 
-    // Indices of neighboring points.
     const int
-      X_m = lic->x->left(i),
-      X_p = lic->x->right(i),
       Y_m = lic->y->left(j),
       Y_p = lic->y->right(j);
 
-    for (unsigned int k = 0; k < nlevels; k++) {
+    for (int i = 0; i < xm; ++i) {
+      // interpolation coefficient in the x direction
+      const double x_alpha = lic->x->alpha(i);
 
-      double
-        a_mm = 0.0,
-        a_mp = 0.0,
-        a_pm = 0.0,
-        a_pp = 0.0;
+      // Indices of neighboring points.
+      const int
+        X_m = lic->x->left(i),
+        X_p = lic->x->right(i);
 
-      if (nlevels > 1) {
-        const int
-          Z_m = lic->z->left(k),
-          Z_p = lic->z->right(k);
+      const double
+        *c_mm = input_array + (Y_m * x_count + X_m) * z_count,
+        *c_mp = input_array + (Y_m * x_count + X_p) * z_count,
+        *c_pm = input_array + (Y_p * x_count + X_m) * z_count,
+        *c_pp = input_array + (Y_p * x_count + X_p) * z_count;
 
-        const double alpha_z = lic->z->alpha(k);
+      double *result = output_array + (j * xm + i) * nlevels;
 
-        // We pretend that there are always 8 neighbors (4 in the map plane,
-        // 2 vertical levels). And compute the indices into the input_array for
-        // those neighbors.
-        const int
-          mmm = (Y_m * x_count + X_m) * z_count + Z_m,
-          mmp = (Y_m * x_count + X_m) * z_count + Z_p,
-          mpm = (Y_m * x_count + X_p) * z_count + Z_m,
-          mpp = (Y_m * x_count + X_p) * z_count + Z_p,
-          pmm = (Y_p * x_count + X_m) * z_count + Z_m,
-          pmp = (Y_p * x_count + X_m) * z_count + Z_p,
-          ppm = (Y_p * x_count + X_p) * z_count + Z_m,
-          ppp = (Y_p * x_count + X_p) * z_count + Z_p;
-
-        // linear interpolation in the z-direction
-        a_mm = input_array[mmm] * (1.0 - alpha_z) + input_array[mmp] * alpha_z;
-        a_mp = input_array[mpm] * (1.0 - alpha_z) + input_array[mpp] * alpha_z;
-        a_pm = input_array[pmm] * (1.0 - alpha_z) + input_array[pmp] * alpha_z;
-        a_pp = input_array[ppm] * (1.0 - alpha_z) + input_array[ppp] * alpha_z;
-      } else {
+      if (nlevels == 1) {
         // we don't need to interpolate vertically for the 2-D case
-        a_mm = input_array[Y_m * x_count + X_m];
-        a_mp = input_array[Y_m * x_count + X_p];
-        a_pm = input_array[Y_p * x_count + X_m];
-        a_pp = input_array[Y_p * x_count + X_p];
-      }
+        const double a_m = c_mm[0] * (1.0 - x_alpha) + c_mp[0] * x_alpha;
+        const double a_p = c_pm[0] * (1.0 - x_alpha) + c_pp[0] * x_alpha;
 
-      // interpolation coefficient in the x direction
-      const double x_alpha = lic->x->alpha(i);
-      // interpolation coefficient in the y direction
-      const double y_alpha = lic->y->alpha(j);
-
-      // interpolate in x direction
-      const double a_m = a_mm * (1.0 - x_alpha) + a_mp * x_alpha;
-      const double a_p = a_pm * (1.0 - x_alpha) + a_pp * x_alpha;
+        result[0] = a_m * (1.0 - y_alpha) + a_p * y_alpha;
+        continue;
+      }
 
-      int index = (j * grid.xm() + i) * nlevels + k;
+      for (unsigned int k = 0; k < nlevels; k++) {
+        const int
+          m = Z_m[k],
+          p = Z_p[k];
+        const double alpha = alpha_z[k];
 
-      // index into the new array and interpolate in x direction
-      output_array[index] = a_m * (1.0 - y_alpha) + a_p * y_alpha;
-      // done with the point at (x,y,z)
+        // linear interpolation in the z-direction
+        const double
+          a_mm = c_mm[m] * (1.0 - alpha) + c_mm[p] * alpha,
+          a_mp = c_mp[m] * (1.0 - alpha) + c_mp[p] * alpha,
+          a_pm = c_pm[m] * (1.0 - alpha) + c_pm[p] * alpha,
+          a_pp = c_pp[m] * (1.0 - alpha) + c_pp[p] * alpha;
+
+        // interpolate in x direction
+        const double a_m = a_mm * (1.0 - x_alpha) + a_mp * x_alpha;
+        const double a_p = a_pm * (1.0 - x_alpha) + a_pp * x_alpha;
+
+        // interpolate in y direction
+        result[k] = a_m * (1.0 - y_alpha) + a_p * y_alpha;
+      }
     }
   }
 }
@@ -267,7 +276,11 @@ void append_time(const File &file, const std::string &name, double value) {
     file.write_variable(name, {start}, {1}, &value);
 
     // PIO's I/O type PnetCDF requires this
-    file.sync();
+    IO_Backend backend = file.backend();
+    if (backend == PISM_PIO_PNETCDF or backend == PISM_PIO_NETCDF4P or
+        backend == PISM_PIO_NETCDF4C or backend == PISM_PIO_NETCDF) {
+      file.sync();
+    }
   } catch (RuntimeError &e) {
     e.add_context("appending to the time dimension in \"" + file.filename() + "\"");
     throw;
@@ -408,6 +421,9 @@ static bool use_transposed_io(const File &file,
 }
 
 //! \brief Read an array distributed according to the grid.
+/*!
+ * The read may complete only after File::wait_all(). (Transposed reads are blocking.)
+ */
 static void read_distributed_array(const File &file, const IceGrid &grid,
                                    const std::string &var_name,
                                    unsigned int z_count, unsigned int t_start,
@@ -428,7 +444,7 @@ static void read_distributed_array(const File &file, const IceGrid &grid,
     if (transposed_io) {
       file.read_variable_transposed(var_name, start, count, imap, output);
     } else {
-      file.read_variable(var_name, start, count, output);
+      file.read_variable_nonblocking(var_name, start, count, output);
     }
 
   } catch (RuntimeError &e) {
@@ -438,13 +454,98 @@ static void read_distributed_array(const File &file, const IceGrid &grid,
   }
 }
 
+/*!
+ * Read the part of a record needed to interpolate onto the local patch into `lic.buffer`,
+ * reading the whole record once per node.
+ *
+ * Node leaders read the record into `node_buffer`, then each rank copies its part.
+ */
+static void read_using_node_buffer(const File &file,
+                                   units::System::Ptr unit_system,
+                                   const std::string &variable_name,
+                                   const grid_info &input_grid,
+                                   unsigned int t_start,
+                                   NodeSharedBuffer &node_buffer,
+                                   LocalInterpCtx &lic) {
+  const int X = 1, Y = 2, Z = 3; // indices, just for clarity
+
+  // the whole record (all vertical levels needed on this rank are needed everywhere)
+  const unsigned int t_count = 1;
+  std::vector<unsigned int> start, count, imap;
+  compute_start_and_count(file, unit_system, variable_name,
+                          t_start, t_count,
+                          0, input_grid.x_len,
+                          0, input_grid.y_len,
+                          lic.start[Z], lic.count[Z],
+                          start, count, imap);
+
+  bool transposed_io = use_transposed_io(file, unit_system, variable_name);
+
+  double *record = node_buffer.allocate(input_grid.x_len * input_grid.y_len * lic.count[Z]);
+
+  // make sure that all ranks on this node are done with the previous record
+  node_buffer.sync();
+
+  int success = 1;
+  if (node_buffer.leaders() != MPI_COMM_NULL) {
+    try {
+      File leader_file(node_buffer.leaders(), file.filename(), PISM_GUESS, PISM_READONLY);
+
+      if (transposed_io) {
+        leader_file.read_variable_transposed(variable_name, start, count, imap, record);
+      } else {
+        leader_file.read_variable(variable_name, start, count, record);
+      }
+    } catch (...) {
+      success = 0;
+    }
+  }
+
+  node_buffer.sync();
+
+  MPI_Bcast(&success, 1, MPI_INT, 0, node_buffer.node());
+  if (success == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to read variable '%s' into a node-shared buffer",
+                                  variable_name.c_str());
+  }
+
+  // copy the part of the record used by this rank
+  const unsigned int
+    x_count = lic.count[X],
+    y_count = lic.count[Y],
+    z_count = lic.count[Z];
+
+  for (unsigned int j = 0; j < y_count; ++j) {
+    for (unsigned int i = 0; i < x_count; ++i) {
+      const double *column = &record[((lic.start[Y] + j) * input_grid.x_len +
+                                      (lic.start[X] + i)) * z_count];
+      double *result = &lic.buffer[(j * x_count + i) * z_count];
+
+      for (unsigned int k = 0; k < z_count; ++k) {
+        result[k] = column[k];
+      }
+    }
+  }
+}
+
+/*!
+ * Read and interpolate `t_count` records starting at `t_start`.
+ *
+ * Records are stored one after another in `output`.
+ *
+ * The interpolation context is computed once. Unless `node_buffer` is not NULL, all
+ * records are read using one (x, y, time) hyperslab read.
+ */
 static void regrid_vec_generic(const File &file, const IceGrid &grid,
                                const std::string &variable_name,
                                const std::vector<double> &zlevels_out,
                                unsigned int t_start,
+                               unsigned int t_count,
                                bool fill_missing,
                                double default_value,
                                InterpolationType interpolation_type,
+                               NodeSharedBuffer *node_buffer,
                                double *output) {
   const int X = 1, Y = 2, Z = 3; // indices, just for clarity
 
@@ -452,48 +553,87 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
 
   try {
     grid_info gi(file, variable_name, grid.ctx()->unit_system(), grid.registration());
-    LocalInterpCtx lic(gi, grid, zlevels_out, interpolation_type);
+    std::shared_ptr<LocalInterpCtx> context = grid.get_interpolation_context(gi, zlevels_out,
+                                                                            interpolation_type);
+    LocalInterpCtx &lic = *context;
 
-    std::vector<double> &buffer = lic.buffer;
+    const size_t
+      input_size  = lic.count[X] * lic.count[Y] * std::max(lic.count[Z], 1u),
+      output_size = grid.xm() * grid.ym() * zlevels_out.size();
 
-    const unsigned int t_count = 1;
-    std::vector<unsigned int> start, count, imap;
-    compute_start_and_count(file,
-                            grid.ctx()->unit_system(),
-                            variable_name,
-                            t_start, t_count,
-                            lic.start[X], lic.count[X],
-                            lic.start[Y], lic.count[Y],
-                            lic.start[Z], lic.count[Z],
-                            start, count, imap);
+    std::vector<double> &buffer = lic.buffer;
 
-    bool transposed_io = use_transposed_io(file, grid.ctx()->unit_system(), variable_name);
-    profiling.begin("io.regridding.read");
-    if (transposed_io) {
-      file.read_variable_transposed(variable_name, start, count, imap, &buffer[0]);
-    } else {
-      file.read_variable(variable_name, start, count, &buffer[0]);
+    std::vector<double> fill_value;
+    if (fill_missing) {
+      fill_value = file.read_double_attribute(variable_name, "_FillValue");
     }
-    profiling.end("io.regridding.read");
 
     // Replace missing values if the _FillValue attribute is present,
     // and if we have missing values to replace.
-    if (fill_missing) {
-      std::vector<double> attribute = file.read_double_attribute(variable_name, "_FillValue");
-      if (attribute.size() == 1) {
-        const double fill_value = attribute[0],
-          epsilon = 1e-12;
-        for (unsigned int i = 0; i < buffer.size(); ++i) {
-          if (fabs(buffer[i] - fill_value) < epsilon) {
-            buffer[i] = default_value;
+    auto replace_missing = [&](double *data, size_t size) {
+      if (fill_value.size() == 1) {
+        const double epsilon = 1e-12;
+        for (size_t i = 0; i < size; ++i) {
+          if (fabs(data[i] - fill_value[0]) < epsilon) {
+            data[i] = default_value;
           }
         }
       }
+    };
+
+    if (node_buffer != nullptr) {
+      // the node leader reads whole records, so we read (and share) one record at a time
+      for (unsigned int k = 0; k < t_count; ++k) {
+        profiling.begin("io.regridding.read");
+        read_using_node_buffer(file, grid.ctx()->unit_system(), variable_name,
+                               gi, t_start + k, *node_buffer, lic);
+        profiling.end("io.regridding.read");
+
+        replace_missing(&buffer[0], input_size);
+
+        profiling.begin("io.regridding.interpolate");
+        regrid(grid, zlevels_out, &lic, &buffer[0], output + k * output_size);
+        profiling.end("io.regridding.interpolate");
+      }
+      return;
+    }
+
+    // storage for all records (the buffer in the interpolation context holds one record)
+    std::vector<double> records;
+    double *input = &buffer[0];
+    if (t_count > 1) {
+      records.resize(t_count * input_size);
+      input = &records[0];
     }
 
+    profiling.begin("io.regridding.read");
+    {
+      std::vector<unsigned int> start, count, imap;
+      compute_start_and_count(file,
+                              grid.ctx()->unit_system(),
+                              variable_name,
+                              t_start, t_count,
+                              lic.start[X], lic.count[X],
+                              lic.start[Y], lic.count[Y],
+                              lic.start[Z], lic.count[Z],
+                              start, count, imap);
+
+      bool transposed_io = use_transposed_io(file, grid.ctx()->unit_system(), variable_name);
+      if (transposed_io) {
+        file.read_variable_transposed(variable_name, start, count, imap, input);
+      } else {
+        file.read_variable(variable_name, start, count, input);
+      }
+    }
+    profiling.end("io.regridding.read");
+
+    replace_missing(input, t_count * input_size);
+
     // interpolate
     profiling.begin("io.regridding.interpolate");
-    regrid(grid, zlevels_out, &lic, output);
+    for (unsigned int k = 0; k < t_count; ++k) {
+      regrid(grid, zlevels_out, &lic, input + k * input_size, output + k * output_size);
+    }
     profiling.end("io.regridding.interpolate");
   } catch (RuntimeError &e) {
     e.add_context("reading variable '%s' (using linear interpolation) from '%s'",
@@ -507,14 +647,17 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
 static void regrid_vec(const File &file, const IceGrid &grid, const std::string &var_name,
                        const std::vector<double> &zlevels_out,
                        unsigned int t_start,
+                       unsigned int t_count,
                        InterpolationType interpolation_type,
+                       NodeSharedBuffer *node_buffer,
                        double *output) {
   regrid_vec_generic(file, grid,
                      var_name,
                      zlevels_out,
-                     t_start,
+                     t_start, t_count,
                      false, 0.0,
                      interpolation_type,
+                     node_buffer,
                      output);
 }
 
@@ -524,7 +667,8 @@ static void regrid_vec(const File &file, const IceGrid &grid, const std::string
  * @param grid computational grid; used to initialize interpolation
  * @param var_name variable to regrid
  * @param zlevels_out vertical levels of the resulting grid
- * @param t_start time index of the record to regrid
+ * @param t_start time index of the first record to regrid
+ * @param t_count number of records to regrid
  * @param default_value default value to replace `_FillValue` with
  * @param[out] output resulting interpolated field
  */
@@ -532,18 +676,205 @@ static void regrid_vec_fill_missing(const File &file, const IceGrid &grid,
                                     const std::string &var_name,
                                     const std::vector<double> &zlevels_out,
                                     unsigned int t_start,
+                                    unsigned int t_count,
                                     double default_value,
                                     InterpolationType interpolation_type,
+                                    NodeSharedBuffer *node_buffer,
                                     double *output) {
   regrid_vec_generic(file, grid,
                      var_name,
                      zlevels_out,
-                     t_start,
+                     t_start, t_count,
                      true, default_value,
                      interpolation_type,
+                     node_buffer,
                      output);
 }
 
+/*!
+ * Chunk sizes of a spatial variable with dimensions (time, y, x, z) (time and z are
+ * optional; `n_levels == 0` means "no z dimension").
+ *
+ * PISM_CHUNKING_DECOMPOSITION: each chunk covers the largest patch owned by a rank (all
+ * vertical levels) to avoid read-modify-write cycles in HDF5 when patches span chunk
+ * boundaries.
+ *
+ * PISM_CHUNKING_TILES: each chunk contains one horizontal slice of a record, which is
+ * what most post-processing tools read.
+ */
+static std::vector<size_t> chunk_sizes(IO_Chunking policy, const IceGrid &grid,
+                                       bool time_dependent, unsigned int n_levels) {
+  std::vector<size_t> result;
+
+  if (time_dependent) {
+    result.push_back(1);
+  }
+
+  if (policy == PISM_CHUNKING_DECOMPOSITION) {
+    result.push_back(static_cast<size_t>(GlobalMax(grid.com, grid.ym())));
+    result.push_back(static_cast<size_t>(GlobalMax(grid.com, grid.xm())));
+    if (n_levels > 0) {
+      result.push_back(n_levels);
+    }
+  } else {
+    result.push_back(grid.My());
+    result.push_back(grid.Mx());
+    if (n_levels > 0) {
+      result.push_back(1);
+    }
+  }
+
+  return result;
+}
+
+//! Name of the dimension (and of the index variable) used by 3D variables written using
+//! "compression by gathering" (see File::set_ice_columns()).
+static const char *ice_column_dimension = "ice_column";
+//! Name of the variable containing numbers of levels stored in each column.
+static const char *ice_column_levels = "ice_column_levels";
+
+//! Compute the index of the first ice column stored by this rank in the `ice_column`
+//! dimension and the number of these columns.
+static void ice_column_range(const IceGrid &grid, const File &file,
+                             unsigned int &start, unsigned int &count) {
+  count = 0;
+  for (auto n : file.ice_column_levels()) {
+    count += n > 0 ? 1 : 0;
+  }
+
+  start = 0;
+  MPI_Exscan(&count, &start, 1, MPI_UNSIGNED, MPI_SUM, grid.com);
+  if (grid.rank() == 0) {
+    // the result of MPI_Exscan() is undefined on rank 0
+    start = 0;
+  }
+}
+
+/*!
+ * Define the `ice_column` dimension, the index variable and numbers of levels in each
+ * column, unless they are defined already.
+ *
+ * Returns false if the grid has no ice columns (the `ice_column` dimension would be
+ * empty).
+ */
+static bool define_ice_columns(const SpatialVariableMetadata &var,
+                               const IceGrid &grid, const File &file) {
+  if (file.find_dimension(ice_column_dimension)) {
+    return true;
+  }
+
+  if (file.ice_column_levels().size() != grid.xm() * grid.ym()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "numbers of levels in ice columns are not set"
+                                  " (writing '%s' to '%s')",
+                                  var.get_name().c_str(), file.filename().c_str());
+  }
+
+  unsigned int start = 0, count = 0;
+  ice_column_range(grid, file, start, count);
+
+  const unsigned int n_columns = GlobalSum(grid.com, count);
+  if (n_columns == 0) {
+    return false;
+  }
+
+  file.define_dimension(ice_column_dimension, n_columns);
+
+  file.define_variable(ice_column_dimension, PISM_INT, {ice_column_dimension});
+  file.write_attribute(ice_column_dimension, "long_name", "index of an ice-covered grid column");
+  // CF conventions, section 8.2: zero-based indexes into the array with dimensions (y, x)
+  file.write_attribute(ice_column_dimension, "compress",
+                       var.get_y().get_name() + " " + var.get_x().get_name());
+  file.write_attribute(ice_column_dimension, "not_written", PISM_INT, {1.0});
+
+  file.define_variable(ice_column_levels, PISM_INT, {ice_column_dimension});
+  file.write_attribute(ice_column_levels, "long_name",
+                       "number of vertical levels stored in an ice-covered grid column");
+  file.write_attribute(ice_column_levels, "units", "1");
+
+  return true;
+}
+
+//! Stop if `variable_name` in `file` is stored in ice columns only: PISM cannot read it.
+static void check_not_gathered(const File &file, const std::string &variable_name) {
+  auto dims = file.dimensions(variable_name);
+  if (std::find(dims.begin(), dims.end(), ice_column_dimension) != dims.end()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "'%s' in '%s' is stored in ice-covered columns only"
+                                  " (see output.gathered_3d_variables).\n"
+                                  "Use expand_ice_columns.py to convert it.",
+                                  variable_name.c_str(), file.filename().c_str());
+  }
+}
+
+//! Write the index of ice columns and numbers of levels in each (once per file).
+static void write_ice_columns(const IceGrid &grid, const File &file) {
+  if (file.attribute_type(ice_column_dimension, "not_written") == PISM_NAT) {
+    return;
+  }
+
+  unsigned int start = 0, count = 0;
+  ice_column_range(grid, file, start, count);
+
+  const std::vector<int> &n_levels = file.ice_column_levels();
+
+  std::vector<double> index, levels;
+  index.reserve(count);
+  levels.reserve(count);
+
+  for (unsigned int j = 0; j < grid.ym(); ++j) {
+    for (unsigned int i = 0; i < grid.xm(); ++i) {
+      const int n = n_levels[j * grid.xm() + i];
+      if (n > 0) {
+        index.push_back((grid.ys() + j) * grid.Mx() + (grid.xs() + i));
+        levels.push_back(n);
+      }
+    }
+  }
+
+  file.write_variable(ice_column_dimension, {start}, {count}, index.data());
+  file.write_variable(ice_column_levels, {start}, {count}, levels.data());
+
+  file.redef();
+  file.remove_attribute(ice_column_dimension, "not_written");
+}
+
+//! Write `input` (a 3D variable in the layout used by write_distributed_array()) using
+//! "compression by gathering".
+static void write_gathered(const SpatialVariableMetadata &var, const IceGrid &grid,
+                           const File &file, unsigned int nlevels, const double *input) {
+  write_ice_columns(grid, file);
+
+  unsigned int start = 0, count = 0;
+  ice_column_range(grid, file, start, count);
+
+  const double fill_value = file.read_double_attribute(var.get_name(), "_FillValue")[0];
+
+  const std::vector<int> &n_levels = file.ice_column_levels();
+
+  std::vector<double> data;
+  data.reserve(count * nlevels);
+
+  for (size_t k = 0; k < n_levels.size(); ++k) {
+    const int n = std::min(n_levels[k], (int)nlevels);
+    if (n_levels[k] > 0) {
+      const double *column = input + k * nlevels;
+      data.insert(data.end(), column, column + n);
+      data.insert(data.end(), nlevels - n, fill_value);
+    }
+  }
+
+  std::vector<unsigned int> start_, count_;
+  if (not var.get_time_independent()) {
+    start_.push_back(file.nrecords() - 1);
+    count_.push_back(1);
+  }
+  start_.insert(start_.end(), {start, 0});
+  count_.insert(count_.end(), {count, nlevels});
+
+  file.write_variable(var.get_name(), start_, count_, data.data());
+}
+
 //! Define a NetCDF variable corresponding to a VariableMetadata object.
 void define_spatial_variable(const SpatialVariableMetadata &var,
                              const IceGrid &grid, const File &file,
@@ -566,8 +897,17 @@ void define_spatial_variable(const SpatialVariableMetadata &var,
     dims.push_back(grid.ctx()->config()->get_string("time.dimension_name"));
   }
 
-  dims.push_back(y);
-  dims.push_back(x);
+  // 3D variables listed in File::set_ice_columns() are stored in ice columns only
+  const bool gathered = (file.gathered(name) and not z.empty() and
+                         var.get_levels().size() > 1 and
+                         define_ice_columns(var, grid, file));
+
+  if (gathered) {
+    dims.push_back(ice_column_dimension);
+  } else {
+    dims.push_back(y);
+    dims.push_back(x);
+  }
 
   if (not z.empty()) {
     dims.push_back(z);
@@ -575,14 +915,33 @@ void define_spatial_variable(const SpatialVariableMetadata &var,
 
   assert(dims.size() > 1);
 
-  IO_Type type = var.get_output_type();
+  IO_Type type = file.output_type(name);
+  if (type == PISM_NAT) {
+    type = var.get_output_type();
+  }
   if (type == PISM_NAT) {
     type = default_type;
   }
   file.define_variable(name, type, dims);
 
+  if (file.chunking() != PISM_CHUNKING_DEFAULT and not gathered) {
+    file.define_chunking(name, chunk_sizes(file.chunking(), grid,
+                                           not var.get_time_independent(),
+                                           z.empty() ? 0 : var.get_levels().size()));
+  }
+
   write_attributes(file, var, type);
 
+  if (gathered and file.attribute_type(name, "_FillValue") == PISM_NAT) {
+    // values above the top of the ice in stored columns are replaced with the fill value
+    file.write_attribute(name, "_FillValue", type, {9.969209968386869e+36});
+  }
+
+  const int digits = file.significant_digits(name);
+  if (digits > 0) {
+    file.write_attribute(name, "pism_significant_digits", PISM_INT, {(double)digits});
+  }
+
   // add the "grid_mapping" attribute if the grid has an associated mapping. Variables lat, lon,
   // lat_bnds, and lon_bnds should not have the grid_mapping attribute to support CDO (see issue
   // #384).
@@ -603,12 +962,13 @@ void define_spatial_variable(const SpatialVariableMetadata &var,
 //! Read a variable from a file into an array `output`.
 /*! This also converts data from input units to internal units if needed.
  */
-void read_spatial_variable(const SpatialVariableMetadata &variable,
-                           const IceGrid& grid, const File &file,
-                           unsigned int time, double *output) {
-
-  const Logger &log = *grid.ctx()->log();
-
+/*!
+ * Find `variable` in `file` and check that it has the expected spatial dimensions.
+ *
+ * Returns the name of the variable in the file.
+ */
+static std::string find_spatial_variable(const SpatialVariableMetadata &variable,
+                                         const File &file) {
   // Find the variable:
   auto var = file.find_variable(variable.get_name(), variable.get_string("standard_name"));
 
@@ -619,6 +979,8 @@ void read_spatial_variable(const SpatialVariableMetadata &variable,
                                   file.filename().c_str());
   }
 
+  check_not_gathered(file, var.name);
+
   // Sanity check: the variable in an input file should have the expected
   // number of spatial dimensions.
   {
@@ -663,36 +1025,220 @@ void read_spatial_variable(const SpatialVariableMetadata &variable,
     }
   }
 
-  // make sure we have at least one level
-  const std::vector<double>& zlevels = variable.get_levels();
-  unsigned int nlevels = std::max(zlevels.size(), (size_t)1);
+  return var.name;
+}
 
-  read_distributed_array(file, grid, var.name, nlevels, time, output);
+//! Name of the base checkpoint containing `variable_name` if `file` refers to it (see
+//! File::set_checkpoint()), otherwise an empty string.
+static std::string checkpoint_base(const File &file, const std::string &variable_name) {
+  if (file.attribute_type(variable_name, "pism_checkpoint_base") == PISM_CHAR) {
+    return file.read_text_attribute(variable_name, "pism_checkpoint_base");
+  }
+  return "";
+}
 
-  std::string input_units = file.read_text_attribute(var.name, "units");
-  const std::string &internal_units = variable.get_string("units");
+void read_spatial_variable(const SpatialVariableMetadata &variable,
+                           const IceGrid& grid, const File &file,
+                           unsigned int time, double *output) {
+  read_spatial_variables({&variable}, grid, file, time, {output});
+}
 
-  if (input_units.empty() and not internal_units.empty()) {
-    const std::string &long_name = variable.get_string("long_name");
-    log.message(2,
-               "PISM WARNING: Variable '%s' ('%s') does not have the units attribute.\n"
-               "              Assuming that it is in '%s'.\n",
-               variable.get_name().c_str(), long_name.c_str(),
-               internal_units.c_str());
-    input_units = internal_units;
+/*!
+ * Read several variables from `file`: `variables[k]` is read into `outputs[k]`.
+ *
+ * Reads of all variables are started before any of them is completed, so backends
+ * supporting non-blocking I/O (PnetCDF) read them using one collective operation. Other
+ * backends read one variable at a time.
+ *
+ * All output arrays have to be distinct: they are filled when all reads are done.
+ */
+void read_spatial_variables(const std::vector<const SpatialVariableMetadata*> &variables,
+                            const IceGrid& grid, const File &file,
+                            unsigned int time, const std::vector<double*> &outputs) {
+
+  if (variables.size() != outputs.size()) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "numbers of variables and output arrays have to match");
+  }
+
+  const Logger &log = *grid.ctx()->log();
+
+  std::vector<std::string> names(variables.size());
+  // true if a variable was read from the base checkpoint
+  std::vector<bool> read_from_base(variables.size(), false);
+
+  for (size_t k = 0; k < variables.size(); ++k) {
+    const SpatialVariableMetadata &variable = *variables[k];
+
+    names[k] = find_spatial_variable(variable, file);
+
+    std::string base = checkpoint_base(file, names[k]);
+    if (not base.empty()) {
+      File base_file(grid.com, base, PISM_GUESS, PISM_READONLY);
+      read_spatial_variable(variable, grid, base_file, base_file.nrecords() - 1, outputs[k]);
+      read_from_base[k] = true;
+      continue;
+    }
+
+    // make sure we have at least one level
+    unsigned int nlevels = std::max(variable.get_levels().size(), (size_t)1);
+
+    read_distributed_array(file, grid, names[k], nlevels, time, outputs[k]);
   }
 
-  // Convert data:
-  size_t size = grid.xm() * grid.ym() * nlevels;
+  file.wait_all();
+
+  for (size_t k = 0; k < variables.size(); ++k) {
+    const SpatialVariableMetadata &variable = *variables[k];
+
+    if (read_from_base[k]) {
+      // units were converted already
+      continue;
+    }
+
+    std::string input_units = file.read_text_attribute(names[k], "units");
+    const std::string &internal_units = variable.get_string("units");
+
+    if (input_units.empty() and not internal_units.empty()) {
+      const std::string &long_name = variable.get_string("long_name");
+      log.message(2,
+                  "PISM WARNING: Variable '%s' ('%s') does not have the units attribute.\n"
+                  "              Assuming that it is in '%s'.\n",
+                  variable.get_name().c_str(), long_name.c_str(),
+                  internal_units.c_str());
+      input_units = internal_units;
+    }
+
+    // Convert data:
+    unsigned int nlevels = std::max(variable.get_levels().size(), (size_t)1);
+    size_t size = grid.xm() * grid.ym() * nlevels;
 
-  units::Converter(variable.unit_system(),
-                   input_units, internal_units).convert_doubles(output, size);
+    units::Converter(variable.unit_system(),
+                     input_units, internal_units).convert_doubles(outputs[k], size);
+  }
 }
 
 //! \brief Write a double array to a file.
 /*!
   Converts units if internal and "glaciological" units are different.
  */
+/*!
+ * Round values in `data` to keep `digits` significant decimal digits, setting unused bits
+ * of the mantissa to zero ("bit rounding"). This makes compressed files smaller.
+ *
+ * Values equal to `fill_value` (if `use_fill_value` is set), infinities, and NaNs are
+ * not modified.
+ */
+static void round_to_significant_digits(int digits, bool use_fill_value, double fill_value,
+                                        double *data, size_t data_size) {
+  // number of bits in the mantissa of a double
+  const int mantissa_bits = 52;
+  const int keep_bits = static_cast<int>(std::ceil(digits * std::log2(10.0)));
+
+  if (digits <= 0 or keep_bits >= mantissa_bits) {
+    return;
+  }
+
+  const int drop_bits = mantissa_bits - keep_bits;
+  const uint64_t
+    half = uint64_t(1) << (drop_bits - 1),
+    mask = ~((uint64_t(1) << drop_bits) - 1);
+
+  for (size_t k = 0; k < data_size; ++k) {
+    if (not std::isfinite(data[k]) or
+        (use_fill_value and std::fabs(data[k] - fill_value) <= 1e-6 * std::fabs(fill_value))) {
+      continue;
+    }
+
+    uint64_t bits = 0;
+    std::memcpy(&bits, &data[k], sizeof(bits));
+
+    // round to nearest, ties to even
+    bits += half - 1 + ((bits >> drop_bits) & 1);
+    bits &= mask;
+
+    std::memcpy(&data[k], &bits, sizeof(bits));
+  }
+}
+
+//! Returns true if `var` is time-independent and was written to `file` already.
+/*!
+ * Time-independent variables are written once per file (see define_spatial_variable()), so
+ * callers can use this to skip computing them.
+ */
+bool time_independent_written(const SpatialVariableMetadata &var, const File &file) {
+  const std::string &name = var.get_name();
+
+  return (var.get_time_independent() and
+          file.find_variable(name) and
+          file.attribute_type(name, "not_written") == PISM_NAT);
+}
+
+//! Checksum of a distributed array (combined over all ranks in `com`).
+/*!
+ * Used to detect variables that did not change since the last checkpoint, so it only
+ * has to change when data change.
+ */
+static std::string checksum(MPI_Comm com, const double *data, size_t size) {
+  const uint64_t
+    offset_basis = 14695981039346656037ULL,
+    prime        = 1099511628211ULL;
+
+  // 64-bit FNV-1a hash of the local part, using 64-bit words instead of bytes
+  uint64_t local_hash = offset_basis;
+  for (size_t k = 0; k < size; ++k) {
+    uint64_t word = 0;
+    memcpy(&word, &data[k], sizeof(word));
+    local_hash = (local_hash ^ word) * prime;
+  }
+
+  // Hash hashes of local parts in rank order. (Combining them using a commutative
+  // operation such as XOR would make equal local parts cancel each other.)
+  int n_ranks = 1;
+  MPI_Comm_size(com, &n_ranks);
+  std::vector<uint64_t> hashes(n_ranks);
+
+  int err = MPI_Allgather(&local_hash, 1, MPI_UINT64_T,
+                          hashes.data(), 1, MPI_UINT64_T, com);
+  PISM_C_CHK(err, 0, "MPI_Allgather");
+
+  uint64_t hash = offset_basis;
+  for (auto h : hashes) {
+    hash = (hash ^ h) * prime;
+  }
+
+  return pism::printf("%016llx", (unsigned long long)hash);
+}
+
+//! Returns true if values of `var` have to be converted before they are written to `file`.
+static bool needs_conversion(const SpatialVariableMetadata &var, const File &file) {
+  return (var.get_string("units") != var.get_string("glaciological_units") or
+          file.significant_digits(var.get_name()) > 0);
+}
+
+//! Convert `data` to glaciological units and round to the number of significant digits
+//! requested for `var` in `file`.
+static void convert_for_output(const SpatialVariableMetadata &var, const File &file,
+                               std::vector<double> &data) {
+  std::string
+    units               = var.get_string("units"),
+    glaciological_units = var.get_string("glaciological_units");
+
+  if (units != glaciological_units) {
+    units::Converter(var.unit_system(),
+                     units,
+                     glaciological_units).convert_doubles(data.data(), data.size());
+  }
+
+  const int digits = file.significant_digits(var.get_name());
+  if (digits > 0) {
+    const bool use_fill_value = var.has_attribute("_FillValue");
+    round_to_significant_digits(digits, use_fill_value,
+                                use_fill_value ? var.get_number("_FillValue") : 0.0,
+                                data.data(), data.size());
+  }
+}
+
 void write_spatial_variable(const SpatialVariableMetadata &var,
                             const IceGrid& grid,
                             const File &file,
@@ -723,30 +1269,104 @@ void write_spatial_variable(const SpatialVariableMetadata &var,
   // make sure we have at least one level
   unsigned int nlevels = std::max(var.get_levels().size(), (size_t)1);
 
-  std::string
-    units               = var.get_string("units"),
-    glaciological_units = var.get_string("glaciological_units");
+  if (file.checkpoint()) {
+    const std::string sum = checksum(grid.com, input, grid.xm() * grid.ym() * nlevels);
+    file.record_checksum(name, sum);
 
-  if (units != glaciological_units) {
-    size_t data_size = grid.xm() * grid.ym() * nlevels;
+    const std::string base = file.checkpoint_base();
+    if (not base.empty() and file.base_checksum(name) == sum) {
+      // this variable did not change since the base checkpoint was written: refer to it
+      // instead of writing data
+      file.redef();
+      file.write_attribute(name, "pism_checkpoint_base", base);
+      return;
+    }
+  }
+
+  size_t data_size = grid.xm() * grid.ym() * nlevels;
+
+  bool gathered = false;
+  if (file.gathered(name) and file.find_dimension(ice_column_dimension)) {
+    auto dims = file.dimensions(name);
+    gathered = std::find(dims.begin(), dims.end(), ice_column_dimension) != dims.end();
+  }
 
+  if (needs_conversion(var, file)) {
     // create a temporary array, convert to glaciological units, and
     // save
-    std::vector<double> tmp(data_size);
-    for (size_t k = 0; k < data_size; ++k) {
-      tmp[k] = input[k];
-    }
+    std::vector<double> tmp(input, input + data_size);
 
-    units::Converter(var.unit_system(),
-                     units,
-                     glaciological_units).convert_doubles(&tmp[0], tmp.size());
+    convert_for_output(var, file, tmp);
 
-    file.write_distributed_array(name, grid, nlevels, &tmp[0]);
+    if (gathered) {
+      write_gathered(var, grid, file, nlevels, tmp.data());
+    } else {
+      file.write_distributed_array(name, grid, nlevels, &tmp[0]);
+    }
+  } else if (gathered) {
+    write_gathered(var, grid, file, nlevels, input);
   } else {
     file.write_distributed_array(name, grid, nlevels, input);
   }
 }
 
+//! Write a variable using values `input` on the whole `grid` (ordered as in the file).
+/*!
+ * This is used by ranks writing files opened on `MPI_COMM_SELF` (see
+ * IceModel::write_extras_per_variable()). Writes to the last record of `file`.
+ */
+void write_spatial_variable_serial(const SpatialVariableMetadata &var,
+                                   const IceGrid& grid,
+                                   const File &file,
+                                   const double *input) {
+
+  auto name = var.get_name();
+
+  if (not file.find_variable(name)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "Can't find '%s' in '%s'.",
+                                  name.c_str(),
+                                  file.filename().c_str());
+  }
+
+  write_dimensions(var, grid, file);
+
+  if (var.get_time_independent()) {
+    bool written = file.attribute_type(var.get_name(), "not_written") == PISM_NAT;
+    if (written) {
+      return;
+    } else {
+      file.redef();
+      file.remove_attribute(var.get_name(), "not_written");
+    }
+  }
+
+  unsigned int nlevels = std::max(var.get_levels().size(), (size_t)1);
+
+  std::vector<unsigned int> start, count;
+  if (not var.get_time_independent()) {
+    start.push_back(file.nrecords() - 1);
+    count.push_back(1);
+  }
+  start.push_back(0);
+  count.push_back(grid.My());
+  start.push_back(0);
+  count.push_back(grid.Mx());
+  if (not var.get_z().get_name().empty()) {
+    start.push_back(0);
+    count.push_back(nlevels);
+  }
+
+  if (needs_conversion(var, file)) {
+    std::vector<double> tmp(input, input + grid.Mx() * grid.My() * nlevels);
+
+    convert_for_output(var, file, tmp);
+
+    file.write_variable(name, start, count, tmp.data());
+  } else {
+    file.write_variable(name, start, count, input);
+  }
+}
+
 //! \brief Regrid from a NetCDF file into a distributed array `output`.
 /*!
   - if `flag` is `CRITICAL` or `CRITICAL_FILL_MISSING`, stops if the
@@ -900,15 +1520,77 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
                              double default_value,
                              InterpolationType interpolation_type,
                              double *output) {
+  regrid_spatial_variable(variable, grid, file, t_start, flag, report_range,
+                          allow_extrapolation, default_value, interpolation_type,
+                          nullptr, output);
+}
+
+/*!
+ * Regrid a record of a variable.
+ *
+ * If `node_buffer` is not NULL, each record is read once per node (by the node leader)
+ * and shared by all ranks on the node. Otherwise each rank reads its own part.
+ */
+void regrid_spatial_variable(SpatialVariableMetadata &variable,
+                             const IceGrid& grid, const File &file,
+                             unsigned int t_start, RegriddingFlag flag,
+                             bool report_range,
+                             bool allow_extrapolation,
+                             double default_value,
+                             InterpolationType interpolation_type,
+                             NodeSharedBuffer *node_buffer,
+                             double *output) {
+  regrid_spatial_variable_records(variable, grid, file, t_start, 1, flag,
+                                  report_range, allow_extrapolation, default_value,
+                                  interpolation_type, node_buffer, output);
+}
+
+/*!
+ * Regrid `t_count` records of a variable starting at `t_start`.
+ *
+ * Records are stored one after another in `output`, which has to have room for
+ * `t_count * grid.xm() * grid.ym() * variable.get_levels().size()` numbers.
+ *
+ * Unless `node_buffer` is not NULL, all records are read using one hyperslab read and the
+ * interpolation context is computed once. Units are converted and the range is checked
+ * once for all records.
+ */
+void regrid_spatial_variable_records(SpatialVariableMetadata &variable,
+                                     const IceGrid& grid, const File &file,
+                                     unsigned int t_start, unsigned int t_count,
+                                     RegriddingFlag flag,
+                                     bool report_range,
+                                     bool allow_extrapolation,
+                                     double default_value,
+                                     InterpolationType interpolation_type,
+                                     NodeSharedBuffer *node_buffer,
+                                     double *output) {
   const Logger &log = *grid.ctx()->log();
 
   units::System::Ptr sys = variable.unit_system();
   const std::vector<double>& levels = variable.get_levels();
-  const size_t data_size = grid.xm() * grid.ym() * levels.size();
+  const size_t
+    record_size = grid.xm() * grid.ym() * levels.size(),
+    data_size   = record_size * t_count;
 
   // Find the variable
   auto var = file.find_variable(variable.get_name(), variable.get_string("standard_name"));
 
+  if (var.exists) {
+    check_not_gathered(file, var.name);
+
+    std::string base = checkpoint_base(file, var.name);
+    if (not base.empty()) {
+      File base_file(grid.com, base, PISM_GUESS, PISM_READONLY);
+      for (unsigned int k = 0; k < t_count; ++k) {
+        regrid_spatial_variable(variable, grid, base_file, base_file.nrecords() - 1, flag,
+                                report_range, allow_extrapolation, default_value,
+                                interpolation_type, node_buffer, output + k * record_size);
+      }
+      return;
+    }
+  }
+
   if (var.exists) {                      // the variable was found successfully
 
     {
@@ -928,9 +1610,11 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
                   file.filename().c_str());
 
       regrid_vec_fill_missing(file, grid, var.name, levels,
-                              t_start, default_value, interpolation_type, output);
+                              t_start, t_count, default_value, interpolation_type,
+                              node_buffer, output);
     } else {
-      regrid_vec(file, grid, var.name, levels, t_start, interpolation_type, output);
+      regrid_vec(file, grid, var.name, levels, t_start, t_count, interpolation_type,
+                 node_buffer, output);
     }
 
     // Now we need to get the units string from the file and convert
@@ -43,8 +43,19 @@ class Config;
 
 namespace io {
 
+class NodeSharedBuffer;
+
+void regrid_spatial_variable(SpatialVariableMetadata &var,
+                             const IceGrid& grid, const File &nc,
+                             RegriddingFlag flag, bool do_report_range,
+                             bool allow_extrapolation,
+                             double default_value,
+                             InterpolationType type,
+                             double *output);
+
 void regrid_spatial_variable(SpatialVariableMetadata &var,
                              const IceGrid& grid, const File &nc,
+                             unsigned int t_start,
                              RegriddingFlag flag, bool do_report_range,
                              bool allow_extrapolation,
                              double default_value,
@@ -58,16 +69,37 @@ void regrid_spatial_variable(SpatialVariableMetadata &var,
                              bool allow_extrapolation,
                              double default_value,
                              InterpolationType type,
+                             NodeSharedBuffer *node_buffer,
                              double *output);
 
+void regrid_spatial_variable_records(SpatialVariableMetadata &var,
+                                     const IceGrid& grid, const File &nc,
+                                     unsigned int t_start, unsigned int t_count,
+                                     RegriddingFlag flag, bool do_report_range,
+                                     bool allow_extrapolation,
+                                     double default_value,
+                                     InterpolationType type,
+                                     NodeSharedBuffer *node_buffer,
+                                     double *output);
+
 void read_spatial_variable(const SpatialVariableMetadata &var,
                            const IceGrid& grid, const File &nc,
                            unsigned int time, double *output);
 
+void read_spatial_variables(const std::vector<const SpatialVariableMetadata*> &variables,
+                            const IceGrid& grid, const File &file,
+                            unsigned int time, const std::vector<double*> &outputs);
+
 void write_spatial_variable(const SpatialVariableMetadata &var,
                             const IceGrid& grid, const File &nc,
                             const double *input);
 
+void write_spatial_variable_serial(const SpatialVariableMetadata &var,
+                                   const IceGrid& grid, const File &file,
+                                   const double *input);
+
+bool time_independent_written(const SpatialVariableMetadata &var, const File &file);
+
 void define_dimension(const File &nc, unsigned long int length,
                       const VariableMetadata &metadata);
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,40 +17,257 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <vector>
+#include <algorithm>            // std::sort, std::lower_bound
+#include <cmath>                // std::fabs
+
 #include "label_components.hh"
 
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/pism_utilities.hh"
 #include "pism/util/error_handling.hh"
 #include "connected_components.hh"
 
 namespace pism {
 
+//! A foreground point at the edge of a subdomain and its neighbor owned by another rank.
+struct BoundaryLink {
+  //! local index of the component containing the point
+  int component;
+  //! neighbor's grid indices
+  int i, j;
+};
+
 /*!
  * Label connected components in a mask stored in an IceModelVec2Int.
  *
- * This function allocates a copy on rank 0 and so should not be used if that is a
- * problem.
+ * Points with values above zero are "foreground", the rest are "background". Components
+ * are 4-connected.
+ *
+ * If `identify_icebergs` is true, points in components that contain at least one point
+ * with the value `mask_grounded` are set to 0, points in all other components to 1.
+ * Otherwise components get labels from 1 to the number of components.
+ *
+ * Background points are not modified.
+ *
+ * The algorithm:
+ *
+ * 1. Label components within each subdomain using the serial algorithm (run-length
+ *    encoding and union-find) and give them globally unique IDs.
+ *
+ * 2. Exchange labels across subdomain boundaries (using ghosts), replacing the label of a
+ *    component with the smallest label of its neighbors and propagating the "grounded"
+ *    flag. Each iteration updates whole components, so the number of iterations depends
+ *    on the number of subdomains a component spans, not on its size.
+ *
+ * 3. Number resulting components consecutively (or set iceberg flags).
  */
 void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded) {
-  auto mask_p0 = mask.allocate_proc0_copy();
-
-  mask.put_on_proc0(*mask_p0);
+  const double eps = 1e-6;
 
   auto grid = mask.grid();
 
-  ParallelSection rank0(grid->com);
-  try {
-    if (grid->rank() == 0) {
-      petsc::VecArray array(*mask_p0);
-      label_connected_components(array.get(), grid->My(), grid->Mx(),
-                                 identify_icebergs, mask_grounded);
+  const int
+    Mx = grid->Mx(),
+    My = grid->My(),
+    xs = grid->xs(),
+    xm = grid->xm(),
+    ys = grid->ys(),
+    ym = grid->ym();
+
+  // Step 1: label components in this subdomain.
+  std::vector<double> image(xm * ym);
+  {
+    IceModelVec::AccessList list(mask);
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      image[(j - ys) * xm + (i - xs)] = mask(i, j);
+    }
+  }
+
+  label_connected_components(image.data(), ym, xm, false, 0.0);
+
+  // local component index of a foreground point (0 is not used)
+  auto component = [&](int i, int j) {
+    return (int)image[(j - ys) * xm + (i - xs)];
+  };
+
+  int n_components = 0;
+  {
+    IceModelVec::AccessList list(mask);
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (mask(i, j) > 0.0) {
+        n_components = std::max(n_components, component(i, j));
+      }
+    }
+  }
+
+  // local component c gets the globally unique ID offset + c
+  int offset = 0;
+  MPI_Exscan(&n_components, &offset, 1, MPI_INT, MPI_SUM, grid->com);
+  if (grid->rank() == 0) {
+    // MPI_Exscan leaves the result on rank 0 undefined
+    offset = 0;
+  }
+
+  // labels and "grounded" flags of local components
+  std::vector<double> label(n_components + 1), grounded(n_components + 1, 0.0);
+  std::vector<BoundaryLink> links;
+  {
+    for (int c = 1; c <= n_components; ++c) {
+      label[c] = offset + c;
+    }
+
+    IceModelVec::AccessList list(mask);
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (not (mask(i, j) > 0.0)) {
+        continue;
+      }
+
+      const int c = component(i, j);
+
+      if (std::fabs(mask(i, j) - mask_grounded) < eps) {
+        grounded[c] = 1.0;
+      }
+
+      // record neighbors owned by other ranks (skipping points outside the domain)
+      const int
+        ii[] = {i - 1, i + 1, i,     i},
+        jj[] = {j,     j,     j - 1, j + 1};
+      for (int n = 0; n < 4; ++n) {
+        const bool
+          in_domain = ii[n] >= 0 and ii[n] < Mx and jj[n] >= 0 and jj[n] < My,
+          in_subdomain = (ii[n] >= xs and ii[n] < xs + xm and
+                          jj[n] >= ys and jj[n] < ys + ym);
+
+        if (in_domain and not in_subdomain) {
+          links.push_back({c, ii[n], jj[n]});
+        }
+      }
+    }
+  }
+
+  // Step 2: merge labels across subdomain boundaries.
+  IceModelVec2Int labels(grid, "component_labels", WITH_GHOSTS, 1);
+  IceModelVec2Int flags(grid, "component_grounded_flags", WITH_GHOSTS, 1);
+
+  auto set_fields = [&]() {
+    IceModelVec::AccessList list{&mask, &labels, &flags};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (mask(i, j) > 0.0) {
+        const int c = component(i, j);
+        labels(i, j) = label[c];
+        flags(i, j)  = grounded[c];
+      } else {
+        labels(i, j) = 0.0;
+        flags(i, j)  = 0.0;
+      }
+    }
+  };
+
+  set_fields();
+
+  while (true) {
+    labels.update_ghosts();
+    flags.update_ghosts();
+
+    int changed = 0;
+    {
+      IceModelVec::AccessList list{&labels, &flags};
+
+      for (const auto &link : links) {
+        const double L = labels(link.i, link.j);
+
+        if (not (L > 0.0)) {
+          // the neighbor is a background point
+          continue;
+        }
+
+        const int c = link.component;
+
+        if (L < label[c]) {
+          label[c] = L;
+          changed = 1;
+        }
+
+        if (flags(link.i, link.j) > 0.5 and grounded[c] < 0.5) {
+          grounded[c] = 1.0;
+          changed = 1;
+        }
+      }
+    }
+
+    if (GlobalSum(grid->com, changed) == 0) {
+      break;
+    }
+
+    set_fields();
+  }
+
+  // Step 3: store results.
+  if (identify_icebergs) {
+    IceModelVec::AccessList list(mask);
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (mask(i, j) > 0.0) {
+        mask(i, j) = 1.0 - grounded[component(i, j)];
+      }
+    }
+  } else {
+    // A merged component is labeled using the smallest ID of its parts. Collect these
+    // IDs from all ranks to number components consecutively.
+    std::vector<double> roots;
+    for (int c = 1; c <= n_components; ++c) {
+      if ((int)label[c] == offset + c) {
+        roots.push_back(label[c]);
+      }
+    }
+
+    int n_roots = roots.size();
+    std::vector<int> counts(grid->size()), displacements(grid->size());
+    MPI_Allgather(&n_roots, 1, MPI_INT, counts.data(), 1, MPI_INT, grid->com);
+
+    int total = 0;
+    for (int r = 0; r < grid->size(); ++r) {
+      displacements[r] = total;
+      total += counts[r];
+    }
+
+    std::vector<double> all_roots(total);
+    MPI_Allgatherv(roots.data(), n_roots, MPI_DOUBLE,
+                   all_roots.data(), counts.data(), displacements.data(), MPI_DOUBLE,
+                   grid->com);
+    std::sort(all_roots.begin(), all_roots.end());
+
+    IceModelVec::AccessList list(mask);
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (mask(i, j) > 0.0) {
+        const double L = label[component(i, j)];
+        auto k = std::lower_bound(all_roots.begin(), all_roots.end(), L) - all_roots.begin();
+        mask(i, j) = k + 1;
+      }
     }
-  } catch (...) {
-    rank0.failed();
   }
-  rank0.check();
 
-  mask.get_from_proc0(*mask_p0);
+  mask.update_ghosts();
+  mask.inc_state_counter();
 }
 
 } // end of namespace pism
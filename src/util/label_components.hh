@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -24,6 +24,7 @@ namespace pism {
 
 class IceModelVec2Int;
 
+//! Label connected components in a distributed mask. See label_components.cc for details.
 void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded);
 
 } // end of namespace pism
@@ -0,0 +1,346 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+
+#include "pism/util/partitioning.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/IS.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
+
+namespace pism {
+
+/*!
+ * Uses prefix sums of `weights`: the end of the part `n` is the point where the prefix
+ * sum is closest to `(n + 1) / N` times the total weight, subject to the constraint that
+ * each part contains at least `min_size` points.
+ *
+ * All weights have to be non-negative.
+ */
+std::vector<unsigned int> weighted_ownership_ranges(const std::vector<double> &weights,
+                                                    unsigned int N,
+                                                    unsigned int min_size) {
+  const unsigned int M = weights.size();
+
+  if (N == 0 or M < N * min_size) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "Can't split %d grid points into %d parts.", M, N);
+  }
+
+  std::vector<double> prefix(M + 1, 0.0);
+  for (unsigned int k = 0; k < M; ++k) {
+    if (weights[k] < 0.0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "negative weight %f at index %d", weights[k], k);
+    }
+    prefix[k + 1] = prefix[k] + weights[k];
+  }
+
+  std::vector<unsigned int> result(N);
+
+  unsigned int start = 0;
+  for (unsigned int n = 0; n < N - 1; ++n) {
+    const double target = prefix[M] * (n + 1) / N;
+
+    // range of allowed ends of the current part
+    const unsigned int
+      lo = start + min_size,
+      hi = M - (N - n - 1) * min_size;
+
+    unsigned int end = std::lower_bound(prefix.begin() + lo, prefix.begin() + hi + 1,
+                                        target) - prefix.begin();
+    end = std::min(end, hi);
+
+    if (end > lo and target - prefix[end - 1] < prefix[end] - target) {
+      end -= 1;
+    }
+
+    result[n] = end - start;
+    start = end;
+  }
+  result[N - 1] = M - start;
+
+  return result;
+}
+
+/*!
+ * The cost of an ice-free column is one, so `icy_cell_cost` is the *additional* cost of
+ * an ice-covered column relative to an ice-free one.
+ */
+void column_cost(const IceModelVec2S &ice_thickness, double icy_cell_cost,
+                 IceModelVec2S &result) {
+  IceGrid::ConstPtr grid = result.grid();
+
+  IceModelVec::AccessList list{&ice_thickness, &result};
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result(i, j) = ice_thickness(i, j) > 0.0 ? 1.0 + icy_cell_cost : 1.0;
+  }
+}
+
+/*!
+ * Equal to one if the work is distributed perfectly and to the number of ranks if one
+ * rank does all the work.
+ */
+double load_imbalance(const IceModelVec2S &cost) {
+  IceGrid::ConstPtr grid = cost.grid();
+
+  IceModelVec::AccessList list{&cost};
+
+  double local_cost = 0.0;
+  for (Points p(*grid); p; p.next()) {
+    local_cost += cost(p.i(), p.j());
+  }
+
+  double
+    total = GlobalSum(grid->com, local_cost),
+    max   = GlobalMax(grid->com, local_cost),
+    mean  = total / grid->size();
+
+  return mean > 0.0 ? max / mean : 1.0;
+}
+
+GridParameters grid_parameters(const IceGrid &grid) {
+  GridParameters result;
+
+  result.Lx           = grid.Lx();
+  result.Ly           = grid.Ly();
+  result.x0           = grid.x0();
+  result.y0           = grid.y0();
+  result.Mx           = grid.Mx();
+  result.My           = grid.My();
+  result.registration = grid.registration();
+  result.periodicity  = grid.periodicity();
+  result.z            = grid.z();
+
+  petsc::DM::Ptr da = grid.get_dm(1, 0);
+
+  PetscInt Nx = 0, Ny = 0;
+  PetscErrorCode ierr = DMDAGetInfo(*da, NULL, NULL, NULL, NULL,
+                                    &Nx, &Ny, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+  PISM_CHK(ierr, "DMDAGetInfo");
+
+  const PetscInt *lx = NULL, *ly = NULL;
+  ierr = DMDAGetOwnershipRanges(*da, &lx, &ly, NULL);
+  PISM_CHK(ierr, "DMDAGetOwnershipRanges");
+
+  result.procs_x = std::vector<unsigned int>(lx, lx + Nx);
+  result.procs_y = std::vector<unsigned int>(ly, ly + Ny);
+
+  return result;
+}
+
+/*!
+ * Keeps the number of ranks in each direction and moves boundaries between patches so
+ * that each row (column) of patches gets roughly the same total cost.
+ *
+ * This tensor-product partitioning does not balance the cost exactly (patches are
+ * rectangular and boundaries between them have to be straight lines), but it reduces
+ * the imbalance in the common case of an ice sheet surrounded by ice-free areas.
+ */
+IceGrid::Ptr weighted_grid(const IceGrid &grid, const IceModelVec2S &cost) {
+  GridParameters P = grid_parameters(grid);
+
+  std::vector<double>
+    local_x(P.Mx, 0.0), local_y(P.My, 0.0),
+    weights_x(P.Mx, 0.0), weights_y(P.My, 0.0);
+
+  {
+    IceModelVec::AccessList list{&cost};
+
+    for (Points p(grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      local_x[i] += cost(i, j);
+      local_y[j] += cost(i, j);
+    }
+  }
+
+  GlobalSum(grid.com, local_x.data(), weights_x.data(), P.Mx);
+  GlobalSum(grid.com, local_y.data(), weights_y.data(), P.My);
+
+  P.procs_x = weighted_ownership_ranges(weights_x, P.procs_x.size());
+  P.procs_y = weighted_ownership_ranges(weights_y, P.procs_y.size());
+
+  IceGrid::Ptr result(new IceGrid(grid.ctx(), P));
+  result->set_mapping_info(grid.get_mapping_info());
+
+  return result;
+}
+
+//! Read ice thickness from `filename` and compute the cost of each column on `grid`.
+static void read_cost(const std::string &filename, double icy_cell_cost,
+                      IceModelVec2S &result) {
+  IceModelVec2S thickness(result.grid(), "thk", WITHOUT_GHOSTS);
+  thickness.set_attrs("internal", "land ice thickness", "m", "m", "land_ice_thickness", 0);
+  thickness.metadata().set_number("valid_min", 0.0);
+
+  thickness.regrid(filename, OPTIONAL, 0.0);
+
+  column_cost(thickness, icy_cell_cost, result);
+}
+
+/*!
+ * Computes the load imbalance for the original and re-partitioned grids, reports both
+ * and returns the one with the smaller imbalance.
+ */
+IceGrid::Ptr ice_weighted_grid(IceGrid::Ptr grid, const std::string &filename) {
+  Config::ConstPtr config = grid->ctx()->config();
+  Logger::ConstPtr log = grid->ctx()->log();
+
+  if (grid->size() == 1) {
+    return grid;
+  }
+
+  double icy_cell_cost = config->get_number("grid.partitioning.icy_cell_cost");
+
+  IceModelVec2S cost(grid, "column_cost", WITHOUT_GHOSTS);
+  read_cost(filename, icy_cell_cost, cost);
+  double imbalance_even = load_imbalance(cost);
+
+  IceGrid::Ptr result = weighted_grid(*grid, cost);
+
+  IceModelVec2S new_cost(result, "column_cost", WITHOUT_GHOSTS);
+  read_cost(filename, icy_cell_cost, new_cost);
+  double imbalance_weighted = load_imbalance(new_cost);
+
+  log->message(2,
+               "* Load imbalance (max/mean cost per process): %.3f (even), %.3f (ice-weighted)\n",
+               imbalance_even, imbalance_weighted);
+
+  if (imbalance_weighted < imbalance_even) {
+    return result;
+  }
+
+  log->message(2, "  Ice-weighted partitioning does not help; using the even one.\n");
+
+  return grid;
+}
+
+//! Number of degrees of freedom (per map-plane grid point) of `vec`.
+static unsigned int ndof(const IceModelVec &vec) {
+  return std::max((size_t)vec.ndof(), vec.levels().size());
+}
+
+/*!
+ * Grids of `source` and `destination` have to have the same size; they may use different
+ * ownership ranges (and a different number of ranks in each direction).
+ *
+ * Uses the natural (application) ordering of grid points: values are converted to the
+ * natural ordering using the DM of the source, moved between ranks owning the same
+ * natural indices in the source and destination layouts and converted to PETSc's ordering
+ * using the DM of the destination. No files are written.
+ */
+void migrate(const IceModelVec &source, IceModelVec &destination) {
+  IceGrid::ConstPtr
+    source_grid      = source.grid(),
+    destination_grid = destination.grid();
+
+  const unsigned int N = ndof(source);
+
+  if (source_grid->Mx() != destination_grid->Mx() or
+      source_grid->My() != destination_grid->My() or
+      N != ndof(destination)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot migrate %s to %s: grid sizes do not match",
+                                  source.get_name().c_str(),
+                                  destination.get_name().c_str());
+  }
+
+  {
+    int comparison = MPI_UNEQUAL;
+    MPI_Comm_compare(source_grid->com, destination_grid->com, &comparison);
+    if (comparison != MPI_IDENT and comparison != MPI_CONGRUENT) {
+      // see grid.partitioning.node_aware
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "cannot migrate %s to %s: grids use different process orderings",
+                                    source.get_name().c_str(),
+                                    destination.get_name().c_str());
+    }
+  }
+
+  PetscErrorCode ierr = 0;
+
+  petsc::DM::Ptr
+    source_da      = source_grid->get_dm(N, 0),
+    destination_da = destination_grid->get_dm(N, 0);
+
+  petsc::Vec source_global, source_natural, destination_natural, destination_global;
+
+  ierr = DMCreateGlobalVector(*source_da, source_global.rawptr());
+  PISM_CHK(ierr, "DMCreateGlobalVector");
+
+  ierr = DMDACreateNaturalVector(*source_da, source_natural.rawptr());
+  PISM_CHK(ierr, "DMDACreateNaturalVector");
+
+  ierr = DMDACreateNaturalVector(*destination_da, destination_natural.rawptr());
+  PISM_CHK(ierr, "DMDACreateNaturalVector");
+
+  ierr = DMCreateGlobalVector(*destination_da, destination_global.rawptr());
+  PISM_CHK(ierr, "DMCreateGlobalVector");
+
+  source.copy_to_vec(source_da, source_global);
+
+  ierr = DMDAGlobalToNaturalBegin(*source_da, source_global, INSERT_VALUES, source_natural);
+  PISM_CHK(ierr, "DMDAGlobalToNaturalBegin");
+
+  ierr = DMDAGlobalToNaturalEnd(*source_da, source_global, INSERT_VALUES, source_natural);
+  PISM_CHK(ierr, "DMDAGlobalToNaturalEnd");
+
+  // natural indices owned by this rank in the destination layout
+  PetscInt lo = 0, hi = 0;
+  ierr = VecGetOwnershipRange(destination_natural, &lo, &hi);
+  PISM_CHK(ierr, "VecGetOwnershipRange");
+
+  petsc::IS is;
+  ierr = ISCreateStride(destination_grid->com, hi - lo, lo, 1, is.rawptr());
+  PISM_CHK(ierr, "ISCreateStride");
+
+  petsc::VecScatter scatter;
+  ierr = VecScatterCreate(source_natural, is, destination_natural, is, scatter.rawptr());
+  PISM_CHK(ierr, "VecScatterCreate");
+
+  ierr = VecScatterBegin(scatter, source_natural, destination_natural,
+                         INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(scatter, source_natural, destination_natural,
+                       INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterEnd");
+
+  ierr = DMDANaturalToGlobalBegin(*destination_da, destination_natural, INSERT_VALUES,
+                                  destination_global);
+  PISM_CHK(ierr, "DMDANaturalToGlobalBegin");
+
+  ierr = DMDANaturalToGlobalEnd(*destination_da, destination_natural, INSERT_VALUES,
+                                destination_global);
+  PISM_CHK(ierr, "DMDANaturalToGlobalEnd");
+
+  destination.copy_from_vec(destination_global);
+}
+
+} // end of namespace pism
@@ -0,0 +1,59 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_PARTITIONING_H
+#define PISM_PARTITIONING_H
+
+#include <vector>
+#include <string>
+
+#include "pism/util/IceGrid.hh"
+
+namespace pism {
+
+class IceModelVec;
+class IceModelVec2S;
+
+//! Split `weights.size()` grid points into `N` contiguous parts of roughly equal weight.
+std::vector<unsigned int> weighted_ownership_ranges(const std::vector<double> &weights,
+                                                    unsigned int N,
+                                                    unsigned int min_size = 2);
+
+//! Compute the cost of each column (1 for ice-free columns, `1 + icy_cell_cost` otherwise).
+void column_cost(const IceModelVec2S &ice_thickness, double icy_cell_cost,
+                 IceModelVec2S &result);
+
+//! Load imbalance: the maximum over all ranks of the cost of a patch divided by the mean.
+double load_imbalance(const IceModelVec2S &cost);
+
+//! Parameters of a grid (including ownership ranges).
+GridParameters grid_parameters(const IceGrid &grid);
+
+//! Create a copy of `grid` with ownership ranges balancing the cost of columns.
+IceGrid::Ptr weighted_grid(const IceGrid &grid, const IceModelVec2S &cost);
+
+//! Re-partition `grid` using ice thickness read from `filename`.
+IceGrid::Ptr ice_weighted_grid(IceGrid::Ptr grid, const std::string &filename);
+
+//! Copy values of `source` to `destination` defined on a grid with a different decomposition.
+void migrate(const IceModelVec &source, IceModelVec &destination);
+
+} // end of namespace pism
+
+#endif /* PISM_PARTITIONING_H */
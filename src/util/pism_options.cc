@@ -25,6 +25,8 @@
 
 #include "error_handling.hh"
 #include "Logger.hh"
+#include "Context.hh"
+#include "Profiling.hh"
 
 namespace pism {
 
@@ -92,4 +94,46 @@ bool show_usage_check_req_opts(const Logger &log,
   return keep_running;
 }
 
+ProfilingOptions::ProfilingOptions() {
+  options::String profile_log("-profile",
+                              "Save detailed profiling data to a file.");
+  options::String profile_trace("-profile_trace",
+                                "Save timings of all events to FILE-RANK.json (Chrome trace format).");
+  options::String profile_json("-profile_json",
+                               "Save the summary of event timings to a file (JSON format).");
+
+  counters = options::Bool("-profile_counters",
+                           "Record hardware performance counters of profiling events"
+                           " (Linux only; used with -profile and -profile_json).");
+
+  log     = profile_log.is_set() ? profile_log.value() : "";
+  trace   = profile_trace.is_set() ? profile_trace.value() : "";
+  summary = profile_json.is_set() ? profile_json.value() : "";
+}
+
+//! Start profiling if any of the profiling outputs was requested.
+void start_profiling(const Context &ctx, const ProfilingOptions &options) {
+  if (not (options.log.empty() and options.trace.empty() and options.summary.empty())) {
+    ctx.profiling().start(not options.trace.empty(), options.counters);
+  }
+}
+
+//! Save profiling outputs requested using command-line options.
+void save_profiling_results(const Context &ctx, const ProfilingOptions &options) {
+  const Profiling &profiling = ctx.profiling();
+
+  if (not options.log.empty()) {
+    profiling.report(options.log);
+    profiling.summary(ctx.com(), *ctx.log());
+  }
+
+  if (not options.summary.empty()) {
+    profiling.save_summary(ctx.com(), options.summary);
+  }
+
+  if (not options.trace.empty()) {
+    profiling.trace(options.trace, ctx.rank());
+  }
+}
+
 } // end of namespace pism
@@ -31,6 +31,7 @@ namespace pism {
 
 class Config;
 class Logger;
+class Context;
 
 void show_usage(const Logger &log, const std::string &execname, const std::string &usage);
 
@@ -41,6 +42,22 @@ bool show_usage_check_req_opts(const Logger &log,
                                const std::vector<std::string> &required_options,
                                const std::string &usage);
 
+//! Profiling output requested using command-line options.
+struct ProfilingOptions {
+  ProfilingOptions();
+  //! PETSc log and the summary printed to stdout (`-profile`)
+  std::string log;
+  //! prefix of per-rank Chrome trace files (`-profile_trace`)
+  std::string trace;
+  //! summary in the JSON format (`-profile_json`)
+  std::string summary;
+  //! true if hardware performance counters should be recorded (`-profile_counters`)
+  bool counters;
+};
+
+void start_profiling(const Context &ctx, const ProfilingOptions &options);
+void save_profiling_results(const Context &ctx, const ProfilingOptions &options);
+
 
 //! Utilities for processing command-line options.
 namespace options {
@@ -44,9 +44,14 @@
 #include <jansson.h>            // JANSSON_VERSION
 #endif
 
+#if (Pism_USE_OPENMP==1)
+#include <omp.h>                // omp_get_max_threads
+#endif
+
 #include <petsctime.h>          // PetscTime
 
 #include "error_handling.hh"
+#include "Profiling.hh"
 
 namespace pism {
 
@@ -128,6 +133,7 @@ bool member(const std::string &string, const std::set<std::string> &set) {
 }
 
 void GlobalReduce(MPI_Comm comm, double *local, double *result, int count, MPI_Op op) {
+  WaitTimer timer;
   int err = MPI_Allreduce(local, result, count, MPI_DOUBLE, op, comm);
   PISM_C_CHK(err, 0, "MPI_Allreduce");
 }
@@ -146,6 +152,7 @@ void GlobalSum(MPI_Comm comm, double *local, double *result, int count) {
 
 unsigned int GlobalSum(MPI_Comm comm, unsigned int input) {
   unsigned int result;
+  WaitTimer timer;
   int err = MPI_Allreduce(&input, &result, 1, MPI_UNSIGNED, MPI_SUM, comm);
   PISM_C_CHK(err, 0, "MPI_Allreduce");
   return result;
@@ -153,6 +160,7 @@ unsigned int GlobalSum(MPI_Comm comm, unsigned int input) {
 
 int GlobalSum(MPI_Comm comm, int input) {
   int result;
+  WaitTimer timer;
   int err = MPI_Allreduce(&input, &result, 1, MPI_INT, MPI_SUM, comm);
   PISM_C_CHK(err, 0, "MPI_Allreduce");
   return result;
@@ -176,6 +184,35 @@ double GlobalSum(MPI_Comm comm, double local) {
   return result;
 }
 
+//! Returns the union of sets of strings `local` on all ranks in `comm`.
+std::set<std::string> GlobalUnion(MPI_Comm comm, const std::set<std::string> &local) {
+  int size = 0;
+  MPI_Comm_size(comm, &size);
+
+  std::string buffer;
+  for (const auto &s : local) {
+    buffer += s + '\n';
+  }
+
+  int length = buffer.size();
+  std::vector<int> lengths(size), offsets(size);
+  int err = MPI_Allgather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, comm);
+  PISM_C_CHK(err, 0, "MPI_Allgather");
+
+  int total = 0;
+  for (int k = 0; k < size; ++k) {
+    offsets[k] = total;
+    total += lengths[k];
+  }
+
+  std::vector<char> result(total + 1, '\0');
+  err = MPI_Allgatherv(const_cast<char*>(buffer.data()), length, MPI_CHAR,
+                       result.data(), lengths.data(), offsets.data(), MPI_CHAR, comm);
+  PISM_C_CHK(err, 0, "MPI_Allgatherv");
+
+  return set_split(std::string(result.data(), total), '\n');
+}
+
 static const int TEMPORARY_STRING_LENGTH = 32768;
 
 std::string version() {
@@ -226,6 +263,12 @@ std::string version() {
   result += buffer;
 #endif
 
+#if (Pism_USE_OPENMP==1)
+  snprintf(buffer, sizeof(buffer), "OpenMP %d (up to %d threads per process).\n",
+           _OPENMP, omp_get_max_threads());
+  result += buffer;
+#endif
+
 #if (Pism_BUILD_PYTHON_BINDINGS==1)
   snprintf(buffer, sizeof(buffer), "SWIG %s.\n", pism::swig_version);
   result += buffer;
@@ -115,6 +115,8 @@ unsigned int GlobalSum(MPI_Comm comm, unsigned int input);
 
 int GlobalSum(MPI_Comm comm, int input);
 
+std::set<std::string> GlobalUnion(MPI_Comm comm, const std::set<std::string> &local);
+
 std::string version();
 
 std::string printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
@@ -0,0 +1,167 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Compares the per-column and batched tridiagonal solvers (TridiagonalSystem and\n"
+  "TridiagonalSystemBatch).\n\n";
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include "pism/util/ColumnSystem.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+using namespace pism;
+
+//! Diagonally-dominant systems similar to the ones used in the energy balance code.
+struct Systems {
+  Systems(unsigned int size, unsigned int n_systems)
+    : Mz(size), N(n_systems),
+      L(size * n_systems), D(size * n_systems), U(size * n_systems),
+      rhs(size * n_systems) {
+
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // column c is stored at [c * Mz, (c + 1) * Mz)
+    for (unsigned int k = 0; k < L.size(); ++k) {
+      L[k]   = -uniform(generator);
+      U[k]   = -uniform(generator);
+      D[k]   = 1.0 + std::fabs(L[k]) + std::fabs(U[k]) + uniform(generator);
+      rhs[k] = 250.0 + 20.0 * uniform(generator);
+    }
+  }
+
+  unsigned int Mz, N;
+  std::vector<double> L, D, U, rhs;
+};
+
+//! Solve all systems one at a time. Returns the elapsed time.
+static double per_column(const Systems &S, int n_repeats, std::vector<double> &result) {
+  TridiagonalSystem system(S.Mz, "per_column");
+  result.resize(S.Mz * S.N);
+
+  double start = get_time();
+  for (int r = 0; r < n_repeats; ++r) {
+    for (unsigned int c = 0; c < S.N; ++c) {
+      const unsigned int offset = c * S.Mz;
+      for (unsigned int k = 0; k < S.Mz; ++k) {
+        system.L(k)   = S.L[offset + k];
+        system.D(k)   = S.D[offset + k];
+        system.U(k)   = S.U[offset + k];
+        system.RHS(k) = S.rhs[offset + k];
+      }
+      system.solve(S.Mz, &result[offset]);
+    }
+  }
+  return get_time() - start;
+}
+
+//! Solve all systems in batches. Returns the elapsed time.
+static double batched(const Systems &S, int n_repeats, unsigned int batch_size,
+                      std::vector<double> &result) {
+  TridiagonalSystemBatch batch(S.Mz, batch_size, "batched");
+  std::vector<double> x(S.Mz * batch_size);
+  result.resize(S.Mz * S.N);
+
+  double start = get_time();
+  for (int r = 0; r < n_repeats; ++r) {
+    for (unsigned int c0 = 0; c0 < S.N; c0 += batch_size) {
+      const unsigned int n = std::min(batch_size, S.N - c0);
+
+      for (unsigned int c = 0; c < n; ++c) {
+        const unsigned int offset = (c0 + c) * S.Mz;
+        for (unsigned int k = 0; k < S.Mz; ++k) {
+          batch.L(k, c)   = S.L[offset + k];
+          batch.D(k, c)   = S.D[offset + k];
+          batch.U(k, c)   = S.U[offset + k];
+          batch.RHS(k, c) = S.rhs[offset + k];
+        }
+      }
+
+      batch.solve(S.Mz, n, x.data());
+
+      for (unsigned int c = 0; c < n; ++c) {
+        const unsigned int offset = (c0 + c) * S.Mz;
+        for (unsigned int k = 0; k < S.Mz; ++k) {
+          result[offset + k] = x[k * batch_size + c];
+        }
+      }
+    }
+  }
+  return get_time() - start;
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Logger log(com, 2);
+
+    options::IntegerList Mz("-Mz", "Sizes of tridiagonal systems", {101, 201, 401});
+    options::Integer n_columns("-n_columns", "Number of columns", 10000);
+    options::Integer batch_size("-batch_size", "Number of systems in a batch", 64);
+    options::Integer n_repeats("-n_repeats", "Number of times to repeat each solve", 10);
+
+    if (n_columns < 1 or batch_size < 1 or n_repeats < 1) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "-n_columns, -batch_size, and -n_repeats have to be positive");
+    }
+
+    log.message(2, "%d columns, batch size %d, %d repetitions\n",
+                n_columns.value(), batch_size.value(), n_repeats.value());
+    log.message(2, "%8s %16s %16s %10s %12s\n",
+                "Mz", "per column (s)", "batched (s)", "speedup", "max. diff.");
+
+    for (unsigned int k = 0; k < Mz->size(); ++k) {
+      if (Mz[k] < 1) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid system size: %d", Mz[k]);
+      }
+
+      Systems S(Mz[k], n_columns);
+
+      std::vector<double> x_column, x_batch;
+      double
+        t_column = per_column(S, n_repeats, x_column),
+        t_batch  = batched(S, n_repeats, batch_size, x_batch);
+
+      double diff = 0.0;
+      for (unsigned int n = 0; n < x_column.size(); ++n) {
+        diff = std::max(diff, std::fabs(x_column[n] - x_batch[n]));
+      }
+
+      log.message(2, "%8d %16.6f %16.6f %10.2f %12.2e\n",
+                  Mz[k], t_column, t_batch, t_column / t_batch, diff);
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
@@ -119,6 +119,7 @@ void IceCompModel::initTestFG() {
   }
 
   m_geometry.ice_thickness.update_ghosts();
+  m_geometry.ice_thickness.inc_state_counter();
 
   {
     IceModelVec2S bed_topography(m_grid, "topg", WITHOUT_GHOSTS);
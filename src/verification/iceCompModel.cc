@@ -338,6 +338,7 @@ void IceCompModel::initTestABCDH() {
   loop.check();
 
   m_geometry.ice_thickness.update_ghosts();
+  m_geometry.ice_thickness.inc_state_counter();
 
   {
     IceModelVec2S bed_uplift(m_grid, "uplift", WITHOUT_GHOSTS);
@@ -411,6 +412,7 @@ void IceCompModel::initTestL() {
     }
 
     m_geometry.ice_thickness.update_ghosts();
+    m_geometry.ice_thickness.inc_state_counter();
 
     bed_uplift.set(0.0);
 
@@ -437,6 +439,7 @@ void IceCompModel::reset_thickness_test_A() {
   }
 
   m_geometry.ice_thickness.update_ghosts();
+  m_geometry.ice_thickness.inc_state_counter();
 }
 
 void IceCompModel::computeGeometryErrors(double &gvolexact, double &gareaexact,
@@ -725,6 +728,25 @@ void IceCompModel::reportErrors() {
 
   }
 
+  // throughput of the time-stepping loop, in (horizontal grid points) x (time steps) per
+  // second of wall-clock time; used to track performance regressions
+  double n_steps = 0.0, wall_clock_time = 0.0, throughput = 0.0;
+  {
+    auto steps   = m_run_stats.get_numbers("time_steps");
+    auto seconds = m_run_stats.get_numbers("time_stepping_wall_clock_seconds");
+    if (not steps.empty() and not seconds.empty()) {
+      n_steps         = steps[0];
+      wall_clock_time = seconds[0];
+      if (wall_clock_time > 0.0) {
+        throughput = (double)m_grid->Mx() * m_grid->My() * n_steps / wall_clock_time;
+      }
+    }
+  }
+  m_log->message(1,
+             "performance:      steps     seconds  throughput\n");
+  m_log->message(1, "           %12d%12.3f%12.4g\n",
+                 (int)n_steps, wall_clock_time, throughput);
+
   m_log->message(1, "NUM ERRORS DONE\n");
 
   options::String report_file("-report_file", "NetCDF error report file");
@@ -759,6 +781,23 @@ void IceCompModel::reportErrors() {
     err.set_name("dz");
     io::write_timeseries(file, err, (size_t)start, m_grid->dz_max());
 
+    // Always write performance data:
+    err.clear_all_strings(); err.clear_all_doubles();
+    err.set_name("time_steps");
+    err.set_string("units", "1");
+    err.set_string("long_name", "number of time steps");
+    io::write_timeseries(file, err, (size_t)start, n_steps);
+
+    err.set_name("wall_clock_time");
+    err.set_string("units", "seconds");
+    err.set_string("long_name", "wall-clock time spent in the time-stepping loop");
+    io::write_timeseries(file, err, (size_t)start, wall_clock_time);
+
+    err.set_name("throughput");
+    err.set_string("units", "second-1");
+    err.set_string("long_name", "horizontal grid points times time steps per second");
+    io::write_timeseries(file, err, (size_t)start, throughput);
+
     // Always write the test name:
     err.clear_all_strings(); err.clear_all_doubles(); err.set_string("units", "1");
     err.set_name("test");
@@ -932,6 +971,7 @@ void IceCompModel::test_V_init() {
   m_ssa_dirichlet_bc_values.update_ghosts();
 
   m_geometry.ice_thickness.update_ghosts();
+  m_geometry.ice_thickness.inc_state_counter();
 }
 
 } // end of namespace pism
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Compares fields read using NC3File (rank 0 reads and sends each patch) to fields read
+using NC3Aggregated (two-level aggregation).
+
+Run using at least 2 MPI processes. With 3 processes the default number of aggregators
+(2) splits them into groups of different sizes.
+"""
+
+import os
+import numpy as np
+import PISM
+
+ctx = PISM.Context()
+ctx.log.set_threshold(0)
+
+filename = "aggregated_reads_test.nc"
+
+def create_grid():
+    "Create a grid with sub-domains of different sizes"
+    params = PISM.GridParameters(ctx.config)
+    params.Mx = 23
+    params.My = 17
+    params.z = PISM.DoubleVector(np.linspace(0, 1000, 5))
+    params.ownership_ranges_from_options(ctx.size)
+    return PISM.IceGrid(ctx.ctx, params)
+
+def allocate(grid, name, three_d):
+    "Allocate a 2D or 3D field"
+    if three_d:
+        return PISM.IceModelVec3(grid, name, PISM.WITHOUT_GHOSTS)
+    return PISM.IceModelVec2S(grid, name, PISM.WITHOUT_GHOSTS)
+
+def read(grid, backend, three_d, n_aggregators=0):
+    "Read the field from `filename` using `backend`"
+    f = PISM.File(grid.com, filename, backend, PISM.PISM_READONLY, -1, n_aggregators)
+    assert f.backend() == backend
+
+    v = allocate(grid, "data", three_d)
+    v.read(f, 0)
+    f.close()
+    return v
+
+def compare(three_d):
+    "Write a field and read it back using both backends"
+    grid = create_grid()
+
+    v = allocate(grid, "data", three_d)
+    with v.local_array() as a:
+        a[...] = np.random.rand(*a.shape)
+
+    output = PISM.util.prepare_output(filename)
+    v.write(output)
+    output.close()
+
+    try:
+        a = read(grid, PISM.PISM_NETCDF3, three_d)
+        with a.local_array() as x, v.local_array() as z:
+            np.testing.assert_equal(x, z)
+
+        # automatic, one aggregator, one aggregator per process
+        for n_aggregators in [0, 1, ctx.size]:
+            b = read(grid, PISM.PISM_NETCDF3_AGGREGATED, three_d, n_aggregators)
+            with b.local_array() as y, v.local_array() as z:
+                np.testing.assert_equal(y, z)
+    finally:
+        if ctx.rank == 0 and os.path.exists(filename):
+            os.remove(filename)
+
+def test_2d():
+    "NC3Aggregated and NC3File read the same 2D field"
+    compare(False)
+
+def test_3d():
+    "NC3Aggregated and NC3File read the same 3D field"
+    compare(True)
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""Run PISM performance benchmarks and collect Profiling summaries.
+
+Each case runs for a fixed number of time steps (time_stepping.max_steps) on a fixed
+grid, so timings are comparable between PISM versions. Results of all runs are saved to
+OUTPUT/benchmarks.json. Use --compare to check them against an earlier run.
+
+Use --pism-options to compare alternatives, e.g. SSAFD matrix storage formats:
+
+    run_benchmarks.py ... --cases mismip+ --sizes small medium large --output aij
+    run_benchmarks.py ... --cases mismip+ --sizes small medium large --output baij \
+        --pism-options="-ssafd_matrix_type baij" --compare aij/benchmarks.json
+"""
+
+import argparse
+import json
+import os
+import shlex
+import subprocess
+import sys
+import time
+
+import numpy as np
+from netCDF4 import Dataset as NC
+
+# Grid sizes (Mx, My, Mz) for each case and size.
+SIZES = {
+    "eismint2": {"small": (61, 61, 31), "medium": (121, 121, 61), "large": (241, 241, 101)},
+    "mismip+": {"small": (129, 17, 11), "medium": (257, 33, 11), "large": (513, 65, 11)},
+    "pismv_C": {"small": (61, 61, 31), "medium": (121, 121, 61), "large": (241, 241, 101)},
+    "pismv_G": {"small": (61, 61, 31), "medium": (121, 121, 61), "large": (241, 241, 101)},
+    "greenland": {"small": (76, 141, 41), "medium": (151, 281, 101), "large": (301, 561, 201)},
+}
+
+STEPS = 20
+
+
+def generate_mismip_plus(filename, Mx=257, My=33):
+    "MISMIP+ bed topography (Asay-Davis et al, 2016) with a uniform slab of ice."
+    Lx, Ly = 640e3, 80e3
+    x = np.linspace(0, Lx, Mx)
+    y = np.linspace(0, Ly, My)
+    xx, yy = np.meshgrid(x, y)
+
+    x_hat = xx / 300e3
+    Bx = -150.0 - 728.8 * x_hat**2 + 343.91 * x_hat**4 - 50.57 * x_hat**6
+    fc, dc, wc = 4e3, 500.0, 24e3
+    By = (dc / (1 + np.exp(-2 * (yy - Ly / 2 - wc) / fc)) +
+          dc / (1 + np.exp(2 * (yy - Ly / 2 + wc) / fc)))
+
+    fields = {
+        "topg": (np.maximum(Bx + By, -720.0), "m", "bedrock_altitude"),
+        "thk": (np.zeros_like(xx) + 100.0, "m", "land_ice_thickness"),
+        "climatic_mass_balance": (np.zeros_like(xx) + 0.3 * 910.0, "kg m-2 year-1",
+                                  "land_ice_surface_specific_mass_balance_flux"),
+        "ice_surface_temp": (np.zeros_like(xx) + 268.15, "K", None),
+        "bheatflx": (np.zeros_like(xx) + 0.07, "W m-2", None),
+    }
+    write(filename, x, y, fields)
+
+
+def generate_greenland(filename, Mx=151, My=281):
+    "A synthetic Greenland-shaped ice sheet with climate inputs for the PDD model."
+    Lx, Ly = 750e3, 1400e3
+    x = np.linspace(-Lx, Lx, Mx)
+    y = np.linspace(-Ly, Ly, My)
+    xx, yy = np.meshgrid(x, y)
+
+    r2 = (xx / (0.8 * Lx))**2 + (yy / (0.85 * Ly))**2
+    thk = 3000.0 * np.sqrt(np.maximum(1.0 - r2, 0.0))
+    topg = 400.0 * np.cos(np.pi * xx / Lx) * np.cos(0.5 * np.pi * yy / Ly) - 300.0 * r2
+    usurf = np.maximum(topg, 0.0) + thk
+
+    latitude = 72.0 + 12.0 * yy / Ly
+    air_temp = 273.15 + 30.0 - 0.006 * usurf - 0.75 * latitude
+    precipitation = 900.0 * np.exp(-usurf / 2000.0) * (1.0 - 0.3 * yy / Ly)
+
+    fields = {
+        "topg": (topg, "m", "bedrock_altitude"),
+        "thk": (thk, "m", "land_ice_thickness"),
+        "air_temp": (air_temp, "K", None),
+        "precipitation": (precipitation, "kg m-2 year-1", None),
+        "bheatflx": (np.zeros_like(xx) + 0.05, "W m-2", None),
+    }
+    write(filename, x, y, fields)
+
+
+def write(filename, x, y, fields):
+    nc = NC(filename, "w")
+
+    for name, values in [("x", x), ("y", y)]:
+        nc.createDimension(name, len(values))
+        var = nc.createVariable(name, "f8", (name,))
+        var.units = "m"
+        var.standard_name = "projection_{}_coordinate".format(name)
+        var[:] = values
+
+    for name, (values, units, standard_name) in fields.items():
+        var = nc.createVariable(name, "f8", ("y", "x"))
+        var.units = units
+        if standard_name:
+            var.standard_name = standard_name
+        var[:] = values
+
+    nc.close()
+
+
+def cases(pism_path, output, size):
+    "Returns the list of (name, command) pairs for a given size."
+    result = []
+
+    def grid(case):
+        Mx, My, Mz = SIZES[case][size]
+        return "-Mx {} -My {} -Mz {}".format(Mx, My, Mz)
+
+    result.append(("eismint2",
+                   "{}/pisms -eisII A -y 1e5 {}".format(pism_path, grid("eismint2"))))
+
+    for test in ["C", "G"]:
+        case = "pismv_" + test
+        result.append((case,
+                       "{}/pismv -test {} -y 1e5 {} -no_report".format(pism_path, test, grid(case))))
+
+    Mx, My, _ = SIZES["mismip+"][size]
+    mismip_input = os.path.join(output, "mismip+_{}.nc".format(size))
+    generate_mismip_plus(mismip_input, Mx, My)
+    result.append(("mismip+",
+                   "{}/pismr -bootstrap -i {} {} -Lz 1000 -y 1e4 "
+                   "-stress_balance ssa -ssa_method fd -ssa_flow_law isothermal_glen "
+                   "-pseudo_plastic -pseudo_plastic_q 0.333 -yield_stress constant "
+                   "-energy none -surface given -surface_given_file {} "
+                   "-ocean constant".format(pism_path, mismip_input, grid("mismip+"),
+                                            mismip_input)))
+
+    Mx, My, _ = SIZES["greenland"][size]
+    greenland_input = os.path.join(output, "greenland_{}.nc".format(size))
+    generate_greenland(greenland_input, Mx, My)
+    result.append(("greenland",
+                   "{}/pismr -bootstrap -i {} {} -Lz 4000 -Lbz 1000 -Mbz 11 -y 1e4 "
+                   "-stress_balance ssa+sia -energy enthalpy "
+                   "-atmosphere given -atmosphere_given_file {} -surface pdd "
+                   "-ocean constant".format(pism_path, greenland_input, grid("greenland"),
+                                            greenland_input)))
+
+    return result
+
+
+def run(opts):
+    os.makedirs(opts.output, exist_ok=True)
+
+    results = []
+    for size in opts.sizes:
+        for name, command in cases(opts.pism_path, opts.output, size):
+            if opts.cases and name not in opts.cases:
+                continue
+
+            prefix = os.path.join(opts.output, "{}_{}".format(name, size))
+            command = "{} -n {} {} -config {}/pism_config.nc -max_steps {} -verbose 1 " \
+                "-o {}.nc -profile_json {}.json {}".format(opts.mpiexec, opts.n, command,
+                                                           opts.pism_path, opts.steps,
+                                                           prefix, prefix, opts.pism_options)
+            print("Running {} ({})...".format(name, size))
+            print("  " + command)
+
+            start = time.time()
+            subprocess.run(shlex.split(command), check=True)
+            wall_clock = time.time() - start
+
+            with open(prefix + ".json") as f:
+                summary = json.load(f)
+
+            results.append({"case": name, "size": size, "ranks": opts.n, "steps": opts.steps,
+                            "options": opts.pism_options,
+                            "wall_clock": wall_clock, "events": summary["events"]})
+
+    with open(os.path.join(opts.output, "benchmarks.json"), "w") as f:
+        json.dump(results, f, indent=1)
+
+    return results
+
+
+def total_time(result):
+    "Time spent in the time-stepping loop."
+    return sum(e["max"] for e in result["events"] if e["path"] == "time_step")
+
+
+def compare(results, baseline_file, tolerance):
+    "Compare results to a baseline. Returns the number of cases that got slower."
+    with open(baseline_file) as f:
+        baseline = {(r["case"], r["size"], r["ranks"]): r for r in json.load(f)}
+
+    slower = 0
+    for r in results:
+        b = baseline.get((r["case"], r["size"], r["ranks"]))
+        if b is None:
+            continue
+
+        ratio = total_time(r) / max(total_time(b), 1e-16)
+        status = "OK"
+        if ratio > 1.0 + tolerance:
+            status = "SLOWER"
+            slower += 1
+        print("{:>12} {:>8}: {:8.3f} s vs {:8.3f} s ({:.2f}) {}".format(
+            r["case"], r["size"], total_time(r), total_time(b), ratio, status))
+
+    return slower
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--pism-path", dest="pism_path", required=True,
+                        help="directory containing PISM executables and pism_config.nc")
+    parser.add_argument("--mpiexec", default="mpiexec")
+    parser.add_argument("-n", type=int, default=1, help="number of MPI processes")
+    parser.add_argument("--output", default="benchmarks")
+    parser.add_argument("--sizes", nargs="+", default=["small", "medium"],
+                        choices=["small", "medium", "large"])
+    parser.add_argument("--cases", nargs="+", default=[], choices=sorted(SIZES.keys()))
+    parser.add_argument("--steps", type=int, default=STEPS,
+                        help="number of time steps in each run")
+    parser.add_argument("--pism-options", dest="pism_options", default="",
+                        help="options added to every PISM run")
+    parser.add_argument("--compare", default=None,
+                        help="benchmarks.json from an earlier run to compare to")
+    parser.add_argument("--tolerance", type=float, default=0.1,
+                        help="relative slow-down reported as a regression")
+    opts = parser.parse_args()
+
+    results = run(opts)
+
+    if opts.compare:
+        sys.exit(1 if compare(results, opts.compare, opts.tolerance) > 0 else 0)
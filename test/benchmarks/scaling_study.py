@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+"""Run a strong or weak scaling study of a PISM setup and report parallel efficiency.
+
+Runs a PISM command (or one of the cases in run_benchmarks.py) using each of the
+requested numbers of MPI processes (and, optionally, each of several domain
+decompositions), collects Profiling summaries (-profile_json), and computes the parallel
+efficiency of each component (Profiling event). Results are saved to
+OUTPUT/scaling.json, OUTPUT/scaling.txt and (if matplotlib is available) plotted.
+
+Strong scaling: the grid is fixed; efficiency(N) = T(N0) * N0 / (T(N) * N).
+Weak scaling: the number of grid points per process is fixed (Mx and My are scaled by
+sqrt(N / N0)); efficiency(N) = T(N0) / T(N).
+
+The component whose efficiency first drops below --threshold is reported as the one
+that limits scalability.
+
+Examples:
+
+  scaling_study.py --pism-path build --case greenland --size medium -n 1 2 4 8 16
+  scaling_study.py --pism-path build --command "pisms -eisII A -y 1e5" \\
+      --grid 61 61 31 --mode weak -n 1 4 16 --decompositions 2x2 4x1
+"""
+
+import argparse
+import json
+import math
+import os
+import shlex
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import run_benchmarks
+
+
+def parse_decomposition(text):
+    "Convert 'NxxNy' to a tuple (Nx, Ny)."
+    try:
+        Nx, Ny = [int(n) for n in text.lower().split("x")]
+    except ValueError:
+        raise argparse.ArgumentTypeError(
+            "invalid decomposition '{}' (use NxxNy, e.g. 4x2)".format(text))
+    return Nx, Ny
+
+
+def grid_size(grid, n, n0, mode):
+    "Grid size (Mx, My, Mz) to use with n processes."
+    Mx, My, Mz = grid
+    if mode == "weak":
+        factor = math.sqrt(float(n) / n0)
+        Mx = int(round((Mx - 1) * factor)) + 1
+        My = int(round((My - 1) * factor)) + 1
+    return Mx, My, Mz
+
+
+def base_command(opts):
+    "Returns the command (without mpiexec and grid options) and the base grid size."
+    if opts.command:
+        command = opts.command.split(None, 1)
+        command[0] = os.path.join(opts.pism_path, command[0])
+        return " ".join(command), opts.grid
+
+    os.makedirs(opts.output, exist_ok=True)
+    for name, command in run_benchmarks.cases(opts.pism_path, opts.output, opts.size):
+        if name == opts.case:
+            grid = opts.grid or run_benchmarks.SIZES[name][opts.size]
+            return command, grid
+
+    raise ValueError("unknown case: {}".format(opts.case))
+
+
+def runs(opts):
+    "Returns the list of (ranks, decomposition) pairs to run."
+    result = []
+    for n in opts.n:
+        decompositions = [d for d in opts.decompositions if d[0] * d[1] == n]
+        if decompositions:
+            result += [(n, d) for d in decompositions]
+        else:
+            # use PISM's default decomposition
+            result.append((n, None))
+    return result
+
+
+def run(opts):
+    os.makedirs(opts.output, exist_ok=True)
+
+    command, grid = base_command(opts)
+    n0 = min(opts.n)
+
+    results = []
+    for n, decomposition in runs(opts):
+        label = "{}".format(n) if decomposition is None else "{}x{}".format(*decomposition)
+        prefix = os.path.join(opts.output, "run_{}".format(label))
+
+        full_command = "{} -n {} {} -config {}/pism_config.nc -max_steps {} -verbose 1 " \
+            "-o {}.nc -profile_json {}.json".format(opts.mpiexec, n, command, opts.pism_path,
+                                                    opts.steps, prefix, prefix)
+        if grid:
+            Mx, My, Mz = grid_size(grid, n, n0, opts.mode)
+            full_command += " -Mx {} -My {} -Mz {}".format(Mx, My, Mz)
+        if decomposition:
+            full_command += " -Nx {} -Ny {}".format(*decomposition)
+
+        print("Running on {} processes ({})...".format(n, label))
+        print("  " + full_command)
+
+        start = time.time()
+        subprocess.run(shlex.split(full_command), check=True)
+        wall_clock = time.time() - start
+
+        with open(prefix + ".json") as f:
+            summary = json.load(f)
+
+        results.append({"ranks": n, "label": label, "wall_clock": wall_clock,
+                        "events": {e["path"]: e for e in summary["events"]}})
+
+    return results
+
+
+def components(results, depth):
+    "Names of events at most `depth` levels deep that are present in all runs."
+    names = None
+    for r in results:
+        events = {path for path in r["events"] if len(path.split("/")) <= depth}
+        names = events if names is None else names & events
+    return sorted(names or [])
+
+
+def efficiency(results, names, mode):
+    "Parallel efficiency of each component in each run, relative to the first run."
+    reference = results[0]
+    n0 = reference["ranks"]
+
+    table = {}
+    for name in names:
+        T0 = reference["events"][name]["max"]
+        row = []
+        for r in results:
+            T = r["events"][name]["max"]
+            if T <= 0.0:
+                row.append(float("nan"))
+            elif mode == "strong":
+                row.append(T0 * n0 / (T * r["ranks"]))
+            else:
+                row.append(T0 / T)
+        table[name] = row
+    return table
+
+
+def first_breakdown(table, threshold):
+    """The component whose efficiency drops below `threshold` first (at the smallest
+    number of processes, then the lowest efficiency). Returns (name, run index) or
+    None."""
+    worst = None
+    for name, row in table.items():
+        for k, E in enumerate(row):
+            if E < threshold:
+                key = (k, E)
+                if worst is None or key < worst[0]:
+                    worst = (key, name)
+                break
+
+    if worst is None:
+        return None
+    return worst[1], worst[0][0]
+
+
+def report(results, table, opts):
+    labels = [r["label"] for r in results]
+    width = max([len(name) for name in table] + [10])
+
+    lines = []
+    lines.append("{} scaling, efficiency relative to {} processes".format(opts.mode,
+                                                                          results[0]["ranks"]))
+    lines.append(" ".join(["{:<{}}".format("component", width)] +
+                          ["{:>8}".format(l) for l in labels]))
+    for name in sorted(table):
+        lines.append(" ".join(["{:<{}}".format(name, width)] +
+                              ["{:8.2f}".format(E) for E in table[name]]))
+
+    lines.append("")
+    lines.append(" ".join(["{:<{}}".format("time (s)", width)] +
+                          ["{:>8}".format(l) for l in labels]))
+    for name in sorted(table):
+        lines.append(" ".join(["{:<{}}".format(name, width)] +
+                              ["{:8.2f}".format(r["events"][name]["max"]) for r in results]))
+
+    breakdown = first_breakdown(table, opts.threshold)
+    lines.append("")
+    if breakdown:
+        name, k = breakdown
+        lines.append("'{}' is the first component to fall below {:.0f}% efficiency "
+                     "({:.0f}% with {} processes)".format(name, 100 * opts.threshold,
+                                                          100 * table[name][k],
+                                                          labels[k]))
+    else:
+        lines.append("All components stay above {:.0f}% efficiency".format(100 * opts.threshold))
+
+    text = "\n".join(lines)
+    print(text)
+
+    with open(os.path.join(opts.output, "scaling.txt"), "w") as f:
+        f.write(text + "\n")
+
+    with open(os.path.join(opts.output, "scaling.json"), "w") as f:
+        json.dump({"mode": opts.mode,
+                   "runs": results,
+                   "efficiency": table,
+                   "breakdown": breakdown[0] if breakdown else None}, f, indent=1)
+
+
+def plot(results, table, opts):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("matplotlib is not available: skipping plots")
+        return
+
+    ranks = [r["ranks"] for r in results]
+
+    fig, (ax_time, ax_efficiency) = plt.subplots(1, 2, figsize=(12, 5))
+    for name in sorted(table):
+        ax_time.loglog(ranks, [r["events"][name]["max"] for r in results], "o-", label=name)
+        ax_efficiency.semilogx(ranks, table[name], "o-", label=name)
+
+    ax_time.set_xlabel("MPI processes")
+    ax_time.set_ylabel("time, s")
+    ax_time.set_title("Time per component")
+
+    ax_efficiency.axhline(opts.threshold, color="gray", linestyle="--")
+    ax_efficiency.set_xlabel("MPI processes")
+    ax_efficiency.set_ylabel("parallel efficiency")
+    ax_efficiency.set_title("{} scaling".format(opts.mode.capitalize()))
+    ax_efficiency.legend(fontsize="small")
+
+    fig.tight_layout()
+    fig.savefig(os.path.join(opts.output, "scaling.png"))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--pism-path", dest="pism_path", required=True,
+                        help="directory containing PISM executables and pism_config.nc")
+    parser.add_argument("--mpiexec", default="mpiexec")
+    parser.add_argument("-n", type=int, nargs="+", required=True,
+                        help="numbers of MPI processes")
+    parser.add_argument("--decompositions", type=parse_decomposition, nargs="+", default=[],
+                        help="domain decompositions NxxNy to try (e.g. 4x1 2x2)")
+    parser.add_argument("--mode", choices=["strong", "weak"], default="strong")
+    parser.add_argument("--command", default=None,
+                        help="PISM command to run, relative to --pism-path (e.g. 'pismr -i in.nc')")
+    parser.add_argument("--case", default="greenland", choices=sorted(run_benchmarks.SIZES.keys()),
+                        help="benchmark case to use if --command is not set")
+    parser.add_argument("--size", default="small", choices=["small", "medium", "large"],
+                        help="size of the benchmark case")
+    parser.add_argument("--grid", type=int, nargs=3, default=None, metavar=("MX", "MY", "MZ"),
+                        help="grid size used with the smallest number of processes")
+    parser.add_argument("--steps", type=int, default=run_benchmarks.STEPS,
+                        help="number of time steps in each run")
+    parser.add_argument("--depth", type=int, default=2,
+                        help="nesting depth of Profiling events to report")
+    parser.add_argument("--threshold", type=float, default=0.7,
+                        help="efficiency below which a component is considered to not scale")
+    parser.add_argument("--output", default="scaling")
+    opts = parser.parse_args()
+    opts.n = sorted(set(opts.n))
+
+    if opts.mode == "weak" and opts.command and not opts.grid:
+        parser.error("weak scaling with --command requires --grid")
+
+    results = run(opts)
+    table = efficiency(results, components(results, opts.depth), opts.mode)
+
+    report(results, table, opts)
+    plot(results, table, opts)
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Track performance and accuracy of PISM using verification tests.
+
+Each selected pismv test runs for a fixed wall-clock budget
+(time_stepping.max_wall_clock_time) and writes its error report (-report_file). Results
+(throughput in grid points times time steps per second and error norms) are saved to
+OUTPUT/verification.json. Use --compare to check them against a baseline: a case fails
+if its throughput dropped or one of its errors grew by more than the tolerance.
+
+Note that errors depend on the number of time steps taken, so errors should be compared
+to a baseline obtained on the same machine with the same budget.
+"""
+
+import argparse
+import json
+import os
+import shlex
+import subprocess
+import sys
+
+from netCDF4 import Dataset as NC
+
+# Grid sizes (Mx, My, Mz) and run lengths (years) for each test.
+TESTS = {
+    "B": ((61, 61, 31), 25000),
+    "C": ((61, 61, 31), 15208),
+    "G": ((61, 61, 61), 25000),
+    "K": ((6, 6, 401), 130000),
+    "L": ((61, 61, 31), 25000),
+}
+
+# Variables in the -report_file that are not error norms.
+NOT_ERRORS = ["N", "dx", "dy", "dz", "test", "time_steps", "wall_clock_time", "throughput"]
+
+
+def read_report(filename):
+    "Read the last record of a pismv error report."
+    with NC(filename) as nc:
+        return {name: float(var[-1]) for name, var in nc.variables.items()
+                if name not in ["N", "test"]}
+
+
+def run(opts):
+    os.makedirs(opts.output, exist_ok=True)
+
+    results = []
+    for test in opts.tests:
+        (Mx, My, Mz), years = TESTS[test]
+
+        prefix = os.path.join(opts.output, "test_{}".format(test))
+        command = "{mpiexec} -n {n} {path}/pismv -config {path}/pism_config.nc " \
+            "-test {test} -Mx {Mx} -My {My} -Mz {Mz} -y {years} " \
+            "-max_wall_clock_time {budget} -verbose 1 " \
+            "-o {prefix}.nc -report_file {prefix}_report.nc".format(mpiexec=opts.mpiexec,
+                                                                    n=opts.n,
+                                                                    path=opts.pism_path,
+                                                                    test=test,
+                                                                    Mx=Mx, My=My, Mz=Mz,
+                                                                    years=years,
+                                                                    budget=opts.budget,
+                                                                    prefix=prefix)
+        print("Running test {}...".format(test))
+        print("  " + command)
+
+        # start a new report
+        if os.path.exists(prefix + "_report.nc"):
+            os.remove(prefix + "_report.nc")
+
+        subprocess.run(shlex.split(command), check=True)
+
+        report = read_report(prefix + "_report.nc")
+
+        results.append({"test": test, "ranks": opts.n, "budget": opts.budget,
+                        "grid": [Mx, My, Mz],
+                        "time_steps": report["time_steps"],
+                        "throughput": report["throughput"],
+                        "errors": {k: v for k, v in report.items() if k not in NOT_ERRORS}})
+
+    with open(os.path.join(opts.output, "verification.json"), "w") as f:
+        json.dump(results, f, indent=1)
+
+    return results
+
+
+def compare(results, baseline_file, tolerance, error_tolerance):
+    "Compare results to a baseline. Returns the number of regressions."
+    with open(baseline_file) as f:
+        baseline = {(r["test"], r["ranks"], tuple(r["grid"])): r for r in json.load(f)}
+
+    regressions = 0
+    for r in results:
+        b = baseline.get((r["test"], r["ranks"], tuple(r["grid"])))
+        if b is None:
+            print("{:>6}: no baseline".format(r["test"]))
+            continue
+
+        ratio = r["throughput"] / max(b["throughput"], 1e-16)
+        status = "OK"
+        if ratio < 1.0 - tolerance:
+            status = "SLOWER"
+            regressions += 1
+        print("test {}: throughput {:10.4g} vs {:10.4g} ({:.2f}) {}".format(
+            r["test"], r["throughput"], b["throughput"], ratio, status))
+
+        for name, value in sorted(r["errors"].items()):
+            old = b["errors"].get(name)
+            if old is None:
+                continue
+            # errors are compared in absolute value (some are signed)
+            if abs(value) > abs(old) * (1.0 + error_tolerance) + 1e-12:
+                print("  {:>30}: {:12.6g} vs {:12.6g} LESS ACCURATE".format(name, value, old))
+                regressions += 1
+
+    return regressions
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--pism-path", dest="pism_path", required=True,
+                        help="directory containing pismv and pism_config.nc")
+    parser.add_argument("--mpiexec", default="mpiexec")
+    parser.add_argument("-n", type=int, default=1, help="number of MPI processes")
+    parser.add_argument("--output", default="verification")
+    parser.add_argument("--tests", nargs="+", default=["C", "G"], choices=sorted(TESTS.keys()))
+    parser.add_argument("--budget", type=float, default=60.0,
+                        help="wall-clock time budget of each run, in seconds")
+    parser.add_argument("--compare", default=None,
+                        help="verification.json from an earlier run to compare to")
+    parser.add_argument("--tolerance", type=float, default=0.1,
+                        help="relative throughput drop reported as a regression")
+    parser.add_argument("--error-tolerance", dest="error_tolerance", type=float, default=0.05,
+                        help="relative error increase reported as a regression")
+    opts = parser.parse_args()
+
+    results = run(opts)
+
+    if opts.compare:
+        sys.exit(1 if compare(results, opts.compare, opts.tolerance, opts.error_tolerance) > 0 else 0)
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+"""Checks that checksums used by incremental checkpoints change when a field changes.
+
+Run using 2 MPI processes: a uniform field on a grid split into two equal sub-domains
+has equal local parts on both ranks.
+"""
+
+import os
+import PISM
+
+ctx = PISM.Context()
+ctx.log.set_threshold(0)
+
+def create_grid():
+    "Create a grid split into sub-domains of equal size (using an even number of ranks)"
+    params = PISM.GridParameters(ctx.config)
+    params.Mx = 20
+    params.My = 20
+    params.ownership_ranges_from_options(ctx.size)
+    return PISM.IceGrid(ctx.ctx, params)
+
+def checksum(grid, field, filename):
+    "Return the checksum of `field` computed while writing it to a checkpoint"
+    f = PISM.File(grid.com, filename, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+    try:
+        f.set_checkpoint("", PISM.StringMap())
+        field.define(f)
+        field.write(f)
+        return f.checksums()["data"]
+    finally:
+        f.close()
+
+def test_uniform_field():
+    "The checksum of a uniform field changes when the field changes"
+    grid = create_grid()
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+
+    filename = "test_checkpoint_checksums.nc"
+    try:
+        v.set(1.0)
+        a = checksum(grid, v, filename)
+
+        v.set(2.0)
+        b = checksum(grid, v, filename)
+
+        assert a != b, "checksum did not change: {} == {}".format(a, b)
+    finally:
+        if ctx.rank == 0:
+            for name in [filename, filename + "~"]:
+                if os.path.exists(name):
+                    os.remove(name)
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Compares ghosts updated using SharedMemoryHaloExchange (grid.node_aware_halo_exchange)
+to ghosts updated using DMLocalToLocal.
+
+Run using at least 4 MPI processes so that each sub-domain has neighbors in all 8
+directions, including corners. Ranks on the same node exchange ghosts through shared
+memory; run on several nodes to test messages to ranks on other nodes as well.
+"""
+
+import numpy as np
+import PISM
+
+ctx = PISM.Context()
+config = ctx.config
+
+# odd grid sizes make sub-domains differ in size
+Mx = 13
+My = 11
+Mz = 7
+width = 2
+
+def create_grid():
+    "Create a periodic grid"
+    params = PISM.GridParameters(config)
+    params.Lx = 1e5
+    params.Ly = 1e5
+    params.Mx = Mx
+    params.My = My
+    params.z = PISM.DoubleVector(np.linspace(0, 1000, Mz))
+    params.registration = PISM.CELL_CENTER
+    params.periodicity = PISM.XY_PERIODIC
+    params.ownership_ranges_from_options(ctx.size)
+    return PISM.IceGrid(ctx.ctx, params)
+
+def allocate(grid, node_aware, three_d):
+    "Allocate a ghosted field using the selected halo exchange implementation"
+    config.set_flag("grid.node_aware_halo_exchange", node_aware)
+    try:
+        if three_d:
+            return PISM.IceModelVec3(grid, "test", PISM.WITH_GHOSTS, width)
+        return PISM.IceModelVec2S(grid, "test", PISM.WITH_GHOSTS, width)
+    finally:
+        config.set_flag("grid.node_aware_halo_exchange", False)
+
+def value(i, j, k):
+    "Unique value at a grid point (periodic)"
+    return ((j % My) * Mx + (i % Mx)) * Mz + k + 1
+
+def fill(grid, field):
+    "Set values at owned points and invalidate ghosts"
+    with field.local_array() as a:
+        a[...] = -1.0
+
+    xs, ys = grid.xs(), grid.ys()
+    with field.local_array() as a:
+        for j in range(ys, ys + grid.ym()):
+            for i in range(xs, xs + grid.xm()):
+                if a.ndim == 3:
+                    a[j - ys + width, i - xs + width, :] = [value(i, j, k) for k in range(Mz)]
+                else:
+                    a[j - ys + width, i - xs + width] = value(i, j, 0)
+
+def expected(grid, three_d):
+    "Values at all points in the local (ghosted) array"
+    xs, ys = grid.xs(), grid.ys()
+    result = np.zeros((grid.ym() + 2 * width, grid.xm() + 2 * width, Mz))
+    for j in range(ys - width, ys + grid.ym() + width):
+        for i in range(xs - width, xs + grid.xm() + width):
+            result[j - ys + width, i - xs + width, :] = [value(i, j, k) for k in range(Mz)]
+    return result if three_d else result[:, :, 0]
+
+def compare(three_d):
+    grid = create_grid()
+
+    result = []
+    for node_aware in [False, True]:
+        field = allocate(grid, node_aware, three_d)
+        fill(grid, field)
+        field.update_ghosts()
+        with field.local_array(writable=False) as a:
+            result.append(a.copy())
+
+    local_to_local, shared_memory = result
+
+    np.testing.assert_array_equal(shared_memory, local_to_local)
+    np.testing.assert_array_equal(shared_memory, expected(grid, three_d))
+
+def test_2d():
+    "SharedMemoryHaloExchange: 2D fields, periodic grid"
+    compare(three_d=False)
+
+def test_3d():
+    "SharedMemoryHaloExchange: 3D fields (dof = Mz), periodic grid"
+    compare(three_d=True)
@@ -289,6 +289,172 @@ class ForcingInput(unittest.TestCase):
         # fourth month
         check(3)
 
+    def test_read_ahead(self):
+        "update() calls with input.forcing.read_ahead set"
+        config = ctx.config
+        read_ahead = config.get_flag("input.forcing.read_ahead")
+        config.set_flag("input.forcing.read_ahead", True)
+        try:
+            forcing = self.forcing(self.filename, buffer_size=3)
+        finally:
+            config.set_flag("input.forcing.read_ahead", read_ahead)
+
+        dt = 30 * 86400
+        for month in range(len(self.f)):
+            t = self.tb[month] * 86400 + 1
+            forcing.update(t, dt - 2)
+            forcing.interp(t)
+
+            compare(forcing, self.f[month])
+
+    def test_exact_averages(self):
+        "average() calls with input.forcing.exact_averages set"
+        config = ctx.config
+        exact = config.get_flag("input.forcing.exact_averages")
+        config.set_flag("input.forcing.exact_averages", True)
+        try:
+            forcing = self.forcing(self.filename)
+            periodic = self.forcing(self.filename, periodic=True)
+        finally:
+            config.set_flag("input.forcing.exact_averages", exact)
+
+        month = 30 * 86400.0
+
+        # three months and a half
+        forcing.update(0, 3.5 * month)
+        forcing.average(0, 3.5 * month)
+        compare(forcing, (numpy.sum(self.f[0:3]) + 0.5 * self.f[3]) / 3.5)
+
+        # two years and a month, starting in the middle of a month
+        t = 0.5 * month
+        dt = 25 * month
+        periodic.update(t, dt)
+        periodic.average(t, dt)
+        compare(periodic, (2 * numpy.sum(self.f) +
+                           0.5 * self.f[0] + 0.5 * self.f[1]) / 25.0)
+
+    def test_node_shared_cache(self):
+        "update() calls with input.forcing.node_shared_cache set"
+        config = ctx.config
+        node_shared_cache = config.get_flag("input.forcing.node_shared_cache")
+        config.set_flag("input.forcing.node_shared_cache", True)
+        try:
+            forcing = self.forcing(self.filename, buffer_size=3)
+        finally:
+            config.set_flag("input.forcing.node_shared_cache", node_shared_cache)
+
+        dt = 30 * 86400
+        for month in range(len(self.f)):
+            t = self.tb[month] * 86400 + 1
+            forcing.update(t, dt - 2)
+            forcing.interp(t)
+
+            compare(forcing, self.f[month])
+
+    def test_buffer_compression(self):
+        "update(), interp() and average() calls with compressed buffers"
+        config = ctx.config
+        compression = config.get_string("input.forcing.buffer_compression")
+
+        month = 30 * 86400.0
+
+        for method in ["float32", "int16"]:
+            for layout in [PISM.IceModelVec2T.POINT_MAJOR, PISM.IceModelVec2T.RECORD_MAJOR]:
+                config.set_string("input.forcing.buffer_compression", method)
+                try:
+                    forcing = self.forcing(self.filename, buffer_size=1)
+                finally:
+                    config.set_string("input.forcing.buffer_compression", compression)
+
+                forcing.set_layout(layout)
+
+                # a small buffer: update() discards records
+                for k in range(len(self.f)):
+                    t = k * month + 1
+                    forcing.update(t, month - 2)
+                    forcing.interp(t)
+                    compare(forcing, self.f[k])
+
+                    forcing.average(t, month - 2)
+                    compare(forcing, self.f[k])
+
+    def test_int16_non_finite(self):
+        "Records containing NaNs are not stored as 16-bit integers"
+        config = ctx.config
+        compression = config.get_string("input.forcing.buffer_compression")
+
+        filename = "non_finite.nc"
+        v = PISM.IceModelVec2S(self.grid, "v", PISM.WITHOUT_GHOSTS)
+        v.set(numpy.nan)
+        output = PISM.util.prepare_output(filename)
+        v.write(output)
+        output.close()
+
+        config.set_string("input.forcing.buffer_compression", "int16")
+        try:
+            forcing = self.forcing(filename)
+            forcing.update(0, 1)
+            assert 0, "stored NaNs as 16-bit integers"
+        except RuntimeError:
+            pass
+        finally:
+            config.set_string("input.forcing.buffer_compression", compression)
+            os.remove(filename)
+
+    def test_record_layout(self):
+        "Results do not depend on the storage order of buffered records"
+        config = ctx.config
+        exact = config.get_flag("input.forcing.exact_averages")
+
+        month = 30 * 86400.0
+        t = 0.5 * month
+        dt = 25 * month
+
+        def run(layout, exact_averages, periodic):
+            config.set_flag("input.forcing.exact_averages", exact_averages)
+            try:
+                forcing = self.forcing(self.filename, buffer_size=3, periodic=periodic)
+            finally:
+                config.set_flag("input.forcing.exact_averages", exact)
+
+            forcing.set_layout(layout)
+            assert forcing.layout() == layout
+
+            result = []
+
+            # update() with a small buffer discards records
+            for k in range(4):
+                if not periodic:
+                    forcing.update(k * month, 2 * month)
+                forcing.interp(k * month + 1)
+                result.append(forcing.numpy().copy())
+
+                forcing.average(k * month, 2 * month)
+                result.append(forcing.numpy().copy())
+
+            if periodic:
+                forcing.update(t, dt)
+                forcing.average(t, dt)
+                result.append(forcing.numpy().copy())
+
+            return result
+
+        for periodic in [False, True]:
+            for exact_averages in [False, True]:
+                A = run(PISM.IceModelVec2T.POINT_MAJOR, exact_averages, periodic)
+                B = run(PISM.IceModelVec2T.RECORD_MAJOR, exact_averages, periodic)
+
+                for a, b in zip(A, B):
+                    numpy.testing.assert_equal(a, b)
+
+        # init_interpolation() switches to the point-major storage
+        forcing = self.forcing(self.filename, periodic=True)
+        forcing.set_layout(PISM.IceModelVec2T.RECORD_MAJOR)
+        forcing.init_interpolation([0.0, month])
+        assert forcing.layout() == PISM.IceModelVec2T.POINT_MAJOR
+        with PISM.vec.Access(nocomm=forcing):
+            numpy.testing.assert_almost_equal(forcing.interp(0, 0), self.f[0:2])
+
     def test_max_timestep(self):
         "Maximum time step"
         forcing = self.forcing(self.filename, buffer_size=1)
@@ -137,6 +137,86 @@ def vec_access_test():
         pass
 
 
+def vec_local_array_test():
+    "Test zero-copy NumPy views of IceModelVec data"
+    grid = create_dummy_grid()
+
+    w = 2
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITH_GHOSTS, w)
+    v.set(1.0)
+    counter = v.get_state_counter()
+
+    with v.local_array() as a:
+        assert a.shape == (grid.ym() + 2 * w, grid.xm() + 2 * w)
+        a[w:-w, w:-w] = 2.0
+
+    assert v.get_state_counter() > counter
+
+    with PISM.vec.Access(nocomm=v):
+        for (i, j) in grid.points():
+            assert v[i, j] == 2.0
+
+    vel = PISM.IceModelVec2V(grid, "velocity", PISM.WITHOUT_GHOSTS)
+    vel.set(0.0)
+    with vel.local_array() as a:
+        a[:, :, 1] = 3.0
+
+    with PISM.vec.Access(nocomm=vel):
+        for (i, j) in grid.points():
+            assert vel[i, j].u == 0.0
+            assert vel[i, j].v == 3.0
+
+    T = PISM.IceModelVec3(grid, "temp", PISM.WITHOUT_GHOSTS)
+    T.set(250.0)
+    with T.local_array(writable=False) as a:
+        assert a.shape == (grid.ym(), grid.xm(), len(grid.z()))
+        assert np.all(a == 250.0)
+        assert not a.flags.writeable
+
+
+def functional_taylor_test():
+    "Test gradients of inversion functionals using directional derivatives"
+    grid = PISM.IceGrid_Shallow(PISM.Context().ctx, 1e5, 1e5, 0, 0, 21, 21,
+                                PISM.NOT_PERIODIC, PISM.CELL_CENTER)
+
+    steps = [1e-4, 5e-5, 2.5e-5]
+
+    def check(f, x, d, gradient):
+        # the fused implementation has to match the separate one
+        value = f.valueAt(x)
+        f.gradientAt(x, gradient)
+        g = gradient.numpy()
+
+        fused_value = f.valueAndGradientAt(x, gradient)
+        assert abs(fused_value - value) <= 1e-12 * abs(value)
+        assert np.allclose(gradient.numpy(), g, rtol=1e-12, atol=0)
+
+        # remainders of the first-order Taylor expansion have to decrease as h**2
+        r = PISM.taylor_test(f, x, d, steps)
+        for k in range(len(r) - 1):
+            assert 3.0 < r[k] / r[k + 1] < 5.0, r
+
+    x = PISM.vec.randVectorS(grid, 1.0, 1)
+    d = PISM.vec.randVectorS(grid, 1.0, 1)
+    g = PISM.IceModelVec2S(grid, "gradient", PISM.WITHOUT_GHOSTS)
+
+    check(PISM.IPTotalVariationFunctional2S(grid, 1.0, 1.2, 1e-4), x, d, g)
+    check(PISM.IP_H1NormFunctional2S(grid, 1.0, 1e8), x, d, g)
+
+    u_obs = PISM.vec.randVectorV(grid, 1.0, 1)
+    u = PISM.vec.randVectorV(grid, 0.1, 1)
+    v = PISM.vec.randVectorV(grid, 1.0, 1)
+    g = PISM.IceModelVec2V(grid, "gradient", PISM.WITHOUT_GHOSTS)
+
+    f = PISM.IPLogRatioFunctional(grid, u_obs, 1e-3)
+    f.normalize(1.0)
+    check(f, u, v, g)
+
+    f = PISM.IPLogRelativeFunctional(grid, u_obs, 1e-3)
+    f.normalize(1.0)
+    check(f, u, v, g)
+
+
 def create_modeldata_test():
     "Test creating the ModelData class"
     grid = create_dummy_grid()
@@ -386,6 +466,313 @@ def util_test():
     print(b.a, b["b"], "b" in b, b)
 
 
+def chunking_policy_test():
+    "Writing spatial variables using different chunking policies"
+    grid = create_dummy_grid()
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    v.set(1.0)
+
+    output_file = "test_chunking.nc"
+    try:
+        for policy in ["default", "decomposition", "tiles"]:
+            f = PISM.File(grid.com, output_file, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+            f.set_chunking(PISM.string_to_chunking(policy))
+            assert f.chunking() == PISM.string_to_chunking(policy)
+            v.write(f)
+            f.close()
+
+            w = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+            w.regrid(output_file, PISM.CRITICAL)
+            assert w.norm(PISM.PETSc.NormType.N1) == grid.Mx() * grid.My()
+    finally:
+        os.remove(output_file)
+
+    try:
+        PISM.string_to_chunking("invalid")
+        assert False, "failed to catch an invalid chunking policy"
+    except RuntimeError:
+        pass
+
+def significant_digits_test():
+    "Writing spatial variables keeping a given number of significant digits"
+    grid = create_dummy_grid()
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    v.set(np.pi)
+
+    output_file = "test_significant_digits.nc"
+    try:
+        for digits in [1, 3, 6]:
+            f = PISM.File(grid.com, output_file, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+            f.set_significant_digits("data", digits)
+            f.set_significant_digits("", 0)
+            assert f.significant_digits("data") == digits
+            assert f.significant_digits("other") == 0
+            v.define(f, PISM.PISM_DOUBLE)
+            v.write(f)
+            f.close()
+
+            w = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+            w.regrid(output_file, PISM.CRITICAL)
+
+            error = abs(w.max() - np.pi) / np.pi
+            assert error > 0.0
+            assert error < 10.0**(-digits), (digits, error)
+    finally:
+        os.remove(output_file)
+
+def output_type_test():
+    "Overriding output types of individual variables"
+    grid = create_dummy_grid()
+
+    assert PISM.string_to_type("float") == PISM.PISM_FLOAT
+    assert PISM.string_to_type("double") == PISM.PISM_DOUBLE
+    try:
+        PISM.string_to_type("quad")
+        assert False, "failed to catch an invalid type"
+    except RuntimeError:
+        pass
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    v.set(np.pi)
+
+    output_file = "test_output_type.nc"
+    try:
+        for default_type, override in [(PISM.PISM_FLOAT, PISM.PISM_DOUBLE),
+                                       (PISM.PISM_DOUBLE, PISM.PISM_FLOAT)]:
+            f = PISM.File(grid.com, output_file, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+            f.set_output_type("data", override)
+            assert f.output_type("data") == override
+            assert f.output_type("other") == PISM.PISM_NAT
+            v.define(f, default_type)
+            v.write(f)
+            f.close()
+
+            w = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+            w.regrid(output_file, PISM.CRITICAL)
+
+            error = abs(w.max() - np.pi)
+            if override == PISM.PISM_DOUBLE:
+                assert error == 0.0, error
+            else:
+                assert error > 0.0 and error < 1e-6, error
+    finally:
+        os.remove(output_file)
+
+def checkpoint_test():
+    "Writing and reading checkpoint files"
+    grid = create_dummy_grid()
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    with PISM.vec.Access(nocomm=[v]):
+        for (i, j) in grid.points():
+            v[i, j] = 100.0 * j + i
+
+    output_file = "test_checkpoint.nc"
+    data_file = output_file + ".data"
+    try:
+        # write twice to check that the data file is moved along with the NetCDF file
+        for k in range(2):
+            f = PISM.File(grid.com, output_file, PISM.PISM_CHECKPOINT, PISM.PISM_READWRITE_MOVE)
+            v.define(f)
+            v.write(f)
+            f.close()
+
+        assert os.path.exists(data_file)
+        assert os.path.exists(output_file + "~.data")
+
+        # a checkpoint is recognized when reading
+        f = PISM.File(grid.com, output_file, PISM.PISM_GUESS, PISM.PISM_READONLY)
+        assert f.backend() == PISM.PISM_CHECKPOINT
+        f.close()
+
+        w = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+        for method in ["read", "regrid"]:
+            w.set(0.0)
+            if method == "read":
+                w.read(output_file, 0)
+            else:
+                w.regrid(output_file, PISM.CRITICAL)
+
+            w.add(-1.0, v)
+            assert w.norm(PISM.PETSc.NormType.NORM_INFINITY) == 0.0
+    finally:
+        for name in [output_file, data_file, output_file + "~", output_file + "~.data"]:
+            if os.path.exists(name):
+                os.remove(name)
+
+def incremental_checkpoint_test():
+    "Incremental checkpoints refer to the base checkpoint for fields that did not change"
+    grid = create_dummy_grid()
+
+    a = PISM.IceModelVec2S(grid, "a", PISM.WITHOUT_GHOSTS)
+    b = PISM.IceModelVec2S(grid, "b", PISM.WITHOUT_GHOSTS)
+    with PISM.vec.Access(nocomm=[a, b]):
+        for (i, j) in grid.points():
+            a[i, j] = 100.0 * j + i
+            b[i, j] = i - j
+
+    base_file = "test_checkpoint_base.nc"
+    increment_file = "test_checkpoint_increment.nc"
+    try:
+        f = PISM.File(grid.com, base_file, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+        f.set_checkpoint("", PISM.StringMap())
+        for v in [a, b]:
+            v.define(f)
+            v.write(f)
+        checksums = f.checksums()
+        f.close()
+
+        assert set(checksums.keys()) == {"a", "b"}
+
+        # modify b only
+        b.shift(1.0)
+
+        f = PISM.File(grid.com, increment_file, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+        f.set_checkpoint(base_file, checksums)
+        for v in [a, b]:
+            v.define(f)
+            v.write(f)
+        f.close()
+
+        f = PISM.File(grid.com, increment_file, PISM.PISM_GUESS, PISM.PISM_READONLY)
+        assert f.read_text_attribute("a", "pism_checkpoint_base") == base_file
+        assert f.attribute_type("b", "pism_checkpoint_base") == PISM.PISM_NAT
+        f.close()
+
+        for method in ["read", "regrid"]:
+            for name, v in [("a", a), ("b", b)]:
+                w = PISM.IceModelVec2S(grid, name, PISM.WITHOUT_GHOSTS)
+                if method == "read":
+                    w.read(increment_file, 0)
+                else:
+                    w.regrid(increment_file, PISM.CRITICAL)
+
+                w.add(-1.0, v)
+                assert w.norm(PISM.PETSc.NormType.NORM_INFINITY) == 0.0
+    finally:
+        for name in [base_file, increment_file]:
+            if os.path.exists(name):
+                os.remove(name)
+
+def in_memory_file_test():
+    "Writing and reading in-memory files"
+    grid = create_dummy_grid()
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    with PISM.vec.Access(nocomm=[v]):
+        for (i, j) in grid.points():
+            v[i, j] = 100.0 * j + i
+
+    filename = "memory:test"
+
+    # the backend is chosen using the file name
+    f = PISM.File(grid.com, filename, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_CLOBBER)
+    assert f.backend() == PISM.PISM_IN_MEMORY
+    v.define(f)
+    v.write(f)
+    f.close()
+
+    assert not os.path.exists(filename)
+
+    w = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    w.read(filename, 0)
+    w.add(-1.0, v)
+    assert w.norm(PISM.PETSc.NormType.NORM_INFINITY) == 0.0
+
+    try:
+        PISM.File(grid.com, "memory:missing", PISM.PISM_GUESS, PISM.PISM_READONLY)
+        assert False, "opened an in-memory file that does not exist"
+    except RuntimeError:
+        pass
+
+def async_staged_write_test():
+    "Staged writes are completed before switching to define mode"
+    ctx = PISM.Context()
+    params = PISM.GridParameters(ctx.config)
+    # a field large enough to be staged (writes smaller than 64 KiB are not)
+    params.Mx = 101
+    params.My = 101
+    params.ownership_ranges_from_options(ctx.size)
+    grid = PISM.IceGrid(ctx.ctx, params)
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    with PISM.vec.Access(nocomm=[v]):
+        for (i, j) in grid.points():
+            v[i, j] = 100.0 * j + i
+
+    filename = "async_staged_write_test.nc"
+    try:
+        f = PISM.File(grid.com, filename, PISM.PISM_NETCDF3_ASYNC, PISM.PISM_READWRITE_MOVE)
+        v.define(f)
+        v.write(f)
+        # writing an attribute puts the file in define mode
+        f.write_attribute("PISM_GLOBAL", "comment", "written after a staged field")
+        f.close()
+
+        w = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+        w.read(filename, 0)
+        w.add(-1.0, v)
+        assert w.norm(PISM.PETSc.NormType.NORM_INFINITY) == 0.0
+    finally:
+        if os.path.exists(filename):
+            os.remove(filename)
+
+def decimation_test():
+    "Writing spatial variables using a coarser and cropped grid"
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, 41, 31,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    def f(x, y):
+        return 1000.0 + x + 2.0 * y
+
+    v = PISM.IceModelVec2S(grid, "data", PISM.WITHOUT_GHOSTS)
+    v.set_attrs("internal", "linear function", "m", "m", "", 0)
+    with PISM.vec.Access(nocomm=v):
+        for (i, j) in grid.points():
+            v[i, j] = f(grid.x(i), grid.y(j))
+
+    factor = 4
+    x = np.array(grid.x())
+    y = np.array(grid.y())
+
+    output_file = "test_decimation.nc"
+    try:
+        for method in [PISM.Decimation.AVERAGE, PISM.Decimation.SUBSAMPLE]:
+            d = PISM.Decimation(grid, factor, method, -5e4, 5e4, -1e6, 1e6)
+            coarse = d.grid()
+
+            # 21 points in the x direction, 31 in the y direction
+            assert coarse.Mx() == 5
+            assert coarse.My() == 7
+
+            i0 = np.argmin(abs(x + 5e4))
+            if method == PISM.Decimation.AVERAGE:
+                x0 = np.mean(x[i0:i0 + factor])
+                y0 = np.mean(y[0:factor])
+            else:
+                x0 = x[i0 + factor // 2]
+                y0 = y[factor // 2]
+            np.testing.assert_almost_equal(coarse.x(0), x0)
+            np.testing.assert_almost_equal(coarse.y(0), y0)
+            np.testing.assert_almost_equal(coarse.dx(), factor * grid.dx())
+
+            f_out = PISM.File(grid.com, output_file, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+            d.define(v.metadata(0), f_out, PISM.PISM_DOUBLE)
+            d.write(v, f_out)
+            f_out.close()
+
+            w = PISM.IceModelVec2S(coarse, "data", PISM.WITHOUT_GHOSTS)
+            w.regrid(output_file, PISM.CRITICAL)
+
+            # the function is linear, so block averages are equal to values at block centers
+            with PISM.vec.Access(nocomm=w):
+                for (i, j) in coarse.points():
+                    np.testing.assert_almost_equal(w[i, j], f(coarse.x(i), coarse.y(j)))
+    finally:
+        os.remove(output_file)
+
 def logging_test():
     "Test the PISM.logging module"
     grid = create_dummy_grid()
@@ -671,6 +1058,48 @@ def flowlaw_test():
         check_flow_law(factory, flow_law_name, EC, np.array(data))
 
 
+def flowlaw_lookup_table_test():
+    "Tabulated Paterson-Budd softness"
+    EC = ctx.enthalpy_converter
+
+    exact = PISM.FlowLawFactory("stress_balance.sia.", ctx.config, EC)
+
+    tabulated_config = PISM.DefaultConfig(ctx.com, "pism_config", "-config", ctx.unit_system)
+    tabulated_config.init_with_default(ctx.log)
+    tabulated_config.import_from(ctx.config)
+    tabulated_config.set_flag("flow_law.Paterson_Budd.lookup_table.enabled", True)
+    tabulated = PISM.FlowLawFactory("stress_balance.sia.", tabulated_config, EC)
+
+    p = EC.pressure(1000.0)
+    Tm = EC.melting_temperature(p)
+    for name in ["pb", "gpbld"]:
+        exact.set_default(name)
+        tabulated.set_default(name)
+        A = exact.create()
+        B = tabulated.create()
+        for T_pa in np.linspace(-60, 0, 1001):
+            for omega in [0.0, 0.005]:
+                if omega > 0 and T_pa < 0:
+                    continue
+                E = EC.enthalpy(Tm + T_pa, omega, p)
+                a = A.hardness(E, p)
+                b = B.hardness(E, p)
+                assert abs(a - b) / a < 1e-6
+
+
+def flowlaw_is_power_law_test():
+    "FlowLawIsPowerLaw()"
+    EC = ctx.enthalpy_converter
+
+    factory = PISM.FlowLawFactory("stress_balance.sia.", ctx.config, EC)
+
+    expected = {"gpbld": True, "pb": True, "isothermal_glen": True, "hooke": True,
+                "arr": True, "arrwarm": True, "gk": False}
+    for name, power_law in expected.items():
+        factory.set_default(name)
+        assert PISM.FlowLawIsPowerLaw(factory.create()) == power_law, name
+
+
 def ssa_trivial_test():
     "Test the SSA solver using a trivial setup."
 
@@ -801,6 +1230,50 @@ def regridding_test():
     os.remove("thk1.nc")
 
 
+def regridding_from_different_grids_test():
+    "Test 2D regridding from several files using the same target grid."
+    import os
+
+    ctx = PISM.Context().ctx
+
+    def create_grid(M):
+        return PISM.IceGrid_Shallow(ctx, 10, 10, 0, 0, M, M,
+                                    PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    # bilinear interpolation recovers a linear function exactly
+    def F(x, y):
+        return 100.0 + x + 2.0 * y
+
+    filenames = []
+    for M in [5, 7]:
+        input_grid = create_grid(M)
+        thk = PISM.model.createIceThicknessVec(input_grid)
+        x = input_grid.x()
+        y = input_grid.y()
+        with PISM.vec.Access(nocomm=[thk]):
+            for (i, j) in input_grid.points():
+                thk[i, j] = F(x[i], y[j])
+        filename = "thk_{}.nc".format(M)
+        thk.dump(filename)
+        filenames.append(filename)
+
+    grid = create_grid(11)
+    x = grid.x()
+    y = grid.y()
+    thk = PISM.model.createIceThicknessVec(grid)
+
+    # the second regridding from the first file re-uses an interpolation context
+    for filename in filenames + filenames:
+        thk.set(0.0)
+        thk.regrid(filename, critical=True)
+
+        with PISM.vec.Access(nocomm=[thk]):
+            for (i, j) in grid.points():
+                assert np.abs(thk[i, j] - F(x[i], y[j])) < 1e-9
+
+    for filename in filenames:
+        os.remove(filename)
+
 
 def interpolation_weights_test():
     "Test 2D interpolation weights."
@@ -1059,6 +1532,33 @@ def test_timeseries_linear_interpolation():
 
         assert ts(T) == f(T), (T, ts(T), f(T))
 
+def test_timeseries_cursor():
+    "Timeseries values do not depend on the order of requests"
+
+    ctx = PISM.Context()
+    ts = PISM.Timeseries(ctx.com, ctx.unit_system, "test", "time")
+
+    N = 10
+    t = np.arange(N + 1, dtype=np.float64)
+    for k in range(N):
+        ts.append(np.sin(t[k + 1]), t[k], t[k + 1])
+
+    # times outside of [t[0], t[-1]] and at interval end points are included
+    T = np.linspace(-1, N + 1, 97)
+    T = np.r_[T, t]
+
+    for use_bounds in [True, False]:
+        ts.set_use_bounds(use_bounds)
+
+        # increasing times; these use the cached interval
+        expected = [ts(x) for x in T]
+
+        # decreasing and shuffled times require binary search
+        assert [ts(x) for x in T[::-1]] == expected[::-1]
+
+        order = np.random.RandomState(0).permutation(len(T))
+        assert [ts(T[k]) for k in order] == [expected[k] for k in order]
+
 def test_trapezoid_integral():
     "Linear integration weights"
     x = [0.0, 0.5, 1.0, 2.0]
@@ -1165,6 +1665,253 @@ def checksum_test():
 
     assert old_checksum != v.checksum()
 
+def cell_type_index_lists_test():
+    "IceModelVec2CellType: index lists"
+    grid = PISM.testing.shallow_grid(Mx=11, My=11)
+
+    def cell_type(i, j):
+        if i < 3:
+            return PISM.MASK_GROUNDED
+        if i < 6:
+            return PISM.MASK_FLOATING
+        return PISM.MASK_ICE_FREE_OCEAN
+
+    mask = PISM.IceModelVec2CellType(grid, "mask", PISM.WITH_GHOSTS)
+    with PISM.vec.Access(nocomm=mask):
+        for (i, j) in grid.points():
+            mask[i, j] = cell_type(i, j)
+    mask.update_ghosts()
+    mask.inc_state_counter()
+
+    def points(list_type):
+        L = mask.index_list(list_type)
+        return sorted(zip(L.i, L.j))
+
+    expected = {PISM.IceModelVec2CellType.ICY : lambda i, j: i < 6,
+                PISM.IceModelVec2CellType.GROUNDED_ICE : lambda i, j: i < 3,
+                PISM.IceModelVec2CellType.FLOATING_ICE : lambda i, j: 3 <= i < 6,
+                # ghosts are periodic, so i == 0 is next to ice-free cells at i == Mx - 1
+                PISM.IceModelVec2CellType.ICE_MARGIN : lambda i, j: i in (0, 5),
+                PISM.IceModelVec2CellType.ICE_FREE : lambda i, j: i >= 6}
+
+    for list_type, f in expected.items():
+        assert points(list_type) == sorted((i, j) for (i, j) in grid.points() if f(i, j))
+
+    # lists are re-computed if the state counter changes
+    mask.set(PISM.MASK_ICE_FREE_BEDROCK)
+    assert len(points(PISM.IceModelVec2CellType.ICY)) == 0
+    assert len(points(PISM.IceModelVec2CellType.ICE_FREE)) == grid.xm() * grid.ym()
+
+def grounded_cell_fraction_test():
+    "compute_grounded_cell_fraction: fully grounded and fully floating cells"
+    grid = PISM.testing.shallow_grid(Mx=21, My=21)
+
+    config = ctx.config
+    ice_density = config.get_number("constants.ice.density")
+    ocean_density = config.get_number("constants.sea_water.density")
+    alpha = ice_density / ocean_density
+
+    sea_level = PISM.IceModelVec2S(grid, "sea_level", PISM.WITH_GHOSTS)
+    H = PISM.IceModelVec2S(grid, "thk", PISM.WITH_GHOSTS)
+    bed = PISM.IceModelVec2S(grid, "topg", PISM.WITH_GHOSTS)
+    result = PISM.IceModelVec2S(grid, "gcf", PISM.WITHOUT_GHOSTS)
+
+    # a bed sloping in the x direction and an ice thickness varying in the y direction,
+    # so that there are grounded, floating and partially grounded cells
+    sea_level.set(0.0)
+    with PISM.vec.Access(nocomm=[H, bed]):
+        for (i, j) in grid.points():
+            bed[i, j] = 100.0 - 50.0 * i
+            H[i, j] = 200.0 + 40.0 * j
+    H.update_ghosts()
+    bed.update_ghosts()
+
+    PISM.compute_grounded_cell_fraction(ice_density, ocean_density,
+                                        sea_level, H, bed, result)
+
+    def F(i, j):
+        return H[i, j] * alpha - (sea_level[i, j] - bed[i, j])
+
+    # The reference computation: split each cell into 8 triangles. (This is what
+    # compute_grounded_cell_fraction() used to do at every grid point.)
+    def reference(i, j):
+        f = {(a, b): F(i + a, j + b) for a in [-1, 0, 1] for b in [-1, 0, 1]}
+
+        o = f[0, 0]
+        sw = 0.25 * (f[-1, -1] + f[0, -1] + o + f[-1, 0])
+        se = 0.25 * (f[0, -1] + f[1, -1] + f[1, 0] + o)
+        ne = 0.25 * (o + f[1, 0] + f[1, 1] + f[0, 1])
+        nw = 0.25 * (f[-1, 0] + o + f[0, 1] + f[-1, 1])
+        s = 0.5 * (o + f[0, -1])
+        e = 0.5 * (o + f[1, 0])
+        n = 0.5 * (o + f[0, 1])
+        w = 0.5 * (o + f[-1, 0])
+
+        gaf = PISM.grounded_area_fraction
+        fraction = 0.125 * (gaf(o, ne, n) + gaf(o, n, nw) + gaf(o, nw, w) + gaf(o, w, sw) +
+                            gaf(o, sw, s) + gaf(o, s, se) + gaf(o, se, e) + gaf(o, e, ne))
+
+        return min(max(fraction, 0.0), 1.0)
+
+    n_partial = 0
+    with PISM.vec.Access(nocomm=[sea_level, H, bed, result]):
+        for (i, j) in grid.points():
+            # results have to be bit-for-bit identical
+            assert result[i, j] == reference(i, j), (i, j, result[i, j], reference(i, j))
+            if 0.0 < result[i, j] < 1.0:
+                n_partial += 1
+
+    assert PISM.GlobalSum(ctx.com, n_partial) > 0
+
+def implicit_sia_test():
+    "GeometryEvolution: the implicit SIA step is stable and conserves mass"
+    grid = PISM.testing.shallow_grid(Mx=31, My=31, Lx=100e3, Ly=100e3)
+
+    config = ctx.config
+    implicit_sia = config.get_flag("geometry.update.implicit_sia")
+    config.set_flag("geometry.update.implicit_sia", True)
+    options = PISM.PETSc.Options()
+    options.setValue("-geometry_implicit_ksp_rtol", 1e-12)
+    try:
+        ge = PISM.GeometryEvolution(grid)
+    finally:
+        config.set_flag("geometry.update.implicit_sia", implicit_sia)
+        options.delValue("-geometry_implicit_ksp_rtol")
+
+    geometry = PISM.Geometry(grid)
+    geometry.latitude.set(0.0)
+    geometry.longitude.set(0.0)
+    geometry.bed_elevation.set(0.0)
+    geometry.sea_level_elevation.set(-1000.0)
+    geometry.ice_area_specific_volume.set(0.0)
+
+    # a dome in the middle of the domain
+    H = geometry.ice_thickness
+    R = 0.5 * grid.Lx()
+    with PISM.vec.Access(nocomm=H):
+        for (i, j) in grid.points():
+            r = PISM.radius(grid, i, j)
+            H[i, j] = 1000.0 * max(1.0 - (r / R)**2, 0.0)
+    H.update_ghosts()
+    geometry.ensure_consistency(0.0)
+
+    v = PISM.IceModelVec2V(grid, "velocity", PISM.WITHOUT_GHOSTS)
+    Q = PISM.IceModelVec2Stag(grid, "Q", PISM.WITHOUT_GHOSTS)
+    D = PISM.IceModelVec2Stag(grid, "D", PISM.WITHOUT_GHOSTS)
+    v_bc_mask = PISM.IceModelVec2Int(grid, "v_bc_mask", PISM.WITHOUT_GHOSTS)
+    H_bc_mask = PISM.IceModelVec2Int(grid, "H_bc_mask", PISM.WITHOUT_GHOSTS)
+
+    v.set(0.0)
+    Q.set(0.0)
+    v_bc_mask.set(0.0)
+    H_bc_mask.set(0.0)
+
+    D0 = 10.0                   # m2 / s
+    D.set(D0)
+
+    # 100 times the explicit (diffusivity-based) time step restriction
+    dt = 100 * 0.5 / (D0 * (1.0 / grid.dx()**2 + 1.0 / grid.dy()**2))
+
+    ge.flow_step(geometry, dt, v, Q, v_bc_mask, H_bc_mask, D)
+
+    dH = ge.thickness_change_due_to_flow()
+
+    # no flux through domain boundaries and no negative thickness: the volume is conserved
+    assert abs(dH.sum()) < 1e-10 * H.sum()
+
+    # the discrete maximum principle holds
+    H_max = H.max()
+    with PISM.vec.Access(nocomm=[H, dH]):
+        for (i, j) in grid.points():
+            H_new = H[i, j] + dH[i, j]
+            assert H_new >= 0.0 and H_new <= H_max, (i, j, H_new)
+
+def calendar_test():
+    "Time_Calendar: dates, year fractions and year starts"
+    config = PISM.DefaultConfig(ctx.com, "pism_config", "-config", ctx.unit_system)
+    config.init_with_default(ctx.log)
+    config.set_string("time.reference_date", "2000-1-1")
+
+    time = PISM.Time_Calendar(ctx.com, config, "gregorian", ctx.unit_system)
+
+    day = 86400.0
+    year_2000 = 366 * day       # a leap year
+    year_2001 = 365 * day
+
+    time.set_start(0.0)
+    time.set_end(10 * year_2000)
+
+    assert time.date(0.0) == "2000-01-01"
+    assert time.date(31 * day) == "2000-02-01"
+    assert time.date(31 * day - 0.5 * day) == "2000-01-31"
+    assert time.date(year_2000 + 59 * day) == "2001-03-01"
+
+    # times close to boundaries of months and days
+    assert time.date(31 * day - 1e-6) == "2000-01-31"
+    assert time.date(year_2000 - 1e-6) == "2000-12-31"
+
+    assert time.year_fraction(0.5 * year_2000) == 0.5
+    assert time.year_fraction(year_2000 + 0.25 * year_2001) == 0.25
+
+    assert time.calendar_year_start(400 * day) == year_2000
+    assert time.increment_date(0.0, 2) == year_2000 + year_2001
+    assert time.increment_date(year_2000, -1) == 0.0
+
+    # times outside of the run
+    assert time.date(-1 * day) == "1999-12-31"
+    assert time.calendar_year_start(100 * year_2000) == time.increment_date(0.0, 100)
+
+class SetIceThickness(TestCase):
+    "IceModel::set_ice_thickness() (used by nested coupling) updates the cell type mask"
+    def setUp(self):
+        # store current configuration parameters
+        self.config = PISM.DefaultConfig(ctx.com, "pism_config", "-config", ctx.unit_system)
+        self.config.init_with_default(ctx.log)
+        self.config.import_from(ctx.config)
+
+        self.filename = "set-ice-thickness-input.nc"
+
+        self.grid = create_dummy_grid()
+
+        # an ice-free bootstrapping file with bed above sea level
+        output = PISM.util.prepare_output(self.filename)
+        for name, units, value in [("topg", "m", 100.0),
+                                   ("thk", "m", 0.0),
+                                   ("climatic_mass_balance", "kg m-2 s-1", 0.0),
+                                   ("ice_surface_temp", "K", 260.0)]:
+            v = PISM.IceModelVec2S(self.grid, name, PISM.WITHOUT_GHOSTS)
+            v.metadata().set_string("units", units)
+            v.set(value)
+            v.write(output)
+        output.close()
+
+        ctx.config.set_string("input.file", self.filename)
+        ctx.config.set_flag("input.bootstrap", True)
+        ctx.config.set_string("surface.models", "given")
+
+    def test_cell_type(self):
+        "IceModel::set_ice_thickness() updates the cell type"
+        model = PISM.IceModel(self.grid, ctx.ctx)
+        model.init()
+
+        geometry = model.geometry()
+        assert PISM.testing.sample(geometry.cell_type) == PISM.MASK_ICE_FREE_BEDROCK
+
+        H = PISM.IceModelVec2S(self.grid, "thk", PISM.WITHOUT_GHOSTS)
+        H.set(1000.0)
+        mask = PISM.IceModelVec2Int(self.grid, "mask", PISM.WITHOUT_GHOSTS)
+        mask.set(1)
+
+        model.set_ice_thickness(H, mask)
+
+        assert PISM.testing.sample(geometry.cell_type) == PISM.MASK_GROUNDED
+
+    def tearDown(self):
+        # reset configuration parameters
+        ctx.config.import_from(self.config)
+
+        os.remove(self.filename)
+
 class ForcingOptions(TestCase):
     def setUp(self):
         # store current configuration parameters
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+
+"""Compares the distributed (FFTW-MPI) version of the Lingle-Clark bed deformation model
+to the serial one (LingleClarkSerial), which is used as the reference.
+"""
+
+import numpy as np
+import PISM
+from PISM.util import convert
+
+ctx = PISM.Context()
+config = ctx.config
+
+# silence models' initialization messages
+ctx.log.set_threshold(1)
+
+def run(parallel, dt, N=3):
+    "Bootstrap the model and take N steps using a disc load."
+    config.set_flag("bed_deformation.lc.parallel_fft", parallel)
+    config.set_flag("bed_deformation.lc.elastic_model", True)
+    config.set_number("bed_deformation.lc.grid_size_factor", 2)
+
+    L = convert(1000, "km", "m")
+    M = 31
+
+    grid = PISM.IceGrid.Shallow(ctx.ctx, L, L, 0, 0, M, M,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    model = PISM.LingleClark(grid)
+
+    H = PISM.IceModelVec2S(grid, "thk", PISM.WITHOUT_GHOSTS)
+    bed = PISM.IceModelVec2S(grid, "topg", PISM.WITHOUT_GHOSTS)
+    uplift = PISM.IceModelVec2S(grid, "uplift", PISM.WITHOUT_GHOSTS)
+    sea_level = PISM.IceModelVec2S(grid, "sea_level", PISM.WITHOUT_GHOSTS)
+
+    bed.set(0.0)
+    sea_level.set(-1000.0)
+
+    # use a non-trivial uplift field to exercise bootstrapping
+    with PISM.vec.Access(nocomm=[H, uplift]):
+        for (i, j) in grid.points():
+            r = PISM.radius(grid, i, j)
+            H[i, j] = 1000.0 if r <= 0.5 * L else 0.0
+            uplift[i, j] = convert(-1.0, "mm / year", "m / s") * np.exp(-(r / L)**2)
+
+    model.bootstrap(bed, uplift, H, sea_level)
+
+    for k in range(N):
+        model.step(H, sea_level, dt)
+
+    return (model.viscous_displacement().numpy(),
+            model.elastic_displacement().numpy(),
+            model.total_displacement().numpy())
+
+def compare(dt):
+    serial = run(False, dt)
+    parallel = run(True, dt)
+
+    for a, b in zip(serial, parallel):
+        assert np.max(np.fabs(a - b)) < 1e-8 * max(1.0, np.max(np.fabs(a)))
+
+def test_viscous_and_elastic():
+    "Distributed and serial Lingle-Clark models: time steps"
+    compare(convert(100, "years", "seconds"))
+
+def test_elastic_only():
+    "Distributed and serial Lingle-Clark models: elastic response (dt == 0)"
+    compare(0.0)
@@ -200,6 +200,46 @@ def steady_state_test():
     return np.testing.assert_almost_equal(diff, stored)
 
 
+def coarse_earth_grid_test():
+    "Steady state bed deformation computed on a coarser grid (disc load)"
+    N = 41
+
+    _, z_fine = modeled_steady_state(disc_radius, disc_thickness, T, Lx, N)
+
+    config.set_number("bed_deformation.lc.coarsening_factor", 2)
+    try:
+        _, z_coarse = modeled_steady_state(disc_radius, disc_thickness, T, Lx, N)
+    finally:
+        config.set_number("bed_deformation.lc.coarsening_factor", 1)
+
+    # the viscous response is smooth, so the coarser grid should not change it much
+    assert np.max(np.fabs(z_coarse - z_fine)) < 0.05 * np.max(np.fabs(z_fine))
+
+
+def exponential_integrator_test():
+    "Time dependent bed deformation using the exponential integrator (disc load)"
+    N = 34
+
+    config.set_string("bed_deformation.lc.time_stepping", "exponential")
+    try:
+        # the exponential integrator is exact for a load that is constant in time, so one
+        # long step should be equivalent to many short ones
+        _, z_one_step = modeled_time_dependent(disc_radius, disc_thickness, t_final, Lx, N,
+                                               t_final)
+        _, z_many_steps = modeled_time_dependent(disc_radius, disc_thickness, t_final, Lx, N,
+                                                 dt)
+    finally:
+        config.set_string("bed_deformation.lc.time_stepping", "crank_nicolson")
+
+    np.testing.assert_allclose(z_one_step, z_many_steps, atol=1e-6)
+
+    # results should be close to the ones computed using Crank-Nicolson and short steps
+    _, z_crank_nicolson = modeled_time_dependent(disc_radius, disc_thickness, t_final, Lx, N,
+                                                 dt)
+
+    assert np.max(np.fabs(z_one_step - z_crank_nicolson)) < 0.5
+
+
 def verify_steady_state():
     "Set up a grid refinement study and produce convergence plots."
 
@@ -168,6 +168,17 @@ class DischargeRoutingTest(TestCase):
 
         assert model.max_timestep(0).infinite()
 
+        # cached melt rates are re-computed when inputs change
+        T = 2.0 * self.potential_temperature
+        self.theta.set(T)
+        model.initialize(self.theta)
+
+        model.update(self.inputs, 1, 1)
+
+        melt_rate = self.frontal_melt(self.depth, self.water_flux, T) / seconds_per_day
+
+        check_model(model, melt_rate)
+
     def tearDown(self):
         pass
 
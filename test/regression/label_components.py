@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+
+"""Tests of the distributed connected component labeling code (label_components).
+
+The results are compared to a simple serial reference implementation. Run the tests
+using several MPI processes to exercise label merging across subdomain boundaries.
+"""
+
+import numpy as np
+import PISM
+
+ctx = PISM.Context()
+
+Mx = 41
+My = 31
+
+grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, Mx, My,
+                            PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+def input_mask():
+    "A random mask containing 0 (background), 1, and 2 (grounded)."
+    state = np.random.RandomState(0)
+    foreground = state.uniform(size=(My, Mx)) > 0.4
+    grounded = state.uniform(size=(My, Mx)) > 0.97
+
+    return foreground * (1.0 + grounded)
+
+def reference_labels(mask):
+    "Label 4-connected components of a mask (serial, breadth-first search)."
+    labels = np.zeros(mask.shape, dtype=int)
+    n_components = 0
+    for j in range(My):
+        for i in range(Mx):
+            if mask[j, i] > 0 and labels[j, i] == 0:
+                n_components += 1
+                labels[j, i] = n_components
+                queue = [(j, i)]
+                while queue:
+                    r, c = queue.pop()
+                    for rr, cc in [(r - 1, c), (r + 1, c), (r, c - 1), (r, c + 1)]:
+                        if (0 <= rr < My and 0 <= cc < Mx and
+                                mask[rr, cc] > 0 and labels[rr, cc] == 0):
+                            labels[rr, cc] = n_components
+                            queue.append((rr, cc))
+    return labels, n_components
+
+def run(identify_icebergs):
+    data = input_mask()
+
+    mask = PISM.IceModelVec2Int(grid, "mask", PISM.WITHOUT_GHOSTS)
+    with PISM.vec.Access(nocomm=mask):
+        for (i, j) in grid.points():
+            mask[i, j] = data[j, i]
+
+    PISM.label_components(mask, identify_icebergs, 2.0)
+
+    return data, mask
+
+def test_labels():
+    "label_components: labeling connected components"
+    data, mask = run(False)
+
+    labels, n_components = reference_labels(data)
+
+    # labels are consecutive
+    assert mask.range().max == n_components
+
+    # each component gets exactly one label
+    mapping = {}
+    with PISM.vec.Access(nocomm=mask):
+        for (i, j) in grid.points():
+            if data[j, i] > 0:
+                L = int(mask[i, j])
+                assert mapping.setdefault(labels[j, i], L) == L
+            else:
+                assert mask[i, j] == data[j, i]
+
+    assert len(set(mapping.values())) == len(mapping)
+
+def test_icebergs():
+    "label_components: identifying icebergs"
+    data, mask = run(True)
+
+    labels, n_components = reference_labels(data)
+
+    grounded = set(labels[data == 2.0])
+
+    with PISM.vec.Access(nocomm=mask):
+        for (i, j) in grid.points():
+            if data[j, i] > 0:
+                expected = 0.0 if labels[j, i] in grounded else 1.0
+                assert mask[i, j] == expected
+            else:
+                assert mask[i, j] == 0.0
@@ -196,6 +196,32 @@ class GivenTHTest(TestCase):
 
         check_model(model, self.temperature, self.mass_flux, self.melange_back_pressure)
 
+    def test_ocean_th_batch(self):
+        "Model GivenTH: batched and point-wise computations are the same"
+
+        c = PISM.OceanGivenTHConstants(config)
+
+        # cover melt, freeze-on and diffusion-only cases as well as ice-free points and
+        # salinity values outside of [4, 40]
+        S, Theta, H = [], [], []
+        for salinity in [2.0, 20.0, 35.0, 45.0]:
+            for theta in np.linspace(-3.0, 3.0, 13):
+                for thickness in [0.0, 1.0, 10.0, 100.0, 1000.0, 3000.0]:
+                    S.append(salinity)
+                    Theta.append(theta)
+                    H.append(thickness)
+
+        T_batch = PISM.DoubleVector()
+        M_batch = PISM.DoubleVector()
+        PISM.OceanGivenTH.batch_update(c, PISM.DoubleVector(S), PISM.DoubleVector(Theta),
+                                       PISM.DoubleVector(H), T_batch, M_batch)
+
+        for k in range(len(S)):
+            T, M = PISM.OceanGivenTH.pointwise_update(c, S[k], Theta[k], H[k])
+
+            assert T_batch[k] == T
+            assert M_batch[k] == M
+
     def tearDown(self):
         os.remove(self.filename)
 
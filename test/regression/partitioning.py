@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+
+"""Tests of the weighted domain decomposition code.
+
+Run the tests using several MPI processes (at least 2) to check that the ice-weighted
+partitioning reduces the load imbalance.
+"""
+
+import PISM
+
+ctx = PISM.Context()
+
+def test_even_weights():
+    "weighted_ownership_ranges: equal weights"
+    weights = [1.0] * 10
+
+    assert list(PISM.weighted_ownership_ranges(weights, 1)) == [10]
+    assert list(PISM.weighted_ownership_ranges(weights, 2)) == [5, 5]
+    assert sum(PISM.weighted_ownership_ranges(weights, 3)) == 10
+
+def test_weighted():
+    "weighted_ownership_ranges: points in the middle are more expensive"
+    weights = [1.0] * 40 + [11.0] * 20 + [1.0] * 40
+
+    assert list(PISM.weighted_ownership_ranges(weights, 4)) == [43, 7, 7, 43]
+
+def test_min_size():
+    "weighted_ownership_ranges: minimum part size"
+    weights = [1.0] * 10 + [100.0] * 10
+
+    result = PISM.weighted_ownership_ranges(weights, 10, 2)
+
+    assert min(result) == 2
+    assert sum(result) == 20
+
+def test_too_many_parts():
+    "weighted_ownership_ranges: invalid arguments"
+    try:
+        PISM.weighted_ownership_ranges([1.0] * 5, 3, 2)
+        assert False, "failed to catch an error"
+    except RuntimeError:
+        pass
+
+def test_weighted_grid():
+    "weighted_grid: re-partitioning reduces the load imbalance"
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, 101, 101,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    def cost(grid):
+        thickness = PISM.IceModelVec2S(grid, "thk", PISM.WITHOUT_GHOSTS)
+        with PISM.vec.Access(nocomm=thickness):
+            for (i, j) in grid.points():
+                thickness[i, j] = 1000.0 if 30 <= i < 50 and 30 <= j < 50 else 0.0
+
+        result = PISM.IceModelVec2S(grid, "cost", PISM.WITHOUT_GHOSTS)
+        PISM.column_cost(thickness, 10.0, result)
+        return result
+
+    old_cost = cost(grid)
+    new_grid = PISM.weighted_grid(grid, old_cost)
+
+    assert new_grid.Mx() == grid.Mx()
+    assert new_grid.My() == grid.My()
+
+    before = PISM.load_imbalance(old_cost)
+    after = PISM.load_imbalance(cost(new_grid))
+
+    assert after <= before + 1e-12
+
+    if ctx.size > 1:
+        # all the ice is on one process before re-partitioning
+        assert after < before
+
+def test_migrate():
+    "migrate: copying a field to a grid with a different decomposition"
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, 51, 41,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    def f(i, j):
+        return i + 100.0 * j
+
+    cost = PISM.IceModelVec2S(grid, "cost", PISM.WITHOUT_GHOSTS)
+    with PISM.vec.Access(nocomm=cost):
+        for (i, j) in grid.points():
+            # non-uniform in both directions so that the decomposition changes
+            # regardless of how processes are arranged
+            cost[i, j] = 1.0 + 10.0 * (i < 10) + 10.0 * (j < 10)
+
+    new_grid = PISM.weighted_grid(grid, cost)
+
+    if ctx.size > 1:
+        changed = (new_grid.xs(), new_grid.xm(), new_grid.ys(), new_grid.ym()) != \
+            (grid.xs(), grid.xm(), grid.ys(), grid.ym())
+        assert PISM.GlobalMax(grid.com, 1.0 if changed else 0.0) > 0.0, \
+            "the decomposition did not change: nothing to migrate"
+
+    source = PISM.IceModelVec2V(grid, "velocity", PISM.WITH_GHOSTS)
+    with PISM.vec.Access(nocomm=source):
+        for (i, j) in grid.points():
+            source[i, j].u = f(i, j)
+            source[i, j].v = -f(i, j)
+
+    destination = PISM.IceModelVec2V(new_grid, "velocity", PISM.WITH_GHOSTS)
+    PISM.migrate(source, destination)
+
+    with PISM.vec.Access(nocomm=destination):
+        for (i, j) in new_grid.points():
+            assert destination[i, j].u == f(i, j)
+            assert destination[i, j].v == -f(i, j)
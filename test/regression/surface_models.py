@@ -414,6 +414,42 @@ class TemperatureIndex2(TestCase):
         check_model(model, T=self.T, SMB=self.SMB, omega=0.0, mass=0.0, thickness=0.0,
                     melt=40, runoff=16)
 
+class TemperatureIndexTabulated(TestCase):
+    def setUp(self):
+        self.air_temp = config.get_number("atmosphere.uniform.temperature")
+
+        self.grid = shallow_grid()
+
+        self.geometry = PISM.Geometry(self.grid)
+        # make sure that there's ice to melt
+        self.geometry.ice_thickness.set(1000.0)
+
+        # close to the melting point, so that daily variability matters
+        config.set_number("atmosphere.uniform.temperature", 273.15 - 1.0)
+
+    def tearDown(self):
+        config.set_number("atmosphere.uniform.temperature", self.air_temp)
+        config.set_number("surface.pdd.tabulated_integrand_error", 0.0)
+
+    def melt(self, max_error):
+        config.set_number("surface.pdd.tabulated_integrand_error", max_error)
+
+        model = PISM.SurfaceTemperatureIndex(self.grid, PISM.AtmosphereUniform(self.grid))
+
+        model.init(self.geometry)
+
+        model.update(self.geometry, 0, 30 * 86400)
+
+        return sample(model.melt())
+
+    def test_surface_pdd_tabulated(self):
+        "Model 'pdd' with the tabulated PDD integrand"
+        exact = self.melt(0.0)
+        tabulated = self.melt(1e-6)
+
+        assert exact > 0.0
+        np.testing.assert_allclose(tabulated, exact, rtol=1e-5)
+
 class PIK(TestCase):
     def setUp(self):
         self.filename = "surface_pik_input.nc"
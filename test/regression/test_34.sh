@@ -0,0 +1,29 @@
+#!/bin/bash
+
+echo "Test #34: restricted halo exchange of enthalpy and age (moving margin)."
+PISM_PATH=$1
+MPIEXEC=$2
+
+files="foo-34.nc bar-34.nc"
+
+rm -f $files
+
+set -e -x
+
+# pisms starts with no ice, so the margin advances during the whole run. Use 4
+# sub-domains so that every rank has neighbors in both directions (including corners).
+OPTS="-Mx 31 -My 31 -Mz 41 -Lz 5000 -y 3000 -max_dt 50 -energy enthalpy -age -o_size small"
+
+$MPIEXEC -n 4 $PISM_PATH/pisms $OPTS -o foo-34.nc
+$MPIEXEC -n 4 $PISM_PATH/pisms $OPTS -grid.restrict_3d_halo_exchange -o bar-34.nc
+
+set +e
+
+# Results have to be identical:
+$PISM_PATH/nccmp.py -v age,enthalpy,thk foo-34.nc bar-34.nc
+if [ $? != 0 ];
+then
+    exit 1
+fi
+
+rm -f $files; exit 0
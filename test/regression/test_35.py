@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Compares implicit and explicit time stepping in hydrology::Distributed.
+
+Runs the setup of test #29 twice, once with each method, checks that the SNES solver
+used by the implicit method converged at every sub-step, and compares water thickness
+and pressure at the end of the run.
+"""
+
+import subprocess
+import shlex
+import os
+from sys import exit
+from netCDF4 import Dataset as NC
+import numpy as np
+
+from test_29 import process_arguments, copy_input, generate_config
+
+# maximum difference between implicit and explicit results, relative to the maximum
+# value of the explicit result
+tolerance = 0.05
+
+
+def run_pism(opts, method, output):
+    cmd = "%s -n 2 %s/pismr -config_override testPconfig.nc -i inputforP_regression.nc -bootstrap -Mx 21 -My 21 -Mz 11 -Lz 4000 -hydrology distributed -hydrology_distributed_time_stepping %s -hydrology_snes_converged_reason -y 0.08333333333333 -max_dt 0.01 -no_mass -energy none -stress_balance ssa+sia -ssa_dirichlet_bc -o %s" % (
+        opts.MPIEXEC, opts.PISM_PATH, method, output)
+
+    print(cmd)
+    result = subprocess.run(shlex.split(cmd), stdout=subprocess.PIPE, universal_newlines=True)
+    print(result.stdout)
+
+    if result.returncode != 0:
+        print("PISM failed (%s time stepping)" % method)
+        exit(1)
+
+    return result.stdout
+
+
+def check_convergence(log):
+    reasons = [line for line in log.split("\n") if "solve converged" in line or "solve did not converge" in line]
+
+    if len(reasons) == 0:
+        print("The implicit solver was not used")
+        exit(1)
+
+    for line in reasons:
+        if "did not converge" in line:
+            print("SNES failed to converge: %s" % line)
+            exit(1)
+
+    print("SNES converged %d times" % len(reasons))
+
+
+def compare(explicit, implicit):
+    nc1 = NC(explicit)
+    nc2 = NC(implicit)
+
+    for name in ("bwat", "bwp"):
+        v1 = np.squeeze(nc1.variables[name][:])
+        v2 = np.squeeze(nc2.variables[name][:])
+
+        diff = np.max(np.abs(v1 - v2)) / np.max(np.abs(v1))
+        print("%s: relative difference = %e" % (name, diff))
+
+        if not diff < tolerance:
+            print("Implicit and explicit results differ: %s (%e > %e)" % (name, diff, tolerance))
+            exit(1)
+
+    nc1.close()
+    nc2.close()
+
+
+def cleanup():
+    for fname in ("inputforP_regression.nc", "testPconfig.nc", "explicit.nc", "implicit.nc"):
+        os.remove(fname)
+
+
+if __name__ == "__main__":
+    opts = process_arguments()
+
+    copy_input(opts)
+    generate_config()
+
+    run_pism(opts, "explicit", "explicit.nc")
+    log = run_pism(opts, "implicit", "implicit.nc")
+
+    check_convergence(log)
+
+    compare("explicit.nc", "implicit.nc")
+
+    cleanup()
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2020 PISM Authors
+#
+# This file is part of PISM.
+#
+# PISM is free software; you can redistribute it and/or modify it under the
+# terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 3 of the License, or (at your option) any later
+# version.
+#
+# PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License
+# along with PISM; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""Expand 3D variables stored in ice-covered columns only (see the configuration parameter
+output.gathered_3d_variables) into regular (y, x, z) arrays.
+
+Uses the CF "compression by gathering" convention: the variable 'ice_column' contains
+zero-based indexes of stored columns in the (y, x) array (see its 'compress' attribute).
+Points in columns that are not stored get the fill value.
+"""
+
+from argparse import ArgumentParser
+
+import numpy as np
+
+try:
+    from netCDF4 import Dataset as NC
+except:
+    print("netCDF4 is not installed!")
+    import sys
+    sys.exit(1)
+
+ice_column = "ice_column"
+ice_column_levels = "ice_column_levels"
+default_fill_value = 9.969209968386869e+36
+
+
+def copy_attributes(source, destination, skip=()):
+    for name in source.ncattrs():
+        if name not in skip:
+            destination.setncattr(name, source.getncattr(name))
+
+
+def expand(data, index, shape, fill_value):
+    """Expand `data` (with the gathered dimension second to last) into an array with the
+    spatial dimensions `shape`, using `index` (zero-based indexes into the flattened
+    `shape` array)."""
+    leading = data.shape[:-2]
+    n_levels = data.shape[-1]
+
+    result = np.empty(leading + (shape[0] * shape[1], n_levels), dtype=data.dtype)
+    result[:] = fill_value
+    result[..., index, :] = np.ma.filled(data, fill_value)
+
+    return result.reshape(leading + shape + (n_levels,))
+
+
+def expand_file(input_filename, output_filename):
+    with NC(input_filename, "r") as f, NC(output_filename, "w", format=f.data_model) as out:
+        if ice_column not in f.variables:
+            raise RuntimeError("%s does not contain gathered variables" % input_filename)
+
+        compressed = f.variables[ice_column].compress.split()
+        shape = tuple(len(f.dimensions[d]) for d in compressed)
+        index = f.variables[ice_column][:]
+
+        copy_attributes(f, out)
+
+        for name, dim in f.dimensions.items():
+            if name != ice_column:
+                out.createDimension(name, None if dim.isunlimited() else len(dim))
+
+        for name, var in f.variables.items():
+            if name in (ice_column, ice_column_levels):
+                continue
+
+            if ice_column not in var.dimensions:
+                v = out.createVariable(name, var.dtype, var.dimensions,
+                                       fill_value=getattr(var, "_FillValue", None))
+                copy_attributes(var, v, skip=["_FillValue"])
+                v[:] = var[:]
+                continue
+
+            fill_value = getattr(var, "_FillValue", default_fill_value)
+
+            dims = []
+            for d in var.dimensions:
+                if d == ice_column:
+                    dims += compressed
+                else:
+                    dims.append(d)
+
+            v = out.createVariable(name, var.dtype, dims, fill_value=fill_value)
+            copy_attributes(var, v, skip=["_FillValue"])
+
+            # read without masking to keep fill values in the gathered array
+            var.set_auto_mask(False)
+            v[:] = expand(var[:], index, shape, fill_value)
+
+
+if __name__ == "__main__":
+    parser = ArgumentParser()
+    parser.description = __doc__
+    parser.add_argument("INPUT", nargs=1, help="input file")
+    parser.add_argument("OUTPUT", nargs=1, help="output file")
+
+    options = parser.parse_args()
+
+    expand_file(options.INPUT[0], options.OUTPUT[0])
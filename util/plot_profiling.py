@@ -45,15 +45,14 @@ big_events = ["basal_yield_stress",
 small_events = {}
 small_events["energy"] = ["ice_energy", "btu"]
 small_events["stress_balance"] = ["stress_balance.shallow", "stress_balance.modifier",
-                                  "stress_balance.strain_heat", "stress_balance.vertical_velocity"]
+                                  "stress_balance.3d_fields"]
 small_events["stress_balance.modifier"] = ["sia.bed_smoother",
                                            "sia.gradient", "sia.flux", "sia.3d_velocity"]
 small_events["io"] = ["io.backup", "io.extra_file", "io.model_state"]
 
 better_names = {"stress_balance.shallow": "SSA",
                 "stress_balance.modifier": "SIA",
-                "stress_balance.strain_heat": "Strain heating",
-                "stress_balance.vertical_velocity": "Vertical velocity"}
+                "stress_balance.3d_fields": "Vertical velocity and strain heating"}
 
 
 def get_event_times(event, n_procs):